@@ -49,6 +49,12 @@ find_package(OpenSSL MODULE REQUIRED)
 find_package(SELinux)
 set(EDEN_HAVE_SELINUX ${SELINUX_FOUND})
 
+# liburing is optional; without it FUSE requests are always read with read(2).
+if (CMAKE_SYSTEM_NAME STREQUAL "Linux")
+  find_package(Liburing)
+  set(EDEN_HAVE_LIBURING ${LIBURING_FOUND})
+endif()
+
 if("${ENABLE_GIT}" STREQUAL "AUTO")
   find_package(LibGit2 MODULE)
   set(EDEN_HAVE_GIT "${LibGit2_FOUND}")
@@ -104,6 +110,8 @@ set_target_properties(lz4::lz4 PROPERTIES
   INTERFACE_INCLUDE_DIRECTORIES "${LZ4_INCLUDES}"
 )
 
+find_package(Zstd MODULE REQUIRED)
+
 # TODO: It shouldn't be too hard to turn RocksDB and sqlite3 into optional
 # dependencies, since we have alternate LocalStore implementations.
 find_package(RocksDB CONFIG REQUIRED)
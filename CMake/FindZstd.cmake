@@ -0,0 +1,30 @@
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This software may be used and distributed according to the terms of the
+# GNU General Public License version 2.
+
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h)
+
+find_library(ZSTD_LIBRARY_DEBUG NAMES zstdd)
+find_library(ZSTD_LIBRARY_RELEASE NAMES zstd)
+
+include(SelectLibraryConfigurations)
+select_library_configurations(ZSTD)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+    Zstd DEFAULT_MSG
+    ZSTD_LIBRARY ZSTD_INCLUDE_DIR
+)
+
+if(ZSTD_FOUND)
+  add_library(Zstd::zstd UNKNOWN IMPORTED)
+  set_target_properties(
+    Zstd::zstd PROPERTIES
+    INTERFACE_INCLUDE_DIRECTORIES "${ZSTD_INCLUDE_DIR}"
+    IMPORTED_LINK_INTERFACE_LANGUAGES "C"
+    IMPORTED_LOCATION "${ZSTD_LIBRARY}"
+  )
+endif()
+
+mark_as_advanced(ZSTD_INCLUDE_DIR ZSTD_LIBRARY)
@@ -6,13 +6,207 @@
  */
 
 #include "eden/fs/benchharness/Bench.h"
+#include <errno.h>
+#include <folly/lang/Bits.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <time.h>
+#include <unistd.h>
+#include <cmath>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 namespace facebook {
 namespace eden {
 
+namespace {
+// Values below 2^kPrecisionBits each get their own bucket.  Above that, each
+// power of two is split into 2^(kPrecisionBits - 1) buckets.
+constexpr size_t kPrecisionBits = 8;
+constexpr size_t kSubBuckets = size_t{1} << (kPrecisionBits - 1);
+constexpr size_t kBucketCount = (64 - kPrecisionBits + 2) * kSubBuckets;
+
+#ifdef __linux__
+int openPerfEvent(uint32_t type, uint64_t config) {
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_hv = 1;
+  // Count only the calling thread, on any CPU.
+  auto fd =
+      syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+  if (fd == -1 && errno == EACCES) {
+    // Unprivileged processes may only be allowed to count user space events.
+    attr.exclude_kernel = 1;
+    fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+  }
+  return static_cast<int>(fd);
+}
+#endif
+
+void printPerfEvent(const char* name, const std::optional<uint64_t>& value) {
+  if (value) {
+    printf("  %s: %" PRIu64 "\n", name, *value);
+  } else {
+    printf("  %s: unavailable\n", name);
+  }
+}
+
+void combineCount(
+    std::optional<uint64_t>& count,
+    const std::optional<uint64_t>& other) {
+  if (count && other) {
+    *count += *other;
+  } else if (other) {
+    count = other;
+  }
+}
+} // namespace
+
+HistogramAccumulator::HistogramAccumulator() : buckets_(kBucketCount) {}
+
+size_t HistogramAccumulator::getBucket(uint64_t value) {
+  if (value < 2 * kSubBuckets) {
+    return value;
+  }
+  // Keep the kPrecisionBits most significant bits of value.
+  size_t shift = folly::findLastSet(value) - kPrecisionBits;
+  return (shift << (kPrecisionBits - 1)) + (value >> shift);
+}
+
+uint64_t HistogramAccumulator::getBucketMaximum(size_t bucket) {
+  if (bucket < 2 * kSubBuckets) {
+    return bucket;
+  }
+  size_t shift = (bucket >> (kPrecisionBits - 1)) - 1;
+  uint64_t mantissa = bucket - (shift << (kPrecisionBits - 1));
+  return (mantissa << shift) + ((uint64_t{1} << shift) - 1);
+}
+
+void HistogramAccumulator::add(uint64_t value) {
+  ++buckets_[getBucket(value)];
+  minimum_ = std::min(minimum_, value);
+  maximum_ = std::max(maximum_, value);
+  total_ += value;
+  ++count_;
+}
+
+void HistogramAccumulator::combine(const HistogramAccumulator& other) {
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  minimum_ = std::min(minimum_, other.minimum_);
+  maximum_ = std::max(maximum_, other.maximum_);
+  total_ += other.total_;
+  count_ += other.count_;
+}
+
+uint64_t HistogramAccumulator::getPercentile(double fraction) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  auto rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(fraction * count_)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(getBucketMaximum(i), maximum_);
+    }
+  }
+  return maximum_;
+}
+
+void printHistogram(
+    folly::StringPiece name,
+    const HistogramAccumulator& accum) {
+  printf(
+      "%.*s\n"
+      "  minimum: %" PRIu64 " ns\n"
+      "  average: %" PRIu64 " ns\n"
+      "  p50: %" PRIu64 " ns\n"
+      "  p90: %" PRIu64 " ns\n"
+      "  p99: %" PRIu64 " ns\n"
+      "  p99.9: %" PRIu64 " ns\n"
+      "  maximum: %" PRIu64 " ns\n",
+      static_cast<int>(name.size()),
+      name.data(),
+      accum.getMinimum(),
+      accum.getAverage(),
+      accum.getPercentile(0.5),
+      accum.getPercentile(0.9),
+      accum.getPercentile(0.99),
+      accum.getPercentile(0.999),
+      accum.getMaximum());
+}
+
+void PerfEventValues::combine(const PerfEventValues& other) {
+  combineCount(cycles, other.cycles);
+  combineCount(cacheMisses, other.cacheMisses);
+  combineCount(contextSwitches, other.contextSwitches);
+}
+
+void printPerfEvents(const PerfEventValues& values) {
+  printf("perf events\n");
+  printPerfEvent("cycles", values.cycles);
+  printPerfEvent("cache misses", values.cacheMisses);
+  printPerfEvent("context switches", values.contextSwitches);
+}
+
+PerfEventCounters::PerfEventCounters() {
+#ifdef __linux__
+  fds_ = {
+      openPerfEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+      openPerfEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES),
+      openPerfEvent(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES),
+  };
+#else
+  fds_.fill(-1);
+#endif
+}
+
+PerfEventCounters::~PerfEventCounters() {
+  for (auto fd : fds_) {
+    if (fd != -1) {
+      ::close(fd);
+    }
+  }
+}
+
+void PerfEventCounters::start() {
+#ifdef __linux__
+  for (auto fd : fds_) {
+    if (fd != -1) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+PerfEventValues PerfEventCounters::stop() {
+  std::array<std::optional<uint64_t>, 3> counts;
+#ifdef __linux__
+  for (size_t i = 0; i < fds_.size(); ++i) {
+    if (fds_[i] == -1) {
+      continue;
+    }
+    ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t count;
+    if (::read(fds_[i], &count, sizeof(count)) == sizeof(count)) {
+      counts[i] = count;
+    }
+  }
+#endif
+  return PerfEventValues{counts[0], counts[1], counts[2]};
+}
+
 uint64_t getTime() noexcept {
   timespec ts;
   // CLOCK_MONOTONIC is subject in NTP adjustments. CLOCK_MONOTONIC_RAW would be
@@ -8,10 +8,18 @@
 #pragma once
 
 #include <benchmark/benchmark.h>
+#include <folly/Range.h>
+#include <folly/functional/Invoke.h>
 #include <folly/init/Init.h>
+#include <folly/synchronization/test/Barrier.h>
 #include <stdint.h>
 #include <algorithm>
+#include <array>
 #include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 
 namespace facebook {
 namespace eden {
@@ -49,6 +57,138 @@ class StatAccumulator {
   uint64_t count_{0};
 };
 
+/**
+ * Accumulates data points into a histogram with logarithmic buckets, in the
+ * style of HdrHistogram, so that percentiles can be reported without
+ * keeping every data point.
+ *
+ * Values below 256 are recorded exactly, and larger values to within 1%.
+ *
+ * This type is a monoid.
+ */
+class HistogramAccumulator {
+ public:
+  HistogramAccumulator();
+
+  void add(uint64_t value);
+
+  void combine(const HistogramAccumulator& other);
+
+  uint64_t getCount() const {
+    return count_;
+  }
+
+  uint64_t getMinimum() const {
+    return minimum_;
+  }
+
+  uint64_t getMaximum() const {
+    return maximum_;
+  }
+
+  uint64_t getAverage() const {
+    return count_ ? total_ / count_ : 0;
+  }
+
+  /**
+   * Returns the value that fraction of the data points are less than or
+   * equal to, to within the precision of the buckets.  For example,
+   * getPercentile(0.99) is the p99.
+   */
+  uint64_t getPercentile(double fraction) const;
+
+ private:
+  static size_t getBucket(uint64_t value);
+  static uint64_t getBucketMaximum(size_t bucket);
+
+  std::vector<uint64_t> buckets_;
+  uint64_t minimum_{std::numeric_limits<uint64_t>::max()};
+  uint64_t maximum_{0};
+  uint64_t total_{0};
+  uint64_t count_{0};
+};
+
+/**
+ * Prints the minimum, average, p50, p90, p99, p99.9 and maximum of accum,
+ * which holds durations in nanoseconds.
+ */
+void printHistogram(folly::StringPiece name, const HistogramAccumulator& accum);
+
+/**
+ * Event counts measured by PerfEventCounters.  A count is std::nullopt if
+ * the event could not be counted, for example because perf_event_open() is
+ * not permitted or not supported on this platform.
+ *
+ * This type is a monoid.
+ */
+struct PerfEventValues {
+  std::optional<uint64_t> cycles;
+  std::optional<uint64_t> cacheMisses;
+  std::optional<uint64_t> contextSwitches;
+
+  void combine(const PerfEventValues& other);
+};
+
+void printPerfEvents(const PerfEventValues& values);
+
+/**
+ * Counts the CPU cycles, cache misses and context switches of the thread
+ * that creates it with perf_event_open(2), so that a regression can be
+ * attributed to more instructions, worse locality or more blocking.
+ *
+ * Counting is per thread, so each thread of a concurrent benchmark needs
+ * its own PerfEventCounters.  start() and stop() are cheap enough to wrap a
+ * whole benchmark loop, but not each iteration.
+ */
+class PerfEventCounters {
+ public:
+  PerfEventCounters();
+  ~PerfEventCounters();
+
+  PerfEventCounters(const PerfEventCounters&) = delete;
+  PerfEventCounters& operator=(const PerfEventCounters&) = delete;
+
+  /** Reset the counts to zero and start counting. */
+  void start();
+
+  /** Stop counting and return the counts since start(). */
+  PerfEventValues stop();
+
+ private:
+  std::array<int, 3> fds_;
+};
+
+/**
+ * Runs fn(threadIndex, gate) on threadCount threads at once and returns the
+ * combination of the Stats monoids that they return.
+ *
+ * Each thread should do any setup that is not part of the measurement, call
+ * gate.wait() so that every thread starts measuring together, and then run
+ * the benchmark.
+ */
+template <typename Fn>
+auto runConcurrently(uint64_t threadCount, Fn fn) {
+  using Stats = folly::invoke_result_t<Fn&, uint64_t, folly::test::Barrier&>;
+
+  folly::test::Barrier gate{threadCount};
+  std::mutex combinedMutex;
+  Stats combined;
+
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount);
+  for (uint64_t i = 0; i < threadCount; ++i) {
+    threads.emplace_back([&, i] {
+      auto stats = fn(i, gate);
+      std::lock_guard guard{combinedMutex};
+      combined.combine(stats);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return combined;
+}
+
 /**
  * Returns the current time in nanoseconds since some epoch. A fast timer
  * suitable for benchmarking short operations.
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Random.h>
+#include <vector>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/store/BlobCache.h"
+
+using namespace facebook::eden;
+
+namespace {
+
+constexpr size_t kBlobCount = 10000;
+constexpr size_t kBlobSize = 1024;
+
+std::vector<Hash> makeHashes() {
+  std::vector<Hash> hashes;
+  hashes.reserve(kBlobCount);
+  for (size_t i = 0; i < kBlobCount; ++i) {
+    Hash::Storage bytes;
+    folly::Random::secureRandom(bytes.data(), bytes.size());
+    hashes.emplace_back(bytes);
+  }
+  return hashes;
+}
+
+const std::vector<Hash>& getHashes() {
+  static const auto hashes = makeHashes();
+  return hashes;
+}
+
+/**
+ * Measures cache hits from many threads at once. The argument is the number
+ * of shards in the cache; compare results across shard counts and thread
+ * counts to see how lock contention scales.
+ */
+void blob_cache_get(benchmark::State& state) {
+  static std::shared_ptr<BlobCache> cache;
+  auto& hashes = getHashes();
+
+  if (state.thread_index == 0) {
+    cache = BlobCache::create(
+        kBlobCount * kBlobSize * 2, 0, static_cast<size_t>(state.range(0)));
+    std::string contents(kBlobSize, 'x');
+    for (auto& hash : hashes) {
+      cache->insert(std::make_shared<Blob>(hash, folly::StringPiece{contents}));
+    }
+  }
+
+  size_t index = folly::Random::rand32(kBlobCount);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cache->get(hashes[index]));
+    if (++index == kBlobCount) {
+      index = 0;
+    }
+  }
+
+  if (state.thread_index == 0) {
+    cache.reset();
+  }
+}
+BENCHMARK(blob_cache_get)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(64)
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(32)
+    ->Threads(64)
+    ->UseRealTime();
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
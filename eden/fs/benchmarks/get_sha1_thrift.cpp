@@ -8,15 +8,12 @@
 #include <benchmark/benchmark.h>
 #include <boost/filesystem.hpp>
 #include <folly/File.h>
-#include <folly/container/Array.h>
 #include <folly/init/Init.h>
 #include <folly/io/async/AsyncSocket.h>
 #include <folly/net/NetworkSocket.h>
-#include <folly/synchronization/test/Barrier.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <algorithm>
 #include <iostream>
-#include <numeric>
-#include <thread>
 #include <vector>
 
 #include "eden/fs/benchharness/Bench.h"
@@ -27,12 +24,18 @@ using namespace boost::filesystem;
 
 DEFINE_uint64(threads, 1, "The number of concurrent Thrift client threads");
 DEFINE_string(repo, "", "Path to Eden repository");
+DEFINE_uint64(
+    batch,
+    1,
+    "The number of paths to request in each getSHA1 call. Each thread starts "
+    "at a different file and wraps around the list of files.");
 
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
 
-  if (!FLAGS_threads) {
-    std::cerr << "Must specify nonzero number of threads" << std::endl;
+  if (!FLAGS_threads || !FLAGS_batch) {
+    std::cerr << "Must specify nonzero number of threads and batch size"
+              << std::endl;
     gflags::ShowUsageWithFlags(argv[0]);
     return 1;
   }
@@ -65,54 +68,42 @@ int main(int argc, char** argv) {
   path repo_path = real_path;
   const auto socket_path = repo_path / ".eden" / "socket";
   const unsigned nthreads = FLAGS_threads;
-  const auto samples_per_thread = 131072;
+  // Keep the number of paths requested roughly constant as the batch grows.
+  const uint64_t samples_per_thread =
+      std::max<uint64_t>(1, 131072 / FLAGS_batch);
 
-  std::vector<std::thread> threads;
-  folly::test::Barrier gate{static_cast<unsigned>(nthreads)};
-  std::vector<uint64_t> samples(nthreads * samples_per_thread);
-  for (unsigned i = 0; i < nthreads; ++i) {
-    threads.emplace_back(
-        [i, &gate, &socket_path, &repo_path, &samples, &files] {
-          folly::EventBase eventBase;
-          auto socket = folly::AsyncSocket::newSocket(
-              &eventBase,
-              folly::SocketAddress::makeFromPath(
-                  socket_path.string<std::string>()));
-          auto channel = apache::thrift::HeaderClientChannel::newChannel(
-              std::move(socket));
-          auto client =
-              std::make_unique<EdenServiceAsyncClient>(std::move(channel));
+  auto samples = runConcurrently(nthreads, [&](uint64_t i, auto& gate) {
+    HistogramAccumulator thread_samples;
+    std::vector<std::string> paths;
+    paths.reserve(FLAGS_batch);
+    for (uint64_t k = 0; k < FLAGS_batch; ++k) {
+      paths.push_back(files[(i + k) % files.size()]);
+    }
 
-          gate.wait();
-          for (auto j = 0; j < samples_per_thread; ++j) {
-            std::vector<SHA1Result> res;
-            auto start = getTime();
-            benchmark::DoNotOptimize(files[i]);
-            client->sync_getSHA1(res, repo_path.native(), {files[i]});
-            benchmark::DoNotOptimize(res);
-            auto duration = std::chrono::nanoseconds(getTime() - start);
-            samples[i * samples_per_thread + j] =
-                std::chrono::duration_cast<std::chrono::microseconds>(duration)
-                    .count();
-          }
-        });
-  }
+    folly::EventBase eventBase;
+    auto socket = folly::AsyncSocket::newSocket(
+        &eventBase,
+        folly::SocketAddress::makeFromPath(socket_path.string<std::string>()));
+    auto channel = apache::thrift::HeaderClientChannel::newChannel(
+        std::move(socket));
+    auto client = std::make_unique<EdenServiceAsyncClient>(std::move(channel));
 
-  for (auto& thread : threads) {
-    thread.join();
-  }
+    gate.wait();
+    for (uint64_t j = 0; j < samples_per_thread; ++j) {
+      std::vector<SHA1Result> res;
+      auto start = getTime();
+      benchmark::DoNotOptimize(paths);
+      client->sync_getSHA1(res, repo_path.native(), paths);
+      benchmark::DoNotOptimize(res);
+      thread_samples.add(getTime() - start);
+    }
+    return thread_samples;
+  });
 
-  // calculate statistics
-  std::sort(samples.begin(), samples.end());
-  double avg =
-      std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
-  std::cout << "avg: " << avg << "us" << std::endl;
-  std::cout << "min: " << samples[0] << "us" << std::endl;
-  const auto nsamples = samples_per_thread * nthreads;
-  auto pct = folly::make_array(0.05, 0.5, 0.95);
-  for (const auto& p : pct) {
-    std::cout << "p" << static_cast<uint64_t>(p * 100) << ": "
-              << samples[p * nsamples] << "us" << std::endl;
+  printHistogram("getSHA1()", samples);
+  if (FLAGS_batch > 1) {
+    std::cout << "average per path: " << samples.getAverage() / FLAGS_batch
+              << " ns" << std::endl;
   }
 
   return 0;
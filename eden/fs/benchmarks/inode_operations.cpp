@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+/*
+ * In-process benchmarks of the operations behind the hottest FUSE and Thrift
+ * requests.  Unlike the other benchmarks here, these need no running edenfs
+ * or mount: each one builds a TestMount over a FakeBackingStore.
+ *
+ * The argument of each benchmark is the size of the repository shape it runs
+ * against: the number of files in one directory for "wide" shapes, and the
+ * number of nested directories for "deep" ones.
+ *
+ * Pass --benchmark_format=json for machine-readable results.
+ */
+
+#include <folly/Conv.h>
+#include <folly/executors/ManualExecutor.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/fuse/DirList.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/FileInode.h"
+#include "eden/fs/inodes/GlobNode.h"
+#include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/journal/Journal.h"
+#include "eden/fs/store/DiffContext.h"
+#include "eden/fs/store/ObjectFetchContext.h"
+#include "eden/fs/store/ScmStatusDiffCallback.h"
+#include "eden/fs/telemetry/EdenStats.h"
+#include "eden/fs/testharness/FakeBackingStore.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+#include "eden/fs/testharness/TestUtil.h"
+
+using namespace facebook::eden;
+
+namespace {
+
+constexpr size_t kFileSize = 64 * 1024;
+
+std::string fileName(size_t i) {
+  return folly::to<std::string>("file", i);
+}
+
+/** A single directory, "wide", holding count files. */
+FakeTreeBuilder makeWideTree(size_t count) {
+  FakeTreeBuilder builder;
+  std::string contents(kFileSize, 'x');
+  for (size_t i = 0; i < count; ++i) {
+    builder.setFile(folly::to<std::string>("wide/", fileName(i)), contents);
+  }
+  return builder;
+}
+
+/** depth nested directories under "deep", each holding one file. */
+FakeTreeBuilder makeDeepTree(size_t depth) {
+  FakeTreeBuilder builder;
+  std::string dir = "deep";
+  for (size_t i = 0; i < depth; ++i) {
+    builder.setFile(folly::to<std::string>(dir, "/file"), "contents\n");
+    dir += "/d";
+  }
+  return builder;
+}
+
+/**
+ * The state shared by the threads running a benchmark.
+ *
+ * Thread 0 sets it up before the timed loop and tears it down after it.  The
+ * benchmark library synchronizes all threads as the loop starts and ends, so
+ * the other threads may only touch it inside the loop.
+ */
+struct SharedMount {
+  void setUp(FakeTreeBuilder builder) {
+    mount = std::make_unique<TestMount>(builder);
+    mount->loadAllInodes();
+  }
+
+  void tearDown() {
+    files.clear();
+    dir.reset();
+    mount.reset();
+  }
+
+  std::unique_ptr<TestMount> mount;
+  TreeInodePtr dir;
+  std::vector<FileInodePtr> files;
+};
+
+std::vector<PathComponent> makeNames(size_t count) {
+  std::vector<PathComponent> names;
+  names.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    names.emplace_back(fileName(i));
+  }
+  return names;
+}
+
+/** Looks up loaded children of a directory, as FUSE_LOOKUP does. */
+void lookup_wide(benchmark::State& state) {
+  static SharedMount shared;
+  auto count = static_cast<size_t>(state.range(0));
+  if (state.thread_index == 0) {
+    shared.setUp(makeWideTree(count));
+    shared.dir = shared.mount->getTreeInode("wide");
+  }
+  auto names = makeNames(count);
+
+  size_t index = static_cast<size_t>(state.thread_index) % count;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(shared.dir->getOrLoadChild(names[index]).get());
+    if (++index == count) {
+      index = 0;
+    }
+  }
+
+  if (state.thread_index == 0) {
+    shared.tearDown();
+  }
+}
+BENCHMARK(lookup_wide)
+    ->Arg(100)
+    ->Arg(10000)
+    ->Threads(1)
+    ->Threads(8)
+    ->UseRealTime();
+
+/** Resolves a path through every level of a deep tree. */
+void lookup_deep(benchmark::State& state) {
+  static SharedMount shared;
+  auto depth = static_cast<size_t>(state.range(0));
+  if (state.thread_index == 0) {
+    shared.setUp(makeDeepTree(depth));
+  }
+  std::string path = "deep";
+  for (size_t i = 1; i < depth; ++i) {
+    path += "/d";
+  }
+  path += "/file";
+  RelativePath relativePath{path};
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        shared.mount->getEdenMount()->getInode(relativePath).get());
+  }
+
+  if (state.thread_index == 0) {
+    shared.tearDown();
+  }
+}
+BENCHMARK(lookup_deep)->Arg(8)->Arg(64)->Threads(1)->Threads(8)->UseRealTime();
+
+/** Lists a whole directory, as a series of FUSE_READDIR requests does. */
+void readdir_wide(benchmark::State& state) {
+  static SharedMount shared;
+  if (state.thread_index == 0) {
+    shared.setUp(makeWideTree(static_cast<size_t>(state.range(0))));
+    shared.dir = shared.mount->getTreeInode("wide");
+  }
+
+  for (auto _ : state) {
+    off_t offset = 0;
+    while (true) {
+      auto list = shared.dir->readdir(
+          DirList{64 * 1024}, offset, ObjectFetchContext::getNullContext());
+      auto entries = list.extract();
+      if (entries.empty()) {
+        break;
+      }
+      offset = entries.back().offset;
+    }
+  }
+
+  if (state.thread_index == 0) {
+    shared.tearDown();
+  }
+}
+BENCHMARK(readdir_wide)
+    ->Arg(100)
+    ->Arg(10000)
+    ->Threads(1)
+    ->Threads(8)
+    ->UseRealTime();
+
+/** Reads 4KB from files whose blobs are already loaded. */
+void read_file(benchmark::State& state) {
+  static SharedMount shared;
+  auto count = static_cast<size_t>(state.range(0));
+  if (state.thread_index == 0) {
+    shared.setUp(makeWideTree(count));
+    for (size_t i = 0; i < count; ++i) {
+      shared.files.push_back(
+          shared.mount->getFileInode(
+              folly::to<std::string>("wide/", fileName(i))));
+    }
+  }
+
+  size_t index = static_cast<size_t>(state.thread_index) % count;
+  off_t offset = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        shared.files[index]
+            ->read(4096, offset, ObjectFetchContext::getNullContext())
+            .get());
+    offset = (offset + 4096) % kFileSize;
+    if (++index == count) {
+      index = 0;
+    }
+  }
+
+  if (state.thread_index == 0) {
+    shared.tearDown();
+  }
+}
+BENCHMARK(read_file)->Arg(64)->Threads(1)->Threads(8)->UseRealTime();
+
+/** Overwrites 4KB of a materialized file, each thread its own file. */
+void write_file(benchmark::State& state) {
+  static SharedMount shared;
+  if (state.thread_index == 0) {
+    shared.setUp(makeWideTree(static_cast<size_t>(state.threads)));
+    for (int i = 0; i < state.threads; ++i) {
+      auto file = shared.mount->getFileInode(
+          folly::to<std::string>("wide/", fileName(i)));
+      // The first write materializes the file.
+      file->write("x", 0).get();
+      shared.files.push_back(std::move(file));
+    }
+  }
+  std::string data(4096, 'y');
+
+  off_t offset = 0;
+  for (auto _ : state) {
+    auto& file = shared.files[static_cast<size_t>(state.thread_index)];
+    benchmark::DoNotOptimize(file->write(data, offset).get());
+    offset = (offset + 4096) % kFileSize;
+  }
+
+  if (state.thread_index == 0) {
+    shared.tearDown();
+  }
+}
+BENCHMARK(write_file)->Threads(1)->Threads(8)->UseRealTime();
+
+/**
+ * Computes the status of a mount with one modified file.  This bypasses the
+ * mount's status cache, so each iteration walks the loaded inodes.
+ */
+void status_wide(benchmark::State& state) {
+  SharedMount shared;
+  shared.setUp(makeWideTree(static_cast<size_t>(state.range(0))));
+  shared.mount->overwriteFile("wide/file0", "modified\n");
+  auto* edenMount = shared.mount->getEdenMount().get();
+  auto commitHash = edenMount->getParentCommits().parent1();
+
+  for (auto _ : state) {
+    ScmStatusDiffCallback callback;
+    DiffContext context{&callback, edenMount->getObjectStore()};
+    edenMount->diff(&context, commitHash).get();
+    benchmark::DoNotOptimize(callback.extractStatus());
+  }
+
+  shared.tearDown();
+}
+BENCHMARK(status_wide)->Arg(100)->Arg(10000);
+
+/** Evaluates a recursive glob matching every file. */
+void glob_wide(benchmark::State& state) {
+  SharedMount shared;
+  shared.setUp(makeWideTree(static_cast<size_t>(state.range(0))));
+  auto* edenMount = shared.mount->getEdenMount().get();
+  GlobNode globRoot{/*includeDotfiles=*/false};
+  globRoot.parse("**/file*");
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(globRoot
+                                 .evaluate(
+                                     edenMount->getObjectStore(),
+                                     ObjectFetchContext::getNullContext(),
+                                     RelativePathPiece{},
+                                     edenMount->getRootInode(),
+                                     nullptr)
+                                 .get());
+  }
+
+  shared.tearDown();
+}
+BENCHMARK(glob_wide)->Arg(100)->Arg(10000);
+
+/**
+ * Checks out back and forth between two commits that differ in a tenth of the
+ * files of a wide directory.
+ */
+void checkout_wide(benchmark::State& state) {
+  auto count = static_cast<size_t>(state.range(0));
+  auto builder1 = makeWideTree(count);
+  SharedMount shared;
+  shared.setUp(builder1.clone());
+  auto* backingStore = shared.mount->getBackingStore().get();
+
+  auto builder2 = builder1.clone();
+  for (size_t i = 0; i < count; i += 10) {
+    builder2.replaceFile(
+        folly::to<std::string>("wide/", fileName(i)), "changed\n");
+  }
+  builder2.finalize(shared.mount->getBackingStore(), true);
+  backingStore->putCommit("2", builder2)->setReady();
+
+  auto* edenMount = shared.mount->getEdenMount().get();
+  auto* executor = shared.mount->getServerExecutor().get();
+  std::vector<Hash> commits{makeTestHash("2"), makeTestHash("1")};
+  size_t next = 0;
+  for (auto _ : state) {
+    auto result = edenMount->checkout(commits[next], std::nullopt, __func__)
+                      .waitVia(executor)
+                      .get();
+    benchmark::DoNotOptimize(result);
+    next ^= 1;
+  }
+
+  shared.tearDown();
+}
+BENCHMARK(checkout_wide)->Arg(100)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+/**
+ * Sums every change recorded in a journal, as getFilesChangedSince() does
+ * for a client that has not asked in a while.
+ */
+void journal_accumulate_range(benchmark::State& state) {
+  Journal journal{std::make_shared<EdenStats>()};
+  auto count = static_cast<size_t>(state.range(0));
+  for (size_t i = 0; i < count; ++i) {
+    journal.recordChanged(RelativePath{fileName(i % 1000)});
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(journal.accumulateRange(1));
+  }
+}
+BENCHMARK(journal_accumulate_range)->Arg(1000)->Arg(100000);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
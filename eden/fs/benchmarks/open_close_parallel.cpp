@@ -9,22 +9,36 @@
 #include <folly/Exception.h>
 #include <folly/Likely.h>
 #include <folly/init/Init.h>
-#include <folly/synchronization/test/Barrier.h>
 #include <gflags/gflags.h>
 #include <inttypes.h>
 #include <string.h>
 #include <unistd.h>
-#include <limits>
-#include <mutex>
 #include <system_error>
-#include <thread>
 #include "eden/fs/benchharness/Bench.h"
 
 DEFINE_uint64(threads, 1, "The number of concurrent open/close threads");
 DEFINE_uint64(iterations, 100000, "Number of open/close iterations per thread");
+DEFINE_bool(
+    perf_events,
+    false,
+    "Also count cycles, cache misses and context switches");
 
 using namespace facebook::eden;
 
+namespace {
+struct OpenCloseStats {
+  HistogramAccumulator open;
+  HistogramAccumulator close;
+  PerfEventValues perfEvents;
+
+  void combine(const OpenCloseStats& other) {
+    open.combine(other.open);
+    close.combine(other.close);
+    perfEvents.combine(other.perfEvents);
+  }
+};
+} // namespace
+
 int main(int argc, char** argv) {
   folly::init(&argc, &argv);
 
@@ -54,18 +68,18 @@ int main(int argc, char** argv) {
     ::close(fd);
   }
 
-  folly::test::Barrier gate{FLAGS_threads};
-
-  std::mutex result_mutex;
-  StatAccumulator combined_open;
-  StatAccumulator combined_close;
-
-  auto thread = [&] {
-    StatAccumulator open_accum;
-    StatAccumulator close_accum;
+  auto combined = runConcurrently(FLAGS_threads, [&](uint64_t, auto& gate) {
+    OpenCloseStats stats;
+    std::optional<PerfEventCounters> counters;
+    if (FLAGS_perf_events) {
+      counters.emplace();
+    }
     int file_index = 1;
 
     gate.wait();
+    if (counters) {
+      counters->start();
+    }
 
     for (uint64_t i = 0; i < FLAGS_iterations; ++i) {
       const char* filename = argv[file_index];
@@ -83,31 +97,19 @@ int main(int argc, char** argv) {
         file_index = 1;
       }
 
-      open_accum.add(after_open - start_time);
-      close_accum.add(after_close - after_open);
+      stats.open.add(after_open - start_time);
+      stats.close.add(after_close - after_open);
     }
 
-    std::lock_guard guard{result_mutex};
-    combined_open.combine(open_accum);
-    combined_close.combine(close_accum);
-  };
-
-  std::vector<std::thread> threads;
-  threads.reserve(FLAGS_threads);
-  for (uint64_t t = 0; t < FLAGS_threads; ++t) {
-    threads.emplace_back(thread);
-  }
+    if (counters) {
+      stats.perfEvents = counters->stop();
+    }
+    return stats;
+  });
 
-  for (auto& thread : threads) {
-    thread.join();
+  printHistogram("open()", combined.open);
+  printHistogram("close()", combined.close);
+  if (FLAGS_perf_events) {
+    printPerfEvents(combined.perfEvents);
   }
-
-  printf(
-      "open()\n  minimum: %" PRIu64 " ns\n  average: %" PRIu64 " ns\n",
-      combined_open.getMinimum(),
-      combined_open.getAverage());
-  printf(
-      "close()\n  minimum: %" PRIu64 " ns\n  average: %" PRIu64 " ns\n",
-      combined_close.getMinimum(),
-      combined_close.getAverage());
 }
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <boost/filesystem.hpp>
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/init/Init.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <thrift/lib/cpp2/async/HeaderClientChannel.h>
+#include <array>
+#include <cinttypes>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/service/gen-cpp2/EdenService.h"
+
+using namespace facebook::eden;
+using namespace boost::filesystem;
+
+DEFINE_uint64(threads, 1, "The number of concurrent Thrift client threads");
+DEFINE_string(repo, "", "Path to Eden repository");
+DEFINE_uint64(calls, 10000, "The number of calls each thread makes");
+DEFINE_double(
+    rate,
+    0,
+    "Total calls per second to send, spread evenly across threads. Latency is "
+    "measured from each call's scheduled send time, so it includes any time "
+    "spent waiting behind a slow call. 0 sends each call as soon as the "
+    "previous one on its thread returns.");
+DEFINE_string(
+    mix,
+    "getScmStatusV2:1,globFiles:1,getFilesChangedSince:1,getSHA1:4,"
+    "getFileInformation:4",
+    "Relative frequency of each method");
+DEFINE_string(glob, "**/*", "The pattern globFiles() matches");
+DEFINE_uint64(
+    batch,
+    1,
+    "The number of paths in each getSHA1 and getFileInformation call");
+DEFINE_string(
+    replay,
+    "",
+    "Replay the calls in this file instead of generating them from --mix. "
+    "Each line is a method name followed by its space-separated paths or "
+    "globs; threads take turns taking lines, wrapping around at the end.");
+
+namespace {
+
+enum class Method {
+  GetScmStatusV2,
+  GlobFiles,
+  GetFilesChangedSince,
+  GetSHA1,
+  GetFileInformation,
+};
+constexpr size_t kNumMethods = 5;
+constexpr std::array<folly::StringPiece, kNumMethods> kMethodNames{
+    "getScmStatusV2",
+    "globFiles",
+    "getFilesChangedSince",
+    "getSHA1",
+    "getFileInformation",
+};
+
+Method parseMethod(folly::StringPiece name) {
+  auto it = std::find(kMethodNames.begin(), kMethodNames.end(), name);
+  if (it == kMethodNames.end()) {
+    throw std::invalid_argument(
+        folly::to<std::string>("unknown Thrift method: ", name));
+  }
+  return static_cast<Method>(it - kMethodNames.begin());
+}
+
+std::array<double, kNumMethods> parseMix(folly::StringPiece mix) {
+  std::array<double, kNumMethods> weights{};
+  std::vector<folly::StringPiece> terms;
+  folly::split(',', mix, terms);
+  for (auto term : terms) {
+    folly::StringPiece name;
+    folly::StringPiece weight;
+    if (!folly::split(':', term, name, weight)) {
+      throw std::invalid_argument(
+          folly::to<std::string>("invalid --mix term: ", term));
+    }
+    weights[static_cast<size_t>(parseMethod(name))] =
+        folly::to<double>(weight);
+  }
+  return weights;
+}
+
+struct Call {
+  Method method;
+  // The paths for getSHA1 and getFileInformation, or the globs for
+  // globFiles.
+  std::vector<std::string> args;
+};
+
+std::vector<Call> readReplayFile(const std::string& filename) {
+  std::ifstream input{filename};
+  if (!input) {
+    throw std::runtime_error(
+        folly::to<std::string>("unable to open replay file ", filename));
+  }
+  std::vector<Call> calls;
+  std::string line;
+  while (std::getline(input, line)) {
+    std::vector<std::string> words;
+    folly::split(' ', line, words, /*ignoreEmpty=*/true);
+    if (words.empty() || words[0][0] == '#') {
+      continue;
+    }
+    Call call{parseMethod(words[0]), {}};
+    call.args.assign(
+        std::make_move_iterator(words.begin() + 1),
+        std::make_move_iterator(words.end()));
+    calls.push_back(std::move(call));
+  }
+  if (calls.empty()) {
+    throw std::runtime_error(
+        folly::to<std::string>("no calls in replay file ", filename));
+  }
+  return calls;
+}
+
+struct LoadStats {
+  std::array<HistogramAccumulator, kNumMethods> latency;
+  std::array<uint64_t, kNumMethods> errors{};
+
+  void combine(const LoadStats& other) {
+    for (size_t i = 0; i < kNumMethods; ++i) {
+      latency[i].combine(other.latency[i]);
+      errors[i] += other.errors[i];
+    }
+  }
+};
+
+/** One thread's connection to the daemon and the state its calls need. */
+class LoadClient {
+ public:
+  LoadClient(folly::EventBase& eventBase, const path& repoPath)
+      : mountPoint_{repoPath.string<std::string>()} {
+    auto socketPath = repoPath / ".eden" / "socket";
+    auto socket = folly::AsyncSocket::newSocket(
+        &eventBase,
+        folly::SocketAddress::makeFromPath(socketPath.string<std::string>()));
+    client_ = std::make_unique<EdenServiceAsyncClient>(
+        apache::thrift::HeaderClientChannel::newChannel(std::move(socket)));
+
+    WorkingDirectoryParents parents;
+    client_->sync_getParentCommits(parents, mountPoint_);
+    commit_ = *parents.parent1_ref();
+    client_->sync_getCurrentJournalPosition(position_, mountPoint_);
+  }
+
+  void call(const Call& call) {
+    switch (call.method) {
+      case Method::GetScmStatusV2: {
+        GetScmStatusParams params;
+        *params.mountPoint_ref() = mountPoint_;
+        *params.commit_ref() = commit_;
+        GetScmStatusResult result;
+        client_->sync_getScmStatusV2(result, params);
+        return;
+      }
+      case Method::GlobFiles: {
+        GlobParams params;
+        *params.mountPoint_ref() = mountPoint_;
+        *params.globs_ref() = call.args;
+        Glob result;
+        client_->sync_globFiles(result, params);
+        return;
+      }
+      case Method::GetFilesChangedSince: {
+        // Ask for the changes since this thread connected, so the delta
+        // grows with any writes made while the load runs.
+        FileDelta result;
+        client_->sync_getFilesChangedSince(result, mountPoint_, position_);
+        return;
+      }
+      case Method::GetSHA1: {
+        std::vector<SHA1Result> result;
+        client_->sync_getSHA1(result, mountPoint_, call.args);
+        return;
+      }
+      case Method::GetFileInformation: {
+        std::vector<FileInformationOrError> result;
+        client_->sync_getFileInformation(result, mountPoint_, call.args);
+        return;
+      }
+    }
+    throw std::logic_error("unknown Thrift method");
+  }
+
+ private:
+  std::string mountPoint_;
+  std::string commit_;
+  JournalPosition position_;
+  std::unique_ptr<EdenServiceAsyncClient> client_;
+};
+
+/** Generates calls from --mix, spreading their paths over the given files. */
+class CallGenerator {
+ public:
+  CallGenerator(const std::vector<std::string>& files, uint64_t seed)
+      : files_{files}, rng_{seed} {
+    auto weights = parseMix(FLAGS_mix);
+    pickMethod_ = std::discrete_distribution<size_t>{
+        weights.begin(), weights.end()};
+  }
+
+  Call next() {
+    Call call{static_cast<Method>(pickMethod_(rng_)), {}};
+    switch (call.method) {
+      case Method::GlobFiles:
+        call.args.push_back(FLAGS_glob);
+        break;
+      case Method::GetSHA1:
+      case Method::GetFileInformation: {
+        std::uniform_int_distribution<size_t> pickFile{0, files_.size() - 1};
+        auto first = pickFile(rng_);
+        for (uint64_t k = 0; k < FLAGS_batch; ++k) {
+          call.args.push_back(files_[(first + k) % files_.size()]);
+        }
+        break;
+      }
+      case Method::GetScmStatusV2:
+      case Method::GetFilesChangedSince:
+        break;
+    }
+    return call;
+  }
+
+ private:
+  const std::vector<std::string>& files_;
+  std::mt19937_64 rng_;
+  std::discrete_distribution<size_t> pickMethod_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+
+  if (!FLAGS_threads || !FLAGS_batch || !FLAGS_calls) {
+    std::cerr << "Must specify nonzero number of threads, calls and batch size"
+              << std::endl;
+    gflags::ShowUsageWithFlags(argv[0]);
+    return 1;
+  }
+  if (FLAGS_repo.empty()) {
+    std::cerr << "Must specify a repository root" << std::endl;
+    gflags::ShowUsageWithFlagsRestrict(argv[0], __FILE__);
+    return 1;
+  }
+
+  auto real_path = realpath(FLAGS_repo.c_str(), nullptr);
+  if (!real_path) {
+    perror("realpath on given repo failed");
+    return 1;
+  }
+  SCOPE_EXIT {
+    free(real_path);
+  };
+  path repo_path = real_path;
+
+  std::vector<Call> replay;
+  std::vector<std::string> files;
+  if (!FLAGS_replay.empty()) {
+    replay = readReplayFile(FLAGS_replay);
+  } else {
+    for (int i = 1; i < argc; ++i) {
+      files.emplace_back(argv[i]);
+    }
+    if (files.empty()) {
+      std::cerr << "Must specify a set of files to query, or --replay"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  // Each thread sends a call every interval, offset so that the threads'
+  // calls interleave evenly.
+  const uint64_t interval_ns = FLAGS_rate > 0
+      ? static_cast<uint64_t>(FLAGS_threads * 1e9 / FLAGS_rate)
+      : 0;
+
+  auto start = getTime();
+  auto stats = runConcurrently(FLAGS_threads, [&](uint64_t i, auto& gate) {
+    LoadStats thread_stats;
+    folly::EventBase eventBase;
+    LoadClient client{eventBase, repo_path};
+    CallGenerator generator{files, std::random_device{}()};
+
+    gate.wait();
+    auto thread_start = getTime() + interval_ns * i / FLAGS_threads;
+    for (uint64_t j = 0; j < FLAGS_calls; ++j) {
+      auto call = replay.empty()
+          ? generator.next()
+          : replay[(i + j * FLAGS_threads) % replay.size()];
+
+      auto scheduled = getTime();
+      if (interval_ns) {
+        scheduled = thread_start + j * interval_ns;
+        auto now = getTime();
+        if (now < scheduled) {
+          std::this_thread::sleep_for(
+              std::chrono::nanoseconds(scheduled - now));
+        }
+      }
+
+      auto index = static_cast<size_t>(call.method);
+      try {
+        client.call(call);
+      } catch (const std::exception&) {
+        ++thread_stats.errors[index];
+      }
+      thread_stats.latency[index].add(getTime() - scheduled);
+    }
+    return thread_stats;
+  });
+  auto seconds = (getTime() - start) / 1e9;
+
+  printf(
+      "%" PRIu64 " calls on %" PRIu64 " threads in %.2f s: %.0f calls/s\n",
+      FLAGS_calls * FLAGS_threads,
+      FLAGS_threads,
+      seconds,
+      FLAGS_calls * FLAGS_threads / seconds);
+  for (size_t i = 0; i < kNumMethods; ++i) {
+    const auto& latency = stats.latency[i];
+    if (latency.getCount() == 0) {
+      continue;
+    }
+    printHistogram(
+        folly::to<std::string>(
+            kMethodNames[i],
+            "(): ",
+            latency.getCount(),
+            " calls, ",
+            stats.errors[i],
+            " errors"),
+        latency);
+  }
+
+  return 0;
+}
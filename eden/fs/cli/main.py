@@ -24,7 +24,13 @@ from eden.fs.cli.telemetry import TelemetrySample
 from eden.fs.cli.util import check_health_using_lockfile, wait_for_instance_healthy
 from eden.thrift.legacy import EdenClient, EdenNotRunningError
 from facebook.eden import EdenService
-from facebook.eden.ttypes import GlobParams, MountInfo as ThriftMountInfo, MountState
+from facebook.eden.ttypes import (
+    GlobParams,
+    HydrateCommitParams,
+    MountInfo as ThriftMountInfo,
+    MountState,
+    StartBuildSessionParams,
+)
 from fb303_core.ttypes import fb303_status
 
 from . import (
@@ -1168,6 +1174,86 @@ class PrefetchCmd(Subcmd):
         return 0
 
 
+@subcmd("hydrate", "Import all of a commit's trees ahead of reading them")
+class HydrateCmd(Subcmd):
+    def setup_parser(self, parser: argparse.ArgumentParser) -> None:
+        parser.add_argument(
+            "--repo", help="Specify path to repo root (default: root of cwd)"
+        )
+        parser.add_argument(
+            "--commit",
+            help="The commit to import (default: the working copy parent)",
+        )
+        parser.add_argument(
+            "PATH",
+            nargs="*",
+            help=(
+                "Also import the contents of the files under these paths, "
+                "relative to the repo root; '.' selects every file"
+            ),
+        )
+
+    def run(self, args: argparse.Namespace) -> int:
+        instance, checkout, _rel_path = require_checkout(args, args.repo)
+        commit = args.commit or checkout.get_snapshot()
+        blob_paths = [b"" if path == "." else os.fsencode(path) for path in args.PATH]
+
+        with instance.get_thrift_client() as client:
+            result = client.hydrateCommit(
+                HydrateCommitParams(
+                    mountPoint=bytes(checkout.path),
+                    commit=commit.encode(),
+                    blobPaths=blob_paths,
+                )
+            )
+        print(f"Imported {result.treeCount} trees and {result.blobCount} files")
+        return 0
+
+
+@subcmd("build-session", "Tell EdenFS that a build is about to run")
+class BuildSessionCmd(Subcmd):
+    def setup_parser(self, parser: argparse.ArgumentParser) -> None:
+        parser.add_argument(
+            "--repo", help="Specify path to repo root (default: root of cwd)"
+        )
+        parser.add_argument(
+            "--duration",
+            type=int,
+            default=3600,
+            help="How long the session lasts, in seconds (default: %(default)s)",
+        )
+        parser.add_argument(
+            "--end",
+            action="store_true",
+            help="End the session early and print what it did",
+        )
+        parser.add_argument(
+            "PREFIX",
+            nargs="*",
+            help="Prefetch the trees under these paths, relative to the repo root",
+        )
+
+    def run(self, args: argparse.Namespace) -> int:
+        instance, checkout, _rel_path = require_checkout(args, args.repo)
+        with instance.get_thrift_client() as client:
+            if args.end:
+                info = client.endBuildSession(bytes(checkout.path))
+            else:
+                info = client.startBuildSession(
+                    StartBuildSessionParams(
+                        mountPoint=bytes(checkout.path),
+                        prefixes=[os.fsencode(prefix) for prefix in args.PREFIX],
+                        durationSeconds=args.duration,
+                    )
+                )
+        print(f"Remaining: {info.remainingSeconds}s")
+        print(f"Prefetched trees: {info.prefetchedTrees}")
+        print(f"Blob cache hits: {info.blobCacheHits}")
+        print(f"Blob cache misses: {info.blobCacheMisses}")
+        print(f"Deferred unloads: {info.deferredUnloads}")
+        return 0
+
+
 #
 # Most users should not need the "unmount" command in most circumstances.
 # Maybe we should deprecate or remove it in the future.
@@ -29,6 +29,11 @@ const facebook::eden::RelativePathPiece kCheckoutConfig{"config.toml"};
 constexpr folly::StringPiece kRepoSection{"repository"};
 constexpr folly::StringPiece kRepoSourceKey{"path"};
 constexpr folly::StringPiece kRepoTypeKey{"type"};
+constexpr folly::StringPiece kOverlaySection{"overlay"};
+constexpr folly::StringPiece kOverlayTypeKey{"type"};
+constexpr folly::StringPiece kFilterSection{"filter"};
+constexpr folly::StringPiece kFilterIncludeKey{"include"};
+constexpr folly::StringPiece kFilterExcludeKey{"exclude"};
 
 // Files of interest in the client directory.
 const facebook::eden::RelativePathPiece kSnapshotFile{"SNAPSHOT"};
@@ -49,6 +54,37 @@ enum : uint32_t {
   kSnapshotHeaderSize = 8,
   kSnapshotFormatVersion = 1,
 };
+
+std::vector<facebook::eden::RelativePath> loadFilterPrefixes(
+    const cpptoml::table& filter,
+    folly::StringPiece key,
+    facebook::eden::AbsolutePathPiece configPath) {
+  std::vector<facebook::eden::RelativePath> prefixes;
+  auto values = filter.get_array_of<std::string>(key.str());
+  if (!values) {
+    if (filter.contains(key.str())) {
+      throw std::runtime_error(folly::sformat(
+          "filter {} in {} must be an array of paths", key, configPath));
+    }
+    return prefixes;
+  }
+  for (const auto& value : *values) {
+    try {
+      facebook::eden::RelativePath prefix{value};
+      if (!prefix.empty()) {
+        prefixes.push_back(std::move(prefix));
+      }
+    } catch (const std::exception& ex) {
+      throw std::runtime_error(folly::sformat(
+          "invalid filter {} path \"{}\" in {}: {}",
+          key,
+          value,
+          configPath,
+          folly::exceptionStr(ex)));
+    }
+  }
+  return prefixes;
+}
 } // namespace
 
 namespace facebook {
@@ -179,6 +215,28 @@ std::unique_ptr<CheckoutConfig> CheckoutConfig::loadFromClientDirectory(
   config->repoType_ = *repository->get_as<std::string>(kRepoTypeKey.str());
   config->repoSource_ = *repository->get_as<std::string>(kRepoSourceKey.str());
 
+  // Load overlay information, if any
+  auto overlay = configRoot->get_table(kOverlaySection.str());
+  if (overlay) {
+    auto overlayType = overlay->get_as<std::string>(kOverlayTypeKey.str());
+    if (overlayType) {
+      if (*overlayType == "sqlite") {
+        config->overlayType_ = OverlayType::Sqlite;
+      } else if (*overlayType != "filesystem") {
+        throw std::runtime_error(folly::sformat(
+            "unsupported overlay type \"{}\" in {}", *overlayType, configPath));
+      }
+    }
+  }
+
+  // Load the filter, if any
+  auto filter = configRoot->get_table(kFilterSection.str());
+  if (filter) {
+    config->filter_ = CheckoutFilter{
+        loadFilterPrefixes(*filter, kFilterIncludeKey, configPath),
+        loadFilterPrefixes(*filter, kFilterExcludeKey, configPath)};
+  }
+
   return config;
 }
 
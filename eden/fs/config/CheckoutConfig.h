@@ -9,6 +9,7 @@
 
 #include <folly/dynamic.h>
 #include <optional>
+#include "eden/fs/model/CheckoutFilter.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/model/ParentCommits.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -16,6 +17,16 @@
 namespace facebook {
 namespace eden {
 
+/**
+ * Where a checkout's overlay keeps its directory data.
+ */
+enum class OverlayType {
+  /** One file per directory, alongside the materialized files. */
+  Filesystem,
+  /** A single SQLite database.  File contents still use one file each. */
+  Sqlite,
+};
+
 /**
  * CheckoutConfig contains the configuration state for a single Eden checkout.
  *
@@ -90,6 +101,25 @@ class CheckoutConfig {
     return repoSource_;
   }
 
+  /**
+   * Get the overlay type, from the optional "type" key of the [overlay]
+   * section.  Supported values are "filesystem", the default, and "sqlite".
+   * Existing overlays are migrated when the type changes.
+   */
+  OverlayType getOverlayType() const {
+    return overlayType_;
+  }
+
+  /**
+   * Get the checkout's filter, from the optional [filter] section.  Its
+   * "include" and "exclude" keys are arrays of directory paths: when there
+   * are includes, only they and the directories leading to them are
+   * visible, and the excludes are hidden even under an include.
+   */
+  const CheckoutFilter& getFilter() const {
+    return filter_;
+  }
+
   /** Path to the file where the current commit ID is stored */
   AbsolutePath getSnapshotPath() const;
 
@@ -101,6 +131,8 @@ class CheckoutConfig {
   const AbsolutePath mountPath_;
   std::string repoType_;
   std::string repoSource_;
+  OverlayType overlayType_{OverlayType::Filesystem};
+  CheckoutFilter filter_;
 };
 } // namespace eden
 } // namespace facebook
@@ -202,6 +202,16 @@ class EdenConfig : private ConfigSettingManager {
                                              kUnspecifiedDefault,
                                              this};
 
+  /**
+   * The number of recently resolved paths whose inode numbers each mount
+   * keeps, so that thrift calls naming the same paths do not walk from the
+   * root each time.  0 disables this.  Read when a mount starts.
+   */
+  ConfigSetting<uint64_t> inodePathCacheSize{
+      "core:inode-path-cache-size",
+      16384,
+      this};
+
   /**
    * How often to check the on-disk lock file to ensure it is still valid.
    * EdenFS will exit if the lock file is no longer valid.
@@ -211,6 +221,52 @@ class EdenConfig : private ConfigSettingManager {
       std::chrono::minutes(5),
       this};
 
+  /**
+   * When more than this many inodes are loaded across all mounts, EdenFS
+   * unloads the least recently accessed ones until no more than
+   * core:unload-inode-low-watermark remain.  0 disables this.
+   */
+  ConfigSetting<uint64_t> unloadInodeHighWatermark{
+      "core:unload-inode-high-watermark",
+      0,
+      this};
+
+  /**
+   * The number of loaded inodes to unload down to once a high watermark has
+   * been crossed.  0 unloads a quarter of the loaded inodes.
+   */
+  ConfigSetting<uint64_t> unloadInodeLowWatermark{
+      "core:unload-inode-low-watermark",
+      0,
+      this};
+
+  /**
+   * Also start unloading inodes when the resident set size of the process
+   * exceeds this many bytes.  0 disables this.
+   */
+  ConfigSetting<uint64_t> unloadRssHighWatermark{
+      "core:unload-rss-high-watermark",
+      0,
+      this};
+
+  /**
+   * How often to unload inodes that have not been accessed for
+   * core:background-unload-age, across all mounts.  0 disables this.
+   */
+  ConfigSetting<std::chrono::nanoseconds> backgroundUnloadInterval{
+      "core:background-unload-interval",
+      std::chrono::nanoseconds::zero(),
+      this};
+
+  /**
+   * The minimum time since an inode was last accessed before background and
+   * memory pressure unloading may unload it.
+   */
+  ConfigSetting<std::chrono::nanoseconds> backgroundUnloadAge{
+      "core:background-unload-age",
+      std::chrono::hours(6),
+      this};
+
   ConfigSetting<bool> allowUnixGroupRequests{"thrift:allow-unix-group-requests",
                                              false,
                                              this};
@@ -289,6 +345,192 @@ class EdenConfig : private ConfigSettingManager {
       20'000'000,
       this};
 
+  ConfigSetting<uint64_t> localStoreFetchProfileSizeLimit{
+      "store:fetchprofile-size-limit",
+      100'000'000,
+      this};
+
+  /**
+   * Garbage collection evicts the least recently used keys from a key space
+   * that exceeds its size limit until the key space is below this percentage
+   * of its limit.
+   */
+  ConfigSetting<uint64_t> localStoreGcLowWatermarkPercent{
+      "store:gc-low-watermark-percent",
+      75,
+      this};
+
+  /**
+   * The maximum number of keys per second that garbage collection deletes.
+   * Setting this to 0 removes the limit.
+   */
+  ConfigSetting<uint64_t> localStoreGcMaxDeletesPerSecond{
+      "store:gc-max-deletes-per-second",
+      50'000,
+      this};
+
+  /*
+   * The following settings tune the RocksDB local store.  They are read when
+   * the store is opened, so changing them requires restarting edenfs.
+   */
+
+  /**
+   * Writes to the ephemeral key spaces are queued and committed in batches
+   * by a writer thread.  This bounds the total size in bytes of the queued
+   * writes; importers wait while the queue is full.  Setting this to 0
+   * commits every write before it returns.
+   */
+  ConfigSetting<uint64_t> localStoreMaxPendingWriteBytes{
+      "store:max-pending-write-bytes",
+      64 * 1024 * 1024,
+      this};
+
+  /**
+   * How many bytes worth of blobs to keep in memory, at most.  Lowering this
+   * evicts blobs right away.
+   */
+  ConfigSetting<uint64_t> blobCacheSize{
+      "store:blob-cache-size",
+      40 * 1024 * 1024,
+      this};
+
+  /**
+   * How many bytes worth of blob sizes and SHA-1s to keep in memory, at most,
+   * for each object store.  Read when the object store is created.
+   */
+  ConfigSetting<uint64_t> metadataCacheSize{
+      "store:metadata-cache-size",
+      80 * 1024 * 1024,
+      this};
+
+  /**
+   * Keep blob sizes and SHA-1s in a compact table that takes about half the
+   * memory per entry, but allocates all of store:metadata-cache-size up
+   * front.  Read when the object store is created.
+   */
+  ConfigSetting<bool> compactMetadataCache{
+      "store:compact-metadata-cache",
+      false,
+      this};
+
+  /**
+   * Blobs of at least this many bytes are written to files under the eden
+   * directory and read from mappings of those files, so that their contents
+   * do not take up heap memory.  Setting this to 0 turns this off.  Read
+   * when the server starts.
+   */
+  ConfigSetting<uint64_t> mappedBlobThreshold{
+      "store:mapped-blob-threshold",
+      0,
+      this};
+
+  /**
+   * The most disk space, in bytes, that the files of mapped blobs may take
+   * up.  The least recently used are deleted to make room.  Read when the
+   * server starts.
+   */
+  ConfigSetting<uint64_t> mappedBlobCacheSize{
+      "store:mapped-blob-cache-size",
+      20ull * 1024 * 1024 * 1024,
+      this};
+
+  /**
+   * The number of tree and blob IDs each mount remembers as recently missing
+   * from the local store, so that further lookups for them skip it.  Each
+   * takes 8 bytes.  Setting this to 0 turns this off.
+   */
+  ConfigSetting<uint64_t> negativeLookupCacheSize{
+      "store:negative-lookup-cache-size",
+      64 * 1024,
+      this};
+
+  /**
+   * The number of the trees and blobs each tool fetched from a mount that are
+   * remembered, so that they can be prefetched the next time the same tool
+   * runs.  Each remembered object takes 21 bytes in the local store.  Setting
+   * this to 0 turns this off.
+   */
+  ConfigSetting<uint64_t> fetchProfileSize{"store:fetch-profile-size", 0, this};
+
+  /**
+   * The number of recently read blobs whose usual successors each mount
+   * remembers, so that reading one prefetches the blobs usually read after
+   * it.  Each remembered blob takes up to 105 bytes in the local store.
+   * Setting this to 0 turns this off.
+   */
+  ConfigSetting<uint64_t> coAccessPrefetchSize{
+      "store:co-access-prefetch-size",
+      0,
+      this};
+
+  /**
+   * The number of read-only connections the SQLite local store spreads its
+   * reads across.
+   */
+  ConfigSetting<uint64_t> sqliteReaderConnections{
+      "store:sqlite-reader-connections",
+      4,
+      this};
+
+  /**
+   * The eden state directory of a SQLite local store that is shared by the
+   * eden daemons on this host.  When set, a SQLite local store reads from
+   * the store there before fetching from source control.  It never writes
+   * to it.
+   */
+  ConfigSetting<std::optional<AbsolutePath>> sharedLocalStoreDir{
+      "store:shared-store-dir",
+      std::nullopt,
+      this};
+
+  /**
+   * The size in bytes of the block cache shared by all of the RocksDB column
+   * families.
+   */
+  ConfigSetting<uint64_t> rocksDbBlockCacheSize{
+      "store:rocksdb-block-cache-size",
+      72 * 1024 * 1024,
+      this};
+
+  /**
+   * The number of bits per key used by the bloom filters of the RocksDB
+   * column families.
+   */
+  ConfigSetting<uint64_t> rocksDbBloomFilterBits{
+      "store:rocksdb-bloom-filter-bits",
+      10,
+      this};
+
+  /**
+   * The maximum rate in bytes per second at which RocksDB may write out
+   * flushes and compactions.  Setting this to 0 removes the limit.
+   */
+  ConfigSetting<uint64_t> rocksDbCompactionRateLimit{
+      "store:rocksdb-compaction-rate-limit",
+      0,
+      this};
+
+  /**
+   * The size in bytes of the data blocks of the blob column family.  File
+   * contents are usually larger than the other values we store, and bigger
+   * blocks compress them better.
+   */
+  ConfigSetting<uint64_t> rocksDbBlobBlockSize{
+      "store:rocksdb-blob-block-size",
+      64 * 1024,
+      this};
+
+  /**
+   * The compression used for the blob column family: one of "none",
+   * "snappy", "lz4", "lz4hc", "zstd", or "default" for the best of LZ4 and
+   * Snappy that RocksDB was built with.  RocksDB fails to open the store if
+   * it was not built with the chosen algorithm.
+   */
+  ConfigSetting<std::string> rocksDbBlobCompression{
+      "store:rocksdb-blob-compression",
+      "default",
+      this};
+
   /**
    * The maximum time duration allowed for a fuse request. If a request exceeds
    * this amount of time, an ETIMEDOUT error will be returned to the kernel to
@@ -318,6 +560,167 @@ class EdenConfig : private ConfigSettingManager {
       std::chrono::nanoseconds::max(),
       this};
 
+  /**
+   * How long the kernel may cache the attributes and directory entries of
+   * materialized files and directories.  Those of inodes that are still
+   * identical to source control are cached until a checkout invalidates them.
+   */
+  ConfigSetting<std::chrono::nanoseconds> fuseMaterializedAttrTimeout{
+      "fuse:materialized-attr-timeout",
+      std::chrono::seconds(1),
+      this};
+
+  /**
+   * Let the kernel buffer writes in its page cache and send them to Eden in
+   * large batches (FUSE_WRITEBACK_CACHE).  The kernel then owns the file size
+   * and timestamps of files with dirty pages.
+   * This value is only applicable to the Linux fuse implementation.
+   */
+  ConfigSetting<bool> fuseWritebackCache{"fuse:writeback-cache", false, this};
+
+  /**
+   * How many bytes of file data a globFiles() call with prefetchFiles set may
+   * push into the kernel's page cache (FUSE_NOTIFY_STORE) once the matched
+   * files are prefetched, so that their first reads need no FUSE request.
+   * 0 disables this, as does fuse:writeback-cache.
+   * This value is only applicable to the Linux fuse implementation.
+   */
+  ConfigSetting<uint64_t> fusePageCachePrefetchBytes{
+      "fuse:page-cache-prefetch-bytes",
+      0,
+      this};
+
+  /**
+   * Let the kernel submit direct I/O requests asynchronously
+   * (FUSE_ASYNC_DIO).
+   * This value is only applicable to the Linux fuse implementation.
+   */
+  ConfigSetting<bool> fuseAsyncDio{"fuse:async-dio", false, this};
+
+  /**
+   * The maximum number of pages in a single FUSE read or write request, up to
+   * 256.  0 keeps the kernel's default of 32 pages.  Applies to newly mounted
+   * checkouts.
+   * This value is only applicable to the Linux fuse implementation.
+   */
+  ConfigSetting<uint32_t> fuseMaxPages{"fuse:max-pages", 0, this};
+
+  /**
+   * Whether the FUSE worker threads read requests through io_uring rather
+   * than with blocking read() calls.  Falls back to read() if eden was built
+   * without liburing or the kernel does not support io_uring.
+   * Applies to newly mounted checkouts.
+   * This value is only applicable to the Linux fuse implementation.
+   */
+  ConfigSetting<bool> fuseUseIoUring{"fuse:use-io-uring", false, this};
+
+  /**
+   * The number of FUSE device reads each worker thread keeps queued when
+   * fuse:use-io-uring is enabled.
+   */
+  ConfigSetting<uint32_t> fuseIoUringQueueDepth{
+      "fuse:io-uring-queue-depth",
+      8,
+      this};
+
+  /**
+   * The number of threads reading requests from each mount's FUSE device.
+   * Changes apply to mounts made afterwards.
+   */
+  ConfigSetting<uint32_t> fuseNumThreads{"fuse:num-threads", 16, this};
+
+  /**
+   * The number of threads handling FUSE metadata requests (lookup, getattr,
+   * readdir, ...), data requests (read and write) and other mutating requests.
+   * With 0, requests of that kind are handled on the FUSE worker threads that
+   * read them.  Giving data requests their own threads keeps a slow read
+   * from delaying getattr calls.
+   * The thread pools are shared by all mounts and created on startup; later
+   * changes to a nonzero count resize them without a restart.
+   */
+  ConfigSetting<uint32_t> fuseMetadataThreads{"fuse:metadata-threads", 0, this};
+  ConfigSetting<uint32_t> fuseDataThreads{"fuse:data-threads", 0, this};
+  ConfigSetting<uint32_t> fuseMutationThreads{"fuse:mutation-threads", 0, this};
+
+  /**
+   * The number of FUSE requests each process may have in progress on a
+   * mount.  Further requests from that process wait for earlier ones to
+   * finish, so a process flooding a mount with requests delays only itself.
+   * 0 means no limit.  Applies to newly mounted checkouts.
+   */
+  ConfigSetting<uint32_t> fuseMaxRequestsPerProcess{
+      "fuse:max-requests-per-process",
+      0,
+      this};
+
+  /**
+   * How long directory saves may be held in memory before they are written to
+   * the overlay.  Repeated saves of the same directory within this window are
+   * coalesced into a single write, at the cost of losing up to this much
+   * recent directory state on a crash.  0 writes every save immediately.
+   * Applies to newly mounted checkouts.  Not used on Windows.
+   */
+  ConfigSetting<std::chrono::nanoseconds> overlayDirSaveDelay{
+      "overlay:dir-save-delay",
+      std::chrono::nanoseconds::zero(),
+      this};
+
+  /**
+   * Files whose source control blobs are at least this many bytes are only
+   * partially materialized by their first write: the overlay file is created
+   * sparse and holds just the written ranges, and unwritten ranges are still
+   * read from the blob.  0 disables partial materialization.  Not used on
+   * Windows.
+   */
+  ConfigSetting<uint64_t> partialMaterializationMinSize{
+      "overlay:partial-materialization-min-size",
+      0,
+      this};
+
+  /**
+   * A partially materialized file is fully materialized once its writes form
+   * more than this many disjoint ranges, bounding the cost of tracking them.
+   */
+  ConfigSetting<uint64_t> partialMaterializationMaxRanges{
+      "overlay:partial-materialization-max-ranges",
+      256,
+      this};
+
+  /**
+   * Once a file has been read sequentially, each further sequential read
+   * starts loading this many bytes past its end: the chunks of large blobs
+   * that are stored in chunks, or the overlay file's pages for materialized
+   * files.  0 disables read-ahead.  Not used on Windows.
+   */
+  ConfigSetting<uint64_t> readAheadSize{"fuse:read-ahead-size",
+                                        4 * 1024 * 1024,
+                                        this};
+
+  /**
+   * How many reads in a row must each start where the previous one ended
+   * before a file is considered to be read sequentially.
+   */
+  ConfigSetting<uint32_t> readAheadMinSequentialReads{
+      "fuse:read-ahead-min-sequential-reads",
+      2,
+      this};
+
+  /**
+   * Whether to keep a copy of each mount's journal in its client directory,
+   * so that the journal positions held by clients such as watchman remain
+   * valid across an edenfs restart or graceful takeover.
+   */
+  ConfigSetting<bool> persistJournal{"journal:persist", false, this};
+
+  /**
+   * The size in bytes past which a mount's on-disk journal is rewritten from
+   * the entries still held in memory.  Only used if journal:persist is set.
+   */
+  ConfigSetting<uint64_t> journalLogDiskLimit{
+      "journal:log-disk-limit",
+      100'000'000,
+      this};
+
   /**
    * Whether Eden should implement its own unix domain socket permission checks
    * or rely on filesystem permissions.
@@ -327,12 +730,81 @@ class EdenConfig : private ConfigSettingManager {
       true,
       this};
 
+  /**
+   * Low priority Thrift calls, such as prefetchTrees, fail immediately with
+   * an overload error while tasks on the server thread pool have recently
+   * waited longer than this to start.  0 disables shedding.
+   */
+  ConfigSetting<std::chrono::nanoseconds> thriftShedQueueAge{
+      "thrift:shed-queue-age",
+      std::chrono::nanoseconds::zero(),
+      this};
+
   /**
    * Controls whether Eden enforces parent commits in a hg status
    * (getScmStatusV2) call
    */
   ConfigSetting<bool> enforceParents{"hg:enforce-parents", true, this};
 
+  /**
+   * Controls whether getScmStatus calls reuse the previous status computed for
+   * the same commit, and only re-diff the paths the journal recorded as
+   * changed since then.
+   */
+  ConfigSetting<bool> incrementalStatus{"hg:incremental-status", true, this};
+
+  /**
+   * Controls whether the hg import queue serves the requests of the same
+   * priority kind fairly between the processes that caused them, rather than
+   * strictly by priority.
+   */
+  ConfigSetting<bool> importQueueFairScheduling{
+      "hg:import-queue-fair-scheduling",
+      false,
+      this};
+
+  /**
+   * Requests waiting in the hg import queue are raised by one priority kind
+   * every time they have waited this long. Setting this to 0 disables aging.
+   */
+  ConfigSetting<std::chrono::nanoseconds> importQueueAgingInterval{
+      "hg:import-queue-aging-interval",
+      std::chrono::nanoseconds::zero(),
+      this};
+
+  /**
+   * The number of threads importing data from hg. Changes are applied without
+   * restarting EdenFS.
+   */
+  ConfigSetting<uint64_t> importWorkerThreads{"hg:import-worker-threads",
+                                              8,
+                                              this};
+
+  /**
+   * If greater than hg:import-worker-threads, the hg import thread pool grows
+   * up to this many threads while imports are piling up in the queue, and
+   * shrinks back once they are processed.
+   */
+  ConfigSetting<uint64_t> importWorkerThreadsMax{
+      "hg:import-worker-threads-max",
+      0,
+      this};
+
+  /**
+   * The maximum number of blob, tree and prefetch requests processed together
+   * by an hg import thread.
+   */
+  ConfigSetting<uint64_t> blobImportBatchSize{"hg:blob-import-batch-size",
+                                              1,
+                                              this};
+  ConfigSetting<uint64_t> treeImportBatchSize{"hg:tree-import-batch-size",
+                                              1,
+                                              this};
+  ConfigSetting<uint64_t> prefetchImportBatchSize{
+      "hg:prefetch-import-batch-size",
+      1,
+      this};
+
   /**
    * Location of scribe_cat binary on the system. If not specified, scribe
    * logging will be disabled.
@@ -346,6 +818,42 @@ class EdenConfig : private ConfigSettingManager {
                                             "",
                                             this};
 
+  /**
+   * Logs only one in N structured events of a type, written as
+   * comma-separated `type=N` pairs, such as "server_data_fetch=100".  Read
+   * when the daemon starts.
+   */
+  ConfigSetting<std::string> eventSampleRates{"telemetry:event-sample-rates",
+                                              "",
+                                              this};
+
+  /**
+   * Enables tracing when the daemon starts.  Each thread keeps its most
+   * recent trace points in a fixed-size buffer, which getRecentTracePoints
+   * returns without consuming them.
+   */
+  ConfigSetting<bool> alwaysOnTracing{"telemetry:always-on-tracing",
+                                      false,
+                                      this};
+
+  /**
+   * Counts one in N lookups, reads, and loads by the directory they are in,
+   * for getHotDirectories.  0 disables counting.  Read when a mount starts.
+   */
+  ConfigSetting<uint32_t> directoryAccessSampleRate{
+      "telemetry:directory-access-sample-rate",
+      0,
+      this};
+
+  /**
+   * How often thread-local stats are aggregated into the exported counters.
+   * Longer intervals cost less, but make the exported time series coarser.
+   */
+  ConfigSetting<std::chrono::nanoseconds> statsFlushInterval{
+      "telemetry:stats-flush-interval",
+      std::chrono::seconds(1),
+      this};
+
   /**
    * Controls which paths eden will log data fetches for when this is set.
    * Will only log paths which are subpaths of
@@ -363,6 +871,31 @@ class EdenConfig : private ConfigSettingManager {
                                         false,
                                         this};
 
+  /**
+   * Controls whether the local store keys blob contents by their SHA-1, so
+   * that blobs with identical contents at different paths or revisions are
+   * only stored once.
+   */
+  ConfigSetting<bool> dedupeBlobContents{"experimental:dedupe-blob-contents",
+                                         false,
+                                         this};
+
+  /**
+   * Controls whether the local store compresses blob contents with zstd.
+   */
+  ConfigSetting<bool> compressBlobs{"experimental:compress-blobs",
+                                    false,
+                                    this};
+
+  /**
+   * Controls whether the local store keeps the contents of large blobs in
+   * fixed-size chunks, so that reads of part of a large file that is no longer
+   * in memory only load the chunks they cover.
+   */
+  ConfigSetting<bool> chunkLargeBlobs{"experimental:chunk-large-blobs",
+                                      false,
+                                      this};
+
   /**
    * Controls whether EdenFS uses EdenApi to import data from remote.
    */
@@ -375,6 +908,34 @@ class EdenConfig : private ConfigSettingManager {
   ConfigSetting<uint64_t> maxTreePrefetches{"store:max-tree-prefetches",
                                             5,
                                             this};
+
+  /**
+   * Whether to prefetch the subdirectories of a commit's root tree, at low
+   * priority, when the commit is first resolved to its root tree.
+   */
+  ConfigSetting<bool> prefetchCommitRootChildren{
+      "store:prefetch-commit-root-children",
+      true,
+      this};
+
+  /**
+   * The maximum number of tree and blob fetches a single status operation may
+   * have in flight.  Setting this to 0 removes the limit.
+   */
+  ConfigSetting<uint64_t> maxDiffPendingFetches{
+      "store:max-diff-pending-fetches",
+      1000,
+      this};
+
+  /**
+   * The maximum number of tree and blob fetches a single checkout operation
+   * may have in flight.  Setting this to 0 removes the limit.
+   */
+  ConfigSetting<uint64_t> maxCheckoutPendingFetches{
+      "store:max-checkout-pending-fetches",
+      1000,
+      this};
+
   /**
    * A command to run to warn the user of a generic problem encountered
    * while trying to process a request.
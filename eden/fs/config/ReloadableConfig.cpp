@@ -21,7 +21,7 @@ namespace facebook {
 namespace eden {
 
 ReloadableConfig::ReloadableConfig(std::shared_ptr<const EdenConfig> config)
-    : state_{ConfigState{config}} {}
+    : state_{ConfigState{config}}, current_{config.get()} {}
 
 ReloadableConfig::~ReloadableConfig() {}
 
@@ -68,7 +68,9 @@ std::shared_ptr<const EdenConfig> ReloadableConfig::getEdenConfig(
     if (systemConfigChanged) {
       newConfig->loadSystemConfig();
     }
+    state->retired.push_back(std::move(state->config));
     state->config = std::move(newConfig);
+    current_.store(state->config.get(), std::memory_order_release);
   }
   return state->config;
 }
@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <memory>
+#include <vector>
 
 #include <folly/Synchronized.h>
 
@@ -37,14 +39,37 @@ class ReloadableConfig {
   std::shared_ptr<const EdenConfig> getEdenConfig(
       ConfigReloadBehavior reload = ConfigReloadBehavior::AutoReload);
 
+  /**
+   * Get the most recently loaded EdenConfig, for hot paths.
+   *
+   * This never checks the config files, takes no lock and touches no
+   * reference count: it is a single atomic load.  Changes on disk become
+   * visible once some other caller reloads the config, which EdenServer does
+   * every config:reload-interval.
+   *
+   * The returned reference stays valid for the lifetime of this
+   * ReloadableConfig.
+   */
+  const EdenConfig& getConfigSnapshot() const {
+    return *current_.load(std::memory_order_acquire);
+  }
+
  private:
   struct ConfigState {
     explicit ConfigState(const std::shared_ptr<const EdenConfig>& config)
         : config{config} {}
     std::shared_ptr<const EdenConfig> config;
+    /**
+     * Every config that was replaced by a reload.  Snapshot readers may still
+     * hold references to them, and configs only change when their files are
+     * edited, so they are kept rather than reclaimed.
+     */
+    std::vector<std::shared_ptr<const EdenConfig>> retired;
   };
 
   folly::Synchronized<ConfigState> state_;
+  /** state_->config, readable without the lock. */
+  std::atomic<const EdenConfig*> current_;
   std::atomic<std::chrono::steady_clock::time_point::rep> lastCheck_;
 };
 
@@ -17,6 +17,8 @@
 using facebook::eden::AbsolutePath;
 using facebook::eden::CheckoutConfig;
 using facebook::eden::Hash;
+using facebook::eden::OverlayType;
+using facebook::eden::RelativePathPiece;
 using facebook::eden::writeFile;
 using folly::StringPiece;
 
@@ -94,6 +96,74 @@ TEST_F(CheckoutConfigTest, testLoadWithIgnoredSettings) {
   EXPECT_EQ("/tmp/someplace", config->getMountPath());
 }
 
+TEST_F(CheckoutConfigTest, testOverlayType) {
+  auto config = CheckoutConfig::loadFromClientDirectory(
+      AbsolutePath{mountPoint_.string()}, AbsolutePath{clientDir_.string()});
+  EXPECT_EQ(OverlayType::Filesystem, config->getOverlayType());
+
+  auto data =
+      "[repository]\n"
+      "path = \"/data/users/carenthomas/fbsource\"\n"
+      "type = \"git\"\n"
+      "[overlay]\n"
+      "type = \"sqlite\"\n";
+  writeFile(folly::StringPiece{data}, configDotToml_.c_str());
+  config = CheckoutConfig::loadFromClientDirectory(
+      AbsolutePath{mountPoint_.string()}, AbsolutePath{clientDir_.string()});
+  EXPECT_EQ(OverlayType::Sqlite, config->getOverlayType());
+
+  auto badData =
+      "[repository]\n"
+      "path = \"/data/users/carenthomas/fbsource\"\n"
+      "type = \"git\"\n"
+      "[overlay]\n"
+      "type = \"tape\"\n";
+  writeFile(folly::StringPiece{badData}, configDotToml_.c_str());
+  EXPECT_THROW_RE(
+      CheckoutConfig::loadFromClientDirectory(
+          AbsolutePath{mountPoint_.string()},
+          AbsolutePath{clientDir_.string()}),
+      std::runtime_error,
+      "unsupported overlay type \"tape\"");
+}
+
+TEST_F(CheckoutConfigTest, testFilter) {
+  auto config = CheckoutConfig::loadFromClientDirectory(
+      AbsolutePath{mountPoint_.string()}, AbsolutePath{clientDir_.string()});
+  EXPECT_TRUE(config->getFilter().empty());
+
+  auto data =
+      "[repository]\n"
+      "path = \"/data/users/carenthomas/fbsource\"\n"
+      "type = \"git\"\n"
+      "[filter]\n"
+      "include = [\"fbcode\", \"tools/build\"]\n"
+      "exclude = [\"fbcode/third-party\"]\n";
+  writeFile(folly::StringPiece{data}, configDotToml_.c_str());
+  config = CheckoutConfig::loadFromClientDirectory(
+      AbsolutePath{mountPoint_.string()}, AbsolutePath{clientDir_.string()});
+  const auto& filter = config->getFilter();
+  EXPECT_EQ(2, filter.getIncludePrefixes().size());
+  EXPECT_EQ(1, filter.getExcludePrefixes().size());
+  EXPECT_FALSE(filter.isHidden(RelativePathPiece{"fbcode/eden"}));
+  EXPECT_TRUE(filter.isHidden(RelativePathPiece{"fbcode/third-party"}));
+  EXPECT_TRUE(filter.isHidden(RelativePathPiece{"www"}));
+
+  auto badData =
+      "[repository]\n"
+      "path = \"/data/users/carenthomas/fbsource\"\n"
+      "type = \"git\"\n"
+      "[filter]\n"
+      "exclude = [\"/fbcode\"]\n";
+  writeFile(folly::StringPiece{badData}, configDotToml_.c_str());
+  EXPECT_THROW_RE(
+      CheckoutConfig::loadFromClientDirectory(
+          AbsolutePath{mountPoint_.string()},
+          AbsolutePath{clientDir_.string()}),
+      std::runtime_error,
+      "invalid filter exclude path \"/fbcode\"");
+}
+
 TEST_F(CheckoutConfigTest, testMultipleParents) {
   auto config = CheckoutConfig::loadFromClientDirectory(
       AbsolutePath{mountPoint_.string()}, AbsolutePath{clientDir_.string()});
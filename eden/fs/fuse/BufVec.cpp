@@ -7,21 +7,61 @@
 
 #include "eden/fs/fuse/BufVec.h"
 
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+
 namespace facebook {
 namespace eden {
 
 BufVec::Buf::Buf(std::unique_ptr<folly::IOBuf> buf) : buf(std::move(buf)) {}
 
+BufVec::Buf::Buf(
+    int fd,
+    off_t pos,
+    size_t size,
+    std::shared_ptr<const void> owner)
+    : fd{fd}, fd_size{size}, fd_pos{pos}, fd_owner{std::move(owner)} {}
+
+const folly::IOBuf& BufVec::Buf::materialize() {
+  if (!buf) {
+    DCHECK_NE(fd, -1);
+    auto data = folly::IOBuf::createCombined(fd_size);
+    auto res = folly::preadFull(fd, data->writableBuffer(), fd_size, fd_pos);
+    folly::checkUnixError(res, "pread failed while reading file data");
+    data->append(res);
+    buf = std::move(data);
+  }
+  return *buf;
+}
+
 BufVec::BufVec(std::unique_ptr<folly::IOBuf> buf) {
   items_.emplace_back(std::make_shared<Buf>(std::move(buf)));
 }
 
+BufVec BufVec::fromFile(
+    int fd,
+    off_t pos,
+    size_t size,
+    std::shared_ptr<const void> owner) {
+  BufVec result;
+  result.items_.emplace_back(
+      std::make_shared<Buf>(fd, pos, size, std::move(owner)));
+  return result;
+}
+
+std::optional<BufVec::FileRange> BufVec::getFileRange() const {
+  if (items_.size() != 1 || items_[0]->fd == -1 || items_[0]->buf) {
+    return std::nullopt;
+  }
+  const auto& b = items_[0];
+  return FileRange{b->fd, b->fd_pos, b->fd_size};
+}
+
 folly::fbvector<struct iovec> BufVec::getIov() const {
   folly::fbvector<struct iovec> vec;
 
   for (const auto& b : items_) {
-    DCHECK(b->fd == -1) << "we don't support splicing yet";
-    b->buf->appendToIov(&vec);
+    b->materialize().appendToIov(&vec);
   }
 
   return vec;
@@ -30,7 +70,7 @@ folly::fbvector<struct iovec> BufVec::getIov() const {
 size_t BufVec::size() const {
   size_t total = 0;
   for (const auto& b : items_) {
-    total += b->buf->computeChainDataLength();
+    total += b->materialize().computeChainDataLength();
   }
   return total;
 }
@@ -39,12 +79,12 @@ std::string BufVec::copyData() const {
   std::string rv;
   rv.reserve(size());
   for (const auto& b : items_) {
-    DCHECK(b->fd == -1) << "we don't support splicing yet";
-    const auto* buf = b->buf.get();
+    const auto* head = &b->materialize();
+    const auto* buf = head;
     do {
       rv.append(reinterpret_cast<const char*>(buf->data()), buf->length());
       buf = buf->next();
-    } while (buf != b->buf.get());
+    } while (buf != head);
   }
   return rv;
 }
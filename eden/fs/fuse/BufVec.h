@@ -8,6 +8,7 @@
 #pragma once
 #include <folly/FBVector.h>
 #include <folly/io/IOBuf.h>
+#include <optional>
 
 namespace facebook {
 namespace eden {
@@ -15,9 +16,9 @@ namespace eden {
 /**
  * Represents data that may come from a buffer or a file descriptor.
  *
- * While we don't currently have a fuse client lib that supports this,
- * we want to make sure we're ready to use it, so this looks like
- * a dumb wrapper around IOBuf at the moment.
+ * File descriptor backed data lets FuseChannel splice(2) a read reply
+ * straight from the overlay into the FUSE device.  Callers that need the
+ * bytes in memory (getIov(), copyData(), ...) transparently pread() them.
  */
 class BufVec {
   struct Buf {
@@ -25,6 +26,8 @@ class BufVec {
     int fd{-1};
     size_t fd_size{0};
     off_t fd_pos{-1};
+    // Keeps fd open for as long as this Buf may read from it.
+    std::shared_ptr<const void> fd_owner;
 
     Buf(const Buf&) = delete;
     Buf& operator=(const Buf&) = delete;
@@ -32,9 +35,18 @@ class BufVec {
     Buf& operator=(Buf&&) = default;
 
     explicit Buf(std::unique_ptr<folly::IOBuf> buf);
+    Buf(int fd, off_t pos, size_t size, std::shared_ptr<const void> owner);
+
+    /**
+     * Read the file range into buf if that has not been done yet.
+     * Throws std::system_error if the read fails.
+     */
+    const folly::IOBuf& materialize();
   };
   folly::fbvector<std::shared_ptr<Buf>> items_;
 
+  BufVec() = default;
+
  public:
   BufVec(const BufVec&) = delete;
   BufVec& operator=(const BufVec&) = delete;
@@ -43,6 +55,26 @@ class BufVec {
 
   explicit BufVec(std::unique_ptr<folly::IOBuf> buf);
 
+  /**
+   * Refer to up to `size` bytes of `fd`, starting at `pos`.  Fewer bytes are
+   * returned at EOF.  `owner` must keep `fd` open until the BufVec and all of
+   * its copies are destroyed.
+   */
+  static BufVec
+  fromFile(int fd, off_t pos, size_t size, std::shared_ptr<const void> owner);
+
+  struct FileRange {
+    int fd;
+    off_t pos;
+    size_t size;
+  };
+
+  /**
+   * If this BufVec is a single, not yet read, file range, return it so the
+   * caller can hand it to the kernel directly.
+   */
+  std::optional<FileRange> getFileRange() const;
+
   /**
    * Return an iovector suitable for e.g. writev()
    *   auto iov = buf->getIov();
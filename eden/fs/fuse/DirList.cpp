@@ -15,18 +15,56 @@ using folly::StringPiece;
 namespace facebook {
 namespace eden {
 
-DirList::DirList(size_t maxSize)
-    : buf_(new char[maxSize]), end_(buf_.get() + maxSize), cur_(buf_.get()) {}
+namespace {
+size_t nameOffset(DirList::Format format) {
+#ifdef __linux__
+  if (format == DirList::Format::ReaddirPlus) {
+    return FUSE_NAME_OFFSET_DIRENTPLUS;
+  }
+#else
+  (void)format;
+#endif
+  return FUSE_NAME_OFFSET;
+}
+
+fuse_dirent* direntAt(DirList::Format format, char* p) {
+#ifdef __linux__
+  if (format == DirList::Format::ReaddirPlus) {
+    return &reinterpret_cast<fuse_direntplus*>(p)->dirent;
+  }
+#else
+  (void)format;
+#endif
+  return reinterpret_cast<fuse_dirent*>(p);
+}
+} // namespace
+
+DirList::DirList(size_t maxSize, Format format)
+    : buf_(new char[maxSize]),
+      end_(buf_.get() + maxSize),
+      cur_(buf_.get()),
+      format_(format) {
+#ifndef __linux__
+  CHECK(format_ == Format::Readdir)
+      << "FUSE_READDIRPLUS is only supported on Linux";
+#endif
+}
 
 bool DirList::add(StringPiece name, ino_t inode, dtype_t type, off_t off) {
   const size_t avail = end_ - cur_;
-  const auto entLength = FUSE_NAME_OFFSET + name.size();
+  const auto entLength = nameOffset(format_) + name.size();
   const auto fullSize = FUSE_DIRENT_ALIGN(entLength);
   if (fullSize > avail) {
     return false;
   }
 
-  fuse_dirent* const dirent = reinterpret_cast<fuse_dirent*>(cur_);
+  if (format_ == Format::ReaddirPlus) {
+    // Zero out the fuse_entry_out until setEntry() is called.
+    memset(cur_, 0, nameOffset(format_) - FUSE_NAME_OFFSET);
+    entryOffsets_.push_back(cur_ - buf_.get());
+  }
+
+  fuse_dirent* const dirent = direntAt(format_, cur_);
   dirent->ino = inode;
   dirent->off = off;
   dirent->namelen = name.size();
@@ -42,6 +80,19 @@ bool DirList::add(StringPiece name, ino_t inode, dtype_t type, off_t off) {
   return true;
 }
 
+void DirList::setEntry(size_t index, const fuse_entry_out& entry) {
+#ifdef __linux__
+  DCHECK(format_ == Format::ReaddirPlus);
+  auto* direntplus =
+      reinterpret_cast<fuse_direntplus*>(buf_.get() + entryOffsets_.at(index));
+  DCHECK_EQ(direntplus->dirent.ino, entry.nodeid);
+  direntplus->entry_out = entry;
+#else
+  (void)index;
+  (void)entry;
+#endif
+}
+
 StringPiece DirList::getBuf() const {
   return StringPiece(buf_.get(), cur_ - buf_.get());
 }
@@ -51,14 +102,14 @@ std::vector<DirList::ExtractedEntry> DirList::extract() const {
 
   char* p = buf_.get();
   while (p != cur_) {
-    auto entry = reinterpret_cast<fuse_dirent*>(p);
+    auto entry = direntAt(format_, p);
     result.emplace_back(
         ExtractedEntry{std::string{entry->name, entry->name + entry->namelen},
                        entry->ino,
                        static_cast<dtype_t>(entry->type),
                        static_cast<off_t>(entry->off)});
 
-    p += FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET + entry->namelen);
+    p += FUSE_DIRENT_ALIGN(nameOffset(format_) + entry->namelen);
   }
   return result;
 }
@@ -9,8 +9,11 @@
 #include <folly/Range.h>
 #include <sys/stat.h>
 #include <memory>
+#include <vector>
 #include "eden/fs/utils/DirType.h"
 
+struct fuse_entry_out;
+
 namespace facebook {
 namespace eden {
 
@@ -18,9 +21,25 @@ namespace eden {
  * Helper for populating directory listings.
  */
 class DirList {
+ public:
+  enum class Format {
+    /** fuse_dirent entries, as returned by FUSE_READDIR */
+    Readdir,
+    /**
+     * fuse_direntplus entries, as returned by FUSE_READDIRPLUS.  Each entry
+     * starts with a zeroed fuse_entry_out, which tells the kernel to not
+     * instantiate it, until it is filled in with setEntry().
+     */
+    ReaddirPlus,
+  };
+
+ private:
   std::unique_ptr<char[]> buf_;
   char* end_;
   char* cur_;
+  Format format_{Format::Readdir};
+  // Position of each entry in buf_, only tracked for ReaddirPlus lists.
+  std::vector<size_t> entryOffsets_;
 
  public:
   struct ExtractedEntry {
@@ -30,7 +49,7 @@ class DirList {
     off_t offset;
   };
 
-  explicit DirList(size_t maxSize);
+  explicit DirList(size_t maxSize, Format format = Format::Readdir);
 
   DirList(const DirList&) = delete;
   DirList& operator=(const DirList&) = delete;
@@ -43,6 +62,18 @@ class DirList {
    */
   bool add(folly::StringPiece name, ino_t inode, dtype_t type, off_t off);
 
+  /**
+   * Set the attributes of the index'th entry of a ReaddirPlus list.
+   *
+   * The kernel takes a lookup reference on entry.nodeid, so the caller must
+   * account for it as it would for a FUSE_LOOKUP reply.
+   */
+  void setEntry(size_t index, const fuse_entry_out& entry);
+
+  Format getFormat() const {
+    return format_;
+  }
+
   folly::StringPiece getBuf() const;
 
   /**
@@ -187,6 +187,15 @@ folly::Future<DirList> Dispatcher::readdir(
   FUSELL_NOT_IMPL();
 }
 
+folly::Future<DirList> Dispatcher::readdirplus(
+    InodeNumber,
+    DirList&&,
+    off_t,
+    uint64_t,
+    ObjectFetchContext&) {
+  FUSELL_NOT_IMPL();
+}
+
 folly::Future<struct fuse_kstatfs> Dispatcher::statfs(InodeNumber /*ino*/) {
   struct fuse_kstatfs info = {};
 
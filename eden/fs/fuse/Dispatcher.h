@@ -361,6 +361,21 @@ class Dispatcher {
       uint64_t fh,
       ObjectFetchContext& context);
 
+  /**
+   * Read directory, including the attributes of each entry.
+   *
+   * The DirList uses the ReaddirPlus format.  Entries are filled using
+   * DirList::add(), and optionally given attributes with DirList::setEntry().
+   * The kernel takes a lookup reference on every entry with attributes, just
+   * like for lookup().
+   */
+  virtual folly::Future<DirList> readdirplus(
+      InodeNumber ino,
+      DirList&& dirList,
+      off_t offset,
+      uint64_t fh,
+      ObjectFetchContext& context);
+
   /**
    * Get file system statistics
    *
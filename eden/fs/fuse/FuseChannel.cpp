@@ -8,16 +8,25 @@
 #include "eden/fs/fuse/FuseChannel.h"
 
 #include <boost/cast.hpp>
+#include <fcntl.h>
+#include <folly/File.h>
+#include <folly/ScopeGuard.h>
+#include <folly/Executor.h>
 #include <folly/futures/Future.h>
 #include <folly/io/async/Request.h>
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
 #include <signal.h>
+#include <limits>
 #include <type_traits>
+#ifdef EDEN_HAVE_LIBURING
+#include <liburing.h> // @manual
+#endif
 #include "eden/fs/fuse/DirList.h"
 #include "eden/fs/fuse/Dispatcher.h"
 #include "eden/fs/fuse/RequestData.h"
 #include "eden/fs/utils/Bug.h"
+#include "eden/fs/utils/EnumValue.h"
 #include "eden/fs/utils/Synchronized.h"
 #include "eden/fs/utils/SystemError.h"
 #include "eden/fs/utils/Thread.h"
@@ -33,6 +42,17 @@ namespace {
 // This is the minimum size used by libfuse so we use it too!
 constexpr size_t MIN_BUFSIZE = 0x21000;
 
+// The kernel does not accept more than this many pages per request.
+constexpr size_t kMaxFusePages = 256;
+
+// Room for the request headers in front of the data of a FUSE_WRITE.
+constexpr size_t kRequestHeaderSpace = 0x1000;
+
+size_t computeBufferSize(size_t maxPages) {
+  auto pages = std::max(std::min(maxPages, kMaxFusePages), size_t{1});
+  return std::max(pages * getpagesize() + kRequestHeaderSpace, MIN_BUFSIZE);
+}
+
 using Handler = folly::Future<folly::Unit> (
     FuseChannel::*)(const fuse_in_header* header, const uint8_t* arg);
 
@@ -158,7 +178,10 @@ constexpr auto kFuseHandlers = [] {
                                  &FuseThreadStats::forgetmulti};
   handlers[FUSE_FALLOCATE] = {"FUSE_FALLOCATE", Write};
 #ifdef __linux__
-  handlers[FUSE_READDIRPLUS] = {"FUSE_READDIRPLUS", Read};
+  handlers[FUSE_READDIRPLUS] = {"FUSE_READDIRPLUS",
+                                &FuseChannel::fuseReadDirPlus,
+                                &FuseThreadStats::readdirplus,
+                                Read};
   handlers[FUSE_RENAME2] = {"FUSE_RENAME2", Write};
   handlers[FUSE_LSEEK] = {"FUSE_LSEEK"};
   handlers[FUSE_COPY_FILE_RANGE] = {"FUSE_COPY_FILE_RANGE", Write};
@@ -171,6 +194,23 @@ constexpr auto kFuseHandlers = [] {
   return handlers;
 }();
 
+constexpr FuseThreadStats::HistogramPtr
+    kQueueDepthHistograms[kNumFuseRequestClasses] = {
+        &FuseThreadStats::metadataQueueDepth,
+        &FuseThreadStats::dataQueueDepth,
+        &FuseThreadStats::mutationQueueDepth,
+};
+
+FuseRequestClass getRequestClass(uint32_t opcode, AccessType accessType) {
+  switch (opcode) {
+    case FUSE_READ:
+    case FUSE_WRITE:
+      return FuseRequestClass::Data;
+  }
+  return accessType == AccessType::FuseWrite ? FuseRequestClass::Mutation
+                                             : FuseRequestClass::Metadata;
+}
+
 // Separate to avoid bloating the FUSE opcode table; CUSE_INIT is 4096.
 constexpr HandlerEntry kCuseInitHandler{"CUSE_INIT"};
 
@@ -284,11 +324,128 @@ iovec make_iovec(const T& t) {
   return iov;
 }
 
+#ifdef __linux__
+// Smaller read replies are cheaper to copy than to splice.
+constexpr size_t kMinSpliceReplySize = 32 * 1024;
+
+// Room for the reply header and for file data that does not start on a page
+// boundary, each of which takes up an extra pipe buffer.
+constexpr size_t kSplicePipeSlack = 2 * 4096;
+
+/**
+ * The pipes used to splice a read reply into the FUSE device.  The file data
+ * goes through `data` first so that its length is known before the reply
+ * header is written into `reply`.
+ */
+struct SplicePipes {
+  // Read and write ends of each pipe.
+  std::array<folly::File, 2> data;
+  std::array<folly::File, 2> reply;
+  size_t capacity{0};
+};
+
+// Each thread sending replies has its own pipes.
+thread_local std::optional<SplicePipes> splicePipes;
+
+bool makePipe(std::array<folly::File, 2>& pipe, size_t capacity) {
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+    return false;
+  }
+  pipe[0] = folly::File{fds[0], true};
+  pipe[1] = folly::File{fds[1], true};
+  auto size = fcntl(fds[1], F_SETPIPE_SZ, capacity);
+  return size >= 0 && static_cast<size_t>(size) >= capacity;
+}
+
+/**
+ * Returns this thread's pipes, or nullptr if pipes large enough for
+ * `capacity` bytes could not be created (for instance because of
+ * /proc/sys/fs/pipe-max-size).
+ */
+SplicePipes* getSplicePipes(size_t capacity) {
+  capacity += kSplicePipeSlack;
+  if (splicePipes && splicePipes->capacity >= capacity) {
+    return &*splicePipes;
+  }
+
+  splicePipes.reset();
+  SplicePipes pipes;
+  if (!makePipe(pipes.data, capacity) || !makePipe(pipes.reply, capacity)) {
+    XLOG_EVERY_MS(WARN, 60000)
+        << "unable to create pipes for splicing FUSE replies: "
+        << folly::errnoStr(errno);
+    return nullptr;
+  }
+  pipes.capacity = capacity;
+  splicePipes = std::move(pipes);
+  return &*splicePipes;
+}
+#endif
+
 } // namespace
 
 FuseChannel::DataRange::DataRange(int64_t off, int64_t len)
     : offset(off), length(len) {}
 
+void FuseChannel::DataRange::merge(const DataRange& other) {
+  // The attributes are always invalidated, so an attributes-only range adds
+  // nothing.
+  if (other.offset < 0) {
+    return;
+  }
+  if (offset < 0) {
+    *this = other;
+    return;
+  }
+
+  const auto start = std::min(offset, other.offset);
+  if (length <= 0 || other.length <= 0) {
+    length = 0;
+  } else {
+    length = std::max(offset + length, other.offset + other.length) - start;
+  }
+  offset = start;
+}
+
+void FuseChannel::InvalidationQueue::addInode(
+    InodeNumber inode,
+    int64_t offset,
+    int64_t length) {
+  auto [it, inserted] = inodeIndices.emplace(inode, queue.size());
+  if (!inserted) {
+    queue[it->second].range.merge(DataRange{offset, length});
+    return;
+  }
+  queue.emplace_back(inode, offset, length);
+}
+
+void FuseChannel::InvalidationQueue::addEntry(
+    InodeNumber parent,
+    PathComponentPiece name) {
+  auto [it, inserted] =
+      entryIndices[parent].emplace(PathComponent{name}, queue.size());
+  if (!inserted) {
+    return;
+  }
+  queue.emplace_back(parent, name);
+}
+
+void FuseChannel::InvalidationQueue::addStore(
+    InodeNumber inode,
+    int64_t offset,
+    std::unique_ptr<folly::IOBuf> data) {
+  inodeIndices.erase(inode);
+  queue.emplace_back(inode, offset, std::move(data));
+}
+
+void FuseChannel::InvalidationQueue::takeEntries(
+    std::vector<InvalidationEntry>& entries) {
+  queue.swap(entries);
+  inodeIndices.clear();
+  entryIndices.clear();
+}
+
 FuseChannel::InvalidationEntry::InvalidationEntry(
     InodeNumber num,
     PathComponentPiece n)
@@ -300,6 +457,14 @@ FuseChannel::InvalidationEntry::InvalidationEntry(
     int64_t length)
     : type(InvalidationType::INODE), inode(num), range(offset, length) {}
 
+FuseChannel::InvalidationEntry::InvalidationEntry(
+    InodeNumber num,
+    int64_t offset,
+    std::unique_ptr<folly::IOBuf> data)
+    : type(InvalidationType::STORE),
+      inode(num),
+      store{offset, std::move(data)} {}
+
 FuseChannel::InvalidationEntry::InvalidationEntry(Promise<Unit> p)
     : type(InvalidationType::FLUSH),
       inode(kRootNodeId),
@@ -316,6 +481,9 @@ FuseChannel::InvalidationEntry::~InvalidationEntry() {
     case InvalidationType::FLUSH:
       promise.~Promise();
       return;
+    case InvalidationType::STORE:
+      store.~StoreData();
+      return;
   }
   XLOG(FATAL) << "unknown InvalidationEntry type: "
               << static_cast<uint64_t>(type);
@@ -336,6 +504,9 @@ FuseChannel::InvalidationEntry::InvalidationEntry(
   static_assert(
       std::is_nothrow_move_constructible<DataRange>::value,
       "All members should be nothrow move constructible");
+  static_assert(
+      std::is_nothrow_move_constructible<StoreData>::value,
+      "All members should be nothrow move constructible");
 
   switch (type) {
     case InvalidationType::INODE:
@@ -347,6 +518,9 @@ FuseChannel::InvalidationEntry::InvalidationEntry(
     case InvalidationType::FLUSH:
       new (&promise) Promise<Unit>(std::move(other.promise));
       return;
+    case InvalidationType::STORE:
+      new (&store) StoreData(std::move(other.store));
+      return;
   }
 }
 
@@ -362,6 +536,10 @@ std::ostream& operator<<(
                 << "\")";
     case FuseChannel::InvalidationType::FLUSH:
       return os << "(invalidation flush)";
+    case FuseChannel::InvalidationType::STORE:
+      return os << "(inode " << entry.inode << ", store offset "
+                << entry.store.offset << ", length "
+                << entry.store.data->computeChainDataLength() << ")";
   }
   return os << "(unknown invalidation type "
             << static_cast<uint64_t>(entry.type) << " inode " << entry.inode
@@ -413,6 +591,119 @@ void FuseChannel::sendReply(
   sendRawReply(iov.data(), iov.size());
 }
 
+void FuseChannel::sendReply(const fuse_in_header& request, const BufVec& buf)
+    const {
+#ifdef __linux__
+  if (connInfo_->flags & FUSE_SPLICE_WRITE) {
+    auto range = buf.getFileRange();
+    if (range && range->size >= kMinSpliceReplySize &&
+        spliceReply(request, *range)) {
+      return;
+    }
+  }
+#endif
+
+  sendReply(request, buf.getIov());
+}
+
+#ifdef __linux__
+bool FuseChannel::spliceReply(
+    const fuse_in_header& request,
+    const BufVec::FileRange& range) const {
+  auto* pipes = getSplicePipes(range.size);
+  if (!pipes) {
+    return false;
+  }
+
+  // Anything going wrong before the reply reaches the FUSE device leaves data
+  // behind in the pipes, so they get recreated and the caller falls back to
+  // copying the reply.
+  auto discardPipes = [] {
+    splicePipes.reset();
+    return false;
+  };
+
+  size_t length = 0;
+  loff_t offset = range.pos;
+  while (length < range.size) {
+    auto res = splice(
+        range.fd,
+        &offset,
+        pipes->data[1].fd(),
+        nullptr,
+        range.size - length,
+        SPLICE_F_MOVE);
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return discardPipes();
+    }
+    if (res == 0) {
+      // EOF
+      break;
+    }
+    length += res;
+  }
+
+  fuse_out_header out;
+  out.unique = request.unique;
+  out.error = 0;
+  out.len = sizeof(out) + length;
+  if (write(pipes->reply[1].fd(), &out, sizeof(out)) !=
+      static_cast<ssize_t>(sizeof(out))) {
+    return discardPipes();
+  }
+
+  size_t moved = 0;
+  while (moved < length) {
+    auto res = splice(
+        pipes->data[0].fd(),
+        nullptr,
+        pipes->reply[1].fd(),
+        nullptr,
+        length - moved,
+        SPLICE_F_MOVE);
+    if (res <= 0) {
+      return discardPipes();
+    }
+    moved += res;
+  }
+
+  // The kernel expects the whole reply in a single write.
+  const auto res = splice(
+      pipes->reply[0].fd(),
+      nullptr,
+      fuseDevice_.fd(),
+      nullptr,
+      out.len,
+      SPLICE_F_MOVE);
+  const int err = errno;
+  XLOG(DBG7) << "spliceReply: unique=" << out.unique << " len=" << out.len
+             << " wrote=" << res;
+  if (res != static_cast<ssize_t>(out.len)) {
+    splicePipes.reset();
+    if (res >= 0) {
+      throw std::runtime_error("unexpected short splice to FUSE device");
+    }
+    throwReplyError(err);
+  }
+  return true;
+}
+#endif
+
+void FuseChannel::throwReplyError(int err) const {
+  if (err == ENOENT) {
+    // Interrupted by a signal.  We don't need to log this,
+    // but will propagate it back to our caller.
+  } else if (!isFuseDeviceValid(state_.rlock()->stopReason)) {
+    XLOG(INFO) << "error writing to fuse device: session closed";
+  } else {
+    XLOG(WARNING) << "error writing to fuse device: " << folly::errnoStr(err);
+  }
+  throwSystemErrorExplicit(err, "error writing to fuse device");
+}
+
 void FuseChannel::sendRawReply(const iovec iov[], size_t count) const {
   // Ensure that the length is set correctly
   DCHECK_EQ(iov[0].iov_len, sizeof(fuse_out_header));
@@ -428,15 +719,7 @@ void FuseChannel::sendRawReply(const iovec iov[], size_t count) const {
              << " header->len=" << header->len << " wrote=" << res;
 
   if (res < 0) {
-    if (err == ENOENT) {
-      // Interrupted by a signal.  We don't need to log this,
-      // but will propagate it back to our caller.
-    } else if (!isFuseDeviceValid(state_.rlock()->stopReason)) {
-      XLOG(INFO) << "error writing to fuse device: session closed";
-    } else {
-      XLOG(WARNING) << "error writing to fuse device: " << folly::errnoStr(err);
-    }
-    throwSystemErrorExplicit(err, "error writing to fuse device");
+    throwReplyError(err);
   }
 }
 
@@ -447,8 +730,10 @@ FuseChannel::FuseChannel(
     Dispatcher* const dispatcher,
     std::shared_ptr<ProcessNameCache> processNameCache,
     folly::Duration requestTimeout,
-    Notifications* notifications)
-    : bufferSize_(std::max(size_t(getpagesize()) + 0x1000, MIN_BUFSIZE)),
+    Notifications* notifications,
+    FuseChannelOptions options)
+    : bufferSize_(computeBufferSize(options.maxPages)),
+      options_(options),
       numThreads_(numThreads),
       dispatcher_(dispatcher),
       mountPath_(mountPath),
@@ -457,6 +742,10 @@ FuseChannel::FuseChannel(
       fuseDevice_(std::move(fuseDevice)),
       processAccessLog_(std::move(processNameCache)) {
   CHECK_GE(numThreads_, 1);
+  if (options_.maxRequestsPerProcess > 0) {
+    processLimiter_ = std::make_unique<ProcessConcurrencyLimiter>(
+        options_.maxRequestsPerProcess);
+  }
   installSignalHandler();
 }
 
@@ -477,6 +766,10 @@ Future<FuseChannel::StopFuture> FuseChannel::initialize() {
 FuseChannel::StopFuture FuseChannel::initializeFromTakeover(
     fuse_init_out connInfo) {
   connInfo_ = connInfo;
+  // The kernel keeps sending requests as large as the previous process
+  // negotiated, so make sure they fit.
+  bufferSize_ = std::max<size_t>(
+      bufferSize_, connInfo_->max_write + kRequestHeaderSpace);
   dispatcher_->initConnection(connInfo);
   XLOG(DBG1) << "Takeover using max_write=" << connInfo_->max_write
              << ", max_readahead=" << connInfo_->max_readahead
@@ -551,30 +844,36 @@ void FuseChannel::destroy() {
 void FuseChannel::invalidateInode(InodeNumber ino, off_t off, off_t len) {
   // Add the entry to invalidationQueue_ and wake up the invalidation thread to
   // send it.
-  invalidationQueue_.lock()->queue.emplace_back(ino, off, len);
+  invalidationQueue_.lock()->addInode(ino, off, len);
   invalidationCV_.notify_one();
 }
 
 void FuseChannel::invalidateEntry(InodeNumber parent, PathComponentPiece name) {
   // Add the entry to invalidationQueue_ and wake up the invalidation thread to
   // send it.
-  invalidationQueue_.lock()->queue.emplace_back(parent, name);
+  invalidationQueue_.lock()->addEntry(parent, name);
   invalidationCV_.notify_one();
 }
 
 void FuseChannel::invalidateInodes(folly::Range<InodeNumber*> range) {
   {
     auto queue = invalidationQueue_.lock();
-    std::transform(
-        range.begin(),
-        range.end(),
-        std::back_insert_iterator(queue->queue),
-        [](const auto& inodeNum) { return InvalidationEntry(inodeNum, 0, 0); });
+    for (auto inodeNum : range) {
+      queue->addInode(inodeNum, 0, 0);
+    }
   }
   if (range.begin() != range.end()) {
     invalidationCV_.notify_one();
   }
 }
+
+void FuseChannel::storeInode(
+    InodeNumber ino,
+    int64_t off,
+    std::unique_ptr<folly::IOBuf> data) {
+  invalidationQueue_.lock()->addStore(ino, off, std::move(data));
+  invalidationCV_.notify_one();
+}
 folly::Future<folly::Unit> FuseChannel::flushInvalidations() {
   // Add a promise to the invalidation queue, which the invalidation thread
   // will fulfill once it reaches that element in the queue.
@@ -608,6 +907,9 @@ void FuseChannel::sendInvalidation(InvalidationEntry& entry) {
         // invalidation queue have been completed.
         entry.promise.setValue();
         return;
+      case InvalidationType::STORE:
+        sendStoreInode(entry.inode, entry.store.offset, *entry.store.data);
+        return;
     }
     EDEN_BUG() << "unknown invalidation entry type "
                << static_cast<uint64_t>(entry.type);
@@ -734,6 +1036,52 @@ void FuseChannel::sendInvalidateEntry(
   }
 }
 
+/**
+ * Send a FUSE_NOTIFY_STORE message to the kernel.
+ *
+ * This method always runs in the invalidation thread.
+ */
+void FuseChannel::sendStoreInode(
+    InodeNumber ino,
+    int64_t off,
+    const folly::IOBuf& data) {
+  auto len = data.computeChainDataLength();
+  XLOG(DBG3) << "sendStoreInode(ino=" << ino << ", off=" << off
+             << ", len=" << len << ")";
+  if (len > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument(folly::to<std::string>(
+        "too much data to store in FUSE inode ", ino, ": ", len, " bytes"));
+  }
+
+  fuse_notify_store_out notify = {};
+  notify.nodeid = ino.get();
+  notify.offset = off;
+  notify.size = len;
+
+  fuse_out_header out;
+  out.unique = 0;
+  out.error = FUSE_NOTIFY_STORE;
+
+  std::vector<iovec> iov;
+  iov.push_back({&out, sizeof(out)});
+  iov.push_back({&notify, sizeof(notify)});
+  data.appendToIov(&iov);
+
+  try {
+    sendRawReply(iov.data(), iov.size());
+  } catch (const std::system_error& exc) {
+    // Ignore ENOENT.  The kernel only accepts data for inodes that it has
+    // looked up and not yet forgotten.
+    if (!isEnoent(exc)) {
+      throwSystemErrorExplicit(
+          exc.code().value(), "error storing data in FUSE inode ", ino);
+    } else {
+      XLOG(DBG3) << "sendStoreInode(ino=" << ino << ", off=" << off
+                 << ", len=" << len << ") failed with ENOENT";
+    }
+  }
+}
+
 std::vector<fuse_in_header> FuseChannel::getOutstandingRequests() {
   auto state = state_.wlock();
   const auto& requests = state->requests;
@@ -825,11 +1173,16 @@ void FuseChannel::fuseWorkerThread() noexcept {
   disablePthreadCancellation();
   setThreadName(to<std::string>("fuse", mountPath_.basename()));
   setThreadSigmask();
-  *(liveRequestWatches_.get()) =
-      std::make_shared<RequestMetricsScope::LockedRequestWatchList>();
+  *(liveRequestWatches_.get()) = std::make_shared<RequestWatchList>();
 
   try {
+#ifdef EDEN_HAVE_LIBURING
+    if (!options_.useIoUring || !processSessionIoUring()) {
+      processSession();
+    }
+#else
     processSession();
+#endif
   } catch (const std::exception& ex) {
     XLOG(ERR) << "unexpected error in FUSE worker thread: " << exceptionStr(ex);
     // Request that all other FUSE threads exit.
@@ -885,7 +1238,7 @@ void FuseChannel::invalidationThread() noexcept {
         }
         invalidationCV_.wait(lockedQueue.getUniqueLock());
       }
-      lockedQueue->queue.swap(entries);
+      lockedQueue->takeEntries(entries);
     }
 
     // Process all of the entries we found
@@ -988,17 +1341,13 @@ void FuseChannel::readInitPacket() {
   fuse_init_out connInfo = {};
   connInfo.major = init.init.major;
   connInfo.minor = init.init.minor;
-  connInfo.max_write = bufferSize_ - 4096;
+  connInfo.max_write = bufferSize_ - kRequestHeaderSpace;
 
   connInfo.max_readahead = init.init.max_readahead;
 
   const auto capable = init.init.flags;
   auto& want = connInfo.flags;
 
-  // TODO: follow up and look at the new flags; particularly
-  // FUSE_DO_READDIRPLUS, FUSE_READDIRPLUS_AUTO. FUSE_SPLICE_XXX are interesting
-  // too, but may not directly benefit eden today.
-  //
   // FUSE_ATOMIC_O_TRUNC is a nice optimization when the kernel supports it
   // and the FUSE daemon requires handling open/release for stateful file
   // handles. But FUSE_NO_OPEN_SUPPORT is superior, so edenfs has no need for
@@ -1018,6 +1367,26 @@ void FuseChannel::readInitPacket() {
   want |= FUSE_CACHE_SYMLINKS;
   // We can handle almost any request in parallel.
   want |= FUSE_PARALLEL_DIROPS;
+  // Large reads from overlay files are spliced into the FUSE device rather
+  // than copied through our memory.
+  want |= FUSE_SPLICE_WRITE | FUSE_SPLICE_MOVE;
+  // Return attributes along with directory entries, saving a lookup per entry
+  // for `ls -l` and friends.  The kernel decides when that is worth it.
+  want |= FUSE_DO_READDIRPLUS | FUSE_READDIRPLUS_AUTO;
+
+  if (options_.writebackCache) {
+    // Let the kernel coalesce writes in its page cache.  FileInode accepts
+    // the timestamps the kernel then sends back with setattr.
+    want |= FUSE_WRITEBACK_CACHE;
+  }
+  if (options_.asyncDio) {
+    want |= FUSE_ASYNC_DIO;
+  }
+  if (options_.maxPages > 0) {
+    // bufferSize_ was sized to hold requests this large.
+    want |= FUSE_MAX_PAGES;
+    connInfo.max_pages = std::min(options_.maxPages, kMaxFusePages);
+  }
 #endif
 #ifdef FUSE_NO_OPEN_SUPPORT
   // File handles are stateless so the kernel does not need to send open() and
@@ -1099,239 +1468,422 @@ void FuseChannel::processSession() {
     // We can look at turning this on once the main plumbing is complete.
     auto res = read(fuseDevice_.fd(), buf.data(), buf.size());
     if (UNLIKELY(res < 0)) {
-      int error = errno;
-      if (stop_.load(std::memory_order_relaxed)) {
+      if (!handleReadError(errno)) {
         break;
       }
+      continue;
+    }
 
-      if (error == EINTR || error == EAGAIN) {
-        // If we got interrupted by a signal while reading the next
-        // fuse command, we will simply retry and read the next thing.
-        continue;
-      } else if (error == ENOENT) {
-        // According to comments in the libfuse code:
-        // ENOENT means the operation was interrupted; it's safe to restart
-        continue;
-      } else if (error == ENODEV) {
-        // ENODEV means the filesystem was unmounted
-        folly::call_once(unmountLogFlag_, [this] {
-          XLOG(DBG3) << "received unmount event ENODEV on mount " << mountPath_;
-        });
-        requestSessionExit(StopReason::UNMOUNTED);
-        break;
-      } else {
-        XLOG(WARNING) << "error reading from fuse channel: "
-                      << folly::errnoStr(error);
-        requestSessionExit(StopReason::FUSE_READ_ERROR);
-        break;
-      }
+    if (!processRequest(buf.data(), static_cast<size_t>(res), myPid)) {
+      return;
     }
+  }
+}
 
-    const auto arg_size = static_cast<size_t>(res);
-    if (arg_size < sizeof(struct fuse_in_header)) {
-      if (arg_size == 0) {
-        // This code path is hit when a fake FUSE channel is closed in our unit
-        // tests.  On real FUSE channels we should get ENODEV to indicate that
-        // the FUSE channel was shut down.  However, in our unit tests that use
-        // fake FUSE connections we cannot send an ENODEV error, and so we just
-        // close the channel instead.
-        requestSessionExit(StopReason::UNMOUNTED);
-      } else {
-        // We got a partial FUSE header.  This shouldn't ever happen unless
-        // there is a bug in the FUSE kernel code.
-        XLOG(ERR) << "read truncated message from kernel fuse device: len="
-                  << arg_size;
-        requestSessionExit(StopReason::FUSE_TRUNCATED_REQUEST);
+#ifdef EDEN_HAVE_LIBURING
+bool FuseChannel::processSessionIoUring() {
+  const size_t queueDepth = std::max(options_.ioUringQueueDepth, size_t{1});
+  // Reads are tagged with the index of their buffer, and the requests that
+  // cancel them with kCancelTag.
+  const uintptr_t kCancelTag = queueDepth;
+
+  // Leave room for cancelling every read at once.
+  struct io_uring ring;
+  auto err = io_uring_queue_init(2 * queueDepth, &ring, 0);
+  if (err < 0) {
+    XLOG(WARN) << "unable to set up io_uring for " << mountPath_ << ": "
+               << folly::errnoStr(-err) << "; falling back to read()";
+    return false;
+  }
+  SCOPE_EXIT {
+    io_uring_queue_exit(&ring);
+  };
+
+  // Registered buffers (IORING_OP_READ_FIXED) cannot be used here: the FUSE
+  // device only accepts reads into user memory.
+  std::vector<std::vector<char>> buffers(
+      queueDepth, std::vector<char>(bufferSize_));
+  std::vector<bool> pending(queueDepth, false);
+  auto queueRead = [&](size_t index) {
+    // The ring has two entries for every buffer, so this cannot fail.
+    auto* sqe = CHECK_NOTNULL(io_uring_get_sqe(&ring));
+    auto& buf = buffers[index];
+    io_uring_prep_read(sqe, fuseDevice_.fd(), buf.data(), buf.size(), 0);
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(uintptr_t{index}));
+    pending[index] = true;
+  };
+
+  XLOG(DBG3) << "reading FUSE requests for " << mountPath_
+             << " through io_uring with " << queueDepth << " queued reads";
+
+  auto myPid = getpid();
+  for (size_t index = 0; index < queueDepth; ++index) {
+    queueRead(index);
+  }
+  size_t readsInFlight = queueDepth;
+  bool cancelled = false;
+
+  while (readsInFlight > 0) {
+    if (!cancelled && stop_.load(std::memory_order_relaxed)) {
+      // Knock the outstanding reads out of the kernel; the SIGUSR2 sent by
+      // requestSessionExit() only interrupts our own wait.  Reads that already
+      // picked up a request still complete and are processed below, so that
+      // no request gets lost on takeover.
+      for (size_t index = 0; index < queueDepth; ++index) {
+        if (pending[index]) {
+          auto* sqe = CHECK_NOTNULL(io_uring_get_sqe(&ring));
+          io_uring_prep_cancel(
+              sqe, reinterpret_cast<void*>(uintptr_t{index}), 0);
+          io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(kCancelTag));
+        }
       }
-      return;
+      cancelled = true;
     }
 
-    const auto* header = reinterpret_cast<fuse_in_header*>(buf.data());
-    const uint8_t* arg = reinterpret_cast<const uint8_t*>(header + 1);
-
-    XLOG(DBG7) << "fuse request opcode=" << header->opcode << " "
-               << fuseOpcodeName(header->opcode) << " unique=" << header->unique
-               << " len=" << header->len << " nodeid=" << header->nodeid
-               << " uid=" << header->uid << " gid=" << header->gid
-               << " pid=" << header->pid;
-
-    // On Linux, if security caps are enabled and the FUSE filesystem implements
-    // xattr support, every FUSE_WRITE opcode is preceded by FUSE_GETXATTR for
-    // "security.capability". Until we discover a way to tell the kernel that
-    // they will always return nothing in an Eden mount, short-circuit that path
-    // as efficiently and as early as possible.
-    if (header->opcode == FUSE_GETXATTR) {
-      const auto getxattr = reinterpret_cast<const fuse_getxattr_in*>(arg);
-      const auto nameStr = reinterpret_cast<const char*>(getxattr + 1);
-      if (strcmp("security.capability", nameStr) == 0) {
-        replyError(*header, ENODATA);
+    // Submit the reads queued by the previous iteration and wait for at
+    // least one of them to complete, in a single system call.
+    err = io_uring_submit_and_wait(&ring, 1);
+    if (err < 0) {
+      if (err == -EINTR) {
+        // The signal from requestSessionExit(), or any other signal.
         continue;
       }
+      XLOG(WARNING) << "error waiting on io_uring for fuse channel: "
+                    << folly::errnoStr(-err);
+      requestSessionExit(StopReason::FUSE_READ_ERROR);
+      break;
     }
 
-    // Sanity check to ensure that the request wasn't from ourself.
-    //
-    // We should never make requests to ourself via normal filesytem
-    // operations going through the kernel.  Otherwise we risk deadlocks if the
-    // kernel calls us while holding an inode lock, and we then end up making a
-    // filesystem call that need the same inode lock.  We will then not be able
-    // to resolve this deadlock on kernel inode locks without rebooting the
-    // system.
-    if (UNLIKELY(static_cast<pid_t>(header->pid) == myPid)) {
-      replyError(*header, EIO);
-      XLOG(CRITICAL) << "Received FUSE request from our own pid: opcode="
-                     << header->opcode << " nodeid=" << header->nodeid
-                     << " pid=" << header->pid;
-      continue;
+    unsigned head;
+    unsigned seen = 0;
+    struct io_uring_cqe* cqe;
+    io_uring_for_each_cqe(&ring, head, cqe) {
+      ++seen;
+      const auto tag = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+      if (tag == kCancelTag) {
+        continue;
+      }
+
+      --readsInFlight;
+      const auto index = static_cast<size_t>(tag);
+      pending[index] = false;
+      const bool keepReading = cqe->res < 0
+          ? handleReadError(-cqe->res)
+          : processRequest(
+                buffers[index].data(), static_cast<size_t>(cqe->res), myPid);
+      // Requests are fully consumed by processRequest(), so the buffer can be
+      // reused right away.
+      if (keepReading && !stop_.load(std::memory_order_relaxed)) {
+        queueRead(index);
+        ++readsInFlight;
+      }
     }
+    io_uring_cq_advance(&ring, seen);
+  }
+  return true;
+}
+#endif
 
-    auto* handlerEntry = lookupFuseHandlerEntry(header->opcode);
-    processAccessLog_.recordAccess(
-        header->pid,
-        handlerEntry ? handlerEntry->accessType : AccessType::FuseOther);
-
-    switch (header->opcode) {
-      case FUSE_INIT:
-        replyError(*header, EPROTO);
-        throw std::runtime_error(
-            "received FUSE_INIT after we have been initialized!?");
-
-      case FUSE_GETLK:
-      case FUSE_SETLK:
-      case FUSE_SETLKW:
-        // Deliberately not handling locking; this causes
-        // the kernel to do it for us
-        XLOG(DBG7) << fuseOpcodeName(header->opcode);
-        replyError(*header, ENOSYS);
-        break;
+bool FuseChannel::handleReadError(int error) {
+  if (stop_.load(std::memory_order_relaxed)) {
+    return false;
+  }
 
-#ifdef __linux__
-      case FUSE_LSEEK:
-        // We only support stateless file handles, so lseek() is meaningless
-        // for us.  Returning ENOSYS causes the kernel to implement it for us,
-        // and will cause it to stop sending subsequent FUSE_LSEEK requests.
-        XLOG(DBG7) << "FUSE_LSEEK";
-        replyError(*header, ENOSYS);
-        break;
-#endif
+  if (error == EINTR || error == EAGAIN) {
+    // If we got interrupted by a signal while reading the next
+    // fuse command, we will simply retry and read the next thing.
+    return true;
+  } else if (error == ENOENT) {
+    // According to comments in the libfuse code:
+    // ENOENT means the operation was interrupted; it's safe to restart
+    return true;
+  } else if (error == ENODEV) {
+    // ENODEV means the filesystem was unmounted
+    folly::call_once(unmountLogFlag_, [this] {
+      XLOG(DBG3) << "received unmount event ENODEV on mount " << mountPath_;
+    });
+    requestSessionExit(StopReason::UNMOUNTED);
+    return false;
+  } else {
+    XLOG(WARNING) << "error reading from fuse channel: "
+                  << folly::errnoStr(error);
+    requestSessionExit(StopReason::FUSE_READ_ERROR);
+    return false;
+  }
+}
 
-      case FUSE_POLL:
-        // We do not currently implement FUSE_POLL.
-        XLOG(DBG7) << "FUSE_POLL";
-        replyError(*header, ENOSYS);
-        break;
+bool FuseChannel::processRequest(
+    const char* data,
+    size_t arg_size,
+    pid_t myPid) {
+  if (arg_size < sizeof(struct fuse_in_header)) {
+    if (arg_size == 0) {
+      // This code path is hit when a fake FUSE channel is closed in our unit
+      // tests.  On real FUSE channels we should get ENODEV to indicate that
+      // the FUSE channel was shut down.  However, in our unit tests that use
+      // fake FUSE connections we cannot send an ENODEV error, and so we just
+      // close the channel instead.
+      requestSessionExit(StopReason::UNMOUNTED);
+    } else {
+      // We got a partial FUSE header.  This shouldn't ever happen unless
+      // there is a bug in the FUSE kernel code.
+      XLOG(ERR) << "read truncated message from kernel fuse device: len="
+                << arg_size;
+      requestSessionExit(StopReason::FUSE_TRUNCATED_REQUEST);
+    }
+    return false;
+  }
 
-      case FUSE_INTERRUPT: {
-        // no reply is required
-        XLOG(DBG7) << "FUSE_INTERRUPT";
-        // Ignore it: we don't have a reliable way to guarantee
-        // that interrupting functions correctly.
-        // In addition, the kernel (certainly on macOS) may recycle
-        // ids too quickly for us to safely track by `unique` id.
-        break;
-      }
+  const auto* header = reinterpret_cast<const fuse_in_header*>(data);
+  const uint8_t* arg = reinterpret_cast<const uint8_t*>(header + 1);
+
+  XLOG(DBG7) << "fuse request opcode=" << header->opcode << " "
+             << fuseOpcodeName(header->opcode) << " unique=" << header->unique
+             << " len=" << header->len << " nodeid=" << header->nodeid
+             << " uid=" << header->uid << " gid=" << header->gid
+             << " pid=" << header->pid;
+
+  // On Linux, if security caps are enabled and the FUSE filesystem implements
+  // xattr support, every FUSE_WRITE opcode is preceded by FUSE_GETXATTR for
+  // "security.capability". Until we discover a way to tell the kernel that
+  // they will always return nothing in an Eden mount, short-circuit that path
+  // as efficiently and as early as possible.
+  if (header->opcode == FUSE_GETXATTR) {
+    const auto getxattr = reinterpret_cast<const fuse_getxattr_in*>(arg);
+    const auto nameStr = reinterpret_cast<const char*>(getxattr + 1);
+    if (strcmp("security.capability", nameStr) == 0) {
+      replyError(*header, ENODATA);
+      return true;
+    }
+  }
 
-      case FUSE_DESTROY:
-        XLOG(DBG7) << "FUSE_DESTROY";
-        dispatcher_->destroy();
-        // FUSE on linux doesn't care whether we reply to FUSE_DESTROY
-        // but the macOS implementation blocks the unmount syscall until
-        // we have responded, which in turn blocks our attempt to gracefully
-        // unmount, so we respond here.  It doesn't hurt Linux to respond
-        // so we do it for both platforms.
-        replyError(*header, 0);
-        break;
+  // Sanity check to ensure that the request wasn't from ourself.
+  //
+  // We should never make requests to ourself via normal filesytem
+  // operations going through the kernel.  Otherwise we risk deadlocks if the
+  // kernel calls us while holding an inode lock, and we then end up making a
+  // filesystem call that need the same inode lock.  We will then not be able
+  // to resolve this deadlock on kernel inode locks without rebooting the
+  // system.
+  if (UNLIKELY(static_cast<pid_t>(header->pid) == myPid)) {
+    replyError(*header, EIO);
+    XLOG(CRITICAL) << "Received FUSE request from our own pid: opcode="
+                   << header->opcode << " nodeid=" << header->nodeid
+                   << " pid=" << header->pid;
+    return true;
+  }
 
-      case FUSE_NOTIFY_REPLY:
-        XLOG(DBG7) << "FUSE_NOTIFY_REPLY";
-        // Don't strictly need to do anything here, but may want to
-        // turn the kernel notifications in Futures and use this as
-        // a way to fulfil the promise
-        break;
+  auto* handlerEntry = lookupFuseHandlerEntry(header->opcode);
+  processAccessLog_.recordAccess(
+      header->pid,
+      handlerEntry ? handlerEntry->accessType : AccessType::FuseOther);
+
+  switch (header->opcode) {
+    case FUSE_INIT:
+      replyError(*header, EPROTO);
+      throw std::runtime_error(
+          "received FUSE_INIT after we have been initialized!?");
+
+    case FUSE_GETLK:
+    case FUSE_SETLK:
+    case FUSE_SETLKW:
+      // Deliberately not handling locking; this causes
+      // the kernel to do it for us
+      XLOG(DBG7) << fuseOpcodeName(header->opcode);
+      replyError(*header, ENOSYS);
+      break;
 
-      case FUSE_IOCTL:
-        // Rather than the default ENOSYS, we need to return ENOTTY
-        // to indicate that the requested ioctl is not supported
-        replyError(*header, ENOTTY);
-        break;
+#ifdef __linux__
+    case FUSE_LSEEK:
+      // We only support stateless file handles, so lseek() is meaningless
+      // for us.  Returning ENOSYS causes the kernel to implement it for us,
+      // and will cause it to stop sending subsequent FUSE_LSEEK requests.
+      XLOG(DBG7) << "FUSE_LSEEK";
+      replyError(*header, ENOSYS);
+      break;
+#endif
 
-      default: {
-        if (handlerEntry && handlerEntry->handler) {
-          // Start a new request and associate it with the current thread.
-          // It will be disassociated when we leave this scope, but will
-          // propagate across any futures that are spawned as part of this
-          // request.
-          RequestContextScopeGuard requestContextGuard;
-
-          auto& request = RequestData::create(this, *header, dispatcher_);
-          uint64_t requestId;
-          {
-            // Save a weak reference to this new request context.
-            // We use this to enable getOutstandingRequests() for debugging
-            // purposes, as well as to determine when all requests are done.
-            // We allocate our own request Id for this purpose, as the
-            // kernel may recycle `unique` values more quickly than the
-            // lifecycle of our state here.
-            auto state = state_.wlock();
-            requestId = state->nextRequestId++;
-            state->requests.emplace(requestId, *header);
-          }
+    case FUSE_POLL:
+      // We do not currently implement FUSE_POLL.
+      XLOG(DBG7) << "FUSE_POLL";
+      replyError(*header, ENOSYS);
+      break;
+
+    case FUSE_INTERRUPT: {
+      // no reply is required
+      XLOG(DBG7) << "FUSE_INTERRUPT";
+      // Ignore it: we don't have a reliable way to guarantee
+      // that interrupting functions correctly.
+      // In addition, the kernel (certainly on macOS) may recycle
+      // ids too quickly for us to safely track by `unique` id.
+      break;
+    }
 
-          request
-              .catchErrors(
-                  folly::makeFutureWith([&] {
-                    request.startRequest(
-                        dispatcher_->getStats(),
-                        handlerEntry->histogram,
-                        *(liveRequestWatches_.get()));
-                    return (this->*handlerEntry->handler)(
-                        &request.getReq(), arg);
-                  })
-                      .within(requestTimeout_),
-                  notifications_)
-              .ensure([this, requestId] {
-                auto state = state_.wlock();
-
-                // Remove the request from the map
-                state->requests.erase(requestId);
-
-                // We may be complete; check to see if all requests are
-                // done and whether there are any threads remaining.
-                if (state->requests.empty() &&
-                    state->stoppedThreads == numThreads_) {
-                  sessionComplete(std::move(state));
-                }
-              });
-          break;
+    case FUSE_DESTROY:
+      XLOG(DBG7) << "FUSE_DESTROY";
+      dispatcher_->destroy();
+      // FUSE on linux doesn't care whether we reply to FUSE_DESTROY
+      // but the macOS implementation blocks the unmount syscall until
+      // we have responded, which in turn blocks our attempt to gracefully
+      // unmount, so we respond here.  It doesn't hurt Linux to respond
+      // so we do it for both platforms.
+      replyError(*header, 0);
+      break;
+
+    case FUSE_NOTIFY_REPLY:
+      XLOG(DBG7) << "FUSE_NOTIFY_REPLY";
+      // Don't strictly need to do anything here, but may want to
+      // turn the kernel notifications in Futures and use this as
+      // a way to fulfil the promise
+      break;
+
+    case FUSE_IOCTL:
+      // Rather than the default ENOSYS, we need to return ENOTTY
+      // to indicate that the requested ioctl is not supported
+      replyError(*header, ENOTTY);
+      break;
+
+    default: {
+      if (handlerEntry && handlerEntry->handler) {
+        // Start a new request and associate it with the current thread.
+        // It will be disassociated when we leave this scope, but will
+        // propagate across any futures that are spawned as part of this
+        // request.
+        RequestContextScopeGuard requestContextGuard;
+
+        auto& request = RequestData::create(this, *header, dispatcher_);
+        uint64_t requestId;
+        {
+          // Save a weak reference to this new request context.
+          // We use this to enable getOutstandingRequests() for debugging
+          // purposes, as well as to determine when all requests are done.
+          // We allocate our own request Id for this purpose, as the
+          // kernel may recycle `unique` values more quickly than the
+          // lifecycle of our state here.
+          auto state = state_.wlock();
+          requestId = state->nextRequestId++;
+          state->requests.emplace(requestId, *header);
         }
 
-        const auto opcode = header->opcode;
-        tryRlockCheckBeforeUpdate<folly::Unit>(
-            unhandledOpcodes_,
-            [&](const auto& unhandledOpcodes) -> std::optional<folly::Unit> {
-              if (unhandledOpcodes.find(opcode) != unhandledOpcodes.end()) {
-                return folly::unit;
+        request
+            .catchErrors(
+                folly::makeFutureWith([&] {
+                  request.startRequest(
+                      dispatcher_->getStats(),
+                      handlerEntry->histogram,
+                      *(liveRequestWatches_.get()));
+
+                  const auto* argEnd =
+                      reinterpret_cast<const uint8_t*>(data) + arg_size;
+                  auto dispatch = [this,
+                                   &request,
+                                   handlerEntry,
+                                   opcode = header->opcode](
+                                      const uint8_t* requestArg,
+                                      const uint8_t* requestArgEnd) {
+                    const auto requestClass =
+                        getRequestClass(opcode, handlerEntry->accessType);
+                    const auto classIndex = enumValue(requestClass);
+                    auto* pool = options_.requestPools[classIndex].get();
+                    if (!pool) {
+                      return (this->*handlerEntry->handler)(
+                          &request.getReq(), requestArg);
+                    }
+
+                    auto& queueDepth = requestQueueDepths_[classIndex];
+                    const auto depth = ++queueDepth;
+                    (dispatcher_->getStats()
+                         ->getChannelStatsForCurrentThread()
+                         .*kQueueDepthHistograms[classIndex])
+                        .addValue(depth);
+
+                    // Our caller reuses the buffer for the next request as
+                    // soon as we return, so the handler needs its own copy.
+                    std::vector<uint8_t> argCopy(requestArg, requestArgEnd);
+                    return folly::via(
+                        pool,
+                        [this,
+                         &request,
+                         &queueDepth,
+                         handler = handlerEntry->handler,
+                         argCopy = std::move(argCopy)] {
+                          --queueDepth;
+                          return (this->*handler)(
+                              &request.getReq(), argCopy.data());
+                        });
+                  };
+
+                  // pid 0 is the kernel itself, e.g. for FUSE_FORGET or
+                  // writeback, which no process is waiting on.
+                  if (!processLimiter_ || header->pid == 0) {
+                    return dispatch(arg, argEnd);
+                  }
+                  auto slot = processLimiter_->acquire(header->pid);
+                  if (slot.isReady()) {
+                    return dispatch(arg, argEnd)
+                        .ensure([slot = std::move(slot).value()] {});
+                  }
+
+                  // The process has too many requests in progress, so this
+                  // one waits, and holds on to its arguments until then.
+                  dispatcher_->getStats()
+                      ->getChannelStatsForCurrentThread()
+                      .admissionDelayed.addValue(1);
+                  return std::move(slot).thenValue(
+                      [dispatch = std::move(dispatch),
+                       argCopy = std::vector<uint8_t>(arg, argEnd)](
+                          ProcessConcurrencyLimiter::Slot admitted) {
+                        return dispatch(
+                                   argCopy.data(),
+                                   argCopy.data() + argCopy.size())
+                            .ensure([admitted = std::move(admitted)] {});
+                      });
+                })
+                    .within(requestTimeout_),
+                notifications_)
+            .ensure([this, requestId] {
+              auto state = state_.wlock();
+
+              // Remove the request from the map
+              state->requests.erase(requestId);
+
+              // We may be complete; check to see if all requests are
+              // done and whether there are any threads remaining.
+              if (state->requests.empty() &&
+                  state->stoppedThreads == numThreads_) {
+                sessionComplete(std::move(state));
               }
-              return std::nullopt;
-            },
-            [&](auto& unhandledOpcodes) -> folly::Unit {
-              XLOG(WARN) << "unhandled fuse opcode " << opcode << "("
-                         << fuseOpcodeName(opcode) << ")";
-              unhandledOpcodes->insert(opcode);
-              return folly::unit;
             });
-
-        try {
-          replyError(*header, ENOSYS);
-        } catch (const std::system_error& exc) {
-          XLOG(ERR) << "Failed to write error response to fuse: " << exc.what();
-          requestSessionExit(StopReason::FUSE_WRITE_ERROR);
-          return;
-        }
         break;
       }
+
+      const auto opcode = header->opcode;
+      tryRlockCheckBeforeUpdate<folly::Unit>(
+          unhandledOpcodes_,
+          [&](const auto& unhandledOpcodes) -> std::optional<folly::Unit> {
+            if (unhandledOpcodes.find(opcode) != unhandledOpcodes.end()) {
+              return folly::unit;
+            }
+            return std::nullopt;
+          },
+          [&](auto& unhandledOpcodes) -> folly::Unit {
+            XLOG(WARN) << "unhandled fuse opcode " << opcode << "("
+                       << fuseOpcodeName(opcode) << ")";
+            unhandledOpcodes->insert(opcode);
+            return folly::unit;
+          });
+
+      try {
+        replyError(*header, ENOSYS);
+      } catch (const std::system_error& exc) {
+        XLOG(ERR) << "Failed to write error response to fuse: " << exc.what();
+        requestSessionExit(StopReason::FUSE_WRITE_ERROR);
+        return false;
+      }
+      break;
     }
   }
+  return true;
 }
 
 void FuseChannel::sessionComplete(folly::Synchronized<State>::LockedPtr state) {
@@ -1374,7 +1926,7 @@ folly::Future<folly::Unit> FuseChannel::fuseRead(
   auto ino = InodeNumber{header->nodeid};
   return dispatcher_->read(ino, read->size, read->offset, RequestData::get())
       .thenValue(
-          [](BufVec&& buf) { RequestData::get().sendReply(buf.getIov()); });
+          [](BufVec&& buf) { RequestData::get().sendReply(buf); });
 }
 
 folly::Future<folly::Unit> FuseChannel::fuseWrite(
@@ -1765,6 +2317,27 @@ folly::Future<folly::Unit> FuseChannel::fuseReadDir(
       });
 }
 
+#ifdef __linux__
+folly::Future<folly::Unit> FuseChannel::fuseReadDirPlus(
+    const fuse_in_header* header,
+    const uint8_t* arg) {
+  auto read = reinterpret_cast<const fuse_read_in*>(arg);
+  XLOG(DBG7) << "FUSE_READDIRPLUS";
+  auto ino = InodeNumber{header->nodeid};
+  return dispatcher_
+      ->readdirplus(
+          ino,
+          DirList{read->size, DirList::Format::ReaddirPlus},
+          read->offset,
+          read->fh,
+          RequestData::get())
+      .thenValue([](DirList&& list) {
+        const auto buf = list.getBuf();
+        RequestData::get().sendReply(StringPiece{buf});
+      });
+}
+#endif
+
 folly::Future<folly::Unit> FuseChannel::fuseReleaseDir(
     const fuse_in_header* header,
     const uint8_t* arg) {
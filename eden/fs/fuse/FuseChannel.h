@@ -15,6 +15,8 @@
 #include <folly/synchronization/CallOnce.h>
 #include <stdlib.h>
 #include <sys/uio.h>
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <iosfwd>
 #include <memory>
@@ -24,13 +26,18 @@
 #include <unordered_map>
 #include <vector>
 
+#include "eden/fs/eden-config.h"
+#include "eden/fs/fuse/BufVec.h"
+#include "eden/fs/fuse/FuseRequestClass.h"
 #include "eden/fs/fuse/FuseTypes.h"
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
 #include "eden/fs/utils/PathFuncs.h"
 #include "eden/fs/utils/ProcessAccessLog.h"
+#include "eden/fs/utils/ProcessConcurrencyLimiter.h"
 
 namespace folly {
+class Executor;
 class RequestContext;
 struct Unit;
 } // namespace folly
@@ -41,6 +48,32 @@ namespace eden {
 class Dispatcher;
 class Notifications;
 
+/**
+ * Optional FUSE features that are negotiated with the kernel during
+ * FUSE_INIT.  They are only honored by the Linux FUSE implementation.
+ */
+struct FuseChannelOptions {
+  // Request FUSE_WRITEBACK_CACHE.
+  bool writebackCache{false};
+  // Request FUSE_ASYNC_DIO.
+  bool asyncDio{false};
+  // The maximum number of pages per request, or 0 for the kernel default.
+  size_t maxPages{0};
+  // Read requests through io_uring instead of blocking read() calls, if eden
+  // was built with liburing and the kernel supports it.
+  bool useIoUring{false};
+  // The number of reads each worker thread keeps queued when using io_uring.
+  size_t ioUringQueueDepth{8};
+  // The number of requests each process may have in progress before its
+  // further requests wait for earlier ones to finish, or 0 for no limit.
+  // Requests the kernel makes on its own behalf are never limited.
+  size_t maxRequestsPerProcess{0};
+  // The thread pools to handle each FuseRequestClass in.  Requests without a
+  // pool are handled on the FUSE worker thread that read them.
+  std::array<std::shared_ptr<folly::Executor>, kNumFuseRequestClasses>
+      requestPools;
+};
+
 class FuseChannel {
  public:
   enum class StopReason {
@@ -103,7 +136,8 @@ class FuseChannel {
       Dispatcher* const dispatcher,
       std::shared_ptr<ProcessNameCache> processNameCache,
       folly::Duration requestTimeout = std::chrono::seconds(60),
-      Notifications* FOLLY_NULLABLE notifications = nullptr);
+      Notifications* FOLLY_NULLABLE notifications = nullptr,
+      FuseChannelOptions options = {});
 
   /**
    * Destroy the FuseChannel.
@@ -214,8 +248,30 @@ class FuseChannel {
   void invalidateInodes(folly::Range<InodeNumber*> range);
 
   /**
-   * Wait for all currently scheduled invalidateInode() and invalidateEntry()
-   * operations to complete.
+   * Push data into the kernel's page cache for the specified inode
+   * (FUSE_NOTIFY_STORE), so that reads of that range are served without a
+   * FUSE request.  The kernel extends its idea of the file size if the data
+   * ends past it.
+   *
+   * The caller must make sure that the data is the current contents of the
+   * file: the kernel overwrites whatever it has cached for the range.
+   *
+   * This operation is performed asynchronously, in order with the
+   * invalidations scheduled around it.  flushInvalidations() can be called if
+   * you need to determine when this operation has completed.
+   *
+   * @param ino the inode number
+   * @param off the offset in the inode where the data starts
+   * @param data the data to store
+   */
+  void storeInode(
+      InodeNumber ino,
+      int64_t off,
+      std::unique_ptr<folly::IOBuf> data);
+
+  /**
+   * Wait for all currently scheduled invalidateInode(), invalidateEntry() and
+   * storeInode() operations to complete.
    *
    * The returned Future will complete once all invalidation operations
    * scheduled before this flushInvalidations() call have finished.  This
@@ -270,6 +326,16 @@ class FuseChannel {
   void sendReply(const fuse_in_header& request, folly::fbvector<iovec>&& vec)
       const;
 
+  /**
+   * Sends the contents of a BufVec as a reply to the kernel.
+   * Large replies that refer to a file range are spliced into the FUSE device
+   * when the kernel supports it, instead of being copied through userspace.
+   *
+   * throws system_error if the write fails.  Writes can fail if the
+   * data we send to the kernel is invalid.
+   */
+  void sendReply(const fuse_in_header& request, const BufVec& buf) const;
+
   /**
    * Sends a reply to the kernel.
    * The payload parameter is typically a fuse_out_XXX struct as defined
@@ -343,6 +409,16 @@ class FuseChannel {
   struct DataRange {
     DataRange(int64_t offset, int64_t length);
 
+    /**
+     * Widen this range so that invalidating it also covers `other`.
+     *
+     * Ranges follow FUSE_NOTIFY_INVAL_INODE: a negative offset only
+     * invalidates the attributes, and a length of 0 or less extends to the
+     * end of the file.  Disjoint ranges are merged into the range spanning
+     * both, which over-invalidates but is never incorrect.
+     */
+    void merge(const DataRange& other);
+
     int64_t offset;
     int64_t length;
   };
@@ -350,10 +426,19 @@ class FuseChannel {
     INODE,
     DIR_ENTRY,
     FLUSH,
+    STORE,
+  };
+  struct StoreData {
+    int64_t offset;
+    std::unique_ptr<folly::IOBuf> data;
   };
   struct InvalidationEntry {
     InvalidationEntry(InodeNumber inode, int64_t offset, int64_t length);
     InvalidationEntry(InodeNumber inode, PathComponentPiece name);
+    InvalidationEntry(
+        InodeNumber inode,
+        int64_t offset,
+        std::unique_ptr<folly::IOBuf> data);
     explicit InvalidationEntry(folly::Promise<folly::Unit> promise);
     InvalidationEntry(InvalidationEntry&& other) noexcept;
     ~InvalidationEntry();
@@ -364,11 +449,50 @@ class FuseChannel {
       PathComponent name;
       DataRange range;
       folly::Promise<folly::Unit> promise;
+      StoreData store;
     };
   };
   struct InvalidationQueue {
+    /**
+     * Queue an inode invalidation, merging it into an invalidation of the
+     * same inode that is already queued.
+     */
+    void addInode(InodeNumber inode, int64_t offset, int64_t length);
+
+    /**
+     * Queue a directory entry invalidation, unless the same entry is already
+     * queued.
+     */
+    void addEntry(InodeNumber parent, PathComponentPiece name);
+
+    /**
+     * Queue a page cache store.  Invalidations of the same inode queued
+     * after it are not merged into ones queued before it, so that they still
+     * reach the kernel after the data does.
+     */
+    void addStore(
+        InodeNumber inode,
+        int64_t offset,
+        std::unique_ptr<folly::IOBuf> data);
+
+    /**
+     * Take the queued entries, leaving the queue empty.
+     */
+    void takeEntries(std::vector<InvalidationEntry>& entries);
+
     std::vector<InvalidationEntry> queue;
     bool stop{false};
+
+    // The indices in `queue` of the invalidations that have not been taken
+    // yet.  A checkout can invalidate the same inodes and entries many times
+    // over, and the invalidation thread only needs to send each one once.
+    //
+    // Coalescing across FLUSH entries is fine: nothing in `queue` has been
+    // sent yet, so a merged invalidation still reaches the kernel after every
+    // request that it stands for was made.
+    std::unordered_map<InodeNumber, size_t> inodeIndices;
+    std::unordered_map<InodeNumber, std::unordered_map<PathComponent, size_t>>
+        entryIndices;
   };
   friend std::ostream& operator<<(
       std::ostream& os,
@@ -462,6 +586,11 @@ class FuseChannel {
   folly::Future<folly::Unit> fuseReadDir(
       const fuse_in_header* header,
       const uint8_t* arg);
+#ifdef __linux__
+  folly::Future<folly::Unit> fuseReadDirPlus(
+      const fuse_in_header* header,
+      const uint8_t* arg);
+#endif
   folly::Future<folly::Unit> fuseReleaseDir(
       const fuse_in_header* header,
       const uint8_t* arg);
@@ -490,7 +619,24 @@ class FuseChannel {
   void sendInvalidation(InvalidationEntry& entry);
   void sendInvalidateInode(InodeNumber ino, int64_t off, int64_t len);
   void sendInvalidateEntry(InodeNumber parent, PathComponentPiece name);
+  void sendStoreInode(InodeNumber ino, int64_t off, const folly::IOBuf& data);
   void readInitPacket();
+
+#ifdef __linux__
+  /**
+   * Splice a file range into the FUSE device as the reply to `request`.
+   * Returns false, without having sent anything, if splicing is not possible
+   * and the reply has to be copied instead.
+   */
+  bool spliceReply(
+      const fuse_in_header& request,
+      const BufVec::FileRange& range) const;
+#endif
+
+  /**
+   * Log and throw the error for a failed write of a reply to the FUSE device.
+   */
+  [[noreturn]] void throwReplyError(int err) const;
   void startWorkerThreads();
 
   /**
@@ -522,6 +668,30 @@ class FuseChannel {
    */
   void processSession();
 
+#ifdef EDEN_HAVE_LIBURING
+  /**
+   * Like processSession(), but keeps options_.ioUringQueueDepth reads of the
+   * FUSE device queued in an io_uring so that a single worker thread can have
+   * several requests in flight.
+   *
+   * Returns false without having read anything if the io_uring could not be
+   * set up, in which case the caller should fall back to processSession().
+   */
+  bool processSessionIoUring();
+#endif
+
+  /**
+   * Handle an error from reading the FUSE device.  Returns true if the worker
+   * thread should keep reading requests, and false if it should exit.
+   */
+  bool handleReadError(int error);
+
+  /**
+   * Dispatch a single request that was read from the FUSE device.
+   * Returns false if the worker thread should exit.
+   */
+  bool processRequest(const char* data, size_t arg_size, pid_t myPid);
+
   /**
    * Requests that the worker threads terminate their processing loop.
    */
@@ -530,10 +700,17 @@ class FuseChannel {
       const folly::Synchronized<State>::LockedPtr& state,
       StopReason reason);
 
+  /*
+   * The size of the buffer requests are read into.  This is only changed by
+   * initializeFromTakeover(), before the worker threads are started, to fit
+   * the max_write negotiated by the previous process.
+   */
+  size_t bufferSize_{0};
+
   /*
    * Constant state that does not change for the lifetime of the FuseChannel
    */
-  const size_t bufferSize_{0};
+  const FuseChannelOptions options_;
   const size_t numThreads_;
   Dispatcher* const dispatcher_{nullptr};
   const AbsolutePath mountPath_;
@@ -570,6 +747,11 @@ class FuseChannel {
    */
   std::atomic<bool> stop_{false};
   folly::once_flag unmountLogFlag_;
+  // The number of requests waiting for a thread in each of
+  // options_.requestPools.
+  std::array<std::atomic<size_t>, kNumFuseRequestClasses> requestQueueDepths_{};
+  // Null unless options_.maxRequestsPerProcess is set.
+  std::unique_ptr<ProcessConcurrencyLimiter> processLimiter_;
   folly::Synchronized<State> state_;
   folly::Promise<StopFuture> initPromise_;
   folly::Promise<StopData> sessionCompletePromise_;
@@ -592,9 +774,7 @@ class FuseChannel {
   // destroyed when the owning FuseWorkerThread ends if there are outstanding
   // requests as these may outlive the spawning worker thread.
   class ThreadLocalTag {};
-  folly::ThreadLocal<
-      std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>,
-      ThreadLocalTag>
+  folly::ThreadLocal<std::shared_ptr<RequestWatchList>, ThreadLocalTag>
       liveRequestWatches_;
 };
 
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * The kinds of FUSE requests that can be handled in thread pools of their
+ * own, so that slow requests of one kind do not hold up the others.
+ */
+enum class FuseRequestClass : uint8_t {
+  // Lookups, getattr, readdir and the other requests that only read metadata.
+  Metadata,
+  // FUSE_READ and FUSE_WRITE.
+  Data,
+  // Requests other than FUSE_WRITE that modify the file system.
+  Mutation,
+};
+
+constexpr size_t kNumFuseRequestClasses = 3;
+
+} // namespace eden
+} // namespace facebook
@@ -9,6 +9,7 @@
 
 #include <folly/Subprocess.h>
 #include <folly/logging/xlog.h>
+#include <vector>
 
 #include "eden/fs/fuse/Dispatcher.h"
 #include "eden/fs/notifications/Notifications.h"
@@ -23,6 +24,58 @@ namespace eden {
 
 const std::string RequestData::kKey("fuse");
 
+namespace {
+/**
+ * The most freed RequestData objects each thread keeps for reuse.  Threads
+ * that create requests free most of them too, so this only needs to cover
+ * the requests a thread has in flight at once.
+ */
+constexpr size_t kMaxFreeRequestData = 64;
+
+struct RequestDataFreeList {
+  RequestDataFreeList() {
+    // Reserve up front so that returning an entry never allocates.
+    entries.reserve(kMaxFreeRequestData);
+  }
+
+  ~RequestDataFreeList();
+
+  std::vector<void*> entries;
+};
+
+// Set once this thread's free list has been destroyed, so requests freed by
+// later thread-local destructors go straight back to the allocator.  This is
+// trivially destructible, so it is safe to read at any point.
+thread_local bool freeListDestroyed = false;
+thread_local RequestDataFreeList freeList;
+
+RequestDataFreeList::~RequestDataFreeList() {
+  freeListDestroyed = true;
+  for (auto* entry : entries) {
+    ::operator delete(entry);
+  }
+}
+} // namespace
+
+void* RequestData::operator new(size_t size) {
+  if (size == sizeof(RequestData) && !freeListDestroyed &&
+      !freeList.entries.empty()) {
+    auto* ptr = freeList.entries.back();
+    freeList.entries.pop_back();
+    return ptr;
+  }
+  return ::operator new(size);
+}
+
+void RequestData::operator delete(void* ptr, size_t size) noexcept {
+  if (size == sizeof(RequestData) && !freeListDestroyed &&
+      freeList.entries.size() < kMaxFreeRequestData) {
+    freeList.entries.push_back(ptr);
+    return;
+  }
+  ::operator delete(ptr);
+}
+
 RequestData::RequestData(
     FuseChannel* channel,
     const fuse_in_header& fuseHeader,
@@ -51,8 +104,7 @@ RequestData& RequestData::create(
 void RequestData::startRequest(
     EdenStats* stats,
     FuseThreadStats::HistogramPtr histogram,
-    std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>&
-        requestWatches) {
+    std::shared_ptr<RequestWatchList>& requestWatches) {
   startTime_ = steady_clock::now();
   DCHECK(latencyHistogram_ == nullptr);
   latencyHistogram_ = histogram;
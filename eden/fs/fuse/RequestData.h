@@ -46,8 +46,7 @@ class RequestData : public folly::RequestData, public ObjectFetchContext {
   EdenStats* stats_{nullptr};
   Dispatcher* dispatcher_{nullptr};
   RequestMetricsScope requestMetricsScope_;
-  std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>
-      channelThreadLocalStats_;
+  std::shared_ptr<RequestWatchList> channelThreadLocalStats_;
 
   struct EdenTopStats {
    public:
@@ -91,6 +90,15 @@ class RequestData : public folly::RequestData, public ObjectFetchContext {
       const fuse_in_header& fuseHeader,
       Dispatcher* dispatcher);
 
+  /**
+   * Every FUSE request allocates a RequestData, and it is freed when the
+   * request's last continuation finishes.  Freed RequestData objects are
+   * kept on a small per-thread free list and reused by the next request
+   * created on that thread, rather than going back to malloc each time.
+   */
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size) noexcept;
+
   bool hasCallback() override {
     return false;
   }
@@ -134,8 +142,7 @@ class RequestData : public folly::RequestData, public ObjectFetchContext {
   void startRequest(
       EdenStats* stats,
       FuseThreadStats::HistogramPtr histogram,
-      std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>&
-          requestWatches);
+      std::shared_ptr<RequestWatchList>& requestWatches);
   void finishRequest();
 
   // Returns the associated dispatcher instance
@@ -203,6 +210,10 @@ class RequestData : public folly::RequestData, public ObjectFetchContext {
     channel_->sendReply(stealReq(), std::move(vec));
   }
 
+  void sendReply(const BufVec& buf) {
+    channel_->sendReply(stealReq(), buf);
+  }
+
   void sendReply(folly::StringPiece piece) {
     channel_->sendReply(stealReq(), folly::ByteRange(piece));
   }
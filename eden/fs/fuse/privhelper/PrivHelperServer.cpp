@@ -16,6 +16,8 @@
 #include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/init/Init.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
@@ -31,6 +33,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <chrono>
+#include <mutex>
 #include <set>
 
 #include "eden/fs/fuse/privhelper/PrivHelperConn.h"
@@ -54,6 +57,14 @@ using std::string;
 namespace facebook {
 namespace eden {
 
+namespace {
+/**
+ * The number of mount and unmount requests that may run at once.  Mounting
+ * mostly waits on the kernel, so this need not match the number of CPUs.
+ */
+constexpr size_t kNumWorkerThreads = 8;
+} // namespace
+
 PrivHelperServer::PrivHelperServer() {}
 
 PrivHelperServer::~PrivHelperServer() {}
@@ -96,6 +107,9 @@ void PrivHelperServer::initPartial(folly::File&& socket, uid_t uid, gid_t gid) {
   // NotificationQueue code checks to ensure that it isn't used across a fork.
   eventBase_ = std::make_unique<folly::EventBase>();
   conn_ = UnixSocket::makeUnique(eventBase_.get(), std::move(socket));
+  workerPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+      kNumWorkerThreads,
+      std::make_shared<folly::NamedThreadFactory>("PrivHelperMount"));
   uid_ = uid;
   gid_ = gid;
 
@@ -149,6 +163,9 @@ bool isFuseKextLoaded() {
 }
 
 void ensureFuseKextIsLoaded() {
+  // Mounts run in parallel; only one of them should load the kext.
+  static std::mutex kextMutex;
+  std::lock_guard<std::mutex> guard{kextMutex};
   if (isFuseKextLoaded()) {
     return;
   }
@@ -300,7 +317,8 @@ folly::File PrivHelperServer::fuseMount(const char* mountPath, bool readOnly) {
   // If the timeout is reached, the kernel will shut down the fuse
   // connection.
   auto daemon_timeout_seconds =
-      std::chrono::duration_cast<std::chrono::seconds>(fuseTimeout_).count();
+      std::chrono::duration_cast<std::chrono::seconds>(fuseTimeout_.load())
+          .count();
   if (daemon_timeout_seconds > FUSE_MAX_DAEMON_TIMEOUT) {
     args.daemon_timeout = FUSE_MAX_DAEMON_TIMEOUT;
   } else {
@@ -443,7 +461,7 @@ UnixSocket::Message PrivHelperServer::processTakeoverStartupMsg(
   XLOG(DBG3) << "takeover startup for \"" << mountPath << "\"; "
              << bindMounts.size() << " bind mounts";
 
-  mountPoints_.insert(mountPath);
+  mountPoints_.wlock()->insert(mountPath);
   return makeResponse();
 }
 
@@ -454,7 +472,7 @@ UnixSocket::Message PrivHelperServer::processMountMsg(Cursor& cursor) {
   XLOG(DBG3) << "mount \"" << mountPath << "\"";
 
   auto fuseDev = fuseMount(mountPath.c_str(), readOnly);
-  mountPoints_.insert(mountPath);
+  mountPoints_.wlock()->insert(mountPath);
 
   return makeResponse(std::move(fuseDev));
 }
@@ -464,14 +482,15 @@ UnixSocket::Message PrivHelperServer::processUnmountMsg(Cursor& cursor) {
   PrivHelperConn::parseUnmountRequest(cursor, mountPath);
   XLOG(DBG3) << "unmount \"" << mountPath << "\"";
 
-  const auto it = mountPoints_.find(mountPath);
-  if (it == mountPoints_.end()) {
+  if (mountPoints_.rlock()->count(mountPath) == 0) {
     throw std::domain_error(
         folly::to<string>("No FUSE mount found for ", mountPath));
   }
 
+  // Requests for mountPath are serialized, so it cannot be removed from
+  // mountPoints_ while we unmount it without holding the lock.
   fuseUnmount(mountPath.c_str());
-  mountPoints_.erase(mountPath);
+  mountPoints_.wlock()->erase(mountPath);
   return makeResponse();
 }
 
@@ -481,18 +500,16 @@ UnixSocket::Message PrivHelperServer::processTakeoverShutdownMsg(
   PrivHelperConn::parseTakeoverShutdownRequest(cursor, mountPath);
   XLOG(DBG3) << "takeover shutdown \"" << mountPath << "\"";
 
-  const auto it = mountPoints_.find(mountPath);
-  if (it == mountPoints_.end()) {
+  if (mountPoints_.wlock()->erase(mountPath) == 0) {
     throw std::domain_error(
         folly::to<string>("No FUSE mount found for ", mountPath));
   }
-
-  mountPoints_.erase(mountPath);
   return makeResponse();
 }
 
 std::string PrivHelperServer::findMatchingMountPrefix(folly::StringPiece path) {
-  for (const auto& mountPoint : mountPoints_) {
+  const auto mountPoints = mountPoints_.rlock();
+  for (const auto& mountPoint : *mountPoints) {
     if (boost::starts_with(path, mountPoint + "/")) {
       return mountPoint;
     }
@@ -639,20 +656,91 @@ void PrivHelperServer::run() {
   // too.
   XLOG(DBG5) << "privhelper process exiting";
 
+  // Let in-flight mounts finish, so that cleanupMountPoints() sees them, then
+  // drop the responses they queued for the closed connection.
+  pathQueues_.clear();
+  workerPool_->join();
+  conn_.reset();
+  eventBase_->loopOnce(EVLOOP_NONBLOCK);
+
   // Unmount all active mount points
   cleanupMountPoints();
 }
 
 void PrivHelperServer::messageReceived(UnixSocket::Message&& message) noexcept {
   try {
-    processAndSendResponse(std::move(message));
+    Cursor cursor{&message.data};
+    cursor.skip(sizeof(uint32_t)); // xid
+    const auto msgType =
+        static_cast<PrivHelperConn::MsgType>(cursor.readBE<uint32_t>());
+    auto path = getMountRequestPath(msgType, cursor);
+    if (!path) {
+      processAndSendResponse(std::move(message));
+      return;
+    }
+
+    auto& queue = pathQueues_[*path];
+    if (!queue) {
+      queue = folly::SerialExecutor::create(
+          folly::getKeepAliveToken(workerPool_.get()));
+    }
+    queue->add([this, message = std::move(message)]() mutable {
+      auto response = processRequest(message);
+      eventBase_->runInEventBaseThread(
+          [this, response = std::move(response)]() mutable {
+            sendResponse(std::move(response));
+          });
+    });
   } catch (const std::exception& ex) {
     XLOG(ERR) << "error processing privhelper request: "
               << folly::exceptionStr(ex);
   }
 }
 
+std::optional<std::string> PrivHelperServer::getMountRequestPath(
+    PrivHelperConn::MsgType msgType,
+    Cursor cursor) {
+  string mountPath;
+  try {
+    switch (msgType) {
+      case PrivHelperConn::REQ_MOUNT_FUSE: {
+        bool readOnly;
+        PrivHelperConn::parseMountRequest(cursor, mountPath, readOnly);
+        return mountPath;
+      }
+      case PrivHelperConn::REQ_UNMOUNT_FUSE:
+        PrivHelperConn::parseUnmountRequest(cursor, mountPath);
+        return mountPath;
+      case PrivHelperConn::REQ_MOUNT_BIND: {
+        string clientPath;
+        PrivHelperConn::parseBindMountRequest(cursor, clientPath, mountPath);
+        return mountPath;
+      }
+      case PrivHelperConn::REQ_UNMOUNT_BIND:
+        PrivHelperConn::parseBindUnMountRequest(cursor, mountPath);
+        return mountPath;
+      default:
+        return std::nullopt;
+    }
+  } catch (const std::exception&) {
+    // Let processRequest() report the malformed request.
+    return std::nullopt;
+  }
+}
+
 void PrivHelperServer::processAndSendResponse(UnixSocket::Message&& message) {
+  sendResponse(processRequest(message));
+}
+
+void PrivHelperServer::sendResponse(UnixSocket::Message&& response) {
+  // conn_ is gone if the response arrived after shutdown began.
+  if (conn_) {
+    conn_->send(std::move(response));
+  }
+}
+
+UnixSocket::Message PrivHelperServer::processRequest(
+    UnixSocket::Message& message) {
   Cursor cursor{&message.data};
   const auto xid = cursor.readBE<uint32_t>();
   const auto msgType =
@@ -692,8 +780,7 @@ void PrivHelperServer::processAndSendResponse(UnixSocket::Message&& message) {
   RWPrivateCursor respCursor(&response.data);
   respCursor.writeBE<uint32_t>(xid);
   respCursor.writeBE<uint32_t>(responseType);
-
-  conn_->send(std::move(response));
+  return response;
 }
 
 UnixSocket::Message PrivHelperServer::makeResponse() {
@@ -761,7 +848,8 @@ void PrivHelperServer::receiveError(
 }
 
 void PrivHelperServer::cleanupMountPoints() {
-  for (const auto& mountPoint : mountPoints_) {
+  auto mountPoints = std::move(*mountPoints_.wlock());
+  for (const auto& mountPoint : mountPoints) {
     try {
       fuseUnmount(mountPoint.c_str());
     } catch (const std::exception& ex) {
@@ -769,8 +857,6 @@ void PrivHelperServer::cleanupMountPoints() {
                 << "\": " << folly::exceptionStr(ex);
     }
   }
-
-  mountPoints_.clear();
 }
 
 } // namespace eden
@@ -7,8 +7,13 @@
 
 #pragma once
 
+#include <folly/Synchronized.h>
+#include <folly/executors/SerialExecutor.h>
 #include <sys/types.h>
+#include <atomic>
+#include <chrono>
 #include <limits>
+#include <optional>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -16,6 +21,7 @@
 #include "eden/fs/utils/UnixSocket.h"
 
 namespace folly {
+class CPUThreadPoolExecutor;
 class EventBase;
 class File;
 namespace io {
@@ -36,6 +42,11 @@ namespace eden {
  *
  * The uid and gid parameters specify the user and group ID of the unprivileged
  * process that will be making requests to us.
+ *
+ * Mount and unmount requests run on a small pool of threads, so that bringing
+ * up many checkouts and bind mounts happens in parallel.  Requests for the
+ * same path still run in the order they were received.  The other requests
+ * are cheap and run on the main thread as they arrive.
  */
 class PrivHelperServer : private UnixSocket::ReceiveCallback {
  public:
@@ -71,6 +82,17 @@ class PrivHelperServer : private UnixSocket::ReceiveCallback {
   void receiveError(const folly::exception_wrapper& ew) noexcept override;
 
   void processAndSendResponse(UnixSocket::Message&& message);
+  UnixSocket::Message processRequest(UnixSocket::Message& message);
+  void sendResponse(UnixSocket::Message&& response);
+
+  /**
+   * Returns the path that a mount or unmount request operates on, or
+   * std::nullopt if the request should run on the main thread.
+   */
+  static std::optional<std::string> getMountRequestPath(
+      PrivHelperConn::MsgType msgType,
+      folly::io::Cursor cursor);
+
   UnixSocket::Message processMessage(
       PrivHelperConn::MsgType msgType,
       folly::io::Cursor& cursor,
@@ -106,11 +128,18 @@ class PrivHelperServer : private UnixSocket::ReceiveCallback {
   UnixSocket::UniquePtr conn_;
   uid_t uid_{std::numeric_limits<uid_t>::max()};
   gid_t gid_{std::numeric_limits<gid_t>::max()};
-  std::chrono::nanoseconds fuseTimeout_{std::chrono::seconds(60)};
-
-  // The privhelper server only has a single thread,
-  // so we don't need to lock the following state
-  std::set<std::string> mountPoints_;
+  std::atomic<std::chrono::nanoseconds> fuseTimeout_{std::chrono::seconds(60)};
+
+  // Created by initPartial(), since threads do not survive a fork.
+  std::unique_ptr<folly::CPUThreadPoolExecutor> workerPool_;
+  // Serializes the requests for each path on workerPool_.  Only accessed from
+  // the main thread.
+  std::unordered_map<
+      std::string,
+      folly::Executor::KeepAlive<folly::SerialExecutor>>
+      pathQueues_;
+
+  folly::Synchronized<std::set<std::string>> mountPoints_;
 };
 
 } // namespace eden
@@ -289,6 +289,28 @@ TEST_F(PrivHelperTest, multiplePendingFuseMounts) {
   EXPECT_THAT(server_.getUnusedFuseUnmountResults(), UnorderedElementsAre());
 }
 
+TEST_F(PrivHelperTest, slowFuseMountDoesNotBlockOthers) {
+  auto slowPromise = server_.setFuseMountResult("/mnt/slow");
+  auto fastPromise = server_.setFuseMountResult("/mnt/fast");
+  server_.setFuseUnmountResult("/mnt/slow").setValue();
+  server_.setFuseUnmountResult("/mnt/fast").setValue();
+
+  auto slowResult = client_->fuseMount("/mnt/slow", false);
+  auto fastResult = client_->fuseMount("/mnt/fast", false);
+
+  // The second mount completes while the first one is still in progress.
+  TemporaryFile tempFile;
+  fastPromise.setValue(File(tempFile.fd(), /* ownsFD */ false));
+  std::move(fastResult).get(500ms);
+  EXPECT_FALSE(slowResult.isReady());
+
+  slowPromise.setValue(File(tempFile.fd(), /* ownsFD */ false));
+  std::move(slowResult).get(1s);
+
+  cleanup();
+  EXPECT_THAT(server_.getUnusedFuseUnmountResults(), UnorderedElementsAre());
+}
+
 TEST_F(PrivHelperTest, bindMounts) {
   TemporaryFile tempFile;
 
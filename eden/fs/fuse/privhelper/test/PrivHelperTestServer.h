@@ -10,6 +10,7 @@
 #include "eden/fs/fuse/privhelper/PrivHelperServer.h"
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
 
 namespace facebook {
 namespace eden {
@@ -41,7 +42,8 @@ class PrivHelperTestServer : public PrivHelperServer {
  private:
   // all of the paths we've ever bind mounted; we remember this
   // so that we can mark them as unmounted when we unmount things.
-  std::vector<std::string> allBindMounts_;
+  // Mount requests run on several threads, so this is synchronized.
+  folly::Synchronized<std::vector<std::string>> allBindMounts_;
 
   folly::File fuseMount(const char* mountPath, bool readOnly) override;
   void fuseUnmount(const char* mountPath) override;
@@ -7,6 +7,8 @@
 
 #include "eden/fs/fuse/BufVec.h"
 
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
 #include <gtest/gtest.h>
 
 TEST(BufVecTest, BufVec) {
@@ -16,4 +18,22 @@ TEST(BufVecTest, BufVec) {
   EXPECT_EQ(10u, bufVec.size());
   EXPECT_EQ(10u, bufVec.copyData().size());
   EXPECT_EQ("helloworld", bufVec.copyData());
+  EXPECT_FALSE(bufVec.getFileRange());
+}
+
+TEST(BufVecTest, fromFile) {
+  folly::test::TemporaryFile file;
+  ASSERT_EQ(10, folly::writeFull(file.fd(), "helloworld", 10));
+
+  const auto bufVec = facebook::eden::BufVec::fromFile(file.fd(), 5, 100, {});
+  auto range = bufVec.getFileRange();
+  ASSERT_TRUE(range);
+  EXPECT_EQ(file.fd(), range->fd);
+  EXPECT_EQ(5, range->pos);
+  EXPECT_EQ(100u, range->size);
+
+  // Reading stops at EOF, after which the data is no longer a file range.
+  EXPECT_EQ("world", bufVec.copyData());
+  EXPECT_EQ(5u, bufVec.size());
+  EXPECT_FALSE(bufVec.getFileRange());
 }
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/fuse/DirList.h"
+
+#include <gtest/gtest.h>
+
+#include "eden/fs/fuse/FuseTypes.h"
+
+using namespace facebook::eden;
+
+TEST(DirListTest, readdirEntriesRoundTrip) {
+  DirList list{4096};
+  EXPECT_TRUE(list.add("foo", 5, dtype_t::Regular, 7));
+  EXPECT_TRUE(list.add("bar", 6, dtype_t::Dir, 8));
+
+  auto entries = list.extract();
+  ASSERT_EQ(2, entries.size());
+  EXPECT_EQ("foo", entries[0].name);
+  EXPECT_EQ(5, entries[0].inode);
+  EXPECT_EQ(dtype_t::Regular, entries[0].type);
+  EXPECT_EQ(7, entries[0].offset);
+  EXPECT_EQ("bar", entries[1].name);
+  EXPECT_EQ(dtype_t::Dir, entries[1].type);
+}
+
+#ifdef __linux__
+TEST(DirListTest, readdirplusEntriesCarryAttributes) {
+  DirList list{4096, DirList::Format::ReaddirPlus};
+  EXPECT_TRUE(list.add("foo", 5, dtype_t::Regular, 7));
+  EXPECT_TRUE(list.add("bar", 6, dtype_t::Dir, 8));
+
+  fuse_entry_out entry = {};
+  entry.nodeid = 6;
+  entry.attr.size = 42;
+  list.setEntry(1, entry);
+
+  auto buf = list.getBuf();
+  auto* first = reinterpret_cast<const fuse_direntplus*>(buf.data());
+  EXPECT_EQ(0, first->entry_out.nodeid);
+  EXPECT_EQ(5, first->dirent.ino);
+  auto* second = reinterpret_cast<const fuse_direntplus*>(
+      buf.data() + FUSE_DIRENTPLUS_SIZE(first));
+  EXPECT_EQ(6, second->entry_out.nodeid);
+  EXPECT_EQ(42, second->entry_out.attr.size);
+
+  auto entries = list.extract();
+  ASSERT_EQ(2, entries.size());
+  EXPECT_EQ("foo", entries[0].name);
+  EXPECT_EQ("bar", entries[1].name);
+  EXPECT_EQ(8, entries[1].offset);
+}
+
+TEST(DirListTest, readdirplusEntriesTakeMoreSpace) {
+  // Room for one plain entry plus a bit, but not for a readdirplus entry.
+  DirList list{FUSE_NAME_OFFSET_DIRENTPLUS, DirList::Format::ReaddirPlus};
+  EXPECT_FALSE(list.add("foo", 5, dtype_t::Regular, 7));
+}
+#endif
@@ -8,6 +8,7 @@
 #include "eden/fs/fuse/FuseChannel.h"
 
 #include <folly/Random.h>
+#include <folly/executors/ManualExecutor.h>
 #include <folly/logging/xlog.h>
 #include <folly/test/TestUtils.h>
 #include <gtest/gtest.h>
@@ -64,13 +65,17 @@ fuse_entry_out genRandomLookupResponse(uint64_t nodeid) {
 class FuseChannelTest : public ::testing::Test {
  protected:
   unique_ptr<FuseChannel, FuseChannelDeleter> createChannel(
-      size_t numThreads = 2) {
+      size_t numThreads = 2,
+      FuseChannelOptions options = {}) {
     return unique_ptr<FuseChannel, FuseChannelDeleter>(new FuseChannel(
         fuse_.start(),
         mountPath_,
         numThreads,
         &dispatcher_,
-        std::make_shared<ProcessNameCache>()));
+        std::make_shared<ProcessNameCache>(),
+        std::chrono::seconds(60),
+        nullptr,
+        options));
   }
 
   FuseChannel::StopFuture performInit(
@@ -392,3 +397,72 @@ TEST_F(FuseChannelTest, interruptLookups) {
     EXPECT_EQ(requestId, received.header.unique);
   }
 }
+
+TEST_F(FuseChannelTest, ioUringRequestsAndTakeover) {
+  // Without liburing, or on kernels without io_uring, the channel falls back
+  // to read(), and this behaves like the other tests.
+  FuseChannelOptions options;
+  options.useIoUring = true;
+  options.ioUringQueueDepth = 4;
+  auto channel = createChannel(1, options);
+  auto completeFuture = performInit(channel.get());
+
+  // More requests than there are queued reads.
+  std::vector<uint32_t> requestIds;
+  for (int i = 0; i < 10; ++i) {
+    requestIds.push_back(fuse_.sendLookup(FUSE_ROOT_ID, "foo"));
+  }
+  for (auto requestId : requestIds) {
+    auto req = dispatcher_.waitForLookup(requestId);
+    req.promise.setValue(genRandomLookupResponse(requestId + 1));
+    auto received = fuse_.recvResponse();
+    EXPECT_EQ(requestId, received.header.unique);
+  }
+
+  channel->takeoverStop();
+
+  auto stopData = std::move(completeFuture).get(kTimeout);
+  EXPECT_EQ(stopData.reason, FuseChannel::StopReason::TAKEOVER);
+  EXPECT_TRUE(stopData.fuseDevice);
+}
+
+TEST_F(FuseChannelTest, ioUringUnmount) {
+  FuseChannelOptions options;
+  options.useIoUring = true;
+  auto channel = createChannel(2, options);
+  auto completeFuture = performInit(channel.get());
+
+  fuse_.close();
+
+  auto stopData = std::move(completeFuture).get(kTimeout);
+  EXPECT_EQ(stopData.reason, FuseChannel::StopReason::UNMOUNTED);
+  EXPECT_FALSE(stopData.fuseDevice);
+}
+
+TEST_F(FuseChannelTest, requestsAreHandledInTheirPool) {
+  auto pool = std::make_shared<folly::ManualExecutor>();
+  FuseChannelOptions options;
+  options.requestPools[enumValue(FuseRequestClass::Metadata)] = pool;
+  auto channel = createChannel(1, options);
+  auto completeFuture = performInit(channel.get());
+
+  // The worker thread reads the second request into the same buffer before
+  // the first one is handled.
+  auto id1 = fuse_.sendLookup(FUSE_ROOT_ID, "foo");
+  auto id2 = fuse_.sendLookup(FUSE_ROOT_ID, "some_longer_name");
+  size_t handled = 0;
+  while (handled < 2) {
+    pool->wait();
+    handled += pool->run();
+  }
+
+  auto req1 = dispatcher_.waitForLookup(id1);
+  auto req2 = dispatcher_.waitForLookup(id2);
+  EXPECT_EQ("foo", req1.name.stringPiece());
+  EXPECT_EQ("some_longer_name", req2.name.stringPiece());
+
+  req1.promise.setValue(genRandomLookupResponse(5));
+  EXPECT_EQ(id1, fuse_.recvResponse().header.unique);
+  req2.promise.setValue(genRandomLookupResponse(6));
+  EXPECT_EQ(id2, fuse_.recvResponse().header.unique);
+}
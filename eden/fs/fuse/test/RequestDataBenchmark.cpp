@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <benchmark/benchmark.h>
+#include <folly/io/async/Request.h>
+#include "eden/fs/fuse/RequestData.h"
+
+using namespace facebook::eden;
+
+static void RequestData_create_and_destroy(benchmark::State& state) {
+  fuse_in_header header{};
+  header.opcode = FUSE_GETATTR;
+  for (auto _ : state) {
+    folly::RequestContextScopeGuard guard;
+    benchmark::DoNotOptimize(&RequestData::create(nullptr, header, nullptr));
+  }
+}
+BENCHMARK(RequestData_create_and_destroy);
+
+static void RequestData_create_and_destroy_from_multiple_threads(
+    benchmark::State& state) {
+  fuse_in_header header{};
+  header.opcode = FUSE_GETATTR;
+  for (auto _ : state) {
+    folly::RequestContextScopeGuard guard;
+    benchmark::DoNotOptimize(&RequestData::create(nullptr, header, nullptr));
+  }
+}
+BENCHMARK(RequestData_create_and_destroy_from_multiple_threads)->Threads(8);
+
+BENCHMARK_MAIN();
@@ -13,11 +13,9 @@
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeBase.h"
 #include "eden/fs/inodes/TreeInode.h"
-#include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/TreeEntry.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
-#include "eden/fs/store/ObjectStore.h"
 
 using folly::exception_wrapper;
 using folly::Future;
@@ -105,9 +103,14 @@ class CheckoutAction::LoadingRefcount {
   CheckoutAction* action_;
 };
 
-Future<InvalidationRequired> CheckoutAction::run(
-    CheckoutContext* ctx,
-    ObjectStore* store) {
+std::optional<Hash> CheckoutAction::getNewBlobHash() const {
+  if (!newScmEntry_.has_value() || newScmEntry_->isTree()) {
+    return std::nullopt;
+  }
+  return newScmEntry_->getHash();
+}
+
+Future<InvalidationRequired> CheckoutAction::run(CheckoutContext* ctx) {
   // Immediately create one LoadingRefcount, to ensure that our
   // numLoadsPending_ refcount does not drop to 0 until after we have started
   // all required load operations.
@@ -117,10 +120,11 @@ Future<InvalidationRequired> CheckoutAction::run(
   LoadingRefcount refcount{this};
 
   try {
-    // Load the Blob or Tree for the old TreeEntry.
+    // Load the Tree for the old TreeEntry.  Files are compared by hash in
+    // hasConflict(), without loading their contents.
     if (oldScmEntry_.has_value()) {
       if (oldScmEntry_.value().isTree()) {
-        store->getTree(oldScmEntry_.value().getHash(), ctx->getFetchContext())
+        ctx->getTree(oldScmEntry_.value().getHash())
             .thenValue([rc = LoadingRefcount(this)](
                            std::shared_ptr<const Tree> oldTree) {
               rc->setOldTree(std::move(oldTree));
@@ -129,24 +133,15 @@ Future<InvalidationRequired> CheckoutAction::run(
                 [rc = LoadingRefcount(this)](const exception_wrapper& ew) {
                   rc->error("error getting old tree", ew);
                 });
-      } else {
-        store->getBlob(oldScmEntry_.value().getHash(), ctx->getFetchContext())
-            .thenValue([rc = LoadingRefcount(this)](
-                           std::shared_ptr<const Blob> oldBlob) {
-              rc->setOldBlob(std::move(oldBlob));
-            })
-            .thenError(
-                [rc = LoadingRefcount(this)](const exception_wrapper& ew) {
-                  rc->error("error getting old blob", ew);
-                });
       }
     }
 
-    // If we have a new TreeEntry, load the corresponding Blob or Tree
+    // If we have a new TreeEntry, load the corresponding Tree.  A new file
+    // only needs its hash, from newScmEntry_.
     if (newScmEntry_.has_value()) {
       const auto& newEntry = newScmEntry_.value();
       if (newEntry.isTree()) {
-        store->getTree(newEntry.getHash(), ctx->getFetchContext())
+        ctx->getTree(newEntry.getHash())
             .thenValue([rc = LoadingRefcount(this)](
                            std::shared_ptr<const Tree> newTree) {
               rc->setNewTree(std::move(newTree));
@@ -155,16 +150,6 @@ Future<InvalidationRequired> CheckoutAction::run(
                 [rc = LoadingRefcount(this)](const exception_wrapper& ew) {
                   rc->error("error getting new tree", ew);
                 });
-      } else {
-        store->getBlob(newEntry.getHash(), ctx->getFetchContext())
-            .thenValue([rc = LoadingRefcount(this)](
-                           std::shared_ptr<const Blob> newBlob) {
-              rc->setNewBlob(std::move(newBlob));
-            })
-            .thenError(
-                [rc = LoadingRefcount(this)](const exception_wrapper& ew) {
-                  rc->error("error getting new blob", ew);
-                });
       }
     }
 
@@ -189,28 +174,14 @@ Future<InvalidationRequired> CheckoutAction::run(
 
 void CheckoutAction::setOldTree(std::shared_ptr<const Tree> tree) {
   CHECK(!oldTree_);
-  CHECK(!oldBlob_);
   oldTree_ = std::move(tree);
 }
 
-void CheckoutAction::setOldBlob(std::shared_ptr<const Blob> blob) {
-  CHECK(!oldTree_);
-  CHECK(!oldBlob_);
-  oldBlob_ = std::move(blob);
-}
-
 void CheckoutAction::setNewTree(std::shared_ptr<const Tree> tree) {
   CHECK(!newTree_);
-  CHECK(!newBlob_);
   newTree_ = std::move(tree);
 }
 
-void CheckoutAction::setNewBlob(std::shared_ptr<const Blob> blob) {
-  CHECK(!newTree_);
-  CHECK(!newBlob_);
-  newBlob_ = std::move(blob);
-}
-
 void CheckoutAction::setInode(InodePtr inode) {
   CHECK(!inode_);
   inode_ = std::move(inode);
@@ -260,12 +231,12 @@ bool CheckoutAction::ensureDataReady() noexcept {
   // Make sure we actually have all the data we need.
   // (Just in case something went wrong when wiring up the callbacks in such a
   // way that we also failed to call error().)
-  if (oldScmEntry_.has_value() && (!oldTree_ && !oldBlob_)) {
+  if (oldScmEntry_.has_value() && oldScmEntry_->isTree() && !oldTree_) {
     promise_.setException(
         std::runtime_error("failed to load data for old TreeEntry"));
     return false;
   }
-  if (newScmEntry_.has_value() && (!newTree_ && !newBlob_)) {
+  if (newScmEntry_.has_value() && newScmEntry_->isTree() && !newTree_) {
     promise_.setException(
         std::runtime_error("failed to load data for new TreeEntry"));
     return false;
@@ -333,7 +304,7 @@ Future<bool> CheckoutAction::hasConflict() {
     // conflicts for individual leaf inodes that were modified, and not for the
     // parent directories.
     return false;
-  } else if (oldBlob_) {
+  } else if (oldScmEntry_.has_value()) {
     auto fileInode = inode_.asFilePtrOrNull();
     if (!fileInode) {
       // This was a file, but has been replaced with a directory on disk
@@ -341,10 +312,14 @@ Future<bool> CheckoutAction::hasConflict() {
       return true;
     }
 
-    // Check that the file contents are the same as the old source control entry
+    // Check that the file contents are the same as the old source control
+    // entry.  This compares blob hashes, or else the file's SHA-1 with the
+    // one in the blob's metadata, so the old contents are never fetched.
     return fileInode
         ->isSameAs(
-            *oldBlob_, oldScmEntry_.value().getType(), ctx_->getFetchContext())
+            oldScmEntry_->getHash(),
+            oldScmEntry_->getType(),
+            ctx_->getFetchContext())
         .thenValue([this](bool isSame) {
           if (isSame) {
             // no conflict
@@ -364,8 +339,7 @@ Future<bool> CheckoutAction::hasConflict() {
         });
   }
 
-  DCHECK(!oldScmEntry_) << "Both oldTree_ and oldBlob_ are nullptr, "
-                           "so this file should not have an oldScmEntry_.";
+  DCHECK(!oldScmEntry_) << "There is no oldScmEntry_ for this file.";
   DCHECK(newScmEntry_) << "If there is no oldScmEntry_, then there must be a "
                           "newScmEntry_.";
 
@@ -22,9 +22,7 @@ class exception_wrapper;
 namespace facebook {
 namespace eden {
 
-class Blob;
 class CheckoutContext;
-class ObjectStore;
 class Tree;
 
 /**
@@ -89,6 +87,12 @@ class CheckoutAction {
 
   PathComponentPiece getEntryName() const;
 
+  /**
+   * Returns the hash of the blob for the new source control entry, if it is a
+   * file.  run() does not fetch it.
+   */
+  std::optional<Hash> getNewBlobHash() const;
+
   /**
    * Run the CheckoutAction.
    *
@@ -98,8 +102,7 @@ class CheckoutAction {
    * cache in the kernel.
    */
   FOLLY_NODISCARD folly::Future<InvalidationRequired> run(
-      CheckoutContext* ctx,
-      ObjectStore* store);
+      CheckoutContext* ctx);
 
  private:
   class LoadingRefcount;
@@ -115,9 +118,7 @@ class CheckoutAction {
       folly::Future<InodePtr> inodeFuture);
 
   void setOldTree(std::shared_ptr<const Tree> tree);
-  void setOldBlob(std::shared_ptr<const Blob> blob);
   void setNewTree(std::shared_ptr<const Tree> tree);
-  void setNewBlob(std::shared_ptr<const Blob> blob);
   void setInode(InodePtr inode);
   void error(folly::StringPiece msg, const folly::exception_wrapper& ew);
 
@@ -170,18 +171,13 @@ class CheckoutAction {
   /*
    * Data that we have to load to perform the checkout action.
    *
-   * Only one each oldTree_ and oldBlob_ will be loaded,
-   * and the same goes for newTree_ and newBlob_.
-   *
-   * TODO: We don't actually ever need the data from new blob.  If the
-   * destination entry is a blob we could just record this fact, and not bother
-   * loading the blob data itself.
+   * Trees are only loaded for entries that are directories.  Files are
+   * checked for conflicts and replaced using only their hashes, so their
+   * blobs are never loaded.
    */
   InodePtr inode_;
   std::shared_ptr<const Tree> oldTree_;
-  std::shared_ptr<const Blob> oldBlob_;
   std::shared_ptr<const Tree> newTree_;
-  std::shared_ptr<const Blob> newBlob_;
 
   /**
    * The errors vector keeps track of any errors that occurred while trying to
@@ -13,6 +13,8 @@
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/store/ObjectStore.h"
 
 using folly::Future;
 using std::vector;
@@ -25,13 +27,15 @@ CheckoutContext::CheckoutContext(
     folly::Synchronized<EdenMount::ParentInfo>::LockedPtr&& parentsLock,
     CheckoutMode checkoutMode,
     std::optional<pid_t> clientPid,
-    folly::StringPiece thriftMethodName)
+    folly::StringPiece thriftMethodName,
+    size_t maxPendingFetches)
     : checkoutMode_{checkoutMode},
       mount_{mount},
       parentsLock_(std::move(parentsLock)),
       fetchContext_{clientPid,
                     ObjectFetchContext::Cause::Thrift,
-                    thriftMethodName} {}
+                    thriftMethodName},
+      fetchThrottle_{maxPendingFetches} {}
 
 CheckoutContext::~CheckoutContext() {}
 
@@ -74,6 +78,20 @@ Future<vector<CheckoutConflict>> CheckoutContext::finish(Hash newSnapshot) {
       return std::move(*conflicts_.wlock());
     });
   }
+#else
+  // Bring Projected FS up to date with every entry the checkout changed
+  // before another checkout may start.
+  auto* fsChannel = mount_->getFsChannel();
+  auto updates = std::move(*cachedFileUpdates_.wlock());
+  if (!isDryRun() && fsChannel && !updates.empty()) {
+    XLOG(DBG4) << "updating " << updates.size() << " cached files";
+    return fsChannel->updateCachedFiles(std::move(updates))
+        .thenValue([this](auto&&) {
+          XLOG(DBG4) << "finished updating cached files";
+          parentsLock_.unlock();
+          return std::move(*conflicts_.wlock());
+        });
+  }
 #endif
 
   // Release the parentsLock_.
@@ -85,6 +103,44 @@ Future<vector<CheckoutConflict>> CheckoutContext::finish(Hash newSnapshot) {
   return std::move(*conflicts_.wlock());
 }
 
+Future<std::shared_ptr<const Tree>> CheckoutContext::getTree(
+    const Hash& hash) {
+  return fetchThrottle_.run<std::shared_ptr<const Tree>>(
+      /*isTree=*/true, [this, hash] {
+        return mount_->getObjectStore()->getTree(hash, fetchContext_);
+      });
+}
+
+Future<folly::Unit> CheckoutContext::prefetchBlobs(std::vector<Hash> hashes) {
+  return fetchThrottle_.run<folly::Unit>(
+      /*isTree=*/false, [this, hashes = std::move(hashes)] {
+        return mount_->getObjectStore()->prefetchBlobs(hashes, fetchContext_);
+      });
+}
+
+#ifdef _WIN32
+void CheckoutContext::queueCachedFileUpdate(
+    RelativePath path,
+    const TreeEntry* newEntry) {
+  FsChannel::CachedFileUpdate update;
+  update.path = std::move(path);
+  if (newEntry) {
+    update.hash = newEntry->getHash();
+    update.isDirectory = newEntry->isTree();
+  }
+  cachedFileUpdates_.wlock()->push_back(std::move(update));
+}
+#endif
+
+CheckoutProgressInfo CheckoutContext::getProgress() const {
+  CheckoutProgressInfo progress;
+  *progress.checkoutInProgress_ref() = true;
+  *progress.treesProcessed_ref() =
+      treesProcessed_.load(std::memory_order_relaxed);
+  *progress.filesUpdated_ref() = filesUpdated_.load(std::memory_order_relaxed);
+  return progress;
+}
+
 void CheckoutContext::addConflict(ConflictType type, RelativePathPiece path) {
   // Errors should be added using addError()
   CHECK(type != ConflictType::ERROR)
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include <folly/Range.h>
@@ -16,9 +17,14 @@
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodePtrFwd.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
+#include "eden/fs/store/FetchThrottle.h"
 #include "eden/fs/store/StatsFetchContext.h"
 #include "eden/fs/utils/PathFuncs.h"
 
+#ifdef _WIN32
+#include "eden/fs/win/mount/FsChannel.h" // @manual
+#endif
+
 namespace folly {
 class exception_wrapper;
 template <typename T>
@@ -32,6 +38,7 @@ namespace eden {
 class CheckoutConflict;
 class TreeInode;
 class Tree;
+class TreeEntry;
 
 /**
  * CheckoutContext maintains state during a checkout operation.
@@ -43,7 +50,8 @@ class CheckoutContext {
       folly::Synchronized<EdenMount::ParentInfo>::LockedPtr&& parentsLock,
       CheckoutMode checkoutMode,
       std::optional<pid_t> clientPid,
-      folly::StringPiece thriftMethodName);
+      folly::StringPiece thriftMethodName,
+      size_t maxPendingFetches = 0);
   ~CheckoutContext();
 
   /**
@@ -111,17 +119,74 @@ class CheckoutContext {
     return fetchContext_;
   }
 
+  /**
+   * Fetch a tree needed by the checkout from the object store.
+   *
+   * At most maxPendingFetches fetches are in flight at once, and queued trees
+   * are fetched before queued blobs, so that the checkout discovers the
+   * directories it has to update before it starts on their files. See
+   * FetchThrottle.
+   */
+  folly::Future<std::shared_ptr<const Tree>> getTree(const Hash& hash);
+
+  /**
+   * Fetch the given blobs from the backing store in one batch, so that they
+   * are cached locally when next read.  The batch counts as a single fetch
+   * against maxPendingFetches.
+   */
+  folly::Future<folly::Unit> prefetchBlobs(std::vector<Hash> hashes);
+
+  /** Called when the checkout has finished updating a directory. */
+  void treeProcessed() {
+    treesProcessed_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Called when the checkout adds, removes or replaces an entry. A directory
+   * that is replaced without being loaded counts as a single entry.
+   */
+  void fileUpdated() {
+    filesUpdated_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns how far the checkout has got so far. This may be called from any
+   * thread while the checkout is running.
+   */
+  CheckoutProgressInfo getProgress() const;
+
+#ifdef _WIN32
+  /**
+   * Record that the checkout changed the entry at path. newEntry is its new
+   * source control state, or nullptr if it was removed.
+   *
+   * Rather than updating Projected FS one entry at a time, with the
+   * directory being checked out locked, finish() hands all of the changes to
+   * FsChannel::updateCachedFiles() at once.
+   */
+  void queueCachedFileUpdate(RelativePath path, const TreeEntry* newEntry);
+#endif
+
  private:
   CheckoutMode checkoutMode_;
   EdenMount* const mount_;
   folly::Synchronized<EdenMount::ParentInfo>::LockedPtr parentsLock_;
   RenameLock renameLock_;
   StatsFetchContext fetchContext_;
+  FetchThrottle fetchThrottle_;
+
+  std::atomic<uint64_t> treesProcessed_{0};
+  std::atomic<uint64_t> filesUpdated_{0};
 
   // The checkout processing may occur across many threads,
   // if some data load operations complete asynchronously on other threads.
   // Therefore access to the conflicts list must be synchronized.
   folly::Synchronized<std::vector<CheckoutConflict>> conflicts_;
+
+#ifdef _WIN32
+  folly::Synchronized<std::vector<FsChannel::CachedFileUpdate>>
+      cachedFileUpdates_;
+#endif
 };
 } // namespace eden
 } // namespace facebook
@@ -190,8 +190,7 @@ class ModifiedDiffEntry : public DeferredDiffEntry {
     }
 
     // Possibly modified directory.  Load the Tree in question.
-    return context_->store
-        ->getTree(scmEntry_.getHash(), context_->getFetchContext())
+    return context_->getTree(scmEntry_.getHash())
         .thenValue([this, treeInode = std::move(treeInode)](
                        shared_ptr<const Tree>&& tree) {
           return treeInode->diff(
@@ -248,10 +247,8 @@ class ModifiedBlobDiffEntry : public DeferredDiffEntry {
         currentBlobHash_{currentBlobHash} {}
 
   folly::Future<folly::Unit> run() override {
-    auto f1 = context_->store->getBlobSha1(
-        scmEntry_.getHash(), context_->getFetchContext());
-    auto f2 = context_->store->getBlobSha1(
-        currentBlobHash_, context_->getFetchContext());
+    auto f1 = context_->getBlobSha1(scmEntry_.getHash());
+    auto f2 = context_->getBlobSha1(currentBlobHash_);
     return collectSafe(f1, f2).thenValue(
         [this](const std::tuple<Hash, Hash>& info) {
           const auto& [info1, info2] = info;
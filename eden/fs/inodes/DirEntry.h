@@ -10,8 +10,8 @@
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/ChunkedPathMap.h"
 #include "eden/fs/utils/DirType.h"
-#include "eden/fs/utils/PathMap.h"
 
 namespace facebook {
 namespace eden {
@@ -235,8 +235,12 @@ static_assert(sizeof(DirEntry) == 32, "DirEntry is four words");
 
 /**
  * Represents a directory in the overlay.
+ *
+ * Entries are stored in sorted chunks so that creating and removing entries
+ * in directories with hundreds of thousands of children doesn't have to move
+ * every entry around.  Typical directories fit in a single chunk.
  */
-struct DirContents : PathMap<DirEntry> {};
+struct DirContents : ChunkedPathMap<DirEntry> {};
 
 } // namespace eden
 } // namespace facebook
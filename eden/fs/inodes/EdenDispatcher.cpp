@@ -13,12 +13,14 @@
 #include <cstring>
 #include <shared_mutex>
 
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/fuse/DirList.h"
 #include "eden/fs/fuse/RequestData.h"
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeMap.h"
 #include "eden/fs/inodes/Overlay.h"
+#include "eden/fs/inodes/ServerState.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/utils/SystemError.h"
@@ -65,16 +67,93 @@ Dispatcher::Attr attrForInodeWithCorruptOverlay(InodeNumber ino) noexcept {
   st.st_mode = S_IFREG;
   return Dispatcher::Attr{st, kBrokenInodeCacheSeconds};
 }
+
+/**
+ * Nothing but a checkout changes an inode that is identical to source
+ * control, and checkout invalidates the kernel's cache of the inodes it
+ * changes, so the kernel may cache their attributes and entries
+ * indefinitely.  Materialized inodes are only cached for materializedTimeout.
+ */
+Dispatcher::Attr makeAttr(
+    const InodePtr& inode,
+    const struct stat& st,
+    std::chrono::nanoseconds materializedTimeout) {
+  bool materialized;
+  if (auto* file = inode.asFileOrNull()) {
+    materialized = !file->getBlobHash().has_value();
+  } else {
+    materialized =
+        inode.asTreeOrNull()->getContents().rlock()->isMaterialized();
+  }
+  if (!materialized) {
+    return Dispatcher::Attr{st};
+  }
+  return Dispatcher::Attr{
+      st,
+      static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::seconds>(materializedTimeout)
+              .count())};
+}
+
+folly::Future<fuse_entry_out> lookupChildInode(
+    const TreeInodePtr& tree,
+    PathComponentPiece name,
+    std::chrono::nanoseconds materializedTimeout,
+    ObjectFetchContext& context) {
+  return tree->getOrLoadChild(name).thenValue(
+      [materializedTimeout, &context](const InodePtr& inode) {
+        return folly::makeFutureWith([&]() { return inode->stat(context); })
+            .thenTry([inode, materializedTimeout](
+                         folly::Try<struct stat> maybeStat) {
+              if (maybeStat.hasValue()) {
+                inode->incFuseRefcount();
+                return computeEntryParam(
+                    makeAttr(inode, maybeStat.value(), materializedTimeout));
+              } else {
+                // The most common case for stat() failing is if this file is
+                // materialized but the data for it in the overlay is missing
+                // or corrupt.  This can happen after a hard reboot where the
+                // overlay data was not synced to disk first.
+                //
+                // We intentionally want to return a result here rather than
+                // failing; otherwise we can't return the inode number to the
+                // kernel at all.  This blocks other operations on the file,
+                // like FUSE_UNLINK.  By successfully returning from the
+                // lookup we allow clients to remove this corrupt file with an
+                // unlink operation.  (Even though FUSE_UNLINK does not require
+                // the child inode number, the kernel does not appear to send a
+                // FUSE_UNLINK request to us if it could not get the child inode
+                // number first.)
+                XLOG(WARN) << "error getting attributes for inode "
+                           << inode->getNodeId() << " (" << inode->getLogPath()
+                           << "): " << maybeStat.exception().what();
+                inode->incFuseRefcount();
+                return computeEntryParam(
+                    attrForInodeWithCorruptOverlay(inode->getNodeId()));
+              }
+            });
+      });
+}
 } // namespace
 
+std::chrono::nanoseconds EdenDispatcher::getMaterializedAttrTimeout() const {
+  return mount_->getServerState()
+      ->getEdenConfig(ConfigReloadBehavior::NoReload)
+      ->fuseMaterializedAttrTimeout.getValue();
+}
+
 folly::Future<Dispatcher::Attr> EdenDispatcher::getattr(
     InodeNumber ino,
     ObjectFetchContext& context) {
   FB_LOGF(mount_->getStraceLogger(), DBG7, "getattr({})", ino);
-  return inodeMap_->lookupInode(ino)
-      .thenValue(
-          [&context](const InodePtr& inode) { return inode->stat(context); })
-      .thenValue([](const struct stat& st) { return Dispatcher::Attr{st}; });
+  return inodeMap_->lookupInode(ino).thenValue(
+      [materializedTimeout = getMaterializedAttrTimeout(),
+       &context](const InodePtr& inode) {
+        return inode->stat(context).thenValue(
+            [inode, materializedTimeout](const struct stat& st) {
+              return makeAttr(inode, st, materializedTimeout);
+            });
+      });
 }
 
 folly::Future<uint64_t> EdenDispatcher::opendir(InodeNumber ino, int flags) {
@@ -105,38 +184,33 @@ folly::Future<fuse_entry_out> EdenDispatcher::lookup(
     ObjectFetchContext& context) {
   FB_LOGF(mount_->getStraceLogger(), DBG7, "lookup({}, {})", parent, namepiece);
   return inodeMap_->lookupTreeInode(parent)
-      .thenValue([name = PathComponent(namepiece)](const TreeInodePtr& tree) {
-        return tree->getOrLoadChild(name);
-      })
-      .thenValue([&context](const InodePtr& inode) {
-        return folly::makeFutureWith([&]() { return inode->stat(context); })
-            .thenTry([inode](folly::Try<struct stat> maybeStat) {
-              if (maybeStat.hasValue()) {
-                inode->incFuseRefcount();
-                return computeEntryParam(Dispatcher::Attr{maybeStat.value()});
-              } else {
-                // The most common case for stat() failing is if this file is
-                // materialized but the data for it in the overlay is missing
-                // or corrupt.  This can happen after a hard reboot where the
-                // overlay data was not synced to disk first.
-                //
-                // We intentionally want to return a result here rather than
-                // failing; otherwise we can't return the inode number to the
-                // kernel at all.  This blocks other operations on the file,
-                // like FUSE_UNLINK.  By successfully returning from the
-                // lookup we allow clients to remove this corrupt file with an
-                // unlink operation.  (Even though FUSE_UNLINK does not require
-                // the child inode number, the kernel does not appear to send a
-                // FUSE_UNLINK request to us if it could not get the child inode
-                // number first.)
-                XLOG(WARN) << "error getting attributes for inode "
-                           << inode->getNodeId() << " (" << inode->getLogPath()
-                           << "): " << maybeStat.exception().what();
-                inode->incFuseRefcount();
+      .thenValue([name = PathComponent(namepiece),
+                  stats = &mount_->getDirectoryAccessStats(),
+                  materializedTimeout = getMaterializedAttrTimeout(),
+                  &context](const TreeInodePtr& tree) {
+        stats->record(DirectoryAccessStats::AccessType::Lookup, [&] {
+          return tree->getPath();
+        });
+        // Scans like `find -ls` look up every file in the tree, so answer
+        // for unloaded files without creating a FileInode for each of them.
+        if (auto child = tree->statUnloadedChildForLookup(name, context)) {
+          return std::move(child->second)
+              .thenTry([number = child->first](
+                           folly::Try<struct stat> maybeStat) {
+                if (maybeStat.hasValue()) {
+                  // The child is not materialized.
+                  return computeEntryParam(
+                      Dispatcher::Attr{maybeStat.value()});
+                }
+                // As in lookupChildInode(), the kernel still needs the inode
+                // number.
+                XLOG(WARN) << "error getting attributes for inode " << number
+                           << ": " << maybeStat.exception().what();
                 return computeEntryParam(
-                    attrForInodeWithCorruptOverlay(inode->getNodeId()));
-              }
-            });
+                    attrForInodeWithCorruptOverlay(number));
+              });
+        }
+        return lookupChildInode(tree, name, materializedTimeout, context);
       })
       .thenError(
           folly::tag_t<std::system_error>{}, [](const std::system_error& err) {
@@ -170,7 +244,13 @@ folly::Future<Dispatcher::Attr> EdenDispatcher::setattr(
   }
 
   return inodeMap_->lookupInode(ino).thenValue(
-      [attr](const InodePtr& inode) { return inode->setattr(attr); });
+      [attr, materializedTimeout = getMaterializedAttrTimeout()](
+          const InodePtr& inode) {
+        return inode->setattr(attr).thenValue(
+            [inode, materializedTimeout](const Dispatcher::Attr& result) {
+              return makeAttr(inode, result.st, materializedTimeout);
+            });
+      });
 }
 
 void EdenDispatcher::forget(InodeNumber ino, unsigned long nlookup) {
@@ -208,14 +288,17 @@ folly::Future<fuse_entry_out> EdenDispatcher::create(
   // (and thus can be zero)
   mode = S_IFREG | (07777 & mode);
   return inodeMap_->lookupTreeInode(parent).thenValue(
-      [=](const TreeInodePtr& inode) {
+      [=, materializedTimeout = getMaterializedAttrTimeout()](
+          const TreeInodePtr& inode) {
         auto childName = PathComponent{name};
         auto child = inode->mknod(childName, mode, 0, InvalidationRequired::No);
         return child->stat(ObjectFetchContext::getNullContext())
-            .thenValue([child](struct stat st) -> fuse_entry_out {
-              child->incFuseRefcount();
-              return computeEntryParam(Dispatcher::Attr{st});
-            });
+            .thenValue(
+                [child, materializedTimeout](struct stat st) -> fuse_entry_out {
+                  child->incFuseRefcount();
+                  return computeEntryParam(
+                      makeAttr(child, st, materializedTimeout));
+                });
       });
 }
 
@@ -232,7 +315,11 @@ folly::Future<BufVec> EdenDispatcher::read(
       off,
       size);
   return inodeMap_->lookupFileInode(ino).thenValue(
-      [&context, size, off](FileInodePtr&& inode) {
+      [&context, size, off, stats = &mount_->getDirectoryAccessStats()](
+          FileInodePtr&& inode) {
+        stats->record(DirectoryAccessStats::AccessType::Read, [&] {
+          return DirectoryAccessStats::parentOf(inode->getPath());
+        });
         return inode->read(size, off, context);
       });
 }
@@ -308,6 +395,64 @@ folly::Future<DirList> EdenDispatcher::readdir(
       });
 }
 
+folly::Future<DirList> EdenDispatcher::readdirplus(
+    InodeNumber ino,
+    DirList&& dirList,
+    off_t offset,
+    uint64_t /*fh*/,
+    ObjectFetchContext& context) {
+  FB_LOGF(mount_->getStraceLogger(), DBG7, "readdirplus({}, {})", ino, offset);
+  return inodeMap_->lookupTreeInode(ino).thenValue(
+      [dirList = std::move(dirList),
+       offset,
+       materializedTimeout = getMaterializedAttrTimeout(),
+       &context](TreeInodePtr inode) mutable {
+        auto list = inode->readdir(std::move(dirList), offset, context);
+
+        // Look up and stat every listed child in parallel, as lookup() would.
+        // Entries that fail (for example because they were removed or
+        // renamed in the meantime) are sent without attributes, which makes
+        // the kernel fall back to a regular lookup for them.
+        std::vector<folly::Future<std::optional<fuse_entry_out>>> futures;
+        for (auto& entry : list.extract()) {
+          if (entry.name == "." || entry.name == "..") {
+            // The kernel ignores the attributes of these entries.
+            futures.push_back(
+                folly::makeFuture(std::optional<fuse_entry_out>{}));
+            continue;
+          }
+          futures.push_back(
+              inode->getOrLoadChild(PathComponentPiece{entry.name})
+                  .thenValue([&context,
+                              materializedTimeout,
+                              number = entry.inode](const InodePtr& child) {
+                    if (child->getNodeId().get() != number) {
+                      return folly::makeFuture(std::optional<fuse_entry_out>{});
+                    }
+                    return child->stat(context).thenValue(
+                        [child, materializedTimeout](struct stat st) {
+                          child->incFuseRefcount();
+                          return std::make_optional(computeEntryParam(
+                              makeAttr(child, st, materializedTimeout)));
+                        });
+                  })
+                  .thenError([](const folly::exception_wrapper&) {
+                    return std::optional<fuse_entry_out>{};
+                  }));
+        }
+
+        return folly::collectAllUnsafe(std::move(futures))
+            .thenValue([list = std::move(list)](auto&& entries) mutable {
+              for (size_t i = 0; i < entries.size(); ++i) {
+                if (entries[i].hasValue() && entries[i].value()) {
+                  list.setEntry(i, *entries[i].value());
+                }
+              }
+              return std::move(list);
+            });
+      });
+}
+
 folly::Future<fuse_entry_out> EdenDispatcher::mknod(
     InodeNumber parent,
     PathComponentPiece name,
@@ -322,14 +467,20 @@ folly::Future<fuse_entry_out> EdenDispatcher::mknod(
       mode,
       rdev);
   return inodeMap_->lookupTreeInode(parent).thenValue(
-      [childName = PathComponent{name}, mode, rdev](const TreeInodePtr& inode) {
+      [childName = PathComponent{name},
+       mode,
+       rdev,
+       materializedTimeout =
+           getMaterializedAttrTimeout()](const TreeInodePtr& inode) {
         auto child =
             inode->mknod(childName, mode, rdev, InvalidationRequired::No);
         return child->stat(ObjectFetchContext::getNullContext())
-            .thenValue([child](struct stat st) -> fuse_entry_out {
-              child->incFuseRefcount();
-              return computeEntryParam(Dispatcher::Attr{st});
-            });
+            .thenValue(
+                [child, materializedTimeout](struct stat st) -> fuse_entry_out {
+                  child->incFuseRefcount();
+                  return computeEntryParam(
+                      makeAttr(child, st, materializedTimeout));
+                });
       });
 }
 
@@ -345,12 +496,16 @@ folly::Future<fuse_entry_out> EdenDispatcher::mkdir(
       name,
       mode);
   return inodeMap_->lookupTreeInode(parent).thenValue(
-      [childName = PathComponent{name}, mode](const TreeInodePtr& inode) {
+      [childName = PathComponent{name},
+       mode,
+       materializedTimeout =
+           getMaterializedAttrTimeout()](const TreeInodePtr& inode) {
         auto child = inode->mkdir(childName, mode, InvalidationRequired::No);
         return child->stat(ObjectFetchContext::getNullContext())
-            .thenValue([child](struct stat st) {
+            .thenValue([child, materializedTimeout](struct stat st) {
               child->incFuseRefcount();
-              return computeEntryParam(Dispatcher::Attr{st});
+              return computeEntryParam(
+                  makeAttr(child, st, materializedTimeout));
             });
       });
 }
@@ -390,13 +545,16 @@ folly::Future<fuse_entry_out> EdenDispatcher::symlink(
       link);
   return inodeMap_->lookupTreeInode(parent).thenValue(
       [linkContents = link.str(),
-       childName = PathComponent{name}](const TreeInodePtr& inode) {
+       childName = PathComponent{name},
+       materializedTimeout =
+           getMaterializedAttrTimeout()](const TreeInodePtr& inode) {
         auto symlinkInode =
             inode->symlink(childName, linkContents, InvalidationRequired::No);
         symlinkInode->incFuseRefcount();
         return symlinkInode->stat(ObjectFetchContext::getNullContext())
-            .thenValue([symlinkInode](struct stat st) {
-              return computeEntryParam(Dispatcher::Attr{st});
+            .thenValue([symlinkInode, materializedTimeout](struct stat st) {
+              return computeEntryParam(
+                  makeAttr(symlinkInode, st, materializedTimeout));
             });
       });
 }
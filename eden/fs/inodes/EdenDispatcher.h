@@ -6,6 +6,7 @@
  */
 
 #pragma once
+#include <chrono>
 #include "eden/fs/fuse/Dispatcher.h"
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/store/IObjectStore.h"
@@ -98,12 +99,23 @@ class EdenDispatcher : public Dispatcher {
       off_t offset,
       uint64_t fh,
       ObjectFetchContext& context) override;
+  folly::Future<DirList> readdirplus(
+      InodeNumber ino,
+      DirList&& dirList,
+      off_t offset,
+      uint64_t fh,
+      ObjectFetchContext& context) override;
 
   folly::Future<std::string> getxattr(InodeNumber ino, folly::StringPiece name)
       override;
   folly::Future<std::vector<std::string>> listxattr(InodeNumber ino) override;
 
  private:
+  /**
+   * The fuse:materialized-attr-timeout setting.
+   */
+  std::chrono::nanoseconds getMaterializedAttrTimeout() const;
+
   // The EdenMount that owns this EdenDispatcher.
   EdenMount* const mount_;
   // The EdenMount's InodeMap.
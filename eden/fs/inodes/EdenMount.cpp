@@ -19,6 +19,7 @@
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
 #include <gflags/gflags.h>
+#include <limits>
 
 #include "eden/fs/config/CheckoutConfig.h"
 #include "eden/fs/config/EdenConfig.h"
@@ -40,6 +41,7 @@
 #include "eden/fs/store/DiffContext.h"
 #include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/store/ScmStatusDiffCallback.h"
+#include "eden/fs/store/TreePrefetch.h"
 #include "eden/fs/telemetry/StructuredLogger.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/Clock.h"
@@ -68,7 +70,6 @@ using folly::Unit;
 using std::make_unique;
 using std::shared_ptr;
 
-DEFINE_int32(fuseNumThreads, 16, "how many fuse dispatcher threads to spawn");
 DEFINE_string(
     edenfsctlPath,
     "edenfsctl",
@@ -158,6 +159,7 @@ class EdenMount::JournalDiffCallback : public DiffCallback {
 
 constexpr int EdenMount::kMaxSymlinkChainDepth;
 static constexpr folly::StringPiece kEdenStracePrefix = "eden.strace.";
+static constexpr PathComponentPiece kIgnoreFilename{".gitignore"};
 
 // We compute this when the process is initialized, but stash a copy
 // in each EdenMount.  We may in the future manage to propagate enough
@@ -204,18 +206,44 @@ EdenMount::EdenMount(
       objectStore_{std::move(objectStore)},
       blobCache_{std::move(blobCache)},
       blobAccess_{objectStore_, blobCache_},
-      overlay_{Overlay::create(config_->getOverlayPath())},
+      directoryAccessStats_{
+          serverState_->getReloadableConfig()
+              .getEdenConfig()
+              ->directoryAccessSampleRate.getValue()},
+      inodePathCache_{serverState_->getReloadableConfig()
+                          .getEdenConfig()
+                          ->inodePathCacheSize.getValue()},
+      overlay_{Overlay::create(
+          config_->getOverlayPath(),
+          serverState_->getReloadableConfig()
+              .getEdenConfig()
+              ->overlayDirSaveDelay.getValue(),
+          config_->getOverlayType())},
 #ifndef _WIN32
       overlayFileAccess_{overlay_.get()},
 #endif
       journal_{std::move(journal)},
-      mountGeneration_{globalProcessGeneration | ++mountGeneration},
+      mountGeneration_{openJournalLog()},
       straceLogger_{kEdenStracePrefix.str() + config_->getMountPath().value()},
       lastCheckoutTime_{serverState_->getClock()->getRealtime()},
       owner_{Owner{getuid(), getgid()}},
       clock_{serverState_->getClock()} {
 }
 
+uint64_t EdenMount::openJournalLog() {
+  auto edenConfig = serverState_->getReloadableConfig().getEdenConfig();
+  if (edenConfig->persistJournal.getValue()) {
+    auto generation = journal_->openLog(
+        config_->getClientDirectory() + PathComponentPiece{"journal"},
+        edenConfig->journalLogDiskLimit.getValue());
+    if (generation) {
+      XLOG(DBG1) << "restored journal for " << getPath();
+      return *generation;
+    }
+  }
+  return globalProcessGeneration | ++mountGeneration;
+}
+
 FOLLY_NODISCARD folly::Future<folly::Unit> EdenMount::initialize(
     OverlayChecker::ProgressCallback&& progressCallback,
     const std::optional<SerializedInodeMap>& takeover) {
@@ -277,7 +305,10 @@ folly::Future<TreeInodePtr> EdenMount::createRootInode(
       ->getTreeForCommit(
           parentCommits.parent1(), ObjectFetchContext::getNullContext())
       .thenValue([this](std::shared_ptr<const Tree> tree) {
-        return TreeInodePtr::makeNew(this, std::move(tree));
+        return TreeInodePtr::makeNew(
+            this,
+            getCheckoutFilter().filterTree(
+                std::move(tree), RelativePathPiece{}));
       });
 }
 
@@ -601,6 +632,9 @@ folly::SemiFuture<SerializedInodeMap> EdenMount::shutdownImpl(bool doTakeover) {
         // the mount point.
         overlay_->close();
         XLOG(DBG1) << "successfully closed overlay at " << getPath();
+        // Like the overlay, the journal log must be complete before a new
+        // edenfs process takes over the mount and loads it.
+        journal_->closeLog(mountGeneration_);
         auto oldState =
             state_.exchange(State::SHUT_DOWN, std::memory_order_acq_rel);
         if (oldState == State::DESTROYING) {
@@ -650,6 +684,10 @@ folly::Future<folly::Unit> EdenMount::unmount() {
   });
 }
 
+const CheckoutFilter& EdenMount::getCheckoutFilter() const {
+  return config_->getFilter();
+}
+
 const shared_ptr<UnboundedQueueExecutor>& EdenMount::getThreadPool() const {
   return serverState_->getThreadPool();
 }
@@ -662,6 +700,58 @@ InodeMetadataTable* EdenMount::getInodeMetadataTable() const {
 FuseChannel* EdenMount::getFuseChannel() const {
   return channel_.get();
 }
+
+folly::Future<folly::Unit> EdenMount::populatePageCache(
+    const std::vector<RelativePath>& paths,
+    uint64_t maxBytes) {
+  auto remaining = std::make_shared<std::atomic<uint64_t>>(maxBytes);
+  auto& context = ObjectFetchContext::getNullContext();
+
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(paths.size());
+  for (const auto& path : paths) {
+    futures.push_back(
+        getInode(path)
+            .thenValue([this, remaining, &context](InodePtr inode) {
+              auto file = inode.asFilePtrOrNull();
+              if (!file || file->getType() != dtype_t::Regular ||
+                  !file->getBlobHash() || remaining->load() == 0) {
+                return makeFuture();
+              }
+              return file->stat(context).thenValue(
+                  [this, file, remaining, &context](
+                      struct stat st) -> folly::Future<folly::Unit> {
+                    auto size = static_cast<uint64_t>(st.st_size);
+                    auto available = remaining->load();
+                    do {
+                      if (size == 0 || size > available) {
+                        return folly::unit;
+                      }
+                    } while (!remaining->compare_exchange_weak(
+                        available, available - size));
+
+                    return file->readAll(context, CacheHint::NotNeededAgain)
+                        .thenValue([this, file](std::string contents) {
+                          // A write may have materialized the file while it
+                          // was being read, and then the kernel's pages are
+                          // newer than contents.
+                          if (!file->getBlobHash()) {
+                            return;
+                          }
+                          channel_->storeInode(
+                              file->getNodeId(),
+                              0,
+                              folly::IOBuf::copyBuffer(contents));
+                        });
+                  });
+            })
+            .thenError([path](folly::exception_wrapper&& ew) {
+              XLOG(DBG3) << "not populating the page cache for " << path
+                         << ": " << ew;
+            }));
+  }
+  return folly::collectAll(futures).unit();
+}
 #endif
 
 const AbsolutePath& EdenMount::getPath() const {
@@ -690,7 +780,24 @@ InodeNumber EdenMount::getDotEdenInodeNumber() const {
 #endif // !_WIN32
 
 Future<InodePtr> EdenMount::getInode(RelativePathPiece path) const {
-  return inodeMap_->getRootInode()->getChildRecursive(path);
+  if (auto number = inodePathCache_.get(path)) {
+    // The entry is only a hint: the inode may have been unloaded, or moved by
+    // a rename of one of its parents.
+    auto inode = inodeMap_->lookupLoadedInode(*number);
+    if (inode) {
+      auto inodePath = inode->getPath();
+      if (inodePath && *inodePath == path) {
+        return inode;
+      }
+    }
+    inodePathCache_.invalidate(path);
+  }
+
+  return inodeMap_->getRootInode()->getChildRecursive(path).thenValue(
+      [this, path = path.copy()](InodePtr inode) {
+        inodePathCache_.insert(path, inode->getNodeId());
+        return inode;
+      });
 }
 
 folly::Future<std::string> EdenMount::loadFileContentsFromPath(
@@ -836,7 +943,10 @@ folly::Future<CheckoutResult> EdenMount::checkout(
       std::move(parentsLock),
       checkoutMode,
       clientPid,
-      thriftMethodCaller);
+      thriftMethodCaller,
+      serverState_->getEdenConfig(ConfigReloadBehavior::NoReload)
+          ->maxCheckoutPendingFetches.getValue());
+  *currentCheckout_.wlock() = ctx;
   XLOG(DBG1) << "starting checkout for " << this->getPath() << ": "
              << oldParents << " to " << snapshotHash;
 
@@ -862,6 +972,9 @@ folly::Future<CheckoutResult> EdenMount::checkout(
                      std::tuple<shared_ptr<const Tree>, shared_ptr<const Tree>>
                          treeResults) {
         checkoutTimes->didLookupTrees = stopWatch.elapsed();
+        prefetchCheckoutTrees(
+            std::get<0>(treeResults), std::get<1>(treeResults));
+
         // Call JournalDiffCallback::performDiff() to compute the changes
         // between the original working directory state and the source
         // tree state.
@@ -889,28 +1002,6 @@ folly::Future<CheckoutResult> EdenMount::checkout(
         ctx->start(this->acquireRenameLock());
 
         checkoutTimes->didAcquireRenameLock = stopWatch.elapsed();
-#ifndef _WIN32
-
-        /**
-         * If a significant number of tree inodes are loaded or referenced
-         * by FUSE, then checkout is slow, because Eden must precisely
-         * manage changes to each one, as if the checkout was actually
-         * creating and removing files in each directory. If a tree is
-         * unloaded and unmodified, Eden can pretend the checkout
-         * operation blew away the entire subtree and assigned new inode
-         * numbers to everything under it, which is much cheaper.
-         *
-         * To make checkout faster, enumerate all loaded, unreferenced
-         * inodes and unload them, allowing checkout to use the fast path.
-         *
-         * Note that this will not unload any inodes currently referenced
-         * by FUSE, including the kernel's cache, so rapidly switching
-         * between commits while working should not be materially
-         * affected.
-         */
-        this->getRootInode()->unloadChildrenUnreferencedByFuse();
-
-#endif // !1
 
         auto rootInode = getRootInode();
         return serverState_->getFaultInjector()
@@ -1004,6 +1095,15 @@ folly::Future<CheckoutResult> EdenMount::checkout(
       });
 }
 
+CheckoutProgressInfo EdenMount::getCheckoutProgress() const {
+  if (auto ctx = currentCheckout_.rlock()->lock()) {
+    return ctx->getProgress();
+  }
+  CheckoutProgressInfo progress;
+  *progress.checkoutInProgress_ref() = false;
+  return progress;
+}
+
 #ifndef _WIN32
 folly::Future<folly::Unit> EdenMount::chown(uid_t uid, gid_t gid) {
   // 1) Ensure that all future opens will by default provide this owner
@@ -1054,13 +1154,19 @@ std::unique_ptr<DiffContext> EdenMount::createDiffContext(
     return loadFileContentsFromPath(
         fetchContext, path, CacheHint::LikelyNeededAgain);
   };
-  return make_unique<DiffContext>(
+  auto context = make_unique<DiffContext>(
       callback,
       listIgnored,
       getObjectStore(),
       serverState_->getTopLevelIgnores(),
       std::move(loadContents),
-      request);
+      request,
+      serverState_->getEdenConfig(ConfigReloadBehavior::NoReload)
+          ->maxDiffPendingFetches.getValue());
+  if (!getCheckoutFilter().empty()) {
+    context->setFilter(&getCheckoutFilter());
+  }
+  return context;
 }
 
 Future<Unit> EdenMount::diff(DiffContext* ctxPtr, Hash commitHash) const {
@@ -1077,6 +1183,36 @@ Future<Unit> EdenMount::diff(DiffContext* ctxPtr, Hash commitHash) const {
       });
 }
 
+Future<Unit> EdenMount::checkCurrentParent(const Hash& commitHash) const {
+  auto parentInfo = parentInfo_.rlock(std::chrono::milliseconds{500});
+
+  if (!parentInfo) {
+    // We failed to get the lock, which generally means a checkout is in
+    // progress.
+    return makeFuture<Unit>(newEdenError(
+        EdenErrorType::CHECKOUT_IN_PROGRESS,
+        "cannot compute status while a checkout is currently in progress"));
+  }
+
+  if (parentInfo->parents.parent1() != commitHash) {
+    // Log this occurrence to Scuba
+    getServerState()->getStructuredLogger()->logEvent(ParentMismatch{
+        commitHash.toString(), parentInfo->parents.parent1().toString()});
+    return makeFuture<Unit>(newEdenError(
+        EdenErrorType::OUT_OF_DATE_PARENT,
+        "error computing status: requested parent commit is out-of-date: requested ",
+        commitHash,
+        ", but current parent commit is ",
+        parentInfo->parents.parent1(),
+        ".\nTry running `eden doctor` to remediate"));
+  }
+
+  // TODO: Should we perhaps hold the parentInfo read-lock for the duration
+  // of the status operation?  This would block new checkout operations from
+  // starting until we have finished computing this status call.
+  return makeFuture();
+}
+
 Future<Unit> EdenMount::diff(
     DiffCallback* callback,
     Hash commitHash,
@@ -1084,32 +1220,10 @@ Future<Unit> EdenMount::diff(
     bool enforceCurrentParent,
     ResponseChannelRequest* request) const {
   if (enforceCurrentParent) {
-    auto parentInfo = parentInfo_.rlock(std::chrono::milliseconds{500});
-
-    if (!parentInfo) {
-      // We failed to get the lock, which generally means a checkout is in
-      // progress.
-      return makeFuture<Unit>(newEdenError(
-          EdenErrorType::CHECKOUT_IN_PROGRESS,
-          "cannot compute status while a checkout is currently in progress"));
-    }
-
-    if (parentInfo->parents.parent1() != commitHash) {
-      // Log this occurrence to Scuba
-      getServerState()->getStructuredLogger()->logEvent(ParentMismatch{
-          commitHash.toString(), parentInfo->parents.parent1().toString()});
-      return makeFuture<Unit>(newEdenError(
-          EdenErrorType::OUT_OF_DATE_PARENT,
-          "error computing status: requested parent commit is out-of-date: requested ",
-          commitHash,
-          ", but current parent commit is ",
-          parentInfo->parents.parent1(),
-          ".\nTry running `eden doctor` to remediate"));
+    auto parentCheck = checkCurrentParent(commitHash);
+    if (parentCheck.hasException()) {
+      return parentCheck;
     }
-
-    // TODO: Should we perhaps hold the parentInfo read-lock for the duration
-    // of the status operation?  This would block new checkout operations from
-    // starting until we have finished computing this status call.
   }
 
   // Create a DiffContext object for this diff operation.
@@ -1123,18 +1237,124 @@ Future<Unit> EdenMount::diff(
   return diff(ctxPtr, commitHash).ensure(std::move(stateHolder));
 }
 
+bool EdenMount::scopeDiffToChangesSince(
+    DiffContext& context,
+    JournalDelta::SequenceNumber sequence) const {
+  auto range = journal_->accumulateRange(sequence + 1);
+  if (!range) {
+    // Nothing has changed.
+    context.setScope({});
+    return true;
+  }
+  // A checkout changes files without recording each of them in the journal.
+  if (range->isTruncated || range->fromHash != range->toHash ||
+      !range->uncleanPaths.empty()) {
+    return false;
+  }
+
+  std::vector<RelativePath> paths;
+  paths.reserve(range->changedFilesInOverlay.size());
+  for (auto& entry : range->changedFilesInOverlay) {
+    const auto& path = entry.first;
+    if (path.basename() == kIgnoreFilename) {
+      // The ignore rules changed for the whole directory.
+      if (path.dirname().empty()) {
+        return false;
+      }
+      paths.emplace_back(path.dirname());
+    } else {
+      paths.push_back(path);
+    }
+  }
+  context.setScope(std::move(paths));
+  return true;
+}
+
 folly::Future<std::unique_ptr<ScmStatus>> EdenMount::diff(
     Hash commitHash,
     bool listIgnored,
     bool enforceCurrentParent,
     ResponseChannelRequest* request) {
+  if (enforceCurrentParent) {
+    auto parentCheck = checkCurrentParent(commitHash);
+    if (parentCheck.hasException()) {
+      return makeFuture<std::unique_ptr<ScmStatus>>(
+          std::move(parentCheck).getTry().exception());
+    }
+  }
+
   auto callback = std::make_unique<ScmStatusDiffCallback>();
-  auto callbackPtr = callback.get();
-  return this
-      ->diff(
-          callbackPtr, commitHash, listIgnored, enforceCurrentParent, request)
-      .thenValue([callback = std::move(callback)](auto&&) {
-        return std::make_unique<ScmStatus>(callback->extractStatus());
+  auto context = createDiffContext(callback.get(), listIgnored, request);
+  auto* ctxPtr = context.get();
+
+  // Record the journal position and the top-level ignores only once the
+  // context has loaded the ignore files, so that any change made after them
+  // is picked up by the next call.
+  auto latest = journal_->getLatest();
+  CachedStatus current;
+  current.commitHash = commitHash;
+  current.sequence = latest ? latest->sequenceID : 0;
+  current.ignoresGeneration = serverState_->getTopLevelIgnoresGeneration();
+
+  std::optional<CachedStatus> cached;
+  if (serverState_->getReloadableConfig()
+          .getEdenConfig()
+          ->incrementalStatus.getValue()) {
+    cached = (*statusCache_.rlock())[listIgnored];
+  }
+  if (cached &&
+      (cached->commitHash != commitHash ||
+       cached->ignoresGeneration != current.ignoresGeneration)) {
+    cached.reset();
+  }
+  if (cached) {
+    if (cached->sequence == current.sequence) {
+      XLOG(DBG4) << "status for " << getPath() << " is unchanged since "
+                 << "journal position " << cached->sequence;
+      return makeFuture(std::make_unique<ScmStatus>(*cached->status));
+    }
+    if (!scopeDiffToChangesSince(*ctxPtr, cached->sequence)) {
+      cached.reset();
+    }
+  }
+
+  return diff(ctxPtr, commitHash)
+      .thenValue([this,
+                  listIgnored,
+                  callback = std::move(callback),
+                  context = std::move(context),
+                  cached = std::move(cached),
+                  current = std::move(current)](auto&&) mutable {
+        auto status = callback->extractStatus();
+        if (cached) {
+          // Everything outside of the context's scope is unchanged since the
+          // cached status was computed.
+          ScmStatus merged;
+          for (const auto& entry : cached->status->get_entries()) {
+            if (!context->isWithinScope(RelativePathPiece{entry.first})) {
+              merged.entries_ref()->insert(entry);
+            }
+          }
+          for (auto& entry : *status.entries_ref()) {
+            if (context->isWithinScope(RelativePathPiece{entry.first})) {
+              merged.entries_ref()->insert(std::move(entry));
+            }
+          }
+          *merged.errors_ref() = std::move(*status.errors_ref());
+          status = std::move(merged);
+        }
+
+        // Errors may hide differences, so only cache complete results.
+        if (status.get_errors().empty()) {
+          current.status = std::make_shared<const ScmStatus>(status);
+          auto statusCache = statusCache_.wlock();
+          auto& slot = (*statusCache)[listIgnored];
+          if (!slot || slot->commitHash != current.commitHash ||
+              slot->sequence <= current.sequence) {
+            slot = std::move(current);
+          }
+        }
+        return std::make_unique<ScmStatus>(std::move(status));
       });
 }
 
@@ -1183,6 +1403,10 @@ std::string EdenMount::getCounterName(CounterName name) {
       return folly::to<std::string>("inodemap.", base, ".loaded");
     case CounterName::INODEMAP_UNLOADED:
       return folly::to<std::string>("inodemap.", base, ".unloaded");
+    case CounterName::INODEMAP_FILE_MEMORY:
+      return folly::to<std::string>("inodemap.", base, ".file_memory");
+    case CounterName::INODEMAP_TREE_MEMORY:
+      return folly::to<std::string>("inodemap.", base, ".tree_memory");
     case CounterName::JOURNAL_MEMORY:
       return folly::to<std::string>("journal.", base, ".memory");
     case CounterName::JOURNAL_ENTRIES:
@@ -1269,17 +1493,28 @@ void EdenMount::createChannel(EdenMount::channelType channel) {
 #if _WIN32
   fsChannel_.reset(channel);
 #else
+  auto config = serverState_->getReloadableConfig().getEdenConfig();
+  FuseChannelOptions options;
+  options.writebackCache = config->fuseWritebackCache.getValue();
+  options.asyncDio = config->fuseAsyncDio.getValue();
+  options.maxPages = config->fuseMaxPages.getValue();
+  options.useIoUring = config->fuseUseIoUring.getValue();
+  options.ioUringQueueDepth = config->fuseIoUringQueueDepth.getValue();
+  options.maxRequestsPerProcess = config->fuseMaxRequestsPerProcess.getValue();
+  for (size_t i = 0; i < kNumFuseRequestClasses; ++i) {
+    options.requestPools[i] =
+        serverState_->getFuseRequestPool(static_cast<FuseRequestClass>(i));
+  }
   channel_.reset(new FuseChannel(
       std::move(channel),
       getPath(),
-      FLAGS_fuseNumThreads,
+      config->fuseNumThreads.getValue(),
       dispatcher_.get(),
       serverState_->getProcessNameCache(),
       std::chrono::duration_cast<folly::Duration>(
-          serverState_->getReloadableConfig()
-              .getEdenConfig()
-              ->fuseRequestTimeout.getValue()),
-      serverState_->getNotifications()));
+          config->fuseRequestTimeout.getValue()),
+      serverState_->getNotifications(),
+      options));
 #endif
 }
 
@@ -1480,6 +1715,117 @@ std::optional<TreePrefetchLease> EdenMount::tryStartTreePrefetch(
   }
 }
 
+namespace {
+/**
+ * Find the id of the tree at `path` below `tree`, or std::nullopt if `path`
+ * is not a directory in source control.
+ */
+Future<std::optional<Hash>> lookupTreeId(
+    std::shared_ptr<ObjectStore> objectStore,
+    std::shared_ptr<const Tree> tree,
+    RelativePathPiece path,
+    ObjectFetchContext& context) {
+  if (path.empty()) {
+    return folly::makeFuture(std::optional<Hash>{tree->getHash()});
+  }
+
+  auto [childName, rest] = splitFirst(path);
+  auto entry = tree->getEntryPtr(childName);
+  if (!entry || !entry->isTree()) {
+    return folly::makeFuture(std::optional<Hash>{});
+  }
+  return objectStore->getTree(entry->getHash(), context)
+      .thenValue([objectStore, rest = rest.copy(), &context](
+                     std::shared_ptr<const Tree> child) {
+        return lookupTreeId(objectStore, std::move(child), rest, context);
+      });
+}
+} // namespace
+
+folly::Future<size_t> EdenMount::prefetchTrees(
+    std::vector<RelativePath> paths,
+    size_t depth) {
+  auto prefetchLease = tryStartTreePrefetch(getRootInode());
+  if (!prefetchLease) {
+    XLOG(DBG3) << "skipping tree prefetch for " << getPath()
+               << ": too many prefetches already in progress";
+    return folly::makeFuture(size_t{0});
+  }
+
+  // The context is owned by the lease, which is kept alive until the walk
+  // completes.
+  auto lease = std::make_shared<TreePrefetchLease>(std::move(*prefetchLease));
+  auto& context = lease->getContext();
+  return getRootTree()
+      .thenValue([objectStore = objectStore_,
+                  paths = std::move(paths),
+                  &context](std::shared_ptr<const Tree> rootTree) {
+        std::vector<Future<std::optional<Hash>>> futures;
+        futures.reserve(paths.size());
+        for (const auto& path : paths) {
+          futures.emplace_back(
+              lookupTreeId(objectStore, rootTree, path, context));
+        }
+        return folly::collectAllUnsafe(futures);
+      })
+      .thenValue([objectStore = objectStore_, depth, &context](
+                     std::vector<folly::Try<std::optional<Hash>>>&& treeIds) {
+        std::vector<TreePrefetchRoot> roots;
+        for (auto& treeId : treeIds) {
+          if (treeId.hasValue() && treeId.value().has_value()) {
+            roots.push_back(TreePrefetchRoot{*treeId.value(), std::nullopt});
+          }
+        }
+        return prefetchTreesBreadthFirst(
+            objectStore, std::move(roots), depth, context);
+      })
+      .ensure([lease] {});
+}
+
+folly::Future<HydrateResult> EdenMount::hydrateCommit(
+    const Hash& commitHash,
+    std::vector<RelativePath> blobPaths,
+    ObjectFetchContext& context) {
+  return objectStore_->getTreeForCommit(commitHash, context)
+      .thenValue([objectStore = objectStore_,
+                  blobPaths = std::move(blobPaths),
+                  &context](std::shared_ptr<const Tree> rootTree) mutable {
+        return hydrateTree(
+            objectStore, rootTree->getHash(), std::move(blobPaths), context);
+      });
+}
+
+void EdenMount::prefetchCheckoutTrees(
+    const std::shared_ptr<const Tree>& fromTree,
+    const std::shared_ptr<const Tree>& toTree) {
+  if (fromTree->getHash() == toTree->getHash()) {
+    return;
+  }
+
+  auto prefetchLease = tryStartTreePrefetch(getRootInode());
+  if (!prefetchLease) {
+    XLOG(DBG3) << "skipping checkout tree prefetch for " << getPath()
+               << ": too many prefetches already in progress";
+    return;
+  }
+
+  XLOG(DBG4) << "starting checkout tree prefetch for " << getPath();
+  auto& context = prefetchLease->getContext();
+  prefetchTreesBreadthFirst(
+      objectStore_,
+      {TreePrefetchRoot{toTree->getHash(), fromTree->getHash()}},
+      std::numeric_limits<size_t>::max(),
+      context)
+      .thenTry([lease = std::move(*prefetchLease)](
+                   folly::Try<size_t>&& loadedCount) {
+        if (loadedCount.hasValue()) {
+          XLOG(DBG4) << "finished checkout tree prefetch for "
+                     << lease.getTreeInode()->getLogPath() << ": "
+                     << loadedCount.value() << " trees";
+        }
+      });
+}
+
 void EdenMount::treePrefetchFinished() noexcept {
   auto oldValue =
       numPrefetchesInProgress_.fetch_sub(1, std::memory_order_acq_rel);
@@ -15,6 +15,7 @@
 #include <folly/futures/Promise.h>
 #include <folly/futures/SharedPromise.h>
 #include <folly/logging/Logger.h>
+#include <array>
 #include <chrono>
 #include <memory>
 #include <mutex>
@@ -30,6 +31,8 @@
 #include "eden/fs/service/gen-cpp2/eden_types.h"
 #include "eden/fs/store/BlobAccess.h"
 #include "eden/fs/takeover/TakeoverData.h"
+#include "eden/fs/inodes/InodePathCache.h"
+#include "eden/fs/utils/DirectoryAccessStats.h"
 #include "eden/fs/utils/PathFuncs.h"
 
 #ifndef _WIN32
@@ -63,13 +66,16 @@ namespace eden {
 class BindMount;
 class BlobCache;
 class CheckoutConfig;
+class CheckoutFilter;
 class CheckoutConflict;
+class CheckoutContext;
 class Clock;
 class DiffContext;
 class EdenDispatcher;
 class FuseChannel;
 class FuseDeviceUnmountedDuringInitialization;
 class DiffCallback;
+struct HydrateResult;
 class InodeMap;
 class MountPoint;
 struct InodeMetadata;
@@ -100,6 +106,14 @@ enum class CounterName {
    * Represents count of unloaded inodes in the current mount.
    */
   INODEMAP_UNLOADED,
+  /**
+   * Represents the memory used by the loaded FileInodes in the current mount.
+   */
+  INODEMAP_FILE_MEMORY,
+  /**
+   * Represents the memory used by the loaded TreeInodes in the current mount.
+   */
+  INODEMAP_TREE_MEMORY,
   /**
    * Represents the amount of memory used by deltas in the change log
    */
@@ -275,6 +289,19 @@ class EdenMount {
    */
   FuseChannel* getFuseChannel() const;
 
+  /**
+   * Push the contents of the given files into the kernel's page cache, so
+   * that their first reads are served without a FUSE request.
+   *
+   * Only regular files that are still identical to source control are
+   * stored, and only until maxBytes of file data have been queued.  Files the
+   * kernel has not looked up are silently skipped by the kernel.  Errors are
+   * logged rather than returned, since this is purely an optimization.
+   */
+  folly::Future<folly::Unit> populatePageCache(
+      const std::vector<RelativePath>& paths,
+      uint64_t maxBytes);
+
   /**
    * Return the path to the mount point.
    */
@@ -315,6 +342,22 @@ class EdenMount {
     return &blobAccess_;
   }
 
+  /**
+   * Sampled counts of the lookups, reads, and loads within each directory of
+   * this mount.
+   */
+  DirectoryAccessStats& getDirectoryAccessStats() {
+    return directoryAccessStats_;
+  }
+
+  /**
+   * The recently resolved paths that getInode() checks before walking from
+   * the root.
+   */
+  InodePathCache& getInodePathCache() {
+    return inodePathCache_;
+  }
+
 #ifdef _WIN32
   /**
    * Return the pointer to FsChannel on Windows
@@ -368,6 +411,11 @@ class EdenMount {
     return mountGeneration_;
   }
 
+  /**
+   * Get the filter that hides parts of this checkout's source control trees.
+   */
+  const CheckoutFilter& getCheckoutFilter() const;
+
   const CheckoutConfig* getConfig() const {
     return config_.get();
   }
@@ -465,6 +513,12 @@ class EdenMount {
       folly::StringPiece thriftMethodCaller,
       CheckoutMode checkoutMode = CheckoutMode::NORMAL);
 
+  /**
+   * Returns the progress of the checkout currently running in this mount.
+   * checkoutInProgress is false in the result if there is none.
+   */
+  CheckoutProgressInfo getCheckoutProgress() const;
+
   /**
    * Chown the repository to the given uid and gid
    */
@@ -489,6 +543,12 @@ class EdenMount {
    * @return Returns a folly::Future that will be fulfilled when the diff
    *     operation is complete.  This is marked FOLLY_NODISCARD to
    *     make sure callers do not forget to wait for the operation to complete.
+   *
+   * The last status computed for each value of listIgnored is cached along
+   * with the journal position it was computed at. A later call for the same
+   * commit only re-diffs the paths that the journal has recorded as changed
+   * since then, unless the journal was truncated, a checkout happened, or
+   * ignore rules that affect the whole repository changed.
    */
   FOLLY_NODISCARD folly::Future<std::unique_ptr<ScmStatus>> diff(
       Hash commitHash,
@@ -673,11 +733,72 @@ class EdenMount {
   FOLLY_NODISCARD std::optional<TreePrefetchLease> tryStartTreePrefetch(
       TreeInodePtr treeInode);
 
+  /**
+   * Import the source control trees of the working copy parent under each of
+   * the given paths, walking at most `depth` directory levels below them.
+   *
+   * The walk is breadth first, every level being requested at once with
+   * ImportPriority::kLow() so the backing store can batch the imports. This
+   * counts as one of the prefetches bounded by the max-tree-prefetches config;
+   * when too many are already running nothing is fetched.
+   *
+   * Paths that do not refer to a directory in source control are ignored. The
+   * returned future produces the number of trees that were loaded.
+   */
+  folly::Future<size_t> prefetchTrees(
+      std::vector<RelativePath> paths,
+      size_t depth);
+
+  /**
+   * Import every source control tree of the given commit, and the blobs of
+   * its files under any of `blobPaths`, into the local store.
+   *
+   * Unlike prefetchTrees() this is meant for clients that are about to read
+   * most of the commit, such as CI jobs, so it is not bounded by the
+   * max-tree-prefetches config and runs at the priority of `context`, which
+   * must remain valid until the returned future completes. See hydrateTree()
+   * for the details of the walk.
+   */
+  folly::Future<HydrateResult> hydrateCommit(
+      const Hash& commitHash,
+      std::vector<RelativePath> blobPaths,
+      ObjectFetchContext& context);
+
  private:
   friend class RenameLock;
   friend class SharedRenameLock;
   class JournalDiffCallback;
 
+  /**
+   * A status computed by diff(), and the state of the mount it was computed
+   * against.
+   */
+  struct CachedStatus {
+    Hash commitHash;
+    /** The latest journal sequence number when the diff started. */
+    JournalDelta::SequenceNumber sequence{0};
+    /** ServerState::getTopLevelIgnoresGeneration() when the diff started. */
+    size_t ignoresGeneration{0};
+    std::shared_ptr<const ScmStatus> status;
+  };
+
+  /**
+   * Returns an error unless commitHash is the current parent commit.
+   */
+  folly::Future<folly::Unit> checkCurrentParent(const Hash& commitHash) const;
+
+  /**
+   * Restrict context to the paths the journal has recorded as changed since
+   * sequence, so that rediffing them brings a status computed at sequence up
+   * to date.
+   *
+   * Returns false if the changes since sequence cannot be attributed to
+   * individual paths, and a full diff is needed.
+   */
+  bool scopeDiffToChangesSince(
+      DiffContext& context,
+      JournalDelta::SequenceNumber sequence) const;
+
   /**
    * Recursive method used for resolveSymlink() implementation
    */
@@ -733,6 +854,14 @@ class EdenMount {
 
   folly::SemiFuture<SerializedInodeMap> shutdownImpl(bool doTakeover);
 
+  /**
+   * Open the on-disk copy of the journal if journal:persist is set, and
+   * return the mount generation to use.  This is the generation of the
+   * previous mount of this checkout if its journal was restored, since the
+   * journal's sequence numbers continue from that mount's.
+   */
+  uint64_t openJournalLog();
+
   /**
    * Create a DiffContext to be passed through the TreeInode diff codepath. This
    * will be used to record differences through the callback (in which
@@ -814,6 +943,14 @@ class EdenMount {
   friend class TreePrefetchLease;
   void treePrefetchFinished() noexcept;
 
+  /**
+   * Start importing, in the background, the trees of `toTree` that differ from
+   * `fromTree` so that checkout finds them in the caches.
+   */
+  void prefetchCheckoutTrees(
+      const std::shared_ptr<const Tree>& fromTree,
+      const std::shared_ptr<const Tree>& toTree);
+
   static constexpr int kMaxSymlinkChainDepth = 40; // max depth of symlink chain
 
   const std::unique_ptr<const CheckoutConfig> config_;
@@ -845,6 +982,9 @@ class EdenMount {
   std::shared_ptr<ObjectStore> objectStore_;
   std::shared_ptr<BlobCache> blobCache_;
   BlobAccess blobAccess_;
+  DirectoryAccessStats directoryAccessStats_;
+  // Mutable so that the const getInode() can fill it in.
+  mutable InodePathCache inodePathCache_;
   std::shared_ptr<Overlay> overlay_;
 
 #ifndef _WIN32
@@ -872,9 +1012,15 @@ class EdenMount {
 
   std::unique_ptr<Journal> journal_;
 
+  /**
+   * The last status computed by diff(), indexed by its listIgnored argument.
+   */
+  folly::Synchronized<std::array<std::optional<CachedStatus>, 2>> statusCache_;
+
   /**
    * A number to uniquely identify this particular incarnation of this mount.
-   * We use bits from the process id and the time at which we were mounted.
+   * We use bits from the process id and the time at which we were mounted,
+   * unless the journal was restored from a previous incarnation.
    */
   const uint64_t mountGeneration_;
 
@@ -907,6 +1053,12 @@ class EdenMount {
    */
   folly::Synchronized<struct timespec> lastCheckoutTime_;
 
+  /**
+   * The checkout currently running in this mount, so that its progress can
+   * be reported while it runs.
+   */
+  folly::Synchronized<std::weak_ptr<CheckoutContext>> currentCheckout_;
+
   struct MountingUnmountingState {
     bool channelMountStarted() const noexcept;
     bool channelUnmountStarted() const noexcept;
@@ -11,8 +11,10 @@
 #include <folly/io/IOBuf.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/xlog.h>
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodeError.h"
+#include "eden/fs/inodes/ServerState.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
@@ -193,6 +195,18 @@ ReturnType FileInode::runWhileDataLoaded(
       state.unlock();
       break;
     case State::MATERIALIZED_IN_OVERLAY:
+#ifndef _WIN32
+      if (state->partialBlobHash) {
+        if (blob) {
+          return folly::makeFutureWith([&] {
+            return std::forward<Fn>(fn)(std::move(state), std::move(blob));
+          });
+        }
+        future =
+            startLoadingPartialBlob(std::move(state), interest, fetchContext);
+        break;
+      }
+#endif // !_WIN32
       return folly::makeFutureWith(
           [&] { return std::forward<Fn>(fn)(std::move(state), nullptr); });
   }
@@ -274,8 +288,23 @@ typename folly::futures::detail::callableResult<FileInode::LockedState, Fn>::
       state.unlock();
       break;
     case State::MATERIALIZED_IN_OVERLAY:
-      return folly::makeFutureWith(
-          [&] { return std::forward<Fn>(fn)(LockedState{std::move(state)}); });
+      if (!state->partialBlobHash) {
+        return folly::makeFutureWith([&] {
+          return std::forward<Fn>(fn)(LockedState{std::move(state)});
+        });
+      }
+      if (blob) {
+        // The file is partially materialized.  Fill in the rest of it first.
+        completePartialMaterialization(state, *blob);
+        return folly::makeFutureWith([&] {
+          return std::forward<Fn>(fn)(LockedState{std::move(state)});
+        });
+      }
+      future = startLoadingPartialBlob(
+          std::move(state),
+          BlobCache::Interest::UnlikelyNeededAgain,
+          ObjectFetchContext::getNullContext());
+      break;
   }
 
   return std::move(future).thenValue(
@@ -293,6 +322,52 @@ typename folly::futures::detail::callableResult<FileInode::LockedState, Fn>::
       });
 }
 
+template <typename Fn>
+typename folly::futures::detail::callableResult<FileInode::LockedState, Fn>::
+    Return
+    FileInode::runWhileWritable(LockedState state, Fn&& fn) {
+  if (state->tag == State::MATERIALIZED_IN_OVERLAY) {
+    // Partially materialized files stay that way.
+    return folly::makeFutureWith(
+        [&] { return std::forward<Fn>(fn)(LockedState{std::move(state)}); });
+  }
+
+  auto minSize = getMount()
+                     ->getServerState()
+                     ->getConfigSnapshot()
+                     .partialMaterializationMinSize.getValue();
+  if (minSize == 0) {
+    return runWhileMaterialized(
+        std::move(state), nullptr, std::forward<Fn>(fn));
+  }
+
+  // The blob size is usually known without fetching the blob.
+  auto sizeFuture = getObjectStore()->getBlobSize(
+      state->hash.value(), ObjectFetchContext::getNullContext());
+  state.unlock();
+  return std::move(sizeFuture)
+      .thenValue([self = inodePtrFromThis(),
+                  minSize,
+                  fn = std::forward<Fn>(fn)](uint64_t blobSize) mutable {
+        auto state = LockedState{self};
+        // Only start from BLOB_NOT_LOADING.  If the blob is being loaded
+        // anyway, we may as well copy all of it.
+        if (state->tag != State::BLOB_NOT_LOADING || blobSize < minSize) {
+          return self->runWhileMaterialized(
+              std::move(state), nullptr, std::forward<Fn>(fn));
+        }
+
+        self->startPartialMaterialization(state, blobSize);
+        SCOPE_EXIT {
+          CHECK(state.isNull());
+          self->materializeInParent();
+        };
+        return folly::makeFutureWith([&] {
+          return std::forward<Fn>(fn)(LockedState{std::move(state)});
+        });
+      });
+}
+
 template <typename Fn>
 typename std::result_of<Fn(FileInode::LockedState&&)>::type
 FileInode::truncateAndRun(LockedState state, Fn&& fn) {
@@ -311,7 +386,7 @@ FileInode::truncateAndRun(LockedState state, Fn&& fn) {
       //   materialized in our parent TreeInode.
       // - If we successfully materialized the file and were in the
       //   BLOB_LOADING state, fulfill the blobLoadingPromise.
-      std::optional<folly::SharedPromise<std::shared_ptr<const Blob>>>
+      std::unique_ptr<folly::SharedPromise<std::shared_ptr<const Blob>>>
           loadingPromise;
       SCOPE_EXIT {
         if (loadingPromise) {
@@ -328,7 +403,6 @@ FileInode::truncateAndRun(LockedState state, Fn&& fn) {
       // Now that materializeAndTruncate() has succeeded, extract the
       // blobLoadingPromise so we can fulfill it as we exit.
       loadingPromise = std::move(state->blobLoadingPromise);
-      state->blobLoadingPromise.reset();
       // Also call materializeInParent() as we exit, before fulfilling the
       // blobLoadingPromise.
       SCOPE_EXIT {
@@ -379,12 +453,16 @@ void FileInodeState::checkInvariants() {
     case BLOB_NOT_LOADING:
       CHECK(hash);
       CHECK(!blobLoadingPromise);
+#ifndef _WIN32
+      CHECK(!partialBlobHash);
+#endif
       return;
     case BLOB_LOADING:
       CHECK(hash);
       CHECK(blobLoadingPromise);
 #ifndef _WIN32
       CHECK(readByteRanges.empty());
+      CHECK(!partialBlobHash);
 #endif
       return;
     case MATERIALIZED_IN_OVERLAY:
@@ -413,7 +491,20 @@ FileInode::FileInode(
     const std::optional<InodeTimestamps>& initialTimestamps,
     const std::optional<Hash>& hash)
     : Base(ino, initialMode, initialTimestamps, std::move(parentInode), name),
-      state_(folly::in_place, hash) {}
+      state_(folly::in_place, hash) {
+#ifndef _WIN32
+  auto* overlay = getMount()->getOverlay();
+  if (auto partialBlobHash = overlay->getPartialFileBlob(ino)) {
+    if (hash) {
+      // We crashed after partially materializing the file but before its
+      // parent recorded that, so the overlay file is not used.
+      overlay->finishPartialFile(ino);
+    } else {
+      state_.wlock()->partialBlobHash = partialBlobHash;
+    }
+  }
+#endif // !_WIN32
+}
 
 // The FileInode is in MATERIALIZED_IN_OVERLAY state.
 FileInode::FileInode(
@@ -642,6 +733,14 @@ Future<Hash> FileInode::getSha1(ObjectFetchContext& fetchContext) {
       AbsolutePath pathToFile = getMaterializedFilePath();
       return makeFuture(getFileSha1(pathToFile.c_str()));
 #else
+      if (state->partialBlobHash) {
+        return runWhileMaterialized(
+            std::move(state),
+            nullptr,
+            [self = inodePtrFromThis()](LockedState&& state) {
+              return self->getOverlayFileAccess(state)->getSha1(*self);
+            });
+      }
       return getOverlayFileAccess(state)->getSha1(*this);
 #endif // _WIN32
   }
@@ -751,6 +850,11 @@ Future<string> FileInode::readAll(
             AbsolutePath pathToFile = self->getMaterializedFilePath();
             readFile(pathToFile.c_str(), result);
 #else
+            if (state->partialBlobHash) {
+              auto size = self->getOverlayFileAccess(state)->getFileSize(*self);
+              result = self->readPartial(state, *blob, size, 0).copyData();
+              break;
+            }
             DCHECK(!blob);
             result = self->getOverlayFileAccess(state)->readAllContents(*self);
 #endif
@@ -792,13 +896,56 @@ void FileInode::materialize() {
 Future<BufVec>
 FileInode::read(size_t size, off_t off, ObjectFetchContext& context) {
   DCHECK_GE(off, 0);
+  auto state = LockedState{this};
+  auto readAhead = recordRead(state, size, off);
+  if (state->tag != State::BLOB_NOT_LOADING) {
+    return readWhileDataLoaded(
+        std::move(state), nullptr, size, off, readAhead, context);
+  }
+  auto blob = state.getCachedBlob(getMount(), BlobCache::Interest::WantHandle);
+  if (blob) {
+    return readWhileDataLoaded(
+        std::move(state), std::move(blob), size, off, readAhead, context);
+  }
+
+  // Rather than loading all of a large blob that is no longer in memory, try
+  // to load only the chunks of it that cover this read.
+  auto hash = state->hash.value();
+  state.unlock();
+  auto* blobAccess = getMount()->getBlobAccess();
+  if (readAhead > 0) {
+    blobAccess->prefetchBlobRange(hash, off + size, readAhead);
+  }
+  return blobAccess->getBlobRange(hash, off, size, context)
+      .thenValue([size, off, hash, &context, self = inodePtrFromThis()](
+                     std::unique_ptr<folly::IOBuf> range) {
+        auto state = LockedState{self};
+        if (!range || state->tag != State::BLOB_NOT_LOADING ||
+            state->hash != hash) {
+          // The chunks were not available, or the file changed while they
+          // were loading.  Read-ahead, if any, was already started.
+          return self->readWhileDataLoaded(
+              std::move(state), nullptr, size, off, 0, context);
+        }
+        self->updateAtimeLocked(*state);
+        return folly::makeFuture(BufVec{std::move(range)});
+      });
+}
+
+Future<BufVec> FileInode::readWhileDataLoaded(
+    LockedState state,
+    std::shared_ptr<const Blob> cachedBlob,
+    size_t size,
+    off_t off,
+    size_t readAhead,
+    ObjectFetchContext& context) {
   return runWhileDataLoaded<Future<BufVec>>(
-      LockedState{this},
+      std::move(state),
       BlobCache::Interest::WantHandle,
       // This function is only called by FUSE.
       context,
-      nullptr,
-      [size, off, self = inodePtrFromThis()](
+      std::move(cachedBlob),
+      [size, off, readAhead, self = inodePtrFromThis()](
           LockedState&& state, std::shared_ptr<const Blob> blob) -> BufVec {
         SCOPE_SUCCESS {
           self->updateAtimeLocked(*state);
@@ -806,7 +953,15 @@ FileInode::read(size_t size, off_t off, ObjectFetchContext& context) {
 
         // Materialized either before or during blob load.
         if (state->tag == State::MATERIALIZED_IN_OVERLAY) {
-          return self->getOverlayFileAccess(state)->read(*self, size, off);
+          if (state->partialBlobHash) {
+            return self->readPartial(state, *blob, size, off);
+          }
+          auto* overlayFileAccess = self->getOverlayFileAccess(state);
+          auto result = overlayFileAccess->read(*self, size, off);
+          if (readAhead > 0) {
+            overlayFileAccess->readAhead(*self, readAhead, off + size);
+          }
+          return result;
         }
 
         // runWhileDataLoaded() ensures that the state is either
@@ -816,10 +971,17 @@ FileInode::read(size_t size, off_t off, ObjectFetchContext& context) {
 
         state->readByteRanges.add(off, off + size);
         if (state->readByteRanges.covers(0, blob->getSize())) {
+          // A read that continued the previous one and reached the end of the
+          // file finished a sequential pass; anything else filled in a hole
+          // left by reading out of order.
+          auto usage = state->sequentialReadCount > 0 &&
+                  off + size >= blob->getSize()
+              ? BlobInterestHandle::Usage::ReadSequentially
+              : BlobInterestHandle::Usage::ReadRandomly;
           XLOG(DBG4) << "Inode " << self->getNodeId()
                      << " dropping interest for blob " << blob->getHash()
                      << " because it's been fully read.";
-          state->interestHandle.reset();
+          state->interestHandle.reset(usage);
           state->readByteRanges.clear();
         }
 
@@ -840,6 +1002,22 @@ FileInode::read(size_t size, off_t off, ObjectFetchContext& context) {
       });
 }
 
+size_t FileInode::recordRead(LockedState& state, size_t size, off_t off) {
+  if (static_cast<uint64_t>(off) == state->nextSequentialReadOffset) {
+    ++state->sequentialReadCount;
+  } else {
+    state->sequentialReadCount = 0;
+  }
+  state->nextSequentialReadOffset = off + size;
+
+  const auto& config = getMount()->getServerState()->getConfigSnapshot();
+  if (state->sequentialReadCount <
+      config.readAheadMinSequentialReads.getValue()) {
+    return 0;
+  }
+  return config.readAheadSize.getValue();
+}
+
 size_t FileInode::writeImpl(
     LockedState& state,
     const struct iovec* iov,
@@ -847,7 +1025,26 @@ size_t FileInode::writeImpl(
     off_t off) {
   DCHECK_EQ(state->tag, State::MATERIALIZED_IN_OVERLAY);
 
-  auto xfer = getOverlayFileAccess(state)->write(*this, iov, numIovecs, off);
+  auto* overlayFileAccess = getOverlayFileAccess(state);
+  off_t oldSize = 0;
+  if (state->partialBlobHash) {
+    oldSize = overlayFileAccess->getFileSize(*this);
+  }
+
+  auto xfer = overlayFileAccess->write(*this, iov, numIovecs, off);
+
+  bool tooManyRanges = false;
+  if (state->partialBlobHash && xfer > 0) {
+    // Anything skipped over past the old end of the file reads as zeros, so
+    // it counts as written too.
+    auto rangeCount = getMount()->getOverlay()->addPartialFileRange(
+        getNodeId(), std::min(off, oldSize), off + xfer);
+    tooManyRanges = rangeCount >
+        getMount()
+            ->getServerState()
+            ->getConfigSnapshot()
+            .partialMaterializationMaxRanges.getValue();
+  }
 
   updateMtimeAndCtimeLocked(*state, getNow());
 
@@ -855,13 +1052,20 @@ size_t FileInode::writeImpl(
 
   updateJournal();
 
+  if (tooManyRanges) {
+    runWhileMaterialized(LockedState{this}, nullptr, [](LockedState&&) {})
+        .thenError([ino = getNodeId()](const folly::exception_wrapper& ew) {
+          XLOG(ERR) << "failed to fully materialize inode " << ino << ": "
+                    << ew.what();
+        });
+  }
+
   return xfer;
 }
 
 folly::Future<size_t> FileInode::write(BufVec&& buf, off_t off) {
-  return runWhileMaterialized(
+  return runWhileWritable(
       LockedState{this},
-      nullptr,
       [buf = std::move(buf), off, self = inodePtrFromThis()](
           LockedState&& state) {
         auto vec = buf.getIov();
@@ -880,9 +1084,8 @@ folly::Future<size_t> FileInode::write(folly::StringPiece data, off_t off) {
     return writeImpl(state, &iov, 1, off);
   }
 
-  return runWhileMaterialized(
+  return runWhileWritable(
       std::move(state),
-      nullptr,
       [data = data.str(), off, self = inodePtrFromThis()](
           LockedState&& stateLock) {
         struct iovec iov;
@@ -906,13 +1109,18 @@ Future<std::shared_ptr<const Blob>> FileInode::startLoadingData(
       state->hash.value(), fetchContext, interest);
 
   // Everything from here through blobFuture.then should be noexcept.
-  state->blobLoadingPromise.emplace();
+  state->blobLoadingPromise = std::make_unique<
+      folly::SharedPromise<std::shared_ptr<const Blob>>>();
   auto resultFuture = state->blobLoadingPromise->getFuture();
   state->tag = State::BLOB_LOADING;
 
   // Unlock state_ while we wait on the blob data to load
   state.unlock();
 
+  getMount()->getDirectoryAccessStats().record(
+      DirectoryAccessStats::AccessType::BlobLoad,
+      [this] { return DirectoryAccessStats::parentOf(getPath()); });
+
   auto self = inodePtrFromThis(); // separate line for formatting
   std::move(getBlobFuture)
       .thenTry([self](folly::Try<BlobCache::GetResult> tryResult) mutable {
@@ -930,8 +1138,7 @@ Future<std::shared_ptr<const Blob>> FileInode::startLoadingData(
           // materialized the FileInode, so we may already be
           // MATERIALIZED_IN_OVERLAY at this point.
           case State::BLOB_LOADING: {
-            auto promise = std::move(*state->blobLoadingPromise);
-            state->blobLoadingPromise.reset();
+            auto promise = std::move(state->blobLoadingPromise);
             state->tag = State::BLOB_NOT_LOADING;
 
             // Call the Future's subscribers while the state_ lock is not
@@ -940,10 +1147,10 @@ Future<std::shared_ptr<const Blob>> FileInode::startLoadingData(
             if (tryResult.hasValue()) {
               state->interestHandle = std::move(tryResult->interestHandle);
               state.unlock();
-              promise.setValue(std::move(tryResult->blob));
+              promise->setValue(std::move(tryResult->blob));
             } else {
               state.unlock();
-              promise.setException(std::move(tryResult).exception());
+              promise->setException(std::move(tryResult).exception());
             }
             return;
           }
@@ -952,7 +1159,7 @@ Future<std::shared_ptr<const Blob>> FileInode::startLoadingData(
             // The load raced with a someone materializing the file to truncate
             // it.  Nothing left to do here. The truncation completed the
             // promise with a null blob.
-            CHECK_EQ(false, state->blobLoadingPromise.has_value());
+            CHECK(!state->blobLoadingPromise);
             return;
         }
       })
@@ -1003,6 +1210,101 @@ void FileInode::truncateInOverlay(LockedState& state) {
   CHECK(!state->hash);
 
   getOverlayFileAccess(state)->truncate(*this);
+  if (state->partialBlobHash) {
+    // Nothing is left of the blob's contents.
+    getMount()->getOverlay()->finishPartialFile(getNodeId());
+    state->partialBlobHash.reset();
+  }
+}
+
+void FileInode::startPartialMaterialization(
+    LockedState& state,
+    uint64_t blobSize) {
+  DCHECK_EQ(state->tag, State::BLOB_NOT_LOADING);
+
+  // Record the partial file first, so that it is never mistaken for a fully
+  // materialized one.
+  auto blobHash = state->hash.value();
+  getMount()->getOverlay()->startPartialFile(getNodeId(), blobHash);
+
+  auto* overlayFileAccess = getOverlayFileAccess(state);
+  overlayFileAccess->createEmptyFile(getNodeId());
+  overlayFileAccess->truncate(*this, blobSize);
+
+  state.setMaterialized();
+  state->partialBlobHash = blobHash;
+}
+
+void FileInode::completePartialMaterialization(
+    LockedState& state,
+    const Blob& blob) {
+  DCHECK(state->partialBlobHash);
+
+  auto* overlayFileAccess = getOverlayFileAccess(state);
+  auto* overlay = getMount()->getOverlay();
+  uint64_t end = overlayFileAccess->getFileSize(*this);
+  end = std::min<uint64_t>(end, blob.getSize());
+  for (const auto& gap : overlay->getPartialFileGaps(getNodeId(), 0, end)) {
+    folly::io::Cursor cursor(&blob.getContents());
+    cursor.skip(gap.first);
+    std::unique_ptr<folly::IOBuf> data;
+    cursor.clone(data, gap.second - gap.first);
+    auto iov = data->getIov();
+    overlayFileAccess->write(*this, iov.data(), iov.size(), gap.first);
+  }
+
+  overlay->finishPartialFile(getNodeId());
+  state->partialBlobHash.reset();
+}
+
+Future<std::shared_ptr<const Blob>> FileInode::startLoadingPartialBlob(
+    LockedState state,
+    BlobCache::Interest interest,
+    ObjectFetchContext& fetchContext) {
+  auto blobHash = state->partialBlobHash.value();
+  state.unlock();
+  return getMount()
+      ->getBlobAccess()
+      ->getBlob(blobHash, fetchContext, interest)
+      .thenValue([](BlobCache::GetResult result) {
+        return std::move(result.blob);
+      });
+}
+
+BufVec FileInode::readPartial(
+    LockedState& state,
+    const Blob& blob,
+    size_t size,
+    off_t off) {
+  DCHECK(state->partialBlobHash);
+
+  auto* overlayFileAccess = getOverlayFileAccess(state);
+  uint64_t fileSize = overlayFileAccess->getFileSize(*this);
+  if (static_cast<uint64_t>(off) >= fileSize) {
+    return BufVec{folly::IOBuf::wrapBuffer("", 0)};
+  }
+  size = std::min<uint64_t>(size, fileSize - off);
+
+  // Anything past the end of the blob was written.
+  std::vector<std::pair<size_t, size_t>> gaps;
+  uint64_t blobEnd = std::min<uint64_t>(off + size, blob.getSize());
+  if (static_cast<uint64_t>(off) < blobEnd) {
+    gaps = getMount()->getOverlay()->getPartialFileGaps(
+        getNodeId(), off, blobEnd);
+  }
+  if (gaps.empty()) {
+    return overlayFileAccess->read(*this, size, off);
+  }
+
+  auto data = overlayFileAccess->read(*this, size, off).copyData();
+  // A short read of the overlay file would leave us nowhere to put the gaps.
+  data.resize(size);
+  for (const auto& gap : gaps) {
+    folly::io::Cursor cursor(&blob.getContents());
+    cursor.skip(gap.first);
+    cursor.pull(&data[gap.first - off], gap.second - gap.first);
+  }
+  return BufVec{folly::IOBuf::fromString(std::move(data))};
 }
 
 OverlayFileAccess* FileInode::getOverlayFileAccess(LockedState&) const {
@@ -11,6 +11,7 @@
 #include <folly/futures/Future.h>
 #include <folly/futures/SharedPromise.h>
 #include <chrono>
+#include <memory>
 #include <optional>
 #include "eden/fs/inodes/CacheHint.h"
 #include "eden/fs/inodes/InodeBase.h"
@@ -55,6 +56,13 @@ class OverlayFileAccess;
  *   - loading -> not loaded (blob available during transition)
  *   - loading -> materialized (O_TRUNC or not)
  *   - loading -> not loading -> materialized
+ *
+ * A materialized file may also be partially materialized, if it was first
+ * written while overlay:partial-materialization-min-size was set.  Its
+ * overlay file then only holds the ranges that were written, and the rest of
+ * its contents are read from the blob it was created from.  This is
+ * invisible outside of FileInode, which fills in the rest of the overlay file
+ * before anything needs the complete file.
  */
 struct FileInodeState {
   enum Tag : uint8_t {
@@ -94,8 +102,11 @@ struct FileInodeState {
    * if a truncate operation occurs during load. In that case, the future is
    * completed and the inode transitions to the materialized state without
    * a blob. Callbacks on this future must handle that case.
+   *
+   * A SharedPromise is much larger than a pointer and only a small fraction
+   * of loaded inodes are ever loading at once, so it is allocated on demand.
    */
-  std::optional<folly::SharedPromise<std::shared_ptr<const Blob>>>
+  std::unique_ptr<folly::SharedPromise<std::shared_ptr<const Blob>>>
       blobLoadingPromise;
 
   /**
@@ -116,6 +127,20 @@ struct FileInodeState {
    * Records the ranges that have been read() when not materialized.
    */
   CoverageSet readByteRanges;
+
+  /**
+   * The offset just past the end of the most recent read(), and how many
+   * reads in a row have started where the previous one ended.  FileInode has
+   * no per-handle state, so these are shared by all of the file's readers.
+   */
+  uint64_t nextSequentialReadOffset{0};
+  uint32_t sequentialReadCount{0};
+
+  /**
+   * Set only in the 'materialized' state, if the file is partially
+   * materialized.  The blob holding the contents that were not written.
+   */
+  std::optional<Hash> partialBlobHash;
 #endif
 };
 
@@ -252,6 +277,11 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
 
   folly::Future<struct stat> stat(ObjectFetchContext& context) override;
 
+  /**
+   * Update the st_blocks field in a stat structure based on the st_size value.
+   */
+  static void updateBlockCount(struct stat& st);
+
  private:
   using State = FileInodeState;
   class LockedState;
@@ -261,8 +291,9 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
    *
    * fn(state, blob) will be invoked when state->tag is either NOT_LOADING or
    * MATERIALIZED_IN_OVERLAY. If state->tag is MATERIALIZED_IN_OVERLAY,
-   * state->file will be available. If state->tag is NOT_LOADING, then the
-   * second argument will be a non-null std::shared_ptr<const Blob>.
+   * state->file will be available. If state->tag is NOT_LOADING, or the file
+   * is partially materialized, then the second argument will be a non-null
+   * std::shared_ptr<const Blob>.
    *
    * The blob parameter is used when recursing.
    *
@@ -280,7 +311,8 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
   /**
    * Run a function with the FileInode materialized.
    *
-   * fn(state) will be invoked when state->tag is MATERIALIZED_IN_OVERLAY.
+   * fn(state) will be invoked when state->tag is MATERIALIZED_IN_OVERLAY,
+   * and the file is not partially materialized.
    *
    * Returns a Future with the result of fn(state_.wlock())
    */
@@ -291,6 +323,18 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
       std::shared_ptr<const Blob> blob,
       Fn&& fn);
 
+  /**
+   * Run a function that writes to the file.
+   *
+   * Like runWhileMaterialized(), except that files with blobs of at least
+   * overlay:partial-materialization-min-size are only partially materialized,
+   * without loading their blob.  fn(state) must write through writeImpl(),
+   * which records the written ranges of partially materialized files.
+   */
+  template <typename Fn>
+  typename folly::futures::detail::callableResult<LockedState, Fn>::Return
+  runWhileWritable(LockedState state, Fn&& fn);
+
   /**
    * Truncate the file and then call a function.
    *
@@ -347,6 +391,59 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
    */
   void truncateInOverlay(LockedState& state);
 
+  /**
+   * Transition from NOT_LOADING to MATERIALIZED_IN_OVERLAY by creating a
+   * sparse overlay file of blobSize bytes, none of which are written yet.
+   *
+   * After this function returns the caller must call materializeInParent()
+   * after releasing the state lock.
+   */
+  void startPartialMaterialization(LockedState& state, uint64_t blobSize);
+
+  /**
+   * Copy the unwritten ranges of a partially materialized file from its blob
+   * into the overlay, leaving it fully materialized.
+   */
+  void completePartialMaterialization(LockedState& state, const Blob& blob);
+
+  /**
+   * Start loading the blob of a partially materialized file.  Unlocks state.
+   */
+  FOLLY_NODISCARD folly::Future<std::shared_ptr<const Blob>>
+  startLoadingPartialBlob(
+      LockedState state,
+      BlobCache::Interest interest,
+      ObjectFetchContext& fetchContext);
+
+  /**
+   * Read from a partially materialized file, taking the unwritten ranges from
+   * its blob.
+   */
+  BufVec readPartial(
+      LockedState& state,
+      const Blob& blob,
+      size_t size,
+      off_t off);
+
+  /**
+   * Implements read() once the blob, if it is needed, is loaded or loading.
+   * cachedBlob, if non-null, is the blob for the inode's current hash.
+   * readAhead is the number of bytes past the read to start loading.
+   */
+  folly::Future<BufVec> readWhileDataLoaded(
+      LockedState state,
+      std::shared_ptr<const Blob> cachedBlob,
+      size_t size,
+      off_t off,
+      size_t readAhead,
+      ObjectFetchContext& context);
+
+  /**
+   * Records a read of size bytes at off for sequential access detection, and
+   * returns how many bytes past its end to read ahead, or 0.
+   */
+  size_t recordRead(LockedState& state, size_t size, off_t off);
+
 #endif // !_WIN32
 
   /**
@@ -406,11 +503,6 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
       off_t off);
 #endif // !_WIN32
 
-  /**
-   * Update the st_blocks field in a stat structure based on the st_size value.
-   */
-  static void updateBlockCount(struct stat& st);
-
 #ifdef _WIN32
   /**
    * The getMaterializedFilePath() will return the Absolute path to the file in
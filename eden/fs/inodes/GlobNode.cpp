@@ -8,6 +8,7 @@
 #include "GlobNode.h"
 #include <iomanip>
 #include <iostream>
+#include "eden/fs/inodes/GlobNodeCache.h"
 #include "eden/fs/inodes/TreeInode.h"
 
 using folly::Future;
@@ -292,12 +293,13 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
     ObjectFetchContext& context,
     RelativePathPiece rootPath,
     ROOT&& root,
-    GlobNode::PrefetchList fileBlobsToPrefetch) {
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    ResultSink* sink) const {
   vector<GlobResult> results;
   vector<std::pair<PathComponentPiece, GlobNode*>> recurse;
   vector<Future<vector<GlobResult>>> futures;
   futures.emplace_back(evaluateRecursiveComponentImpl(
-      store, context, rootPath, root, fileBlobsToPrefetch));
+      store, context, rootPath, root, fileBlobsToPrefetch, sink));
 
   auto recurseIfNecessary =
       [&](PathComponentPiece name, GlobNode* node, const auto& entry) {
@@ -306,22 +308,14 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
           if (root.entryShouldLoadChildTree(entry)) {
             recurse.emplace_back(std::make_pair(name, node));
           } else {
-            auto candidateName = rootPath + name;
-            futures.emplace_back(
-                store->getTree(root.entryHash(entry), context)
-                    .thenValue(
-                        [candidateName,
-                         store,
-                         &context,
-                         innerNode = node,
-                         fileBlobsToPrefetch](std::shared_ptr<const Tree> dir) {
-                          return innerNode->evaluateImpl(
-                              store,
-                              context,
-                              candidateName,
-                              TreeRoot(dir),
-                              fileBlobsToPrefetch);
-                        }));
+            futures.emplace_back(node->evaluateTree(
+                store,
+                context,
+                rootPath + name,
+                root.entryHash(entry),
+                fileBlobsToPrefetch,
+                /*recursive=*/false,
+                sink));
           }
         }
       };
@@ -377,16 +371,23 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
                         &context,
                         candidateName,
                         node = item.second,
-                        fileBlobsToPrefetch](TreeInodePtr dir) {
+                        fileBlobsToPrefetch,
+                        sink](TreeInodePtr dir) {
               return node->evaluateImpl(
                   store,
                   context,
                   candidateName,
                   TreeInodePtrRoot(dir),
-                  fileBlobsToPrefetch);
+                  fileBlobsToPrefetch,
+                  sink);
             }));
   }
 
+  if (sink && !results.empty()) {
+    (*sink)(std::move(results));
+    results.clear();
+  }
+
   // Note: we use collectAll() rather than collect() here to make sure that
   // we have really finished all computation before we return a result.
   // Our caller may destroy us after we return, so we can't let errors propagate
@@ -411,9 +412,14 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
     ObjectFetchContext& context,
     RelativePathPiece rootPath,
     TreeInodePtr root,
-    GlobNode::PrefetchList fileBlobsToPrefetch) {
+    GlobNode::PrefetchList fileBlobsToPrefetch) const {
   return evaluateImpl(
-      store, context, rootPath, TreeInodePtrRoot(root), fileBlobsToPrefetch);
+      store,
+      context,
+      rootPath,
+      TreeInodePtrRoot(root),
+      fileBlobsToPrefetch,
+      /*sink=*/nullptr);
 }
 
 folly::Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
@@ -421,9 +427,143 @@ folly::Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
     ObjectFetchContext& context,
     RelativePathPiece rootPath,
     const std::shared_ptr<const Tree>& tree,
-    GlobNode::PrefetchList fileBlobsToPrefetch) {
+    GlobNode::PrefetchList fileBlobsToPrefetch) const {
+  return evaluateImpl(
+      store,
+      context,
+      rootPath,
+      TreeRoot(tree),
+      fileBlobsToPrefetch,
+      /*sink=*/nullptr);
+}
+
+Future<folly::Unit> GlobNode::evaluateStreaming(
+    const ObjectStore* store,
+    ObjectFetchContext& context,
+    RelativePathPiece rootPath,
+    TreeInodePtr root,
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    ResultSink& sink) const {
   return evaluateImpl(
-      store, context, rootPath, TreeRoot(tree), fileBlobsToPrefetch);
+             store,
+             context,
+             rootPath,
+             TreeInodePtrRoot(root),
+             fileBlobsToPrefetch,
+             &sink)
+      .thenValue([](vector<GlobResult>&&) {});
+}
+
+Future<vector<GlobNode::GlobResult>> GlobNode::evaluateTree(
+    const ObjectStore* store,
+    ObjectFetchContext& context,
+    RelativePathPiece rootPath,
+    const Hash& treeHash,
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    bool recursive,
+    ResultSink* sink) const {
+  auto evaluateFetchedTree = [this,
+                              store,
+                              &context,
+                              rootPath = rootPath.copy(),
+                              recursive](
+                                 PrefetchList blobsToPrefetch,
+                                 ResultSink* resultSink) {
+    return [this,
+            store,
+            &context,
+            rootPath,
+            recursive,
+            blobsToPrefetch,
+            resultSink](std::shared_ptr<const Tree> tree) {
+      if (recursive) {
+        return evaluateRecursiveComponentImpl(
+            store,
+            context,
+            rootPath,
+            TreeRoot(tree),
+            blobsToPrefetch,
+            resultSink);
+      }
+      return evaluateImpl(
+          store,
+          context,
+          rootPath,
+          TreeRoot(tree),
+          blobsToPrefetch,
+          resultSink);
+    };
+  };
+
+  if (!treeResultCache_) {
+    return store->getTree(treeHash, context)
+        .thenValue(evaluateFetchedTree(std::move(fileBlobsToPrefetch), sink));
+  }
+
+  auto key = GlobTreeResultCache::Key{
+      rootId_, this, recursive, treeHash, rootPath.copy()};
+  auto addBlobsToPrefetch = [fileBlobsToPrefetch](
+                                const GlobTreeResultCache::Results& results) {
+    if (fileBlobsToPrefetch && !results.blobsToPrefetch.empty()) {
+      auto blobs = fileBlobsToPrefetch->wlock();
+      blobs->insert(
+          blobs->end(),
+          results.blobsToPrefetch.begin(),
+          results.blobsToPrefetch.end());
+    }
+  };
+
+  if (auto cached = treeResultCache_->get(key)) {
+    addBlobsToPrefetch(*cached);
+    if (sink) {
+      (*sink)(vector<GlobResult>{cached->matches});
+      return vector<GlobResult>{};
+    }
+    return cached->matches;
+  }
+
+  if (sink) {
+    // The results are passed to the sink as they are found rather than
+    // collected, so they cannot be memoized.
+    return store->getTree(treeHash, context)
+        .thenValue(evaluateFetchedTree(std::move(fileBlobsToPrefetch), sink));
+  }
+
+  // Collect the blobs to prefetch separately, so that they can be memoized
+  // along with the matches.
+  auto blobsToPrefetch =
+      std::make_shared<folly::Synchronized<std::vector<Hash>>>();
+  return store->getTree(treeHash, context)
+      .thenValue(evaluateFetchedTree(blobsToPrefetch, /*resultSink=*/nullptr))
+      .thenValue([cache = treeResultCache_,
+                  key = std::move(key),
+                  blobsToPrefetch,
+                  addBlobsToPrefetch](vector<GlobResult>&& matches) mutable {
+        auto results = GlobTreeResultCache::Results{
+            std::move(matches), std::move(*blobsToPrefetch->wlock())};
+        addBlobsToPrefetch(results);
+        if (results.matches.size() >
+            GlobTreeResultCache::kMaxMemoizedMatches) {
+          return std::move(results.matches);
+        }
+        auto memoized =
+            std::make_shared<GlobTreeResultCache::Results>(std::move(results));
+        cache->insert(std::move(key), memoized);
+        return memoized->matches;
+      });
+}
+
+void GlobNode::setTreeResultCache(
+    std::shared_ptr<GlobTreeResultCache> cache,
+    uint64_t rootId) {
+  for (auto& child : children_) {
+    child->setTreeResultCache(cache, rootId);
+  }
+  for (auto& child : recursiveChildren_) {
+    child->setTreeResultCache(cache, rootId);
+  }
+  treeResultCache_ = std::move(cache);
+  rootId_ = rootId;
 }
 
 StringPiece GlobNode::tokenize(StringPiece& pattern, bool* hasSpecials) {
@@ -470,7 +610,8 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
     ObjectFetchContext& context,
     RelativePathPiece rootPath,
     ROOT&& root,
-    GlobNode::PrefetchList fileBlobsToPrefetch) {
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    ResultSink* sink) const {
   vector<GlobResult> results;
   if (recursiveChildren_.empty()) {
     return results;
@@ -501,21 +642,14 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
         if (root.entryShouldLoadChildTree(entry)) {
           subDirNames.emplace_back(candidateName);
         } else {
-          futures.emplace_back(
-              store->getTree(root.entryHash(entry), context)
-                  .thenValue([candidateName,
-                              store,
-                              &context,
-                              this,
-                              fileBlobsToPrefetch](
-                                 const std::shared_ptr<const Tree>& tree) {
-                    return evaluateRecursiveComponentImpl(
-                        store,
-                        context,
-                        candidateName,
-                        TreeRoot(tree),
-                        fileBlobsToPrefetch);
-                  }));
+          futures.emplace_back(evaluateTree(
+              store,
+              context,
+              candidateName,
+              root.entryHash(entry),
+              fileBlobsToPrefetch,
+              /*recursive=*/true,
+              sink));
         }
       }
     }
@@ -526,17 +660,27 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
     futures.emplace_back(
         root.getOrLoadChildTree(candidateName.basename())
             .thenValue(
-                [candidateName, store, &context, this, fileBlobsToPrefetch](
-                    TreeInodePtr dir) {
+                [candidateName,
+                 store,
+                 &context,
+                 this,
+                 fileBlobsToPrefetch,
+                 sink](TreeInodePtr dir) {
                   return evaluateRecursiveComponentImpl(
                       store,
                       context,
                       candidateName,
                       TreeInodePtrRoot(dir),
-                      fileBlobsToPrefetch);
+                      fileBlobsToPrefetch,
+                      sink);
                 }));
   }
 
+  if (sink && !results.empty()) {
+    (*sink)(std::move(results));
+    results.clear();
+  }
+
   // Note: we use collectAll() rather than collect() here to make sure that
   // we have really finished all computation before we return a result.
   // Our caller may destroy us after we return, so we can't let errors propagate
@@ -7,6 +7,7 @@
 
 #pragma once
 #include <folly/futures/Future.h>
+#include <functional>
 #include <ostream>
 #include "eden/fs/inodes/InodePtrFwd.h"
 #include "eden/fs/model/Hash.h"
@@ -20,6 +21,8 @@
 namespace facebook {
 namespace eden {
 
+class GlobTreeResultCache;
+
 /** Represents the compiled state of a tree-walking glob operation.
  * We split the glob into path components and build a tree of name
  * matching operations.
@@ -57,6 +60,10 @@ class GlobNode {
         : name(std::move(name)), dtype(dtype) {}
   };
 
+  // Receives batches of results from evaluateStreaming().  It may be called
+  // concurrently from multiple threads.
+  using ResultSink = std::function<void(std::vector<GlobResult>&&)>;
+
   // Compile and add a new glob pattern to the tree.
   // Compilation splits the pattern into nodes, with one node for each
   // directory separator separated path component.
@@ -71,12 +78,15 @@ class GlobNode {
   // prefetched via the ObjectStore layer.  This will not change the
   // materialization or overlay state for children that already have
   // inodes assigned.
+  // Inodes are only loaded for materialized directories.  Directories that
+  // are not materialized are evaluated against their source control Trees,
+  // fetched by hash from the ObjectStore.
   folly::Future<std::vector<GlobResult>> evaluate(
       const ObjectStore* store,
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       TreeInodePtr root,
-      PrefetchList fileBlobsToPrefetch);
+      PrefetchList fileBlobsToPrefetch) const;
 
   // This is the Tree version of the method above
   folly::Future<std::vector<GlobResult>> evaluate(
@@ -84,7 +94,33 @@ class GlobNode {
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       const std::shared_ptr<const Tree>& tree,
-      PrefetchList fileBlobsToPrefetch);
+      PrefetchList fileBlobsToPrefetch) const;
+
+  // Like the TreeInode version of evaluate(), but rather than collecting all
+  // of the matching file names, passes them to sink in batches as each
+  // directory is evaluated.  A file matched by more than one glob may be
+  // passed more than once.
+  // The caller is responsible for ensuring that both this GlobNode and sink
+  // exist until the returned Future is resolved.
+  folly::Future<folly::Unit> evaluateStreaming(
+      const ObjectStore* store,
+      ObjectFetchContext& context,
+      RelativePathPiece rootPath,
+      TreeInodePtr root,
+      PrefetchList fileBlobsToPrefetch,
+      ResultSink& sink) const;
+
+  /**
+   * Memoize the results of evaluating this GlobNode tree against
+   * unmaterialized source control trees in cache.
+   *
+   * rootId must be unique to this GlobNode tree within cache.  This must be
+   * called on the root of the tree after all of its globs have been parsed,
+   * and before it is evaluated.
+   */
+  void setTreeResultCache(
+      std::shared_ptr<GlobTreeResultCache> cache,
+      uint64_t rootId);
 
   /**
    * Print a human-readable description of this GlobNode to stderr.
@@ -123,7 +159,8 @@ class GlobNode {
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       ROOT&& root,
-      PrefetchList fileBlobsToPrefetch);
+      PrefetchList fileBlobsToPrefetch,
+      ResultSink* sink) const;
 
   template <typename ROOT>
   folly::Future<std::vector<GlobResult>> evaluateImpl(
@@ -131,7 +168,22 @@ class GlobNode {
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       ROOT&& root,
-      PrefetchList fileBlobsToPrefetch);
+      PrefetchList fileBlobsToPrefetch,
+      ResultSink* sink) const;
+
+  // Evaluates this node (or, if recursive is true, only its recursive
+  // children) against the source control tree with the given hash, using
+  // the memoized results from treeResultCache_ if there are any.
+  // The private evaluation methods pass their results to sink rather than
+  // returning them if sink is not null.
+  folly::Future<std::vector<GlobResult>> evaluateTree(
+      const ObjectStore* store,
+      ObjectFetchContext& context,
+      RelativePathPiece rootPath,
+      const Hash& treeHash,
+      PrefetchList fileBlobsToPrefetch,
+      bool recursive,
+      ResultSink* sink) const;
 
   void debugDump(int currentDepth) const;
 
@@ -158,6 +210,10 @@ class GlobNode {
   // - this node is "**" or "*"
   // - it was created with includeDotfiles=true.
   bool alwaysMatch_{false};
+  // Set by setTreeResultCache().  treeResultCache_ is null if results are
+  // not memoized.
+  std::shared_ptr<GlobTreeResultCache> treeResultCache_;
+  uint64_t rootId_{0};
 };
 
 // Streaming operators for logging and printing
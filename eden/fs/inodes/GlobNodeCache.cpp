@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/GlobNodeCache.h"
+
+#include <folly/hash/Hash.h>
+#include <algorithm>
+
+namespace facebook {
+namespace eden {
+
+size_t GlobTreeResultCache::KeyHasher::operator()(const Key& key) const {
+  return folly::hash::hash_combine(
+      key.rootId,
+      key.node,
+      key.recursive,
+      std::hash<Hash>{}(key.treeHash),
+      std::hash<RelativePath>{}(key.path));
+}
+
+std::shared_ptr<const GlobTreeResultCache::Results> GlobTreeResultCache::get(
+    const Key& key) {
+  // Looking up an entry moves it to the front of the eviction order, so this
+  // needs the write lock.
+  auto cache = cache_.wlock();
+  auto it = cache->find(key);
+  if (it == cache->end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+void GlobTreeResultCache::insert(
+    Key key,
+    std::shared_ptr<const Results> results) {
+  cache_.wlock()->set(std::move(key), std::move(results));
+}
+
+GlobNodeCache::GlobNodeCache(size_t maxRoots, size_t maxTreeResults)
+    : roots_{maxRoots},
+      treeResults_{std::make_shared<GlobTreeResultCache>(maxTreeResults)} {}
+
+std::shared_ptr<const GlobNode> GlobNodeCache::get(
+    const std::vector<std::string>& globs,
+    bool includeDotfiles) {
+  auto sortedGlobs = globs;
+  std::sort(sortedGlobs.begin(), sortedGlobs.end());
+  sortedGlobs.erase(
+      std::unique(sortedGlobs.begin(), sortedGlobs.end()), sortedGlobs.end());
+
+  // Globs cannot contain a NUL byte, so it can separate them in the key.
+  std::string key{includeDotfiles ? "1" : "0"};
+  for (const auto& glob : sortedGlobs) {
+    key.push_back('\0');
+    key.append(glob);
+  }
+
+  {
+    auto roots = roots_.wlock();
+    auto it = roots->find(key);
+    if (it != roots->end()) {
+      return it->second;
+    }
+  }
+
+  // Compile without holding the lock.  If another thread compiles the same
+  // globs concurrently, the last one to finish replaces the other's entry.
+  auto root = std::make_shared<GlobNode>(includeDotfiles);
+  for (const auto& glob : sortedGlobs) {
+    root->parse(glob);
+  }
+  root->setTreeResultCache(treeResults_, nextRootId_.fetch_add(1));
+
+  std::shared_ptr<const GlobNode> result = std::move(root);
+  roots_.wlock()->set(std::move(key), result);
+  return result;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "eden/fs/inodes/GlobNode.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Memoized results of evaluating the GlobNodes held by a GlobNodeCache
+ * against source control trees.
+ *
+ * A tree's contents never change, so evaluating the same glob against the
+ * same tree at the same path always produces the same results.  Only trees
+ * that are not materialized are evaluated as source control trees, so
+ * repeated globs over clean directories become lookups here.
+ *
+ * GlobTreeResultCache is thread-safe.
+ */
+class GlobTreeResultCache {
+ public:
+  struct Key {
+    /** Identifies the compiled glob that node belongs to. */
+    uint64_t rootId;
+    const GlobNode* node;
+    /** Whether these are the results of node's recursive children. */
+    bool recursive;
+    Hash treeHash;
+    RelativePath path;
+
+    bool operator==(const Key& other) const {
+      return rootId == other.rootId && node == other.node &&
+          recursive == other.recursive && treeHash == other.treeHash &&
+          path == other.path;
+    }
+  };
+
+  struct KeyHasher {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Results {
+    std::vector<GlobNode::GlobResult> matches;
+    /** The blobs the evaluation asked to prefetch. */
+    std::vector<Hash> blobsToPrefetch;
+  };
+
+  /**
+   * Evaluations that match more than this many entries are not memoized.
+   * Memoizing them would mostly duplicate the results already memoized for
+   * their subtrees.
+   */
+  static constexpr size_t kMaxMemoizedMatches = 256;
+
+  explicit GlobTreeResultCache(size_t maxEntries) : cache_{maxEntries} {}
+
+  GlobTreeResultCache(const GlobTreeResultCache&) = delete;
+  GlobTreeResultCache& operator=(const GlobTreeResultCache&) = delete;
+
+  /** Returns the memoized results for key, or nullptr if there are none. */
+  std::shared_ptr<const Results> get(const Key& key);
+
+  void insert(Key key, std::shared_ptr<const Results> results);
+
+ private:
+  folly::Synchronized<folly::EvictingCacheMap<
+      Key,
+      std::shared_ptr<const Results>,
+      KeyHasher>>
+      cache_;
+};
+
+/**
+ * A cache of compiled GlobNode trees, keyed by the set of glob patterns they
+ * were compiled from.
+ *
+ * Tools such as buck issue the same sets of globs over and over.  Sharing the
+ * compiled trees across calls saves recompiling them, and lets their results
+ * for unmaterialized trees be memoized in a GlobTreeResultCache.
+ *
+ * GlobNodeCache is thread-safe.
+ */
+class GlobNodeCache {
+ public:
+  GlobNodeCache(size_t maxRoots, size_t maxTreeResults);
+
+  GlobNodeCache(const GlobNodeCache&) = delete;
+  GlobNodeCache& operator=(const GlobNodeCache&) = delete;
+
+  /**
+   * Returns a GlobNode tree compiled from globs, compiling and caching it if
+   * it is not already cached.  The order of globs does not matter.
+   *
+   * Throws std::system_error if one of the globs is invalid.
+   */
+  std::shared_ptr<const GlobNode> get(
+      const std::vector<std::string>& globs,
+      bool includeDotfiles);
+
+ private:
+  folly::Synchronized<
+      folly::EvictingCacheMap<std::string, std::shared_ptr<const GlobNode>>>
+      roots_;
+  std::shared_ptr<GlobTreeResultCache> treeResults_;
+  std::atomic<uint64_t> nextRootId_{1};
+};
+
+} // namespace eden
+} // namespace facebook
@@ -218,9 +218,22 @@ std::unique_ptr<InodeBase> InodeBase::markUnlinked(
     TreeInode* parent,
     PathComponentPiece name,
     const RenameLock& renameLock) {
-  XLOG(DBG5) << "inode " << this << " unlinked: " << getLogPath();
   DCHECK(renameLock.isHeld(mount_));
+  return markUnlinkedImpl(parent, name);
+}
+
+std::unique_ptr<InodeBase> InodeBase::markUnlinked(
+    TreeInode* parent,
+    PathComponentPiece name,
+    const SharedRenameLock& renameLock) {
+  DCHECK(renameLock.isHeld(mount_));
+  return markUnlinkedImpl(parent, name);
+}
 
+std::unique_ptr<InodeBase> InodeBase::markUnlinkedImpl(
+    TreeInode* parent,
+    PathComponentPiece name) {
+  XLOG(DBG5) << "inode " << this << " unlinked: " << getLogPath();
   {
     auto loc = location_.wlock();
     DCHECK(!loc->unlinked);
@@ -270,6 +283,20 @@ void InodeBase::updateLocation(
   loc->name = newName.copy();
 }
 
+void InodeBase::updateName(
+    TreeInode* parent,
+    PathComponentPiece newName,
+    const SharedRenameLock& renameLock) {
+  XLOG(DBG5) << "inode " << this << " renamed: " << getLogPath() << " --> "
+             << parent->getLogPath() << " / \"" << newName << "\"";
+  DCHECK(renameLock.isHeld(mount_));
+
+  auto loc = location_.wlock();
+  DCHECK(!loc->unlinked);
+  DCHECK_EQ(loc->parent.get(), parent);
+  loc->name = newName.copy();
+}
+
 void InodeBase::onPtrRefZero() const {
   // onPtrRefZero() is const since we treat incrementing and decrementing the
   // pointer refcount as a non-modifying operation.  (The refcount is updated
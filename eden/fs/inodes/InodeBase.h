@@ -186,6 +186,16 @@ class InodeBase {
       PathComponentPiece name,
       const RenameLock& renameLock);
 
+  /**
+   * A version of markUnlinked() for renames within a single directory, which
+   * only hold the rename lock in shared mode.  The caller must hold the
+   * parent's contents lock.
+   */
+  std::unique_ptr<InodeBase> markUnlinked(
+      TreeInode* parent,
+      PathComponentPiece name,
+      const SharedRenameLock& renameLock);
+
   /**
    * This method should only be called by TreeInode::loadUnlinkedChildInode().
    * Its purpose is to set the unlinked flag to true for inodes that have
@@ -204,6 +214,18 @@ class InodeBase {
       PathComponentPiece newName,
       const RenameLock& renameLock);
 
+  /**
+   * Rename this inode within its current parent directory.
+   *
+   * Holders of the rename lock in shared mode may rely on an inode's parent
+   * staying the same, so this may only change its name.  The caller must hold
+   * the parent's contents lock.
+   */
+  void updateName(
+      TreeInode* parent,
+      PathComponentPiece newName,
+      const SharedRenameLock& renameLock);
+
   /**
    * Check to see if the ptrAcquire reference count is zero.
    *
@@ -372,6 +394,10 @@ class InodeBase {
   InodeTimestamps updateMtimeAndCtime(timespec now);
 #endif
 
+  std::unique_ptr<InodeBase> markUnlinkedImpl(
+      TreeInode* parent,
+      PathComponentPiece name);
+
   template <typename InodeType>
   friend class InodePtrImpl;
   friend class InodePtrTestHelper;
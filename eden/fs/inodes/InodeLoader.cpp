@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/InodeLoader.h"
+
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/ObjectStore.h"
+
+using folly::Future;
+using folly::Try;
+using std::unique_ptr;
+
+namespace facebook {
+namespace eden {
+
+namespace detail {
+
+namespace {
+folly::exception_wrapper noSuchEntry() {
+  return folly::make_exception_wrapper<std::system_error>(
+      ENOENT, std::generic_category());
+}
+} // namespace
+
+Future<ResolvedEntry> EntryLoader::load(RelativePathPiece path) {
+  EntryLoader* parent = this;
+  for (auto name : path.components()) {
+    parent = parent->getOrCreateChild(name);
+  }
+
+  parent->promises_.emplace_back();
+  return parent->promises_.back().getFuture();
+}
+
+EntryLoader* EntryLoader::getOrCreateChild(PathComponentPiece name) {
+  auto child = folly::get_ptr(children_, name);
+  if (child) {
+    return child->get();
+  }
+  auto ret = children_.emplace(name, std::make_unique<EntryLoader>());
+  return ret.first->second.get();
+}
+
+void EntryLoader::loaded(
+    unique_ptr<EntryLoader> loader,
+    Try<ResolvedEntry> entry,
+    EdenMount* mount,
+    ObjectFetchContext& context) {
+  Batch batch;
+  batch.emplace_back(std::move(loader), std::move(entry));
+  loadedBatch(std::move(batch), mount, context);
+}
+
+void EntryLoader::failed(const folly::exception_wrapper& error) {
+  for (auto& promise : promises_) {
+    promise.setException(error);
+  }
+  for (auto& entry : children_) {
+    entry.second->failed(error);
+  }
+}
+
+void EntryLoader::childrenOfInode(
+    const TreeInodePtr& tree,
+    EdenMount* mount,
+    ObjectFetchContext& context) {
+  Batch batch;
+  std::vector<std::pair<unique_ptr<EntryLoader>, PathComponentPiece>> toLoad;
+  {
+    auto contents = tree->getContents().rlock();
+    for (auto& [name, child] : children_) {
+      auto iter = contents->entries.find(name);
+      if (iter == contents->entries.end() || iter->second.isMaterialized()) {
+        // Let getOrLoadChild() report the error for a missing entry, or
+        // find the special .eden entry in a subdirectory.
+        toLoad.emplace_back(std::move(child), name);
+        continue;
+      }
+
+      const auto& dirEntry = iter->second;
+      if (dirEntry.getInode()) {
+        batch.emplace_back(
+            std::move(child), ResolvedEntry{dirEntry.getInodePtr()});
+        continue;
+      }
+
+      ResolvedEntry resolved;
+      resolved.mode = dirEntry.getInitialMode();
+      resolved.hash = dirEntry.getHash();
+      resolved.inodeNumber = dirEntry.getInodeNumber();
+      batch.emplace_back(std::move(child), std::move(resolved));
+    }
+  }
+
+  for (auto& entry : toLoad) {
+    auto name = entry.second;
+    loadedInode(
+        std::move(entry.first),
+        folly::makeFutureWith([&] { return tree->getOrLoadChild(name); }),
+        mount,
+        context);
+  }
+  loadedBatch(std::move(batch), mount, context);
+}
+
+void EntryLoader::childrenOfTree(
+    const Try<std::shared_ptr<const Tree>>& tree,
+    EdenMount* mount,
+    ObjectFetchContext& context) {
+  if (tree.hasException()) {
+    for (auto& entry : children_) {
+      entry.second->failed(tree.exception());
+    }
+    return;
+  }
+
+  Batch batch;
+  for (auto& [name, child] : children_) {
+#ifndef _WIN32
+    if (name == kDotEdenName) {
+      // As in TreeInode::getOrLoadChild(), .eden in any subdirectory is the
+      // symlink back to the root's .eden directory.
+      loadedInode(
+          std::move(child),
+          mount->getInode(".eden/this-dir"_relpath),
+          mount,
+          context);
+      continue;
+    }
+#endif // !_WIN32
+
+    auto treeEntry = tree.value()->getEntryPtr(name);
+    if (!treeEntry) {
+      batch.emplace_back(std::move(child), Try<ResolvedEntry>(noSuchEntry()));
+      continue;
+    }
+
+    ResolvedEntry resolved;
+    resolved.mode = modeFromTreeEntryType(treeEntry->getType());
+    resolved.hash = treeEntry->getHash();
+    resolved.size = treeEntry->getSize();
+    resolved.sha1 = treeEntry->getContentSha1();
+    batch.emplace_back(std::move(child), std::move(resolved));
+  }
+  loadedBatch(std::move(batch), mount, context);
+}
+
+void EntryLoader::loadedInode(
+    unique_ptr<EntryLoader> loader,
+    Future<InodePtr> inode,
+    EdenMount* mount,
+    ObjectFetchContext& context) {
+  std::move(inode).thenTry([loader = std::move(loader), mount, &context](
+                               Try<InodePtr>&& inode) mutable {
+    auto entry = inode.hasValue()
+        ? Try<ResolvedEntry>(ResolvedEntry{std::move(inode).value()})
+        : Try<ResolvedEntry>(std::move(inode).exception());
+    loaded(std::move(loader), std::move(entry), mount, context);
+  });
+}
+
+void EntryLoader::loadedBatch(
+    Batch batch,
+    EdenMount* mount,
+    ObjectFetchContext& context) {
+  std::vector<Hash> treeIds;
+  std::vector<unique_ptr<EntryLoader>> treeLoaders;
+  for (auto& [loader, entry] : batch) {
+    if (entry.hasException()) {
+      loader->failed(entry.exception());
+      continue;
+    }
+
+    for (auto& promise : loader->promises_) {
+      promise.setValue(entry.value());
+    }
+    if (loader->children_.empty()) {
+      continue;
+    }
+
+    if (entry->inode) {
+      if (auto tree = entry->inode.asTreePtrOrNull()) {
+        loader->childrenOfInode(tree, mount, context);
+        continue;
+      }
+    } else if (entry->getDtype() == dtype_t::Dir) {
+      treeIds.push_back(entry->hash);
+      treeLoaders.push_back(std::move(loader));
+      continue;
+    }
+
+    // This entry is not a tree but we're trying to resolve children;
+    // generate failures for these
+    for (auto& child : loader->children_) {
+      child.second->failed(noSuchEntry());
+    }
+  }
+
+  if (treeIds.empty()) {
+    return;
+  }
+  auto trees = mount->getObjectStore()->getTrees(treeIds, context);
+  for (size_t i = 0; i < trees.size(); ++i) {
+    std::move(trees[i]).thenTry(
+        [loader = std::move(treeLoaders[i]), mount, &context](
+            Try<std::shared_ptr<const Tree>>&& tree) {
+          loader->childrenOfTree(tree, mount, context);
+        });
+  }
+}
+
+} // namespace detail
+
+std::vector<folly::SemiFuture<ResolvedEntry>> resolveEntries(
+    TreeInodePtr rootInode,
+    const std::vector<std::string>& paths,
+    ObjectFetchContext& context) {
+  auto loader = std::make_unique<detail::EntryLoader>();
+
+  std::vector<folly::SemiFuture<ResolvedEntry>> results;
+  results.reserve(paths.size());
+  for (const auto& path : paths) {
+    results.emplace_back(loader->load(path));
+  }
+
+  auto* mount = rootInode->getMount();
+  detail::EntryLoader::loaded(
+      std::move(loader),
+      Try<ResolvedEntry>(ResolvedEntry{std::move(rootInode)}),
+      mount,
+      context);
+
+  return results;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -11,13 +11,43 @@
 #include <folly/MapUtil.h>
 #include <folly/functional/Invoke.h>
 #include <folly/futures/Future.h>
+#include <optional>
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/DirType.h"
 #include "eden/fs/utils/PathMap.h"
 
 namespace facebook {
 namespace eden {
 
+class EdenMount;
+class ObjectFetchContext;
+class Tree;
+
+/** What resolveEntries() found for one path.
+ * If the inode for the path is loaded or materialized then `inode` is set
+ * and the other fields are unused.  Otherwise the path is unchanged from
+ * source control, and it is described by its source control object without
+ * an inode being loaded for it.
+ */
+struct ResolvedEntry {
+  InodePtr inode;
+  // The initial mode of the entry, as its inode would be created with.
+  mode_t mode{0};
+  Hash hash;
+  // Set if the directory containing the entry is loaded, and so has already
+  // allocated an inode number for it.
+  std::optional<InodeNumber> inodeNumber;
+  // The size and SHA-1 of a file, if its source control tree records them.
+  std::optional<uint64_t> size;
+  std::optional<Hash> sha1;
+
+  dtype_t getDtype() const {
+    return inode ? inode->getType() : mode_to_dtype(mode);
+  }
+};
+
 namespace detail {
 
 /** InodeLoader is a helper class for minimizing the number
@@ -113,6 +143,74 @@ class InodeLoader {
   }
 };
 
+/** EntryLoader builds the same plan as InodeLoader, but resolves the
+ * entries that are unchanged from source control by walking their source
+ * control trees rather than by loading inodes.  The trees needed by the
+ * children of one directory are fetched in a single batch.
+ */
+class EntryLoader {
+ public:
+  EntryLoader() = default;
+
+  // Arrange to resolve the input path
+  folly::Future<ResolvedEntry> load(RelativePathPiece path);
+
+  // Arrange to resolve the input path, given a stringy input.  If the path
+  // is not well formed then the error is recorded in the returned future.
+  folly::Future<ResolvedEntry> load(folly::StringPiece path) {
+    return folly::makeFutureWith([&] { return load(RelativePathPiece(path)); });
+  }
+
+  // Called to signal that the entry for loader has been resolved.  This
+  // fulfills its promises and then resolves its children, if it has any.
+  // The loader is kept alive until all of its children are resolved, and
+  // mount and context must remain valid until then too.
+  static void loaded(
+      std::unique_ptr<EntryLoader> loader,
+      folly::Try<ResolvedEntry> entry,
+      EdenMount* mount,
+      ObjectFetchContext& context);
+
+ private:
+  using Batch = std::vector<
+      std::pair<std::unique_ptr<EntryLoader>, folly::Try<ResolvedEntry>>>;
+
+  // Any child nodes that we need to resolve; see InodeLoader::children_.
+  PathMap<std::unique_ptr<EntryLoader>> children_;
+  // promises for the resolution attempts
+  std::vector<folly::Promise<ResolvedEntry>> promises_;
+
+  // Helper for building out the plan during parsing
+  EntryLoader* getOrCreateChild(PathComponentPiece name);
+
+  // Fail the promises of this node and all of its children with error
+  void failed(const folly::exception_wrapper& error);
+
+  // Resolve the children of this node against its loaded directory inode
+  void childrenOfInode(
+      const TreeInodePtr& tree,
+      EdenMount* mount,
+      ObjectFetchContext& context);
+
+  // Resolve the children of this node against its source control tree
+  void childrenOfTree(
+      const folly::Try<std::shared_ptr<const Tree>>& tree,
+      EdenMount* mount,
+      ObjectFetchContext& context);
+
+  // Call loaded() for loader once inode has been loaded for it
+  static void loadedInode(
+      std::unique_ptr<EntryLoader> loader,
+      folly::Future<InodePtr> inode,
+      EdenMount* mount,
+      ObjectFetchContext& context);
+
+  // Call loaded() for each of the resolved children of one directory,
+  // fetching all of the source control trees that they need in one batch.
+  static void
+  loadedBatch(Batch batch, EdenMount* mount, ObjectFetchContext& context);
+};
+
 } // namespace detail
 
 /** Given a `rootInode` and a list of `paths` relative to that root,
@@ -149,5 +247,20 @@ auto applyToInodes(
   return results;
 }
 
+/** Given a `rootInode` and a list of `paths` relative to that root,
+ * resolve each path to its inode or, if it is unchanged from source control
+ * and not loaded, to the source control entry that describes it.
+ * Like applyToInodes(), each directory is visited once no matter how many
+ * of the paths pass through it, but no inodes are loaded below a directory
+ * that is neither loaded nor materialized.
+ * `context` must remain valid until all of the results are ready.
+ * Index 0 of the results corresponds to `paths[0]`, and so on for each of
+ * the input paths.
+ */
+std::vector<folly::SemiFuture<ResolvedEntry>> resolveEntries(
+    TreeInodePtr rootInode,
+    const std::vector<std::string>& paths,
+    ObjectFetchContext& context);
+
 } // namespace eden
 } // namespace facebook
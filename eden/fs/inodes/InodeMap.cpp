@@ -41,12 +41,11 @@ InodeMap::UnloadedInode::UnloadedInode(
     mode_t mode,
     std::optional<Hash> hash,
     uint32_t fuseRefcount)
-    : parent(parentNum),
-      name(entryName),
-      isUnlinked{isUnlinked},
-      mode{mode},
-      hash{hash},
-      numFuseReferences{fuseRefcount} {}
+    : parent(parentNum), name(entryName), numFuseReferences{fuseRefcount} {
+  if (isUnlinked) {
+    unlinked = std::make_unique<UnlinkedData>(UnlinkedData{mode, hash});
+  }
+}
 
 InodeMap::UnloadedInode::UnloadedInode(
     TreeInode* parent,
@@ -56,14 +55,16 @@ InodeMap::UnloadedInode::UnloadedInode(
     uint32_t fuseRefcount)
     : parent{parent->getNodeId()},
       name{entryName},
-      isUnlinked{isUnlinked},
-      // There is no asTree->getMode() we can call,
-      // however, directories are always represented with
-      // this specific mode bit pattern in eden so we can
-      // force the value down here.
-      mode{S_IFDIR | 0755},
-      hash{hash},
-      numFuseReferences{fuseRefcount} {}
+      numFuseReferences{fuseRefcount} {
+  if (isUnlinked) {
+    // There is no asTree->getMode() we can call,
+    // however, directories are always represented with
+    // this specific mode bit pattern in eden so we can
+    // force the value down here.
+    unlinked =
+        std::make_unique<UnlinkedData>(UnlinkedData{S_IFDIR | 0755, hash});
+  }
+}
 
 InodeMap::UnloadedInode::UnloadedInode(
     FileInode* inode,
@@ -73,10 +74,27 @@ InodeMap::UnloadedInode::UnloadedInode(
     uint32_t fuseRefcount)
     : parent{parent->getNodeId()},
       name{entryName},
-      isUnlinked{isUnlinked},
-      mode{inode->getMode()},
-      hash{inode->getBlobHash()},
-      numFuseReferences{fuseRefcount} {}
+      numFuseReferences{fuseRefcount} {
+  if (isUnlinked) {
+    unlinked = std::make_unique<UnlinkedData>(
+        UnlinkedData{inode->getMode(), inode->getBlobHash()});
+  }
+}
+
+folly::Promise<InodePtr>& InodeMap::UnloadedInode::addPromise() {
+  if (!promises) {
+    promises = std::make_unique<PromiseVector>();
+  }
+  return promises->emplace_back();
+}
+
+InodeMap::PromiseVector InodeMap::UnloadedInode::takePromises() {
+  PromiseVector result;
+  if (promises) {
+    swap(result, *promises);
+  }
+  return result;
+}
 
 InodeMap::InodeMap(EdenMount* mount) : mount_{mount} {}
 
@@ -176,19 +194,23 @@ void InodeMap::initializeFromTakeover(
 }
 
 Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
+  // Most lookups are for inodes that are already loaded.  Serve those under
+  // the read lock so that concurrent lookups do not serialize on data_.
+  if (auto inode = lookupLoadedInode(number)) {
+    return folly::makeFuture<InodePtr>(std::move(inode));
+  }
+
   // Lock the data.
   // We hold it while doing most of our work below, but explicitly unlock it
   // before triggering inode loading or before fulfilling any Promises.
   auto data = data_.wlock();
 
-  // Check to see if this Inode is already loaded
+  // Check again now that we hold the write lock: the inode may have finished
+  // loading since we released the read lock.
   auto loadedIter = data->loadedInodes_.find(number);
   if (loadedIter != data->loadedInodes_.end()) {
     // Make a copy of the InodePtr with the lock held, then release the lock
     // before calling makeFuture().
-    //
-    // This code path should be quite common, so it's better to perform
-    // makeFuture()'s memory allocation without the lock held.
     auto result = loadedIter->second.getPtr();
     data.unlock();
     return folly::makeFuture<InodePtr>(std::move(result));
@@ -206,11 +228,10 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
 
   // Check to see if anyone else has already started loading this inode.
   auto* unloadedData = &unloadedIter->second;
-  bool alreadyLoading = !unloadedData->promises.empty();
+  bool alreadyLoading = unloadedData->isLoading();
 
   // Add a new entry to the promises list.
-  unloadedData->promises.emplace_back();
-  auto result = unloadedData->promises.back().getFuture();
+  auto result = unloadedData->addPromise().getFuture();
 
   // If someone else has already started loading this inode we are done.
   // The current loading attempt will signal our promise when it completes.
@@ -239,9 +260,9 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
       // with the lock still held.
       InodePtr firstLoadedParent = loadedIter->second.getPtr();
       PathComponent requiredChildName = unloadedData->name;
-      bool isUnlinked = unloadedData->isUnlinked;
-      auto optionalHash = unloadedData->hash;
-      auto mode = unloadedData->mode;
+      bool isUnlinked = unloadedData->isUnlinked();
+      auto optionalHash = unloadedData->getHash();
+      auto mode = unloadedData->getMode();
       // Unlock the data before starting the child lookup
       data.unlock();
       // Trigger the lookup, then return to our caller.
@@ -270,19 +291,18 @@ Future<InodePtr> InodeMap::lookupInode(InodeNumber number) {
     }
 
     auto* parentData = &unloadedIter->second;
-    alreadyLoading = !parentData->promises.empty();
+    alreadyLoading = parentData->isLoading();
 
     // Add a new entry to the promises list.
     // It should kick off loading of the current child inode when
     // it is fulfilled.
-    parentData->promises.emplace_back();
     setupParentLookupPromise(
-        parentData->promises.back(),
+        parentData->addPromise(),
         unloadedData->name,
-        unloadedData->isUnlinked,
+        unloadedData->isUnlinked(),
         childInodeNumber,
-        unloadedData->hash,
-        unloadedData->mode);
+        unloadedData->getHash(),
+        unloadedData->getMode());
 
     if (alreadyLoading) {
       // This parent is already being loaded.
@@ -358,7 +378,7 @@ InodeMap::PromiseVector InodeMap::inodeLoadComplete(InodeBase* inode) {
     CHECK(it != data->unloadedInodes_.end())
         << "failed to find unloaded inode data when finishing load of inode "
         << number;
-    swap(promises, it->second.promises);
+    promises = it->second.takePromises();
 
     inode->setFuseRefcount(it->second.numFuseReferences);
 
@@ -396,7 +416,7 @@ InodeMap::PromiseVector InodeMap::extractPendingPromises(InodeNumber number) {
     CHECK(it != data->unloadedInodes_.end())
         << "failed to find unloaded inode data when finishing load of inode "
         << number;
-    swap(promises, it->second.promises);
+    promises = it->second.takePromises();
   }
   return promises;
 }
@@ -451,7 +471,7 @@ std::optional<RelativePath> InodeMap::getPathForInodeHelper(
   } else {
     auto unloadedIt = data->unloadedInodes_.find(inodeNumber);
     if (unloadedIt != data->unloadedInodes_.cend()) {
-      if (unloadedIt->second.isUnlinked) {
+      if (unloadedIt->second.isUnlinked()) {
         return std::nullopt;
       }
       // If the inode is not loaded, return its parent's path as long as it's
@@ -474,6 +494,14 @@ std::optional<RelativePath> InodeMap::getPathForInodeHelper(
 }
 
 void InodeMap::decFuseRefcount(InodeNumber number, uint32_t count) {
+  // Loaded inodes track their FUSE refcount themselves, so only the read lock
+  // is needed to find them.  See below for why we hold an InodePtr while
+  // decrementing.
+  if (auto inode = lookupLoadedInode(number)) {
+    inode->decFuseRefcount(count);
+    return;
+  }
+
   auto data = data_.wlock();
 
   // First check in the loaded inode map
@@ -626,10 +654,12 @@ Future<SerializedInodeMap> InodeMap::shutdown(bool doTakeover) {
       *serializedEntry.inodeNumber_ref() = inodeNumber.get();
       *serializedEntry.parentInode_ref() = entry.parent.get();
       *serializedEntry.name_ref() = entry.name.stringPiece().str();
-      *serializedEntry.isUnlinked_ref() = entry.isUnlinked;
+      *serializedEntry.isUnlinked_ref() = entry.isUnlinked();
       *serializedEntry.numFuseReferences_ref() = entry.numFuseReferences;
-      *serializedEntry.hash_ref() = thriftHash(entry.hash);
-      *serializedEntry.mode_ref() = entry.mode;
+      // Linked entries have no mode or hash.  Like this one, older versions
+      // only read them for unlinked entries.
+      *serializedEntry.hash_ref() = thriftHash(entry.getHash());
+      *serializedEntry.mode_ref() = entry.getMode();
 
       result.unloadedInodes_ref()->emplace_back(std::move(serializedEntry));
     }
@@ -882,10 +912,10 @@ bool InodeMap::shouldLoadChild(
     unloadedData = &iter->second;
   }
 
-  bool isFirstPromise = unloadedData->promises.empty();
+  bool isFirstPromise = !unloadedData->isLoading();
 
   // Add the promise to the existing list for this inode.
-  unloadedData->promises.push_back(std::move(promise));
+  unloadedData->addPromise() = std::move(promise);
 
   // If this is the very first promise then tell the caller they need
   // to start the load operation.  Otherwise someone else (whoever added the
@@ -893,6 +923,30 @@ bool InodeMap::shouldLoadChild(
   return isFirstPromise;
 }
 
+void InodeMap::incUnloadedChildFuseRefcount(
+    const TreeInode* parent,
+    PathComponentPiece name,
+    InodeNumber childInode,
+    mode_t mode,
+    std::optional<Hash> hash) {
+  auto data = data_.wlock();
+  DCHECK(data->loadedInodes_.find(childInode) == data->loadedInodes_.end());
+  auto iter = data->unloadedInodes_.find(childInode);
+  if (iter == data->unloadedInodes_.end()) {
+    data->unloadedInodes_.emplace(
+        childInode,
+        UnloadedInode(
+            parent->getNodeId(),
+            name,
+            /*isUnlinked=*/false,
+            mode,
+            hash,
+            /*fuseRefcount=*/1));
+  } else {
+    ++iter->second.numFuseReferences;
+  }
+}
+
 void InodeMap::inodeCreated(const InodePtr& inode) {
   XLOG(DBG4) << "created new inode " << inode->getNodeId() << ": "
              << inode->getLogPath();
@@ -908,6 +962,8 @@ InodeMap::InodeCounts InodeMap::getInodeCounts() const {
   counts.treeCount = data->numTreeInodes_;
   counts.fileCount = data->numFileInodes_;
   counts.unloadedInodeCount = data->unloadedInodes_.size();
+  counts.fileInodeBytes = counts.fileCount * sizeof(FileInode);
+  counts.treeInodeBytes = counts.treeCount * sizeof(TreeInode);
   return counts;
 }
 
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <folly/futures/Future.h>
 #include <list>
 #include <memory>
@@ -373,10 +374,34 @@ class InodeMap {
 
   void inodeCreated(const InodePtr& inode);
 
+  /**
+   * incUnloadedChildFuseRefcount() should only be called by TreeInode.
+   *
+   * Records that a lookup() returned the number of a child inode that is
+   * not loaded, so that it can be loaded later from its parent.  This is the
+   * counterpart of InodeBase::incFuseRefcount() for unloaded inodes.
+   *
+   * The TreeInode must be holding its contents lock when calling this method,
+   * and the child must not be loaded.
+   */
+  void incUnloadedChildFuseRefcount(
+      const TreeInode* parent,
+      PathComponentPiece name,
+      InodeNumber childInode,
+      mode_t mode,
+      std::optional<Hash> hash);
+
   struct InodeCounts {
     size_t fileCount = 0;
     size_t treeCount = 0;
     size_t unloadedInodeCount = 0;
+    /**
+     * The bytes used by the loaded FileInode and TreeInode objects
+     * themselves.  Memory allocated on their behalf, such as a TreeInode's
+     * directory entries, is not included.
+     */
+    size_t fileInodeBytes = 0;
+    size_t treeInodeBytes = 0;
   };
 
   /**
@@ -399,6 +424,13 @@ class InodeMap {
    *
    * Note that this is different from the public UnloadedInodeData type which
    * we return to callers.  This class tracks more state.
+   *
+   * After something like `find /`, the kernel can hold references to
+   * millions of inodes that must be remembered here, so this only stores
+   * what most entries need inline.  The mode and hash of an entry only
+   * matter for unlinked inodes, since linked ones are loaded from the entry
+   * in their parent's directory, which has both, and pending load promises
+   * only exist while the inode is being loaded.
    */
   struct UnloadedInode {
     UnloadedInode(InodeNumber parentNum, PathComponentPiece entryName);
@@ -422,43 +454,75 @@ class InodeMap {
         bool isUnlinked,
         uint32_t fuseRefcount);
 
-    InodeNumber const parent;
-    PathComponent const name;
+    UnloadedInode(UnloadedInode&&) = default;
+    UnloadedInode& operator=(UnloadedInode&&) = default;
 
     /**
      * A boolean indicating if this inode is unlinked.
      */
-    bool const isUnlinked{false};
+    bool isUnlinked() const {
+      return unlinked != nullptr;
+    }
 
-    /** The complete st_mode value for this entry */
-    mode_t const mode{0};
+    /**
+     * The complete st_mode value for this entry, if it is unlinked, and 0
+     * otherwise.
+     */
+    mode_t getMode() const {
+      return unlinked ? unlinked->mode : 0;
+    }
 
     /**
-     * If the entry is not materialized, this contains the hash
-     * identifying the source control Tree (if this is a directory) or Blob
-     * (if this is a file) that contains the entry contents.
-     *
-     * If the entry is materialized, this field is not set.
+     * If the entry is unlinked and not materialized, the hash identifying
+     * the source control Tree (if this is a directory) or Blob (if this is a
+     * file) that contains the entry contents.
      */
-    std::optional<Hash> const hash;
+    std::optional<Hash> getHash() const {
+      return unlinked ? unlinked->hash : std::nullopt;
+    }
 
     /**
-     * A list of promises waiting on this inode to be loaded.
-     *
-     * If this list is non-empty then the inode is currently in the process of
-     * being loaded.
-     *
-     * (We could use folly::SharedPromise here instead, but it has extra
-     * overhead that we don't really need.  It performs its own locking, but we
-     * are already protected by the data_ lock.)
+     * Whether the inode is currently in the process of being loaded, that
+     * is, whether any promises are waiting on it.
      */
-    PromiseVector promises;
+    bool isLoading() const {
+      return promises && !promises->empty();
+    }
+
+    /** Adds a promise waiting on this inode to be loaded. */
+    folly::Promise<InodePtr>& addPromise();
+
+    /** Removes and returns the promises waiting on this inode. */
+    PromiseVector takePromises();
+
+    InodeNumber parent;
+    PathComponent name;
+
     /**
      * The number of times we have returned this inode number to FUSE via
      * lookup() calls that have not yet been released with a corresponding
      * forget().
      */
     uint32_t numFuseReferences{0};
+
+   private:
+    struct UnlinkedData {
+      mode_t mode;
+      std::optional<Hash> hash;
+    };
+
+    /** Null unless the inode is unlinked. */
+    std::unique_ptr<UnlinkedData> unlinked;
+
+    /**
+     * A list of promises waiting on this inode to be loaded, or null if no
+     * load has been started since the entry was created.
+     *
+     * (We could use folly::SharedPromise here instead, but it has extra
+     * overhead that we don't really need.  It performs its own locking, but we
+     * are already protected by the data_ lock.)
+     */
+    std::unique_ptr<PromiseVector> promises;
   };
 
   struct LoadedInode {
@@ -507,8 +571,12 @@ class InodeMap {
 
     /**
      * The map of currently unloaded inodes
+     *
+     * This is an open addressing table that stores its entries in one array,
+     * rather than allocating a node per entry.  Inserting or erasing entries
+     * invalidates pointers to the others.
      */
-    std::unordered_map<InodeNumber, UnloadedInode> unloadedInodes_;
+    folly::F14FastMap<InodeNumber, UnloadedInode> unloadedInodes_;
 
     /**
      * Indicates if the FUSE mount point has been unmounted.
@@ -635,6 +703,9 @@ class InodeMap {
    * since we should not hold our lock while an InodeBase acquires its own
    * internal lock.  (This makes it safe for InodeBase to perform operations on
    * the InodeMap while holding their own lock.)
+   *
+   * Lookups of already loaded inodes only need the read lock, which keeps
+   * parallel FUSE lookups and forgets from serializing on each other.
    */
   folly::Synchronized<Members> data_;
 };
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/InodePathCache.h"
+
+namespace facebook {
+namespace eden {
+
+std::optional<InodeNumber> InodePathCache::get(RelativePathPiece path) {
+  if (!enabled_) {
+    return std::nullopt;
+  }
+  // Looking up an entry moves it to the front of the eviction order, so this
+  // needs the write lock.
+  auto cache = cache_.wlock();
+  auto it = cache->find(RelativePath{path});
+  if (it == cache->end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void InodePathCache::insert(RelativePathPiece path, InodeNumber number) {
+  if (!enabled_) {
+    return;
+  }
+  cache_.wlock()->set(RelativePath{path}, number);
+}
+
+void InodePathCache::invalidate(RelativePathPiece path) {
+  if (!enabled_) {
+    return;
+  }
+  cache_.wlock()->erase(RelativePath{path});
+}
+
+} // namespace eden
+} // namespace facebook
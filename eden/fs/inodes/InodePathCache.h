@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <optional>
+
+#include "eden/fs/fuse/InodeNumber.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * The inode numbers of recently resolved paths, so that EdenMount::getInode()
+ * does not have to walk and lock every directory from the root each time a
+ * thrift call names the same path.
+ *
+ * Entries are only hints.  A user must check that the inode it finds is still
+ * at the path, since a rename or unlink of any ancestor moves it without
+ * invalidating the entry.  Renames and unlinks of the path itself do
+ * invalidate it, so that hot paths do not keep missing after a change.
+ *
+ * InodePathCache is thread-safe.
+ */
+class InodePathCache {
+ public:
+  /** A maxEntries of 0 disables the cache. */
+  explicit InodePathCache(size_t maxEntries)
+      : enabled_{maxEntries > 0}, cache_{maxEntries > 0 ? maxEntries : 1} {}
+
+  InodePathCache(const InodePathCache&) = delete;
+  InodePathCache& operator=(const InodePathCache&) = delete;
+
+  std::optional<InodeNumber> get(RelativePathPiece path);
+
+  void insert(RelativePathPiece path, InodeNumber number);
+
+  void invalidate(RelativePathPiece path);
+
+ private:
+  const bool enabled_;
+  folly::Synchronized<folly::EvictingCacheMap<RelativePath, InodeNumber>>
+      cache_;
+};
+
+} // namespace eden
+} // namespace facebook
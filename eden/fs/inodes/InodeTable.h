@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <folly/container/F14Map.h>
 #include <optional>
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/InodeMetadata.h"
@@ -63,7 +64,11 @@ struct InodeTableEntry {
  *
  * The index from inode number to record index is wrapped in a SharedMutex.
  * Most accesses will only take a reader lock unless a new entry is added or
- * an inode number is removed.
+ * an inode number is removed.  folly::SharedMutex tracks readers in per-core
+ * slots, so concurrent readers do not contend with each other.  Splitting the
+ * index into independently locked stripes would not help: adding an entry may
+ * remap the storage and removing one relocates another record, so both must
+ * exclude every reader anyway.
  *
  * The contents of each record itself is protected by the FileInode and
  * TreeInode's locks.
@@ -88,12 +93,26 @@ class InodeTable {
 
   /**
    * Create or open an InodeTable at the specified path.
+   *
+   * By default the whole table is faulted in when it is opened, since the
+   * index is built by reading every record.
    */
   template <typename... OldRecords>
-  static std::unique_ptr<InodeTable> open(folly::StringPiece path) {
+  static std::unique_ptr<InodeTable> open(
+      folly::StringPiece path,
+      const MappedDiskVectorOptions& options = defaultMapOptions()) {
     return std::unique_ptr<InodeTable>{
         new InodeTable{MappedDiskVector<Entry>::template open<
-            detail::InodeTableEntry<OldRecords>...>(path, true)}};
+            detail::InodeTableEntry<OldRecords>...>(path, options)}};
+  }
+
+  static MappedDiskVectorOptions defaultMapOptions() {
+    MappedDiskVectorOptions options;
+    options.populate = true;
+    // After the index is built, records are accessed in inode load order,
+    // which has nothing to do with their order in the file.
+    options.advice = MADV_RANDOM;
+    return options;
   }
 
   /**
@@ -220,6 +239,59 @@ class InodeTable {
     });
   }
 
+  /**
+   * Removes the entries of every inode for which keep(inode) returns false,
+   * keeping the remaining records in their original order, and shrinks the
+   * file to fit them.  Returns the number of entries removed.
+   *
+   * Inode numbers are never reused, so entries for inodes that were freed
+   * without calling freeInode(), such as those of unmaterialized inodes
+   * forgotten across a restart, otherwise stay in the table forever.
+   *
+   * The table is rewritten under the write lock, so other threads see either
+   * the old table or the compacted one.  If the process dies partway
+   * through, the records not yet moved are still present, possibly twice,
+   * and the first copy of each is identical to the second.
+   *
+   * `keep` has type (InodeNumber) -> bool, and is called while the table's
+   * locks are held.
+   */
+  template <typename KeepFn>
+  size_t compact(KeepFn&& keep) {
+    auto state = state_.wlock();
+    auto& storage = state->storage;
+    auto& indices = state->indices;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < storage.size(); ++i) {
+      auto inode = storage[i].inode;
+      auto iter = indices.find(inode);
+      if (iter == indices.end() || iter->second != i || !keep(inode)) {
+        // Duplicate records are dropped along with removed inodes.
+        continue;
+      }
+      if (kept != i) {
+        storage[kept] = storage[i];
+        iter->second = kept;
+      }
+      ++kept;
+    }
+
+    size_t removed = storage.size() - kept;
+    while (storage.size() > kept) {
+      storage.pop_back();
+    }
+    for (auto iter = indices.begin(); iter != indices.end();) {
+      if (iter->second >= kept || storage[iter->second].inode != iter->first) {
+        iter = indices.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    storage.shrinkToFit();
+    return removed;
+  }
+
   /**
    * Iterate over all entries of the table and call fn with the inode
    * and record
@@ -297,6 +369,7 @@ class InodeTable {
 
   struct State {
     State(MappedDiskVector<Entry>&& mdv) : storage{std::move(mdv)} {
+      indices.reserve(storage.size());
       for (size_t i = 0; i < storage.size(); ++i) {
         const Entry& entry = storage[i];
         auto ret = indices.insert({entry.inode, i});
@@ -320,7 +393,7 @@ class InodeTable {
     mutable MappedDiskVector<Entry> storage;
 
     /// Maintains an index from inode number to index in storage_.
-    std::unordered_map<InodeNumber, size_t> indices;
+    folly::F14FastMap<InodeNumber, size_t> indices;
   };
 
   folly::Synchronized<State> state_;
@@ -147,6 +147,19 @@ void InodeTimestamps::setattrTimes(
   // we do not allow users to set ctime using setattr. ctime should be changed
   // when ever setattr is called, as this function is called in setattr, update
   // ctime to now.
+  //
+  // The exception is the kernel itself: with FUSE_WRITEBACK_CACHE it owns the
+  // timestamps of files it buffered writes for, and sends them back with
+  // FATTR_CTIME once the writes are flushed.
+#ifdef FATTR_CTIME
+  if (attr.valid & FATTR_CTIME) {
+    timespec attr_ctime;
+    attr_ctime.tv_sec = attr.ctime;
+    attr_ctime.tv_nsec = attr.ctimensec;
+    ctime = attr_ctime;
+    return;
+  }
+#endif
   ctime = now;
 }
 
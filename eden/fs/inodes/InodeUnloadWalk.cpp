@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/inodes/InodeUnloadWalk.h"
+
+#include <folly/Executor.h>
+#include <algorithm>
+#include "eden/fs/inodes/FileInode.h"
+#include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/utils/Bug.h"
+
+namespace facebook {
+namespace eden {
+
+InodeUnloadWalk::InodeUnloadWalk(TreeInodePtr root, const timespec& cutoff)
+    : cutoff_{cutoff} {
+  stack_.emplace_back(std::move(root));
+}
+
+bool InodeUnloadWalk::step(size_t budget) {
+  size_t examined = 0;
+  while (!stack_.empty() && examined < budget) {
+    auto& frame = stack_.back();
+    if (!frame.expanded) {
+      examined += expand(frame);
+      continue;
+    }
+
+    if (!frame.pendingTrees.empty()) {
+      auto name = std::move(frame.pendingTrees.back());
+      frame.pendingTrees.pop_back();
+      ++examined;
+      if (auto child = lookupLoadedTree(frame.tree, name)) {
+        // This may reallocate stack_ and invalidate frame.
+        stack_.emplace_back(std::move(child));
+      }
+      continue;
+    }
+
+    // Every loaded tree child has been walked, and its frame popped, so the
+    // children no longer hold references from this walk.
+    unloaded_ += frame.tree->unloadUnreferencedChildren(frame.toUnload);
+    stack_.pop_back();
+  }
+  return stack_.empty();
+}
+
+size_t InodeUnloadWalk::expand(Frame& frame) {
+  // As in TreeInode::unloadChildrenLastAccessedBefore(), atime can only be
+  // read without the parent's contents lock held, so take strong references
+  // under the lock and check them after releasing it.
+  std::vector<InodePtr> children;
+  {
+    auto contents = frame.tree->getContents().rlock();
+    for (auto& entry : contents->entries) {
+      if (!entry.second.getInode()) {
+        continue;
+      }
+      if (auto asFile = entry.second.asFilePtrOrNull()) {
+        children.emplace_back(std::move(asFile));
+      } else if (auto asTree = entry.second.asTreePtrOrNull()) {
+        frame.pendingTrees.emplace_back(entry.first);
+        children.emplace_back(std::move(asTree));
+      } else {
+        EDEN_BUG() << "entry " << entry.first << " was neither a tree nor file";
+      }
+    }
+  }
+
+  for (const auto& child : children) {
+    if (child->getMetadata().timestamps.atime < cutoff_) {
+      frame.toUnload.insert(child->getNodeId());
+    }
+  }
+  // Walk children in name order.
+  std::reverse(frame.pendingTrees.begin(), frame.pendingTrees.end());
+  frame.expanded = true;
+  return children.size() + 1;
+}
+
+TreeInodePtr InodeUnloadWalk::lookupLoadedTree(
+    const TreeInodePtr& tree,
+    PathComponentPiece name) {
+  auto contents = tree->getContents().rlock();
+  auto it = contents->entries.find(name);
+  if (it == contents->entries.end()) {
+    return nullptr;
+  }
+  return it->second.asTreePtrOrNull();
+}
+
+namespace {
+/**
+ * Run one step of walk on executor, then queue the next step behind whatever
+ * else was queued meanwhile.
+ */
+folly::Future<size_t> runSlices(
+    std::shared_ptr<InodeUnloadWalk> walk,
+    folly::Executor::KeepAlive<> executor,
+    size_t sliceSize) {
+  return folly::via(
+             executor.copy(),
+             [walk, sliceSize] { return walk->step(sliceSize); })
+      .thenValue([walk, executor = std::move(executor), sliceSize](
+                     bool done) mutable {
+        if (done) {
+          return folly::makeFuture(walk->getUnloadedCount());
+        }
+        return runSlices(std::move(walk), std::move(executor), sliceSize);
+      });
+}
+} // namespace
+
+folly::Future<size_t> unloadInSlices(
+    TreeInodePtr root,
+    const timespec& cutoff,
+    folly::Executor::KeepAlive<> executor,
+    size_t sliceSize) {
+  auto walk = std::make_shared<InodeUnloadWalk>(std::move(root), cutoff);
+  return runSlices(std::move(walk), std::move(executor), sliceSize);
+}
+
+} // namespace eden
+} // namespace facebook
+
+#endif // !_WIN32
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#ifndef _WIN32
+
+#include <folly/futures/Future.h>
+#include <time.h>
+#include <unordered_set>
+#include <vector>
+#include "eden/fs/inodes/InodePtr.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace folly {
+class Executor;
+}
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A resumable version of TreeInode::unloadChildrenLastAccessedBefore().
+ *
+ * unloadChildrenLastAccessedBefore() walks the whole tree in one call, which
+ * on a mount with millions of loaded inodes ties up its thread for seconds.
+ * InodeUnloadWalk does the same depth-first walk, but step() stops once it
+ * has looked at a given number of inodes and picks up where it left off on
+ * the next call.  No locks are held between steps, so FUSE requests for the
+ * same directories are never stuck behind the whole walk.
+ *
+ * Directories are revisited by name, so entries renamed or removed between
+ * steps are skipped rather than unloaded.
+ *
+ * InodeUnloadWalk is not thread-safe, but consecutive steps may run on
+ * different threads.
+ */
+class InodeUnloadWalk {
+ public:
+  InodeUnloadWalk(TreeInodePtr root, const timespec& cutoff);
+
+  InodeUnloadWalk(const InodeUnloadWalk&) = delete;
+  InodeUnloadWalk& operator=(const InodeUnloadWalk&) = delete;
+
+  /**
+   * Continue the walk, examining roughly budget inodes before returning.
+   *
+   * Returns true once the whole tree has been walked.
+   */
+  bool step(size_t budget);
+
+  bool isDone() const {
+    return stack_.empty();
+  }
+
+  /** The number of inodes unloaded so far. */
+  size_t getUnloadedCount() const {
+    return unloaded_;
+  }
+
+ private:
+  struct Frame {
+    explicit Frame(TreeInodePtr t) : tree{std::move(t)} {}
+
+    TreeInodePtr tree;
+    bool expanded{false};
+    /** Loaded tree children not yet walked, in reverse order. */
+    std::vector<PathComponent> pendingTrees;
+    /** Children last accessed before the cutoff. */
+    std::unordered_set<InodeNumber> toUnload;
+  };
+
+  /**
+   * Record which children of frame are old enough to unload and which need
+   * to be walked.  Returns the number of children examined.
+   */
+  size_t expand(Frame& frame);
+
+  /** Look up a pending tree child, returning nullptr if it is gone. */
+  static TreeInodePtr lookupLoadedTree(
+      const TreeInodePtr& tree,
+      PathComponentPiece name);
+
+  timespec cutoff_;
+  std::vector<Frame> stack_;
+  size_t unloaded_{0};
+};
+
+/**
+ * Unload the inodes under root last accessed before cutoff, sliceSize inodes
+ * at a time.  Each slice runs as a separate function on executor, so other
+ * work queued on it runs between slices, and on a low priority executor the
+ * slices only run when nothing else is queued.
+ *
+ * The returned future completes with the number of inodes unloaded.
+ */
+folly::Future<size_t> unloadInSlices(
+    TreeInodePtr root,
+    const timespec& cutoff,
+    folly::Executor::KeepAlive<> executor,
+    size_t sliceSize);
+
+} // namespace eden
+} // namespace facebook
+
+#endif // !_WIN32
@@ -40,20 +40,74 @@ namespace eden {
 namespace {
 constexpr uint64_t ioCountMask = 0x7FFFFFFFFFFFFFFFull;
 constexpr uint64_t ioClosedMask = 1ull << 63;
+
+#ifndef _WIN32
+// The number of directories written per transaction when migrating them to
+// SQLite.
+constexpr size_t kSqliteMigrationBatchSize = 1000;
+
+/**
+ * Calls fn(inodeNumber, dir) for each directory reachable from the root of
+ * backingOverlay, which may be an FsOverlay or a SqliteOverlay.
+ */
+template <typename BackingOverlay, typename Fn>
+void forEachOverlayDir(BackingOverlay& backingOverlay, Fn&& fn) {
+  std::vector<InodeNumber> pending{kRootNodeId};
+  while (!pending.empty()) {
+    auto inodeNumber = pending.back();
+    pending.pop_back();
+
+    auto dir = backingOverlay.loadOverlayDir(inodeNumber);
+    if (!dir) {
+      continue;
+    }
+    for (const auto& entry : *dir->entries_ref()) {
+      const auto& value = entry.second;
+      if (*value.inodeNumber_ref() && S_ISDIR(*value.mode_ref())) {
+        pending.push_back(InodeNumber::fromThrift(*value.inodeNumber_ref()));
+      }
+    }
+    fn(inodeNumber, std::move(*dir));
+  }
+}
+#endif
 } // namespace
 
 using folly::Unit;
 using std::optional;
 
-std::shared_ptr<Overlay> Overlay::create(AbsolutePathPiece localDir) {
+std::shared_ptr<Overlay> Overlay::create(
+    AbsolutePathPiece localDir,
+    std::chrono::nanoseconds dirSaveDelay,
+    OverlayType type) {
   struct MakeSharedEnabler : public Overlay {
-    explicit MakeSharedEnabler(AbsolutePathPiece localDir)
-        : Overlay(localDir) {}
+    MakeSharedEnabler(
+        AbsolutePathPiece localDir,
+        std::chrono::nanoseconds dirSaveDelay,
+        OverlayType type)
+        : Overlay(localDir, dirSaveDelay, type) {}
   };
-  return std::make_shared<MakeSharedEnabler>(localDir);
+  return std::make_shared<MakeSharedEnabler>(localDir, dirSaveDelay, type);
 }
 
-Overlay::Overlay(AbsolutePathPiece localDir) : backingOverlay_{localDir} {}
+Overlay::Overlay(
+    AbsolutePathPiece localDir,
+    std::chrono::nanoseconds dirSaveDelay,
+    OverlayType type)
+    : backingOverlay_{localDir},
+#ifdef _WIN32
+      // There is no GC thread to write delayed saves on Windows.
+      dirSaveDelay_{std::chrono::nanoseconds::zero()} {
+  (void)dirSaveDelay;
+  (void)type;
+}
+#else
+      dirSaveDelay_{dirSaveDelay} {
+  if (type == OverlayType::Sqlite) {
+    sqliteDirs_ = std::make_unique<SqliteOverlay>(localDir);
+  }
+}
+#endif
 
 Overlay::~Overlay() {
   close();
@@ -87,6 +141,9 @@ void Overlay::close() {
   closeAndWaitForOutstandingIO();
 #ifndef _WIN32
   inodeMetadataTable_.reset();
+  if (sqliteDirs_ && sqliteDirs_->initialized()) {
+    sqliteDirs_->close(optNextInodeNumber);
+  }
 #endif // !_WIN32
 
   backingOverlay_.close(optNextInodeNumber);
@@ -140,23 +197,46 @@ void Overlay::initOverlay(
     const OverlayChecker::ProgressCallback& progressCallback) {
   IORequest req{this};
   auto optNextInodeNumber = backingOverlay_.initOverlay(true);
+#ifndef _WIN32
+  std::optional<InodeNumber> sqliteNextInodeNumber;
+  if (sqliteDirs_) {
+    sqliteNextInodeNumber = sqliteDirs_->initOverlay(true);
+  } else if (SqliteOverlay::exists(backingOverlay_.getLocalDir())) {
+    migrateDirsFromSqlite();
+  }
+  // Directories left in backingOverlay_ are checked below as usual before
+  // being moved to sqliteDirs_.
+  bool migrateToSqlite =
+      sqliteDirs_ && backingOverlay_.hasOverlayData(kRootNodeId);
+  std::optional<OverlayChecker> checker;
+#endif
   if (!optNextInodeNumber.has_value()) {
 #ifndef _WIN32
-    // If the next-inode-number data is missing it means that this overlay was
-    // not shut down cleanly the last time it was used.  If this was caused by a
-    // hard system reboot this can sometimes cause corruption and/or missing
-    // data in some of the on-disk state.
-    //
-    // Use OverlayChecker to scan the overlay for any issues, and also compute
-    // correct next inode number as it does so.
-    XLOG(WARN) << "Overlay " << backingOverlay_.getLocalDir()
-               << " was not shut down cleanly.  Performing fsck scan.";
-
-    OverlayChecker checker(&backingOverlay_, std::nullopt);
-    checker.scanForErrors(progressCallback);
-    checker.repairErrors();
-
-    optNextInodeNumber = checker.getNextInodeNumber();
+    if (sqliteDirs_ && !migrateToSqlite) {
+      // OverlayChecker only understands directories stored in FsOverlay.  The
+      // SqliteOverlay records inode numbers ahead of their allocation, so its
+      // next inode number is safe to use, but leaked data is not collected.
+      XLOG(WARN) << "Overlay " << backingOverlay_.getLocalDir()
+                 << " was not shut down cleanly.  Skipping fsck scan of the "
+                 << "SQLite directory data.";
+      optNextInodeNumber = sqliteNextInodeNumber;
+    } else {
+      // If the next-inode-number data is missing it means that this overlay
+      // was not shut down cleanly the last time it was used.  If this was
+      // caused by a hard system reboot this can sometimes cause corruption
+      // and/or missing data in some of the on-disk state.
+      //
+      // Use OverlayChecker to scan the overlay for any issues, and also
+      // compute correct next inode number as it does so.
+      XLOG(WARN) << "Overlay " << backingOverlay_.getLocalDir()
+                 << " was not shut down cleanly.  Performing fsck scan.";
+
+      checker.emplace(&backingOverlay_, std::nullopt);
+      checker->scanForErrors(progressCallback);
+      checker->repairErrors();
+
+      optNextInodeNumber = checker->getNextInodeNumber();
+    }
 #else
     // SqliteOverlay will always return the value of next Inode number, if we
     // end up here - it's a bug.
@@ -168,16 +248,67 @@ void Overlay::initOverlay(
   nextInodeNumber_.store(optNextInodeNumber->get(), std::memory_order_relaxed);
 
 #ifndef _WIN32
+  if (migrateToSqlite) {
+    migrateDirsToSqlite();
+  }
+
   // Open after infoFile_'s lock is acquired because the InodeTable acquires
   // its own lock, which should be released prior to infoFile_.
   inodeMetadataTable_ =
       InodeMetadataTable::open((backingOverlay_.getLocalDir() +
                                 PathComponentPiece{FsOverlay::kMetadataFile})
                                    .c_str());
+  if (checker) {
+    compactInodeMetadataTable(*checker);
+  }
+
+  auto partialFiles = partialFiles_.wlock();
+  for (auto& entry : backingOverlay_.loadPartialFileRecords()) {
+    auto inodeNumber = entry.first;
+    if (!backingOverlay_.hasOverlayData(inodeNumber)) {
+      // The overlay file was removed, or never created, before the record
+      // was.
+      backingOverlay_.removePartialFileRecord(inodeNumber);
+      continue;
+    }
+    if (entry.second.blobHash.size() != Hash::RAW_SIZE) {
+      XLOG(WARN) << "ignoring partial file record for inode " << inodeNumber
+                 << " with a malformed blob hash";
+      continue;
+    }
+    PartialFile partialFile{
+        Hash{folly::ByteRange{folly::StringPiece{entry.second.blobHash}}}, {}};
+    for (const auto& range : entry.second.writtenRanges) {
+      partialFile.writtenRanges.add(range.first, range.second);
+    }
+    partialFiles->emplace(inodeNumber, std::move(partialFile));
+  }
 #endif // !_WIN32
 }
 
+#ifndef _WIN32
+void Overlay::compactInodeMetadataTable(const OverlayChecker& checker) {
+  // After an unclean shutdown no inodes can have been handed over by a
+  // graceful restart, so the inodes found by the checker are the only ones
+  // still in use.
+  try {
+    auto removed = inodeMetadataTable_->compact(
+        [&](InodeNumber number) { return checker.isInodeReferenced(number); });
+    XLOG(DBG2) << "removed " << removed << " stale entries from the inode "
+               << "metadata table of " << backingOverlay_.getLocalDir();
+  } catch (const std::exception& ex) {
+    // Stale entries only waste space, so failing to remove them is not fatal.
+    XLOG(WARN) << "unable to compact the inode metadata table of "
+               << backingOverlay_.getLocalDir() << ": " << ex.what();
+  }
+}
+#endif // !_WIN32
+
 InodeNumber Overlay::allocateInodeNumber() {
+  return allocateInodeNumbers(1);
+}
+
+InodeNumber Overlay::allocateInodeNumbers(size_t count) {
   // InodeNumber should generally be 64-bits wide, in which case it isn't even
   // worth bothering to handle the case where nextInodeNumber_ wraps.  We don't
   // need to bother checking for conflicts with existing inode numbers since
@@ -188,20 +319,26 @@ InodeNumber Overlay::allocateInodeNumber() {
       "expected nextInodeNumber_ and InodeNumber to have the same size");
   static_assert(
       sizeof(InodeNumber) >= 8, "expected InodeNumber to be at least 64 bits");
+  DCHECK_NE(0, count);
 
   // This could be a relaxed atomic operation.  It doesn't matter on x86 but
   // might on ARM.
-  auto previous = nextInodeNumber_++;
+  auto first = nextInodeNumber_.fetch_add(count);
+  auto last = first + count - 1;
 #ifdef _WIN32
-  backingOverlay_.updateUsedInodeNumber(previous);
+  backingOverlay_.updateUsedInodeNumber(last);
+#else
+  if (sqliteDirs_) {
+    sqliteDirs_->updateUsedInodeNumber(last);
+  }
 #endif
-  DCHECK_NE(0, previous) << "allocateInodeNumber called before initialize";
-  return InodeNumber{previous};
+  DCHECK_NE(0, first) << "allocateInodeNumbers called before initialize";
+  return InodeNumber{first};
 }
 
 optional<DirContents> Overlay::loadOverlayDir(InodeNumber inodeNumber) {
   IORequest req{this};
-  auto dirData = backingOverlay_.loadOverlayDir(inodeNumber);
+  auto dirData = loadOverlayDirData(inodeNumber);
   if (!dirData.has_value()) {
     return std::nullopt;
   }
@@ -282,16 +419,74 @@ void Overlay::saveOverlayDir(InodeNumber inodeNumber, const DirContents& dir) {
         std::make_pair(entName.stringPiece().str(), std::move(oent)));
   }
 
+  if (dirSaveDelay_.count() > 0) {
+    bool wasClean;
+    {
+      auto lock = gcQueue_.lock();
+      wasClean = lock->dirtyDirs.empty();
+      if (wasClean) {
+        lock->dirtyDirsDeadline =
+            std::chrono::steady_clock::now() + dirSaveDelay_;
+      }
+      // Swap rather than assign so any previous pending save of this
+      // directory is destroyed after the lock is released.
+      std::swap(lock->dirtyDirs[inodeNumber], odir);
+    }
+    if (wasClean) {
+      gcCondVar_.notify_one();
+    }
+    return;
+  }
+
+#ifndef _WIN32
+  if (sqliteDirs_) {
+    sqliteDirs_->saveOverlayDir(inodeNumber, odir);
+    return;
+  }
+#endif
   backingOverlay_.saveOverlayDir(inodeNumber, odir);
 }
 
+optional<overlay::OverlayDir> Overlay::loadOverlayDirData(
+    InodeNumber inodeNumber) {
+  folly::SharedMutex::ReadHolder writeLock{nullptr};
+  if (dirSaveDelay_.count() > 0) {
+    writeLock = folly::SharedMutex::ReadHolder{dirtyDirsWriteLock_};
+    auto lock = gcQueue_.lock();
+    auto it = lock->dirtyDirs.find(inodeNumber);
+    if (it != lock->dirtyDirs.end()) {
+      return it->second;
+    }
+  }
+#ifndef _WIN32
+  if (sqliteDirs_) {
+    return sqliteDirs_->loadOverlayDir(inodeNumber);
+  }
+#endif
+  return backingOverlay_.loadOverlayDir(inodeNumber);
+}
+
 void Overlay::removeOverlayData(InodeNumber inodeNumber) {
   IORequest req{this};
 
 #ifndef _WIN32
+  // Drop any pending save of this directory so it is not written back after
+  // the data is removed.
+  folly::SharedMutex::ReadHolder writeLock{nullptr};
+  if (dirSaveDelay_.count() > 0) {
+    writeLock = folly::SharedMutex::ReadHolder{dirtyDirsWriteLock_};
+    gcQueue_.lock()->dirtyDirs.erase(inodeNumber);
+  }
+
   // TODO: batch request during GC
   getInodeMetadataTable()->freeInode(inodeNumber);
   backingOverlay_.removeOverlayFile(inodeNumber);
+  if (sqliteDirs_) {
+    sqliteDirs_->removeOverlayData(inodeNumber);
+  }
+  if (partialFiles_.rlock()->count(inodeNumber)) {
+    finishPartialFile(inodeNumber);
+  }
 #else
   backingOverlay_.removeOverlayData(inodeNumber);
 #endif // !_WIN32
@@ -300,7 +495,7 @@ void Overlay::removeOverlayData(InodeNumber inodeNumber) {
 #ifndef _WIN32
 void Overlay::recursivelyRemoveOverlayData(InodeNumber inodeNumber) {
   IORequest req{this};
-  auto dirData = backingOverlay_.loadOverlayDir(inodeNumber);
+  auto dirData = loadOverlayDirData(inodeNumber);
 
   // This inode's data must be removed from the overlay before
   // recursivelyRemoveOverlayData returns to avoid a race condition if
@@ -329,6 +524,18 @@ folly::Future<folly::Unit> Overlay::flushPendingAsync() {
 
 bool Overlay::hasOverlayData(InodeNumber inodeNumber) {
   IORequest req{this};
+  folly::SharedMutex::ReadHolder writeLock{nullptr};
+  if (dirSaveDelay_.count() > 0) {
+    writeLock = folly::SharedMutex::ReadHolder{dirtyDirsWriteLock_};
+    if (gcQueue_.lock()->dirtyDirs.count(inodeNumber)) {
+      return true;
+    }
+  }
+#ifndef _WIN32
+  if (sqliteDirs_ && sqliteDirs_->hasOverlayData(inodeNumber)) {
+    return true;
+  }
+#endif
   return backingOverlay_.hasOverlayData(inodeNumber);
 }
 
@@ -371,6 +578,60 @@ OverlayFile Overlay::createOverlayFile(
       weak_from_this());
 }
 
+void Overlay::startPartialFile(InodeNumber inodeNumber, const Hash& blobHash) {
+  IORequest req{this};
+  backingOverlay_.createPartialFileRecord(inodeNumber, blobHash.getBytes());
+  partialFiles_.wlock()->insert_or_assign(
+      inodeNumber, PartialFile{blobHash, {}});
+}
+
+std::optional<Hash> Overlay::getPartialFileBlob(InodeNumber inodeNumber) {
+  auto partialFiles = partialFiles_.rlock();
+  auto it = partialFiles->find(inodeNumber);
+  if (it == partialFiles->end()) {
+    return std::nullopt;
+  }
+  return it->second.blobHash;
+}
+
+size_t Overlay::addPartialFileRange(
+    InodeNumber inodeNumber,
+    size_t begin,
+    size_t end) {
+  IORequest req{this};
+  {
+    auto partialFiles = partialFiles_.rlock();
+    auto& partialFile = partialFiles->at(inodeNumber);
+    if (partialFile.writtenRanges.covers(begin, end)) {
+      return partialFile.writtenRanges.getIntervalCount();
+    }
+  }
+
+  // Writes to a given inode are serialized by the FileInode's lock, so the
+  // record cannot be removed while we append to it.
+  backingOverlay_.appendPartialFileRange(inodeNumber, begin, end);
+
+  auto partialFiles = partialFiles_.wlock();
+  auto& partialFile = partialFiles->at(inodeNumber);
+  partialFile.writtenRanges.add(begin, end);
+  return partialFile.writtenRanges.getIntervalCount();
+}
+
+std::vector<std::pair<size_t, size_t>> Overlay::getPartialFileGaps(
+    InodeNumber inodeNumber,
+    size_t begin,
+    size_t end) {
+  auto partialFiles = partialFiles_.rlock();
+  return partialFiles->at(inodeNumber).writtenRanges.getUncoveredRanges(
+      begin, end);
+}
+
+void Overlay::finishPartialFile(InodeNumber inodeNumber) {
+  IORequest req{this};
+  backingOverlay_.removePartialFileRecord(inodeNumber);
+  partialFiles_.wlock()->erase(inodeNumber);
+}
+
 #endif // !_WIN32
 
 InodeNumber Overlay::getMaxInodeNumber() {
@@ -432,17 +693,32 @@ void Overlay::closeAndWaitForOutstandingIO() {
 void Overlay::gcThread() noexcept {
   for (;;) {
     std::vector<GCRequest> requests;
+    bool stopping = false;
     {
       auto lock = gcQueue_.lock();
-      while (lock->queue.empty()) {
-        if (lock->stop) {
-          return;
+      while (lock->queue.empty() && !lock->stop) {
+        if (lock->dirtyDirs.empty()) {
+          gcCondVar_.wait(lock.getUniqueLock());
+        } else if (
+            gcCondVar_.wait_until(
+                lock.getUniqueLock(), lock->dirtyDirsDeadline) ==
+            std::cv_status::timeout) {
+          break;
         }
-        gcCondVar_.wait(lock.getUniqueLock());
-        continue;
       }
 
       requests = std::move(lock->queue);
+      stopping = lock->stop && requests.empty();
+    }
+
+    // Flush requests and shutdown wait for every pending directory save.
+    bool force = stopping ||
+        std::any_of(requests.begin(), requests.end(), [](const auto& r) {
+                   return r.flush.has_value();
+                 });
+    writeDirtyDirs(force);
+    if (stopping) {
+      return;
     }
 
     for (auto& request : requests) {
@@ -456,6 +732,85 @@ void Overlay::gcThread() noexcept {
   }
 }
 
+void Overlay::writeDirtyDirs(bool force) {
+  if (dirSaveDelay_.count() == 0) {
+    return;
+  }
+
+  std::unordered_map<InodeNumber, overlay::OverlayDir> dirs;
+  folly::SharedMutex::WriteHolder writeLock{dirtyDirsWriteLock_};
+  {
+    auto lock = gcQueue_.lock();
+    if (lock->dirtyDirs.empty() ||
+        (!force &&
+         std::chrono::steady_clock::now() < lock->dirtyDirsDeadline)) {
+      return;
+    }
+    dirs.swap(lock->dirtyDirs);
+  }
+
+  IORequest req{this};
+  if (sqliteDirs_) {
+    try {
+      sqliteDirs_->saveOverlayDirs(dirs);
+    } catch (const std::exception& e) {
+      XLOG(ERR) << "Failed to write " << dirs.size()
+                << " delayed overlay directories: " << e.what();
+    }
+    return;
+  }
+  for (const auto& [inodeNumber, dir] : dirs) {
+    try {
+      backingOverlay_.saveOverlayDir(inodeNumber, dir);
+    } catch (const std::exception& e) {
+      XLOG(ERR) << "Failed to write delayed overlay data for inode "
+                << inodeNumber << ": " << e.what();
+    }
+  }
+}
+
+void Overlay::migrateDirsToSqlite() {
+  XLOG(INFO) << "Moving the directories of overlay "
+             << backingOverlay_.getLocalDir() << " to SQLite";
+  std::vector<InodeNumber> migrated;
+  std::unordered_map<InodeNumber, overlay::OverlayDir> batch;
+  forEachOverlayDir(
+      backingOverlay_, [&](InodeNumber inodeNumber, overlay::OverlayDir dir) {
+        migrated.push_back(inodeNumber);
+        batch.emplace(inodeNumber, std::move(dir));
+        if (batch.size() >= kSqliteMigrationBatchSize) {
+          sqliteDirs_->saveOverlayDirs(batch);
+          batch.clear();
+        }
+      });
+  sqliteDirs_->saveOverlayDirs(batch);
+
+  // The root is visited first and removed last, so that an interrupted
+  // removal restarts the migration.
+  for (auto it = migrated.rbegin(); it != migrated.rend(); ++it) {
+    backingOverlay_.removeOverlayFile(*it);
+  }
+  XLOG(INFO) << "Moved " << migrated.size() << " directories to SQLite";
+}
+
+void Overlay::migrateDirsFromSqlite() {
+  XLOG(INFO) << "Moving the directories of overlay "
+             << backingOverlay_.getLocalDir() << " out of SQLite";
+  size_t migrated = 0;
+  {
+    SqliteOverlay sqliteDirs{backingOverlay_.getLocalDir()};
+    sqliteDirs.initOverlay(false);
+    forEachOverlayDir(
+        sqliteDirs, [&](InodeNumber inodeNumber, overlay::OverlayDir dir) {
+          backingOverlay_.saveOverlayDir(inodeNumber, dir);
+          ++migrated;
+        });
+    sqliteDirs.close(std::nullopt);
+  }
+  SqliteOverlay::removeDatabase(backingOverlay_.getLocalDir());
+  XLOG(INFO) << "Moved " << migrated << " directories out of SQLite";
+}
+
 void Overlay::handleGCRequest(GCRequest& request) {
   IORequest req{this};
   if (request.flush) {
@@ -508,7 +863,7 @@ void Overlay::handleGCRequest(GCRequest& request) {
 
     overlay::OverlayDir dir;
     try {
-      auto dirData = backingOverlay_.loadOverlayDir(ino);
+      auto dirData = loadOverlayDirData(ino);
       if (!dirData.has_value()) {
         XLOG(DBG7) << "no dir data for inode " << ino;
         continue;
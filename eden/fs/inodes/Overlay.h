@@ -8,17 +8,25 @@
 #pragma once
 #include <folly/File.h>
 #include <folly/Range.h>
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/Promise.h>
 #include <folly/synchronization/Baton.h>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <optional>
 #include <thread>
+#include <unordered_map>
+#include <vector>
+#include "eden/fs/config/CheckoutConfig.h"
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/overlay/OverlayChecker.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/CoverageSet.h"
 #include "eden/fs/utils/DirType.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -26,6 +34,7 @@
 #include "eden/fs/inodes/sqliteoverlay/SqliteOverlay.h" // @manual
 #else
 #include "eden/fs/inodes/overlay/FsOverlay.h"
+#include "eden/fs/inodes/sqliteoverlay/SqliteOverlay.h"
 
 #endif
 
@@ -73,8 +82,23 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    *
    * The caller must call initialize() after creating the Overlay and wait for
    * it to succeed before using any other methods.
+   *
+   * If dirSaveDelay is nonzero, saveOverlayDir() only records the directory
+   * in memory, and the GC thread writes it out once it has been pending for
+   * dirSaveDelay, coalescing any further saves of the same directory.  A
+   * crash loses at most dirSaveDelay worth of directory saves.  Pending
+   * saves are always written by flushPendingAsync() and close().  Not
+   * supported on Windows, where the delay is ignored.
+   *
+   * With OverlayType::Sqlite, directories are stored in a SQLite database
+   * rather than in one file each.  Directories are migrated on
+   * initialization if the type of an existing overlay changed.  Windows
+   * always stores directories in SQLite.
    */
-  static std::shared_ptr<Overlay> create(AbsolutePathPiece localDir);
+  static std::shared_ptr<Overlay> create(
+      AbsolutePathPiece localDir,
+      std::chrono::nanoseconds dirSaveDelay = std::chrono::nanoseconds::zero(),
+      OverlayType type = OverlayType::Filesystem);
 
   ~Overlay();
 
@@ -145,11 +169,17 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    *   TreeInode::create() or TreeInode::mkdir().  In this case
    *   inodeCreated() should be called immediately afterwards to register the
    *   new child Inode object.
-   *
-   * TODO: It would be easy to extend this function to allocate a range of
-   * inode values in one atomic operation.
    */
   InodeNumber allocateInodeNumber();
+
+  /**
+   * Allocate count consecutive inode numbers in one atomic operation, and
+   * return the first of them.  count must not be 0.
+   *
+   * This is used to number all the entries of a directory at once when it is
+   * loaded from a source control tree.
+   */
+  InodeNumber allocateInodeNumbers(size_t count);
 #ifndef _WIN32
 
   /**
@@ -178,7 +208,8 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
 
   /**
    * Returns a future that completes once all previously-issued async
-   * operations, namely recursivelyRemoveOverlayData, finish.
+   * operations, namely recursivelyRemoveOverlayData and delayed
+   * saveOverlayDir calls, finish.
    */
   folly::Future<folly::Unit> flushPendingAsync();
 
@@ -215,9 +246,47 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    * call statfs(2) on the filesystem in which the overlay is located
    */
   struct statfs statFs();
+
+  /**
+   * Record that the overlay file for inodeNumber is partially materialized:
+   * only the byte ranges later passed to addPartialFileRange() hold file
+   * contents, and everything else must be read from blobHash.
+   *
+   * Partial files are recorded on disk, so they survive a restart, until
+   * finishPartialFile() or removeOverlayData() is called.
+   */
+  void startPartialFile(InodeNumber inodeNumber, const Hash& blobHash);
+
+  /**
+   * Returns the blob backing a partially materialized file, or std::nullopt
+   * if the inode is not partially materialized.
+   */
+  std::optional<Hash> getPartialFileBlob(InodeNumber inodeNumber);
+
+  /**
+   * Record that [begin, end) of a partially materialized file now lives in
+   * the overlay file.  Returns the number of disjoint ranges written so far.
+   */
+  size_t addPartialFileRange(InodeNumber inodeNumber, size_t begin, size_t end);
+
+  /**
+   * Returns the subranges of [begin, end) of a partially materialized file
+   * that have not been written, and so must be read from its blob.
+   */
+  std::vector<std::pair<size_t, size_t>>
+  getPartialFileGaps(InodeNumber inodeNumber, size_t begin, size_t end);
+
+  /**
+   * Forget that the file is partially materialized, once the overlay file
+   * holds all of its contents or the inode is dematerialized.
+   */
+  void finishPartialFile(InodeNumber inodeNumber);
 #endif // !_WIN32
  private:
-  explicit Overlay(AbsolutePathPiece localDir);
+  Overlay(
+      AbsolutePathPiece localDir,
+      std::chrono::nanoseconds dirSaveDelay,
+      OverlayType type);
 
   /**
    * A request for the background GC thread.  There are two types of requests:
@@ -243,13 +312,52 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
   struct GCQueue {
     bool stop = false;
     std::vector<GCRequest> queue;
+
+    /**
+     * Directories saved but not yet written to backingOverlay_, when
+     * dirSaveDelay_ is nonzero, and the time by which they must be written.
+     */
+    std::unordered_map<InodeNumber, overlay::OverlayDir> dirtyDirs;
+    std::chrono::steady_clock::time_point dirtyDirsDeadline;
   };
 
   void initOverlay(
       const OverlayChecker::ProgressCallback& progressCallback = [](auto) {});
   void gcThread() noexcept;
+
+#ifndef _WIN32
+  /**
+   * Removes the metadata of inodes the checker found no trace of from the
+   * InodeMetadataTable.
+   */
+  void compactInodeMetadataTable(const OverlayChecker& checker);
+#endif // !_WIN32
+
   void handleGCRequest(GCRequest& request);
 
+  /**
+   * Load a directory from the pending saves, or else from backingOverlay_.
+   */
+  std::optional<overlay::OverlayDir> loadOverlayDirData(
+      InodeNumber inodeNumber);
+
+  /**
+   * Write the pending directory saves to backingOverlay_.  Unless force is
+   * set, does nothing until dirtyDirsDeadline has passed.
+   */
+  void writeDirtyDirs(bool force);
+
+#ifndef _WIN32
+  /**
+   * Move the directories reachable from the root between backingOverlay_ and
+   * sqliteDirs_, or from an existing database when sqliteDirs_ is not used.
+   * The source copies are only removed once everything has been written, so
+   * an interrupted migration is redone on the next initialization.
+   */
+  void migrateDirsToSqlite();
+  void migrateDirsFromSqlite();
+#endif
+
   bool tryIncOutstandingIORequests();
   void decOutstandingIORequests();
   void closeAndWaitForOutstandingIO();
@@ -275,6 +383,24 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    * should be released first during shutdown.
    */
   std::unique_ptr<InodeMetadataTable> inodeMetadataTable_;
+
+  /**
+   * If the overlay type is OverlayType::Sqlite, directories are stored here
+   * rather than in backingOverlay_, which still stores file contents.
+   */
+  std::unique_ptr<SqliteOverlay> sqliteDirs_;
+
+  struct PartialFile {
+    Hash blobHash;
+    CoverageSet writtenRanges;
+  };
+
+  /**
+   * In-memory copy of the partial file records in backingOverlay_, loaded by
+   * initOverlay().
+   */
+  folly::Synchronized<std::unordered_map<InodeNumber, PartialFile>>
+      partialFiles_;
 #endif // !_WIN32
 
   /**
@@ -285,6 +411,16 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
   folly::Synchronized<GCQueue, std::mutex> gcQueue_;
   std::condition_variable gcCondVar_;
 
+  const std::chrono::nanoseconds dirSaveDelay_;
+
+  /**
+   * Held exclusively by writeDirtyDirs() from taking the pending saves out of
+   * gcQueue_ until they are written, and shared by anything that reads or
+   * removes overlay data while saves are delayed, so those never observe a
+   * directory that is neither pending nor written.
+   */
+  folly::SharedMutex dirtyDirsWriteLock_;
+
   /**
    * This uint64_t holds two values, a single bit on the MSB that
    * acts a boolean closed: True if the the Overlay has been closed with
@@ -39,6 +39,15 @@ class OverlayFile {
   folly::Expected<int, int> fdatasync() const;
   folly::Expected<std::string, int> readFile() const;
 
+  /**
+   * The underlying file descriptor, for IO that is handed to the kernel
+   * directly (such as splicing FUSE read replies).  The descriptor is only
+   * valid for the lifetime of this OverlayFile.
+   */
+  int fd() const {
+    return file_.fd();
+  }
+
  private:
   OverlayFile(const OverlayFile&) = delete;
   OverlayFile& operator=(const OverlayFile&) = delete;
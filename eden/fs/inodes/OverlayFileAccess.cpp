@@ -9,9 +9,11 @@
 
 #include <folly/Expected.h>
 #include <folly/Range.h>
+#include <folly/String.h>
 #include <folly/logging/xlog.h>
 #include <gflags/gflags.h>
 #include <openssl/sha.h>
+#include <fcntl.h>
 
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeError.h"
@@ -20,6 +22,7 @@
 #include "eden/fs/inodes/OverlayFile.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/model/Blob.h"
+#include "eden/fs/store/Sha1Hasher.h"
 #include "eden/fs/utils/Bug.h"
 #include "folly/FileUtil.h"
 
@@ -34,10 +37,13 @@ namespace eden {
 
 DEFINE_uint64(overlayFileCacheSize, 100, "");
 
-void OverlayFileAccess::Entry::Info::invalidateMetadata() {
+void OverlayFileAccess::Entry::Info::invalidateMetadata(
+    uint64_t modifiedOffset) {
   ++version;
   size = std::nullopt;
   sha1 = std::nullopt;
+  sha1Checkpoints.resize(std::min<uint64_t>(
+      sha1Checkpoints.size(), modifiedOffset / kSha1CheckpointInterval));
 }
 
 OverlayFileAccess::State::State(size_t cacheSize) : entries{cacheSize} {
@@ -110,24 +116,52 @@ off_t OverlayFileAccess::getFileSize(FileInode& inode) {
   return size;
 }
 
-Hash OverlayFileAccess::getSha1(FileInode& inode) {
+folly::Future<Hash> OverlayFileAccess::getSha1(FileInode& inode) {
   auto entry = getEntryForInode(inode.getNodeId());
+  // Find out how much is left to hash, so that small files are hashed here
+  // rather than handed to the pool.  This is normally cached.
+  uint64_t size = getFileSize(inode);
   uint64_t version;
+  SHA_CTX ctx;
+  size_t checkpointCount;
   {
     auto info = entry->info.rlock();
     if (info->sha1.has_value()) {
-      return *info->sha1;
+      return folly::makeFuture(*info->sha1);
     }
     version = info->version;
+    checkpointCount = info->sha1Checkpoints.size();
+    if (checkpointCount > 0) {
+      ctx = info->sha1Checkpoints.back();
+    } else {
+      SHA1_Init(&ctx);
+    }
   }
 
-  // SHA-1 is not known, so recompute it. Do so while the lock is not held to
-  // improve concurrency.
-
-  SHA_CTX ctx;
-  SHA1_Init(&ctx);
+  // SHA-1 is not known, so compute it from the last checkpoint. Do so while
+  // the lock is not held to improve concurrency.
+  uint64_t hashed = checkpointCount * kSha1CheckpointInterval;
+  return Sha1Hasher::get()
+      .compute(
+          size > hashed ? size - hashed : 0,
+          [entry = std::move(entry),
+           inode = inode.inodePtrFromThis(),
+           version,
+           ctx,
+           checkpointCount] {
+            return computeSha1(*entry, *inode, version, ctx, checkpointCount);
+          })
+      .toUnsafeFuture();
+}
 
-  off_t off = FsOverlay::kHeaderLength;
+Hash OverlayFileAccess::computeSha1(
+    Entry& entry,
+    FileInode& inode,
+    uint64_t version,
+    SHA_CTX ctx,
+    size_t checkpointCount) {
+  std::vector<SHA_CTX> newCheckpoints;
+  uint64_t hashed = checkpointCount * kSha1CheckpointInterval;
   while (true) {
     // Using pread here so that we don't move the file position;
     // the file descriptor is shared between multiple file handles
@@ -135,7 +169,12 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
     // like a good property of this function to avoid changing that
     // state.
     uint8_t buf[8192];
-    auto ret = entry->file.preadNoInt(&buf, sizeof(buf), off);
+    // Stop at the next checkpoint so its state can be saved.
+    auto toRead = std::min<uint64_t>(
+        sizeof(buf),
+        kSha1CheckpointInterval - hashed % kSha1CheckpointInterval);
+    auto ret = entry.file.preadNoInt(
+        &buf, toRead, hashed + FsOverlay::kHeaderLength);
     if (ret.hasError()) {
       throw InodeError(
           ret.error(),
@@ -147,7 +186,10 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
       break;
     }
     SHA1_Update(&ctx, buf, len);
-    off += len;
+    hashed += len;
+    if (hashed % kSha1CheckpointInterval == 0) {
+      newCheckpoints.push_back(ctx);
+    }
   }
 
   static_assert(Hash::RAW_SIZE == SHA_DIGEST_LENGTH);
@@ -155,9 +197,14 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
   SHA1_Final(sha1.mutableBytes().begin(), &ctx);
 
   // Update the cache if the version still matches.
-  auto info = entry->info.wlock();
+  auto info = entry.info.wlock();
   if (version == info->version) {
+    DCHECK_EQ(checkpointCount, info->sha1Checkpoints.size());
     info->sha1 = sha1;
+    info->sha1Checkpoints.insert(
+        info->sha1Checkpoints.end(),
+        newCheckpoints.begin(),
+        newCheckpoints.end());
   }
   return sha1;
 }
@@ -197,19 +244,32 @@ std::string OverlayFileAccess::readAllContents(FileInode& inode) {
 BufVec OverlayFileAccess::read(FileInode& inode, size_t size, off_t off) {
   auto entry = getEntryForInode(inode.getNodeId());
 
-  auto buf = folly::IOBuf::createCombined(size);
-  auto res = entry->file.preadNoInt(
-      buf->writableBuffer(), size, off + FsOverlay::kHeaderLength);
+  // The data is not read here: FuseChannel can splice it straight into the
+  // FUSE device.  The entry is kept alive, and thus its file open, until the
+  // BufVec is done with it.
+  auto fd = entry->file.fd();
+  return BufVec::fromFile(
+      fd, off + FsOverlay::kHeaderLength, size, std::move(entry));
+}
 
-  if (res.hasError()) {
-    throw InodeError(
-        res.error(),
-        inode.inodePtrFromThis(),
-        "pread failed during overlay file read");
+void OverlayFileAccess::readAhead(FileInode& inode, size_t size, off_t off) {
+#ifdef __linux__
+  auto entry = getEntryForInode(inode.getNodeId());
+  auto err = posix_fadvise(
+      entry->file.fd(),
+      off + FsOverlay::kHeaderLength,
+      size,
+      POSIX_FADV_WILLNEED);
+  if (err != 0) {
+    // Read-ahead is only advice, so failing to give it is not an error.
+    XLOG(DBG3) << "posix_fadvise failed for inode " << inode.getNodeId()
+               << ": " << folly::errnoStr(err);
   }
-
-  buf->append(res.value());
-  return BufVec{std::move(buf)};
+#else
+  (void)inode;
+  (void)size;
+  (void)off;
+#endif
 }
 
 size_t OverlayFileAccess::write(
@@ -227,7 +287,7 @@ size_t OverlayFileAccess::write(
         "pwritev failed during file write");
   }
   auto info = entry->info.wlock();
-  info->invalidateMetadata();
+  info->invalidateMetadata(off);
 
   return xfer.value();
 }
@@ -243,7 +303,7 @@ void OverlayFileAccess::truncate(FileInode& inode, off_t size) {
   }
 
   auto info = entry->info.wlock();
-  info->invalidateMetadata();
+  info->invalidateMetadata(size);
 }
 
 void OverlayFileAccess::fsync(FileInode& inode, bool datasync) {
@@ -10,7 +10,10 @@
 #include <folly/File.h>
 #include <folly/Synchronized.h>
 #include <folly/container/EvictingCacheMap.h>
+#include <folly/futures/Future.h>
+#include <openssl/sha.h>
 #include <memory>
+#include <vector>
 #include "eden/fs/fuse/BufVec.h"
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/OverlayFile.h"
@@ -66,8 +69,11 @@ class OverlayFileAccess {
 
   /**
    * Returns the SHA-1 hash of the file contents for the given inode number.
+   *
+   * Unless it is cached, or there is little left to hash, the hash is
+   * computed on the Sha1Hasher pool.
    */
-  Hash getSha1(FileInode& inode);
+  folly::Future<Hash> getSha1(FileInode& inode);
 
   /**
    * Reads the entire file's contents into memory and returns it.
@@ -77,9 +83,18 @@ class OverlayFileAccess {
   /**
    * Reads a range from the file. At EOF, may return a BufVec smaller than the
    * requested size.
+   *
+   * The returned BufVec refers to the overlay file rather than holding a copy
+   * of the data, so read errors are reported when its contents are accessed.
    */
   BufVec read(FileInode& inode, size_t size, off_t off);
 
+  /**
+   * Advises the kernel that size bytes of the file at off will be read soon,
+   * so that it can start reading them into the page cache.
+   */
+  void readAhead(FileInode& inode, size_t size, off_t off);
+
   /**
    * Writes data into the file at the specified offset. Returns the number of
    * bytes written.
@@ -116,8 +131,16 @@ class OverlayFileAccess {
    * concurrent with write or truncate, a version number is incremented on every
    * modification to an entry's file, and checked before writing the cached
    * value back.
+   *
+   * So that modifying a large file does not require hashing all of it again,
+   * the SHA-1 state is also saved every kSha1CheckpointInterval bytes.  A
+   * modification only discards the checkpoints past the modified offset, and
+   * getSha1 resumes from the last remaining one.  Appending to a file thus
+   * only hashes the appended data.
    */
 
+  static constexpr size_t kSha1CheckpointInterval = 1024 * 1024;
+
   struct Entry {
     Entry(OverlayFile f, std::optional<size_t> s, const std::optional<Hash>& h)
         : file{std::move(f)}, info{folly::in_place, s, h} {}
@@ -126,11 +149,21 @@ class OverlayFileAccess {
       Info(std::optional<size_t> s, const std::optional<Hash>& h)
           : size{s}, sha1{h} {}
 
-      void invalidateMetadata();
+      /**
+       * Invalidate the cached metadata after the file contents starting at
+       * offset modifiedOffset were changed.
+       */
+      void invalidateMetadata(uint64_t modifiedOffset);
 
       std::optional<size_t> size;
       std::optional<Hash> sha1;
       uint64_t version{0};
+
+      /**
+       * sha1Checkpoints[i] is the SHA-1 state after hashing the first
+       * (i + 1) * kSha1CheckpointInterval bytes of the file.
+       */
+      std::vector<SHA_CTX> sha1Checkpoints;
     };
 
     const OverlayFile file;
@@ -153,6 +186,18 @@ class OverlayFileAccess {
    */
   EntryPtr getEntryForInode(InodeNumber);
 
+  /**
+   * Finish hashing the entry's file, starting after checkpointCount
+   * checkpoints with the state ctx, and cache the result if the file is
+   * still at the given version.
+   */
+  static Hash computeSha1(
+      Entry& entry,
+      FileInode& inode,
+      uint64_t version,
+      SHA_CTX ctx,
+      size_t checkpointCount);
+
   Overlay* overlay_ = nullptr;
   folly::Synchronized<State> state_;
 };
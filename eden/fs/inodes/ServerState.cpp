@@ -31,6 +31,15 @@ constexpr std::chrono::seconds kUserIgnoreMinPollSeconds{5};
 /** Throttle Ignore change checks, max of 1 per kSystemIgnoreMinPollSeconds */
 constexpr std::chrono::seconds kSystemIgnoreMinPollSeconds{5};
 
+/** The number of parsed .gitignore files to keep in the GitIgnoreCache */
+constexpr size_t kGitIgnoreCacheSize{10000};
+
+/** The number of compiled glob sets to keep in the GlobNodeCache */
+constexpr size_t kGlobNodeCacheSize{512};
+
+/** The number of memoized glob results for unmaterialized trees to keep */
+constexpr size_t kGlobTreeResultCacheSize{50000};
+
 ServerState::ServerState(
     UserInfo userInfo,
     std::shared_ptr<PrivHelper> privHelper,
@@ -54,6 +63,8 @@ ServerState::ServerState(
       systemIgnoreFileMonitor_{CachedParsedFileMonitor<GitIgnoreFileParser>{
           edenConfig->systemIgnoreFile.getValue(),
           kSystemIgnoreMinPollSeconds}},
+      gitIgnoreCache_{kGitIgnoreCacheSize},
+      globNodeCache_{kGlobNodeCacheSize, kGlobTreeResultCacheSize},
       notifications_(config_) {
   // It would be nice if we eventually built a more generic mechanism for
   // defining faults to be configured on start up.  (e.g., loading this from the
@@ -66,10 +77,37 @@ ServerState::ServerState(
   if (FLAGS_fault_injection_block_mounts) {
     faultInjector_->injectBlock("mount", ".*");
   }
+
+  auto createFuseRequestPool = [](uint32_t numThreads,
+                                  folly::StringPiece name) {
+    return numThreads == 0
+        ? nullptr
+        : std::make_shared<UnboundedQueueExecutor>(numThreads, name);
+  };
+  fuseRequestPools_[static_cast<size_t>(FuseRequestClass::Metadata)] =
+      createFuseRequestPool(
+          edenConfig->fuseMetadataThreads.getValue(), "FuseMetadata");
+  fuseRequestPools_[static_cast<size_t>(FuseRequestClass::Data)] =
+      createFuseRequestPool(edenConfig->fuseDataThreads.getValue(), "FuseData");
+  fuseRequestPools_[static_cast<size_t>(FuseRequestClass::Mutation)] =
+      createFuseRequestPool(
+          edenConfig->fuseMutationThreads.getValue(), "FuseMutation");
 }
 
 ServerState::~ServerState() {}
 
+void ServerState::resizeFuseRequestPools(const EdenConfig& config) {
+  auto resize = [this](FuseRequestClass requestClass, uint32_t numThreads) {
+    auto& pool = fuseRequestPools_[static_cast<size_t>(requestClass)];
+    if (pool && numThreads > 0) {
+      pool->setNumThreads(numThreads);
+    }
+  };
+  resize(FuseRequestClass::Metadata, config.fuseMetadataThreads.getValue());
+  resize(FuseRequestClass::Data, config.fuseDataThreads.getValue());
+  resize(FuseRequestClass::Mutation, config.fuseMutationThreads.getValue());
+}
+
 std::unique_ptr<TopLevelIgnores> ServerState::getTopLevelIgnores() {
   // Update EdenConfig to detect changes to the system or user ignore files
   auto edenConfig = getEdenConfig();
@@ -97,5 +135,10 @@ std::unique_ptr<TopLevelIgnores> ServerState::getTopLevelIgnores() {
       std::move(userGitIgnore), std::move(systemGitIgnore));
 }
 
+size_t ServerState::getTopLevelIgnoresGeneration() const {
+  return userIgnoreFileMonitor_.rlock()->getUpdateCount() +
+      systemIgnoreFileMonitor_.rlock()->getUpdateCount();
+}
+
 } // namespace eden
 } // namespace facebook
@@ -8,12 +8,16 @@
 #pragma once
 
 #include <folly/ThreadLocal.h>
+#include <array>
 #include <chrono>
 #include <memory>
 
 #include "eden/fs/config/CachedParsedFileMonitor.h"
 #include "eden/fs/config/ReloadableConfig.h"
+#include "eden/fs/fuse/FuseRequestClass.h"
 #include "eden/fs/fuse/privhelper/PrivHelper.h"
+#include "eden/fs/inodes/GlobNodeCache.h"
+#include "eden/fs/model/git/GitIgnoreCache.h"
 #include "eden/fs/model/git/GitIgnoreFileParser.h"
 #include "eden/fs/notifications/Notifications.h"
 #include "eden/fs/telemetry/EdenStats.h"
@@ -94,12 +98,41 @@ class ServerState {
     return config_.getEdenConfig(reload);
   }
 
+  /**
+   * Get the most recently loaded EdenConfig without checking the config
+   * files.  Cheap enough for per-request paths; see
+   * ReloadableConfig::getConfigSnapshot().
+   */
+  const EdenConfig& getConfigSnapshot() const {
+    return config_.getConfigSnapshot();
+  }
+
   /**
    * Get the TopLevelIgnores. It is based on the system and user git ignore
    * files.
    */
   std::unique_ptr<TopLevelIgnores> getTopLevelIgnores();
 
+  /**
+   * Returns a number that changes each time getTopLevelIgnores() picks up a
+   * change to the system or user git ignore file.
+   */
+  size_t getTopLevelIgnoresGeneration() const;
+
+  /**
+   * Get the cache of parsed .gitignore files shared by all mounts.
+   */
+  GitIgnoreCache& getGitIgnoreCache() {
+    return gitIgnoreCache_;
+  }
+
+  /**
+   * Get the cache of compiled globs shared by all mounts.
+   */
+  GlobNodeCache& getGlobNodeCache() {
+    return globNodeCache_;
+  }
+
   /**
    * Get the UserInfo object describing the user running this edenfs process.
    */
@@ -124,6 +157,26 @@ class ServerState {
     return threadPool_;
   }
 
+  /**
+   * Get the thread pool that FUSE requests of the given class are handled in.
+   *
+   * Returns null if the FUSE worker threads should handle these requests
+   * themselves.
+   */
+  const std::shared_ptr<UnboundedQueueExecutor>& getFuseRequestPool(
+      FuseRequestClass requestClass) const {
+    return fuseRequestPools_[static_cast<size_t>(requestClass)];
+  }
+
+  /**
+   * Resize the FUSE request pools to the thread counts in config.
+   *
+   * Pools are only created on startup, so a class handled on the FUSE worker
+   * threads keeps being handled there, and a pool whose configured count
+   * drops to 0 keeps its current threads until EdenFS restarts.
+   */
+  void resizeFuseRequestPools(const EdenConfig& config);
+
   /**
    * Get the Clock.
    */
@@ -153,6 +206,8 @@ class ServerState {
   EdenStats edenStats_;
   std::shared_ptr<PrivHelper> privHelper_;
   std::shared_ptr<UnboundedQueueExecutor> threadPool_;
+  std::array<std::shared_ptr<UnboundedQueueExecutor>, kNumFuseRequestClasses>
+      fuseRequestPools_;
   std::shared_ptr<Clock> clock_;
   std::shared_ptr<ProcessNameCache> processNameCache_;
   std::shared_ptr<StructuredLogger> structuredLogger_;
@@ -163,6 +218,8 @@ class ServerState {
       userIgnoreFileMonitor_;
   folly::Synchronized<CachedParsedFileMonitor<GitIgnoreFileParser>>
       systemIgnoreFileMonitor_;
+  GitIgnoreCache gitIgnoreCache_;
+  GlobNodeCache globNodeCache_;
   Notifications notifications_;
 };
 } // namespace eden
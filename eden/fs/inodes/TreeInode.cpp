@@ -9,7 +9,9 @@
 
 #include <boost/polymorphic_cast.hpp>
 #include <folly/chrono/Conv.h>
+#include <folly/executors/ExecutorWithPriority.h>
 #include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/xlog.h>
 #include <vector>
@@ -27,7 +29,10 @@
 #include "eden/fs/inodes/TreePrefetchLease.h"
 #include "eden/fs/journal/JournalDelta.h"
 #include "eden/fs/model/Tree.h"
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/model/CheckoutFilter.h"
 #include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/model/git/GitIgnoreCache.h"
 #include "eden/fs/model/git/GitIgnoreStack.h"
 #include "eden/fs/service/ThriftUtil.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
@@ -309,6 +314,60 @@ Future<InodePtr> TreeInode::getOrLoadChild(PathComponentPiece name) {
       .ensure([b = std::move(block)]() mutable { b.close(); });
 }
 
+#ifndef _WIN32
+std::optional<std::pair<InodeNumber, Future<struct stat>>>
+TreeInode::statUnloadedChildForLookup(
+    PathComponentPiece name,
+    ObjectFetchContext& context) {
+  if (name == kDotEdenName && getNodeId() != kRootNodeId) {
+    return std::nullopt;
+  }
+
+  InodeNumber childNumber;
+  mode_t mode;
+  Hash hash;
+  {
+    auto contents = contents_.wlock();
+    auto iter = contents->entries.find(name);
+    if (iter == contents->entries.end()) {
+      return std::nullopt;
+    }
+    const auto& entry = iter->second;
+    if (entry.getInode() || entry.isDirectory() || entry.isMaterialized()) {
+      return std::nullopt;
+    }
+
+    childNumber = entry.getInodeNumber();
+    mode = entry.getInitialMode();
+    hash = entry.getHash();
+    auto inodeName = copyCanonicalInodeName(iter);
+    getInodeMap()->incUnloadedChildFuseRefcount(
+        this, inodeName.piece(), childNumber, mode, hash);
+  }
+
+  // Match what FileInode::stat() would report once the inode is loaded.
+  // The reference is already recorded, so errors must go through the future.
+  auto future = folly::makeFutureWith([&] {
+    auto* metadataTable = getMount()->getInodeMetadataTable();
+    metadataTable->populateIfNotSet(childNumber, [&] {
+      return getMount()->getInitialInodeMetadata(mode);
+    });
+    auto st = getMount()->initStatData();
+    st.st_nlink = 1;
+    st.st_ino = childNumber.get();
+    metadataTable->getOrThrow(childNumber).applyToStat(st);
+
+    return getStore()->getBlobSize(hash, context).thenValue(
+        [st](uint64_t size) mutable {
+          st.st_size = size;
+          FileInode::updateBlockCount(st);
+          return st;
+        });
+  });
+  return std::make_pair(childNumber, std::move(future));
+}
+#endif // !_WIN32
+
 Future<TreeInodePtr> TreeInode::getOrLoadChildTree(PathComponentPiece name) {
   return getOrLoadChild(name).thenValue([](InodePtr child) {
     auto treeInode = child.asTreePtrOrNull();
@@ -631,6 +690,9 @@ Future<unique_ptr<InodeBase>> TreeInode::startLoadingInode(
   }
 
   if (!entry.isMaterialized()) {
+    getMount()->getDirectoryAccessStats().record(
+        DirectoryAccessStats::AccessType::TreeLoad,
+        [this] { return getPath(); });
     return getStore()
         ->getTree(entry.getHash(), fetchContext)
         .thenValue(
@@ -641,6 +703,7 @@ Future<unique_ptr<InodeBase>> TreeInode::startLoadingInode(
              number = entry.getInodeNumber()](
                 std::shared_ptr<const Tree> tree) mutable
             -> unique_ptr<InodeBase> {
+              tree = self->filterTree(std::move(tree), childName);
               // Even if the inode is not materialized, it may have inode
               // numbers stored in the overlay.
               auto overlayDir = self->loadOverlayDir(number);
@@ -841,6 +904,9 @@ std::optional<DirContents> TreeInode::loadOverlayDir(
 }
 
 void TreeInode::saveOverlayDir(const DirContents& contents) const {
+#ifdef _WIN32
+  contentsGeneration_.fetch_add(1, std::memory_order_acq_rel);
+#endif
   return saveOverlayDir(getNodeId(), contents);
 }
 
@@ -864,23 +930,42 @@ DirContents TreeInode::saveDirFromTree(
 DirContents TreeInode::buildDirFromTree(const Tree* tree, Overlay* overlay) {
   CHECK(tree);
 
-  // A future optimization is for this code to allocate all of the inode numbers
-  // at once and then dole them out, one per entry. It would reduce the number
-  // of atomic operations from N to 1, though if the atomic is issued with the
-  // other work this loop is doing it may not matter much.
-
   DirContents dir;
-  // TODO: O(N^2)
-  for (const auto& treeEntry : tree->getTreeEntries()) {
+  const auto& entries = tree->getTreeEntries();
+  if (entries.empty()) {
+    return dir;
+  }
+
+  // Allocate all of the inode numbers at once and dole them out, one per
+  // entry.  Tree entries are sorted, so each emplace() appends to the end of
+  // the reserved storage.
+  auto nextInodeNumber = overlay->allocateInodeNumbers(entries.size()).get();
+  dir.reserve(entries.size());
+  for (const auto& treeEntry : entries) {
     dir.emplace(
         treeEntry.getName(),
         modeFromTreeEntryType(treeEntry.getType()),
-        overlay->allocateInodeNumber(),
+        InodeNumber{nextInodeNumber++},
         treeEntry.getHash());
   }
   return dir;
 }
 
+std::shared_ptr<const Tree> TreeInode::filterTree(
+    std::shared_ptr<const Tree> tree,
+    PathComponentPiece childName) const {
+  const auto& filter = getMount()->getCheckoutFilter();
+  if (filter.empty()) {
+    return tree;
+  }
+  auto path = getPath();
+  if (!path) {
+    // Nothing new is looked up in an unlinked directory.
+    return tree;
+  }
+  return filter.filterTree(std::move(tree), *path + childName);
+}
+
 FileInodePtr TreeInode::createImpl(
     folly::Synchronized<TreeInodeState>::LockedPtr contents,
     PathComponentPiece name,
@@ -959,8 +1044,10 @@ FileInodePtr TreeInode::createImpl(
 
 #ifndef _WIN32
     updateMtimeAndCtimeLocked(contents->entries, now);
-    getMount()->getServerState()->getFaultInjector().check(
-        "createInodeSaveOverlay", name.stringPiece());
+    EDEN_CHECK_FAULT(
+        getMount()->getServerState()->getFaultInjector(),
+        "createInodeSaveOverlay",
+        name.stringPiece());
 #endif
 
     saveOverlayDir(contents->entries);
@@ -1137,6 +1224,130 @@ folly::Future<folly::Unit> TreeInode::rmdir(
       });
 }
 
+folly::Future<folly::Unit> TreeInode::removeRecursively(
+    PathComponentPiece name,
+    InvalidationRequired invalidate) {
+  int errnoValue = tryRemoveUnloadedSubtree(name, invalidate);
+  if (errnoValue == 0) {
+    return folly::unit;
+  }
+  if (errnoValue != EBADF) {
+    return makeFuture<Unit>(InodeError(errnoValue, inodePtrFromThis(), name));
+  }
+
+  return getOrLoadChildTree(name).thenValue(
+      [self = inodePtrFromThis(), childName = PathComponent{name}, invalidate](
+          const TreeInodePtr& child) {
+        std::vector<std::pair<PathComponent, bool>> children;
+        {
+          auto contents = child->contents_.rlock();
+          for (const auto& entry : contents->entries) {
+            children.emplace_back(entry.first, entry.second.isDirectory());
+          }
+        }
+
+        std::vector<folly::Future<folly::Unit>> futures;
+        for (const auto& [grandchildName, isDirectory] : children) {
+          if (isDirectory) {
+            futures.push_back(
+                child->removeRecursively(grandchildName, invalidate));
+          } else {
+            futures.push_back(child->unlink(grandchildName, invalidate));
+          }
+        }
+        return folly::collect(std::move(futures))
+            .thenValue([self, childName, invalidate](auto&&) {
+              return self->rmdir(childName, invalidate);
+            });
+      });
+}
+
+int TreeInode::tryRemoveUnloadedSubtree(
+    PathComponentPiece name,
+    InvalidationRequired invalidate) {
+#ifndef _WIN32
+  // prevent unlinking files in the .eden directory
+  if (getNodeId() == getMount()->getDotEdenInodeNumber()) {
+    return EPERM;
+  }
+#endif // !_WIN32
+
+  // Materialization, loads and the kernel remembering an inode all propagate
+  // up to the parent directory, so if none of them have happened to the
+  // entry itself then nothing beneath it needs to be visited.
+  auto* inodeMap = getMount()->getInodeMap();
+  auto checkEntry = [&](const DirContents& entries) {
+    auto iter = entries.find(name);
+    if (iter == entries.end()) {
+      return ENOENT;
+    }
+    const auto& entry = iter->second;
+    if (!entry.isDirectory()) {
+      return ENOTDIR;
+    }
+    if (entry.getInode() || entry.isMaterialized() ||
+        inodeMap->isInodeRemembered(entry.getInodeNumber())) {
+      return EBADF;
+    }
+    return 0;
+  };
+
+  // Check before materializing ourself, which the slow path may not need.
+  {
+    auto contents = contents_.rlock();
+    int errnoValue = checkEntry(contents->entries);
+    if (errnoValue != 0) {
+      return errnoValue;
+    }
+  }
+
+  auto renameLock = getMount()->acquireRenameLock();
+  auto myPath = getPath();
+  if (!myPath.has_value()) {
+    return ENOENT;
+  }
+  materialize(&renameLock);
+
+  InodeNumber childNumber;
+  std::optional<PathComponent> childName;
+  {
+    auto contents = contents_.wlock();
+    int errnoValue = checkEntry(contents->entries);
+    if (errnoValue != 0) {
+      return errnoValue;
+    }
+    auto entIter = contents->entries.find(name);
+    childName = copyCanonicalInodeName(entIter);
+    childNumber = entIter->second.getInodeNumber();
+    contents->entries.erase(entIter);
+
+#ifndef _WIN32
+    updateMtimeAndCtimeLocked(contents->entries, getNow());
+#endif
+    saveOverlayDir(contents->entries);
+  }
+
+  auto targetName = myPath.value() + childName->piece();
+  getMount()->getJournal().recordRemoved(targetName);
+  getMount()->getInodePathCache().invalidate(targetName);
+  renameLock.unlock();
+
+#ifdef _WIN32
+  invalidateChannelEntryCache(childName->piece());
+#else
+  // Forget the inode numbers that were allocated beneath the entry, as
+  // checkout does when it removes an unloaded subtree.
+  getOverlay()->recursivelyRemoveOverlayData(childNumber);
+
+  if (InvalidationRequired::Yes == invalidate) {
+    invalidateFuseInodeCache();
+    invalidateChannelEntryCache(childName->piece());
+  }
+#endif
+
+  return 0;
+}
+
 template <typename InodePtrType>
 folly::Future<folly::Unit> TreeInode::removeImpl(
     PathComponent name,
@@ -1183,6 +1394,7 @@ folly::Future<folly::Unit> TreeInode::removeImpl(
     // We successfully removed the child.
     // Record the change in the journal.
     getMount()->getJournal().recordRemoved(targetName);
+    getMount()->getInodePathCache().invalidate(targetName);
 
     return folly::unit;
   }
@@ -1367,7 +1579,7 @@ class TreeInode::TreeRenameLocks {
     return destContents_;
   }
 
-  const PathMap<DirEntry>::iterator& destChildIter() const {
+  const DirContents::iterator& destChildIter() const {
     return destChildIter_;
   }
   InodeBase* destChild() const {
@@ -1425,7 +1637,7 @@ class TreeInode::TreeRenameLocks {
    * This may point to destContents_->entries.end() if the destination child
    * does not exist.
    */
-  PathMap<DirEntry>::iterator destChildIter_;
+  DirContents::iterator destChildIter_;
 };
 
 Future<Unit> TreeInode::rename(
@@ -1443,6 +1655,13 @@ Future<Unit> TreeInode::rename(
 #endif
   validatePathComponentLength(destName);
 
+  if (destParent.get() == this) {
+    auto result = tryRenameWithinDirectory(name, destName, invalidate);
+    if (result.has_value()) {
+      return std::move(result).value();
+    }
+  }
+
   bool needSrc = false;
   bool needDest = false;
   {
@@ -1569,7 +1788,7 @@ bool isAncestor(const RenameLock& renameLock, TreeInode* a, TreeInode* b) {
 Future<Unit> TreeInode::doRename(
     TreeRenameLocks&& locks,
     PathComponentPiece srcName,
-    PathMap<DirEntry>::iterator srcIter,
+    DirContents::iterator srcIter,
     TreeInodePtr destParent,
     PathComponentPiece destName,
     InvalidationRequired invalidate) {
@@ -1643,7 +1862,7 @@ Future<Unit> TreeInode::doRename(
   // Save the overlay data
   saveOverlayDir(*locks.srcContents());
   if (destParent.get() != this) {
-    saveOverlayDir(destParent->getNodeId(), *locks.destContents());
+    destParent->saveOverlayDir(*locks.destContents());
   }
 
   // Release the TreeInode locks before we write a journal entry.
@@ -1656,13 +1875,16 @@ Future<Unit> TreeInode::doRename(
   auto srcPath = getPath();
   auto destPath = destParent->getPath();
   if (srcPath.has_value() && destPath.has_value()) {
+    auto srcChildPath = srcPath.value() + srcName;
+    auto destChildPath = destPath.value() + destName;
     if (destChildExists) {
-      getMount()->getJournal().recordReplaced(
-          srcPath.value() + srcName, destPath.value() + destName);
+      getMount()->getJournal().recordReplaced(srcChildPath, destChildPath);
     } else {
-      getMount()->getJournal().recordRenamed(
-          srcPath.value() + srcName, destPath.value() + destName);
+      getMount()->getJournal().recordRenamed(srcChildPath, destChildPath);
     }
+    auto& pathCache = getMount()->getInodePathCache();
+    pathCache.invalidate(srcChildPath);
+    pathCache.invalidate(destChildPath);
   }
 
   // Release the rename lock before we destroy the deleted destination child
@@ -1686,6 +1908,91 @@ Future<Unit> TreeInode::doRename(
   return folly::unit;
 }
 
+std::optional<Future<Unit>> TreeInode::tryRenameWithinDirectory(
+    PathComponentPiece srcName,
+    PathComponentPiece destName,
+    InvalidationRequired invalidate) {
+  // No directory changes parents here, so the shared rename lock is enough to
+  // keep the paths of this directory and its ancestors stable, and our
+  // contents lock serializes this with every other change to this directory.
+  auto renameLock = getMount()->acquireSharedRenameLock();
+  std::unique_ptr<InodeBase> deletedInode;
+  {
+    auto contents = contents_.wlock();
+    // Materializing needs the exclusive rename lock, as do the error cases,
+    // which are left to rename() so that it reports them.
+    if (!contents->isMaterialized() || isUnlinked()) {
+      return std::nullopt;
+    }
+    auto& entries = contents->entries;
+    auto srcIter = entries.find(srcName);
+    if (srcIter == entries.end() || srcIter->second.isDirectory() ||
+        !srcIter->second.getInode()) {
+      return std::nullopt;
+    }
+    auto destIter = entries.find(destName);
+    bool destChildExists = destIter != entries.end();
+    if (destChildExists) {
+      if (destIter->second.isDirectory() || !destIter->second.getInode()) {
+        return std::nullopt;
+      }
+      if (destIter->second.getInode() == srcIter->second.getInode()) {
+        return Future<Unit>{folly::unit};
+      }
+    }
+
+    auto* childInode = srcIter->second.getInode();
+    if (destChildExists) {
+      deletedInode = destIter->second.getInode()->markUnlinked(
+          this, destName, renameLock);
+      destIter->second = std::move(srcIter->second);
+    } else {
+      auto ret = entries.emplace(destName, std::move(srcIter->second));
+      CHECK(ret.second);
+      srcIter = entries.find(srcName);
+    }
+    childInode->updateName(this, destName, renameLock);
+    entries.erase(srcIter);
+
+#ifndef _WIN32
+    updateMtimeAndCtimeLocked(entries, getNow());
+#endif
+    saveOverlayDir(entries);
+
+    // Without the exclusive rename lock it is our contents lock that orders
+    // the renames in this directory, so keep holding it while writing the
+    // journal entry.
+    auto path = getPath();
+    if (path.has_value()) {
+      auto srcChildPath = path.value() + srcName;
+      auto destChildPath = path.value() + destName;
+      if (destChildExists) {
+        getMount()->getJournal().recordReplaced(srcChildPath, destChildPath);
+      } else {
+        getMount()->getJournal().recordRenamed(srcChildPath, destChildPath);
+      }
+      auto& pathCache = getMount()->getInodePathCache();
+      pathCache.invalidate(srcChildPath);
+      pathCache.invalidate(destChildPath);
+    }
+  }
+
+  // Release the rename lock before we destroy the deleted destination child
+  // inode (if it exists).
+  renameLock.unlock();
+  deletedInode.reset();
+
+#ifndef _WIN32
+  if (InvalidationRequired::Yes == invalidate) {
+    invalidateFuseInodeCache();
+    invalidateChannelEntryCache(srcName);
+    invalidateChannelEntryCache(destName);
+  }
+#endif
+
+  return Future<Unit>{folly::unit};
+}
+
 /**
  * Acquire the locks necessary for a rename operation.
  *
@@ -1789,14 +2096,16 @@ TreeInode::readdir(DirList&& list, off_t off, ObjectFetchContext& /*context*/) {
    * the entry at `off` being removed before the next readdir. (How do you find
    * where to restart in the stream?).
    *
-   * Today, Eden does not support hard links. Therefore, in the short term, we
-   * can store inode numbers in off_t and treat them as an index into an
-   * inode-sorted list of entries. This has quadratic time complexity without an
-   * additional index but is correct.
+   * Today, Eden does not support hard links. Therefore, we can store inode
+   * numbers in off_t and treat them as an index into an inode-sorted list of
+   * entries. Inode numbers are already stable, persisted in the overlay, and
+   * never reused, which makes them good readdir cookies.
    *
-   * In the long term, especially when Eden's tree directory structure is stored
-   * in SQLite or something similar, we should maintain a seekdir/readdir cookie
-   * index and use said cookies to enumerate entries.
+   * To avoid walking the whole directory on every call, the inode-sorted list
+   * is built when a stream starts and kept in readdirIndex_ until a stream
+   * reaches the end. Entries added after that are not returned by the streams
+   * already in progress, which POSIX allows. Entries removed or replaced since
+   * are checked against the live contents and skipped.
    *
    * - https://oss.oracle.com/pipermail/btrfs-devel/2008-January/000463.html
    * - https://yarchive.net/comp/linux/readdir_nonatomicity.html
@@ -1840,47 +2149,83 @@ TreeInode::readdir(DirList&& list, off_t off, ObjectFetchContext& /*context*/) {
     }
   }
 
+  // A new stream always builds a new index, so that it sees every entry
+  // that was added before it started.
+  std::shared_ptr<const ReaddirIndex> index;
+  if (off > 2) {
+    index = *readdirIndex_.rlock();
+  }
+
   auto dir = contents_.rlock();
   auto& entries = dir->entries;
 
-  // Compute an index into the PathMap by InodeNumber, only including the
-  // entries that are greater than the given offset.
-  std::vector<std::pair<InodeNumber, size_t>> indices;
-  indices.reserve(entries.size());
-  size_t index = 0;
-  for (auto& entry : entries) {
-    auto inodeNumber = entry.second.getInodeNumber();
-    if (static_cast<off_t>(inodeNumber.get() + 2) > off) {
-      indices.emplace_back(entry.second.getInodeNumber(), index);
+  if (!index) {
+    auto newIndex = std::make_shared<ReaddirIndex>();
+    newIndex->reserve(entries.size());
+    for (auto& [name, entry] : entries) {
+      newIndex->emplace_back(entry.getInodeNumber(), name);
     }
-    ++index;
+    std::sort(
+        newIndex->begin(),
+        newIndex->end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+    index = newIndex;
+    *readdirIndex_.wlock() = index;
   }
-  std::make_heap(indices.begin(), indices.end(), std::greater<>{});
+
+  // Resume after the entry with the given offset.
+  auto it = std::upper_bound(
+      index->begin(), index->end(), off, [](off_t offset, const auto& indexed) {
+        return offset < static_cast<off_t>(indexed.first.get() + 2);
+      });
 
   // The provided DirList has limited space. Add entries until no more fit.
-  while (indices.size()) {
-    std::pop_heap(indices.begin(), indices.end(), std::greater<>{});
-    auto& [name, entry] = entries.begin()[indices.back().second];
-    indices.pop_back();
+  for (; it != index->end(); ++it) {
+    auto entryIter = entries.find(it->second);
+    if (entryIter == entries.end() ||
+        entryIter->second.getInodeNumber() != it->first) {
+      // Removed or replaced since the index was built.
+      continue;
+    }
 
+    auto& [name, entry] = *entryIter;
     if (!list.add(
             name.stringPiece(),
             entry.getInodeNumber().get(),
             entry.getDtype(),
             entry.getInodeNumber().get() + 2)) {
-      break;
+      return std::move(list);
     }
   }
 
+  // This stream has reached the end of the directory.  Drop the index unless
+  // another stream has replaced it in the meantime.
+  auto lockedIndex = readdirIndex_.wlock();
+  if (*lockedIndex == index) {
+    lockedIndex->reset();
+  }
   return std::move(list);
 }
 
 #else
 
-folly::Future<std::vector<FileMetadata>> TreeInode::readdir() {
+folly::Future<std::shared_ptr<const std::vector<FileMetadata>>>
+TreeInode::readdir() {
   vector<Future<FileMetadata>> futures;
+  std::optional<Hash> treeHash;
+  uint64_t generation;
   {
     auto dir = contents_.rlock();
+    treeHash = dir->treeHash;
+    generation = contentsGeneration_.load(std::memory_order_acquire);
+    {
+      auto snapshot = enumerationSnapshot_.rlock();
+      if (snapshot->has_value() && (*snapshot)->treeHash == treeHash &&
+          (*snapshot)->generation == generation) {
+        return folly::makeFuture((*snapshot)->entries);
+      }
+    }
+
     auto& entries = dir->entries;
     futures.reserve(entries.size());
 
@@ -1911,7 +2256,19 @@ folly::Future<std::vector<FileMetadata>> TreeInode::readdir() {
   }
 
   return folly::collect(std::move(futures))
-      .via(getMount()->getServerState()->getThreadPool().get());
+      .via(getMount()->getServerState()->getThreadPool().get())
+      .thenValue([self = inodePtrFromThis(),
+                  treeHash = std::move(treeHash),
+                  generation](std::vector<FileMetadata> list) mutable {
+        Enumerator::sortEntries(list);
+        auto entries =
+            std::make_shared<const std::vector<FileMetadata>>(std::move(list));
+        // If the contents changed while the sizes were fetched, the next
+        // readdir() will see a newer generation and rebuild the list.
+        *self->enumerationSnapshot_.wlock() =
+            EnumerationSnapshot{std::move(treeHash), generation, entries};
+        return entries;
+      });
 }
 #endif // _WIN32
 
@@ -1950,6 +2307,7 @@ Future<Unit> TreeInode::diff(
 
   InodePtr inode;
   auto gitignoreInodeFuture = Future<InodePtr>::makeEmpty();
+  std::optional<Hash> gitignoreHash;
   vector<IncompleteInodeLoad> pendingLoads;
   {
     // We have to get a write lock since we may have to load
@@ -2019,7 +2377,12 @@ Future<Unit> TreeInode::diff(
 
     XLOG(DBG7) << "Loading ignore file for " << getLogPath();
     inode = gitignoreEntry->getInodePtr();
-    if (!inode) {
+    if (!inode && !gitignoreEntry->isMaterialized() &&
+        gitignoreEntry->getDtype() == dtype_t::Regular) {
+      // An unmodified ignore file can be read from the store by its hash,
+      // without loading an inode for it.
+      gitignoreHash = gitignoreEntry->getHash();
+    } else if (!inode) {
       gitignoreInodeFuture = loadChildLocked(
           contents->entries,
           kIgnoreFilename,
@@ -2035,58 +2398,91 @@ Future<Unit> TreeInode::diff(
     load.finish();
   }
 
-  if (!inode) {
-    return std::move(gitignoreInodeFuture)
-        .thenValue([self = inodePtrFromThis(),
-                    context,
-                    currentPath = RelativePath{currentPath},
-                    tree = std::move(tree),
-                    parentIgnore,
-                    isIgnored](InodePtr&& loadedInode) mutable {
-          return self->loadGitIgnoreThenDiff(
-              std::move(loadedInode),
-              context,
-              currentPath,
-              std::move(tree),
-              parentIgnore,
-              isIgnored);
-        });
+  auto ignoreFuture = Future<shared_ptr<const GitIgnore>>::makeEmpty();
+  if (gitignoreHash) {
+    ignoreFuture = loadGitIgnoreBlob(*gitignoreHash, context);
+  } else if (inode) {
+    ignoreFuture = loadGitIgnore(std::move(inode), context);
   } else {
-    return loadGitIgnoreThenDiff(
-        std::move(inode),
-        context,
-        currentPath,
-        std::move(tree),
-        parentIgnore,
-        isIgnored);
+    ignoreFuture = std::move(gitignoreInodeFuture)
+                       .thenValue([self = inodePtrFromThis(),
+                                   context](InodePtr&& loadedInode) {
+                         return self->loadGitIgnore(
+                             std::move(loadedInode), context);
+                       });
   }
+  return loadGitIgnoreThenDiff(
+      std::move(ignoreFuture),
+      context,
+      currentPath,
+      std::move(tree),
+      parentIgnore,
+      isIgnored);
 }
 
-Future<Unit> TreeInode::loadGitIgnoreThenDiff(
+Future<shared_ptr<const GitIgnore>> TreeInode::loadGitIgnore(
     InodePtr gitignoreInode,
+    DiffContext* context) {
+  // An unmodified ignore file is parsed once and then shared through the
+  // GitIgnoreCache.  Its contents are read from the store rather than the
+  // inode, so that they are sure to match the hash even if the file is
+  // modified concurrently.
+  if (gitignoreInode->getType() == dtype_t::Regular) {
+    if (auto blobHash = gitignoreInode.asFilePtr()->getBlobHash()) {
+      return loadGitIgnoreBlob(*blobHash, context);
+    }
+  }
+
+  return getMount()
+      ->loadFileContents(context->getFetchContext(), gitignoreInode)
+      .thenValue([](std::string&& ignoreFileContents) {
+        auto ignore = std::make_shared<GitIgnore>();
+        ignore->loadFile(ignoreFileContents);
+        return shared_ptr<const GitIgnore>{std::move(ignore)};
+      });
+}
+
+Future<shared_ptr<const GitIgnore>> TreeInode::loadGitIgnoreBlob(
+    const Hash& blobHash,
+    DiffContext* context) {
+  auto& ignoreCache = getMount()->getServerState()->getGitIgnoreCache();
+  if (auto ignore = ignoreCache.get(blobHash)) {
+    return makeFuture(std::move(ignore));
+  }
+  return context->store->getBlob(blobHash, context->getFetchContext())
+      .thenValue([&ignoreCache, blobHash](shared_ptr<const Blob>&& blob) {
+        const auto& contentsBuf = blob->getContents();
+        folly::io::Cursor cursor(&contentsBuf);
+        return ignoreCache.insert(
+            blobHash,
+            cursor.readFixedString(contentsBuf.computeChainDataLength()));
+      });
+}
+
+Future<Unit> TreeInode::loadGitIgnoreThenDiff(
+    Future<shared_ptr<const GitIgnore>> ignoreFuture,
     DiffContext* context,
     RelativePathPiece currentPath,
     shared_ptr<const Tree> tree,
     const GitIgnoreStack* parentIgnore,
     bool isIgnored) {
-  return getMount()
-      ->loadFileContents(context->getFetchContext(), gitignoreInode)
+  return std::move(ignoreFuture)
       .thenError([](const folly::exception_wrapper& ex) {
         XLOG(WARN) << "error reading ignore file: " << folly::exceptionStr(ex);
-        return std::string{};
+        return std::make_shared<const GitIgnore>();
       })
       .thenValue([self = inodePtrFromThis(),
                   context,
                   currentPath = RelativePath{currentPath}, // deep copy
                   tree,
                   parentIgnore,
-                  isIgnored](std::string&& ignoreFileContents) mutable {
+                  isIgnored](shared_ptr<const GitIgnore>&& ignore) mutable {
         return self->computeDiff(
             self->contents_.wlock(),
             context,
             currentPath,
             std::move(tree),
-            make_unique<GitIgnoreStack>(parentIgnore, ignoreFileContents),
+            make_unique<GitIgnoreStack>(parentIgnore, std::move(ignore)),
             isIgnored);
       });
 }
@@ -2137,6 +2533,9 @@ Future<Unit> TreeInode::computeDiff(
   std::vector<PathComponent> modifiedFiles;
 
   std::vector<std::unique_ptr<DeferredDiffEntry>> deferredEntries;
+  // The loaded child directories that will read their .gitignore files, and
+  // the source control tree each is compared to.
+  std::vector<std::pair<TreeInodePtr, std::optional<Hash>>> childTrees;
   auto self = inodePtrFromThis();
 
   // Grab the contents_ lock, and loop to find children that might be
@@ -2160,7 +2559,17 @@ Future<Unit> TreeInode::computeDiff(
     // lead to deadlock.
     auto contents = std::move(contentsLock);
 
+    // Skip entries that are outside of the parts of the tree the context was
+    // restricted to.
+    auto isOutOfScope = [&](PathComponentPiece name) {
+      return context->hasScope() &&
+          !context->shouldExamine(currentPath + name);
+    };
+
     auto processUntracked = [&](PathComponentPiece name, DirEntry* inodeEntry) {
+      if (isOutOfScope(name)) {
+        return;
+      }
       bool entryIgnored = isIgnored;
       auto fileType = inodeEntry->isDirectory() ? GitIgnore::TYPE_DIR
                                                 : GitIgnore::TYPE_FILE;
@@ -2179,6 +2588,9 @@ Future<Unit> TreeInode::computeDiff(
       if (inodeEntry->isDirectory()) {
         if (!entryIgnored || context->listIgnored) {
           if (auto childPtr = inodeEntry->getInodePtr()) {
+            if (!entryIgnored) {
+              childTrees.emplace_back(childPtr.asTreePtrOrNull(), std::nullopt);
+            }
             deferredEntries.emplace_back(
                 DeferredDiffEntry::createUntrackedEntryFromInodeFuture(
                     context,
@@ -2229,7 +2641,16 @@ Future<Unit> TreeInode::computeDiff(
       }
     };
 
+    // Source control entries hidden by the checkout's filter are not in the
+    // working copy, and are not reported as removed.
+    auto isHidden = [&](PathComponentPiece name) {
+      return context->isHidden(currentPath + name);
+    };
+
     auto processRemoved = [&](const TreeEntry& scmEntry) {
+      if (isOutOfScope(scmEntry.getName()) || isHidden(scmEntry.getName())) {
+        return;
+      }
       if (scmEntry.isTree()) {
         deferredEntries.emplace_back(DeferredDiffEntry::createRemovedScmEntry(
             context, currentPath + scmEntry.getName(), scmEntry.getHash()));
@@ -2242,6 +2663,14 @@ Future<Unit> TreeInode::computeDiff(
 
     auto processBothPresent = [&](const TreeEntry& scmEntry,
                                   DirEntry* inodeEntry) {
+      if (isOutOfScope(scmEntry.getName())) {
+        return;
+      }
+      if (isHidden(scmEntry.getName())) {
+        // Anything created at a hidden path is new to the working copy.
+        processUntracked(scmEntry.getName(), inodeEntry);
+        return;
+      }
       // We only need to know the ignored status if this is a directory.
       // If this is a regular file on disk and in source control, then it
       // is always included since it is already tracked in source control.
@@ -2266,6 +2695,13 @@ Future<Unit> TreeInode::computeDiff(
       if (inodeEntry->getInode()) {
         // This inode is already loaded.
         auto childInodePtr = inodeEntry->getInodePtr();
+        if (auto childTree = childInodePtr.asTreePtrOrNull();
+            childTree && !entryIgnored) {
+          childTrees.emplace_back(
+              std::move(childTree),
+              scmEntry.isTree() ? std::make_optional(scmEntry.getHash())
+                                : std::nullopt);
+        }
         deferredEntries.emplace_back(DeferredDiffEntry::createModifiedEntry(
             context,
             entryPath,
@@ -2404,6 +2840,12 @@ Future<Unit> TreeInode::computeDiff(
     load.finish();
   }
 
+  // Start reading the children's .gitignore files together, so that they are
+  // fetched in one batch rather than one at a time as each child's diff gets
+  // to them.  The children find them in the GitIgnoreCache, or join the
+  // pending loads.
+  auto gitignorePrefetch = prefetchChildGitIgnores(context, childTrees);
+
   // Now process all of the deferred work.
   vector<Future<Unit>> deferredFutures;
   for (auto& entry : deferredEntries) {
@@ -2422,8 +2864,9 @@ Future<Unit> TreeInode::computeDiff(
                   // Capture ignore to ensure it remains valid until all of our
                   // children's diff operations complete.
                   ignore = std::move(ignore),
-                  deferredJobs = std::move(deferredEntries)](
-                     vector<folly::Try<Unit>> results) {
+                  deferredJobs = std::move(deferredEntries),
+                  gitignorePrefetch = std::move(gitignorePrefetch)](
+                     vector<folly::Try<Unit>> results) mutable {
         // Call diffError() for any jobs that failed.
         for (size_t n = 0; n < results.size(); ++n) {
           auto& result = results[n];
@@ -2438,10 +2881,60 @@ Future<Unit> TreeInode::computeDiff(
         // Report success here, even if some of our deferred jobs failed.
         // We will have reported those errors to the callback already, and so we
         // don't want our parent to report a new error at our path.
-        return makeFuture();
+        return std::move(gitignorePrefetch);
       });
 }
 
+std::optional<Hash> TreeInode::getUnloadedGitIgnoreHash(
+    const std::optional<Hash>& scmTreeHash) {
+  auto contents = contents_.rlock();
+  if (!contents->isMaterialized() && scmTreeHash &&
+      contents->treeHash.value() == *scmTreeHash) {
+    // diff() will return without reading the .gitignore file.
+    return std::nullopt;
+  }
+  auto iter = contents->entries.find(kIgnoreFilename);
+  if (iter == contents->entries.end()) {
+    return std::nullopt;
+  }
+  const auto& entry = iter->second;
+  if (entry.getInode() || entry.isMaterialized() ||
+      entry.getDtype() != dtype_t::Regular) {
+    return std::nullopt;
+  }
+  return entry.getHash();
+}
+
+Future<Unit> TreeInode::prefetchChildGitIgnores(
+    DiffContext* context,
+    const std::vector<std::pair<TreeInodePtr, std::optional<Hash>>>&
+        childTrees) {
+  if (childTrees.size() < 2) {
+    // There is nothing to batch.
+    return makeFuture();
+  }
+
+  auto& ignoreCache = getMount()->getServerState()->getGitIgnoreCache();
+  vector<Future<Unit>> loads;
+  for (const auto& [childTree, scmTreeHash] : childTrees) {
+    if (!childTree) {
+      continue;
+    }
+    auto hash = childTree->getUnloadedGitIgnoreHash(scmTreeHash);
+    if (hash && !ignoreCache.get(*hash)) {
+      // Errors are reported by the child's own diff.
+      loads.push_back(loadGitIgnoreBlob(*hash, context)
+                          .thenTry([](auto&&) { return folly::unit; }));
+    }
+  }
+  if (loads.empty()) {
+    return makeFuture();
+  }
+  XLOG(DBG7) << "diff: prefetching " << loads.size()
+             << " ignore files under " << getLogPath();
+  return folly::collectAll(loads).toUnsafeFuture().unit();
+}
+
 Future<Unit> TreeInode::checkout(
     CheckoutContext* ctx,
     std::shared_ptr<const Tree> fromTree,
@@ -2454,6 +2947,25 @@ Future<Unit> TreeInode::checkout(
   vector<IncompleteInodeLoad> pendingLoads;
   bool wasDirectoryListModified = false;
 
+  // Entries hidden by the checkout's filter are left out on both sides, so
+  // the checkout neither creates nor removes them.
+  const auto& filter = getMount()->getCheckoutFilter();
+  if (!filter.empty()) {
+    if (auto path = getPath()) {
+      fromTree = filter.filterTree(std::move(fromTree), *path);
+      toTree = filter.filterTree(std::move(toTree), *path);
+    }
+  }
+
+#ifndef _WIN32
+  // Loaded children have to be updated precisely, as if the checkout were
+  // creating and removing each file inside them, while unloaded children can
+  // simply be given their new hashes. Unload the children this checkout will
+  // change wherever nothing inside them is still in use, so that they take
+  // the fast path.
+  unloadChildrenChangedByCheckout(ctx, fromTree.get(), toTree.get());
+#endif // !_WIN32
+
   computeCheckoutActions(
       ctx,
       fromTree.get(),
@@ -2467,10 +2979,31 @@ Future<Unit> TreeInode::checkout(
     load.finish();
   }
 
+  // The actions only compare hashes, and replace files without fetching
+  // their new contents.  The files being replaced are in use, and are likely
+  // to be read again as soon as the checkout finishes, so fetch their new
+  // contents in one batch while the checkout runs rather than with a series
+  // of single imports afterwards.
+  vector<Hash> newBlobs;
+  if (!ctx->isDryRun()) {
+    for (const auto& action : actions) {
+      if (auto hash = action->getNewBlobHash()) {
+        newBlobs.push_back(*hash);
+      }
+    }
+  }
+  auto blobsPrefetched = newBlobs.empty()
+      ? makeFuture()
+      : ctx->prefetchBlobs(std::move(newBlobs))
+            .thenError([](const folly::exception_wrapper& ew) {
+              // The files are fetched when they are next read instead.
+              XLOG(DBG3) << "checkout blob prefetch failed: " << ew.what();
+            });
+
   // Now start all of the checkout actions
   vector<Future<InvalidationRequired>> actionFutures;
   for (const auto& action : actions) {
-    actionFutures.emplace_back(action->run(ctx, getStore()));
+    actionFutures.emplace_back(action->run(ctx));
   }
   // Wait for all of the actions, and record any errors.
   return folly::collectAll(actionFutures)
@@ -2480,7 +3013,8 @@ Future<Unit> TreeInode::checkout(
            self = inodePtrFromThis(),
            toTree = std::move(toTree),
            actions = std::move(actions),
-           wasDirectoryListModified](
+           wasDirectoryListModified,
+           blobsPrefetched = std::move(blobsPrefetched)](
               vector<folly::Try<InvalidationRequired>> actionResults) mutable {
             // Record any errors that occurred
             size_t numErrors = 0;
@@ -2504,9 +3038,14 @@ Future<Unit> TreeInode::checkout(
 
             // Update our state in the overlay
             self->saveOverlayPostCheckout(ctx, toTree.get());
+            ctx->treeProcessed();
 
             XLOG(DBG4) << "checkout: finished update of " << self->getLogPath()
                        << ": " << numErrors << " errors";
+
+            // The prefetch uses the checkout's fetch context, so the checkout
+            // must not finish before it does.
+            return std::move(blobsPrefetched);
           });
 }
 
@@ -2725,7 +3264,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
       // after this inode processes all of its checkout actions. But we
       // do want to invalidate the kernel's dcache and inode caches.
       wasDirectoryListModified = true;
-      invalidateChannelEntryCache(name);
+      checkoutInvalidateEntry(ctx, name, newScmEntry);
     }
 
     // Nothing else to do when there is no local inode.
@@ -2822,6 +3361,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
   }
 
   wasDirectoryListModified = true;
+  ctx->fileUpdated();
 
 #ifndef _WIN32
   // Contents have changed and the entry is not materialized, but we may have
@@ -2843,7 +3383,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
   // materialized if necessary.
 
   // We removed or replaced an entry - invalidate it.
-  invalidateChannelEntryCache(name);
+  checkoutInvalidateEntry(ctx, name, newScmEntry);
 
   return nullptr;
 }
@@ -2899,7 +3439,9 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
     }
 
     // Tell the OS to invalidate its cache for this entry.
-    invalidateChannelEntryCache(name);
+    checkoutInvalidateEntry(
+        ctx, name, newScmEntry ? &newScmEntry.value() : nullptr);
+    ctx->fileUpdated();
 
     // We don't save our own overlay data right now:
     // we'll wait to do that until the checkout operation finishes touching all
@@ -2984,6 +3526,8 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
                       name,
                       "new file created with this name while checkout operation "
                       "was in progress"));
+            } else {
+              ctx->fileUpdated();
             }
 
             // Return false because the code above has already invalidated
@@ -2999,6 +3543,7 @@ void TreeInode::invalidateChannelEntryCache(PathComponentPiece name) {
     fuseChannel->invalidateEntry(getNodeId(), name);
   }
 #else
+  contentsGeneration_.fetch_add(1, std::memory_order_acq_rel);
   if (auto* fsChannel = getMount()->getFsChannel()) {
     const auto path = getPath();
     if (path.has_value()) {
@@ -3008,6 +3553,23 @@ void TreeInode::invalidateChannelEntryCache(PathComponentPiece name) {
 #endif
 }
 
+void TreeInode::checkoutInvalidateEntry(
+    CheckoutContext* ctx,
+    PathComponentPiece name,
+    const TreeEntry* newScmEntry) {
+#ifndef _WIN32
+  (void)ctx;
+  (void)newScmEntry;
+  invalidateChannelEntryCache(name);
+#else
+  contentsGeneration_.fetch_add(1, std::memory_order_acq_rel);
+  const auto path = getPath();
+  if (path.has_value()) {
+    ctx->queueCachedFileUpdate(path.value() + name, newScmEntry);
+  }
+#endif
+}
+
 #ifndef _WIN32
 void TreeInode::invalidateFuseInodeCache() {
   if (auto* fuseChannel = getMount()->getFuseChannel()) {
@@ -3054,7 +3616,7 @@ void TreeInode::saveOverlayPostCheckout(
         return std::nullopt;
       }
 
-      // This code relies on the fact that our contents->entries PathMap sorts
+      // This code relies on the fact that our contents->entries map sorts
       // paths in the same order as Tree's entry list.
       auto inodeIter = contents->entries.begin();
       auto scmIter = scmEntries.begin();
@@ -3382,18 +3944,185 @@ size_t TreeInode::unloadChildrenLastAccessedBefore(const timespec& cutoff) {
         return toUnload.count(child->getNodeId()) != 0;
       });
 }
+
+size_t TreeInode::unloadUnreferencedChildren(
+    const std::unordered_set<InodeNumber>& candidates) {
+  std::vector<TreeInodePtr> noChildren;
+  return unloadChildrenIf(
+      this,
+      getInodeMap(),
+      noChildren,
+      [](TreeInode&) -> size_t { return 0; },
+      [&](InodeBase* child) {
+        return candidates.count(child->getNodeId()) != 0;
+      });
+}
+
+void TreeInode::unloadChildrenChangedByCheckout(
+    CheckoutContext* ctx,
+    const Tree* fromTree,
+    const Tree* toTree) {
+  auto isChangedByCheckout = [&](PathComponentPiece name) {
+    auto* fromEntry = fromTree ? fromTree->getEntryPtr(name) : nullptr;
+    auto* toEntry = toTree ? toTree->getEntryPtr(name) : nullptr;
+    if (!fromEntry && !toEntry) {
+      // Untracked entries are not touched by the checkout.
+      return false;
+    }
+    if (ctx->forceUpdate() || !fromEntry || !toEntry) {
+      return true;
+    }
+    return fromEntry->getType() != toEntry->getType() ||
+        fromEntry->getHash() != toEntry->getHash();
+  };
+
+  std::vector<TreeInodePtr> treeChildren;
+  std::unordered_set<InodeNumber> toUnload;
+  {
+    auto contents = contents_.rlock();
+    for (auto& entry : contents->entries) {
+      if (!entry.second.getInode() || entry.second.isMaterialized() ||
+          !isChangedByCheckout(entry.first)) {
+        continue;
+      }
+      toUnload.insert(entry.second.getInodeNumber());
+      if (auto asTree = entry.second.asTreePtrOrNull()) {
+        treeChildren.emplace_back(std::move(asTree));
+      }
+    }
+  }
+  if (toUnload.empty()) {
+    return;
+  }
+
+  auto unloadCount = unloadChildrenIf(
+      this,
+      getInodeMap(),
+      treeChildren,
+      [](TreeInode& child) { return child.unloadChildrenUnreferencedByFuse(); },
+      [&](InodeBase* child) {
+        return child->getFuseRefcount() == 0 &&
+            toUnload.count(child->getNodeId()) != 0;
+      });
+  XLOG(DBG5) << "checkout: unloaded " << unloadCount << " inodes under "
+             << getLogPath();
+}
 #endif
 
 void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
+  getDebugStatus(results, DebugStatusOptions{});
+}
+
+namespace {
+/**
+ * If dir is path or one of its parents, returns the part of path below it.
+ */
+std::optional<folly::StringPiece> pathBelow(
+    RelativePathPiece dir,
+    RelativePathPiece path) {
+  if (dir.empty()) {
+    return path.stringPiece();
+  }
+  if (dir == path) {
+    return folly::StringPiece{};
+  }
+  if (dir.isParentDirOf(path)) {
+    return path.stringPiece().subpiece(dir.stringPiece().size() + 1);
+  }
+  return std::nullopt;
+}
+} // namespace
+
+std::optional<RelativePath> TreeInode::getDebugStatus(
+    vector<TreeInodeDebugInfo>& results,
+    const DebugStatusOptions& options) const {
+  struct Directory {
+    const TreeInode* inode;
+    // Keeps inode alive.  Unset for this inode, which the caller holds.
+    TreeInodePtr inodePtr;
+    RelativePath path;
+    size_t depth;
+    // Whether this directory is options.startAfter or one of its parents,
+    // and so has already been reported.
+    bool resuming;
+  };
+
+  auto rootPath = getPath().value_or(RelativePath{});
+  std::vector<Directory> stack;
+  stack.push_back(Directory{
+      this,
+      TreeInodePtr{},
+      rootPath,
+      0,
+      options.startAfter.has_value() &&
+          pathBelow(rootPath, *options.startAfter).has_value()});
+
+  vector<std::pair<PathComponent, TreeInodePtr>> subdirectories;
+  size_t reported = 0;
+  while (!stack.empty()) {
+    auto dir = std::move(stack.back());
+    stack.pop_back();
+
+    if (options.materializedOnly &&
+        !dir.inode->contents_.rlock()->isMaterialized()) {
+      continue;
+    }
+
+    bool report = !dir.resuming;
+    if (report && options.maxResults != 0 && reported >= options.maxResults) {
+      return RelativePath{*results.back().path_ref()};
+    }
+
+    subdirectories.clear();
+    auto info = dir.inode->getDebugInfo(
+        report && options.fileSizes, subdirectories);
+    if (report) {
+      *info.path_ref() = dir.path.stringPiece().str();
+      results.push_back(std::move(info));
+      ++reported;
+    }
+
+    if (options.maxDepth.has_value() && dir.depth >= *options.maxDepth) {
+      continue;
+    }
+
+    // When resuming below this directory, skip the subdirectories in front
+    // of the one leading to startAfter.  The rest have not been reported,
+    // unless the tree changed between the calls.
+    std::optional<folly::StringPiece> resumeName;
+    if (dir.resuming) {
+      auto below = pathBelow(dir.path, *options.startAfter);
+      if (below.has_value() && !below->empty()) {
+        resumeName = below->subpiece(0, below->find('/'));
+      }
+    }
+
+    // Push in reverse so that the first subdirectory is visited next.
+    for (auto it = subdirectories.rbegin(); it != subdirectories.rend();
+         ++it) {
+      auto name = it->first.stringPiece();
+      if (resumeName.has_value() && name < *resumeName) {
+        continue;
+      }
+      auto* inode = it->second.get();
+      stack.push_back(Directory{
+          inode,
+          std::move(it->second),
+          dir.path + it->first,
+          dir.depth + 1,
+          resumeName.has_value() && name == *resumeName});
+    }
+  }
+  return std::nullopt;
+}
+
+TreeInodeDebugInfo TreeInode::getDebugInfo(
+    bool fileSizes,
+    vector<std::pair<PathComponent, TreeInodePtr>>& subdirectories) const {
   TreeInodeDebugInfo info;
   *info.inodeNumber_ref() = getNodeId().get();
   *info.refcount_ref() = debugGetFuseRefcount();
 
-  auto myPath = getPath();
-  if (myPath.has_value()) {
-    *info.path_ref() = myPath.value().stringPiece().str();
-  }
-
   vector<std::pair<PathComponent, InodePtr>> childInodes;
   {
     auto contents = contents_.rlock();
@@ -3428,7 +4157,7 @@ void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
   }
 
   std::vector<folly::Future<std::pair<size_t, uint64_t>>> futures;
-  for (const auto& childData : childInodes) {
+  for (auto& childData : childInodes) {
     info.entries_ref()->emplace_back();
     auto& infoEntry = info.entries_ref()->back();
     *infoEntry.name_ref() = childData.first.stringPiece().str();
@@ -3437,8 +4166,8 @@ void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
 
     auto childTree = childData.second.asTreePtrOrNull();
     if (childTree) {
-      // The child will also store its own data when we recurse, but go ahead
-      // and grab the materialization and status info now.
+      // The caller will visit the child to get its own data, but go ahead and
+      // grab the materialization and status info now.
       {
         auto childContents = childTree->contents_.rlock();
         *infoEntry.materialized_ref() = !childContents->treeHash.has_value();
@@ -3446,6 +4175,8 @@ void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
         // TODO: We don't currently store mode data for TreeInodes.  We should.
         *infoEntry.mode_ref() = (S_IFDIR | 0755);
       }
+      subdirectories.emplace_back(
+          std::move(childData.first), std::move(childTree));
     } else {
       auto childFile = childData.second.asFilePtr();
 
@@ -3453,12 +4184,14 @@ void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
       auto blobHash = childFile->getBlobHash();
       *infoEntry.materialized_ref() = !blobHash.has_value();
       *infoEntry.hash_ref() = thriftHash(blobHash);
-      futures.push_back(
-          childFile->stat(ObjectFetchContext::getNullContext())
-              .thenValue([i = info.entries_ref()->size() - 1](auto st) {
-                auto fileSize = st.st_size;
-                return std::make_pair(i, fileSize);
-              }));
+      if (fileSizes) {
+        futures.push_back(
+            childFile->stat(ObjectFetchContext::getNullContext())
+                .thenValue([i = info.entries_ref()->size() - 1](auto st) {
+                  auto fileSize = st.st_size;
+                  return std::make_pair(i, fileSize);
+                }));
+      }
     }
   }
   auto fileSizeMappings = folly::collectAllUnsafe(futures).get();
@@ -3471,18 +4204,7 @@ void TreeInode::getDebugStatus(vector<TreeInodeDebugInfo>& results) const {
     // not get serialized correctly.
     infoEntry.fileSize_ref() = fileSize;
   }
-  results.push_back(info);
-
-  // Recurse into all children directories after we finish building our own
-  // results.  We do this separately from the loop above just to order the
-  // results nicely: parents appear before their children, and children
-  // are sorted alphabetically (since contents_.entries are sorted).
-  for (const auto& childData : childInodes) {
-    auto childTree = childData.second.asTreePtrOrNull();
-    if (childTree) {
-      childTree->getDebugStatus(results);
-    }
-  }
+  return info;
 }
 
 #ifndef _WIN32
@@ -3514,8 +4236,12 @@ void TreeInode::prefetch() {
   }
   XLOG(DBG4) << "starting prefetch for " << getLogPath();
 
+  // Queue behind the requests that processes are blocked on.
+  auto executor = folly::ExecutorWithPriority::create(
+      folly::getKeepAliveToken(getMount()->getThreadPool().get()),
+      prefetchLease->getContext().getExecutorPriority());
   folly::via(
-      getMount()->getThreadPool().get(),
+      std::move(executor),
       [lease = std::move(*prefetchLease)]() mutable {
         // prefetch() is called by readdir, under the assumption that a series
         // of stat calls on its entries will follow. (e.g. `ls -l` or `find
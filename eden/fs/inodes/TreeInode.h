@@ -9,7 +9,9 @@
 #include <folly/File.h>
 #include <folly/Portability.h>
 #include <folly/Synchronized.h>
+#include <atomic>
 #include <optional>
+#include <unordered_set>
 #include "eden/fs/fuse/Invalidation.h"
 #include "eden/fs/inodes/CheckoutAction.h"
 #include "eden/fs/inodes/DirEntry.h"
@@ -23,6 +25,7 @@ class CheckoutContext;
 class DiffContext;
 class DirList;
 class EdenMount;
+class GitIgnore;
 class GitIgnoreStack;
 class DiffCallback;
 class InodeMap;
@@ -117,6 +120,23 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   folly::Future<std::string> getxattr(folly::StringPiece name) override;
 
   Dispatcher::Attr getAttrLocked(const DirContents& contents);
+
+  /**
+   * Stat a child for a FUSE lookup without loading it, if it is a file that
+   * is neither loaded nor materialized.  Its attributes come from its
+   * directory entry, its inode metadata and its blob's size, and a FUSE
+   * reference to its inode number is recorded in the InodeMap, so the
+   * FileInode is only created once something operates on it.
+   *
+   * Returns the child's inode number with its attributes, or std::nullopt,
+   * without recording anything, for other children and for names that do not
+   * exist, which must be looked up with getOrLoadChild().  The reference is
+   * recorded even if the attributes cannot be computed.
+   */
+  std::optional<std::pair<InodeNumber, folly::Future<struct stat>>>
+  statUnloadedChildForLookup(
+      PathComponentPiece name,
+      ObjectFetchContext& context);
 #endif // !_WIN32
 
   /**
@@ -153,8 +173,14 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * materialized files is stored in the ProjectedFS and there is no efficient
    * way to get it, so in this function as an optimization we don't populate the
    * size of materialized files.
+   *
+   * The entries are sorted with Enumerator::sortEntries().  The list is
+   * shared by every enumeration of the same version of this directory, until
+   * its entries change.
    */
-  FOLLY_NODISCARD folly::Future<std::vector<FileMetadata>> readdir();
+  FOLLY_NODISCARD folly::Future<
+      std::shared_ptr<const std::vector<FileMetadata>>>
+  readdir();
 #endif
 
   const folly::Synchronized<TreeInodeState>& getContents() const {
@@ -178,6 +204,18 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
       PathComponentPiece name,
       InvalidationRequired invalidate);
 
+  /**
+   * Remove the directory name and everything beneath it, like `rm -rf`.
+   *
+   * A subtree with no modifications, and with no inodes loaded or remembered
+   * for any part of it, is dropped as a single change to this directory
+   * without loading anything, and is journaled as the removal of name alone.
+   * Anything else is removed entry by entry.
+   */
+  FOLLY_NODISCARD folly::Future<folly::Unit> removeRecursively(
+      PathComponentPiece name,
+      InvalidationRequired invalidate);
+
   /**
    * Create a filesystem node.
    * Only unix domain sockets and regular files are supported; attempting to
@@ -344,6 +382,19 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * Returns the number of inodes unloaded.
    */
   size_t unloadChildrenLastAccessedBefore(const timespec& cutoff);
+
+  /**
+   * Unload the children of this tree whose inode numbers are in candidates
+   * and that are unreferenced.  Unlike the methods above, this does not
+   * recurse: loaded tree children still hold references to this tree until
+   * their own children have been unloaded.
+   *
+   * InodeUnloadWalk uses this to unload a mount a few directories at a time.
+   *
+   * Returns the number of inodes unloaded.
+   */
+  size_t unloadUnreferencedChildren(
+      const std::unordered_set<InodeNumber>& candidates);
 #endif
 
   /*
@@ -389,6 +440,48 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    */
   void getDebugStatus(std::vector<TreeInodeDebugInfo>& results) const;
 
+  struct DebugStatusOptions {
+    /**
+     * Only report materialized directories.  Since the parents of a
+     * materialized inode are materialized too, the subdirectories of an
+     * unmaterialized directory are skipped without being visited.
+     */
+    bool materializedOnly{false};
+    /**
+     * How many levels of subdirectories below this one to visit, or
+     * std::nullopt to visit all of them.
+     */
+    std::optional<size_t> maxDepth;
+    /** Stop after reporting this many directories, or 0 for no limit. */
+    size_t maxResults{0};
+    /**
+     * Resume a previous traversal, skipping the directories up to and
+     * including this one.  It is relative to the mount's root.
+     */
+    std::optional<RelativePath> startAfter;
+    /**
+     * Report the size of each loaded file.  This may need to load the file's
+     * blob, so leaving it unset makes the traversal much cheaper.
+     */
+    bool fileSizes{true};
+  };
+
+  /**
+   * Get debug data about this TreeInode and the loaded subdirectories below
+   * it, as selected by options.
+   *
+   * Directories are reported parents first, and the children of each in
+   * name order.  Only one directory is locked at a time, and no lock is held
+   * while the results are built, so this does not hold up other filesystem
+   * operations for long even on a large mount.
+   *
+   * Returns the path of the last directory reported if the traversal was
+   * stopped by maxResults, to be passed as startAfter to resume it.
+   */
+  std::optional<RelativePath> getDebugStatus(
+      std::vector<TreeInodeDebugInfo>& results,
+      const DebugStatusOptions& options) const;
+
   /**
    * Returns a copy of this inode's metadata.
    */
@@ -400,6 +493,15 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   class TreeRenameLocks;
   class IncompleteInodeLoad;
 
+  /**
+   * Get debug data about this TreeInode alone, and append its loaded
+   * subdirectories to subdirectories in name order.
+   */
+  TreeInodeDebugInfo getDebugInfo(
+      bool fileSizes,
+      std::vector<std::pair<PathComponent, TreeInodePtr>>& subdirectories)
+      const;
+
 #ifndef _WIN32
   InodeMetadata getMetadataLocked(const DirContents&) const;
 #endif
@@ -445,11 +547,27 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   FOLLY_NODISCARD folly::Future<folly::Unit> doRename(
       TreeRenameLocks&& locks,
       PathComponentPiece srcName,
-      PathMap<DirEntry>::iterator srcIter,
+      DirContents::iterator srcIter,
       TreeInodePtr destParent,
       PathComponentPiece destName,
       InvalidationRequired invalidate);
 
+  /**
+   * Rename a file within this directory while holding the rename lock only in
+   * shared mode, so that atomic-rename writes in different directories do not
+   * serialize on each other.
+   *
+   * This only handles the common case: this directory is already
+   * materialized, and neither name refers to a directory or to an inode that
+   * is not loaded yet.  It returns std::nullopt without changing anything
+   * otherwise, and the caller must fall back to the path that takes the
+   * rename lock exclusively.
+   */
+  std::optional<folly::Future<folly::Unit>> tryRenameWithinDirectory(
+      PathComponentPiece srcName,
+      PathComponentPiece destName,
+      InvalidationRequired invalidate);
+
   Overlay* getOverlay() const;
 
   /**
@@ -479,6 +597,14 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * used to track the directory in the inode */
   static DirContents buildDirFromTree(const Tree* tree, Overlay* overlay);
 
+  /**
+   * Drops the entries of the Tree for the child directory with the given
+   * name that the checkout's filter hides.
+   */
+  std::shared_ptr<const Tree> filterTree(
+      std::shared_ptr<const Tree> tree,
+      PathComponentPiece childName) const;
+
 #ifndef _WIN32
   void updateAtime();
 #endif // !_WIN32
@@ -510,6 +636,17 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
       folly::ByteRange fileContents,
       InvalidationRequired invalidate);
 
+  /**
+   * The fast path of removeRecursively().
+   *
+   * @return Returns 0 if the subtree was removed, EBADF if it has to be
+   *     removed entry by entry instead, or another errno value if it cannot be
+   *     removed at all.
+   */
+  int tryRemoveUnloadedSubtree(
+      PathComponentPiece name,
+      InvalidationRequired invalidate);
+
   /**
    * removeImpl() is the actual implementation used for unlink() and rmdir().
    *
@@ -588,11 +725,44 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
       ObjectFetchContext& fetchContext);
 
   /**
-   * Load the .gitignore file for this directory, then call computeDiff() once
-   * it is loaded.
+   * Read and parse the given .gitignore file.
    */
-  FOLLY_NODISCARD folly::Future<folly::Unit> loadGitIgnoreThenDiff(
+  folly::Future<std::shared_ptr<const GitIgnore>> loadGitIgnore(
       InodePtr gitignoreInode,
+      DiffContext* context);
+
+  /**
+   * Read and parse an unmodified .gitignore file by its blob hash, sharing
+   * the result through the GitIgnoreCache.
+   */
+  folly::Future<std::shared_ptr<const GitIgnore>> loadGitIgnoreBlob(
+      const Hash& blobHash,
+      DiffContext* context);
+
+  /**
+   * Returns the blob hash of this directory's .gitignore file if it is
+   * unmodified and its inode is not loaded, unless this directory is
+   * unmodified from scmTreeHash and so will not need it.
+   */
+  std::optional<Hash> getUnloadedGitIgnoreHash(
+      const std::optional<Hash>& scmTreeHash);
+
+  /**
+   * Start reading the .gitignore files of the child directories that diff()
+   * is about to be called on, each paired with the tree it is compared to.
+   * The returned future completes when they have been read.
+   */
+  FOLLY_NODISCARD folly::Future<folly::Unit> prefetchChildGitIgnores(
+      DiffContext* context,
+      const std::vector<std::pair<TreeInodePtr, std::optional<Hash>>>&
+          childTrees);
+
+  /**
+   * Wait for the .gitignore file for this directory to be loaded, then call
+   * computeDiff().
+   */
+  FOLLY_NODISCARD folly::Future<folly::Unit> loadGitIgnoreThenDiff(
+      folly::Future<std::shared_ptr<const GitIgnore>> ignoreFuture,
       DiffContext* context,
       RelativePathPiece currentPath,
       std::shared_ptr<const Tree> tree,
@@ -635,6 +805,23 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
       const Hash& treeHash,
       const Tree* fromTree,
       const Tree* toTree);
+#ifndef _WIN32
+  /**
+   * Unload the children that this checkout is going to change, as long as
+   * neither they nor anything inside them is referenced by FUSE or
+   * internally by Eden.
+   *
+   * The checkout can then update the entries of these children by replacing
+   * their hashes, without loading their source control trees or recursing
+   * into them, deferring that work until they are next accessed.
+   * Materialized children are left loaded, since the checkout has to load
+   * them again to look for conflicts.
+   */
+  void unloadChildrenChangedByCheckout(
+      CheckoutContext* ctx,
+      const Tree* fromTree,
+      const Tree* toTree);
+#endif // !_WIN32
   void computeCheckoutActions(
       CheckoutContext* ctx,
       const Tree* fromTree,
@@ -684,6 +871,17 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    */
   void invalidateChannelEntryCache(PathComponentPiece name);
 
+  /**
+   * invalidateChannelEntryCache() for an entry changed by a checkout.
+   * newScmEntry is its new source control state, or nullptr if it was
+   * removed.  On Windows, the update is queued on the CheckoutContext, which
+   * applies every queued update when the checkout finishes.
+   */
+  void checkoutInvalidateEntry(
+      CheckoutContext* ctx,
+      PathComponentPiece name,
+      const TreeEntry* newScmEntry);
+
   /**
    * Attempt to remove an empty directory during a checkout operation.
    *
@@ -699,6 +897,43 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * Only prefetch blob metadata on the first readdir() of a loaded inode.
    */
   std::atomic<bool> prefetched_{false};
+
+#ifndef _WIN32
+  using ReaddirIndex = std::vector<std::pair<InodeNumber, PathComponent>>;
+
+  /**
+   * The children of this directory sorted by inode number, as of the start
+   * of a readdir() stream.  This lets readdir() resume from an offset without
+   * walking the whole directory.  It is dropped when a stream reaches the end
+   * of the directory.
+   *
+   * Never acquire contents_ while holding this lock.
+   */
+  folly::Synchronized<std::shared_ptr<const ReaddirIndex>> readdirIndex_;
+#else
+  /**
+   * The last list returned by readdir(), and the version of the contents it
+   * was built from.
+   */
+  struct EnumerationSnapshot {
+    std::optional<Hash> treeHash;
+    uint64_t generation;
+    std::shared_ptr<const std::vector<FileMetadata>> entries;
+  };
+
+  /**
+   * Incremented whenever the entries may have changed: when they are saved to
+   * the overlay, and when a child's entry is invalidated.  Together with the
+   * tree hash, this identifies the version of the contents an
+   * EnumerationSnapshot describes.
+   */
+  mutable std::atomic<uint64_t> contentsGeneration_{0};
+
+  /**
+   * Never acquire contents_ while holding this lock.
+   */
+  folly::Synchronized<std::optional<EnumerationSnapshot>> enumerationSnapshot_;
+#endif
 };
 
 /**
@@ -11,7 +11,9 @@
 #include <algorithm>
 #include <chrono>
 
+#include <folly/Conv.h>
 #include <folly/Exception.h>
+#include <folly/ExceptionString.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
 #include <folly/Range.h>
@@ -51,6 +53,8 @@ constexpr const char* kNextInodeNumberFile{"next-inode-number"};
 constexpr StringPiece kInfoHeaderMagic{"\xed\xe0\x00\x01"};
 
 constexpr folly::StringPiece FsOverlay::kMetadataFile;
+constexpr folly::StringPiece FsOverlay::kPartialFileDir;
+constexpr folly::StringPiece FsOverlay::kPartialFileRecordIdentifier;
 
 /**
  * A version number for the overlay directory format.
@@ -645,6 +649,113 @@ bool FsOverlay::hasOverlayData(InodeNumber inodeNumber) {
   }
 }
 
+std::string FsOverlay::getPartialFilePath(InodeNumber inodeNumber) {
+  return folly::to<string>(kPartialFileDir, "/", inodeNumber.get());
+}
+
+void FsOverlay::createPartialFileRecord(
+    InodeNumber inodeNumber,
+    ByteRange hash) {
+  auto result = ::mkdirat(dirFile_.fd(), kPartialFileDir.data(), 0755);
+  if (result != 0 && errno != EEXIST) {
+    folly::throwSystemError(
+        "error creating overlay partial file directory in ", localDir_);
+  }
+
+  // The record is a header holding the blob hash, followed by the written
+  // ranges appended by appendPartialFileRange().
+  IOBuf record{IOBuf::CREATE, kHeaderLength + hash.size()};
+  folly::io::Appender appender(&record, 0);
+  appender.push(kPartialFileRecordIdentifier);
+  appender.writeBE(kHeaderVersion);
+  appender.writeBE<uint32_t>(hash.size());
+  appender.push(hash);
+
+  auto path = localDir_.value() + "/" + getPartialFilePath(inodeNumber);
+  folly::writeFileAtomic(path, ByteRange{record.data(), record.length()});
+}
+
+void FsOverlay::appendPartialFileRange(
+    InodeNumber inodeNumber,
+    uint64_t begin,
+    uint64_t end) {
+  auto path = getPartialFilePath(inodeNumber);
+  int fd = openat(
+      dirFile_.fd(),
+      path.c_str(),
+      O_WRONLY | O_APPEND | O_CLOEXEC | O_NOFOLLOW);
+  folly::checkUnixError(
+      fd, "error opening partial file record for inode ", inodeNumber);
+  File file{fd, /* ownsFd */ true};
+
+  std::array<uint64_t, 2> range{folly::Endian::big(begin),
+                                folly::Endian::big(end)};
+  auto written = folly::writeFull(fd, range.data(), sizeof(range));
+  folly::checkUnixError(
+      written, "error writing partial file record for inode ", inodeNumber);
+}
+
+void FsOverlay::removePartialFileRecord(InodeNumber inodeNumber) {
+  auto path = getPartialFilePath(inodeNumber);
+  if (::unlinkat(dirFile_.fd(), path.c_str(), 0) != 0 && errno != ENOENT) {
+    folly::throwSystemError(
+        "error removing partial file record for inode ", inodeNumber);
+  }
+}
+
+std::unordered_map<InodeNumber, FsOverlay::PartialFileRecord>
+FsOverlay::loadPartialFileRecords() {
+  std::unordered_map<InodeNumber, PartialFileRecord> records;
+
+  boost::system::error_code error;
+  auto dirPath = localDir_ + PathComponentPiece{kPartialFileDir};
+  auto iterator = boost::filesystem::directory_iterator(
+      boost::filesystem::path{dirPath.value().c_str()}, error);
+  if (error.value() != 0) {
+    // Overlays that never had a partially materialized file have no
+    // directory for them.
+    return records;
+  }
+
+  for (; iterator != boost::filesystem::directory_iterator();
+       iterator.increment(error)) {
+    auto name = iterator->path().filename().string();
+    auto inodeNumber = folly::tryTo<uint64_t>(name);
+    std::string contents;
+    if (!inodeNumber.hasValue() || *inodeNumber == 0 ||
+        !folly::readFile(iterator->path().c_str(), contents)) {
+      XLOG(WARN) << "ignoring unexpected file " << name << " in " << dirPath;
+      continue;
+    }
+
+    try {
+      IOBuf buf(IOBuf::WRAP_BUFFER, ByteRange{StringPiece{contents}});
+      folly::io::Cursor cursor(&buf);
+      auto id = cursor.readFixedString(kPartialFileRecordIdentifier.size());
+      auto version = cursor.readBE<uint32_t>();
+      if (StringPiece{id} != kPartialFileRecordIdentifier ||
+          version != kHeaderVersion) {
+        throw std::runtime_error("unexpected header");
+      }
+      PartialFileRecord record;
+      record.blobHash = cursor.readFixedString(cursor.readBE<uint32_t>());
+      // A range that was being appended when we crashed may be incomplete.
+      // Its data was written before the range was recorded, so dropping it
+      // only loses that last write.
+      while (cursor.canAdvance(2 * sizeof(uint64_t))) {
+        auto begin = cursor.readBE<uint64_t>();
+        auto end = cursor.readBE<uint64_t>();
+        record.writtenRanges.emplace_back(begin, end);
+      }
+      records.emplace(InodeNumber{*inodeNumber}, std::move(record));
+    } catch (const std::exception& ex) {
+      XLOG(WARN) << "ignoring corrupt partial file record " << name << " in "
+                 << dirPath << ": " << folly::exceptionStr(ex);
+    }
+  }
+  return records;
+}
+
 InodePath::InodePath() noexcept : path_{'\0'} {}
 
 const char* InodePath::c_str() const noexcept {
@@ -13,6 +13,8 @@
 #include <array>
 #include <condition_variable>
 #include <optional>
+#include <unordered_map>
+#include <vector>
 #include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
 #include "eden/fs/utils/DirType.h"
@@ -180,7 +182,50 @@ class FsOverlay {
 
   bool hasOverlayData(InodeNumber inodeNumber);
 
+  /**
+   * The durable description of a partially materialized file: a file whose
+   * overlay file only holds the ranges written to it, with the rest of its
+   * contents coming from a source control blob.
+   */
+  struct PartialFileRecord {
+    /** The binary hash of the blob providing the unwritten contents. */
+    std::string blobHash;
+    /**
+     * The [begin, end) ranges of the overlay file that hold written data, in
+     * the order they were recorded.  They may overlap.
+     */
+    std::vector<std::pair<uint64_t, uint64_t>> writtenRanges;
+  };
+
+  /**
+   * Record that the overlay file for the given inode is partially
+   * materialized from the given blob, with nothing written yet.  Replaces any
+   * existing record for the inode.
+   */
+  void createPartialFileRecord(InodeNumber inodeNumber, folly::ByteRange hash);
+
+  /**
+   * Add a written range to the record created by createPartialFileRecord().
+   * The data must already have been written to the overlay file, so that the
+   * record never claims data that is not there.
+   */
+  void
+  appendPartialFileRange(InodeNumber inodeNumber, uint64_t begin, uint64_t end);
+
+  /**
+   * Remove the partial file record for the given inode, if there is one.
+   */
+  void removePartialFileRecord(InodeNumber inodeNumber);
+
+  /**
+   * Load all of the partial file records.  Records that cannot be parsed are
+   * logged and skipped.
+   */
+  std::unordered_map<InodeNumber, PartialFileRecord> loadPartialFileRecords();
+
   static constexpr folly::StringPiece kMetadataFile{"metadata.table"};
+  static constexpr folly::StringPiece kPartialFileDir{"partial"};
+  static constexpr folly::StringPiece kPartialFileRecordIdentifier{"OVPF"};
 
   /**
    * Constants for an header in overlay file.
@@ -216,6 +261,12 @@ class FsOverlay {
    */
   static InodePath getFilePath(InodeNumber inodeNumber);
 
+  /**
+   * Get the path to the partial file record for the given inode, relative to
+   * localDir.
+   */
+  static std::string getPartialFilePath(InodeNumber inodeNumber);
+
   std::optional<overlay::OverlayDir> deserializeOverlayDir(
       InodeNumber inodeNumber);
 
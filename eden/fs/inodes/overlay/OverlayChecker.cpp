@@ -11,12 +11,18 @@
 #include <fcntl.h>
 #include <time.h>
 #include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 #include <folly/Conv.h>
 #include <folly/ExceptionWrapper.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
+#include <folly/Range.h>
 #include <folly/String.h>
+#include <folly/Synchronized.h>
 #include <folly/logging/xlog.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
@@ -36,6 +42,47 @@ using std::chrono::seconds;
 namespace facebook {
 namespace eden {
 
+namespace {
+/**
+ * Call fn(task) for every task in [0, numTasks), using up to numThreads
+ * threads including the calling thread.  Tasks are started in increasing
+ * order.  If a call throws, no new tasks are started and the exception is
+ * rethrown once all of the threads have finished.
+ */
+template <typename Fn>
+void runInParallel(size_t numThreads, size_t numTasks, Fn&& fn) {
+  numThreads = std::max<size_t>(std::min(numThreads, numTasks), 1);
+  std::atomic<size_t> nextTask{0};
+  std::vector<std::exception_ptr> errors(numThreads);
+  auto worker = [&](size_t threadIndex) {
+    try {
+      for (auto task = nextTask.fetch_add(1); task < numTasks;
+           task = nextTask.fetch_add(1)) {
+        fn(task);
+      }
+    } catch (...) {
+      errors[threadIndex] = std::current_exception();
+      nextTask.store(numTasks);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads - 1);
+  for (size_t threadIndex = 1; threadIndex < numThreads; ++threadIndex) {
+    threads.emplace_back(worker, threadIndex);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+} // namespace
+
 class OverlayChecker::RepairState {
  public:
   explicit RepairState(OverlayChecker* checker)
@@ -652,8 +699,11 @@ class OverlayChecker::BadNextInodeNumber : public OverlayChecker::Error {
 
 OverlayChecker::OverlayChecker(
     FsOverlay* fs,
-    optional<InodeNumber> nextInodeNumber)
-    : fs_(fs), loadedNextInodeNumber_(nextInodeNumber) {}
+    optional<InodeNumber> nextInodeNumber,
+    size_t numThreads)
+    : fs_(fs),
+      loadedNextInodeNumber_(nextInodeNumber),
+      numThreads_(std::max<size_t>(numThreads, 1)) {}
 
 OverlayChecker::~OverlayChecker() {}
 
@@ -851,44 +901,64 @@ PathComponent OverlayChecker::findChildName(
 }
 
 void OverlayChecker::readInodes(const ProgressCallback& progressCallback) {
-  // Walk through all of the sharded subdirectories
-  uint32_t progress10pct = 0;
-  std::array<char, 2> subdirBuffer;
-  MutableStringPiece subdir{subdirBuffer.data(), subdirBuffer.size()};
-  for (uint32_t shardID = 0; shardID < FsOverlay::kNumShards; ++shardID) {
-    // Log a INFO message every 10% done
-    uint32_t progress = (10 * shardID) / FsOverlay::kNumShards;
-    if (progress > progress10pct) {
-      XLOG(INFO) << "fsck:" << fs_->getLocalDir() << ": scan " << progress
-                 << "0% complete: " << inodes_.size() << " inodes scanned";
-      if (auto callback = progressCallback) {
-        callback(progress);
-      }
-      progress10pct = progress;
-    }
-    if (auto callback = progressCallback) {
-      callback(10);
-    }
+  // Walk through all of the sharded subdirectories in parallel.  Each shard is
+  // scanned into its own ScanResult, which is merged as soon as all earlier
+  // shards have been merged, by whichever thread finished it.  This keeps the
+  // results in the same order as a serial scan, and avoids holding the data
+  // for every shard in memory at once.
+  struct MergeState {
+    std::vector<std::optional<ScanResult>> pending{FsOverlay::kNumShards};
+    uint32_t nextShard{0};
+    uint32_t progress10pct{0};
+  };
+  folly::Synchronized<MergeState, std::mutex> mergeState;
+
+  runInParallel(numThreads_, FsOverlay::kNumShards, [&](size_t shardID) {
+    std::array<char, 2> subdirBuffer;
+    MutableStringPiece subdir{subdirBuffer.data(), subdirBuffer.size()};
     FsOverlay::formatSubdirShardPath(shardID, subdir);
     auto subdirPath = fs_->getLocalDir() + PathComponentPiece{subdir};
-
-    readInodeSubdir(subdirPath, shardID);
-  }
+    auto result = readInodeSubdir(subdirPath, shardID);
+
+    auto state = mergeState.lock();
+    state->pending[shardID] = std::move(result);
+    while (state->nextShard < FsOverlay::kNumShards &&
+           state->pending[state->nextShard].has_value()) {
+      mergeScanResult(std::move(*state->pending[state->nextShard]));
+      state->pending[state->nextShard].reset();
+      ++state->nextShard;
+
+      // Log a INFO message every 10% done
+      uint32_t progress = (10 * state->nextShard) / FsOverlay::kNumShards;
+      if (progress > state->progress10pct) {
+        if (progress < 10) {
+          XLOG(INFO) << "fsck:" << fs_->getLocalDir() << ": scan " << progress
+                     << "0% complete: " << inodes_.size()
+                     << " inodes scanned";
+        }
+        if (auto callback = progressCallback) {
+          callback(progress);
+        }
+        state->progress10pct = progress;
+      }
+    }
+  });
   XLOG(INFO) << "fsck:" << fs_->getLocalDir() << ": scanned " << inodes_.size()
              << " inodes";
 }
 
-void OverlayChecker::readInodeSubdir(
+OverlayChecker::ScanResult OverlayChecker::readInodeSubdir(
     const AbsolutePath& path,
     ShardID shardID) {
   XLOG(DBG5) << "fsck:" << fs_->getLocalDir() << ": scanning " << path;
 
+  ScanResult result;
   boost::system::error_code error;
   auto boostPath = boost::filesystem::path{path.value().c_str()};
   auto iterator = boost::filesystem::directory_iterator(boostPath, error);
   if (error.value() != 0) {
-    addError<ShardDirectoryEnumerationError>(path, error);
-    return;
+    result.addError<ShardDirectoryEnumerationError>(path, error);
+    return result;
   }
 
   auto endIterator = boost::filesystem::directory_iterator();
@@ -898,37 +968,43 @@ void OverlayChecker::readInodeSubdir(
     auto entryInodeNumber =
         folly::tryTo<uint64_t>(inodePath.basename().value());
     if (entryInodeNumber.hasValue()) {
-      loadInode(InodeNumber(*entryInodeNumber), shardID);
+      loadInode(InodeNumber(*entryInodeNumber), shardID, result);
     } else {
-      addError<UnexpectedOverlayFile>(inodePath);
+      result.addError<UnexpectedOverlayFile>(inodePath);
     }
 
     iterator.increment(error);
     if (error.value() != 0) {
-      addError<ShardDirectoryEnumerationError>(path, error);
+      result.addError<ShardDirectoryEnumerationError>(path, error);
       break;
     }
   }
+  return result;
 }
 
-void OverlayChecker::loadInode(InodeNumber number, ShardID shardID) {
+void OverlayChecker::loadInode(
+    InodeNumber number,
+    ShardID shardID,
+    ScanResult& result) {
   XLOG(DBG9) << "fsck: loading inode " << number;
-  updateMaxInodeNumber(number);
+  result.updateMaxInodeNumber(number);
 
   // Verify that we found this inode in the correct shard subdirectory.
   // Ignore the data if it is in the wrong directory.
   ShardID expectedShard = static_cast<ShardID>(number.get() & 0xff);
   if (expectedShard != shardID) {
-    addError<UnexpectedInodeShard>(number, shardID);
+    result.addError<UnexpectedInodeShard>(number, shardID);
     return;
   }
 
-  inodes_.emplace(number, loadInodeInfo(number));
+  result.inodes.push_back(loadInodeInfo(number, result));
 }
 
-OverlayChecker::InodeInfo OverlayChecker::loadInodeInfo(InodeNumber number) {
-  auto inodeError = [this, number](auto&&... args) {
-    addError<InodeDataError>(number, args...);
+OverlayChecker::InodeInfo OverlayChecker::loadInodeInfo(
+    InodeNumber number,
+    ScanResult& result) {
+  auto inodeError = [&result, number](auto&&... args) {
+    result.addError<InodeDataError>(number, args...);
     return InodeInfo(number, InodeType::Error);
   };
 
@@ -1006,52 +1082,113 @@ overlay::OverlayDir OverlayChecker::loadDirectoryChildren(folly::File& file) {
   return CompactSerializer::deserialize<overlay::OverlayDir>(serializedData);
 }
 
-void OverlayChecker::linkInodeChildren() {
-  for (const auto& [parentInodeNumber, parent] : inodes_) {
-    for (const auto& [childName, child] : *parent.children.entries_ref()) {
-      auto childRawInode = *child.inodeNumber_ref();
-      if (childRawInode == 0) {
-        // Older versions of edenfs would leave the inode number set to 0
-        // if the child inode has never been loaded.  The child can't be
-        // present in the overlay if it doesn't have an inode number
-        // allocated for it yet.
-        //
-        // Newer versions of edenfs always allocate an inode number for all
-        // children, even if they haven't been loaded yet.
-        continue;
-      }
+void OverlayChecker::mergeScanResult(ScanResult&& result) {
+  for (auto& info : result.inodes) {
+    auto number = info.number;
+    inodes_.emplace(number, std::move(info));
+  }
+  for (auto& error : result.errors) {
+    addError(std::move(error));
+  }
+  maxInodeNumber_ = std::max(maxInodeNumber_, result.maxInodeNumber);
+}
 
-      auto childInodeNumber = InodeNumber(childRawInode);
-      updateMaxInodeNumber(childInodeNumber);
-      auto childInfo = getInodeInfo(childInodeNumber);
-      if (!childInfo) {
-        const auto& hash = child.hash_ref();
-        if (!hash.has_value() || hash->empty()) {
-          // This child is materialized (since it doesn't have a hash
-          // linking it to a source control object).  It's a problem if the
-          // materialized data isn't actually present in the overlay.
-          addError<MissingMaterializedInode>(
-              parentInodeNumber, childName, child);
+template <typename Result, typename Fn>
+std::vector<Result> OverlayChecker::analyzeInodesInParallel(Fn&& fn) {
+  std::vector<InodeInfo*> inodes;
+  inodes.reserve(inodes_.size());
+  for (auto& entry : inodes_) {
+    inodes.push_back(&entry.second);
+  }
+
+  // Use several runs per thread so that threads that finish early can pick up
+  // some of the remaining work.
+  auto numRuns = std::min(inodes.size(), numThreads_ * 4);
+  std::vector<Result> results(numRuns);
+  runInParallel(numThreads_, numRuns, [&](size_t run) {
+    auto begin = inodes.data() + (inodes.size() * run) / numRuns;
+    auto end = inodes.data() + (inodes.size() * (run + 1)) / numRuns;
+    fn(folly::Range<InodeInfo* const*>{begin, end}, results[run]);
+  });
+  return results;
+}
+
+void OverlayChecker::linkInodeChildren() {
+  // Looking up the children only reads inodes_, so it can be done in
+  // parallel.  The parents are then recorded on this thread, in the same
+  // order as a serial walk over inodes_.
+  struct LinkResult {
+    ScanResult scan;
+    std::vector<std::tuple<InodeInfo*, InodeNumber, mode_t>> links;
+    std::vector<InodeNumber> unmaterialized;
+  };
+  auto results = analyzeInodesInParallel<LinkResult>(
+      [this](folly::Range<InodeInfo* const*> inodes, LinkResult& result) {
+        for (const auto* parent : inodes) {
+          for (const auto& [childName, child] :
+               *parent->children.entries_ref()) {
+            auto childRawInode = *child.inodeNumber_ref();
+            if (childRawInode == 0) {
+              // Older versions of edenfs would leave the inode number set to
+              // 0 if the child inode has never been loaded.  The child can't
+              // be present in the overlay if it doesn't have an inode number
+              // allocated for it yet.
+              //
+              // Newer versions of edenfs always allocate an inode number for
+              // all children, even if they haven't been loaded yet.
+              continue;
+            }
+
+            auto childInodeNumber = InodeNumber(childRawInode);
+            result.scan.updateMaxInodeNumber(childInodeNumber);
+            auto childInfo = getInodeInfo(childInodeNumber);
+            if (!childInfo) {
+              result.unmaterialized.push_back(childInodeNumber);
+              const auto& hash = child.hash_ref();
+              if (!hash.has_value() || hash->empty()) {
+                // This child is materialized (since it doesn't have a hash
+                // linking it to a source control object).  It's a problem if
+                // the materialized data isn't actually present in the
+                // overlay.
+                result.scan.addError<MissingMaterializedInode>(
+                    parent->number, childName, child);
+              }
+            } else {
+              result.links.emplace_back(
+                  childInfo, parent->number, *child.mode_ref());
+
+              // TODO: It would be nice to also check for mismatch between
+              // childInfo->type and child.mode
+            }
+          }
         }
-      } else {
-        childInfo->addParent(parentInodeNumber, *child.mode_ref());
+      });
 
-        // TODO: It would be nice to also check for mismatch between
-        // childInfo->type and child.mode
-      }
+  for (auto& result : results) {
+    for (const auto& [childInfo, parentInodeNumber, mode] : result.links) {
+      childInfo->addParent(parentInodeNumber, mode);
     }
+    unmaterializedChildren_.insert(
+        result.unmaterialized.begin(), result.unmaterialized.end());
+    mergeScanResult(std::move(result.scan));
   }
 }
 
 void OverlayChecker::scanForParentErrors() {
-  for (const auto& [inodeNumber, inodeInfo] : inodes_) {
-    if (inodeInfo.parents.empty()) {
-      if (inodeNumber != kRootNodeId) {
-        addError<OrphanInode>(inodeInfo);
-      }
-    } else if (inodeInfo.parents.size() != 1) {
-      addError<HardLinkedInode>(inodeInfo);
-    }
+  auto results = analyzeInodesInParallel<ScanResult>(
+      [](folly::Range<InodeInfo* const*> inodes, ScanResult& result) {
+        for (const auto* inodeInfo : inodes) {
+          if (inodeInfo->parents.empty()) {
+            if (inodeInfo->number != kRootNodeId) {
+              result.addError<OrphanInode>(*inodeInfo);
+            }
+          } else if (inodeInfo->parents.size() != 1) {
+            result.addError<HardLinkedInode>(*inodeInfo);
+          }
+        }
+      });
+  for (auto& result : results) {
+    mergeScanResult(std::move(result));
   }
 }
 
@@ -9,6 +9,9 @@
 
 #include <memory>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <folly/CppAttributes.h>
 #include <folly/small_vector.h>
@@ -56,11 +59,30 @@ class OverlayChecker {
    * The OverlayChecker stores a raw pointer to the FsOverlay for the duration
    * of the check operation.  The caller is responsible for ensuring that the
    * FsOverlay object exists for at least as long as the OverlayChecker object.
+   *
+   * The overlay is scanned and analyzed using up to numThreads threads,
+   * including the thread calling scanForErrors().
    */
-  OverlayChecker(FsOverlay* fs, std::optional<InodeNumber> nextInodeNumber);
+  OverlayChecker(
+      FsOverlay* fs,
+      std::optional<InodeNumber> nextInodeNumber,
+      size_t numThreads = kDefaultNumThreads);
 
   ~OverlayChecker();
 
+  /**
+   * The default number of threads used by scanForErrors().  The scan is
+   * mostly bound by reading the overlay files, so this does not need to match
+   * the number of CPUs.
+   */
+  static constexpr size_t kDefaultNumThreads = 8;
+
+  /**
+   * Receives the scan progress in tenths, from 0 to 10.
+   *
+   * The callback may be invoked from any of the threads scanning the overlay,
+   * but never from more than one at a time.
+   */
   using ProgressCallback = std::function<void(uint16_t)>;
 
   /**
@@ -101,6 +123,17 @@ class OverlayChecker {
     return InodeNumber(maxInodeNumber_ + 1);
   }
 
+  /**
+   * Returns whether the overlay holds data for the given inode, or a
+   * directory in the overlay names it as a child.  Other inodes can only be
+   * in use if they were allocated after the scan.
+   *
+   * scanForErrors() must have been called first to scan the inode data.
+   */
+  bool isInodeReferenced(InodeNumber number) const {
+    return inodes_.count(number) || unmaterializedChildren_.count(number);
+  }
+
   /**
    * A structure to represent best-effort computed paths for inodes.
    *
@@ -186,12 +219,45 @@ class OverlayChecker {
   template <typename Fn>
   PathInfo cachedPathComputation(InodeNumber number, Fn&& fn);
 
+  /**
+   * The inodes and errors found in one part of the overlay by a worker
+   * thread.  They are merged into the OverlayChecker state afterwards, so
+   * that worker threads never modify inodes_ or errors_ directly.
+   */
+  struct ScanResult {
+    template <typename ErrorType, typename... Args>
+    void addError(Args&&... args) {
+      errors.push_back(
+          std::make_unique<ErrorType>(std::forward<Args>(args)...));
+    }
+
+    void updateMaxInodeNumber(InodeNumber number) {
+      if (number.get() > maxInodeNumber) {
+        maxInodeNumber = number.get();
+      }
+    }
+
+    std::vector<InodeInfo> inodes;
+    std::vector<std::unique_ptr<Error>> errors;
+    uint64_t maxInodeNumber{0};
+  };
+
   using ShardID = uint32_t;
   void readInodes(const ProgressCallback& progressCallback = [](auto) {});
-  void readInodeSubdir(const AbsolutePath& path, ShardID shardID);
-  void loadInode(InodeNumber number, ShardID shardID);
-  InodeInfo loadInodeInfo(InodeNumber number);
+  ScanResult readInodeSubdir(const AbsolutePath& path, ShardID shardID);
+  void loadInode(InodeNumber number, ShardID shardID, ScanResult& result);
+  InodeInfo loadInodeInfo(InodeNumber number, ScanResult& result);
   overlay::OverlayDir loadDirectoryChildren(folly::File& file);
+  void mergeScanResult(ScanResult&& result);
+
+  /**
+   * Split inodes_ into contiguous runs, in iteration order, and call
+   * fn(inodes, result) for each run in parallel, where inodes is a range of
+   * InodeInfo pointers.  The results are returned in the same order as the
+   * runs, so merging them in order matches a serial walk over inodes_.
+   */
+  template <typename Result, typename Fn>
+  std::vector<Result> analyzeInodesInParallel(Fn&& fn);
 
   void linkInodeChildren();
   void scanForParentErrors();
@@ -203,15 +269,12 @@ class OverlayChecker {
   }
   void addError(std::unique_ptr<Error> error);
 
-  void updateMaxInodeNumber(InodeNumber number) {
-    if (number.get() > maxInodeNumber_) {
-      maxInodeNumber_ = number.get();
-    }
-  }
-
   FsOverlay* const fs_;
   std::optional<InodeNumber> loadedNextInodeNumber_;
+  const size_t numThreads_;
   std::unordered_map<InodeNumber, InodeInfo> inodes_;
+  /** Children named by a directory that have no data in the overlay. */
+  std::unordered_set<InodeNumber> unmaterializedChildren_;
   std::vector<std::unique_ptr<Error>> errors_;
   uint64_t maxInodeNumber_{kRootNodeId.get()};
 
@@ -16,6 +16,7 @@
 
 #include "eden/fs/inodes/overlay/FsOverlay.h"
 #include "eden/fs/inodes/overlay/OverlayChecker.h"
+#include "eden/fs/inodes/sqliteoverlay/SqliteOverlay.h"
 
 FOLLY_INIT_LOGGING_CONFIG("eden=DBG2; default:async=true");
 
@@ -23,6 +24,10 @@ DEFINE_bool(
     dry_run,
     false,
     "Only report errors, without attempting to fix any problems");
+DEFINE_uint32(
+    num_threads,
+    OverlayChecker::kDefaultNumThreads,
+    "The number of threads used to scan the overlay");
 
 using namespace facebook::eden;
 
@@ -37,6 +42,12 @@ int main(int argc, char** argv) {
   std::optional<FsOverlay> fsOverlay;
   std::optional<InodeNumber> nextInodeNumber;
   auto overlayPath = normalizeBestEffort(argv[1]);
+  if (SqliteOverlay::exists(overlayPath)) {
+    // The checker would consider every file orphaned.
+    XLOG(ERR) << "overlay directories are stored in SQLite, which eden_fsck "
+              << "does not support";
+    return 1;
+  }
   try {
     fsOverlay.emplace(overlayPath);
     nextInodeNumber = fsOverlay->initOverlay(/*createIfNonExisting=*/false);
@@ -49,7 +60,8 @@ int main(int argc, char** argv) {
     XLOG(INFO) << "Overlay was shut down uncleanly";
   }
 
-  OverlayChecker checker(&fsOverlay.value(), nextInodeNumber);
+  OverlayChecker checker(
+      &fsOverlay.value(), nextInodeNumber, FLAGS_num_threads);
   checker.scanForErrors();
   if (FLAGS_dry_run) {
     checker.logErrors();
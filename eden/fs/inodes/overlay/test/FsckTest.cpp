@@ -614,3 +614,34 @@ TEST(Fsck, testHardLink) {
           "- src/foo/x/y/z.txt")));
   overlay->fs().close(checker.getNextInodeNumber());
 }
+
+TEST(Fsck, testThreadCountsAndProgress) {
+  auto overlay = make_shared<TestOverlay>();
+  auto root = overlay->init();
+  SimpleOverlayLayout layout(root);
+  layout.src_foo.linkFile(layout.src_foo_x_y_zTxt.number(), "also_z.txt");
+  layout.src_foo.save();
+  overlay->fs().removeOverlayFile(layout.src.number());
+
+  // A single thread and several threads should find the same problems, in
+  // the same order.
+  OverlayChecker serialChecker(&overlay->fs(), std::nullopt, 1);
+  serialChecker.scanForErrors();
+  auto serialErrors = errorMessages(serialChecker);
+  EXPECT_EQ(4, serialErrors.size());
+
+  std::vector<uint16_t> progress;
+  OverlayChecker parallelChecker(&overlay->fs(), std::nullopt, 16);
+  parallelChecker.scanForErrors(
+      [&progress](uint16_t tenths) { progress.push_back(tenths); });
+  EXPECT_EQ(serialErrors, errorMessages(parallelChecker));
+  EXPECT_EQ(
+      serialChecker.getNextInodeNumber(),
+      parallelChecker.getNextInodeNumber());
+
+  // Progress is reported once at the start and then once per 10% scanned.
+  EXPECT_EQ(
+      (std::vector<uint16_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}), progress);
+
+  overlay->fs().close(parallelChecker.getNextInodeNumber());
+}
@@ -7,6 +7,8 @@
 
 #include "SqliteOverlay.h"
 
+#include <boost/filesystem.hpp>
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
 #include <folly/container/Array.h>
 #include <folly/logging/xlog.h>
@@ -35,15 +37,37 @@ constexpr uint64_t kStartInodeNumber = 100;
 // shutdown. More details in the header file.
 constexpr uint64_t kInodeAllocationRange = 100;
 
+SqliteOverlay::Statements::Statements(LockedDbPtr& db)
+    : load{db, "select value from ", kInodeTable, " where inode = ?"},
+      has{db, "select 1 from ", kInodeTable, " where inode = ?"},
+      // TODO: we need `or ignore` otherwise we hit primary key violations
+      // when running our integration tests.  This implies that we're
+      // over-fetching and that we have a perf improvement opportunity.
+      save{db, "insert or replace into ", kInodeTable, " VALUES(?, ?, ?)"},
+      remove{db, "delete from ", kInodeTable, " where inode = ?"} {}
+
 SqliteOverlay::SqliteOverlay(AbsolutePathPiece localDir)
     : localDir_{std::move(localDir)} {}
 
 SqliteOverlay::~SqliteOverlay() {
+  statements_.reset();
   if (db_) {
     db_->close();
   }
 }
 
+bool SqliteOverlay::exists(AbsolutePathPiece localDir) {
+  return boost::filesystem::exists((localDir + kOverlayName).c_str());
+}
+
+void SqliteOverlay::removeDatabase(AbsolutePathPiece localDir) {
+  // Remove the write ahead log and its index along with the database.
+  auto path = (localDir + kOverlayName).value();
+  for (auto suffix : {"-wal", "-shm", ""}) {
+    boost::filesystem::remove(path + suffix);
+  }
+}
+
 std::optional<InodeNumber> SqliteOverlay::initOverlay(
     bool createIfNonExisting) {
   if (createIfNonExisting) {
@@ -55,6 +79,10 @@ std::optional<InodeNumber> SqliteOverlay::initOverlay(
 
   // Write ahead log for faster perf https://www.sqlite.org/wal.html
   SqliteStatement(db, "PRAGMA journal_mode=WAL").step();
+  // In WAL mode this only gives up durability of the most recent commits on
+  // power loss, never consistency, which matches the FsOverlay which does not
+  // fsync its files either.
+  SqliteStatement(db, "PRAGMA synchronous=NORMAL").step();
 
   // The Inode table stores the information about each inode. At this point we
   // are only using it to store the information about the directory entries
@@ -81,6 +109,8 @@ std::optional<InodeNumber> SqliteOverlay::initOverlay(
       ")")
       .step();
 
+  statements_ = std::make_unique<Statements>(db);
+
   // In the following code we read the last know used inode number and allocate
   // a range of inodes by saving the incremented value in db.
   uint64_t nextInodeNumber;
@@ -94,6 +124,7 @@ std::optional<InodeNumber> SqliteOverlay::initOverlay(
   auto nextValue = nextInodeNumber + kStartInodeNumber;
   writeNextInodeNumber(db, nextValue);
   nextInodeNumber_.store(nextValue, std::memory_order_release);
+  initialized_ = true;
 
   // The only reason we return an optional value is to have a common interface
   // with FsOverlay. This would change once we have implement OverlayChecker.
@@ -104,6 +135,7 @@ void SqliteOverlay::close(std::optional<InodeNumber> nextInodeNumber) {
   if (nextInodeNumber.has_value()) {
     saveNextInodeNumber(nextInodeNumber.value().get());
   }
+  statements_.reset();
   db_->close();
 }
 
@@ -113,9 +145,10 @@ void SqliteOverlay::updateUsedInodeNumber(uint64_t usedInodeNumber) {
 
 std::optional<std::string> SqliteOverlay::load(uint64_t inodeNumber) const {
   auto db = db_->lock();
-
-  SqliteStatement stmt(
-      db, "select value from ", kInodeTable, " where inode = ?");
+  auto& stmt = statements_->load;
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   // Bind the inode; parameters are 1-based
   stmt.bind(1, inodeNumber);
@@ -132,8 +165,10 @@ std::optional<std::string> SqliteOverlay::load(uint64_t inodeNumber) const {
 
 bool SqliteOverlay::hasInode(uint64_t inodeNumber) const {
   auto db = db_->lock();
-
-  SqliteStatement stmt(db, "select 1 from ", kInodeTable, " where inode = ?");
+  auto& stmt = statements_->has;
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   stmt.bind(1, inodeNumber);
   return stmt.step();
@@ -144,15 +179,10 @@ void SqliteOverlay::save(
     bool isDirectory,
     ByteRange value) {
   auto db = db_->lock();
-
-  SqliteStatement stmt(
-      db,
-      // TODO: we need `or ignore` otherwise we hit primary key violations
-      // when running our integration tests.  This implies that we're
-      // over-fetching and that we have a perf improvement opportunity.
-      "insert or replace into ",
-      kInodeTable,
-      " VALUES(?, ?, ?)");
+  auto& stmt = statements_->save;
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   const uint32_t dir = isDirectory ? 1 : 0;
 
@@ -175,6 +205,37 @@ void SqliteOverlay::saveOverlayDir(
       folly::StringPiece(serializedData));
 }
 
+void SqliteOverlay::saveOverlayDirs(
+    const std::unordered_map<InodeNumber, overlay::OverlayDir>& dirs) {
+  // Serialize before taking the lock.
+  std::vector<std::pair<uint64_t, std::string>> serialized;
+  serialized.reserve(dirs.size());
+  for (const auto& [inodeNumber, odir] : dirs) {
+    serialized.emplace_back(
+        inodeNumber.getRawValue(),
+        apache::thrift::CompactSerializer::serialize<std::string>(odir));
+  }
+
+  auto db = db_->lock();
+  auto& stmt = statements_->save;
+  SqliteStatement(db, "BEGIN").step();
+  try {
+    for (const auto& [inodeNumber, value] : serialized) {
+      stmt.bind(1, inodeNumber);
+      stmt.bind(2, uint32_t{1});
+      stmt.bind(3, StringPiece{value});
+      stmt.step();
+    }
+    SqliteStatement(db, "COMMIT").step();
+  } catch (const std::exception&) {
+    // Speculative rollback to make sure that we're not still in a
+    // transaction if we bail out in the error path
+    stmt.reset();
+    SqliteStatement(db, "ROLLBACK").step();
+    throw;
+  }
+}
+
 std::optional<overlay::OverlayDir> SqliteOverlay::loadOverlayDir(
     InodeNumber inodeNumber) {
   auto serializedData = load(inodeNumber.getRawValue());
@@ -188,8 +249,10 @@ std::optional<overlay::OverlayDir> SqliteOverlay::loadOverlayDir(
 
 void SqliteOverlay::removeOverlayData(InodeNumber inodeNumber) {
   auto db = db_->lock();
-
-  SqliteStatement stmt(db, "delete from ", kInodeTable, " where inode = ?");
+  auto& stmt = statements_->remove;
+  SCOPE_EXIT {
+    stmt.reset();
+  };
 
   stmt.bind(1, inodeNumber.get());
   stmt.step();
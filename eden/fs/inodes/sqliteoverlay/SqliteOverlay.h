@@ -7,19 +7,22 @@
 
 #pragma once
 #include <folly/Synchronized.h>
+#include <unordered_map>
+#include "eden/fs/fuse/InodeNumber.h"
 #include "eden/fs/sqlite/Sqlite.h"
 
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
 
 namespace facebook {
 namespace eden {
-struct InodeNumber;
 using LockedDbPtr = folly::Synchronized<sqlite3*>::LockedPtr;
 
 /**
  * Sqlite overlay stores the directory inode and its entries in the sqlite
  * database. This is similar to FsOverlay but doesn't support all the
- * functionality. This is only used on Windows right now.
+ * functionality. It is the only overlay on Windows.  On other platforms a
+ * checkout can opt into keeping its directories here, in a single file,
+ * while file contents stay in FsOverlay.
  */
 
 class SqliteOverlay {
@@ -56,6 +59,13 @@ class SqliteOverlay {
   }
 
   void saveOverlayDir(InodeNumber inodeNumber, const overlay::OverlayDir& odir);
+
+  /**
+   * Save several directories in a single transaction.
+   */
+  void saveOverlayDirs(
+      const std::unordered_map<InodeNumber, overlay::OverlayDir>& dirs);
+
   std::optional<overlay::OverlayDir> loadOverlayDir(InodeNumber inodeNumber);
   void removeOverlayData(InodeNumber inodeNumber);
   bool hasOverlayData(InodeNumber inodeNumber);
@@ -76,7 +86,30 @@ class SqliteOverlay {
    */
   void updateUsedInodeNumber(uint64_t usedInodeNumber);
 
+  /**
+   * Returns true if there is a database in localDir.
+   */
+  static bool exists(AbsolutePathPiece localDir);
+
+  /**
+   * Delete the database in localDir, which must not be open.
+   */
+  static void removeDatabase(AbsolutePathPiece localDir);
+
  private:
+  /**
+   * The statements used for the per-inode queries.  They are prepared once
+   * by initOverlay() and must only be used while holding the db_ lock.
+   */
+  struct Statements {
+    explicit Statements(LockedDbPtr& db);
+
+    SqliteStatement load;
+    SqliteStatement has;
+    SqliteStatement save;
+    SqliteStatement remove;
+  };
+
   std::optional<std::string> load(uint64_t inodeNumber) const;
   bool hasInode(uint64_t inodeNumber) const;
   void save(uint64_t inodeNumber, bool isDirectory, folly::ByteRange value);
@@ -89,6 +122,9 @@ class SqliteOverlay {
   // Sqlite db handle
   std::unique_ptr<SqliteDatabase> db_;
 
+  // Must be destroyed before db_ is closed.
+  std::unique_ptr<Statements> statements_;
+
   // Path to the folder containing DB.
   const AbsolutePath localDir_;
 
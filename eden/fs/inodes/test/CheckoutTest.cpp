@@ -1116,6 +1116,43 @@ TEST(Checkout, checkoutRemembersInodeNumbersAfterCheckoutAndTakeover) {
   EXPECT_EQ(dirInodeNumber, subTree->getParentRacy()->getNodeId());
   EXPECT_EQ(subInodeNumber, subTree->getNodeId());
 }
+
+TEST(Checkout, checkoutUnloadsOnlyChangedUnreferencedTrees) {
+  auto builder1 = FakeTreeBuilder{};
+  builder1.setFile("changed/sub/file.txt", "contents1");
+  builder1.setFile("unchanged/sub/file.txt", "contents");
+  TestMount testMount{builder1};
+
+  auto builder2 = builder1.clone();
+  builder2.replaceFile("changed/sub/file.txt", "contents2");
+  builder2.finalize(testMount.getBackingStore(), true);
+  auto commit2 = testMount.getBackingStore()->putCommit("2", builder2);
+  commit2->setReady();
+
+  // Load both files, but do not reference them from FUSE.
+  testMount.getFileInode("changed/sub/file.txt");
+  auto unchangedInodeNumber =
+      testMount.getFileInode("unchanged/sub/file.txt")->getNodeId();
+  auto inodeMap = testMount.getEdenMount()->getInodeMap();
+  auto countsBefore = inodeMap->getInodeCounts();
+
+  auto executor = testMount.getServerExecutor().get();
+  auto checkoutResult =
+      testMount.getEdenMount()
+          ->checkout(makeTestHash("2"), std::nullopt, __func__)
+          .getVia(executor);
+  EXPECT_EQ(0, checkoutResult.conflicts.size());
+
+  // The changed subtree was unloaded and given its new hash rather than being
+  // walked, while the unchanged subtree was left alone.
+  auto countsAfter = inodeMap->getInodeCounts();
+  EXPECT_EQ(countsBefore.treeCount - 2, countsAfter.treeCount);
+  EXPECT_EQ(countsBefore.fileCount - 1, countsAfter.fileCount);
+  EXPECT_TRUE(inodeMap->lookupLoadedInode(unchangedInodeNumber));
+
+  EXPECT_FILE_INODE(
+      testMount.getFileInode("changed/sub/file.txt"), "contents2", 0644);
+}
 #endif
 
 namespace {
@@ -1366,6 +1403,86 @@ TEST(Checkout, checkoutFailsOnInProgressCheckout) {
   EXPECT_NO_THROW(std::move(checkout2).get());
 }
 
+TEST(Checkout, replacesLoadedFilesWithoutFetchingTheirContents) {
+  auto builder1 = FakeTreeBuilder();
+  builder1.setFile("src/main.c", "int main() { return 0; }\n");
+  TestMount testMount{makeTestHash("1"), builder1};
+  testMount.getFileInode("src/main.c");
+
+  auto builder2 = builder1.clone();
+  builder2.replaceFile("src/main.c", "int main() { return 1; }\n");
+  builder2.finalize(testMount.getBackingStore(), false);
+  auto commit2 = testMount.getBackingStore()->putCommit("2", builder2);
+  commit2->setReady();
+
+  // Only the trees are made ready.  The unmodified file is compared with the
+  // old source control entry by hash, and given the new one's hash.
+  builder2.setReady("");
+  builder2.setReady("src");
+  auto executor = testMount.getServerExecutor().get();
+  auto checkoutResult =
+      testMount.getEdenMount()
+          ->checkout(makeTestHash("2"), std::nullopt, __func__)
+          .waitVia(executor);
+  ASSERT_TRUE(checkoutResult.isReady());
+  EXPECT_EQ(0, std::move(checkoutResult).get().conflicts.size());
+
+  builder2.setAllReady();
+  EXPECT_FILE_INODE(
+      testMount.getFileInode("src/main.c"), "int main() { return 1; }\n", 0644);
+}
+
+TEST(Checkout, reportsProgressWhileRunning) {
+  auto builder1 = FakeTreeBuilder();
+  builder1.setFile("README", "Read me.\n");
+  builder1.setFile("src/main.c", "int main() { return 0; }\n");
+  TestMount testMount{makeTestHash("1"), builder1};
+
+  auto builder2 = builder1.clone();
+  builder2.replaceFile("README", "Read me again.\n");
+  builder2.replaceFile("src/main.c", "int main() { return 1; }\n");
+  builder2.setFile("src/new.c", "// New file.\n");
+  builder2.finalize(testMount.getBackingStore(), false);
+  auto commit2 = testMount.getBackingStore()->putCommit("2", builder2);
+  commit2->setReady();
+
+  // Load src/main.c so that the checkout has to load the new src tree to
+  // update it.
+  testMount.getFileInode("src/main.c");
+
+  auto progress = testMount.getEdenMount()->getCheckoutProgress();
+  EXPECT_FALSE(*progress.checkoutInProgress_ref());
+
+  auto checkoutResult = testMount.getEdenMount()->checkout(
+      makeTestHash("2"), std::nullopt, __func__);
+  testMount.drainServerExecutor();
+  EXPECT_FALSE(checkoutResult.isReady());
+  progress = testMount.getEdenMount()->getCheckoutProgress();
+  EXPECT_TRUE(*progress.checkoutInProgress_ref());
+  EXPECT_EQ(0, *progress.treesProcessed_ref());
+  EXPECT_EQ(0, *progress.filesUpdated_ref());
+
+  // With the root tree ready, README can be replaced, but src waits for its
+  // new tree.
+  builder2.setReady("");
+  testMount.drainServerExecutor();
+  EXPECT_FALSE(checkoutResult.isReady());
+  progress = testMount.getEdenMount()->getCheckoutProgress();
+  EXPECT_TRUE(*progress.checkoutInProgress_ref());
+  EXPECT_EQ(0, *progress.treesProcessed_ref());
+  EXPECT_EQ(1, *progress.filesUpdated_ref());
+  EXPECT_EQ(0, *progress.bytesFetched_ref());
+
+  builder2.setAllReady();
+  auto executor = testMount.getServerExecutor().get();
+  auto waitedCheckoutResult = std::move(checkoutResult).waitVia(executor);
+  ASSERT_TRUE(waitedCheckoutResult.isReady());
+  EXPECT_EQ(0, std::move(waitedCheckoutResult).get().conflicts.size());
+
+  progress = testMount.getEdenMount()->getCheckoutProgress();
+  EXPECT_FALSE(*progress.checkoutInProgress_ref());
+}
+
 // TODO:
 // - remove subdirectory
 //   - with no untracked/ignored files, it should get removed entirely
@@ -342,6 +342,64 @@ TEST(DiffTest, pathOrdering) {
           std::make_pair("three/zzz.txt", ScmFileStatus::MODIFIED)));
 }
 
+TEST(DiffTest, repeatedStatusReportsLaterChanges) {
+  DiffTest test;
+  auto df = test.diffFuture();
+  auto result = EXPECT_FUTURE_RESULT(df);
+  EXPECT_THAT(*result.entries_ref(), UnorderedElementsAre());
+
+  test.getMount().overwriteFile("src/1.txt", "This file has been updated.\n");
+  test.getMount().addFile("src/a/new.txt", "extra stuff\n");
+  df = test.diffFuture();
+  result = EXPECT_FUTURE_RESULT(df);
+  EXPECT_THAT(
+      *result.entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED),
+          std::make_pair("src/a/new.txt", ScmFileStatus::ADDED)));
+
+  // Nothing has changed since the last call.
+  df = test.diffFuture();
+  EXPECT_EQ(result, EXPECT_FUTURE_RESULT(df));
+
+  // Restoring the original contents removes the file from the status, and
+  // changes elsewhere are still reported.
+  test.getMount().overwriteFile("src/1.txt", "This is src/1.txt.\n");
+  test.getMount().move("src/a/b", "src/z");
+  df = test.diffFuture();
+  result = EXPECT_FUTURE_RESULT(df);
+  EXPECT_THAT(
+      *result.entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/a/new.txt", ScmFileStatus::ADDED),
+          std::make_pair("src/a/b/3.txt", ScmFileStatus::REMOVED),
+          std::make_pair("src/a/b/c/4.txt", ScmFileStatus::REMOVED),
+          std::make_pair("src/z/3.txt", ScmFileStatus::ADDED),
+          std::make_pair("src/z/c/4.txt", ScmFileStatus::ADDED)));
+}
+
+TEST(DiffTest, repeatedStatusAppliesIgnoreFileChanges) {
+  DiffTest test;
+  test.getMount().addFile("src/a/b/debug.log", "log\n");
+  test.getMount().addFile("src/a/b/c/trace.log", "log\n");
+  auto df = test.diffFuture();
+  auto result = EXPECT_FUTURE_RESULT(df);
+  EXPECT_THAT(
+      *result.entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/a/b/debug.log", ScmFileStatus::ADDED),
+          std::make_pair("src/a/b/c/trace.log", ScmFileStatus::ADDED)));
+
+  // The new rules apply to files that did not change themselves.
+  test.getMount().addFile("src/a/.gitignore", "*.log\n");
+  df = test.diffFuture(/*listIgnored=*/false);
+  result = EXPECT_FUTURE_RESULT(df);
+  EXPECT_THAT(
+      *result.entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/a/.gitignore", ScmFileStatus::ADDED)));
+}
+
 /*
  * The following tests modify the directory contents using resetCommit()
  * This exercises a different code path than when using FUSE-like filesystem
@@ -591,6 +649,35 @@ TEST(DiffTest, ignoreToplevelOnly) {
               "src/foo/abc/xyz/ignore.txt", ScmFileStatus::IGNORED)));
 }
 
+// Unmodified .gitignore files are read by hash, without loading their inodes
+TEST(DiffTest, unmodifiedIgnoreFilesAreReadWithoutLoadingInodes) {
+  DiffTest test({
+      {"src/a/.gitignore", "*.log\n"},
+      {"src/a/x.txt", "test\n"},
+      {"src/b/.gitignore", "*.tmp\n"},
+      {"src/b/y.txt", "test\n"},
+  });
+  test.getMount().addFile("src/a/debug.log", "new\n");
+  test.getMount().addFile("src/a/debug.tmp", "new\n");
+  test.getMount().addFile("src/b/debug.log", "new\n");
+  test.getMount().addFile("src/b/debug.tmp", "new\n");
+
+  auto result = test.diff();
+  EXPECT_THAT(
+      *result.entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/a/debug.tmp", ScmFileStatus::ADDED),
+          std::make_pair("src/b/debug.log", ScmFileStatus::ADDED)));
+
+  for (auto dir : {"src/a", "src/b"}) {
+    auto tree = test.getMount().getTreeInode(dir);
+    auto contents = tree->getContents().rlock();
+    auto iter = contents->entries.find(".gitignore"_pc);
+    ASSERT_NE(contents->entries.end(), iter) << dir;
+    EXPECT_EQ(nullptr, iter->second.getInode()) << dir;
+  }
+}
+
 // Test with a file that matches a .gitignore pattern but also is already in the
 // Tree (so we should report the modification)
 TEST(DiffTest, ignoredFileInMountAndInTree) {
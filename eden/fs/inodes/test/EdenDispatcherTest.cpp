@@ -127,3 +127,22 @@ TEST(RawEdenDispatcherTest, lookup_returns_valid_inode_for_bad_file) {
   EXPECT_NE(0, entry.attr.ino);
   EXPECT_EQ(entry.nodeid, entry.attr.ino);
 }
+
+TEST(RawEdenDispatcherTest, materialized_files_get_short_attr_timeouts) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"clean", "contents"}, {"dirty", "contents"}});
+  TestMount mount{builder};
+  mount.overwriteFile("dirty", "new contents");
+  auto& context = ObjectFetchContext::getNullContext();
+  auto* dispatcher = mount.getDispatcher();
+
+  auto clean = dispatcher->lookup(kRootNodeId, "clean"_pc, context).get(0ms);
+  EXPECT_EQ(std::numeric_limits<int32_t>::max(), clean.attr_valid);
+  EXPECT_EQ(std::numeric_limits<int32_t>::max(), clean.entry_valid);
+
+  auto dirty = dispatcher->lookup(kRootNodeId, "dirty"_pc, context).get(0ms);
+  EXPECT_EQ(1, dirty.attr_valid);
+  EXPECT_EQ(1, dirty.entry_valid);
+  auto attr = dispatcher->getattr(InodeNumber{dirty.nodeid}, context).get(0ms);
+  EXPECT_EQ(1, attr.timeout_seconds);
+}
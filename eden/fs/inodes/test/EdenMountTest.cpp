@@ -242,6 +242,34 @@ TEST(EdenMount, loadFileContentsFromPathInvalidInodePtr) {
   EXPECT_THROW_ERRNO(testMount.loadFileContentsFromPath("src"), EISDIR);
 }
 
+TEST(EdenMount, getInodeFollowsRenamesOfCachedPaths) {
+  FakeTreeBuilder builder;
+  builder.setFile("src/a/file.txt", "contents\n");
+  builder.setFile("src/b/file.txt", "other\n");
+  TestMount testMount{builder};
+
+  auto file = testMount.getInode("src/a/file.txt");
+  EXPECT_EQ(file, testMount.getInode("src/a/file.txt"));
+
+  // Renaming a parent moves the cached path's inode elsewhere.
+  auto src = testMount.getTreeInode("src");
+  auto renameFuture =
+      src->rename("a"_pc, src, "c"_pc, InvalidationRequired::No);
+  ASSERT_TRUE(renameFuture.isReady());
+  EXPECT_THROW_ERRNO(testMount.getInode("src/a/file.txt"), ENOENT);
+  EXPECT_EQ(file, testMount.getInode("src/c/file.txt"));
+
+  // Renaming over the cached path itself replaces what it resolves to.
+  auto other = testMount.getInode("src/b/file.txt");
+  auto c = testMount.getTreeInode("src/c");
+  auto b = testMount.getTreeInode("src/b");
+  renameFuture =
+      b->rename("file.txt"_pc, c, "file.txt"_pc, InvalidationRequired::No);
+  ASSERT_TRUE(renameFuture.isReady());
+  EXPECT_EQ(other, testMount.getInode("src/c/file.txt"));
+  EXPECT_THROW_ERRNO(testMount.getInode("src/b/file.txt"), ENOENT);
+}
+
 TEST(EdenMount, resolveSymlink) {
   FakeTreeBuilder builder;
   builder.mkdir("src");
@@ -7,12 +7,15 @@
 
 #include "eden/fs/inodes/FileInode.h"
 
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/Range.h>
 #include <folly/test/TestUtils.h>
 #include <gtest/gtest.h>
 #include <chrono>
 
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/inodes/Overlay.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/store/IObjectStore.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
@@ -610,6 +613,134 @@ TEST(FileInode, reloadsBlobIfCacheIsEvicted) {
       << "reading should insert hash " << hash << " into cache";
 }
 
+namespace {
+void setPartialMaterialization(
+    TestMount& mount,
+    uint64_t minSize,
+    uint64_t maxRanges) {
+  auto& serverState = mount.getServerState();
+  auto userConfigPath = serverState->getEdenConfig()->getUserConfigPath();
+  folly::writeFileAtomic(
+      userConfigPath.stringPiece(),
+      folly::to<std::string>(
+          "[overlay]\n",
+          "partial-materialization-min-size = \"",
+          minSize,
+          "\"\n",
+          "partial-materialization-max-ranges = \"",
+          maxRanges,
+          "\"\n"));
+  serverState->getReloadableConfig().getEdenConfig(
+      ConfigReloadBehavior::ForceReload);
+}
+
+bool isPartiallyMaterialized(TestMount& mount, const FileInodePtr& inode) {
+  return mount.getEdenMount()
+      ->getOverlay()
+      ->getPartialFileBlob(inode->getNodeId())
+      .has_value();
+}
+} // namespace
+
+TEST(FileInode, writePartiallyMaterializesLargeFile) {
+  FakeTreeBuilder builder;
+  builder.setFiles(
+      {{"dir/big.txt", "0123456789abcdefghij"}, {"dir/small.txt", "0123"}});
+  TestMount mount{builder};
+  setPartialMaterialization(mount, 10, 16);
+
+  auto inode = mount.getFileInode("dir/big.txt");
+  EXPECT_EQ(2, inode->write("XY", 5).get());
+  EXPECT_TRUE(isPartiallyMaterialized(mount, inode));
+  EXPECT_FALSE(inode->getBlobHash().has_value());
+  EXPECT_TRUE(isInodeMaterialized(mount.getTreeInode("dir")));
+
+  auto& context = ObjectFetchContext::getNullContext();
+  EXPECT_EQ("4XY7", inode->read(4, 4, context).get().copyData());
+  EXPECT_EQ("gh", inode->read(2, 16, context).get().copyData());
+  EXPECT_FILE_INODE(inode, "01234XY789abcdefghij", 0644);
+  EXPECT_EQ(20, getFileAttr(inode).st.st_size);
+
+  // Writing past the end of the file leaves a hole of zeros.
+  EXPECT_EQ(1, inode->write("Z", 22).get());
+  EXPECT_FILE_INODE(inode, "01234XY789abcdefghij\0\0Z"_sp, 0644);
+
+  // Smaller files are fully materialized.
+  auto small = mount.getFileInode("dir/small.txt");
+  EXPECT_EQ(1, small->write("X", 0).get());
+  EXPECT_FALSE(isPartiallyMaterialized(mount, small));
+  EXPECT_FILE_INODE(small, "X123", 0644);
+}
+
+TEST(FileInode, partialMaterializationSurvivesUnload) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"big.txt", "0123456789abcdefghij"}});
+  TestMount mount{builder};
+  setPartialMaterialization(mount, 10, 16);
+
+  auto inode = mount.getFileInode("big.txt");
+  EXPECT_EQ(3, inode->write("XYZ", 10).get());
+  inode.reset();
+  mount.getEdenMount()->getRootInode()->unloadChildrenNow();
+
+  inode = mount.getFileInode("big.txt");
+  EXPECT_TRUE(isPartiallyMaterialized(mount, inode));
+  EXPECT_FILE_INODE(inode, "0123456789XYZdefghij", 0644);
+}
+
+TEST(FileInode, fullyMaterializesPartialFile) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a.txt", "0123456789abcdefghij"},
+                    {"b.txt", "0123456789abcdefghij"}});
+  TestMount mount{builder};
+  setPartialMaterialization(mount, 10, 3);
+
+  // Computing the SHA-1 needs the whole file.
+  auto inode = mount.getFileInode("a.txt");
+  EXPECT_EQ(1, inode->write("X", 0).get());
+  EXPECT_TRUE(isPartiallyMaterialized(mount, inode));
+  EXPECT_EQ(
+      Hash::sha1("X123456789abcdefghij"_sp),
+      inode->getSha1(ObjectFetchContext::getNullContext()).get());
+  EXPECT_FALSE(isPartiallyMaterialized(mount, inode));
+  EXPECT_FILE_INODE(inode, "X123456789abcdefghij", 0644);
+
+  // So does accumulating too many written ranges.
+  inode = mount.getFileInode("b.txt");
+  for (int off = 0; off < 8; off += 2) {
+    EXPECT_EQ(1, inode->write("X", off).get());
+  }
+  EXPECT_FALSE(isPartiallyMaterialized(mount, inode));
+  EXPECT_FILE_INODE(inode, "X1X3X5X789abcdefghij", 0644);
+}
+
+TEST_F(FileInodeTest, sha1OfModifiedLargeFile) {
+  // Large enough to span several of OverlayFileAccess's SHA-1 checkpoints.
+  std::string contents(3 * 1024 * 1024 + 100, 'a');
+  mount_.addFile("dir/large.bin", contents);
+  auto inode = mount_.getFileInode("dir/large.bin");
+  auto& context = ObjectFetchContext::getNullContext();
+  auto expectedSha1 = [&] { return Hash::sha1(StringPiece{contents}); };
+  EXPECT_EQ(expectedSha1(), inode->getSha1(context).get());
+
+  // Append, then modify the middle, then truncate, checking that the hash
+  // resumed from the remaining checkpoints matches a full recomputation.
+  EXPECT_EQ(3, inode->write("xyz", contents.size()).get());
+  contents += "xyz";
+  EXPECT_EQ(expectedSha1(), inode->getSha1(context).get());
+
+  EXPECT_EQ(1, inode->write("b", 1024 * 1024 + 17).get());
+  contents[1024 * 1024 + 17] = 'b';
+  EXPECT_EQ(expectedSha1(), inode->getSha1(context).get());
+
+  fuse_setattr_in attr;
+  attr.valid = FATTR_SIZE;
+  attr.size = 2 * 1024 * 1024;
+  (void)inode->setattr(attr).get(0ms);
+  contents.resize(2 * 1024 * 1024);
+  EXPECT_EQ(expectedSha1(), inode->getSha1(context).get());
+}
+
 // TODO: test multiple flags together
 // TODO: ensure ctime is updated after every call to setattr()
 // TODO: ensure mtime is updated after opening a file, writing to it, then
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <fcntl.h>
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/init/Init.h>
+#include <gflags/gflags.h>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/testharness/FakeFuse.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+DEFINE_uint64(files, 1000, "Number of files in the benchmark directory");
+DEFINE_uint64(fileSize, 4096, "Size of each file, and of each read");
+DEFINE_uint64(requests, 100000, "Number of requests to send");
+DEFINE_uint64(depth, 16, "Number of requests kept in flight at once");
+DEFINE_uint64(
+    executorThreads,
+    1,
+    "Number of threads running the requests that FuseChannel dispatches");
+DEFINE_string(
+    mix,
+    "lookup:1,getattr:1,read:1,readdir:1",
+    "Relative frequency of each request type");
+
+namespace {
+
+enum class Op { Lookup, Getattr, Read, Readdir };
+constexpr size_t kNumOps = 4;
+constexpr std::array<folly::StringPiece, kNumOps> kOpNames{
+    "lookup",
+    "getattr",
+    "read",
+    "readdir",
+};
+
+std::array<double, kNumOps> parseMix(folly::StringPiece mix) {
+  std::array<double, kNumOps> weights{};
+  std::vector<folly::StringPiece> terms;
+  folly::split(',', mix, terms);
+  for (auto term : terms) {
+    folly::StringPiece name;
+    folly::StringPiece weight;
+    if (!folly::split(':', term, name, weight)) {
+      throw std::invalid_argument(
+          folly::to<std::string>("invalid --mix term: ", term));
+    }
+    auto it = std::find(kOpNames.begin(), kOpNames.end(), name);
+    if (it == kOpNames.end()) {
+      throw std::invalid_argument(
+          folly::to<std::string>("unknown request type in --mix: ", name));
+    }
+    weights[it - kOpNames.begin()] = folly::to<double>(weight);
+  }
+  return weights;
+}
+
+/**
+ * Runs the tasks that FuseChannel dispatches to the TestMount's
+ * ManualExecutor, as the server's thread pool would, until stopped.
+ */
+class ExecutorThreads {
+ public:
+  ExecutorThreads(std::shared_ptr<folly::ManualExecutor> executor, size_t n)
+      : executor_{std::move(executor)} {
+    for (size_t i = 0; i < n; ++i) {
+      ++running_;
+      threads_.emplace_back([this] {
+        while (!stopping_.load(std::memory_order_acquire)) {
+          executor_->wait();
+          executor_->run();
+        }
+        --running_;
+      });
+    }
+  }
+
+  ~ExecutorThreads() {
+    stopping_.store(true, std::memory_order_release);
+    // Each wakeup may be consumed by any thread, so keep waking them until
+    // they have all seen stopping_.
+    while (running_.load() > 0) {
+      executor_->add([] {});
+      std::this_thread::sleep_for(1ms);
+    }
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+ private:
+  std::shared_ptr<folly::ManualExecutor> executor_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<size_t> running_{0};
+  std::vector<std::thread> threads_;
+};
+
+template <typename T>
+T parseResponse(const FakeFuse::Response& response, folly::StringPiece what) {
+  if (response.header.error != 0) {
+    throw std::system_error(
+        -response.header.error, std::generic_category(), what.str());
+  }
+  if (response.body.size() < sizeof(T)) {
+    throw std::runtime_error(folly::to<std::string>("short ", what, " reply"));
+  }
+  T result;
+  memcpy(&result, response.body.data(), sizeof(T));
+  return result;
+}
+
+/** The kernel's side of the mount, set up for the benchmark requests. */
+class BenchmarkMount {
+ public:
+  BenchmarkMount() : mount_{makeBuilder()} {
+    fuse_->setTimeout(10s);
+    mount_.startFuseAndWait(fuse_);
+    executorThreads_.emplace(
+        mount_.getServerExecutor(), FLAGS_executorThreads);
+
+    dirIno_ = lookup(FUSE_ROOT_ID, "dir");
+    fuse_open_in openArg{};
+    openArg.flags = O_RDONLY;
+    for (uint64_t i = 0; i < FLAGS_files; ++i) {
+      auto ino = lookup(dirIno_, fileName(i));
+      fuse_->sendRequest(FUSE_OPEN, ino, openArg);
+      auto fh = parseResponse<fuse_open_out>(fuse_->recvResponse(), "open").fh;
+      files_.emplace_back(ino, fh);
+    }
+    fuse_->sendRequest(FUSE_OPENDIR, dirIno_, openArg);
+    dirFh_ = parseResponse<fuse_open_out>(fuse_->recvResponse(), "opendir").fh;
+  }
+
+  ~BenchmarkMount() {
+    fuse_->close();
+    // The channel finishes shutting down on the executor threads.
+    std::move(mount_.getEdenMount()->getChannelCompletionFuture())
+        .within(10s)
+        .wait();
+    executorThreads_.reset();
+  }
+
+  /** Send the request for op on file index, returning its request ID. */
+  uint32_t send(Op op, uint64_t index) {
+    const auto& [ino, fh] = files_[index];
+    switch (op) {
+      case Op::Lookup:
+        return fuse_->sendLookup(dirIno_, fileName(index));
+      case Op::Getattr:
+        return fuse_->sendRequest(FUSE_GETATTR, ino, fuse_getattr_in{});
+      case Op::Read: {
+        fuse_read_in arg{};
+        arg.fh = fh;
+        arg.size = FLAGS_fileSize;
+        return fuse_->sendRequest(FUSE_READ, ino, arg);
+      }
+      case Op::Readdir: {
+        fuse_read_in arg{};
+        arg.fh = dirFh_;
+        arg.size = 4096;
+        return fuse_->sendRequest(FUSE_READDIR, dirIno_, arg);
+      }
+    }
+    throw std::logic_error("unknown request type");
+  }
+
+  FakeFuse::Response recv() {
+    return fuse_->recvResponse();
+  }
+
+ private:
+  static FakeTreeBuilder makeBuilder() {
+    FakeTreeBuilder builder;
+    std::string contents(FLAGS_fileSize, 'x');
+    for (uint64_t i = 0; i < FLAGS_files; ++i) {
+      builder.setFile(folly::to<std::string>("dir/", fileName(i)), contents);
+    }
+    return builder;
+  }
+
+  static std::string fileName(uint64_t index) {
+    return folly::to<std::string>("file", index);
+  }
+
+  uint64_t lookup(uint64_t parent, folly::StringPiece name) {
+    fuse_->sendLookup(parent, name);
+    return parseResponse<fuse_entry_out>(fuse_->recvResponse(), "lookup")
+        .nodeid;
+  }
+
+  std::shared_ptr<FakeFuse> fuse_{std::make_shared<FakeFuse>()};
+  TestMount mount_;
+  std::optional<ExecutorThreads> executorThreads_;
+  uint64_t dirIno_{0};
+  uint64_t dirFh_{0};
+  // The inode number and file handle of each file
+  std::vector<std::pair<uint64_t, uint64_t>> files_;
+};
+
+void runBenchmark() {
+  auto weights = parseMix(FLAGS_mix);
+  BenchmarkMount mount;
+
+  // Choose every request up front so the loop below only sends and
+  // receives.
+  std::mt19937_64 rng{std::random_device{}()};
+  std::discrete_distribution<size_t> pickOp{weights.begin(), weights.end()};
+  std::uniform_int_distribution<uint64_t> pickFile{0, FLAGS_files - 1};
+  std::vector<std::pair<Op, uint64_t>> requests;
+  requests.reserve(FLAGS_requests);
+  for (uint64_t i = 0; i < FLAGS_requests; ++i) {
+    requests.emplace_back(static_cast<Op>(pickOp(rng)), pickFile(rng));
+  }
+
+  std::array<HistogramAccumulator, kNumOps> latencies;
+  std::array<uint64_t, kNumOps> errors{};
+  // The op and send time of each request in flight, by request ID.
+  std::unordered_map<uint32_t, std::pair<Op, uint64_t>> inFlight;
+  size_t next = 0;
+  auto sendNext = [&] {
+    auto [op, index] = requests[next++];
+    auto start = getTime();
+    inFlight.emplace(mount.send(op, index), std::make_pair(op, start));
+  };
+
+  auto start = getTime();
+  while (next < requests.size() && inFlight.size() < FLAGS_depth) {
+    sendNext();
+  }
+  while (!inFlight.empty()) {
+    auto response = mount.recv();
+    auto end = getTime();
+    auto it = inFlight.find(response.header.unique);
+    if (it == inFlight.end()) {
+      throw std::runtime_error(folly::to<std::string>(
+          "reply to unknown request ", response.header.unique));
+    }
+    auto [op, sent] = it->second;
+    inFlight.erase(it);
+    latencies[static_cast<size_t>(op)].add(end - sent);
+    if (response.header.error != 0) {
+      ++errors[static_cast<size_t>(op)];
+    }
+    if (next < requests.size()) {
+      sendNext();
+    }
+  }
+  auto seconds = (getTime() - start) / 1e9;
+
+  printf(
+      "%" PRIu64 " requests at depth %" PRIu64 " with %" PRIu64
+      " executor threads: %.0f requests/s\n",
+      FLAGS_requests,
+      FLAGS_depth,
+      FLAGS_executorThreads,
+      FLAGS_requests / seconds);
+  for (size_t i = 0; i < kNumOps; ++i) {
+    if (latencies[i].getCount() == 0) {
+      continue;
+    }
+    printHistogram(
+        folly::to<std::string>(
+            kOpNames[i],
+            ": ",
+            latencies[i].getCount(),
+            " requests, ",
+            static_cast<uint64_t>(latencies[i].getCount() / seconds),
+            " requests/s, ",
+            errors[i],
+            " errors"),
+        latencies[i]);
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  if (FLAGS_files == 0 || FLAGS_depth == 0 || FLAGS_executorThreads == 0) {
+    fprintf(stderr, "error: files, depth and executorThreads must be set\n");
+    return 1;
+  }
+
+  runBenchmark();
+  return 0;
+}
@@ -17,6 +17,7 @@
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
 
+#include "eden/fs/inodes/GlobNodeCache.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
 #include "eden/fs/testharness/FakeTreeBuilder.h"
@@ -35,7 +36,7 @@ constexpr folly::Duration kSmallTimeout =
 
 folly::Future<std::vector<GlobResult>> evaluateGlob(
     TestMount& mount,
-    GlobNode& globRoot,
+    const GlobNode& globRoot,
     GlobNode::PrefetchList prefetchHashes) {
   auto rootInode = mount.getTreeInode(RelativePathPiece());
   auto objectStore = mount.getEdenMount()->getObjectStore();
@@ -78,7 +79,7 @@ class GlobNodeTest : public ::testing::TestWithParam<
     return doGlob(globRoot);
   }
 
-  std::vector<GlobResult> doGlob(GlobNode& globRoot) {
+  std::vector<GlobResult> doGlob(const GlobNode& globRoot) {
     globRoot.debugDump();
 
     if (shouldPrefetch()) {
@@ -256,6 +257,62 @@ TEST_P(GlobNodeTest, matchLiteralDirectoryAndDirectoryRecursiveChildren) {
   EXPECT_EQ(expect, matches);
 }
 
+TEST_P(GlobNodeTest, cachedGlobGivesSameResultsWhenRepeated) {
+  GlobNodeCache cache{/*maxRoots=*/10, /*maxTreeResults=*/100};
+  auto globRoot = cache.get({"dir/*.txt", "**/b.txt"}, true);
+  EXPECT_EQ(globRoot, cache.get({"**/b.txt", "dir/*.txt", "**/b.txt"}, true));
+  EXPECT_NE(globRoot, cache.get({"dir/*.txt", "**/b.txt"}, false));
+
+  std::vector<GlobResult> expect{
+      GlobResult("dir/sub/b.txt"_relpath, dtype_t::Regular),
+      GlobResult("dir/a.txt"_relpath, dtype_t::Regular),
+  };
+  for (int i = 0; i < 2; ++i) {
+    SCOPED_TRACE(folly::to<std::string>("evaluation ", i));
+    auto matches = doGlob(*globRoot);
+    EXPECT_EQ(expect, matches);
+    if (shouldPrefetch()) {
+      EXPECT_THAT(
+          getPrefetchHashes(), testing::UnorderedElementsAre(AHash, BHash));
+    }
+  }
+}
+
+TEST_P(GlobNodeTest, streamingGlobPassesAllMatches) {
+  GlobNode globRoot(/*includeDotfiles=*/true);
+  globRoot.parse("**/*.txt");
+  globRoot.parse("*");
+
+  folly::Synchronized<std::vector<GlobResult>> streamed;
+  GlobNode::ResultSink sink = [&](std::vector<GlobResult>&& results) {
+    auto locked = streamed.wlock();
+    locked->insert(
+        locked->end(),
+        std::make_move_iterator(results.begin()),
+        std::make_move_iterator(results.end()));
+  };
+  auto future = globRoot.evaluateStreaming(
+      mount_.getEdenMount()->getObjectStore(),
+      ObjectFetchContext::getNullContext(),
+      RelativePathPiece(),
+      mount_.getTreeInode(RelativePathPiece()),
+      /*fileBlobsToPrefetch=*/nullptr,
+      sink);
+  if (!GetParam().first) {
+    builder_.setAllReady();
+  }
+  std::move(future).get();
+
+  EXPECT_THAT(
+      *streamed.rlock(),
+      testing::UnorderedElementsAre(
+          GlobResult("dir/a.txt"_relpath, dtype_t::Regular),
+          GlobResult("dir/sub/b.txt"_relpath, dtype_t::Regular),
+          GlobResult(".eden"_relpath, dtype_t::Dir),
+          GlobResult(".watchmanconfig"_relpath, dtype_t::Regular),
+          GlobResult("dir"_relpath, dtype_t::Dir)));
+}
+
 const std::pair<enum StartReady, enum Prefetch> combinations[] = {
     {StartReady::Start, Prefetch::NoPrefetch},
     {StartReady::Start, Prefetch::PrefetchBlobs},
@@ -352,3 +409,33 @@ TEST(GlobNodeTest, treeLoadError) {
     }
   }
 }
+
+TEST(GlobNodeTest, recursiveGlobDoesNotLoadUnmaterializedTrees) {
+  auto mount = TestMount{};
+  auto builder = FakeTreeBuilder{};
+  builder.setFiles({
+      {"dir/a/x.txt", "x"},
+      {"dir/b/c/y.txt", "y"},
+      {"dir/b/z.c", "z"},
+  });
+  mount.initialize(builder);
+  auto inodeMap = mount.getEdenMount()->getInodeMap();
+  auto countsBefore = inodeMap->getInodeCounts();
+
+  GlobNode globRoot(/*includeDotfiles=*/false);
+  globRoot.parse("**/*.txt");
+  auto matches = evaluateGlob(mount, globRoot, /*prefetchHashes=*/nullptr)
+                     .get(kSmallTimeout);
+  EXPECT_EQ(
+      (std::vector<GlobResult>{
+          GlobResult("dir/a/x.txt"_relpath, dtype_t::Regular),
+          GlobResult("dir/b/c/y.txt"_relpath, dtype_t::Regular),
+      }),
+      matches);
+
+  // The unmaterialized directories are globbed using their source control
+  // trees, so no inodes should have been loaded for them.
+  auto countsAfter = inodeMap->getInodeCounts();
+  EXPECT_EQ(countsBefore.treeCount, countsAfter.treeCount);
+  EXPECT_EQ(countsBefore.fileCount, countsAfter.fileCount);
+}
@@ -11,6 +11,7 @@
 #include <folly/test/TestUtils.h>
 #include <gtest/gtest.h>
 #include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
 #include "eden/fs/testharness/FakeTreeBuilder.h"
 #include "eden/fs/testharness/TestChecks.h"
@@ -102,3 +103,48 @@ TEST(InodeLoader, notReady) {
     EXPECT_EQ("dir/sub/b.txt"_relpath, results[3].value());
   }
 }
+
+TEST(InodeLoader, resolveEntriesWithoutLoadingInodes) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/a.txt", "a"}, {"dir/sub/b.txt", "bb"}});
+  TestMount mount(builder);
+
+  auto rootInode = mount.getTreeInode(RelativePathPiece());
+  auto results =
+      collectAll(resolveEntries(
+                     rootInode,
+                     std::vector<std::string>{"dir",
+                                              "dir/sub",
+                                              "dir/sub/b.txt",
+                                              "dir/missing",
+                                              "dir/a.txt/child"},
+                     ObjectFetchContext::getNullContext()))
+          .get();
+
+  EXPECT_FALSE(results[0].value().inode);
+  EXPECT_EQ(dtype_t::Dir, results[0].value().getDtype());
+  EXPECT_TRUE(results[0].value().inodeNumber.has_value())
+      << "the root is loaded, so it has allocated an inode number for dir";
+  EXPECT_FALSE(results[1].value().inode);
+  EXPECT_EQ(dtype_t::Dir, results[1].value().getDtype());
+  EXPECT_FALSE(results[1].value().inodeNumber.has_value())
+      << "dir is not loaded, so dir/sub comes from its source control tree";
+  EXPECT_FALSE(results[2].value().inode);
+  EXPECT_EQ(dtype_t::Regular, results[2].value().getDtype());
+  EXPECT_EQ(
+      builder.getStoredBlob("dir/sub/b.txt"_relpath)->get().getHash(),
+      results[2].value().hash);
+  EXPECT_THROW_ERRNO(results[3].value(), ENOENT);
+  EXPECT_THROW_ERRNO(results[4].value(), ENOENT);
+
+  // Once a file is materialized its inode is returned instead.
+  mount.overwriteFile("dir/sub/b.txt", "changed");
+  auto materialized =
+      collectAll(resolveEntries(
+                     rootInode,
+                     std::vector<std::string>{"dir/sub/b.txt"},
+                     ObjectFetchContext::getNullContext()))
+          .get();
+  ASSERT_TRUE(materialized[0].value().inode);
+  EXPECT_EQ("dir/sub/b.txt"_relpath, materialized[0].value().inode->getPath());
+}
@@ -368,6 +368,31 @@ TEST(InodeMap, unloadedFileMetadataIsForgotten) {
   EXPECT_FALSE(mount.hasMetadata(file1ino));
   EXPECT_FALSE(mount.hasMetadata(file2ino));
 }
+
+TEST(InodeMap, unloadedUnlinkedFilesReloadWithTheirModeAndContents) {
+  FakeTreeBuilder builder;
+  builder.setFile("dir/file.txt", "contents", /*executable=*/true);
+  TestMount mount{builder};
+  auto edenMount = mount.getEdenMount();
+  auto* inodeMap = edenMount->getInodeMap();
+
+  auto dir = edenMount->getInode("dir"_relpath).get().asTreePtr();
+  auto file = edenMount->getInode("dir/file.txt"_relpath).get().asFilePtr();
+  auto fileino = file->getNodeId();
+  file->incFuseRefcount();
+  file.reset();
+  dir->unlink("file.txt"_pc, InvalidationRequired::No).get(0ms);
+  EXPECT_TRUE(inodeMap->isInodeRemembered(fileino));
+
+  // The unlinked file can no longer be loaded from its parent's entry, so it
+  // is loaded from what the InodeMap remembered about it.
+  file = inodeMap->lookupFileInode(fileino).get(0ms);
+  EXPECT_EQ(S_IFREG | 0755, file->getMode());
+  EXPECT_EQ(
+      "contents",
+      file->readAll(ObjectFetchContext::getNullContext()).get(0ms));
+  inodeMap->decFuseRefcount(fileino);
+}
 #endif
 
 struct InodePersistenceTreeTest : ::testing::Test {
@@ -162,6 +162,34 @@ TEST_F(InodeTableTest, setDefault) {
   EXPECT_EQ(14, inodeTable->setDefault(1_ino, 16));
 }
 
+TEST_F(InodeTableTest, compact_removes_unkept_inodes) {
+  {
+    auto inodeTable = InodeTable<Int>::open(tablePath);
+    for (int i = 1; i <= 10; ++i) {
+      inodeTable->set(InodeNumber(i), 100 + i);
+    }
+    EXPECT_EQ(5, inodeTable->compact([](InodeNumber ino) {
+      return ino.get() % 2 == 0;
+    }));
+
+    EXPECT_EQ(102, inodeTable->getOrThrow(2_ino));
+    EXPECT_EQ(110, inodeTable->getOrThrow(10_ino));
+    EXPECT_FALSE(inodeTable->getOptional(3_ino).has_value());
+
+    // The compacted table can still be modified.
+    inodeTable->set(11_ino, 111);
+    inodeTable->freeInode(2_ino);
+    EXPECT_EQ(110, inodeTable->getOrThrow(10_ino));
+  }
+
+  auto inodeTable = InodeTable<Int>::open(tablePath);
+  EXPECT_FALSE(inodeTable->getOptional(1_ino).has_value());
+  EXPECT_FALSE(inodeTable->getOptional(2_ino).has_value());
+  EXPECT_EQ(104, inodeTable->getOrThrow(4_ino));
+  EXPECT_EQ(110, inodeTable->getOrThrow(10_ino));
+  EXPECT_EQ(111, inodeTable->getOrThrow(11_ino));
+}
+
 // TEST(INodeTable, set) {}
 // TEST(INodeTable, getOrThrow) {}
 // TEST(INodeTable, getOptional) {}
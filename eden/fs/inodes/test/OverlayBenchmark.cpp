@@ -5,74 +5,346 @@
  * GNU General Public License version 2.
  */
 
+#include <folly/Benchmark.h>
 #include <folly/init/Init.h>
 #include <folly/stop_watch.h>
 #include <gflags/gflags.h>
 #include <stdlib.h>
+#include <algorithm>
 #include "eden/fs/inodes/DirEntry.h"
+#include "eden/fs/inodes/InodeTable.h"
 #include "eden/fs/inodes/Overlay.h"
+#include "eden/fs/inodes/overlay/FsOverlay.h"
+#include "eden/fs/inodes/overlay/OverlayChecker.h"
 
 using namespace facebook::eden;
 using namespace folly::string_piece_literals;
+using namespace std::chrono_literals;
 
-DEFINE_string(overlayPath, "", "Directory where the test overlay is created");
+DEFINE_string(overlayPath, "", "Directory where the test overlays are created");
+DEFINE_string(
+    overlayType,
+    "all",
+    "Overlay backend to benchmark: filesystem, sqlite or all");
+DEFINE_int64(
+    dirSaveDelayMs,
+    0,
+    "If nonzero, also benchmark directory saves delayed by this long");
+DEFINE_uint64(smallDirs, 500000, "Number of small directories to save");
+DEFINE_uint64(hugeDirs, 20, "Number of huge directories to save");
+DEFINE_uint64(hugeDirEntries, 100000, "Number of entries in a huge directory");
+DEFINE_uint64(fileWrites, 100000, "Number of materialized files to write");
+DEFINE_uint64(fileWriteSize, 4096, "Size of each materialized file write");
+DEFINE_uint64(
+    metadataInodes,
+    1000000,
+    "Number of inodes in the metadata table loaded at startup");
+DEFINE_uint64(startupRuns, 10, "Number of times to open each overlay");
+DEFINE_uint64(
+    checkerInodes,
+    1000000,
+    "Number of inodes in the overlay scanned by OverlayChecker");
 
 namespace {
 
-void benchmarkOverlayTreeWrites(AbsolutePathPiece overlayPath) {
-  // A large mount will contain 500,000 trees. If they're all loaded, they
-  // will all be written into the overlay. This benchmark simulates that
-  // workload and measures how long it takes.
-  //
-  // overlayPath is parameterized to measure on different filesystem types.
+const Hash kFileHash{folly::ByteRange{"abcdabcdabcdabcdabcd"_sp}};
+const Hash kDirHash{folly::ByteRange{"01234012340123401234"_sp}};
 
-  auto overlay = Overlay::create(overlayPath);
-  overlay->initialize().get();
+/**
+ * The latency of each call made by one benchmark.
+ *
+ * Each call is timed on its own so that the tail latency is visible, which
+ * the average alone hides when, for example, a delayed save or a btree
+ * update in the filesystem makes some calls much slower than the rest.
+ */
+class Samples {
+ public:
+  explicit Samples(uint64_t count) {
+    latencies_.reserve(count);
+  }
+
+  template <typename Fn>
+  void measure(Fn&& fn) {
+    folly::stop_watch<std::chrono::nanoseconds> timer;
+    fn();
+    latencies_.push_back(timer.elapsed());
+  }
 
-  Hash hash1{folly::ByteRange{"abcdabcdabcdabcdabcd"_sp}};
-  Hash hash2{folly::ByteRange{"01234012340123401234"_sp}};
+  /**
+   * Print the throughput and latency percentiles.  total is the time taken
+   * by the whole benchmark, including any work that is not part of one
+   * call, such as flushing delayed saves.
+   */
+  void report(const std::string& name, std::chrono::nanoseconds total) {
+    if (latencies_.empty()) {
+      return;
+    }
+    std::sort(latencies_.begin(), latencies_.end());
+    auto seconds = std::chrono::duration<double>(total).count();
+    printf(
+        "%-48s %12.0f ops/s  p50 %10.2f us  p99 %10.2f us\n",
+        name.c_str(),
+        latencies_.size() / seconds,
+        toMicros(percentile(0.50)),
+        toMicros(percentile(0.99)));
+  }
+
+ private:
+  std::chrono::nanoseconds percentile(double p) const {
+    auto index = static_cast<size_t>(p * (latencies_.size() - 1));
+    return latencies_[index];
+  }
+
+  static double toMicros(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  }
+
+  std::vector<std::chrono::nanoseconds> latencies_;
+};
 
+folly::StringPiece overlayTypeName(OverlayType type) {
+  switch (type) {
+    case OverlayType::Filesystem:
+      return "filesystem";
+    case OverlayType::Sqlite:
+      return "sqlite";
+  }
+  return "unknown";
+}
+
+/**
+ * Returns a new directory for one benchmark of one overlay type under
+ * --overlayPath, so that every benchmark starts from an empty overlay.
+ */
+AbsolutePath makeBenchmarkDir(
+    AbsolutePathPiece overlayPath,
+    OverlayType type,
+    folly::StringPiece name) {
+  auto path = overlayPath + PathComponent{overlayTypeName(type)} +
+      PathComponent{name};
+  removeRecursively(path);
+  ensureDirectoryExists(path);
+  return path;
+}
+
+std::shared_ptr<Overlay> openOverlay(
+    AbsolutePathPiece path,
+    OverlayType type,
+    std::chrono::nanoseconds dirSaveDelay = 0ns) {
+  auto overlay = Overlay::create(path, dirSaveDelay, type);
+  overlay->initialize().get();
+  return overlay;
+}
+
+/**
+ * Returns a directory with numEntries children, alternating between files
+ * and directories that are unchanged from source control.
+ */
+DirContents makeDirContents(Overlay& overlay, uint64_t numEntries) {
   DirContents contents;
-  contents.emplace(
-      PathComponent{"one"},
-      S_IFREG | 0644,
-      overlay->allocateInodeNumber(),
-      hash1);
-  contents.emplace(
-      PathComponent{"two"},
-      S_IFDIR | 0755,
-      overlay->allocateInodeNumber(),
-      hash2);
-
-  uint64_t N = 500000;
-
-  folly::stop_watch<> timer;
-
-  for (uint64_t i = 1; i <= N; i++) {
+  for (uint64_t i = 0; i < numEntries; ++i) {
+    auto isFile = i % 2 == 0;
+    contents.emplace(
+        PathComponent{folly::to<std::string>("entry", i)},
+        isFile ? S_IFREG | 0644 : S_IFDIR | 0755,
+        overlay.allocateInodeNumber(),
+        isFile ? kFileHash : kDirHash);
+  }
+  return contents;
+}
+
+void benchmarkDirs(
+    AbsolutePathPiece overlayPath,
+    OverlayType type,
+    std::chrono::nanoseconds dirSaveDelay,
+    folly::StringPiece size,
+    uint64_t numDirs,
+    uint64_t entriesPerDir) {
+  auto label = folly::to<std::string>(overlayTypeName(type), " ");
+  if (dirSaveDelay > 0ns) {
+    label += folly::to<std::string>(
+        "delay=",
+        std::chrono::duration_cast<std::chrono::milliseconds>(dirSaveDelay)
+            .count(),
+        "ms ");
+  }
+
+  auto overlay = openOverlay(
+      makeBenchmarkDir(
+          overlayPath, type, folly::to<std::string>(size, "-dirs")),
+      type,
+      dirSaveDelay);
+  auto contents = makeDirContents(*overlay, entriesPerDir);
+
+  std::vector<InodeNumber> inodes;
+  inodes.reserve(numDirs);
+  Samples saves{numDirs};
+  folly::stop_watch<std::chrono::nanoseconds> timer;
+  for (uint64_t i = 0; i < numDirs; ++i) {
     auto ino = overlay->allocateInodeNumber();
-    overlay->saveOverlayDir(ino, contents);
+    inodes.push_back(ino);
+    saves.measure([&] { overlay->saveOverlayDir(ino, contents); });
   }
+  // Delayed saves only count once they reach the disk.
+  overlay->flushPendingAsync().get();
+  saves.report(label + "saveOverlayDir " + size.str(), timer.elapsed());
 
-  auto elapsed = timer.elapsed();
+  Samples loads{numDirs};
+  timer.reset();
+  for (auto ino : inodes) {
+    loads.measure(
+        [&] { folly::doNotOptimizeAway(overlay->loadOverlayDir(ino)); });
+  }
+  loads.report(label + "loadOverlayDir " + size.str(), timer.elapsed());
 
-  printf(
-      "Total elapsed time for %" SCNu64 " entries: %.2f s\n",
-      N,
-      std::chrono::duration_cast<std::chrono::duration<double>>(elapsed)
-          .count());
+  overlay->close();
+}
 
-  // Normally, I prefer to use minimum, but the cost of writing into the
-  // overlay increases as the overlay grows, as xfs especially updates its
-  // btrees.
-  //
-  // That reason, plus the reason that we want a fixed N for comparable results
-  // is why this benchmark doesn't use folly Benchmark.
-  printf(
-      "Average time per call: %.2f us\n",
-      static_cast<double>(
-          std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(
-              elapsed / N)
-              .count()));
+void benchmarkFileWrites(AbsolutePathPiece overlayPath, OverlayType type) {
+  // Materialized files are stored one per file in both overlay types.  The
+  // writes match what OverlayFileAccess does for a FileInode: create the
+  // overlay file with the blob's contents, then write past the header.
+  auto overlay = openOverlay(
+      makeBenchmarkDir(overlayPath, type, "file-writes"_sp), type);
+  std::string data(FLAGS_fileWriteSize, 'x');
+  auto label = overlayTypeName(type).str();
+
+  std::vector<OverlayFile> files;
+  files.reserve(FLAGS_fileWrites);
+  Samples creates{FLAGS_fileWrites};
+  folly::stop_watch<std::chrono::nanoseconds> timer;
+  for (uint64_t i = 0; i < FLAGS_fileWrites; ++i) {
+    auto ino = overlay->allocateInodeNumber();
+    creates.measure([&] {
+      files.push_back(overlay->createOverlayFile(
+          ino, folly::ByteRange{folly::StringPiece{data}}));
+    });
+  }
+  creates.report(label + " createOverlayFile", timer.elapsed());
+
+  Samples writes{FLAGS_fileWrites};
+  timer.reset();
+  for (auto& file : files) {
+    writes.measure([&] {
+      iovec iov{data.data(), data.size()};
+      auto result = file.pwritev(&iov, 1, FsOverlay::kHeaderLength);
+      if (result.hasError()) {
+        folly::throwSystemErrorExplicit(result.error(), "pwritev failed");
+      }
+    });
+  }
+  writes.report(label + " file write", timer.elapsed());
+
+  files.clear();
+  overlay->close();
+}
+
+void benchmarkStartup(AbsolutePathPiece overlayPath, OverlayType type) {
+  // Opening an overlay maps its InodeMetadataTable, which grows with every
+  // inode that has ever been loaded in the mount.
+  auto path = makeBenchmarkDir(overlayPath, type, "startup"_sp);
+  {
+    auto overlay = openOverlay(path, type);
+    auto* metadataTable = overlay->getInodeMetadataTable();
+    for (uint64_t i = 0; i < FLAGS_metadataInodes; ++i) {
+      metadataTable->set(
+          overlay->allocateInodeNumber(),
+          InodeMetadata{S_IFREG | 0644, 0, 0, InodeTimestamps{}});
+    }
+    overlay->close();
+  }
+
+  Samples opens{FLAGS_startupRuns};
+  folly::stop_watch<std::chrono::nanoseconds> timer;
+  for (uint64_t i = 0; i < FLAGS_startupRuns; ++i) {
+    std::shared_ptr<Overlay> overlay;
+    opens.measure([&] { overlay = openOverlay(path, type); });
+    overlay->close();
+  }
+  opens.report(
+      folly::to<std::string>(
+          overlayTypeName(type),
+          " initialize with ",
+          FLAGS_metadataInodes,
+          " inodes"),
+      timer.elapsed());
+}
+
+void benchmarkChecker(AbsolutePathPiece overlayPath) {
+  // OverlayChecker only runs on the file system overlay, after an unclean
+  // shutdown, and it reads every directory and file in the overlay.
+  constexpr uint64_t kFilesPerDir = 100;
+  auto path =
+      makeBenchmarkDir(overlayPath, OverlayType::Filesystem, "checker"_sp);
+  {
+    auto overlay = openOverlay(path, OverlayType::Filesystem);
+    DirContents root;
+    auto numDirs = std::max<uint64_t>(FLAGS_checkerInodes / kFilesPerDir, 1);
+    for (uint64_t i = 0; i < numDirs; ++i) {
+      DirContents dir;
+      for (uint64_t j = 0; j < kFilesPerDir; ++j) {
+        auto fileIno = overlay->allocateInodeNumber();
+        overlay->createOverlayFile(fileIno, folly::ByteRange{});
+        dir.emplace(
+            PathComponent{folly::to<std::string>("file", j)},
+            S_IFREG | 0644,
+            fileIno);
+      }
+      auto dirIno = overlay->allocateInodeNumber();
+      overlay->saveOverlayDir(dirIno, dir);
+      root.emplace(
+          PathComponent{folly::to<std::string>("dir", i)},
+          S_IFDIR | 0755,
+          dirIno);
+    }
+    overlay->saveOverlayDir(kRootNodeId, root);
+    overlay->close();
+  }
+
+  FsOverlay fsOverlay{path};
+  auto nextInodeNumber = fsOverlay.initOverlay(/*createIfNonExisting=*/false);
+  Samples scans{1};
+  folly::stop_watch<std::chrono::nanoseconds> timer;
+  OverlayChecker checker{&fsOverlay, nextInodeNumber};
+  scans.measure([&] { checker.scanForErrors(); });
+  scans.report(
+      folly::to<std::string>(
+          "filesystem OverlayChecker scan of ", FLAGS_checkerInodes, " inodes"),
+      timer.elapsed());
+  if (!checker.getErrors().empty()) {
+    fprintf(
+        stderr,
+        "warning: OverlayChecker found %zu errors\n",
+        checker.getErrors().size());
+  }
+  fsOverlay.close(checker.getNextInodeNumber());
+}
+
+void benchmarkOverlay(AbsolutePathPiece overlayPath, OverlayType type) {
+  benchmarkDirs(overlayPath, type, 0ns, "small"_sp, FLAGS_smallDirs, 2);
+  benchmarkDirs(
+      overlayPath,
+      type,
+      0ns,
+      "huge"_sp,
+      FLAGS_hugeDirs,
+      FLAGS_hugeDirEntries);
+  if (FLAGS_dirSaveDelayMs > 0) {
+    std::chrono::milliseconds delay{FLAGS_dirSaveDelayMs};
+    benchmarkDirs(overlayPath, type, delay, "small"_sp, FLAGS_smallDirs, 2);
+    benchmarkDirs(
+        overlayPath,
+        type,
+        delay,
+        "huge"_sp,
+        FLAGS_hugeDirs,
+        FLAGS_hugeDirEntries);
+  }
+  benchmarkFileWrites(overlayPath, type);
+  benchmarkStartup(overlayPath, type);
+  if (type == OverlayType::Filesystem) {
+    benchmarkChecker(overlayPath);
+  }
 }
 
 } // namespace
@@ -85,8 +357,30 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  std::vector<OverlayType> types;
+  if (FLAGS_overlayType == "all" || FLAGS_overlayType == "filesystem") {
+    types.push_back(OverlayType::Filesystem);
+  }
+  if (FLAGS_overlayType == "all" || FLAGS_overlayType == "sqlite") {
+    types.push_back(OverlayType::Sqlite);
+  }
+  if (types.empty()) {
+    fprintf(
+        stderr,
+        "error: unknown overlayType %s\n",
+        FLAGS_overlayType.c_str());
+    return 1;
+  }
+
+  // Overlay costs grow as the overlay does, xfs especially updates its
+  // btrees, so every benchmark uses a fixed N for comparable results rather
+  // than folly Benchmark's adaptive iteration counts.
+  //
+  // overlayPath is parameterized to measure on different filesystem types.
   auto overlayPath = normalizeBestEffort(FLAGS_overlayPath.c_str());
-  benchmarkOverlayTreeWrites(overlayPath);
+  for (auto type : types) {
+    benchmarkOverlay(overlayPath, type);
+  }
 
   return 0;
 }
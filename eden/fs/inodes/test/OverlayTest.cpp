@@ -291,6 +291,153 @@ TEST(PlainOverlayTest, unclean_overlay_is_dirty) {
   EXPECT_FALSE(overlay->hadCleanStartup());
 }
 
+namespace {
+bool overlayFileExists(AbsolutePathPiece localDir, InodeNumber inodeNumber) {
+  auto path = localDir + FsOverlay::getFilePath(inodeNumber);
+  return access(path.c_str(), F_OK) == 0;
+}
+} // namespace
+
+TEST(PlainOverlayTest, delayed_dir_saves_are_coalesced_until_flush) {
+  folly::test::TemporaryDirectory testDir;
+  auto localDir = AbsolutePath{testDir.path().string()};
+  auto overlay = Overlay::create(localDir, std::chrono::hours{1});
+  overlay->initialize().get();
+
+  auto ino = overlay->allocateInodeNumber();
+  auto child1 = overlay->allocateInodeNumber();
+  auto child2 = overlay->allocateInodeNumber();
+
+  DirContents dir;
+  dir.emplace("one"_pc, S_IFREG | 0644, child1);
+  overlay->saveOverlayDir(ino, dir);
+  dir.emplace("two"_pc, S_IFREG | 0644, child2);
+  overlay->saveOverlayDir(ino, dir);
+
+  // The saves are only pending, but reads see the latest one.
+  EXPECT_FALSE(overlayFileExists(localDir, ino));
+  EXPECT_TRUE(overlay->hasOverlayData(ino));
+  auto loaded = overlay->loadOverlayDir(ino);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(2, loaded->size());
+
+  overlay->flushPendingAsync().get();
+  EXPECT_TRUE(overlayFileExists(localDir, ino));
+
+  overlay->close();
+  overlay = Overlay::create(localDir);
+  overlay->initialize().get();
+  loaded = overlay->loadOverlayDir(ino);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(2, loaded->size());
+}
+
+TEST(PlainOverlayTest, delayed_dir_saves_are_written_on_close) {
+  folly::test::TemporaryDirectory testDir;
+  auto localDir = AbsolutePath{testDir.path().string()};
+  auto overlay = Overlay::create(localDir, std::chrono::hours{1});
+  overlay->initialize().get();
+
+  auto ino = overlay->allocateInodeNumber();
+  auto removedIno = overlay->allocateInodeNumber();
+  auto child = overlay->allocateInodeNumber();
+
+  DirContents dir;
+  dir.emplace("child"_pc, S_IFREG | 0644, child);
+  overlay->saveOverlayDir(ino, dir);
+  overlay->saveOverlayDir(removedIno, dir);
+
+  // Removing a directory drops its pending save.
+  overlay->removeOverlayData(removedIno);
+  EXPECT_FALSE(overlay->hasOverlayData(removedIno));
+
+  overlay->close();
+  EXPECT_TRUE(overlayFileExists(localDir, ino));
+  EXPECT_FALSE(overlayFileExists(localDir, removedIno));
+
+  overlay = Overlay::create(localDir);
+  overlay->initialize().get();
+  EXPECT_TRUE(overlay->hadCleanStartup());
+  auto loaded = overlay->loadOverlayDir(ino);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(1, loaded->count("child"_pc));
+}
+
+TEST(PlainOverlayTest, sqlite_dirs_are_migrated_both_ways) {
+  folly::test::TemporaryDirectory testDir;
+  auto localDir = AbsolutePath{testDir.path().string()};
+  auto overlay = Overlay::create(localDir);
+  overlay->initialize().get();
+
+  auto subdirIno = overlay->allocateInodeNumber();
+  auto fileIno = overlay->allocateInodeNumber();
+  DirContents root;
+  root.emplace("subdir"_pc, S_IFDIR | 0755, subdirIno);
+  overlay->saveOverlayDir(kRootNodeId, root);
+  DirContents subdir;
+  subdir.emplace("file"_pc, S_IFREG | 0644, fileIno);
+  overlay->saveOverlayDir(subdirIno, subdir);
+  overlay->close();
+
+  // Switching to SQLite moves the directories into the database.
+  overlay = Overlay::create(
+      localDir, std::chrono::nanoseconds::zero(), OverlayType::Sqlite);
+  overlay->initialize().get();
+  EXPECT_TRUE(overlay->hadCleanStartup());
+  EXPECT_FALSE(overlayFileExists(localDir, kRootNodeId));
+  EXPECT_FALSE(overlayFileExists(localDir, subdirIno));
+  auto loaded = overlay->loadOverlayDir(subdirIno);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(1, loaded->count("file"_pc));
+
+  // New directories go to the database too.
+  auto newdirIno = overlay->allocateInodeNumber();
+  root.emplace("newdir"_pc, S_IFDIR | 0755, newdirIno);
+  overlay->saveOverlayDir(kRootNodeId, root);
+  overlay->saveOverlayDir(newdirIno, DirContents{});
+  EXPECT_FALSE(overlayFileExists(localDir, newdirIno));
+  EXPECT_TRUE(overlay->hasOverlayData(newdirIno));
+  overlay->close();
+
+  // Switching back moves them out and removes the database.
+  overlay = Overlay::create(localDir);
+  overlay->initialize().get();
+  EXPECT_FALSE(SqliteOverlay::exists(localDir));
+  EXPECT_TRUE(overlayFileExists(localDir, kRootNodeId));
+  EXPECT_TRUE(overlayFileExists(localDir, subdirIno));
+  EXPECT_TRUE(overlayFileExists(localDir, newdirIno));
+  loaded = overlay->loadOverlayDir(kRootNodeId);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(2, loaded->size());
+  EXPECT_LT(newdirIno, overlay->allocateInodeNumber());
+}
+
+TEST(PlainOverlayTest, sqlite_dirs_batch_delayed_saves) {
+  folly::test::TemporaryDirectory testDir;
+  auto localDir = AbsolutePath{testDir.path().string()};
+  auto overlay =
+      Overlay::create(localDir, std::chrono::hours{1}, OverlayType::Sqlite);
+  overlay->initialize().get();
+
+  std::vector<InodeNumber> inodes;
+  for (int i = 0; i < 10; ++i) {
+    auto ino = overlay->allocateInodeNumber();
+    inodes.push_back(ino);
+    overlay->saveOverlayDir(ino, DirContents{});
+  }
+  overlay->flushPendingAsync().get();
+  overlay->removeOverlayData(inodes[0]);
+  overlay->close();
+
+  overlay = Overlay::create(
+      localDir, std::chrono::nanoseconds::zero(), OverlayType::Sqlite);
+  overlay->initialize().get();
+  EXPECT_FALSE(overlay->hasOverlayData(inodes[0]));
+  for (size_t i = 1; i < inodes.size(); ++i) {
+    EXPECT_TRUE(overlay->loadOverlayDir(inodes[i])) << inodes[i];
+  }
+}
+
 enum class OverlayRestartMode {
   CLEAN,
   UNCLEAN,
@@ -496,6 +643,16 @@ TEST_P(RawOverlayTest, max_inode_number_is_1_if_overlay_is_empty) {
   EXPECT_EQ(2_ino, overlay->allocateInodeNumber());
 }
 
+TEST_P(RawOverlayTest, allocates_consecutive_inode_numbers_in_a_range) {
+  EXPECT_EQ(2_ino, overlay->allocateInodeNumbers(3));
+  EXPECT_EQ(5_ino, overlay->allocateInodeNumber());
+
+  recreate(OverlayRestartMode::CLEAN);
+
+  EXPECT_EQ(5_ino, overlay->getMaxInodeNumber());
+  EXPECT_EQ(6_ino, overlay->allocateInodeNumbers(2));
+}
+
 TEST_P(RawOverlayTest, remembers_max_inode_number_of_tree_inodes) {
   auto ino2 = overlay->allocateInodeNumber();
   EXPECT_EQ(2_ino, ino2);
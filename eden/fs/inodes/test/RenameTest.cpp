@@ -187,6 +187,29 @@ TEST_F(RenameTest, renameFileToSamePath) {
   EXPECT_EQ(path, origFile->getPath().value());
 }
 
+TEST_F(RenameTest, replaceFileSameDirectoryWithSharedRenameLockHeld) {
+  auto origSrc = mount_->getFileInode("a/b/c/doc.txt");
+  auto origDest = mount_->getFileInode("a/b/c/readme.txt");
+  auto dir = mount_->getTreeInode("a/b/c");
+
+  // Renames within one directory only need the rename lock in shared mode,
+  // so this would block forever if it tried to take it exclusively.
+  auto renameLock = mount_->getEdenMount()->acquireSharedRenameLock();
+  auto renameFuture = dir->rename(
+      PathComponentPiece{"doc.txt"},
+      dir,
+      PathComponentPiece{"readme.txt"},
+      InvalidationRequired::No);
+  ASSERT_TRUE(renameFuture.isReady());
+  std::move(renameFuture).get();
+  renameLock.unlock();
+
+  EXPECT_EQ(RelativePath{"a/b/c/readme.txt"}, origSrc->getPath().value());
+  EXPECT_TRUE(origDest->isUnlinked());
+  EXPECT_EQ(origSrc.get(), mount_->getFileInode("a/b/c/readme.txt").get());
+  EXPECT_THROW_ERRNO(mount_->getFileInode("a/b/c/doc.txt"), ENOENT);
+}
+
 /*
  * Basic tests for renaming directories
  */
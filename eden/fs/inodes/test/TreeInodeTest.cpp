@@ -21,6 +21,7 @@
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/service/gen-cpp2/eden_types.h"
 #include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/testharness/FakeTreeBuilder.h"
 #include "eden/fs/testharness/TestChecks.h"
@@ -90,9 +91,9 @@ TEST(TreeInode, readdirTest) {
   auto root = mount.getEdenMount()->getRootInode();
   auto result = root->readdir().get(0ms);
 
-  ASSERT_EQ(2, result.size());
-  EXPECT_EQ(L".eden", result[0].name);
-  EXPECT_EQ(L"file", result[1].name);
+  ASSERT_EQ(2, result->size());
+  EXPECT_EQ(L".eden", (*result)[0].name);
+  EXPECT_EQ(L"file", (*result)[1].name);
 }
 
 TEST(TreeInode, updateAndReaddir) {
@@ -106,36 +107,54 @@ TEST(TreeInode, updateAndReaddir) {
   auto somedir = mount.getTreeInode("somedir"_relpath);
   auto result = somedir->readdir().get(0ms);
 
-  ASSERT_EQ(3, result.size());
-  EXPECT_EQ(L"file1", result[0].name);
-  EXPECT_EQ(L"file2", result[1].name);
-  EXPECT_EQ(L"file3", result[2].name);
+  ASSERT_EQ(3, result->size());
+  EXPECT_EQ(L"file1", (*result)[0].name);
+  EXPECT_EQ(L"file2", (*result)[1].name);
+  EXPECT_EQ(L"file3", (*result)[2].name);
 
   auto resultInode =
       somedir->mknod("newfile.txt"_pc, S_IFREG, 0, InvalidationRequired::No);
   result = somedir->readdir().get(0ms);
-  ASSERT_EQ(4, result.size());
-  EXPECT_EQ(L"file1", result[0].name);
-  EXPECT_EQ(L"file2", result[1].name);
-  EXPECT_EQ(L"file3", result[2].name);
-  EXPECT_EQ(L"newfile.txt", result[3].name);
+  ASSERT_EQ(4, result->size());
+  EXPECT_EQ(L"file1", (*result)[0].name);
+  EXPECT_EQ(L"file2", (*result)[1].name);
+  EXPECT_EQ(L"file3", (*result)[2].name);
+  EXPECT_EQ(L"newfile.txt", (*result)[3].name);
 
   somedir->unlink("file2"_pc, InvalidationRequired::No).get(0ms);
   result = somedir->readdir().get(0ms);
-  ASSERT_EQ(3, result.size());
-  EXPECT_EQ(L"file1", result[0].name);
-  EXPECT_EQ(L"file3", result[1].name);
-  EXPECT_EQ(L"newfile.txt", result[2].name);
+  ASSERT_EQ(3, result->size());
+  EXPECT_EQ(L"file1", (*result)[0].name);
+  EXPECT_EQ(L"file3", (*result)[1].name);
+  EXPECT_EQ(L"newfile.txt", (*result)[2].name);
 
   somedir
       ->rename(
           "file3"_pc, somedir, "renamedfile.txt"_pc, InvalidationRequired::No)
       .get(0ms);
   result = somedir->readdir().get(0ms);
-  ASSERT_EQ(3, result.size());
-  EXPECT_EQ(L"file1", result[0].name);
-  EXPECT_EQ(L"newfile.txt", result[1].name);
-  EXPECT_EQ(L"renamedfile.txt", result[2].name);
+  ASSERT_EQ(3, result->size());
+  EXPECT_EQ(L"file1", (*result)[0].name);
+  EXPECT_EQ(L"newfile.txt", (*result)[1].name);
+  EXPECT_EQ(L"renamedfile.txt", (*result)[2].name);
+}
+
+TEST(TreeInode, readdirSharesListUntilContentsChange) {
+  FakeTreeBuilder builder;
+  builder.setFile("somedir/file1", "test\n");
+  TestMount mount{builder};
+
+  auto somedir = mount.getTreeInode("somedir"_relpath);
+  auto first = somedir->readdir().get(0ms);
+  auto second = somedir->readdir().get(0ms);
+  EXPECT_EQ(first, second);
+
+  somedir->mknod("file2"_pc, S_IFREG, 0, InvalidationRequired::No);
+  auto third = somedir->readdir().get(0ms);
+  EXPECT_NE(first, third);
+  ASSERT_EQ(2, third->size());
+  EXPECT_EQ(L"file2", (*third)[1].name);
+  EXPECT_EQ(third, somedir->readdir().get(0ms));
 }
 #else
 TEST(TreeInode, readdirReturnsSelfAndParentBeforeEntries) {
@@ -227,6 +246,44 @@ TEST(TreeInode, readdirRespectsOffset) {
   EXPECT_EQ(0, resultE.size());
 }
 
+TEST(TreeInode, readdirStartsNewStreamsWithCurrentEntries) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a", ""}, {"b", ""}, {"c", ""}});
+  TestMount mount{builder};
+
+  auto root = mount.getEdenMount()->getRootInode();
+
+  // Leave a stream unfinished, so that its index is kept around.  Each entry
+  // takes 32 bytes.
+  const auto partial =
+      root->readdir(DirList{3 * 32}, 0, ObjectFetchContext::getNullContext())
+          .extract();
+  ASSERT_EQ(3, partial.size());
+  root->symlink("d"_pc, "target", InvalidationRequired::No);
+  root->unlink("b"_pc, InvalidationRequired::No).get(0ms);
+
+  // The unfinished stream skips the removed entry.
+  std::vector<std::string> rest;
+  for (const auto& entry : root->readdir(
+                                    DirList{4096},
+                                    partial[2].offset,
+                                    ObjectFetchContext::getNullContext())
+                               .extract()) {
+    rest.push_back(entry.name);
+  }
+  EXPECT_EQ(rest.end(), std::find(rest.begin(), rest.end(), "b"));
+
+  // A new stream sees the new entry.
+  std::vector<std::string> names;
+  for (const auto& entry :
+       root->readdir(DirList{4096}, 0, ObjectFetchContext::getNullContext())
+           .extract()) {
+    names.push_back(entry.name);
+  }
+  EXPECT_NE(names.end(), std::find(names.begin(), names.end(), "d"));
+  EXPECT_EQ(names.end(), std::find(names.begin(), names.end(), "b"));
+}
+
 TEST(TreeInode, readdirIgnoresWildOffsets) {
   TestMount mount{FakeTreeBuilder{}};
 
@@ -408,3 +465,168 @@ TEST(TreeInode, createOverlayWriteError) {
       ENOSPC);
 }
 #endif
+
+namespace {
+std::vector<std::string> debugStatusPaths(
+    const std::vector<TreeInodeDebugInfo>& results) {
+  std::vector<std::string> paths;
+  for (const auto& info : results) {
+    paths.push_back(*info.path_ref());
+  }
+  return paths;
+}
+} // namespace
+
+TEST(TreeInode, getDebugStatusReportsParentsFirst) {
+  FakeTreeBuilder builder;
+  builder.setFile("a/b/file.txt", "a\n");
+  builder.setFile("c/file.txt", "c\n");
+  TestMount mount{builder};
+  mount.loadAllInodes();
+
+  std::vector<TreeInodeDebugInfo> results;
+  mount.getEdenMount()->getRootInode()->getDebugStatus(results);
+  EXPECT_EQ(
+      (std::vector<std::string>{"", "a", "a/b", "c"}),
+      debugStatusPaths(results));
+}
+
+TEST(TreeInode, getDebugStatusResumesInPages) {
+  FakeTreeBuilder builder;
+  builder.setFile("a/b/file.txt", "a\n");
+  builder.setFile("c/file.txt", "c\n");
+  TestMount mount{builder};
+  mount.loadAllInodes();
+  auto root = mount.getEdenMount()->getRootInode();
+
+  TreeInode::DebugStatusOptions options;
+  options.maxResults = 2;
+  options.fileSizes = false;
+  std::vector<TreeInodeDebugInfo> first;
+  auto next = root->getDebugStatus(first, options);
+  EXPECT_EQ((std::vector<std::string>{"", "a"}), debugStatusPaths(first));
+  ASSERT_TRUE(next.has_value());
+  EXPECT_EQ("a"_relpath, *next);
+
+  options.startAfter = next;
+  std::vector<TreeInodeDebugInfo> second;
+  next = root->getDebugStatus(second, options);
+  EXPECT_EQ((std::vector<std::string>{"a/b", "c"}), debugStatusPaths(second));
+  EXPECT_FALSE(next.has_value());
+}
+
+TEST(TreeInode, getDebugStatusFilters) {
+  FakeTreeBuilder builder;
+  builder.setFile("a/b/file.txt", "a\n");
+  builder.setFile("c/file.txt", "c\n");
+  TestMount mount{builder};
+  mount.loadAllInodes();
+  mount.addFile("c/new.txt", "new\n");
+  auto root = mount.getEdenMount()->getRootInode();
+
+  TreeInode::DebugStatusOptions materialized;
+  materialized.materializedOnly = true;
+  std::vector<TreeInodeDebugInfo> results;
+  root->getDebugStatus(results, materialized);
+  EXPECT_EQ((std::vector<std::string>{"", "c"}), debugStatusPaths(results));
+
+  TreeInode::DebugStatusOptions shallow;
+  shallow.maxDepth = 1;
+  results.clear();
+  root->getDebugStatus(results, shallow);
+  EXPECT_EQ(
+      (std::vector<std::string>{"", "a", "c"}), debugStatusPaths(results));
+}
+
+#ifndef _WIN32
+TEST(TreeInode, statUnloadedChildForLookupDoesNotLoadTheChild) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/file", "contents"}});
+  TestMount mount{builder};
+  auto& context = ObjectFetchContext::getNullContext();
+
+  auto dir = mount.getTreeInode("dir");
+  auto child = dir->statUnloadedChildForLookup("file"_pc, context);
+  ASSERT_TRUE(child.has_value());
+  auto number = child->first;
+  auto result = std::move(child->second).get(0ms);
+  EXPECT_EQ(dir->getChildInodeNumber("file"_pc), number);
+  EXPECT_EQ(number.get(), result.st_ino);
+  EXPECT_EQ(8, result.st_size);
+  EXPECT_TRUE(S_ISREG(result.st_mode));
+
+  auto inodeMap = mount.getEdenMount()->getInodeMap();
+  EXPECT_FALSE(inodeMap->lookupLoadedInode(number));
+  EXPECT_TRUE(inodeMap->isInodeRemembered(number));
+
+  // The inode is loaded once something needs it, with the same attributes.
+  auto file = inodeMap->lookupInode(number).get(0ms);
+  auto loadedResult = file->stat(context).get(0ms);
+  EXPECT_EQ(result.st_size, loadedResult.st_size);
+  EXPECT_EQ(result.st_mode, loadedResult.st_mode);
+  EXPECT_EQ(result.st_mtime, loadedResult.st_mtime);
+
+  // Loaded children take the regular path.
+  EXPECT_FALSE(dir->statUnloadedChildForLookup("file"_pc, context));
+  file.reset();
+  inodeMap->decFuseRefcount(number);
+}
+#endif // !_WIN32
+
+TEST(TreeInode, removeRecursivelyDropsUnloadedSubtreesWithoutLoadingThem) {
+  FakeTreeBuilder builder;
+  builder.setFiles({
+      {"dir/a/file1", "1"},
+      {"dir/a/b/file2", "2"},
+      {"dir/c/file3", "3"},
+      {"other", "4"},
+  });
+  TestMount mount{builder};
+  auto root = mount.getEdenMount()->getRootInode();
+  auto inodeMap = mount.getEdenMount()->getInodeMap();
+  auto& journal = mount.getEdenMount()->getJournal();
+  auto countsBefore = inodeMap->getInodeCounts();
+  auto sequenceBefore = journal.getLatest()->sequenceID;
+
+  root->removeRecursively("dir"_pc, InvalidationRequired::No).get(0ms);
+
+  auto countsAfter = inodeMap->getInodeCounts();
+  EXPECT_EQ(countsBefore.treeCount, countsAfter.treeCount);
+  EXPECT_EQ(countsBefore.fileCount, countsAfter.fileCount);
+  EXPECT_EQ(sequenceBefore + 1, journal.getLatest()->sequenceID);
+  EXPECT_THROW_ERRNO(mount.getInode("dir"_relpath), ENOENT);
+  EXPECT_TRUE(mount.hasFileAt("other"));
+}
+
+TEST(TreeInode, removeRecursivelyRemovesLoadedAndModifiedEntries) {
+  FakeTreeBuilder builder;
+  builder.setFiles({
+      {"dir/a/file1", "1"},
+      {"dir/a/b/file2", "2"},
+      {"dir/c/file3", "3"},
+  });
+  TestMount mount{builder};
+  auto loadedFile = mount.getFileInode("dir/a/b/file2");
+  mount.addFile("dir/c/newfile", "new");
+  auto root = mount.getEdenMount()->getRootInode();
+
+  root->removeRecursively("dir"_pc, InvalidationRequired::No).get(0ms);
+
+  EXPECT_TRUE(loadedFile->isUnlinked());
+  EXPECT_THROW_ERRNO(mount.getInode("dir"_relpath), ENOENT);
+}
+
+TEST(TreeInode, removeRecursivelyRejectsFiles) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/file", "contents"}});
+  TestMount mount{builder};
+  auto dir = mount.getTreeInode("dir");
+
+  EXPECT_THROW_ERRNO(
+      dir->removeRecursively("file"_pc, InvalidationRequired::No).get(0ms),
+      ENOTDIR);
+  EXPECT_THROW_ERRNO(
+      dir->removeRecursively("missing"_pc, InvalidationRequired::No).get(0ms),
+      ENOENT);
+  EXPECT_TRUE(mount.hasFileAt("dir/file"));
+}
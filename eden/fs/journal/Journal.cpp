@@ -6,11 +6,164 @@
  */
 
 #include "Journal.h"
+#include <folly/ExceptionString.h>
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <iterator>
+#include <mutex>
 
 namespace facebook {
 namespace eden {
 
+namespace {
+/** The innermost FileChangeBatch created on this thread, of any journal. */
+thread_local Journal::FileChangeBatch* currentFileChangeBatch = nullptr;
+} // namespace
+
+Journal::FileChangeBatch::FileChangeBatch(Journal& journal)
+    : journal_{journal}, previous_{currentFileChangeBatch} {
+  // Changes held by an enclosing batch must be added before the ones this
+  // batch will hold.
+  if (auto* enclosing = journal.getCurrentBatch()) {
+    enclosing->flush();
+  }
+  currentFileChangeBatch = this;
+}
+
+Journal::FileChangeBatch::~FileChangeBatch() {
+  flush();
+  currentFileChangeBatch = previous_;
+}
+
+void Journal::FileChangeBatch::flush() {
+  if (!deltas_.empty()) {
+    journal_.addDeltas(std::move(deltas_));
+    deltas_.clear();
+  }
+}
+
+/**
+ * A subscriber registered with SubscriberOptions. It is shared with the
+ * notifications scheduled on its executor, so it may outlive both its
+ * registration and the Journal.
+ */
+class Journal::BatchedSubscriber
+    : public std::enable_shared_from_this<BatchedSubscriber> {
+ public:
+  BatchedSubscriber(
+      BatchedSubscriberCallback&& callback,
+      SubscriberOptions options)
+      : callback_{std::move(callback)}, options_{std::move(options)} {}
+
+  /** Record that the delta with sequence number latest was added, and make
+   * sure a notification that covers it is scheduled. */
+  void onChange(SequenceNumber latest);
+
+  void cancel() {
+    state_.wlock()->cancelled = true;
+  }
+
+ private:
+  struct State {
+    /** The range waiting to be notified, if any. */
+    std::optional<SequenceNumber> pendingFrom;
+    SequenceNumber pendingTo{0};
+    size_t pendingCount{0};
+    /** Whether a notification is scheduled for when minInterval passes. */
+    bool delayedScheduled{false};
+    /** Whether a notification is scheduled because of maxBatchSize. */
+    bool immediateScheduled{false};
+    std::optional<std::chrono::steady_clock::time_point> lastNotified;
+    bool cancelled{false};
+  };
+
+  void deliver(bool immediate);
+
+  BatchedSubscriberCallback callback_;
+  SubscriberOptions options_;
+  folly::Synchronized<State> state_;
+  /** Held while callback_ runs, so that notifications do not overlap. */
+  std::mutex callbackMutex_;
+};
+
+void Journal::BatchedSubscriber::onChange(SequenceNumber latest) {
+  bool scheduleImmediate = false;
+  std::optional<std::chrono::steady_clock::duration> delay;
+  {
+    auto state = state_.wlock();
+    if (state->cancelled) {
+      return;
+    }
+    if (!state->pendingFrom) {
+      state->pendingFrom = latest;
+    }
+    state->pendingTo = latest;
+    ++state->pendingCount;
+
+    if (options_.maxBatchSize > 0 &&
+        state->pendingCount >= options_.maxBatchSize &&
+        !state->immediateScheduled) {
+      state->immediateScheduled = true;
+      scheduleImmediate = true;
+    } else if (!state->delayedScheduled && !state->immediateScheduled) {
+      state->delayedScheduled = true;
+      delay = std::chrono::steady_clock::duration::zero();
+      if (state->lastNotified) {
+        delay = std::max(
+            *delay,
+            *state->lastNotified + options_.minInterval -
+                std::chrono::steady_clock::now());
+      }
+    }
+  }
+
+  if (scheduleImmediate) {
+    options_.executor->add(
+        [self = shared_from_this()] { self->deliver(true); });
+  }
+  if (delay) {
+    if (*delay == std::chrono::steady_clock::duration::zero()) {
+      options_.executor->add(
+          [self = shared_from_this()] { self->deliver(false); });
+    } else {
+      folly::futures::sleep(
+          std::chrono::duration_cast<folly::Duration>(*delay))
+          .via(options_.executor)
+          .thenValue([self = shared_from_this()](auto&&) {
+            self->deliver(false);
+          });
+    }
+  }
+}
+
+void Journal::BatchedSubscriber::deliver(bool immediate) {
+  std::lock_guard<std::mutex> guard{callbackMutex_};
+  SequenceNumber from;
+  SequenceNumber to;
+  {
+    auto state = state_.wlock();
+    if (immediate) {
+      state->immediateScheduled = false;
+    } else {
+      state->delayedScheduled = false;
+    }
+    if (state->cancelled || !state->pendingFrom) {
+      return;
+    }
+    from = *state->pendingFrom;
+    to = state->pendingTo;
+    state->pendingFrom.reset();
+    state->pendingCount = 0;
+    state->lastNotified = std::chrono::steady_clock::now();
+  }
+
+  try {
+    callback_(from, to);
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "journal subscriber failed: " << folly::exceptionStr(ex);
+  }
+}
+
 void Journal::recordCreated(RelativePathPiece fileName) {
   addDelta(FileChangeJournalDelta(fileName, FileChangeJournalDelta::CREATED));
 }
@@ -114,6 +267,17 @@ JournalDeltaPtr Journal::DeltaState::backPtr() noexcept {
   }
 }
 
+void Journal::internPaths(
+    FileChangeJournalDelta& delta,
+    DeltaState& deltaState) {
+  if (delta.isPath1Valid) {
+    delta.path1 = deltaState.paths.intern(std::move(delta.path1));
+  }
+  if (delta.isPath2Valid) {
+    delta.path2 = deltaState.paths.intern(std::move(delta.path2));
+  }
+}
+
 void Journal::truncateIfNecessary(DeltaState& deltaState) {
   while (JournalDeltaPtr front = deltaState.frontPtr()) {
     if (estimateMemoryUsage(deltaState) <= deltaState.memoryLimit) {
@@ -122,6 +286,10 @@ void Journal::truncateIfNecessary(DeltaState& deltaState) {
     deltaState.stats->entryCount--;
 
     deltaState.deltaMemoryUsage -= front.estimateMemoryUsage();
+    if (auto* fileChange = front.getAsFileChangeJournalDelta()) {
+      deltaState.paths.release(fileChange->path1);
+      deltaState.paths.release(fileChange->path2);
+    }
     deltaState.popFront();
   }
 }
@@ -148,6 +316,8 @@ template <typename T>
 void Journal::addDeltaWithoutNotifying(T&& delta, DeltaState& deltaState) {
   delta.sequenceID = deltaState.nextSequence++;
   delta.time = std::chrono::steady_clock::now();
+  internPaths(delta, deltaState);
+  summarizePaths(delta);
 
   truncateIfNecessary(deltaState);
 
@@ -178,22 +348,69 @@ void Journal::addDeltaWithoutNotifying(T&& delta, DeltaState& deltaState) {
   deltaState.stats->earliestTimestamp = deltaState.frontPtr()->time;
 }
 
-void Journal::notifySubscribers() const {
-  auto subscribers = subscriberState_.rlock()->subscribers;
+void Journal::notifySubscribers(SequenceNumber latest) const {
+  std::unordered_map<SubscriberId, SubscriberCallback> subscribers;
+  std::vector<std::shared_ptr<BatchedSubscriber>> batchedSubscribers;
+  {
+    auto subscriberState = subscriberState_.rlock();
+    subscribers = subscriberState->subscribers;
+    batchedSubscribers.reserve(subscriberState->batchedSubscribers.size());
+    for (auto& entry : subscriberState->batchedSubscribers) {
+      batchedSubscribers.push_back(entry.second);
+    }
+  }
   for (auto& sub : subscribers) {
     sub.second();
   }
+  for (auto& sub : batchedSubscribers) {
+    sub->onChange(latest);
+  }
+}
+
+Journal::FileChangeBatch* Journal::getCurrentBatch() {
+  for (auto* batch = currentFileChangeBatch; batch; batch = batch->previous_) {
+    if (&batch->journal_ == this) {
+      return batch;
+    }
+  }
+  return nullptr;
 }
 
 void Journal::addDelta(FileChangeJournalDelta&& delta) {
+  if (auto* batch = getCurrentBatch()) {
+    batch->deltas_.push_back(std::move(delta));
+    return;
+  }
+
+  SequenceNumber latest;
   {
     auto deltaState = deltaState_.wlock();
     addDeltaWithoutNotifying(std::move(delta), *deltaState);
+    appendToLog(*deltaState);
+    latest = deltaState->backPtr()->sequenceID;
+  }
+  notifySubscribers(latest);
+}
+
+void Journal::addDeltas(std::vector<FileChangeJournalDelta>&& deltas) {
+  SequenceNumber latest;
+  {
+    auto deltaState = deltaState_.wlock();
+    for (auto& delta : deltas) {
+      addDeltaWithoutNotifying(std::move(delta), *deltaState);
+      appendToLog(*deltaState);
+    }
+    latest = deltaState->backPtr()->sequenceID;
   }
-  notifySubscribers();
+  notifySubscribers(latest);
 }
 
 void Journal::addDelta(HashUpdateJournalDelta&& delta, const Hash& newHash) {
+  if (auto* batch = getCurrentBatch()) {
+    batch->flush();
+  }
+
+  SequenceNumber latest;
   {
     auto deltaState = deltaState_.wlock();
 
@@ -204,8 +421,97 @@ void Journal::addDelta(HashUpdateJournalDelta&& delta, const Hash& newHash) {
     }
     addDeltaWithoutNotifying(std::move(delta), *deltaState);
     deltaState->currentHash = newHash;
+    appendToLog(*deltaState);
+    latest = deltaState->backPtr()->sequenceID;
+  }
+  notifySubscribers(latest);
+}
+
+void Journal::appendToLog(DeltaState& deltaState) {
+  if (!deltaState.log) {
+    return;
+  }
+  try {
+    // If the delta was compacted into the previous one this records it again
+    // with its new sequence number; loading the log compacts it the same way.
+    if (deltaState.isFileChangeInBack()) {
+      deltaState.log->append(deltaState.fileChangeDeltas.back());
+    } else {
+      deltaState.log->append(
+          deltaState.hashUpdateDeltas.back(), deltaState.currentHash);
+    }
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error writing journal log, keeping the journal in memory "
+              << "only: " << folly::exceptionStr(ex);
+    deltaState.log.reset();
+    return;
   }
-  notifySubscribers();
+  if (deltaState.log->isOverLimit()) {
+    rewriteLog(deltaState);
+  }
+}
+
+void Journal::rewriteLog(DeltaState& deltaState) {
+  if (!deltaState.log) {
+    return;
+  }
+  try {
+    deltaState.log->rewrite(
+        deltaState.fileChangeDeltas,
+        deltaState.hashUpdateDeltas,
+        deltaState.currentHash,
+        deltaState.nextSequence);
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error rewriting journal log, keeping the journal in memory "
+              << "only: " << folly::exceptionStr(ex);
+    deltaState.log.reset();
+  }
+}
+
+std::optional<uint64_t> Journal::openLog(
+    AbsolutePathPiece path,
+    uint64_t diskLimit) {
+  auto contents = JournalLog::load(path);
+  std::optional<uint64_t> generation;
+
+  auto deltaState = deltaState_.wlock();
+  DCHECK(deltaState->empty()) << "openLog() called after recording deltas";
+  if (contents && deltaState->empty()) {
+    generation = contents->generation;
+    deltaState->currentHash = contents->baseHash;
+    // Replay the deltas with their original sequence numbers. Their times are
+    // from the steady clock of the process that wrote them, so they are
+    // stamped with the current time instead.
+    for (auto& record : contents->records) {
+      if (auto* delta = std::get_if<FileChangeJournalDelta>(&record)) {
+        deltaState->nextSequence = delta->sequenceID;
+        addDeltaWithoutNotifying(std::move(*delta), *deltaState);
+      } else {
+        auto& update = std::get<JournalLog::HashUpdate>(record);
+        deltaState->nextSequence = update.delta.sequenceID;
+        addDeltaWithoutNotifying(std::move(update.delta), *deltaState);
+        deltaState->currentHash = update.toHash;
+      }
+    }
+    deltaState->nextSequence = contents->nextSequence;
+  }
+
+  deltaState->log = std::make_unique<JournalLog>(path, diskLimit);
+  rewriteLog(*deltaState);
+  return generation;
+}
+
+void Journal::closeLog(uint64_t generation) {
+  auto deltaState = deltaState_.wlock();
+  if (!deltaState->log) {
+    return;
+  }
+  try {
+    deltaState->log->close(generation);
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error closing journal log: " << folly::exceptionStr(ex);
+  }
+  deltaState->log.reset();
 }
 
 std::optional<JournalDeltaInfo> Journal::getLatest() const {
@@ -234,8 +540,28 @@ uint64_t Journal::registerSubscriber(SubscriberCallback&& callback) {
   return id;
 }
 
+uint64_t Journal::registerSubscriber(
+    BatchedSubscriberCallback&& callback,
+    SubscriberOptions options) {
+  DCHECK(options.executor);
+  auto subscriber =
+      std::make_shared<BatchedSubscriber>(std::move(callback), options);
+  auto subscriberState = subscriberState_.wlock();
+  auto id = subscriberState->nextSubscriberId++;
+  subscriberState->batchedSubscribers[id] = std::move(subscriber);
+  return id;
+}
+
 void Journal::cancelSubscriber(uint64_t id) {
   auto subscriberState = subscriberState_.wlock();
+  auto batchedIt = subscriberState->batchedSubscribers.find(id);
+  if (batchedIt != subscriberState->batchedSubscribers.end()) {
+    auto subscriber = std::move(batchedIt->second);
+    subscriberState->batchedSubscribers.erase(batchedIt);
+    subscriberState.unlock();
+    subscriber->cancel();
+    return;
+  }
   auto it = subscriberState->subscribers.find(id);
   if (it == subscriberState->subscribers.end()) {
     return;
@@ -253,14 +579,25 @@ void Journal::cancelAllSubscribers() {
   // as part of their tear down, so we need to make sure that we aren't
   // holding the lock when we trigger that.
   std::unordered_map<SubscriberId, SubscriberCallback> subscribers;
-  subscriberState_.wlock()->subscribers.swap(subscribers);
+  std::unordered_map<SubscriberId, std::shared_ptr<BatchedSubscriber>>
+      batchedSubscribers;
+  {
+    auto subscriberState = subscriberState_.wlock();
+    subscriberState->subscribers.swap(subscribers);
+    subscriberState->batchedSubscribers.swap(batchedSubscribers);
+  }
   subscribers.clear();
+  for (auto& entry : batchedSubscribers) {
+    entry.second->cancel();
+  }
 }
 
 bool Journal::isSubscriberValid(uint64_t id) const {
   auto subscriberState = subscriberState_.rlock();
   auto& subscribers = subscriberState->subscribers;
-  return subscribers.find(id) != subscribers.end();
+  auto& batchedSubscribers = subscriberState->batchedSubscribers;
+  return subscribers.find(id) != subscribers.end() ||
+      batchedSubscribers.find(id) != batchedSubscribers.end();
 }
 
 std::optional<JournalStats> Journal::getStats() {
@@ -314,16 +651,19 @@ size_t Journal::estimateMemoryUsage(const DeltaState& deltaState) const {
   if (deltaState.stats) {
     memoryUsage += deltaState.deltaMemoryUsage;
   }
+  memoryUsage += deltaState.paths.estimateMemoryUsage();
   return memoryUsage;
 }
 
 void Journal::flush() {
+  SequenceNumber latest;
   {
     auto deltaState = deltaState_.wlock();
     ++deltaState->nextSequence;
     auto lastHash = deltaState->currentHash;
     deltaState->fileChangeDeltas.clear();
     deltaState->hashUpdateDeltas.clear();
+    deltaState->paths.clear();
     deltaState->stats = std::nullopt;
     auto delta = HashUpdateJournalDelta();
     /* Tracking the hash correctly when the journal is flushed is important
@@ -335,8 +675,10 @@ void Journal::flush() {
      */
     delta.fromHash = lastHash;
     addDeltaWithoutNotifying(std::move(delta), *deltaState);
+    rewriteLog(*deltaState);
+    latest = deltaState->backPtr()->sequenceID;
   }
-  notifySubscribers();
+  notifySubscribers(latest);
 }
 
 std::unique_ptr<JournalDeltaRange> Journal::accumulateRange() {
@@ -345,6 +687,18 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange() {
 
 std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
     SequenceNumber from) {
+  return accumulateFilteredRange(from, nullptr);
+}
+
+std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
+    SequenceNumber from,
+    const JournalPathFilter& filter) {
+  return accumulateFilteredRange(from, &filter);
+}
+
+std::unique_ptr<JournalDeltaRange> Journal::accumulateFilteredRange(
+    SequenceNumber from,
+    const JournalPathFilter* filter) {
   DCHECK(from > 0);
   std::unique_ptr<JournalDeltaRange> result = nullptr;
 
@@ -358,6 +712,7 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
     forEachDelta(
         *deltaState,
         from,
+        kMaxSequence,
         std::nullopt,
         [&](const FileChangeJournalDelta& current) -> void {
           ++filesAccumulated;
@@ -372,9 +727,16 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
           result->fromSequence = current.sequenceID;
           result->fromTime = current.time;
 
+          // Check the delta's own paths before copying them.
+          if (filter && !filter->matchesAny(current)) {
+            return;
+          }
           for (auto& entry : current.getChangedFilesInOverlay()) {
             auto& name = entry.first;
             auto& currentInfo = entry.second;
+            if (filter && !filter->matches(name)) {
+              continue;
+            }
             auto* resultInfo =
                 folly::get_ptr(result->changedFilesInOverlay, name);
             if (!resultInfo) {
@@ -404,8 +766,16 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
           result->fromHash = current.fromHash;
 
           // Merge the unclean status list
-          result->uncleanPaths.insert(
-              current.uncleanPaths.begin(), current.uncleanPaths.end());
+          if (!filter) {
+            result->uncleanPaths.insert(
+                current.uncleanPaths.begin(), current.uncleanPaths.end());
+          } else if (filter->mayMatchUnder(current.uncleanPathsPrefix)) {
+            for (auto& path : current.uncleanPaths) {
+              if (filter->matches(path)) {
+                result->uncleanPaths.insert(path);
+              }
+            }
+          }
         });
   }
 
@@ -428,6 +798,120 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
   return result;
 }
 
+void Journal::accumulateRangeInChunks(
+    SequenceNumber from,
+    size_t chunkSize,
+    ChunkCallback callback) {
+  DCHECK(from > 0);
+  DCHECK(chunkSize > 0);
+
+  // The bounds of the range summed so far, and the merged state of every path
+  // reported so far.
+  JournalDeltaRange summed;
+  bool started = false;
+  std::unordered_map<RelativePath, PathChangeInfo> merged;
+  std::unordered_set<RelativePath> uncleanPaths;
+  SequenceNumber to = kMaxSequence;
+  size_t filesAccumulated = 0;
+  bool isTruncated = false;
+
+  auto start = [&](const JournalDelta& current, const Hash& currentHash) {
+    if (!started) {
+      started = true;
+      summed.toSequence = current.sequenceID;
+      summed.toTime = current.time;
+      summed.toHash = currentHash;
+      summed.fromHash = currentHash;
+    }
+    // Capture the lower bound.
+    summed.fromSequence = current.sequenceID;
+    summed.fromTime = current.time;
+    to = current.sequenceID - 1;
+  };
+
+  while (to >= from) {
+    JournalDeltaRange chunk;
+    size_t deltaCount = 0;
+    {
+      auto deltaState = deltaState_.rlock();
+      // Deltas are only ever dropped from the front of the journal, so this
+      // also catches deltas that were dropped since the previous chunk.
+      if (!deltaState->empty() && deltaState->getFrontSequenceID() > from) {
+        isTruncated = true;
+        break;
+      }
+      forEachDelta(
+          *deltaState,
+          from,
+          to,
+          chunkSize,
+          [&](const FileChangeJournalDelta& current) -> void {
+            ++deltaCount;
+            ++filesAccumulated;
+            start(current, deltaState->currentHash);
+            for (auto& entry : current.getChangedFilesInOverlay()) {
+              auto& name = entry.first;
+              auto& currentInfo = entry.second;
+              auto it = merged.find(name);
+              if (it == merged.end()) {
+                merged.emplace(name, currentInfo);
+                chunk.changedFilesInOverlay.emplace(name, currentInfo);
+              } else if (
+                  it->second.existedBefore != currentInfo.existedBefore) {
+                it->second.existedBefore = currentInfo.existedBefore;
+                chunk.changedFilesInOverlay.insert_or_assign(name, it->second);
+              }
+            }
+          },
+          [&](const HashUpdateJournalDelta& current) -> void {
+            ++deltaCount;
+            start(current, deltaState->currentHash);
+            summed.fromHash = current.fromHash;
+            for (auto& path : current.uncleanPaths) {
+              if (uncleanPaths.insert(path).second) {
+                chunk.uncleanPaths.insert(path);
+              }
+            }
+          });
+    }
+
+    if (deltaCount == 0) {
+      break;
+    }
+    chunk.fromSequence = summed.fromSequence;
+    chunk.toSequence = summed.toSequence;
+    chunk.fromTime = summed.fromTime;
+    chunk.toTime = summed.toTime;
+    chunk.fromHash = summed.fromHash;
+    chunk.toHash = summed.toHash;
+    if (!callback(std::move(chunk)) || deltaCount < chunkSize) {
+      break;
+    }
+  }
+
+  if (isTruncated) {
+    JournalDeltaRange chunk;
+    chunk.isTruncated = true;
+    callback(std::move(chunk));
+  }
+
+  if (started || isTruncated) {
+    if (edenStats_) {
+      if (isTruncated) {
+        edenStats_->getJournalStatsForCurrentThread().truncatedReads.addValue(
+            1);
+      }
+      edenStats_->getJournalStatsForCurrentThread().filesAccumulated.addValue(
+          filesAccumulated);
+    }
+    auto deltaState = deltaState_.wlock();
+    if (deltaState->stats) {
+      deltaState->stats->maxFilesAccumulated =
+          std::max(deltaState->stats->maxFilesAccumulated, filesAccumulated);
+    }
+  }
+}
+
 std::vector<DebugJournalDelta> Journal::getDebugRawJournalInfo(
     SequenceNumber from,
     std::optional<size_t> limit,
@@ -438,6 +922,7 @@ std::vector<DebugJournalDelta> Journal::getDebugRawJournalInfo(
   forEachDelta(
       *deltaState,
       from,
+      kMaxSequence,
       limit,
       [mountGeneration, &result, &currentHash](
           const FileChangeJournalDelta& current) -> void {
@@ -500,12 +985,27 @@ template <class FileChangeFunc, class HashUpdateFunc>
 void Journal::forEachDelta(
     const DeltaState& deltaState,
     JournalDelta::SequenceNumber from,
+    JournalDelta::SequenceNumber to,
     std::optional<size_t> lengthLimit,
     FileChangeFunc&& fileChangeDeltaCallback,
     HashUpdateFunc&& hashUpdateDeltaCallback) const {
   size_t iters = 0;
-  auto fileChangeIt = deltaState.fileChangeDeltas.rbegin();
-  auto hashUpdateIt = deltaState.hashUpdateDeltas.rbegin();
+  // Both deques are sorted by sequence ID, so skip the deltas newer than 'to'
+  // by searching for the first one that is.
+  auto isAfter = [](JournalDelta::SequenceNumber sequenceID,
+                    const JournalDelta& delta) {
+    return sequenceID < delta.sequenceID;
+  };
+  auto fileChangeIt = std::make_reverse_iterator(std::upper_bound(
+      deltaState.fileChangeDeltas.begin(),
+      deltaState.fileChangeDeltas.end(),
+      to,
+      isAfter));
+  auto hashUpdateIt = std::make_reverse_iterator(std::upper_bound(
+      deltaState.hashUpdateDeltas.begin(),
+      deltaState.hashUpdateDeltas.end(),
+      to,
+      isAfter));
   auto fileChangeRend = deltaState.fileChangeDeltas.rend();
   auto hashUpdateRend = deltaState.hashUpdateDeltas.rend();
   while (fileChangeIt != fileChangeRend || hashUpdateIt != hashUpdateRend) {
@@ -7,14 +7,20 @@
 
 #pragma once
 
+#include <folly/Executor.h>
 #include <folly/Function.h>
 #include <folly/Synchronized.h>
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 #include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/journal/JournalLog.h"
+#include "eden/fs/journal/JournalPathFilter.h"
 #include "eden/fs/service/ThriftUtil.h"
 #include "eden/fs/service/gen-cpp2/StreamingEdenService.h"
 #include "eden/fs/telemetry/EdenStats.h"
@@ -73,6 +79,51 @@ class Journal {
   using SequenceNumber = JournalDelta::SequenceNumber;
   using SubscriberId = uint64_t;
   using SubscriberCallback = std::function<void()>;
+  /** Called with the inclusive range of sequence numbers added since the
+   * previous notification of a batched subscriber. */
+  using BatchedSubscriberCallback =
+      std::function<void(SequenceNumber from, SequenceNumber to)>;
+
+  struct SubscriberOptions {
+    /** The executor that notifications are delivered on. */
+    folly::Executor::KeepAlive<> executor;
+    /** The minimum time between two notifications. Deltas added in the
+     * meantime are coalesced into the next notification. */
+    std::chrono::steady_clock::duration minInterval{0};
+    /** Notify without waiting for minInterval to pass once this many deltas
+     * are waiting to be notified. 0 means always wait. */
+    size_t maxBatchSize{0};
+  };
+
+  /**
+   * While a FileChangeBatch is alive, the file changes recorded on the thread
+   * that created it are held back, and are added to the journal together,
+   * with one acquisition of its lock and one notification of its
+   * subscribers, when the batch is flushed or destroyed.
+   *
+   * The held changes are not visible to readers of the journal until then.
+   * Hash updates are never held back; they flush the batch first so that the
+   * order of the deltas is kept.
+   */
+  class FileChangeBatch {
+   public:
+    explicit FileChangeBatch(Journal& journal);
+    ~FileChangeBatch();
+
+    FileChangeBatch(const FileChangeBatch&) = delete;
+    FileChangeBatch& operator=(const FileChangeBatch&) = delete;
+
+    /** Add the changes held so far to the journal. */
+    void flush();
+
+   private:
+    friend class Journal;
+
+    Journal& journal_;
+    /** The batch that was active on this thread before this one. */
+    FileChangeBatch* const previous_;
+    std::vector<FileChangeJournalDelta> deltas_;
+  };
 
   void recordCreated(RelativePathPiece fileName);
   void recordRemoved(RelativePathPiece fileName);
@@ -124,6 +175,16 @@ class Journal {
    * can be passed to cancelSubscriber to later remove the registration.
    */
   SubscriberId registerSubscriber(SubscriberCallback&& callback);
+
+  /** Register a subscriber that is notified on options.executor rather than
+   * on the thread that changed the journal, with changes coalesced as
+   * described by options. Notifications to one subscriber do not overlap and
+   * their ranges are in increasing order. A notification may still be running
+   * when cancelSubscriber() returns.
+   */
+  SubscriberId registerSubscriber(
+      BatchedSubscriberCallback&& callback,
+      SubscriberOptions options);
   void cancelSubscriber(SubscriberId id);
 
   void cancelAllSubscribers();
@@ -144,6 +205,40 @@ class Journal {
       SequenceNumber limitSequence);
   std::unique_ptr<JournalDeltaRange> accumulateRange();
 
+  /** Like accumulateRange(limitSequence), but only sums the paths selected by
+   * filter. The sequence numbers, times and hashes still describe every delta
+   * in the range, including those that changed no selected path. Deltas whose
+   * paths cannot be selected are skipped without copying their paths.
+   * */
+  std::unique_ptr<JournalDeltaRange> accumulateRange(
+      SequenceNumber limitSequence,
+      const JournalPathFilter& filter);
+
+  /**
+   * Called with each chunk of changes summed by accumulateRangeInChunks().
+   * Returning false stops the summing early.
+   */
+  using ChunkCallback = folly::Function<bool(JournalDeltaRange&& chunk)>;
+
+  /** Sums the same deltas as accumulateRange(limitSequence), but hands the
+   * result to callback in chunks of at most chunkSize deltas, walking back
+   * from the newest delta, and releases the Journal's lock between chunks.
+   *
+   * The sequence numbers, times and hashes of each chunk describe the range
+   * summed by it and every earlier chunk, so the last chunk describes the
+   * whole range. Its changedFilesInOverlay and uncleanPaths only hold the
+   * paths that chunk added or whose PathChangeInfo it changed; a path reported
+   * by several chunks takes its PathChangeInfo from the last of them.
+   *
+   * If deltas in the range are dropped from the Journal, either before the
+   * first chunk or between chunks, callback is passed a final chunk with just
+   * isTruncated set. If no deltas match, callback is never called.
+   * */
+  void accumulateRangeInChunks(
+      SequenceNumber limitSequence,
+      size_t chunkSize,
+      ChunkCallback callback);
+
   /** Gets a vector of the modifications (newer deltas having lower indices)
    * done by the latest 'limit' deltas, if the
    * beginning of the journal is reached before 'limit' number of deltas are
@@ -165,6 +260,26 @@ class Journal {
 
   size_t estimateMemoryUsage() const;
 
+  /**
+   * Keep a copy of the journal in a log file at path, so that its sequence
+   * numbers remain meaningful after edenfs restarts.
+   *
+   * If the file holds a log that was closed cleanly by closeLog(), the
+   * deltas it recorded are loaded first and the generation passed to
+   * closeLog() is returned. This must be called before any deltas are
+   * recorded.
+   *
+   * The log is rewritten from the deltas held in memory whenever it grows
+   * past diskLimit bytes.
+   */
+  std::optional<uint64_t> openLog(AbsolutePathPiece path, uint64_t diskLimit);
+
+  /**
+   * Write out and close the log opened by openLog(), marking it as complete.
+   * Deltas recorded afterwards are only kept in memory.
+   */
+  void closeLog(uint64_t generation);
+
  private:
   /** Add a delta to the journal and notify subscribers.
    * The delta will have a new sequence number and timestamp
@@ -173,7 +288,15 @@ class Journal {
   void addDelta(FileChangeJournalDelta&& delta);
   void addDelta(HashUpdateJournalDelta&& delta, const Hash& newHash);
 
+  /** Add the deltas to the journal in order, and notify subscribers once. */
+  void addDeltas(std::vector<FileChangeJournalDelta>&& deltas);
+
+  /** The FileChangeBatch active on this thread for this journal, if any. */
+  FileChangeBatch* getCurrentBatch();
+
   static constexpr size_t kDefaultJournalMemoryLimit = 1000000000;
+  static constexpr SequenceNumber kMaxSequence =
+      std::numeric_limits<SequenceNumber>::max();
 
   struct DeltaState {
     /** The sequence number that we'll use for the next entry
@@ -188,6 +311,10 @@ class Journal {
     std::optional<JournalStats> stats;
     size_t memoryLimit = kDefaultJournalMemoryLimit;
     size_t deltaMemoryUsage = 0;
+    /** The on-disk copy of the deltas, if openLog() has been called. */
+    std::unique_ptr<JournalLog> log;
+    /** The distinct paths held by fileChangeDeltas. */
+    JournalPathTable paths;
 
     JournalDeltaPtr frontPtr() noexcept;
     void popFront();
@@ -235,6 +362,25 @@ class Journal {
   };
   folly::Synchronized<DeltaState> deltaState_;
 
+  /** Replaces the delta's paths with the copies in the path table, so that
+   * deltas for the same file share them.
+   */
+  static void internPaths(FileChangeJournalDelta& delta, DeltaState& state);
+  static void internPaths(HashUpdateJournalDelta&, DeltaState&) {}
+
+  /** Computes the summaries of the delta's paths that let filtered queries
+   * skip it.
+   */
+  static void summarizePaths(FileChangeJournalDelta&) {}
+  static void summarizePaths(HashUpdateJournalDelta& delta) {
+    delta.updateUncleanPathsPrefix();
+  }
+
+  /** Implements both forms of accumulateRange(); filter may be null. */
+  std::unique_ptr<JournalDeltaRange> accumulateFilteredRange(
+      SequenceNumber limitSequence,
+      const JournalPathFilter* filter);
+
   /** Removes the oldest deltas until the memory usage of the journal is below
    * the journal's memory limit.
    */
@@ -246,9 +392,13 @@ class Journal {
   bool compact(FileChangeJournalDelta& delta, DeltaState& deltaState);
   bool compact(HashUpdateJournalDelta& delta, DeltaState& deltaState);
 
+  class BatchedSubscriber;
+
   struct SubscriberState {
     SubscriberId nextSubscriberId{1};
     std::unordered_map<SubscriberId, SubscriberCallback> subscribers;
+    std::unordered_map<SubscriberId, std::shared_ptr<BatchedSubscriber>>
+        batchedSubscribers;
   };
 
   /** Add a delta to the journal without notifying subscribers.
@@ -259,21 +409,31 @@ class Journal {
   template <typename T>
   void addDeltaWithoutNotifying(T&& delta, DeltaState& deltaState);
 
-  /** Notify subscribers that a change has happened, should be called with no
-   * Journal locks held.
+  /** Write the most recently added delta to the log, if there is one. If
+   * writing fails the log is abandoned and the journal only lives in memory.
+   */
+  void appendToLog(DeltaState& deltaState);
+
+  /** Rewrite the log, if there is one, from the deltas held in memory */
+  void rewriteLog(DeltaState& deltaState);
+
+  /** Notify subscribers that a change has happened, latest being the sequence
+   * number of the newest delta. Should be called with no Journal locks held.
    */
-  void notifySubscribers() const;
+  void notifySubscribers(SequenceNumber latest) const;
 
   size_t estimateMemoryUsage(const DeltaState& deltaState) const;
 
-  /** Runs from the latest delta to the delta with sequence ID (if 'lengthLimit'
-   * is not nullopt then checks at most 'lengthLimit' entries) and runs
-   * deltaActor on each entry encountered.
+  /** Runs from the latest delta with a sequence ID of at most 'to' to the
+   * delta with sequence ID 'from' (if 'lengthLimit' is not nullopt then checks
+   * at most 'lengthLimit' entries) and runs deltaActor on each entry
+   * encountered.
    * */
   template <class FileChangeFunc, class HashUpdateFunc>
   void forEachDelta(
       const DeltaState& deltaState,
       JournalDelta::SequenceNumber from,
+      JournalDelta::SequenceNumber to,
       std::optional<size_t> lengthLimit,
       FileChangeFunc&& fileChangeDeltaCallback,
       HashUpdateFunc&& hashUpdateDeltaCallback) const;
@@ -14,21 +14,21 @@ namespace eden {
 FileChangeJournalDelta::FileChangeJournalDelta(
     RelativePathPiece fileName,
     FileChangeJournalDelta::Created)
-    : path1{fileName.copy()},
+    : path1{fileName},
       info1{PathChangeInfo{false, true}},
       isPath1Valid{true} {}
 
 FileChangeJournalDelta::FileChangeJournalDelta(
     RelativePathPiece fileName,
     FileChangeJournalDelta::Removed)
-    : path1{fileName.copy()},
+    : path1{fileName},
       info1{PathChangeInfo{true, false}},
       isPath1Valid{true} {}
 
 FileChangeJournalDelta::FileChangeJournalDelta(
     RelativePathPiece fileName,
     FileChangeJournalDelta::Changed)
-    : path1{fileName.copy()},
+    : path1{fileName},
       info1{PathChangeInfo{true, true}},
       isPath1Valid{true} {}
 
@@ -36,8 +36,8 @@ FileChangeJournalDelta::FileChangeJournalDelta(
     RelativePathPiece oldName,
     RelativePathPiece newName,
     FileChangeJournalDelta::Renamed)
-    : path1{oldName.copy()},
-      path2{newName.copy()},
+    : path1{oldName},
+      path2{newName},
       info1{PathChangeInfo{true, false}},
       info2{PathChangeInfo{false, true}},
       isPath1Valid{true},
@@ -47,28 +47,15 @@ FileChangeJournalDelta::FileChangeJournalDelta(
     RelativePathPiece oldName,
     RelativePathPiece newName,
     FileChangeJournalDelta::Replaced)
-    : path1{oldName.copy()},
-      path2{newName.copy()},
+    : path1{oldName},
+      path2{newName},
       info1{PathChangeInfo{true, false}},
       info2{PathChangeInfo{true, true}},
       isPath1Valid{true},
       isPath2Valid{true} {}
 
 size_t FileChangeJournalDelta::estimateMemoryUsage() const {
-  size_t mem = sizeof(FileChangeJournalDelta);
-
-  /* NOTE: The following code assumes an unordered_set is separated into an
-   * array of buckets, each one being a chain of nodes containing a next
-   * pointer, a key-value pair, and a stored hash
-   */
-  if (isPath1Valid) {
-    mem += facebook::eden::estimateIndirectMemoryUsage(path1);
-  }
-  if (isPath2Valid) {
-    mem += facebook::eden::estimateIndirectMemoryUsage(path2);
-  }
-
-  return mem;
+  return sizeof(FileChangeJournalDelta);
 }
 
 size_t HashUpdateJournalDelta::estimateMemoryUsage() const {
@@ -94,18 +81,34 @@ size_t HashUpdateJournalDelta::estimateMemoryUsage() const {
   for (auto& path : uncleanPaths) {
     mem += facebook::eden::estimateIndirectMemoryUsage(path);
   }
+  mem += facebook::eden::estimateIndirectMemoryUsage(uncleanPathsPrefix);
 
   return mem;
 }
 
+void HashUpdateJournalDelta::updateUncleanPathsPrefix() {
+  if (uncleanPaths.empty()) {
+    uncleanPathsPrefix = RelativePath{};
+    return;
+  }
+  auto it = uncleanPaths.begin();
+  RelativePathPiece prefix = it->dirname();
+  for (++it; it != uncleanPaths.end() && !prefix.empty(); ++it) {
+    while (!prefix.empty() && *it != prefix && !it->isSubDirOf(prefix)) {
+      prefix = prefix.dirname();
+    }
+  }
+  uncleanPathsPrefix = prefix.copy();
+}
+
 std::unordered_map<RelativePath, PathChangeInfo>
 FileChangeJournalDelta::getChangedFilesInOverlay() const {
   std::unordered_map<RelativePath, PathChangeInfo> changedFilesInOverlay;
   if (isPath1Valid) {
-    changedFilesInOverlay[path1] = info1;
+    changedFilesInOverlay[path1.piece().copy()] = info1;
   }
   if (isPath2Valid) {
-    changedFilesInOverlay[path2] = info2;
+    changedFilesInOverlay[path2.piece().copy()] = info2;
   }
   return changedFilesInOverlay;
 }
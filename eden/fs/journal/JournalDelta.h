@@ -11,6 +11,7 @@
 #include <type_traits>
 #include <unordered_set>
 #include <variant>
+#include "eden/fs/journal/JournalPath.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -97,8 +98,8 @@ class FileChangeJournalDelta : public JournalDelta {
       Replaced);
 
   /** Which of these paths actually contain information */
-  RelativePath path1;
-  RelativePath path2;
+  JournalPath path1;
+  JournalPath path2;
   PathChangeInfo info1;
   PathChangeInfo info2;
   bool isPath1Valid = false;
@@ -114,7 +115,8 @@ class FileChangeJournalDelta : public JournalDelta {
    * sequenceID [whether they do the same action] */
   bool isSameAction(const FileChangeJournalDelta& other) const;
 
-  /** Get memory used (in bytes) by this Delta */
+  /** Get memory used (in bytes) by this Delta. This does not include its
+   * paths, which are accounted for by the Journal's JournalPathTable. */
   size_t estimateMemoryUsage() const;
 };
 
@@ -136,6 +138,14 @@ class HashUpdateJournalDelta : public JournalDelta {
    * some other operation that changes the snapshot hash */
   std::unordered_set<RelativePath> uncleanPaths;
 
+  /** The deepest directory that holds every path in uncleanPaths, so that a
+   * filtered query can skip the whole set when it selects nothing under
+   * this directory. Set by updateUncleanPathsPrefix(). */
+  RelativePath uncleanPathsPrefix;
+
+  /** Recompute uncleanPathsPrefix from uncleanPaths */
+  void updateUncleanPathsPrefix();
+
   /** Get memory used (in bytes) by this Delta */
   size_t estimateMemoryUsage() const;
 };
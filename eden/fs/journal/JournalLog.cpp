@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalLog.h"
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/ExceptionString.h>
+#include <folly/FileUtil.h>
+#include <folly/Range.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include <folly/logging/xlog.h>
+#include <folly/portability/Fcntl.h>
+#include <algorithm>
+
+using folly::ByteRange;
+using folly::IOBuf;
+using folly::IOBufQueue;
+using folly::StringPiece;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr StringPiece kLogIdentifier{"EDJL"};
+constexpr uint32_t kLogVersion = 1;
+constexpr uint32_t kCleanFlag = 0x1;
+constexpr size_t kHeaderSize = kLogIdentifier.size() + sizeof(uint32_t) +
+    sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint64_t) + Hash::RAW_SIZE;
+
+/** Records are written once this many bytes of them have been appended. */
+constexpr size_t kWriteBufferSize = 64 * 1024;
+
+enum class RecordType : uint8_t {
+  FileChange = 1,
+  HashUpdate = 2,
+};
+
+constexpr uint8_t kPath1Valid = 0x01;
+constexpr uint8_t kPath1ExistedBefore = 0x02;
+constexpr uint8_t kPath1ExistedAfter = 0x04;
+constexpr uint8_t kPath2Valid = 0x08;
+constexpr uint8_t kPath2ExistedBefore = 0x10;
+constexpr uint8_t kPath2ExistedAfter = 0x20;
+
+struct Header {
+  uint32_t flags{0};
+  uint64_t generation{0};
+  JournalDelta::SequenceNumber nextSequence{1};
+  Hash baseHash;
+};
+
+std::unique_ptr<IOBuf> serializeHeader(const Header& header) {
+  auto buf = IOBuf::create(kHeaderSize);
+  folly::io::Appender appender(buf.get(), 0);
+  appender.push(kLogIdentifier);
+  appender.writeBE(kLogVersion);
+  appender.writeBE(header.flags);
+  appender.writeBE<uint64_t>(header.generation);
+  appender.writeBE<uint64_t>(header.nextSequence);
+  appender.push(header.baseHash.getBytes());
+  return buf;
+}
+
+void writePath(folly::io::QueueAppender& appender, RelativePathPiece path) {
+  appender.writeBE<uint32_t>(path.stringPiece().size());
+  appender.push(ByteRange{path.stringPiece()});
+}
+
+RelativePath readPath(folly::io::Cursor& cursor) {
+  return RelativePath{cursor.readFixedString(cursor.readBE<uint32_t>())};
+}
+
+/** Append a record to queue, returning its size in bytes. */
+size_t serialize(const FileChangeJournalDelta& delta, IOBufQueue& queue) {
+  uint8_t flags = (delta.isPath1Valid ? kPath1Valid : 0) |
+      (delta.info1.existedBefore ? kPath1ExistedBefore : 0) |
+      (delta.info1.existedAfter ? kPath1ExistedAfter : 0) |
+      (delta.isPath2Valid ? kPath2Valid : 0) |
+      (delta.info2.existedBefore ? kPath2ExistedBefore : 0) |
+      (delta.info2.existedAfter ? kPath2ExistedAfter : 0);
+  uint32_t bodySize = sizeof(RecordType) + sizeof(uint64_t) + sizeof(flags) +
+      2 * sizeof(uint32_t) + delta.path1.piece().stringPiece().size() +
+      delta.path2.piece().stringPiece().size();
+
+  folly::io::QueueAppender appender(&queue, sizeof(bodySize) + bodySize);
+  appender.writeBE(bodySize);
+  appender.write(static_cast<uint8_t>(RecordType::FileChange));
+  appender.writeBE<uint64_t>(delta.sequenceID);
+  appender.write(flags);
+  writePath(appender, delta.path1.piece());
+  writePath(appender, delta.path2.piece());
+  return sizeof(bodySize) + bodySize;
+}
+
+size_t serialize(
+    const HashUpdateJournalDelta& delta,
+    const Hash& toHash,
+    IOBufQueue& queue) {
+  uint32_t bodySize = sizeof(RecordType) + sizeof(uint64_t) +
+      2 * Hash::RAW_SIZE + sizeof(uint32_t);
+  for (const auto& path : delta.uncleanPaths) {
+    bodySize += sizeof(uint32_t) + path.stringPiece().size();
+  }
+
+  folly::io::QueueAppender appender(&queue, sizeof(bodySize) + bodySize);
+  appender.writeBE(bodySize);
+  appender.write(static_cast<uint8_t>(RecordType::HashUpdate));
+  appender.writeBE<uint64_t>(delta.sequenceID);
+  appender.push(delta.fromHash.getBytes());
+  appender.push(toHash.getBytes());
+  appender.writeBE<uint32_t>(delta.uncleanPaths.size());
+  for (const auto& path : delta.uncleanPaths) {
+    writePath(appender, path);
+  }
+  return sizeof(bodySize) + bodySize;
+}
+
+JournalDelta::SequenceNumber getSequenceID(
+    const FileChangeJournalDelta& delta) {
+  return delta.sequenceID;
+}
+
+JournalDelta::SequenceNumber getSequenceID(const JournalLog::HashUpdate& u) {
+  return u.delta.sequenceID;
+}
+
+JournalLog::Record deserializeRecord(folly::io::Cursor& cursor) {
+  auto type = static_cast<RecordType>(cursor.read<uint8_t>());
+  auto sequenceID = cursor.readBE<uint64_t>();
+  switch (type) {
+    case RecordType::FileChange: {
+      FileChangeJournalDelta delta;
+      delta.sequenceID = sequenceID;
+      auto flags = cursor.read<uint8_t>();
+      delta.isPath1Valid = flags & kPath1Valid;
+      delta.info1 = PathChangeInfo{bool(flags & kPath1ExistedBefore),
+                                   bool(flags & kPath1ExistedAfter)};
+      delta.isPath2Valid = flags & kPath2Valid;
+      delta.info2 = PathChangeInfo{bool(flags & kPath2ExistedBefore),
+                                   bool(flags & kPath2ExistedAfter)};
+      delta.path1 = JournalPath{readPath(cursor)};
+      delta.path2 = JournalPath{readPath(cursor)};
+      return JournalLog::Record{std::move(delta)};
+    }
+    case RecordType::HashUpdate: {
+      JournalLog::HashUpdate update;
+      update.delta.sequenceID = sequenceID;
+      Hash::Storage bytes;
+      cursor.pull(bytes.data(), bytes.size());
+      update.delta.fromHash = Hash{bytes};
+      cursor.pull(bytes.data(), bytes.size());
+      update.toHash = Hash{bytes};
+      auto count = cursor.readBE<uint32_t>();
+      for (uint32_t i = 0; i < count; ++i) {
+        update.delta.uncleanPaths.insert(readPath(cursor));
+      }
+      return JournalLog::Record{std::move(update)};
+    }
+  }
+  throw std::runtime_error(folly::to<std::string>(
+      "unknown journal log record type ", static_cast<int>(type)));
+}
+} // namespace
+
+std::optional<JournalLog::Contents> JournalLog::load(AbsolutePathPiece path) {
+  std::string data;
+  if (!folly::readFile(path.stringPiece().str().c_str(), data)) {
+    if (errno != ENOENT) {
+      XLOG(WARN) << "error reading journal log " << path << ": "
+                 << folly::errnoStr(errno);
+    }
+    return std::nullopt;
+  }
+
+  try {
+    IOBuf buf(IOBuf::WRAP_BUFFER, ByteRange{StringPiece{data}});
+    folly::io::Cursor cursor(&buf);
+    auto id = cursor.readFixedString(kLogIdentifier.size());
+    auto version = cursor.readBE<uint32_t>();
+    if (StringPiece{id} != kLogIdentifier || version != kLogVersion) {
+      throw std::runtime_error("unexpected header");
+    }
+    auto flags = cursor.readBE<uint32_t>();
+    if (!(flags & kCleanFlag)) {
+      XLOG(INFO) << "discarding journal log " << path
+                 << " since it was not closed cleanly";
+      return std::nullopt;
+    }
+
+    Contents contents;
+    contents.generation = cursor.readBE<uint64_t>();
+    contents.nextSequence = cursor.readBE<uint64_t>();
+    Hash::Storage bytes;
+    cursor.pull(bytes.data(), bytes.size());
+    contents.baseHash = Hash{bytes};
+
+    JournalDelta::SequenceNumber minSequence = 1;
+    while (!cursor.isAtEnd()) {
+      auto bodySize = cursor.readBE<uint32_t>();
+      // Parse each record from its own bounded cursor so that a corrupt
+      // record cannot run into the next one.
+      folly::io::Cursor body(cursor, bodySize);
+      cursor.skip(bodySize);
+      auto record = deserializeRecord(body);
+      auto sequenceID = std::visit(
+          [](const auto& r) { return getSequenceID(r); }, record);
+      if (sequenceID < minSequence) {
+        throw std::runtime_error(folly::to<std::string>(
+            "sequence number ", sequenceID, " is out of order"));
+      }
+      minSequence = sequenceID + 1;
+      contents.records.push_back(std::move(record));
+    }
+    // Records appended since the last rewrite come after the header's
+    // sequence number.
+    contents.nextSequence = std::max(contents.nextSequence, minSequence);
+    return contents;
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "discarding corrupt journal log " << path << ": "
+               << folly::exceptionStr(ex);
+    return std::nullopt;
+  }
+}
+
+JournalLog::JournalLog(AbsolutePathPiece path, uint64_t diskLimit)
+    : path_{path}, diskLimit_{diskLimit} {}
+
+void JournalLog::rewrite(
+    const std::deque<FileChangeJournalDelta>& fileChangeDeltas,
+    const std::deque<HashUpdateJournalDelta>& hashUpdateDeltas,
+    const Hash& currentHash,
+    JournalDelta::SequenceNumber nextSequence) {
+  // Serialize the deltas newest first, stopping once they would fill half of
+  // the disk limit. Leaving room for new records keeps a journal that holds
+  // more than the limit in memory from rewriting the log on every append.
+  std::vector<std::unique_ptr<IOBuf>> records;
+  uint64_t size = kHeaderSize;
+  Hash baseHash = currentHash;
+  Hash toHash = currentHash;
+  auto fileChangeIt = fileChangeDeltas.rbegin();
+  auto hashUpdateIt = hashUpdateDeltas.rbegin();
+  while (fileChangeIt != fileChangeDeltas.rend() ||
+         hashUpdateIt != hashUpdateDeltas.rend()) {
+    bool isFileChange = hashUpdateIt == hashUpdateDeltas.rend() ||
+        (fileChangeIt != fileChangeDeltas.rend() &&
+         fileChangeIt->sequenceID > hashUpdateIt->sequenceID);
+    IOBufQueue queue{IOBufQueue::cacheChainLength()};
+    size_t recordSize = isFileChange
+        ? serialize(*fileChangeIt, queue)
+        : serialize(*hashUpdateIt, toHash, queue);
+    if (size + recordSize > diskLimit_ / 2) {
+      break;
+    }
+    size += recordSize;
+    records.push_back(queue.move());
+    if (isFileChange) {
+      ++fileChangeIt;
+    } else {
+      // Deltas older than this one ended on the hash it started from.
+      toHash = hashUpdateIt->fromHash;
+      baseHash = toHash;
+      ++hashUpdateIt;
+    }
+  }
+
+  Header header;
+  header.nextSequence = nextSequence;
+  header.baseHash = baseHash;
+  IOBufQueue data{IOBufQueue::cacheChainLength()};
+  data.append(serializeHeader(header));
+  for (auto it = records.rbegin(); it != records.rend(); ++it) {
+    data.append(std::move(*it));
+  }
+  auto buf = data.move();
+  buf->coalesce();
+
+  file_.close();
+  pending_.move();
+  folly::writeFileAtomic(
+      path_.stringPiece(), ByteRange{buf->data(), buf->length()});
+  file_ = folly::File{path_.stringPiece(), O_WRONLY | O_APPEND | O_CLOEXEC};
+  size_ = size;
+  baseHash_ = baseHash;
+  nextSequence_ = nextSequence;
+}
+
+void JournalLog::append(const FileChangeJournalDelta& delta) {
+  size_ += serialize(delta, pending_);
+  if (pending_.chainLength() >= kWriteBufferSize) {
+    flushPending();
+  }
+}
+
+void JournalLog::append(
+    const HashUpdateJournalDelta& delta,
+    const Hash& toHash) {
+  size_ += serialize(delta, toHash, pending_);
+  if (pending_.chainLength() >= kWriteBufferSize) {
+    flushPending();
+  }
+}
+
+void JournalLog::flushPending() {
+  if (pending_.empty()) {
+    return;
+  }
+  auto buf = pending_.move();
+  auto iov = buf->getIov();
+  auto written = folly::writevFull(file_.fd(), iov.data(), iov.size());
+  folly::checkUnixError(written, "error writing journal log ", path_);
+}
+
+void JournalLog::close(uint64_t generation) {
+  flushPending();
+
+  Header header;
+  header.flags = kCleanFlag;
+  header.generation = generation;
+  header.nextSequence = nextSequence_;
+  header.baseHash = baseHash_;
+  auto buf = serializeHeader(header);
+  // file_ was opened for appending, so the header needs its own descriptor.
+  folly::File file{path_.stringPiece(), O_WRONLY | O_CLOEXEC};
+  auto written = folly::pwriteFull(file.fd(), buf->data(), buf->length(), 0);
+  folly::checkUnixError(written, "error writing journal log ", path_);
+  folly::checkUnixError(
+      folly::fsyncNoInt(file.fd()), "error syncing journal log ", path_);
+  file_.close();
+}
+
+} // namespace eden
+} // namespace facebook
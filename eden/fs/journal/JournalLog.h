@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/io/IOBufQueue.h>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <variant>
+#include <vector>
+#include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An on-disk copy of a mount's Journal, so that the journal positions handed
+ * out to clients such as watchman remain valid across an edenfs restart or a
+ * graceful takeover.
+ *
+ * The log is a header followed by one record per delta added to the Journal.
+ * Records are buffered in memory and written in batches, so a log is only
+ * trusted if it was closed cleanly: opening a log clears the clean flag in its
+ * header and close() sets it again. A log that was not closed cleanly may be
+ * missing changes, and load() ignores it.
+ *
+ * Once the log grows past its disk limit the Journal rewrites it from the
+ * deltas it still holds in memory. The rewritten log keeps only as many of the
+ * newest deltas as fit in half of the limit.
+ *
+ * JournalLog is not thread-safe; the Journal only uses it while holding its
+ * delta state lock.
+ */
+class JournalLog {
+ public:
+  /** A hash update record, along with the hash the journal moved to. */
+  struct HashUpdate {
+    HashUpdateJournalDelta delta;
+    Hash toHash;
+  };
+
+  using Record = std::variant<FileChangeJournalDelta, HashUpdate>;
+
+  /** The contents of a cleanly closed log. */
+  struct Contents {
+    /** The value passed to close(). */
+    uint64_t generation{0};
+    /** The journal's next sequence number. */
+    JournalDelta::SequenceNumber nextSequence{1};
+    /** The journal's hash before the first record. */
+    Hash baseHash;
+    /** The records, in sequence order. Their times are not meaningful. */
+    std::vector<Record> records;
+  };
+
+  /**
+   * Read the log at path.
+   *
+   * Returns std::nullopt if there is no log, or if it is corrupt or was not
+   * closed cleanly.
+   */
+  static std::optional<Contents> load(AbsolutePathPiece path);
+
+  /**
+   * Prepare to write the log at path. Nothing is written until rewrite() is
+   * called.
+   */
+  JournalLog(AbsolutePathPiece path, uint64_t diskLimit);
+
+  JournalLog(const JournalLog&) = delete;
+  JournalLog& operator=(const JournalLog&) = delete;
+
+  /**
+   * Replace the log's contents with the given deltas, leaving the log marked
+   * as not closed cleanly.
+   *
+   * currentHash is the journal's current hash, and nextSequence is its next
+   * sequence number.
+   */
+  void rewrite(
+      const std::deque<FileChangeJournalDelta>& fileChangeDeltas,
+      const std::deque<HashUpdateJournalDelta>& hashUpdateDeltas,
+      const Hash& currentHash,
+      JournalDelta::SequenceNumber nextSequence);
+
+  void append(const FileChangeJournalDelta& delta);
+  void append(const HashUpdateJournalDelta& delta, const Hash& toHash);
+
+  /**
+   * Write any buffered records and mark the log as closed cleanly, recording
+   * generation in its header. The log must not be used afterwards.
+   */
+  void close(uint64_t generation);
+
+  /** Returns true if appended records have grown the log past its limit. */
+  bool isOverLimit() const {
+    return size_ > diskLimit_;
+  }
+
+ private:
+  void flushPending();
+
+  AbsolutePath path_;
+  uint64_t diskLimit_;
+  folly::File file_;
+  /** Records that have been appended but not yet written to file_. */
+  folly::IOBufQueue pending_{folly::IOBufQueue::cacheChainLength()};
+  /** The size of the log, including the pending records. */
+  uint64_t size_{0};
+  /** The header fields written by the last rewrite(). */
+  Hash baseHash_;
+  JournalDelta::SequenceNumber nextSequence_{1};
+};
+
+} // namespace eden
+} // namespace facebook
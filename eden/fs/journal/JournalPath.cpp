@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalPath.h"
+#include <folly/memory/Malloc.h>
+
+namespace facebook {
+namespace eden {
+
+JournalPath JournalPathTable::intern(JournalPath path) {
+  if (!path.path_) {
+    return path;
+  }
+  auto it = paths_.find(path.piece());
+  if (it != paths_.end()) {
+    return it->second;
+  }
+  memoryUsage_ += estimateEntryMemoryUsage(path);
+  paths_.emplace(path.piece(), path);
+  return path;
+}
+
+void JournalPathTable::release(const JournalPath& path) {
+  if (!path.path_) {
+    return;
+  }
+  auto it = paths_.find(path.piece());
+  // One reference is held by the table and the other by the caller.
+  if (it != paths_.end() && it->second.path_ == path.path_ &&
+      path.path_.use_count() <= 2) {
+    memoryUsage_ -= estimateEntryMemoryUsage(it->second);
+    paths_.erase(it);
+  }
+}
+
+void JournalPathTable::clear() {
+  paths_.clear();
+  memoryUsage_ = 0;
+}
+
+size_t JournalPathTable::estimateEntryMemoryUsage(const JournalPath& path) {
+  // The map node holding the entry and its bucket pointer, the shared
+  // allocation holding the path, and the path's own buffer.
+  using Entry = decltype(paths_)::value_type;
+  return folly::goodMallocSize(
+             sizeof(void*) + sizeof(Entry) + sizeof(size_t)) +
+      sizeof(void*) +
+      folly::goodMallocSize(2 * sizeof(void*) + sizeof(RelativePath)) +
+      estimateIndirectMemoryUsage(*path.path_);
+}
+
+} // namespace eden
+} // namespace facebook
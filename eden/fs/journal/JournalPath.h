@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A path recorded by a journal delta.
+ *
+ * Copies of a JournalPath share one refcounted copy of the path, and the
+ * Journal interns them in a JournalPathTable, so that a file which changes
+ * many times only has its path stored once.
+ */
+class JournalPath {
+ public:
+  JournalPath() = default;
+
+  explicit JournalPath(RelativePathPiece path)
+      : path_{std::make_shared<const RelativePath>(path)} {}
+
+  RelativePathPiece piece() const {
+    return path_ ? RelativePathPiece{*path_} : RelativePathPiece{};
+  }
+
+  bool operator==(const JournalPath& other) const {
+    return path_ == other.path_ || piece() == other.piece();
+  }
+
+  bool operator!=(const JournalPath& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  friend class JournalPathTable;
+
+  std::shared_ptr<const RelativePath> path_;
+};
+
+/**
+ * The set of distinct paths held by a Journal's deltas.
+ *
+ * The memory used by the paths is accounted for here rather than by each
+ * delta that refers to them. JournalPathTable is not thread-safe; the Journal
+ * only uses it while holding its delta state lock.
+ */
+class JournalPathTable {
+ public:
+  /**
+   * Returns the table's copy of path, adding path to the table if it holds no
+   * equal path.
+   */
+  JournalPath intern(JournalPath path);
+
+  /**
+   * Must be called before a delta that is being dropped from the journal
+   * releases its reference to path. Removes path from the table if that
+   * delta was its last user.
+   */
+  void release(const JournalPath& path);
+
+  void clear();
+
+  size_t size() const {
+    return paths_.size();
+  }
+
+  size_t estimateMemoryUsage() const {
+    return memoryUsage_;
+  }
+
+ private:
+  static size_t estimateEntryMemoryUsage(const JournalPath& path);
+
+  /** The keys point into the path held by the value. */
+  std::unordered_map<RelativePathPiece, JournalPath> paths_;
+  size_t memoryUsage_{0};
+};
+
+} // namespace eden
+} // namespace facebook
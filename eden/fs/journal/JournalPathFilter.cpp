@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalPathFilter.h"
+
+#include <folly/Conv.h>
+#include <algorithm>
+#include <stdexcept>
+#include "eden/fs/journal/JournalDelta.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+bool isAtOrUnder(RelativePathPiece path, RelativePathPiece dir) {
+  return dir.empty() || path == dir || path.isSubDirOf(dir);
+}
+} // namespace
+
+JournalPathFilter::JournalPathFilter(
+    std::vector<RelativePath> includePrefixes,
+    std::vector<RelativePath> excludePrefixes,
+    const std::vector<std::string>& includeGlobs)
+    : includePrefixes_{std::move(includePrefixes)},
+      excludePrefixes_{std::move(excludePrefixes)} {
+  includeGlobs_.reserve(includeGlobs.size());
+  for (const auto& glob : includeGlobs) {
+    auto matcher = GlobMatcher::create(glob, GlobOptions::DEFAULT);
+    if (matcher.hasError()) {
+      throw std::invalid_argument(folly::to<std::string>(
+          "invalid glob pattern `", glob, "`: ", matcher.error()));
+    }
+    includeGlobs_.push_back(std::move(matcher).value());
+  }
+}
+
+bool JournalPathFilter::matches(RelativePathPiece path) const {
+  auto isUnder = [&](const RelativePath& prefix) {
+    return isAtOrUnder(path, prefix);
+  };
+  if (!includePrefixes_.empty() &&
+      std::none_of(includePrefixes_.begin(), includePrefixes_.end(), isUnder)) {
+    return false;
+  }
+  if (std::any_of(excludePrefixes_.begin(), excludePrefixes_.end(), isUnder)) {
+    return false;
+  }
+  return includeGlobs_.empty() ||
+      std::any_of(
+             includeGlobs_.begin(),
+             includeGlobs_.end(),
+             [&](const GlobMatcher& glob) {
+               return glob.match(path.stringPiece());
+             });
+}
+
+bool JournalPathFilter::matchesAny(const FileChangeJournalDelta& delta) const {
+  return (delta.isPath1Valid && matches(delta.path1.piece())) ||
+      (delta.isPath2Valid && matches(delta.path2.piece()));
+}
+
+bool JournalPathFilter::mayMatchUnder(RelativePathPiece dir) const {
+  for (const auto& prefix : excludePrefixes_) {
+    if (isAtOrUnder(dir, prefix)) {
+      return false;
+    }
+  }
+  if (includePrefixes_.empty()) {
+    return true;
+  }
+  // An include prefix selects paths under dir if it is above dir, or is
+  // itself somewhere under it.
+  return std::any_of(
+      includePrefixes_.begin(),
+      includePrefixes_.end(),
+      [&](const RelativePath& prefix) {
+        return isAtOrUnder(dir, prefix) || isAtOrUnder(prefix, dir);
+      });
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "eden/fs/model/git/GlobMatcher.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class FileChangeJournalDelta;
+
+/**
+ * Selects the paths a journal query reports, so that clients interested in a
+ * few directories do not have to be sent every change in the checkout.
+ *
+ * A path is selected if it is at or under one of the include prefixes, is
+ * not at or under any exclude prefix, and matches one of the include globs.
+ * An empty list of include prefixes or globs selects every path.
+ */
+class JournalPathFilter {
+ public:
+  /**
+   * Throws std::invalid_argument if one of includeGlobs is not a valid glob
+   * pattern.
+   */
+  JournalPathFilter(
+      std::vector<RelativePath> includePrefixes,
+      std::vector<RelativePath> excludePrefixes,
+      const std::vector<std::string>& includeGlobs);
+
+  bool matches(RelativePathPiece path) const;
+
+  /** Whether either of the paths changed by delta is selected. */
+  bool matchesAny(const FileChangeJournalDelta& delta) const;
+
+  /**
+   * Returns false if no path at or under dir can be selected, so that the
+   * paths in it do not need to be checked one by one.
+   */
+  bool mayMatchUnder(RelativePathPiece dir) const;
+
+ private:
+  std::vector<RelativePath> includePrefixes_;
+  std::vector<RelativePath> excludePrefixes_;
+  std::vector<GlobMatcher> includeGlobs_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -6,6 +6,10 @@
  */
 
 #include "eden/fs/journal/Journal.h"
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/experimental/TestUtil.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -539,3 +543,417 @@ TEST(Journal, compaction) {
   EXPECT_EQ(3, summed->toSequence);
   EXPECT_EQ(1, summed->changedFilesInOverlay.size());
 }
+
+namespace {
+AbsolutePath journalLogPath(const folly::test::TemporaryDirectory& dir) {
+  return AbsolutePath{dir.path().string()} + "journal"_pc;
+}
+} // namespace
+
+TEST(Journal, log_restores_closed_journal) {
+  folly::test::TemporaryDirectory tmpDir;
+  auto path = journalLogPath(tmpDir);
+  auto hash1 = Hash{"1111111111111111111111111111111111111111"};
+  auto hash2 = Hash{"2222222222222222222222222222222222222222"};
+  {
+    Journal journal(std::make_shared<EdenStats>());
+    EXPECT_FALSE(journal.openLog(path, 1000000));
+    journal.recordHashUpdate(hash1);
+    journal.recordCreated("foo"_relpath);
+    journal.recordRenamed("foo"_relpath, "bar"_relpath);
+    journal.recordUncleanPaths(hash1, hash2, {RelativePath{"baz"}});
+    journal.recordChanged("bar"_relpath);
+    journal.closeLog(1234);
+  }
+
+  Journal journal(std::make_shared<EdenStats>());
+  EXPECT_EQ(1234, journal.openLog(path, 1000000));
+  auto latest = journal.getLatest();
+  ASSERT_TRUE(latest);
+  EXPECT_EQ(5, latest->sequenceID);
+  EXPECT_EQ(hash2, latest->toHash);
+
+  auto summed = journal.accumulateRange(2);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_FALSE(summed->isTruncated);
+  EXPECT_EQ(2, summed->fromSequence);
+  EXPECT_EQ(5, summed->toSequence);
+  EXPECT_EQ(hash1, summed->fromHash);
+  EXPECT_EQ(hash2, summed->toHash);
+  EXPECT_EQ(
+      (std::unordered_map<RelativePath, PathChangeInfo>{
+          {RelativePath{"foo"}, PathChangeInfo{false, false}},
+          {RelativePath{"bar"}, PathChangeInfo{false, true}}}),
+      summed->changedFilesInOverlay);
+  EXPECT_EQ(
+      std::unordered_set<RelativePath>{RelativePath{"baz"}},
+      summed->uncleanPaths);
+
+  // New deltas continue the restored sequence.
+  journal.recordChanged("qux"_relpath);
+  EXPECT_EQ(6, journal.getLatest()->sequenceID);
+}
+
+TEST(Journal, log_is_ignored_unless_closed) {
+  folly::test::TemporaryDirectory tmpDir;
+  auto path = journalLogPath(tmpDir);
+  {
+    Journal journal(std::make_shared<EdenStats>());
+    journal.openLog(path, 1000000);
+    journal.recordCreated("foo"_relpath);
+    // Destroying the journal without closeLog() is like crashing.
+  }
+
+  Journal journal(std::make_shared<EdenStats>());
+  EXPECT_FALSE(journal.openLog(path, 1000000));
+  EXPECT_FALSE(journal.getLatest());
+}
+
+TEST(Journal, log_is_bounded_by_disk_limit) {
+  folly::test::TemporaryDirectory tmpDir;
+  auto path = journalLogPath(tmpDir);
+  constexpr uint64_t kDiskLimit = 4096;
+  {
+    Journal journal(std::make_shared<EdenStats>());
+    journal.openLog(path, kDiskLimit);
+    for (int i = 0; i < 1000; ++i) {
+      journal.recordCreated(RelativePath{folly::to<std::string>("file", i)});
+    }
+    journal.closeLog(1);
+  }
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(path.stringPiece().str().c_str(), contents));
+  EXPECT_GE(kDiskLimit, contents.size());
+
+  Journal journal(std::make_shared<EdenStats>());
+  EXPECT_EQ(1, journal.openLog(path, kDiskLimit));
+  EXPECT_EQ(1000, journal.getLatest()->sequenceID);
+  auto summed = journal.accumulateRange(1);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_TRUE(summed->isTruncated);
+
+  // The newest deltas were kept.
+  summed = journal.accumulateRange(1000);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_FALSE(summed->isTruncated);
+  EXPECT_EQ(1, summed->changedFilesInOverlay.count(RelativePath{"file999"}));
+}
+
+namespace {
+std::vector<JournalDeltaRange> accumulateInChunks(
+    Journal& journal,
+    Journal::SequenceNumber from,
+    size_t chunkSize) {
+  std::vector<JournalDeltaRange> chunks;
+  journal.accumulateRangeInChunks(
+      from, chunkSize, [&](JournalDeltaRange&& chunk) {
+        chunks.push_back(std::move(chunk));
+        return true;
+      });
+  return chunks;
+}
+} // namespace
+
+TEST(Journal, accumulate_range_in_chunks_matches_accumulate_range) {
+  Journal journal(std::make_shared<EdenStats>());
+  auto hash1 = Hash{"1111111111111111111111111111111111111111"};
+  auto hash2 = Hash{"2222222222222222222222222222222222222222"};
+  journal.recordHashUpdate(hash1);
+  journal.recordCreated("foo"_relpath);
+  journal.recordChanged("bar"_relpath);
+  journal.recordUncleanPaths(hash1, hash2, {RelativePath{"bar"}});
+  journal.recordRenamed("foo"_relpath, "baz"_relpath);
+  journal.recordChanged("bar"_relpath);
+  journal.recordRemoved("qux"_relpath);
+
+  auto chunks = accumulateInChunks(journal, 2, 2);
+  ASSERT_EQ(3, chunks.size());
+  const auto& last = chunks.back();
+  auto summed = journal.accumulateRange(2);
+  EXPECT_EQ(summed->fromSequence, last.fromSequence);
+  EXPECT_EQ(summed->toSequence, last.toSequence);
+  EXPECT_EQ(summed->fromHash, last.fromHash);
+  EXPECT_EQ(summed->toHash, last.toHash);
+  EXPECT_EQ(7, chunks.front().toSequence);
+  EXPECT_EQ(6, chunks.front().fromSequence);
+
+  // Later chunks only report the paths they change, and the last report of
+  // each path matches the merged result.
+  std::unordered_map<RelativePath, PathChangeInfo> changed;
+  std::unordered_set<RelativePath> unclean;
+  for (const auto& chunk : chunks) {
+    EXPECT_FALSE(chunk.isTruncated);
+    for (const auto& entry : chunk.changedFilesInOverlay) {
+      changed.insert_or_assign(entry.first, entry.second);
+    }
+    unclean.insert(chunk.uncleanPaths.begin(), chunk.uncleanPaths.end());
+  }
+  EXPECT_EQ(summed->changedFilesInOverlay, changed);
+  EXPECT_EQ(summed->uncleanPaths, unclean);
+  EXPECT_EQ(0, chunks[2].changedFilesInOverlay.count(RelativePath{"bar"}))
+      << "bar already existed in the newer chunks";
+  EXPECT_EQ(1, chunks[2].changedFilesInOverlay.count(RelativePath{"foo"}))
+      << "foo was created in the oldest chunk";
+}
+
+TEST(Journal, accumulate_range_in_chunks_reports_truncation) {
+  Journal journal(std::make_shared<EdenStats>());
+  EXPECT_TRUE(accumulateInChunks(journal, 1, 10).empty());
+
+  for (int i = 0; i < 10; ++i) {
+    journal.recordCreated(RelativePath{folly::to<std::string>("file", i)});
+  }
+  EXPECT_TRUE(accumulateInChunks(journal, 11, 10).empty());
+
+  // Flushing the journal between chunks drops the rest of the range.
+  std::vector<JournalDeltaRange> chunks;
+  journal.accumulateRangeInChunks(1, 4, [&](JournalDeltaRange&& chunk) {
+    chunks.push_back(std::move(chunk));
+    journal.flush();
+    return true;
+  });
+  ASSERT_EQ(2, chunks.size());
+  EXPECT_FALSE(chunks[0].isTruncated);
+  EXPECT_EQ(4, chunks[0].changedFilesInOverlay.size());
+  EXPECT_TRUE(chunks[1].isTruncated);
+
+  chunks = accumulateInChunks(journal, 1, 4);
+  ASSERT_EQ(1, chunks.size());
+  EXPECT_TRUE(chunks[0].isTruncated);
+}
+
+TEST(Journal, repeated_paths_are_stored_once) {
+  // Long enough that the paths are not stored inline.
+  auto pathFor = [](int i) {
+    return RelativePath{folly::to<std::string>(
+        "some/long/directory/name/file", 100 + i % 100)};
+  };
+
+  Journal distinct(std::make_shared<EdenStats>());
+  Journal repeated(std::make_shared<EdenStats>());
+  for (int i = 0; i < 100; ++i) {
+    distinct.recordCreated(pathFor(i));
+    repeated.recordCreated(pathFor(0));
+  }
+  EXPECT_LT(repeated.estimateMemoryUsage(), distinct.estimateMemoryUsage());
+
+  // Interning paths does not change what the journal reports.
+  auto summed = repeated.accumulateRange();
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(1, summed->changedFilesInOverlay.count(pathFor(0)));
+  EXPECT_EQ(100, summed->toSequence);
+}
+
+TEST(Journal, truncation_releases_paths) {
+  Journal journal(std::make_shared<EdenStats>());
+  journal.setMemoryLimit(0);
+  journal.recordCreated("some/long/directory/name/file100"_relpath);
+  auto memoryUsage = journal.estimateMemoryUsage();
+  for (int i = 101; i < 200; ++i) {
+    journal.recordCreated(RelativePath{
+        folly::to<std::string>("some/long/directory/name/file", i)});
+  }
+  // Only the newest delta, and so only its path, is remembered.
+  EXPECT_EQ(memoryUsage, journal.estimateMemoryUsage());
+}
+
+namespace {
+struct Notifications {
+  using Range = std::pair<Journal::SequenceNumber, Journal::SequenceNumber>;
+  std::vector<Range> ranges;
+
+  Journal::BatchedSubscriberCallback callback() {
+    return [this](Journal::SequenceNumber from, Journal::SequenceNumber to) {
+      ranges.emplace_back(from, to);
+    };
+  }
+};
+} // namespace
+
+TEST(Journal, batched_subscriber_coalesces_changes) {
+  folly::ManualExecutor executor;
+  Notifications notifications;
+  Journal journal(std::make_shared<EdenStats>());
+  Journal::SubscriberOptions options;
+  options.executor = folly::getKeepAliveToken(&executor);
+  journal.registerSubscriber(notifications.callback(), options);
+
+  journal.recordCreated("a"_relpath);
+  journal.recordCreated("b"_relpath);
+  journal.recordCreated("c"_relpath);
+  EXPECT_TRUE(notifications.ranges.empty())
+      << "notifications run on the executor";
+  executor.drain();
+  ASSERT_EQ(1, notifications.ranges.size());
+  EXPECT_EQ(Notifications::Range(1, 3), notifications.ranges[0]);
+
+  journal.recordCreated("d"_relpath);
+  executor.drain();
+  ASSERT_EQ(2, notifications.ranges.size());
+  EXPECT_EQ(Notifications::Range(4, 4), notifications.ranges[1]);
+}
+
+TEST(Journal, batched_subscriber_notifies_full_batches_early) {
+  folly::ManualExecutor executor;
+  Notifications notifications;
+  Journal journal(std::make_shared<EdenStats>());
+  Journal::SubscriberOptions options;
+  options.executor = folly::getKeepAliveToken(&executor);
+  options.minInterval = std::chrono::seconds{1};
+  options.maxBatchSize = 2;
+  journal.registerSubscriber(notifications.callback(), options);
+
+  // The first notification does not wait.
+  journal.recordCreated("a"_relpath);
+  executor.drain();
+  ASSERT_EQ(1, notifications.ranges.size());
+
+  // The next one waits for the interval or for a full batch.
+  journal.recordCreated("b"_relpath);
+  executor.drain();
+  EXPECT_EQ(1, notifications.ranges.size());
+  journal.recordCreated("c"_relpath);
+  executor.drain();
+  ASSERT_EQ(2, notifications.ranges.size());
+  EXPECT_EQ(Notifications::Range(2, 3), notifications.ranges[1]);
+
+  // Cancel so that the notification still waiting for the interval does
+  // nothing when it runs.
+  journal.cancelAllSubscribers();
+}
+
+TEST(Journal, cancelled_batched_subscriber_is_not_notified) {
+  folly::ManualExecutor executor;
+  Notifications notifications;
+  Journal journal(std::make_shared<EdenStats>());
+  Journal::SubscriberOptions options;
+  options.executor = folly::getKeepAliveToken(&executor);
+  auto id = journal.registerSubscriber(notifications.callback(), options);
+  EXPECT_TRUE(journal.isSubscriberValid(id));
+
+  journal.recordCreated("a"_relpath);
+  journal.cancelSubscriber(id);
+  EXPECT_FALSE(journal.isSubscriberValid(id));
+  executor.drain();
+  EXPECT_TRUE(notifications.ranges.empty());
+}
+
+TEST(Journal, file_change_batch_adds_changes_together) {
+  Journal journal(std::make_shared<EdenStats>());
+  size_t notifications = 0;
+  journal.registerSubscriber([&] { ++notifications; });
+
+  {
+    Journal::FileChangeBatch batch{journal};
+    journal.recordCreated("a"_relpath);
+    journal.recordChanged("b"_relpath);
+    EXPECT_FALSE(journal.getLatest()) << "held until the batch ends";
+  }
+  EXPECT_EQ(1, notifications);
+  ASSERT_TRUE(journal.getLatest());
+  EXPECT_EQ(2, journal.getLatest()->sequenceID);
+
+  {
+    Journal::FileChangeBatch batch{journal};
+    journal.recordRemoved("a"_relpath);
+    // A hash update adds the held changes first.
+    journal.recordHashUpdate(Hash("1111111111111111111111111111111111111111"));
+    EXPECT_EQ(4, journal.getLatest()->sequenceID);
+    journal.recordCreated("c"_relpath);
+  }
+  EXPECT_EQ(5, journal.getLatest()->sequenceID);
+
+  auto summed = journal.accumulateRange(3);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(1, summed->changedFilesInOverlay.count("a"_relpath));
+  EXPECT_EQ(1, summed->changedFilesInOverlay.count("c"_relpath));
+}
+
+TEST(Journal, accumulate_range_only_sums_paths_selected_by_filter) {
+  Journal journal(std::make_shared<EdenStats>());
+  journal.recordCreated("foo/a"_relpath);
+  journal.recordChanged("bar/b"_relpath);
+  journal.recordChanged("foo/excluded/c"_relpath);
+  journal.recordRenamed("bar/d"_relpath, "foo/d"_relpath);
+  journal.recordChanged("bar/e"_relpath);
+
+  JournalPathFilter filter{
+      {RelativePath{"foo"}}, {RelativePath{"foo/excluded"}}, {}};
+  auto summed = journal.accumulateRange(1, filter);
+  ASSERT_NE(nullptr, summed);
+  // The range still covers the deltas that changed nothing selected.
+  EXPECT_EQ(1, summed->fromSequence);
+  EXPECT_EQ(5, summed->toSequence);
+  EXPECT_EQ(2, summed->changedFilesInOverlay.size());
+  EXPECT_TRUE(summed->changedFilesInOverlay.count(RelativePath{"foo/a"}));
+  EXPECT_TRUE(summed->changedFilesInOverlay.count(RelativePath{"foo/d"}));
+
+  JournalPathFilter globFilter{{}, {}, {"**/*.h", "bar/b"}};
+  journal.recordChanged("foo/x.h"_relpath);
+  summed = journal.accumulateRange(1, globFilter);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(2, summed->changedFilesInOverlay.size());
+  EXPECT_TRUE(summed->changedFilesInOverlay.count(RelativePath{"bar/b"}));
+  EXPECT_TRUE(summed->changedFilesInOverlay.count(RelativePath{"foo/x.h"}));
+}
+
+TEST(Journal, accumulate_range_filters_unclean_paths) {
+  Journal journal(std::make_shared<EdenStats>());
+  auto hash1 = Hash{"1111111111111111111111111111111111111111"};
+  auto hash2 = Hash{"2222222222222222222222222222222222222222"};
+  journal.recordUncleanPaths(
+      hash1,
+      hash2,
+      {RelativePath{"foo/bar/a"}, RelativePath{"foo/bar/b"},
+       RelativePath{"foo/c"}});
+
+  auto summed = journal.accumulateRange(
+      1, JournalPathFilter{{RelativePath{"baz"}}, {}, {}});
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(hash1, summed->fromHash);
+  EXPECT_EQ(hash2, summed->toHash);
+  EXPECT_TRUE(summed->uncleanPaths.empty());
+
+  summed = journal.accumulateRange(
+      1, JournalPathFilter{{RelativePath{"foo/bar"}}, {}, {}});
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(
+      (std::unordered_set<RelativePath>{
+          RelativePath{"foo/bar/a"}, RelativePath{"foo/bar/b"}}),
+      summed->uncleanPaths);
+}
+
+TEST(JournalPathFilter, skips_directories_it_selects_nothing_under) {
+  JournalPathFilter filter{
+      {RelativePath{"foo/bar"}, RelativePath{"baz"}},
+      {RelativePath{"baz/out"}},
+      {}};
+  EXPECT_TRUE(filter.mayMatchUnder(RelativePathPiece{}));
+  EXPECT_TRUE(filter.mayMatchUnder("foo"_relpath));
+  EXPECT_TRUE(filter.mayMatchUnder("foo/bar/x"_relpath));
+  EXPECT_TRUE(filter.mayMatchUnder("baz"_relpath));
+  EXPECT_FALSE(filter.mayMatchUnder("foo/baz"_relpath));
+  EXPECT_FALSE(filter.mayMatchUnder("foo/barx"_relpath));
+  EXPECT_FALSE(filter.mayMatchUnder("baz/out/x"_relpath));
+
+  EXPECT_THROW(JournalPathFilter({}, {}, {"[a-"}), std::invalid_argument);
+}
+
+TEST(HashUpdateJournalDelta, unclean_paths_prefix_is_their_common_directory) {
+  HashUpdateJournalDelta delta;
+  delta.updateUncleanPathsPrefix();
+  EXPECT_EQ(RelativePath{}, delta.uncleanPathsPrefix);
+
+  delta.uncleanPaths = {RelativePath{"foo/bar/a"}};
+  delta.updateUncleanPathsPrefix();
+  EXPECT_EQ(RelativePath{"foo/bar"}, delta.uncleanPathsPrefix);
+
+  delta.uncleanPaths.insert(RelativePath{"foo/baz/b"});
+  delta.uncleanPaths.insert(RelativePath{"foo/bar/c/d"});
+  delta.updateUncleanPathsPrefix();
+  EXPECT_EQ(RelativePath{"foo"}, delta.uncleanPathsPrefix);
+
+  delta.uncleanPaths.insert(RelativePath{"top"});
+  delta.updateUncleanPathsPrefix();
+  EXPECT_EQ(RelativePath{}, delta.uncleanPathsPrefix);
+}
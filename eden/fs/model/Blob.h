@@ -16,6 +16,9 @@ namespace eden {
 
 class Blob {
  public:
+  /** Tags the constructor for contents mapped from a file. */
+  struct Mapped {};
+
   Blob(const Hash& hash, folly::IOBuf&& contents)
       : hash_{hash},
         contents_{std::move(contents)},
@@ -35,6 +38,16 @@ class Blob {
         contents_{folly::IOBuf::COPY_BUFFER, contents.data(), contents.size()},
         size_{contents.size()} {}
 
+  /**
+   * Constructs a Blob whose contents are a read-only mapping of a file,
+   * rather than heap memory, such as the blobs MappedBlobCache returns.
+   */
+  Blob(const Hash& hash, folly::IOBuf&& contents, Mapped)
+      : hash_{hash},
+        contents_{std::move(contents)},
+        size_{contents_.computeChainDataLength()},
+        isMapped_{true} {}
+
   const Hash& getHash() const {
     return hash_;
   }
@@ -47,10 +60,23 @@ class Blob {
     return size_;
   }
 
+  bool isMapped() const {
+    return isMapped_;
+  }
+
+  /**
+   * The heap memory the contents take up, which is none if they are mapped
+   * from a file.
+   */
+  size_t getHeapSize() const {
+    return isMapped_ ? 0 : size_;
+  }
+
  private:
   const Hash hash_;
   const folly::IOBuf contents_;
   const size_t size_;
+  const bool isMapped_{false};
 };
 } // namespace eden
 } // namespace facebook
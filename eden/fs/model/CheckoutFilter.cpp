@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/CheckoutFilter.h"
+
+#include <algorithm>
+#include "eden/fs/model/Tree.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+bool isAtOrUnder(RelativePathPiece path, RelativePathPiece dir) {
+  return dir.empty() || path == dir || path.isSubDirOf(dir);
+}
+} // namespace
+
+CheckoutFilter::CheckoutFilter(
+    std::vector<RelativePath> includePrefixes,
+    std::vector<RelativePath> excludePrefixes)
+    : includePrefixes_{std::move(includePrefixes)},
+      excludePrefixes_{std::move(excludePrefixes)} {}
+
+bool CheckoutFilter::isHidden(RelativePathPiece path) const {
+  for (const auto& prefix : excludePrefixes_) {
+    if (isAtOrUnder(path, prefix)) {
+      return true;
+    }
+  }
+  if (includePrefixes_.empty()) {
+    return false;
+  }
+  return std::none_of(
+      includePrefixes_.begin(),
+      includePrefixes_.end(),
+      [&](const RelativePath& prefix) {
+        return isAtOrUnder(path, prefix) || prefix.isSubDirOf(path);
+      });
+}
+
+bool CheckoutFilter::mayHideUnder(RelativePathPiece dir) const {
+  for (const auto& prefix : excludePrefixes_) {
+    if (!dir.empty() && isAtOrUnder(dir, prefix)) {
+      return true;
+    }
+    if (prefix.isSubDirOf(dir) || (dir.empty() && !prefix.empty())) {
+      return true;
+    }
+  }
+  if (includePrefixes_.empty()) {
+    return false;
+  }
+  // Nothing under an included directory is hidden, except by an exclude.
+  return std::none_of(
+      includePrefixes_.begin(),
+      includePrefixes_.end(),
+      [&](const RelativePath& prefix) { return isAtOrUnder(dir, prefix); });
+}
+
+std::shared_ptr<const Tree> CheckoutFilter::filterTree(
+    std::shared_ptr<const Tree> tree,
+    RelativePathPiece dirPath) const {
+  if (!tree || !mayHideUnder(dirPath)) {
+    return tree;
+  }
+
+  const auto& entries = tree->getTreeEntries();
+  std::vector<TreeEntry> visible;
+  visible.reserve(entries.size());
+  for (const auto& entry : entries) {
+    if (!isHidden(dirPath + entry.getName())) {
+      visible.push_back(entry);
+    }
+  }
+  if (visible.size() == entries.size()) {
+    return tree;
+  }
+  return std::make_shared<const Tree>(std::move(visible), tree->getHash());
+}
+
+} // namespace eden
+} // namespace facebook
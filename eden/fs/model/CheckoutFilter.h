@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class Tree;
+
+/**
+ * Hides the parts of a checkout that its users do not need, so that tools
+ * which wander into the whole tree do not import it.
+ *
+ * A path is hidden if it is at or under one of the exclude prefixes, or if
+ * there are include prefixes and the path is neither at or under one of them
+ * nor a directory leading to one.  Hidden entries are dropped from source
+ * control trees before the checkout uses them, so they cannot be listed or
+ * looked up, checkout and diff ignore them, and their contents are never
+ * fetched.
+ *
+ * An empty filter hides nothing.
+ */
+class CheckoutFilter {
+ public:
+  CheckoutFilter() = default;
+  CheckoutFilter(
+      std::vector<RelativePath> includePrefixes,
+      std::vector<RelativePath> excludePrefixes);
+
+  bool empty() const {
+    return includePrefixes_.empty() && excludePrefixes_.empty();
+  }
+
+  const std::vector<RelativePath>& getIncludePrefixes() const {
+    return includePrefixes_;
+  }
+
+  const std::vector<RelativePath>& getExcludePrefixes() const {
+    return excludePrefixes_;
+  }
+
+  bool isHidden(RelativePathPiece path) const;
+
+  /**
+   * Returns tree itself if none of its entries are hidden, or else a copy of
+   * it, with the same hash, without the hidden entries.  dirPath is the path
+   * of the tree in the checkout.
+   */
+  std::shared_ptr<const Tree> filterTree(
+      std::shared_ptr<const Tree> tree,
+      RelativePathPiece dirPath) const;
+
+ private:
+  /** Whether any path strictly under dir may be hidden. */
+  bool mayHideUnder(RelativePathPiece dir) const;
+
+  std::vector<RelativePath> includePrefixes_;
+  std::vector<RelativePath> excludePrefixes_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/ObjectId.h"
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/hash/Hash.h>
+#include <cstring>
+#include <ostream>
+
+namespace facebook {
+namespace eden {
+
+std::string ObjectId::toString() const {
+  std::string result;
+  folly::hexlify(bytes_, result);
+  return result;
+}
+
+size_t ObjectId::getHashCode() const noexcept {
+  // Ids that are plain Hashes hash the same way Hash does, since they are
+  // already uniformly distributed.
+  if (isHash()) {
+    size_t result;
+    memcpy(&result, bytes_.data(), sizeof(size_t));
+    return result;
+  }
+  return folly::hash::SpookyHashV2::Hash64(bytes_.data(), bytes_.size(), 0);
+}
+
+std::ostream& operator<<(std::ostream& os, const ObjectId& id) {
+  os << id.toString();
+  return os;
+}
+
+void toAppend(const ObjectId& id, std::string* result) {
+  folly::toAppend(id.toString(), result);
+}
+} // namespace eden
+} // namespace facebook
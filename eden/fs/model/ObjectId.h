@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <boost/operators.hpp>
+#include <folly/Range.h>
+#include <iosfwd>
+#include <string>
+
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Immutable, variable-length identifier of a tree or blob.
+ *
+ * Unlike a Hash, an ObjectId can carry whatever a BackingStore needs to find
+ * the object, such as a mercurial node and path, so that fetching it does
+ * not first require looking that information up in the LocalStore.
+ *
+ * An ObjectId of exactly Hash::RAW_SIZE bytes is a plain Hash, as used
+ * before ObjectIds existed.  BackingStores that produce longer ids must start
+ * them with a byte that tells their format apart, and keep reading plain
+ * Hashes the way they always have.
+ */
+class ObjectId : boost::totally_ordered<ObjectId> {
+ public:
+  /**
+   * Create an empty id, which refers to no object.
+   */
+  ObjectId() = default;
+
+  explicit ObjectId(folly::ByteRange bytes)
+      : bytes_{reinterpret_cast<const char*>(bytes.data()), bytes.size()} {}
+
+  explicit ObjectId(std::string bytes) : bytes_{std::move(bytes)} {}
+
+  explicit ObjectId(const Hash& hash) : ObjectId{hash.getBytes()} {}
+
+  folly::ByteRange getBytes() const {
+    return folly::ByteRange{folly::StringPiece{bytes_}};
+  }
+
+  size_t size() const {
+    return bytes_.size();
+  }
+
+  /**
+   * Whether this id is a plain Hash, which asHash() returns.
+   */
+  bool isHash() const {
+    return bytes_.size() == Hash::RAW_SIZE;
+  }
+
+  /**
+   * Returns this id as a Hash.  Throws std::invalid_argument if it is not
+   * one.
+   */
+  Hash asHash() const {
+    return Hash{getBytes()};
+  }
+
+  /** @return lowercase hex representation of this id. */
+  std::string toString() const;
+
+  size_t getHashCode() const noexcept;
+
+  bool operator==(const ObjectId& other) const {
+    return bytes_ == other.bytes_;
+  }
+  bool operator<(const ObjectId& other) const {
+    return bytes_ < other.bytes_;
+  }
+
+ private:
+  std::string bytes_;
+};
+
+/**
+ * Output stream operator for ObjectId.
+ *
+ * This makes it possible to easily use ObjectId in glog statements.
+ */
+std::ostream& operator<<(std::ostream& os, const ObjectId& id);
+
+/* Define toAppend() so folly::to<string>(ObjectId) will work */
+void toAppend(const ObjectId& id, std::string* result);
+} // namespace eden
+} // namespace facebook
+
+namespace std {
+template <>
+struct hash<facebook::eden::ObjectId> {
+  size_t operator()(const facebook::eden::ObjectId& id) const noexcept {
+    return id.getHashCode();
+  }
+};
+} // namespace std
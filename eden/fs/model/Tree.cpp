@@ -7,8 +7,70 @@
 
 #include "Tree.h"
 
+#ifdef _WIN32
+#include <folly/String.h>
+#include <numeric>
+#endif
+
 namespace facebook {
 namespace eden {
+#ifdef _WIN32
+namespace {
+char lowerAscii(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+bool caseInsensitiveLess(folly::StringPiece lhs, folly::StringPiece rhs) {
+  return std::lexicographical_compare(
+      lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b) {
+        return lowerAscii(a) < lowerAscii(b);
+      });
+}
+} // namespace
+
+const TreeEntry* Tree::getEntryPtrCaseInsensitive(
+    PathComponentPiece path) const {
+  folly::call_once(caseInsensitiveIndexOnce_, [this] {
+    caseInsensitiveIndex_.resize(entries_.size());
+    std::iota(caseInsensitiveIndex_.begin(), caseInsensitiveIndex_.end(), 0);
+    // A stable sort keeps entries that only differ in case in their case
+    // sensitive order, so the first match is the same one a scan would find.
+    std::stable_sort(
+        caseInsensitiveIndex_.begin(),
+        caseInsensitiveIndex_.end(),
+        [this](uint32_t a, uint32_t b) {
+          return caseInsensitiveLess(
+              entries_[a].getName().stringPiece(),
+              entries_[b].getName().stringPiece());
+        });
+  });
+
+  const auto fileName = path.stringPiece();
+  auto iter = std::lower_bound(
+      caseInsensitiveIndex_.cbegin(),
+      caseInsensitiveIndex_.cend(),
+      fileName,
+      [this](uint32_t index, folly::StringPiece name) {
+        return caseInsensitiveLess(
+            entries_[index].getName().stringPiece(), name);
+      });
+  if (iter != caseInsensitiveIndex_.cend() &&
+      entries_[*iter].getName().stringPiece().equals(
+          fileName, folly::AsciiCaseInsensitive())) {
+    return &entries_[*iter];
+  }
+  return nullptr;
+}
+#endif
+
+size_t Tree::getSizeBytes() const {
+  size_t size = sizeof(*this) + entries_.capacity() * sizeof(TreeEntry);
+  for (const auto& entry : entries_) {
+    size += entry.getName().stringPiece().size();
+  }
+  return size;
+}
+
 bool operator==(const Tree& tree1, const Tree& tree2) {
   return (tree1.getHash() == tree2.getHash()) &&
       (tree1.getTreeEntries() == tree2.getTreeEntries());
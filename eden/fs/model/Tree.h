@@ -9,6 +9,9 @@
 
 #include <algorithm>
 #include <vector>
+#ifdef _WIN32
+#include <folly/synchronization/CallOnce.h>
+#endif
 #include "Hash.h"
 #include "TreeEntry.h"
 
@@ -45,16 +48,11 @@ class Tree {
       // On Windows we need to do a case insensitive lookup for the file and
       // directory names. For performance, we will do a case sensitive search
       // first which should cover most of the cases and if not found then do a
-      // case sensitive search.
-      const auto& fileName = path.stringPiece();
-      for (const auto& entry : entries_) {
-        if (entry.getName().stringPiece().equals(
-                fileName, folly::AsciiCaseInsensitive())) {
-          return &entry;
-        }
-      }
-#endif
+      // case insensitive search.
+      return getEntryPtrCaseInsensitive(path);
+#else
       return nullptr;
+#endif
     }
     return &*iter;
   }
@@ -68,6 +66,12 @@ class Tree {
     return *entry;
   }
 
+  /**
+   * An estimate of the memory footprint of this tree, used to bound the size
+   * of in-memory tree caches.
+   */
+  size_t getSizeBytes() const;
+
   std::vector<PathComponent> getEntryNames() const {
     std::vector<PathComponent> results;
     results.reserve(entries_.size());
@@ -78,8 +82,22 @@ class Tree {
   }
 
  private:
+#ifdef _WIN32
+  /**
+   * Binary searches the case insensitive index, building it on first use.
+   * Among several matching entries, returns the one that sorts first.
+   */
+  const TreeEntry* getEntryPtrCaseInsensitive(PathComponentPiece path) const;
+#endif
+
   const Hash hash_;
   const std::vector<TreeEntry> entries_;
+#ifdef _WIN32
+  // Indices into entries_, sorted by case insensitive name.  Trees are
+  // immutable and shared between threads, so this is built exactly once.
+  mutable folly::once_flag caseInsensitiveIndexOnce_;
+  mutable std::vector<uint32_t> caseInsensitiveIndex_;
+#endif
 };
 
 bool operator==(const Tree& tree1, const Tree& tree2);
@@ -63,6 +63,13 @@ class TreeEntry {
         size_(size),
         contentSha1_(contentSha1) {}
 
+  /**
+   * Construct an entry whose name has already been validated, by taking the
+   * PathComponent instead of checking a string again.
+   */
+  explicit TreeEntry(const Hash& hash, PathComponent name, TreeEntryType type)
+      : type_(type), hash_(hash), name_(std::move(name)) {}
+
   const Hash& getHash() const {
     return hash_;
   }
@@ -8,6 +8,7 @@
 #include "GitIgnore.h"
 
 #include <algorithm>
+#include <limits>
 #include "GitIgnorePattern.h"
 
 using folly::StringPiece;
@@ -68,20 +69,77 @@ void GitIgnore::loadFile(StringPiece contents) {
   // stop at the first match.
   std::reverse(newRules.begin(), newRules.end());
   std::swap(rules_, newRules);
+
+  exactBasenames_.clear();
+  exactPaths_.clear();
+  basenameSuffixes_.clear();
+  suffixLengths_.clear();
+  otherRules_.clear();
+  for (uint32_t idx = 0; idx < rules_.size(); ++idx) {
+    const auto& rule = rules_[idx];
+    auto literal = rule.getLiteral().str();
+    switch (rule.getLiteralKind()) {
+      case GitIgnorePattern::Literal::EXACT:
+        if (rule.isBasenameOnly()) {
+          exactBasenames_[literal].push_back(idx);
+        } else {
+          exactPaths_[literal].push_back(idx);
+        }
+        break;
+      case GitIgnorePattern::Literal::SUFFIX:
+        suffixLengths_.push_back(literal.size());
+        basenameSuffixes_[literal].push_back(idx);
+        break;
+      case GitIgnorePattern::Literal::NONE:
+        otherRules_.push_back(idx);
+        break;
+    }
+  }
+  std::sort(suffixLengths_.begin(), suffixLengths_.end());
+  suffixLengths_.erase(
+      std::unique(suffixLengths_.begin(), suffixLengths_.end()),
+      suffixLengths_.end());
 }
 
 GitIgnore::MatchResult GitIgnore::match(
     RelativePathPiece path,
     PathComponentPiece basename,
     FileType fileType) const {
-  for (const auto& pattern : rules_) {
-    auto result = pattern.match(path, basename, fileType);
-    if (result != NO_MATCH) {
-      return result;
+  // The rule with the highest precedence that matched so far.
+  auto bestIdx = std::numeric_limits<uint32_t>::max();
+  auto bestResult = NO_MATCH;
+  auto tryRules = [&](const RuleList& rules) {
+    for (auto idx : rules) {
+      if (idx >= bestIdx) {
+        return;
+      }
+      auto result = rules_[idx].match(path, basename, fileType);
+      if (result != NO_MATCH) {
+        bestIdx = idx;
+        bestResult = result;
+        return;
+      }
     }
+  };
+  auto tryLookup = [&](const folly::F14FastMap<std::string, RuleList>& map,
+                       StringPiece key) {
+    auto it = map.find(key);
+    if (it != map.end()) {
+      tryRules(it->second);
+    }
+  };
+
+  tryLookup(exactBasenames_, basename.stringPiece());
+  tryLookup(exactPaths_, path.stringPiece());
+  auto name = basename.stringPiece();
+  for (auto length : suffixLengths_) {
+    if (length > name.size()) {
+      break;
+    }
+    tryLookup(basenameSuffixes_, name.subpiece(name.size() - length));
   }
-
-  return NO_MATCH;
+  tryRules(otherRules_);
+  return bestResult;
 }
 
 string GitIgnore::matchString(MatchResult result) {
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/container/F14Map.h>
+#include <string>
 #include <vector>
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -180,6 +182,22 @@ class GitIgnore {
    * listed in the .gitignore file).
    */
   std::vector<GitIgnorePattern> rules_;
+
+  /*
+   * Indexes into rules_, grouped so that match() only has to try the rules
+   * whose literal text fits the path.  Each list is in precedence order.
+   */
+  using RuleList = std::vector<uint32_t>;
+  /** Rules that match exactly one basename, keyed by it. */
+  folly::F14FastMap<std::string, RuleList> exactBasenames_;
+  /** Rules that match exactly one path, keyed by it. */
+  folly::F14FastMap<std::string, RuleList> exactPaths_;
+  /** Rules that match basenames ending in a literal suffix, keyed by it. */
+  folly::F14FastMap<std::string, RuleList> basenameSuffixes_;
+  /** The distinct lengths of the keys of basenameSuffixes_. */
+  std::vector<size_t> suffixLengths_;
+  /** Rules that have to be tried against every path. */
+  RuleList otherRules_;
 };
 } // namespace eden
 } // namespace facebook
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/git/GitIgnoreCache.h"
+
+namespace facebook {
+namespace eden {
+
+std::shared_ptr<const GitIgnore> GitIgnoreCache::get(const Hash& blobHash) {
+  // Looking up an entry moves it to the front of the eviction order, so this
+  // needs the write lock.
+  auto cache = cache_.wlock();
+  auto it = cache->find(blobHash);
+  if (it == cache->end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+std::shared_ptr<const GitIgnore> GitIgnoreCache::insert(
+    const Hash& blobHash,
+    folly::StringPiece contents) {
+  auto ignore = std::make_shared<GitIgnore>();
+  ignore->loadFile(contents);
+  std::shared_ptr<const GitIgnore> result = std::move(ignore);
+  cache_.wlock()->set(blobHash, result);
+  return result;
+}
+
+} // namespace eden
+} // namespace facebook
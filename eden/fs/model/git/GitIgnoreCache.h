@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <memory>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/git/GitIgnore.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A cache of parsed .gitignore files, keyed by the hash of the blob holding
+ * their contents.
+ *
+ * A repository's .gitignore files rarely change, but every status call reads
+ * and parses each one it walks past.  Sharing the parsed rules across calls,
+ * and across mounts of the same repository, saves redoing that work.
+ *
+ * GitIgnoreCache is thread-safe.
+ */
+class GitIgnoreCache {
+ public:
+  explicit GitIgnoreCache(size_t maxEntries) : cache_{maxEntries} {}
+
+  GitIgnoreCache(const GitIgnoreCache&) = delete;
+  GitIgnoreCache& operator=(const GitIgnoreCache&) = delete;
+
+  /**
+   * Returns the parsed contents of the blob, or nullptr if they are not
+   * cached.
+   */
+  std::shared_ptr<const GitIgnore> get(const Hash& blobHash);
+
+  /**
+   * Parse contents, which must be the contents of the blob, and cache the
+   * result.
+   */
+  std::shared_ptr<const GitIgnore> insert(
+      const Hash& blobHash,
+      folly::StringPiece contents);
+
+ private:
+  folly::Synchronized<
+      folly::EvictingCacheMap<Hash, std::shared_ptr<const GitIgnore>>>
+      cache_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -138,7 +138,22 @@ optional<GitIgnorePattern> GitIgnorePattern::parseLine(StringPiece line) {
     return std::nullopt;
   }
 
-  return GitIgnorePattern(flags, std::move(matcher).value());
+  GitIgnorePattern pattern(flags, std::move(matcher).value());
+
+  // Record any literal text the pattern reduces to.  Patterns with backslash
+  // escapes are left to the GlobMatcher.  Since "*" does not match "/", a
+  // leading "*" is only a plain suffix check when matching basenames.
+  constexpr StringPiece kSpecialChars{"*?[\\"};
+  if (line.find_first_of(kSpecialChars) == StringPiece::npos) {
+    pattern.literalKind_ = Literal::EXACT;
+    pattern.literal_ = line.str();
+  } else if (
+      (flags & FLAG_BASENAME_ONLY) && line.size() > 1 && line[0] == '*' &&
+      line.subpiece(1).find_first_of(kSpecialChars) == StringPiece::npos) {
+    pattern.literalKind_ = Literal::SUFFIX;
+    pattern.literal_ = line.subpiece(1).str();
+  }
+  return pattern;
 }
 
 GitIgnorePattern::GitIgnorePattern(uint32_t flags, GlobMatcher&& matcher)
@@ -9,6 +9,7 @@
 
 #include <folly/Range.h>
 #include <optional>
+#include <string>
 #include "eden/fs/model/git/GitIgnore.h"
 #include "eden/fs/model/git/GlobMatcher.h"
 
@@ -70,6 +71,35 @@ class GitIgnorePattern {
       PathComponentPiece basename,
       GitIgnore::FileType fileType) const;
 
+  /**
+   * How much of the pattern is plain text, which lets GitIgnore look up the
+   * patterns that may match a path instead of trying each one in turn.
+   */
+  enum class Literal {
+    /** The pattern contains wildcards beyond a single leading "*". */
+    NONE,
+    /** The pattern only matches exactly getLiteral(). */
+    EXACT,
+    /** The pattern is "*" followed by getLiteral(). */
+    SUFFIX,
+  };
+
+  Literal getLiteralKind() const {
+    return literalKind_;
+  }
+
+  folly::StringPiece getLiteral() const {
+    return literal_;
+  }
+
+  /**
+   * Returns true if the pattern is matched against a path's basename rather
+   * than against the whole path.
+   */
+  bool isBasenameOnly() const {
+    return flags_ & FLAG_BASENAME_ONLY;
+  }
+
  private:
   /**
    * Flag values that can be bitwise-ORed to create the flags_ value.
@@ -95,6 +125,8 @@ class GitIgnorePattern {
    * The GlobMatcher object for performing matching.
    */
   GlobMatcher matcher_;
+  Literal literalKind_{Literal::NONE};
+  std::string literal_;
 };
 } // namespace eden
 } // namespace facebook
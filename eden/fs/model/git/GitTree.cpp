@@ -65,8 +65,11 @@ std::unique_ptr<Tree> deserializeGitTree(
       throw invalid_argument("Did not parse expected number of octal chars.");
     }
 
-    // Extract the name.
-    auto name = cursor.readTerminatedString();
+    // Extract the name.  Trees in this format are only ever read back from
+    // the LocalStore, which stores the trees that were imported into
+    // TreeEntry objects, so their names were already validated then.
+    auto name = PathComponent{
+        cursor.readTerminatedString(), detail::SkipPathSanityCheck{}};
 
     // Extract the hash.
     Hash::Storage hashBytes;
@@ -21,6 +21,9 @@ class TreeEntry;
 /**
  * Creates an Eden Tree from the serialized version of a Git tree object.
  * As such, the SHA-1 of the gitTreeObject should match the hash.
+ *
+ * The entry names are trusted rather than validated as PathComponents, so
+ * this must only be given trees that Eden serialized itself.
  */
 std::unique_ptr<Tree> deserializeGitTree(
     const Hash& hash,
@@ -91,7 +91,9 @@ bool operator&(GlobOptions a, GlobOptions b) {
 }
 
 GlobMatcher::GlobMatcher(vector<uint8_t> pattern)
-    : pattern_(std::move(pattern)) {}
+    : pattern_(std::move(pattern)) {
+  classifyPattern();
+}
 
 GlobMatcher::GlobMatcher() {}
 
@@ -467,7 +469,59 @@ bool GlobMatcher::addCharClass(
   return false;
 }
 
+void GlobMatcher::classifyPattern() {
+  // Collect the leading run of literal opcodes.
+  string literal;
+  size_t idx = 0;
+  while (idx < pattern_.size() && pattern_[idx] == GLOB_LITERAL) {
+    uint8_t length = pattern_[idx + 1];
+    literal.append(
+        reinterpret_cast<const char*>(pattern_.data() + idx + 2), length);
+    idx += 2 + length;
+  }
+
+  Shape shape = Shape::GENERAL;
+  if (idx == pattern_.size()) {
+    shape = Shape::LITERAL;
+  } else if (
+      idx == 0 && pattern_[0] == GLOB_ENDS_WITH && pattern_[1] == GLOB_TRUE &&
+      pattern_.size() == 3 + size_t{pattern_[2]}) {
+    shape = Shape::SUFFIX;
+    literal.assign(
+        reinterpret_cast<const char*>(pattern_.data() + 3), pattern_[2]);
+  } else if (idx + 2 == pattern_.size() && pattern_[idx + 1] == GLOB_TRUE) {
+    if (pattern_[idx] == GLOB_STAR) {
+      shape = Shape::PREFIX;
+    } else if (pattern_[idx] == GLOB_STAR_STAR_END) {
+      shape = Shape::PREFIX_ANY;
+    }
+  }
+
+  if (shape != Shape::GENERAL) {
+    shape_ = shape;
+    literal_ = std::move(literal);
+  }
+}
+
 bool GlobMatcher::match(StringPiece text) const {
+  // Most ignore patterns are plain strings or simple "*.ext" and "dir/*"
+  // patterns.  Check these with memcmp() and memchr(), which are much faster
+  // than stepping through the opcodes one byte at a time.
+  switch (shape_) {
+    case Shape::GENERAL:
+      break;
+    case Shape::LITERAL:
+      return text == literal_;
+    case Shape::SUFFIX:
+      return text.endsWith(literal_) &&
+          text.subpiece(0, text.size() - literal_.size()).find('/') ==
+          StringPiece::npos;
+    case Shape::PREFIX:
+      return text.startsWith(literal_) &&
+          text.subpiece(literal_.size()).find('/') == StringPiece::npos;
+    case Shape::PREFIX_ANY:
+      return text.startsWith(literal_);
+  }
   return tryMatchAt(text, 0, 0);
 }
 
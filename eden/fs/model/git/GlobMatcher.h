@@ -10,6 +10,7 @@
 #include <folly/Expected.h>
 #include <folly/Range.h>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 namespace facebook {
@@ -77,8 +78,33 @@ class GlobMatcher {
   bool match(folly::StringPiece text) const;
 
  private:
+  /**
+   * Simple pattern shapes that match() checks with plain string comparisons,
+   * without interpreting the opcodes in pattern_.
+   */
+  enum class Shape : uint8_t {
+    // Any other pattern.  Matched by tryMatchAt().
+    GENERAL,
+    // A literal string with no wildcards, e.g. "foo/bar".
+    LITERAL,
+    // A '*' followed by a literal, e.g. "*.txt".
+    SUFFIX,
+    // A literal followed by a '*', e.g. "foo*".
+    PREFIX,
+    // A literal followed by a trailing '**', e.g. "foo/**".
+    PREFIX_ANY,
+  };
+
   explicit GlobMatcher(std::vector<uint8_t> pattern);
 
+  /**
+   * Set shape_ and literal_ if pattern_ has one of the simple shapes.
+   *
+   * Patterns whose wildcards may not match a leading '.' are always left as
+   * Shape::GENERAL.
+   */
+  void classifyPattern();
+
   static folly::Expected<size_t, std::string> parseBracketExpr(
       folly::StringPiece glob,
       size_t idx,
@@ -117,6 +143,13 @@ class GlobMatcher {
    * rather than heap-allocating them in a vector.
    */
   std::vector<uint8_t> pattern_;
+
+  /**
+   * The shape of pattern_, and for shapes other than Shape::GENERAL the
+   * concatenation of its literal data.
+   */
+  Shape shape_{Shape::GENERAL};
+  std::string literal_;
 };
 } // namespace eden
 } // namespace facebook
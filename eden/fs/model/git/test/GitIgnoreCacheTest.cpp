@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/git/GitIgnoreCache.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+namespace {
+const Hash kHash1{"0000000000000000000000000000000000000001"};
+const Hash kHash2{"0000000000000000000000000000000000000002"};
+const Hash kHash3{"0000000000000000000000000000000000000003"};
+} // namespace
+
+TEST(GitIgnoreCache, returnsInsertedRules) {
+  GitIgnoreCache cache{2};
+  EXPECT_EQ(nullptr, cache.get(kHash1));
+
+  auto inserted = cache.insert(kHash1, "*.o\n");
+  EXPECT_EQ(
+      GitIgnore::EXCLUDE,
+      inserted->match(RelativePathPiece{"foo.o"}, GitIgnore::TYPE_FILE));
+  EXPECT_EQ(inserted, cache.get(kHash1));
+}
+
+TEST(GitIgnoreCache, evictsLeastRecentlyUsed) {
+  GitIgnoreCache cache{2};
+  cache.insert(kHash1, "a\n");
+  cache.insert(kHash2, "b\n");
+  // Using kHash1 makes kHash2 the next entry to be evicted.
+  EXPECT_NE(nullptr, cache.get(kHash1));
+  cache.insert(kHash3, "c\n");
+
+  EXPECT_NE(nullptr, cache.get(kHash1));
+  EXPECT_EQ(nullptr, cache.get(kHash2));
+  EXPECT_NE(nullptr, cache.get(kHash3));
+}
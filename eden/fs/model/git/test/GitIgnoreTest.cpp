@@ -666,3 +666,41 @@ TEST(GitIgnore, directory) {
   // path known to be a file.  It expects ignored directories earlier in the
   // path to have already been filtered out.
 }
+
+TEST(GitIgnore, literalPatternPrecedence) {
+  // Mix patterns that GitIgnore looks up by their literal text with ones it
+  // has to try against every path, and make sure the last matching rule in
+  // the file still wins.
+  GitIgnore ignore;
+  ignore.loadFile(
+      "*.txt\n"
+      "!keep*\n"
+      "keep.txt\n"
+      "!*_test.txt\n"
+      "/top/fixed.txt\n"
+      "!fixed.txt\n"
+      "out\n"
+      "!out/\n");
+
+  EXPECT_IGNORE(ignore, EXCLUDE, "notes.txt");
+  EXPECT_IGNORE(ignore, EXCLUDE, "src/notes.txt");
+  EXPECT_IGNORE(ignore, EXCLUDE, ".txt");
+  EXPECT_IGNORE(ignore, NO_MATCH, "notes.txt2");
+  EXPECT_IGNORE(ignore, INCLUDE, "keeper.txt");
+  EXPECT_IGNORE(ignore, EXCLUDE, "keep.txt");
+  EXPECT_IGNORE(ignore, INCLUDE, "unit_test.txt");
+  EXPECT_IGNORE(ignore, INCLUDE, "src/unit_test.txt");
+  EXPECT_IGNORE(ignore, INCLUDE, "top/fixed.txt");
+  EXPECT_IGNORE(ignore, INCLUDE, "other/fixed.txt");
+  EXPECT_IGNORE(ignore, EXCLUDE, "top/other.txt");
+  EXPECT_IGNORE(ignore, EXCLUDE, "out");
+  EXPECT_IGNORE_DIR(ignore, INCLUDE, "out");
+  EXPECT_IGNORE_DIR(ignore, INCLUDE, "src/out");
+  EXPECT_IGNORE(ignore, NO_MATCH, "output");
+
+  // Reloading replaces all of the rules.
+  ignore.loadFile("/top/fixed.txt\n");
+  EXPECT_IGNORE(ignore, EXCLUDE, "top/fixed.txt");
+  EXPECT_IGNORE(ignore, NO_MATCH, "other/fixed.txt");
+  EXPECT_IGNORE(ignore, NO_MATCH, "notes.txt");
+}
@@ -211,6 +211,30 @@ GBENCHMARK(endswith_fixed)(benchmark::State& state) {
   runBenchmark<EndsWithImpl>(state, ".txt", basenameCorpus);
 }
 
+GBENCHMARK(prefix_globmatch)(benchmark::State& state) {
+  runBenchmark<GlobMatcherImpl>(state, "foobar*", basenameCorpus);
+}
+
+GBENCHMARK(prefix_wildmatch)(benchmark::State& state) {
+  runBenchmark<WildmatchImpl>(state, "foobar*", basenameCorpus);
+}
+
+GBENCHMARK(prefix_re2)(benchmark::State& state) {
+  runBenchmark<RE2Impl>(state, "foobar[^/]*", basenameCorpus);
+}
+
+GBENCHMARK(dirPrefix_globmatch)(benchmark::State& state) {
+  runBenchmark<GlobMatcherImpl>(state, "Documentation/**", fullnameCorpus);
+}
+
+GBENCHMARK(dirPrefix_wildmatch)(benchmark::State& state) {
+  runBenchmark<WildmatchImpl>(state, "Documentation/**", fullnameCorpus);
+}
+
+GBENCHMARK(dirPrefix_re2)(benchmark::State& state) {
+  runBenchmark<RE2Impl>(state, "Documentation/.*", fullnameCorpus);
+}
+
 GBENCHMARK(basenameGlob_globmatch)(benchmark::State& state) {
   runBenchmark<GlobMatcherImpl>(state, ".*.swp", basenameCorpus);
 }
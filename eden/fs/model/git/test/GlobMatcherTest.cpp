@@ -328,6 +328,47 @@ TEST(Glob, testOther) {
   EXPECT_NOMATCH("foo\x9atest", "foo[\xa0-\xaf]test");
 }
 
+TEST(Glob, testSimpleShapes) {
+  // Literal patterns, including ones split into multiple literal opcodes.
+  EXPECT_MATCH("foo/bar", "foo/bar");
+  EXPECT_NOMATCH("foo/ba", "foo/bar");
+  EXPECT_NOMATCH("foo/barr", "foo/bar");
+  std::string longLiteral(600, 'x');
+  EXPECT_MATCH(longLiteral, longLiteral);
+  EXPECT_NOMATCH(longLiteral + "x", longLiteral);
+  EXPECT_NOMATCH(longLiteral.substr(1), longLiteral);
+
+  // Suffix patterns
+  EXPECT_MATCH("foo.txt", "*.txt");
+  EXPECT_MATCH(".txt", "*.txt");
+  EXPECT_NOMATCH("txt", "*.txt");
+  EXPECT_NOMATCH("foo/bar.txt", "*.txt");
+  EXPECT_MATCH("foo/bar.txt", "*/bar.txt");
+  EXPECT_NOMATCH("a/foo/bar.txt", "*/bar.txt");
+  EXPECT_IGNORE_DOTFILES_MATCH("foo.txt", "*.txt");
+  EXPECT_IGNORE_DOTFILES_NOMATCH(".foo.txt", "*.txt");
+
+  // Prefix patterns
+  EXPECT_MATCH("foo", "foo*");
+  EXPECT_MATCH("foo.bar", "foo*");
+  EXPECT_NOMATCH("fo", "foo*");
+  EXPECT_NOMATCH("foo/bar", "foo*");
+  EXPECT_MATCH("foo/", "foo/*");
+  EXPECT_MATCH("foo/.bar", "foo/*");
+  EXPECT_NOMATCH("foo/bar/baz", "foo/*");
+  EXPECT_MATCH("anything", "*");
+  EXPECT_NOMATCH("any/thing", "*");
+  EXPECT_IGNORE_DOTFILES_NOMATCH("foo/.bar", "foo/*");
+
+  // Prefix patterns ending in "**"
+  EXPECT_MATCH("foo/bar", "foo/**");
+  EXPECT_MATCH("foo/bar/.baz", "foo/**");
+  EXPECT_MATCH("foo/", "foo/**");
+  EXPECT_NOMATCH("foo", "foo/**");
+  EXPECT_NOMATCH("foobar/baz", "foo/**");
+  EXPECT_IGNORE_DOTFILES_NOMATCH("foo/bar/.baz", "foo/**");
+}
+
 void testCharClass(StringPiece name, int (*libcFn)(int)) {
   auto matcher =
       GlobMatcher::create("[[:" + name.str() + ":]]", GlobOptions::DEFAULT)
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/CheckoutFilter.h"
+
+#include <gtest/gtest.h>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/model/TreeEntry.h"
+
+using namespace facebook::eden;
+
+namespace {
+Hash testHash(folly::StringPiece data) {
+  return Hash::sha1(data);
+}
+
+std::shared_ptr<const Tree> makeTree(std::vector<std::string> names) {
+  std::vector<TreeEntry> entries;
+  for (const auto& name : names) {
+    entries.emplace_back(
+        testHash(name), PathComponent{name}, TreeEntryType::TREE);
+  }
+  return std::make_shared<const Tree>(std::move(entries), testHash("tree"));
+}
+
+std::vector<std::string> entryNames(const Tree& tree) {
+  std::vector<std::string> names;
+  for (const auto& entry : tree.getTreeEntries()) {
+    names.push_back(entry.getName().stringPiece().str());
+  }
+  return names;
+}
+
+CheckoutFilter makeFilter(
+    std::vector<std::string> includes,
+    std::vector<std::string> excludes) {
+  std::vector<RelativePath> includePaths;
+  for (const auto& path : includes) {
+    includePaths.emplace_back(path);
+  }
+  std::vector<RelativePath> excludePaths;
+  for (const auto& path : excludes) {
+    excludePaths.emplace_back(path);
+  }
+  return CheckoutFilter{std::move(includePaths), std::move(excludePaths)};
+}
+} // namespace
+
+TEST(CheckoutFilter, emptyFilterHidesNothing) {
+  CheckoutFilter filter;
+  EXPECT_TRUE(filter.empty());
+  EXPECT_FALSE(filter.isHidden(RelativePathPiece{"a/b"}));
+
+  auto tree = makeTree({"a", "b"});
+  EXPECT_EQ(tree, filter.filterTree(tree, RelativePathPiece{}));
+}
+
+TEST(CheckoutFilter, excludesHideTheirSubtrees) {
+  auto filter = makeFilter({}, {"a/big"});
+  EXPECT_FALSE(filter.isHidden(RelativePathPiece{"a"}));
+  EXPECT_TRUE(filter.isHidden(RelativePathPiece{"a/big"}));
+  EXPECT_TRUE(filter.isHidden(RelativePathPiece{"a/big/c"}));
+  EXPECT_FALSE(filter.isHidden(RelativePathPiece{"a/bigger"}));
+
+  auto tree = makeTree({"big", "bigger", "small"});
+  auto filtered = filter.filterTree(tree, RelativePathPiece{"a"});
+  EXPECT_EQ(
+      (std::vector<std::string>{"bigger", "small"}), entryNames(*filtered));
+  EXPECT_EQ(tree->getHash(), filtered->getHash());
+
+  // Directories that cannot contain an exclude are returned unchanged.
+  EXPECT_EQ(tree, filter.filterTree(tree, RelativePathPiece{"b"}));
+}
+
+TEST(CheckoutFilter, includesHideEverythingElse) {
+  auto filter = makeFilter({"a/b", "c"}, {"c/out"});
+  EXPECT_FALSE(filter.isHidden(RelativePathPiece{"a"}));
+  EXPECT_FALSE(filter.isHidden(RelativePathPiece{"a/b"}));
+  EXPECT_FALSE(filter.isHidden(RelativePathPiece{"a/b/d/e"}));
+  EXPECT_TRUE(filter.isHidden(RelativePathPiece{"a/x"}));
+  EXPECT_TRUE(filter.isHidden(RelativePathPiece{"d"}));
+  EXPECT_FALSE(filter.isHidden(RelativePathPiece{"c/in"}));
+  EXPECT_TRUE(filter.isHidden(RelativePathPiece{"c/out"}));
+
+  auto root = makeTree({"a", "c", "d"});
+  EXPECT_EQ(
+      (std::vector<std::string>{"a", "c"}),
+      entryNames(*filter.filterTree(root, RelativePathPiece{})));
+
+  auto a = makeTree({"b", "x"});
+  EXPECT_EQ(
+      std::vector<std::string>{"b"},
+      entryNames(*filter.filterTree(a, RelativePathPiece{"a"})));
+
+  auto b = makeTree({"d", "e"});
+  EXPECT_EQ(b, filter.filterTree(b, RelativePathPiece{"a/b"}));
+
+  auto c = makeTree({"in", "out"});
+  EXPECT_EQ(
+      std::vector<std::string>{"in"},
+      entryNames(*filter.filterTree(c, RelativePathPiece{"c"})));
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/ObjectId.h"
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+#include <unordered_set>
+
+using namespace facebook::eden;
+using folly::StringPiece;
+
+namespace {
+Hash testHash(StringPiece{"faceb00cdeadbeefc00010ff1badb0028badf00d"});
+} // namespace
+
+TEST(ObjectId, hashRoundTrips) {
+  ObjectId id{testHash};
+  EXPECT_TRUE(id.isHash());
+  EXPECT_EQ(Hash::RAW_SIZE, id.size());
+  EXPECT_EQ(testHash, id.asHash());
+  EXPECT_EQ(testHash.toString(), id.toString());
+  EXPECT_EQ(testHash.getHashCode(), id.getHashCode());
+}
+
+TEST(ObjectId, variableLength) {
+  ObjectId id{std::string{"\x01node-and-path", 14}};
+  EXPECT_FALSE(id.isHash());
+  EXPECT_EQ(14, id.size());
+  EXPECT_EQ("016e6f64652d616e642d70617468", id.toString());
+  EXPECT_THROW(id.asHash(), std::invalid_argument);
+  EXPECT_EQ("016e6f64652d616e642d70617468", folly::to<std::string>(id));
+}
+
+TEST(ObjectId, compareAndHash) {
+  ObjectId empty;
+  ObjectId hash{testHash};
+  ObjectId longer{testHash.toString()};
+  EXPECT_EQ(0, empty.size());
+  EXPECT_NE(hash, longer);
+  EXPECT_LT(empty, hash);
+  EXPECT_EQ(hash, ObjectId{testHash.getBytes()});
+
+  std::unordered_set<ObjectId> ids{empty, hash, longer};
+  EXPECT_EQ(3, ids.size());
+  EXPECT_EQ(1, ids.count(ObjectId{testHash}));
+}
@@ -67,3 +67,26 @@ TEST(Tree, testGetEntryPtr) {
   PathComponentPiece nonExistentPath("not_a_file");
   EXPECT_EQ(nullptr, tree.getEntryPtr(nonExistentPath));
 }
+
+#ifdef _WIN32
+TEST(Tree, testGetEntryPtrCaseInsensitiveOrder) {
+  // '_' sorts between the upper and lower case letters, so the case
+  // sensitive and case insensitive orders of these names differ.
+  vector<TreeEntry> entries;
+  for (auto name : {"B_dir", "Zebra", "_under", "apple", "b_dir", "m_file"}) {
+    entries.emplace_back(testHash, name, TreeEntryType::REGULAR_FILE);
+  }
+  Tree tree(std::move(entries));
+
+  EXPECT_EQ("apple", tree.getEntryPtr(PathComponentPiece("APPLE"))->getName());
+  EXPECT_EQ("Zebra", tree.getEntryPtr(PathComponentPiece("zebra"))->getName());
+  EXPECT_EQ(
+      "_under", tree.getEntryPtr(PathComponentPiece("_UNDER"))->getName());
+  EXPECT_EQ(
+      "m_file", tree.getEntryPtr(PathComponentPiece("M_FILE"))->getName());
+  // Both B_dir and b_dir match; the one that sorts first wins.
+  EXPECT_EQ("B_dir", tree.getEntryPtr(PathComponentPiece("b_DIR"))->getName());
+  EXPECT_EQ(nullptr, tree.getEntryPtr(PathComponentPiece("ZEBRAS")));
+  EXPECT_EQ(nullptr, tree.getEntryPtr(PathComponentPiece("_")));
+}
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/nfs/Nfsd3.h"
+
+#include <folly/logging/xlog.h>
+#include <limits>
+
+#include "eden/fs/fuse/Dispatcher.h"
+#include "eden/fs/nfs/NfsdRpc.h"
+#include "eden/fs/store/ObjectFetchContext.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+class Nfsd3ServerProcessor : public RpcServerProcessor {
+ public:
+  Nfsd3ServerProcessor(Dispatcher* dispatcher, uint32_t iosize)
+      : dispatcher_(dispatcher), iosize_(iosize) {}
+
+  folly::Future<folly::Unit> dispatchRpc(
+      folly::io::Cursor deser,
+      folly::io::QueueAppender ser,
+      uint32_t xid,
+      uint32_t progNumber,
+      uint32_t progVersion,
+      uint32_t procNumber) override;
+
+ private:
+  // The arguments are decoded by dispatchRpc(), so that it can still reply
+  // GARBAGE_ARGS with ser.
+  folly::Future<folly::Unit>
+  getattr(nfs_fh3 fh, folly::io::QueueAppender ser, uint32_t xid);
+  folly::Future<folly::Unit> fsinfo(folly::io::QueueAppender ser, uint32_t xid);
+
+  Dispatcher* const dispatcher_;
+  const uint32_t iosize_;
+};
+
+/**
+ * The status of a Dispatcher call that failed with ew: the errno of a
+ * system_error, or NFS3ERR_SERVERFAULT for anything else.
+ */
+nfsstat3 exceptionToNfsstat3(const folly::exception_wrapper& ew) {
+  if (auto* err = ew.get_exception<std::system_error>()) {
+    if (err->code().category() == std::system_category() ||
+        err->code().category() == std::generic_category()) {
+      return errnoToNfsstat3(err->code().value());
+    }
+  }
+  return nfsstat3::NFS3ERR_SERVERFAULT;
+}
+
+folly::Future<folly::Unit> Nfsd3ServerProcessor::getattr(
+    nfs_fh3 fh,
+    folly::io::QueueAppender ser,
+    uint32_t xid) {
+  return folly::makeFutureWith([&] {
+           return dispatcher_->getattr(
+               fh.ino, ObjectFetchContext::getNullContext());
+         })
+      .thenTry([ser = std::move(ser),
+                xid](folly::Try<Dispatcher::Attr>&& attr) mutable {
+        serializeReply(ser, accept_stat::SUCCESS, xid);
+        if (attr.hasException()) {
+          xdrSerialize(ser, exceptionToNfsstat3(attr.exception()));
+          return;
+        }
+        xdrSerialize(ser, nfsstat3::NFS3_OK);
+        xdrSerialize(ser, statToFattr3(attr->st));
+      });
+}
+
+folly::Future<folly::Unit> Nfsd3ServerProcessor::fsinfo(
+    folly::io::QueueAppender ser,
+    uint32_t xid) {
+  FSINFO3resok res;
+  res.rtmax = iosize_;
+  res.rtpref = iosize_;
+  res.rtmult = 1;
+  res.wtmax = iosize_;
+  res.wtpref = iosize_;
+  res.wtmult = 1;
+  res.dtpref = iosize_;
+  res.maxfilesize = std::numeric_limits<int64_t>::max();
+  res.time_delta = nfstime3{0, 1};
+  res.properties = FSF3_SYMLINK | FSF3_HOMOGENEOUS | FSF3_CANSETTIME;
+
+  serializeReply(ser, accept_stat::SUCCESS, xid);
+  xdrSerialize(ser, nfsstat3::NFS3_OK);
+  xdrSerialize(ser, res);
+  return folly::unit;
+}
+
+folly::Future<folly::Unit> Nfsd3ServerProcessor::dispatchRpc(
+    folly::io::Cursor deser,
+    folly::io::QueueAppender ser,
+    uint32_t xid,
+    uint32_t progNumber,
+    uint32_t progVersion,
+    uint32_t procNumber) {
+  if (progNumber != kNfsdProgNumber) {
+    serializeReply(ser, accept_stat::PROG_UNAVAIL, xid);
+    return folly::unit;
+  }
+  if (progVersion != kNfsd3ProgVersion) {
+    serializeReply(ser, accept_stat::PROG_MISMATCH, xid);
+    xdrSerialize(ser, mismatch_info{kNfsd3ProgVersion, kNfsd3ProgVersion});
+    return folly::unit;
+  }
+
+  XLOG(DBG7) << "NFS call " << procNumber << " xid " << xid;
+  try {
+    switch (static_cast<nfsv3Procs>(procNumber)) {
+      case nfsv3Procs::null:
+        serializeReply(ser, accept_stat::SUCCESS, xid);
+        return folly::unit;
+      case nfsv3Procs::getattr: {
+        auto fh = xdrDeserialize<nfs_fh3>(deser);
+        return getattr(fh, std::move(ser), xid);
+      }
+      case nfsv3Procs::fsinfo:
+        // Every handle is in the same file system, so the answer is the same.
+        xdrDeserialize<nfs_fh3>(deser);
+        return fsinfo(std::move(ser), xid);
+      default:
+        serializeReply(ser, accept_stat::PROC_UNAVAIL, xid);
+        return folly::unit;
+    }
+  } catch (const std::out_of_range&) {
+    serializeReply(ser, accept_stat::GARBAGE_ARGS, xid);
+  } catch (const std::invalid_argument&) {
+    serializeReply(ser, accept_stat::GARBAGE_ARGS, xid);
+  }
+  return folly::unit;
+}
+} // namespace
+
+Nfsd3::Nfsd3(
+    folly::EventBase* evb,
+    std::shared_ptr<folly::Executor> threadPool,
+    Dispatcher* dispatcher,
+    uint32_t iosize)
+    : server_(
+          std::make_shared<Nfsd3ServerProcessor>(dispatcher, iosize),
+          evb,
+          std::move(threadPool)) {}
+
+void Nfsd3::initialize(folly::SocketAddress addr) {
+  server_.initialize(std::move(addr));
+}
+
+} // namespace eden
+} // namespace facebook
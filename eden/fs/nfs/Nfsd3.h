@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include "eden/fs/nfs/RpcServer.h"
+
+namespace facebook {
+namespace eden {
+
+class Dispatcher;
+
+/**
+ * An NFS version 3 server for one mount, as an alternative to FuseChannel
+ * where FUSE is slow, which is mostly macOS.
+ *
+ * Calls are decoded on the thread pool and handed to the same Dispatcher
+ * that serves FUSE requests, so the inode layer cannot tell the two apart.
+ * The file handles are the inode numbers that Dispatcher already uses.
+ *
+ * So far this answers NULL, GETATTR and FSINFO, and PROC_UNAVAIL to the
+ * other procedures.
+ */
+class Nfsd3 {
+ public:
+  /**
+   * iosize is the largest READ, WRITE and READDIR(PLUS) reply that clients
+   * are told to ask for, which they are free to use as their rsize and wsize.
+   */
+  Nfsd3(
+      folly::EventBase* evb,
+      std::shared_ptr<folly::Executor> threadPool,
+      Dispatcher* dispatcher,
+      uint32_t iosize);
+
+  /** Start listening on addr; see RpcServer::initialize(). */
+  void initialize(folly::SocketAddress addr);
+
+  folly::SocketAddress getAddr() const {
+    return server_.getAddr();
+  }
+
+ private:
+  RpcServer server_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/nfs/NfsdRpc.h"
+
+#include <errno.h>
+#include <sys/types.h>
+
+#include "eden/fs/utils/StatTimes.h"
+
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+namespace facebook {
+namespace eden {
+
+namespace {
+nfstime3 timespecToNfstime3(const struct timespec& ts) {
+  return nfstime3{
+      static_cast<uint32_t>(ts.tv_sec), static_cast<uint32_t>(ts.tv_nsec)};
+}
+
+ftype3 modeToFtype3(mode_t mode) {
+  switch (mode & S_IFMT) {
+    case S_IFDIR:
+      return ftype3::NF3DIR;
+    case S_IFBLK:
+      return ftype3::NF3BLK;
+    case S_IFCHR:
+      return ftype3::NF3CHR;
+    case S_IFLNK:
+      return ftype3::NF3LNK;
+    case S_IFSOCK:
+      return ftype3::NF3SOCK;
+    case S_IFIFO:
+      return ftype3::NF3FIFO;
+    default:
+      return ftype3::NF3REG;
+  }
+}
+} // namespace
+
+nfsstat3 errnoToNfsstat3(int errnum) {
+  switch (errnum) {
+    case 0:
+      return nfsstat3::NFS3_OK;
+    case EPERM:
+      return nfsstat3::NFS3ERR_PERM;
+    case ENOENT:
+      return nfsstat3::NFS3ERR_NOENT;
+    case ENXIO:
+      return nfsstat3::NFS3ERR_NXIO;
+    case EACCES:
+      return nfsstat3::NFS3ERR_ACCES;
+    case EEXIST:
+      return nfsstat3::NFS3ERR_EXIST;
+    case EXDEV:
+      return nfsstat3::NFS3ERR_XDEV;
+    case ENODEV:
+      return nfsstat3::NFS3ERR_NODEV;
+    case ENOTDIR:
+      return nfsstat3::NFS3ERR_NOTDIR;
+    case EISDIR:
+      return nfsstat3::NFS3ERR_ISDIR;
+    case EINVAL:
+      return nfsstat3::NFS3ERR_INVAL;
+    case EFBIG:
+      return nfsstat3::NFS3ERR_FBIG;
+    case ENOSPC:
+      return nfsstat3::NFS3ERR_NOSPC;
+    case EROFS:
+      return nfsstat3::NFS3ERR_ROFS;
+    case EMLINK:
+      return nfsstat3::NFS3ERR_MLINK;
+    case ENAMETOOLONG:
+      return nfsstat3::NFS3ERR_NAMETOOLONG;
+    case ENOTEMPTY:
+      return nfsstat3::NFS3ERR_NOTEMPTY;
+    case EDQUOT:
+      return nfsstat3::NFS3ERR_DQUOT;
+    case ESTALE:
+      return nfsstat3::NFS3ERR_STALE;
+    case ENOTSUP:
+      return nfsstat3::NFS3ERR_NOTSUPP;
+    default:
+      return nfsstat3::NFS3ERR_IO;
+  }
+}
+
+fattr3 statToFattr3(const struct stat& st) {
+  fattr3 attr;
+  attr.type = modeToFtype3(st.st_mode);
+  attr.mode = st.st_mode & 07777;
+  attr.nlink = st.st_nlink;
+  attr.uid = st.st_uid;
+  attr.gid = st.st_gid;
+  attr.size = st.st_size;
+  attr.used = static_cast<uint64_t>(st.st_blocks) * 512;
+  attr.rdev = specdata3{
+      static_cast<uint32_t>(major(st.st_rdev)),
+      static_cast<uint32_t>(minor(st.st_rdev))};
+  attr.fsid = st.st_dev;
+  attr.fileid = st.st_ino;
+  attr.atime = timespecToNfstime3(stAtime(st));
+  attr.mtime = timespecToNfstime3(stMtime(st));
+  attr.ctime = timespecToNfstime3(stCtime(st));
+  return attr;
+}
+
+void XdrTrait<nfs_fh3>::serialize(
+    folly::io::QueueAppender& appender,
+    const nfs_fh3& value) {
+  xdrSerialize(appender, uint32_t{sizeof(uint64_t)});
+  xdrSerialize(appender, value.ino.get());
+}
+
+nfs_fh3 XdrTrait<nfs_fh3>::deserialize(folly::io::Cursor& cursor) {
+  auto length = xdrDeserialize<uint32_t>(cursor);
+  if (length != sizeof(uint64_t)) {
+    throw std::invalid_argument("NFS file handle is not an Eden handle");
+  }
+  return nfs_fh3{InodeNumber{xdrDeserialize<uint64_t>(cursor)}};
+}
+
+void XdrTrait<specdata3>::serialize(
+    folly::io::QueueAppender& appender,
+    const specdata3& value) {
+  xdrSerialize(appender, value.specdata1);
+  xdrSerialize(appender, value.specdata2);
+}
+
+specdata3 XdrTrait<specdata3>::deserialize(folly::io::Cursor& cursor) {
+  specdata3 value;
+  value.specdata1 = xdrDeserialize<uint32_t>(cursor);
+  value.specdata2 = xdrDeserialize<uint32_t>(cursor);
+  return value;
+}
+
+void XdrTrait<nfstime3>::serialize(
+    folly::io::QueueAppender& appender,
+    const nfstime3& value) {
+  xdrSerialize(appender, value.seconds);
+  xdrSerialize(appender, value.nseconds);
+}
+
+nfstime3 XdrTrait<nfstime3>::deserialize(folly::io::Cursor& cursor) {
+  nfstime3 value;
+  value.seconds = xdrDeserialize<uint32_t>(cursor);
+  value.nseconds = xdrDeserialize<uint32_t>(cursor);
+  return value;
+}
+
+void XdrTrait<fattr3>::serialize(
+    folly::io::QueueAppender& appender,
+    const fattr3& value) {
+  xdrSerialize(appender, value.type);
+  xdrSerialize(appender, value.mode);
+  xdrSerialize(appender, value.nlink);
+  xdrSerialize(appender, value.uid);
+  xdrSerialize(appender, value.gid);
+  xdrSerialize(appender, value.size);
+  xdrSerialize(appender, value.used);
+  xdrSerialize(appender, value.rdev);
+  xdrSerialize(appender, value.fsid);
+  xdrSerialize(appender, value.fileid);
+  xdrSerialize(appender, value.atime);
+  xdrSerialize(appender, value.mtime);
+  xdrSerialize(appender, value.ctime);
+}
+
+fattr3 XdrTrait<fattr3>::deserialize(folly::io::Cursor& cursor) {
+  fattr3 value;
+  value.type = xdrDeserialize<ftype3>(cursor);
+  value.mode = xdrDeserialize<uint32_t>(cursor);
+  value.nlink = xdrDeserialize<uint32_t>(cursor);
+  value.uid = xdrDeserialize<uint32_t>(cursor);
+  value.gid = xdrDeserialize<uint32_t>(cursor);
+  value.size = xdrDeserialize<uint64_t>(cursor);
+  value.used = xdrDeserialize<uint64_t>(cursor);
+  value.rdev = xdrDeserialize<specdata3>(cursor);
+  value.fsid = xdrDeserialize<uint64_t>(cursor);
+  value.fileid = xdrDeserialize<uint64_t>(cursor);
+  value.atime = xdrDeserialize<nfstime3>(cursor);
+  value.mtime = xdrDeserialize<nfstime3>(cursor);
+  value.ctime = xdrDeserialize<nfstime3>(cursor);
+  return value;
+}
+
+void XdrTrait<FSINFO3resok>::serialize(
+    folly::io::QueueAppender& appender,
+    const FSINFO3resok& value) {
+  xdrSerialize(appender, value.obj_attributes);
+  xdrSerialize(appender, value.rtmax);
+  xdrSerialize(appender, value.rtpref);
+  xdrSerialize(appender, value.rtmult);
+  xdrSerialize(appender, value.wtmax);
+  xdrSerialize(appender, value.wtpref);
+  xdrSerialize(appender, value.wtmult);
+  xdrSerialize(appender, value.dtpref);
+  xdrSerialize(appender, value.maxfilesize);
+  xdrSerialize(appender, value.time_delta);
+  xdrSerialize(appender, value.properties);
+}
+
+FSINFO3resok XdrTrait<FSINFO3resok>::deserialize(folly::io::Cursor& cursor) {
+  FSINFO3resok value;
+  value.obj_attributes = xdrDeserialize<post_op_attr>(cursor);
+  value.rtmax = xdrDeserialize<uint32_t>(cursor);
+  value.rtpref = xdrDeserialize<uint32_t>(cursor);
+  value.rtmult = xdrDeserialize<uint32_t>(cursor);
+  value.wtmax = xdrDeserialize<uint32_t>(cursor);
+  value.wtpref = xdrDeserialize<uint32_t>(cursor);
+  value.wtmult = xdrDeserialize<uint32_t>(cursor);
+  value.dtpref = xdrDeserialize<uint32_t>(cursor);
+  value.maxfilesize = xdrDeserialize<uint64_t>(cursor);
+  value.time_delta = xdrDeserialize<nfstime3>(cursor);
+  value.properties = xdrDeserialize<uint32_t>(cursor);
+  return value;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <sys/stat.h>
+#include <optional>
+
+#include "eden/fs/fuse/InodeNumber.h"
+#include "eden/fs/nfs/Rpc.h"
+
+// The NFS version 3 protocol, as specified in RFC 1813.  As in Rpc.h, the
+// names follow the RFC.
+
+namespace facebook {
+namespace eden {
+
+constexpr uint32_t kNfsdProgNumber = 100003;
+constexpr uint32_t kNfsd3ProgVersion = 3;
+
+enum class nfsv3Procs : uint32_t {
+  null = 0,
+  getattr = 1,
+  setattr = 2,
+  lookup = 3,
+  access = 4,
+  readlink = 5,
+  read = 6,
+  write = 7,
+  create = 8,
+  mkdir = 9,
+  symlink = 10,
+  mknod = 11,
+  remove = 12,
+  rmdir = 13,
+  rename = 14,
+  link = 15,
+  readdir = 16,
+  readdirplus = 17,
+  fsstat = 18,
+  fsinfo = 19,
+  pathconf = 20,
+  commit = 21,
+};
+
+enum class nfsstat3 : int32_t {
+  NFS3_OK = 0,
+  NFS3ERR_PERM = 1,
+  NFS3ERR_NOENT = 2,
+  NFS3ERR_IO = 5,
+  NFS3ERR_NXIO = 6,
+  NFS3ERR_ACCES = 13,
+  NFS3ERR_EXIST = 17,
+  NFS3ERR_XDEV = 18,
+  NFS3ERR_NODEV = 19,
+  NFS3ERR_NOTDIR = 20,
+  NFS3ERR_ISDIR = 21,
+  NFS3ERR_INVAL = 22,
+  NFS3ERR_FBIG = 27,
+  NFS3ERR_NOSPC = 28,
+  NFS3ERR_ROFS = 30,
+  NFS3ERR_MLINK = 31,
+  NFS3ERR_NAMETOOLONG = 63,
+  NFS3ERR_NOTEMPTY = 66,
+  NFS3ERR_DQUOT = 69,
+  NFS3ERR_STALE = 70,
+  NFS3ERR_REMOTE = 71,
+  NFS3ERR_BADHANDLE = 10001,
+  NFS3ERR_NOT_SYNC = 10002,
+  NFS3ERR_BAD_COOKIE = 10003,
+  NFS3ERR_NOTSUPP = 10004,
+  NFS3ERR_TOOSMALL = 10005,
+  NFS3ERR_SERVERFAULT = 10006,
+  NFS3ERR_BADTYPE = 10007,
+  NFS3ERR_JUKEBOX = 10008,
+};
+
+/** The nfsstat3 that best describes errno. */
+nfsstat3 errnoToNfsstat3(int errnum);
+
+enum class ftype3 : int32_t {
+  NF3REG = 1,
+  NF3DIR = 2,
+  NF3BLK = 3,
+  NF3CHR = 4,
+  NF3LNK = 5,
+  NF3SOCK = 6,
+  NF3FIFO = 7,
+};
+
+/**
+ * A file handle.  The RFC allows up to 64 opaque bytes, and Eden's are the
+ * 8 bytes of an InodeNumber, so that a handle stays valid for as long as the
+ * inode number does.
+ */
+struct nfs_fh3 {
+  InodeNumber ino;
+};
+
+struct specdata3 {
+  uint32_t specdata1;
+  uint32_t specdata2;
+};
+
+struct nfstime3 {
+  uint32_t seconds;
+  uint32_t nseconds;
+};
+
+struct fattr3 {
+  ftype3 type;
+  uint32_t mode;
+  uint32_t nlink;
+  uint32_t uid;
+  uint32_t gid;
+  uint64_t size;
+  uint64_t used;
+  specdata3 rdev;
+  uint64_t fsid;
+  uint64_t fileid;
+  nfstime3 atime;
+  nfstime3 mtime;
+  nfstime3 ctime;
+};
+
+/** The attributes of the file, or nothing. */
+using post_op_attr = std::optional<fattr3>;
+
+/** Convert the result of a Dispatcher::getattr() to fattr3. */
+fattr3 statToFattr3(const struct stat& st);
+
+// FSINFO3resok.properties bits.
+constexpr uint32_t FSF3_LINK = 0x0001;
+constexpr uint32_t FSF3_SYMLINK = 0x0002;
+constexpr uint32_t FSF3_HOMOGENEOUS = 0x0008;
+constexpr uint32_t FSF3_CANSETTIME = 0x0010;
+
+struct FSINFO3resok {
+  post_op_attr obj_attributes;
+  uint32_t rtmax;
+  uint32_t rtpref;
+  uint32_t rtmult;
+  uint32_t wtmax;
+  uint32_t wtpref;
+  uint32_t wtmult;
+  uint32_t dtpref;
+  uint64_t maxfilesize;
+  nfstime3 time_delta;
+  uint32_t properties;
+};
+
+template <>
+struct XdrTrait<nfs_fh3> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const nfs_fh3& value);
+  static nfs_fh3 deserialize(folly::io::Cursor& cursor);
+};
+
+template <>
+struct XdrTrait<specdata3> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const specdata3& value);
+  static specdata3 deserialize(folly::io::Cursor& cursor);
+};
+
+template <>
+struct XdrTrait<nfstime3> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const nfstime3& value);
+  static nfstime3 deserialize(folly::io::Cursor& cursor);
+};
+
+template <>
+struct XdrTrait<fattr3> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const fattr3& value);
+  static fattr3 deserialize(folly::io::Cursor& cursor);
+};
+
+template <>
+struct XdrTrait<FSINFO3resok> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const FSINFO3resok& value);
+  static FSINFO3resok deserialize(folly::io::Cursor& cursor);
+};
+
+} // namespace eden
+} // namespace facebook
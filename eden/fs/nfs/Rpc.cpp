@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/nfs/Rpc.h"
+
+namespace facebook {
+namespace eden {
+
+// RFC 5531 limits the body of an opaque_auth to 400 bytes.
+constexpr size_t kMaxAuthBodySize = 400;
+
+void XdrTrait<opaque_auth>::serialize(
+    folly::io::QueueAppender& appender,
+    const opaque_auth& value) {
+  xdrSerialize(appender, value.flavor);
+  xdrSerialize(appender, value.body);
+}
+
+opaque_auth XdrTrait<opaque_auth>::deserialize(folly::io::Cursor& cursor) {
+  opaque_auth value;
+  value.flavor = xdrDeserialize<auth_flavor>(cursor);
+  value.body = xdrDeserialize<std::vector<uint8_t>>(cursor);
+  if (value.body.size() > kMaxAuthBodySize) {
+    throw std::out_of_range("RPC authentication body is too large");
+  }
+  return value;
+}
+
+void XdrTrait<call_body>::serialize(
+    folly::io::QueueAppender& appender,
+    const call_body& value) {
+  xdrSerialize(appender, value.rpcvers);
+  xdrSerialize(appender, value.prog);
+  xdrSerialize(appender, value.vers);
+  xdrSerialize(appender, value.proc);
+  xdrSerialize(appender, value.cred);
+  xdrSerialize(appender, value.verf);
+}
+
+call_body XdrTrait<call_body>::deserialize(folly::io::Cursor& cursor) {
+  call_body value;
+  value.rpcvers = xdrDeserialize<uint32_t>(cursor);
+  value.prog = xdrDeserialize<uint32_t>(cursor);
+  value.vers = xdrDeserialize<uint32_t>(cursor);
+  value.proc = xdrDeserialize<uint32_t>(cursor);
+  value.cred = xdrDeserialize<opaque_auth>(cursor);
+  value.verf = xdrDeserialize<opaque_auth>(cursor);
+  return value;
+}
+
+void XdrTrait<rpc_msg_call>::serialize(
+    folly::io::QueueAppender& appender,
+    const rpc_msg_call& value) {
+  xdrSerialize(appender, value.xid);
+  xdrSerialize(appender, value.mtype);
+  xdrSerialize(appender, value.cbody);
+}
+
+rpc_msg_call XdrTrait<rpc_msg_call>::deserialize(folly::io::Cursor& cursor) {
+  rpc_msg_call value;
+  value.xid = xdrDeserialize<uint32_t>(cursor);
+  value.mtype = xdrDeserialize<msg_type>(cursor);
+  if (value.mtype != msg_type::CALL) {
+    throw std::invalid_argument("RPC message is not a call");
+  }
+  value.cbody = xdrDeserialize<call_body>(cursor);
+  return value;
+}
+
+void XdrTrait<mismatch_info>::serialize(
+    folly::io::QueueAppender& appender,
+    const mismatch_info& value) {
+  xdrSerialize(appender, value.low);
+  xdrSerialize(appender, value.high);
+}
+
+mismatch_info XdrTrait<mismatch_info>::deserialize(folly::io::Cursor& cursor) {
+  mismatch_info value;
+  value.low = xdrDeserialize<uint32_t>(cursor);
+  value.high = xdrDeserialize<uint32_t>(cursor);
+  return value;
+}
+
+void serializeReply(
+    folly::io::QueueAppender& appender,
+    accept_stat status,
+    uint32_t xid) {
+  xdrSerialize(appender, xid);
+  xdrSerialize(appender, msg_type::REPLY);
+  xdrSerialize(appender, reply_stat::MSG_ACCEPTED);
+  xdrSerialize(appender, opaque_auth{});
+  xdrSerialize(appender, status);
+}
+
+void serializeRpcMismatch(folly::io::QueueAppender& appender, uint32_t xid) {
+  xdrSerialize(appender, xid);
+  xdrSerialize(appender, msg_type::REPLY);
+  xdrSerialize(appender, reply_stat::MSG_DENIED);
+  xdrSerialize(appender, reject_stat::RPC_MISMATCH);
+  xdrSerialize(appender, mismatch_info{kRPCVersion, kRPCVersion});
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "eden/fs/nfs/Xdr.h"
+
+// The message formats of ONC RPC version 2, as specified in RFC 5531.  The
+// type and member names follow the RFC so that the two are easy to compare.
+
+namespace facebook {
+namespace eden {
+
+constexpr uint32_t kRPCVersion = 2;
+
+enum class auth_flavor : int32_t {
+  AUTH_NONE = 0,
+  AUTH_SYS = 1,
+  AUTH_SHORT = 2,
+  AUTH_DH = 3,
+  RPCSEC_GSS = 6,
+};
+
+enum class msg_type : int32_t {
+  CALL = 0,
+  REPLY = 1,
+};
+
+enum class reply_stat : int32_t {
+  MSG_ACCEPTED = 0,
+  MSG_DENIED = 1,
+};
+
+enum class accept_stat : int32_t {
+  SUCCESS = 0,
+  PROG_UNAVAIL = 1,
+  PROG_MISMATCH = 2,
+  PROC_UNAVAIL = 3,
+  GARBAGE_ARGS = 4,
+  SYSTEM_ERR = 5,
+};
+
+enum class reject_stat : int32_t {
+  RPC_MISMATCH = 0,
+  AUTH_ERROR = 1,
+};
+
+struct opaque_auth {
+  auth_flavor flavor{auth_flavor::AUTH_NONE};
+  std::vector<uint8_t> body;
+
+  bool operator==(const opaque_auth& other) const {
+    return flavor == other.flavor && body == other.body;
+  }
+};
+
+struct call_body {
+  uint32_t rpcvers{kRPCVersion};
+  uint32_t prog{0};
+  uint32_t vers{0};
+  uint32_t proc{0};
+  opaque_auth cred;
+  opaque_auth verf;
+};
+
+/** An rpc_msg whose mtype is CALL. */
+struct rpc_msg_call {
+  uint32_t xid{0};
+  msg_type mtype{msg_type::CALL};
+  call_body cbody;
+};
+
+/** The supported versions sent with PROG_MISMATCH and RPC_MISMATCH. */
+struct mismatch_info {
+  uint32_t low;
+  uint32_t high;
+};
+
+template <>
+struct XdrTrait<opaque_auth> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const opaque_auth& value);
+  static opaque_auth deserialize(folly::io::Cursor& cursor);
+};
+
+template <>
+struct XdrTrait<call_body> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const call_body& value);
+  static call_body deserialize(folly::io::Cursor& cursor);
+};
+
+template <>
+struct XdrTrait<rpc_msg_call> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const rpc_msg_call& value);
+  static rpc_msg_call deserialize(folly::io::Cursor& cursor);
+};
+
+template <>
+struct XdrTrait<mismatch_info> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const mismatch_info& value);
+  static mismatch_info deserialize(folly::io::Cursor& cursor);
+};
+
+/**
+ * Write the header of an accepted reply to the call xid, with an AUTH_NONE
+ * verifier.  For SUCCESS the results follow it, and for PROG_MISMATCH a
+ * mismatch_info.
+ */
+void serializeReply(
+    folly::io::QueueAppender& appender,
+    accept_stat status,
+    uint32_t xid);
+
+/**
+ * Write a complete reply that denies the call xid because it is not for RPC
+ * version 2.
+ */
+void serializeRpcMismatch(folly::io::QueueAppender& appender, uint32_t xid);
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/nfs/RpcServer.h"
+
+#include <folly/Conv.h>
+#include <folly/Executor.h>
+#include <folly/String.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/logging/xlog.h>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+// The high bit of a record mark is set on the last fragment of a message,
+// and the other 31 bits are the length of the fragment.
+constexpr uint32_t kLastFragment = 0x80000000;
+constexpr uint32_t kFragmentLengthMask = 0x7fffffff;
+
+// NFS calls carry at most one rsize or wsize of data, so a bigger message
+// means a broken or hostile client.
+constexpr size_t kMaxMessageSize = 16 * 1024 * 1024;
+
+/**
+ * Decode the call in message, have proc handle it, and return the reply with
+ * its record mark.  Throws if message is not a call, which has no reply.
+ */
+folly::Future<std::unique_ptr<folly::IOBuf>> processMessage(
+    const std::shared_ptr<RpcServerProcessor>& proc,
+    std::unique_ptr<folly::IOBuf> message) {
+  folly::io::Cursor deser(message.get());
+  auto call = xdrDeserialize<rpc_msg_call>(deser);
+
+  auto reply = std::make_unique<folly::IOBufQueue>(
+      folly::IOBufQueue::cacheChainLength());
+  folly::io::QueueAppender ser(reply.get(), 1024);
+  // The record mark, filled in once the length of the reply is known.
+  xdrSerialize(ser, uint32_t{0});
+
+  auto finish = [reply = std::move(reply)](auto&&) {
+    auto buf = reply->move();
+    auto length = buf->computeChainDataLength() - sizeof(uint32_t);
+    folly::io::RWPrivateCursor mark(buf.get());
+    mark.writeBE<uint32_t>(kLastFragment | static_cast<uint32_t>(length));
+    return buf;
+  };
+
+  if (call.cbody.rpcvers != kRPCVersion) {
+    serializeRpcMismatch(ser, call.xid);
+    return finish(folly::unit);
+  }
+
+  auto& cbody = call.cbody;
+  return proc
+      ->dispatchRpc(
+          deser, std::move(ser), call.xid, cbody.prog, cbody.vers, cbody.proc)
+      .thenValue([message = std::move(message),
+                  finish = std::move(finish)](auto&& unit) mutable {
+        return finish(unit);
+      });
+}
+
+/**
+ * Reads the calls on one connection and writes back their replies.
+ *
+ * A handler owns itself until its connection ends, and the calls in flight
+ * keep it alive after that.  It is only ever destroyed on the EventBase.
+ */
+class RpcConnectionHandler
+    : public folly::AsyncReader::ReadCallback,
+      public std::enable_shared_from_this<RpcConnectionHandler> {
+ public:
+  RpcConnectionHandler(
+      std::shared_ptr<RpcServerProcessor> proc,
+      folly::AsyncSocket::UniquePtr socket,
+      std::shared_ptr<folly::Executor> threadPool)
+      : proc_(std::move(proc)),
+        socket_(std::move(socket)),
+        threadPool_(std::move(threadPool)) {}
+
+  static void start(std::shared_ptr<RpcConnectionHandler> handler) {
+    auto* raw = handler.get();
+    raw->self_ = std::move(handler);
+    raw->socket_->setReadCB(raw);
+  }
+
+ private:
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override {
+    auto [data, length] = readBuf_.preallocate(kMinReadSize, kReadSize);
+    *bufReturn = data;
+    *lenReturn = length;
+  }
+
+  void readDataAvailable(size_t len) noexcept override {
+    readBuf_.postallocate(len);
+    try {
+      processReadBuffer();
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "invalid RPC record from "
+                << socket_->getPeerAddress().describe() << ": "
+                << folly::exceptionStr(ex);
+      close();
+    }
+  }
+
+  void readEOF() noexcept override {
+    close();
+  }
+
+  void readErr(const folly::AsyncSocketException& ex) noexcept override {
+    XLOG(DBG2) << "error reading RPC connection: " << ex.what();
+    close();
+  }
+
+  /** Split the complete messages off readBuf_ and dispatch them. */
+  void processReadBuffer() {
+    while (readBuf_.chainLength() >= sizeof(uint32_t)) {
+      folly::io::Cursor cursor(readBuf_.front());
+      auto mark = cursor.readBE<uint32_t>();
+      size_t length = mark & kFragmentLengthMask;
+      if (pendingLength_ + length > kMaxMessageSize) {
+        throw std::length_error(folly::to<std::string>(
+            "RPC message is longer than ", kMaxMessageSize, " bytes"));
+      }
+      if (readBuf_.chainLength() < sizeof(uint32_t) + length) {
+        return;
+      }
+
+      readBuf_.trimStart(sizeof(uint32_t));
+      auto fragment = length > 0 ? readBuf_.split(length)
+                                 : folly::IOBuf::create(0);
+      pendingLength_ += length;
+      if (pending_) {
+        pending_->prependChain(std::move(fragment));
+      } else {
+        pending_ = std::move(fragment);
+      }
+
+      if (mark & kLastFragment) {
+        pendingLength_ = 0;
+        dispatch(std::move(pending_));
+      }
+    }
+  }
+
+  void dispatch(std::unique_ptr<folly::IOBuf> message) {
+    auto* evb = socket_->getEventBase();
+    folly::via(
+        threadPool_.get(),
+        [proc = proc_, message = std::move(message)]() mutable {
+          return processMessage(proc, std::move(message));
+        })
+        .thenTry([self = shared_from_this(), evb](auto&& reply) mutable {
+          // Move the last reference to the handler onto the EventBase, which
+          // must be the one to destroy its socket.
+          evb->runInEventBaseThread(
+              [self = std::move(self), reply = std::move(reply)]() mutable {
+                self->sendReply(std::move(reply));
+              });
+        });
+  }
+
+  void sendReply(folly::Try<std::unique_ptr<folly::IOBuf>>&& reply) {
+    if (reply.hasException()) {
+      // Without a decodable call there is no xid to reply to.
+      XLOG(ERR) << "error handling RPC call: "
+                << folly::exceptionStr(reply.exception());
+      return;
+    }
+    if (*reply && socket_->good()) {
+      socket_->writeChain(nullptr, std::move(*reply));
+    }
+  }
+
+  void close() {
+    socket_->setReadCB(nullptr);
+    socket_->closeNow();
+    self_.reset();
+  }
+
+  static constexpr size_t kMinReadSize = 4096;
+  static constexpr size_t kReadSize = 64 * 1024;
+
+  std::shared_ptr<RpcServerProcessor> proc_;
+  folly::AsyncSocket::UniquePtr socket_;
+  std::shared_ptr<folly::Executor> threadPool_;
+  std::shared_ptr<RpcConnectionHandler> self_;
+
+  folly::IOBufQueue readBuf_{folly::IOBufQueue::cacheChainLength()};
+  // The fragments of a message whose last fragment has not arrived yet.
+  std::unique_ptr<folly::IOBuf> pending_;
+  size_t pendingLength_{0};
+};
+} // namespace
+
+folly::Future<folly::Unit> RpcServerProcessor::dispatchRpc(
+    folly::io::Cursor /*deser*/,
+    folly::io::QueueAppender ser,
+    uint32_t xid,
+    uint32_t /*progNumber*/,
+    uint32_t /*progVersion*/,
+    uint32_t /*procNumber*/) {
+  serializeReply(ser, accept_stat::PROG_UNAVAIL, xid);
+  return folly::unit;
+}
+
+RpcServer::RpcServer(
+    std::shared_ptr<RpcServerProcessor> proc,
+    folly::EventBase* evb,
+    std::shared_ptr<folly::Executor> threadPool)
+    : evb_(evb),
+      threadPool_(std::move(threadPool)),
+      serverSocket_(new folly::AsyncServerSocket(evb_)),
+      proc_(std::move(proc)) {}
+
+RpcServer::~RpcServer() {}
+
+void RpcServer::initialize(folly::SocketAddress addr) {
+  serverSocket_->bind(addr);
+  serverSocket_->listen(/* backlog */ 1024);
+  serverSocket_->addAcceptCallback(this, evb_);
+  serverSocket_->startAccepting();
+}
+
+folly::SocketAddress RpcServer::getAddr() const {
+  return serverSocket_->getAddress();
+}
+
+void RpcServer::connectionAccepted(
+    folly::NetworkSocket fd,
+    const folly::SocketAddress& clientAddr) noexcept {
+  XLOG(DBG4) << "RPC connection from " << clientAddr.describe();
+  try {
+    folly::AsyncSocket::UniquePtr socket(new folly::AsyncSocket(evb_, fd));
+    // Replies are small and latency matters more than packet count.
+    socket->setNoDelay(true);
+    RpcConnectionHandler::start(std::make_shared<RpcConnectionHandler>(
+        proc_, std::move(socket), threadPool_));
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error setting up RPC connection from "
+              << clientAddr.describe() << ": " << folly::exceptionStr(ex);
+  }
+}
+
+void RpcServer::acceptError(const std::exception& ex) noexcept {
+  XLOG(ERR) << "accept() error on RPC socket: " << folly::exceptionStr(ex);
+}
+
+} // namespace eden
+} // namespace facebook
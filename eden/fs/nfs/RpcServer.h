@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/SocketAddress.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <memory>
+
+#include "eden/fs/nfs/Rpc.h"
+
+namespace folly {
+class Executor;
+}
+
+namespace facebook {
+namespace eden {
+
+/**
+ * The implementation of the RPC programs served by an RpcServer.
+ */
+class RpcServerProcessor {
+ public:
+  virtual ~RpcServerProcessor() = default;
+
+  /**
+   * Handle one call.  deser is positioned at the call's arguments, and the
+   * whole reply, from serializeReply() on, must be written to ser.
+   *
+   * This is called on the RpcServer's thread pool, and calls from one
+   * connection may run concurrently.  The default implementation replies
+   * PROG_UNAVAIL.
+   */
+  virtual folly::Future<folly::Unit> dispatchRpc(
+      folly::io::Cursor deser,
+      folly::io::QueueAppender ser,
+      uint32_t xid,
+      uint32_t progNumber,
+      uint32_t progVersion,
+      uint32_t procNumber);
+};
+
+/**
+ * An ONC RPC server over TCP (RFC 5531), using the record marking of
+ * section 11 to delimit the messages.
+ *
+ * Connections are accepted and read on the EventBase, and each call is
+ * decoded and handled on the thread pool, so that a slow call does not hold
+ * up the others on its connection.  Replies are sent in the order that the
+ * calls complete, which RPC clients match to their calls by xid.
+ */
+class RpcServer : private folly::AsyncServerSocket::AcceptCallback {
+ public:
+  RpcServer(
+      std::shared_ptr<RpcServerProcessor> proc,
+      folly::EventBase* evb,
+      std::shared_ptr<folly::Executor> threadPool);
+  ~RpcServer() override;
+
+  /**
+   * Start listening on addr.  Binding to port 0 lets the kernel pick a free
+   * port, which getAddr() then returns.
+   */
+  void initialize(folly::SocketAddress addr);
+
+  folly::SocketAddress getAddr() const;
+
+ private:
+  void connectionAccepted(
+      folly::NetworkSocket fd,
+      const folly::SocketAddress& clientAddr) noexcept override;
+  void acceptError(const std::exception& ex) noexcept override;
+
+  folly::EventBase* evb_;
+  std::shared_ptr<folly::Executor> threadPool_;
+  folly::AsyncServerSocket::UniquePtr serverSocket_;
+  std::shared_ptr<RpcServerProcessor> proc_;
+};
+
+} // namespace eden
+} // namespace facebook
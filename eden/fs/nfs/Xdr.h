@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/io/Cursor.h>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Encoding and decoding of the External Data Representation (XDR, RFC 4506)
+ * that ONC RPC and NFS are specified in.
+ *
+ * XdrTrait<T> is specialized for every type that can be encoded, with:
+ *
+ *   static void serialize(folly::io::QueueAppender& appender, const T& value);
+ *   static T deserialize(folly::io::Cursor& cursor);
+ *
+ * Every item is encoded big endian, in a multiple of 4 bytes.  deserialize()
+ * throws std::out_of_range if the data ends early.
+ */
+template <typename T, typename Enable = void>
+struct XdrTrait;
+
+namespace detail {
+/** The number of zero bytes that pad an item of size bytes. */
+inline size_t xdrPadding(size_t size) {
+  return (4 - (size & 3)) & 3;
+}
+
+inline void writeXdrPadding(folly::io::QueueAppender& appender, size_t size) {
+  static constexpr uint8_t kZeros[3] = {0, 0, 0};
+  appender.push(kZeros, xdrPadding(size));
+}
+
+/** Read the length of a variable sized item, and check that it is there. */
+inline uint32_t readXdrLength(folly::io::Cursor& cursor, size_t itemSize) {
+  auto length = cursor.readBE<uint32_t>();
+  if (!cursor.canAdvance(uint64_t{length} * itemSize)) {
+    throw std::out_of_range("XDR item is longer than its buffer");
+  }
+  return length;
+}
+} // namespace detail
+
+template <typename T>
+void xdrSerialize(folly::io::QueueAppender& appender, const T& value) {
+  XdrTrait<T>::serialize(appender, value);
+}
+
+template <typename T>
+T xdrDeserialize(folly::io::Cursor& cursor) {
+  return XdrTrait<T>::deserialize(cursor);
+}
+
+/** int, unsigned int, hyper and unsigned hyper. */
+template <typename T>
+struct XdrTrait<
+    T,
+    std::enable_if_t<
+        std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+        (sizeof(T) == 4 || sizeof(T) == 8)>> {
+  static void serialize(folly::io::QueueAppender& appender, const T& value) {
+    appender.writeBE<T>(value);
+  }
+
+  static T deserialize(folly::io::Cursor& cursor) {
+    return cursor.readBE<T>();
+  }
+};
+
+template <>
+struct XdrTrait<bool> {
+  static void serialize(folly::io::QueueAppender& appender, bool value) {
+    appender.writeBE<uint32_t>(value ? 1 : 0);
+  }
+
+  static bool deserialize(folly::io::Cursor& cursor) {
+    return cursor.readBE<uint32_t>() != 0;
+  }
+};
+
+/** Enumerations are encoded as a signed int. */
+template <typename T>
+struct XdrTrait<T, std::enable_if_t<std::is_enum_v<T>>> {
+  static void serialize(folly::io::QueueAppender& appender, const T& value) {
+    appender.writeBE<int32_t>(static_cast<int32_t>(value));
+  }
+
+  static T deserialize(folly::io::Cursor& cursor) {
+    return static_cast<T>(cursor.readBE<int32_t>());
+  }
+};
+
+/** Fixed-length opaque data. */
+template <size_t N>
+struct XdrTrait<std::array<uint8_t, N>> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const std::array<uint8_t, N>& value) {
+    appender.push(value.data(), N);
+    detail::writeXdrPadding(appender, N);
+  }
+
+  static std::array<uint8_t, N> deserialize(folly::io::Cursor& cursor) {
+    std::array<uint8_t, N> value;
+    cursor.pull(value.data(), N);
+    cursor.skip(detail::xdrPadding(N));
+    return value;
+  }
+};
+
+/** Variable-length opaque data. */
+template <>
+struct XdrTrait<std::vector<uint8_t>> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const std::vector<uint8_t>& value) {
+    appender.writeBE<uint32_t>(value.size());
+    appender.push(value.data(), value.size());
+    detail::writeXdrPadding(appender, value.size());
+  }
+
+  static std::vector<uint8_t> deserialize(folly::io::Cursor& cursor) {
+    auto length = detail::readXdrLength(cursor, 1);
+    std::vector<uint8_t> value(length);
+    cursor.pull(value.data(), length);
+    cursor.skip(detail::xdrPadding(length));
+    return value;
+  }
+};
+
+/** Strings are encoded like variable-length opaque data. */
+template <>
+struct XdrTrait<std::string> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const std::string& value) {
+    appender.writeBE<uint32_t>(value.size());
+    appender.push(
+        reinterpret_cast<const uint8_t*>(value.data()), value.size());
+    detail::writeXdrPadding(appender, value.size());
+  }
+
+  static std::string deserialize(folly::io::Cursor& cursor) {
+    auto length = detail::readXdrLength(cursor, 1);
+    auto value = cursor.readFixedString(length);
+    cursor.skip(detail::xdrPadding(length));
+    return value;
+  }
+};
+
+/** Variable-length arrays. */
+template <typename T>
+struct XdrTrait<
+    std::vector<T>,
+    std::enable_if_t<!std::is_same_v<T, uint8_t>>> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const std::vector<T>& value) {
+    appender.writeBE<uint32_t>(value.size());
+    for (const auto& item : value) {
+      XdrTrait<T>::serialize(appender, item);
+    }
+  }
+
+  static std::vector<T> deserialize(folly::io::Cursor& cursor) {
+    // Every item takes at least 4 bytes.
+    auto length = detail::readXdrLength(cursor, 4);
+    std::vector<T> value;
+    value.reserve(length);
+    for (uint32_t i = 0; i < length; ++i) {
+      value.push_back(XdrTrait<T>::deserialize(cursor));
+    }
+    return value;
+  }
+};
+
+/** Optional data (`T *name` in the XDR language). */
+template <typename T>
+struct XdrTrait<std::optional<T>> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const std::optional<T>& value) {
+    XdrTrait<bool>::serialize(appender, value.has_value());
+    if (value) {
+      XdrTrait<T>::serialize(appender, *value);
+    }
+  }
+
+  static std::optional<T> deserialize(folly::io::Cursor& cursor) {
+    if (!XdrTrait<bool>::deserialize(cursor)) {
+      return std::nullopt;
+    }
+    return XdrTrait<T>::deserialize(cursor);
+  }
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/nfs/Xdr.h"
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GTest.h>
+
+#include "eden/fs/nfs/NfsdRpc.h"
+#include "eden/fs/nfs/Rpc.h"
+
+using namespace facebook::eden;
+
+namespace {
+template <typename T>
+std::string serialize(const T& value) {
+  folly::IOBufQueue queue;
+  folly::io::QueueAppender appender(&queue, 64);
+  xdrSerialize(appender, value);
+  auto buf = queue.move();
+  return buf->moveToFbString().toStdString();
+}
+
+template <typename T>
+T deserialize(const std::string& bytes) {
+  auto buf = folly::IOBuf::wrapBuffer(bytes.data(), bytes.size());
+  folly::io::Cursor cursor(buf.get());
+  auto value = xdrDeserialize<T>(cursor);
+  EXPECT_TRUE(cursor.isAtEnd());
+  return value;
+}
+} // namespace
+
+TEST(XdrTest, integers_are_big_endian) {
+  EXPECT_EQ(
+      std::string("\x01\x02\x03\x04", 4), serialize(uint32_t{0x01020304}));
+  EXPECT_EQ(std::string("\xff\xff\xff\xfe", 4), serialize(int32_t{-2}));
+  EXPECT_EQ(
+      std::string("\x00\x00\x00\x01\x00\x00\x00\x02", 8),
+      serialize(uint64_t{0x100000002}));
+  EXPECT_EQ(std::string("\x00\x00\x00\x01", 4), serialize(true));
+
+  EXPECT_EQ(0x01020304, deserialize<uint32_t>(serialize(uint32_t{0x01020304})));
+  EXPECT_EQ(-2, deserialize<int32_t>(serialize(int32_t{-2})));
+  EXPECT_FALSE(deserialize<bool>(serialize(false)));
+}
+
+TEST(XdrTest, opaque_data_is_padded_to_four_bytes) {
+  std::vector<uint8_t> data{1, 2, 3, 4, 5};
+  auto bytes = serialize(data);
+  EXPECT_EQ(
+      std::string("\x00\x00\x00\x05\x01\x02\x03\x04\x05\x00\x00\x00", 12),
+      bytes);
+  EXPECT_EQ(data, deserialize<std::vector<uint8_t>>(bytes));
+
+  EXPECT_EQ(
+      std::string("\x00\x00\x00\x02hi\x00\x00", 8),
+      serialize(std::string("hi")));
+  EXPECT_EQ("hi", deserialize<std::string>(serialize(std::string("hi"))));
+
+  std::array<uint8_t, 3> fixed{7, 8, 9};
+  EXPECT_EQ(std::string("\x07\x08\x09\x00", 4), serialize(fixed));
+  EXPECT_EQ(fixed, (deserialize<std::array<uint8_t, 3>>(serialize(fixed))));
+}
+
+TEST(XdrTest, arrays_and_optionals) {
+  std::vector<uint32_t> values{1, 2, 3};
+  EXPECT_EQ(16, serialize(values).size());
+  EXPECT_EQ(values, deserialize<std::vector<uint32_t>>(serialize(values)));
+
+  std::optional<uint32_t> none;
+  EXPECT_EQ(std::string("\x00\x00\x00\x00", 4), serialize(none));
+  EXPECT_EQ(none, deserialize<std::optional<uint32_t>>(serialize(none)));
+
+  std::optional<uint32_t> some{42};
+  EXPECT_EQ(8, serialize(some).size());
+  EXPECT_EQ(some, deserialize<std::optional<uint32_t>>(serialize(some)));
+}
+
+TEST(XdrTest, truncated_data_throws) {
+  auto bytes = serialize(std::vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8});
+  EXPECT_THROW(
+      deserialize<std::vector<uint8_t>>(bytes.substr(0, 8)), std::out_of_range);
+  EXPECT_THROW(
+      deserialize<uint32_t>(std::string("\x00\x01", 2)), std::out_of_range);
+
+  // A length that claims more items than the buffer can hold must not be
+  // trusted to size an allocation.
+  EXPECT_THROW(
+      deserialize<std::vector<uint32_t>>(std::string("\x7f\xff\xff\xff", 4)),
+      std::out_of_range);
+}
+
+TEST(XdrTest, rpc_call_round_trips) {
+  rpc_msg_call call;
+  call.xid = 17;
+  call.cbody.prog = kNfsdProgNumber;
+  call.cbody.vers = kNfsd3ProgVersion;
+  call.cbody.proc = static_cast<uint32_t>(nfsv3Procs::getattr);
+  call.cbody.cred.flavor = auth_flavor::AUTH_SYS;
+  call.cbody.cred.body = {1, 2, 3};
+
+  auto bytes = serialize(call);
+  // xid, mtype, rpcvers, prog, vers, proc, cred (flavor, length, 3 bytes
+  // padded to 4) and verf (flavor, length).
+  EXPECT_EQ(6 * 4 + 3 * 4 + 2 * 4, bytes.size());
+
+  auto result = deserialize<rpc_msg_call>(bytes);
+  EXPECT_EQ(17, result.xid);
+  EXPECT_EQ(kRPCVersion, result.cbody.rpcvers);
+  EXPECT_EQ(kNfsdProgNumber, result.cbody.prog);
+  EXPECT_EQ(kNfsd3ProgVersion, result.cbody.vers);
+  EXPECT_EQ(
+      static_cast<uint32_t>(nfsv3Procs::getattr), result.cbody.proc);
+  EXPECT_EQ(call.cbody.cred, result.cbody.cred);
+  EXPECT_EQ(opaque_auth{}, result.cbody.verf);
+}
+
+TEST(XdrTest, replies_are_not_calls) {
+  folly::IOBufQueue queue;
+  folly::io::QueueAppender appender(&queue, 64);
+  serializeReply(appender, accept_stat::SUCCESS, 5);
+  auto buf = queue.move();
+  folly::io::Cursor cursor(buf.get());
+  EXPECT_THROW(xdrDeserialize<rpc_msg_call>(cursor), std::invalid_argument);
+}
+
+TEST(XdrTest, nfs_file_handles_hold_an_inode_number) {
+  nfs_fh3 fh{InodeNumber{0x1234}};
+  auto bytes = serialize(fh);
+  EXPECT_EQ(
+      std::string("\x00\x00\x00\x08\x00\x00\x00\x00\x00\x00\x12\x34", 12),
+      bytes);
+  EXPECT_EQ(fh.ino, deserialize<nfs_fh3>(bytes).ino);
+
+  EXPECT_THROW(
+      deserialize<nfs_fh3>(serialize(std::vector<uint8_t>{1, 2, 3, 4})),
+      std::invalid_argument);
+}
@@ -8,8 +8,19 @@
 #include "eden/fs/service/EdenCPUThreadPool.h"
 
 #include <gflags/gflags.h>
+#include "eden/fs/utils/WorkStealingExecutor.h"
 
 DEFINE_int32(num_eden_threads, 12, "the number of eden CPU worker threads");
+DEFINE_bool(
+    eden_cpu_work_stealing,
+    false,
+    "Give each eden CPU worker thread a queue of its own, from which idle "
+    "threads steal, instead of one queue shared by all of them");
+DEFINE_bool(
+    eden_cpu_numa_pinning,
+    false,
+    "With --eden_cpu_work_stealing, spread the eden CPU worker threads across "
+    "the NUMA nodes and pin each to the CPUs of its node");
 
 namespace facebook {
 namespace eden {
@@ -17,5 +28,20 @@ namespace eden {
 EdenCPUThreadPool::EdenCPUThreadPool()
     : UnboundedQueueExecutor(FLAGS_num_eden_threads, "EdenCPUThread") {}
 
+EdenCPUThreadPool::EdenCPUThreadPool(
+    std::shared_ptr<WorkStealingExecutor> executor)
+    : UnboundedQueueExecutor(std::move(executor)) {}
+
+std::shared_ptr<EdenCPUThreadPool> EdenCPUThreadPool::create() {
+  if (FLAGS_eden_cpu_work_stealing) {
+    return std::shared_ptr<EdenCPUThreadPool>(
+        new EdenCPUThreadPool(std::make_shared<WorkStealingExecutor>(
+            FLAGS_num_eden_threads,
+            "EdenCPUThread",
+            FLAGS_eden_cpu_numa_pinning)));
+  }
+  return std::make_shared<EdenCPUThreadPool>();
+}
+
 } // namespace eden
 } // namespace facebook
@@ -16,6 +16,15 @@ namespace eden {
 class EdenCPUThreadPool : public UnboundedQueueExecutor {
  public:
   explicit EdenCPUThreadPool();
+
+  /**
+   * Creates the pool configured by the command line flags, which may make it
+   * a WorkStealingExecutor.
+   */
+  static std::shared_ptr<EdenCPUThreadPool> create();
+
+ private:
+  explicit EdenCPUThreadPool(std::shared_ptr<WorkStealingExecutor> executor);
 };
 
 } // namespace eden
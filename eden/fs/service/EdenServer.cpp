@@ -10,9 +10,11 @@
 #include <cpptoml.h> // @manual=fbsource//third-party/cpptoml:cpptoml
 
 #include <sys/stat.h>
+#include <algorithm>
 #include <atomic>
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <sstream>
 
@@ -22,6 +24,7 @@
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
 #include <folly/chrono/Conv.h>
+#include <folly/executors/ExecutorWithPriority.h>
 #include <folly/io/async/AsyncSignalHandler.h>
 #include <folly/logging/xlog.h>
 #include <folly/stop_watch.h>
@@ -44,10 +47,12 @@
 #include "eden/fs/store/BlobCache.h"
 #include "eden/fs/store/EmptyBackingStore.h"
 #include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/MappedBlobCache.h"
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
 #include "eden/fs/store/SqliteLocalStore.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/store/hg/HgBackingStore.h"
 #include "eden/fs/store/hg/HgQueuedBackingStore.h"
 #include "eden/fs/store/hg/MetadataImporter.h"
@@ -56,6 +61,7 @@
 #include "eden/fs/telemetry/SessionInfo.h"
 #include "eden/fs/telemetry/StructuredLogger.h"
 #include "eden/fs/telemetry/StructuredLoggerFactory.h"
+#include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Clock.h"
 #include "eden/fs/utils/EnumValue.h"
 #include "eden/fs/utils/FileUtils.h"
@@ -70,6 +76,7 @@
 #else
 #include "eden/fs/fuse/FuseChannel.h"
 #include "eden/fs/inodes/EdenDispatcher.h"
+#include "eden/fs/inodes/InodeUnloadWalk.h"
 #include "eden/fs/inodes/Overlay.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/takeover/TakeoverClient.h"
@@ -119,27 +126,41 @@ DEFINE_int32(
     "Maximum number of active thrift requests");
 DEFINE_bool(thrift_enable_codel, false, "Enable Codel queuing timeout");
 
-DEFINE_int64(
-    unload_interval_minutes,
-    0,
-    "Frequency in minutes of background inode unloading");
-DEFINE_int64(
-    start_delay_minutes,
-    10,
-    "Initial delay before first background inode unload");
-DEFINE_int64(
-    unload_age_minutes,
-    6 * 60,
-    "Minimum age of the inodes to be unloaded in background");
+DEFINE_uint64(
+    unload_slice_size,
+    1000,
+    "Number of inodes background unloading examines before yielding its "
+    "thread to other work");
 
 DEFINE_uint64(
-    maximumBlobCacheSize,
+    minimumBlobCacheEntryCount,
+    16,
+    "The minimum number of recent blobs to keep cached. Trumps "
+    "store:blob-cache-size");
+DEFINE_uint64(
+    compressedBlobCacheSize,
+    0,
+    "How many bytes worth of compressed blobs evicted from the blob cache to "
+    "keep in memory, at most. 0 disables the compressed tier");
+DEFINE_uint64(
+    protectedBlobCacheSize,
+    0,
+    "How many bytes of the blob cache to reserve for blobs that were requested "
+    "more than once, so that scans reading many blobs once do not evict them. "
+    "0 makes the blob cache a plain LRU cache");
+DEFINE_uint64(
+    blobCacheShardCount,
+    1,
+    "Number of independently locked shards to split the blob cache into. The "
+    "size limits are divided evenly across shards");
+DEFINE_uint64(
+    maximumTreeCacheSize,
     40 * 1024 * 1024,
-    "How many bytes worth of blobs to keep in memory, at most");
+    "How many bytes worth of decoded trees to keep in memory, at most");
 DEFINE_uint64(
-    minimumBlobCacheEntryCount,
+    minimumTreeCacheEntryCount,
     16,
-    "The minimum number of recent blobs to keep cached. Trumps maximumBlobCacheSize");
+    "The minimum number of recent trees to keep cached. Trumps maximumTreeCacheSize");
 
 using apache::thrift::ThriftServer;
 using folly::Future;
@@ -163,6 +184,12 @@ constexpr StringPiece kHgStorePrefix{"store.hg"};
 constexpr StringPiece kFuseRequestPrefix{"fuse"};
 constexpr StringPiece kStateConfig{"config.toml"};
 
+/**
+ * Unloading under memory pressure stops once inodes accessed within this long
+ * would have to be unloaded.
+ */
+constexpr std::chrono::minutes kMinPressureUnloadAge{1};
+
 std::optional<std::string> getUnixDomainSocketPath(
     const folly::SocketAddress& address) {
   return AF_UNIX == address.getFamily() ? std::make_optional(address.getPath())
@@ -257,6 +284,30 @@ size_t getNumberPendingFuseRequests(const EdenMount* mount) {
 }
 #endif // __linux__
 
+std::shared_ptr<MappedBlobCache> makeMappedBlobCache(const EdenConfig& config) {
+#ifdef _WIN32
+  (void)config;
+  return nullptr;
+#else
+  auto threshold = config.mappedBlobThreshold.getValue();
+  if (threshold == 0) {
+    return nullptr;
+  }
+  auto directory = config.edenDir.getValue() + "blobs"_pc;
+  try {
+    return std::make_shared<MappedBlobCache>(
+        directory,
+        threshold,
+        config.mappedBlobCacheSize.getValue());
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "unable to open the mapped blob cache in " << directory
+              << ", large blobs will be kept in memory: "
+              << folly::exceptionStr(ex);
+    return nullptr;
+  }
+#endif
+}
+
 } // namespace
 
 namespace facebook {
@@ -316,7 +367,18 @@ class EdenServer::ThriftServerEventHandler
   folly::Promise<Unit> runningPromise_;
 };
 
+// The number of hashes read from the LocalStore at once when warming the
+// caches after a takeover.
+static constexpr size_t kCacheWarmingBatchSize = 1024;
+
 static constexpr folly::StringPiece kBlobCacheMemory{"blob_cache.memory"};
+static constexpr folly::StringPiece kTreeCacheMemory{"tree_cache.memory"};
+static constexpr folly::StringPiece kTreeCacheEvictions{
+    "tree_cache.eviction_count"};
+static constexpr folly::StringPiece kCPUThreadPoolPending{
+    "eden_cpu_thread_pool.pending_tasks"};
+static constexpr folly::StringPiece kCPUThreadPoolSteals{
+    "eden_cpu_thread_pool.steal_count"};
 
 EdenServer::EdenServer(
     std::vector<std::string> originalCommandLine,
@@ -330,12 +392,19 @@ EdenServer::EdenServer(
       edenDir_{edenConfig->edenDir.getValue()},
       metadataImporterFactory_(std::move(metadataImporterFactory)),
       blobCache_{BlobCache::create(
-          FLAGS_maximumBlobCacheSize,
-          FLAGS_minimumBlobCacheEntryCount)},
+          edenConfig->blobCacheSize.getValue(),
+          FLAGS_minimumBlobCacheEntryCount,
+          FLAGS_blobCacheShardCount,
+          FLAGS_compressedBlobCacheSize,
+          FLAGS_protectedBlobCacheSize)},
+      treeCache_{TreeCache::create(
+          FLAGS_maximumTreeCacheSize,
+          FLAGS_minimumTreeCacheEntryCount)},
+      mappedBlobCache_{makeMappedBlobCache(*edenConfig)},
       serverState_{make_shared<ServerState>(
           std::move(userInfo),
           std::move(privHelper),
-          std::make_shared<EdenCPUThreadPool>(),
+          EdenCPUThreadPool::create(),
           std::make_shared<UnixClock>(),
           std::make_shared<ProcessNameCache>(),
           makeDefaultStructuredLogger(*edenConfig, std::move(sessionInfo)),
@@ -348,6 +417,18 @@ EdenServer::EdenServer(
   counters->registerCallback(kBlobCacheMemory, [this] {
     return this->getBlobCache()->getStats().totalSizeInBytes;
   });
+  counters->registerCallback(kTreeCacheMemory, [this] {
+    return this->getTreeCache()->getStats().totalSizeInBytes;
+  });
+  counters->registerCallback(kTreeCacheEvictions, [this] {
+    return this->getTreeCache()->getStats().evictionCount;
+  });
+  counters->registerCallback(kCPUThreadPoolPending, [this] {
+    return serverState_->getThreadPool()->getPendingTaskCount();
+  });
+  counters->registerCallback(kCPUThreadPoolSteals, [this] {
+    return serverState_->getThreadPool()->getStealCount();
+  });
 
   for (auto stage : RequestMetricsScope::requestStages) {
     for (auto metric : RequestMetricsScope::requestMetrics) {
@@ -380,11 +461,19 @@ EdenServer::EdenServer(
       });
     }
   }
+
+  if (edenConfig->alwaysOnTracing.getValue()) {
+    enableTracing();
+  }
 }
 
 EdenServer::~EdenServer() {
   auto counters = fb303::ServiceData::get()->getDynamicCounters();
   counters->unregisterCallback(kBlobCacheMemory);
+  counters->unregisterCallback(kTreeCacheMemory);
+  counters->unregisterCallback(kTreeCacheEvictions);
+  counters->unregisterCallback(kCPUThreadPoolPending);
+  counters->unregisterCallback(kCPUThreadPoolSteals);
 
   for (auto stage : RequestMetricsScope::requestStages) {
     for (auto metric : RequestMetricsScope::requestMetrics) {
@@ -559,11 +648,13 @@ Future<TakeoverData> EdenServer::stopMountsForTakeover(
   // Use collectAll() rather than collect() to wait for all of the unmounts
   // to complete, and only check for errors once everything has finished.
   return folly::collectAll(futures).toUnsafeFuture().thenValue(
-      [takeoverPromise = std::move(takeoverPromise)](
+      [this, takeoverPromise = std::move(takeoverPromise)](
           std::vector<folly::Try<optional<TakeoverData::MountInfo>>>
               results) mutable {
         TakeoverData data;
         data.takeoverComplete = std::move(takeoverPromise);
+        data.cachedTrees = treeCache_->getCachedHashes();
+        data.cachedBlobs = blobCache_->getCachedHashes();
         data.mountPoints.reserve(results.size());
         for (auto& result : results) {
           // If something went wrong shutting down a mount point,
@@ -593,26 +684,12 @@ Future<TakeoverData> EdenServer::stopMountsForTakeover(
 #endif
 
 void EdenServer::startPeriodicTasks() {
-  // Flush stats must run once every second for accurate aggregation of
-  // the time series & histogram buckets
-  flushStatsTask_.updateInterval(1s, /*splay=*/false);
-
   // Report memory usage stats once every 30 seconds
   memoryStatsTask_.updateInterval(30s);
+  buildSessionTask_.updateInterval(10s);
   auto config = serverState_->getReloadableConfig().getEdenConfig();
   updatePeriodicTaskIntervals(*config);
 
-#ifndef _WIN32
-  // Schedule a periodic job to unload unused inodes based on the last access
-  // time. currently Eden does not have accurate timestamp tracking for inodes,
-  // so using unloadChildrenNow just to validate the behaviour. We will have to
-  // modify current unloadChildrenNow function to unload inodes based on the
-  // last access time.
-  if (FLAGS_unload_interval_minutes > 0) {
-    scheduleInodeUnload(std::chrono::minutes(FLAGS_start_delay_minutes));
-  }
-#endif
-
   backingStoreTask_.updateInterval(1min);
 }
 
@@ -630,15 +707,147 @@ void EdenServer::updatePeriodicTaskIntervals(const EdenConfig& config) {
   checkValidityTask_.updateInterval(
       std::chrono::duration_cast<std::chrono::milliseconds>(
           config.checkValidityInterval.getValue()));
+
+  inodeUnloadTask_.updateInterval(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          config.backgroundUnloadInterval.getValue()));
 #endif
 
   localStoreTask_.updateInterval(
       std::chrono::duration_cast<std::chrono::milliseconds>(
           config.localStoreManagementInterval.getValue()));
+
+  // Stats are flushed without splay, so that each flush covers the same
+  // span of the exported time series.
+  flushStatsTask_.updateInterval(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          config.statsFlushInterval.getValue()),
+      /*splay=*/false);
+}
+
+EdenServer::BuildSessionStats EdenServer::startBuildSession(
+    const std::shared_ptr<EdenMount>& mount,
+    std::vector<RelativePath> prefixes,
+    std::chrono::seconds duration) {
+  auto mountPath = mount->getPath().stringPiece().str();
+  auto deadline = std::chrono::steady_clock::now() + duration;
+  BuildSessionStats stats;
+  {
+    auto sessions = buildSessions_.wlock();
+    auto it = sessions->find(mountPath);
+    if (it == sessions->end()) {
+      auto cacheStats = blobCache_->getStats();
+      BuildSession session;
+      session.deadline = deadline;
+      session.blobCacheHitsAtStart = cacheStats.hitCount;
+      session.blobCacheMissesAtStart = cacheStats.missCount;
+      it = sessions->emplace(mountPath, session).first;
+      XLOG(INFO) << "starting build session on " << mountPath << " for "
+                 << duration.count() << " seconds";
+      updateBuildMode(*sessions);
+    } else {
+      it->second.deadline = std::max(it->second.deadline, deadline);
+    }
+    stats = getBuildSessionStats(it->second);
+  }
+
+  if (!prefixes.empty()) {
+    // Builds read everything under their targets, so there is no depth limit.
+    auto depth = std::numeric_limits<size_t>::max();
+    mount->prefetchTrees(std::move(prefixes), depth)
+        .thenValue([this, mountPath](size_t loadedCount) {
+          auto sessions = buildSessions_.wlock();
+          auto it = sessions->find(mountPath);
+          if (it != sessions->end()) {
+            it->second.prefetchedTrees += loadedCount;
+          }
+        })
+        .thenError([mountPath](const folly::exception_wrapper& ew) {
+          XLOG(WARN) << "build session prefetch failed for " << mountPath
+                     << ": " << ew.what();
+        });
+  }
+  return stats;
+}
+
+std::optional<EdenServer::BuildSessionStats> EdenServer::endBuildSession(
+    folly::StringPiece mountPath) {
+  auto sessions = buildSessions_.wlock();
+  auto it = sessions->find(mountPath.str());
+  if (it == sessions->end()) {
+    return std::nullopt;
+  }
+  auto stats = getBuildSessionStats(it->second);
+  sessions->erase(it);
+  XLOG(INFO) << "ended build session on " << mountPath;
+  updateBuildMode(*sessions);
+  return stats;
+}
+
+EdenServer::BuildSessionStats EdenServer::getBuildSessionStats(
+    const BuildSession& session) const {
+  auto cacheStats = blobCache_->getStats();
+  BuildSessionStats stats;
+  stats.remaining = std::max(
+      std::chrono::seconds{0},
+      std::chrono::duration_cast<std::chrono::seconds>(
+          session.deadline - std::chrono::steady_clock::now()));
+  stats.prefetchedTrees = session.prefetchedTrees;
+  stats.blobCacheHits = cacheStats.hitCount - session.blobCacheHitsAtStart;
+  stats.blobCacheMisses = cacheStats.missCount - session.blobCacheMissesAtStart;
+  stats.deferredUnloads = session.deferredUnloads;
+  return stats;
+}
+
+void EdenServer::updateBuildMode(const BuildSessionMap& sessions) {
+  fb303::ServiceData::get()->setCounter(
+      kBuildSessionsCounterKey, sessions.size());
+  // Only the first session to start and the last to end change the mode.
+  if (sessions.size() > 1) {
+    return;
+  }
+  bool active = !sessions.empty();
+  blobCache_->setRetainReleasedBlobs(active);
+  std::vector<shared_ptr<BackingStore>> backingStores;
+  {
+    auto lockedStores = backingStores_.rlock();
+    for (auto& entry : *lockedStores) {
+      backingStores.emplace_back(entry.second);
+    }
+  }
+  for (auto& store : backingStores) {
+    store->setBuildSessionActive(active);
+  }
+}
+
+void EdenServer::expireBuildSessions() {
+  auto now = std::chrono::steady_clock::now();
+  auto sessions = buildSessions_.wlock();
+  bool expired = false;
+  for (auto it = sessions->begin(); it != sessions->end();) {
+    if (it->second.deadline <= now) {
+      XLOG(INFO) << "build session on " << it->first << " expired";
+      it = sessions->erase(it);
+      expired = true;
+    } else {
+      ++it;
+    }
+  }
+  if (expired) {
+    updateBuildMode(*sessions);
+  }
 }
 
 #ifndef _WIN32
 void EdenServer::unloadInodes() {
+  // A walk of large mounts can outlast a short interval.  Skip this run
+  // rather than walking the same inodes twice at once.
+  if (backgroundUnloadRunning_) {
+    XLOG(DBG4) << "Skipping periodic inode unload: previous one still running";
+    return;
+  }
+  XLOG(DBG4) << "Beginning periodic inode unload";
+
   struct Root {
     std::string mountName;
     TreeInodePtr rootInode;
@@ -646,40 +855,75 @@ void EdenServer::unloadInodes() {
   std::vector<Root> roots;
   {
     const auto mountPoints = mountPoints_.wlock();
+    auto sessions = buildSessions_.wlock();
     for (auto& entry : *mountPoints) {
+      // A build is about to read the inodes that would be unloaded.
+      auto session = sessions->find(entry.first.str());
+      if (session != sessions->end()) {
+        ++session->second.deferredUnloads;
+        continue;
+      }
       roots.emplace_back(Root{std::string{entry.first},
                               entry.second.edenMount->getRootInode()});
     }
   }
 
-  if (!roots.empty()) {
-    auto serviceData = fb303::ServiceData::get();
+  if (roots.empty()) {
+    return;
+  }
 
-    uint64_t totalUnloaded = serviceData->getCounter(kPeriodicUnloadCounterKey);
-    auto cutoff = std::chrono::system_clock::now() -
-        std::chrono::minutes(FLAGS_unload_age_minutes);
-    auto cutoff_ts = folly::to<timespec>(cutoff);
-    for (auto& [name, rootInode] : roots) {
-      auto unloaded = rootInode->unloadChildrenLastAccessedBefore(cutoff_ts);
-      if (unloaded) {
-        XLOG(INFO) << "Unloaded " << unloaded
-                   << " inodes in background from mount " << name;
-      }
-      totalUnloaded += unloaded;
-    }
-    serviceData->setCounter(kPeriodicUnloadCounterKey, totalUnloaded);
+  // Walk the mounts a slice at a time on the shared thread pool rather than
+  // the main event base, so neither FUSE requests nor other periodic tasks
+  // wait behind a large unload.
+  auto config = serverState_->getReloadableConfig().getEdenConfig();
+  auto cutoff = std::chrono::system_clock::now() -
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          config->backgroundUnloadAge.getValue());
+  auto cutoff_ts = folly::to<timespec>(cutoff);
+  // Unlike unloading under memory pressure, this can wait for everything
+  // else queued on the thread pool.
+  auto executor = folly::ExecutorWithPriority::create(
+      folly::getKeepAliveToken(serverState_->getThreadPool().get()),
+      folly::Executor::LO_PRI);
+  std::vector<std::string> names;
+  std::vector<Future<size_t>> futures;
+  for (auto& [name, rootInode] : roots) {
+    names.push_back(std::move(name));
+    futures.push_back(unloadInSlices(
+        std::move(rootInode),
+        cutoff_ts,
+        executor.copy(),
+        FLAGS_unload_slice_size));
   }
 
-  scheduleInodeUnload(std::chrono::minutes(FLAGS_unload_interval_minutes));
-}
+  backgroundUnloadRunning_ = true;
+  folly::collectAll(futures)
+      .via(mainEventBase_)
+      .thenValue([this, names = std::move(names)](
+                     std::vector<folly::Try<size_t>> results) {
+        size_t totalUnloaded = 0;
+        for (size_t i = 0; i < results.size(); ++i) {
+          if (results[i].hasException()) {
+            XLOG(ERR) << "Error unloading inodes in background from mount "
+                      << names[i] << ": "
+                      << folly::exceptionStr(results[i].exception());
+            continue;
+          }
+          auto unloaded = results[i].value();
+          if (unloaded) {
+            XLOG(INFO) << "Unloaded " << unloaded
+                       << " inodes in background from mount " << names[i];
+          }
+          totalUnloaded += unloaded;
+        }
 
-void EdenServer::scheduleInodeUnload(std::chrono::milliseconds timeout) {
-  mainEventBase_->timer().scheduleTimeoutFn(
-      [this] {
-        XLOG(DBG4) << "Beginning periodic inode unload";
-        unloadInodes();
-      },
-      timeout);
+        auto serviceData = fb303::ServiceData::get();
+        serviceData->setCounter(
+            kPeriodicUnloadCounterKey,
+            serviceData->getCounter(kPeriodicUnloadCounterKey) +
+                totalUnloaded);
+        backgroundUnloadRunning_ = false;
+      });
 }
 
 Future<Unit> EdenServer::recover(TakeoverData&& data) {
@@ -821,6 +1065,9 @@ Future<Unit> EdenServer::prepareImpl(
 #ifndef _WIN32
     mountFutures =
         prepareMountsTakeover(logger, std::move(takeoverData.mountPoints));
+    warmCachesAfterTakeover(
+        std::move(takeoverData.cachedTrees),
+        std::move(takeoverData.cachedBlobs));
 #else
     NOT_IMPLEMENTED();
 #endif // !_WIN32
@@ -840,6 +1087,73 @@ Future<Unit> EdenServer::prepareImpl(
   }
 }
 
+void EdenServer::warmCachesAfterTakeover(
+    std::vector<Hash> cachedTrees,
+    std::vector<Hash> cachedBlobs) {
+  if (cachedTrees.empty() && cachedBlobs.empty()) {
+    return;
+  }
+  XLOG(INFO) << "reloading the " << cachedTrees.size() << " trees and "
+             << cachedBlobs.size()
+             << " blobs cached by the previous edenfs process";
+
+  // Insert the least recently used first, so that the caches end up in the
+  // same order as in the previous process.
+  std::reverse(cachedTrees.begin(), cachedTrees.end());
+  std::reverse(cachedBlobs.begin(), cachedBlobs.end());
+
+  auto executor = folly::ExecutorWithPriority::create(
+      folly::getKeepAliveToken(serverState_->getThreadPool().get()),
+      folly::Executor::LO_PRI);
+  folly::via(
+      executor,
+      [localStore = localStore_,
+       treeCache = treeCache_,
+       blobCache = blobCache_,
+       cachedTrees = std::move(cachedTrees),
+       cachedBlobs = std::move(cachedBlobs)] {
+        folly::stop_watch<std::chrono::milliseconds> watch;
+        auto batchEnd = [](const std::vector<Hash>& hashes, size_t start) {
+          return hashes.begin() +
+              std::min(start + kCacheWarmingBatchSize, hashes.size());
+        };
+
+        size_t treeCount = 0;
+        for (size_t i = 0; i < cachedTrees.size();
+             i += kCacheWarmingBatchSize) {
+          std::vector<Hash> batch{
+              cachedTrees.begin() + i, batchEnd(cachedTrees, i)};
+          for (auto& tree : localStore->getTreeBatch(batch).get()) {
+            if (tree) {
+              treeCache->insert(std::move(tree));
+              ++treeCount;
+            }
+          }
+        }
+
+        size_t blobCount = 0;
+        for (size_t i = 0; i < cachedBlobs.size();
+             i += kCacheWarmingBatchSize) {
+          std::vector<Hash> batch{
+              cachedBlobs.begin() + i, batchEnd(cachedBlobs, i)};
+          for (auto& blob : localStore->getBlobBatch(batch).get()) {
+            if (blob) {
+              blobCache->insert(std::move(blob));
+              ++blobCount;
+            }
+          }
+        }
+
+        XLOG(INFO) << "reloaded " << treeCount << " trees and " << blobCount
+                   << " blobs into the memory caches in "
+                   << watch.elapsed().count() << "ms";
+      })
+      .thenError([](const folly::exception_wrapper& ew) {
+        XLOG(WARN) << "error reloading the memory caches after takeover: "
+                   << ew.what();
+      });
+}
+
 std::shared_ptr<cpptoml::table> EdenServer::parseConfig() {
   auto configPath = edenDir_.getPath() + RelativePathPiece{kStateConfig};
 
@@ -891,7 +1205,15 @@ bool EdenServer::openStorageEngine(
     ensureDirectoryExists(parentDir);
     logger.log("Opening local SQLite store ", path, "...");
     folly::stop_watch<std::chrono::milliseconds> watch;
-    localStore_ = make_shared<SqliteLocalStore>(path);
+    const auto& edenConfig = *serverState_->getEdenConfig();
+    std::optional<AbsolutePath> sharedCachePath;
+    if (auto sharedDir = edenConfig.sharedLocalStoreDir.getValue()) {
+      sharedCachePath = *sharedDir + RelativePathPiece{kSqlitePath};
+    }
+    localStore_ = make_shared<SqliteLocalStore>(
+        path,
+        edenConfig.sqliteReaderConnections.getValue(),
+        std::move(sharedCachePath));
     logger.log(
         "Opened SQLite store in ",
         watch.elapsed().count() / 1000.0,
@@ -904,10 +1226,20 @@ bool EdenServer::openStorageEngine(
     localStore_ = make_shared<RocksDbLocalStore>(
         rocksPath,
         serverState_->getStructuredLogger(),
-        &serverState_->getFaultInjector());
+        &serverState_->getFaultInjector(),
+        *serverState_->getEdenConfig());
     localStore_->enableBlobCaching.store(
         serverState_->getEdenConfig()->enableBlobCaching.getValue(),
         std::memory_order_relaxed);
+    localStore_->dedupeBlobContents.store(
+        serverState_->getEdenConfig()->dedupeBlobContents.getValue(),
+        std::memory_order_relaxed);
+    localStore_->compressBlobs.store(
+        serverState_->getEdenConfig()->compressBlobs.getValue(),
+        std::memory_order_relaxed);
+    localStore_->chunkLargeBlobs.store(
+        serverState_->getEdenConfig()->chunkLargeBlobs.getValue(),
+        std::memory_order_relaxed);
     logger.log(
         "Opened RocksDB store in ",
         watch.elapsed().count() / 1000.0,
@@ -985,46 +1317,59 @@ std::vector<Future<Unit>> EdenServer::prepareMounts(
   logger->log("Remounting ", dirs.size(), " mount points...");
 
   for (const auto& client : dirs.items()) {
-    auto mountFuture = makeFutureWith([&] {
-      MountInfo mountInfo;
-      *mountInfo.mountPoint_ref() = client.first.c_str();
-      auto edenClientPath =
-          edenDir_.getCheckoutStateDir(client.second.asString());
-      *mountInfo.edenClientPath_ref() = edenClientPath.stringPiece().str();
-      auto initialConfig = CheckoutConfig::loadFromClientDirectory(
-          AbsolutePathPiece{*mountInfo.mountPoint_ref()},
-          AbsolutePathPiece{*mountInfo.edenClientPath_ref()});
-      auto progressIndex = progressManager_->wlock()->registerEntry(
-          client.first.asString(), initialConfig->getOverlayPath().c_str());
-
-      return mount(
-                 std::move(initialConfig),
-                 false,
-                 [this, logger, progressIndex](auto percent) {
-                   progressManager_->wlock()->manageProgress(
-                       logger, progressIndex, percent);
-                 })
-          .thenTry(
-              [this,
-               logger,
-               mountPath = client.first.asString(),
-               progressIndex](folly::Try<std::shared_ptr<EdenMount>>&& result) {
-                if (result.hasValue()) {
-                  auto wl = progressManager_->wlock();
-                  wl->finishProgress(progressIndex);
-                  wl->printProgresses(logger);
-                  return makeFuture();
-                } else {
-                  incrementStartupMountFailures();
-                  logger->warn(
-                      "Failed to remount ",
-                      mountPath,
-                      ": ",
-                      result.exception().what());
-                  return makeFuture<Unit>(std::move(result).exception());
-                }
-              });
-    });
+    // Set up each checkout on the thread pool, so that loading its config and
+    // creating its stores is not serialized behind the checkouts before it.
+    auto mountFuture = folly::via(
+        serverState_->getThreadPool().get(),
+        [this,
+         logger,
+         mountPath = client.first.asString(),
+         clientName = client.second.asString()] {
+          folly::stop_watch<std::chrono::milliseconds> mountWatch;
+          MountInfo mountInfo;
+          *mountInfo.mountPoint_ref() = mountPath;
+          auto edenClientPath = edenDir_.getCheckoutStateDir(clientName);
+          *mountInfo.edenClientPath_ref() = edenClientPath.stringPiece().str();
+          auto initialConfig = CheckoutConfig::loadFromClientDirectory(
+              AbsolutePathPiece{*mountInfo.mountPoint_ref()},
+              AbsolutePathPiece{*mountInfo.edenClientPath_ref()});
+          auto progressIndex = progressManager_->wlock()->registerEntry(
+              mountPath, initialConfig->getOverlayPath().c_str());
+
+          return mount(
+                     std::move(initialConfig),
+                     false,
+                     [this, logger, progressIndex](auto percent) {
+                       progressManager_->wlock()->manageProgress(
+                           logger, progressIndex, percent);
+                     })
+              .thenTry(
+                  [this, logger, mountPath, progressIndex, mountWatch](
+                      folly::Try<std::shared_ptr<EdenMount>>&& result) {
+                    if (result.hasValue()) {
+                      {
+                        auto wl = progressManager_->wlock();
+                        wl->finishProgress(progressIndex);
+                        wl->printProgresses(logger);
+                      }
+                      logger->log(
+                          "Remounted ",
+                          mountPath,
+                          " in ",
+                          mountWatch.elapsed().count(),
+                          "ms");
+                      return makeFuture();
+                    } else {
+                      incrementStartupMountFailures();
+                      logger->warn(
+                          "Failed to remount ",
+                          mountPath,
+                          ": ",
+                          result.exception().what());
+                      return makeFuture<Unit>(std::move(result).exception());
+                    }
+                  });
+        });
 
     mountFutures.push_back(std::move(mountFuture));
   }
@@ -1172,6 +1517,16 @@ void EdenServer::registerStats(std::shared_ptr<EdenMount> edenMount) {
       edenMount->getCounterName(CounterName::INODEMAP_UNLOADED), [edenMount] {
         return edenMount->getInodeMap()->getInodeCounts().unloadedInodeCount;
       });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::INODEMAP_FILE_MEMORY),
+      [edenMount] {
+        return edenMount->getInodeMap()->getInodeCounts().fileInodeBytes;
+      });
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::INODEMAP_TREE_MEMORY),
+      [edenMount] {
+        return edenMount->getInodeMap()->getInodeCounts().treeInodeBytes;
+      });
 #endif
   counters->registerCallback(
       edenMount->getCounterName(CounterName::JOURNAL_MEMORY),
@@ -1225,6 +1580,10 @@ void EdenServer::unregisterStats(EdenMount* edenMount) {
       edenMount->getCounterName(CounterName::INODEMAP_LOADED));
   counters->unregisterCallback(
       edenMount->getCounterName(CounterName::INODEMAP_UNLOADED));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::INODEMAP_FILE_MEMORY));
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::INODEMAP_TREE_MEMORY));
 #endif
   counters->unregisterCallback(
       edenMount->getCounterName(CounterName::JOURNAL_MEMORY));
@@ -1304,11 +1663,17 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
   auto objectStore = ObjectStore::create(
       getLocalStore(),
       backingStore,
+      treeCache_,
       getSharedStats(),
       serverState_->getThreadPool().get(),
       serverState_->getProcessNameCache(),
       serverState_->getStructuredLogger(),
       serverState_->getReloadableConfig().getEdenConfig());
+  objectStore->enableFetchProfiles(initialConfig->getMountPath().value());
+  objectStore->enableCoAccessPrefetch(initialConfig->getMountPath().value());
+  if (mappedBlobCache_) {
+    objectStore->enableMappedBlobs(mappedBlobCache_);
+  }
   auto journal = std::make_unique<Journal>(getSharedStats());
 
   // Create the EdenMount object and insert the mount into the mountPoints_ map.
@@ -1845,6 +2210,166 @@ void EdenServer::reportMemoryStats() {
     fb303::ServiceData::get()->addStatValue(
         kRssBytes, memoryStats->resident, fb303::AVG);
   }
+
+  reportComponentMemory();
+  checkMemoryPressure(memoryStats ? memoryStats->resident : 0);
+}
+
+void EdenServer::reportComponentMemory() {
+  // The blob and tree caches are exported as dynamic counters, since their
+  // stats are cheap to read on demand.  Everything else here walks the
+  // mounts, so it is only sampled along with the RSS.
+  uint64_t fileInodeBytes = 0;
+  uint64_t treeInodeBytes = 0;
+  uint64_t unloadedInodes = 0;
+  uint64_t journalBytes = 0;
+  uint64_t metadataCacheBytes = 0;
+  {
+    const auto mountPoints = mountPoints_.rlock();
+    for (const auto& entry : *mountPoints) {
+      const auto& mount = entry.second.edenMount;
+      auto counts = mount->getInodeMap()->getInodeCounts();
+      fileInodeBytes += counts.fileInodeBytes;
+      treeInodeBytes += counts.treeInodeBytes;
+      unloadedInodes += counts.unloadedInodeCount;
+      journalBytes += mount->getJournal().estimateMemoryUsage();
+      metadataCacheBytes +=
+          mount->getObjectStore()->getMetadataCacheMemoryUsage();
+    }
+  }
+  auto localStoreBytes = localStore_ ? localStore_->getMemoryUsage() : 0;
+
+  fb303::fbData->setCounter(
+      "memory.inode_map.file_inode_bytes", fileInodeBytes);
+  fb303::fbData->setCounter(
+      "memory.inode_map.tree_inode_bytes", treeInodeBytes);
+  fb303::fbData->setCounter("memory.inode_map.unloaded_inodes", unloadedInodes);
+  fb303::fbData->setCounter("memory.journal_bytes", journalBytes);
+  fb303::fbData->setCounter("memory.metadata_cache_bytes", metadataCacheBytes);
+  fb303::fbData->setCounter("memory.local_store_bytes", localStoreBytes);
+}
+
+struct EdenServer::PressureUnload {
+  std::vector<std::string> mountNames;
+  size_t nextMount{0};
+  std::chrono::minutes age;
+  size_t target;
+  size_t unloaded{0};
+};
+
+size_t EdenServer::getLoadedInodeCount() {
+  size_t count = 0;
+  const auto mountPoints = mountPoints_.rlock();
+  for (const auto& entry : *mountPoints) {
+    auto counts = entry.second.edenMount->getInodeMap()->getInodeCounts();
+    count += counts.fileCount + counts.treeCount;
+  }
+  return count;
+}
+
+void EdenServer::checkMemoryPressure(uint64_t residentBytes) {
+#ifndef _WIN32
+  if (pressureUnloadRunning_) {
+    return;
+  }
+
+  auto config = serverState_->getReloadableConfig().getEdenConfig(
+      ConfigReloadBehavior::NoReload);
+  auto inodeHigh = config->unloadInodeHighWatermark.getValue();
+  auto rssHigh = config->unloadRssHighWatermark.getValue();
+  if (inodeHigh == 0 && rssHigh == 0) {
+    return;
+  }
+
+  auto loaded = getLoadedInodeCount();
+  bool overInodes = inodeHigh > 0 && loaded > inodeHigh;
+  bool overRss = rssHigh > 0 && residentBytes > rssHigh;
+  if (!overInodes && !overRss) {
+    return;
+  }
+
+  auto state = std::make_shared<PressureUnload>();
+  {
+    const auto mountPoints = mountPoints_.rlock();
+    for (const auto& entry : *mountPoints) {
+      state->mountNames.emplace_back(entry.first);
+    }
+  }
+  state->age = std::chrono::duration_cast<std::chrono::minutes>(
+      config->backgroundUnloadAge.getValue());
+  auto inodeLow = config->unloadInodeLowWatermark.getValue();
+  state->target = inodeLow > 0 ? inodeLow : loaded - loaded / 4;
+
+  XLOG(INFO) << "Unloading inodes under memory pressure: " << loaded
+             << " inodes loaded, " << residentBytes
+             << " bytes resident, unloading down to " << state->target
+             << " inodes";
+  pressureUnloadRunning_ = true;
+  unloadUnderPressure(std::move(state));
+#else
+  (void)residentBytes;
+#endif
+}
+
+void EdenServer::unloadUnderPressure(std::shared_ptr<PressureUnload> state) {
+#ifndef _WIN32
+  if (state->nextMount == state->mountNames.size()) {
+    // Every mount has been visited with this age; move on to inodes that were
+    // accessed more recently.
+    state->nextMount = 0;
+    state->age /= 2;
+  }
+  if (state->age < kMinPressureUnloadAge ||
+      getLoadedInodeCount() <= state->target) {
+    XLOG(INFO) << "Unloaded " << state->unloaded
+               << " inodes under memory pressure";
+    pressureUnloadRunning_ = false;
+    return;
+  }
+
+  const auto& name = state->mountNames[state->nextMount++];
+  TreeInodePtr rootInode;
+  {
+    const auto mountPoints = mountPoints_.rlock();
+    auto it = mountPoints->find(name);
+    if (it != mountPoints->end()) {
+      rootInode = it->second.edenMount->getRootInode();
+    }
+  }
+  if (!rootInode) {
+    mainEventBase_->runInEventBaseThread(
+        [this, state = std::move(state)]() mutable {
+          unloadUnderPressure(std::move(state));
+        });
+    return;
+  }
+
+  auto cutoff =
+      folly::to<timespec>(std::chrono::system_clock::now() - state->age);
+  unloadInSlices(
+      std::move(rootInode),
+      cutoff,
+      folly::getKeepAliveToken(serverState_->getThreadPool().get()),
+      FLAGS_unload_slice_size)
+      .via(mainEventBase_)
+      .thenTry([this, state = std::move(state)](
+                   folly::Try<size_t> unloaded) mutable {
+        if (unloaded.hasException()) {
+          XLOG(ERR) << "Error unloading inodes under memory pressure: "
+                    << folly::exceptionStr(unloaded.exception());
+        } else {
+          state->unloaded += unloaded.value();
+          auto serviceData = fb303::ServiceData::get();
+          serviceData->setCounter(
+              kPeriodicUnloadCounterKey,
+              serviceData->getCounter(kPeriodicUnloadCounterKey) +
+                  unloaded.value());
+        }
+        unloadUnderPressure(std::move(state));
+      });
+#else
+  (void)state;
+#endif
 }
 
 void EdenServer::manageLocalStore() {
@@ -1872,6 +2397,10 @@ void EdenServer::reloadConfig() {
   auto config = serverState_->getReloadableConfig().getEdenConfig(
       ConfigReloadBehavior::ForceReload);
 
+  // Apply the resource limits that can change while EdenFS runs.
+  blobCache_->setMaximumCacheSize(config->blobCacheSize.getValue());
+  serverState_->resizeFuseRequestPools(*config);
+
   // Update all periodic tasks that are controlled by config settings.
   // This should be cheap, so for now we just block on this to finish rather
   // than returning a Future.  We could change this to return a Future if we
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -47,6 +48,7 @@
 #endif
 
 constexpr folly::StringPiece kPeriodicUnloadCounterKey{"PeriodicUnloadCounter"};
+constexpr folly::StringPiece kBuildSessionsCounterKey{"build_sessions.active"};
 DECLARE_bool(takeover);
 
 namespace cpptoml {
@@ -72,10 +74,12 @@ class BlobCache;
 class Dirstate;
 class EdenServiceHandler;
 class LocalStore;
+class MappedBlobCache;
 class MountInfo;
 class Notifications;
 struct SessionInfo;
 class StartupLogger;
+class TreeCache;
 class UserInfo;
 
 #ifndef _WIN32
@@ -294,6 +298,43 @@ class EdenServer : private TakeoverHandler {
    */
   std::shared_ptr<EdenMount> getMountUnsafe(folly::StringPiece mountPath) const;
 
+  /**
+   * What a build session has done so far.  The BlobCache is shared by all
+   * mounts, so its hits and misses are those of every mount since the
+   * session started.
+   */
+  struct BuildSessionStats {
+    std::chrono::seconds remaining{0};
+    size_t prefetchedTrees{0};
+    uint64_t blobCacheHits{0};
+    uint64_t blobCacheMisses{0};
+    /** The background unload runs that skipped the mount. */
+    uint64_t deferredUnloads{0};
+  };
+
+  /**
+   * Starts a build session on a mount, or extends the one in progress, so
+   * that it lasts at least `duration` from now.
+   *
+   * The trees under `prefixes` are prefetched.  While any session is
+   * active, the backing stores import with more workers and larger batches,
+   * and the BlobCache keeps blobs after their last reader drops them.
+   * Background unloading skips the mounts with an active session, though
+   * unloading under memory pressure does not.  All of this reverts when the
+   * last session ends.
+   */
+  BuildSessionStats startBuildSession(
+      const std::shared_ptr<EdenMount>& mount,
+      std::vector<RelativePath> prefixes,
+      std::chrono::seconds duration);
+
+  /**
+   * Ends the build session of the mount at mountPath, and returns what it
+   * did, or std::nullopt if it has none.
+   */
+  std::optional<BuildSessionStats> endBuildSession(
+      folly::StringPiece mountPath);
+
   std::shared_ptr<LocalStore> getLocalStore() const {
     return localStore_;
   }
@@ -302,6 +343,10 @@ class EdenServer : private TakeoverHandler {
     return blobCache_;
   }
 
+  const std::shared_ptr<TreeCache>& getTreeCache() const {
+    return treeCache_;
+  }
+
   /**
    * Look up the BackingStore object for the specified repository type+name.
    *
@@ -346,9 +391,10 @@ class EdenServer : private TakeoverHandler {
   /**
    * Flush all thread-local stats to the main ServiceData object.
    *
-   * Thread-local counters are normally flushed to the main ServiceData once
-   * a second.  flushStatsNow() can be used to flush thread-local counters on
-   * demand, in addition to the normal once-a-second flush.
+   * Thread-local counters are normally flushed to the main ServiceData every
+   * telemetry:stats-flush-interval, once a second by default.
+   * flushStatsNow() can be used to flush thread-local counters on demand, in
+   * addition to the normal periodic flush.
    *
    * This is mainly useful for unit and integration tests that want to ensure
    * they see up-to-date counter information without waiting for the normal
@@ -417,18 +463,32 @@ class EdenServer : private TakeoverHandler {
   void startPeriodicTasks();
   void updatePeriodicTaskIntervals(const EdenConfig& config);
 
+  // Perform unloading of inodes based on their last access time.  Runs every
+  // core:background-unload-interval and applies to all mounts.  The mounts
+  // are walked in slices on the server's thread pool; a run that starts
+  // before the previous one's walks have finished does nothing.
+  void unloadInodes();
+
+  struct BuildSession {
+    std::chrono::steady_clock::time_point deadline;
+    uint64_t blobCacheHitsAtStart{0};
+    uint64_t blobCacheMissesAtStart{0};
+    size_t prefetchedTrees{0};
+    uint64_t deferredUnloads{0};
+  };
+  using BuildSessionMap = std::unordered_map<std::string, BuildSession>;
+
+  BuildSessionStats getBuildSessionStats(const BuildSession& session) const;
+
   /**
-   * Schedule a call to unloadInodes() to happen after timeout
-   * has expired.
-   * Must be called only from the eventBase thread.
+   * Applies or reverts the effects of build sessions on the shared caches
+   * and backing stores, and updates the active session counter.  Called with
+   * the sessions locked, whenever one starts or ends.
    */
-  void scheduleInodeUnload(std::chrono::milliseconds timeout);
+  void updateBuildMode(const BuildSessionMap& sessions);
 
-  // Perform unloading of inodes based on their last access time
-  // and then schedule another call to unloadInodes() to happen
-  // at the next appropriate interval.  The unload attempt applies to
-  // all mounts.
-  void unloadInodes();
+  /** Ends the build sessions whose deadline has passed. */
+  void expireBuildSessions();
 
   std::shared_ptr<BackingStore> createBackingStore(
       folly::StringPiece type,
@@ -450,6 +510,16 @@ class EdenServer : private TakeoverHandler {
       std::shared_ptr<StartupLogger> logger);
   static void incrementStartupMountFailures();
 
+  /**
+   * Reload the trees and blobs that the previous edenfs process had cached in
+   * memory from the LocalStore, at low priority on the thread pool, so that
+   * the caches are warm again soon after a graceful takeover.  Hashes that
+   * are missing from the LocalStore are skipped rather than fetched.
+   */
+  void warmCachesAfterTakeover(
+      std::vector<Hash> cachedTrees,
+      std::vector<Hash> cachedBlobs);
+
 #ifndef _WIN32
   /**
    * recoverImpl() contains the bulk of the implementation of recover()
@@ -506,8 +576,27 @@ class EdenServer : private TakeoverHandler {
   void registerStats(std::shared_ptr<EdenMount> edenMount);
   void unregisterStats(EdenMount* edenMount);
 
-  // Report memory usage statistics to ServiceData.
+  // Report memory usage statistics to ServiceData, and start unloading inodes
+  // if the memory use crossed one of the configured high watermarks.
   void reportMemoryStats();
+  // Export the memory held by each of the larger in-memory structures, so
+  // that growth can be attributed to the component responsible for it.
+  void reportComponentMemory();
+
+  struct PressureUnload;
+
+  // Returns the number of loaded inodes across all mounts.
+  size_t getLoadedInodeCount();
+
+  // Starts unloading inodes if residentBytes or the number of loaded inodes
+  // crossed their high watermark.
+  void checkMemoryPressure(uint64_t residentBytes);
+
+  // Unloads inodes from one mount in slices on the server's thread pool, then
+  // continues on the main event base until the low watermark is reached.
+  // Inodes not accessed for progressively shorter durations are unloaded,
+  // approximating LRU order.
+  void unloadUnderPressure(std::shared_ptr<PressureUnload> state);
 
   // Compute stats for the local store and perform garbage collection if
   // necessary
@@ -561,9 +650,23 @@ class EdenServer : private TakeoverHandler {
   std::shared_ptr<LocalStore> localStore_;
   folly::Synchronized<BackingStoreMap> backingStores_;
   const std::shared_ptr<BlobCache> blobCache_;
+  const std::shared_ptr<TreeCache> treeCache_;
+  /* Null unless store:mapped-blob-threshold is set. */
+  const std::shared_ptr<MappedBlobCache> mappedBlobCache_;
 
   folly::Synchronized<MountMap> mountPoints_;
 
+  // Whether unloadUnderPressure() is in progress.  Only accessed from the main
+  // event base.
+  bool pressureUnloadRunning_{false};
+
+  // Whether a walk started by unloadInodes() is in progress.  Only accessed
+  // from the main event base.
+  bool backgroundUnloadRunning_{false};
+
+  // The active build sessions, by mount path.
+  folly::Synchronized<BuildSessionMap> buildSessions_;
+
 #ifndef _WIN32
   /**
    * A server that waits on a new edenfs process to attempt
@@ -666,6 +769,13 @@ class EdenServer : private TakeoverHandler {
   PeriodicFnTask<&EdenServer::refreshBackingStore> backingStoreTask_{
       this,
       "backing_store"};
+#ifndef _WIN32
+  PeriodicFnTask<&EdenServer::unloadInodes> inodeUnloadTask_{this,
+                                                             "inode_unload"};
+#endif
+  PeriodicFnTask<&EdenServer::expireBuildSessions> buildSessionTask_{
+      this,
+      "build_sessions"};
 };
 } // namespace eden
 } // namespace facebook
@@ -50,6 +50,7 @@
 #include "eden/fs/model/TreeEntry.h"
 #include "eden/fs/service/EdenError.h"
 #include "eden/fs/service/EdenServer.h"
+#include "eden/fs/service/ThriftLoadShedder.h"
 #include "eden/fs/service/ThriftPermissionChecker.h"
 #include "eden/fs/service/ThriftUtil.h"
 #include "eden/fs/store/BlobMetadata.h"
@@ -57,10 +58,12 @@
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/TreePrefetch.h"
 #include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/Clock.h"
 #include "eden/fs/utils/FaultInjector.h"
+#include "eden/fs/utils/FrontCodedPaths.h"
 #include "eden/fs/utils/ProcUtil.h"
 #include "eden/fs/utils/StatTimes.h"
 
@@ -98,6 +101,13 @@ std::string toDelimWrapper(StringPiece arg1, const Args&... rest) {
 }
 
 using facebook::eden::Hash;
+
+/**
+ * The minimum time between two journal positions sent to a
+ * subscribeStreamTemporary() client.
+ */
+constexpr auto kJournalNotificationInterval = std::chrono::milliseconds{10};
+
 std::string logHash(StringPiece thriftArg) {
   if (thriftArg.size() == Hash::RAW_SIZE) {
     return Hash{folly::ByteRange{thriftArg}}.toString();
@@ -245,6 +255,103 @@ facebook::eden::InodePtr inodeFromUserPath(
         .get();
   }
 }
+
+/**
+ * Returns the regular file that getSHA1() was asked about, or nullptr if it is
+ * one that resolveEntries() found without loading its inode, throwing the
+ * error to report for path if it does not name a regular file.
+ */
+facebook::eden::FileInodePtr getFileForSHA1(
+    StringPiece path,
+    const Try<facebook::eden::ResolvedEntry>& entry) {
+  using facebook::eden::dtype_t;
+  using facebook::eden::EdenErrorType;
+  using facebook::eden::newEdenError;
+
+  if (path.empty()) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "path cannot be the empty string");
+  }
+
+  const auto& resolved = entry.value();
+  if (!resolved.inode) {
+    auto dtype = resolved.getDtype();
+    if (dtype == dtype_t::Dir) {
+      throw newEdenError(
+          EISDIR, EdenErrorType::POSIX_ERROR, path, ": Is a directory");
+    }
+    if (dtype != dtype_t::Regular) {
+      throw newEdenError(
+          EINVAL, EdenErrorType::POSIX_ERROR, path, ": file is a symlink");
+    }
+    return nullptr;
+  }
+
+  auto fileInode = resolved.inode.asFilePtr();
+  if (!S_ISREG(fileInode->getMode())) {
+    // We intentionally want to refuse to compute the SHA1 of symlinks
+    throw facebook::eden::InodeError(EINVAL, fileInode, "file is a symlink");
+  }
+  return fileInode;
+}
+
+/**
+ * Returns the blob whose metadata gives the size of entry, if it is a file
+ * that is unchanged from source control and its size is not already known.
+ */
+std::optional<facebook::eden::Hash> getBlobHashForSize(
+    const facebook::eden::ResolvedEntry& entry) {
+  if (entry.inode) {
+    if (auto fileInode = entry.inode.asFilePtrOrNull()) {
+      return fileInode->getBlobHash();
+    }
+    return std::nullopt;
+  }
+  if (entry.size || entry.getDtype() == facebook::eden::dtype_t::Dir) {
+    return std::nullopt;
+  }
+  return entry.hash;
+}
+
+facebook::eden::FileInformation fileInformationFromStat(const struct stat& st) {
+  facebook::eden::FileInformation info;
+  *info.size_ref() = st.st_size;
+  auto ts = facebook::eden::stMtime(st);
+  *info.mtime_ref()->seconds_ref() = ts.tv_sec;
+  *info.mtime_ref()->nanoSeconds_ref() = ts.tv_nsec;
+  *info.mode_ref() = st.st_mode;
+  return info;
+}
+
+/**
+ * Returns the FileInformation of an entry that resolveEntries() found without
+ * loading its inode, as the inode would report it once loaded, given the size
+ * of its contents.
+ */
+facebook::eden::FileInformation getFileInformationForEntry(
+    const facebook::eden::EdenMount& mount,
+    const facebook::eden::ResolvedEntry& entry,
+    uint64_t size) {
+  facebook::eden::FileInformation info;
+  *info.size_ref() = size;
+  *info.mode_ref() = entry.mode;
+  auto mtime = mount.getLastCheckoutTime();
+#ifndef _WIN32
+  // An inode that has been loaded before keeps the metadata it was given.
+  if (entry.inodeNumber) {
+    if (auto metadata =
+            mount.getInodeMetadataTable()->getOptional(*entry.inodeNumber)) {
+      *info.mode_ref() = metadata->mode;
+      mtime = metadata->timestamps.mtime.toTimespec();
+    }
+  }
+#endif // !_WIN32
+  *info.mtime_ref()->seconds_ref() = mtime.tv_sec;
+  *info.mtime_ref()->nanoSeconds_ref() = mtime.tv_nsec;
+  return info;
+}
 } // namespace
 
 // INSTRUMENT_THRIFT_CALL returns a unique pointer to
@@ -310,6 +417,7 @@ EdenServiceHandler::EdenServiceHandler(
       {"listMounts", {20, 0, 1000}},
       {"resetParentCommits", {20, 0, 1000}},
       {"getCurrentJournalPosition", {20, 0, 1000}},
+      {"getCheckoutProgressInfo", {20, 0, 1000}},
       {"flushStatsNow", {20, 0, 1000}},
       {"reloadConfig", {200, 0, 10000}},
   };
@@ -348,6 +456,8 @@ EdenServiceHandler::getProcessor() {
     processor->addEventHandler(
         std::make_shared<ThriftPermissionChecker>(server_->getServerState()));
   }
+  processor->addEventHandler(
+      std::make_shared<ThriftLoadShedder>(server_->getServerState()));
   return processor;
 }
 
@@ -426,6 +536,14 @@ void EdenServiceHandler::checkOutRevision(
   results = std::move(std::move(checkoutFuture).get().conflicts);
 }
 
+void EdenServiceHandler::getCheckoutProgressInfo(
+    CheckoutProgressInfo& out,
+    std::unique_ptr<std::string> mountPoint) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG4, *mountPoint);
+  auto edenMount = server_->getMount(*mountPoint);
+  out = edenMount->getCheckoutProgress();
+}
+
 void EdenServiceHandler::resetParentCommits(
     std::unique_ptr<std::string> mountPoint,
     std::unique_ptr<WorkingDirectoryParents> parents) {
@@ -447,13 +565,62 @@ void EdenServiceHandler::getSHA1(
     unique_ptr<vector<string>> paths) {
   TraceBlock block("getSHA1");
   auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint, toLogArg(*paths));
+  auto edenMount = server_->getMount(*mountPoint);
+  auto& fetchContext = helper->getFetchContext();
+
+  // Resolve every path together so that each parent directory is visited
+  // once, and without loading inodes for unmaterialized files.
+  auto entries =
+      collectAll(
+          resolveEntries(edenMount->getRootInode(), *paths, fetchContext))
+          .get();
+
+  // Files that are not materialized have the SHA-1 of their source control
+  // blob.  Look those up in one batch rather than one blob at a time.
   vector<Future<Hash>> futures;
-  for (const auto& path : *paths) {
-    futures.emplace_back(getSHA1ForPathDefensively(
-        *mountPoint, path, helper->getFetchContext()));
+  futures.reserve(paths->size());
+  vector<size_t> blobIndices;
+  vector<Hash> blobIds;
+  for (size_t i = 0; i < paths->size(); ++i) {
+    auto fileInode = folly::makeTryWith(
+        [&] { return getFileForSHA1((*paths)[i], entries[i]); });
+    if (fileInode.hasException()) {
+      futures.push_back(makeFuture<Hash>(std::move(fileInode.exception())));
+      continue;
+    }
+    if (!fileInode.value()) {
+      const auto& entry = entries[i].value();
+      if (entry.sha1) {
+        futures.push_back(makeFuture(*entry.sha1));
+        continue;
+      }
+      blobIndices.push_back(i);
+      blobIds.push_back(entry.hash);
+      futures.push_back(makeFuture(Hash{}));
+      continue;
+    }
+    if (auto blobHash = fileInode.value()->getBlobHash()) {
+      // Replaced by the result of the batched lookup below.
+      blobIndices.push_back(i);
+      blobIds.push_back(*blobHash);
+      futures.push_back(makeFuture(Hash{}));
+      continue;
+    }
+    futures.push_back(fileInode.value()->getSha1(fetchContext));
   }
 
+  auto metadataFuture = edenMount->getObjectStore()->getBlobMetadataBatch(
+      blobIds, fetchContext);
   auto results = folly::collectAll(std::move(futures)).get();
+  auto metadata = std::move(metadataFuture).get();
+  for (size_t j = 0; j < blobIndices.size(); ++j) {
+    if (metadata[j].hasValue()) {
+      results[blobIndices[j]] = Try<Hash>{metadata[j]->sha1};
+    } else {
+      results[blobIndices[j]] = Try<Hash>{std::move(metadata[j].exception())};
+    }
+  }
+
   for (auto& result : results) {
     out.emplace_back();
     SHA1Result& sha1Result = out.back();
@@ -465,39 +632,6 @@ void EdenServiceHandler::getSHA1(
   }
 }
 
-Future<Hash> EdenServiceHandler::getSHA1ForPathDefensively(
-    StringPiece mountPoint,
-    StringPiece path,
-    ObjectFetchContext& fetchContext) noexcept {
-  return folly::makeFutureWith(
-      [&] { return getSHA1ForPath(mountPoint, path, fetchContext); });
-}
-
-Future<Hash> EdenServiceHandler::getSHA1ForPath(
-    StringPiece mountPoint,
-    StringPiece path,
-    ObjectFetchContext& fetchContext) {
-  if (path.empty()) {
-    return makeFuture<Hash>(newEdenError(
-        EINVAL,
-        EdenErrorType::ARGUMENT_ERROR,
-        "path cannot be the empty string"));
-  }
-
-  auto edenMount = server_->getMount(mountPoint);
-  auto relativePath = RelativePathPiece{path};
-  return edenMount->getInode(relativePath)
-      .thenValue([&fetchContext](const InodePtr& inode) {
-        auto fileInode = inode.asFilePtr();
-        if (!S_ISREG(fileInode->getMode())) {
-          // We intentionally want to refuse to compute the SHA1 of symlinks
-          return makeFuture<Hash>(
-              InodeError(EINVAL, fileInode, "file is a symlink"));
-        }
-        return fileInode->getSha1(fetchContext);
-      });
-}
-
 void EdenServiceHandler::getBindMounts(
     std::vector<std::string>&,
     std::unique_ptr<std::string>) {
@@ -611,8 +745,12 @@ EdenServiceHandler::subscribeStreamTemporary(
   auto stream = std::make_shared<Publisher>(
       std::move(streamAndPublisher.second), std::move(disconnected));
 
-  // This is called each time the journal is updated
-  auto onJournalChange = [weakMount, stream = std::move(stream)]() mutable {
+  // This is called on the server thread pool after the journal is updated.
+  // Updates are coalesced so that a checkout that records many changes sends
+  // a few positions rather than one per change.
+  auto onJournalChange = [weakMount, stream = std::move(stream)](
+                             Journal::SequenceNumber /* from */,
+                             Journal::SequenceNumber /* to */) mutable {
     auto mount = weakMount.lock();
     if (mount) {
       auto& journal = mount->getJournal();
@@ -633,21 +771,28 @@ EdenServiceHandler::subscribeStreamTemporary(
 
   // Register onJournalChange with the journal subsystem, and assign
   // the subscriber id into the handle so that the callbacks can consume it.
-  handle->emplace(
-      edenMount->getJournal().registerSubscriber(std::move(onJournalChange)));
+  Journal::SubscriberOptions options;
+  options.executor = folly::getKeepAliveToken(
+      server_->getServerState()->getThreadPool().get());
+  options.minInterval = kJournalNotificationInterval;
+  handle->emplace(edenMount->getJournal().registerSubscriber(
+      std::move(onJournalChange), std::move(options)));
 
   return std::move(streamAndPublisher.first);
 }
 
-void EdenServiceHandler::getFilesChangedSince(
-    FileDelta& out,
-    std::unique_ptr<std::string> mountPoint,
-    std::unique_ptr<JournalPosition> fromPosition) {
-  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint);
-  auto edenMount = server_->getMount(*mountPoint);
+namespace {
+/**
+ * The number of journal deltas summed into each chunk sent by
+ * streamFilesChangedSince().
+ */
+constexpr size_t kFilesChangedChunkSize = 10000;
 
-  if (*fromPosition->mountGeneration_ref() !=
-      static_cast<ssize_t>(edenMount->getMountGeneration())) {
+void checkMountGeneration(
+    const JournalPosition& position,
+    const EdenMount& edenMount) {
+  if (*position.mountGeneration_ref() !=
+      static_cast<ssize_t>(edenMount.getMountGeneration())) {
     throw newEdenError(
         ERANGE,
         EdenErrorType::MOUNT_GENERATION_CHANGED,
@@ -655,19 +800,87 @@ void EdenServiceHandler::getFilesChangedSince(
         "mountGeneration.  "
         "You need to compute a new basis for delta queries.");
   }
+}
+
+/**
+ * Fill out with the changes in summed.  If compactPaths is set, the paths
+ * are front coded into the compact fields instead of copied into lists.
+ */
+void populateFileDelta(
+    FileDelta& out,
+    const JournalDeltaRange& summed,
+    uint64_t mountGeneration,
+    bool compactPaths = false) {
+  *out.toPosition_ref()->sequenceNumber_ref() = summed.toSequence;
+  *out.toPosition_ref()->snapshotHash_ref() = thriftHash(summed.toHash);
+  *out.toPosition_ref()->mountGeneration_ref() = mountGeneration;
+
+  *out.fromPosition_ref()->sequenceNumber_ref() = summed.fromSequence;
+  *out.fromPosition_ref()->snapshotHash_ref() = thriftHash(summed.fromHash);
+  *out.fromPosition_ref()->mountGeneration_ref() = mountGeneration;
+
+  if (compactPaths) {
+    std::vector<folly::StringPiece> changedPaths;
+    std::vector<folly::StringPiece> createdPaths;
+    for (const auto& [path, changeInfo] : summed.changedFilesInOverlay) {
+      (changeInfo.isNew() ? createdPaths : changedPaths)
+          .push_back(path.stringPiece());
+    }
+    std::vector<folly::StringPiece> uncleanPaths;
+    uncleanPaths.reserve(summed.uncleanPaths.size());
+    for (const auto& path : summed.uncleanPaths) {
+      uncleanPaths.push_back(path.stringPiece());
+    }
+    *out.compactChangedPaths_ref() =
+        encodeFrontCodedPaths(std::move(changedPaths));
+    *out.compactCreatedPaths_ref() =
+        encodeFrontCodedPaths(std::move(createdPaths));
+    *out.compactUncleanPaths_ref() =
+        encodeFrontCodedPaths(std::move(uncleanPaths));
+    return;
+  }
+
+  for (const auto& entry : summed.changedFilesInOverlay) {
+    auto& path = entry.first;
+    auto& changeInfo = entry.second;
+    if (changeInfo.isNew()) {
+      out.createdPaths_ref()->emplace_back(path.stringPiece().str());
+    } else {
+      out.changedPaths_ref()->emplace_back(path.stringPiece().str());
+    }
+  }
+
+  for (auto& path : summed.uncleanPaths) {
+    out.uncleanPaths_ref()->emplace_back(path.stringPiece().str());
+  }
+}
+
+/**
+ * Fill out with the changes made to edenMount since fromPosition, only
+ * reporting the paths selected by filter unless it is null, and front coding
+ * them if compactPaths is set.
+ */
+void getFilesChangedSinceImpl(
+    FileDelta& out,
+    EdenMount& edenMount,
+    const JournalPosition& fromPosition,
+    const JournalPathFilter* filter,
+    bool compactPaths = false) {
+  checkMountGeneration(fromPosition, edenMount);
 
   // The +1 is because the core merge stops at the item prior to
   // its limitSequence parameter and we want the changes *since*
   // the provided sequence number.
-  auto summed = edenMount->getJournal().accumulateRange(
-      *fromPosition->sequenceNumber_ref() + 1);
+  auto limitSequence = *fromPosition.sequenceNumber_ref() + 1;
+  auto summed = filter
+      ? edenMount.getJournal().accumulateRange(limitSequence, *filter)
+      : edenMount.getJournal().accumulateRange(limitSequence);
 
   // We set the default toPosition to be where we where if summed is null
   *out.toPosition_ref()->sequenceNumber_ref() =
-      *fromPosition->sequenceNumber_ref();
-  *out.toPosition_ref()->snapshotHash_ref() = *fromPosition->snapshotHash_ref();
-  *out.toPosition_ref()->mountGeneration_ref() =
-      edenMount->getMountGeneration();
+      *fromPosition.sequenceNumber_ref();
+  *out.toPosition_ref()->snapshotHash_ref() = *fromPosition.snapshotHash_ref();
+  *out.toPosition_ref()->mountGeneration_ref() = edenMount.getMountGeneration();
 
   *out.fromPosition_ref() = *out.toPosition_ref();
 
@@ -678,30 +891,134 @@ void EdenServiceHandler::getFilesChangedSince(
           EdenErrorType::JOURNAL_TRUNCATED,
           "Journal entry range has been truncated.");
     }
-    *out.toPosition_ref()->sequenceNumber_ref() = summed->toSequence;
-    *out.toPosition_ref()->snapshotHash_ref() = thriftHash(summed->toHash);
-    *out.toPosition_ref()->mountGeneration_ref() =
-        edenMount->getMountGeneration();
-
-    *out.fromPosition_ref()->sequenceNumber_ref() = summed->fromSequence;
-    *out.fromPosition_ref()->snapshotHash_ref() = thriftHash(summed->fromHash);
-    *out.fromPosition_ref()->mountGeneration_ref() =
-        *out.toPosition_ref()->mountGeneration_ref();
-
-    for (const auto& entry : summed->changedFilesInOverlay) {
-      auto& path = entry.first;
-      auto& changeInfo = entry.second;
-      if (changeInfo.isNew()) {
-        out.createdPaths_ref()->emplace_back(path.stringPiece().str());
-      } else {
-        out.changedPaths_ref()->emplace_back(path.stringPiece().str());
-      }
-    }
+    populateFileDelta(
+        out, *summed, edenMount.getMountGeneration(), compactPaths);
+  }
+}
 
-    for (auto& path : summed->uncleanPaths) {
-      out.uncleanPaths_ref()->emplace_back(path.stringPiece().str());
-    }
+/**
+ * Move the entries of status into its compact fields.  The entries are
+ * already sorted, as thrift maps are std::maps.
+ */
+void compactScmStatus(ScmStatus& status) {
+  FrontCodedPathsBuilder builder;
+  auto& statuses = *status.compactStatuses_ref();
+  statuses.reserve(status.entries_ref()->size());
+  for (const auto& [path, fileStatus] : *status.entries_ref()) {
+    builder.add(path);
+    statuses.push_back(fileStatus);
+  }
+  *status.compactPaths_ref() = builder.finish();
+  status.entries_ref()->clear();
+}
+
+std::vector<RelativePath> toRelativePaths(
+    const std::vector<std::string>& paths) {
+  std::vector<RelativePath> result;
+  result.reserve(paths.size());
+  for (const auto& path : paths) {
+    result.emplace_back(path);
+  }
+  return result;
+}
+} // namespace
+
+void EdenServiceHandler::getFilesChangedSince(
+    FileDelta& out,
+    std::unique_ptr<std::string> mountPoint,
+    std::unique_ptr<JournalPosition> fromPosition) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint);
+  auto edenMount = server_->getMount(*mountPoint);
+  getFilesChangedSinceImpl(out, *edenMount, *fromPosition, nullptr);
+}
+
+void EdenServiceHandler::getFilesChangedSinceFiltered(
+    FileDelta& out,
+    std::unique_ptr<GetFilesChangedSinceParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *params->mountPoint_ref());
+  auto edenMount = server_->getMount(*params->mountPoint_ref());
+
+  const auto& filterParams = *params->filter_ref();
+  std::optional<JournalPathFilter> filter;
+  try {
+    filter.emplace(
+        toRelativePaths(*filterParams.includePrefixes_ref()),
+        toRelativePaths(*filterParams.excludePrefixes_ref()),
+        *filterParams.includeGlobs_ref());
+  } catch (const std::logic_error& ex) {
+    // Both invalid paths and invalid globs.
+    throw newEdenError(EINVAL, EdenErrorType::ARGUMENT_ERROR, ex.what());
   }
+  getFilesChangedSinceImpl(
+      out,
+      *edenMount,
+      *params->fromPosition_ref(),
+      &*filter,
+      *params->compactPaths_ref());
+}
+
+apache::thrift::ServerStream<FileDelta>
+EdenServiceHandler::streamFilesChangedSince(
+    std::unique_ptr<std::string> mountPoint,
+    std::unique_ptr<JournalPosition> fromPosition) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint);
+  auto edenMount = server_->getMount(*mountPoint);
+  checkMountGeneration(*fromPosition, *edenMount);
+
+  auto disconnected = std::make_shared<std::atomic<bool>>(false);
+  auto streamAndPublisher =
+      apache::thrift::ServerStream<FileDelta>::createPublisher(
+          [disconnected] { disconnected->store(true); });
+
+  // Sum the journal on the server thread pool so that the first chunks can
+  // be sent while later ones are still being computed.
+  server_->getServerState()->getThreadPool()->add(
+      [edenMount,
+       fromPosition = std::move(fromPosition),
+       disconnected,
+       publisher = std::move(streamAndPublisher.second)]() mutable {
+        auto mountGeneration = edenMount->getMountGeneration();
+        bool sentChunk = false;
+        std::optional<folly::exception_wrapper> error;
+        // The +1 is for the same reason as in getFilesChangedSince().
+        edenMount->getJournal().accumulateRangeInChunks(
+            *fromPosition->sequenceNumber_ref() + 1,
+            kFilesChangedChunkSize,
+            [&](JournalDeltaRange&& chunk) {
+              if (chunk.isTruncated) {
+                error = folly::exception_wrapper{newEdenError(
+                    EDOM,
+                    EdenErrorType::JOURNAL_TRUNCATED,
+                    "Journal entry range has been truncated.")};
+                return false;
+              }
+              FileDelta out;
+              populateFileDelta(out, chunk, mountGeneration);
+              publisher.next(std::move(out));
+              sentChunk = true;
+              return !disconnected->load();
+            });
+
+        if (disconnected->load()) {
+          return;
+        }
+        if (error) {
+          std::move(publisher).complete(std::move(*error));
+          return;
+        }
+        if (!sentChunk) {
+          // Like getFilesChangedSince(), report an empty range ending at
+          // fromPosition.
+          FileDelta out;
+          *out.toPosition_ref() = *fromPosition;
+          *out.toPosition_ref()->mountGeneration_ref() = mountGeneration;
+          *out.fromPosition_ref() = *out.toPosition_ref();
+          publisher.next(std::move(out));
+        }
+        std::move(publisher).complete();
+      });
+
+  return std::move(streamAndPublisher.first);
 }
 
 void EdenServiceHandler::setJournalMemoryLimit(
@@ -763,32 +1080,28 @@ EdenServiceHandler::semifuture_getEntryInformation(
   auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint, toLogArg(*paths));
   auto edenMount = server_->getMount(*mountPoint);
   auto rootInode = edenMount->getRootInode();
+  auto& fetchContext = helper->getFetchContext();
 
-  // TODO: applyToInodes currently forces allocation of inodes for all specified
-  // paths. It's possible to resolve this request directly from source control
-  // data. In the future, this should be changed to avoid allocating inodes when
-  // possible.
-
-  return collectAll(applyToInodes(
-                        rootInode,
-                        *paths,
-                        [](InodePtr inode) { return inode->getType(); }))
-      .deferValue([](vector<Try<dtype_t>> done) {
-        auto out = std::make_unique<vector<EntryInformationOrError>>();
-        out->reserve(done.size());
-        for (auto& item : done) {
-          EntryInformationOrError result;
-          if (item.hasException()) {
-            result.set_error(newEdenError(item.exception()));
-          } else {
-            EntryInformation info;
-            info.dtype_ref() = static_cast<Dtype>(item.value());
-            result.set_info(info);
-          }
-          out->emplace_back(std::move(result));
-        }
-        return out;
-      });
+  // The callback holds edenMount so that the mount outlives resolveEntries().
+  return wrapSemiFuture(
+      std::move(helper),
+      collectAll(resolveEntries(rootInode, *paths, fetchContext))
+          .deferValue([edenMount](vector<Try<ResolvedEntry>> done) {
+            auto out = std::make_unique<vector<EntryInformationOrError>>();
+            out->reserve(done.size());
+            for (auto& item : done) {
+              EntryInformationOrError result;
+              if (item.hasException()) {
+                result.set_error(newEdenError(item.exception()));
+              } else {
+                EntryInformation info;
+                info.dtype_ref() = static_cast<Dtype>(item->getDtype());
+                result.set_info(info);
+              }
+              out->emplace_back(std::move(result));
+            }
+            return out;
+          }));
 }
 
 folly::SemiFuture<std::unique_ptr<std::vector<FileInformationOrError>>>
@@ -799,31 +1112,61 @@ EdenServiceHandler::semifuture_getFileInformation(
   auto edenMount = server_->getMount(*mountPoint);
   auto rootInode = edenMount->getRootInode();
   auto& fetchContext = helper->getFetchContext();
-  // TODO: applyToInodes currently forces allocation of inodes for all specified
-  // paths. It's possible to resolve this request directly from source control
-  // data. In the future, this should be changed to avoid allocating inodes when
-  // possible.
   return wrapSemiFuture(
       std::move(helper),
-      collectAll(
-          applyToInodes(
-              rootInode,
-              *paths,
-              [&fetchContext](InodePtr inode) {
-                return inode->stat(fetchContext).thenValue([](struct stat st) {
-                  FileInformation info;
-                  *info.size_ref() = st.st_size;
-                  auto ts = stMtime(st);
-                  *info.mtime_ref()->seconds_ref() = ts.tv_sec;
-                  *info.mtime_ref()->nanoSeconds_ref() = ts.tv_nsec;
-                  *info.mode_ref() = st.st_mode;
-
-                  FileInformationOrError result;
-                  result.set_info(info);
-
-                  return result;
+      collectAll(resolveEntries(rootInode, *paths, fetchContext))
+          .deferValue([edenMount, &fetchContext](
+                          vector<Try<ResolvedEntry>>&& entries) {
+            // Fetch the sizes of all the unmaterialized files in one batch.
+            // The stat() calls on inodes below find theirs in the metadata
+            // cache, and the entries without inodes use them directly.
+            vector<Hash> blobIds;
+            for (auto& entry : entries) {
+              if (entry.hasValue()) {
+                if (auto blobHash = getBlobHashForSize(*entry)) {
+                  blobIds.push_back(*blobHash);
+                }
+              }
+            }
+            return edenMount->getObjectStore()
+                ->getBlobMetadataBatch(blobIds, fetchContext)
+                .thenValue([entries = std::move(entries),
+                            edenMount,
+                            &fetchContext](
+                               vector<Try<BlobMetadata>>&& metadata) {
+                  vector<Future<FileInformationOrError>> futures;
+                  futures.reserve(entries.size());
+                  size_t metadataIndex = 0;
+                  for (auto& entry : entries) {
+                    futures.push_back(folly::makeFutureWith([&] {
+                      auto& resolved = entry.value();
+                      if (resolved.inode) {
+                        if (getBlobHashForSize(resolved)) {
+                          ++metadataIndex;
+                        }
+                        return resolved.inode->stat(fetchContext)
+                            .thenValue([](struct stat st) {
+                              FileInformationOrError result;
+                              result.set_info(fileInformationFromStat(st));
+                              return result;
+                            });
+                      }
+
+                      uint64_t size = 0;
+                      if (resolved.size) {
+                        size = *resolved.size;
+                      } else if (getBlobHashForSize(resolved)) {
+                        size = metadata[metadataIndex++].value().size;
+                      }
+                      FileInformationOrError result;
+                      result.set_info(getFileInformationForEntry(
+                          *edenMount, resolved, size));
+                      return makeFuture(std::move(result));
+                    }));
+                  }
+                  return folly::collectAllUnsafe(std::move(futures));
                 });
-              }))
+          })
           .deferValue([](vector<Try<FileInformationOrError>>&& done) {
             auto out = std::make_unique<vector<FileInformationOrError>>();
             out->reserve(done.size());
@@ -875,6 +1218,156 @@ void EdenServiceHandler::glob(
   }
 }
 
+namespace {
+/**
+ * The number of blobs requested together when prefetching the files matched
+ * by a glob.
+ */
+constexpr size_t kGlobPrefetchBatchSize = 20480;
+
+/**
+ * The number of files or status entries in each chunk sent by
+ * streamGlobFiles() and streamScmStatus().
+ */
+constexpr size_t kStreamChunkSize = 10000;
+
+folly::Future<folly::Unit> prefetchBlobsInBatches(
+    const ObjectStore* store,
+    const std::vector<Hash>& blobs,
+    ObjectFetchContext& context) {
+  std::vector<folly::Future<folly::Unit>> futures;
+  std::vector<Hash> batch;
+
+  for (auto& hash : blobs) {
+    if (batch.size() >= kGlobPrefetchBatchSize) {
+      futures.emplace_back(store->prefetchBlobs(batch, context));
+      batch.clear();
+    }
+    batch.emplace_back(hash);
+  }
+  if (!batch.empty()) {
+    futures.emplace_back(store->prefetchBlobs(batch, context));
+  }
+
+  return folly::collectUnsafe(futures).unit();
+}
+
+/**
+ * Sends items to a thrift stream in chunks of about kStreamChunkSize items,
+ * so that a large result is never held in memory or sent as one message.
+ *
+ * add() may be called concurrently from multiple threads.
+ */
+template <typename Chunk>
+class ChunkedStreamPublisher {
+ public:
+  ChunkedStreamPublisher(
+      apache::thrift::ServerStreamPublisher<Chunk> publisher,
+      std::shared_ptr<std::atomic<bool>> disconnected)
+      : disconnected_{std::move(disconnected)} {
+    state_.wlock()->publisher.emplace(std::move(publisher));
+  }
+
+  /**
+   * Call fn with the current chunk so that it can add count items to it, and
+   * send the chunk once it is full.
+   */
+  template <typename Fn>
+  void add(size_t count, Fn&& fn) {
+    auto state = state_.wlock();
+    if (!state->publisher || disconnected_->load()) {
+      return;
+    }
+    fn(state->chunk);
+    state->chunkItems += count;
+    if (state->chunkItems >= kStreamChunkSize) {
+      state->publisher->next(std::exchange(state->chunk, Chunk{}));
+      state->chunkItems = 0;
+      state->sentChunk = true;
+    }
+  }
+
+  /**
+   * Send the last chunk and complete the stream, or end the stream with an
+   * error if result holds one.  At least one chunk is sent before the
+   * stream completes successfully.
+   */
+  void complete(const folly::Try<folly::Unit>& result) {
+    auto state = state_.wlock();
+    if (!state->publisher || disconnected_->load()) {
+      return;
+    }
+    auto publisher = std::move(*state->publisher);
+    state->publisher.reset();
+    if (result.hasException()) {
+      std::move(publisher).complete(result.exception());
+      return;
+    }
+    if (state->chunkItems > 0 || !state->sentChunk) {
+      publisher.next(std::move(state->chunk));
+    }
+    std::move(publisher).complete();
+  }
+
+ private:
+  struct State {
+    std::optional<apache::thrift::ServerStreamPublisher<Chunk>> publisher;
+    Chunk chunk;
+    size_t chunkItems{0};
+    bool sentChunk{false};
+  };
+
+  std::shared_ptr<std::atomic<bool>> disconnected_;
+  folly::Synchronized<State> state_;
+};
+
+/**
+ * A DiffCallback that sends the differences found to a stream of ScmStatus
+ * chunks, rather than collecting them like ScmStatusDiffCallback.
+ */
+class StreamingScmStatusDiffCallback : public DiffCallback {
+ public:
+  explicit StreamingScmStatusDiffCallback(
+      std::shared_ptr<ChunkedStreamPublisher<ScmStatus>> publisher)
+      : publisher_{std::move(publisher)} {}
+
+  void ignoredFile(RelativePathPiece path) override {
+    addEntry(path, ScmFileStatus::IGNORED);
+  }
+
+  void addedFile(RelativePathPiece path) override {
+    addEntry(path, ScmFileStatus::ADDED);
+  }
+
+  void removedFile(RelativePathPiece path) override {
+    addEntry(path, ScmFileStatus::REMOVED);
+  }
+
+  void modifiedFile(RelativePathPiece path) override {
+    addEntry(path, ScmFileStatus::MODIFIED);
+  }
+
+  void diffError(RelativePathPiece path, const folly::exception_wrapper& ew)
+      override {
+    XLOG(WARNING) << "error computing status data for " << path << ": "
+                  << folly::exceptionStr(ew);
+    publisher_->add(1, [&](ScmStatus& chunk) {
+      chunk.errors_ref()->emplace(
+          path.stringPiece().str(), folly::exceptionStr(ew).toStdString());
+    });
+  }
+
+ private:
+  void addEntry(RelativePathPiece path, ScmFileStatus status) {
+    publisher_->add(1, [&](ScmStatus& chunk) {
+      chunk.entries_ref()->emplace(path.stringPiece().str(), status);
+    });
+  }
+
+  std::shared_ptr<ChunkedStreamPublisher<ScmStatus>> publisher_;
+};
+} // namespace
+
 folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
     std::unique_ptr<GlobParams> params) {
   auto helper = INSTRUMENT_THRIFT_CALL(
@@ -885,12 +1378,12 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
   auto edenMount = server_->getMount(*params->mountPoint_ref());
   auto rootInode = edenMount->getRootInode();
 
-  // Compile the list of globs into a tree
-  auto globRoot = std::make_shared<GlobNode>(*params->includeDotfiles_ref());
+  // Compile the list of globs into a tree, or reuse the tree compiled by an
+  // earlier call with the same globs.
+  std::shared_ptr<const GlobNode> globRoot;
   try {
-    for (auto& globString : *params->globs_ref()) {
-      globRoot->parse(globString);
-    }
+    globRoot = server_->getServerState()->getGlobNodeCache().get(
+        *params->globs_ref(), *params->includeDotfiles_ref());
   } catch (const std::system_error& exc) {
     throw newEdenError(exc);
   }
@@ -899,6 +1392,16 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
       ? std::make_shared<folly::Synchronized<std::vector<Hash>>>()
       : nullptr;
 
+  uint64_t pageCacheBytes = 0;
+#ifndef _WIN32
+  if (fileBlobsToPrefetch) {
+    auto config = server_->getServerState()->getEdenConfig();
+    if (!config->fuseWritebackCache.getValue()) {
+      pageCacheBytes = config->fusePageCachePrefetchBytes.getValue();
+    }
+  }
+#endif // !_WIN32
+
   auto& fetchContext = helper->getFetchContext();
 
   // and evaluate it against the root
@@ -915,11 +1418,45 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
                       wantDtype = *params->wantDtype_ref(),
                       fileBlobsToPrefetch,
                       suppressFileList = *params->suppressFileList_ref(),
+                      compactPaths = *params->compactPaths_ref(),
+                      pageCacheBytes,
                       &fetchContext](
                          std::vector<GlobNode::GlobResult>&& results) mutable {
             auto out = std::make_unique<Glob>();
 
-            if (!suppressFileList) {
+            std::vector<RelativePath> pageCachePaths;
+            if (pageCacheBytes > 0) {
+              for (auto& entry : results) {
+                if (entry.dtype == dtype_t::Regular) {
+                  pageCachePaths.push_back(entry.name);
+                }
+              }
+            }
+
+            if (!suppressFileList && compactPaths) {
+              // Sorting brings duplicates together, so no set of the paths
+              // seen is needed, and the paths are encoded without copies.
+              std::sort(
+                  results.begin(),
+                  results.end(),
+                  [](const auto& left, const auto& right) {
+                    return left.name.stringPiece() < right.name.stringPiece();
+                  });
+              FrontCodedPathsBuilder builder;
+              const RelativePath* previous = nullptr;
+              for (auto& entry : results) {
+                if (previous && *previous == entry.name) {
+                  continue;
+                }
+                previous = &entry.name;
+                builder.add(entry.name.stringPiece());
+                if (wantDtype) {
+                  out->dtypes_ref()->emplace_back(
+                      static_cast<OsDtype>(entry.dtype));
+                }
+              }
+              *out->compactMatchingFiles_ref() = builder.finish();
+            } else if (!suppressFileList) {
               std::unordered_set<RelativePathPiece> seenPaths;
               for (auto& entry : results) {
                 auto ret = seenPaths.insert(entry.name);
@@ -935,26 +1472,22 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
               }
             }
             if (fileBlobsToPrefetch) {
-              std::vector<folly::Future<folly::Unit>> futures;
-
-              auto store = edenMount->getObjectStore();
-              auto blobs = fileBlobsToPrefetch->rlock();
-              std::vector<Hash> batch;
-
-              for (auto& hash : *blobs) {
-                if (batch.size() >= 20480) {
-                  futures.emplace_back(
-                      store->prefetchBlobs(batch, fetchContext));
-                  batch.clear();
-                }
-                batch.emplace_back(hash);
-              }
-              if (!batch.empty()) {
-                futures.emplace_back(store->prefetchBlobs(batch, fetchContext));
-              }
-
-              return folly::collectUnsafe(futures).thenValue(
-                  [glob = std::move(out)](auto&&) mutable {
+              return prefetchBlobsInBatches(
+                         edenMount->getObjectStore(),
+                         *fileBlobsToPrefetch->rlock(),
+                         fetchContext)
+                  .thenValue([glob = std::move(out),
+                              edenMount,
+                              pageCachePaths = std::move(pageCachePaths),
+                              pageCacheBytes](auto&&) mutable {
+#ifndef _WIN32
+                    // The glob's caller does not wait for this.
+                    if (!pageCachePaths.empty()) {
+                      (void)edenMount
+                          ->populatePageCache(pageCachePaths, pageCacheBytes)
+                          .ensure([edenMount] {});
+                    }
+#endif // !_WIN32
                     return makeFuture(std::move(glob));
                   });
             }
@@ -965,6 +1498,197 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
           }));
 }
 
+apache::thrift::ServerStream<Glob> EdenServiceHandler::streamGlobFiles(
+    std::unique_ptr<GlobParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG3,
+      *params->mountPoint_ref(),
+      toLogArg(*params->globs_ref()),
+      *params->includeDotfiles_ref());
+  auto edenMount = server_->getMount(*params->mountPoint_ref());
+  auto rootInode = edenMount->getRootInode();
+
+  std::shared_ptr<const GlobNode> globRoot;
+  try {
+    globRoot = server_->getServerState()->getGlobNodeCache().get(
+        *params->globs_ref(), *params->includeDotfiles_ref());
+  } catch (const std::system_error& exc) {
+    throw newEdenError(exc);
+  }
+
+  auto fileBlobsToPrefetch = *params->prefetchFiles_ref()
+      ? std::make_shared<folly::Synchronized<std::vector<Hash>>>()
+      : nullptr;
+
+  auto disconnected = std::make_shared<std::atomic<bool>>(false);
+  auto streamAndPublisher = apache::thrift::ServerStream<Glob>::createPublisher(
+      [disconnected] { disconnected->store(true); });
+  auto publisher = std::make_shared<ChunkedStreamPublisher<Glob>>(
+      std::move(streamAndPublisher.second), disconnected);
+
+  auto sink = std::make_shared<GlobNode::ResultSink>(
+      [publisher,
+       wantDtype = *params->wantDtype_ref(),
+       suppressFileList = *params->suppressFileList_ref()](
+          std::vector<GlobNode::GlobResult>&& results) {
+        if (suppressFileList) {
+          return;
+        }
+        publisher->add(results.size(), [&](Glob& chunk) {
+          for (auto& entry : results) {
+            chunk.matchingFiles_ref()->emplace_back(
+                entry.name.stringPiece().str());
+            if (wantDtype) {
+              chunk.dtypes_ref()->emplace_back(
+                  static_cast<OsDtype>(entry.dtype));
+            }
+          }
+        });
+      });
+
+  auto& fetchContext = helper->getFetchContext();
+  globRoot
+      ->evaluateStreaming(
+          edenMount->getObjectStore(),
+          fetchContext,
+          RelativePathPiece(),
+          rootInode,
+          fileBlobsToPrefetch,
+          *sink)
+      .thenValue([edenMount, fileBlobsToPrefetch, &fetchContext](auto&&) {
+        if (!fileBlobsToPrefetch) {
+          return makeFuture();
+        }
+        return prefetchBlobsInBatches(
+            edenMount->getObjectStore(),
+            *fileBlobsToPrefetch->rlock(),
+            fetchContext);
+      })
+      .thenTry([helper = std::move(helper), globRoot, sink, publisher](
+                   folly::Try<folly::Unit>&& result) {
+        // This keeps the glob tree and sink alive until the glob finishes,
+        // and the helper and the fetch context it owns until its prefetches
+        // finish.
+        publisher->complete(result);
+      });
+
+  return std::move(streamAndPublisher.first);
+}
+
+folly::Future<Unit> EdenServiceHandler::future_prefetchTrees(
+    std::unique_ptr<std::string> mountPoint,
+    std::unique_ptr<std::vector<std::string>> paths,
+    int32_t depth) {
+  auto helper =
+      INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint, toLogArg(*paths), depth);
+  if (depth < 0) {
+    return makeFuture<Unit>(newEdenError(
+        EINVAL, EdenErrorType::ARGUMENT_ERROR, "depth must not be negative"));
+  }
+
+  auto edenMount = server_->getMount(*mountPoint);
+  std::vector<RelativePath> relativePaths;
+  relativePaths.reserve(paths->size());
+  for (const auto& path : *paths) {
+    relativePaths.emplace_back(path);
+  }
+
+  return wrapFuture(
+      std::move(helper),
+      edenMount->prefetchTrees(std::move(relativePaths), depth)
+          .thenValue([](size_t loadedCount) {
+            XLOG(DBG3) << "prefetched " << loadedCount << " trees";
+          }));
+}
+
+folly::Future<std::unique_ptr<HydrateCommitResult>>
+EdenServiceHandler::future_hydrateCommit(
+    std::unique_ptr<HydrateCommitParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG2,
+      *params->mountPoint_ref(),
+      logHash(*params->commit_ref()),
+      toLogArg(*params->blobPaths_ref()));
+  auto edenMount = server_->getMount(*params->mountPoint_ref());
+  auto commitHash = hashFromThrift(*params->commit_ref());
+  std::vector<RelativePath> blobPaths;
+  blobPaths.reserve(params->blobPaths_ref()->size());
+  for (const auto& path : *params->blobPaths_ref()) {
+    blobPaths.emplace_back(path);
+  }
+
+  auto& fetchContext = helper->getFetchContext();
+  return wrapFuture(
+      std::move(helper),
+      edenMount->hydrateCommit(commitHash, std::move(blobPaths), fetchContext)
+          // Keep the mount alive until the walk completes.
+          .thenValue([edenMount](HydrateResult&& hydrated) {
+            XLOG(DBG2) << "hydrated " << hydrated.treeCount << " trees and "
+                       << hydrated.blobCount << " blobs";
+            auto result = std::make_unique<HydrateCommitResult>();
+            *result->treeCount_ref() = hydrated.treeCount;
+            *result->blobCount_ref() = hydrated.blobCount;
+            return result;
+          }));
+}
+
+namespace {
+void fillBuildSessionInfo(
+    BuildSessionInfo& info,
+    const EdenServer::BuildSessionStats& stats) {
+  *info.remainingSeconds_ref() = stats.remaining.count();
+  *info.prefetchedTrees_ref() = stats.prefetchedTrees;
+  *info.blobCacheHits_ref() = stats.blobCacheHits;
+  *info.blobCacheMisses_ref() = stats.blobCacheMisses;
+  *info.deferredUnloads_ref() = stats.deferredUnloads;
+}
+} // namespace
+
+void EdenServiceHandler::startBuildSession(
+    BuildSessionInfo& result,
+    std::unique_ptr<StartBuildSessionParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG2,
+      *params->mountPoint_ref(),
+      toLogArg(*params->prefixes_ref()),
+      *params->durationSeconds_ref());
+  if (*params->durationSeconds_ref() <= 0) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "build session duration must be positive");
+  }
+
+  auto edenMount = server_->getMount(*params->mountPoint_ref());
+  std::vector<RelativePath> prefixes;
+  prefixes.reserve(params->prefixes_ref()->size());
+  for (const auto& prefix : *params->prefixes_ref()) {
+    prefixes.emplace_back(prefix);
+  }
+  fillBuildSessionInfo(
+      result,
+      server_->startBuildSession(
+          edenMount,
+          std::move(prefixes),
+          std::chrono::seconds{*params->durationSeconds_ref()}));
+}
+
+void EdenServiceHandler::endBuildSession(
+    BuildSessionInfo& result,
+    std::unique_ptr<std::string> mountPoint) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG2, *mountPoint);
+  auto edenMount = server_->getMount(*mountPoint);
+  auto stats = server_->endBuildSession(edenMount->getPath().stringPiece());
+  if (!stats) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "no build session is active on ",
+        *mountPoint);
+  }
+  fillBuildSessionInfo(result, *stats);
+}
+
 folly::Future<Unit> EdenServiceHandler::future_chown(
     std::unique_ptr<std::string> mountPoint,
     int32_t uid,
@@ -1045,7 +1769,13 @@ void EdenServiceHandler::async_tm_getScmStatusV2(
     return wrapFuture(
         std::move(helper),
         mount->diff(hash, *params->listIgnored_ref(), enforceParents, request)
-            .thenValue([this, mount](std::unique_ptr<ScmStatus>&& status) {
+            .thenValue([this,
+                        mount,
+                        compactPaths = *params->compactPaths_ref()](
+                           std::unique_ptr<ScmStatus>&& status) {
+              if (compactPaths) {
+                compactScmStatus(*status);
+              }
               auto result = std::make_unique<GetScmStatusResult>();
               *result->status_ref() = std::move(*status);
               *result->version_ref() = server_->getVersion();
@@ -1060,6 +1790,46 @@ void EdenServiceHandler::async_tm_getScmStatusV2(
       });
 }
 
+apache::thrift::ServerStream<ScmStatus> EdenServiceHandler::streamScmStatus(
+    unique_ptr<GetScmStatusParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG2,
+      *params->mountPoint_ref(),
+      folly::to<string>("commitHash=", logHash(*params->commit_ref())),
+      folly::to<string>("listIgnored=", *params->listIgnored_ref()));
+
+  auto mount = server_->getMount(*params->mountPoint_ref());
+  auto hash = hashFromThrift(*params->commit_ref());
+  const auto& enforceParents = server_->getServerState()
+                                   ->getReloadableConfig()
+                                   .getEdenConfig()
+                                   ->enforceParents.getValue();
+
+  auto disconnected = std::make_shared<std::atomic<bool>>(false);
+  auto streamAndPublisher =
+      apache::thrift::ServerStream<ScmStatus>::createPublisher(
+          [disconnected] { disconnected->store(true); });
+  auto publisher = std::make_shared<ChunkedStreamPublisher<ScmStatus>>(
+      std::move(streamAndPublisher.second), disconnected);
+  auto callback = std::make_shared<StreamingScmStatusDiffCallback>(publisher);
+
+  // Unlike getScmStatusV2(), this does not use the status cached by
+  // EdenMount::diff(), since the results are sent as they are found.
+  mount
+      ->diff(
+          callback.get(),
+          hash,
+          *params->listIgnored_ref(),
+          enforceParents,
+          /*request=*/nullptr)
+      .thenTry([helper = std::move(helper), mount, callback, publisher](
+                   folly::Try<folly::Unit>&& result) {
+        publisher->complete(result);
+      });
+
+  return std::move(streamAndPublisher.first);
+}
+
 void EdenServiceHandler::async_tm_getScmStatus(
     unique_ptr<apache::thrift::HandlerCallback<unique_ptr<ScmStatus>>> callback,
     unique_ptr<string> mountPoint,
@@ -1219,6 +1989,37 @@ void EdenServiceHandler::debugInodeStatus(
   inode->getDebugStatus(inodeInfo);
 }
 
+void EdenServiceHandler::debugInodeStatusPaged(
+    DebugInodeStatusResult& result,
+    std::unique_ptr<DebugInodeStatusParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG3, *params->mountPoint_ref(), *params->path_ref());
+  if (*params->maxResults_ref() < 0) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "debugInodeStatusPaged maxResults must not be negative");
+  }
+  auto edenMount = server_->getMount(*params->mountPoint_ref());
+
+  TreeInode::DebugStatusOptions options;
+  options.materializedOnly = *params->materializedOnly_ref();
+  if (*params->maxDepth_ref() >= 0) {
+    options.maxDepth = *params->maxDepth_ref();
+  }
+  options.maxResults = *params->maxResults_ref();
+  if (params->startAfter_ref().has_value()) {
+    options.startAfter = RelativePath{*params->startAfter_ref()};
+  }
+  options.fileSizes = *params->includeFileSizes_ref();
+
+  auto inode = inodeFromUserPath(*edenMount, *params->path_ref()).asTreePtr();
+  auto next = inode->getDebugStatus(*result.inodes_ref(), options);
+  if (next.has_value()) {
+    result.nextStartAfter_ref() = next->stringPiece().str();
+  }
+}
+
 void EdenServiceHandler::debugOutstandingFuseCalls(
     std::vector<FuseCall>& outstandingCalls,
     std::unique_ptr<std::string> mountPoint) {
@@ -1306,14 +2107,14 @@ void EdenServiceHandler::getAccessCounts(
     auto& mountStr = mount->getPath().value();
     auto& pal = mount->getFuseChannel()->getProcessAccessLog();
 
-    auto& pidFetches = mount->getObjectStore()->getPidFetches();
+    auto pidFetches = mount->getObjectStore()->getPidFetches();
 
     MountAccesses& ma = result.accessesByMount_ref()[mountStr];
     for (auto& [pid, accessCounts] : pal.getAccessCounts(seconds)) {
       ma.accessCountsByPid_ref()[pid] = accessCounts;
     }
 
-    for (auto& [pid, fetchCount] : *pidFetches.rlock()) {
+    for (auto& [pid, fetchCount] : pidFetches) {
       ma.fetchCountsByPid_ref()[pid] = fetchCount;
     }
   }
@@ -1322,6 +2123,36 @@ void EdenServiceHandler::getAccessCounts(
 #endif // !_WIN32
 }
 
+void EdenServiceHandler::getHotDirectories(
+    std::vector<DirectoryAccessCounts>& result,
+    std::unique_ptr<GetHotDirectoriesParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *params->mountPoint_ref());
+  if (*params->count_ref() < 0) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "getHotDirectories count must not be negative");
+  }
+  auto mount = server_->getMount(*params->mountPoint_ref());
+  auto& stats = mount->getDirectoryAccessStats();
+
+  using AccessType = DirectoryAccessStats::AccessType;
+  for (auto& hot : stats.getHotDirectories(*params->count_ref())) {
+    DirectoryAccessCounts counts;
+    counts.directory_ref() = hot.directory.stringPiece().str();
+    counts.lookups_ref() = hot.counts[enumValue(AccessType::Lookup)];
+    counts.reads_ref() = hot.counts[enumValue(AccessType::Read)];
+    counts.blobLoads_ref() = hot.counts[enumValue(AccessType::BlobLoad)];
+    counts.treeLoads_ref() = hot.counts[enumValue(AccessType::TreeLoad)];
+    counts.total_ref() = hot.total;
+    counts.error_ref() = hot.error;
+    result.push_back(std::move(counts));
+  }
+  if (*params->reset_ref()) {
+    stats.clear();
+  }
+}
+
 void EdenServiceHandler::clearAndCompactLocalStore() {
   auto helper = INSTRUMENT_THRIFT_CALL(DBG1);
   server_->getLocalStore()->clearCachesAndCompactAll();
@@ -1452,6 +2283,29 @@ Future<Unit> EdenServiceHandler::future_invalidateKernelInodeCache(
 #endif // !_WIN32
 }
 
+Future<Unit> EdenServiceHandler::future_removeRecursively(
+    std::unique_ptr<std::string> mountPoint,
+    std::unique_ptr<std::string> path) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG2, *mountPoint, *path);
+  auto edenMount = server_->getMount(*mountPoint);
+  RelativePath relativePath{*path};
+  if (relativePath.empty()) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "cannot remove the root of the mount");
+  }
+
+  return wrapFuture(
+      std::move(helper),
+      edenMount->getInode(relativePath.dirname())
+          .thenValue([name = relativePath.basename().copy()](
+                         const InodePtr& parent) {
+            return parent.asTreePtr()->removeRecursively(
+                name, InvalidationRequired::Yes);
+          }));
+}
+
 void EdenServiceHandler::enableTracing() {
   XLOG(INFO) << "Enabling tracing";
   eden::enableTracing();
@@ -1461,8 +2315,11 @@ void EdenServiceHandler::disableTracing() {
   eden::disableTracing();
 }
 
-void EdenServiceHandler::getTracePoints(std::vector<TracePoint>& result) {
-  auto compactTracePoints = getAllTracepoints();
+namespace {
+void convertTracePoints(
+    const std::vector<CompactTracePoint>& compactTracePoints,
+    std::vector<TracePoint>& result) {
+  result.reserve(result.size() + compactTracePoints.size());
   for (auto& point : compactTracePoints) {
     TracePoint tp;
     tp.timestamp_ref() = point.timestamp.count();
@@ -1480,6 +2337,28 @@ void EdenServiceHandler::getTracePoints(std::vector<TracePoint>& result) {
     result.emplace_back(std::move(tp));
   }
 }
+} // namespace
+
+void EdenServiceHandler::getTracePoints(std::vector<TracePoint>& result) {
+  convertTracePoints(getAllTracepoints(), result);
+}
+
+void EdenServiceHandler::getRecentTracePoints(
+    std::vector<TracePoint>& result,
+    int64_t seconds) {
+  if (seconds <= 0) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "getRecentTracePoints requires a positive number of seconds");
+  }
+  convertTracePoints(
+      getRecentTracepoints(std::chrono::seconds{seconds}), result);
+}
+
+void EdenServiceHandler::getChromeTrace(std::string& result) {
+  result = formatChromeTrace(getAllTracepoints());
+}
 
 namespace {
 std::optional<folly::exception_wrapper> getFaultError(
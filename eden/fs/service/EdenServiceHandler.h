@@ -57,6 +57,10 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       std::unique_ptr<std::string> hash,
       CheckoutMode checkoutMode) override;
 
+  void getCheckoutProgressInfo(
+      CheckoutProgressInfo& out,
+      std::unique_ptr<std::string> mountPoint) override;
+
   void resetParentCommits(
       std::unique_ptr<std::string> mountPoint,
       std::unique_ptr<WorkingDirectoryParents> parents) override;
@@ -86,6 +90,10 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       std::unique_ptr<std::string> mountPoint,
       std::unique_ptr<JournalPosition> fromPosition) override;
 
+  void getFilesChangedSinceFiltered(
+      FileDelta& out,
+      std::unique_ptr<GetFilesChangedSinceParams> params) override;
+
   void setJournalMemoryLimit(
       std::unique_ptr<PathString> mountPoint,
       int64_t limit) override;
@@ -117,6 +125,22 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   folly::Future<std::unique_ptr<Glob>> future_globFiles(
       std::unique_ptr<GlobParams> params) override;
 
+  folly::Future<folly::Unit> future_prefetchTrees(
+      std::unique_ptr<std::string> mountPoint,
+      std::unique_ptr<std::vector<std::string>> paths,
+      int32_t depth) override;
+
+  folly::Future<std::unique_ptr<HydrateCommitResult>> future_hydrateCommit(
+      std::unique_ptr<HydrateCommitParams> params) override;
+
+  void startBuildSession(
+      BuildSessionInfo& result,
+      std::unique_ptr<StartBuildSessionParams> params) override;
+
+  void endBuildSession(
+      BuildSessionInfo& result,
+      std::unique_ptr<std::string> mountPoint) override;
+
   folly::Future<folly::Unit> future_chown(
       std::unique_ptr<std::string> mountPoint,
       int32_t uid,
@@ -125,6 +149,16 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   apache::thrift::ServerStream<JournalPosition> subscribeStreamTemporary(
       std::unique_ptr<std::string> mountPoint) override;
 
+  apache::thrift::ServerStream<FileDelta> streamFilesChangedSince(
+      std::unique_ptr<std::string> mountPoint,
+      std::unique_ptr<JournalPosition> fromPosition) override;
+
+  apache::thrift::ServerStream<Glob> streamGlobFiles(
+      std::unique_ptr<GlobParams> params) override;
+
+  apache::thrift::ServerStream<ScmStatus> streamScmStatus(
+      std::unique_ptr<GetScmStatusParams> params) override;
+
   void getManifestEntry(
       ManifestEntry& out,
       std::unique_ptr<std::string> mountPoint,
@@ -170,6 +204,10 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       std::unique_ptr<std::string> mountPoint,
       std::unique_ptr<std::string> path) override;
 
+  void debugInodeStatusPaged(
+      DebugInodeStatusResult& result,
+      std::unique_ptr<DebugInodeStatusParams> params) override;
+
   void debugOutstandingFuseCalls(
       std::vector<FuseCall>& outstandingCalls,
       std::unique_ptr<std::string> mountPoint) override;
@@ -186,6 +224,10 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   void getAccessCounts(GetAccessCountsResult& result, int64_t duration)
       override;
 
+  void getHotDirectories(
+      std::vector<DirectoryAccessCounts>& result,
+      std::unique_ptr<GetHotDirectoriesParams> params) override;
+
   void clearAndCompactLocalStore() override;
 
   void debugClearLocalStoreCaches() override;
@@ -203,11 +245,18 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       std::unique_ptr<std::string> mountPoint,
       std::unique_ptr<std::string> path) override;
 
+  folly::Future<folly::Unit> future_removeRecursively(
+      std::unique_ptr<std::string> mountPoint,
+      std::unique_ptr<std::string> path) override;
+
   void getStatInfo(InternalStats& result) override;
 
   void enableTracing() override;
   void disableTracing() override;
   void getTracePoints(std::vector<TracePoint>& result) override;
+  void getRecentTracePoints(std::vector<TracePoint>& result, int64_t seconds)
+      override;
+  void getChromeTrace(std::string& result) override;
 
   void injectFault(std::unique_ptr<FaultDefinition> fault) override;
   bool removeFault(std::unique_ptr<RemoveFaultArg> fault) override;
@@ -238,16 +287,6 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   std::optional<pid_t> getAndRegisterClientPid();
 
  private:
-  folly::Future<Hash> getSHA1ForPath(
-      folly::StringPiece mountPoint,
-      folly::StringPiece path,
-      ObjectFetchContext& fetchContext);
-
-  folly::Future<Hash> getSHA1ForPathDefensively(
-      folly::StringPiece mountPoint,
-      folly::StringPiece path,
-      ObjectFetchContext& fetchContext) noexcept;
-
   /**
    * If `filename` exists in the manifest as a file (not a directory), returns
    * the mode of the file as recorded in the manifest.
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/service/ThriftLoadShedder.h"
+
+#include <folly/Conv.h>
+#include <folly/Range.h>
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/inodes/ServerState.h"
+#include "eden/fs/telemetry/EdenStats.h"
+#include "eden/fs/utils/UnboundedQueueExecutor.h"
+
+namespace {
+/**
+ * Methods that only warm caches or serve debugging tools, which are better
+ * retried later than served late.
+ */
+constexpr folly::StringPiece LOW_PRIORITY_METHODS[] = {
+    "EdenService.prefetchTrees",
+    "EdenService.hydrateCommit",
+    "EdenService.debugInodeStatus",
+    "EdenService.debugInodeStatusPaged",
+    "EdenService.getAccessCounts",
+};
+
+bool isLowPriority(folly::StringPiece methodName) {
+  for (auto& name : LOW_PRIORITY_METHODS) {
+    if (methodName == name) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+namespace facebook {
+namespace eden {
+
+ThriftLoadShedder::ThriftLoadShedder(std::shared_ptr<ServerState> serverState)
+    : serverState_{std::move(serverState)} {}
+
+void ThriftLoadShedder::preRead(void* /*ctx*/, const char* fn_name) {
+  if (!isLowPriority(fn_name)) {
+    return;
+  }
+  auto maxAge = serverState_->getConfigSnapshot().thriftShedQueueAge.getValue();
+  if (maxAge.count() <= 0) {
+    return;
+  }
+  auto wait = serverState_->getThreadPool()->getRecentQueueWait();
+  if (wait <= maxAge) {
+    return;
+  }
+
+  serverState_->getStats().getThriftStatsForCurrentThread().loadShed.addValue(
+      1);
+  throw Overloaded{folly::to<std::string>(
+      "eden is overloaded: tasks are waiting ",
+      std::chrono::duration_cast<std::chrono::milliseconds>(wait).count(),
+      "ms to start, so ",
+      fn_name,
+      " was not run; retry later")};
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <thrift/lib/cpp/TProcessorEventHandler.h>
+#include <stdexcept>
+
+namespace facebook {
+namespace eden {
+
+class ServerState;
+
+class Overloaded : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * Throws Overloaded in preRead for low priority methods, such as
+ * prefetchTrees, while tasks on the server thread pool are waiting longer
+ * than thrift:shed-queue-age to start.  Failing those calls fast leaves the
+ * thread pool to the requests that users are waiting on, and tells the
+ * callers to back off rather than add to the queue.
+ */
+class ThriftLoadShedder : public apache::thrift::TProcessorEventHandler {
+ public:
+  explicit ThriftLoadShedder(std::shared_ptr<ServerState> serverState);
+
+  void preRead(void* ctx, const char* fn_name) override;
+
+ private:
+  std::shared_ptr<ServerState> serverState_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -46,6 +46,15 @@ typedef binary BinaryHash
  */
 typedef binary PathString
 
+/**
+ * A sorted list of PathStrings, front coded: each path is the number of
+ * leading bytes it shares with the path before it, then the length of the
+ * rest of the path, then those bytes.  Both numbers are unsigned LEB128
+ * varints.  Calls that can return very many paths fill a field of this type
+ * instead of a list<PathString> when the caller asks for compactPaths.
+ */
+typedef binary FrontCodedPaths
+
 /**
  * A customizable type to be returned with an EdenError, helpful for catching
  * and having custom client logic to handle specfic error cases
@@ -278,6 +287,31 @@ struct FileDelta {
    * in ways that may not be able to be extracted solely by performing
    * source control diff operations on the from/to hashes. */
   6: list<PathString> uncleanPaths
+  /**
+   * When the call asked for compactPaths, these hold changedPaths,
+   * createdPaths and uncleanPaths, sorted, and those lists are empty.
+   */
+  7: FrontCodedPaths compactChangedPaths
+  8: FrontCodedPaths compactCreatedPaths
+  9: FrontCodedPaths compactUncleanPaths
+}
+
+/** Selects the paths getFilesChangedSinceFiltered() reports.
+ * A path is reported if it is at or under one of includePrefixes, is not at
+ * or under any of excludePrefixes, and matches one of includeGlobs. An empty
+ * includePrefixes or includeGlobs list selects every path.
+ */
+struct FileDeltaFilter {
+  1: list<PathString> includePrefixes
+  2: list<PathString> excludePrefixes
+  3: list<string> includeGlobs
+}
+
+struct GetFilesChangedSinceParams {
+  1: PathString mountPoint
+  2: JournalPosition fromPosition
+  3: FileDeltaFilter filter
+  4: bool compactPaths = false
 }
 
 struct DebugGetRawJournalParams {
@@ -347,6 +381,14 @@ struct ScmStatus {
    * This map will be empty if no errors occurred.
    */
   2: map<PathString, string> errors
+
+  /**
+   * When the call asked for compactPaths, these hold the paths of entries,
+   * sorted, and the status of each in the same order, and entries is
+   * empty.
+   */
+  3: FrontCodedPaths compactPaths
+  4: list<ScmFileStatus> compactStatuses
 }
 
 /** Option for use with checkOutRevision(). */
@@ -415,6 +457,26 @@ struct CheckoutConflict {
   3: string message
 }
 
+/**
+ * How far a checkOutRevision() call that is still running has got.
+ */
+struct CheckoutProgressInfo {
+  /** If this is false, no checkout is running and the counts are all 0. */
+  1: bool checkoutInProgress
+  /** The number of directories the checkout has finished updating. */
+  2: i64 treesProcessed
+  /**
+   * The number of entries the checkout has added, removed or replaced. A
+   * directory that is replaced without being loaded counts as one entry.
+   */
+  3: i64 filesUpdated
+  /**
+   * Always 0.  Checkout compares and replaces files by hash, and no longer
+   * fetches their contents.
+   */
+  4: i64 bytesFetched
+}
+
 struct ScmBlobMetadata {
   1: i64 size
   2: BinaryHash contentsSha1
@@ -473,6 +535,29 @@ struct TreeInodeDebugInfo {
   6: i64 refcount
 }
 
+struct DebugInodeStatusParams {
+  1: PathString mountPoint
+  2: PathString path
+  // Only report materialized directories.
+  3: bool materializedOnly = false
+  // How many levels of subdirectories below path to report.  Negative values
+  // mean there is no limit.
+  4: i32 maxDepth = -1
+  // The most directories to report in one call, or 0 for no limit.
+  5: i32 maxResults = 0
+  // Continue a previous call from its nextStartAfter.
+  6: optional PathString startAfter
+  // Report the size of each loaded file, which may require fetching it.
+  7: bool includeFileSizes = true
+}
+
+struct DebugInodeStatusResult {
+  1: list<TreeInodeDebugInfo> inodes
+  // Set if maxResults directories were reported and there may be more.  Pass
+  // it as startAfter to get the next page.
+  2: optional PathString nextStartAfter
+}
+
 struct InodePathDebugInfo {
   1: PathString path
   2: bool loaded
@@ -611,6 +696,8 @@ struct GlobParams {
   // results.  This only really makes sense with prefetchFiles.
   5: bool suppressFileList,
   6: bool wantDtype,
+  // if true, matching files are returned sorted in compactMatchingFiles
+  7: bool compactPaths,
 }
 
 struct Glob {
@@ -619,7 +706,46 @@ struct Glob {
    * sorted.
    */
   1: list<PathString> matchingFiles,
+  /** In the same order as matchingFiles, or compactMatchingFiles. */
   2: list<OsDtype> dtypes,
+  /** Used instead of matchingFiles when the call asked for compactPaths. */
+  3: FrontCodedPaths compactMatchingFiles,
+}
+
+/** Params for hydrateCommit(). */
+struct HydrateCommitParams {
+  1: PathString mountPoint,
+  2: BinaryHash commit,
+  // The blobs of the files under these paths are fetched too. An empty path
+  // selects every file.
+  3: list<PathString> blobPaths,
+}
+
+struct HydrateCommitResult {
+  1: i64 treeCount,
+  2: i64 blobCount,
+}
+
+/** Params for startBuildSession(). */
+struct StartBuildSessionParams {
+  1: PathString mountPoint,
+  // The trees under these paths are prefetched.
+  2: list<PathString> prefixes,
+  3: i64 durationSeconds,
+}
+
+/**
+ * What a build session has done so far. The blob cache is shared by all
+ * mounts, so its hits and misses are those of every mount since the session
+ * started.
+ */
+struct BuildSessionInfo {
+  1: i64 remainingSeconds,
+  2: i64 prefetchedTrees,
+  3: i64 blobCacheHits,
+  4: i64 blobCacheMisses,
+  // The background inode unload runs that skipped the mount.
+  5: i64 deferredUnloads,
 }
 
 struct AccessCounts {
@@ -642,6 +768,27 @@ struct GetAccessCountsResult {
   // 3: map<pid_t, AccessCount> thriftAccesses
 }
 
+struct DirectoryAccessCounts {
+  1: PathString directory
+  2: i64 lookups
+  3: i64 reads
+  // Blobs of files in the directory that had to be loaded because they were
+  // not in memory.
+  4: i64 blobLoads
+  // Trees of subdirectories that were loaded from the object store.
+  5: i64 treeLoads
+  6: i64 total
+  // An upper bound on how much total overstates the directory's accesses.
+  7: i64 error
+}
+
+struct GetHotDirectoriesParams {
+  1: PathString mountPoint
+  2: i64 count
+  // Clears the counts after reading them.
+  3: bool reset
+}
+
 enum TracePointEvent {
   // Start of a new block
   START = 0;
@@ -727,6 +874,12 @@ struct GetScmStatusParams {
    * directory) will never be reported even when listIgnored is true.
    */
   3: bool listIgnored = false
+
+  /**
+   * Whether to return the status in ScmStatus.compactPaths and
+   * compactStatuses rather than in entries.
+   */
+  4: bool compactPaths = false
 }
 
 service EdenService extends fb303_core.BaseService {
@@ -762,6 +915,13 @@ service EdenService extends fb303_core.BaseService {
     3: CheckoutMode checkoutMode)
       throws (1: EdenError ex)
 
+  /**
+   * Report the progress of the checkOutRevision() call currently running in
+   * this mount, if any.
+   */
+  CheckoutProgressInfo getCheckoutProgressInfo(1: PathString mountPoint)
+    throws (1: EdenError ex)
+
   /**
    * Reset the working directory's parent commits, without changing the working
    * directory contents.
@@ -835,6 +995,16 @@ service EdenService extends fb303_core.BaseService {
     2: JournalPosition fromPosition)
       throws (1: EdenError ex)
 
+  /** Like getFilesChangedSince(), but only reports the paths selected by
+   * params.filter. The filter is applied while the journal is summed, so
+   * clients that watch a few directories of a large checkout do not pay for
+   * the changes everywhere else. An invalid glob in the filter throws an
+   * EdenError with errorCode = EINVAL.
+   */
+  FileDelta getFilesChangedSinceFiltered(
+    1: GetFilesChangedSinceParams params)
+      throws (1: EdenError ex)
+
   /** Sets the memory limit on the journal such that the journal will forget
    * old data to keep itself under a certain estimated memory use.
    */
@@ -907,6 +1077,55 @@ service EdenService extends fb303_core.BaseService {
     1: GlobParams params,
   ) throws (1: EdenError ex)
 
+  /**
+   * Imports the source control trees under each of the given paths, walking
+   * at most `depth` directory levels below them. A depth of 0 only imports the
+   * trees of the given paths.
+   *
+   * Trees are imported breadth first at low priority, which is useful to warm
+   * up a subtree that is about to be read, e.g. before starting a build.
+   * Paths that are not directories in the working copy parent are ignored.
+   */
+  void prefetchTrees(
+    1: PathString mountPoint,
+    2: list<PathString> paths,
+    3: i32 depth,
+  ) throws (1: EdenError ex)
+
+  /**
+   * Imports every source control tree of a commit, and the blobs of its files
+   * under the given paths, into the local store of the mount's daemon.
+   *
+   * This is meant for clients that are about to read most of a commit, such
+   * as CI jobs: it replaces many on-demand imports with large batched ones.
+   * The commit does not need to be checked out. Trees and blobs that fail to
+   * import are logged and skipped.
+   */
+  HydrateCommitResult hydrateCommit(
+    1: HydrateCommitParams params,
+  ) throws (1: EdenError ex)
+
+  /**
+   * Declares that a build is about to run in a mount, or extends the session
+   * already declared so that it lasts at least durationSeconds from now.
+   *
+   * The trees under the given prefixes are prefetched. Until the session
+   * ends, the daemon imports with more workers and larger batches, keeps
+   * blobs cached after they are read, and skips the mount when unloading
+   * inodes in the background. Everything reverts when the last session ends.
+   */
+  BuildSessionInfo startBuildSession(
+    1: StartBuildSessionParams params,
+  ) throws (1: EdenError ex)
+
+  /**
+   * Ends the build session of a mount before its deadline, and returns what
+   * it did. Throws an ARGUMENT_ERROR if the mount has no session.
+   */
+  BuildSessionInfo endBuildSession(
+    1: PathString mountPoint,
+  ) throws (1: EdenError ex)
+
   /**
    * Chowns all files in the requested mount to the requested uid and gid
    */
@@ -1072,6 +1291,15 @@ service EdenService extends fb303_core.BaseService {
     2: PathString path,
   ) throws (1: EdenError ex)
 
+  /**
+   * Like debugInodeStatus, but only reports the directories selected by
+   * params, a page at a time.  Only one directory is locked at a time, so
+   * this is suitable for periodic monitoring of large mounts.
+   */
+  DebugInodeStatusResult debugInodeStatusPaged(
+    1: DebugInodeStatusParams params,
+  ) throws (1: EdenError ex)
+
   /**
    * Get the list of outstanding fuse requests
    *
@@ -1109,6 +1337,17 @@ service EdenService extends fb303_core.BaseService {
   GetAccessCountsResult getAccessCounts(1: i64 duration)
     throws (1: EdenError ex)
 
+  /**
+   * Returns the directories of a mount with the most lookups, reads, and
+   * loads since the mount started or was last reset, most accessed first.
+   * Accesses are sampled at the rate set by
+   * telemetry:directory-access-sample-rate, and nothing is counted unless it
+   * is set.
+   */
+  list<DirectoryAccessCounts> getHotDirectories(
+    1: GetHotDirectoriesParams params,
+  ) throws (1: EdenError ex)
+
   /**
    * Column by column, clears and compacts the LocalStore. All columns are
    * compacted, but only columns that contain ephemeral data are cleared.
@@ -1167,6 +1406,18 @@ service EdenService extends fb303_core.BaseService {
     )
   throws (1: EdenError ex)
 
+  /**
+   * Remove path and everything beneath it, like `rm -rf`.
+   *
+   * Subtrees that have not been modified or accessed since they were checked
+   * out are removed without loading them, and are reported in the journal as
+   * the removal of the subtree's root alone.
+   */
+  void removeRecursively(
+    1: PathString mountPoint,
+    2: PathString path,
+  ) throws (1: EdenError ex)
+
  /**
    * Gets the number of inodes unloaded by periodic job on an EdenMount.
    */
@@ -1176,6 +1427,21 @@ service EdenService extends fb303_core.BaseService {
   void disableTracing()
   list<TracePoint> getTracePoints()
 
+  /**
+   * Returns the same trace points as getTracePoints(), formatted as a JSON
+   * trace that chrome://tracing and Perfetto can load. Like getTracePoints(),
+   * this consumes the trace points it returns.
+   */
+  string getChromeTrace()
+
+  /**
+   * Returns the trace points recorded in the last `seconds` seconds, without
+   * consuming them.  Each thread keeps only its most recent trace points, so
+   * with telemetry:always-on-tracing set this can be used to look into a
+   * latency incident after the fact.
+   */
+  list<TracePoint> getRecentTracePoints(1: i64 seconds)
+
   /**
    * Configure a new fault in Eden's fault injection framework.
    *
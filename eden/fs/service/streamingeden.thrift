@@ -30,4 +30,40 @@ service StreamingEdenService extends eden.EdenService {
    * method above. */
   stream<eden.JournalPosition> subscribeStreamTemporary(
     1: string mountPoint)
+
+  /** Like getFilesChangedSince(), but streams the changes in chunks rather
+   * than building them into a single FileDelta, so that summing a long range
+   * of the journal does not block changes to the mount or build one huge
+   * response.
+   *
+   * Each chunk's fromPosition and toPosition describe the range summed by
+   * that chunk and the ones before it, so the last chunk describes the whole
+   * range.  A path may be listed by more than one chunk, in which case
+   * whether it was created or changed is given by the last chunk that lists
+   * it.  If the range has no changes a single chunk ending at fromPosition
+   * is sent.
+   *
+   * The stream ends with an error if the journal no longer holds the whole
+   * range, as getFilesChangedSince() fails with JOURNAL_TRUNCATED. */
+  stream<eden.FileDelta> streamFilesChangedSince(
+    1: eden.PathString mountPoint,
+    2: eden.JournalPosition fromPosition)
+
+  /** Like globFiles(), but streams the matching files in chunks as each
+   * directory is evaluated, rather than collecting them into a single Glob.
+   *
+   * Unlike the Glob returned by globFiles(), a file matched by more than one
+   * of the globs may be listed more than once, possibly by different chunks.
+   * If prefetchFiles is set the stream completes once the matching files have
+   * been prefetched.  The stream ends with an error if the glob fails. */
+  stream<eden.Glob> streamGlobFiles(1: eden.GlobParams params)
+
+  /** Like getScmStatusV2(), but streams the status in chunks as the
+   * differences are found, rather than collecting them into a single
+   * ScmStatus.
+   *
+   * Each path is listed by exactly one chunk.  The stream ends with an error
+   * if the status cannot be computed, for the same reasons that
+   * getScmStatusV2() fails. */
+  stream<eden.ScmStatus> streamScmStatus(1: eden.GetScmStatusParams params)
 }
@@ -35,9 +35,12 @@ void checkSqliteResult(sqlite3* db, int result) {
       to<string>("sqlite error: ", result, ": ", sqlite3_errstr(result)));
 }
 
-SqliteDatabase::SqliteDatabase(AbsolutePathPiece path) {
+SqliteDatabase::SqliteDatabase(AbsolutePathPiece path, SqliteOpenMode mode) {
   sqlite3* db = nullptr;
-  auto result = sqlite3_open(path.copy().c_str(), &db);
+  int flags = mode == SqliteOpenMode::ReadOnly
+      ? SQLITE_OPEN_READONLY
+      : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+  auto result = sqlite3_open_v2(path.copy().c_str(), &db, flags, nullptr);
   if (result != SQLITE_OK) {
     // On most error conditions sqlite3_open() does allocate the DB object,
     // and it needs to be closed afterwards if it is non-null.
@@ -63,6 +66,10 @@ Synchronized<sqlite3*>::LockedPtr SqliteDatabase::lock() {
   return db_.wlock();
 }
 
+Synchronized<sqlite3*>::LockedPtr SqliteDatabase::tryLock() {
+  return db_.tryWLock();
+}
+
 SqliteStatement::SqliteStatement(
     folly::Synchronized<sqlite3*>::LockedPtr& db,
     folly::StringPiece query)
@@ -87,6 +94,10 @@ bool SqliteStatement::step() {
   }
 }
 
+void SqliteStatement::reset() {
+  sqlite3_reset(stmt_);
+}
+
 void SqliteStatement::bind(
     size_t paramNo,
     folly::StringPiece blob,
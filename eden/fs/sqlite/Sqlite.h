@@ -17,14 +17,22 @@ namespace eden {
 // (SQLITE_OK), format an error message and throw an exception.
 void checkSqliteResult(sqlite3* db, int result);
 
+enum class SqliteOpenMode {
+  ReadWrite,
+  ReadOnly,
+};
+
 /** A helper class for managing a handle to a sqlite database. */
 class SqliteDatabase {
  public:
   /** Open a handle to the database at the specified path.
    * Will throw an exception if the database fails to open.
-   * The database will be created if it didn't already exist.
+   * In ReadWrite mode the database will be created if it didn't already
+   * exist; in ReadOnly mode it must already exist.
    */
-  explicit SqliteDatabase(AbsolutePathPiece path);
+  explicit SqliteDatabase(
+      AbsolutePathPiece path,
+      SqliteOpenMode mode = SqliteOpenMode::ReadWrite);
 
   // Not copyable...
   SqliteDatabase(const SqliteDatabase&) = delete;
@@ -45,6 +53,10 @@ class SqliteDatabase {
    * to the SqliteStatement class. */
   folly::Synchronized<sqlite3*>::LockedPtr lock();
 
+  /** Like lock(), but returns a null LockedPtr instead of waiting if another
+   * thread holds the lock. */
+  folly::Synchronized<sqlite3*>::LockedPtr tryLock();
+
  private:
   folly::Synchronized<sqlite3*> db_{nullptr};
 };
@@ -93,6 +105,14 @@ class SqliteStatement {
    */
   bool step();
 
+  /** Reset the statement so that it can be executed again.
+   * step() does this itself once it reaches the end of the result set, so
+   * this is only needed when a statement that is kept around for reuse did
+   * not run to completion, such as a lookup that stopped at its first row.
+   * Bound parameters keep their values.
+   */
+  void reset();
+
   /** Bind a stringy parameter to a prepared statement placeholder.
    * Parameters are 1-based, with the first parameter having paramNo==1.
    * Throws an exception on error.
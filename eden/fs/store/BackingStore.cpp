@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BackingStore.h"
+
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/Tree.h"
+
+namespace facebook {
+namespace eden {
+
+std::vector<folly::SemiFuture<std::unique_ptr<Tree>>> BackingStore::getTrees(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) {
+  std::vector<folly::SemiFuture<std::unique_ptr<Tree>>> futures;
+  futures.reserve(ids.size());
+  for (const auto& id : ids) {
+    futures.push_back(
+        folly::makeSemiFutureWith([&] { return getTree(id, context); }));
+  }
+  return futures;
+}
+
+std::vector<folly::SemiFuture<std::unique_ptr<Blob>>> BackingStore::getBlobs(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) {
+  std::vector<folly::SemiFuture<std::unique_ptr<Blob>>> futures;
+  futures.reserve(ids.size());
+  for (const auto& id : ids) {
+    futures.push_back(
+        folly::makeSemiFutureWith([&] { return getBlob(id, context); }));
+  }
+  return futures;
+}
+
+} // namespace eden
+} // namespace facebook
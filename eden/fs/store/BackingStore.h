@@ -9,7 +9,10 @@
 
 #include <folly/futures/Future.h>
 #include <memory>
+#include <optional>
+#include <vector>
 
+#include "eden/fs/store/BlobMetadata.h"
 #include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/store/ObjectFetchContext.h"
 
@@ -46,6 +49,31 @@ class BackingStore {
       const Hash& id,
       ObjectFetchContext& context) = 0;
 
+  /**
+   * Fetch several trees or blobs at once.  Returns one future per ID, in the
+   * same order, so that a missing object only fails its own future.
+   *
+   * BackingStores that can fetch many objects more cheaply than one at a time
+   * override these.  The defaults call getTree() or getBlob() for each ID.
+   */
+  virtual std::vector<folly::SemiFuture<std::unique_ptr<Tree>>> getTrees(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context);
+  virtual std::vector<folly::SemiFuture<std::unique_ptr<Blob>>> getBlobs(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context);
+
+  /**
+   * Fetch the size and SHA-1 of a blob's contents without fetching the
+   * contents.  Returns std::nullopt if this BackingStore cannot do that, in
+   * which case the caller fetches the blob to compute them.
+   */
+  virtual folly::SemiFuture<std::optional<BlobMetadata>> getBlobMetadata(
+      const Hash& /*id*/,
+      ObjectFetchContext& /*context*/) {
+    return std::optional<BlobMetadata>{};
+  }
+
   virtual folly::SemiFuture<std::unique_ptr<Tree>> getTreeForCommit(
       const Hash& commitID) = 0;
   virtual folly::SemiFuture<std::unique_ptr<Tree>> getTreeForManifest(
@@ -59,6 +87,13 @@ class BackingStore {
 
   virtual void periodicManagementTask() {}
 
+  /**
+   * Called when the first build session starts and when the last one ends.
+   * While one is active, stores that can import objects in parallel may use
+   * more threads and larger batches.
+   */
+  virtual void setBuildSessionActive(bool /*active*/) {}
+
  private:
   // Forbidden copy constructor and assignment operator
   BackingStore(BackingStore const&) = delete;
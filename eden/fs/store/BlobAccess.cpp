@@ -7,9 +7,15 @@
 
 #include "eden/fs/store/BlobAccess.h"
 #include <folly/MapUtil.h>
+#include <folly/io/Cursor.h>
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include <vector>
 #include "eden/fs/model/Blob.h"
+#include "eden/fs/store/BlobChunks.h"
 #include "eden/fs/store/BlobCache.h"
 #include "eden/fs/store/IObjectStore.h"
+#include "eden/fs/store/ObjectFetchContext.h"
 
 namespace facebook {
 namespace eden {
@@ -21,22 +27,136 @@ BlobAccess::BlobAccess(
 
 BlobAccess::~BlobAccess() {}
 
+namespace {
+/**
+ * Deprioritized requests, such as those from processes that have fetched an
+ * unusual number of objects, are usually scans.  Their hits should not
+ * protect blobs in the BlobCache.
+ */
+BlobCache::Interest adjustInterest(
+    BlobCache::Interest interest,
+    const ObjectFetchContext& context) {
+  if (interest == BlobCache::Interest::LikelyNeededAgain &&
+      context.getPriority() < ImportPriority::kNormal()) {
+    return BlobCache::Interest::UnlikelyNeededAgain;
+  }
+  return interest;
+}
+} // namespace
+
 folly::Future<BlobCache::GetResult> BlobAccess::getBlob(
     const Hash& hash,
     ObjectFetchContext& context,
     BlobCache::Interest interest) {
-  auto result = blobCache_->get(hash, interest);
+  auto result = blobCache_->get(hash, adjustInterest(interest, context));
   if (result.blob) {
     return folly::Future<BlobCache::GetResult>{std::move(result)};
   }
 
   return objectStore_->getBlob(hash, context)
-      .thenValue([blobCache = blobCache_,
-                  interest](std::shared_ptr<const Blob> blob) {
-        auto interestHandle = blobCache->insert(blob, interest);
+      .thenValue([blobCache = blobCache_, interest, &context](
+                     std::shared_ptr<const Blob> blob) {
+        // ObjectStore may have deprioritized the context while fetching.
+        auto interestHandle =
+            blobCache->insert(blob, adjustInterest(interest, context));
         return BlobCache::GetResult{std::move(blob), std::move(interestHandle)};
       });
 }
 
+folly::Future<std::unique_ptr<folly::IOBuf>> BlobAccess::getBlobRange(
+    const Hash& hash,
+    uint64_t offset,
+    size_t length,
+    ObjectFetchContext& context) {
+  auto firstChunk = offset / kBlobChunkSize;
+  auto endChunk =
+      (offset + std::max<size_t>(length, 1) - 1) / kBlobChunkSize + 1;
+  std::vector<folly::Future<std::shared_ptr<const Blob>>> chunkFutures;
+  for (auto index = firstChunk; index < endChunk; ++index) {
+    chunkFutures.push_back(getBlobChunk(hash, index, context));
+  }
+
+  return folly::collect(chunkFutures)
+      .thenValue([skip = offset - firstChunk * kBlobChunkSize, length](
+                     std::vector<std::shared_ptr<const Blob>> chunks) mutable
+                 -> std::unique_ptr<folly::IOBuf> {
+        std::unique_ptr<folly::IOBuf> range;
+        auto remaining = length;
+        for (const auto& chunk : chunks) {
+          if (!chunk) {
+            // Either the chunk is not available or the previous chunk ended
+            // exactly at the end of the blob.  Only the whole blob can tell.
+            return nullptr;
+          }
+
+          auto chunkSize = chunk->getSize();
+          if (skip < chunkSize) {
+            const auto& contents = chunk->getContents();
+            folly::io::Cursor cursor(&contents);
+            cursor.skip(skip);
+            std::unique_ptr<folly::IOBuf> piece;
+            remaining -= cursor.cloneAtMost(piece, remaining);
+            if (range) {
+              range->prependChain(std::move(piece));
+            } else {
+              range = std::move(piece);
+            }
+          }
+          skip = 0;
+
+          // Only the last chunk of a blob is shorter than kBlobChunkSize.
+          if (chunkSize < kBlobChunkSize || remaining == 0) {
+            break;
+          }
+        }
+        return range ? std::move(range) : folly::IOBuf::create(0);
+      });
+}
+
+void BlobAccess::prefetchBlobRange(
+    const Hash& hash,
+    uint64_t offset,
+    size_t length) {
+  if (length == 0) {
+    return;
+  }
+  std::vector<folly::Future<std::shared_ptr<const Blob>>> chunkFutures;
+  auto endChunk = (offset + length - 1) / kBlobChunkSize + 1;
+  for (auto index = offset / kBlobChunkSize; index < endChunk; ++index) {
+    if (!blobCache_->contains(blobChunkId(hash, index))) {
+      chunkFutures.push_back(
+          getBlobChunk(hash, index, ObjectFetchContext::getNullContext()));
+    }
+  }
+  if (chunkFutures.empty()) {
+    return;
+  }
+
+  folly::collect(chunkFutures)
+      .thenError([hash](const folly::exception_wrapper& ew) {
+        XLOG(DBG3) << "error prefetching chunks of blob " << hash << ": "
+                   << ew.what();
+        return std::vector<std::shared_ptr<const Blob>>{};
+      });
+}
+
+folly::Future<std::shared_ptr<const Blob>> BlobAccess::getBlobChunk(
+    const Hash& hash,
+    uint64_t index,
+    ObjectFetchContext& context) {
+  auto result = blobCache_->get(blobChunkId(hash, index));
+  if (result.blob) {
+    return folly::Future<std::shared_ptr<const Blob>>{std::move(result.blob)};
+  }
+
+  return objectStore_->getBlobChunk(hash, index, context)
+      .thenValue([blobCache = blobCache_](std::shared_ptr<const Blob> chunk) {
+        if (chunk) {
+          blobCache->insert(chunk);
+        }
+        return chunk;
+      });
+}
+
 } // namespace eden
 } // namespace facebook
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <folly/futures/Future.h>
+#include <folly/io/IOBuf.h>
+#include <cstdint>
 #include <memory>
 #include "eden/fs/store/BlobCache.h"
 
@@ -60,7 +62,31 @@ class BlobAccess {
       ObjectFetchContext& context,
       BlobCache::Interest interest = BlobCache::Interest::LikelyNeededAgain);
 
+  /**
+   * Loads up to length bytes of the blob's contents starting at offset, from
+   * only the chunks of the blob that cover that range (see BlobChunks.h).
+   * Chunks are cached in the BlobCache separately from whole blobs.
+   *
+   * Returns nullptr if those chunks are not available, in which case the
+   * caller should load the entire blob with getBlob() instead.
+   */
+  folly::Future<std::unique_ptr<folly::IOBuf>> getBlobRange(
+      const Hash& hash,
+      uint64_t offset,
+      size_t length,
+      ObjectFetchContext& context);
+
+  /**
+   * Starts loading the chunks of the blob that cover length bytes at offset
+   * into the BlobCache, without waiting for them to load.  Chunks that are
+   * not available are skipped.
+   */
+  void prefetchBlobRange(const Hash& hash, uint64_t offset, size_t length);
+
  private:
+  folly::Future<std::shared_ptr<const Blob>>
+  getBlobChunk(const Hash& hash, uint64_t index, ObjectFetchContext& context);
+
   BlobAccess(const BlobAccess&) = delete;
   BlobAccess& operator=(const BlobAccess&) = delete;
 
@@ -6,9 +6,12 @@
  */
 
 #include "BlobCache.h"
+#include <folly/ExceptionString.h>
 #include <folly/MapUtil.h>
+#include <algorithm>
 #include <folly/logging/xlog.h>
 #include "eden/fs/model/Blob.h"
+#include "eden/fs/store/BlobCompression.h"
 #include "eden/fs/utils/IDGen.h"
 
 namespace facebook {
@@ -24,9 +27,9 @@ BlobInterestHandle::BlobInterestHandle(
       blob_{std::move(blob)},
       cacheItemGeneration_{generation} {}
 
-void BlobInterestHandle::reset() noexcept {
+void BlobInterestHandle::reset(Usage usage) noexcept {
   if (auto blobCache = blobCache_.lock()) {
-    blobCache->dropInterestHandle(hash_, cacheItemGeneration_);
+    blobCache->dropInterestHandle(hash_, cacheItemGeneration_, usage);
   }
   blobCache_.reset();
 }
@@ -49,17 +52,35 @@ std::shared_ptr<const Blob> BlobInterestHandle::getBlob() const {
 
 std::shared_ptr<BlobCache> BlobCache::create(
     size_t maximumCacheSizeBytes,
-    size_t minimumEntryCount) {
+    size_t minimumEntryCount,
+    size_t shardCount,
+    size_t maximumCompressedSizeBytes,
+    size_t maximumProtectedSizeBytes) {
   // Allow make_shared with private constructor.
   struct BC : BlobCache {
-    BC(size_t x, size_t y) : BlobCache{x, y} {}
+    BC(size_t x, size_t y, size_t z, size_t w, size_t v)
+        : BlobCache{x, y, z, w, v} {}
   };
-  return std::make_shared<BC>(maximumCacheSizeBytes, minimumEntryCount);
+  return std::make_shared<BC>(
+      maximumCacheSizeBytes,
+      minimumEntryCount,
+      std::max(shardCount, size_t{1}),
+      maximumCompressedSizeBytes,
+      maximumProtectedSizeBytes);
 }
 
-BlobCache::BlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount)
-    : maximumCacheSizeBytes_{maximumCacheSizeBytes},
-      minimumEntryCount_{minimumEntryCount} {}
+BlobCache::BlobCache(
+    size_t maximumCacheSizeBytes,
+    size_t minimumEntryCount,
+    size_t shardCount,
+    size_t maximumCompressedSizeBytes,
+    size_t maximumProtectedSizeBytes)
+    : maximumCacheSizeBytes_{maximumCacheSizeBytes / shardCount},
+      // Round up so the cache as a whole keeps at least minimumEntryCount.
+      minimumEntryCount_{(minimumEntryCount + shardCount - 1) / shardCount},
+      maximumCompressedSizeBytes_{maximumCompressedSizeBytes / shardCount},
+      maximumProtectedSizeBytes_{maximumProtectedSizeBytes / shardCount},
+      shards_(shardCount) {}
 
 BlobCache::~BlobCache() {}
 
@@ -71,13 +92,26 @@ BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
   // runs after the lock is released.
   BlobInterestHandle interestHandle;
 
-  auto state = state_.wlock();
+  auto state = getShard(hash).wlock();
 
   auto* item = folly::get_ptr(state->items, hash);
   if (!item) {
-    XLOG(DBG6) << "BlobCache::get missed";
-    ++state->missCount;
-    return GetResult{};
+    auto compressedIter = state->compressedItems.find(hash);
+    if (compressedIter == state->compressedItems.end()) {
+      XLOG(DBG6) << "BlobCache::get missed";
+      ++state->missCount;
+      return GetResult{};
+    }
+
+    XLOG(DBG6) << "BlobCache::get hit in the compressed tier";
+    ++state->compressedHitCount;
+    auto compressed = std::move(compressedIter->second);
+    state->compressedEvictionQueue.erase(compressed.index);
+    state->compressedSize -= compressed.compressedSize;
+    state->compressedItems.erase(compressedIter);
+    // Decompress without holding the lock.
+    state.unlock();
+    return insertDecompressed(hash, compressed, interest);
   }
 
   switch (interest) {
@@ -88,6 +122,7 @@ BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
       interestHandle = BlobInterestHandle{
           shared_from_this(), hash, item->blob, item->generation};
       ++item->referenceCount;
+      item->addInterestHandle();
       break;
     case Interest::LikelyNeededAgain:
       interestHandle.blob_ = item->blob;
@@ -104,10 +139,9 @@ BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
 
   XLOG(DBG6) << "BlobCache::get hit";
 
-  // TODO: Should we avoid promoting if interest is UnlikelyNeededAgain?
-  // For now, we'll try not to be too clever.
-  state->evictionQueue.splice(
-      state->evictionQueue.end(), state->evictionQueue, item->index);
+  // UnlikelyNeededAgain still moves the blob to the back of its queue, but
+  // never into the protected segment.
+  touchItem(*state, item, interest != Interest::UnlikelyNeededAgain);
   ++state->hitCount;
   return GetResult{item->blob, std::move(interestHandle)};
 }
@@ -123,7 +157,7 @@ BlobInterestHandle BlobCache::insert(
   BlobInterestHandle interestHandle;
 
   auto hash = blob->getHash();
-  auto size = blob->getSize();
+  auto size = blob->getHeapSize();
 
   auto cacheItemGeneration = generateUniqueID();
 
@@ -137,7 +171,7 @@ BlobInterestHandle BlobCache::insert(
 
   XLOG(DBG6) << "  creating entry with generation=" << cacheItemGeneration;
 
-  auto state = state_.wlock();
+  auto state = getShard(hash).wlock();
   auto [iter, inserted] =
       state->items.try_emplace(hash, std::move(blob), cacheItemGeneration);
   // noexcept from here until `try`
@@ -145,6 +179,9 @@ BlobInterestHandle BlobCache::insert(
     case Interest::UnlikelyNeededAgain:
       break;
     case Interest::WantHandle:
+      ++iter->second.referenceCount;
+      iter->second.addInterestHandle();
+      break;
     case Interest::LikelyNeededAgain:
       ++iter->second.referenceCount;
       break;
@@ -159,47 +196,195 @@ BlobInterestHandle BlobCache::insert(
     }
     iter->second.index = std::prev(state->evictionQueue.end());
     state->totalSize += size;
+    // The compressed copy of the blob, if any, is no longer needed.
+    auto compressedIter = state->compressedItems.find(hash);
+    if (compressedIter != state->compressedItems.end()) {
+      state->compressedEvictionQueue.erase(compressedIter->second.index);
+      state->compressedSize -= compressedIter->second.compressedSize;
+      state->compressedItems.erase(compressedIter);
+    }
     evictUntilFits(*state);
   } else {
     XLOG(DBG6) << "  duplicate entry, using generation " << itemPtr->generation;
     // Inserting duplicate entry - use its generation.
     interestHandle.cacheItemGeneration_ = itemPtr->generation;
-    state->evictionQueue.splice(
-        state->evictionQueue.end(), state->evictionQueue, itemPtr->index);
+    touchItem(*state, itemPtr, interest != Interest::UnlikelyNeededAgain);
+  }
+
+  if (!state->evictedToCompress.empty()) {
+    auto evicted = std::move(state->evictedToCompress);
+    state->evictedToCompress.clear();
+    state.unlock();
+    compressEvicted(getShard(hash), std::move(evicted));
   }
   return interestHandle;
 }
 
+BlobCache::GetResult BlobCache::insertDecompressed(
+    const Hash& hash,
+    const CompressedItem& compressed,
+    Interest interest) {
+  BlobPtr blob;
+  try {
+    blob = std::make_shared<const Blob>(
+        hash,
+        decompressBlobContents(*compressed.data, compressed.uncompressedSize));
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error decompressing cached blob " << hash << ": "
+              << folly::exceptionStr(ex);
+    return GetResult{};
+  }
+  auto interestHandle = insert(blob, interest);
+  return GetResult{std::move(blob), std::move(interestHandle)};
+}
+
+void BlobCache::compressEvicted(
+    folly::Synchronized<State>& shard,
+    std::vector<BlobPtr> blobs) noexcept {
+  for (auto& blob : blobs) {
+    try {
+      auto compressed = compressBlobContents(blob->getContents());
+      if (!compressed) {
+        continue;
+      }
+      auto compressedSize = compressed->computeChainDataLength();
+      const auto& hash = blob->getHash();
+
+      auto state = shard.wlock();
+      if (state->items.count(hash) || state->compressedItems.count(hash)) {
+        // The blob was cached again while it was being compressed.
+        continue;
+      }
+      state->compressedEvictionQueue.push_back(hash);
+      try {
+        state->compressedItems.emplace(
+            hash,
+            CompressedItem{
+                std::move(compressed),
+                compressedSize,
+                blob->getSize(),
+                std::prev(state->compressedEvictionQueue.end())});
+      } catch (const std::exception&) {
+        state->compressedEvictionQueue.pop_back();
+        throw;
+      }
+      state->compressedSize += compressedSize;
+      evictCompressedUntilFits(*state);
+    } catch (const std::exception& ex) {
+      XLOG(WARN) << "error compressing evicted blob " << blob->getHash()
+                 << ": " << folly::exceptionStr(ex);
+    }
+  }
+}
+
+void BlobCache::evictCompressedUntilFits(State& state) noexcept {
+  while (state.compressedSize > maximumCompressedSizeBytes_ &&
+         !state.compressedEvictionQueue.empty()) {
+    auto iter =
+        state.compressedItems.find(state.compressedEvictionQueue.front());
+    state.compressedSize -= iter->second.compressedSize;
+    state.compressedItems.erase(iter);
+    state.compressedEvictionQueue.pop_front();
+  }
+}
+
 bool BlobCache::contains(const Hash& hash) const {
-  auto state = state_.rlock();
+  auto state = getShard(hash).rlock();
   return 1 == state->items.count(hash);
 }
 
 void BlobCache::clear() {
   XLOG(DBG6) << "BlobCache::clear";
-  auto state = state_.wlock();
-  state->totalSize = 0;
-  state->items.clear();
-  state->evictionQueue.clear();
+  for (auto& shard : shards_) {
+    auto state = shard.wlock();
+    state->totalSize = 0;
+    state->items.clear();
+    state->evictionQueue.clear();
+    state->protectedQueue.clear();
+    state->protectedSize = 0;
+    state->compressedSize = 0;
+    state->compressedItems.clear();
+    state->compressedEvictionQueue.clear();
+  }
+}
+
+void BlobCache::setMaximumCacheSize(size_t maximumCacheSizeBytes) {
+  XLOG(DBG2) << "BlobCache::setMaximumCacheSize " << maximumCacheSizeBytes;
+  maximumCacheSizeBytes_.store(
+      maximumCacheSizeBytes / shards_.size(), std::memory_order_relaxed);
+  for (auto& shard : shards_) {
+    auto state = shard.wlock();
+    evictUntilFits(*state);
+    if (!state->evictedToCompress.empty()) {
+      auto evicted = std::move(state->evictedToCompress);
+      state->evictedToCompress.clear();
+      state.unlock();
+      compressEvicted(shard, std::move(evicted));
+    }
+  }
+}
+
+void BlobCache::setRetainReleasedBlobs(bool retain) {
+  XLOG(DBG2) << "BlobCache::setRetainReleasedBlobs " << retain;
+  retainReleasedBlobs_.store(retain, std::memory_order_relaxed);
 }
 
 BlobCache::Stats BlobCache::getStats() const {
-  auto state = state_.rlock();
   Stats stats;
-  stats.blobCount = state->items.size();
-  stats.totalSizeInBytes = state->totalSize;
-  stats.hitCount = state->hitCount;
-  stats.missCount = state->missCount;
-  stats.evictionCount = state->evictionCount;
-  stats.dropCount = state->dropCount;
+  for (auto& shard : shards_) {
+    auto state = shard.rlock();
+    stats.blobCount += state->items.size();
+    stats.totalSizeInBytes += state->totalSize;
+    stats.hitCount += state->hitCount;
+    stats.missCount += state->missCount;
+    stats.evictionCount += state->evictionCount;
+    stats.dropCount += state->dropCount;
+    stats.compressedBlobCount += state->compressedItems.size();
+    stats.compressedSizeInBytes += state->compressedSize;
+    stats.compressedHitCount += state->compressedHitCount;
+    stats.protectedBlobCount += state->protectedQueue.size();
+    stats.protectedSizeInBytes += state->protectedSize;
+    stats.demoteCount += state->demoteCount;
+    stats.retainCount += state->retainCount;
+  }
   return stats;
 }
 
+std::vector<Hash> BlobCache::getCachedHashes() const {
+  std::vector<std::vector<Hash>> shardHashes;
+  shardHashes.reserve(shards_.size());
+  size_t total = 0;
+  for (auto& shard : shards_) {
+    auto state = shard.rlock();
+    auto& hashes = shardHashes.emplace_back();
+    hashes.reserve(state->items.size());
+    for (auto* queue : {&state->protectedQueue, &state->evictionQueue}) {
+      for (auto it = queue->rbegin(); it != queue->rend(); ++it) {
+        hashes.push_back((*it)->blob->getHash());
+      }
+    }
+    total += hashes.size();
+  }
+
+  std::vector<Hash> result;
+  result.reserve(total);
+  for (size_t i = 0; result.size() < total; ++i) {
+    for (const auto& hashes : shardHashes) {
+      if (i < hashes.size()) {
+        result.push_back(hashes[i]);
+      }
+    }
+  }
+  return result;
+}
+
 void BlobCache::dropInterestHandle(
     const Hash& hash,
-    uint64_t generation) noexcept {
+    uint64_t generation,
+    BlobInterestHandle::Usage usage) noexcept {
+  using Usage = BlobInterestHandle::Usage;
   XLOG(DBG6) << "dropInterestHandle " << hash << " generation=" << generation;
-  auto state = state_.wlock();
+  auto state = getShard(hash).wlock();
 
   auto* item = folly::get_ptr(state->items, hash);
   if (!item) {
@@ -220,35 +405,125 @@ void BlobCache::dropInterestHandle(
     return;
   }
 
+  if (item->handleCount > 0) {
+    --item->handleCount;
+  }
+
+  // Blobs that several readers wanted at once, or that were read randomly, are
+  // likely to be read again, so they are left to age out of the cache.
+  bool worthKeeping = usage == Usage::ReadRandomly ||
+      (usage != Usage::Unknown && item->isShared) ||
+      retainReleasedBlobs_.load(std::memory_order_relaxed);
+
   if (--item->referenceCount == 0) {
-    state->evictionQueue.erase(item->index);
+    if (worthKeeping) {
+      ++state->retainCount;
+      return;
+    }
+    unlinkItem(*state, item);
     ++state->dropCount;
     evictItem(*state, item);
+    return;
+  }
+
+  // Still referenced, perhaps by a LikelyNeededAgain lookup, but a single
+  // sequential reader has finished with it.
+  if (usage == Usage::ReadSequentially && !worthKeeping &&
+      item->handleCount == 0) {
+    demoteItem(*state, item);
+    ++state->demoteCount;
+  }
+}
+
+void BlobCache::touchItem(
+    State& state,
+    CacheItem* item,
+    bool promote) noexcept {
+  if (item->isProtected) {
+    state.protectedQueue.splice(
+        state.protectedQueue.end(), state.protectedQueue, item->index);
+    return;
+  }
+  if (!promote || maximumProtectedSizeBytes_ == 0) {
+    state.evictionQueue.splice(
+        state.evictionQueue.end(), state.evictionQueue, item->index);
+    return;
+  }
+
+  state.protectedQueue.splice(
+      state.protectedQueue.end(), state.evictionQueue, item->index);
+  item->isProtected = true;
+  state.protectedSize += item->blob->getHeapSize();
+
+  // Demote the least recently used protected blobs to the back of the
+  // probationary segment, always keeping the one just promoted.
+  while (state.protectedSize > maximumProtectedSizeBytes_ &&
+         state.protectedQueue.size() > 1) {
+    auto* demoted = state.protectedQueue.front();
+    state.evictionQueue.splice(
+        state.evictionQueue.end(), state.protectedQueue, demoted->index);
+    demoted->isProtected = false;
+    state.protectedSize -= demoted->blob->getHeapSize();
+  }
+}
+
+void BlobCache::unlinkItem(State& state, CacheItem* item) noexcept {
+  if (item->isProtected) {
+    state.protectedQueue.erase(item->index);
+    state.protectedSize -= item->blob->getHeapSize();
+  } else {
+    state.evictionQueue.erase(item->index);
+  }
+}
+
+void BlobCache::demoteItem(State& state, CacheItem* item) noexcept {
+  if (item->isProtected) {
+    state.evictionQueue.splice(
+        state.evictionQueue.begin(), state.protectedQueue, item->index);
+    item->isProtected = false;
+    state.protectedSize -= item->blob->getHeapSize();
+  } else {
+    state.evictionQueue.splice(
+        state.evictionQueue.begin(), state.evictionQueue, item->index);
   }
 }
 
 void BlobCache::evictUntilFits(State& state) noexcept {
+  auto maximumCacheSizeBytes =
+      maximumCacheSizeBytes_.load(std::memory_order_relaxed);
   XLOG(DBG6) << "state.totalSize=" << state.totalSize
-             << ", maximumCacheSizeBytes_=" << maximumCacheSizeBytes_
+             << ", maximumCacheSizeBytes_=" << maximumCacheSizeBytes
              << ", evictionQueue.size()=" << state.evictionQueue.size()
              << ", minimumEntryCount_=" << minimumEntryCount_;
-  while (state.totalSize > maximumCacheSizeBytes_ &&
-         state.evictionQueue.size() > minimumEntryCount_) {
+  while (state.totalSize > maximumCacheSizeBytes &&
+         state.items.size() > minimumEntryCount_) {
     evictOne(state);
   }
 }
 
 void BlobCache::evictOne(State& state) noexcept {
-  CacheItem* front = state.evictionQueue.front();
-  state.evictionQueue.pop_front();
+  // Probationary blobs go first.
+  CacheItem* front = state.evictionQueue.empty()
+      ? state.protectedQueue.front()
+      : state.evictionQueue.front();
+  unlinkItem(state, front);
   ++state.evictionCount;
+  // Mapped blobs take up no heap memory to save by compressing them.
+  if (maximumCompressedSizeBytes_ > 0 && !front->blob->isMapped() &&
+      front->blob->getSize() >= kMinCompressibleBlobSize) {
+    try {
+      state.evictedToCompress.push_back(front->blob);
+    } catch (const std::exception&) {
+      // The blob is simply not kept in the compressed tier.
+    }
+  }
   evictItem(state, front);
 }
 
 void BlobCache::evictItem(State& state, CacheItem* item) noexcept {
   XLOG(DBG6) << "evicting " << item->blob->getHash()
              << " generation=" << item->generation;
-  auto size = item->blob->getSize();
+  auto size = item->blob->getHeapSize();
   // TODO: Releasing this BlobPtr here can run arbitrary deleters which could,
   // in theory, try to reacquire the BlobCache's lock. The blob could be
   // scheduled for deletion in a deletion queue but then it's hard to ensure
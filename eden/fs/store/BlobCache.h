@@ -8,9 +8,13 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <folly/io/IOBuf.h>
+#include <atomic>
 #include <cstddef>
 #include <list>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 #include "eden/fs/model/Hash.h"
 
 namespace facebook {
@@ -25,6 +29,28 @@ class BlobCache;
  */
 class BlobInterestHandle {
  public:
+  /**
+   * How the holder read the blob, passed to reset() so the cache can spend
+   * its memory on blobs that are read again.
+   */
+  enum class Usage {
+    /** Nothing is known: the last handle to be dropped evicts the blob. */
+    Unknown,
+
+    /**
+     * The blob was read once from start to end.  The kernel's page cache now
+     * holds it, so unless other readers are interested in it, it is evicted or
+     * moved to where it will be evicted next.
+     */
+    ReadSequentially,
+
+    /**
+     * The blob was read out of order, as databases and linkers do, and such
+     * readers tend to come back.  It is kept until it is naturally evicted.
+     */
+    ReadRandomly,
+  };
+
   BlobInterestHandle() noexcept = default;
 
   ~BlobInterestHandle() noexcept {
@@ -42,7 +68,7 @@ class BlobInterestHandle {
    */
   std::shared_ptr<const Blob> getBlob() const;
 
-  void reset() noexcept;
+  void reset(Usage usage = Usage::Unknown) noexcept;
 
  private:
   BlobInterestHandle(
@@ -77,6 +103,31 @@ class BlobInterestHandle {
  * frequently-accessed large blobs when they are larger than the maximum cache
  * size.
  *
+ * Optionally, the cache is segmented to resist scans.  Blobs start out in a
+ * probationary segment and move to a protected segment of limited size when
+ * they are requested again with an interest other than UnlikelyNeededAgain.
+ * Probationary blobs are evicted before protected ones, so reading many blobs
+ * once, as `grep -r` or a backup does, does not evict the working set.
+ * Protected blobs that overflow their segment return to probation.
+ *
+ * Interest handles also tell the cache how blobs were read.  A blob read once
+ * sequentially by a single reader is demoted as soon as the read completes,
+ * while a blob that several readers held handles to at the same time, or that
+ * was read randomly, outlives its handles.
+ *
+ * Optionally, blobs evicted to make room are kept compressed in a second tier
+ * with its own maximum size, and are decompressed and moved back into the
+ * cache when they are next requested.  Source code compresses well, so this
+ * keeps many more blobs in memory for the same space.
+ *
+ * Blobs whose contents are mapped from a MappedBlobCache file take up no heap
+ * memory, and do not count towards the maximum cache size.
+ *
+ * To reduce lock contention when many threads read through the cache, it can
+ * be split into multiple shards by hash. Each shard has its own lock and an
+ * equal share of the maximum cache size and minimum entry count, and evicts
+ * independently of the others.
+ *
  * It is safe to use this object from arbitrary threads.
  */
 class BlobCache : public std::enable_shared_from_this<BlobCache> {
@@ -95,7 +146,8 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
      * returned that, when dropped, releases the reference and evicts the item
      * from cache. Intended for satisfying a series of blob reads from cache
      * until the inode is unloaded, after which the blob can evicted from cache,
-     * freeing space.
+     * freeing space.  The Usage passed to BlobInterestHandle::reset() can keep
+     * the blob cached for longer, or demote it sooner.
      */
     WantHandle,
 
@@ -122,11 +174,24 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
     uint64_t missCount{0};
     uint64_t evictionCount{0};
     uint64_t dropCount{0};
+    size_t compressedBlobCount{0};
+    size_t compressedSizeInBytes{0};
+    /** Misses in the cache that were satisfied by the compressed tier. */
+    uint64_t compressedHitCount{0};
+    size_t protectedBlobCount{0};
+    size_t protectedSizeInBytes{0};
+    /** Blobs moved to the front of the eviction queue after one read. */
+    uint64_t demoteCount{0};
+    /** Blobs kept in the cache after their last interest handle was dropped. */
+    uint64_t retainCount{0};
   };
 
   static std::shared_ptr<BlobCache> create(
       size_t maximumCacheSizeBytes,
-      size_t minimumEntryCount);
+      size_t minimumEntryCount,
+      size_t shardCount = 1,
+      size_t maximumCompressedSizeBytes = 0,
+      size_t maximumProtectedSizeBytes = 0);
   ~BlobCache();
 
   /**
@@ -167,12 +232,33 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
    */
   void clear();
 
+  /**
+   * Changes the maximum cache size, evicting entries as needed to fit it.
+   * Lets the budget be adjusted while the cache is in use.
+   */
+  void setMaximumCacheSize(size_t maximumCacheSizeBytes);
+
+  /**
+   * While set, blobs whose last interest handle is dropped are left to age
+   * out of the cache however they were read.  Builds read the same headers
+   * from many processes in quick succession, so during a build session the
+   * cache favors keeping what it has over making room early.
+   */
+  void setRetainReleasedBlobs(bool retain);
+
   /**
    * Return information about the current size of the cache and the total number
-   * of hits and misses.
+   * of hits and misses, summed across all shards.
    */
   Stats getStats() const;
 
+  /**
+   * Return the hashes of the uncompressed blobs in the cache, roughly most
+   * recently used first: each shard's protected segment is listed before its
+   * probationary segment, and the shards are interleaved.
+   */
+  std::vector<Hash> getCachedHashes() const;
+
  private:
   /*
    * TODO: This data structure could be implemented more efficiently. But since
@@ -192,6 +278,11 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
     explicit CacheItem(BlobPtr b, uint64_t g)
         : blob{std::move(b)}, generation{g} {}
 
+    void addInterestHandle() noexcept {
+      isShared = isShared || handleCount > 0;
+      ++handleCount;
+    }
+
     BlobPtr blob;
     std::list<CacheItem*>::iterator index;
 
@@ -202,31 +293,121 @@ class BlobCache : public std::enable_shared_from_this<BlobCache> {
     /// Given a unique value upon allocation. Used to verify InterestHandle
     // matches this specific item.
     uint64_t generation{0};
+
+    /// The number of live interest handles, each one held by a reader.
+    uint32_t handleCount{0};
+
+    /// Set once a handle is created while another is live, meaning distinct
+    /// readers are sharing this blob.
+    bool isShared{false};
+
+    /// Whether index refers to protectedQueue rather than evictionQueue.
+    bool isProtected{false};
+  };
+
+  struct CompressedItem {
+    std::unique_ptr<folly::IOBuf> data;
+    size_t compressedSize;
+    uint64_t uncompressedSize;
+    std::list<Hash>::iterator index;
   };
 
   struct State {
     size_t totalSize{0};
     std::unordered_map<Hash, CacheItem> items;
 
-    /// Entries are evicted from the front of the queue.
+    /// Entries are evicted from the front of the queue.  Holds every entry
+    /// unless the cache is segmented, in which case it is the probationary
+    /// segment.
     std::list<CacheItem*> evictionQueue;
 
+    /// The protected segment.  Its entries are only evicted once
+    /// evictionQueue is empty, and overflow from its front into evictionQueue.
+    std::list<CacheItem*> protectedQueue;
+    size_t protectedSize{0};
+
+    size_t compressedSize{0};
+    std::unordered_map<Hash, CompressedItem> compressedItems;
+    /// Compressed entries are evicted from the front of the queue.
+    std::list<Hash> compressedEvictionQueue;
+
+    /// Blobs that insert() evicted and will compress once it has released
+    /// the lock.
+    std::vector<BlobPtr> evictedToCompress;
+
     uint64_t hitCount{0};
     uint64_t missCount{0};
     uint64_t evictionCount{0};
     uint64_t dropCount{0};
+    uint64_t compressedHitCount{0};
+    uint64_t demoteCount{0};
+    uint64_t retainCount{0};
   };
 
-  void dropInterestHandle(const Hash& hash, uint64_t generation) noexcept;
+  void dropInterestHandle(
+      const Hash& hash,
+      uint64_t generation,
+      BlobInterestHandle::Usage usage) noexcept;
+
+  explicit BlobCache(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount,
+      size_t shardCount,
+      size_t maximumCompressedSizeBytes,
+      size_t maximumProtectedSizeBytes);
+
+  folly::Synchronized<State>& getShard(const Hash& hash) noexcept {
+    return shards_[std::hash<Hash>{}(hash) % shards_.size()];
+  }
+  const folly::Synchronized<State>& getShard(const Hash& hash) const noexcept {
+    return shards_[std::hash<Hash>{}(hash) % shards_.size()];
+  }
+
+  /**
+   * Move item to the back of its queue, or, if promote is true and the cache
+   * is segmented, to the back of the protected segment.
+   */
+  void touchItem(State& state, CacheItem* item, bool promote) noexcept;
+
+  /**
+   * Remove item from whichever queue holds it.
+   */
+  void unlinkItem(State& state, CacheItem* item) noexcept;
+
+  /**
+   * Move item to the front of the probationary segment, to be evicted next.
+   */
+  void demoteItem(State& state, CacheItem* item) noexcept;
 
-  explicit BlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount);
   void evictUntilFits(State& state) noexcept;
   void evictOne(State& state) noexcept;
   void evictItem(State&, CacheItem* item) noexcept;
 
-  const size_t maximumCacheSizeBytes_;
+  /**
+   * Compress blobs evicted from shard and add them to its compressed tier.
+   */
+  void compressEvicted(
+      folly::Synchronized<State>& shard,
+      std::vector<BlobPtr> blobs) noexcept;
+  void evictCompressedUntilFits(State& state) noexcept;
+
+  /**
+   * Move a blob from the compressed tier back into the cache.
+   */
+  GetResult insertDecompressed(
+      const Hash& hash,
+      const CompressedItem& compressed,
+      Interest interest);
+
+  // These limits apply to each shard.
+  std::atomic<size_t> maximumCacheSizeBytes_;
   const size_t minimumEntryCount_;
-  folly::Synchronized<State> state_;
+  const size_t maximumCompressedSizeBytes_;
+  const size_t maximumProtectedSizeBytes_;
+  std::atomic<bool> retainReleasedBlobs_{false};
+
+  // Sized at construction and never resized, so shards are never moved.
+  std::vector<folly::Synchronized<State>> shards_;
 
   friend class BlobInterestHandle;
 };
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobChunks.h"
+
+#include <folly/lang/Bits.h>
+
+namespace facebook {
+namespace eden {
+
+std::string blobChunkKey(const Hash& key, uint64_t index) {
+  auto bytes = key.getBytes();
+  std::string chunkKey{reinterpret_cast<const char*>(bytes.data()),
+                       bytes.size()};
+  auto bigEndianIndex = folly::Endian::big(static_cast<uint32_t>(index));
+  chunkKey.append(
+      reinterpret_cast<const char*>(&bigEndianIndex), sizeof(bigEndianIndex));
+  return chunkKey;
+}
+
+Hash blobChunkId(const Hash& id, uint64_t index) {
+  return Hash::sha1(folly::StringPiece{blobChunkKey(id, index)});
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+/*
+ * Large blobs can be stored in the LocalStore as a series of fixed-size
+ * chunks, so that reading part of a file only needs to load the chunks that
+ * cover it rather than the entire blob.  Each chunk is also cached
+ * separately in the BlobCache.
+ */
+
+/** The size of every chunk of a chunked blob except the last one. */
+constexpr uint64_t kBlobChunkSize = 1024 * 1024;
+
+/** Blobs smaller than this are never split into chunks. */
+constexpr uint64_t kMinChunkedBlobSize = 8 * kBlobChunkSize;
+
+/**
+ * The LocalStore key of chunk `index` of the blob whose contents are stored
+ * under `key`.  Chunk keys are longer than the keys of whole blobs, so the
+ * two never collide.
+ */
+std::string blobChunkKey(const Hash& key, uint64_t index);
+
+/**
+ * The ID under which chunk `index` of blob `id` is cached in the BlobCache.
+ */
+Hash blobChunkId(const Hash& id, uint64_t index);
+
+} // namespace eden
+} // namespace facebook
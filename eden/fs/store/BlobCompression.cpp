@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobCompression.h"
+
+#include <folly/compression/Compression.h>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/**
+ * Favor speed over ratio: blobs are compressed on the import and cache
+ * eviction paths.
+ */
+constexpr int kCompressionLevel = 1;
+
+std::unique_ptr<folly::io::Codec> getBlobCodec() {
+  // Codecs are not thread-safe, so each caller gets its own.
+  return folly::io::getCodec(folly::io::CodecType::ZSTD, kCompressionLevel);
+}
+} // namespace
+
+std::unique_ptr<folly::IOBuf> compressBlobContents(
+    const folly::IOBuf& contents) {
+  auto size = contents.computeChainDataLength();
+  if (size < kMinCompressibleBlobSize) {
+    return nullptr;
+  }
+  auto compressed = getBlobCodec()->compress(&contents);
+  // Require a saving of at least 1/8th to make decompressing worthwhile.
+  if (compressed->computeChainDataLength() > size - size / 8) {
+    return nullptr;
+  }
+  return compressed;
+}
+
+folly::IOBuf decompressBlobContents(
+    const folly::IOBuf& compressed,
+    uint64_t size) {
+  auto contents = getBlobCodec()->uncompress(&compressed, size);
+  return std::move(*contents);
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/io/IOBuf.h>
+#include <memory>
+
+namespace facebook {
+namespace eden {
+
+/*
+ * Compression of blob contents, shared by the LocalStore and the BlobCache.
+ *
+ * Blobs are compressed with zstd.  Small blobs and blobs that do not compress
+ * well are not worth the CPU time it takes to decompress them on every read,
+ * so they are left uncompressed.
+ */
+
+/** Blobs smaller than this are never compressed. */
+constexpr size_t kMinCompressibleBlobSize = 1024;
+
+/**
+ * Returns the compressed contents, or nullptr if compressing them would not
+ * save enough space to be worthwhile.
+ */
+std::unique_ptr<folly::IOBuf> compressBlobContents(
+    const folly::IOBuf& contents);
+
+/**
+ * Decompress contents that were size bytes long before compressBlobContents()
+ * compressed them.
+ *
+ * Throws if compressed is corrupt.
+ */
+folly::IOBuf decompressBlobContents(
+    const folly::IOBuf& compressed,
+    uint64_t size);
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobMetadataCache.h"
+
+#include <algorithm>
+
+namespace facebook {
+namespace eden {
+
+BlobMetadataCache::BlobMetadataCache(size_t maxBytes, bool compact) {
+  auto shardBytes = maxBytes / kNumShards;
+  for (auto& shard : shards_) {
+    auto locked = shard.lock();
+    if (compact) {
+      locked->table = std::make_unique<CompactTable>(
+          std::max<size_t>(1, shardBytes / sizeof(Bucket)));
+    } else {
+      locked->map.emplace(std::max<size_t>(1, shardBytes / kMapEntryBytes));
+    }
+  }
+}
+
+BlobMetadataCache::~BlobMetadataCache() {}
+
+std::optional<BlobMetadata> BlobMetadataCache::get(const Hash& id) {
+  auto shard = shardFor(id).lock();
+  if (shard->table) {
+    return shard->table->get(id);
+  }
+  // A hit moves the entry to the front of the LRU list.
+  auto it = shard->map->find(id);
+  if (it == shard->map->end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void BlobMetadataCache::set(const Hash& id, const BlobMetadata& metadata) {
+  auto shard = shardFor(id).lock();
+  if (shard->table) {
+    shard->table->set(id, metadata);
+  } else {
+    shard->map->set(id, metadata);
+  }
+}
+
+size_t BlobMetadataCache::getMemoryUsage() const {
+  size_t total = 0;
+  for (const auto& shard : shards_) {
+    auto locked = shard.lock();
+    total += locked->table ? locked->table->getMemoryUsage()
+                           : locked->map->size() * kMapEntryBytes;
+  }
+  return total;
+}
+
+folly::Synchronized<BlobMetadataCache::Shard, std::mutex>&
+BlobMetadataCache::shardFor(const Hash& id) {
+  // Blob IDs are uniformly distributed.  The bucket within the shard is
+  // chosen from the first bytes, so use the last one here.
+  return shards_[id.getBytes()[Hash::RAW_SIZE - 1] % kNumShards];
+}
+
+BlobMetadataCache::CompactTable::CompactTable(size_t numBuckets)
+    : buckets_(numBuckets) {}
+
+BlobMetadataCache::Bucket& BlobMetadataCache::CompactTable::bucketFor(
+    const Hash& id) {
+  return buckets_[id.getHashCode() % buckets_.size()];
+}
+
+std::optional<BlobMetadata> BlobMetadataCache::CompactTable::get(
+    const Hash& id) {
+  auto& bucket = bucketFor(id);
+  auto begin = bucket.entries.begin();
+  auto end = begin + bucket.used;
+  auto it = std::find_if(
+      begin, end, [&](const CompactEntry& entry) { return entry.id == id; });
+  if (it == end) {
+    return std::nullopt;
+  }
+  std::rotate(begin, it, it + 1);
+  return BlobMetadata{begin->sha1, begin->size};
+}
+
+void BlobMetadataCache::CompactTable::set(
+    const Hash& id,
+    const BlobMetadata& metadata) {
+  auto& bucket = bucketFor(id);
+  auto begin = bucket.entries.begin();
+  auto end = begin + bucket.used;
+  auto it = std::find_if(
+      begin, end, [&](const CompactEntry& entry) { return entry.id == id; });
+  if (it == end) {
+    if (bucket.used < kWays) {
+      ++bucket.used;
+    } else {
+      // Evict the least recently used entry.
+      --it;
+    }
+  }
+  *it = CompactEntry{id, metadata.sha1, metadata.size};
+  std::rotate(begin, it, it + 1);
+}
+
+} // namespace eden
+} // namespace facebook
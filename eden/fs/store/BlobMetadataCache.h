@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/store/BlobMetadata.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A bounded in-memory cache of the sizes and SHA-1s of blobs, by blob ID.
+ *
+ * Every stat() of an unloaded file looks up its blob here, so the cache is
+ * split into kNumShards shards by ID, each with its own lock, and each
+ * evicting its own least recently used entries.
+ *
+ * By default each shard is an EvictingCacheMap, which only allocates memory
+ * for the entries it holds.  The compact table instead allocates its whole
+ * budget up front as a set-associative array: each ID maps to a bucket of
+ * kWays entries kept in recency order.  Entries then have no per-node
+ * allocations or pointers, and take about half the memory.
+ *
+ * BlobMetadataCache is thread-safe.
+ */
+class BlobMetadataCache {
+ public:
+  static constexpr size_t kNumShards = 16;
+  static constexpr size_t kWays = 8;
+
+  /**
+   * The approximate memory used by an EvictingCacheMap entry: the node on
+   * the LRU list, plus its slot in the index.
+   */
+  static constexpr size_t kMapEntryBytes =
+      sizeof(Hash) + sizeof(BlobMetadata) + 4 * sizeof(void*);
+
+  /** maxBytes bounds the approximate memory used by the entries. */
+  BlobMetadataCache(size_t maxBytes, bool compact);
+  ~BlobMetadataCache();
+
+  BlobMetadataCache(const BlobMetadataCache&) = delete;
+  BlobMetadataCache& operator=(const BlobMetadataCache&) = delete;
+
+  std::optional<BlobMetadata> get(const Hash& id);
+  void set(const Hash& id, const BlobMetadata& metadata);
+
+  /** The approximate memory used by the cache's entries. */
+  size_t getMemoryUsage() const;
+
+ private:
+  struct CompactEntry {
+    Hash id;
+    Hash sha1;
+    uint64_t size;
+  };
+
+  struct Bucket {
+    /** The first `used` entries, most recently used first. */
+    std::array<CompactEntry, kWays> entries;
+    uint8_t used{0};
+  };
+
+  class CompactTable {
+   public:
+    explicit CompactTable(size_t numBuckets);
+
+    std::optional<BlobMetadata> get(const Hash& id);
+    void set(const Hash& id, const BlobMetadata& metadata);
+
+    size_t getMemoryUsage() const {
+      return buckets_.size() * sizeof(Bucket);
+    }
+
+   private:
+    Bucket& bucketFor(const Hash& id);
+
+    std::vector<Bucket> buckets_;
+  };
+
+  struct Shard {
+    /** Set unless the compact table is used. */
+    std::optional<folly::EvictingCacheMap<Hash, BlobMetadata>> map;
+    std::unique_ptr<CompactTable> table;
+  };
+
+  folly::Synchronized<Shard, std::mutex>& shardFor(const Hash& id);
+
+  std::array<folly::Synchronized<Shard, std::mutex>, kNumShards> shards_;
+};
+
+} // namespace eden
+} // namespace facebook
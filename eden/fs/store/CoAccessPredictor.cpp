@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/CoAccessPredictor.h"
+
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include <limits>
+
+#include "eden/fs/store/KeySpace.h"
+#include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/StoreResult.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr size_t kTriggerHeaderSize = Hash::RAW_SIZE + 1;
+constexpr size_t kSuccessorSize = Hash::RAW_SIZE + 1;
+} // namespace
+
+CoAccessPredictor::CoAccessPredictor(
+    std::shared_ptr<LocalStore> localStore,
+    std::string scope,
+    size_t maxTriggers)
+    : localStore_{std::move(localStore)},
+      scope_{std::move(scope)},
+      state_{folly::in_place, maxTriggers} {}
+
+void CoAccessPredictor::load() {
+  std::vector<Trigger> saved;
+  try {
+    auto result = localStore_->get(
+        KeySpace::FetchProfileFamily, folly::StringPiece{sketchKey()});
+    if (!result.isValid()) {
+      return;
+    }
+    saved = deserialize(result.bytes());
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "failed to load co-access sketch for " << scope_ << ": "
+               << ex.what();
+    return;
+  }
+
+  // Insert the oldest first so that the most recent end up in front.
+  auto state = state_.wlock();
+  for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+    state->triggers.set(it->id, std::move(it->successors));
+  }
+  XLOG(DBG3) << "loaded co-access sketch for " << scope_ << " with "
+             << saved.size() << " blobs";
+}
+
+CoAccessPredictor::AccessResult CoAccessPredictor::recordAccess(
+    pid_t pid,
+    const Hash& id) {
+  AccessResult result;
+  std::optional<std::string> toSave;
+  {
+    auto state = state_.wlock();
+    if (state->predicted.erase(id)) {
+      result.wasPredicted = true;
+      ++state->stats.hits;
+    }
+
+    auto recentIter = state->recentReads.find(pid);
+    if (recentIter == state->recentReads.end()) {
+      state->recentReads.set(pid, std::vector<Hash>{});
+      recentIter = state->recentReads.find(pid);
+    }
+    auto& recent = recentIter->second;
+    if (!recent.empty() && recent.back() == id) {
+      // Reading the same blob again teaches nothing.
+      return result;
+    }
+
+    for (const auto& trigger : recent) {
+      if (trigger == id) {
+        continue;
+      }
+      auto triggerIter = state->triggers.find(trigger);
+      if (triggerIter == state->triggers.end()) {
+        state->triggers.set(trigger, std::vector<Successor>{{id, 1}});
+      } else {
+        addSuccessor(triggerIter->second, id);
+      }
+    }
+    recent.erase(std::remove(recent.begin(), recent.end(), id), recent.end());
+    if (recent.size() >= kWindowSize) {
+      recent.erase(recent.begin());
+    }
+    recent.push_back(id);
+
+    auto triggerIter = state->triggers.find(id);
+    if (triggerIter != state->triggers.end()) {
+      for (const auto& successor : triggerIter->second) {
+        if (successor.count < kMinCount) {
+          break;
+        }
+        if (state->predicted.exists(successor.id) ||
+            std::find(recent.begin(), recent.end(), successor.id) !=
+                recent.end()) {
+          continue;
+        }
+        state->predicted.set(successor.id, folly::unit);
+        result.toPrefetch.push_back(successor.id);
+      }
+      state->stats.predictions += result.toPrefetch.size();
+    }
+
+    if (++state->unsavedReads >= kSaveInterval) {
+      state->unsavedReads = 0;
+      toSave = serialize(snapshot(*state));
+    }
+  }
+
+  if (toSave) {
+    save(*toSave);
+  }
+  return result;
+}
+
+CoAccessPredictor::Stats CoAccessPredictor::getStats() const {
+  return state_.rlock()->stats;
+}
+
+void CoAccessPredictor::addSuccessor(
+    std::vector<Successor>& successors,
+    const Hash& id) {
+  auto it = std::find_if(
+      successors.begin(), successors.end(), [&](const Successor& successor) {
+        return successor.id == id;
+      });
+  if (it == successors.end()) {
+    if (successors.size() < kMaxSuccessors) {
+      successors.push_back(Successor{id, 1});
+      return;
+    }
+    // As in a Misra-Gries summary, a new successor wears down the weakest
+    // one, and only takes its place once that has no count left.  Occasional
+    // reads cannot displace a successor that reliably follows.
+    auto& weakest = successors.back();
+    if (--weakest.count == 0) {
+      weakest = Successor{id, 1};
+    }
+    return;
+  }
+
+  if (it->count == std::numeric_limits<uint8_t>::max()) {
+    // Halve every count so that the sketch keeps adapting to new patterns.
+    for (auto& successor : successors) {
+      successor.count = std::max<uint8_t>(1, successor.count / 2);
+    }
+  }
+  ++it->count;
+  for (; it != successors.begin() && std::prev(it)->count < it->count; --it) {
+    std::iter_swap(it, std::prev(it));
+  }
+}
+
+std::vector<CoAccessPredictor::Trigger> CoAccessPredictor::snapshot(
+    const State& state) {
+  std::vector<Trigger> result;
+  result.reserve(state.triggers.size());
+  for (const auto& [id, successors] : state.triggers) {
+    result.push_back(Trigger{id, successors});
+  }
+  return result;
+}
+
+std::string CoAccessPredictor::serialize(const std::vector<Trigger>& triggers) {
+  std::string bytes;
+  bytes.reserve(
+      triggers.size() * (kTriggerHeaderSize + kMaxSuccessors * kSuccessorSize));
+  auto appendHash = [&](const Hash& hash) {
+    auto hashBytes = hash.getBytes();
+    bytes.append(
+        reinterpret_cast<const char*>(hashBytes.data()), hashBytes.size());
+  };
+  for (const auto& trigger : triggers) {
+    appendHash(trigger.id);
+    bytes.push_back(static_cast<char>(trigger.successors.size()));
+    for (const auto& successor : trigger.successors) {
+      appendHash(successor.id);
+      bytes.push_back(static_cast<char>(successor.count));
+    }
+  }
+  return bytes;
+}
+
+std::vector<CoAccessPredictor::Trigger> CoAccessPredictor::deserialize(
+    folly::ByteRange bytes) {
+  std::vector<Trigger> triggers;
+  while (bytes.size() >= kTriggerHeaderSize) {
+    Trigger trigger{Hash{bytes.subpiece(0, Hash::RAW_SIZE)}, {}};
+    size_t count = bytes[Hash::RAW_SIZE];
+    bytes.advance(kTriggerHeaderSize);
+    if (count > kMaxSuccessors || bytes.size() < count * kSuccessorSize) {
+      break;
+    }
+    for (size_t i = 0; i < count; ++i, bytes.advance(kSuccessorSize)) {
+      uint8_t successorCount = bytes[Hash::RAW_SIZE];
+      if (successorCount > 0) {
+        trigger.successors.push_back(Successor{
+            Hash{bytes.subpiece(0, Hash::RAW_SIZE)}, successorCount});
+      }
+    }
+    triggers.push_back(std::move(trigger));
+  }
+  return triggers;
+}
+
+std::string CoAccessPredictor::sketchKey() const {
+  // ProcessFetchProfiles saves its profiles under the scope, a NUL byte and
+  // a tool name.  Tool names never contain a NUL byte, so this cannot
+  // collide with them.
+  std::string key{scope_};
+  key.append("\0\0co-access", 11);
+  return key;
+}
+
+void CoAccessPredictor::save(const std::string& bytes) const {
+  try {
+    localStore_->put(
+        KeySpace::FetchProfileFamily,
+        folly::StringPiece{sketchKey()},
+        folly::StringPiece{bytes});
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "failed to save co-access sketch: " << ex.what();
+  }
+}
+
+} // namespace eden
+} // namespace facebook
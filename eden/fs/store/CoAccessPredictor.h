@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/Unit.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+class LocalStore;
+
+/**
+ * Learns which blobs are read together, so that reading one can start
+ * fetching the others before they are asked for.
+ *
+ * Each time a process reads a blob, the blob is counted as a successor of
+ * the last few blobs the same process read.  Build tools read the same
+ * files in much the same order on every run, so a blob's most frequent
+ * successors are good predictions of what will be read after it, even
+ * when they are in unrelated directories.
+ *
+ * The sketch keeps at most kMaxSuccessors successors for each of the
+ * maxTriggers blobs read most recently, with small saturating counts, and
+ * is saved to the LocalStore as it changes so that it survives restarts.
+ * Blobs are identified by their content hashes, so what was learned at one
+ * commit stays mostly valid at nearby commits.
+ *
+ * CoAccessPredictor is thread-safe.
+ */
+class CoAccessPredictor {
+ public:
+  /** The number of successors remembered for each blob. */
+  static constexpr size_t kMaxSuccessors = 4;
+
+  /** The number of blobs a process read before this one that it follows. */
+  static constexpr size_t kWindowSize = 4;
+
+  /**
+   * A successor is only predicted once it has followed its trigger this
+   * many times, so that one-off sequences are not prefetched.
+   */
+  static constexpr uint8_t kMinCount = 2;
+
+  /** The sketch is saved each time this many more reads are recorded. */
+  static constexpr size_t kSaveInterval = 4096;
+
+  struct Successor {
+    Hash id;
+    uint8_t count;
+
+    bool operator==(const Successor& other) const {
+      return id == other.id && count == other.count;
+    }
+  };
+
+  struct Trigger {
+    Hash id;
+    /** Most frequent first. */
+    std::vector<Successor> successors;
+
+    bool operator==(const Trigger& other) const {
+      return id == other.id && successors == other.successors;
+    }
+  };
+
+  struct AccessResult {
+    /** The predicted blobs to prefetch. */
+    std::vector<Hash> toPrefetch;
+    /** Whether the blob read was one predicted by an earlier read. */
+    bool wasPredicted{false};
+  };
+
+  struct Stats {
+    /** The number of blobs predicted and returned for prefetching. */
+    uint64_t predictions{0};
+    /** The number of those that were read afterwards. */
+    uint64_t hits{0};
+  };
+
+  /**
+   * scope distinguishes the sketches of different mounts sharing a
+   * LocalStore.  The sketch remembers the successors of at most maxTriggers
+   * blobs.
+   */
+  CoAccessPredictor(
+      std::shared_ptr<LocalStore> localStore,
+      std::string scope,
+      size_t maxTriggers);
+
+  CoAccessPredictor(const CoAccessPredictor&) = delete;
+  CoAccessPredictor& operator=(const CoAccessPredictor&) = delete;
+
+  /**
+   * Loads the sketch saved for this scope, if any.  This should be called
+   * once, before any reads are recorded.
+   */
+  void load();
+
+  /**
+   * Records that pid read the given blob, and returns the blobs predicted
+   * to be read next that have not already been predicted recently.
+   */
+  AccessResult recordAccess(pid_t pid, const Hash& id);
+
+  Stats getStats() const;
+
+  /**
+   * Encodes triggers as the 20 hash bytes, a successor count byte, and the
+   * 20 hash bytes and count byte of each successor, for each trigger.
+   */
+  static std::string serialize(const std::vector<Trigger>& triggers);
+
+  /**
+   * Decodes the output of serialize().  A truncated trigger at the end is
+   * dropped.
+   */
+  static std::vector<Trigger> deserialize(folly::ByteRange bytes);
+
+ private:
+  struct State {
+    explicit State(size_t maxTriggers)
+        : triggers{maxTriggers},
+          recentReads{kMaxProcesses},
+          predicted{maxTriggers} {}
+
+    folly::EvictingCacheMap<Hash, std::vector<Successor>> triggers;
+    /** The last kWindowSize blobs each recently seen process read. */
+    folly::EvictingCacheMap<pid_t, std::vector<Hash>> recentReads;
+    /** The predictions that have not been read yet. */
+    folly::EvictingCacheMap<Hash, folly::Unit> predicted;
+    size_t unsavedReads{0};
+    Stats stats;
+  };
+
+  /** The number of processes whose recent reads are remembered. */
+  static constexpr size_t kMaxProcesses = 1024;
+
+  /** Counts id as a successor, evicting the weakest one if full. */
+  static void addSuccessor(std::vector<Successor>& successors, const Hash& id);
+
+  /** Most recently read trigger first. */
+  static std::vector<Trigger> snapshot(const State& state);
+
+  std::string sketchKey() const;
+  void save(const std::string& bytes) const;
+
+  const std::shared_ptr<LocalStore> localStore_;
+  const std::string scope_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -137,16 +137,23 @@ FOLLY_NODISCARD Future<Unit> computeTreeDiff(
           ignore.get(),
           isIgnored);
       ++wdIdx;
+      continue;
     } else if (wdIdx >= wdEntries.size()) {
       // This entry is present in scmTree but not wdTree
       processRemovedSide(
           context, childFutures, currentPath, scmEntries[scmIdx]);
       ++scmIdx;
-    } else if (scmEntries[scmIdx].getName() < wdEntries[wdIdx].getName()) {
+      continue;
+    }
+
+    // Compare the names once, rather than once for each ordering.
+    auto order = scmEntries[scmIdx].getName().stringPiece().compare(
+        wdEntries[wdIdx].getName().stringPiece());
+    if (order < 0) {
       processRemovedSide(
           context, childFutures, currentPath, scmEntries[scmIdx]);
       ++scmIdx;
-    } else if (scmEntries[scmIdx].getName() > wdEntries[wdIdx].getName()) {
+    } else if (order > 0) {
       processAddedSide(
           context,
           childFutures,
@@ -403,11 +410,14 @@ void processRemovedSide(
     ChildFutures& childFutures,
     RelativePathPiece currentPath,
     const TreeEntry& scmEntry) {
+  auto entryPath = currentPath + scmEntry.getName();
+  if (context->isHidden(entryPath)) {
+    return;
+  }
   if (!scmEntry.isTree()) {
-    context->callback->removedFile(currentPath + scmEntry.getName());
+    context->callback->removedFile(entryPath);
     return;
   }
-  auto entryPath = currentPath + scmEntry.getName();
   auto childFuture = diffRemovedTree(context, entryPath, scmEntry.getHash());
   childFutures.add(std::move(entryPath), std::move(childFuture));
 }
@@ -428,6 +438,9 @@ void processAddedSide(
     bool isIgnored) {
   bool entryIgnored = isIgnored;
   auto entryPath = currentPath + wdEntry.getName();
+  if (context->isHidden(entryPath)) {
+    return;
+  }
   if (!isIgnored && ignore) {
     auto fileType =
         wdEntry.isTree() ? GitIgnore::TYPE_DIR : GitIgnore::TYPE_FILE;
@@ -469,8 +482,19 @@ void processBothPresent(
     const TreeEntry& wdEntry,
     const GitIgnoreStack* ignore,
     bool isIgnored) {
+  // Identical entries cannot have any differences, whether they are trees or
+  // files.  Most entries of the trees being compared are usually unchanged,
+  // so check this before building the entry's path.
+  if (scmEntry.getHash() == wdEntry.getHash() &&
+      scmEntry.getType() == wdEntry.getType()) {
+    return;
+  }
+
   bool entryIgnored = isIgnored;
   auto entryPath = currentPath + scmEntry.getName();
+  if (context->isHidden(entryPath)) {
+    return;
+  }
   // If wdEntry and scmEntry are both files (or symlinks) then we don't need
   // to bother computing the ignore status: the file is explicitly tracked in
   // source control, so we should report it's status even if it would normally
@@ -498,9 +522,6 @@ void processBothPresent(
     if (isTreeWD) {
       // tree-to-tree diff
       DCHECK_EQ(scmEntry.getType(), wdEntry.getType());
-      if (scmEntry.getHash() == wdEntry.getHash()) {
-        return;
-      }
       auto childFuture = diffTrees(
           context,
           entryPath,
@@ -554,10 +575,8 @@ void processBothPresent(
                                    entryPath = currentPath + scmEntry.getName(),
                                    &scmEntry,
                                    &wdEntry] {
-              auto scmFuture = context->store->getBlobSha1(
-                  scmEntry.getHash(), context->getFetchContext());
-              auto wdFuture = context->store->getBlobSha1(
-                  wdEntry.getHash(), context->getFetchContext());
+              auto scmFuture = context->getBlobSha1(scmEntry.getHash());
+              auto wdFuture = context->getBlobSha1(wdEntry.getHash());
               return collectSafe(scmFuture, wdFuture)
                   .thenValue([entryPath = entryPath.copy(),
                               context](const std::tuple<Hash, Hash>& info) {
@@ -648,10 +667,8 @@ FOLLY_NODISCARD Future<Unit> diffTrees(
     Hash wdHash,
     const GitIgnoreStack* ignore,
     bool isIgnored) {
-  auto scmTreeFuture =
-      context->store->getTree(scmHash, context->getFetchContext());
-  auto wdTreeFuture =
-      context->store->getTree(wdHash, context->getFetchContext());
+  auto scmTreeFuture = context->getTree(scmHash);
+  auto wdTreeFuture = context->getTree(wdHash);
   // Optimization for the case when both tree objects are immediately ready.
   // We can avoid copying the input path in this case.
   if (scmTreeFuture.isReady() && wdTreeFuture.isReady()) {
@@ -681,7 +698,7 @@ FOLLY_NODISCARD Future<Unit> diffAddedTree(
     Hash wdHash,
     const GitIgnoreStack* ignore,
     bool isIgnored) {
-  auto wdFuture = context->store->getTree(wdHash, context->getFetchContext());
+  auto wdFuture = context->getTree(wdHash);
   // Optimization for the case when the tree object is immediately ready.
   // We can avoid copying the input path in this case.
   if (wdFuture.isReady()) {
@@ -700,7 +717,7 @@ FOLLY_NODISCARD Future<Unit> diffRemovedTree(
     DiffContext* context,
     RelativePathPiece currentPath,
     Hash scmHash) {
-  auto scmFuture = context->store->getTree(scmHash, context->getFetchContext());
+  auto scmFuture = context->getTree(scmHash);
   // Optimization for the case when the tree object is immediately ready.
   // We can avoid copying the input path in this case.
   if (scmFuture.isReady()) {
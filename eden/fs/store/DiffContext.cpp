@@ -9,9 +9,10 @@
 
 #include <thrift/lib/cpp2/async/ResponseChannel.h>
 
+#include "eden/fs/model/CheckoutFilter.h"
 #include "eden/fs/model/git/GitIgnoreStack.h"
 #include "eden/fs/model/git/TopLevelIgnores.h"
-#include "eden/fs/store/IObjectStore.h"
+#include "eden/fs/store/ObjectStore.h"
 
 using apache::thrift::ResponseChannelRequest;
 
@@ -24,13 +25,15 @@ DiffContext::DiffContext(
     const ObjectStore* os,
     std::unique_ptr<TopLevelIgnores> topLevelIgnores,
     LoadFileFunction loadFileContentsFromPath,
-    ResponseChannelRequest* request)
+    ResponseChannelRequest* request,
+    size_t maxPendingFetches)
     : callback{cb},
       store{os},
       listIgnored{listIgnored},
       topLevelIgnores_(std::move(topLevelIgnores)),
       loadFileContentsFromPath_{loadFileContentsFromPath},
-      request_{request} {}
+      request_{request},
+      fetchThrottle_{maxPendingFetches} {}
 
 DiffContext::DiffContext(DiffCallback* cb, const ObjectStore* os)
     : callback{cb},
@@ -38,7 +41,8 @@ DiffContext::DiffContext(DiffCallback* cb, const ObjectStore* os)
       listIgnored{true},
       topLevelIgnores_{std::unique_ptr<TopLevelIgnores>()},
       loadFileContentsFromPath_{nullptr},
-      request_{nullptr} {};
+      request_{nullptr},
+      fetchThrottle_{0} {};
 
 DiffContext::~DiffContext() = default;
 
@@ -59,5 +63,49 @@ bool DiffContext::isCancelled() const {
   return false;
 }
 
+folly::Future<std::shared_ptr<const Tree>> DiffContext::getTree(
+    const Hash& hash) {
+  return fetchThrottle_.run<std::shared_ptr<const Tree>>(
+      /*isTree=*/true,
+      [this, hash] { return store->getTree(hash, fetchContext_); });
+}
+
+folly::Future<Hash> DiffContext::getBlobSha1(const Hash& hash) {
+  return fetchThrottle_.run<Hash>(/*isTree=*/false, [this, hash] {
+    return store->getBlobSha1(hash, fetchContext_);
+  });
+}
+
+void DiffContext::setScope(std::vector<RelativePath> paths) {
+  hasScope_ = true;
+  for (auto& path : paths) {
+    RelativePathPiece piece{*scopePaths_.insert(std::move(path)).first};
+    scope_.insert(piece);
+    for (auto parent : piece.dirname().paths()) {
+      scopeParents_.insert(parent);
+    }
+  }
+}
+
+bool DiffContext::isWithinScope(RelativePathPiece path) const {
+  if (!hasScope_) {
+    return true;
+  }
+  for (auto parent : path.paths()) {
+    if (scope_.count(parent)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DiffContext::shouldExamine(RelativePathPiece path) const {
+  return scopeParents_.count(path) || isWithinScope(path);
+}
+
+bool DiffContext::isHidden(RelativePathPiece path) const {
+  return filter_ && filter_->isHidden(path);
+}
+
 } // namespace eden
 } // namespace facebook
@@ -7,9 +7,14 @@
 
 #pragma once
 
+#include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/futures/Future.h>
+#include <unordered_set>
+#include <vector>
 
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/store/FetchThrottle.h"
 #include "eden/fs/store/StatsFetchContext.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -27,6 +32,7 @@ class ResponseChannelRequest;
 namespace facebook {
 namespace eden {
 
+class CheckoutFilter;
 class DiffCallback;
 class GitIgnoreStack;
 class ObjectFetchContext;
@@ -34,6 +40,7 @@ class ObjectStore;
 class UserInfo;
 class TopLevelIgnores;
 class EdenMount;
+class Tree;
 
 /**
  * A helper class to store parameters for a TreeInode::diff() operation.
@@ -43,6 +50,11 @@ class EdenMount;
  *
  * The DiffContext must be alive for the duration of the async operation it is
  * used in.
+ *
+ * The diff fetches source control objects through getTree() and
+ * getBlobSha1(), which bound the number of fetches in flight so that a status
+ * call over a huge dirty checkout does not queue up an unbounded number of
+ * imports.
  */
 class DiffContext {
  public:
@@ -55,7 +67,8 @@ class DiffContext {
       const ObjectStore* os,
       std::unique_ptr<TopLevelIgnores> topLevelIgnores,
       LoadFileFunction loadFileContentsFromPath,
-      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request = nullptr);
+      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request = nullptr,
+      size_t maxPendingFetches = 0);
   DiffContext(DiffCallback* cb, const ObjectStore* os);
 
   DiffContext(const DiffContext&) = delete;
@@ -81,11 +94,69 @@ class DiffContext {
     return fetchContext_;
   }
 
+  /**
+   * Fetch a tree, or the SHA-1 of a blob's contents, from the store.
+   *
+   * At most maxPendingFetches fetches are in flight at once; see
+   * FetchThrottle.
+   */
+  folly::Future<std::shared_ptr<const Tree>> getTree(const Hash& hash);
+  folly::Future<Hash> getBlobSha1(const Hash& hash);
+
+  /**
+   * Restrict the diff to the given paths and everything inside them.
+   *
+   * The diff then skips any entry that is not one of these paths, inside one
+   * of them, or a directory containing one of them. Differences outside of
+   * the scope may still be reported, for instance when a whole source control
+   * tree is found to be removed, so callers should use isWithinScope() to
+   * filter the results.
+   */
+  void setScope(std::vector<RelativePath> paths);
+
+  bool hasScope() const {
+    return hasScope_;
+  }
+
+  /**
+   * Returns true if the entry at path is within the scope set by setScope(),
+   * or if no scope was set.
+   */
+  bool isWithinScope(RelativePathPiece path) const;
+
+  /**
+   * Returns true if the diff needs to examine the entry at path: either it is
+   * within the scope, or it is a directory containing part of the scope.
+   */
+  bool shouldExamine(RelativePathPiece path) const;
+
+  /**
+   * Make the diff treat source control entries hidden by the checkout's
+   * filter as absent.  The filter must outlive the DiffContext.
+   */
+  void setFilter(const CheckoutFilter* filter) {
+    filter_ = filter;
+  }
+
+  /** Returns true if the source control entry at path is filtered out. */
+  bool isHidden(RelativePathPiece path) const;
+
  private:
   std::unique_ptr<TopLevelIgnores> topLevelIgnores_;
   const LoadFileFunction loadFileContentsFromPath_;
   apache::thrift::ResponseChannelRequest* const FOLLY_NULLABLE request_;
   StatsFetchContext fetchContext_;
+
+  FetchThrottle fetchThrottle_;
+
+  bool hasScope_{false};
+  /** The paths passed to setScope(). */
+  std::unordered_set<RelativePath> scopePaths_;
+  /** Pieces of scopePaths_, and of the directories that contain them. */
+  std::unordered_set<RelativePathPiece> scope_;
+  std::unordered_set<RelativePathPiece> scopeParents_;
+
+  const CheckoutFilter* FOLLY_NULLABLE filter_{nullptr};
 };
 } // namespace eden
 } // namespace facebook
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/FetchThrottle.h"
+
+namespace facebook {
+namespace eden {
+
+void FetchThrottle::startQueuedFetches(
+    folly::Synchronized<PendingFetches>::LockedPtr pending) {
+  // Fetches that complete immediately call finishFetch() from inside this
+  // loop, so only one thread starts fetches at a time and the others leave
+  // their work to it. This also keeps the stack from growing with the queue.
+  if (pending->starting) {
+    return;
+  }
+  pending->starting = true;
+  while (pending->inProgress < maxPendingFetches_) {
+    auto& queue = pending->trees.empty() ? pending->blobs : pending->trees;
+    if (queue.empty()) {
+      break;
+    }
+    auto start = std::move(queue.front());
+    queue.pop_front();
+    ++pending->inProgress;
+    pending.unlock();
+    start();
+    pending = pendingFetches_.wlock();
+  }
+  pending->starting = false;
+}
+
+void FetchThrottle::finishFetch() {
+  auto pending = pendingFetches_.wlock();
+  --pending->inProgress;
+  startQueuedFetches(std::move(pending));
+}
+
+} // namespace eden
+} // namespace facebook
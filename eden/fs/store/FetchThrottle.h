@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
+#include <folly/futures/Future.h>
+#include <deque>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Bounds the number of source control object fetches an operation has in
+ * flight.
+ *
+ * Once maxPendingFetches fetches are in flight, further fetches wait in a
+ * queue, with trees ahead of blobs since each tree leads to more work.
+ * Queued fetches are started together as earlier ones complete, which lets
+ * the backing store import them in batches. A maxPendingFetches of 0 does not
+ * bound the fetches.
+ *
+ * A slot is given back as soon as its fetch completes, not when the caller is
+ * done with the result, so callers may issue more fetches from their
+ * callbacks without deadlocking.
+ *
+ * FetchThrottle is thread-safe. It must outlive the fetches it starts.
+ */
+class FetchThrottle {
+ public:
+  explicit FetchThrottle(size_t maxPendingFetches)
+      : maxPendingFetches_{maxPendingFetches} {}
+
+  FetchThrottle(const FetchThrottle&) = delete;
+  FetchThrottle& operator=(const FetchThrottle&) = delete;
+
+  template <typename T>
+  folly::Future<T> run(bool isTree, folly::Function<folly::Future<T>()> fetch);
+
+ private:
+  struct PendingFetches {
+    size_t inProgress{0};
+    /** Whether a thread is currently starting queued fetches. */
+    bool starting{false};
+    std::deque<folly::Function<void()>> trees;
+    std::deque<folly::Function<void()>> blobs;
+  };
+
+  void startQueuedFetches(
+      folly::Synchronized<PendingFetches>::LockedPtr pending);
+  void finishFetch();
+
+  const size_t maxPendingFetches_;
+  folly::Synchronized<PendingFetches> pendingFetches_;
+};
+
+template <typename T>
+folly::Future<T> FetchThrottle::run(
+    bool isTree,
+    folly::Function<folly::Future<T>()> fetch) {
+  if (maxPendingFetches_ == 0) {
+    return fetch();
+  }
+
+  folly::Promise<T> promise;
+  auto future = promise.getFuture();
+  auto start = [this,
+                fetch = std::move(fetch),
+                promise = std::move(promise)]() mutable {
+    folly::makeFutureWith(std::move(fetch))
+        .thenTry([this, promise = std::move(promise)](
+                     folly::Try<T>&& result) mutable {
+          finishFetch();
+          promise.setTry(std::move(result));
+        });
+  };
+
+  auto pending = pendingFetches_.wlock();
+  (isTree ? pending->trees : pending->blobs).emplace_back(std::move(start));
+  startQueuedFetches(std::move(pending));
+  return future;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -46,6 +47,25 @@ class IObjectStore {
   virtual folly::Future<std::shared_ptr<const Blob>> getBlob(
       const Hash& id,
       ObjectFetchContext& context) const = 0;
+  /**
+   * Batch forms of getTree() and getBlob(), returning one future per ID in
+   * the same order.
+   */
+  virtual std::vector<folly::Future<std::shared_ptr<const Tree>>> getTrees(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const = 0;
+  virtual std::vector<folly::Future<std::shared_ptr<const Blob>>> getBlobs(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const = 0;
+  /**
+   * Returns chunk `index` of a large blob whose contents are available in
+   * chunks (see BlobChunks.h), or nullptr if that chunk is not available
+   * without fetching the whole blob.
+   */
+  virtual folly::Future<std::shared_ptr<const Blob>> getBlobChunk(
+      const Hash& id,
+      uint64_t index,
+      ObjectFetchContext& context) const = 0;
   virtual folly::Future<std::shared_ptr<const Tree>> getTreeForCommit(
       const Hash& commitID,
       ObjectFetchContext& context) const = 0;
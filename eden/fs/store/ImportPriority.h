@@ -54,6 +54,17 @@ struct ImportPriority {
     return ImportPriority{kind, offset > delta ? offset - delta : 0};
   }
 
+  /**
+   * Raise ImportPriority by `levels` kinds, saturating at High. The offset is
+   * kept, so requests keep their relative order within a kind.
+   */
+  constexpr ImportPriority getRaised(uint64_t levels) const noexcept {
+    auto raised = static_cast<uint64_t>(kind) + levels;
+    auto high = static_cast<uint64_t>(ImportPriorityKind::High);
+    return ImportPriority{
+        static_cast<ImportPriorityKind>(raised < high ? raised : high), offset};
+  }
+
   friend bool operator<(
       const ImportPriority& lhs,
       const ImportPriority& rhs) noexcept {
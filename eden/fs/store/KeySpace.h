@@ -98,6 +98,12 @@ class KeySpace {
       7,
       "treemeta",
       Ephemeral{&EdenConfig::localStoreTreeMetaSizeLimit}};
+  // The objects each tool fetched from each mount, for prefetching them the
+  // next time the tool runs.
+  static constexpr KeySpaceRecord FetchProfileFamily{
+      8,
+      "fetchprofile",
+      Ephemeral{&EdenConfig::localStoreFetchProfileSizeLimit}};
 
   static constexpr const KeySpaceRecord* kAll[] = {&BlobFamily,
                                                    &BlobMetaDataFamily,
@@ -106,7 +112,8 @@ class KeySpace {
                                                    &HgCommitToTreeFamily,
                                                    &BlobSizeFamily,
                                                    &ScsProxyHashFamily,
-                                                   &TreeMetaDataFamily};
+                                                   &TreeMetaDataFamily,
+                                                   &FetchProfileFamily};
   static constexpr size_t kTotalCount = std::size(kAll);
 
  private:
@@ -20,7 +20,11 @@
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/git/GitBlob.h"
 #include "eden/fs/model/git/GitTree.h"
+#include "eden/fs/store/BlobChunks.h"
+#include "eden/fs/store/BlobCompression.h"
 #include "eden/fs/store/SerializedBlobMetadata.h"
+#include "eden/fs/store/SerializedTree.h"
+#include "eden/fs/store/Sha1Hasher.h"
 #include "eden/fs/store/StoreResult.h"
 #include "eden/fs/store/TreeMetadata.h"
 
@@ -34,6 +38,39 @@ using std::string;
 namespace facebook {
 namespace eden {
 
+namespace {
+/**
+ * Compressed blobs are stored with a header like the git blob header, but
+ * with this prefix followed by the uncompressed size.
+ */
+constexpr StringPiece kCompressedBlobPrefix{"zblob "};
+
+std::unique_ptr<Blob> deserializeCompressedBlob(
+    const Hash& id,
+    const IOBuf& data) {
+  Cursor cursor(&data);
+  cursor.skip(kCompressedBlobPrefix.size());
+  // 25 characters is long enough to represent any legitimate length
+  auto sizeStr = cursor.readTerminatedString('\0', 25);
+  auto size = folly::to<uint64_t>(sizeStr);
+  IOBuf compressed;
+  cursor.clone(compressed, cursor.totalLength());
+  return std::make_unique<Blob>(id, decompressBlobContents(compressed, size));
+}
+
+/**
+ * Blobs stored in chunks are stored with a header like the git blob header,
+ * but with this prefix followed by the blob size and no contents.  The
+ * contents are stored under the keys returned by blobChunkKey().
+ */
+constexpr StringPiece kChunkedBlobPrefix{"chunked "};
+
+uint64_t parseChunkedBlobSize(StringPiece header) {
+  header.advance(kChunkedBlobPrefix.size());
+  return folly::to<uint64_t>(header.subpiece(0, header.find('\0')));
+}
+} // namespace
+
 void LocalStore::clearDeprecatedKeySpaces() {
   for (auto& ks : KeySpace::kAll) {
     if (ks->isDeprecated()) {
@@ -98,24 +135,183 @@ folly::Future<std::vector<StoreResult>> LocalStore::getBatch(
 // LocalStore so a vanilla LocalStore has no knowledge of deserializeGitTree()
 // or deserializeGitBlob().
 
+namespace {
+std::unique_ptr<Tree> parseTree(const Hash& id, const StoreResult& data) {
+  if (!data.isValid()) {
+    return nullptr;
+  }
+  auto bytes = data.bytes();
+  if (SerializedTree::isSerializedTree(bytes)) {
+    return SerializedTree{bytes}.toTree(id);
+  }
+  // Trees stored by earlier versions are git tree objects.
+  return deserializeGitTree(id, bytes);
+}
+} // namespace
+
 folly::Future<std::unique_ptr<Tree>> LocalStore::getTree(const Hash& id) const {
   return getFuture(KeySpace::TreeFamily, id.getBytes())
-      .thenValue([id](StoreResult&& data) {
-        if (!data.isValid()) {
-          return std::unique_ptr<Tree>(nullptr);
+      .thenValue([id](StoreResult&& data) { return parseTree(id, data); });
+}
+
+folly::Future<std::vector<std::unique_ptr<Tree>>> LocalStore::getTreeBatch(
+    const std::vector<Hash>& ids) const {
+  std::vector<ByteRange> keys;
+  keys.reserve(ids.size());
+  for (const auto& id : ids) {
+    keys.push_back(id.getBytes());
+  }
+  return getBatch(KeySpace::TreeFamily, keys)
+      .thenValue([ids](std::vector<StoreResult>&& data) {
+        std::vector<std::unique_ptr<Tree>> trees;
+        trees.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+          trees.push_back(parseTree(ids[i], data[i]));
         }
-        return deserializeGitTree(id, data.bytes());
+        return trees;
       });
 }
 
 folly::Future<std::unique_ptr<Blob>> LocalStore::getBlob(const Hash& id) const {
-  return getFuture(KeySpace::BlobFamily, id.getBytes())
-      .thenValue([id](StoreResult&& data) {
-        if (!data.isValid()) {
-          return std::unique_ptr<Blob>(nullptr);
+  if (!dedupeBlobContents.load(std::memory_order_relaxed)) {
+    return getBlobStoredUnder(id, id);
+  }
+
+  // The metadata maps the blob ID to the SHA-1 of the contents, and the
+  // contents are stored under that SHA-1.  Blobs stored before
+  // deduplication was enabled are still stored under their ID.
+  return getBlobMetadata(id).thenValue(
+      [id, this](optional<BlobMetadata> metadata) {
+        if (!metadata) {
+          return getBlobStoredUnder(id, id);
+        }
+        return getBlobStoredUnder(id, metadata->sha1)
+            .thenValue([id, this](std::unique_ptr<Blob> blob) {
+              if (blob) {
+                return folly::makeFuture(std::move(blob));
+              }
+              return getBlobStoredUnder(id, id);
+            });
+      });
+}
+
+folly::Future<std::unique_ptr<Blob>> LocalStore::getBlobStoredUnder(
+    const Hash& id,
+    const Hash& key) const {
+  return getFuture(KeySpace::BlobFamily, key.getBytes())
+      .thenValue([id, key, this](StoreResult&& data) {
+        return parseBlob(id, key, std::move(data));
+      });
+}
+
+folly::Future<std::unique_ptr<Blob>> LocalStore::parseBlob(
+    const Hash& id,
+    const Hash& key,
+    StoreResult&& data) const {
+  if (!data.isValid()) {
+    return std::unique_ptr<Blob>(nullptr);
+  }
+  if (data.piece().startsWith(kChunkedBlobPrefix)) {
+    return getChunkedBlob(id, key, parseChunkedBlobSize(data.piece()));
+  }
+  if (data.piece().startsWith(kCompressedBlobPrefix)) {
+    return deserializeCompressedBlob(id, data.extractIOBuf());
+  }
+  auto buf = data.extractIOBuf();
+  return deserializeGitBlob(id, &buf);
+}
+
+folly::Future<std::vector<std::unique_ptr<Blob>>> LocalStore::getBlobBatch(
+    const std::vector<Hash>& ids) const {
+  // With deduplication the contents are keyed by the metadata, which takes a
+  // read of its own, so there is no single batch to issue.
+  if (dedupeBlobContents.load(std::memory_order_relaxed)) {
+    std::vector<folly::Future<std::unique_ptr<Blob>>> blobs;
+    blobs.reserve(ids.size());
+    for (const auto& id : ids) {
+      blobs.push_back(getBlob(id));
+    }
+    return folly::collectUnsafe(std::move(blobs));
+  }
+
+  std::vector<ByteRange> keys;
+  keys.reserve(ids.size());
+  for (const auto& id : ids) {
+    keys.push_back(id.getBytes());
+  }
+  return getBatch(KeySpace::BlobFamily, keys)
+      .thenValue([ids, this](std::vector<StoreResult>&& data) {
+        std::vector<folly::Future<std::unique_ptr<Blob>>> blobs;
+        blobs.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+          blobs.push_back(folly::makeFutureWith(
+              [&] { return parseBlob(ids[i], ids[i], std::move(data[i])); }));
+        }
+        return folly::collectUnsafe(std::move(blobs));
+      });
+}
+
+folly::Future<std::unique_ptr<Blob>> LocalStore::getChunkedBlob(
+    const Hash& id,
+    const Hash& key,
+    uint64_t size) const {
+  auto chunkKeys = std::make_shared<std::vector<string>>();
+  std::vector<ByteRange> keys;
+  for (uint64_t index = 0; index * kBlobChunkSize < size; ++index) {
+    chunkKeys->push_back(blobChunkKey(key, index));
+  }
+  for (const auto& chunkKey : *chunkKeys) {
+    keys.emplace_back(StringPiece{chunkKey});
+  }
+
+  return getBatch(KeySpace::BlobFamily, keys)
+      .thenValue([id, size, chunkKeys](std::vector<StoreResult>&& chunks) {
+        std::unique_ptr<IOBuf> contents;
+        for (auto& chunk : chunks) {
+          if (!chunk.isValid()) {
+            // The chunks are written before the header, so this blob was
+            // only partly evicted.  Treat it as missing.
+            return std::unique_ptr<Blob>(nullptr);
+          }
+          auto buf = std::make_unique<IOBuf>(chunk.extractIOBuf());
+          if (contents) {
+            contents->prependChain(std::move(buf));
+          } else {
+            contents = std::move(buf);
+          }
+        }
+        if (contents->computeChainDataLength() != size) {
+          throw std::invalid_argument(folly::to<string>(
+              "chunks of blob ", id.toString(), " do not match its size"));
         }
-        auto buf = data.extractIOBuf();
-        return deserializeGitBlob(id, &buf);
+        return std::make_unique<Blob>(id, std::move(*contents));
+      });
+}
+
+folly::Future<std::unique_ptr<Blob>> LocalStore::getBlobChunk(
+    const Hash& id,
+    uint64_t index) const {
+  auto getChunkStoredUnder = [id, index, this](const Hash& key) {
+    auto chunkKey = std::make_shared<string>(blobChunkKey(key, index));
+    return getFuture(KeySpace::BlobFamily, StringPiece{*chunkKey})
+        .thenValue([id, index, chunkKey](StoreResult&& data) {
+          if (!data.isValid()) {
+            return std::unique_ptr<Blob>(nullptr);
+          }
+          return std::make_unique<Blob>(
+              blobChunkId(id, index), data.extractIOBuf());
+        });
+  };
+
+  if (!dedupeBlobContents.load(std::memory_order_relaxed)) {
+    return getChunkStoredUnder(id);
+  }
+  // Blobs stored in chunks before deduplication was enabled are stored under
+  // their ID, so their chunks are not found here.  Callers fall back to
+  // reading the whole blob in that case.
+  return getBlobMetadata(id).thenValue(
+      [id, getChunkStoredUnder](optional<BlobMetadata> metadata) {
+        return getChunkStoredUnder(metadata ? metadata->sha1 : id);
       });
 }
 
@@ -132,17 +328,17 @@ folly::Future<optional<BlobMetadata>> LocalStore::getBlobMetadata(
 }
 
 std::pair<Hash, folly::IOBuf> LocalStore::serializeTree(const Tree* tree) {
-  GitTreeSerializer serializer;
-  for (auto& entry : tree->getTreeEntries()) {
-    serializer.addEntry(std::move(entry));
-  }
-  IOBuf treeBuf = serializer.finalize();
-
   auto id = tree->getHash();
   if (id == Hash()) {
-    id = Hash::sha1(treeBuf);
+    // A tree without a hash is identified by the SHA-1 of its git tree
+    // object, as it was when trees were stored in that format.
+    GitTreeSerializer serializer;
+    for (auto& entry : tree->getTreeEntries()) {
+      serializer.addEntry(entry);
+    }
+    id = Hash::sha1(serializer.finalize());
   }
-  return std::make_pair(id, treeBuf);
+  return std::make_pair(id, SerializedTree::serialize(*tree));
 }
 
 bool LocalStore::hasKey(KeySpace keySpace, const Hash& id) const {
@@ -169,19 +365,52 @@ Hash LocalStore::WriteBatch::putTree(const Tree* tree) {
 
 BlobMetadata LocalStore::putBlob(const Hash& id, const Blob* blob) {
   BlobMetadata metadata = getMetadataFromBlob(blob);
+  putBlobWithMetadata(id, blob, metadata);
+  return metadata;
+}
+
+folly::Future<BlobMetadata> LocalStore::putBlobAsync(
+    const Hash& id,
+    std::shared_ptr<const Blob> blob) {
+  return Sha1Hasher::get()
+      .sha1(blob)
+      .toUnsafeFuture()
+      .thenValue([self = shared_from_this(), id, blob](Hash sha1) {
+        BlobMetadata metadata{sha1, blob->getSize()};
+        self->putBlobWithMetadata(id, blob.get(), metadata);
+        return metadata;
+      });
+}
 
+void LocalStore::putBlobWithMetadata(
+    const Hash& id,
+    const Blob* blob,
+    const BlobMetadata& metadata) {
   if (!enableBlobCaching) {
     XLOG(DBG8) << "Skipping caching " << id
                << " because blob cache is disabled via config";
   } else {
-    // Since blob serialization is moderately complex, just delegate
-    // the immediate putBlob to the method on the WriteBatch.
-    // Pre-allocate a buffer of approximately the right size; it
-    // needs to hold the blob content plus have room for a couple of
-    // hashes for the keys, plus some padding.
-    auto batch = beginWrite(blob->getSize() + 64);
-    batch->putBlob(id, blob);
-    batch->flush();
+    // When deduplicating, identical contents are stored once, under their
+    // SHA-1, no matter how many blob IDs refer to them.
+    auto dedupe = dedupeBlobContents.load(std::memory_order_relaxed);
+    const auto& key = dedupe ? metadata.sha1 : id;
+    if (dedupe && hasKey(KeySpace::BlobFamily, key)) {
+      XLOG(DBG8) << "Contents of " << id << " are already stored as "
+                 << key;
+    } else {
+      // Since blob serialization is moderately complex, just delegate
+      // the immediate putBlob to the method on the WriteBatch.
+      // Pre-allocate a buffer of approximately the right size; it
+      // needs to hold the blob content plus have room for a couple of
+      // hashes for the keys, plus some padding.
+      auto batch = beginWrite(blob->getSize() + 64);
+      batch->putBlob(
+          key,
+          blob,
+          BlobEncoding{compressBlobs.load(std::memory_order_relaxed),
+                       chunkLargeBlobs.load(std::memory_order_relaxed)});
+      batch->flush();
+    }
   }
 
   // Even if blob caching is disabled, it's worth caching the size and SHA-1.
@@ -189,8 +418,6 @@ BlobMetadata LocalStore::putBlob(const Hash& id, const Blob* blob) {
   SerializedBlobMetadata metadataBytes(metadata);
 
   put(KeySpace::BlobMetaDataFamily, hashBytes, metadataBytes.slice());
-
-  return metadata;
 }
 
 BlobMetadata LocalStore::getMetadataFromBlob(const Blob* blob) {
@@ -267,12 +494,47 @@ void LocalStore::WriteBatch::put(
   put(keySpace, id.getBytes(), value);
 }
 
-void LocalStore::WriteBatch::putBlob(const Hash& id, const Blob* blob) {
-  const IOBuf& contents = blob->getContents();
+void LocalStore::WriteBatch::putBlob(
+    const Hash& id,
+    const Blob* blob,
+    BlobEncoding encoding) {
   auto hashSlice = id.getBytes();
 
-  // Add a git-style blob prefix
-  auto prefix = folly::to<string>("blob ", blob->getSize());
+  if (encoding.chunk && blob->getSize() >= kMinChunkedBlobSize) {
+    // Each chunk is stored raw, without a header.  The header is written
+    // after all of the chunks, so a reader that finds the header can expect
+    // to find every chunk.
+    Cursor cursor(&blob->getContents());
+    for (uint64_t index = 0; !cursor.isAtEnd(); ++index) {
+      std::vector<ByteRange> chunkSlices;
+      uint64_t remaining = kBlobChunkSize;
+      while (remaining > 0 && !cursor.isAtEnd()) {
+        auto bytes = cursor.peekBytes().subpiece(0, remaining);
+        chunkSlices.push_back(bytes);
+        cursor.skip(bytes.size());
+        remaining -= bytes.size();
+      }
+      auto chunkKey = blobChunkKey(id, index);
+      put(KeySpace::BlobFamily, StringPiece{chunkKey}, chunkSlices);
+    }
+
+    auto header = folly::to<string>(kChunkedBlobPrefix, blob->getSize());
+    header.push_back('\0');
+    put(KeySpace::BlobFamily, hashSlice, StringPiece{header});
+    return;
+  }
+
+  std::unique_ptr<IOBuf> compressed;
+  if (encoding.compress) {
+    compressed = compressBlobContents(blob->getContents());
+  }
+  const IOBuf& contents = compressed ? *compressed : blob->getContents();
+
+  // Add a git-style blob prefix, or the similar compressed blob prefix.  Both
+  // record the uncompressed size.
+  auto prefix = folly::to<string>(
+      compressed ? kCompressedBlobPrefix : StringPiece{"blob "},
+      blob->getSize());
   prefix.push_back('\0');
   std::vector<ByteRange> bodySlices;
   bodySlices.emplace_back(StringPiece(prefix));
@@ -298,5 +560,9 @@ void LocalStore::periodicManagementTask(const EdenConfig& /* config */) {
   // periodic management.
 }
 
+uint64_t LocalStore::getMemoryUsage() const {
+  return 0;
+}
+
 } // namespace eden
 } // namespace facebook
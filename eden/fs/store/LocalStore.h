@@ -11,6 +11,7 @@
 #include <atomic>
 #include <memory>
 #include <optional>
+#include <vector>
 #include "eden/fs/store/BlobMetadata.h"
 #include "eden/fs/store/KeySpace.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -128,6 +129,25 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
    */
   folly::Future<std::unique_ptr<Blob>> getBlob(const Hash& id) const;
 
+  /**
+   * Get several Trees or Blobs with a single batch read, returning them in
+   * the same order as ids.  An entry is nullptr if its key is not present.
+   */
+  folly::Future<std::vector<std::unique_ptr<Tree>>> getTreeBatch(
+      const std::vector<Hash>& ids) const;
+  folly::Future<std::vector<std::unique_ptr<Blob>>> getBlobBatch(
+      const std::vector<Hash>& ids) const;
+
+  /**
+   * Get chunk `index` of a blob whose contents are stored in chunks.  See
+   * BlobChunks.h.  The returned Blob's ID is blobChunkId(id, index).
+   *
+   * Returns nullptr if the blob is not stored in chunks or has no such chunk.
+   */
+  folly::Future<std::unique_ptr<Blob>> getBlobChunk(
+      const Hash& id,
+      uint64_t index) const;
+
   /**
    * Get the size of a blob and the SHA-1 hash of its contents.
    *
@@ -138,7 +158,8 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
       const Hash& id) const;
 
   /**
-   * Compute the serialized version of the tree.
+   * Compute the serialized version of the tree, in the format described by
+   * SerializedTree.
    * Returns the key and the (not coalesced) serialized data.
    * This does not modify the contents of the store; it is the method
    * used by the putTree method to compute the data that it stores.
@@ -167,6 +188,14 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
    */
   BlobMetadata putBlob(const Hash& id, const Blob* blob);
 
+  /**
+   * Like putBlob(), but the SHA-1 is computed with Sha1Hasher, so a large
+   * blob is hashed on its pool rather than on the calling thread.
+   */
+  folly::Future<BlobMetadata> putBlobAsync(
+      const Hash& id,
+      std::shared_ptr<const Blob> blob);
+
   /**
    * Store metadata for each of the entries in the Tree. This stores the
    * blob metadata for each entry under the identifing hash of that entry and
@@ -207,9 +236,12 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
     Hash putTree(const Tree* tree);
 
     /**
-     * Store a Blob.
+     * Store a Blob, encoding its contents as described by encoding.
      */
-    void putBlob(const Hash& id, const Blob* blob);
+    void putBlob(
+        const Hash& id,
+        const Blob* blob,
+        BlobEncoding encoding = BlobEncoding{});
 
     /**
      * Put arbitrary data in the store.
@@ -259,6 +291,13 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
 
   virtual void periodicManagementTask(const EdenConfig& config);
 
+  /**
+   * Returns the number of bytes of memory the store is currently using for
+   * the data it holds, such as write buffers and caches.  This must be cheap
+   * enough to call periodically.
+   */
+  virtual uint64_t getMemoryUsage() const;
+
   /*
    * We keep this field to avoid making `LocalStore` holding a reference to
    * `EdenConfig`, which will require us to change all the subclasses. We update
@@ -268,7 +307,58 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
    */
   std::atomic<bool> enableBlobCaching = true;
 
+  /**
+   * Whether blob contents are stored under the SHA-1 of the contents rather
+   * than under the blob ID, so that blobs with identical contents are only
+   * stored once.  The blob metadata maps each blob ID to that SHA-1.  This is
+   * updated by `periodicManagementTask` like `enableBlobCaching`.
+   */
+  std::atomic<bool> dedupeBlobContents = false;
+
+  /**
+   * Whether blob contents are compressed when they are stored.  Blobs are
+   * readable whether or not they were compressed.  The blob metadata is
+   * stored separately, so reading it never requires decompressing a blob.
+   * This is updated by `periodicManagementTask` like `enableBlobCaching`.
+   */
+  std::atomic<bool> compressBlobs = false;
+
+  /**
+   * Whether the contents of large blobs are stored in chunks, so that part of
+   * a blob can be read without reading all of it.  Blobs are readable whether
+   * or not they were stored in chunks.  This is updated by
+   * `periodicManagementTask` like `enableBlobCaching`.
+   */
+  std::atomic<bool> chunkLargeBlobs = false;
+
  private:
+  /**
+   * Store a blob whose metadata has already been computed.
+   */
+  void putBlobWithMetadata(
+      const Hash& id,
+      const Blob* blob,
+      const BlobMetadata& metadata);
+
+  /**
+   * Get the blob with the given ID from the contents stored under key.
+   */
+  folly::Future<std::unique_ptr<Blob>> getBlobStoredUnder(
+      const Hash& id,
+      const Hash& key) const;
+
+  /**
+   * Decode the blob with the given ID from the data read for key.
+   */
+  folly::Future<std::unique_ptr<Blob>>
+  parseBlob(const Hash& id, const Hash& key, StoreResult&& data) const;
+
+  /**
+   * Get the blob with the given ID and size from the chunks stored for key.
+   */
+  folly::Future<std::unique_ptr<Blob>>
+  getChunkedBlob(const Hash& id, const Hash& key, uint64_t size) const;
+
   /**
    * Store metadata for each of the entries in the Tree. This stores the
    * blob metadata for each entry under the identifing hash of that entry and
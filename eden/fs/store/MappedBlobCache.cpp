@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/MappedBlobCache.h"
+
+#include <boost/filesystem.hpp>
+#include <folly/Exception.h>
+#include <folly/ExceptionString.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/io/IOBuf.h>
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include <ctime>
+#include <tuple>
+#include <vector>
+
+#include "eden/fs/model/Blob.h"
+
+#ifdef _WIN32
+#include "eden/fs/win/utils/Stub.h" // @manual
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace facebook {
+namespace eden {
+
+MappedBlobCache::MappedBlobCache(
+    AbsolutePath directory,
+    uint64_t minimumBlobSize,
+    uint64_t maximumSize)
+    : directory_{std::move(directory)},
+      minimumBlobSize_{minimumBlobSize},
+      maximumSize_{maximumSize} {
+  ensureDirectoryExists(directory_);
+  loadExistingFiles();
+}
+
+void MappedBlobCache::loadExistingFiles() {
+  boost::system::error_code error;
+  auto iterator = boost::filesystem::directory_iterator(
+      boost::filesystem::path{directory_.value().c_str()}, error);
+  if (error.value() != 0) {
+    XLOG(WARN) << "unable to list " << directory_ << ": " << error.message();
+    return;
+  }
+
+  std::vector<std::tuple<std::time_t, Hash, uint64_t>> files;
+  for (; iterator != boost::filesystem::directory_iterator();
+       iterator.increment(error)) {
+    const auto& path = iterator->path();
+    try {
+      auto mtime = boost::filesystem::last_write_time(path);
+      auto size = boost::filesystem::file_size(path);
+      files.emplace_back(mtime, Hash{path.filename().string()}, size);
+    } catch (const std::exception&) {
+      // Temporary files left behind by a crash while writing one.
+      XLOG(DBG2) << "removing unexpected file " << path.string();
+      boost::filesystem::remove(path, error);
+    }
+  }
+
+  // Add the oldest first so that the newest are the last to be deleted.
+  std::sort(files.begin(), files.end());
+  for (const auto& [mtime, id, size] : files) {
+    addFile(id, size);
+  }
+  XLOG(DBG2) << "found " << files.size() << " cached blob files in "
+             << directory_;
+}
+
+AbsolutePath MappedBlobCache::getPath(const Hash& id) const {
+  return directory_ + PathComponent{id.toString()};
+}
+
+std::shared_ptr<const Blob> MappedBlobCache::get(const Hash& id) {
+  if (!state_.wlock()->files.exists(id)) {
+    return nullptr;
+  }
+  try {
+    auto blob = mapFile(id, getPath(id));
+    // Moves the file to the front of the eviction order.
+    state_.wlock()->files.find(id);
+    return blob;
+  } catch (const std::exception& ex) {
+    // The file may have been deleted to make room since it was looked up.
+    XLOG(DBG2) << "unable to map cached blob " << id << ": "
+               << folly::exceptionStr(ex);
+    removeFile(id);
+    return nullptr;
+  }
+}
+
+std::shared_ptr<const Blob> MappedBlobCache::insert(
+    std::shared_ptr<const Blob> blob) {
+  if (blob->isMapped() || blob->getSize() < minimumBlobSize_ ||
+      blob->getSize() > maximumSize_) {
+    return blob;
+  }
+
+  const auto& id = blob->getHash();
+  auto path = getPath(id);
+  try {
+    // Write to a temporary file and rename it into place, so that a crash
+    // never leaves a truncated file under the blob's name.
+    auto iov = blob->getContents().getIov();
+    folly::writeFileAtomic(
+        path.stringPiece(), iov.data(), static_cast<int>(iov.size()));
+    auto mapped = mapFile(id, path);
+    addFile(id, blob->getSize());
+    XLOG(DBG4) << "cached blob " << id << " of " << blob->getSize()
+               << " bytes on disk";
+    return mapped;
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "unable to cache blob " << id << " on disk: "
+               << folly::exceptionStr(ex);
+    return blob;
+  }
+}
+
+uint64_t MappedBlobCache::getTotalSize() const {
+  return state_.rlock()->totalSize;
+}
+
+void MappedBlobCache::addFile(const Hash& id, uint64_t size) {
+  std::vector<Hash> evicted;
+  {
+    auto state = state_.wlock();
+    auto it = state->files.findWithoutPromotion(id);
+    if (it != state->files.end()) {
+      state->totalSize -= it->second;
+    }
+    state->files.set(id, size);
+    state->totalSize += size;
+
+    while (state->totalSize > maximumSize_ && state->files.size() > 1) {
+      auto oldest = state->files.rbegin();
+      evicted.push_back(oldest->first);
+      state->totalSize -= oldest->second;
+      state->files.erase(oldest->first);
+    }
+  }
+
+  // Unlinking a file does not invalidate the blobs mapped from it.
+  for (const auto& evictedId : evicted) {
+    auto path = getPath(evictedId);
+    boost::system::error_code error;
+    boost::filesystem::remove(
+        boost::filesystem::path{path.value().c_str()}, error);
+    if (error.value() != 0) {
+      XLOG(WARN) << "unable to remove cached blob file " << path << ": "
+                 << error.message();
+    }
+  }
+}
+
+void MappedBlobCache::removeFile(const Hash& id) {
+  auto state = state_.wlock();
+  auto it = state->files.findWithoutPromotion(id);
+  if (it != state->files.end()) {
+    state->totalSize -= it->second;
+    state->files.erase(id);
+  }
+}
+
+std::shared_ptr<const Blob> MappedBlobCache::mapFile(
+    const Hash& id,
+    AbsolutePathPiece path) {
+#ifdef _WIN32
+  (void)id;
+  (void)path;
+  NOT_IMPLEMENTED();
+#else
+  folly::File file{path.stringPiece(), O_RDONLY | O_CLOEXEC};
+  struct stat st;
+  folly::checkUnixError(fstat(file.fd(), &st), "unable to stat ", path);
+  auto size = static_cast<size_t>(st.st_size);
+
+  // The mapping stays valid after the file is closed.
+  auto* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, file.fd(), 0);
+  if (data == MAP_FAILED) {
+    folly::throwSystemError("unable to map ", path);
+  }
+  auto contents = folly::IOBuf::takeOwnership(
+      data,
+      size,
+      [](void* buf, void* userData) {
+        munmap(buf, reinterpret_cast<uintptr_t>(userData));
+      },
+      reinterpret_cast<void*>(static_cast<uintptr_t>(size)));
+  return std::make_shared<Blob>(id, std::move(*contents), Blob::Mapped{});
+#endif
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <cstdint>
+#include <memory>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class Blob;
+
+/**
+ * Keeps the contents of large blobs in files on disk, and hands them out as
+ * read-only mappings of those files instead of heap memory.
+ *
+ * Reading a few very large files would otherwise fill the BlobCache, and the
+ * heap, with their contents.  Mapped contents are paged in and out by the
+ * kernel's page cache as they are read, and reads return slices of the
+ * mapping without copying it.
+ *
+ * Files are named by the blob's hash, so they stay valid across commits and
+ * restarts.  Once they add up to more than maximumSize bytes, the least
+ * recently used are deleted.  Blobs mapped from a deleted file stay valid
+ * until they are released.
+ *
+ * MappedBlobCache is thread-safe.
+ */
+class MappedBlobCache {
+ public:
+  /**
+   * Caches blobs of at least minimumBlobSize bytes in directory, which is
+   * created if needed.  The files already in it are kept.
+   */
+  MappedBlobCache(
+      AbsolutePath directory,
+      uint64_t minimumBlobSize,
+      uint64_t maximumSize);
+
+  MappedBlobCache(const MappedBlobCache&) = delete;
+  MappedBlobCache& operator=(const MappedBlobCache&) = delete;
+
+  /** Returns the blob mapped from its cached file, or nullptr if none. */
+  std::shared_ptr<const Blob> get(const Hash& id);
+
+  /**
+   * Writes a blob of at least minimumBlobSize bytes to the cache, and returns
+   * it mapped from there.  Returns smaller blobs, and blobs that cannot be
+   * written, unchanged.
+   */
+  std::shared_ptr<const Blob> insert(std::shared_ptr<const Blob> blob);
+
+  /** The total size of the cached files, in bytes. */
+  uint64_t getTotalSize() const;
+
+ private:
+  struct State {
+    /** The size of each cached file, most recently used first. */
+    folly::EvictingCacheMap<Hash, uint64_t> files{0};
+    uint64_t totalSize{0};
+  };
+
+  void loadExistingFiles();
+  AbsolutePath getPath(const Hash& id) const;
+
+  /** Records a cached file, and deletes files until they fit. */
+  void addFile(const Hash& id, uint64_t size);
+  void removeFile(const Hash& id);
+
+  static std::shared_ptr<const Blob> mapFile(
+      const Hash& id,
+      AbsolutePathPiece path);
+
+  const AbsolutePath directory_;
+  const uint64_t minimumBlobSize_;
+  const uint64_t maximumSize_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
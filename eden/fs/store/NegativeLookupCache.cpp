@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/NegativeLookupCache.h"
+
+#include <folly/hash/SpookyHashV2.h>
+#include <algorithm>
+
+namespace facebook {
+namespace eden {
+
+NegativeLookupCache::NegativeLookupCache(size_t capacity)
+    : capacity_{std::max(capacity, size_t{1})},
+      slots_{new std::atomic<uint64_t>[capacity_]} {
+  for (size_t i = 0; i < capacity_; ++i) {
+    slots_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void NegativeLookupCache::insert(const Hash& id) noexcept {
+  auto fp = fingerprint(id);
+  slotFor(fp).store(fp, std::memory_order_relaxed);
+}
+
+bool NegativeLookupCache::contains(const Hash& id) const noexcept {
+  auto fp = fingerprint(id);
+  return slotFor(fp).load(std::memory_order_relaxed) == fp;
+}
+
+void NegativeLookupCache::erase(const Hash& id) noexcept {
+  auto fp = fingerprint(id);
+  // Leave the slot alone if it has since been taken by another ID.
+  slotFor(fp).compare_exchange_strong(fp, 0, std::memory_order_relaxed);
+}
+
+uint64_t NegativeLookupCache::fingerprint(const Hash& id) noexcept {
+  // Hash every byte: the IDs used by tests and some backing stores are not
+  // uniformly distributed.
+  auto bytes = id.getBytes();
+  auto fp = folly::hash::SpookyHashV2::Hash64(bytes.data(), bytes.size(), 0);
+  return fp != 0 ? fp : 1;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Remembers the IDs of objects that were recently looked up in the
+ * LocalStore and not found there.
+ *
+ * The ObjectStore checks this before the LocalStore so that an object that
+ * is already known to be missing, such as one that is still being imported
+ * or whose import failed, goes straight to the BackingStore without another
+ * LocalStore lookup.  IDs are erased once their object has been stored.
+ *
+ * Each slot holds a 64-bit fingerprint of an ID, and an ID can only occupy
+ * the one slot its fingerprint maps to.  Recording a miss overwrites
+ * whatever the slot held, so each ID takes 8 bytes and old misses are
+ * forgotten as new ones are recorded.  Two IDs only collide if their
+ * fingerprints are equal.  A false positive merely costs an unnecessary
+ * import.
+ *
+ * NegativeLookupCache is thread-safe and lock-free.
+ */
+class NegativeLookupCache {
+ public:
+  explicit NegativeLookupCache(size_t capacity);
+
+  NegativeLookupCache(const NegativeLookupCache&) = delete;
+  NegativeLookupCache& operator=(const NegativeLookupCache&) = delete;
+
+  /** Records that id was not found in the LocalStore. */
+  void insert(const Hash& id) noexcept;
+
+  /** Returns true if id was recently recorded, and not erased since. */
+  bool contains(const Hash& id) const noexcept;
+
+  /** Forgets id, once its object has been stored. */
+  void erase(const Hash& id) noexcept;
+
+ private:
+  static uint64_t fingerprint(const Hash& id) noexcept;
+
+  std::atomic<uint64_t>& slotFor(uint64_t fingerprint) const noexcept {
+    return slots_[fingerprint % capacity_];
+  }
+
+  const size_t capacity_;
+  /** Zero marks an empty slot.  Fingerprints are never zero. */
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -19,5 +19,15 @@ ObjectFetchContext& ObjectFetchContext::getNullContext() {
   static auto* p = new NullObjectFetchContext;
   return *p;
 }
+
+int8_t ObjectFetchContext::getExecutorPriority() const {
+  if (getCause() == Cause::Fuse) {
+    return folly::Executor::HI_PRI;
+  }
+  if (getPriority().kind == ImportPriorityKind::Low) {
+    return folly::Executor::LO_PRI;
+  }
+  return folly::Executor::MID_PRI;
+}
 } // namespace eden
 } // namespace facebook
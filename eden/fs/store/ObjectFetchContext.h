@@ -8,6 +8,7 @@
 #pragma once
 #include <optional>
 
+#include <folly/Executor.h>
 #include <folly/Range.h>
 
 #include "eden/fs/model/Hash.h"
@@ -73,6 +74,14 @@ class ObjectFetchContext {
     return ImportPriority::kNormal();
   }
 
+  /**
+   * The priority at which to queue work done on the server thread pool on
+   * behalf of this fetch.  FUSE requests come first, since a process is
+   * blocked until they are answered, and low priority imports such as
+   * prefetches come last.
+   */
+  virtual int8_t getExecutorPriority() const;
+
   /**
    * Support deprioritizing in sub-classes.
    * Note: Normally, each ObjectFetchContext is designed to be used for only one
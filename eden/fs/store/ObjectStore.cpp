@@ -10,17 +10,27 @@
 #include <folly/Conv.h>
 #include <folly/Executor.h>
 #include <folly/Format.h>
+#include <folly/executors/ExecutorWithPriority.h>
 #include <folly/futures/Future.h>
 #include <folly/io/IOBuf.h>
+#include <folly/stop_watch.h>
 
+#include <algorithm>
+#include <chrono>
+#include <optional>
 #include <stdexcept>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/store/BackingStore.h"
 #include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/MappedBlobCache.h"
+#include "eden/fs/store/NegativeLookupCache.h"
 #include "eden/fs/store/ObjectFetchContext.h"
+#include "eden/fs/store/ProcessFetchProfiles.h"
+#include "eden/fs/store/SerializedBlobMetadata.h"
 #include "eden/fs/telemetry/EdenStats.h"
+#include "eden/fs/telemetry/Tracing.h"
 
 using folly::Future;
 using folly::makeFuture;
@@ -31,9 +41,40 @@ using std::unique_ptr;
 namespace facebook {
 namespace eden {
 
+namespace {
+ProcessFetchProfiles::ObjectKind profileKind(
+    ObjectFetchContext::ObjectType type) {
+  switch (type) {
+    case ObjectFetchContext::Tree:
+      return ProcessFetchProfiles::ObjectKind::Tree;
+    case ObjectFetchContext::Blob:
+      return ProcessFetchProfiles::ObjectKind::Blob;
+    default:
+      return ProcessFetchProfiles::ObjectKind::BlobMetadata;
+  }
+}
+
+/**
+ * Warming up a mount after a restart should not compete with the fetches its
+ * users are waiting on.
+ */
+class MountProfileFetchContext : public ObjectFetchContext {
+ public:
+  ImportPriority getPriority() const override {
+    return ImportPriority::kLow();
+  }
+};
+
+ObjectFetchContext& getMountProfileFetchContext() {
+  static auto* context = new MountProfileFetchContext;
+  return *context;
+}
+} // namespace
+
 std::shared_ptr<ObjectStore> ObjectStore::create(
     shared_ptr<LocalStore> localStore,
     shared_ptr<BackingStore> backingStore,
+    shared_ptr<TreeCache> treeCache,
     shared_ptr<EdenStats> stats,
     folly::Executor::KeepAlive<folly::Executor> executor,
     std::shared_ptr<ProcessNameCache> processNameCache,
@@ -41,6 +82,7 @@ std::shared_ptr<ObjectStore> ObjectStore::create(
     std::shared_ptr<const EdenConfig> edenConfig) {
   return std::shared_ptr<ObjectStore>{new ObjectStore{std::move(localStore),
                                                       std::move(backingStore),
+                                                      std::move(treeCache),
                                                       std::move(stats),
                                                       executor,
                                                       processNameCache,
@@ -51,14 +93,18 @@ std::shared_ptr<ObjectStore> ObjectStore::create(
 ObjectStore::ObjectStore(
     shared_ptr<LocalStore> localStore,
     shared_ptr<BackingStore> backingStore,
+    shared_ptr<TreeCache> treeCache,
     shared_ptr<EdenStats> stats,
     folly::Executor::KeepAlive<folly::Executor> executor,
     std::shared_ptr<ProcessNameCache> processNameCache,
     std::shared_ptr<StructuredLogger> structuredLogger,
     std::shared_ptr<const EdenConfig> edenConfig)
-    : metadataCache_{folly::in_place, kCacheSize},
+    : metadataCache_{
+          edenConfig->metadataCacheSize.getValue(),
+          edenConfig->compactMetadataCache.getValue()},
       localStore_{std::move(localStore)},
       backingStore_{std::move(backingStore)},
+      treeCache_{std::move(treeCache)},
       stats_{std::move(stats)},
       executor_{executor},
       pidFetchCounts_{std::make_unique<PidFetchCounts>()},
@@ -66,10 +112,26 @@ ObjectStore::ObjectStore(
       structuredLogger_(structuredLogger),
       edenConfig_(edenConfig) {
   fetchThreshold_ = edenConfig->fetchHeavyThreshold.getValue();
+  if (auto size = edenConfig->negativeLookupCacheSize.getValue()) {
+    missingObjects_ = std::make_unique<NegativeLookupCache>(size);
+  }
 }
 
 ObjectStore::~ObjectStore() {}
 
+size_t ObjectStore::getMetadataCacheMemoryUsage() const {
+  return metadataCache_.getMemoryUsage();
+}
+
+folly::Executor::KeepAlive<> ObjectStore::getExecutor(int8_t priority) const {
+  // folly::Executor::addWithPriority throws for executors without priorities,
+  // such as those the tests use.
+  if (executor_->getNumPriorities() <= 1) {
+    return executor_;
+  }
+  return folly::ExecutorWithPriority::create(executor_, priority);
+}
+
 void ObjectStore::sendFetchHeavyEvent(pid_t pid, uint64_t fetch_count) const {
 #ifndef _WIN32
   auto processName = processNameCache_->getProcessName(pid);
@@ -80,6 +142,128 @@ void ObjectStore::sendFetchHeavyEvent(pid_t pid, uint64_t fetch_count) const {
 #endif
 }
 
+void ObjectStore::enableFetchProfiles(std::string scope) {
+  auto size = edenConfig_->fetchProfileSize.getValue();
+  if (size && processNameCache_) {
+    fetchProfiles_ = std::make_unique<ProcessFetchProfiles>(
+        localStore_, processNameCache_, std::move(scope), size);
+
+    // Refetch the objects the mount used most recently before it was last
+    // unmounted, so a restart does not leave the caches cold.
+    auto profile = fetchProfiles_->loadMountProfile();
+    if (!profile.empty()) {
+      auto& context = getMountProfileFetchContext();
+      getExecutor(context.getExecutorPriority())
+          ->add([self = shared_from_this(),
+                 profile = std::move(profile),
+                 &context]() mutable {
+            self->prefetchProfile(std::move(profile), context);
+          });
+    }
+  }
+}
+
+void ObjectStore::enableCoAccessPrefetch(std::string scope) {
+  auto size = edenConfig_->coAccessPrefetchSize.getValue();
+  if (size) {
+    coAccessPredictor_ = std::make_unique<CoAccessPredictor>(
+        localStore_, std::move(scope), size);
+    coAccessPredictor_->load();
+  }
+}
+
+void ObjectStore::enableMappedBlobs(
+    std::shared_ptr<MappedBlobCache> mappedBlobs) {
+  mappedBlobs_ = std::move(mappedBlobs);
+}
+
+void ObjectStore::recordProcessFetch(
+    ObjectFetchContext& context,
+    ObjectFetchContext::ObjectType type,
+    const Hash& id) const {
+  auto pid = context.getClientPid();
+  if (!pid.has_value()) {
+    return;
+  }
+
+  if (pidFetchCounts_->recordProcessFetch(pid.value(), fetchThreshold_)) {
+    sendFetchHeavyEvent(
+        pid.value(), pidFetchCounts_->getCountByPid(pid.value()));
+  }
+
+  if (fetchProfiles_) {
+    auto profile =
+        fetchProfiles_->recordFetch(pid.value(), profileKind(type), id);
+    if (!profile.empty()) {
+      // Prefetch on the executor rather than delaying the fetch that
+      // recognized the process, and behind the fetches it is waiting on.
+      getExecutor(folly::Executor::LO_PRI)
+          ->add([self = shared_from_this(),
+                 profile = std::move(profile)]() mutable {
+            self->prefetchProfile(
+                std::move(profile), ObjectFetchContext::getNullContext());
+          });
+    }
+  }
+
+  if (coAccessPredictor_ && type == ObjectFetchContext::Blob) {
+    auto result = coAccessPredictor_->recordAccess(pid.value(), id);
+    auto& stats = stats_->getObjectStoreStatsForCurrentThread();
+    if (result.wasPredicted) {
+      stats.coAccessPrefetchHit.addValue(1);
+    }
+    if (!result.toPrefetch.empty()) {
+      stats.coAccessPrefetch.addValue(result.toPrefetch.size());
+      // The null context has no client pid, so these fetches are not
+      // learned from.
+      getExecutor(folly::Executor::LO_PRI)
+          ->add([self = shared_from_this(),
+                 ids = std::move(result.toPrefetch)] {
+            self->prefetchBlobs(ids, ObjectFetchContext::getNullContext())
+                .thenError([](const folly::exception_wrapper& ew) {
+                  XLOG(DBG3) << "co-access prefetch failed: " << ew.what();
+                });
+          });
+    }
+  }
+}
+
+void ObjectStore::prefetchProfile(
+    std::vector<ProcessFetchProfiles::Entry> profile,
+    ObjectFetchContext& context) const {
+  XLOG(DBG2) << "prefetching " << profile.size()
+             << " objects from a fetch profile";
+
+  std::vector<Future<folly::Unit>> futures;
+  std::vector<Hash> blobIds;
+  std::vector<Hash> blobMetadataIds;
+  for (const auto& entry : profile) {
+    switch (entry.kind) {
+      case ProcessFetchProfiles::ObjectKind::Tree:
+        futures.push_back(getTree(entry.id, context).unit());
+        break;
+      case ProcessFetchProfiles::ObjectKind::Blob:
+        blobIds.push_back(entry.id);
+        break;
+      case ProcessFetchProfiles::ObjectKind::BlobMetadata:
+        blobMetadataIds.push_back(entry.id);
+        break;
+    }
+  }
+  futures.push_back(prefetchBlobs(blobIds, context));
+  futures.push_back(getBlobMetadataBatch(blobMetadataIds, context).unit());
+
+  folly::collectAllUnsafe(std::move(futures))
+      .thenValue([](std::vector<folly::Try<folly::Unit>>&& results) {
+        auto failures = std::count_if(
+            results.begin(), results.end(), [](const auto& result) {
+              return result.hasException();
+            });
+        XLOG(DBG2) << "finished prefetching a fetch profile, " << failures
+                   << " fetches failed";
+      });
+}
+
 void ObjectStore::deprioritizeWhenFetchHeavy(
     ObjectFetchContext& context) const {
   auto pid = context.getClientPid();
@@ -94,97 +278,314 @@ void ObjectStore::deprioritizeWhenFetchHeavy(
 Future<shared_ptr<const Tree>> ObjectStore::getTree(
     const Hash& id,
     ObjectFetchContext& fetchContext) const {
-  // Check in the LocalStore first
-  return localStore_->getTree(id).thenValue([self = shared_from_this(),
-                                             id,
-                                             &fetchContext](
-                                                shared_ptr<const Tree> tree) {
-    if (tree) {
-      XLOG(DBG4) << "tree " << id << " found in local store";
-      fetchContext.didFetch(
-          ObjectFetchContext::Tree, id, ObjectFetchContext::FromDiskCache);
+  // Check the in-memory cache first
+  if (auto cachedTree = treeCache_->getLive(id).tree) {
+    XLOG(DBG4) << "tree " << id << " found in memory cache";
+    updateTreeStats(true, false, false);
+    fetchContext.didFetch(
+        ObjectFetchContext::Tree, id, ObjectFetchContext::FromMemoryCache);
+    recordProcessFetch(fetchContext, ObjectFetchContext::Tree, id);
+    return makeFuture(std::move(cachedTree));
+  }
+
+  return coalesceLoad(
+      pendingTrees_,
+      id,
+      [&] {
+        XLOG(DBG4) << "joining the pending load of tree " << id;
+        stats_->getObjectStoreStatsForCurrentThread()
+            .getTreeCoalesced.addValue(1);
+        recordProcessFetch(fetchContext, ObjectFetchContext::Tree, id);
+      },
+      [&] { return loadTree(id, fetchContext); });
+}
+
+Future<shared_ptr<const Tree>> ObjectStore::loadTree(
+    const Hash& id,
+    ObjectFetchContext& fetchContext) const {
+  // Skip the LocalStore for trees that recently missed there.
+  if (missingObjects_ && missingObjects_->contains(id)) {
+    XLOG(DBG4) << "tree " << id << " recently missed in local store";
+    return getTreeFromBackingStore(id, fetchContext);
+  }
+
+  // Then check in the LocalStore
+  auto traceBlock = TraceBlock::detached("ObjectStore::getTree local store");
+  return localStore_->getTree(id).thenValue(
+      [self = shared_from_this(),
+       id,
+       &fetchContext,
+       traceBlock = std::move(traceBlock)](
+          shared_ptr<const Tree> tree) mutable {
+        traceBlock.close();
+        if (tree) {
+          XLOG(DBG4) << "tree " << id << " found in local store";
+          self->updateTreeStats(false, true, false);
+          self->treeCache_->insert(tree);
+          fetchContext.didFetch(
+              ObjectFetchContext::Tree, id, ObjectFetchContext::FromDiskCache);
+
+          self->recordProcessFetch(fetchContext, ObjectFetchContext::Tree, id);
 
-      if (auto pid = fetchContext.getClientPid()) {
-        auto fetch_count =
-            self->pidFetchCounts_->recordProcessFetch(pid.value());
-        if (fetch_count == self->fetchThreshold_) {
-          self->sendFetchHeavyEvent(pid.value(), fetch_count);
+          return makeFuture(std::move(tree));
         }
-      }
 
-      return makeFuture(std::move(tree));
+        if (self->missingObjects_) {
+          self->missingObjects_->insert(id);
+        }
+        return self->getTreeFromBackingStore(id, fetchContext);
+      });
+}
+
+Future<shared_ptr<const Tree>> ObjectStore::getTreeFromBackingStore(
+    const Hash& id,
+    ObjectFetchContext& fetchContext) const {
+  deprioritizeWhenFetchHeavy(fetchContext);
+
+  // Load the tree from the BackingStore.
+  auto traceBlock = TraceBlock::detached("ObjectStore::getTree backing store");
+  auto fetch = backingStore_->getTree(id, fetchContext);
+  return importTree(id, std::move(fetch), std::move(traceBlock), fetchContext);
+}
+
+Future<shared_ptr<const Tree>> ObjectStore::importTree(
+    const Hash& id,
+    folly::SemiFuture<unique_ptr<Tree>> fetch,
+    TraceBlock traceBlock,
+    ObjectFetchContext& fetchContext) const {
+  return std::move(fetch)
+      .via(getExecutor(fetchContext.getExecutorPriority()))
+      .thenValue([self = shared_from_this(),
+                  id,
+                  &fetchContext,
+                  localStore = localStore_,
+                  traceBlock = std::move(traceBlock)](
+                     unique_ptr<const Tree> loadedTree) mutable {
+        traceBlock.close();
+        if (!loadedTree) {
+          // TODO: Perhaps we should do some short-term negative
+          // caching?
+          XLOG(DBG2) << "unable to find tree " << id;
+          self->updateTreeStats(false, false, false);
+          throw std::domain_error(
+              folly::to<string>("tree ", id.toString(), " not found"));
+        }
+
+        folly::stop_watch<std::chrono::microseconds> writeWatch;
+        localStore->putTree(loadedTree.get());
+        self->stats_->getObjectStoreStatsForCurrentThread()
+            .localStoreWriteTree.addValue(writeWatch.elapsed().count());
+        if (self->missingObjects_) {
+          self->missingObjects_->erase(id);
+        }
+        XLOG(DBG3) << "tree " << id << " retrieved from backing store";
+        self->updateTreeStats(false, false, true);
+        fetchContext.didFetch(
+            ObjectFetchContext::Tree, id, ObjectFetchContext::FromBackingStore);
+
+        self->recordProcessFetch(fetchContext, ObjectFetchContext::Tree, id);
+        auto tree = shared_ptr<const Tree>(std::move(loadedTree));
+        self->treeCache_->insert(tree);
+        return tree;
+      });
+}
+
+std::vector<Future<shared_ptr<const Tree>>> ObjectStore::getTrees(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& fetchContext) const {
+  std::vector<Future<shared_ptr<const Tree>>> results;
+  results.reserve(ids.size());
+
+  auto localIds = std::make_shared<std::vector<Hash>>();
+  auto localPromises = std::make_shared<TreePromiseList>();
+  std::vector<Hash> backingIds;
+  TreePromiseList backingPromises;
+  for (const auto& id : ids) {
+    if (auto cachedTree = treeCache_->getLive(id).tree) {
+      updateTreeStats(true, false, false);
+      fetchContext.didFetch(
+          ObjectFetchContext::Tree, id, ObjectFetchContext::FromMemoryCache);
+      recordProcessFetch(fetchContext, ObjectFetchContext::Tree, id);
+      results.push_back(makeFuture(std::move(cachedTree)));
+      continue;
     }
 
-    self->deprioritizeWhenFetchHeavy(fetchContext);
-
-    // Note: We don't currently have logic here to avoid duplicate work if
-    // multiple callers request the same tree at once.  We could store a map
-    // of pending lookups as (Hash --> std::list<Promise<unique_ptr<Tree>>),
-    // and just add a new Promise to the list if this Hash already exists in
-    // the pending list.
-    //
-    // However, de-duplication of object loads will already be done at the
-    // Inode layer.  Therefore we currently don't bother de-duping loads at
-    // this layer.
-
-    // Load the tree from the BackingStore.
-    return self->backingStore_->getTree(id, fetchContext)
-        .via(self->executor_)
-        .thenValue([self, id, &fetchContext, localStore = self->localStore_](
-                       unique_ptr<const Tree> loadedTree) {
-          if (!loadedTree) {
-            // TODO: Perhaps we should do some short-term negative
-            // caching?
-            XLOG(DBG2) << "unable to find tree " << id;
-            throw std::domain_error(
-                folly::to<string>("tree ", id.toString(), " not found"));
-          }
+    folly::Promise<shared_ptr<const Tree>> promise;
+    results.push_back(promise.getFuture());
+    if (missingObjects_ && missingObjects_->contains(id)) {
+      backingIds.push_back(id);
+      backingPromises.push_back(std::move(promise));
+    } else {
+      localIds->push_back(id);
+      localPromises->push_back(std::move(promise));
+    }
+  }
+  getTreesFromBackingStore(
+      backingIds, std::move(backingPromises), fetchContext);
+  if (localIds->empty()) {
+    return results;
+  }
 
-          localStore->putTree(loadedTree.get());
-          XLOG(DBG3) << "tree " << id << " retrieved from backing store";
-          fetchContext.didFetch(
-              ObjectFetchContext::Tree,
-              id,
-              ObjectFetchContext::FromBackingStore);
+  auto traceBlock = TraceBlock::detached("ObjectStore::getTrees local store");
+  localStore_->getTreeBatch(*localIds)
+      .thenTry([self = shared_from_this(),
+                localIds,
+                localPromises,
+                &fetchContext,
+                traceBlock = std::move(traceBlock)](
+                   folly::Try<std::vector<unique_ptr<Tree>>>&& trees) mutable {
+        traceBlock.close();
+        if (trees.hasException()) {
+          for (auto& promise : *localPromises) {
+            promise.setException(trees.exception());
+          }
+          return;
+        }
 
-          if (auto pid = fetchContext.getClientPid()) {
-            auto fetch_count =
-                self->pidFetchCounts_->recordProcessFetch(pid.value());
-            if (fetch_count == self->fetchThreshold_) {
-              self->sendFetchHeavyEvent(pid.value(), fetch_count);
+        std::vector<Hash> missingIds;
+        TreePromiseList missingPromises;
+        for (size_t i = 0; i < localIds->size(); ++i) {
+          const auto& id = (*localIds)[i];
+          auto& promise = (*localPromises)[i];
+          if (!(*trees)[i]) {
+            if (self->missingObjects_) {
+              self->missingObjects_->insert(id);
             }
+            missingIds.push_back(id);
+            missingPromises.push_back(std::move(promise));
+            continue;
           }
-          return shared_ptr<const Tree>(std::move(loadedTree));
+
+          auto tree = shared_ptr<const Tree>(std::move((*trees)[i]));
+          self->updateTreeStats(false, true, false);
+          self->treeCache_->insert(tree);
+          fetchContext.didFetch(
+              ObjectFetchContext::Tree, id, ObjectFetchContext::FromDiskCache);
+          self->recordProcessFetch(fetchContext, ObjectFetchContext::Tree, id);
+          promise.setValue(std::move(tree));
+        }
+        self->getTreesFromBackingStore(
+            missingIds, std::move(missingPromises), fetchContext);
+      });
+  return results;
+}
+
+void ObjectStore::getTreesFromBackingStore(
+    const std::vector<Hash>& ids,
+    TreePromiseList&& promises,
+    ObjectFetchContext& fetchContext) const {
+  if (ids.empty()) {
+    return;
+  }
+  deprioritizeWhenFetchHeavy(fetchContext);
+
+  auto fetches = backingStore_->getTrees(ids, fetchContext);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    importTree(
+        ids[i],
+        std::move(fetches[i]),
+        TraceBlock::detached("ObjectStore::getTree backing store"),
+        fetchContext)
+        .thenTry([promise = std::move(promises[i])](
+                     folly::Try<shared_ptr<const Tree>>&& tree) mutable {
+          promise.setTry(std::move(tree));
         });
-  });
+  }
 }
 
 Future<shared_ptr<const Tree>> ObjectStore::getTreeForCommit(
     const Hash& commitID,
-    ObjectFetchContext&) const {
+    ObjectFetchContext& context) const {
   XLOG(DBG3) << "getTreeForCommit(" << commitID << ")";
 
-  return backingStore_->getTreeForCommit(commitID).via(executor_).thenValue(
-      [commitID, localStore = localStore_](std::shared_ptr<const Tree> tree) {
+  std::shared_ptr<TreePromise> promise;
+  {
+    auto commitTrees = commitTrees_.wlock();
+    auto resolved = commitTrees->resolved.find(commitID);
+    if (resolved != commitTrees->resolved.end()) {
+      return folly::makeFuture(resolved->second);
+    }
+    auto& pending = commitTrees->pending[commitID];
+    if (pending) {
+      XLOG(DBG4) << "joining the pending import of commit " << commitID;
+      return pending->getFuture();
+    }
+    pending = std::make_shared<TreePromise>();
+    promise = pending;
+  }
+
+  // The backing store may throw rather than return a failed future, which
+  // must still complete the pending promise.
+  folly::makeSemiFutureWith(
+      [&] { return backingStore_->getTreeForCommit(commitID); })
+      .via(getExecutor(context.getExecutorPriority()))
+      .thenValue([self = shared_from_this(),
+                  commitID](std::shared_ptr<const Tree> tree) {
         if (!tree) {
           throw std::domain_error(folly::to<string>(
               "unable to import commit ", commitID.toString()));
         }
 
-        localStore->putTree(tree.get());
+        self->localStore_->putTree(tree.get());
+        if (self->missingObjects_) {
+          self->missingObjects_->erase(tree->getHash());
+        }
         return tree;
+      })
+      .thenTry([self = shared_from_this(), commitID, promise](
+                   folly::Try<std::shared_ptr<const Tree>>&& tree) {
+        {
+          auto commitTrees = self->commitTrees_.wlock();
+          // Failures are not remembered, since a commit that is missing now
+          // may be pulled at any time.
+          if (tree.hasValue()) {
+            commitTrees->resolved.set(commitID, tree.value());
+          }
+          commitTrees->pending.erase(commitID);
+        }
+        if (tree.hasValue() && self->edenConfig_ &&
+            self->edenConfig_->prefetchCommitRootChildren.getValue()) {
+          self->prefetchRootChildren(*tree.value());
+        }
+        promise->setTry(std::move(tree));
       });
+  return promise->getFuture();
+}
+
+void ObjectStore::prefetchRootChildren(const Tree& root) const {
+  std::vector<Hash> ids;
+  for (const auto& entry : root.getTreeEntries()) {
+    if (entry.isTree()) {
+      ids.push_back(entry.getHash());
+    }
+  }
+  if (ids.empty()) {
+    return;
+  }
+  XLOG(DBG3) << "prefetching " << ids.size() << " subdirectories of root tree "
+             << root.getHash();
+
+  auto executor = getExecutor(folly::Executor::LO_PRI);
+  executor->add([self = shared_from_this(), ids = std::move(ids)] {
+    for (const auto& id : ids) {
+      self->getTree(id, ObjectFetchContext::getNullContext())
+          .thenError([id](const folly::exception_wrapper& ew) {
+            XLOG(DBG3) << "failed to prefetch tree " << id << ": " << ew.what();
+            return std::shared_ptr<const Tree>{};
+          });
+    }
+  });
 }
 
 Future<shared_ptr<const Tree>> ObjectStore::getTreeForManifest(
     const Hash& commitID,
     const Hash& manifestID,
-    ObjectFetchContext&) const {
+    ObjectFetchContext& context) const {
   XLOG(DBG3) << "getTreeForManifest(" << commitID << ", " << manifestID << ")";
 
   return backingStore_->getTreeForManifest(commitID, manifestID)
-      .via(executor_)
-      .thenValue([commitID, manifestID, localStore = localStore_](
+      .via(getExecutor(context.getExecutorPriority()))
+      .thenValue([self = shared_from_this(), commitID, manifestID](
                      std::shared_ptr<const Tree> tree) {
         if (!tree) {
           throw std::domain_error(folly::to<string>(
@@ -194,7 +595,10 @@ Future<shared_ptr<const Tree>> ObjectStore::getTreeForManifest(
               manifestID.toString()));
         }
 
-        localStore->putTree(tree.get());
+        self->localStore_->putTree(tree.get());
+        if (self->missingObjects_) {
+          self->missingObjects_->erase(tree->getHash());
+        }
         return tree;
       });
 }
@@ -213,71 +617,300 @@ folly::Future<folly::Unit> ObjectStore::prefetchBlobs(
   if (ids.empty()) {
     return folly::unit;
   }
-  return backingStore_->prefetchBlobs(ids, fetchContext).via(executor_);
+  return backingStore_->prefetchBlobs(ids, fetchContext)
+      .via(getExecutor(fetchContext.getExecutorPriority()));
 }
 
 Future<shared_ptr<const Blob>> ObjectStore::getBlob(
     const Hash& id,
     ObjectFetchContext& fetchContext) const {
+  if (auto mapped = getMappedBlob(id, fetchContext)) {
+    return makeFuture(std::move(mapped));
+  }
+  return coalesceLoad(
+      pendingBlobs_,
+      id,
+      [&] {
+        XLOG(DBG4) << "joining the pending load of blob " << id;
+        stats_->getObjectStoreStatsForCurrentThread()
+            .getBlobCoalesced.addValue(1);
+        recordProcessFetch(fetchContext, ObjectFetchContext::Blob, id);
+      },
+      [&] { return mapLargeBlob(loadBlob(id, fetchContext)); });
+}
+
+shared_ptr<const Blob> ObjectStore::getMappedBlob(
+    const Hash& id,
+    ObjectFetchContext& fetchContext) const {
+  if (!mappedBlobs_) {
+    return nullptr;
+  }
+  auto blob = mappedBlobs_->get(id);
+  if (blob) {
+    XLOG(DBG4) << "blob " << id << " found in mapped blob cache";
+    updateBlobStats(true, false);
+    fetchContext.didFetch(
+        ObjectFetchContext::Blob, id, ObjectFetchContext::FromDiskCache);
+    recordProcessFetch(fetchContext, ObjectFetchContext::Blob, id);
+  }
+  return blob;
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::mapLargeBlob(
+    Future<shared_ptr<const Blob>> blob) const {
+  if (!mappedBlobs_) {
+    return blob;
+  }
+  return std::move(blob).thenValue(
+      [mappedBlobs = mappedBlobs_](shared_ptr<const Blob> loaded) {
+        return mappedBlobs->insert(std::move(loaded));
+      });
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::loadBlob(
+    const Hash& id,
+    ObjectFetchContext& fetchContext) const {
+  // Skip the LocalStore for blobs that recently missed there.
+  if (missingObjects_ && missingObjects_->contains(id)) {
+    XLOG(DBG4) << "blob " << id << " recently missed in local store";
+    return getBlobFromBackingStore(id, fetchContext);
+  }
+
   auto self = shared_from_this();
 
-  return localStore_->getBlob(id).thenValue([id, &fetchContext, self](
-                                                shared_ptr<const Blob> blob) {
-    if (blob) {
-      // Not computing the BlobMetadata here because if the blob was found
-      // in the local store, the LocalStore probably also has the metadata
-      // already, and the caller may not even need the SHA-1 here. (If the
-      // caller needed the SHA-1, they would have called getBlobMetadata
-      // instead.)
-      XLOG(DBG4) << "blob " << id << " found in local store";
-      self->updateBlobStats(true, false);
-      fetchContext.didFetch(
-          ObjectFetchContext::Blob, id, ObjectFetchContext::FromDiskCache);
-      if (auto pid = fetchContext.getClientPid()) {
-        auto fetch_count =
-            self->pidFetchCounts_->recordProcessFetch(pid.value());
-        if (fetch_count == self->fetchThreshold_) {
-          self->sendFetchHeavyEvent(pid.value(), fetch_count);
+  auto traceBlock = TraceBlock::detached("ObjectStore::getBlob local store");
+  return localStore_->getBlob(id).thenValue(
+      [id, &fetchContext, self, traceBlock = std::move(traceBlock)](
+          shared_ptr<const Blob> blob) mutable {
+        traceBlock.close();
+        if (blob) {
+          // Not computing the BlobMetadata here because if the blob was found
+          // in the local store, the LocalStore probably also has the metadata
+          // already, and the caller may not even need the SHA-1 here. (If the
+          // caller needed the SHA-1, they would have called getBlobMetadata
+          // instead.)
+          XLOG(DBG4) << "blob " << id << " found in local store";
+          self->updateBlobStats(true, false);
+          fetchContext.didFetch(
+              ObjectFetchContext::Blob, id, ObjectFetchContext::FromDiskCache);
+          self->recordProcessFetch(fetchContext, ObjectFetchContext::Blob, id);
+          return makeFuture(shared_ptr<const Blob>(std::move(blob)));
+        }
+
+        if (self->missingObjects_) {
+          self->missingObjects_->insert(id);
         }
-      }
-      return makeFuture(shared_ptr<const Blob>(std::move(blob)));
+        return self->getBlobFromBackingStore(id, fetchContext);
+      });
+}
+
+std::vector<Future<shared_ptr<const Blob>>> ObjectStore::getBlobs(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& fetchContext) const {
+  std::vector<Future<shared_ptr<const Blob>>> results;
+  results.reserve(ids.size());
+
+  auto localIds = std::make_shared<std::vector<Hash>>();
+  auto localPromises = std::make_shared<BlobPromiseList>();
+  std::vector<Hash> backingIds;
+  BlobPromiseList backingPromises;
+  for (const auto& id : ids) {
+    if (auto mapped = getMappedBlob(id, fetchContext)) {
+      results.push_back(makeFuture(std::move(mapped)));
+      continue;
     }
+    folly::Promise<shared_ptr<const Blob>> promise;
+    results.push_back(mapLargeBlob(promise.getFuture()));
+    if (missingObjects_ && missingObjects_->contains(id)) {
+      backingIds.push_back(id);
+      backingPromises.push_back(std::move(promise));
+    } else {
+      localIds->push_back(id);
+      localPromises->push_back(std::move(promise));
+    }
+  }
+  getBlobsFromBackingStore(
+      backingIds, std::move(backingPromises), fetchContext);
+  if (localIds->empty()) {
+    return results;
+  }
 
-    self->deprioritizeWhenFetchHeavy(fetchContext);
-
-    // Look in the BackingStore
-    return self->backingStore_->getBlob(id, fetchContext)
-        .via(self->executor_)
-        .thenValue([self, &fetchContext, id](
-                       unique_ptr<const Blob> loadedBlob) {
-          if (loadedBlob) {
-            XLOG(DBG3) << "blob " << id << "  retrieved from backing store";
-            self->updateBlobStats(false, true);
-            fetchContext.didFetch(
-                ObjectFetchContext::Blob,
-                id,
-                ObjectFetchContext::FromBackingStore);
+  auto traceBlock = TraceBlock::detached("ObjectStore::getBlobs local store");
+  localStore_->getBlobBatch(*localIds)
+      .thenTry([self = shared_from_this(),
+                localIds,
+                localPromises,
+                &fetchContext,
+                traceBlock = std::move(traceBlock)](
+                   folly::Try<std::vector<unique_ptr<Blob>>>&& blobs) mutable {
+        traceBlock.close();
+        if (blobs.hasException()) {
+          for (auto& promise : *localPromises) {
+            promise.setException(blobs.exception());
+          }
+          return;
+        }
 
-            if (auto pid = fetchContext.getClientPid()) {
-              auto fetch_count =
-                  self->pidFetchCounts_->recordProcessFetch(pid.value());
-              if (fetch_count == self->fetchThreshold_) {
-                self->sendFetchHeavyEvent(pid.value(), fetch_count);
-              }
+        std::vector<Hash> missingIds;
+        BlobPromiseList missingPromises;
+        for (size_t i = 0; i < localIds->size(); ++i) {
+          const auto& id = (*localIds)[i];
+          auto& promise = (*localPromises)[i];
+          if (!(*blobs)[i]) {
+            if (self->missingObjects_) {
+              self->missingObjects_->insert(id);
             }
-
-            auto metadata = self->localStore_->putBlob(id, loadedBlob.get());
-            self->metadataCache_.wlock()->set(id, metadata);
-            return shared_ptr<const Blob>(std::move(loadedBlob));
+            missingIds.push_back(id);
+            missingPromises.push_back(std::move(promise));
+            continue;
           }
 
-          XLOG(DBG2) << "unable to find blob " << id;
-          self->updateBlobStats(false, false);
-          // TODO: Perhaps we should do some short-term negative caching?
-          throw std::domain_error(
-              folly::to<string>("blob ", id.toString(), " not found"));
+          self->updateBlobStats(true, false);
+          fetchContext.didFetch(
+              ObjectFetchContext::Blob, id, ObjectFetchContext::FromDiskCache);
+          self->recordProcessFetch(fetchContext, ObjectFetchContext::Blob, id);
+          promise.setValue(shared_ptr<const Blob>(std::move((*blobs)[i])));
+        }
+        self->getBlobsFromBackingStore(
+            missingIds, std::move(missingPromises), fetchContext);
+      });
+  return results;
+}
+
+void ObjectStore::getBlobsFromBackingStore(
+    const std::vector<Hash>& ids,
+    BlobPromiseList&& promises,
+    ObjectFetchContext& fetchContext) const {
+  if (ids.empty()) {
+    return;
+  }
+  deprioritizeWhenFetchHeavy(fetchContext);
+
+  auto fetches = backingStore_->getBlobs(ids, fetchContext);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    importBlob(
+        ids[i],
+        std::move(fetches[i]),
+        TraceBlock::detached("ObjectStore::getBlob backing store"),
+        fetchContext)
+        .thenTry([promise = std::move(promises[i])](
+                     folly::Try<shared_ptr<const Blob>>&& blob) mutable {
+          promise.setTry(std::move(blob));
         });
-  });
+  }
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::getBlobChunk(
+    const Hash& id,
+    uint64_t index,
+    ObjectFetchContext& /* fetchContext */) const {
+  if (!localStore_->chunkLargeBlobs.load(std::memory_order_relaxed) ||
+      (missingObjects_ && missingObjects_->contains(id))) {
+    return makeFuture(shared_ptr<const Blob>{});
+  }
+  return localStore_->getBlobChunk(id, index)
+      .thenValue([](unique_ptr<Blob> chunk) {
+        return shared_ptr<const Blob>(std::move(chunk));
+      });
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::getBlobFromBackingStore(
+    const Hash& id,
+    ObjectFetchContext& fetchContext) const {
+  deprioritizeWhenFetchHeavy(fetchContext);
+
+  // Look in the BackingStore
+  auto traceBlock = TraceBlock::detached("ObjectStore::getBlob backing store");
+  auto fetch = backingStore_->getBlob(id, fetchContext);
+  return importBlob(id, std::move(fetch), std::move(traceBlock), fetchContext);
+}
+
+Future<shared_ptr<const Blob>> ObjectStore::importBlob(
+    const Hash& id,
+    folly::SemiFuture<unique_ptr<Blob>> fetch,
+    TraceBlock traceBlock,
+    ObjectFetchContext& fetchContext) const {
+  return std::move(fetch)
+      .via(getExecutor(fetchContext.getExecutorPriority()))
+      .thenValue([self = shared_from_this(),
+                  &fetchContext,
+                  id,
+                  traceBlock = std::move(traceBlock)](
+                     unique_ptr<const Blob> loadedBlob) mutable
+                  -> Future<shared_ptr<const Blob>> {
+        traceBlock.close();
+        if (loadedBlob) {
+          XLOG(DBG3) << "blob " << id << "  retrieved from backing store";
+          self->updateBlobStats(false, true);
+          fetchContext.didFetch(
+              ObjectFetchContext::Blob,
+              id,
+              ObjectFetchContext::FromBackingStore);
+
+          self->recordProcessFetch(fetchContext, ObjectFetchContext::Blob, id);
+
+          folly::stop_watch<std::chrono::microseconds> writeWatch;
+          auto blob = shared_ptr<const Blob>(std::move(loadedBlob));
+          return self->localStore_->putBlobAsync(id, blob).thenValue(
+              [self, id, blob, writeWatch](BlobMetadata metadata) {
+                self->stats_->getObjectStoreStatsForCurrentThread()
+                    .localStoreWriteBlob.addValue(writeWatch.elapsed().count());
+                if (self->missingObjects_) {
+                  self->missingObjects_->erase(id);
+                }
+                self->metadataCache_.set(id, metadata);
+                return blob;
+              });
+        }
+
+        XLOG(DBG2) << "unable to find blob " << id;
+        self->updateBlobStats(false, false);
+        // TODO: Perhaps we should do some short-term negative caching?
+        throw std::domain_error(
+            folly::to<string>("blob ", id.toString(), " not found"));
+      });
+}
+
+template <typename T, typename JoinFn, typename LoadFn>
+Future<T> ObjectStore::coalesceLoad(
+    folly::Synchronized<PendingLoads<T>>& pendingLoads,
+    const Hash& id,
+    JoinFn&& onJoin,
+    LoadFn&& load) const {
+  std::shared_ptr<folly::SharedPromise<T>> promise;
+  std::optional<Future<T>> joined;
+  {
+    auto pending = pendingLoads.wlock();
+    auto& entry = (*pending)[id];
+    if (entry) {
+      joined = entry->getFuture();
+    } else {
+      entry = std::make_shared<folly::SharedPromise<T>>();
+      promise = entry;
+    }
+  }
+  if (joined) {
+    onJoin();
+    return std::move(*joined);
+  }
+
+  // load() may throw rather than return a failed future, which must still
+  // complete the pending promise.
+  folly::makeFutureWith(std::forward<LoadFn>(load))
+      .thenTry([self = shared_from_this(), &pendingLoads, id, promise](
+                   folly::Try<T>&& result) {
+        pendingLoads.wlock()->erase(id);
+        promise->setTry(std::move(result));
+      });
+  return promise->getFuture();
+}
+
+void ObjectStore::updateTreeStats(bool memory, bool local, bool backing)
+    const {
+  ObjectStoreThreadStats& stats = stats_->getObjectStoreStatsForCurrentThread();
+  stats.getTreeFromMemory.addValue(memory);
+  stats.getTreeFromLocalStore.addValue(local);
+  stats.getTreeFromBackingStore.addValue(backing);
 }
 
 void ObjectStore::updateBlobStats(bool local, bool backing) const {
@@ -290,89 +923,129 @@ Future<BlobMetadata> ObjectStore::getBlobMetadata(
     const Hash& id,
     ObjectFetchContext& context) const {
   // Check in-memory cache
-  {
-    auto metadataCache = metadataCache_.wlock();
-    auto cacheIter = metadataCache->find(id);
-    if (cacheIter != metadataCache->end()) {
-      updateBlobMetadataStats(true, false, false);
-      context.didFetch(
-          ObjectFetchContext::BlobMetadata,
-          id,
-          ObjectFetchContext::FromMemoryCache);
-      if (auto pid = context.getClientPid()) {
-        auto fetch_count = pidFetchCounts_->recordProcessFetch(pid.value());
-        if (fetch_count == fetchThreshold_) {
-          sendFetchHeavyEvent(pid.value(), fetch_count);
-        }
-      }
-      return cacheIter->second;
-    }
+  if (auto cached = metadataCache_.get(id)) {
+    updateBlobMetadataStats(true, false, false);
+    context.didFetch(
+        ObjectFetchContext::BlobMetadata,
+        id,
+        ObjectFetchContext::FromMemoryCache);
+    recordProcessFetch(context, ObjectFetchContext::BlobMetadata, id);
+    return *cached;
   }
 
+  return coalesceLoad(
+      pendingBlobMetadata_,
+      id,
+      [&] {
+        XLOG(DBG4) << "joining the pending load of blob metadata " << id;
+        stats_->getObjectStoreStatsForCurrentThread()
+            .getBlobMetadataCoalesced.addValue(1);
+        recordProcessFetch(context, ObjectFetchContext::BlobMetadata, id);
+      },
+      [&] { return loadBlobMetadata(id, context); });
+}
+
+Future<BlobMetadata> ObjectStore::loadBlobMetadata(
+    const Hash& id,
+    ObjectFetchContext& context) const {
   auto self = shared_from_this();
 
   // Check local store
+  auto traceBlock =
+      TraceBlock::detached("ObjectStore::getBlobMetadata local store");
   return localStore_->getBlobMetadata(id).thenValue(
-      [self, id, &context](std::optional<BlobMetadata>&& metadata) {
+      [self, id, &context, traceBlock = std::move(traceBlock)](
+          std::optional<BlobMetadata>&& metadata) mutable {
+        traceBlock.close();
         if (metadata) {
           self->updateBlobMetadataStats(false, true, false);
-          self->metadataCache_.wlock()->set(id, *metadata);
+          self->metadataCache_.set(id, *metadata);
           context.didFetch(
               ObjectFetchContext::BlobMetadata,
               id,
               ObjectFetchContext::FromDiskCache);
-          if (auto pid = context.getClientPid()) {
-            auto fetch_count =
-                self->pidFetchCounts_->recordProcessFetch(pid.value());
-            if (fetch_count == self->fetchThreshold_) {
-              self->sendFetchHeavyEvent(pid.value(), fetch_count);
-            }
-          }
+          self->recordProcessFetch(
+              context, ObjectFetchContext::BlobMetadata, id);
 
           return makeFuture(*metadata);
         }
 
-        self->deprioritizeWhenFetchHeavy(context);
-
-        // Check backing store
-        //
-        // TODO: It would be nice to add a smarter API to the BackingStore so
-        // that we can query it just for the blob metadata if it supports
-        // getting that without retrieving the full blob data.
-        //
-        // TODO: This should probably check the LocalStore for the blob first,
-        // especially when we begin to expire entries in RocksDB.
-        return self->backingStore_->getBlob(id, context)
-            .via(self->executor_)
-            .thenValue([self, id, &context](std::unique_ptr<Blob> blob) {
-              if (blob) {
-                self->updateBlobMetadataStats(false, false, true);
-                auto metadata = self->localStore_->putBlob(id, blob.get());
-                self->metadataCache_.wlock()->set(id, metadata);
+        return self->getBlobMetadataFromBackingStore(id, context);
+      });
+}
+
+Future<BlobMetadata> ObjectStore::getBlobMetadataFromBackingStore(
+    const Hash& id,
+    ObjectFetchContext& context) const {
+  deprioritizeWhenFetchHeavy(context);
+
+  auto traceBlock =
+      TraceBlock::detached("ObjectStore::getBlobMetadata backing store");
+  return backingStore_->getBlobMetadata(id, context)
+      .via(getExecutor(context.getExecutorPriority()))
+      .thenValue([self = shared_from_this(),
+                  id,
+                  &context,
+                  traceBlock = std::move(traceBlock)](
+                     std::optional<BlobMetadata>&& metadata) mutable {
+        traceBlock.close();
+        if (!metadata) {
+          return self->getBlobMetadataFromBlob(id, context);
+        }
+
+        self->updateBlobMetadataStats(false, false, true);
+        // Only the metadata is stored.  The contents are fetched if they are
+        // ever read.
+        SerializedBlobMetadata metadataBytes(*metadata);
+        self->localStore_->put(
+            KeySpace::BlobMetaDataFamily, id, metadataBytes.slice());
+        self->metadataCache_.set(id, *metadata);
+        context.didFetch(
+            ObjectFetchContext::BlobMetadata,
+            id,
+            ObjectFetchContext::FromBackingStore);
+
+        self->recordProcessFetch(context, ObjectFetchContext::BlobMetadata, id);
+        return makeFuture(*metadata);
+      });
+}
+
+Future<BlobMetadata> ObjectStore::getBlobMetadataFromBlob(
+    const Hash& id,
+    ObjectFetchContext& context) const {
+  // TODO: This should probably check the LocalStore for the blob first,
+  // especially when we begin to expire entries in RocksDB.
+  return backingStore_->getBlob(id, context)
+      .via(getExecutor(context.getExecutorPriority()))
+      .thenValue([self = shared_from_this(), id, &context](
+                     std::unique_ptr<Blob> blob) -> Future<BlobMetadata> {
+        if (blob) {
+          self->updateBlobMetadataStats(false, false, true);
+          return self->localStore_
+              ->putBlobAsync(id, shared_ptr<const Blob>(std::move(blob)))
+              .thenValue([self, id, &context](BlobMetadata metadata) {
+                if (self->missingObjects_) {
+                  self->missingObjects_->erase(id);
+                }
+                self->metadataCache_.set(id, metadata);
                 // I could see an argument for recording this fetch with
                 // type Blob instead of BlobMetadata, but it's probably more
                 // useful in context to know how many metadata fetches
-                // occurred. Also, since backing stores don't directly
-                // support fetching metadata, it should be clear.
+                // occurred.
                 context.didFetch(
                     ObjectFetchContext::BlobMetadata,
                     id,
                     ObjectFetchContext::FromBackingStore);
 
-                if (auto pid = context.getClientPid()) {
-                  auto fetch_count =
-                      self->pidFetchCounts_->recordProcessFetch(pid.value());
-                  if (fetch_count == self->fetchThreshold_) {
-                    self->sendFetchHeavyEvent(pid.value(), fetch_count);
-                  }
-                }
-                return makeFuture(metadata);
-              }
+                self->recordProcessFetch(
+                    context, ObjectFetchContext::BlobMetadata, id);
+                return metadata;
+              });
+        }
 
-              self->updateBlobMetadataStats(false, false, false);
-              throw std::domain_error(
-                  folly::to<string>("blob ", id.toString(), " not found"));
-            });
+        self->updateBlobMetadataStats(false, false, false);
+        throw std::domain_error(
+            folly::to<string>("blob ", id.toString(), " not found"));
       });
 }
 
@@ -384,6 +1057,88 @@ void ObjectStore::updateBlobMetadataStats(bool memory, bool local, bool backing)
   stats.getBlobMetadataFromBackingStore.addValue(backing);
 }
 
+Future<std::vector<folly::Try<BlobMetadata>>>
+ObjectStore::getBlobMetadataBatch(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) const {
+  auto results =
+      std::make_shared<std::vector<folly::Try<BlobMetadata>>>(ids.size());
+
+  // Check in-memory cache
+  std::vector<size_t> uncached;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    auto cached = metadataCache_.get(ids[i]);
+    if (!cached) {
+      uncached.push_back(i);
+      continue;
+    }
+    updateBlobMetadataStats(true, false, false);
+    context.didFetch(
+        ObjectFetchContext::BlobMetadata,
+        ids[i],
+        ObjectFetchContext::FromMemoryCache);
+    recordProcessFetch(context, ObjectFetchContext::BlobMetadata, ids[i]);
+    (*results)[i] = folly::Try<BlobMetadata>{*cached};
+  }
+
+  if (uncached.empty()) {
+    return makeFuture(std::move(*results));
+  }
+
+  // Check local store.  getBatch() copies the keys before returning, but the
+  // IDs are still needed once the results arrive.
+  auto uncachedIds = std::make_shared<std::vector<Hash>>();
+  uncachedIds->reserve(uncached.size());
+  std::vector<folly::ByteRange> keys;
+  keys.reserve(uncached.size());
+  for (auto i : uncached) {
+    uncachedIds->push_back(ids[i]);
+    keys.push_back(uncachedIds->back().getBytes());
+  }
+
+  return localStore_->getBatch(KeySpace::BlobMetaDataFamily, keys)
+      .thenValue([self = shared_from_this(),
+                  results,
+                  uncached = std::move(uncached),
+                  uncachedIds,
+                  &context](std::vector<StoreResult>&& stored) {
+        std::vector<size_t> fetchIndices;
+        std::vector<Future<BlobMetadata>> fetches;
+        for (size_t j = 0; j < uncached.size(); ++j) {
+          const auto& id = (*uncachedIds)[j];
+          if (!stored[j].isValid()) {
+            fetchIndices.push_back(uncached[j]);
+            fetches.push_back(folly::makeFutureWith([&] {
+              return self->getBlobMetadataFromBackingStore(id, context);
+            }));
+            continue;
+          }
+
+          (*results)[uncached[j]] = folly::makeTryWith([&] {
+            auto metadata = SerializedBlobMetadata::parse(id, stored[j]);
+            self->updateBlobMetadataStats(false, true, false);
+            self->metadataCache_.set(id, metadata);
+            context.didFetch(
+                ObjectFetchContext::BlobMetadata,
+                id,
+                ObjectFetchContext::FromDiskCache);
+            self->recordProcessFetch(
+                context, ObjectFetchContext::BlobMetadata, id);
+            return metadata;
+          });
+        }
+
+        return folly::collectAllUnsafe(std::move(fetches))
+            .thenValue([results, fetchIndices = std::move(fetchIndices)](
+                           std::vector<folly::Try<BlobMetadata>>&& fetched) {
+              for (size_t k = 0; k < fetched.size(); ++k) {
+                (*results)[fetchIndices[k]] = std::move(fetched[k]);
+              }
+              return std::move(*results);
+            });
+      });
+}
+
 Future<Hash> ObjectStore::getBlobSha1(
     const Hash& id,
     ObjectFetchContext& context) const {
@@ -9,19 +9,28 @@
 
 #include <folly/Executor.h>
 #include <folly/Synchronized.h>
+#include <folly/Try.h>
 #include <folly/container/EvictingCacheMap.h>
+#include <folly/futures/SharedPromise.h>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include <folly/logging/xlog.h>
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/store/BlobMetadata.h"
+#include "eden/fs/store/BlobMetadataCache.h"
+#include "eden/fs/store/CoAccessPredictor.h"
 #include "eden/fs/store/IObjectStore.h"
 #include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/store/ObjectFetchContext.h"
+#include "eden/fs/store/PidFetchCounts.h"
+#include "eden/fs/store/ProcessFetchProfiles.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/telemetry/EdenStats.h"
 #include "eden/fs/telemetry/StructuredLogger.h"
+#include "eden/fs/telemetry/Tracing.h"
 #ifndef _WIN32
 #include "eden/fs/utils/ProcessNameCache.h"
 #else
@@ -34,32 +43,10 @@ namespace eden {
 class BackingStore;
 class Blob;
 class LocalStore;
+class MappedBlobCache;
+class NegativeLookupCache;
 class Tree;
 
-struct PidFetchCounts {
-  folly::Synchronized<std::unordered_map<pid_t, uint64_t>> map_;
-
-  uint64_t recordProcessFetch(pid_t pid) {
-    auto map_lock = map_.wlock();
-    auto fetch_count = (*map_lock)[pid]++;
-    return fetch_count;
-  }
-
-  void clear() {
-    map_.wlock()->clear();
-  }
-
-  uint64_t getCountByPid(pid_t pid) {
-    auto rl = map_.rlock();
-    auto fetch_count = rl->find(pid);
-    if (fetch_count != rl->end()) {
-      return fetch_count->second;
-    } else {
-      return 0;
-    }
-  }
-};
-
 constexpr uint64_t importPriorityDeprioritizeAmount{1};
 
 /**
@@ -78,6 +65,7 @@ class ObjectStore : public IObjectStore,
   static std::shared_ptr<ObjectStore> create(
       std::shared_ptr<LocalStore> localStore,
       std::shared_ptr<BackingStore> backingStore,
+      std::shared_ptr<TreeCache> treeCache,
       std::shared_ptr<EdenStats> stats,
       folly::Executor::KeepAlive<folly::Executor> executor,
       std::shared_ptr<ProcessNameCache> processNameCache,
@@ -103,6 +91,36 @@ class ObjectStore : public IObjectStore,
    */
   void deprioritizeWhenFetchHeavy(ObjectFetchContext& context) const;
 
+  /**
+   * Start recording which objects each tool fetches, and prefetching them
+   * when the tool runs again, if the store:fetch-profile-size setting is
+   * nonzero.  scope identifies the mount in the saved profiles.  The objects
+   * the mount fetched most recently are prefetched right away, at low
+   * priority.
+   *
+   * This must be called before the ObjectStore is used.
+   */
+  void enableFetchProfiles(std::string scope);
+
+  /**
+   * Start learning which blobs are read together, and prefetching the blobs
+   * usually read after each one read, at low priority, if the
+   * store:co-access-prefetch-size setting is nonzero.  scope identifies the
+   * mount in the saved sketch.
+   *
+   * This must be called before the ObjectStore is used.
+   */
+  void enableCoAccessPrefetch(std::string scope);
+
+  /**
+   * Read large blobs from mappings of the files in mappedBlobs instead of
+   * heap memory, writing the large blobs fetched that are not there yet.
+   * The MappedBlobCache may be shared with other ObjectStores.
+   *
+   * This must be called before the ObjectStore is used.
+   */
+  void enableMappedBlobs(std::shared_ptr<MappedBlobCache> mappedBlobs);
+
   /**
    * Get a Tree by ID.
    *
@@ -120,6 +138,9 @@ class ObjectStore : public IObjectStore,
    * This returns a Future object that will produce the root Tree when it is
    * ready.  It may result in a std::domain_error if the specified commit ID
    * does not exist, or possibly other exceptions on error.
+   *
+   * Concurrent requests for the same commit share one import, and the root
+   * trees of the most recently resolved commits are kept in memory.
    */
   folly::Future<std::shared_ptr<const Tree>> getTreeForCommit(
       const Hash& commitID,
@@ -145,6 +166,32 @@ class ObjectStore : public IObjectStore,
       const Hash& id,
       ObjectFetchContext& context) const override;
 
+  /**
+   * Get several Trees or Blobs by ID, returning one future per ID in the same
+   * order.  Each future fails or succeeds as getTree() or getBlob() would.
+   *
+   * The objects that are not cached in memory are looked up in the
+   * LocalStore with a single batch read, and the ones it misses are fetched
+   * from the BackingStore together, so that it can batch them.
+   */
+  std::vector<folly::Future<std::shared_ptr<const Tree>>> getTrees(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const override;
+  std::vector<folly::Future<std::shared_ptr<const Blob>>> getBlobs(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const override;
+
+  /**
+   * Get a chunk of a blob that the LocalStore keeps in chunks.
+   *
+   * Backing stores only fetch whole blobs, so this returns nullptr rather
+   * than fetching anything if the chunk is not in the LocalStore.
+   */
+  folly::Future<std::shared_ptr<const Blob>> getBlobChunk(
+      const Hash& id,
+      uint64_t index,
+      ObjectFetchContext& context) const override;
+
   /**
    * Returns the size of the contents of the blob with the given ID.
    */
@@ -158,6 +205,18 @@ class ObjectStore : public IObjectStore,
   folly::Future<Hash> getBlobSha1(const Hash& id, ObjectFetchContext& context)
       const;
 
+  /**
+   * Returns the metadata of each of the given blobs, in the same order.
+   *
+   * Blobs whose metadata is not cached in memory are looked up in the
+   * LocalStore with a single batch read, and only the remaining blobs are
+   * fetched from the BackingStore.  A blob that cannot be found produces an
+   * exception in its own entry without failing the others.
+   */
+  folly::Future<std::vector<folly::Try<BlobMetadata>>> getBlobMetadataBatch(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const;
+
   /**
    * Get the LocalStore used by this ObjectStore
    */
@@ -172,8 +231,13 @@ class ObjectStore : public IObjectStore,
     return backingStore_;
   }
 
-  folly::Synchronized<std::unordered_map<pid_t, uint64_t>>& getPidFetches() {
-    return pidFetchCounts_->map_;
+  /**
+   * An estimate of the bytes held by the in-memory blob metadata cache.
+   */
+  size_t getMetadataCacheMemoryUsage() const;
+
+  std::unordered_map<pid_t, uint64_t> getPidFetches() {
+    return pidFetchCounts_->getAllCounts();
   }
 
   void clearFetchCounts() {
@@ -185,6 +249,7 @@ class ObjectStore : public IObjectStore,
   ObjectStore(
       std::shared_ptr<LocalStore> localStore,
       std::shared_ptr<BackingStore> backingStore,
+      std::shared_ptr<TreeCache> treeCache,
       std::shared_ptr<EdenStats> stats,
       folly::Executor::KeepAlive<folly::Executor> executor,
       std::shared_ptr<ProcessNameCache> processNameCache,
@@ -205,24 +270,153 @@ class ObjectStore : public IObjectStore,
       const Hash& id,
       ObjectFetchContext& context) const;
 
-  static constexpr size_t kCacheSize = 1000000;
+  template <typename T>
+  using PendingLoads =
+      std::unordered_map<Hash, std::shared_ptr<folly::SharedPromise<T>>>;
+
+  /**
+   * Returns the result of load(), sharing it with every call for the same id
+   * made while it is running, so that concurrent requests for one object
+   * probe the LocalStore and fetch from the BackingStore only once.  onJoin()
+   * is called when this call shares another's load instead of starting one.
+   */
+  template <typename T, typename JoinFn, typename LoadFn>
+  folly::Future<T> coalesceLoad(
+      folly::Synchronized<PendingLoads<T>>& pendingLoads,
+      const Hash& id,
+      JoinFn&& onJoin,
+      LoadFn&& load) const;
+
+  /**
+   * Load an object that is not in memory from the LocalStore, or else from
+   * the BackingStore.  getTree(), getBlob() and getBlobMetadata() coalesce
+   * concurrent calls to these.
+   */
+  folly::Future<std::shared_ptr<const Tree>> loadTree(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+  folly::Future<std::shared_ptr<const Blob>> loadBlob(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+  /**
+   * Returns the blob if mappedBlobs_ has it, recording the fetch, or nullptr
+   * otherwise.
+   */
+  std::shared_ptr<const Blob> getMappedBlob(
+      const Hash& id,
+      ObjectFetchContext& fetchContext) const;
+
+  /**
+   * Writes the blob to mappedBlobs_, if enabled, and returns the mapped copy
+   * in its place if it is large enough.
+   */
+  folly::Future<std::shared_ptr<const Blob>> mapLargeBlob(
+      folly::Future<std::shared_ptr<const Blob>> blob) const;
+
+  folly::Future<BlobMetadata> loadBlobMetadata(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  using TreePromiseList =
+      std::vector<folly::Promise<std::shared_ptr<const Tree>>>;
+  using BlobPromiseList =
+      std::vector<folly::Promise<std::shared_ptr<const Blob>>>;
+
+  folly::Future<std::shared_ptr<const Tree>> getTreeFromBackingStore(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  folly::Future<std::shared_ptr<const Blob>> getBlobFromBackingStore(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  /**
+   * Fetch the given objects with one call to the BackingStore, completing
+   * each of the promises, in the same order, as the objects arrive.
+   */
+  void getTreesFromBackingStore(
+      const std::vector<Hash>& ids,
+      TreePromiseList&& promises,
+      ObjectFetchContext& context) const;
+  void getBlobsFromBackingStore(
+      const std::vector<Hash>& ids,
+      BlobPromiseList&& promises,
+      ObjectFetchContext& context) const;
+
+  /**
+   * Stores an object being fetched from the BackingStore in the LocalStore
+   * and records the fetch once it arrives, failing if it was not found.
+   */
+  folly::Future<std::shared_ptr<const Tree>> importTree(
+      const Hash& id,
+      folly::SemiFuture<std::unique_ptr<Tree>> fetch,
+      TraceBlock traceBlock,
+      ObjectFetchContext& context) const;
+  folly::Future<std::shared_ptr<const Blob>> importBlob(
+      const Hash& id,
+      folly::SemiFuture<std::unique_ptr<Blob>> fetch,
+      TraceBlock traceBlock,
+      ObjectFetchContext& context) const;
+
+  /**
+   * Get the metadata of a blob that is in neither the metadata cache nor the
+   * LocalStore from the BackingStore, fetching the whole blob if the
+   * BackingStore cannot provide just the metadata.
+   */
+  folly::Future<BlobMetadata> getBlobMetadataFromBackingStore(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  folly::Future<BlobMetadata> getBlobMetadataFromBlob(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  /**
+   * Returns executor_ queuing at the given priority, or executor_ itself if
+   * it does not support priorities.
+   */
+  folly::Executor::KeepAlive<> getExecutor(int8_t priority) const;
 
   /**
    * During status and checkout, it's common to look up the SHA-1 for a given
    * blob ID. To avoid needing to hit RocksDB, keep a bounded in-memory cache of
-   * the sizes and SHA-1s of blobs we've seen. Each node is somewhere around 50
-   * bytes (20+28 + LRU overhead) and we store kMetadataCacheSize entries, which
-   * EvictingCacheMap divides in two for some reason. At the time of this
-   * comment, EvictingCacheMap does not store its nodes densely, so there may
-   * also be some jemalloc tracking overhead and some internal fragmentation
-   * depending on whether the node fits cleanly into one of jemalloc's size
-   * classes.
-   *
-   * TODO: It never makes sense to rlock an LRU cache, since cache hits mutate
-   * the data structure. Thus, should we use a more appropriate type of lock?
+   * the sizes and SHA-1s of blobs we've seen, sized by
+   * store:metadata-cache-size.
+   */
+  mutable BlobMetadataCache metadataCache_;
+
+  static constexpr size_t kCommitTreeCacheSize = 16;
+
+  using TreePromise = folly::SharedPromise<std::shared_ptr<const Tree>>;
+
+  struct CommitTrees {
+    CommitTrees() : resolved{kCommitTreeCacheSize} {}
+
+    /** The root trees of recently resolved commits. */
+    folly::EvictingCacheMap<Hash, std::shared_ptr<const Tree>> resolved;
+    /**
+     * The commits being resolved, so that concurrent requests for the same
+     * commit share one import.
+     */
+    std::unordered_map<Hash, std::shared_ptr<TreePromise>> pending;
+  };
+
+  /**
+   * Clients such as hg, watchman and buck tend to ask for a new commit at
+   * about the same time, and then keep asking for it.
    */
-  mutable folly::Synchronized<folly::EvictingCacheMap<Hash, BlobMetadata>>
-      metadataCache_;
+  mutable folly::Synchronized<CommitTrees> commitTrees_;
+
+  /**
+   * The objects being loaded by getTree(), getBlob() and getBlobMetadata().
+   * FileInode and TreeInode only coalesce the loads of a single inode, and
+   * many inodes, in many mounts, can share an object.
+   */
+  mutable folly::Synchronized<PendingLoads<std::shared_ptr<const Tree>>>
+      pendingTrees_;
+  mutable folly::Synchronized<PendingLoads<std::shared_ptr<const Blob>>>
+      pendingBlobs_;
+  mutable folly::Synchronized<PendingLoads<BlobMetadata>> pendingBlobMetadata_;
 
   /*
    * The LocalStore.
@@ -238,6 +432,21 @@ class ObjectStore : public IObjectStore,
    */
   std::shared_ptr<BackingStore> backingStore_;
 
+  /*
+   * In-memory cache of decoded trees, to avoid deserializing hot trees from
+   * the LocalStore on every lookup.
+   *
+   * Multiple ObjectStores may share the same TreeCache.
+   */
+  std::shared_ptr<TreeCache> treeCache_;
+
+  /*
+   * The IDs of trees and blobs that recently missed in the LocalStore, so
+   * that lookups for them go straight to the BackingStore.  Null if
+   * store:negative-lookup-cache-size is 0.
+   */
+  std::unique_ptr<NegativeLookupCache> missingObjects_;
+
   std::shared_ptr<EdenStats> const stats_;
 
   folly::Executor::KeepAlive<folly::Executor> executor_;
@@ -246,6 +455,15 @@ class ObjectStore : public IObjectStore,
    * from the beginning of the eden daemon progress */
   std::unique_ptr<PidFetchCounts> pidFetchCounts_;
 
+  /* Null unless enableFetchProfiles() turned fetch profiles on. */
+  std::unique_ptr<ProcessFetchProfiles> fetchProfiles_;
+
+  /* Null unless enableCoAccessPrefetch() turned co-access prefetch on. */
+  std::unique_ptr<CoAccessPredictor> coAccessPredictor_;
+
+  /* Null unless enableMappedBlobs() turned mapped blobs on. */
+  std::shared_ptr<MappedBlobCache> mappedBlobs_;
+
   /* process name cache and structured logger used for
    * sending fetch heavy events, set to nullptr if not
    * initialized by create()
@@ -257,8 +475,33 @@ class ObjectStore : public IObjectStore,
   std::shared_ptr<StructuredLogger> structuredLogger_;
   std::shared_ptr<const EdenConfig> edenConfig_;
 
+  void updateTreeStats(bool memory, bool local, bool backing) const;
   void updateBlobStats(bool local, bool backing) const;
   void updateBlobMetadataStats(bool memory, bool local, bool backing) const;
+
+  /**
+   * Account a fetch of the given object to the client process of context,
+   * if it has one.
+   */
+  void recordProcessFetch(
+      ObjectFetchContext& context,
+      ObjectFetchContext::ObjectType type,
+      const Hash& id) const;
+
+  /**
+   * Start fetching the subdirectories of a commit's root tree, at low
+   * priority, since nearly every operation on the commit descends into some
+   * of them.
+   */
+  void prefetchRootChildren(const Tree& root) const;
+
+  /**
+   * Fetch the objects in a saved profile.  context must have no client pid,
+   * so that these fetches are not recorded in the profiles themselves.
+   */
+  void prefetchProfile(
+      std::vector<ProcessFetchProfiles::Entry> profile,
+      ObjectFetchContext& context) const;
 };
 
 } // namespace eden
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/PidFetchCounts.h"
+
+#include <folly/MapUtil.h>
+
+namespace facebook {
+namespace eden {
+
+PidFetchCounts::PidFetchCounts()
+    : threadLocalCounts_{[this] { return new ThreadLocalCounts{this}; }} {}
+
+bool PidFetchCounts::recordProcessFetch(pid_t pid, uint64_t threshold) {
+  // Lock order: a thread's pending counts, then the totals.
+  auto pending = threadLocalCounts_->pending.lock();
+  auto& count = (*pending)[pid];
+  if (++count < kFlushInterval) {
+    return false;
+  }
+
+  auto added = count;
+  pending->erase(pid);
+  auto totals = totals_.wlock();
+  auto& total = (*totals)[pid];
+  auto before = total;
+  total += added;
+  return before <= threshold && threshold < total;
+}
+
+uint64_t PidFetchCounts::getCountByPid(pid_t pid) {
+  auto pending = threadLocalCounts_->pending.lock();
+  auto count = folly::get_default(*pending, pid, 0);
+  return count + folly::get_default(*totals_.rlock(), pid, 0);
+}
+
+std::unordered_map<pid_t, uint64_t> PidFetchCounts::getAllCounts() {
+  for (auto& local : threadLocalCounts_.accessAllThreads()) {
+    flush(local);
+  }
+  return *totals_.rlock();
+}
+
+void PidFetchCounts::clear() {
+  for (auto& local : threadLocalCounts_.accessAllThreads()) {
+    local.pending.lock()->clear();
+  }
+  totals_.wlock()->clear();
+}
+
+void PidFetchCounts::flush(ThreadLocalCounts& local) {
+  auto pending = local.pending.lock();
+  if (pending->empty()) {
+    return;
+  }
+  auto totals = totals_.wlock();
+  for (const auto& [pid, count] : *pending) {
+    (*totals)[pid] += count;
+  }
+  pending->clear();
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Counts the object fetches made on behalf of each process.
+ *
+ * Fetches are counted on the hot path of every object lookup, so each thread
+ * accumulates its counts locally, under a lock only it and readers take.  A
+ * thread adds its count for a process to the shared totals every
+ * kFlushInterval fetches by that process, and readers add in every thread's
+ * pending counts first.  The totals seen by recordProcessFetch() and
+ * getCountByPid() can therefore lag behind by up to kFlushInterval fetches
+ * per thread.
+ *
+ * PidFetchCounts is thread-safe.
+ */
+class PidFetchCounts {
+ public:
+  static constexpr uint64_t kFlushInterval = 64;
+
+  PidFetchCounts();
+
+  PidFetchCounts(const PidFetchCounts&) = delete;
+  PidFetchCounts& operator=(const PidFetchCounts&) = delete;
+
+  /**
+   * Records a fetch by pid.
+   *
+   * Returns true if this fetch was the one that took pid's total past
+   * threshold.  That happens at most once per pid, up to kFlushInterval
+   * fetches late.
+   */
+  bool recordProcessFetch(pid_t pid, uint64_t threshold);
+
+  /**
+   * Returns the number of fetches recorded for pid, including the ones
+   * pending on the calling thread but not those pending on other threads.
+   */
+  uint64_t getCountByPid(pid_t pid);
+
+  /** Returns the number of fetches recorded for each pid. */
+  std::unordered_map<pid_t, uint64_t> getAllCounts();
+
+  void clear();
+
+ private:
+  using CountMap = std::unordered_map<pid_t, uint64_t>;
+
+  struct ThreadLocalCounts {
+    explicit ThreadLocalCounts(PidFetchCounts* owner) : owner{owner} {}
+
+    ~ThreadLocalCounts() {
+      // This thread is going away, so add its counts to the totals.
+      owner->flush(*this);
+    }
+
+    PidFetchCounts* const owner;
+    folly::Synchronized<CountMap, std::mutex> pending;
+  };
+
+  class Tag {};
+
+  /**
+   * Moves all of local's pending counts to the totals.  Must not be called
+   * with the totals locked.
+   */
+  void flush(ThreadLocalCounts& local);
+
+  // Declared before threadLocalCounts_ so that it outlives the flushes done
+  // when threadLocalCounts_ is destroyed.
+  folly::Synchronized<CountMap> totals_;
+  folly::ThreadLocal<ThreadLocalCounts, Tag, folly::AccessModeStrict>
+      threadLocalCounts_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/ProcessFetchProfiles.h"
+
+#include <folly/logging/xlog.h>
+
+#include "eden/fs/store/KeySpace.h"
+#include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/StoreResult.h"
+#include "eden/fs/utils/ProcessNameCache.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/** The number of processes whose tool names are remembered. */
+constexpr size_t kMaxProcesses = 1024;
+
+constexpr size_t kEntrySize = 1 + Hash::RAW_SIZE;
+} // namespace
+
+ProcessFetchProfiles::ProcessFetchProfiles(
+    std::shared_ptr<LocalStore> localStore,
+    std::shared_ptr<ProcessNameCache> processNameCache,
+    std::string scope,
+    size_t maxEntries)
+    : localStore_{std::move(localStore)},
+      processNameCache_{std::move(processNameCache)},
+      scope_{std::move(scope)},
+      maxEntries_{maxEntries},
+      state_{folly::in_place, kMaxProcesses, maxEntries} {}
+
+std::vector<ProcessFetchProfiles::Entry> ProcessFetchProfiles::recordFetch(
+    pid_t pid,
+    ObjectKind kind,
+    const Hash& id) {
+  std::vector<Entry> toPrefetch;
+  std::optional<std::pair<std::string, std::string>> toSave;
+  std::optional<std::string> mountProfileToSave;
+  {
+    auto state = state_.wlock();
+    auto processIter = state->toolNames.find(pid);
+    if (processIter == state->toolNames.end()) {
+      // Fetches are not recorded until the process name has been resolved.
+      auto processName = processNameCache_->getProcessName(pid);
+      if (!processName) {
+        return toPrefetch;
+      }
+      auto tool = toolName(*processName);
+      if (!tool.empty()) {
+        auto [profileIter, inserted] =
+            state->profiles.try_emplace(tool, maxEntries_);
+        if (inserted) {
+          loadProfile(tool, profileIter->second);
+        }
+        if (profileIter->second.entries.size() >= kMinProfileSize) {
+          toPrefetch = profileIter->second.snapshot();
+        }
+      }
+      state->toolNames.set(pid, tool);
+      processIter = state->toolNames.find(pid);
+    }
+
+    auto& tool = processIter->second;
+    if (tool.empty()) {
+      return toPrefetch;
+    }
+    mountProfileToSave = addEntry(state->mountProfile, kind, id);
+    if (auto bytes = addEntry(state->profiles.at(tool), kind, id)) {
+      toSave.emplace(profileKey(tool), std::move(*bytes));
+    }
+  }
+
+  if (mountProfileToSave) {
+    saveProfile(profileKey(""), *mountProfileToSave);
+  }
+  if (toSave) {
+    saveProfile(toSave->first, toSave->second);
+  }
+  return toPrefetch;
+}
+
+std::vector<ProcessFetchProfiles::Entry>
+ProcessFetchProfiles::loadMountProfile() {
+  auto state = state_.wlock();
+  loadProfile("", state->mountProfile);
+  return state->mountProfile.snapshot();
+}
+
+std::optional<std::string> ProcessFetchProfiles::addEntry(
+    Profile& profile,
+    ObjectKind kind,
+    const Hash& id) {
+  // Looking the entry up moves it to the front.  A blob whose contents were
+  // fetched stays a Blob when only its metadata is fetched again.
+  auto entryIter = profile.entries.find(id);
+  if (entryIter == profile.entries.end()) {
+    profile.entries.set(id, kind);
+  } else if (kind != ObjectKind::BlobMetadata) {
+    entryIter->second = kind;
+  }
+  if (++profile.unsavedFetches < kMinProfileSize) {
+    return std::nullopt;
+  }
+  profile.unsavedFetches = 0;
+  return serialize(profile.snapshot());
+}
+
+void ProcessFetchProfiles::saveProfile(
+    const std::string& key,
+    const std::string& bytes) const {
+  try {
+    localStore_->put(
+        KeySpace::FetchProfileFamily,
+        folly::StringPiece{key},
+        folly::StringPiece{bytes});
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "failed to save fetch profile: " << ex.what();
+  }
+}
+
+std::string ProcessFetchProfiles::serialize(const std::vector<Entry>& entries) {
+  std::string bytes;
+  bytes.reserve(entries.size() * kEntrySize);
+  for (const auto& entry : entries) {
+    bytes.push_back(static_cast<char>(entry.kind));
+    auto hashBytes = entry.id.getBytes();
+    bytes.append(
+        reinterpret_cast<const char*>(hashBytes.data()), hashBytes.size());
+  }
+  return bytes;
+}
+
+std::vector<ProcessFetchProfiles::Entry> ProcessFetchProfiles::deserialize(
+    folly::ByteRange bytes) {
+  std::vector<Entry> entries;
+  entries.reserve(bytes.size() / kEntrySize);
+  for (; bytes.size() >= kEntrySize; bytes.advance(kEntrySize)) {
+    auto kind = static_cast<ObjectKind>(bytes[0]);
+    if (kind != ObjectKind::Tree && kind != ObjectKind::Blob &&
+        kind != ObjectKind::BlobMetadata) {
+      continue;
+    }
+    entries.push_back(Entry{kind, Hash{bytes.subpiece(1, Hash::RAW_SIZE)}});
+  }
+  return entries;
+}
+
+std::string ProcessFetchProfiles::toolName(folly::StringPiece processName) {
+  // ProcessNameCache reports the names it could not read as "<err:...>".
+  if (processName.startsWith("<err:")) {
+    return std::string{};
+  }
+  // The arguments of the command line are separated by NUL bytes.
+  auto end = processName.find('\0');
+  return processName.subpiece(0, end).str();
+}
+
+std::vector<ProcessFetchProfiles::Entry>
+ProcessFetchProfiles::Profile::snapshot() const {
+  std::vector<Entry> result;
+  result.reserve(entries.size());
+  for (const auto& [id, kind] : entries) {
+    result.push_back(Entry{kind, id});
+  }
+  return result;
+}
+
+std::string ProcessFetchProfiles::profileKey(
+    folly::StringPiece toolName) const {
+  // Neither mount paths nor process names contain a NUL byte.
+  std::string key{scope_};
+  key.push_back('\0');
+  key.append(toolName.data(), toolName.size());
+  return key;
+}
+
+void ProcessFetchProfiles::loadProfile(
+    folly::StringPiece toolName,
+    Profile& profile) const {
+  std::vector<Entry> saved;
+  try {
+    auto result = localStore_->get(
+        KeySpace::FetchProfileFamily, folly::StringPiece{profileKey(toolName)});
+    if (!result.isValid()) {
+      return;
+    }
+    saved = deserialize(result.bytes());
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "failed to load fetch profile for " << toolName << ": "
+               << ex.what();
+    return;
+  }
+
+  // Insert the oldest first so that the most recent end up in front.
+  for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+    profile.entries.set(it->id, it->kind);
+  }
+  XLOG(DBG3) << "loaded fetch profile for " << toolName << " with "
+             << saved.size() << " objects";
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+class LocalStore;
+class ProcessNameCache;
+
+/**
+ * Records which trees and blobs each tool fetches from a mount, so that they
+ * can be fetched ahead of time the next time the same tool runs.
+ *
+ * A profile is kept per tool, identified by the executable in its process
+ * name.  It holds the objects the tool fetched most recently, and is saved
+ * to the LocalStore as it grows so that it survives restarts.  Objects are
+ * identified by their content hashes, so a profile recorded at one commit
+ * stays mostly valid at nearby commits: the objects for directories and
+ * files that did not change are the same.
+ *
+ * Every fetch made by a known process is also recorded in a profile for the
+ * whole mount, which loadMountProfile() returns so that the mount's hottest
+ * objects can be fetched again after a restart.
+ *
+ * ProcessFetchProfiles is thread-safe.
+ */
+class ProcessFetchProfiles {
+ public:
+  /** How an object was fetched.  The values are saved in the LocalStore. */
+  enum class ObjectKind : uint8_t {
+    Tree = 0,
+    Blob = 1,
+    /** Only the size and SHA-1 of the blob were fetched. */
+    BlobMetadata = 2,
+  };
+
+  struct Entry {
+    ObjectKind kind;
+    Hash id;
+
+    bool operator==(const Entry& other) const {
+      return kind == other.kind && id == other.id;
+    }
+  };
+
+  /**
+   * Tools that fetch fewer objects than this are not worth prefetching for.
+   * Their profiles are neither saved nor prefetched, and larger profiles are
+   * saved each time this many more fetches have been recorded.
+   */
+  static constexpr size_t kMinProfileSize = 1024;
+
+  /**
+   * scope distinguishes the profiles of different mounts sharing a
+   * LocalStore.  Each profile keeps at most maxEntries objects.
+   */
+  ProcessFetchProfiles(
+      std::shared_ptr<LocalStore> localStore,
+      std::shared_ptr<ProcessNameCache> processNameCache,
+      std::string scope,
+      size_t maxEntries);
+
+  ProcessFetchProfiles(const ProcessFetchProfiles&) = delete;
+  ProcessFetchProfiles& operator=(const ProcessFetchProfiles&) = delete;
+
+  /**
+   * Records that pid fetched the given object.
+   *
+   * The first time a process with a known name is seen, this returns its
+   * tool's profile, most recently fetched objects first, for the caller to
+   * prefetch.  Otherwise it returns an empty vector.
+   */
+  std::vector<Entry> recordFetch(pid_t pid, ObjectKind kind, const Hash& id);
+
+  /**
+   * Loads the mount's saved profile, most recently fetched objects first.
+   * Fetches recorded from then on are added to it.  This should be called
+   * once, before any fetches are recorded.
+   */
+  std::vector<Entry> loadMountProfile();
+
+  /**
+   * Encodes entries as one kind byte followed by the 20 hash bytes for each
+   * entry.
+   */
+  static std::string serialize(const std::vector<Entry>& entries);
+
+  /**
+   * Decodes the output of serialize().  Entries that cannot be decoded are
+   * skipped.
+   */
+  static std::vector<Entry> deserialize(folly::ByteRange bytes);
+
+  /**
+   * Returns the tool a process name identifies: its executable.  Returns an
+   * empty string for names that could not be read.
+   */
+  static std::string toolName(folly::StringPiece processName);
+
+ private:
+  struct Profile {
+    explicit Profile(size_t maxEntries) : entries{maxEntries} {}
+
+    /** Most recently fetched first. */
+    std::vector<Entry> snapshot() const;
+
+    folly::EvictingCacheMap<Hash, ObjectKind> entries;
+    size_t unsavedFetches{0};
+  };
+
+  struct State {
+    State(size_t maxProcesses, size_t maxEntries)
+        : toolNames{maxProcesses}, mountProfile{maxEntries} {}
+
+    /** The tool name of each process seen recently. */
+    folly::EvictingCacheMap<pid_t, std::string> toolNames;
+    std::unordered_map<std::string, Profile> profiles;
+    Profile mountProfile;
+  };
+
+  /**
+   * The key the profile for toolName is saved under.  The mount profile is
+   * saved under the empty tool name, which no process has.
+   */
+  std::string profileKey(folly::StringPiece toolName) const;
+
+  /** Fills the empty profile with the one saved for toolName, if any. */
+  void loadProfile(folly::StringPiece toolName, Profile& profile) const;
+
+  /**
+   * Records a fetch in profile, returning the serialized profile if it is
+   * due to be saved.
+   */
+  static std::optional<std::string>
+  addEntry(Profile& profile, ObjectKind kind, const Hash& id);
+
+  void saveProfile(const std::string& key, const std::string& bytes) const;
+
+  const std::shared_ptr<LocalStore> localStore_;
+  const std::shared_ptr<ProcessNameCache> processNameCache_;
+  const std::string scope_;
+  const size_t maxEntries_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace eden
+} // namespace facebook
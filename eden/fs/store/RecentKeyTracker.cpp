@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/RecentKeyTracker.h"
+
+#include <folly/Random.h>
+
+namespace facebook {
+namespace eden {
+
+RecentKeyTracker::RecentKeyTracker(size_t maxKeys, uint32_t sampleRate)
+    : sampleRate_{sampleRate}, keys_{folly::in_place, maxKeys} {}
+
+void RecentKeyTracker::recordAccess(folly::ByteRange key) {
+  if (sampleRate_ > 1 && !folly::Random::oneIn(sampleRate_)) {
+    return;
+  }
+  keys_.wlock()->set(folly::StringPiece{key}.str(), folly::unit);
+}
+
+bool RecentKeyTracker::wasRecentlyAccessed(folly::ByteRange key) const {
+  return keys_.rlock()->exists(folly::StringPiece{key}.str());
+}
+
+size_t RecentKeyTracker::size() const {
+  return keys_.rlock()->size();
+}
+
+} // namespace eden
+} // namespace facebook
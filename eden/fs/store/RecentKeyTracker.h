@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/Unit.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <string>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Remembers a sample of the keys most recently read or written in one
+ * LocalStore key space.
+ *
+ * Garbage collection uses this to evict the keys that have not been used
+ * recently rather than clearing the whole key space, so the objects that are
+ * in use do not all have to be refetched right after a collection.
+ *
+ * Only one in every sampleRate accesses is recorded.  Keys that are used
+ * often are still very likely to be recorded, and tracking stays cheap on
+ * the read path.  When more than maxKeys keys have been recorded the least
+ * recently recorded ones are forgotten.
+ *
+ * RecentKeyTracker is thread-safe.
+ */
+class RecentKeyTracker {
+ public:
+  RecentKeyTracker(size_t maxKeys, uint32_t sampleRate);
+
+  RecentKeyTracker(const RecentKeyTracker&) = delete;
+  RecentKeyTracker& operator=(const RecentKeyTracker&) = delete;
+
+  /** Records an access to key, subject to sampling. */
+  void recordAccess(folly::ByteRange key);
+
+  /** Returns true if a recent access to key was recorded. */
+  bool wasRecentlyAccessed(folly::ByteRange key) const;
+
+  size_t size() const;
+
+ private:
+  const uint32_t sampleRate_;
+  folly::Synchronized<folly::EvictingCacheMap<std::string, folly::Unit>>
+      keys_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -7,8 +7,12 @@
 
 #include "eden/fs/store/RocksDbLocalStore.h"
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <optional>
+#include <thread>
+#include <utility>
 
 #include <fb303/ServiceData.h>
 #include <folly/Format.h>
@@ -18,9 +22,12 @@
 #include <folly/io/IOBuf.h>
 #include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
+#include <folly/system/ThreadName.h>
+#include <rocksdb/cache.h>
 #include <rocksdb/convenience.h>
 #include <rocksdb/db.h>
 #include <rocksdb/filter_policy.h>
+#include <rocksdb/rate_limiter.h>
 #include <rocksdb/table.h>
 
 #include "eden/fs/config/EdenConfig.h"
@@ -43,15 +50,89 @@ using std::chrono::duration_cast;
 namespace {
 using namespace facebook::eden;
 
-rocksdb::ColumnFamilyOptions makeColumnOptions(uint64_t LRUblockCacheSizeMB) {
+/** RocksDB's default data block size. */
+constexpr size_t kDefaultBlockSize = 4 * 1024;
+
+/**
+ * How many recently used keys garbage collection remembers per ephemeral key
+ * space, and how often it samples accesses to them.
+ */
+constexpr size_t kMaxRecentKeysPerKeySpace = 64 * 1024;
+constexpr uint32_t kRecentKeySampleRate = 8;
+
+/** How many keys garbage collection deletes in each write batch. */
+constexpr size_t kEvictionBatchSize = 1024;
+
+/**
+ * Parse the name of a compression algorithm from the config.
+ *
+ * Returns std::nullopt for "default" or an unknown name, to keep the
+ * compression that OptimizeLevelStyleCompaction() picks.
+ */
+std::optional<rocksdb::CompressionType> parseCompression(
+    folly::StringPiece name) {
+  static const std::pair<folly::StringPiece, rocksdb::CompressionType>
+      kCompressionNames[] = {
+          {"none", rocksdb::kNoCompression},
+          {"snappy", rocksdb::kSnappyCompression},
+          {"lz4", rocksdb::kLZ4Compression},
+          {"lz4hc", rocksdb::kLZ4HCCompression},
+          {"zstd", rocksdb::kZSTD},
+      };
+  for (const auto& [compressionName, compression] : kCompressionNames) {
+    if (name == compressionName) {
+      return compression;
+    }
+  }
+  if (name != "default") {
+    XLOG(WARN) << "unknown RocksDB compression \"" << name
+               << "\"; using the default compression";
+  }
+  return std::nullopt;
+}
+
+/**
+ * Make the options for a column family whose data blocks are blockSize bytes
+ * and are cached in blockCache.
+ *
+ * If compression is set it is used for every level that
+ * OptimizeLevelStyleCompaction() would compress.
+ */
+rocksdb::ColumnFamilyOptions makeColumnOptions(
+    const EdenConfig& config,
+    const std::shared_ptr<rocksdb::Cache>& blockCache,
+    size_t blockSize,
+    std::optional<rocksdb::CompressionType> compression) {
   rocksdb::ColumnFamilyOptions options;
 
   // We'll never perform range scans on any of the keys that we store.
   // This enables bloom filters and a hash policy that improves our
-  // get/put performance.
-  options.OptimizeForPointLookup(LRUblockCacheSizeMB);
+  // get/put performance, as OptimizeForPointLookup() would, but with a
+  // block cache shared by all of the column families.
+  rocksdb::BlockBasedTableOptions tableOptions;
+  tableOptions.data_block_index_type =
+      rocksdb::BlockBasedTableOptions::kDataBlockBinaryAndHash;
+  tableOptions.data_block_hash_table_util_ratio = 0.75;
+  tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(
+      static_cast<int>(config.rocksDbBloomFilterBits.getValue())));
+  tableOptions.block_cache = blockCache;
+  tableOptions.block_size = blockSize;
+  options.table_factory.reset(
+      rocksdb::NewBlockBasedTableFactory(tableOptions));
+  options.memtable_prefix_bloom_size_ratio = 0.02;
+  options.memtable_whole_key_filtering = true;
 
   options.OptimizeLevelStyleCompaction();
+
+  if (compression) {
+    // OptimizeLevelStyleCompaction() leaves the first levels uncompressed
+    // since they are rewritten soon after being written.
+    options.compression = *compression;
+    for (size_t level = 2; level < options.compression_per_level.size();
+         ++level) {
+      options.compression_per_level[level] = *compression;
+    }
+  }
   return options;
 }
 
@@ -61,13 +142,36 @@ rocksdb::ColumnFamilyOptions makeColumnOptions(uint64_t LRUblockCacheSizeMB) {
  */
 const std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilies(
     const rocksdb::DBOptions& db_options,
-    const std::string& name) {
-  // Most of the column families will share the same cache.  We
-  // want the blob data to live in its own smaller cache; the assumption
-  // is that the vfs cache will compensate for that, together with the
-  // idea that we shouldn't need to materialize a great many files.
-  auto options = makeColumnOptions(64);
-  auto blobOptions = makeColumnOptions(8);
+    const std::string& name,
+    const EdenConfig& config) {
+  // All of the column families share one block cache, so that whichever
+  // of them is busiest can use the memory.
+  auto blockCache =
+      rocksdb::NewLRUCache(config.rocksDbBlockCacheSize.getValue());
+  auto options = makeColumnOptions(
+      config, blockCache, kDefaultBlockSize, /*compression=*/std::nullopt);
+  // File contents are large and compress well, so they get larger blocks
+  // and their own compression.
+  auto blobOptions = makeColumnOptions(
+      config,
+      blockCache,
+      config.rocksDbBlobBlockSize.getValue(),
+      parseCompression(config.rocksDbBlobCompression.getValue()));
+  // Proxy hashes are small and effectively random, so compressing them
+  // only costs CPU.
+  auto proxyHashOptions = makeColumnOptions(
+      config, blockCache, kDefaultBlockSize, rocksdb::kNoCompression);
+
+  auto optionsFor = [&](KeySpace ks) -> const rocksdb::ColumnFamilyOptions& {
+    if (ks->index == KeySpace::BlobFamily.index) {
+      return blobOptions;
+    }
+    if (ks->index == KeySpace::HgProxyHashFamily.index ||
+        ks->index == KeySpace::ScsProxyHashFamily.index) {
+      return proxyHashOptions;
+    }
+    return options;
+  };
 
   // We have to open all column families that currenly exists in our RocksDb.
   // Else we will get "Invalid argument: You have to open all column
@@ -80,9 +184,7 @@ const std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilies(
 
   std::vector<rocksdb::ColumnFamilyDescriptor> families;
   for (auto& ks : KeySpace::kAll) {
-    families.emplace_back(
-        ks->name.str(),
-        (ks->index == KeySpace::BlobFamily.index) ? blobOptions : options);
+    families.emplace_back(ks->name.str(), optionsFor(ks));
     auto oldFamily = find(
         oldUnopenedColumnFamilies.begin(),
         oldUnopenedColumnFamilies.end(),
@@ -134,6 +236,56 @@ rocksdb::Slice _createSlice(folly::ByteRange bytes) {
   return Slice(reinterpret_cast<const char*>(bytes.data()), bytes.size());
 }
 
+rocksdb::Options getRocksdbOptions(const EdenConfig& config) {
+  rocksdb::Options options;
+  // Optimize RocksDB. This is the easiest way to get RocksDB to perform well.
+  options.IncreaseParallelism();
+
+  // Keep background flushes and compactions from starving foreground I/O.
+  auto compactionRateLimit = config.rocksDbCompactionRateLimit.getValue();
+  if (compactionRateLimit > 0) {
+    options.rate_limiter.reset(rocksdb::NewGenericRateLimiter(
+        static_cast<int64_t>(compactionRateLimit)));
+  }
+
+  // Create the DB if it's not already present.
+  options.create_if_missing = true;
+  // Automatically create column families as we define new ones.
+  options.create_missing_column_families = true;
+
+  return options;
+}
+
+RocksHandles openDB(
+    AbsolutePathPiece path,
+    RocksDBOpenMode mode,
+    const EdenConfig& config) {
+  auto options = getRocksdbOptions(config);
+  const auto columnDescriptors = columnFamilies(
+      rocksdb::DBOptions{options}, path.stringPiece().str(), config);
+  try {
+    return RocksHandles(path.stringPiece(), mode, options, columnDescriptors);
+  } catch (const RocksException& ex) {
+    XLOG(ERR) << "Error opening RocksDB storage at " << path << ": "
+              << ex.what();
+    if (mode == RocksDBOpenMode::ReadOnly) {
+      // In read-only mode fail rather than attempting to repair the DB.
+      throw;
+    }
+    // Fall through and attempt to repair the DB
+  }
+
+  RocksDbLocalStore::repairDB(path, config);
+
+  // Now try opening the DB again.
+  return RocksHandles(path.stringPiece(), mode, options, columnDescriptors);
+}
+
+} // namespace
+
+namespace facebook {
+namespace eden {
+
 class RocksDbWriteBatch : public LocalStore::WriteBatch {
  public:
   void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
@@ -146,11 +298,13 @@ class RocksDbWriteBatch : public LocalStore::WriteBatch {
   ~RocksDbWriteBatch() override;
   // Use LocalStore::beginWrite() to create a write batch
   RocksDbWriteBatch(
+      RocksDbLocalStore& store,
       Synchronized<RocksHandles>::ConstRLockedPtr&& dbHandles,
       size_t bufferSize);
 
   void flushIfNeeded();
 
+  RocksDbLocalStore& store_;
   folly::Synchronized<RocksHandles>::ConstRLockedPtr lockedDB_;
   rocksdb::WriteBatch writeBatch_;
   size_t bufSize_;
@@ -185,9 +339,11 @@ void RocksDbWriteBatch::flushIfNeeded() {
 }
 
 RocksDbWriteBatch::RocksDbWriteBatch(
+    RocksDbLocalStore& store,
     Synchronized<RocksHandles>::ConstRLockedPtr&& dbHandles,
     size_t bufSize)
     : LocalStore::WriteBatch(),
+      store_(store),
       lockedDB_(std::move(dbHandles)),
       writeBatch_(bufSize),
       bufSize_(bufSize) {}
@@ -203,6 +359,11 @@ void RocksDbWriteBatch::put(
     KeySpace keySpace,
     folly::ByteRange key,
     folly::ByteRange value) {
+  store_.recordAccess(keySpace, key);
+  if (store_.isWrittenAsynchronously(keySpace)) {
+    store_.enqueueWrite(keySpace, key, folly::StringPiece{value}.str());
+    return;
+  }
   writeBatch_.Put(
       lockedDB_->columns[keySpace->index].get(),
       _createSlice(key),
@@ -215,6 +376,17 @@ void RocksDbWriteBatch::put(
     KeySpace keySpace,
     folly::ByteRange key,
     std::vector<folly::ByteRange> valueSlices) {
+  store_.recordAccess(keySpace, key);
+  if (store_.isWrittenAsynchronously(keySpace)) {
+    std::string value;
+    for (auto& valueSlice : valueSlices) {
+      value.append(
+          reinterpret_cast<const char*>(valueSlice.data()), valueSlice.size());
+    }
+    store_.enqueueWrite(keySpace, key, std::move(value));
+    return;
+  }
+
   std::vector<Slice> slices;
 
   for (auto& valueSlice : valueSlices) {
@@ -231,55 +403,29 @@ void RocksDbWriteBatch::put(
   flushIfNeeded();
 }
 
-rocksdb::Options getRocksdbOptions() {
-  rocksdb::Options options;
-  // Optimize RocksDB. This is the easiest way to get RocksDB to perform well.
-  options.IncreaseParallelism();
-
-  // Create the DB if it's not already present.
-  options.create_if_missing = true;
-  // Automatically create column families as we define new ones.
-  options.create_missing_column_families = true;
-
-  return options;
-}
-
-RocksHandles openDB(AbsolutePathPiece path, RocksDBOpenMode mode) {
-  auto options = getRocksdbOptions();
-  const auto columnDescriptors =
-      columnFamilies(rocksdb::DBOptions{options}, path.stringPiece().str());
-  try {
-    return RocksHandles(path.stringPiece(), mode, options, columnDescriptors);
-  } catch (const RocksException& ex) {
-    XLOG(ERR) << "Error opening RocksDB storage at " << path << ": "
-              << ex.what();
-    if (mode == RocksDBOpenMode::ReadOnly) {
-      // In read-only mode fail rather than attempting to repair the DB.
-      throw;
-    }
-    // Fall through and attempt to repair the DB
-  }
-
-  RocksDbLocalStore::repairDB(path);
-
-  // Now try opening the DB again.
-  return RocksHandles(path.stringPiece(), mode, options, columnDescriptors);
-}
-
-} // namespace
-
-namespace facebook {
-namespace eden {
-
 RocksDbLocalStore::RocksDbLocalStore(
     AbsolutePathPiece pathToRocksDb,
     std::shared_ptr<StructuredLogger> structuredLogger,
     FaultInjector* faultInjector,
+    const EdenConfig& config,
     RocksDBOpenMode mode)
     : structuredLogger_{std::move(structuredLogger)},
       faultInjector_(*faultInjector),
       ioPool_(12, "RocksLocalStore"),
-      dbHandles_(folly::in_place, openDB(pathToRocksDb, mode)) {
+      dbHandles_(folly::in_place, openDB(pathToRocksDb, mode, config)),
+      maxPendingWriteBytes_{
+          mode == RocksDBOpenMode::ReadOnly
+              ? 0
+              : config.localStoreMaxPendingWriteBytes.getValue()} {
+  for (const auto& ks : KeySpace::kAll) {
+    if (ks->isEphemeral()) {
+      recentKeys_[ks->index] = std::make_unique<RecentKeyTracker>(
+          kMaxRecentKeysPerKeySpace, kRecentKeySampleRate);
+    }
+  }
+  if (maxPendingWriteBytes_ > 0) {
+    writerThread_ = std::thread([this] { writerThread(); });
+  }
   // Publish fb303 stats once when we first open the DB.
   // These will be kept up-to-date later by the periodicManagementTask() call.
   computeStats(/*publish=*/true, /*config=*/nullptr);
@@ -291,6 +437,9 @@ RocksDbLocalStore::~RocksDbLocalStore() {
 }
 
 void RocksDbLocalStore::close() {
+  // Commit the queued writes before closing the DB.
+  stopWriterThread();
+
   // Acquire dbHandles_ in write-lock mode.
   // Since any other access to the DB acquires a read lock this will block until
   // all current DB operations are complete.
@@ -298,17 +447,19 @@ void RocksDbLocalStore::close() {
   handles->close();
 }
 
-void RocksDbLocalStore::repairDB(AbsolutePathPiece path) {
+void RocksDbLocalStore::repairDB(
+    AbsolutePathPiece path,
+    const EdenConfig& config) {
   XLOG(ERR) << "Attempting to repair RocksDB " << path;
   rocksdb::ColumnFamilyOptions unknownColumFamilyOptions;
   unknownColumFamilyOptions.OptimizeForPointLookup(8);
   unknownColumFamilyOptions.OptimizeLevelStyleCompaction();
 
   auto dbPathStr = path.stringPiece().str();
-  rocksdb::DBOptions dbOptions(getRocksdbOptions());
+  rocksdb::DBOptions dbOptions(getRocksdbOptions(config));
 
   const auto columnDescriptors =
-      columnFamilies(dbOptions, path.stringPiece().str());
+      columnFamilies(dbOptions, path.stringPiece().str(), config);
 
   auto status = RepairDB(
       dbPathStr, dbOptions, columnDescriptors, unknownColumFamilyOptions);
@@ -318,6 +469,10 @@ void RocksDbLocalStore::repairDB(AbsolutePathPiece path) {
 }
 
 void RocksDbLocalStore::clearKeySpace(KeySpace keySpace) {
+  // Otherwise queued writes could be committed after the key space is
+  // cleared.
+  flushPendingWrites();
+
   auto handles = getHandles();
   auto columnFamily = handles->columns[keySpace->index].get();
   std::unique_ptr<rocksdb::Iterator> it{
@@ -372,8 +527,43 @@ void RocksDbLocalStore::compactKeySpace(KeySpace keySpace) {
   }
 }
 
+void RocksDbLocalStore::forEachEntry(
+    KeySpace keySpace,
+    folly::FunctionRef<bool(ByteRange key, ByteRange value)> fn) const {
+  // A scan of a whole key space would otherwise evict the hot blocks.
+  ReadOptions readOptions;
+  readOptions.fill_cache = false;
+
+  auto handles = getHandles();
+  auto columnFamily = handles->columns[keySpace->index].get();
+  std::unique_ptr<rocksdb::Iterator> it{
+      handles->db->NewIterator(readOptions, columnFamily)};
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    auto key = it->key();
+    auto value = it->value();
+    if (!fn(ByteRange{folly::StringPiece{key.data(), key.size()}},
+            ByteRange{folly::StringPiece{value.data(), value.size()}})) {
+      return;
+    }
+  }
+  auto status = it->status();
+  if (!status.ok()) {
+    throw RocksException::build(
+        status,
+        "error iterating over \"",
+        columnFamily->GetName(),
+        "\" column family");
+  }
+}
+
 StoreResult RocksDbLocalStore::get(KeySpace keySpace, ByteRange key) const {
   auto handles = getHandles();
+  recordAccess(keySpace, key);
+  // Check the queued writes first: the writer thread only dequeues a write
+  // once it has been committed.
+  if (auto pending = getPendingWrite(keySpace, key)) {
+    return StoreResult(std::move(*pending));
+  }
   string value;
   auto status = handles->db->Get(
       ReadOptions(),
@@ -429,6 +619,7 @@ RocksDbLocalStore::getBatch(
   batches.emplace_back(std::make_shared<std::vector<std::string>>());
 
   for (auto& key : keys) {
+    recordAccess(keySpace, key);
     if (batches.back()->size() >= 2048) {
       batches.emplace_back(std::make_shared<std::vector<std::string>>());
     }
@@ -445,6 +636,11 @@ RocksDbLocalStore::getBatch(
                         keys = std::move(batch)](folly::Unit&&) {
               XLOG(DBG3) << __func__ << " starting to actually do work";
               auto handles = store->getHandles();
+              std::vector<std::optional<std::string>> pending;
+              for (auto& key : *keys) {
+                pending.push_back(store->getPendingWrite(
+                    keySpace, ByteRange{folly::StringPiece{key}}));
+              }
               std::vector<Slice> keySlices;
               std::vector<std::string> values;
               std::vector<rocksdb::ColumnFamilyHandle*> columns;
@@ -457,6 +653,10 @@ RocksDbLocalStore::getBatch(
 
               std::vector<StoreResult> results;
               for (size_t i = 0; i < keys->size(); ++i) {
+                if (pending[i]) {
+                  results.emplace_back(std::move(*pending[i]));
+                  continue;
+                }
                 auto& status = statuses[i];
                 if (!status.ok()) {
                   if (status.IsNotFound()) {
@@ -500,6 +700,10 @@ RocksDbLocalStore::getBatch(
 bool RocksDbLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key) const {
   string value;
   auto handles = getHandles();
+  recordAccess(keySpace, key);
+  if (getPendingWrite(keySpace, key)) {
+    return true;
+  }
   auto status = handles->db->Get(
       ReadOptions(),
       handles->columns[keySpace->index].get(),
@@ -523,7 +727,7 @@ bool RocksDbLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key) const {
 
 std::unique_ptr<LocalStore::WriteBatch> RocksDbLocalStore::beginWrite(
     size_t bufSize) {
-  return std::make_unique<RocksDbWriteBatch>(getHandles(), bufSize);
+  return std::make_unique<RocksDbWriteBatch>(*this, getHandles(), bufSize);
 }
 
 void RocksDbLocalStore::put(
@@ -531,6 +735,11 @@ void RocksDbLocalStore::put(
     folly::ByteRange key,
     folly::ByteRange value) {
   auto handles = getHandles();
+  recordAccess(keySpace, key);
+  if (isWrittenAsynchronously(keySpace)) {
+    enqueueWrite(keySpace, key, folly::StringPiece{value}.str());
+    return;
+  }
   handles->db->Put(
       WriteOptions(),
       handles->columns[keySpace->index].get(),
@@ -538,6 +747,98 @@ void RocksDbLocalStore::put(
       _createSlice(value));
 }
 
+uint64_t RocksDbLocalStore::evictColdKeys(
+    KeySpace keySpace,
+    uint64_t bytesToFree,
+    uint64_t maxDeletesPerSecond) {
+  auto& tracker = recentKeys_[keySpace->index];
+  if (!tracker) {
+    throw std::invalid_argument(folly::to<string>(
+        "cannot evict keys from persistent key space ", keySpace->name));
+  }
+
+  // Avoid filling the block cache with data that is about to be deleted.
+  ReadOptions readOptions;
+  readOptions.fill_cache = false;
+
+  std::string resumeKey;
+  bool resume = false;
+  uint64_t bytesFreed = 0;
+  auto startTime = std::chrono::steady_clock::now();
+  size_t keysDeleted = 0;
+  while (bytesFreed < bytesToFree) {
+    // Only hold the handles for one batch at a time, so that closing the
+    // store does not have to wait for the whole eviction.
+    rocksdb::WriteBatch batch;
+    bool exhausted = false;
+    {
+      auto handles = getHandles();
+      auto columnFamily = handles->columns[keySpace->index].get();
+      std::unique_ptr<rocksdb::Iterator> it{
+          handles->db->NewIterator(readOptions, columnFamily)};
+      if (resume) {
+        it->Seek(resumeKey);
+        if (it->Valid() && it->key() == Slice{resumeKey}) {
+          it->Next();
+        }
+      } else {
+        it->SeekToFirst();
+      }
+      for (; it->Valid() && batch.Count() < kEvictionBatchSize &&
+           bytesFreed < bytesToFree;
+           it->Next()) {
+        auto key = it->key();
+        if (tracker->wasRecentlyAccessed(ByteRange{
+                reinterpret_cast<const uint8_t*>(key.data()), key.size()})) {
+          continue;
+        }
+        batch.Delete(columnFamily, key);
+        bytesFreed += key.size() + it->value().size();
+      }
+      auto status = it->status();
+      if (!status.ok()) {
+        throw RocksException::build(
+            status,
+            "error iterating over \"",
+            columnFamily->GetName(),
+            "\" column family");
+      }
+      exhausted = !it->Valid();
+      if (!exhausted) {
+        resumeKey = it->key().ToString();
+        resume = true;
+      }
+
+      if (batch.Count() > 0) {
+        status = handles->db->Write(WriteOptions(), &batch);
+        if (!status.ok()) {
+          throw RocksException::build(
+              status,
+              "error evicting keys from \"",
+              columnFamily->GetName(),
+              "\" column family");
+        }
+      }
+    }
+    keysDeleted += batch.Count();
+
+    if (exhausted) {
+      break;
+    }
+    if (maxDeletesPerSecond > 0) {
+      auto earliestTime = startTime +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double>(
+                  static_cast<double>(keysDeleted) / maxDeletesPerSecond));
+      std::this_thread::sleep_until(earliestTime);
+    }
+  }
+
+  XLOG(DBG2) << "evicted " << keysDeleted << " keys (" << bytesFreed
+             << " bytes) from column family \"" << keySpace->name << "\"";
+  return bytesFreed;
+}
+
 uint64_t RocksDbLocalStore::getApproximateSize(KeySpace keySpace) const {
   auto handles = getHandles();
   uint64_t size = 0;
@@ -583,9 +884,49 @@ uint64_t RocksDbLocalStore::getApproximateSize(KeySpace keySpace) const {
   return size;
 }
 
+uint64_t RocksDbLocalStore::getMemoryUsage() const {
+  auto handles = dbHandles_.rlock();
+  if (!handles->db) {
+    return 0;
+  }
+
+  uint64_t memtableBytes = 0;
+  for (const auto& column : handles->columns) {
+    uint64_t size;
+    if (handles->db->GetIntProperty(
+            column.get(),
+            rocksdb::DB::Properties::kSizeAllMemTables,
+            &size)) {
+      memtableBytes += size;
+    }
+  }
+
+  // Every column family uses the same block cache, so its usage is only
+  // counted once.
+  uint64_t blockCacheBytes = 0;
+  if (!handles->columns.empty()) {
+    handles->db->GetIntProperty(
+        handles->columns[0].get(),
+        rocksdb::DB::Properties::kBlockCacheUsage,
+        &blockCacheBytes);
+  }
+
+  fb303::fbData->setCounter(
+      folly::to<string>(statsPrefix_, "memtable_bytes"), memtableBytes);
+  fb303::fbData->setCounter(
+      folly::to<string>(statsPrefix_, "block_cache_bytes"), blockCacheBytes);
+  return memtableBytes + blockCacheBytes;
+}
+
 void RocksDbLocalStore::periodicManagementTask(const EdenConfig& config) {
   enableBlobCaching.store(
       config.enableBlobCaching.getValue(), std::memory_order_relaxed);
+  dedupeBlobContents.store(
+      config.dedupeBlobContents.getValue(), std::memory_order_relaxed);
+  compressBlobs.store(
+      config.compressBlobs.getValue(), std::memory_order_relaxed);
+  chunkLargeBlobs.store(
+      config.chunkLargeBlobs.getValue(), std::memory_order_relaxed);
 
   // Compute and publish the stats
   auto before = computeStats(/*publish=*/true, &config);
@@ -606,7 +947,7 @@ void RocksDbLocalStore::periodicManagementTask(const EdenConfig& config) {
                << "ephemeral data sizes of columns " << keySpaceNames
                << " exceed their limits; total ephemeral size = "
                << before.ephemeral;
-    triggerAutoGC(before);
+    triggerAutoGC(before, config.localStoreGcMaxDeletesPerSecond.getValue());
   }
 }
 
@@ -623,8 +964,13 @@ RocksDbLocalStore::SizeSummary RocksDbLocalStore::computeStats(
     if (auto* ephemeral = std::get_if<Ephemeral>(&ks->persistence)) {
       result.ephemeral += size;
       if (config) {
-        if (size > (config->*(ephemeral->cacheLimit)).getValue()) {
+        auto limit = (config->*(ephemeral->cacheLimit)).getValue();
+        if (size > limit) {
           result.excessiveKeySpaces.set(ks->index);
+          auto lowWatermark = limit / 100 *
+              std::min<uint64_t>(
+                  config->localStoreGcLowWatermarkPercent.getValue(), 100);
+          result.bytesToFree[ks->index] = size - lowWatermark;
         }
       }
     } else if (!ks->isDeprecated()) {
@@ -651,7 +997,9 @@ RocksDbLocalStore::SizeSummary RocksDbLocalStore::computeStats(
 // code, but the gc operation can take a significant amount of time, and it
 // seems unfortunate to tie up one of the main pool threads for potentially
 // multiple minutes.
-void RocksDbLocalStore::triggerAutoGC(SizeSummary before) {
+void RocksDbLocalStore::triggerAutoGC(
+    SizeSummary before,
+    uint64_t maxDeletesPerSecond) {
   {
     auto state = autoGCState_.wlock();
     if (state->inProgress_) {
@@ -670,11 +1018,17 @@ void RocksDbLocalStore::triggerAutoGC(SizeSummary before) {
     state->inProgress_ = true;
   }
 
-  ioPool_.add([store = getSharedFromThis(), before] {
+  ioPool_.add([store = getSharedFromThis(), before, maxDeletesPerSecond] {
     try {
       for (auto& ks : KeySpace::kAll) {
         if (before.excessiveKeySpaces.test(ks->index)) {
-          store->clearKeySpace(ks);
+          auto bytesToFree = before.bytesToFree[ks->index];
+          auto bytesFreed =
+              store->evictColdKeys(ks, bytesToFree, maxDeletesPerSecond);
+          if (bytesFreed < bytesToFree) {
+            XLOG(WARN) << "only found " << bytesFreed << " of " << bytesToFree
+                       << " bytes of cold data to evict from " << ks->name;
+          }
           store->compactKeySpace(ks);
         }
       }
@@ -728,6 +1082,144 @@ void RocksDbLocalStore::autoGCFinished(
   }
 }
 
+void RocksDbLocalStore::recordAccess(KeySpace keySpace, folly::ByteRange key)
+    const {
+  if (auto& tracker = recentKeys_[keySpace->index]) {
+    tracker->recordAccess(key);
+  }
+}
+
+bool RocksDbLocalStore::isWrittenAsynchronously(KeySpace keySpace) const {
+  return maxPendingWriteBytes_ > 0 && keySpace->isEphemeral();
+}
+
+void RocksDbLocalStore::enqueueWrite(
+    KeySpace keySpace,
+    folly::ByteRange key,
+    std::string value) {
+  {
+    auto state = pendingWrites_.lock();
+    // Importers wait for the writer thread to catch up rather than letting
+    // the queue grow without bound.
+    writesCommitted_.wait(state.getUniqueLock(), [&] {
+      return state->shouldStop ||
+          state->queuedBytes + state->committingBytes < maxPendingWriteBytes_;
+    });
+    if (state->shouldStop) {
+      throwStoreClosedError();
+    }
+    auto [it, inserted] =
+        state->queued[keySpace->index].try_emplace(
+            folly::StringPiece{key}.str());
+    if (!inserted) {
+      state->queuedBytes -= it->first.size() + it->second.size();
+    }
+    it->second = std::move(value);
+    state->queuedBytes += it->first.size() + it->second.size();
+  }
+  newWriteOrStop_.notify_one();
+}
+
+std::optional<std::string> RocksDbLocalStore::getPendingWrite(
+    KeySpace keySpace,
+    folly::ByteRange key) const {
+  if (!isWrittenAsynchronously(keySpace)) {
+    return std::nullopt;
+  }
+  auto state = pendingWrites_.lock();
+  auto& queued = state->queued[keySpace->index];
+  auto it = queued.find(folly::StringPiece{key});
+  if (it != queued.end()) {
+    return it->second;
+  }
+  if (state->committing) {
+    auto& committing = (*state->committing)[keySpace->index];
+    it = committing.find(folly::StringPiece{key});
+    if (it != committing.end()) {
+      return it->second;
+    }
+  }
+  return std::nullopt;
+}
+
+void RocksDbLocalStore::flushPendingWrites() {
+  auto state = pendingWrites_.lock();
+  writesCommitted_.wait(state.getUniqueLock(), [&] {
+    return state->queuedBytes == 0 && !state->committing;
+  });
+}
+
+void RocksDbLocalStore::stopWriterThread() {
+  pendingWrites_.lock()->shouldStop = true;
+  newWriteOrStop_.notify_one();
+  // Wake any importers waiting for room in the queue.
+  writesCommitted_.notify_all();
+  if (writerThread_.joinable()) {
+    writerThread_.join();
+  }
+}
+
+void RocksDbLocalStore::writerThread() {
+  folly::setThreadName("RocksDbWriter");
+  while (true) {
+    std::shared_ptr<const PendingWriteMap> writes;
+    {
+      auto state = pendingWrites_.lock();
+      newWriteOrStop_.wait(state.getUniqueLock(), [&] {
+        return state->shouldStop || state->queuedBytes > 0;
+      });
+      if (state->queuedBytes == 0) {
+        // We were asked to stop and every queued write has been committed.
+        return;
+      }
+      writes = std::make_shared<const PendingWriteMap>(
+          std::exchange(state->queued, PendingWriteMap{}));
+      state->committing = writes;
+      state->committingBytes = std::exchange(state->queuedBytes, 0);
+    }
+
+    // Readers may look at the writes while they are being committed, but
+    // nothing modifies them until they have been.
+    try {
+      commitWrites(*writes);
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "error committing queued writes to the local store: "
+                << folly::exceptionStr(ex);
+    }
+
+    {
+      auto state = pendingWrites_.lock();
+      state->committing.reset();
+      state->committingBytes = 0;
+    }
+    writesCommitted_.notify_all();
+  }
+}
+
+void RocksDbLocalStore::commitWrites(const PendingWriteMap& writes) {
+  auto handles = getHandles();
+  rocksdb::WriteBatch batch;
+  for (const auto& ks : KeySpace::kAll) {
+    auto columnFamily = handles->columns[ks->index].get();
+    for (const auto& [key, value] : writes[ks->index]) {
+      batch.Put(columnFamily, key, value);
+    }
+  }
+  XLOG(DBG5) << "committing " << batch.Count()
+             << " queued writes with data size of " << batch.GetDataSize();
+
+  // Only the ephemeral key spaces are written asynchronously.  They are
+  // caches that can be repopulated from the backing store, so they can skip
+  // the write-ahead log.
+  WriteOptions options;
+  options.disableWAL = true;
+  auto status = handles->db->Write(options, &batch);
+  if (!status.ok()) {
+    throw RocksException::build(
+        status, "error committing queued writes to local store");
+  }
+}
+
 void RocksDbLocalStore::throwStoreClosedError() const {
   // It might be nicer to throw an EdenError exception here.
   // At the moment we don't simply due to library dependency ordering in the
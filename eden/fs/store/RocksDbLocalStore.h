@@ -8,19 +8,34 @@
 #pragma once
 
 #include <folly/CppAttributes.h>
+#include <folly/Function.h>
 #include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <array>
 #include <bitset>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
 
 #include "eden/fs/rocksdb/RocksHandles.h"
 #include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/RecentKeyTracker.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
 
 namespace facebook {
 namespace eden {
 
+class EdenConfig;
 class FaultInjector;
+class RocksDbWriteBatch;
 class StructuredLogger;
 
+using RecentKeyTrackers =
+    std::array<std::unique_ptr<RecentKeyTracker>, KeySpace::kTotalCount>;
+
 /** An implementation of LocalStore that uses RocksDB for the underlying
  * storage.
  */
@@ -29,11 +44,15 @@ class RocksDbLocalStore : public LocalStore {
   /**
    * The given FaultInjector must be valid during the lifetime of this
    * RocksDbLocalStore object.
+   *
+   * The RocksDB tuning settings in config are only read while the store is
+   * being opened.
    */
   explicit RocksDbLocalStore(
       AbsolutePathPiece pathToRocksDb,
       std::shared_ptr<StructuredLogger> structuredLogger,
       FaultInjector* FOLLY_NONNULL faultInjector,
+      const EdenConfig& config,
       RocksDBOpenMode mode = RocksDBOpenMode::ReadWrite);
   ~RocksDbLocalStore();
   void close() override;
@@ -52,14 +71,43 @@ class RocksDbLocalStore : public LocalStore {
   std::unique_ptr<WriteBatch> beginWrite(size_t bufSize = 0) override;
 
   // Call RocksDB's RepairDB() function on the DB at the specified location
-  static void repairDB(AbsolutePathPiece path);
+  static void repairDB(AbsolutePathPiece path, const EdenConfig& config);
+
+  /**
+   * Delete keys from an ephemeral key space that have not been used recently,
+   * until roughly bytesToFree bytes of keys and values have been deleted.
+   *
+   * At most maxDeletesPerSecond keys are deleted per second, or any number if
+   * it is 0.  Returns the number of bytes deleted.  The space is reclaimed
+   * when the key space is next compacted.
+   */
+  uint64_t evictColdKeys(
+      KeySpace keySpace,
+      uint64_t bytesToFree,
+      uint64_t maxDeletesPerSecond);
 
   // Get the approximate number of bytes stored on disk for the
   // specified key space.
   uint64_t getApproximateSize(KeySpace keySpace) const;
 
+  /**
+   * Call fn with the key and value of each entry in keySpace, in key order,
+   * until it returns false.  Writes still queued for the writer thread are
+   * not visited.
+   */
+  void forEachEntry(
+      KeySpace keySpace,
+      folly::FunctionRef<bool(folly::ByteRange key, folly::ByteRange value)>
+          fn) const;
+
   void periodicManagementTask(const EdenConfig& config) override;
 
+  /**
+   * The memory held by the memtables of every key space and by the block
+   * cache they share.
+   */
+  uint64_t getMemoryUsage() const override;
+
  private:
   /**
    * Get a pointer to the RocksHandles object in order to perform an I/O
@@ -76,7 +124,56 @@ class RocksDbLocalStore : public LocalStore {
     }
     return handles;
   }
+  friend class RocksDbWriteBatch;
+
+  /**
+   * The queued writes to each key space, indexed by key space.
+   */
+  using PendingWriteMap = std::array<
+      folly::F14NodeMap<std::string, std::string>,
+      KeySpace::kTotalCount>;
+
+  struct PendingWrites {
+    bool shouldStop = false;
+    /** Writes that the writer thread has not started committing yet. */
+    PendingWriteMap queued;
+    /** Writes that the writer thread is committing, if any. */
+    std::shared_ptr<const PendingWriteMap> committing;
+    /** Sums of the sizes of the keys and values in queued and committing. */
+    size_t queuedBytes = 0;
+    size_t committingBytes = 0;
+  };
+
   [[noreturn]] void throwStoreClosedError() const;
+  void recordAccess(KeySpace keySpace, folly::ByteRange key) const;
+
+  /**
+   * Returns true if writes to keySpace are queued for the writer thread
+   * rather than committed by the thread that makes them.
+   */
+  bool isWrittenAsynchronously(KeySpace keySpace) const;
+
+  /**
+   * Queue a write for the writer thread, waiting while the queue is full.
+   */
+  void
+  enqueueWrite(KeySpace keySpace, folly::ByteRange key, std::string value);
+
+  /**
+   * Returns the value of a write to key that is queued or being committed.
+   */
+  std::optional<std::string> getPendingWrite(
+      KeySpace keySpace,
+      folly::ByteRange key) const;
+
+  /**
+   * Wait until every write queued so far has been committed.
+   */
+  void flushPendingWrites();
+
+  void stopWriterThread();
+  void writerThread();
+  void commitWrites(const PendingWriteMap& writes);
   std::shared_ptr<RocksDbLocalStore> getSharedFromThis() {
     return std::static_pointer_cast<RocksDbLocalStore>(shared_from_this());
   }
@@ -104,6 +201,11 @@ class RocksDbLocalStore : public LocalStore {
      * cleared.
      */
     std::bitset<KeySpace::kTotalCount> excessiveKeySpaces;
+    /**
+     * How many bytes garbage collection should free from each of the
+     * excessive key spaces to bring it below its low watermark.
+     */
+    std::array<uint64_t, KeySpace::kTotalCount> bytesToFree{};
   };
 
   /**
@@ -112,7 +214,7 @@ class RocksDbLocalStore : public LocalStore {
    */
   SizeSummary computeStats(bool publish, const EdenConfig* config);
 
-  void triggerAutoGC(SizeSummary before);
+  void triggerAutoGC(SizeSummary before, uint64_t maxDeletesPerSecond);
   void autoGCFinished(bool successful, uint64_t ephemeralSizeBefore);
 
   std::shared_ptr<StructuredLogger> structuredLogger_;
@@ -120,7 +222,24 @@ class RocksDbLocalStore : public LocalStore {
   FaultInjector& faultInjector_;
   mutable UnboundedQueueExecutor ioPool_;
   folly::Synchronized<AutoGCState> autoGCState_;
+  /**
+   * The recently used keys of each ephemeral key space, indexed by key space.
+   * The entries for persistent key spaces are null.
+   */
+  RecentKeyTrackers recentKeys_;
   folly::Synchronized<RocksHandles> dbHandles_;
+
+  /**
+   * Writes to the ephemeral key spaces are queued and committed in batches
+   * by writerThread_, so that importers do not wait for RocksDB.  This
+   * bounds the size of the queue; it is 0 if writes are not queued.
+   */
+  const size_t maxPendingWriteBytes_;
+  mutable folly::Synchronized<PendingWrites, std::mutex> pendingWrites_;
+  std::condition_variable newWriteOrStop_;
+  /** Notified whenever the writer thread finishes committing a batch. */
+  std::condition_variable writesCommitted_;
+  std::thread writerThread_;
 };
 
 } // namespace eden
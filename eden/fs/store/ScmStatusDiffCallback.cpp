@@ -16,24 +16,46 @@
 
 namespace facebook {
 namespace eden {
+ScmStatusDiffCallback::ScmStatusDiffCallback()
+    : threadLocalEntries_{
+          [this] { return new ThreadLocalEntries{this}; }} {}
+
 void ScmStatusDiffCallback::ignoredFile(RelativePathPiece path) {
-  data_.wlock()->entries_ref()->emplace(
-      path.stringPiece().str(), ScmFileStatus::IGNORED);
+  addEntry(path, ScmFileStatus::IGNORED);
 }
 
 void ScmStatusDiffCallback::addedFile(RelativePathPiece path) {
-  data_.wlock()->entries_ref()->emplace(
-      path.stringPiece().str(), ScmFileStatus::ADDED);
+  addEntry(path, ScmFileStatus::ADDED);
 }
 
 void ScmStatusDiffCallback::removedFile(RelativePathPiece path) {
-  data_.wlock()->entries_ref()->emplace(
-      path.stringPiece().str(), ScmFileStatus::REMOVED);
+  addEntry(path, ScmFileStatus::REMOVED);
 }
 
 void ScmStatusDiffCallback::modifiedFile(RelativePathPiece path) {
-  data_.wlock()->entries_ref()->emplace(
-      path.stringPiece().str(), ScmFileStatus::MODIFIED);
+  addEntry(path, ScmFileStatus::MODIFIED);
+}
+
+void ScmStatusDiffCallback::addEntry(
+    RelativePathPiece path,
+    ScmFileStatus status) {
+  threadLocalEntries_->pending.lock()->emplace_back(
+      path.stringPiece().str(), status);
+}
+
+void ScmStatusDiffCallback::flush(ThreadLocalEntries& local) {
+  // Lock order: a thread's pending entries, then data_.
+  auto pending = local.pending.lock();
+  if (pending->empty()) {
+    return;
+  }
+  auto data = data_.wlock();
+  auto& entries = *data->entries_ref();
+  for (auto& [path, status] : *pending) {
+    // Keep the first status if a path is somehow reported twice.
+    entries.emplace(std::move(path), status);
+  }
+  pending->clear();
 }
 
 void ScmStatusDiffCallback::diffError(
@@ -53,6 +75,9 @@ void ScmStatusDiffCallback::diffError(
  * the diff operation has completed.
  */
 ScmStatus ScmStatusDiffCallback::extractStatus() {
+  for (auto& local : threadLocalEntries_.accessAllThreads()) {
+    flush(local);
+  }
   auto data = data_.wlock();
   return std::move(*data);
 }
@@ -7,8 +7,13 @@
 
 #pragma once
 #include <iosfwd>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
 
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
@@ -23,8 +28,18 @@ class Future;
 namespace facebook {
 namespace eden {
 
+/**
+ * Collects the results of a diff into a ScmStatus.
+ *
+ * The diff reports files from many threads at once.  Each thread appends
+ * them to its own buffer, and the buffers are merged into the ScmStatus
+ * when the diff completes, so that the threads do not contend on a single
+ * lock for every file.
+ */
 class ScmStatusDiffCallback : public DiffCallback {
  public:
+  ScmStatusDiffCallback();
+
   void ignoredFile(RelativePathPiece path) override;
   void addedFile(RelativePathPiece path) override;
   void removedFile(RelativePathPiece path) override;
@@ -43,7 +58,36 @@ class ScmStatusDiffCallback : public DiffCallback {
   ScmStatus extractStatus();
 
  private:
+  using Entries = std::vector<std::pair<std::string, ScmFileStatus>>;
+
+  struct ThreadLocalEntries {
+    explicit ThreadLocalEntries(ScmStatusDiffCallback* owner) : owner{owner} {}
+
+    ~ThreadLocalEntries() {
+      // This thread is going away, so merge what it collected.
+      owner->flush(*this);
+    }
+
+    ScmStatusDiffCallback* const owner;
+    /** Only contended while the entries are being merged. */
+    folly::Synchronized<Entries, std::mutex> pending;
+  };
+
+  class Tag {};
+
+  void addEntry(RelativePathPiece path, ScmFileStatus status);
+
+  /**
+   * Moves local's pending entries to data_.  Must not be called with data_
+   * locked.
+   */
+  void flush(ThreadLocalEntries& local);
+
+  // Declared before threadLocalEntries_ so that it outlives the flushes done
+  // when threadLocalEntries_ is destroyed.
   folly::Synchronized<ScmStatus> data_;
+  folly::ThreadLocal<ThreadLocalEntries, Tag, folly::AccessModeStrict>
+      threadLocalEntries_;
 };
 
 /**
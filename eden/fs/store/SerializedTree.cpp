@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/SerializedTree.h"
+
+#include <folly/Conv.h>
+#include <folly/Format.h>
+#include <folly/io/Cursor.h>
+#include <folly/lang/Bits.h>
+#include <cstring>
+#include <limits>
+
+#include "eden/fs/model/Tree.h"
+
+using folly::ByteRange;
+using folly::IOBuf;
+using folly::StringPiece;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr uint8_t kHasSize = 0x01;
+constexpr uint8_t kHasContentSha1 = 0x02;
+
+template <typename T>
+T loadLittleEndian(const uint8_t* data) {
+  T value;
+  memcpy(&value, data, sizeof(T));
+  return folly::Endian::little(value);
+}
+} // namespace
+
+bool SerializedTree::isSerializedTree(ByteRange data) {
+  return !data.empty() && data[0] == kVersion;
+}
+
+IOBuf SerializedTree::serialize(const Tree& tree) {
+  const auto& entries = tree.getTreeEntries();
+  size_t namesSize = 0;
+  for (const auto& entry : entries) {
+    namesSize += entry.getName().stringPiece().size();
+  }
+  CHECK_LE(entries.size(), std::numeric_limits<uint32_t>::max());
+  CHECK_LE(namesSize, std::numeric_limits<uint32_t>::max());
+
+  IOBuf buf(
+      IOBuf::CREATE, kHeaderSize + kRecordSize * entries.size() + namesSize);
+  folly::io::Appender appender(&buf, 0);
+  appender.writeLE<uint8_t>(kVersion);
+  appender.writeLE<uint32_t>(folly::to_narrow(entries.size()));
+
+  uint32_t nameOffset = 0;
+  for (const auto& entry : entries) {
+    auto name = entry.getName().stringPiece();
+    appender.writeLE<uint32_t>(nameOffset);
+    appender.writeLE<uint32_t>(folly::to_narrow(name.size()));
+    nameOffset += name.size();
+
+    const auto& size = entry.getSize();
+    const auto& contentSha1 = entry.getContentSha1();
+    appender.writeLE<uint8_t>(static_cast<uint8_t>(entry.getType()));
+    appender.writeLE<uint8_t>(
+        (size ? kHasSize : 0) | (contentSha1 ? kHasContentSha1 : 0));
+    appender.push(entry.getHash().getBytes());
+    appender.writeLE<uint64_t>(size.value_or(0));
+    appender.push(contentSha1.value_or(Hash{}).getBytes());
+  }
+  for (const auto& entry : entries) {
+    appender.push(ByteRange{entry.getName().stringPiece()});
+  }
+  return buf;
+}
+
+SerializedTree::SerializedTree(ByteRange data) {
+  if (data.size() < kHeaderSize) {
+    throw std::invalid_argument("serialized tree is missing its header");
+  }
+  if (data[0] != kVersion) {
+    throw std::invalid_argument(folly::sformat(
+        "serialized tree has unsupported version {}", data[0]));
+  }
+  numEntries_ = loadLittleEndian<uint32_t>(data.data() + sizeof(uint8_t));
+  data.advance(kHeaderSize);
+
+  if (data.size() / kRecordSize < numEntries_) {
+    throw std::invalid_argument(folly::sformat(
+        "serialized tree is too small to hold {} entries", numEntries_));
+  }
+  records_ = data.subpiece(0, numEntries_ * kRecordSize);
+  names_ = data.subpiece(numEntries_ * kRecordSize);
+
+  for (size_t i = 0; i < numEntries_; ++i) {
+    auto* record = getRecord(i);
+    auto offset = loadLittleEndian<uint32_t>(record);
+    auto length = loadLittleEndian<uint32_t>(record + sizeof(uint32_t));
+    if (offset > names_.size() || length > names_.size() - offset) {
+      throw std::invalid_argument(
+          folly::sformat("serialized tree entry {} has an invalid name", i));
+    }
+    auto type = record[2 * sizeof(uint32_t)];
+    if (type > static_cast<uint8_t>(TreeEntryType::SYMLINK)) {
+      throw std::invalid_argument(folly::sformat(
+          "serialized tree entry {} has unknown type {}", i, type));
+    }
+  }
+}
+
+const uint8_t* SerializedTree::getRecord(size_t index) const {
+  return records_.data() + index * kRecordSize;
+}
+
+StringPiece SerializedTree::getName(const uint8_t* record) const {
+  auto offset = loadLittleEndian<uint32_t>(record);
+  auto length = loadLittleEndian<uint32_t>(record + sizeof(uint32_t));
+  return StringPiece{names_.subpiece(offset, length)};
+}
+
+TreeEntry SerializedTree::getEntry(size_t index) const {
+  auto* record = getRecord(index);
+  auto name = getName(record);
+  record += 2 * sizeof(uint32_t);
+  auto type = static_cast<TreeEntryType>(record[0]);
+  auto flags = record[1];
+  record += 2 * sizeof(uint8_t);
+  Hash hash{ByteRange{record, Hash::RAW_SIZE}};
+  record += Hash::RAW_SIZE;
+
+  std::optional<uint64_t> size;
+  if (flags & kHasSize) {
+    size = loadLittleEndian<uint64_t>(record);
+  }
+  record += sizeof(uint64_t);
+  std::optional<Hash> contentSha1;
+  if (flags & kHasContentSha1) {
+    contentSha1 = Hash{ByteRange{record, Hash::RAW_SIZE}};
+  }
+  return TreeEntry{hash, name, type, size, contentSha1};
+}
+
+std::optional<TreeEntry> SerializedTree::find(PathComponentPiece name) const {
+  size_t begin = 0;
+  size_t end = numEntries_;
+  while (begin < end) {
+    auto middle = begin + (end - begin) / 2;
+    // PathComponents compare by their bytes, so this matches their order.
+    if (getName(getRecord(middle)) < name.stringPiece()) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  if (begin == numEntries_ || getName(getRecord(begin)) != name.stringPiece()) {
+    return std::nullopt;
+  }
+  return getEntry(begin);
+}
+
+std::unique_ptr<Tree> SerializedTree::toTree(const Hash& hash) const {
+  std::vector<TreeEntry> entries;
+  entries.reserve(numEntries_);
+  for (size_t i = 0; i < numEntries_; ++i) {
+    entries.push_back(getEntry(i));
+  }
+  return std::make_unique<Tree>(std::move(entries), hash);
+}
+
+} // namespace eden
+} // namespace facebook
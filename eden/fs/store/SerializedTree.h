@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <memory>
+#include <optional>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class Tree;
+
+/**
+ * A read-only view of a tree stored in the LocalStore's native tree format.
+ *
+ * Trees used to be stored as git tree objects, which have to be parsed entry
+ * by entry and have no room for the size and SHA-1 of each file. The native
+ * format is stored as:
+ * - the format version (1 byte, kVersion)
+ * - the number of entries (4 bytes)
+ * - one fixed-width record per entry, in the order of the tree's entries:
+ *   - the offset of the entry's name in the name table (4 bytes)
+ *   - the length of the entry's name (4 bytes)
+ *   - the TreeEntryType (1 byte)
+ *   - flags saying whether the size and SHA-1 are present (1 byte)
+ *   - the entry's hash (20 bytes)
+ *   - the file's size, or 0 if absent (8 bytes)
+ *   - the SHA-1 of the file's contents, or zeroes if absent (20 bytes)
+ * - the name table, holding all the names one after the other
+ *
+ * Integers are little endian. Git tree objects start with "tree ", so the
+ * first byte tells the two formats apart and trees stored by earlier versions
+ * remain readable.
+ */
+class SerializedTree {
+ public:
+  static constexpr uint8_t kVersion = 1;
+
+  /**
+   * Returns true if data is in the native format, and false if it must be
+   * read as a git tree object.
+   */
+  static bool isSerializedTree(folly::ByteRange data);
+
+  static folly::IOBuf serialize(const Tree& tree);
+
+  /**
+   * Wraps data, which must outlive the SerializedTree.
+   *
+   * Checks the record table and name offsets up front, and throws
+   * std::invalid_argument if data is malformed.
+   */
+  explicit SerializedTree(folly::ByteRange data);
+
+  size_t size() const {
+    return numEntries_;
+  }
+
+  TreeEntry getEntry(size_t index) const;
+
+  /**
+   * Binary searches the records for the entry with the given name, without
+   * decoding the other entries. Like Tree::getEntryPtr() this relies on the
+   * entries being sorted, but it is always case sensitive.
+   */
+  std::optional<TreeEntry> find(PathComponentPiece name) const;
+
+  std::unique_ptr<Tree> toTree(const Hash& hash) const;
+
+ private:
+  static constexpr size_t kHeaderSize = sizeof(uint8_t) + sizeof(uint32_t);
+  static constexpr size_t kRecordSize = 2 * sizeof(uint32_t) +
+      2 * sizeof(uint8_t) + Hash::RAW_SIZE + sizeof(uint64_t) + Hash::RAW_SIZE;
+
+  const uint8_t* getRecord(size_t index) const;
+  folly::StringPiece getName(const uint8_t* record) const;
+
+  folly::ByteRange records_;
+  folly::ByteRange names_;
+  size_t numEntries_;
+};
+
+} // namespace eden
+} // namespace facebook
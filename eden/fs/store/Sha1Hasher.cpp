@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/Sha1Hasher.h"
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/task_queue/UnboundedBlockingQueue.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <gflags/gflags.h>
+#include <algorithm>
+#include "eden/fs/model/Blob.h"
+
+DEFINE_int32(
+    num_sha1_threads,
+    4,
+    "the number of threads computing the SHA-1 of imported blobs and "
+    "materialized files");
+
+namespace facebook {
+namespace eden {
+
+Sha1Hasher::Sha1Hasher(size_t numThreads) {
+  // As for the import thread pools, the queue is unbounded so that a burst
+  // of imports can never fail or block the threads handing out work.
+  using HashQueue =
+      folly::UnboundedBlockingQueue<folly::CPUThreadPoolExecutor::CPUTask>;
+  threadPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+      std::max<size_t>(numThreads, 1),
+      std::make_unique<HashQueue>(),
+      std::make_shared<folly::NamedThreadFactory>("Sha1Hasher"));
+}
+
+Sha1Hasher::~Sha1Hasher() {
+  threadPool_->join();
+}
+
+Sha1Hasher& Sha1Hasher::get() {
+  // Leaked, so that it outlives anything still hashing at exit.
+  static auto* hasher =
+      new Sha1Hasher(static_cast<size_t>(std::max(FLAGS_num_sha1_threads, 1)));
+  return *hasher;
+}
+
+folly::SemiFuture<Hash> Sha1Hasher::sha1(std::shared_ptr<const Blob> blob) {
+  auto size = blob->getSize();
+  return compute(size, [blob = std::move(blob)] {
+    return Hash::sha1(blob->getContents());
+  });
+}
+
+folly::SemiFuture<Hash> Sha1Hasher::compute(
+    uint64_t size,
+    folly::Function<Hash()> fn) {
+  if (size < kMinPooledBytes) {
+    return folly::makeSemiFutureWith(std::move(fn));
+  }
+  return folly::via(threadPool_.get(), std::move(fn)).semi();
+}
+
+} // namespace eden
+} // namespace facebook
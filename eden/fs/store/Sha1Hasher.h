@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Function.h>
+#include <folly/futures/Future.h>
+#include <memory>
+#include "eden/fs/model/Hash.h"
+
+namespace folly {
+class CPUThreadPoolExecutor;
+}
+
+namespace facebook {
+namespace eden {
+
+class Blob;
+
+/**
+ * Computes SHA-1 hashes on a dedicated thread pool, so that hashing the
+ * contents of imported blobs and materialized files does not hold up the
+ * threads that import or serve them.  Concurrent requests are hashed in
+ * parallel, one per thread.
+ *
+ * Contents smaller than kMinPooledBytes are hashed on the calling thread,
+ * where it is cheaper than handing them to the pool, and the returned future
+ * is already complete.
+ *
+ * The hashing itself is OpenSSL's, which picks the fastest implementation the
+ * CPU supports, such as the SHA extensions, at runtime.
+ *
+ * Sha1Hasher is thread-safe.
+ */
+class Sha1Hasher {
+ public:
+  static constexpr size_t kMinPooledBytes = 8 * 1024;
+
+  explicit Sha1Hasher(size_t numThreads);
+  ~Sha1Hasher();
+
+  Sha1Hasher(const Sha1Hasher&) = delete;
+  Sha1Hasher& operator=(const Sha1Hasher&) = delete;
+
+  /**
+   * The hasher shared by the whole process.  Its size is set by
+   * --num_sha1_threads.
+   */
+  static Sha1Hasher& get();
+
+  /** Compute the SHA-1 of a blob's contents. */
+  folly::SemiFuture<Hash> sha1(std::shared_ptr<const Blob> blob);
+
+  /**
+   * Run a function that computes a hash some other way, such as
+   * incrementally from a file, on the pool.  size is the number of bytes it
+   * will hash; small jobs run on the calling thread.
+   */
+  folly::SemiFuture<Hash> compute(uint64_t size, folly::Function<Hash()> fn);
+
+ private:
+  std::unique_ptr<folly::CPUThreadPoolExecutor> threadPool_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -7,9 +7,11 @@
 
 #include "eden/fs/store/SqliteLocalStore.h"
 
+#include <folly/ExceptionString.h>
 #include <folly/String.h>
 #include <folly/container/Array.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
 
 #include "eden/fs/sqlite/Sqlite.h"
 #include "eden/fs/store/StoreResult.h"
@@ -23,6 +25,23 @@ using std::string;
 
 namespace {
 
+/**
+ * How much of the database each connection may memory map.  Reads of mapped
+ * pages avoid a copy through the page cache into sqlite's own buffers.
+ */
+constexpr int64_t kMmapSizeBytes = 256 * 1024 * 1024;
+
+/**
+ * How long a connection waits for a lock held by another connection, such
+ * as during a WAL checkpoint, before failing.
+ */
+constexpr int kBusyTimeoutMs = 5000;
+
+void configureConnection(folly::Synchronized<sqlite3*>::LockedPtr& db) {
+  SqliteStatement(db, "PRAGMA mmap_size=", kMmapSizeBytes).step();
+  SqliteStatement(db, "PRAGMA busy_timeout=", kBusyTimeoutMs).step();
+}
+
 /**
  * Implements the write batching helper.
  * In an ideal world, we'd just start a transaction and have the WriteBatch
@@ -101,14 +120,53 @@ class SqliteWriteBatch : public LocalStore::WriteBatch {
 
 } // namespace
 
-SqliteLocalStore::SqliteLocalStore(AbsolutePathPiece pathToDb)
+SqliteLocalStore::ReaderPool::ReaderPool(AbsolutePathPiece path, size_t count) {
+  count = std::max(count, size_t{1});
+  connections_.reserve(count);
+  while (connections_.size() < count) {
+    auto connection =
+        std::make_unique<SqliteDatabase>(path, SqliteOpenMode::ReadOnly);
+    auto db = connection->lock();
+    configureConnection(db);
+    db.unlock();
+    connections_.push_back(std::move(connection));
+  }
+}
+
+folly::Synchronized<sqlite3*>::LockedPtr SqliteLocalStore::ReaderPool::lock()
+    const {
+  auto start = next_.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = 0; i < connections_.size(); ++i) {
+    auto db = connections_[(start + i) % connections_.size()]->tryLock();
+    if (db) {
+      return db;
+    }
+  }
+  return connections_[start % connections_.size()]->lock();
+}
+
+void SqliteLocalStore::ReaderPool::close() {
+  for (auto& connection : connections_) {
+    connection->close();
+  }
+}
+
+SqliteLocalStore::SqliteLocalStore(
+    AbsolutePathPiece pathToDb,
+    size_t readerCount,
+    std::optional<AbsolutePath> sharedCachePath)
     : db_(SqliteDatabase(pathToDb)) {
   {
     auto db = db_.lock();
 
-    // Write ahead log for faster perf
+    // Write ahead log for faster perf, and so that the readers do not block
+    // on the writer.
     // https://www.sqlite.org/wal.html
     SqliteStatement(db, "PRAGMA journal_mode=WAL").step();
+    // In WAL mode this can lose the most recent writes on power loss, but
+    // never corrupts the database, which is fine for a cache.
+    SqliteStatement(db, "PRAGMA synchronous=NORMAL").step();
+    configureConnection(db);
 
     for (const auto& ks : KeySpace::kAll) {
       SqliteStatement(
@@ -124,10 +182,46 @@ SqliteLocalStore::SqliteLocalStore(AbsolutePathPiece pathToDb)
     }
   }
 
+  // The readers are opened once the tables exist, since a read-only
+  // connection cannot create them.
+  readers_ = std::make_unique<ReaderPool>(pathToDb, readerCount);
+  if (sharedCachePath) {
+    openSharedCache(*sharedCachePath, readerCount);
+  }
+
   clearDeprecatedKeySpaces();
 }
 
+void SqliteLocalStore::openSharedCache(
+    AbsolutePathPiece path,
+    size_t readerCount) {
+  try {
+    auto sharedCache = std::make_unique<ReaderPool>(path, readerCount);
+    auto db = sharedCache->lock();
+    SqliteStatement stmt(
+        db, "select name from sqlite_master where type = 'table'");
+    while (stmt.step()) {
+      auto name = stmt.columnBlob(0);
+      for (const auto& ks : KeySpace::kAll) {
+        if (name == ks->name) {
+          sharedKeySpaces_[ks->index] = true;
+        }
+      }
+    }
+    db.unlock();
+    sharedCache_ = std::move(sharedCache);
+    XLOG(INFO) << "using the shared local store cache at " << path;
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "unable to open the shared local store cache at " << path
+               << ": " << folly::exceptionStr(ex);
+  }
+}
+
 void SqliteLocalStore::close() {
+  if (sharedCache_) {
+    sharedCache_->close();
+  }
+  readers_->close();
   db_.close();
 }
 
@@ -141,8 +235,21 @@ void SqliteLocalStore::clearKeySpace(KeySpace keySpace) {
 void SqliteLocalStore::compactKeySpace(KeySpace) {}
 
 StoreResult SqliteLocalStore::get(KeySpace keySpace, ByteRange key) const {
-  auto db = db_.lock();
+  auto result = [&] {
+    auto db = readers_->lock();
+    return getFrom(db, keySpace, key);
+  }();
+  if (!result.isValid() && canUseSharedCache(keySpace)) {
+    auto db = sharedCache_->lock();
+    result = getFrom(db, keySpace, key);
+  }
+  return result;
+}
 
+StoreResult SqliteLocalStore::getFrom(
+    folly::Synchronized<sqlite3*>::LockedPtr& db,
+    KeySpace keySpace,
+    ByteRange key) {
   SqliteStatement stmt(
       db, "select value from ", keySpace->name, " where key = ?");
 
@@ -159,12 +266,24 @@ StoreResult SqliteLocalStore::get(KeySpace keySpace, ByteRange key) const {
 }
 
 bool SqliteLocalStore::hasKey(KeySpace keySpace, ByteRange key) const {
-  auto db = db_.lock();
-
-  SqliteStatement stmt(db, "select 1 from ", keySpace->name, " where key = ?");
+  {
+    auto db = readers_->lock();
+    SqliteStatement stmt(
+        db, "select 1 from ", keySpace->name, " where key = ?");
+    stmt.bind(1, key);
+    if (stmt.step()) {
+      return true;
+    }
+  }
 
-  stmt.bind(1, key);
-  return stmt.step();
+  if (canUseSharedCache(keySpace)) {
+    auto db = sharedCache_->lock();
+    SqliteStatement stmt(
+        db, "select 1 from ", keySpace->name, " where key = ?");
+    stmt.bind(1, key);
+    return stmt.step();
+  }
+  return false;
 }
 
 void SqliteLocalStore::put(KeySpace keySpace, ByteRange key, ByteRange value) {
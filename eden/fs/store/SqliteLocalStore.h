@@ -7,6 +7,11 @@
 
 #pragma once
 #include <folly/Synchronized.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
 #include "eden/fs/sqlite/Sqlite.h"
 #include "eden/fs/store/LocalStore.h"
 
@@ -16,10 +21,30 @@ namespace eden {
 /** An implementation of LocalStore that stores values in Sqlite.
  * SqliteLocalStore is thread safe, allowing reads and writes from
  * any thread.
+ *
+ * Writes go through a single connection, while reads are spread across a
+ * pool of read-only connections so that they can run in parallel with each
+ * other and with writes.  The database is in WAL mode and memory mapped.
+ *
+ * A store can optionally consult a shared cache: another SqliteLocalStore
+ * database, typically populated by a different eden daemon on the same host.
+ * Lookups that miss in the store are tried there before going to the
+ * backing store.  The shared cache is only ever read.
  * */
 class SqliteLocalStore : public LocalStore {
  public:
-  explicit SqliteLocalStore(AbsolutePathPiece pathToDb);
+  static constexpr size_t kDefaultReaderCount = 4;
+
+  /**
+   * Open the store at pathToDb, creating it if needed, with readerCount
+   * read-only connections.  If sharedCachePath is set, the existing database
+   * there is opened read-only as the shared cache.  Failing to open the
+   * shared cache is logged and otherwise ignored.
+   */
+  explicit SqliteLocalStore(
+      AbsolutePathPiece pathToDb,
+      size_t readerCount = kDefaultReaderCount,
+      std::optional<AbsolutePath> sharedCachePath = std::nullopt);
   void close() override;
   void clearKeySpace(KeySpace keySpace) override;
   void compactKeySpace(KeySpace keySpace) override;
@@ -31,7 +56,38 @@ class SqliteLocalStore : public LocalStore {
       size_t bufSize = 0) override;
 
  private:
+  /** A set of read-only connections to one database. */
+  class ReaderPool {
+   public:
+    ReaderPool(AbsolutePathPiece path, size_t count);
+
+    /** Lock an idle connection, or wait for one if they are all busy. */
+    folly::Synchronized<sqlite3*>::LockedPtr lock() const;
+
+    void close();
+
+   private:
+    std::vector<std::unique_ptr<SqliteDatabase>> connections_;
+    mutable std::atomic<size_t> next_{0};
+  };
+
+  void openSharedCache(AbsolutePathPiece path, size_t readerCount);
+
+  /** Look up key in db, which must have a table for keySpace. */
+  static StoreResult getFrom(
+      folly::Synchronized<sqlite3*>::LockedPtr& db,
+      KeySpace keySpace,
+      folly::ByteRange key);
+
+  bool canUseSharedCache(KeySpace keySpace) const {
+    return sharedCache_ && sharedKeySpaces_[keySpace->index];
+  }
+
   mutable SqliteDatabase db_;
+  std::unique_ptr<ReaderPool> readers_;
+  std::unique_ptr<ReaderPool> sharedCache_;
+  /** Which key spaces have a table in the shared cache. */
+  std::array<bool, KeySpace::kTotalCount> sharedKeySpaces_{};
 };
 
 } // namespace eden
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "TreeCache.h"
+#include <folly/MapUtil.h>
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/utils/IDGen.h"
+
+namespace facebook {
+namespace eden {
+
+TreeInterestHandle::TreeInterestHandle(
+    std::weak_ptr<TreeCache> treeCache,
+    const Hash& hash,
+    std::weak_ptr<const Tree> tree,
+    uint64_t generation) noexcept
+    : treeCache_{std::move(treeCache)},
+      hash_{hash},
+      tree_{std::move(tree)},
+      cacheItemGeneration_{generation} {}
+
+void TreeInterestHandle::reset() noexcept {
+  if (auto treeCache = treeCache_.lock()) {
+    treeCache->dropInterestHandle(hash_, cacheItemGeneration_);
+  }
+  treeCache_.reset();
+}
+
+std::shared_ptr<const Tree> TreeInterestHandle::getTree() const {
+  auto treeCache = treeCache_.lock();
+  if (treeCache) {
+    // UnlikelyNeededAgain because there's no need to create a new interest
+    // handle nor bump the refcount.
+    auto tree =
+        treeCache->get(hash_, TreeCache::Interest::UnlikelyNeededAgain).tree;
+    if (tree) {
+      return tree;
+    }
+  }
+
+  // If the tree is no longer in cache, at least see if it's still in memory.
+  return tree_.lock();
+}
+
+std::shared_ptr<TreeCache> TreeCache::create(
+    size_t maximumCacheSizeBytes,
+    size_t minimumEntryCount) {
+  // Allow make_shared with private constructor.
+  struct BC : TreeCache {
+    BC(size_t x, size_t y) : TreeCache{x, y} {}
+  };
+  return std::make_shared<BC>(maximumCacheSizeBytes, minimumEntryCount);
+}
+
+TreeCache::TreeCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount)
+    : maximumCacheSizeBytes_{maximumCacheSizeBytes},
+      minimumEntryCount_{minimumEntryCount} {}
+
+TreeCache::~TreeCache() {}
+
+TreeCache::GetResult TreeCache::get(const Hash& hash, Interest interest) {
+  XLOG(DBG6) << "TreeCache::get " << hash;
+
+  // Acquires TreeCache's lock upon destruction by calling dropInterestHandle,
+  // so ensure that, if an exception is thrown below, the ~TreeInterestHandle
+  // runs after the lock is released.
+  TreeInterestHandle interestHandle;
+
+  auto state = state_.wlock();
+
+  auto* item = folly::get_ptr(state->items, hash);
+  if (!item) {
+    XLOG(DBG6) << "TreeCache::get missed";
+    ++state->missCount;
+    return GetResult{};
+  }
+
+  switch (interest) {
+    case Interest::UnlikelyNeededAgain:
+      interestHandle.tree_ = item->tree;
+      break;
+    case Interest::WantHandle:
+      interestHandle = TreeInterestHandle{
+          shared_from_this(), hash, item->tree, item->generation};
+      ++item->referenceCount;
+      break;
+    case Interest::LikelyNeededAgain:
+      interestHandle.tree_ = item->tree;
+      // Bump the reference count without allocating an interest handle - this
+      // will cause the reference count to never reach zero, avoiding early
+      // eviction.
+      //
+      // TODO: One possible optimization here is to set a bit (reference count
+      // to UINT64_MAX) after which new interest handles never need to be
+      // created.
+      ++item->referenceCount;
+      break;
+  }
+
+  XLOG(DBG6) << "TreeCache::get hit";
+
+  // TODO: Should we avoid promoting if interest is UnlikelyNeededAgain?
+  // For now, we'll try not to be too clever.
+  state->evictionQueue.splice(
+      state->evictionQueue.end(), state->evictionQueue, item->index);
+  ++state->hitCount;
+  return GetResult{item->tree, std::move(interestHandle)};
+}
+
+TreeCache::GetResult TreeCache::getLive(const Hash& hash, Interest interest) {
+  auto result = get(hash, interest);
+  if (result.tree) {
+    return result;
+  }
+
+  TreePtr tree;
+  {
+    auto state = state_.wlock();
+    auto it = state->evicted.find(hash);
+    if (it == state->evicted.end()) {
+      return result;
+    }
+    tree = it->second.lock();
+    state->evicted.erase(it);
+    if (!tree) {
+      return result;
+    }
+    ++state->liveHitCount;
+  }
+
+  XLOG(DBG6) << "TreeCache::getLive found evicted tree " << hash;
+  auto interestHandle = insert(tree, interest);
+  return GetResult{std::move(tree), std::move(interestHandle)};
+}
+
+TreeInterestHandle TreeCache::insert(
+    std::shared_ptr<const Tree> tree,
+    Interest interest) {
+  XLOG(DBG6) << "TreeCache::insert " << tree->getHash();
+
+  // Acquires TreeCache's lock upon destruction by calling dropInterestHandle,
+  // so ensure that, if an exception is thrown below, the ~TreeInterestHandle
+  // runs after the lock is released.
+  TreeInterestHandle interestHandle;
+
+  auto hash = tree->getHash();
+  auto size = tree->getSizeBytes();
+
+  auto cacheItemGeneration = generateUniqueID();
+
+  if (interest == Interest::WantHandle) {
+    // This can throw, so do it before inserting into items.
+    interestHandle =
+        TreeInterestHandle{shared_from_this(), hash, tree, cacheItemGeneration};
+  } else {
+    interestHandle.tree_ = tree;
+  }
+
+  XLOG(DBG6) << "  creating entry with generation=" << cacheItemGeneration;
+
+  auto state = state_.wlock();
+  auto [iter, inserted] = state->items.try_emplace(
+      hash, std::move(tree), size, cacheItemGeneration);
+  // noexcept from here until `try`
+  switch (interest) {
+    case Interest::UnlikelyNeededAgain:
+      break;
+    case Interest::WantHandle:
+    case Interest::LikelyNeededAgain:
+      ++iter->second.referenceCount;
+      break;
+  }
+  auto* itemPtr = &iter->second;
+  if (inserted) {
+    try {
+      state->evictionQueue.push_back(itemPtr);
+    } catch (std::exception&) {
+      state->items.erase(iter);
+      throw;
+    }
+    iter->second.index = std::prev(state->evictionQueue.end());
+    state->totalSize += size;
+    state->evicted.erase(hash);
+    evictUntilFits(*state);
+  } else {
+    XLOG(DBG6) << "  duplicate entry, using generation " << itemPtr->generation;
+    // Inserting duplicate entry - use its generation.
+    interestHandle.cacheItemGeneration_ = itemPtr->generation;
+    state->evictionQueue.splice(
+        state->evictionQueue.end(), state->evictionQueue, itemPtr->index);
+  }
+  return interestHandle;
+}
+
+bool TreeCache::contains(const Hash& hash) const {
+  auto state = state_.rlock();
+  return 1 == state->items.count(hash);
+}
+
+void TreeCache::clear() {
+  XLOG(DBG6) << "TreeCache::clear";
+  auto state = state_.wlock();
+  state->totalSize = 0;
+  state->items.clear();
+  state->evictionQueue.clear();
+  state->evicted.clear();
+}
+
+TreeCache::Stats TreeCache::getStats() const {
+  auto state = state_.rlock();
+  Stats stats;
+  stats.treeCount = state->items.size();
+  stats.totalSizeInBytes = state->totalSize;
+  stats.hitCount = state->hitCount;
+  stats.missCount = state->missCount;
+  stats.evictionCount = state->evictionCount;
+  stats.dropCount = state->dropCount;
+  stats.liveHitCount = state->liveHitCount;
+  return stats;
+}
+
+std::vector<Hash> TreeCache::getCachedHashes() const {
+  auto state = state_.rlock();
+  std::vector<Hash> hashes;
+  hashes.reserve(state->evictionQueue.size());
+  for (auto it = state->evictionQueue.rbegin();
+       it != state->evictionQueue.rend();
+       ++it) {
+    hashes.push_back((*it)->tree->getHash());
+  }
+  return hashes;
+}
+
+void TreeCache::dropInterestHandle(
+    const Hash& hash,
+    uint64_t generation) noexcept {
+  XLOG(DBG6) << "dropInterestHandle " << hash << " generation=" << generation;
+  auto state = state_.wlock();
+
+  auto* item = folly::get_ptr(state->items, hash);
+  if (!item) {
+    // Cached item already evicted.
+    return;
+  }
+
+  if (generation != item->generation) {
+    // Item was evicted and re-added between creating and dropping the interest
+    // handle.
+    return;
+  }
+
+  if (item->referenceCount == 0) {
+    XLOG(WARN)
+        << "Reference count on item for " << hash
+        << " was already zero: an exception must have been thrown during get()";
+    return;
+  }
+
+  if (--item->referenceCount == 0) {
+    state->evictionQueue.erase(item->index);
+    ++state->dropCount;
+    evictItem(*state, item);
+  }
+}
+
+void TreeCache::evictUntilFits(State& state) noexcept {
+  XLOG(DBG6) << "state.totalSize=" << state.totalSize
+             << ", maximumCacheSizeBytes_=" << maximumCacheSizeBytes_
+             << ", evictionQueue.size()=" << state.evictionQueue.size()
+             << ", minimumEntryCount_=" << minimumEntryCount_;
+  while (state.totalSize > maximumCacheSizeBytes_ &&
+         state.evictionQueue.size() > minimumEntryCount_) {
+    evictOne(state);
+  }
+}
+
+void TreeCache::evictOne(State& state) noexcept {
+  CacheItem* front = state.evictionQueue.front();
+  state.evictionQueue.pop_front();
+  ++state.evictionCount;
+  evictItem(state, front);
+}
+
+void TreeCache::evictItem(State& state, CacheItem* item) noexcept {
+  XLOG(DBG6) << "evicting " << item->tree->getHash()
+             << " generation=" << item->generation;
+  auto size = item->size;
+  if (item->tree.use_count() > 1) {
+    rememberEvicted(state, item->tree);
+  }
+  // TODO: Releasing this TreePtr here can run arbitrary deleters which could,
+  // in theory, try to reacquire the TreeCache's lock. The tree could be
+  // scheduled for deletion in a deletion queue but then it's hard to ensure
+  // that scheduling is noexcept. Instead, TreePtr should be replaced with an
+  // refcounted pointer that doesn't allow running custom deleters.
+  state.items.erase(item->tree->getHash());
+  state.totalSize -= size;
+}
+
+void TreeCache::rememberEvicted(State& state, const TreePtr& tree) noexcept {
+  try {
+    state.evicted.insert_or_assign(tree->getHash(), tree);
+  } catch (const std::exception&) {
+    // This is only an optimization, so it is fine to forget the tree.
+    return;
+  }
+  if (state.evicted.size() < state.evictedPruneSize) {
+    return;
+  }
+
+  // Dropping an expired weak_ptr never runs a Tree's deleter, so this is
+  // safe with the lock held.
+  for (auto it = state.evicted.begin(); it != state.evicted.end();) {
+    if (it->second.expired()) {
+      it = state.evicted.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Grow the threshold with the live entries, so pruning stays amortized
+  // constant time per eviction.
+  state.evictedPruneSize =
+      std::max(kMinEvictedPruneSize, 2 * state.evicted.size());
+}
+
+} // namespace eden
+} // namespace facebook
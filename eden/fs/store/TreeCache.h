@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+class Tree;
+class TreeCache;
+
+/**
+ * Cache lookups return a TreeInterestHandle which should be held as long as the
+ * tree remains interesting.
+ */
+class TreeInterestHandle {
+ public:
+  TreeInterestHandle() noexcept = default;
+
+  ~TreeInterestHandle() noexcept {
+    reset();
+  }
+
+  TreeInterestHandle(TreeInterestHandle&& other) noexcept = default;
+  TreeInterestHandle& operator=(TreeInterestHandle&& other) noexcept = default;
+
+  /**
+   * If this is a valid interest handle, and the tree is still in cache, return
+   * the corresponding tree and move it to the back of the eviction queue.
+   *
+   * Otherwise, return nullptr.
+   */
+  std::shared_ptr<const Tree> getTree() const;
+
+  void reset() noexcept;
+
+ private:
+  TreeInterestHandle(
+      std::weak_ptr<TreeCache> treeCache,
+      const Hash& hash,
+      std::weak_ptr<const Tree> tree,
+      uint64_t generation) noexcept;
+
+  std::weak_ptr<TreeCache> treeCache_;
+
+  // hash_ is only accessed if treeCache_ is non-expired.
+  Hash hash_;
+
+  // In the situation that the Tree exists even if it's been evicted, allow
+  // retrieving it anyway.
+  std::weak_ptr<const Tree> tree_;
+
+  // Only causes eviction if this matches the corresponding
+  // CacheItem::generation.
+  uint64_t cacheItemGeneration_{0};
+
+  friend class TreeCache;
+};
+
+/**
+ * An in-memory LRU cache for decoded trees, which avoids deserializing the
+ * same hot trees from the LocalStore over and over. It is parameterized by
+ * both a maximum cache size and a minimum entry count. The cache tries to
+ * evict entries when the total size of loaded trees exceeds the maximum cache
+ * size, except that it always keeps the minimum entry count around.
+ *
+ * The intent of the minimum entry count is to avoid having to reload
+ * frequently-accessed large trees when they are larger than the maximum cache
+ * size.
+ *
+ * It is safe to use this object from arbitrary threads.
+ */
+class TreeCache : public std::enable_shared_from_this<TreeCache> {
+ public:
+  using TreePtr = std::shared_ptr<const Tree>;
+
+  enum class Interest {
+    /**
+     * Will return a tree if it is cached, but not add a reference to it nor
+     * move it to the back of the eviction queue.
+     */
+    UnlikelyNeededAgain,
+
+    /**
+     * If a tree is cached, its reference count is incremented and a handle is
+     * returned that, when dropped, releases the reference and evicts the item
+     * from cache. Intended for satisfying a series of lookups from cache until
+     * the inode is unloaded, after which the tree can evicted from cache,
+     * freeing space.
+     */
+    WantHandle,
+
+    /**
+     * If a tree is cached, its reference count is incremented, but no interest
+     * handle is returned. It is assumed to be worth caching until it is
+     * naturally evicted.
+     */
+    LikelyNeededAgain,
+  };
+
+  struct GetResult {
+    TreePtr tree;
+    TreeInterestHandle interestHandle;
+
+    GetResult(GetResult&&) = default;
+    GetResult& operator=(GetResult&&) = default;
+  };
+
+  struct Stats {
+    size_t treeCount{0};
+    size_t totalSizeInBytes{0};
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+    uint64_t evictionCount{0};
+    uint64_t dropCount{0};
+    /// getLive() calls answered by an evicted tree that was still alive.
+    uint64_t liveHitCount{0};
+  };
+
+  static std::shared_ptr<TreeCache> create(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount);
+  ~TreeCache();
+
+  /**
+   * If a tree for the given hash is in cache, return it. If the tree is not in
+   * cache, return nullptr (and an empty interest handle).
+   *
+   * If a tree is returned and interest is WantHandle, then a movable handle
+   * object is also returned. When the interest handle is destroyed, the cached
+   * tree may be evicted.
+   *
+   * After fetching a tree, prefer calling getTree() on the returned
+   * TreeInterestHandle first. It can avoid some overhead or return a tree if
+   * it still exists in memory and the TreeCache has evicted its reference.
+   */
+  GetResult get(
+      const Hash& hash,
+      Interest interest = Interest::LikelyNeededAgain);
+
+  /**
+   * Like get(), but on a miss also returns the tree if it was evicted while
+   * something outside the cache still referenced it and is still alive, and
+   * re-inserts it.
+   *
+   * The cache is shared by every mount, so this lets a checkout of the same
+   * repository reuse a tree that another checkout is holding, such as during
+   * a concurrent checkout or diff, without loading and decoding a second
+   * copy.
+   */
+  GetResult getLive(
+      const Hash& hash,
+      Interest interest = Interest::LikelyNeededAgain);
+
+  /**
+   * Inserts a tree into the cache for future lookup. The size of a tree is
+   * estimated with Tree::getSizeBytes(). If the new total size
+   * exceeds the maximum cache size and the minimum entry count, old entries are
+   * evicted.
+   *
+   * Optionally returns an interest handle that, when dropped, evicts the
+   * inserted tree.
+   */
+  TreeInterestHandle insert(
+      TreePtr tree,
+      Interest interest = Interest::LikelyNeededAgain);
+
+  /**
+   * Returns true if the cache contains a tree for the given hash.
+   */
+  bool contains(const Hash& hash) const;
+
+  /**
+   * Evicts everything from cache.
+   */
+  void clear();
+
+  /**
+   * Return information about the current size of the cache and the total number
+   * of hits and misses.
+   */
+  Stats getStats() const;
+
+  /**
+   * Return the hashes of the cached trees, most recently used first.
+   */
+  std::vector<Hash> getCachedHashes() const;
+
+ private:
+  struct CacheItem {
+    // WARNING: leaves index unset. Since the items map and evictionQueue are
+    // circular, initialization of index must happen after the CacheItem is
+    // constructed.
+    explicit CacheItem(TreePtr t, size_t s, uint64_t g)
+        : tree{std::move(t)}, size{s}, generation{g} {}
+
+    TreePtr tree;
+
+    /// Computing a tree's size requires walking its entries, so remember it.
+    size_t size;
+
+    std::list<CacheItem*>::iterator index;
+
+    /// Incremented on every LikelyNeededAgain or WantInterestHandle.
+    /// Decremented on every dropInterestHandle. Evicted if it reaches zero.
+    uint64_t referenceCount{0};
+
+    /// Given a unique value upon allocation. Used to verify InterestHandle
+    // matches this specific item.
+    uint64_t generation{0};
+  };
+
+  struct State {
+    size_t totalSize{0};
+    std::unordered_map<Hash, CacheItem> items;
+
+    /// Entries are evicted from the front of the queue.
+    std::list<CacheItem*> evictionQueue;
+
+    uint64_t hitCount{0};
+    uint64_t missCount{0};
+    uint64_t evictionCount{0};
+    uint64_t dropCount{0};
+    uint64_t liveHitCount{0};
+
+    /// Trees that were evicted while still referenced elsewhere. Expired
+    /// entries are pruned once the map grows to evictedPruneSize.
+    std::unordered_map<Hash, std::weak_ptr<const Tree>> evicted;
+    size_t evictedPruneSize{kMinEvictedPruneSize};
+  };
+
+  static constexpr size_t kMinEvictedPruneSize = 1024;
+
+  void dropInterestHandle(const Hash& hash, uint64_t generation) noexcept;
+
+  explicit TreeCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount);
+  void evictUntilFits(State& state) noexcept;
+  void evictOne(State& state) noexcept;
+  void evictItem(State&, CacheItem* item) noexcept;
+  void rememberEvicted(State& state, const TreePtr& tree) noexcept;
+
+  const size_t maximumCacheSizeBytes_;
+  const size_t minimumEntryCount_;
+  folly::Synchronized<State> state_;
+
+  friend class TreeInterestHandle;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TreePrefetch.h"
+
+#include <folly/futures/Future.h>
+#include <folly/logging/xlog.h>
+
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/IObjectStore.h"
+#include "eden/fs/utils/Future.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/**
+ * Return the subtrees of `tree` that still need to be walked.
+ */
+std::vector<TreePrefetchRoot> getChildren(
+    const Tree& tree,
+    const Tree* baseTree) {
+  std::vector<TreePrefetchRoot> children;
+  for (const auto& entry : tree.getTreeEntries()) {
+    if (!entry.isTree()) {
+      continue;
+    }
+
+    std::optional<Hash> baseTreeId;
+    if (baseTree) {
+      auto baseEntry = baseTree->getEntryPtr(entry.getName());
+      if (baseEntry && baseEntry->getHash() == entry.getHash()) {
+        // Identical subtree, nothing changes below it.
+        continue;
+      }
+      if (baseEntry && baseEntry->isTree()) {
+        baseTreeId = baseEntry->getHash();
+      }
+    }
+    children.push_back(TreePrefetchRoot{entry.getHash(), baseTreeId});
+  }
+  return children;
+}
+
+folly::Future<size_t> prefetchLevel(
+    std::shared_ptr<const IObjectStore> objectStore,
+    std::vector<TreePrefetchRoot> level,
+    size_t remainingDepth,
+    size_t loadedCount,
+    ObjectFetchContext& context) {
+  if (level.empty()) {
+    return folly::makeFuture(loadedCount);
+  }
+
+  XLOG(DBG4) << "prefetching " << level.size() << " trees";
+
+  std::vector<folly::Future<std::vector<TreePrefetchRoot>>> futures;
+  futures.reserve(level.size());
+  for (const auto& pending : level) {
+    auto treeFuture = objectStore->getTree(pending.treeId, context);
+    auto baseTreeFuture = pending.baseTreeId
+        ? objectStore->getTree(*pending.baseTreeId, context)
+        : folly::makeFuture(std::shared_ptr<const Tree>{});
+    futures.emplace_back(
+        collectSafe(treeFuture, baseTreeFuture)
+            .thenValue([remainingDepth](
+                           std::tuple<
+                               std::shared_ptr<const Tree>,
+                               std::shared_ptr<const Tree>>&& trees) {
+              if (remainingDepth == 0) {
+                return std::vector<TreePrefetchRoot>{};
+              }
+              return getChildren(*std::get<0>(trees), std::get<1>(trees).get());
+            }));
+  }
+
+  // Use collectAll() so that a single missing tree does not abort the walk.
+  return folly::collectAllUnsafe(futures).thenValue(
+      [objectStore, remainingDepth, loadedCount, &context](
+          std::vector<folly::Try<std::vector<TreePrefetchRoot>>>&&
+              results) mutable {
+        std::vector<TreePrefetchRoot> nextLevel;
+        for (auto& result : results) {
+          if (result.hasException()) {
+            XLOG(DBG3) << "error prefetching tree: "
+                       << result.exception().what();
+            continue;
+          }
+          ++loadedCount;
+          auto& children = result.value();
+          nextLevel.insert(
+              nextLevel.end(),
+              std::make_move_iterator(children.begin()),
+              std::make_move_iterator(children.end()));
+        }
+
+        if (remainingDepth == 0) {
+          return folly::makeFuture(loadedCount);
+        }
+        return prefetchLevel(
+            std::move(objectStore),
+            std::move(nextLevel),
+            remainingDepth - 1,
+            loadedCount,
+            context);
+      });
+}
+
+/** The number of blobs requested from the object store at once. */
+constexpr size_t kHydrateBlobBatchSize = 20480;
+
+struct HydrateState {
+  HydrateState(
+      std::shared_ptr<const IObjectStore> objectStore,
+      std::vector<RelativePath> blobPaths,
+      ObjectFetchContext& context)
+      : objectStore{std::move(objectStore)},
+        blobPaths{std::move(blobPaths)},
+        context{context} {}
+
+  bool wantsBlob(RelativePathPiece path) const {
+    for (const auto& blobPath : blobPaths) {
+      if (blobPath.empty() || blobPath == path ||
+          blobPath.isParentDirOf(path)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void addBlob(const Hash& id) {
+    pendingBlobs.push_back(id);
+    if (pendingBlobs.size() >= kHydrateBlobBatchSize) {
+      flushBlobs();
+    }
+  }
+
+  void flushBlobs() {
+    if (pendingBlobs.empty()) {
+      return;
+    }
+    result.blobCount += pendingBlobs.size();
+    blobPrefetches.push_back(
+        objectStore->prefetchBlobs(pendingBlobs, context)
+            .thenError([](const folly::exception_wrapper& ew) {
+              XLOG(WARN) << "error prefetching blobs: " << ew.what();
+            }));
+    pendingBlobs.clear();
+  }
+
+  std::shared_ptr<const IObjectStore> objectStore;
+  std::vector<RelativePath> blobPaths;
+  ObjectFetchContext& context;
+  HydrateResult result;
+  std::vector<Hash> pendingBlobs;
+  std::vector<folly::Future<folly::Unit>> blobPrefetches;
+};
+
+using HydrateLevel = std::vector<std::pair<RelativePath, Hash>>;
+
+folly::Future<folly::Unit> hydrateLevel(
+    std::shared_ptr<HydrateState> state,
+    HydrateLevel level) {
+  if (level.empty()) {
+    return folly::unit;
+  }
+
+  XLOG(DBG4) << "hydrating " << level.size() << " trees";
+
+  std::vector<folly::Future<std::shared_ptr<const Tree>>> futures;
+  futures.reserve(level.size());
+  for (const auto& pending : level) {
+    futures.emplace_back(
+        state->objectStore->getTree(pending.second, state->context));
+  }
+
+  // Continuations of one level run one after the other, so they can update
+  // state without locking.
+  return folly::collectAllUnsafe(futures).thenValue(
+      [state, level = std::move(level)](
+          std::vector<folly::Try<std::shared_ptr<const Tree>>>&& trees) {
+        HydrateLevel nextLevel;
+        for (size_t i = 0; i < trees.size(); ++i) {
+          if (trees[i].hasException()) {
+            XLOG(DBG3) << "error hydrating tree " << level[i].first << ": "
+                       << trees[i].exception().what();
+            continue;
+          }
+          ++state->result.treeCount;
+          const auto& path = level[i].first;
+          for (const auto& entry : trees[i].value()->getTreeEntries()) {
+            auto entryPath = path + entry.getName();
+            if (entry.isTree()) {
+              nextLevel.emplace_back(std::move(entryPath), entry.getHash());
+            } else if (state->wantsBlob(entryPath)) {
+              state->addBlob(entry.getHash());
+            }
+          }
+        }
+        return hydrateLevel(std::move(state), std::move(nextLevel));
+      });
+}
+} // namespace
+
+folly::Future<size_t> prefetchTreesBreadthFirst(
+    std::shared_ptr<const IObjectStore> objectStore,
+    std::vector<TreePrefetchRoot> roots,
+    size_t maxDepth,
+    ObjectFetchContext& context) {
+  return prefetchLevel(
+      std::move(objectStore), std::move(roots), maxDepth, 0, context);
+}
+
+folly::Future<HydrateResult> hydrateTree(
+    std::shared_ptr<const IObjectStore> objectStore,
+    Hash rootTreeId,
+    std::vector<RelativePath> blobPaths,
+    ObjectFetchContext& context) {
+  auto state = std::make_shared<HydrateState>(
+      std::move(objectStore), std::move(blobPaths), context);
+  HydrateLevel roots;
+  roots.emplace_back(RelativePath{}, rootTreeId);
+  return hydrateLevel(state, std::move(roots)).thenValue([state](auto&&) {
+    state->flushBlobs();
+    return folly::collectAllUnsafe(std::move(state->blobPrefetches))
+        .thenValue([state](auto&&) { return state->result; });
+  });
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/futures/Future.h>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+class IObjectStore;
+class ObjectFetchContext;
+
+/**
+ * A source control tree to start a prefetch walk from.
+ */
+struct TreePrefetchRoot {
+  Hash treeId;
+
+  /**
+   * If set, subtrees whose id matches the entry with the same name in this
+   * tree are skipped rather than walked. Checkout uses this to only prefetch
+   * the parts of the destination commit that differ from the current one.
+   */
+  std::optional<Hash> baseTreeId;
+};
+
+/**
+ * Import the given trees and their subtrees breadth first, walking at most
+ * `maxDepth` levels below the roots. A maxDepth of 0 only fetches the roots.
+ *
+ * All the trees of a level are requested at once so the backing store can
+ * batch their imports. The priority of the imports is the one of `context`,
+ * which must remain valid until the returned future completes.
+ *
+ * Trees that fail to load are logged and skipped. The returned future
+ * produces the number of trees that were loaded.
+ */
+folly::Future<size_t> prefetchTreesBreadthFirst(
+    std::shared_ptr<const IObjectStore> objectStore,
+    std::vector<TreePrefetchRoot> roots,
+    size_t maxDepth,
+    ObjectFetchContext& context);
+
+struct HydrateResult {
+  size_t treeCount{0};
+  size_t blobCount{0};
+};
+
+/**
+ * Import every tree below the given root tree, and the blobs of the files
+ * under any of `blobPaths`. An empty path in `blobPaths` selects every file.
+ *
+ * Trees are walked breadth first like prefetchTreesBreadthFirst(). The blobs
+ * of each level are requested in large batches as soon as their trees have
+ * been loaded, so that they are fetched while the following levels are still
+ * being walked. `context` must remain valid until the returned future
+ * completes.
+ *
+ * Trees and blobs that fail to load are logged and skipped. The returned
+ * future produces the number of trees loaded and blobs requested.
+ */
+folly::Future<HydrateResult> hydrateTree(
+    std::shared_ptr<const IObjectStore> objectStore,
+    Hash rootTreeId,
+    std::vector<RelativePath> blobPaths,
+    ObjectFetchContext& context);
+
+} // namespace eden
+} // namespace facebook
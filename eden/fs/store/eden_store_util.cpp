@@ -6,14 +6,21 @@
  */
 
 #include <sysexits.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <optional>
+#include <random>
 
+#include <folly/Format.h>
+#include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/String.h>
 #include <folly/container/Array.h>
 #include <folly/container/Enumerate.h>
+#include <folly/futures/Future.h>
 #include <folly/init/Init.h>
+#include <folly/lang/Bits.h>
 #include <folly/logging/Init.h>
 #include <folly/logging/xlog.h>
 #include <folly/stop_watch.h>
@@ -37,6 +44,14 @@ using std::optional;
 FOLLY_INIT_LOGGING_CONFIG("eden=DBG2; default:async=true");
 
 DEFINE_string(keySpace, "", "operate on just a single key space");
+DEFINE_uint64(
+    benchmarkKeys,
+    100000,
+    "the number of keys the benchmark command samples from each key space");
+DEFINE_uint64(
+    batchSize,
+    64,
+    "the number of keys in each getBatch() call of the benchmark command");
 
 namespace {
 
@@ -80,14 +95,16 @@ class Command {
     return edenDir_.getPath() + "storage/rocks-db"_relpath;
   }
 
-  std::unique_ptr<RocksDbLocalStore> openLocalStore(RocksDBOpenMode mode) {
+  // A shared_ptr, since getBatch() expects the store to be owned by one.
+  std::shared_ptr<RocksDbLocalStore> openLocalStore(RocksDBOpenMode mode) {
     folly::stop_watch<std::chrono::milliseconds> watch;
     const auto rocksPath = getLocalStorePath();
     ensureDirectoryExists(rocksPath);
-    auto localStore = make_unique<RocksDbLocalStore>(
+    auto localStore = std::make_shared<RocksDbLocalStore>(
         rocksPath,
         std::make_shared<NullStructuredLogger>(),
         &faultInjector_,
+        *config_,
         mode);
     XLOG(INFO) << "Opened RocksDB store in "
                << (mode == RocksDBOpenMode::ReadOnly ? "read-only"
@@ -97,6 +114,32 @@ class Command {
     return localStore;
   }
 
+  /**
+   * Run fn on each key space selected by --keySpace, logging how long it
+   * took and how the key space's size changed.
+   */
+  void timeKeySpaces(
+      const RocksDbLocalStore& localStore,
+      StringPiece action,
+      folly::FunctionRef<void(KeySpace)> fn) {
+    auto keySpace = getKeySpace();
+    for (const auto& ks : KeySpace::kAll) {
+      if (keySpace && (*keySpace)->index != ks->index) {
+        continue;
+      }
+      auto sizeBefore = localStore.getApproximateSize(ks);
+      folly::stop_watch<std::chrono::milliseconds> watch;
+      fn(ks);
+      LOG(INFO) << action << " column family \"" << ks->name << "\" in "
+                << (watch.elapsed().count() / 1000.0) << " seconds: "
+                << folly::prettyPrint(sizeBefore, folly::PRETTY_BYTES_METRIC)
+                << " -> "
+                << folly::prettyPrint(
+                       localStore.getApproximateSize(ks),
+                       folly::PRETTY_BYTES_METRIC);
+    }
+  }
+
   UserInfo userInfo_;
   std::shared_ptr<EdenConfig> config_;
   EdenStateDir edenDir_;
@@ -131,14 +174,16 @@ class GcCommand : public Command {
       StringPiece("Clear cached data then compact storage");
 
   void run() override {
-    auto keySpace = getKeySpace();
+    auto namedKeySpace = getKeySpace().has_value();
     auto localStore = openLocalStore(RocksDBOpenMode::ReadWrite);
-    if (keySpace) {
-      localStore->clearKeySpace(*keySpace);
-      localStore->compactKeySpace(*keySpace);
-    } else {
-      localStore->clearCachesAndCompactAll();
-    }
+    // As LocalStore::clearCachesAndCompactAll(), unless a key space was named
+    // explicitly, but timed per key space.
+    timeKeySpaces(*localStore, "garbage collected", [&](KeySpace ks) {
+      if (namedKeySpace || ks->isEphemeral()) {
+        localStore->clearKeySpace(ks);
+      }
+      localStore->compactKeySpace(ks);
+    });
   }
 };
 
@@ -165,13 +210,10 @@ class CompactCommand : public Command {
   static constexpr auto help = StringPiece("Compact the RocksDB storage");
 
   void run() override {
-    auto keySpace = getKeySpace();
     auto localStore = openLocalStore(RocksDBOpenMode::ReadWrite);
-    if (keySpace) {
-      localStore->compactKeySpace(*keySpace);
-    } else {
-      localStore->compactStorage();
-    }
+    timeKeySpaces(*localStore, "compacted", [&](KeySpace ks) {
+      localStore->compactKeySpace(ks);
+    });
   }
 };
 
@@ -182,7 +224,7 @@ class RepairCommand : public Command {
       "Force a repair of the RocksDB storage, even if it does not look corrupt");
 
   void run() override {
-    RocksDbLocalStore::repairDB(getLocalStorePath());
+    RocksDbLocalStore::repairDB(getLocalStorePath(), *config_);
   }
 };
 
@@ -204,13 +246,176 @@ class ShowSizesCommand : public Command {
   }
 };
 
+class InspectCommand : public Command {
+ public:
+  static constexpr auto name = StringPiece("inspect");
+  static constexpr auto help = StringPiece(
+      "Report the number of entries and the value sizes of each key space.");
+
+  void run() override {
+    auto keySpace = getKeySpace();
+    auto localStore = openLocalStore(RocksDBOpenMode::ReadOnly);
+
+    for (const auto& ks : KeySpace::kAll) {
+      if (keySpace && (*keySpace)->index != ks->index) {
+        continue;
+      }
+      // Bucket i counts the values whose size has its highest bit at
+      // position i, so bucket 0 holds only empty values.
+      std::array<uint64_t, 65> buckets{};
+      uint64_t count = 0;
+      uint64_t keyBytes = 0;
+      uint64_t valueBytes = 0;
+      uint64_t maxValue = 0;
+      localStore->forEachEntry(ks, [&](auto key, auto value) {
+        ++count;
+        keyBytes += key.size();
+        valueBytes += value.size();
+        maxValue = std::max<uint64_t>(maxValue, value.size());
+        ++buckets[folly::findLastSet(value.size())];
+        return true;
+      });
+
+      LOG(INFO) << "Column family \"" << ks->name << "\": " << count
+                << " entries, "
+                << folly::prettyPrint(keyBytes, folly::PRETTY_BYTES_METRIC)
+                << " of keys, "
+                << folly::prettyPrint(valueBytes, folly::PRETTY_BYTES_METRIC)
+                << " of values, largest value "
+                << folly::prettyPrint(maxValue, folly::PRETTY_BYTES_METRIC);
+      for (size_t i = 0; i < buckets.size(); ++i) {
+        if (buckets[i] == 0) {
+          continue;
+        }
+        uint64_t low = i == 0 ? 0 : uint64_t{1} << (i - 1);
+        LOG(INFO) << "  values of at least "
+                  << folly::prettyPrint(low, folly::PRETTY_BYTES_IEC) << ": "
+                  << buckets[i] << " ("
+                  << folly::format("{:.1f}", 100.0 * buckets[i] / count)
+                  << "%)";
+      }
+    }
+  }
+};
+
+class BenchmarkCommand : public Command {
+ public:
+  static constexpr auto name = StringPiece("benchmark");
+  static constexpr auto help = StringPiece(
+      "Measure get() and getBatch() throughput for a sample of the keys in "
+      "each key space.");
+
+  void run() override {
+    auto keySpace = getKeySpace();
+    auto localStore = openLocalStore(RocksDBOpenMode::ReadOnly);
+
+    for (const auto& ks : KeySpace::kAll) {
+      if (keySpace && (*keySpace)->index != ks->index) {
+        continue;
+      }
+      auto keys = sampleKeys(*localStore, ks);
+      if (keys.empty()) {
+        LOG(INFO) << "Column family \"" << ks->name << "\" is empty";
+        continue;
+      }
+      std::vector<folly::ByteRange> ranges;
+      ranges.reserve(keys.size());
+      for (const auto& key : keys) {
+        ranges.emplace_back(folly::StringPiece{key});
+      }
+
+      // The runs share the block cache, so each later run may find blocks
+      // that an earlier one loaded.
+      std::sort(ranges.begin(), ranges.end());
+      report(ks, "sequential get()", ranges.size(), [&] {
+        return getEach(*localStore, ks, ranges);
+      });
+      std::shuffle(ranges.begin(), ranges.end(), rng_);
+      report(ks, "random get()", ranges.size(), [&] {
+        return getEach(*localStore, ks, ranges);
+      });
+      report(ks, "random getBatch()", ranges.size(), [&] {
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < ranges.size(); i += FLAGS_batchSize) {
+          auto end = std::min<size_t>(i + FLAGS_batchSize, ranges.size());
+          std::vector<folly::ByteRange> batch{
+              ranges.begin() + i, ranges.begin() + end};
+          auto results = localStore->getBatch(ks, batch).get();
+          for (const auto& result : results) {
+            bytes += result.isValid() ? result.bytes().size() : 0;
+          }
+        }
+        return bytes;
+      });
+    }
+  }
+
+ private:
+  /**
+   * Choose up to --benchmarkKeys keys uniformly from keySpace with reservoir
+   * sampling, so that large key spaces need not fit in memory.
+   */
+  std::vector<std::string> sampleKeys(
+      const RocksDbLocalStore& localStore,
+      KeySpace keySpace) {
+    std::vector<std::string> keys;
+    uint64_t seen = 0;
+    localStore.forEachEntry(keySpace, [&](auto key, auto /*value*/) {
+      ++seen;
+      if (keys.size() < FLAGS_benchmarkKeys) {
+        keys.emplace_back(folly::StringPiece{key});
+      } else {
+        std::uniform_int_distribution<uint64_t> pick{0, seen - 1};
+        auto index = pick(rng_);
+        if (index < keys.size()) {
+          keys[index] = folly::StringPiece{key}.str();
+        }
+      }
+      return true;
+    });
+    return keys;
+  }
+
+  static uint64_t getEach(
+      const RocksDbLocalStore& localStore,
+      KeySpace keySpace,
+      const std::vector<folly::ByteRange>& keys) {
+    uint64_t bytes = 0;
+    for (auto key : keys) {
+      auto result = localStore.get(keySpace, key);
+      bytes += result.isValid() ? result.bytes().size() : 0;
+    }
+    return bytes;
+  }
+
+  /** Run fn, which returns the number of value bytes it read. */
+  static void report(
+      KeySpace keySpace,
+      StringPiece what,
+      size_t keyCount,
+      folly::FunctionRef<uint64_t()> fn) {
+    folly::stop_watch<std::chrono::microseconds> watch;
+    auto bytes = fn();
+    auto seconds = watch.elapsed().count() / 1000000.0;
+    LOG(INFO) << "Column family \"" << keySpace->name << "\" " << what << ": "
+              << keyCount << " keys in " << seconds << " seconds, "
+              << static_cast<uint64_t>(keyCount / seconds) << " keys/s, "
+              << folly::prettyPrint(bytes / seconds, folly::PRETTY_BYTES_METRIC)
+              << "/s";
+  }
+
+  std::mt19937_64 rng_{std::random_device{}()};
+};
+
 std::unique_ptr<Command> createCommand(StringPiece name) {
   auto commands = make_array<std::unique_ptr<CommandFactory>>(
       make_unique<CommandFactoryT<GcCommand>>(),
       make_unique<CommandFactoryT<ClearCommand>>(),
       make_unique<CommandFactoryT<CompactCommand>>(),
       make_unique<CommandFactoryT<RepairCommand>>(),
-      make_unique<CommandFactoryT<ShowSizesCommand>>());
+      make_unique<CommandFactoryT<ShowSizesCommand>>(),
+      make_unique<CommandFactoryT<InspectCommand>>(),
+      make_unique<CommandFactoryT<BenchmarkCommand>>());
 
   std::unique_ptr<Command> command;
   for (const auto& factory : commands) {
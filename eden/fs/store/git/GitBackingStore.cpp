@@ -8,9 +8,15 @@
 #include "GitBackingStore.h"
 
 #include <folly/Conv.h>
+#include <folly/ScopeGuard.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/task_queue/UnboundedBlockingQueue.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <git2.h>
+#include <algorithm>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
@@ -22,16 +28,35 @@
 #include "eden/fs/utils/EnumValue.h"
 
 using folly::ByteRange;
+using folly::Future;
 using folly::IOBuf;
-using folly::makeSemiFuture;
+using folly::makeFuture;
 using folly::SemiFuture;
 using folly::StringPiece;
 using std::make_unique;
 using std::string;
 using std::unique_ptr;
 
+DEFINE_int32(
+    num_git_import_threads,
+    4,
+    "the number of git import threads per repo");
+DEFINE_uint64(
+    git_mwindow_mapped_limit_mb,
+    0,
+    "The most packfile data, in megabytes, that libgit2 keeps mapped across "
+    "all git repositories.  0 keeps the libgit2 default.");
+DEFINE_uint64(
+    git_object_cache_mb,
+    0,
+    "The most memory, in megabytes, each libgit2 repository handle spends "
+    "caching parsed objects.  0 keeps the libgit2 default.");
+
 namespace {
 
+/** The number of objects each prefetchBlobs() task reads. */
+constexpr size_t kPrefetchBatchSize = 256;
+
 template <typename... Args>
 void gitCheckError(int error, Args&&... args) {
   if (error) {
@@ -51,42 +76,113 @@ void freeBlobIOBufData(void* /*blobData*/, void* blobObject) {
 namespace facebook {
 namespace eden {
 
+/**
+ * Returns a leased repository handle to the idle handles when destroyed.
+ */
+class GitBackingStore::RepoLease {
+ public:
+  RepoLease(GitBackingStore* store, git_repository* repo)
+      : store_{store}, repo_{repo} {}
+  ~RepoLease() {
+    store_->idleRepos_.wlock()->push_back(repo_);
+  }
+
+  RepoLease(const RepoLease&) = delete;
+  RepoLease& operator=(const RepoLease&) = delete;
+
+  git_repository* get() const {
+    return repo_;
+  }
+
+ private:
+  GitBackingStore* store_;
+  git_repository* repo_;
+};
+
 GitBackingStore::GitBackingStore(
     AbsolutePathPiece repository,
     LocalStore* localStore)
-    : localStore_{localStore} {
+    : localStore_{localStore}, repository_{repository} {
   // Make sure libgit2 is initialized.
   // (git_libgit2_init() is safe to call multiple times if multiple
   // GitBackingStore objects are created.  git_libgit2_shutdown() should be
   // called once for each call to git_libgit2_init().)
   git_libgit2_init();
 
-  auto error = git_repository_open(&repo_, repository.value().str().c_str());
-  gitCheckError(error, "error opening git repository", repository);
+  // These limits are global to libgit2, so the last store created wins.
+  if (FLAGS_git_mwindow_mapped_limit_mb != 0) {
+    git_libgit2_opts(
+        GIT_OPT_SET_MWINDOW_MAPPED_LIMIT,
+        static_cast<size_t>(FLAGS_git_mwindow_mapped_limit_mb * 1024 * 1024));
+  }
+  if (FLAGS_git_object_cache_mb != 0) {
+    git_libgit2_opts(
+        GIT_OPT_SET_CACHE_MAX_SIZE,
+        static_cast<ssize_t>(FLAGS_git_object_cache_mb * 1024 * 1024));
+  }
+
+  auto* repo = openRepo();
+  gitPath_ = git_repository_path(repo);
+  idleRepos_.wlock()->push_back(repo);
+
+  // As in HgBackingStore, the queue is unbounded so that a burst of imports
+  // can never fail or block the threads scheduling them.
+  using ImportQueue =
+      folly::UnboundedBlockingQueue<folly::CPUThreadPoolExecutor::CPUTask>;
+  importThreadPool_ = make_unique<folly::CPUThreadPoolExecutor>(
+      FLAGS_num_git_import_threads,
+      make_unique<ImportQueue>(),
+      std::make_shared<folly::NamedThreadFactory>("GitImporter"));
 }
 
 GitBackingStore::~GitBackingStore() {
-  git_repository_free(repo_);
+  // Finish every import, returning its repository handle, before freeing
+  // the handles.
+  importThreadPool_.reset();
+  for (auto* repo : *idleRepos_.wlock()) {
+    git_repository_free(repo);
+  }
   git_libgit2_shutdown();
 }
 
 const char* GitBackingStore::getPath() const {
-  return git_repository_path(repo_);
+  return gitPath_.c_str();
+}
+
+git_repository* GitBackingStore::openRepo() {
+  git_repository* repo = nullptr;
+  auto error = git_repository_open(&repo, repository_.value().str().c_str());
+  gitCheckError(error, "error opening git repository", repository_);
+  return repo;
+}
+
+GitBackingStore::RepoLease GitBackingStore::leaseRepo() {
+  {
+    auto idle = idleRepos_.wlock();
+    if (!idle->empty()) {
+      auto* repo = idle->back();
+      idle->pop_back();
+      return RepoLease{this, repo};
+    }
+  }
+  // Every handle is in use by another import thread.
+  return RepoLease{this, openRepo()};
 }
 
 SemiFuture<unique_ptr<Tree>> GitBackingStore::getTree(
     const Hash& id,
     ObjectFetchContext& /*context*/) {
-  // TODO: Use a separate thread pool to do the git I/O
-  return makeSemiFuture(getTreeImpl(id));
+  return folly::via(
+      importThreadPool_.get(), [this, id] { return getTreeImpl(id); });
 }
 
 unique_ptr<Tree> GitBackingStore::getTreeImpl(const Hash& id) {
   XLOG(DBG4) << "importing tree " << id;
 
+  auto repo = leaseRepo();
   git_oid treeOID = hash2Oid(id);
   git_tree* gitTree = nullptr;
-  auto error = git_tree_lookup(&gitTree, repo_, &treeOID);
+  auto error = git_tree_lookup(&gitTree, repo.get(), &treeOID);
   gitCheckError(
       error, "unable to find git tree ", id, " in repository ", getPath());
   SCOPE_EXIT {
@@ -131,16 +227,19 @@ unique_ptr<Tree> GitBackingStore::getTreeImpl(const Hash& id) {
 SemiFuture<unique_ptr<Blob>> GitBackingStore::getBlob(
     const Hash& id,
     ObjectFetchContext& /*context*/) {
-  // TODO: Use a separate thread pool to do the git I/O
-  return makeSemiFuture(getBlobImpl(id));
+  return folly::via(
+      importThreadPool_.get(), [this, id] { return getBlobImpl(id); });
 }
 
 unique_ptr<Blob> GitBackingStore::getBlobImpl(const Hash& id) {
   XLOG(DBG5) << "importing blob " << id;
 
+  // The blob keeps its data alive once looked up, so the handle may be
+  // returned as soon as this function does.
+  auto repo = leaseRepo();
   auto blobOID = hash2Oid(id);
   git_blob* blob = nullptr;
-  int error = git_blob_lookup(&blob, repo_, &blobOID);
+  int error = git_blob_lookup(&blob, repo.get(), &blobOID);
   gitCheckError(
       error, "unable to find git blob ", id, " in repository ", getPath());
 
@@ -160,13 +259,31 @@ unique_ptr<Blob> GitBackingStore::getBlobImpl(const Hash& id) {
 
 SemiFuture<unique_ptr<Tree>> GitBackingStore::getTreeForCommit(
     const Hash& commitID) {
-  // TODO: Use a separate thread pool to do the git I/O
+  return folly::via(
+             importThreadPool_.get(),
+             [this, commitID] { return getTreeIDForCommit(commitID); })
+      .thenValue([this](Hash treeID) {
+        // Now get the specified tree.
+        return localStore_->getTree(treeID).thenValue(
+            [this, treeID](unique_ptr<Tree> tree) -> Future<unique_ptr<Tree>> {
+              if (tree) {
+                return makeFuture(std::move(tree));
+              }
+              return folly::via(importThreadPool_.get(), [this, treeID] {
+                return getTreeImpl(treeID);
+              });
+            });
+      });
+}
+
+Hash GitBackingStore::getTreeIDForCommit(const Hash& commitID) {
   XLOG(DBG4) << "resolving tree for commit " << commitID;
 
   // Look up the commit info
+  auto repo = leaseRepo();
   git_oid commitOID = hash2Oid(commitID);
   git_commit* commit = nullptr;
-  auto error = git_commit_lookup(&commit, repo_, &commitOID);
+  auto error = git_commit_lookup(&commit, repo.get(), &commitOID);
   gitCheckError(
       error,
       "unable to find git commit ",
@@ -178,17 +295,7 @@ SemiFuture<unique_ptr<Tree>> GitBackingStore::getTreeForCommit(
   };
 
   // Get the tree ID for this commit.
-  Hash treeID = oid2Hash(git_commit_tree_id(commit));
-
-  // Now get the specified tree.
-  return localStore_->getTree(treeID).thenValue(
-      [this, treeID](unique_ptr<Tree> tree) {
-        if (tree) {
-          return tree;
-        } else {
-          return getTreeImpl(treeID);
-        }
-      });
+  return oid2Hash(git_commit_tree_id(commit));
 }
 
 SemiFuture<std::unique_ptr<Tree>> GitBackingStore::getTreeForManifest(
@@ -197,6 +304,43 @@ SemiFuture<std::unique_ptr<Tree>> GitBackingStore::getTreeForManifest(
   return getTreeForCommit(commitID);
 }
 
+SemiFuture<folly::Unit> GitBackingStore::prefetchBlobs(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& /*context*/) {
+  std::vector<Future<folly::Unit>> futures;
+  for (size_t start = 0; start < ids.size(); start += kPrefetchBatchSize) {
+    auto end = std::min(ids.size(), start + kPrefetchBatchSize);
+    std::vector<Hash> batch{ids.begin() + start, ids.begin() + end};
+    futures.push_back(folly::via(
+        importThreadPool_.get(),
+        [this, batch = std::move(batch)] { prefetchBatch(batch); }));
+  }
+  return folly::collectAll(std::move(futures)).deferValue([](auto&&) {});
+}
+
+void GitBackingStore::prefetchBatch(const std::vector<Hash>& ids) {
+  auto repo = leaseRepo();
+  git_odb* odb = nullptr;
+  auto error = git_repository_odb(&odb, repo.get());
+  gitCheckError(error, "unable to open object database of ", getPath());
+  SCOPE_EXIT {
+    git_odb_free(odb);
+  };
+
+  for (const auto& id : ids) {
+    // Reading the object inflates it from its packfile, which maps the
+    // packfile window it lives in.  The object itself is not needed yet.
+    auto oid = hash2Oid(id);
+    git_odb_object* object = nullptr;
+    if (git_odb_read(&object, odb, &oid) != 0) {
+      XLOG(DBG3) << "unable to prefetch git object " << id << " in "
+                 << getPath();
+      continue;
+    }
+    git_odb_object_free(object);
+  }
+}
+
 git_oid GitBackingStore::hash2Oid(const Hash& hash) {
   git_oid oid;
   static_assert(
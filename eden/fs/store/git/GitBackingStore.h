@@ -8,6 +8,10 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "eden/fs/store/BackingStore.h"
 #include "eden/fs/store/ObjectFetchContext.h"
@@ -16,6 +20,10 @@
 struct git_oid;
 struct git_repository;
 
+namespace folly {
+class Executor;
+} // namespace folly
+
 namespace facebook {
 namespace eden {
 
@@ -24,6 +32,10 @@ class LocalStore;
 
 /**
  * A BackingStore implementation that loads data out of a git repository.
+ *
+ * Objects are read on a pool of import threads.  A libgit2 repository handle
+ * must not be used by two threads at once, so each read leases a handle of
+ * its own; handles are opened as needed and reused afterwards.
  */
 class GitBackingStore : public BackingStore {
  public:
@@ -56,18 +68,40 @@ class GitBackingStore : public BackingStore {
       const Hash& commitID,
       const Hash& manifestID) override;
 
+  /**
+   * Read the given objects from the object database in batches, spread over
+   * the import threads, so that their packfile data is mapped and cached
+   * when they are later fetched.
+   */
+  FOLLY_NODISCARD folly::SemiFuture<folly::Unit> prefetchBlobs(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) override;
+
  private:
+  class RepoLease;
+
   GitBackingStore(GitBackingStore const&) = delete;
   GitBackingStore& operator=(GitBackingStore const&) = delete;
 
+  RepoLease leaseRepo();
+  git_repository* openRepo();
+
   std::unique_ptr<Tree> getTreeImpl(const Hash& id);
   std::unique_ptr<Blob> getBlobImpl(const Hash& id);
+  Hash getTreeIDForCommit(const Hash& commitID);
+  void prefetchBatch(const std::vector<Hash>& ids);
 
   static git_oid hash2Oid(const Hash& hash);
   static Hash oid2Hash(const git_oid* oid);
 
   LocalStore* localStore_{nullptr};
-  git_repository* repo_{nullptr};
+  const AbsolutePath repository_;
+  // The path to the .git directory, as reported by libgit2.
+  std::string gitPath_;
+  // Repository handles not currently leased by an import.
+  folly::Synchronized<std::vector<git_repository*>> idleRepos_;
+  // The threads that read objects out of the repository.
+  std::unique_ptr<folly::Executor> importThreadPool_;
 };
 } // namespace eden
 } // namespace facebook
@@ -13,11 +13,13 @@
 #include <folly/Try.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/GlobalExecutor.h>
+#include <folly/executors/InlineExecutor.h>
 #include <folly/executors/task_queue/UnboundedBlockingQueue.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include <folly/stop_watch.h>
+#include <mutex>
 
 #include "eden/fs/config/ReloadableConfig.h"
 #include "eden/fs/eden-config.h"
@@ -32,6 +34,7 @@
 #include "eden/fs/store/hg/HgDatapackStore.h"
 #include "eden/fs/store/hg/HgImportPyError.h"
 #include "eden/fs/store/hg/HgImporter.h"
+#include "eden/fs/store/hg/HgImporterPool.h"
 #include "eden/fs/store/hg/HgProxyHash.h"
 #include "eden/fs/store/hg/MetadataImporter.h"
 #include "eden/fs/store/hg/ScsProxyHash.h"
@@ -67,6 +70,22 @@ DEFINE_bool(
     "Set this parameter to \"no\" to disable fetching missing treemanifest "
     "trees from the remote mercurial server.  This is generally only useful "
     "for testing/debugging purposes");
+DEFINE_uint64(
+    hg_import_helper_max_requests,
+    0,
+    "Restart each hg import helper after it has served this many requests. "
+    "0 means never.");
+DEFINE_uint64(
+    hg_import_helper_max_rss_mb,
+    0,
+    "Restart an hg import helper once its resident memory exceeds this many "
+    "megabytes.  0 means never.");
+DEFINE_uint64(
+    hg_import_hedge_ms,
+    0,
+    "If importing a blob from an hg import helper takes longer than this many "
+    "milliseconds, also request it from another helper and use whichever "
+    "answers first.  0 disables hedging.");
 
 namespace facebook {
 namespace eden {
@@ -87,21 +106,20 @@ Importer& getThreadLocalImporter() {
 }
 
 /**
- * Thread factory that sets thread name and initializes a thread local
- * HgImporter.
+ * Thread factory that sets thread name and points the thread local
+ * HgImporter at the repository's shared HgImporterPool.
  */
 class HgImporterThreadFactory : public folly::ThreadFactory {
  public:
-  HgImporterThreadFactory(
-      AbsolutePathPiece repository,
-      std::shared_ptr<EdenStats> stats)
-      : delegate_("HgImporter"),
-        repository_(repository),
-        stats_(std::move(stats)) {}
+  explicit HgImporterThreadFactory(std::shared_ptr<HgImporterPool> pool)
+      : delegate_("HgImporter"), pool_(std::move(pool)) {}
 
   std::thread newThread(folly::Func&& func) override {
     return delegate_.newThread([this, func = std::move(func)]() mutable {
-      threadLocalImporter.reset(new HgImporterManager(repository_, stats_));
+      // The pool is shared by every import thread, so it is not owned by the
+      // thread local pointer.
+      threadLocalImporter.reset(
+          pool_.get(), [](Importer*, folly::TLPDestructionMode) {});
       SCOPE_EXIT {
         // TODO(xavierd): On Windows, the ThreadLocalPtr doesn't appear to
         // release its resources when the thread dies, so let's do it manually
@@ -114,8 +132,7 @@ class HgImporterThreadFactory : public folly::ThreadFactory {
 
  private:
   folly::NamedThreadFactory delegate_;
-  AbsolutePath repository_;
-  std::shared_ptr<EdenStats> stats_;
+  std::shared_ptr<HgImporterPool> pool_;
 };
 
 /**
@@ -172,6 +189,11 @@ HgBackingStore::HgBackingStore(
     MetadataImporterFactory metadataImporterFactory)
     : localStore_(std::move(localStore)),
       stats_(stats),
+      importerPool_(std::make_shared<HgImporterPool>(
+          repository,
+          stats,
+          FLAGS_hg_import_helper_max_requests,
+          FLAGS_hg_import_helper_max_rss_mb * 1024 * 1024)),
       importThreadPool_(make_unique<folly::CPUThreadPoolExecutor>(
           FLAGS_num_hg_import_threads,
           /* Eden performance will degrade when, for example, a status operation
@@ -188,17 +210,19 @@ HgBackingStore::HgBackingStore(
            */
           make_unique<folly::UnboundedBlockingQueue<
               folly::CPUThreadPoolExecutor::CPUTask>>(),
-          std::make_shared<HgImporterThreadFactory>(repository, stats))),
+          std::make_shared<HgImporterThreadFactory>(importerPool_))),
       config_(config),
       serverThreadPool_(serverThreadPool),
       datapackStore_(
           repository,
           config->getEdenConfig()->useEdenApi.getValue()) {
-  HgImporter importer(repository, stats);
-  const auto& options = importer.getOptions();
+  auto importer = std::make_unique<HgImporter>(repository, stats);
+  const auto& options = importer->getOptions();
   initializeTreeManifestImport(options, repository);
   repoName_ = options.repoName;
   metadataImporter_ = metadataImporterFactory(config_, repoName_, localStore_);
+  // Keep the helper started to read the options for the first import.
+  importerPool_->addHelper(std::move(importer));
 }
 
 /**
@@ -224,7 +248,10 @@ HgBackingStore::HgBackingStore(
           config_, repoName_, localStore_);
 }
 
-HgBackingStore::~HgBackingStore() {}
+HgBackingStore::~HgBackingStore() {
+  // Hedges scheduled after this point find the store gone and do nothing.
+  *hedgeTarget_->wlock() = nullptr;
+}
 
 void HgBackingStore::initializeTreeManifestImport(
     const ImporterOptions& options,
@@ -268,6 +295,67 @@ SemiFuture<unique_ptr<Tree>> HgBackingStore::getTree(
       commitHash);
 }
 
+void HgBackingStore::getTreeBatch(
+    const std::vector<Hash>& ids,
+    const std::vector<HgProxyHash>& hashes,
+    std::vector<folly::Promise<std::unique_ptr<Tree>>*> promises) {
+  // Trees whose metadata needs to be fetched alongside them go through
+  // importTreeImpl one at a time.
+  if (metadataImporter_->metadataFetchingAvailable()) {
+    return;
+  }
+
+  std::vector<std::optional<Hash>> commitHashes;
+  commitHashes.reserve(ids.size());
+  for (const auto& id : ids) {
+    std::optional<Hash> commitHash;
+    if (auto commitInfo =
+            ScsProxyHash::load(localStore_.get(), id, "importTreeBatch")) {
+      commitHash = commitInfo.value().commitHash();
+    }
+    commitHashes.emplace_back(std::move(commitHash));
+  }
+
+  folly::stop_watch<std::chrono::milliseconds> watch;
+  auto writeBatch = localStore_->beginWrite();
+  datapackStore_.getTreeBatch(
+      ids, hashes, commitHashes, writeBatch.get(), promises);
+
+  auto elapsed = watch.elapsed().count();
+  auto& currentThreadStats = stats_->getHgBackingStoreStatsForCurrentThread();
+  for (auto* promise : promises) {
+    if (promise->isFulfilled()) {
+      currentThreadStats.hgBackingStoreGetTree.addValue(elapsed);
+    }
+  }
+}
+
+unique_ptr<Tree> HgBackingStore::getTreeLocal(
+    const Hash& id,
+    const HgProxyHash& proxyHash) {
+  // Like getTreeBatch, leave trees that need their metadata fetched to
+  // importTreeImpl.
+  if (metadataImporter_->metadataFetchingAvailable()) {
+    return nullptr;
+  }
+
+  std::optional<Hash> commitHash;
+  if (auto commitInfo =
+          ScsProxyHash::load(localStore_.get(), id, "getTreeLocal")) {
+    commitHash = commitInfo.value().commitHash();
+  }
+
+  folly::stop_watch<std::chrono::milliseconds> watch;
+  auto writeBatch = localStore_->beginWrite();
+  auto tree = datapackStore_.getTreeLocal(
+      id, proxyHash, writeBatch.get(), commitHash);
+  if (tree) {
+    stats_->getHgBackingStoreStatsForCurrentThread()
+        .hgBackingStoreGetTree.addValue(watch.elapsed().count());
+  }
+  return tree;
+}
+
 Future<unique_ptr<Tree>> HgBackingStore::importTreeImpl(
     const Hash& manifestNode,
     const Hash& edenTreeID,
@@ -527,8 +615,90 @@ unique_ptr<Blob> HgBackingStore::getBlobFromHgCache(
   return nullptr;
 }
 
+namespace {
+/**
+ * The result of a blob import that may be hedged: the first attempt to
+ * succeed completes it, and it fails only when every attempt has failed.
+ */
+class HedgedBlobImport {
+ public:
+  SemiFuture<unique_ptr<Blob>> getSemiFuture() {
+    return promise_.getSemiFuture();
+  }
+
+  /**
+   * Count another attempt.  Returns false, and counts nothing, if the import
+   * has already completed.
+   */
+  bool addAttempt() {
+    auto state = state_.lock();
+    if (state->done) {
+      return false;
+    }
+    ++state->outstanding;
+    return true;
+  }
+
+  void complete(folly::Try<unique_ptr<Blob>>&& result) {
+    {
+      auto state = state_.lock();
+      --state->outstanding;
+      if (state->done || (result.hasException() && state->outstanding > 0)) {
+        return;
+      }
+      state->done = true;
+    }
+    promise_.setTry(std::move(result));
+  }
+
+ private:
+  struct State {
+    bool done{false};
+    size_t outstanding{1};
+  };
+
+  folly::Synchronized<State, std::mutex> state_;
+  folly::Promise<unique_ptr<Blob>> promise_;
+};
+} // namespace
+
 SemiFuture<std::unique_ptr<Blob>> HgBackingStore::fetchBlobFromHgImporter(
     HgProxyHash hgInfo) {
+  auto hedgeDelay = std::chrono::milliseconds{FLAGS_hg_import_hedge_ms};
+  if (hedgeDelay.count() == 0) {
+    return startBlobImport(std::move(hgInfo));
+  }
+
+  auto hedged = std::make_shared<HedgedBlobImport>();
+  auto future = hedged->getSemiFuture();
+  startBlobImport(hgInfo)
+      .via(&folly::InlineExecutor::instance())
+      .thenTry([hedged](folly::Try<unique_ptr<Blob>>&& result) {
+        hedged->complete(std::move(result));
+      });
+  folly::futures::sleep(hedgeDelay)
+      .via(&folly::InlineExecutor::instance())
+      .thenValue([hedged, hgInfo = std::move(hgInfo), target = hedgeTarget_](
+                     auto&&) mutable {
+        // Hold the lock while scheduling the hedge, so the store cannot be
+        // destroyed midway.
+        auto store = target->rlock();
+        if (!*store || !hedged->addAttempt()) {
+          return;
+        }
+        XLOG(DBG3) << "hedging slow import of " << hgInfo.path();
+        (*store)
+            ->startBlobImport(std::move(hgInfo))
+            .via(&folly::InlineExecutor::instance())
+            .thenTry([hedged](folly::Try<unique_ptr<Blob>>&& result) {
+              hedged->complete(std::move(result));
+            });
+      });
+  return future;
+}
+
+SemiFuture<std::unique_ptr<Blob>> HgBackingStore::startBlobImport(
+    HgProxyHash hgInfo) {
   return folly::via(
       importThreadPool_.get(),
       [stats = stats_,
@@ -545,6 +715,23 @@ SemiFuture<std::unique_ptr<Blob>> HgBackingStore::fetchBlobFromHgImporter(
       });
 }
 
+SemiFuture<std::vector<folly::Try<std::unique_ptr<Blob>>>>
+HgBackingStore::fetchBlobsFromHgImporter(std::vector<HgProxyHash> hgInfos) {
+  return folly::via(
+      importThreadPool_.get(),
+      [stats = stats_,
+       hgInfos = std::move(hgInfos),
+       &liveImportBlobWatches = liveImportBlobWatches_] {
+        Importer& importer = getThreadLocalImporter();
+        folly::stop_watch<std::chrono::milliseconds> watch;
+        RequestMetricsScope queueTracker{&liveImportBlobWatches};
+        auto blobs = importer.importFileContentsBatch(hgInfos);
+        stats->getHgBackingStoreStatsForCurrentThread()
+            .hgBackingStoreImportBlob.addValue(watch.elapsed().count());
+        return blobs;
+      });
+}
+
 SemiFuture<unique_ptr<Blob>> HgBackingStore::getBlob(
     const Hash& id,
     ObjectFetchContext& /*context*/) {
@@ -572,10 +759,13 @@ SemiFuture<folly::Unit> HgBackingStore::prefetchBlobs(
     ObjectFetchContext& /*context*/) {
   return HgProxyHash::getBatch(localStore_.get(), ids)
       .via(importThreadPool_.get())
-      .thenValue([&liveImportPrefetchWatches = liveImportPrefetchWatches_](
-                     std::vector<HgProxyHash>&& hgPathHashes) {
+      .thenValue([&liveImportPrefetchWatches = liveImportPrefetchWatches_,
+                  stats = stats_](std::vector<HgProxyHash>&& hgPathHashes) {
+        folly::stop_watch<std::chrono::milliseconds> watch;
         RequestMetricsScope queueTracker{&liveImportPrefetchWatches};
-        return getThreadLocalImporter().prefetchFiles(hgPathHashes);
+        getThreadLocalImporter().prefetchFiles(hgPathHashes);
+        stats->getHgBackingStoreStatsForCurrentThread()
+            .hgBackingStoreImportPrefetch.addValue(watch.elapsed().count());
       })
       .via(serverThreadPool_);
 }
@@ -666,8 +856,8 @@ folly::StringPiece HgBackingStore::stringOfHgImportObject(
   EDEN_BUG() << "unknown hg import object " << enumValue(object);
 }
 
-RequestMetricsScope::LockedRequestWatchList&
-HgBackingStore::getLiveImportWatches(HgImportObject object) const {
+RequestWatchList& HgBackingStore::getLiveImportWatches(
+    HgImportObject object) const {
   switch (object) {
     case HgImportObject::BLOB:
       return liveImportBlobWatches_;
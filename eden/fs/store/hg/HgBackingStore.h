@@ -9,11 +9,13 @@
 
 #include <memory>
 #include <optional>
+#include <vector>
 
 #include <folly/Executor.h>
 #include <folly/Range.h>
 #include <folly/String.h>
 #include <folly/Synchronized.h>
+#include <folly/Try.h>
 
 #include "eden/fs/eden-config.h"
 #include "eden/fs/store/BackingStore.h"
@@ -40,6 +42,7 @@ class UnboundedQueueExecutor;
 class ReloadableConfig;
 class ServiceAddress;
 class HgProxyHash;
+class HgImporterPool;
 
 /**
  * A BackingStore implementation that loads data out of a mercurial repository.
@@ -87,6 +90,27 @@ class HgBackingStore : public BackingStore {
 
   void periodicManagementTask() override;
 
+  /**
+   * Import multiple trees at once from the Rust hgcache, fetching all the trees
+   * missing locally in a single remote request. The vector parameters have to
+   * be the same length. Promises are only resolved for the trees that were
+   * imported; the caller is responsible for falling back to `getTree` for the
+   * others.
+   */
+  void getTreeBatch(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& hashes,
+      std::vector<folly::Promise<std::unique_ptr<Tree>>*> promises);
+
+  /**
+   * Import a tree from the local hg datapacks without going through
+   * HgImporter or the network. Returns nullptr when the tree is not available
+   * locally, in which case it must go through the regular import path.
+   */
+  std::unique_ptr<Tree> getTreeLocal(
+      const Hash& id,
+      const HgProxyHash& proxyHash);
+
   /**
    * Import the manifest for the specified revision using mercurial
    * treemanifest data.
@@ -112,8 +136,7 @@ class HgBackingStore : public BackingStore {
    *        )
    *    gets the watches timing live blob imports
    */
-  RequestMetricsScope::LockedRequestWatchList& getLiveImportWatches(
-      HgImportObject object) const;
+  RequestWatchList& getLiveImportWatches(HgImportObject object) const;
 
   // Get blob step functions
 
@@ -124,8 +147,19 @@ class HgBackingStore : public BackingStore {
   std::unique_ptr<Blob> getBlobFromHgCache(
       const Hash& id,
       const HgProxyHash& hgInfo);
+  /**
+   * Import a blob through an HgImporter.  With --hg_import_hedge_ms set, an
+   * import that is still running after that long is also sent to another
+   * import thread, and so another helper.
+   */
   folly::SemiFuture<std::unique_ptr<Blob>> fetchBlobFromHgImporter(
       HgProxyHash hgInfo);
+  /**
+   * Import several blobs through a single importer, pipelining the requests
+   * to its helper process.  Results are in the order of hgInfos.
+   */
+  folly::SemiFuture<std::vector<folly::Try<std::unique_ptr<Blob>>>>
+  fetchBlobsFromHgImporter(std::vector<HgProxyHash> hgInfos);
 
   HgDatapackStore& getDatapackStore() {
     return datapackStore_;
@@ -145,6 +179,9 @@ class HgBackingStore : public BackingStore {
 
   folly::Future<std::unique_ptr<Tree>> getTreeForCommitImpl(Hash commitID);
 
+  /** A single, unhedged, import of a blob through an HgImporter. */
+  folly::SemiFuture<std::unique_ptr<Blob>> startBlobImport(HgProxyHash hgInfo);
+
   folly::Future<std::unique_ptr<Tree>> getTreeForRootTreeImpl(
       const Hash& commitID,
       const Hash& rootTreeHash);
@@ -179,7 +216,10 @@ class HgBackingStore : public BackingStore {
 
   std::shared_ptr<LocalStore> localStore_;
   std::shared_ptr<EdenStats> stats_;
-  // A set of threads owning HgImporter instances
+  // The hg import helpers shared by importThreadPool_.  Null in unit tests,
+  // which use a single HgImporter instead.
+  std::shared_ptr<HgImporterPool> importerPool_;
+  // A set of threads using the HgImporter instances
   std::unique_ptr<folly::Executor> importThreadPool_;
   std::shared_ptr<ReloadableConfig> config_;
   // The main server thread pool; we push the Futures back into
@@ -201,10 +241,14 @@ class HgBackingStore : public BackingStore {
   std::unique_ptr<MetadataImporter> metadataImporter_;
 
   // Track metrics for imports currently fetching data from hg
-  mutable RequestMetricsScope::LockedRequestWatchList liveImportBlobWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList liveImportTreeWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList
-      liveImportPrefetchWatches_;
+  mutable RequestWatchList liveImportBlobWatches_;
+  mutable RequestWatchList liveImportTreeWatches_;
+  mutable RequestWatchList liveImportPrefetchWatches_;
+
+  // Lets a hedge timer that fires after this store is destroyed see that it
+  // is gone.  Reset to null by the destructor.
+  std::shared_ptr<folly::Synchronized<HgBackingStore*>> hedgeTarget_{
+      std::make_shared<folly::Synchronized<HgBackingStore*>>(this)};
 };
 } // namespace eden
 } // namespace facebook
@@ -171,6 +171,78 @@ std::unique_ptr<Tree> HgDatapackStore::getTree(
   return nullptr;
 }
 
+std::unique_ptr<Tree> HgDatapackStore::getTreeLocal(
+    const Hash& edenTreeId,
+    const HgProxyHash& hgInfo,
+    LocalStore::WriteBatch* writeBatch,
+    const std::optional<Hash>& commitHash) {
+  auto manifestId = hgInfo.revHash();
+  std::vector<std::pair<folly::ByteRange, folly::ByteRange>> requests{
+      {folly::ByteRange{hgInfo.path().stringPiece()}, manifestId.getBytes()}};
+
+  std::unique_ptr<Tree> result;
+  store_.getTreeBatch(
+      requests, true, [&](size_t, std::shared_ptr<RustTree> tree) {
+        // This is called from Rust, do not let exceptions escape.
+        auto edenTree = folly::makeTryWith([&] {
+          return fromRawTree(
+              tree.get(), edenTreeId, hgInfo.path(), writeBatch, commitHash);
+        });
+        if (edenTree.hasValue()) {
+          result = std::move(edenTree).value();
+        } else {
+          XLOG(DBG3) << "Failed to convert local tree " << edenTreeId << ": "
+                     << edenTree.exception().what();
+        }
+      });
+  return result;
+}
+
+void HgDatapackStore::getTreeBatch(
+    const std::vector<Hash>& ids,
+    const std::vector<HgProxyHash>& hashes,
+    const std::vector<std::optional<Hash>>& commitHashes,
+    LocalStore::WriteBatch* writeBatch,
+    std::vector<folly::Promise<std::unique_ptr<Tree>>*> promises) {
+  std::vector<Hash> manifestIds;
+  std::vector<std::pair<folly::ByteRange, folly::ByteRange>> requests;
+
+  size_t count = hashes.size();
+  requests.reserve(count);
+  manifestIds.reserve(count);
+
+  // See the comment in getBlobBatch about why the `Hash`es need to be stored
+  // before building `requests`.
+  for (size_t i = 0; i < count; i++) {
+    manifestIds.emplace_back(hashes[i].revHash());
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    requests.emplace_back(std::make_pair<>(
+        folly::ByteRange{hashes[i].path().stringPiece()},
+        manifestIds[i].getBytes()));
+  }
+
+  store_.getTreeBatch(
+      requests,
+      false,
+      [promises = std::move(promises),
+       &ids,
+       &hashes,
+       &commitHashes,
+       writeBatch](size_t index, std::shared_ptr<RustTree> tree) {
+        // This is called from Rust, do not let exceptions escape.
+        promises[index]->setTry(folly::makeTryWith([&] {
+          return fromRawTree(
+              tree.get(),
+              ids[index],
+              hashes[index].path(),
+              writeBatch,
+              commitHashes[index]);
+        }));
+      });
+}
+
 void HgDatapackStore::refresh() {
   store_.refresh();
 }
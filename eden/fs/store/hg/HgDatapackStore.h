@@ -52,6 +52,28 @@ class HgDatapackStore {
       LocalStore::WriteBatch* writeBatch,
       const std::optional<Hash>& commitHash);
 
+  /**
+   * Imports a tree for the given manifest from the local datapacks only.
+   * Returns nullptr when the tree would have to be fetched remotely.
+   */
+  std::unique_ptr<Tree> getTreeLocal(
+      const Hash& edenTreeId,
+      const HgProxyHash& hgInfo,
+      LocalStore::WriteBatch* writeBatch,
+      const std::optional<Hash>& commitHash);
+
+  /**
+   * Import multiple trees at once. The vector parameters have to be the same
+   * length. Promises passed in will be resolved if a tree is successfully
+   * imported. Otherwise the promise will be left untouched.
+   */
+  void getTreeBatch(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& hashes,
+      const std::vector<std::optional<Hash>>& commitHashes,
+      LocalStore::WriteBatch* writeBatch,
+      std::vector<folly::Promise<std::unique_ptr<Tree>>*> promises);
+
   void refresh();
 
  private:
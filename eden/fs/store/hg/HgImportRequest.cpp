@@ -10,6 +10,8 @@
 #include <folly/Try.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/Promise.h>
+#include <algorithm>
+#include <utility>
 
 #include "eden/fs/telemetry/RequestMetricsScope.h"
 
@@ -22,41 +24,131 @@ std::pair<HgImportRequest, folly::SemiFuture<typename Request::Response>>
 makeRequest(
     Input&& input,
     ImportPriority priority,
-    std::unique_ptr<RequestMetricsScope> metricsScope) {
+    RequestMetricsScope metricsScope,
+    std::optional<pid_t> clientPid) {
   auto [promise, future] =
       folly::makePromiseContract<typename Request::Response>();
   return std::make_pair(
       HgImportRequest{
-          Request{std::forward<Input>(input)}, priority, std::move(promise)},
-      std::move(future).defer(
-          [metrics = std::move(metricsScope)](auto&& result) {
-            return std::forward<decltype(result)>(result);
-          }));
+          Request{std::forward<Input>(input)},
+          priority,
+          std::move(promise),
+          std::move(metricsScope),
+          clientPid},
+      std::move(future));
+}
+
+template <typename T>
+std::unique_ptr<T> copyResponse(const std::unique_ptr<T>& value) {
+  return value ? std::make_unique<T>(*value) : nullptr;
+}
+
+/**
+ * Replaces `primary` with a fresh promise, and arranges for both the original
+ * `primary` and `duplicate` to be fulfilled once the new promise is.  The
+ * duplicate stays counted as pending until then.
+ */
+template <typename Response>
+void mergePromises(
+    folly::Promise<Response>& primary,
+    folly::Promise<Response>&& duplicate,
+    RequestMetricsScope&& duplicateMetrics) {
+  auto [promise, future] = folly::makePromiseContract<Response>();
+  auto original = std::exchange(primary, std::move(promise));
+  // The continuation runs inline on whichever thread fulfills the request.
+  std::move(future).toUnsafeFuture().thenTry(
+      [original = std::move(original),
+       duplicate = std::move(duplicate),
+       metrics = std::move(duplicateMetrics)](
+          folly::Try<Response>&& result) mutable {
+        if (result.hasValue()) {
+          duplicate.setValue(copyResponse(result.value()));
+        } else {
+          duplicate.setException(result.exception());
+        }
+        original.setTry(std::move(result));
+      });
 }
 } // namespace
 
+void HgImportRequest::merge(HgImportRequest&& other) {
+  if (getType() != other.getType()) {
+    EDEN_BUG() << "cannot merge import requests of different types";
+  }
+
+  if (auto* blobPromise =
+          std::get_if<folly::Promise<BlobImport::Response>>(&other.promise_)) {
+    mergePromises(
+        *getPromise<BlobImport::Response>(),
+        std::move(*blobPromise),
+        std::move(other.metricsScope_));
+  } else if (
+      auto* treePromise =
+          std::get_if<folly::Promise<TreeImport::Response>>(&other.promise_)) {
+    mergePromises(
+        *getPromise<TreeImport::Response>(),
+        std::move(*treePromise),
+        std::move(other.metricsScope_));
+  } else {
+    EDEN_BUG() << "cannot merge prefetch requests";
+  }
+
+  if (priority_ < other.priority_) {
+    priority_ = other.priority_;
+  }
+  // The merged request has been waiting since the older of the two.
+  requestTime_ = std::min(requestTime_, other.requestTime_);
+}
+
+bool HgImportRequest::agePriority(
+    std::chrono::steady_clock::time_point now,
+    std::chrono::steady_clock::duration interval) noexcept {
+  if (interval.count() <= 0 || now <= requestTime_) {
+    return false;
+  }
+
+  uint64_t levels = (now - requestTime_) / interval;
+  if (levels <= agingLevels_) {
+    return false;
+  }
+
+  auto aged = priority_.getRaised(levels - agingLevels_);
+  agingLevels_ = levels;
+  if (aged.kind == priority_.kind) {
+    return false;
+  }
+  priority_ = aged;
+  return true;
+}
+
 std::pair<HgImportRequest, folly::SemiFuture<std::unique_ptr<Blob>>>
 HgImportRequest::makeBlobImportRequest(
     Hash hash,
     ImportPriority priority,
-    std::unique_ptr<RequestMetricsScope> metricsScope) {
-  return makeRequest<BlobImport>(hash, priority, std::move(metricsScope));
+    RequestMetricsScope metricsScope,
+    std::optional<pid_t> clientPid) {
+  return makeRequest<BlobImport>(
+      hash, priority, std::move(metricsScope), clientPid);
 }
 
 std::pair<HgImportRequest, folly::SemiFuture<std::unique_ptr<Tree>>>
 HgImportRequest::makeTreeImportRequest(
     Hash hash,
     ImportPriority priority,
-    std::unique_ptr<RequestMetricsScope> metricsScope) {
-  return makeRequest<TreeImport>(hash, priority, std::move(metricsScope));
+    RequestMetricsScope metricsScope,
+    std::optional<pid_t> clientPid) {
+  return makeRequest<TreeImport>(
+      hash, priority, std::move(metricsScope), clientPid);
 }
 
 std::pair<HgImportRequest, folly::SemiFuture<folly::Unit>>
 HgImportRequest::makePrefetchRequest(
     std::vector<Hash> hashes,
     ImportPriority priority,
-    std::unique_ptr<RequestMetricsScope> metricsScope) {
-  return makeRequest<Prefetch>(hashes, priority, std::move(metricsScope));
+    RequestMetricsScope metricsScope,
+    std::optional<pid_t> clientPid) {
+  return makeRequest<Prefetch>(
+      std::move(hashes), priority, std::move(metricsScope), clientPid);
 }
 } // namespace eden
 } // namespace facebook
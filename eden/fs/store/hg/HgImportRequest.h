@@ -8,6 +8,9 @@
 #pragma once
 
 #include <folly/futures/Promise.h>
+#include <folly/portability/SysTypes.h>
+#include <chrono>
+#include <optional>
 #include <utility>
 #include <variant>
 
@@ -16,6 +19,7 @@
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
+#include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Bug.h"
 
 namespace facebook {
@@ -46,32 +50,44 @@ class HgImportRequest {
     std::vector<Hash> hashes;
   };
 
+  /** The number of types of requests, as numbered by getType(). */
+  static constexpr size_t kTypeCount = 3;
+
   static std::pair<HgImportRequest, folly::SemiFuture<std::unique_ptr<Blob>>>
   makeBlobImportRequest(
       Hash hash,
       ImportPriority priority,
-      std::unique_ptr<RequestMetricsScope> metricsScope);
+      RequestMetricsScope metricsScope,
+      std::optional<pid_t> clientPid = std::nullopt);
 
   static std::pair<HgImportRequest, folly::SemiFuture<std::unique_ptr<Tree>>>
   makeTreeImportRequest(
       Hash hash,
       ImportPriority priority,
-      std::unique_ptr<RequestMetricsScope> metricsScope);
+      RequestMetricsScope metricsScope,
+      std::optional<pid_t> clientPid = std::nullopt);
 
   static std::pair<HgImportRequest, folly::SemiFuture<folly::Unit>>
   makePrefetchRequest(
       std::vector<Hash> hashes,
       ImportPriority priority,
-      std::unique_ptr<RequestMetricsScope> metricsScope);
+      RequestMetricsScope metricsScope,
+      std::optional<pid_t> clientPid = std::nullopt);
 
   template <typename RequestType>
   HgImportRequest(
       RequestType request,
       ImportPriority priority,
-      folly::Promise<typename RequestType::Response>&& promise)
+      folly::Promise<typename RequestType::Response>&& promise,
+      RequestMetricsScope metricsScope,
+      std::optional<pid_t> clientPid = std::nullopt)
       : request_(std::move(request)),
         priority_(priority),
-        promise_(std::move(promise)) {}
+        promise_(std::move(promise)),
+        metricsScope_(std::move(metricsScope)),
+        clientPid_(clientPid),
+        requestTime_(std::chrono::steady_clock::now()),
+        queueWait_(TraceBlock::detached("hg import queue wait")) {}
 
   ~HgImportRequest() = default;
 
@@ -92,6 +108,60 @@ class HgImportRequest {
     return request_.index();
   }
 
+  ImportPriority getPriority() const noexcept {
+    return priority_;
+  }
+
+  /**
+   * The pid of the process that caused this import, if known.
+   */
+  std::optional<pid_t> getClientPid() const noexcept {
+    return clientPid_;
+  }
+
+  std::chrono::steady_clock::time_point getRequestTime() const noexcept {
+    return requestTime_;
+  }
+
+  /**
+   * Ends the trace block covering the time this request spent in the queue.
+   * Called by the worker that dequeued it.
+   */
+  void markDequeued() {
+    queueWait_.close();
+  }
+
+  /**
+   * Starts a trace block for a later stage of this import. It is recorded in
+   * the trace of the request that caused the import, even though the import
+   * runs on a worker thread.
+   */
+  template <size_t size>
+  TraceBlock traceStage(const char (&name)[size]) const {
+    return queueWait_.sibling(name);
+  }
+
+  /**
+   * Raises the priority of this request by one kind for every `interval` it
+   * has been waiting since it was created, so that low priority requests are
+   * eventually served even under a constant stream of higher priority ones.
+   *
+   * Returns true if the priority changed.
+   */
+  bool agePriority(
+      std::chrono::steady_clock::time_point now,
+      std::chrono::steady_clock::duration interval) noexcept;
+
+  /**
+   * Folds a duplicate request for the same object into this request. The
+   * promise held by `other` will be fulfilled with a copy of the result of
+   * this request, and this request takes the higher of the two priorities.
+   *
+   * Both requests must be of the same type, and must be either a BlobImport
+   * or a TreeImport.
+   */
+  void merge(HgImportRequest&& other);
+
   template <typename T>
   folly::Promise<T>* getPromise() {
     auto promise = std::get_if<folly::Promise<T>>(&promise_); // Promise<T>
@@ -111,10 +181,21 @@ class HgImportRequest {
       folly::Promise<std::unique_ptr<Blob>>,
       folly::Promise<std::unique_ptr<Tree>>,
       folly::Promise<folly::Unit>>;
+  static_assert(std::variant_size_v<Request> == kTypeCount);
 
   Request request_;
   ImportPriority priority_;
   Response promise_;
+  // Counts this request as a pending import until it is destroyed, which the
+  // worker that fulfills the promise does right after.  Kept in place rather
+  // than in a continuation of the future, so that making a request allocates
+  // nothing but the promise and its future.
+  RequestMetricsScope metricsScope_;
+  std::optional<pid_t> clientPid_;
+  std::chrono::steady_clock::time_point requestTime_;
+  TraceBlock queueWait_;
+  // Number of kinds priority_ has been raised by agePriority().
+  uint64_t agingLevels_{0};
 
   friend bool operator<(
       const HgImportRequest& lhs,
@@ -13,6 +13,148 @@
 namespace facebook {
 namespace eden {
 
+namespace {
+bool requestLess(
+    const std::unique_ptr<HgImportRequest>& lhs,
+    const std::unique_ptr<HgImportRequest>& rhs) {
+  return *lhs < *rhs;
+}
+
+size_t getBatchSize(
+    const HgImportRequestQueue::BatchSizes& batchSizes,
+    const HgImportRequest& request) {
+  if (request.isType<HgImportRequest::BlobImport>()) {
+    return batchSizes.blob;
+  } else if (request.isType<HgImportRequest::TreeImport>()) {
+    return batchSizes.tree;
+  }
+  return batchSizes.prefetch;
+}
+} // namespace
+
+std::pair<HgImportRequestQueue::PendingIndex*, const Hash*>
+HgImportRequestQueue::getPendingIndex(State& state, HgImportRequest& request) {
+  if (auto* blob = request.getRequest<HgImportRequest::BlobImport>()) {
+    return {&state.pendingBlobs, &blob->hash};
+  } else if (auto* tree = request.getRequest<HgImportRequest::TreeImport>()) {
+    return {&state.pendingTrees, &tree->hash};
+  }
+  return {nullptr, nullptr};
+}
+
+HgImportRequestQueue::ClientKey HgImportRequestQueue::getClientKey(
+    const HgImportRequest& request) const {
+  return options_.fairScheduling ? request.getClientPid() : std::nullopt;
+}
+
+void HgImportRequestQueue::push(
+    State& state,
+    std::unique_ptr<HgImportRequest> request) const {
+  auto [it, inserted] = state.clients.try_emplace(getClientKey(*request));
+  auto& client = it->second;
+  if (inserted) {
+    client.virtualTime = state.virtualTime;
+  }
+  auto& heap = client.requests[request->getType()];
+  heap.emplace_back(std::move(request));
+  std::push_heap(heap.begin(), heap.end(), requestLess);
+}
+
+std::pair<HgImportRequestQueue::ClientQueue*, size_t>
+HgImportRequestQueue::pickClient(State& state, std::optional<size_t> type)
+    const {
+  ClientQueue* best = nullptr;
+  const HgImportRequest* bestRequest = nullptr;
+  size_t bestType = 0;
+  for (auto& entry : state.clients) {
+    auto& client = entry.second;
+    // The client's most important request amongst the types considered.
+    const HgImportRequest* next = nullptr;
+    size_t nextType = 0;
+    for (size_t i = 0; i < client.requests.size(); ++i) {
+      if ((type && *type != i) || client.requests[i].empty()) {
+        continue;
+      }
+      const auto* head = client.requests[i].front().get();
+      if (!next || *next < *head) {
+        next = head;
+        nextType = i;
+      }
+    }
+    if (!next) {
+      continue;
+    }
+
+    bool better = !best;
+    if (best) {
+      auto priority = next->getPriority();
+      auto bestPriority = bestRequest->getPriority();
+      if (priority.kind != bestPriority.kind) {
+        better = bestPriority.kind < priority.kind;
+      } else if (client.virtualTime != best->virtualTime) {
+        better = client.virtualTime < best->virtualTime;
+      } else {
+        better = bestPriority < priority;
+      }
+    }
+    if (better) {
+      best = &client;
+      bestRequest = next;
+      bestType = nextType;
+    }
+  }
+  return {best, bestType};
+}
+
+HgImportRequest
+HgImportRequestQueue::pop(State& state, ClientQueue& client, size_t type)
+    const {
+  auto& heap = client.requests[type];
+  std::pop_heap(heap.begin(), heap.end(), requestLess);
+  auto owned = std::move(heap.back());
+  heap.pop_back();
+
+  state.virtualTime = client.virtualTime;
+  ++client.virtualTime;
+
+  // Once dequeued, a request is no longer pending and later requests for the
+  // same hash will be queued separately.
+  auto [index, hash] = getPendingIndex(state, *owned);
+  if (index) {
+    index->erase(*hash);
+  }
+
+  HgImportRequest request{std::move(*owned)};
+  if (state.freeRequests.size() < kMaxFreeRequests) {
+    state.freeRequests.push_back(std::move(owned));
+  }
+  return request;
+}
+
+void HgImportRequestQueue::ageRequests(State& state) const {
+  if (options_.agingInterval.count() <= 0) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (now - state.lastAging < options_.agingInterval) {
+    return;
+  }
+  state.lastAging = now;
+
+  for (auto& entry : state.clients) {
+    for (auto& heap : entry.second.requests) {
+      bool changed = false;
+      for (auto& request : heap) {
+        changed |= request->agePriority(now, options_.agingInterval);
+      }
+      if (changed) {
+        std::make_heap(heap.begin(), heap.end(), requestLess);
+      }
+    }
+  }
+}
+
 void HgImportRequestQueue::stop() {
   auto state = state_.lock();
   if (state->running) {
@@ -30,56 +172,104 @@ void HgImportRequestQueue::enqueue(HgImportRequest request) {
       return;
     }
 
-    state->queue.emplace_back(std::move(request));
-    std::push_heap(state->queue.begin(), state->queue.end());
+    auto [index, hash] = getPendingIndex(*state, request);
+    if (index) {
+      auto it = index->find(*hash);
+      if (it != index->end()) {
+        auto* pending = it->second;
+        auto oldPriority = pending->getPriority();
+        pending->merge(std::move(request));
+        if (oldPriority < pending->getPriority()) {
+          // The merged request was raised in priority, so its position in the
+          // heap is no longer valid.
+          auto& heap = state->clients[getClientKey(*pending)]
+                           .requests[pending->getType()];
+          std::make_heap(heap.begin(), heap.end(), requestLess);
+        }
+        // No new work was added to the queue, no need to wake up a worker.
+        return;
+      }
+    }
+
+    std::unique_ptr<HgImportRequest> owned;
+    if (state->freeRequests.empty()) {
+      owned = std::make_unique<HgImportRequest>(std::move(request));
+    } else {
+      owned = std::move(state->freeRequests.back());
+      state->freeRequests.pop_back();
+      *owned = std::move(request);
+    }
+    if (index) {
+      // Take the key from the heap allocated request, since `request` was
+      // moved from.
+      auto [ownedIndex, ownedHash] = getPendingIndex(*state, *owned);
+      ownedIndex->emplace(*ownedHash, owned.get());
+    }
+    push(*state, std::move(owned));
   }
 
   queueCV_.notify_one();
 }
 
 std::vector<HgImportRequest> HgImportRequestQueue::dequeue(size_t count) {
+  return dequeue(BatchSizes{count, count, count});
+}
+
+std::vector<HgImportRequest> HgImportRequestQueue::dequeue(
+    BatchSizes batchSizes) {
   auto state = state_.lock();
 
-  while (state->running && state->queue.empty()) {
+  while (state->running && state->clients.empty()) {
     queueCV_.wait(state.getUniqueLock());
   }
 
   if (!state->running) {
-    state->queue.clear();
+    state->clients.clear();
+    state->pendingBlobs.clear();
+    state->pendingTrees.clear();
+    state->freeRequests.clear();
     return std::vector<HgImportRequest>();
   }
 
-  auto& queue = state->queue;
+  ageRequests(*state);
 
+  auto [client, type] = pickClient(*state, std::nullopt);
   std::vector<HgImportRequest> result;
-  std::vector<HgImportRequest> putback;
-  std::optional<size_t> type;
+  result.push_back(pop(*state, *client, type));
+  auto count = std::max<size_t>(1, getBatchSize(batchSizes, result.front()));
 
-  for (size_t i = 0; i < count * 3; i++) {
-    if (queue.empty() || result.size() == count) {
-      break;
+  // The rest of the batch must not be served ahead of more urgent requests of
+  // other types.
+  std::optional<ImportPriorityKind> otherKind;
+  for (const auto& entry : state->clients) {
+    for (size_t i = 0; i < entry.second.requests.size(); ++i) {
+      const auto& heap = entry.second.requests[i];
+      if (i == type || heap.empty()) {
+        continue;
+      }
+      auto kind = heap.front()->getPriority().kind;
+      if (!otherKind || *otherKind < kind) {
+        otherKind = kind;
+      }
     }
+  }
 
-    std::pop_heap(queue.begin(), queue.end());
-
-    auto request = std::move(queue.back());
-    queue.pop_back();
-
-    if (!type) {
-      type = request.getType();
-      result.emplace_back(std::move(request));
-    } else {
-      if (*type == request.getType()) {
-        result.emplace_back(std::move(request));
-      } else {
-        putback.emplace_back(std::move(request));
-      }
+  while (result.size() < count) {
+    auto* next = pickClient(*state, type).first;
+    if (!next ||
+        (otherKind &&
+         next->requests[type].front()->getPriority().kind < *otherKind)) {
+      break;
     }
+    result.push_back(pop(*state, *next, type));
   }
 
-  for (auto& item : putback) {
-    queue.emplace_back(std::move(item));
-    std::push_heap(queue.begin(), queue.end());
+  for (auto it = state->clients.begin(); it != state->clients.end();) {
+    if (it->second.empty()) {
+      it = state->clients.erase(it);
+    } else {
+      ++it;
+    }
   }
 
   return result;
@@ -8,8 +8,14 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include "eden/fs/store/hg/HgImportRequest.h"
@@ -19,10 +25,42 @@ namespace eden {
 
 class HgImportRequestQueue {
  public:
+  struct Options {
+    /**
+     * When enabled, requests of the same priority kind are served fairly
+     * between the clients (pids) that caused them, instead of strictly by
+     * priority. This prevents a single process issuing lots of fetches from
+     * starving the others.
+     */
+    bool fairScheduling{false};
+
+    /**
+     * If non-zero, pending requests are raised by one priority kind every
+     * time they have waited this long, so that low priority requests still
+     * make progress.
+     */
+    std::chrono::steady_clock::duration agingInterval{0};
+  };
+
+  /**
+   * Maximum number of requests returned by dequeue(), by type of request.
+   */
+  struct BatchSizes {
+    size_t blob{1};
+    size_t tree{1};
+    size_t prefetch{1};
+  };
+
   explicit HgImportRequestQueue() {}
+  explicit HgImportRequestQueue(Options options) : options_{options} {}
 
   /*
    * Puts an item into the queue.
+   *
+   * If a blob or tree import for the same hash is already waiting in the
+   * queue, the new request is merged into the existing one instead: its
+   * promise will be fulfilled with the result of the pending import, and the
+   * pending import is bumped to the higher of the two priorities.
    */
   void enqueue(HgImportRequest request);
 
@@ -36,17 +74,103 @@ class HgImportRequestQueue {
    */
   std::vector<HgImportRequest> dequeue(size_t count);
 
+  /*
+   * Same as above, but the maximum number of returned requests depends on the
+   * type of the requests being returned.
+   */
+  std::vector<HgImportRequest> dequeue(BatchSizes batchSizes);
+
   void stop();
 
  private:
   HgImportRequestQueue(HgImportRequestQueue&&) = delete;
   HgImportRequestQueue& operator=(HgImportRequestQueue&&) = delete;
 
+  using PendingIndex = std::unordered_map<Hash, HgImportRequest*>;
+  using ClientKey = std::optional<pid_t>;
+
+  using RequestHeap = std::vector<std::unique_ptr<HgImportRequest>>;
+
+  struct ClientQueue {
+    // Heaps of pending requests, one per type of request, so that a batch of
+    // one type can be gathered without setting the others aside. Requests
+    // are heap allocated so that `pendingBlobs` and `pendingTrees` can point
+    // at them while the heaps are reordered.
+    std::array<RequestHeap, HgImportRequest::kTypeCount> requests;
+
+    bool empty() const {
+      return std::all_of(
+          requests.begin(), requests.end(), [](const RequestHeap& heap) {
+            return heap.empty();
+          });
+    }
+
+    // Number of requests served for this client, offset by the virtual time
+    // of the queue when the client became active. The client with the lowest
+    // virtual time is served first amongst those of the same priority kind.
+    uint64_t virtualTime{0};
+  };
+
   struct State {
     bool running = true;
-    std::vector<HgImportRequest> queue;
+
+    // Pending requests, by client. Without fair scheduling, all requests are
+    // kept under the same key. Clients without pending requests are removed.
+    std::unordered_map<ClientKey, ClientQueue> clients;
+
+    // Virtual time of the last served client. Clients becoming active start
+    // from it so that they cannot catch up on the time they were idle.
+    uint64_t virtualTime{0};
+
+    // Last time the requests were aged.
+    std::chrono::steady_clock::time_point lastAging;
+
+    // Index of the blob and tree imports currently queued, keyed by hash.
+    PendingIndex pendingBlobs;
+    PendingIndex pendingTrees;
+
+    // Allocations of requests that have been dequeued, reused for the next
+    // requests enqueued so that a steady stream of imports does not allocate
+    // one per request. At most kMaxFreeRequests are kept.
+    std::vector<std::unique_ptr<HgImportRequest>> freeRequests;
   };
 
+  static constexpr size_t kMaxFreeRequests = 1024;
+
+  /**
+   * Returns the index tracking pending requests of the same type as
+   * `request`, along with the hash it is keyed by, or a null index if this
+   * type of request is never deduplicated.
+   */
+  static std::pair<PendingIndex*, const Hash*> getPendingIndex(
+      State& state,
+      HgImportRequest& request);
+
+  ClientKey getClientKey(const HgImportRequest& request) const;
+
+  void push(State& state, std::unique_ptr<HgImportRequest> request) const;
+
+  /**
+   * Returns the client whose next request of the given type should be served
+   * next, and that type, or a null client if there is none. Without a type,
+   * requests of all types are considered.
+   */
+  std::pair<ClientQueue*, size_t> pickClient(
+      State& state,
+      std::optional<size_t> type) const;
+
+  /**
+   * Removes the client's next request of the given type, and moves its
+   * allocation to the free list.
+   */
+  HgImportRequest pop(State& state, ClientQueue& client, size_t type) const;
+
+  /**
+   * Applies priority aging to all pending requests if it is due.
+   */
+  void ageRequests(State& state) const;
+
+  const Options options_;
   folly::Synchronized<State, std::mutex> state_;
   std::condition_variable queueCV_;
 };
@@ -32,6 +32,7 @@
 #endif
 
 #include <mutex>
+#include <unordered_map>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Tree.h"
@@ -340,6 +341,81 @@ unique_ptr<Blob> HgImporter::importFileContents(
   // In the future we might want to consider if it is more efficient to receive
   // the body data in fixed-size chunks, particularly for very large files.
   auto header = readChunkHeader(requestID, "CMD_CAT_FILE");
+  return readFileResponse(header, path, blobHash);
+}
+
+std::vector<folly::Try<unique_ptr<Blob>>> HgImporter::importFileContentsBatch(
+    const std::vector<HgProxyHash>& files) {
+  XLOG(DBG5) << "requesting file contents of " << files.size() << " files";
+
+  std::vector<folly::Try<unique_ptr<Blob>>> results(files.size());
+  // Maps each unanswered request to the index of its file.
+  std::unordered_map<TransactionID, size_t> inFlight;
+  size_t inFlightBytes = 0;
+  size_t next = 0;
+  auto requestBytes = [](const HgProxyHash& file) {
+    return sizeof(ChunkHeader) + Hash::RAW_SIZE +
+        file.path().stringPiece().size();
+  };
+
+  while (next < files.size() || !inFlight.empty()) {
+    // Always allow one request, however long its path.
+    while (next < files.size() &&
+           (inFlight.empty() ||
+            inFlightBytes + requestBytes(files[next]) <=
+                kMaxPipelinedRequestBytes)) {
+      const auto& file = files[next];
+      auto requestID = sendFileRequest(file.path(), file.revHash());
+      inFlight.emplace(requestID, next);
+      inFlightBytes += requestBytes(files[next]);
+      ++next;
+    }
+
+    // The helper currently answers in order, but match responses by ID so
+    // that it is free not to.
+    auto header = readRawChunkHeader();
+    auto it = inFlight.find(header.requestID);
+    if (it == inFlight.end()) {
+      auto err = HgImporterError(
+          "received unexpected transaction ID ",
+          header.requestID,
+          " when reading CMD_CAT_FILE response");
+      XLOG(ERR) << err.what();
+      throw err;
+    }
+    auto index = it->second;
+    inFlight.erase(it);
+    inFlightBytes -= requestBytes(files[index]);
+
+    const auto& file = files[index];
+    try {
+      if ((header.flags & FLAG_ERROR) != 0) {
+        readErrorAndThrow(header);
+      }
+      results[index] = folly::Try<unique_ptr<Blob>>{
+          readFileResponse(header, file.path(), file.revHash())};
+    } catch (const HgImporterError&) {
+      // The pipe is broken or out of sync; nothing more can be read.
+      throw;
+    } catch (const HgImportPyError& ex) {
+      if (ex.errorType() == "ResetRepoError") {
+        // Let HgImporterManager restart the helper and retry the batch.
+        throw;
+      }
+      results[index] = folly::Try<unique_ptr<Blob>>{
+          folly::exception_wrapper{std::current_exception(), ex}};
+    } catch (const std::exception& ex) {
+      results[index] = folly::Try<unique_ptr<Blob>>{
+          folly::exception_wrapper{std::current_exception(), ex}};
+    }
+  }
+  return results;
+}
+
+unique_ptr<Blob> HgImporter::readFileResponse(
+    const ChunkHeader& header,
+    RelativePathPiece path,
+    Hash blobHash) {
   if (header.dataLength < sizeof(uint64_t)) {
     auto msg = folly::to<string>(
         "CMD_CAT_FILE response for blob ",
@@ -437,9 +513,7 @@ Hash HgImporter::resolveManifestNode(folly::StringPiece revName) {
   return Hash(buffer);
 }
 
-HgImporter::ChunkHeader HgImporter::readChunkHeader(
-    TransactionID txnID,
-    StringPiece cmdName) {
+HgImporter::ChunkHeader HgImporter::readRawChunkHeader() {
   ChunkHeader header;
   readFromHelper(&header, folly::to_narrow(sizeof(header)), "response header");
 
@@ -447,6 +521,13 @@ HgImporter::ChunkHeader HgImporter::readChunkHeader(
   header.command = Endian::big(header.command);
   header.flags = Endian::big(header.flags);
   header.dataLength = Endian::big(header.dataLength);
+  return header;
+}
+
+HgImporter::ChunkHeader HgImporter::readChunkHeader(
+    TransactionID txnID,
+    StringPiece cmdName) {
+  auto header = readRawChunkHeader();
 
   // If the header indicates an error, read the error message
   // and throw an exception.
@@ -774,6 +855,14 @@ unique_ptr<Blob> HgImporterManager::importFileContents(
   });
 }
 
+std::vector<folly::Try<unique_ptr<Blob>>>
+HgImporterManager::importFileContentsBatch(
+    const std::vector<HgProxyHash>& files) {
+  return retryOnError([&](HgImporter* importer) {
+    return importer->importFileContentsBatch(files);
+  });
+}
+
 void HgImporterManager::prefetchFiles(const std::vector<HgProxyHash>& files) {
   return retryOnError(
       [&](HgImporter* importer) { return importer->prefetchFiles(files); });
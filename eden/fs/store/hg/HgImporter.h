@@ -8,7 +8,9 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Try.h>
 #include <optional>
+#include <vector>
 #ifndef _WIN32
 #include <folly/Subprocess.h>
 #else
@@ -94,6 +96,16 @@ class Importer {
       RelativePathPiece path,
       Hash blobHash) = 0;
 
+  /**
+   * Import the contents of several files at once.
+   *
+   * Returns one result per file, in the same order.  An error importing one
+   * file does not fail the others; only errors communicating with the helper
+   * process are thrown.
+   */
+  virtual std::vector<folly::Try<std::unique_ptr<Blob>>>
+  importFileContentsBatch(const std::vector<HgProxyHash>& files) = 0;
+
   virtual void prefetchFiles(const std::vector<HgProxyHash>& files) = 0;
 
   /**
@@ -134,12 +146,23 @@ class HgImporter : public Importer {
 
 #ifndef _WIN32
   folly::ProcessReturnCode debugStopHelperProcess();
+
+  pid_t getHelperPid() const {
+    return helper_.pid();
+  }
 #endif
 
   Hash resolveManifestNode(folly::StringPiece revName) override;
   std::unique_ptr<Blob> importFileContents(
       RelativePathPiece path,
       Hash blobHash) override;
+  /**
+   * Pipelines the requests: up to kMaxPipelinedRequestBytes of requests are
+   * written ahead of the responses being read, so the helper process can
+   * start on the next file as soon as it has sent the previous one.
+   */
+  std::vector<folly::Try<std::unique_ptr<Blob>>> importFileContentsBatch(
+      const std::vector<HgProxyHash>& files) override;
   void prefetchFiles(const std::vector<HgProxyHash>& files) override;
   void fetchTree(RelativePathPiece path, Hash pathManifestNode) override;
 
@@ -199,6 +222,16 @@ class HgImporter : public Importer {
     uint32_t dataLength;
   };
 
+  /**
+   * The most request bytes importFileContentsBatch() leaves unanswered.
+   *
+   * The helper process reads one request at a time and blocks writing its
+   * response until we read it.  Keeping the unanswered requests well below
+   * the capacity of the pipe guarantees that our writes never block waiting
+   * for a helper that is itself waiting for us.
+   */
+  static constexpr size_t kMaxPipelinedRequestBytes = 16 * 1024;
+
   // Forbidden copy constructor and assignment operator
   HgImporter(const HgImporter&) = delete;
   HgImporter& operator=(const HgImporter&) = delete;
@@ -224,6 +257,20 @@ class HgImporter : public Importer {
    */
   ChunkHeader readChunkHeader(TransactionID txnID, folly::StringPiece cmdName);
 
+  /**
+   * Read a response chunk header without checking its transaction ID or
+   * error flag.
+   */
+  ChunkHeader readRawChunkHeader();
+
+  /**
+   * Read the body of a CMD_CAT_FILE response whose header has been read.
+   */
+  std::unique_ptr<Blob> readFileResponse(
+      const ChunkHeader& header,
+      RelativePathPiece path,
+      Hash blobHash);
+
   /**
    * Read the body of an error message, and throw it as an exception.
    */
@@ -322,6 +369,8 @@ class HgImporterManager : public Importer {
   std::unique_ptr<Blob> importFileContents(
       RelativePathPiece path,
       Hash blobHash) override;
+  std::vector<folly::Try<std::unique_ptr<Blob>>> importFileContentsBatch(
+      const std::vector<HgProxyHash>& files) override;
   void prefetchFiles(const std::vector<HgProxyHash>& files) override;
   void fetchTree(RelativePathPiece path, Hash pathManifestNode) override;
 
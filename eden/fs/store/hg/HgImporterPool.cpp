@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/HgImporterPool.h"
+
+#include <folly/Conv.h>
+#include <folly/Unit.h>
+#include <folly/logging/xlog.h>
+#include <folly/stop_watch.h>
+#include <algorithm>
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/store/hg/HgImportPyError.h"
+#include "eden/fs/store/hg/HgProxyHash.h"
+#include "eden/fs/utils/ProcUtil.h"
+
+using std::unique_ptr;
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/**
+ * Reading a helper's memory usage costs a few syscalls, so only check it
+ * every this many requests.
+ */
+constexpr size_t kResidentCheckInterval = 16;
+} // namespace
+
+HgImporterPool::HgImporterPool(
+    AbsolutePathPiece repoPath,
+    std::shared_ptr<EdenStats> stats,
+    size_t maxRequestsPerHelper,
+    size_t maxHelperResidentBytes,
+    std::optional<AbsolutePath> importHelperScript)
+    : repoPath_{repoPath},
+      stats_{std::move(stats)},
+      maxRequestsPerHelper_{maxRequestsPerHelper},
+      maxHelperResidentBytes_{maxHelperResidentBytes},
+      importHelperScript_{std::move(importHelperScript)} {}
+
+HgImporterPool::~HgImporterPool() {}
+
+void HgImporterPool::addHelper(unique_ptr<HgImporter> importer) {
+  idle_.lock()->push_back(std::make_unique<Helper>(std::move(importer)));
+}
+
+size_t HgImporterPool::getIdleHelperCount() const {
+  return idle_.lock()->size();
+}
+
+template <typename Fn>
+auto HgImporterPool::withImporter(Fn&& fn) {
+  bool retried = false;
+
+  // Discard the helper, whose state can no longer be trusted, and retry the
+  // call once on another.
+  auto retryableError = [&retried](const std::exception& ex) {
+    XLOG(WARN) << "error communicating with debugedenimporthelper: "
+               << ex.what();
+    if (retried) {
+      throw;
+    }
+    XLOG(INFO) << "restarting hg_import_helper and retrying operation";
+    retried = true;
+  };
+
+  while (true) {
+    auto helper = acquire();
+    folly::stop_watch<std::chrono::microseconds> watch;
+    try {
+      auto result = fn(helper->importer.get());
+      release(std::move(helper), watch.elapsed());
+      return result;
+    } catch (const HgImportPyError& ex) {
+      if (ex.errorType() != "ResetRepoError") {
+        // The helper itself is fine; only this request failed.
+        release(std::move(helper), watch.elapsed());
+        throw;
+      }
+      // The python code thinks its repository state has gone bad, and is
+      // requesting to be restarted.
+      helper.reset();
+      retryableError(ex);
+    } catch (const HgImporterError& ex) {
+      helper.reset();
+      retryableError(ex);
+    }
+  }
+}
+
+unique_ptr<HgImporterPool::Helper> HgImporterPool::acquire() {
+  {
+    auto idle = idle_.lock();
+    if (!idle->empty()) {
+      auto fastest = std::min_element(
+          idle->begin(), idle->end(), [](const auto& a, const auto& b) {
+            return a->latency < b->latency;
+          });
+      auto helper = std::move(*fastest);
+      idle->erase(fastest);
+      return helper;
+    }
+  }
+
+  // Start the new helper without the lock held, since this takes a while.
+  XLOG(DBG2) << "starting a new hg import helper for " << repoPath_;
+  return std::make_unique<Helper>(
+      std::make_unique<HgImporter>(repoPath_, stats_, importHelperScript_));
+}
+
+void HgImporterPool::release(
+    unique_ptr<Helper> helper,
+    std::chrono::microseconds time) {
+  ++helper->requests;
+  helper->latency =
+      helper->requests == 1 ? time : (3 * helper->latency + time) / 4;
+
+  if (shouldRecycle(*helper)) {
+    // Destroying the helper stops its process, so do it outside the lock.
+    return;
+  }
+  idle_.lock()->push_back(std::move(helper));
+}
+
+bool HgImporterPool::shouldRecycle(const Helper& helper) const {
+  if (maxRequestsPerHelper_ != 0 && helper.requests >= maxRequestsPerHelper_) {
+    XLOG(DBG2) << "recycling hg import helper after " << helper.requests
+               << " requests";
+    return true;
+  }
+
+#ifndef _WIN32
+  if (maxHelperResidentBytes_ != 0 &&
+      helper.requests % kResidentCheckInterval == 0) {
+    auto statm = folly::to<std::string>(
+        "/proc/", helper.importer->getHelperPid(), "/statm");
+    auto memory = proc_util::readStatmFile(statm.c_str());
+    if (memory && memory->resident > maxHelperResidentBytes_) {
+      XLOG(DBG2) << "recycling hg import helper using " << memory->resident
+                 << " resident bytes";
+      return true;
+    }
+  }
+#endif
+  return false;
+}
+
+Hash HgImporterPool::resolveManifestNode(folly::StringPiece revName) {
+  return withImporter([&](HgImporter* importer) {
+    return importer->resolveManifestNode(revName);
+  });
+}
+
+unique_ptr<Blob> HgImporterPool::importFileContents(
+    RelativePathPiece path,
+    Hash blobHash) {
+  return withImporter([&](HgImporter* importer) {
+    return importer->importFileContents(path, blobHash);
+  });
+}
+
+std::vector<folly::Try<unique_ptr<Blob>>>
+HgImporterPool::importFileContentsBatch(const std::vector<HgProxyHash>& files) {
+  return withImporter([&](HgImporter* importer) {
+    return importer->importFileContentsBatch(files);
+  });
+}
+
+void HgImporterPool::prefetchFiles(const std::vector<HgProxyHash>& files) {
+  withImporter([&](HgImporter* importer) {
+    importer->prefetchFiles(files);
+    return folly::unit;
+  });
+}
+
+void HgImporterPool::fetchTree(RelativePathPiece path, Hash pathManifestNode) {
+  withImporter([&](HgImporter* importer) {
+    importer->fetchTree(path, pathManifestNode);
+    return folly::unit;
+  });
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "eden/fs/store/hg/HgImporter.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A set of hg debugedenimporthelper processes shared by all of a
+ * repository's import threads.
+ *
+ * Each call leases an idle helper for its duration, preferring the one that
+ * has recently answered fastest, and starts a new helper when none is idle.
+ * A slow or stuck helper therefore stops receiving work as soon as any other
+ * helper becomes free.
+ *
+ * A helper is discarded, and the call retried once, after any error
+ * communicating with it, as HgImporterManager does.  Helpers are also
+ * recycled proactively after serving maxRequestsPerHelper calls, or once
+ * their resident memory exceeds maxHelperResidentBytes.  Zero disables
+ * either limit.
+ *
+ * Unlike HgImporter, HgImporterPool is thread-safe.
+ */
+class HgImporterPool : public Importer {
+ public:
+  HgImporterPool(
+      AbsolutePathPiece repoPath,
+      std::shared_ptr<EdenStats> stats,
+      size_t maxRequestsPerHelper,
+      size_t maxHelperResidentBytes,
+      std::optional<AbsolutePath> importHelperScript = std::nullopt);
+  ~HgImporterPool() override;
+
+  /**
+   * Add an already started helper to the idle helpers, so that the first
+   * import need not wait for one to start.
+   */
+  void addHelper(std::unique_ptr<HgImporter> importer);
+
+  /** The number of helpers not currently serving a call. */
+  size_t getIdleHelperCount() const;
+
+  Hash resolveManifestNode(folly::StringPiece revName) override;
+  std::unique_ptr<Blob> importFileContents(
+      RelativePathPiece path,
+      Hash blobHash) override;
+  std::vector<folly::Try<std::unique_ptr<Blob>>> importFileContentsBatch(
+      const std::vector<HgProxyHash>& files) override;
+  void prefetchFiles(const std::vector<HgProxyHash>& files) override;
+  void fetchTree(RelativePathPiece path, Hash pathManifestNode) override;
+
+ private:
+  struct Helper {
+    explicit Helper(std::unique_ptr<HgImporter> importer)
+        : importer{std::move(importer)} {}
+
+    std::unique_ptr<HgImporter> importer;
+    size_t requests{0};
+    /** An exponentially weighted moving average of recent call times. */
+    std::chrono::microseconds latency{0};
+  };
+
+  template <typename Fn>
+  auto withImporter(Fn&& fn);
+
+  std::unique_ptr<Helper> acquire();
+  void release(std::unique_ptr<Helper> helper, std::chrono::microseconds time);
+  bool shouldRecycle(const Helper& helper) const;
+
+  const AbsolutePath repoPath_;
+  const std::shared_ptr<EdenStats> stats_;
+  const size_t maxRequestsPerHelper_;
+  const size_t maxHelperResidentBytes_;
+  const std::optional<AbsolutePath> importHelperScript_;
+
+  folly::Synchronized<std::vector<std::unique_ptr<Helper>>, std::mutex> idle_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -41,6 +41,54 @@ HgProxyHash::HgProxyHash(
   validate(edenBlobHash);
 }
 
+HgProxyHash::HgProxyHash(
+    LocalStore* store,
+    const ObjectId& edenObjectId,
+    StringPiece context) {
+  if (auto embedded = tryParseEmbeddedId(edenObjectId)) {
+    value_.swap(embedded->value_);
+    return;
+  }
+  if (!edenObjectId.isHash()) {
+    auto msg = folly::to<string>(
+        "invalid mercurial object id ",
+        edenObjectId.toString(),
+        " in ",
+        context);
+    XLOG(ERR) << msg;
+    throw std::invalid_argument(msg);
+  }
+  *this = HgProxyHash{store, edenObjectId.asHash(), context};
+}
+
+ObjectId HgProxyHash::makeEmbeddedId(RelativePathPiece path, Hash hgRevHash) {
+  // We serialize the id as <type><hash_bytes><path>.  Unlike the data stored
+  // in the LocalStore, the path length is implied by the length of the id.
+  auto pathStr = path.stringPiece();
+  string id;
+  id.reserve(1 + Hash::RAW_SIZE + pathStr.size());
+  id.push_back(static_cast<char>(kEmbeddedIdType));
+  id.append(StringPiece{hgRevHash.getBytes()}.str());
+  id.append(pathStr.data(), pathStr.size());
+  return ObjectId{std::move(id)};
+}
+
+std::optional<HgProxyHash> HgProxyHash::tryParseEmbeddedId(
+    const ObjectId& edenObjectId) {
+  auto bytes = edenObjectId.getBytes();
+  if (bytes.size() < 1 + Hash::RAW_SIZE || bytes[0] != kEmbeddedIdType) {
+    return std::nullopt;
+  }
+  bytes.advance(1);
+  Hash hgRevHash{bytes.subpiece(0, Hash::RAW_SIZE)};
+  bytes.advance(Hash::RAW_SIZE);
+
+  HgProxyHash proxyHash;
+  auto buf = serialize(RelativePathPiece{StringPiece{bytes}}, hgRevHash);
+  proxyHash.value_ = StringPiece{buf.coalesce()}.str();
+  return proxyHash;
+}
+
 folly::Future<std::vector<HgProxyHash>> HgProxyHash::getBatch(
     LocalStore* store,
     const std::vector<Hash>& blobHashes) {
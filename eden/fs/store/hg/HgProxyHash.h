@@ -8,9 +8,11 @@
 #pragma once
 
 #include <folly/FixedString.h>
+#include <optional>
 #include <string>
 #include <vector>
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/model/ObjectId.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -42,6 +44,10 @@ constexpr auto kDefaultProxyHash =
  * blob hash in eden.  We store the eden_blob_hash --> (path, hgRevHash)
  * mapping in the LocalStore.  The HgProxyHash class helps store and
  * retrieve these mappings.
+ *
+ * Alternatively the (path, hgRevHash) tuple can be embedded in an ObjectId,
+ * created by makeEmbeddedId(), which is read back without any LocalStore
+ * lookup and needs nothing stored for it.
  */
 class HgProxyHash {
  public:
@@ -50,6 +56,16 @@ class HgProxyHash {
    */
   HgProxyHash(LocalStore* store, Hash edenBlobHash, folly::StringPiece context);
 
+  /**
+   * Load HgProxyHash data for the given id.  An id made by makeEmbeddedId()
+   * is decoded directly.  An id that is a plain Hash is looked up in the
+   * LocalStore, as with the constructor above.
+   */
+  HgProxyHash(
+      LocalStore* store,
+      const ObjectId& edenObjectId,
+      folly::StringPiece context);
+
   ~HgProxyHash() = default;
 
   HgProxyHash(const HgProxyHash& other) = default;
@@ -73,6 +89,19 @@ class HgProxyHash {
       LocalStore* store,
       const std::vector<Hash>& blobHashes);
 
+  /**
+   * Returns an id that embeds the (path, hgRevHash) tuple, so that it can be
+   * turned back into an HgProxyHash without storing or reading anything.
+   */
+  static ObjectId makeEmbeddedId(RelativePathPiece path, Hash hgRevHash);
+
+  /**
+   * Decodes an id made by makeEmbeddedId().  Returns std::nullopt if the id
+   * is not one, such as a plain Hash that needs a LocalStore lookup.
+   */
+  static std::optional<HgProxyHash> tryParseEmbeddedId(
+      const ObjectId& edenObjectId);
+
   /**
    * Store HgProxyHash data in the LocalStore.
    *
@@ -106,6 +135,14 @@ class HgProxyHash {
       LocalStore::WriteBatch* writeBatch);
 
  private:
+  /**
+   * The first byte of the ids made by makeEmbeddedId().  Those are longer
+   * than a Hash, so they cannot be mistaken for one.
+   */
+  static constexpr uint8_t kEmbeddedIdType = 0x01;
+
+  HgProxyHash() = default;
+
   HgProxyHash(
       Hash edenBlobHash,
       StoreResult& infoResult,
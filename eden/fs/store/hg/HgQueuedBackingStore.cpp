@@ -8,9 +8,13 @@
 #include "eden/fs/store/hg/HgQueuedBackingStore.h"
 
 #include <folly/Range.h>
+#include <folly/executors/InlineExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <folly/stop_watch.h>
 #include <gflags/gflags.h>
+#include <algorithm>
+#include <chrono>
 #include <thread>
 #include <utility>
 #include <variant>
@@ -25,6 +29,7 @@
 #include "eden/fs/store/hg/HgProxyHash.h"
 #include "eden/fs/telemetry/EdenStats.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
+#include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/EnumValue.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -32,7 +37,45 @@
 namespace facebook {
 namespace eden {
 
-DEFINE_uint64(hg_queue_batch_size, 1, "Number of requests per Hg import batch");
+DEFINE_uint64(
+    hg_queue_batch_size,
+    1,
+    "Number of requests per Hg import batch, when there is no EdenConfig");
+
+namespace {
+HgImportRequestQueue::Options getQueueOptions(
+    const std::shared_ptr<ReloadableConfig>& config) {
+  HgImportRequestQueue::Options options;
+  if (config) {
+    auto edenConfig = config->getEdenConfig();
+    options.fairScheduling = edenConfig->importQueueFairScheduling.getValue();
+    options.agingInterval = edenConfig->importQueueAgingInterval.getValue();
+  }
+  return options;
+}
+
+/**
+ * In adaptive mode, the pool grows by one worker for every this many imports
+ * waiting in the queue.
+ */
+constexpr size_t kPendingImportsPerWorker = 16;
+
+/** Batches are this many times larger during a build session. */
+constexpr size_t kBuildSessionBatchFactor = 4;
+
+void recordBatch(
+    const std::vector<HgImportRequest>& requests,
+    EdenThreadStatsBase::Histogram& queueWait,
+    EdenThreadStatsBase::Histogram& batchSize) {
+  auto now = std::chrono::steady_clock::now();
+  for (const auto& request : requests) {
+    queueWait.addValue(std::chrono::duration_cast<std::chrono::milliseconds>(
+                           now - request.getRequestTime())
+                           .count());
+  }
+  batchSize.addValue(requests.size());
+}
+} // namespace
 
 HgQueuedBackingStore::HgQueuedBackingStore(
     std::shared_ptr<LocalStore> localStore,
@@ -45,20 +88,162 @@ HgQueuedBackingStore::HgQueuedBackingStore(
       stats_(std::move(stats)),
       config_(std::move(config)),
       backingStore_(std::move(backingStore)),
+      proxyHashCache_{folly::in_place, kProxyHashCacheSize},
+      queue_{getQueueOptions(config_)},
+      defaultWorkerCount_(numberThreads),
       logger_(std::move(logger)) {
-  threads_.reserve(numberThreads);
-  for (int i = 0; i < numberThreads; i++) {
-    threads_.emplace_back(&HgQueuedBackingStore::processRequest, this);
-  }
+  updateWorkerCount();
 }
 
 HgQueuedBackingStore::~HgQueuedBackingStore() {
+  workers_.lock()->stopping = true;
+  workersCV_.notify_all();
   queue_.stop();
-  for (auto& thread : threads_) {
+
+  // No worker is started once `stopping` is set, so the threads can be joined
+  // without holding the lock.
+  auto threads = std::move(workers_.lock()->threads);
+  for (auto& thread : threads) {
     thread.join();
   }
 }
 
+HgImportRequestQueue::BatchSizes HgQueuedBackingStore::getBatchSizes() const {
+  size_t factor = buildSessionActive_.load(std::memory_order_relaxed)
+      ? kBuildSessionBatchFactor
+      : 1;
+  if (!config_) {
+    return HgImportRequestQueue::BatchSizes{
+        factor * FLAGS_hg_queue_batch_size,
+        factor * FLAGS_hg_queue_batch_size,
+        factor * FLAGS_hg_queue_batch_size};
+  }
+  const auto& edenConfig = config_->getConfigSnapshot();
+  return HgImportRequestQueue::BatchSizes{
+      factor * edenConfig.blobImportBatchSize.getValue(),
+      factor * edenConfig.treeImportBatchSize.getValue(),
+      factor * edenConfig.prefetchImportBatchSize.getValue()};
+}
+
+size_t HgQueuedBackingStore::getDesiredWorkerCount() const {
+  if (!config_) {
+    return defaultWorkerCount_;
+  }
+  const auto& edenConfig = config_->getConfigSnapshot();
+  size_t workerCount = edenConfig.importWorkerThreads.getValue();
+  size_t maxWorkerCount = edenConfig.importWorkerThreadsMax.getValue();
+  if (maxWorkerCount <= workerCount) {
+    return workerCount;
+  }
+  if (buildSessionActive_.load(std::memory_order_relaxed)) {
+    return maxWorkerCount;
+  }
+
+  size_t pending = 0;
+  for (auto object : HgBackingStore::hgImportObjects) {
+    pending += getImportMetric(
+        RequestMetricsScope::RequestStage::PENDING,
+        object,
+        RequestMetricsScope::RequestMetric::COUNT);
+  }
+  return std::clamp(
+      pending / kPendingImportsPerWorker, workerCount, maxWorkerCount);
+}
+
+void HgQueuedBackingStore::setBuildSessionActive(bool active) {
+  buildSessionActive_.store(active, std::memory_order_relaxed);
+  updateWorkerCount();
+}
+
+void HgQueuedBackingStore::updateWorkerCount() {
+  // Always keep one worker, otherwise nothing would ever process requests.
+  auto desired = std::max<size_t>(1, getDesiredWorkerCount());
+
+  auto workers = workers_.lock();
+  if (workers->stopping || workers->activeCount == desired) {
+    return;
+  }
+
+  XLOG(DBG2) << "resizing hg import worker pool from " << workers->activeCount
+             << " to " << desired << " threads";
+  workers->activeCount = desired;
+  for (size_t i = workers->threads.size(); i < desired; i++) {
+    workers->threads.emplace_back(
+        &HgQueuedBackingStore::processRequest, this, i);
+  }
+  workersCV_.notify_all();
+}
+
+bool HgQueuedBackingStore::waitUntilActive(size_t index) {
+  auto workers = workers_.lock();
+  while (!workers->stopping && index >= workers->activeCount) {
+    workersCV_.wait(workers.getUniqueLock());
+  }
+  return !workers->stopping;
+}
+
+HgProxyHash HgQueuedBackingStore::getProxyHash(
+    const Hash& id,
+    folly::StringPiece context) {
+  {
+    auto cache = proxyHashCache_.wlock();
+    auto it = cache->find(id);
+    if (it != cache->end()) {
+      return it->second;
+    }
+  }
+
+  auto proxyHash = HgProxyHash(localStore_.get(), id, context);
+  proxyHashCache_.wlock()->set(id, proxyHash);
+  return proxyHash;
+}
+
+folly::Future<std::vector<HgProxyHash>>
+HgQueuedBackingStore::getProxyHashBatch(const std::vector<Hash>& ids) {
+  std::vector<std::optional<HgProxyHash>> cached;
+  std::vector<Hash> missing;
+  cached.reserve(ids.size());
+
+  {
+    auto cache = proxyHashCache_.wlock();
+    for (const auto& id : ids) {
+      auto it = cache->find(id);
+      if (it != cache->end()) {
+        cached.emplace_back(it->second);
+      } else {
+        cached.emplace_back(std::nullopt);
+        missing.emplace_back(id);
+      }
+    }
+  }
+
+  auto loaded = missing.empty()
+      ? folly::makeFuture(std::vector<HgProxyHash>{})
+      : HgProxyHash::getBatch(localStore_.get(), missing);
+  return std::move(loaded).thenValue(
+      [this, cached = std::move(cached), missing = std::move(missing)](
+          std::vector<HgProxyHash>&& proxyHashes) mutable {
+        {
+          auto cache = proxyHashCache_.wlock();
+          for (size_t i = 0; i < missing.size(); ++i) {
+            cache->set(missing[i], proxyHashes[i]);
+          }
+        }
+
+        std::vector<HgProxyHash> results;
+        results.reserve(cached.size());
+        auto next = proxyHashes.begin();
+        for (auto& proxyHash : cached) {
+          if (proxyHash) {
+            results.emplace_back(std::move(*proxyHash));
+          } else {
+            results.emplace_back(std::move(*next++));
+          }
+        }
+        return results;
+      });
+}
+
 void HgQueuedBackingStore::processBlobImportRequests(
     std::vector<HgImportRequest>&& requests) {
   std::vector<Hash> hashes;
@@ -69,6 +254,11 @@ void HgQueuedBackingStore::processBlobImportRequests(
   promises.reserve(requests.size());
 
   XLOG(DBG4) << "Processing blob import batch size=" << requests.size();
+  auto& threadStats = stats_->getHgBackingStoreStatsForCurrentThread();
+  recordBatch(
+      requests,
+      threadStats.hgImportQueueWaitBlob,
+      threadStats.hgImportBatchSizeBlob);
 
   for (auto& request : requests) {
     auto& hash = request.getRequest<HgImportRequest::BlobImport>()->hash;
@@ -82,8 +272,7 @@ void HgQueuedBackingStore::processBlobImportRequests(
     promises.emplace_back(promise);
   }
 
-  auto proxyHashesTry =
-      HgProxyHash::getBatch(localStore_.get(), hashes).wait().result();
+  auto proxyHashesTry = getProxyHashBatch(hashes).wait().result();
 
   if (proxyHashesTry.hasException()) {
     // TODO(zeyi): We should change HgProxyHash::getBatch to make it return
@@ -101,75 +290,174 @@ void HgQueuedBackingStore::processBlobImportRequests(
 
   auto proxyHashes = proxyHashesTry.value();
 
-  backingStore_->getDatapackStore().getBlobBatch(hashes, proxyHashes, promises);
-
   {
-    auto request = requests.begin();
-    auto proxyHash = proxyHashes.begin();
-    std::vector<folly::SemiFuture<folly::Unit>> futures;
-    futures.reserve(requests.size());
-
-    XCHECK_EQ(requests.size(), proxyHashes.size());
-    for (; request != requests.end(); request++, proxyHash++) {
-      if (request->getPromise<HgImportRequest::BlobImport::Response>()
-              ->isFulfilled()) {
-        stats_->getHgBackingStoreStatsForCurrentThread()
-            .hgBackingStoreGetBlob.addValue(watch.elapsed().count());
-        continue;
-      }
-
-      futures.emplace_back(
-          backingStore_->fetchBlobFromHgImporter(*proxyHash)
-              .defer([request = std::move(*request), watch, stats = stats_](
-                         auto&& result) mutable {
-                auto hash =
-                    request.getRequest<HgImportRequest::BlobImport>()->hash;
-                XLOG(DBG4) << "Imported blob from HgImporter for " << hash;
-                stats->getHgBackingStoreStatsForCurrentThread()
-                    .hgBackingStoreGetBlob.addValue(watch.elapsed().count());
-                request.getPromise<HgImportRequest::BlobImport::Response>()
-                    ->setTry(std::forward<decltype(result)>(result));
-              }));
+    std::vector<TraceBlock> datapackBlocks;
+    datapackBlocks.reserve(requests.size());
+    for (const auto& request : requests) {
+      datapackBlocks.emplace_back(request.traceStage("hg datapack"));
     }
+    folly::stop_watch<std::chrono::milliseconds> batchWatch;
+    backingStore_->getDatapackStore().getBlobBatch(
+        hashes, proxyHashes, promises);
+    threadStats.hgImportBatchFetchBlob.addValue(batchWatch.elapsed().count());
+  }
 
-    folly::collectAll(futures).wait();
+  auto request = requests.begin();
+  auto proxyHash = proxyHashes.begin();
+
+  std::vector<HgImportRequest> remoteRequests;
+  std::vector<HgProxyHash> remoteProxyHashes;
+  std::vector<TraceBlock> remoteBlocks;
+  XCHECK_EQ(requests.size(), proxyHashes.size());
+  for (; request != requests.end(); request++, proxyHash++) {
+    if (request->getPromise<HgImportRequest::BlobImport::Response>()
+            ->isFulfilled()) {
+      threadStats.hgBackingStoreGetBlob.addValue(watch.elapsed().count());
+      continue;
+    }
+    remoteBlocks.emplace_back(request->traceStage("hg remote import"));
+    remoteRequests.emplace_back(std::move(*request));
+    remoteProxyHashes.emplace_back(std::move(*proxyHash));
   }
+  if (remoteRequests.empty()) {
+    return;
+  }
+
+  // Import the misses through one importer, which pipelines them to its
+  // helper, rather than occupying a helper per blob.  Do not wait for the
+  // import: the requests are completed from the importer thread, while this
+  // worker goes back to the queue.
+  backingStore_->fetchBlobsFromHgImporter(std::move(remoteProxyHashes))
+      .via(&folly::InlineExecutor::instance())
+      .thenTry([requests = std::move(remoteRequests),
+                remoteBlocks = std::move(remoteBlocks),
+                watch,
+                stats = stats_](
+                   folly::Try<std::vector<folly::Try<std::unique_ptr<Blob>>>>&&
+                       results) mutable {
+        remoteBlocks.clear();
+        for (size_t i = 0; i < requests.size(); ++i) {
+          auto& request = requests[i];
+          auto hash = request.getRequest<HgImportRequest::BlobImport>()->hash;
+          XLOG(DBG4) << "Imported blob from HgImporter for " << hash;
+          stats->getHgBackingStoreStatsForCurrentThread()
+              .hgBackingStoreGetBlob.addValue(watch.elapsed().count());
+          auto* promise =
+              request.getPromise<HgImportRequest::BlobImport::Response>();
+          if (results.hasException()) {
+            promise->setException(results.exception());
+          } else {
+            promise->setTry(std::move((*results)[i]));
+          }
+        }
+      });
 }
 
 void HgQueuedBackingStore::processTreeImportRequests(
     std::vector<HgImportRequest>&& requests) {
+  std::vector<Hash> hashes;
+  std::vector<folly::Promise<HgImportRequest::TreeImport::Response>*> promises;
+
+  hashes.reserve(requests.size());
+  promises.reserve(requests.size());
+
+  XLOG(DBG4) << "Processing tree import batch size=" << requests.size();
+  auto& threadStats = stats_->getHgBackingStoreStatsForCurrentThread();
+  recordBatch(
+      requests,
+      threadStats.hgImportQueueWaitTree,
+      threadStats.hgImportBatchSizeTree);
+
+  for (auto& request : requests) {
+    hashes.emplace_back(
+        request.getRequest<HgImportRequest::TreeImport>()->hash);
+    promises.emplace_back(
+        request.getPromise<HgImportRequest::TreeImport::Response>());
+  }
+
+  auto proxyHashesTry = getProxyHashBatch(hashes).wait().result();
+
+  if (proxyHashesTry.hasException()) {
+    // Unlike blobs, trees still go through the individual import path below,
+    // which reports the failure for the offending tree only.
+    XLOG(WARN) << "Failed to get proxy hash: "
+               << proxyHashesTry.exception().what();
+  } else {
+    std::vector<TraceBlock> batchBlocks;
+    batchBlocks.reserve(requests.size());
+    for (const auto& request : requests) {
+      batchBlocks.emplace_back(request.traceStage("hg tree batch"));
+    }
+    folly::stop_watch<std::chrono::milliseconds> batchWatch;
+    backingStore_->getTreeBatch(hashes, proxyHashesTry.value(), promises);
+    threadStats.hgImportBatchFetchTree.addValue(batchWatch.elapsed().count());
+  }
+
   for (auto& request : requests) {
-    auto parameter = request.getRequest<HgImportRequest::TreeImport>();
-    request.getPromise<HgImportRequest::TreeImport::Response>()->setWith(
-        [store = backingStore_.get(), hash = parameter->hash]() {
-          // TODO(kmancini): follow up with threading the context all the way
-          // through the backing store
-          return store->getTree(hash, ObjectFetchContext::getNullContext())
-              .getTry();
+    auto* promise = request.getPromise<HgImportRequest::TreeImport::Response>();
+    if (promise->isFulfilled()) {
+      continue;
+    }
+
+    auto hash = request.getRequest<HgImportRequest::TreeImport>()->hash;
+    auto remoteBlock = request.traceStage("hg remote import");
+    folly::makeSemiFutureWith([&] {
+      // TODO(kmancini): follow up with threading the context all the way
+      // through the backing store
+      return backingStore_->getTree(hash, ObjectFetchContext::getNullContext());
+    })
+        .via(&folly::InlineExecutor::instance())
+        // The request is kept until it is fulfilled so that it is counted as
+        // pending until then.
+        .thenTry([request = std::move(request),
+                  remoteBlock = std::move(remoteBlock)](
+                     folly::Try<std::unique_ptr<Tree>>&& result) mutable {
+          remoteBlock.close();
+          request.getPromise<HgImportRequest::TreeImport::Response>()->setTry(
+              std::move(result));
         });
   }
 }
 
 void HgQueuedBackingStore::processPrefetchRequests(
     std::vector<HgImportRequest>&& requests) {
+  auto& threadStats = stats_->getHgBackingStoreStatsForCurrentThread();
+  recordBatch(
+      requests,
+      threadStats.hgImportQueueWaitPrefetch,
+      threadStats.hgImportBatchSizePrefetch);
+
   for (auto& request : requests) {
     auto parameter = request.getRequest<HgImportRequest::Prefetch>();
-    request.getPromise<HgImportRequest::Prefetch::Response>()->setWith(
-        [store = backingStore_.get(), hashes = parameter->hashes]() {
-          return store
-              ->prefetchBlobs(hashes, ObjectFetchContext::getNullContext())
-              .getTry();
+    folly::makeSemiFutureWith([&] {
+      return backingStore_->prefetchBlobs(
+          parameter->hashes, ObjectFetchContext::getNullContext());
+    })
+        .via(&folly::InlineExecutor::instance())
+        // The request is kept until it is fulfilled so that it is counted as
+        // pending until then.
+        .thenTry([request = std::move(request)](
+                     folly::Try<folly::Unit>&& result) mutable {
+          request.getPromise<HgImportRequest::Prefetch::Response>()->setTry(
+              std::move(result));
         });
   }
 }
 
-void HgQueuedBackingStore::processRequest() {
+void HgQueuedBackingStore::processRequest(size_t index) {
   for (;;) {
-    auto requests = queue_.dequeue(FLAGS_hg_queue_batch_size);
+    if (!waitUntilActive(index)) {
+      break;
+    }
+
+    auto requests = queue_.dequeue(getBatchSizes());
 
     if (requests.empty()) {
       break;
     }
+    for (auto& request : requests) {
+      request.markDequeued();
+    }
 
     const auto& first = requests.at(0);
 
@@ -180,6 +468,9 @@ void HgQueuedBackingStore::processRequest() {
     } else if (first.isType<HgImportRequest::Prefetch>()) {
       processPrefetchRequests(std::move(requests));
     }
+
+    // Pick up config changes and queue depth variations.
+    updateWorkerCount();
   }
 }
 
@@ -188,34 +479,130 @@ folly::SemiFuture<std::unique_ptr<Tree>> HgQueuedBackingStore::getTree(
     ObjectFetchContext& context) {
   logBackingStoreFetch(context, id);
 
-  auto importTracker =
-      std::make_unique<RequestMetricsScope>(&pendingImportTreeWatches_);
+  // Trees already in the local datapacks do not need to wait behind remote
+  // fetches in the import queue. Anything going wrong here is reported by the
+  // regular import path instead.
+  auto localTree = folly::makeTryWith([&] {
+    TraceBlock block{"hg datapack"};
+    return backingStore_->getTreeLocal(id, getProxyHash(id, "getTree"));
+  });
+  if (localTree.hasValue() && localTree.value()) {
+    return folly::makeSemiFuture(std::move(localTree).value());
+  }
+  return enqueueTreeImport(id, context);
+}
+
+folly::SemiFuture<std::unique_ptr<Tree>>
+HgQueuedBackingStore::enqueueTreeImport(
+    const Hash& id,
+    ObjectFetchContext& context) {
+  RequestMetricsScope importTracker{&pendingImportTreeWatches_};
   auto [request, future] = HgImportRequest::makeTreeImportRequest(
-      id, context.getPriority(), std::move(importTracker));
+      id,
+      context.getPriority(),
+      std::move(importTracker),
+      context.getClientPid());
   queue_.enqueue(std::move(request));
   return std::move(future);
 }
 
+std::vector<folly::SemiFuture<std::unique_ptr<Tree>>>
+HgQueuedBackingStore::getTrees(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) {
+  // Resolve all the proxy hashes with one LocalStore read, instead of one per
+  // tree.  If that fails, the individual path reports it for each tree.
+  auto proxyHashes = getProxyHashBatch(ids).wait().result();
+  if (proxyHashes.hasException()) {
+    XLOG(WARN) << "Failed to get proxy hash: "
+               << proxyHashes.exception().what();
+    return BackingStore::getTrees(ids, context);
+  }
+
+  std::vector<folly::SemiFuture<std::unique_ptr<Tree>>> futures;
+  futures.reserve(ids.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    const auto& id = ids[i];
+    logBackingStoreFetch(context, id);
+    auto localTree = folly::makeTryWith([&] {
+      TraceBlock block{"hg datapack"};
+      return backingStore_->getTreeLocal(id, proxyHashes.value()[i]);
+    });
+    if (localTree.hasValue() && localTree.value()) {
+      futures.push_back(folly::makeSemiFuture(std::move(localTree).value()));
+    } else {
+      futures.push_back(enqueueTreeImport(id, context));
+    }
+  }
+  return futures;
+}
+
 folly::SemiFuture<std::unique_ptr<Blob>> HgQueuedBackingStore::getBlob(
     const Hash& id,
     ObjectFetchContext& context) {
-  auto proxyHash = HgProxyHash(localStore_.get(), id, "getBlob");
+  auto proxyHash = getProxyHash(id, "getBlob");
   auto path = proxyHash.path();
   logBackingStoreFetch(context, path);
 
-  if (auto blob =
-          backingStore_->getDatapackStore().getBlobLocal(id, proxyHash)) {
+  std::unique_ptr<Blob> blob;
+  {
+    TraceBlock block{"hg datapack"};
+    blob = backingStore_->getDatapackStore().getBlobLocal(id, proxyHash);
+  }
+  if (blob) {
     return folly::makeSemiFuture(std::move(blob));
   }
+  return enqueueBlobImport(id, context);
+}
 
-  auto importTracker =
-      std::make_unique<RequestMetricsScope>(&pendingImportBlobWatches_);
+folly::SemiFuture<std::unique_ptr<Blob>>
+HgQueuedBackingStore::enqueueBlobImport(
+    const Hash& id,
+    ObjectFetchContext& context) {
+  RequestMetricsScope importTracker{&pendingImportBlobWatches_};
   auto [request, future] = HgImportRequest::makeBlobImportRequest(
-      id, context.getPriority(), std::move(importTracker));
+      id,
+      context.getPriority(),
+      std::move(importTracker),
+      context.getClientPid());
   queue_.enqueue(std::move(request));
   return std::move(future);
 }
 
+std::vector<folly::SemiFuture<std::unique_ptr<Blob>>>
+HgQueuedBackingStore::getBlobs(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) {
+  // Resolve all the proxy hashes with one LocalStore read, instead of one per
+  // blob.  If that fails, the individual path reports it for each blob.
+  auto proxyHashes = getProxyHashBatch(ids).wait().result();
+  if (proxyHashes.hasException()) {
+    XLOG(WARN) << "Failed to get proxy hash: "
+               << proxyHashes.exception().what();
+    return BackingStore::getBlobs(ids, context);
+  }
+
+  std::vector<folly::SemiFuture<std::unique_ptr<Blob>>> futures;
+  futures.reserve(ids.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    const auto& id = ids[i];
+    const auto& proxyHash = proxyHashes.value()[i];
+    logBackingStoreFetch(context, proxyHash.path());
+
+    std::unique_ptr<Blob> blob;
+    {
+      TraceBlock block{"hg datapack"};
+      blob = backingStore_->getDatapackStore().getBlobLocal(id, proxyHash);
+    }
+    if (blob) {
+      futures.push_back(folly::makeSemiFuture(std::move(blob)));
+    } else {
+      futures.push_back(enqueueBlobImport(id, context));
+    }
+  }
+  return futures;
+}
+
 folly::SemiFuture<std::unique_ptr<Tree>> HgQueuedBackingStore::getTreeForCommit(
     const Hash& commitID) {
   return backingStore_->getTreeForCommit(commitID);
@@ -234,10 +621,12 @@ folly::SemiFuture<folly::Unit> HgQueuedBackingStore::prefetchBlobs(
   for (auto& hash : ids) {
     logBackingStoreFetch(context, hash);
   }
-  auto importTracker =
-      std::make_unique<RequestMetricsScope>(&pendingImportPrefetchWatches_);
+  RequestMetricsScope importTracker{&pendingImportPrefetchWatches_};
   auto [request, future] = HgImportRequest::makePrefetchRequest(
-      ids, ImportPriority::kNormal(), std::move(importTracker));
+      ids,
+      ImportPriority::kNormal(),
+      std::move(importTracker),
+      context.getClientPid());
   queue_.enqueue(std::move(request));
 
   return std::move(future);
@@ -249,7 +638,8 @@ void HgQueuedBackingStore::logBackingStoreFetch(
   if (!config_) {
     return;
   }
-  auto logFetchPath = config_->getEdenConfig()->logObjectFetchPath.getValue();
+  auto logFetchPath =
+      config_->getConfigSnapshot().logObjectFetchPath.getValue();
   if (!logFetchPath) {
     return;
   }
@@ -260,7 +650,7 @@ void HgQueuedBackingStore::logBackingStoreFetch(
   } else {
     auto hash = std::get<Hash>(identifier);
     try {
-      proxyHash = HgProxyHash(localStore_.get(), hash, "logBackingStoreFetch");
+      proxyHash = getProxyHash(hash, "logBackingStoreFetch");
       path = proxyHash.value().path();
     } catch (const std::domain_error&) {
       XLOG(WARN) << "Unable to get proxy hash for logging " << hash.toString();
@@ -282,8 +672,7 @@ size_t HgQueuedBackingStore::getImportMetric(
       metric, getImportWatches(stage, object));
 }
 
-RequestMetricsScope::LockedRequestWatchList&
-HgQueuedBackingStore::getImportWatches(
+RequestWatchList& HgQueuedBackingStore::getImportWatches(
     RequestMetricsScope::RequestStage stage,
     HgBackingStore::HgImportObject object) const {
   switch (stage) {
@@ -295,8 +684,7 @@ HgQueuedBackingStore::getImportWatches(
   EDEN_BUG() << "unknown hg import stage " << enumValue(stage);
 }
 
-RequestMetricsScope::LockedRequestWatchList&
-HgQueuedBackingStore::getPendingImportWatches(
+RequestWatchList& HgQueuedBackingStore::getPendingImportWatches(
     HgBackingStore::HgImportObject object) const {
   switch (object) {
     case HgBackingStore::HgImportObject::BLOB:
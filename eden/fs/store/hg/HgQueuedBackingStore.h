@@ -8,7 +8,13 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "eden/fs/model/Hash.h"
@@ -16,6 +22,7 @@
 #include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/store/hg/HgBackingStore.h"
 #include "eden/fs/store/hg/HgImportRequestQueue.h"
+#include "eden/fs/store/hg/HgProxyHash.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
 
 namespace facebook {
@@ -55,12 +62,30 @@ class HgQueuedBackingStore : public BackingStore {
       const Hash& id,
       ObjectFetchContext& context) override;
 
+  /**
+   * Resolves the proxy hashes of all the objects at once and reads each from
+   * the local datapacks, queuing only the misses for import, where the
+   * workers fetch them in batches.
+   */
+  std::vector<folly::SemiFuture<std::unique_ptr<Tree>>> getTrees(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) override;
+  std::vector<folly::SemiFuture<std::unique_ptr<Blob>>> getBlobs(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) override;
+
   folly::SemiFuture<std::unique_ptr<Tree>> getTreeForCommit(
       const Hash& commitID) override;
   folly::SemiFuture<std::unique_ptr<Tree>> getTreeForManifest(
       const Hash& commitID,
       const Hash& manifestID) override;
 
+  /**
+   * During a build session, runs the maximum number of workers and has them
+   * import larger batches, even before requests pile up.
+   */
+  void setBuildSessionActive(bool active) override;
+
   FOLLY_NODISCARD virtual folly::SemiFuture<folly::Unit> prefetchBlobs(
       const std::vector<Hash>& ids,
       ObjectFetchContext& context) override;
@@ -88,14 +113,60 @@ class HgQueuedBackingStore : public BackingStore {
   HgQueuedBackingStore(const HgQueuedBackingStore&) = delete;
   HgQueuedBackingStore& operator=(const HgQueuedBackingStore&) = delete;
 
+  /**
+   * Load the HgProxyHash of `id`, from the in-memory cache when possible.
+   */
+  HgProxyHash getProxyHash(const Hash& id, folly::StringPiece context);
+
+  /**
+   * Load the HgProxyHashes of `ids`, from the in-memory cache when possible.
+   * All the ones missing from the cache are read from the LocalStore in a
+   * single batch.
+   */
+  folly::Future<std::vector<HgProxyHash>> getProxyHashBatch(
+      const std::vector<Hash>& ids);
+
+  /**
+   * Queue the import of an object that is not in the local datapacks.
+   */
+  folly::SemiFuture<std::unique_ptr<Tree>> enqueueTreeImport(
+      const Hash& id,
+      ObjectFetchContext& context);
+  folly::SemiFuture<std::unique_ptr<Blob>> enqueueBlobImport(
+      const Hash& id,
+      ObjectFetchContext& context);
+
   void processBlobImportRequests(std::vector<HgImportRequest>&& requests);
   void processTreeImportRequests(std::vector<HgImportRequest>&& requests);
   void processPrefetchRequests(std::vector<HgImportRequest>&& requests);
 
   /**
-   * The worker runloop function.
+   * The worker runloop function. `index` identifies the worker in the pool.
    */
-  void processRequest();
+  void processRequest(size_t index);
+
+  /**
+   * Returns the number of requests of each type a worker processes at once.
+   */
+  HgImportRequestQueue::BatchSizes getBatchSizes() const;
+
+  /**
+   * Returns the number of workers that should be processing requests, based
+   * on the config and, in adaptive mode, on the number of pending imports.
+   */
+  size_t getDesiredWorkerCount() const;
+
+  /**
+   * Starts or parks workers so that getDesiredWorkerCount() workers are
+   * processing requests.
+   */
+  void updateWorkerCount();
+
+  /**
+   * Blocks worker `index` while it is in excess of the desired worker count.
+   * Returns false if the store is being destroyed.
+   */
+  bool waitUntilActive(size_t index);
 
   /**
    * Logs a backing store fetch to scuba if the path being fetched is
@@ -116,7 +187,7 @@ class HgQueuedBackingStore : public BackingStore {
    *        )
    *    gets the watches timing blob imports that are pending
    */
-  RequestMetricsScope::LockedRequestWatchList& getImportWatches(
+  RequestWatchList& getImportWatches(
       RequestMetricsScope::RequestStage stage,
       HgBackingStore::HgImportObject object) const;
 
@@ -127,7 +198,7 @@ class HgQueuedBackingStore : public BackingStore {
    *        )
    *    gets the watches timing pending blob imports
    */
-  RequestMetricsScope::LockedRequestWatchList& getPendingImportWatches(
+  RequestWatchList& getPendingImportWatches(
       HgBackingStore::HgImportObject object) const;
 
   std::shared_ptr<LocalStore> localStore_;
@@ -140,17 +211,51 @@ class HgQueuedBackingStore : public BackingStore {
 
   std::unique_ptr<HgBackingStore> backingStore_;
 
+  static constexpr size_t kProxyHashCacheSize = 100000;
+
+  /**
+   * Every blob import resolves the HgProxyHash of the blob, often several
+   * times (once when the request comes in, once when it is processed). The
+   * HgProxyHash of an id never changes, so keep a bounded cache of recently
+   * resolved ones to avoid hitting the LocalStore each time. Each entry is
+   * roughly 24 bytes plus the path length and the LRU overhead.
+   */
+  folly::Synchronized<folly::EvictingCacheMap<Hash, HgProxyHash>>
+      proxyHashCache_;
+
   /**
    * The import request queue. This queue is unbounded. This queue
    * implementation will ensure enqueue operation never blocks.
    */
   HgImportRequestQueue queue_;
 
+  struct Workers {
+    /**
+     * The worker thread pool. These threads will be running `processRequest`
+     * forever to process incoming import requests. Threads are only added:
+     * when the pool shrinks, the excess workers are parked until it grows
+     * again.
+     */
+    std::vector<std::thread> threads;
+
+    /**
+     * Workers with an index lower than this are processing requests, the
+     * other ones are parked.
+     */
+    size_t activeCount{0};
+
+    bool stopping{false};
+  };
+
+  folly::Synchronized<Workers, std::mutex> workers_;
+  std::condition_variable workersCV_;
+
   /**
-   * The worker thread pool. These threads will be running `processRequest`
-   * forever to process incoming import requests
+   * Number of workers when there is no config.
    */
-  std::vector<std::thread> threads_;
+  const size_t defaultWorkerCount_;
+
+  std::atomic<bool> buildSessionActive_{false};
 
   /**
    * Logger for backing store imports
@@ -158,10 +263,9 @@ class HgQueuedBackingStore : public BackingStore {
   std::unique_ptr<BackingStoreLogger> logger_;
 
   // Track metrics for queued imports
-  mutable RequestMetricsScope::LockedRequestWatchList pendingImportBlobWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList pendingImportTreeWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList
-      pendingImportPrefetchWatches_;
+  mutable RequestWatchList pendingImportBlobWatches_;
+  mutable RequestWatchList pendingImportTreeWatches_;
+  mutable RequestWatchList pendingImportPrefetchWatches_;
 };
 
 } // namespace eden
@@ -29,6 +29,10 @@
 using namespace facebook::eden;
 using namespace std::chrono_literals;
 
+namespace {
+constexpr size_t kTreeCacheMaximumSize = 1000; // bytes
+} // namespace
+
 struct TestRepo {
   folly::test::TemporaryDirectory testDir{"eden_hg_backing_store_test"};
   AbsolutePath testPath{testDir.path().string()};
@@ -65,6 +69,7 @@ struct HgBackingStoreTest : TestRepo, ::testing::Test {
   std::shared_ptr<ObjectStore> objectStore{ObjectStore::create(
       localStore,
       backingStore,
+      TreeCache::create(kTreeCacheMaximumSize, 0),
       stats,
       &folly::QueuedImmediateExecutor::instance(),
       std::make_shared<ProcessNameCache>(),
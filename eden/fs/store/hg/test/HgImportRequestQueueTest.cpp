@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <array>
 #include <memory>
+#include <thread>
 
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/store/ImportPriority.h"
@@ -28,23 +29,22 @@ Hash uniqueHash() {
 
 std::pair<Hash, HgImportRequest> makeBlobImportRequest(
     ImportPriority priority,
-    RequestMetricsScope::LockedRequestWatchList& pendingImportWatches) {
+    RequestWatchList& pendingImportWatches,
+    std::optional<pid_t> clientPid = std::nullopt) {
   auto hash = uniqueHash();
-  auto importTracker =
-      std::make_unique<RequestMetricsScope>(&pendingImportWatches);
+  RequestMetricsScope importTracker{&pendingImportWatches};
   return std::make_pair(
       hash,
       HgImportRequest::makeBlobImportRequest(
-          hash, priority, std::move(importTracker))
+          hash, priority, std::move(importTracker), clientPid)
           .first);
 }
 
 std::pair<Hash, HgImportRequest> makeTreeImportRequest(
     ImportPriority priority,
-    RequestMetricsScope::LockedRequestWatchList& pendingImportWatches) {
+    RequestWatchList& pendingImportWatches) {
   auto hash = uniqueHash();
-  auto importTracker =
-      std::make_unique<RequestMetricsScope>(&pendingImportWatches);
+  RequestMetricsScope importTracker{&pendingImportWatches};
   return std::make_pair(
       hash,
       HgImportRequest::makeTreeImportRequest(
@@ -55,7 +55,7 @@ std::pair<Hash, HgImportRequest> makeTreeImportRequest(
 TEST(HgImportRequestQueueTest, getRequestByPriority) {
   auto queue = HgImportRequestQueue{};
   std::vector<Hash> enqueued;
-  RequestMetricsScope::LockedRequestWatchList pendingImportWatches;
+  RequestWatchList pendingImportWatches;
 
   for (int i = 0; i < 10; i++) {
     auto [hash, request] = makeBlobImportRequest(
@@ -87,7 +87,7 @@ TEST(HgImportRequestQueueTest, getRequestByPriority) {
 TEST(HgImportRequestQueueTest, getRequestByPriorityReverse) {
   auto queue = HgImportRequestQueue{};
   std::deque<Hash> enqueued;
-  RequestMetricsScope::LockedRequestWatchList pendingImportWatches;
+  RequestWatchList pendingImportWatches;
 
   for (int i = 0; i < 10; i++) {
     auto [hash, request] = makeBlobImportRequest(
@@ -118,7 +118,7 @@ TEST(HgImportRequestQueueTest, getRequestByPriorityReverse) {
 }
 
 TEST(HgImportRequestQueueTest, getMultipleRequests) {
-  RequestMetricsScope::LockedRequestWatchList pendingImportWatches;
+  RequestWatchList pendingImportWatches;
 
   auto queue = HgImportRequestQueue{};
   std::set<Hash> enqueued_blob;
@@ -149,3 +149,224 @@ TEST(HgImportRequestQueueTest, getMultipleRequests) {
         enqueued_blob.end());
   }
 }
+
+TEST(HgImportRequestQueueTest, duplicateRequestsAreMerged) {
+  RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  auto hash = uniqueHash();
+
+  auto [lowRequest, lowFuture] = HgImportRequest::makeBlobImportRequest(
+      hash,
+      ImportPriority(ImportPriorityKind::Low, 0),
+      RequestMetricsScope{&pendingImportWatches});
+  queue.enqueue(std::move(lowRequest));
+
+  auto [otherHash, otherRequest] = makeBlobImportRequest(
+      ImportPriority(ImportPriorityKind::Normal, 0), pendingImportWatches);
+  queue.enqueue(std::move(otherRequest));
+
+  auto [highRequest, highFuture] = HgImportRequest::makeBlobImportRequest(
+      hash,
+      ImportPriority::kHigh(),
+      RequestMetricsScope{&pendingImportWatches});
+  queue.enqueue(std::move(highRequest));
+
+  // The duplicate request was merged, and raised the pending request above
+  // the normal priority one.
+  auto dequeued = queue.dequeue(1);
+  ASSERT_EQ(1, dequeued.size());
+  EXPECT_EQ(
+      hash, dequeued.at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+  EXPECT_EQ(
+      otherHash,
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+
+  dequeued.at(0)
+      .getPromise<HgImportRequest::BlobImport::Response>()
+      ->setValue(std::make_unique<Blob>(hash, folly::StringPiece{"content"}));
+
+  auto lowBlob = std::move(lowFuture).get();
+  auto highBlob = std::move(highFuture).get();
+  EXPECT_EQ(hash, lowBlob->getHash());
+  EXPECT_EQ(hash, highBlob->getHash());
+  EXPECT_NE(lowBlob.get(), highBlob.get());
+  EXPECT_EQ(7, lowBlob->getSize());
+  EXPECT_EQ(7, highBlob->getSize());
+}
+
+TEST(HgImportRequestQueueTest, fairSchedulingAlternatesBetweenClients) {
+  RequestWatchList pendingImportWatches;
+
+  HgImportRequestQueue::Options options;
+  options.fairScheduling = true;
+  auto queue = HgImportRequestQueue{options};
+
+  // A busy client queues many requests before an interactive one shows up.
+  std::vector<Hash> busy;
+  for (int i = 0; i < 10; i++) {
+    auto [hash, request] = makeBlobImportRequest(
+        ImportPriority(ImportPriorityKind::Normal, 10 - i),
+        pendingImportWatches,
+        pid_t{1});
+    queue.enqueue(std::move(request));
+    busy.push_back(hash);
+  }
+  EXPECT_EQ(
+      busy.at(0),
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+
+  auto [interactiveHash, interactiveRequest] = makeBlobImportRequest(
+      ImportPriority(ImportPriorityKind::Normal, 0),
+      pendingImportWatches,
+      pid_t{2});
+  queue.enqueue(std::move(interactiveRequest));
+
+  // The interactive client has not been served yet, so it goes first.
+  EXPECT_EQ(
+      interactiveHash,
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+  EXPECT_EQ(
+      busy.at(1),
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+}
+
+TEST(HgImportRequestQueueTest, fairSchedulingKeepsPriorityKinds) {
+  RequestWatchList pendingImportWatches;
+
+  HgImportRequestQueue::Options options;
+  options.fairScheduling = true;
+  auto queue = HgImportRequestQueue{options};
+
+  auto [lowHash, lowRequest] = makeBlobImportRequest(
+      ImportPriority::kLow(), pendingImportWatches, pid_t{1});
+  queue.enqueue(std::move(lowRequest));
+  for (int i = 0; i < 3; i++) {
+    auto [hash, request] = makeBlobImportRequest(
+        ImportPriority::kHigh(), pendingImportWatches, pid_t{2});
+    queue.enqueue(std::move(request));
+  }
+
+  EXPECT_EQ(3, queue.dequeue(3).size());
+  EXPECT_EQ(
+      lowHash,
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+}
+
+TEST(HgImportRequestQueueTest, waitingRequestsAreAged) {
+  RequestWatchList pendingImportWatches;
+
+  HgImportRequestQueue::Options options;
+  options.agingInterval = std::chrono::milliseconds(1);
+  auto queue = HgImportRequestQueue{options};
+
+  auto [lowHash, lowRequest] =
+      makeBlobImportRequest(ImportPriority::kLow(), pendingImportWatches);
+  queue.enqueue(std::move(lowRequest));
+
+  // Waiting for two aging intervals brings the request from Low to High.
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  auto [normalHash, normalRequest] =
+      makeBlobImportRequest(ImportPriority::kNormal(), pendingImportWatches);
+  queue.enqueue(std::move(normalRequest));
+
+  EXPECT_EQ(
+      lowHash,
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+  EXPECT_EQ(
+      normalHash,
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+}
+
+TEST(HgImportRequestQueueTest, batchSizesDependOnRequestType) {
+  RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  for (int i = 0; i < 5; i++) {
+    queue.enqueue(
+        makeTreeImportRequest(
+            ImportPriority(ImportPriorityKind::High, 0), pendingImportWatches)
+            .second);
+    queue.enqueue(makeBlobImportRequest(
+                      ImportPriority(ImportPriorityKind::Normal, 0),
+                      pendingImportWatches)
+                      .second);
+  }
+
+  HgImportRequestQueue::BatchSizes batchSizes;
+  batchSizes.blob = 4;
+  batchSizes.tree = 2;
+
+  auto trees = queue.dequeue(batchSizes);
+  EXPECT_EQ(2, trees.size());
+  EXPECT_TRUE(trees.at(0).isType<HgImportRequest::TreeImport>());
+
+  EXPECT_EQ(2, queue.dequeue(batchSizes).size());
+  EXPECT_EQ(1, queue.dequeue(batchSizes).size());
+
+  auto blobs = queue.dequeue(batchSizes);
+  EXPECT_EQ(4, blobs.size());
+  EXPECT_TRUE(blobs.at(0).isType<HgImportRequest::BlobImport>());
+}
+
+TEST(HgImportRequestQueueTest, batchesStopAtMoreUrgentRequestsOfOtherTypes) {
+  RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  for (int i = 0; i < 2; i++) {
+    queue.enqueue(
+        makeBlobImportRequest(ImportPriority::kHigh(), pendingImportWatches)
+            .second);
+  }
+  for (int i = 0; i < 2; i++) {
+    queue.enqueue(
+        makeBlobImportRequest(ImportPriority::kLow(), pendingImportWatches)
+            .second);
+  }
+  auto [treeHash, treeRequest] =
+      makeTreeImportRequest(ImportPriority::kNormal(), pendingImportWatches);
+  queue.enqueue(std::move(treeRequest));
+
+  EXPECT_EQ(2, queue.dequeue(10).size());
+  auto trees = queue.dequeue(10);
+  ASSERT_EQ(1, trees.size());
+  EXPECT_EQ(
+      treeHash, trees.at(0).getRequest<HgImportRequest::TreeImport>()->hash);
+  EXPECT_EQ(2, queue.dequeue(10).size());
+}
+
+TEST(HgImportRequestQueueTest, requestsAreCountedAsPendingUntilDestroyed) {
+  RequestWatchList pendingImportWatches;
+
+  auto queue = HgImportRequestQueue{};
+  auto hash = uniqueHash();
+  auto [request, future] = HgImportRequest::makeBlobImportRequest(
+      hash,
+      ImportPriority::kNormal(),
+      RequestMetricsScope{&pendingImportWatches});
+  queue.enqueue(std::move(request));
+  auto [duplicate, duplicateFuture] = HgImportRequest::makeBlobImportRequest(
+      hash,
+      ImportPriority::kNormal(),
+      RequestMetricsScope{&pendingImportWatches});
+  queue.enqueue(std::move(duplicate));
+  EXPECT_EQ(2, pendingImportWatches.size());
+
+  {
+    auto dequeued = queue.dequeue(1);
+    EXPECT_EQ(2, pendingImportWatches.size());
+    dequeued.at(0)
+        .getPromise<HgImportRequest::BlobImport::Response>()
+        ->setValue(std::make_unique<Blob>(hash, folly::StringPiece{"blob"}));
+  }
+  EXPECT_EQ(0, pendingImportWatches.size());
+
+  // The next request reuses the allocation of the dequeued one.
+  auto [otherHash, otherRequest] =
+      makeBlobImportRequest(ImportPriority::kNormal(), pendingImportWatches);
+  queue.enqueue(std::move(otherRequest));
+  EXPECT_EQ(
+      otherHash,
+      queue.dequeue(1).at(0).getRequest<HgImportRequest::BlobImport>()->hash);
+}
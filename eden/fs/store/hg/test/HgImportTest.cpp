@@ -14,8 +14,11 @@
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/model/Tree.h"
+#include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/hg/HgImportPyError.h"
 #include "eden/fs/store/hg/HgImporter.h"
+#include "eden/fs/store/hg/HgImporterPool.h"
+#include "eden/fs/store/hg/HgProxyHash.h"
 #include "eden/fs/telemetry/EdenStats.h"
 #include "eden/fs/testharness/HgRepo.h"
 #include "eden/fs/testharness/TestUtil.h"
@@ -77,6 +80,69 @@ TEST_F(HgImportTest, importTest) {
       "no match found");
 }
 
+TEST_F(HgImportTest, importFileContentsBatch) {
+  repo_.writeFile("a.txt", "file a\n");
+  repo_.writeFile("b.txt", "file b\n");
+  repo_.hg("add");
+  repo_.commit("Initial commit");
+
+  // Each manifest line is the 40-character hash, a space, and the path.
+  auto manifest = repo_.hg("manifest", "--debug");
+  auto hashA = Hash{manifest.substr(0, 40)};
+  auto hashB = Hash{manifest.substr(manifest.find('\n') + 1, 40)};
+
+  MemoryLocalStore localStore;
+  auto batch = localStore.beginWrite();
+  std::vector<Hash> ids{
+      HgProxyHash::store("a.txt"_relpath, hashA, batch.get()),
+      HgProxyHash::store("missing.txt"_relpath, hashA, batch.get()),
+      HgProxyHash::store("b.txt"_relpath, hashB, batch.get()),
+  };
+  batch->flush();
+  std::vector<HgProxyHash> files;
+  for (const auto& id : ids) {
+    files.emplace_back(&localStore, id, "importFileContentsBatch");
+  }
+
+  HgImporter importer(repo_.path(), stats_);
+  auto blobs = importer.importFileContentsBatch(files);
+  ASSERT_EQ(3, blobs.size());
+  EXPECT_BLOB_EQ(blobs[0].value(), "file a\n");
+  // A missing file fails only its own result.
+  EXPECT_TRUE(blobs[1].hasException());
+  EXPECT_BLOB_EQ(blobs[2].value(), "file b\n");
+
+  // The importer is still in sync with its helper afterwards.
+  EXPECT_BLOB_EQ(
+      importer.importFileContents("b.txt"_relpath, hashB), "file b\n");
+}
+
+TEST_F(HgImportTest, importerPoolReusesAndRecyclesHelpers) {
+  StringPiece data = "pooled\n";
+  RelativePathPiece filePath{"pooled.txt"};
+  repo_.writeFile(filePath, data);
+  repo_.hg("add");
+  repo_.commit("Initial commit");
+  auto fileHash = Hash{repo_.hg("manifest", "--debug").substr(0, 40)};
+
+  HgImporterPool pool(repo_.path(), stats_, /*maxRequestsPerHelper=*/2, 0);
+  EXPECT_EQ(0, pool.getIdleHelperCount());
+
+  EXPECT_BLOB_EQ(pool.importFileContents(filePath, fileHash), data);
+  EXPECT_EQ(1, pool.getIdleHelperCount());
+
+  // The second request is served by the same helper, which is then retired.
+  EXPECT_BLOB_EQ(pool.importFileContents(filePath, fileHash), data);
+  EXPECT_EQ(0, pool.getIdleHelperCount());
+
+  // A failed request leaves its helper in the pool.
+  EXPECT_THROW_RE(
+      pool.importFileContents(filePath, makeTestHash("123")),
+      std::exception,
+      "no match found");
+  EXPECT_EQ(1, pool.getIdleHelperCount());
+}
+
 // TODO(T33797958): Check hg_importer_helper's exit code on Windows (in
 // HgImportTest).
 #ifndef _WIN32
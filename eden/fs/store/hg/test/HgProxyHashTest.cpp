@@ -63,3 +63,40 @@ TEST(HgProxyHashTest, testCopyMove) {
       orig1.revHash(),
       Hash{folly::StringPiece{"0000000000000000000000000000000000000000"}});
 }
+
+TEST(HgProxyHashTest, embeddedIdsDoNotNeedTheStore) {
+  auto store = std::make_shared<MemoryLocalStore>();
+  auto revHash =
+      Hash{folly::StringPiece{"1111111111111111111111111111111111111111"}};
+  auto id = HgProxyHash::makeEmbeddedId(RelativePathPiece{"foo/bar"}, revHash);
+  EXPECT_FALSE(id.isHash());
+
+  auto embedded = HgProxyHash::tryParseEmbeddedId(id);
+  ASSERT_TRUE(embedded.has_value());
+  EXPECT_EQ(RelativePathPiece{"foo/bar"}, embedded->path());
+  EXPECT_EQ(revHash, embedded->revHash());
+
+  // Nothing was stored for the id, so this must not go to the store.
+  auto proxyHash = HgProxyHash{store.get(), id, "test"};
+  EXPECT_EQ(RelativePathPiece{"foo/bar"}, proxyHash.path());
+  EXPECT_EQ(revHash, proxyHash.revHash());
+}
+
+TEST(HgProxyHashTest, hashIdsAreLookedUpInTheStore) {
+  auto store = std::make_shared<MemoryLocalStore>();
+  auto revHash =
+      Hash{folly::StringPiece{"DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD"}};
+  Hash hash;
+  {
+    auto write = store->beginWrite();
+    hash = HgProxyHash::store(
+        RelativePathPiece{"barfoo"}, revHash, write.get());
+    write->flush();
+  }
+
+  ObjectId id{hash};
+  EXPECT_FALSE(HgProxyHash::tryParseEmbeddedId(id).has_value());
+  auto proxyHash = HgProxyHash{store.get(), id, "test"};
+  EXPECT_EQ(RelativePathPiece{"barfoo"}, proxyHash.path());
+  EXPECT_EQ(revHash, proxyHash.revHash());
+}
@@ -114,3 +114,27 @@ TEST_F(HgQueuedBackingStoreTest, getBlob) {
     }
   }
 }
+
+TEST_F(HgQueuedBackingStoreTest, getBlobUsesCachedProxyHash) {
+  auto queuedStore = makeQueuedStore();
+  auto tree = queuedStore->getTreeForCommit(commit1)
+                  .via(&folly::QueuedImmediateExecutor::instance())
+                  .get(kTestTimeout);
+  auto entry = tree->getEntryPtr("foo.txt"_pc);
+  ASSERT_NE(nullptr, entry);
+
+  auto blob =
+      queuedStore
+          ->getBlob(entry->getHash(), ObjectFetchContext::getNullContext())
+          .via(&folly::QueuedImmediateExecutor::instance())
+          .get(kTestTimeout);
+  EXPECT_EQ(blob->getContents().cloneAsValue().moveToFbString(), "foo\n");
+
+  // The proxy hash resolved by the first read is kept in memory.
+  localStore->clearKeySpace(KeySpace::HgProxyHashFamily);
+  blob = queuedStore
+             ->getBlob(entry->getHash(), ObjectFetchContext::getNullContext())
+             .via(&folly::QueuedImmediateExecutor::instance())
+             .get(kTestTimeout);
+  EXPECT_EQ(blob->getContents().cloneAsValue().moveToFbString(), "foo\n");
+}
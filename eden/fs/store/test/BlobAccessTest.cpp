@@ -11,8 +11,10 @@
 #include <chrono>
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/BlobChunks.h"
 #include "eden/fs/store/StoreResult.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
+#include "eden/fs/testharness/FakeObjectStore.h"
 #include "eden/fs/testharness/LoggingFetchContext.h"
 #ifndef _WIN32
 #include "eden/fs/utils/ProcessNameCache.h"
@@ -37,6 +39,8 @@ const auto blob4 = std::make_shared<Blob>(hash4, "4444"_sp);
 const auto blob5 = std::make_shared<Blob>(hash5, "55555"_sp);
 const auto blob6 = std::make_shared<Blob>(hash6, "666666"_sp);
 
+constexpr size_t kTreeCacheMaximumSize = 1000; // bytes
+
 /**
  * These tests attempt to measure the number of hits to the backing store, so
  * prevent anything from getting cached in the local store.
@@ -77,6 +81,7 @@ struct BlobAccessTest : ::testing::Test {
         objectStore{ObjectStore::create(
             localStore,
             backingStore,
+            TreeCache::create(kTreeCacheMaximumSize, 0),
             std::make_shared<EdenStats>(),
             &folly::QueuedImmediateExecutor::instance(),
             std::make_shared<ProcessNameCache>(),
@@ -152,3 +157,70 @@ TEST_F(BlobAccessTest, drops_oldest_blobs) {
   EXPECT_EQ(2, backingStore->getAccessCount(hash4));
   EXPECT_EQ(1, backingStore->getAccessCount(hash5));
 }
+
+TEST_F(BlobAccessTest, get_blob_range_is_null_without_chunks) {
+  EXPECT_EQ(
+      nullptr,
+      blobAccess.getBlobRange(hash4, 0, 4, ObjectFetchContext::getNullContext())
+          .get(0ms));
+}
+
+TEST(BlobAccessRangeTest, reads_only_the_chunks_covering_the_range) {
+  auto objectStore = std::make_shared<FakeObjectStore>();
+  BlobAccess blobAccess{objectStore,
+                        BlobCache::create(4 * kBlobChunkSize, 0)};
+  std::string contents(2 * kBlobChunkSize + 10, 'a');
+  contents[kBlobChunkSize] = 'b';
+  objectStore->addBlob(Blob{hash3, folly::IOBuf{folly::IOBuf::COPY_BUFFER,
+                                                contents}});
+  auto& context = ObjectFetchContext::getNullContext();
+
+  auto range =
+      blobAccess.getBlobRange(hash3, kBlobChunkSize - 2, 4, context).get(0ms);
+  ASSERT_NE(nullptr, range);
+  EXPECT_EQ("aaba", range->moveToFbString());
+  EXPECT_EQ(0, objectStore->getAccessCount(hash3));
+  EXPECT_EQ(1, objectStore->getAccessCount(blobChunkId(hash3, 0)));
+  EXPECT_EQ(1, objectStore->getAccessCount(blobChunkId(hash3, 1)));
+  EXPECT_EQ(0, objectStore->getAccessCount(blobChunkId(hash3, 2)));
+
+  // The chunks are cached.
+  range = blobAccess.getBlobRange(hash3, kBlobChunkSize, 1, context).get(0ms);
+  ASSERT_NE(nullptr, range);
+  EXPECT_EQ("b", range->moveToFbString());
+  EXPECT_EQ(1, objectStore->getAccessCount(blobChunkId(hash3, 1)));
+
+  // Reads are truncated at the end of the blob.
+  range = blobAccess.getBlobRange(hash3, 2 * kBlobChunkSize + 8, 100, context)
+              .get(0ms);
+  ASSERT_NE(nullptr, range);
+  EXPECT_EQ("aa", range->moveToFbString());
+}
+
+TEST(BlobAccessRangeTest, prefetched_chunks_are_cached) {
+  auto objectStore = std::make_shared<FakeObjectStore>();
+  BlobAccess blobAccess{objectStore,
+                        BlobCache::create(4 * kBlobChunkSize, 0)};
+  std::string contents(2 * kBlobChunkSize, 'a');
+  objectStore->addBlob(Blob{hash3, folly::IOBuf{folly::IOBuf::COPY_BUFFER,
+                                                contents}});
+
+  blobAccess.prefetchBlobRange(hash3, kBlobChunkSize, kBlobChunkSize);
+  EXPECT_EQ(0, objectStore->getAccessCount(blobChunkId(hash3, 0)));
+  EXPECT_EQ(1, objectStore->getAccessCount(blobChunkId(hash3, 1)));
+
+  auto range = blobAccess
+                   .getBlobRange(
+                       hash3,
+                       kBlobChunkSize,
+                       3,
+                       ObjectFetchContext::getNullContext())
+                   .get(0ms);
+  ASSERT_NE(nullptr, range);
+  EXPECT_EQ("aaa", range->moveToFbString());
+  EXPECT_EQ(1, objectStore->getAccessCount(blobChunkId(hash3, 1)));
+
+  // Prefetching chunks that are already cached does not reload them.
+  blobAccess.prefetchBlobRange(hash3, kBlobChunkSize, kBlobChunkSize);
+  EXPECT_EQ(1, objectStore->getAccessCount(blobChunkId(hash3, 1)));
+}
@@ -258,3 +258,220 @@ TEST(
   handle3.reset();
   EXPECT_TRUE(cache->contains(hash3));
 }
+
+TEST(BlobCache, sharded_cache_divides_limits_across_shards) {
+  auto cache = BlobCache::create(1000, 4, 4);
+  cache->insert(blob3);
+  cache->insert(blob4);
+  cache->insert(blob5);
+  cache->insert(blob6);
+  cache->insert(blob9);
+
+  auto stats = cache->getStats();
+  EXPECT_EQ(5, stats.blobCount);
+  EXPECT_EQ(27, stats.totalSizeInBytes);
+  EXPECT_EQ(blob3, cache->get(hash3).blob);
+  EXPECT_EQ(blob9, cache->get(hash9).blob);
+  EXPECT_EQ(2, cache->getStats().hitCount);
+}
+
+TEST(BlobCache, sharded_cache_interest_handles_evict_from_their_shard) {
+  auto cache = BlobCache::create(1000, 0, 8);
+  auto handle3 = cache->insert(blob3, BlobCache::Interest::WantHandle);
+  auto handle4 = cache->insert(blob4, BlobCache::Interest::WantHandle);
+
+  handle3.reset();
+  EXPECT_FALSE(cache->contains(hash3));
+  EXPECT_TRUE(cache->contains(hash4));
+
+  cache->clear();
+  EXPECT_FALSE(cache->contains(hash4));
+  EXPECT_EQ(0, cache->getStats().totalSizeInBytes);
+}
+
+TEST(BlobCache, evicted_blobs_are_served_from_the_compressed_tier) {
+  const auto hashA = Hash{"0000000000000000000000000000000000000010"_sp};
+  const auto hashB = Hash{"0000000000000000000000000000000000000011"_sp};
+  auto blobA = std::make_shared<Blob>(hashA, std::string(4096, 'a'));
+  auto blobB = std::make_shared<Blob>(hashB, std::string(4096, 'b'));
+
+  auto cache = BlobCache::create(4096, 0, 1, 4096);
+  cache->insert(blobA);
+  cache->insert(blobB); // evicts blobA into the compressed tier
+
+  auto stats = cache->getStats();
+  EXPECT_EQ(1, stats.blobCount);
+  EXPECT_EQ(1, stats.compressedBlobCount);
+  EXPECT_LT(stats.compressedSizeInBytes, 4096);
+
+  auto result = cache->get(hashA);
+  ASSERT_TRUE(result.blob);
+  EXPECT_EQ(hashA, result.blob->getHash());
+  EXPECT_EQ(
+      std::string(4096, 'a'),
+      result.blob->getContents().clone()->moveToFbString().toStdString());
+
+  stats = cache->getStats();
+  EXPECT_EQ(1, stats.compressedHitCount);
+  // blobA is uncompressed again, and blobB has taken its place.
+  EXPECT_EQ(1, stats.blobCount);
+  EXPECT_EQ(1, stats.compressedBlobCount);
+}
+
+TEST(BlobCache, small_blobs_are_not_kept_compressed) {
+  auto cache = BlobCache::create(10, 0, 1, 1024);
+  cache->insert(blob3);
+  cache->insert(blob9);
+  EXPECT_EQ(0, cache->getStats().compressedBlobCount);
+  EXPECT_FALSE(cache->get(hash3).blob);
+}
+
+TEST(BlobCache, segmented_cache_evicts_blobs_read_once_first) {
+  auto cache = BlobCache::create(12, 0, 1, 0, 6);
+  cache->insert(blob3);
+  EXPECT_EQ(blob3, cache->get(hash3).blob); // protects blob3
+
+  // A scan reads each of these once.
+  cache->insert(blob4);
+  cache->insert(blob5);
+  cache->insert(blob6);
+
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_FALSE(cache->contains(hash4));
+  EXPECT_FALSE(cache->contains(hash5));
+  EXPECT_TRUE(cache->contains(hash6));
+  EXPECT_EQ(1, cache->getStats().protectedBlobCount);
+  EXPECT_EQ(3, cache->getStats().protectedSizeInBytes);
+}
+
+TEST(BlobCache, unlikely_needed_again_hits_do_not_protect) {
+  auto cache = BlobCache::create(10, 0, 1, 0, 6);
+  cache->insert(blob3);
+  EXPECT_EQ(
+      blob3, cache->get(hash3, BlobCache::Interest::UnlikelyNeededAgain).blob);
+  EXPECT_EQ(0, cache->getStats().protectedBlobCount);
+
+  cache->insert(blob4);
+  cache->insert(blob5);
+  EXPECT_FALSE(cache->contains(hash3));
+}
+
+TEST(BlobCache, protected_overflow_returns_to_probation) {
+  auto cache = BlobCache::create(12, 0, 1, 0, 6);
+  cache->insert(blob4);
+  cache->get(hash4);
+  cache->insert(blob5);
+  cache->get(hash5); // demotes blob4
+  EXPECT_EQ(1, cache->getStats().protectedBlobCount);
+  EXPECT_EQ(5, cache->getStats().protectedSizeInBytes);
+
+  // blob4 is now the only probationary blob, so it is evicted first.
+  cache->insert(blob6);
+  EXPECT_FALSE(cache->contains(hash4));
+  EXPECT_TRUE(cache->contains(hash5));
+  EXPECT_TRUE(cache->contains(hash6));
+}
+
+TEST(BlobCache, sequentially_read_blob_is_demoted_if_still_referenced) {
+  auto cache = BlobCache::create(12, 0, 1, 0, 6);
+  cache->insert(blob3);
+  cache->get(hash3); // protects blob3
+  auto result = cache->get(hash3, BlobCache::Interest::WantHandle);
+  cache->insert(blob4);
+
+  result.interestHandle.reset(BlobInterestHandle::Usage::ReadSequentially);
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_EQ(0, cache->getStats().protectedBlobCount);
+  EXPECT_EQ(1, cache->getStats().demoteCount);
+
+  // blob3 is now evicted ahead of blob4.
+  cache->insert(blob6);
+  EXPECT_FALSE(cache->contains(hash3));
+  EXPECT_TRUE(cache->contains(hash4));
+}
+
+TEST(BlobCache, sequentially_read_blob_with_one_reader_is_dropped) {
+  auto cache = BlobCache::create(100, 0);
+  auto handle = cache->insert(blob3, BlobCache::Interest::WantHandle);
+  handle.reset(BlobInterestHandle::Usage::ReadSequentially);
+  EXPECT_FALSE(cache->contains(hash3));
+  EXPECT_EQ(1, cache->getStats().dropCount);
+}
+
+TEST(BlobCache, randomly_read_blob_outlives_its_handle) {
+  auto cache = BlobCache::create(100, 0);
+  auto handle = cache->insert(blob3, BlobCache::Interest::WantHandle);
+  handle.reset(BlobInterestHandle::Usage::ReadRandomly);
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_EQ(0, cache->getStats().dropCount);
+  EXPECT_EQ(1, cache->getStats().retainCount);
+}
+
+TEST(BlobCache, blob_shared_by_several_readers_outlives_their_handles) {
+  auto cache = BlobCache::create(100, 0);
+  auto handle1 = cache->insert(blob3, BlobCache::Interest::WantHandle);
+  auto result2 = cache->get(hash3, BlobCache::Interest::WantHandle);
+
+  handle1.reset(BlobInterestHandle::Usage::ReadSequentially);
+  result2.interestHandle.reset(BlobInterestHandle::Usage::ReadSequentially);
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_EQ(0, cache->getStats().demoteCount);
+  EXPECT_EQ(1, cache->getStats().retainCount);
+}
+
+TEST(BlobCache, released_blobs_are_retained_while_requested) {
+  auto cache = BlobCache::create(100, 0);
+  cache->setRetainReleasedBlobs(true);
+  auto handle = cache->insert(blob3, BlobCache::Interest::WantHandle);
+  handle.reset(BlobInterestHandle::Usage::ReadSequentially);
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_EQ(1, cache->getStats().retainCount);
+
+  cache->setRetainReleasedBlobs(false);
+  handle = cache->insert(blob4, BlobCache::Interest::WantHandle);
+  handle.reset();
+  EXPECT_FALSE(cache->contains(hash4));
+}
+
+TEST(BlobCache, shrinking_maximum_size_evicts_oldest_blobs) {
+  auto cache = BlobCache::create(12, 0);
+  cache->insert(blob3);
+  cache->insert(blob4);
+  cache->insert(blob5);
+  EXPECT_EQ(12, cache->getStats().totalSizeInBytes);
+
+  cache->setMaximumCacheSize(9);
+  EXPECT_FALSE(cache->contains(hash3));
+  EXPECT_TRUE(cache->contains(hash4));
+  EXPECT_TRUE(cache->contains(hash5));
+
+  // A larger budget takes effect for later inserts.
+  cache->setMaximumCacheSize(15);
+  cache->insert(blob6);
+  EXPECT_TRUE(cache->contains(hash4));
+  EXPECT_EQ(15, cache->getStats().totalSizeInBytes);
+}
+
+TEST(BlobCache, lists_protected_then_probationary_blobs_most_recent_first) {
+  auto cache = BlobCache::create(30, 0, 1, 0, 10);
+  cache->insert(blob3);
+  cache->insert(blob4);
+  cache->insert(blob5);
+  cache->get(hash3); // protects blob3
+  EXPECT_EQ(
+      (std::vector<Hash>{hash3, hash5, hash4}), cache->getCachedHashes());
+}
+
+TEST(BlobCache, mapped_blobs_take_no_cache_space) {
+  auto cache = BlobCache::create(10, 0);
+  auto mapped = std::make_shared<Blob>(
+      hash9,
+      folly::IOBuf{folly::IOBuf::COPY_BUFFER, "999999999"_sp},
+      Blob::Mapped{});
+  cache->insert(blob3);
+  cache->insert(mapped);
+  cache->insert(blob6);
+  EXPECT_EQ(9, cache->getStats().totalSizeInBytes);
+  EXPECT_EQ(blob3, cache->get(hash3).blob);
+  EXPECT_EQ(mapped, cache->get(hash9).blob);
+}
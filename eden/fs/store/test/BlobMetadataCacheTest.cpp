@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobMetadataCache.h"
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+namespace {
+
+Hash blobId(size_t i) {
+  auto data = folly::to<std::string>("blob ", i);
+  return Hash::sha1(folly::StringPiece{data});
+}
+
+BlobMetadata metadataFor(size_t i) {
+  return BlobMetadata{blobId(i + 1000000), i};
+}
+
+class BlobMetadataCacheTest : public ::testing::TestWithParam<bool> {};
+
+} // namespace
+
+TEST_P(BlobMetadataCacheTest, returnsWhatWasSet) {
+  BlobMetadataCache cache{1024 * 1024, GetParam()};
+  EXPECT_FALSE(cache.get(blobId(1)).has_value());
+
+  cache.set(blobId(1), metadataFor(1));
+  cache.set(blobId(2), metadataFor(2));
+  auto metadata = cache.get(blobId(1));
+  ASSERT_TRUE(metadata.has_value());
+  EXPECT_EQ(metadataFor(1).sha1, metadata->sha1);
+  EXPECT_EQ(1, metadata->size);
+
+  // Setting an entry again replaces it.
+  cache.set(blobId(1), metadataFor(3));
+  EXPECT_EQ(3, cache.get(blobId(1))->size);
+  EXPECT_GT(cache.getMemoryUsage(), 0);
+}
+
+TEST_P(BlobMetadataCacheTest, staysWithinItsBudget) {
+  constexpr size_t kMaxBytes = 64 * 1024;
+  BlobMetadataCache cache{kMaxBytes, GetParam()};
+  constexpr size_t kCount = 10000;
+  for (size_t i = 0; i < kCount; ++i) {
+    cache.set(blobId(i), metadataFor(i));
+  }
+  EXPECT_LE(cache.getMemoryUsage(), kMaxBytes);
+
+  // The most recent entries are kept, and most of the oldest are evicted.
+  size_t oldHits = 0;
+  for (size_t i = 0; i < kCount / 2; ++i) {
+    oldHits += cache.get(blobId(i)).has_value();
+  }
+  EXPECT_LT(oldHits, kCount / 20);
+  EXPECT_EQ(kCount - 1, cache.get(blobId(kCount - 1))->size);
+}
+
+TEST(BlobMetadataCache, compactTableKeepsRecentlyReadEntries) {
+  // Room for a single bucket in each shard.
+  BlobMetadataCache cache{BlobMetadataCache::kNumShards * 400, true};
+  cache.set(blobId(0), metadataFor(0));
+  auto shardOf = [](const Hash& id) {
+    return id.getBytes()[Hash::RAW_SIZE - 1] % BlobMetadataCache::kNumShards;
+  };
+  // Fill blob 0's bucket, reading blob 0 each time so that it stays in.
+  size_t added = 0;
+  for (size_t i = 1; added < 2 * BlobMetadataCache::kWays; ++i) {
+    if (shardOf(blobId(i)) != shardOf(blobId(0))) {
+      continue;
+    }
+    cache.set(blobId(i), metadataFor(i));
+    ASSERT_TRUE(cache.get(blobId(0)).has_value());
+    ++added;
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    BlobMetadataCache,
+    BlobMetadataCacheTest,
+    ::testing::Values(false, true));
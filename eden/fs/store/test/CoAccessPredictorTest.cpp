@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/CoAccessPredictor.h"
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+#include "eden/fs/store/MemoryLocalStore.h"
+
+using namespace facebook::eden;
+
+namespace {
+
+constexpr pid_t kPid = 1234;
+
+Hash blobId(size_t i) {
+  auto data = folly::to<std::string>("blob ", i);
+  return Hash::sha1(folly::StringPiece{data});
+}
+
+class CoAccessPredictorTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<CoAccessPredictor> makePredictor(std::string scope) {
+    auto predictor =
+        std::make_unique<CoAccessPredictor>(localStore, std::move(scope), 100);
+    predictor->load();
+    return predictor;
+  }
+
+  /** Reads blobs 0, 1 and 2, then blobs other processes do not follow. */
+  void readSequence(CoAccessPredictor& predictor, size_t run) {
+    for (size_t i = 0; i < 3; ++i) {
+      predictor.recordAccess(kPid, blobId(i));
+    }
+    for (size_t i = 0; i < CoAccessPredictor::kWindowSize; ++i) {
+      predictor.recordAccess(kPid, blobId(1000 * (run + 1) + i));
+    }
+  }
+
+  std::shared_ptr<LocalStore> localStore{
+      std::make_shared<MemoryLocalStore>()};
+};
+
+} // namespace
+
+TEST(CoAccessPredictor, serializeRoundTrip) {
+  std::vector<CoAccessPredictor::Trigger> triggers{
+      {blobId(1), {{blobId(2), 3}, {blobId(3), 1}}},
+      {blobId(4), {}},
+  };
+  auto bytes = CoAccessPredictor::serialize(triggers);
+  EXPECT_EQ(2 * (1 + Hash::RAW_SIZE) + 2 * (1 + Hash::RAW_SIZE), bytes.size());
+  EXPECT_EQ(
+      triggers, CoAccessPredictor::deserialize(folly::StringPiece{bytes}));
+
+  // A truncated trigger is dropped.
+  bytes.pop_back();
+  EXPECT_EQ(
+      std::vector<CoAccessPredictor::Trigger>{triggers[0]},
+      CoAccessPredictor::deserialize(folly::StringPiece{bytes}));
+}
+
+TEST_F(CoAccessPredictorTest, predictsBlobsReadTogetherRepeatedly) {
+  auto predictor = makePredictor("/mnt/repo");
+
+  // A sequence seen once is not predicted.
+  readSequence(*predictor, 0);
+  EXPECT_TRUE(predictor->recordAccess(kPid, blobId(0)).toPrefetch.empty());
+
+  readSequence(*predictor, 1);
+  auto result = predictor->recordAccess(kPid, blobId(0));
+  EXPECT_EQ((std::vector<Hash>{blobId(1), blobId(2)}), result.toPrefetch);
+  EXPECT_FALSE(result.wasPredicted);
+
+  // Predictions are made once, until they are read.
+  EXPECT_TRUE(predictor->recordAccess(kPid + 1, blobId(0)).toPrefetch.empty());
+  EXPECT_TRUE(predictor->recordAccess(kPid, blobId(1)).wasPredicted);
+
+  auto stats = predictor->getStats();
+  EXPECT_EQ(2, stats.predictions);
+  EXPECT_EQ(1, stats.hits);
+}
+
+TEST_F(CoAccessPredictorTest, readsOfOtherProcessesAreNotCoAccesses) {
+  auto predictor = makePredictor("/mnt/repo");
+  for (size_t run = 0; run < 3; ++run) {
+    predictor->recordAccess(kPid, blobId(0));
+    predictor->recordAccess(kPid + 1, blobId(1));
+    predictor->recordAccess(kPid, blobId(500 + run));
+  }
+  EXPECT_TRUE(predictor->recordAccess(kPid, blobId(0)).toPrefetch.empty());
+}
+
+TEST_F(CoAccessPredictorTest, occasionalReadsDoNotDisplaceFrequentSuccessors) {
+  auto predictor = makePredictor("/mnt/repo");
+  for (size_t run = 0; run < 3; ++run) {
+    readSequence(*predictor, run);
+  }
+  // Each of these is read once after blob 0, more times than it has room
+  // for successors.
+  for (size_t i = 0; i < 2 * CoAccessPredictor::kMaxSuccessors; ++i) {
+    predictor->recordAccess(kPid, blobId(0));
+    predictor->recordAccess(kPid, blobId(100 + i));
+    for (size_t j = 0; j < CoAccessPredictor::kWindowSize; ++j) {
+      predictor->recordAccess(kPid, blobId(200 + i * 10 + j));
+    }
+  }
+  // Read the predictions made in the loop, so that they can be made again.
+  predictor->recordAccess(kPid + 1, blobId(1));
+  predictor->recordAccess(kPid + 1, blobId(2));
+  EXPECT_EQ(
+      (std::vector<Hash>{blobId(1), blobId(2)}),
+      predictor->recordAccess(kPid, blobId(0)).toPrefetch);
+}
+
+TEST_F(CoAccessPredictorTest, sketchIsSavedAndLoaded) {
+  {
+    auto predictor = makePredictor("/mnt/repo");
+    for (size_t run = 0; run < 2; ++run) {
+      readSequence(*predictor, run);
+    }
+    // Pad the reads out to the next save, without crowding out blob 0.
+    for (size_t i = 0; i < CoAccessPredictor::kSaveInterval; ++i) {
+      predictor->recordAccess(kPid + 1, blobId(10000 + i % 2));
+    }
+  }
+
+  // A new instance, as after a restart, reads the saved sketch.
+  auto predictor = makePredictor("/mnt/repo");
+  EXPECT_EQ(
+      (std::vector<Hash>{blobId(1), blobId(2)}),
+      predictor->recordAccess(kPid, blobId(0)).toPrefetch);
+
+  // Other mounts have their own.
+  EXPECT_TRUE(makePredictor("/mnt/other")
+                  ->recordAccess(kPid, blobId(0))
+                  .toPrefetch.empty());
+}
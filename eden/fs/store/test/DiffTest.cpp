@@ -37,6 +37,10 @@ using std::make_shared;
 using ::testing::Pair;
 using ::testing::UnorderedElementsAre;
 
+namespace {
+constexpr size_t kTreeCacheMaximumSize = 1000; // bytes
+} // namespace
+
 namespace facebook {
 namespace eden {
 inline void PrintTo(ScmFileStatus status, ::std::ostream* os) {
@@ -67,6 +71,7 @@ class DiffTest : public ::testing::Test {
     store_ = ObjectStore::create(
         localStore_,
         backingStore_,
+        TreeCache::create(kTreeCacheMaximumSize, 0),
         std::make_shared<EdenStats>(),
         &folly::QueuedImmediateExecutor::instance(),
         std::make_shared<ProcessNameCache>(),
@@ -171,6 +176,29 @@ TEST_F(DiffTest, basicDiff) {
           Pair("a/b/1.txt", ScmFileStatus::REMOVED)));
 }
 
+TEST_F(DiffTest, unchangedFilesAreNotLoaded) {
+  FakeTreeBuilder builder;
+  builder.setFile("src/main.c", "hello world");
+  builder.setFile("src/lib.c", "helper code");
+  builder.finalize(backingStore_, /* setReady */ true);
+  backingStore_->putCommit("1", builder)->setReady();
+
+  auto builder2 = builder.clone();
+  builder2.replaceFile("src/main.c", "hello world v2");
+  builder2.finalize(backingStore_, /* setReady */ true);
+  backingStore_->putCommit("2", builder2)->setReady();
+
+  auto result = diffCommits("1", "2").get(100ms);
+  EXPECT_THAT(
+      *result->entries_ref(),
+      UnorderedElementsAre(Pair("src/main.c", ScmFileStatus::MODIFIED)));
+
+  // The unchanged file has the same blob hash in both commits, so its
+  // contents do not need to be compared.
+  auto libHash = builder.getStoredBlob("src/lib.c"_relpath)->get().getHash();
+  EXPECT_EQ(0, backingStore_->getAccessCount(libHash));
+}
+
 TEST_F(DiffTest, directoryOrdering) {
   FakeTreeBuilder builder;
 
@@ -1224,3 +1252,58 @@ TEST_F(DiffTest, hiddenFolder) {
       *result.entries_ref(),
       UnorderedElementsAre(std::make_pair("a/c.txt", ScmFileStatus::ADDED)));
 }
+
+TEST_F(DiffTest, pendingFetchesAreBounded) {
+  FakeTreeBuilder builder;
+  builder.setFile("a/1.txt", "one\n");
+  builder.setFile("b/2.txt", "two\n");
+  builder.setFile("c/3.txt", "three\n");
+  builder.finalize(backingStore_, /* setReady */ false);
+  builder.getRoot()->setReady();
+
+  FakeTreeBuilder builder2;
+  builder2.setFile("d.txt", "four\n");
+  builder2.finalize(backingStore_, /* setReady */ true);
+
+  ScmStatusDiffCallback callback;
+  DiffContext diffContext{
+      &callback,
+      /*listIgnored=*/true,
+      store_.get(),
+      std::make_unique<TopLevelIgnores>(StringPiece{}, StringPiece{}),
+      [](ObjectFetchContext&, RelativePathPiece) {
+        return folly::makeFuture(std::string{});
+      },
+      /*request=*/nullptr,
+      /*maxPendingFetches=*/1};
+  auto future = diffTrees(
+      &diffContext,
+      RelativePathPiece{},
+      builder.getRoot()->get().getHash(),
+      builder2.getRoot()->get().getHash(),
+      diffContext.getToplevelIgnore(),
+      false);
+
+  auto treeA = builder.getStoredTree("a"_relpath);
+  auto treeB = builder.getStoredTree("b"_relpath);
+  auto treeC = builder.getStoredTree("c"_relpath);
+  EXPECT_EQ(1, backingStore_->getAccessCount(treeA->get().getHash()));
+  EXPECT_EQ(0, backingStore_->getAccessCount(treeB->get().getHash()));
+  EXPECT_EQ(0, backingStore_->getAccessCount(treeC->get().getHash()));
+
+  // The next fetch only starts once the pending one completes.
+  treeA->setReady();
+  EXPECT_EQ(1, backingStore_->getAccessCount(treeB->get().getHash()));
+  EXPECT_EQ(0, backingStore_->getAccessCount(treeC->get().getHash()));
+
+  treeB->setReady();
+  treeC->setReady();
+  std::move(future).get(100ms);
+  EXPECT_THAT(
+      *callback.extractStatus().entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("a/1.txt", ScmFileStatus::REMOVED),
+          std::make_pair("b/2.txt", ScmFileStatus::REMOVED),
+          std::make_pair("c/3.txt", ScmFileStatus::REMOVED),
+          std::make_pair("d.txt", ScmFileStatus::ADDED)));
+}
@@ -6,6 +6,7 @@
  */
 
 #include "eden/fs/store/test/LocalStoreTest.h"
+#include "eden/fs/store/BlobChunks.h"
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/SqliteLocalStore.h"
 
@@ -48,6 +49,109 @@ TEST_P(LocalStoreTest, testReadAndWriteBlob) {
   EXPECT_EQ(contents.size(), retreivedMetadata.value().size);
 }
 
+TEST_P(LocalStoreTest, dedupedBlobsShareContents) {
+  store_->dedupeBlobContents = true;
+  Hash hash1{"1111111111111111111111111111111111111111"};
+  Hash hash2{"2222222222222222222222222222222222222222"};
+
+  StringPiece contents("shared contents");
+  auto sha1 = Hash::sha1(contents);
+  auto blob1 = Blob{hash1, folly::IOBuf{folly::IOBuf::COPY_BUFFER, contents}};
+  auto blob2 = Blob{hash2, folly::IOBuf{folly::IOBuf::COPY_BUFFER, contents}};
+  store_->putBlob(hash1, &blob1);
+  store_->putBlob(hash2, &blob2);
+
+  // The contents are stored once, under their SHA-1.
+  EXPECT_TRUE(store_->hasKey(KeySpace::BlobFamily, sha1));
+  EXPECT_FALSE(store_->hasKey(KeySpace::BlobFamily, hash1));
+  EXPECT_FALSE(store_->hasKey(KeySpace::BlobFamily, hash2));
+
+  for (const auto& hash : {hash1, hash2}) {
+    auto outBlob = store_->getBlob(hash).get(10s);
+    ASSERT_NE(nullptr, outBlob);
+    EXPECT_EQ(hash, outBlob->getHash());
+    EXPECT_EQ(
+        contents,
+        outBlob->getContents().clone()->moveToFbString().toStdString());
+  }
+}
+
+TEST_P(LocalStoreTest, dedupingStillReadsBlobsStoredUnderTheirId) {
+  Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
+  StringPiece contents("stored before deduplication");
+  auto inBlob = Blob{hash, folly::IOBuf{folly::IOBuf::COPY_BUFFER, contents}};
+  store_->putBlob(hash, &inBlob);
+
+  store_->dedupeBlobContents = true;
+  auto outBlob = store_->getBlob(hash).get(10s);
+  ASSERT_NE(nullptr, outBlob);
+  EXPECT_EQ(
+      contents, outBlob->getContents().clone()->moveToFbString().toStdString());
+}
+
+TEST_P(LocalStoreTest, compressedBlobsRoundTrip) {
+  store_->compressBlobs = true;
+  Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
+  std::string contents(8192, 'x');
+  auto sha1 = Hash::sha1(StringPiece{contents});
+  auto inBlob = Blob{hash, folly::IOBuf{folly::IOBuf::COPY_BUFFER, contents}};
+  store_->putBlob(hash, &inBlob);
+
+  // Blobs written compressed are still readable once compression is off.
+  store_->compressBlobs = false;
+  auto outBlob = store_->getBlob(hash).get(10s);
+  ASSERT_NE(nullptr, outBlob);
+  EXPECT_EQ(hash, outBlob->getHash());
+  EXPECT_EQ(
+      contents, outBlob->getContents().clone()->moveToFbString().toStdString());
+
+  auto metadata = store_->getBlobMetadata(hash).get(10s);
+  ASSERT_TRUE(metadata.has_value());
+  EXPECT_EQ(sha1, metadata.value().sha1);
+  EXPECT_EQ(contents.size(), metadata.value().size);
+}
+
+TEST_P(LocalStoreTest, chunkedBlobsRoundTrip) {
+  store_->chunkLargeBlobs = true;
+  Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
+  std::string contents(kMinChunkedBlobSize + kBlobChunkSize / 2, 'x');
+  contents[kBlobChunkSize] = 'y';
+  auto inBlob = Blob{hash, folly::IOBuf{folly::IOBuf::COPY_BUFFER, contents}};
+  store_->putBlob(hash, &inBlob);
+
+  // Blobs written in chunks are still readable whole once chunking is off.
+  store_->chunkLargeBlobs = false;
+  auto outBlob = store_->getBlob(hash).get(10s);
+  ASSERT_NE(nullptr, outBlob);
+  EXPECT_EQ(hash, outBlob->getHash());
+  EXPECT_EQ(
+      contents, outBlob->getContents().clone()->moveToFbString().toStdString());
+
+  auto chunk = store_->getBlobChunk(hash, 1).get(10s);
+  ASSERT_NE(nullptr, chunk);
+  EXPECT_EQ(blobChunkId(hash, 1), chunk->getHash());
+  EXPECT_EQ(kBlobChunkSize, chunk->getSize());
+  EXPECT_EQ('y', chunk->getContents().data()[0]);
+
+  auto lastIndex = kMinChunkedBlobSize / kBlobChunkSize;
+  auto lastChunk = store_->getBlobChunk(hash, lastIndex).get(10s);
+  ASSERT_NE(nullptr, lastChunk);
+  EXPECT_EQ(kBlobChunkSize / 2, lastChunk->getSize());
+  EXPECT_EQ(nullptr, store_->getBlobChunk(hash, lastIndex + 1).get(10s));
+}
+
+TEST_P(LocalStoreTest, smallBlobsAreNotChunked) {
+  store_->chunkLargeBlobs = true;
+  Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
+  auto inBlob = Blob{hash, "small"_sp};
+  store_->putBlob(hash, &inBlob);
+
+  EXPECT_EQ(nullptr, store_->getBlobChunk(hash, 0).get(10s));
+  auto outBlob = store_->getBlob(hash).get(10s);
+  ASSERT_NE(nullptr, outBlob);
+  EXPECT_EQ("small", outBlob->getContents().clone()->moveToFbString());
+}
+
 TEST_P(LocalStoreTest, testReadNonexistent) {
   using namespace std::chrono_literals;
 
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/MappedBlobCache.h"
+
+#include <gtest/gtest.h>
+
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/testharness/TempFile.h"
+
+using namespace facebook::eden;
+
+namespace {
+
+std::shared_ptr<const Blob> makeBlob(char c, size_t size) {
+  std::string contents(size, c);
+  return std::make_shared<Blob>(
+      Hash::sha1(folly::StringPiece{contents}), folly::StringPiece{contents});
+}
+
+std::string blobContents(const Blob& blob) {
+  return blob.getContents().clone()->moveToFbString().toStdString();
+}
+
+class MappedBlobCacheTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<MappedBlobCache> makeCache(uint64_t maximumSize = 1000) {
+    return std::make_unique<MappedBlobCache>(
+        AbsolutePath{tempDir.path().string()} + "blobs"_pc, 100, maximumSize);
+  }
+
+  folly::test::TemporaryDirectory tempDir{makeTempDir()};
+};
+
+} // namespace
+
+TEST_F(MappedBlobCacheTest, mapsLargeBlobs) {
+  auto cache = makeCache();
+  auto small = makeBlob('s', 99);
+  EXPECT_EQ(small, cache->insert(small));
+  EXPECT_EQ(nullptr, cache->get(small->getHash()));
+
+  auto large = makeBlob('l', 100);
+  auto mapped = cache->insert(large);
+  EXPECT_TRUE(mapped->isMapped());
+  EXPECT_EQ(0, mapped->getHeapSize());
+  EXPECT_EQ(large->getHash(), mapped->getHash());
+  EXPECT_EQ(blobContents(*large), blobContents(*mapped));
+  EXPECT_EQ(100, cache->getTotalSize());
+
+  auto again = cache->get(large->getHash());
+  ASSERT_TRUE(again);
+  EXPECT_TRUE(again->isMapped());
+  EXPECT_EQ(blobContents(*large), blobContents(*again));
+}
+
+TEST_F(MappedBlobCacheTest, deletesLeastRecentlyUsedFilesToFit) {
+  auto cache = makeCache(300);
+  auto a = makeBlob('a', 100);
+  auto b = makeBlob('b', 100);
+  auto c = makeBlob('c', 100);
+  cache->insert(a);
+  cache->insert(b);
+  cache->insert(c);
+  auto mappedA = cache->get(a->getHash());
+
+  cache->insert(makeBlob('d', 150));
+  EXPECT_EQ(250, cache->getTotalSize());
+  EXPECT_TRUE(cache->get(a->getHash()));
+  EXPECT_FALSE(cache->get(b->getHash()));
+  EXPECT_FALSE(cache->get(c->getHash()));
+
+  // Blobs too large for the cache are not written at all.
+  auto huge = makeBlob('h', 301);
+  EXPECT_EQ(huge, cache->insert(huge));
+
+  // Deleting a file leaves the blobs mapped from it readable.
+  cache->insert(makeBlob('e', 300));
+  EXPECT_FALSE(cache->get(a->getHash()));
+  EXPECT_EQ(blobContents(*a), blobContents(*mappedA));
+}
+
+TEST_F(MappedBlobCacheTest, keepsFilesAcrossRestarts) {
+  auto blob = makeBlob('r', 200);
+  makeCache()->insert(blob);
+
+  auto cache = makeCache();
+  EXPECT_EQ(200, cache->getTotalSize());
+  auto mapped = cache->get(blob->getHash());
+  ASSERT_TRUE(mapped);
+  EXPECT_EQ(blobContents(*blob), blobContents(*mapped));
+}
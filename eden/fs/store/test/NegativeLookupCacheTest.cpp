@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/NegativeLookupCache.h"
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+
+namespace {
+const auto hash1 = Hash{"0000000000000000000000000000000000000001"_sp};
+const auto hash2 = Hash{"0000000000000000000000000000000000000002"_sp};
+} // namespace
+
+TEST(NegativeLookupCache, remembers_misses_until_erased) {
+  NegativeLookupCache cache{1024};
+  EXPECT_FALSE(cache.contains(hash1));
+
+  cache.insert(hash1);
+  EXPECT_TRUE(cache.contains(hash1));
+  EXPECT_FALSE(cache.contains(hash2));
+
+  cache.erase(hash1);
+  EXPECT_FALSE(cache.contains(hash1));
+}
+
+TEST(NegativeLookupCache, new_misses_replace_old_ones_in_a_full_cache) {
+  NegativeLookupCache cache{1};
+  cache.insert(hash1);
+  cache.insert(hash2);
+  EXPECT_FALSE(cache.contains(hash1));
+  EXPECT_TRUE(cache.contains(hash2));
+
+  // Erasing an ID that no longer holds the slot leaves the slot alone.
+  cache.erase(hash1);
+  EXPECT_TRUE(cache.contains(hash2));
+}
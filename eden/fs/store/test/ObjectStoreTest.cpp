@@ -22,15 +22,19 @@ using namespace std::chrono_literals;
 
 namespace {
 
+constexpr size_t kTreeCacheMaximumSize = 1000; // bytes
+
 struct ObjectStoreTest : ::testing::Test {
   void SetUp() override {
     localStore = std::make_shared<MemoryLocalStore>();
     backingStore = std::make_shared<FakeBackingStore>(localStore);
     stats = std::make_shared<EdenStats>();
     executor = &folly::QueuedImmediateExecutor::instance();
+    treeCache = TreeCache::create(kTreeCacheMaximumSize, 0);
     objectStore = ObjectStore::create(
         localStore,
         backingStore,
+        treeCache,
         stats,
         executor,
         std::make_shared<ProcessNameCache>(),
@@ -57,6 +61,7 @@ struct ObjectStoreTest : ::testing::Test {
   std::shared_ptr<LocalStore> localStore;
   std::shared_ptr<FakeBackingStore> backingStore;
   std::shared_ptr<EdenStats> stats;
+  std::shared_ptr<TreeCache> treeCache;
   std::shared_ptr<ObjectStore> objectStore;
   folly::QueuedImmediateExecutor* executor;
 
@@ -101,6 +106,17 @@ TEST_F(ObjectStoreTest, getTree_tracks_second_read_from_cache) {
   auto& request = context.requests[1];
   EXPECT_EQ(ObjectFetchContext::Tree, request.type);
   EXPECT_EQ(readyTreeId, request.hash);
+  EXPECT_EQ(ObjectFetchContext::FromMemoryCache, request.origin);
+}
+
+TEST_F(ObjectStoreTest, getTree_tracks_read_from_local_store_after_eviction) {
+  objectStore->getTree(readyTreeId, context).get(0ms);
+  treeCache->clear();
+  objectStore->getTree(readyTreeId, context).get(0ms);
+  ASSERT_EQ(2, context.requests.size());
+  auto& request = context.requests[1];
+  EXPECT_EQ(ObjectFetchContext::Tree, request.type);
+  EXPECT_EQ(readyTreeId, request.hash);
   EXPECT_EQ(ObjectFetchContext::FromDiskCache, request.origin);
 }
 
@@ -133,6 +149,7 @@ TEST_F(ObjectStoreTest, getBlobSizeFromLocalStore) {
   objectStore = ObjectStore::create(
       localStore,
       nullptr,
+      treeCache,
       stats,
       executor,
       std::make_shared<ProcessNameCache>(),
@@ -180,9 +197,155 @@ TEST_F(ObjectStoreTest, getBlobSha1NotFound) {
       "blob .* not found");
 }
 
+TEST_F(ObjectStoreTest, getBlobSize_uses_backing_store_metadata) {
+  // The backing store knows this blob's metadata but not its contents.
+  Hash id{"0123456789abcdef0123456789abcdef01234567"};
+  auto sha1 = Hash::sha1("contents"_sp);
+  backingStore->putBlobMetadata(id, BlobMetadata{sha1, 8});
+
+  EXPECT_EQ(8, objectStore->getBlobSize(id, context).get(0ms));
+  EXPECT_EQ(sha1, objectStore->getBlobSha1(id, context).get(0ms));
+  EXPECT_EQ(0, backingStore->getAccessCount(id));
+
+  auto stored = localStore->getBlobMetadata(id).get(0ms);
+  ASSERT_TRUE(stored.has_value());
+  EXPECT_EQ(8, stored->size);
+  EXPECT_EQ(nullptr, localStore->getBlob(id).get(0ms));
+}
+
 TEST_F(ObjectStoreTest, get_size_and_sha1_only_imports_blob_once) {
   objectStore->getBlobSize(readyBlobId, context).get(0ms);
   objectStore->getBlobSha1(readyBlobId, context).get(0ms);
 
   EXPECT_EQ(1, backingStore->getAccessCount(readyBlobId));
 }
+
+TEST_F(ObjectStoreTest, getBlobMetadataBatch_looks_up_each_blob_once) {
+  objectStore->getBlobSize(readyBlobId, context).get(0ms);
+  auto otherBlobId = putReadyBlob("otherblob");
+  Hash missingId{"0123456789abcdef0123456789abcdef01234567"};
+  context.requests.clear();
+
+  auto results =
+      objectStore
+          ->getBlobMetadataBatch({readyBlobId, otherBlobId, missingId}, context)
+          .get(0ms);
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ(9, results[0].value().size);
+  EXPECT_EQ(Hash::sha1("otherblob"_sp), results[1].value().sha1);
+  EXPECT_THROW(results[2].value(), std::domain_error);
+
+  ASSERT_EQ(2, context.requests.size());
+  EXPECT_EQ(readyBlobId, context.requests[0].hash);
+  EXPECT_EQ(ObjectFetchContext::FromMemoryCache, context.requests[0].origin);
+  EXPECT_EQ(otherBlobId, context.requests[1].hash);
+  EXPECT_EQ(ObjectFetchContext::FromBackingStore, context.requests[1].origin);
+  EXPECT_EQ(1, backingStore->getAccessCount(readyBlobId));
+  EXPECT_EQ(1, backingStore->getAccessCount(otherBlobId));
+
+  // The metadata fetched from the backing store is now in the LocalStore.
+  EXPECT_TRUE(localStore->getBlobMetadata(otherBlobId).get(0ms).has_value());
+}
+
+TEST_F(ObjectStoreTest, getBlobs_only_fetches_local_store_misses) {
+  objectStore->getBlob(readyBlobId, context).get(0ms);
+  auto otherBlobId = putReadyBlob("otherblob");
+  Hash missingId{"0123456789abcdef0123456789abcdef01234567"};
+  context.requests.clear();
+
+  auto results =
+      objectStore->getBlobs({readyBlobId, otherBlobId, missingId}, context);
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ(readyBlobId, std::move(results[0]).get(0ms)->getHash());
+  EXPECT_EQ(otherBlobId, std::move(results[1]).get(0ms)->getHash());
+  EXPECT_THROW(std::move(results[2]).get(0ms), std::domain_error);
+
+  ASSERT_EQ(2, context.requests.size());
+  EXPECT_EQ(readyBlobId, context.requests[0].hash);
+  EXPECT_EQ(ObjectFetchContext::FromDiskCache, context.requests[0].origin);
+  EXPECT_EQ(otherBlobId, context.requests[1].hash);
+  EXPECT_EQ(ObjectFetchContext::FromBackingStore, context.requests[1].origin);
+  EXPECT_EQ(1, backingStore->getAccessCount(readyBlobId));
+  EXPECT_EQ(1, backingStore->getAccessCount(otherBlobId));
+  EXPECT_EQ(1, backingStore->getAccessCount(missingId));
+}
+
+TEST_F(ObjectStoreTest, getTrees_checks_memory_and_local_store_first) {
+  objectStore->getTree(readyTreeId, context).get(0ms);
+  StoredTree* localTree = backingStore->putTree(
+      {{"file", backingStore->putBlob("contents"), 0644}});
+  localTree->setReady();
+  auto localTreeId = localTree->get().getHash();
+  objectStore->getTree(localTreeId, context).get(0ms);
+  treeCache->clear();
+  objectStore->getTree(readyTreeId, context).get(0ms);
+  StoredTree* otherTree = backingStore->putTree(
+      {{"other", backingStore->putBlob("more contents"), 0644}});
+  otherTree->setReady();
+  auto otherTreeId = otherTree->get().getHash();
+  context.requests.clear();
+
+  auto results =
+      objectStore->getTrees({readyTreeId, localTreeId, otherTreeId}, context);
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ(readyTreeId, std::move(results[0]).get(0ms)->getHash());
+  EXPECT_EQ(localTreeId, std::move(results[1]).get(0ms)->getHash());
+  EXPECT_EQ(otherTreeId, std::move(results[2]).get(0ms)->getHash());
+
+  ASSERT_EQ(3, context.requests.size());
+  EXPECT_EQ(ObjectFetchContext::FromMemoryCache, context.requests[0].origin);
+  EXPECT_EQ(ObjectFetchContext::FromDiskCache, context.requests[1].origin);
+  EXPECT_EQ(ObjectFetchContext::FromBackingStore, context.requests[2].origin);
+  EXPECT_EQ(1, backingStore->getAccessCount(readyTreeId));
+  EXPECT_EQ(1, backingStore->getAccessCount(localTreeId));
+  EXPECT_EQ(1, backingStore->getAccessCount(otherTreeId));
+}
+
+TEST_F(ObjectStoreTest, getTreeForCommit_shares_concurrent_imports) {
+  Hash commitId{"1111111111111111111111111111111111111111"};
+  auto* storedCommit = backingStore->putCommit(commitId, readyTreeId);
+
+  auto first = objectStore->getTreeForCommit(commitId, context);
+  auto second = objectStore->getTreeForCommit(commitId, context);
+  EXPECT_EQ(1, backingStore->getAccessCount(commitId));
+  EXPECT_FALSE(first.isReady());
+  EXPECT_FALSE(second.isReady());
+
+  storedCommit->setReady();
+  EXPECT_EQ(readyTreeId, std::move(first).get(0ms)->getHash());
+  EXPECT_EQ(readyTreeId, std::move(second).get(0ms)->getHash());
+
+  // The resolved commit is remembered.
+  objectStore->getTreeForCommit(commitId, context).get(0ms);
+  EXPECT_EQ(1, backingStore->getAccessCount(commitId));
+}
+
+TEST_F(ObjectStoreTest, getTreeForCommit_retries_failed_imports) {
+  Hash missingId{"2222222222222222222222222222222222222222"};
+  EXPECT_THROW(
+      objectStore->getTreeForCommit(missingId, context).get(0ms),
+      std::domain_error);
+  EXPECT_THROW(
+      objectStore->getTreeForCommit(missingId, context).get(0ms),
+      std::domain_error);
+  EXPECT_EQ(2, backingStore->getAccessCount(missingId));
+}
+
+TEST_F(ObjectStoreTest, getBlob_shares_concurrent_loads) {
+  auto* storedBlob = backingStore->putBlob("pendingblob"_sp);
+  auto id = storedBlob->get().getHash();
+
+  auto first = objectStore->getBlob(id, context);
+  auto second = objectStore->getBlob(id, context);
+  EXPECT_EQ(1, backingStore->getAccessCount(id));
+  EXPECT_FALSE(first.isReady());
+  EXPECT_FALSE(second.isReady());
+
+  storedBlob->setReady();
+  EXPECT_EQ(id, std::move(first).get(0ms)->getHash());
+  EXPECT_EQ(id, std::move(second).get(0ms)->getHash());
+
+  // Once the load completes, the next one finds the blob in the local store.
+  objectStore->getBlob(id, context).get(0ms);
+  EXPECT_EQ(1, backingStore->getAccessCount(id));
+}
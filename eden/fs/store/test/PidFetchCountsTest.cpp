@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/PidFetchCounts.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace facebook::eden;
+
+TEST(PidFetchCounts, countsFetchesFromAllThreads) {
+  PidFetchCounts counts;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&counts] {
+      for (int i = 0; i < 100; ++i) {
+        counts.recordProcessFetch(1, 1000);
+      }
+      counts.recordProcessFetch(2, 1000);
+    });
+  }
+  counts.recordProcessFetch(2, 1000);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto all = counts.getAllCounts();
+  EXPECT_EQ(400, all[1]);
+  EXPECT_EQ(5, all[2]);
+  EXPECT_EQ(400, counts.getCountByPid(1));
+  EXPECT_EQ(0, counts.getCountByPid(3));
+}
+
+TEST(PidFetchCounts, reportsCrossingTheThresholdOnce) {
+  PidFetchCounts counts;
+  auto threshold = PidFetchCounts::kFlushInterval * 2 + 1;
+  size_t crossings = 0;
+  uint64_t crossedAt = 0;
+  for (uint64_t i = 1; i <= threshold * 3; ++i) {
+    if (counts.recordProcessFetch(1, threshold)) {
+      ++crossings;
+      crossedAt = i;
+    }
+  }
+  EXPECT_EQ(1, crossings);
+  EXPECT_GT(crossedAt, threshold);
+  EXPECT_LE(crossedAt, threshold + PidFetchCounts::kFlushInterval);
+}
+
+TEST(PidFetchCounts, clearForgetsPendingCounts) {
+  PidFetchCounts counts;
+  counts.recordProcessFetch(1, 1000);
+  counts.clear();
+  EXPECT_EQ(0, counts.getCountByPid(1));
+  EXPECT_TRUE(counts.getAllCounts().empty());
+}
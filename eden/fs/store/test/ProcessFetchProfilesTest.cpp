@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/ProcessFetchProfiles.h"
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/utils/ProcessNameCache.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+using ObjectKind = ProcessFetchProfiles::ObjectKind;
+
+namespace {
+
+Hash objectId(size_t i) {
+  auto data = folly::to<std::string>("object ", i);
+  return Hash::sha1(folly::StringPiece{data});
+}
+
+class ProcessFetchProfilesTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Wait for the name of this process to be resolved.
+    processNameCache->add(getpid());
+    processNameCache->getAllProcessNames();
+  }
+
+  std::unique_ptr<ProcessFetchProfiles> makeProfiles(std::string scope) {
+    return std::make_unique<ProcessFetchProfiles>(
+        localStore, processNameCache, std::move(scope), 10000);
+  }
+
+  void recordProfile(ProcessFetchProfiles& profiles) {
+    for (size_t i = 0; i < ProcessFetchProfiles::kMinProfileSize; ++i) {
+      auto kind = i % 2 ? ObjectKind::Blob : ObjectKind::Tree;
+      EXPECT_TRUE(profiles.recordFetch(getpid(), kind, objectId(i)).empty());
+    }
+  }
+
+  std::shared_ptr<LocalStore> localStore{
+      std::make_shared<MemoryLocalStore>()};
+  std::shared_ptr<ProcessNameCache> processNameCache{
+      std::make_shared<ProcessNameCache>()};
+};
+
+} // namespace
+
+TEST(ProcessFetchProfiles, serializeRoundTrip) {
+  std::vector<ProcessFetchProfiles::Entry> entries{
+      {ObjectKind::Tree, objectId(1)},
+      {ObjectKind::Blob, objectId(2)},
+      {ObjectKind::BlobMetadata, objectId(3)}};
+  auto bytes = ProcessFetchProfiles::serialize(entries);
+  EXPECT_EQ(3 * (1 + Hash::RAW_SIZE), bytes.size());
+  EXPECT_EQ(
+      entries, ProcessFetchProfiles::deserialize(folly::StringPiece{bytes}));
+}
+
+TEST(ProcessFetchProfiles, toolNameIsTheExecutable) {
+  EXPECT_EQ("buck", ProcessFetchProfiles::toolName("buck\0build\0//foo"_sp));
+  EXPECT_EQ("/usr/bin/cat", ProcessFetchProfiles::toolName("/usr/bin/cat"));
+  EXPECT_EQ("", ProcessFetchProfiles::toolName("<err:13>"));
+}
+
+TEST_F(ProcessFetchProfilesTest, profileIsPrefetchedWhenToolRunsAgain) {
+  recordProfile(*makeProfiles("/mnt/repo"));
+
+  // A new instance, as after a restart, reads the saved profile.
+  auto profiles = makeProfiles("/mnt/repo");
+  auto profile = profiles->recordFetch(getpid(), ObjectKind::Tree, objectId(0));
+  ASSERT_EQ(ProcessFetchProfiles::kMinProfileSize, profile.size());
+  // Most recently fetched first.
+  auto last = ProcessFetchProfiles::kMinProfileSize - 1;
+  EXPECT_EQ(objectId(last), profile.front().id);
+  EXPECT_EQ(ObjectKind::Blob, profile.front().kind);
+  EXPECT_EQ(objectId(0), profile.back().id);
+  EXPECT_EQ(ObjectKind::Tree, profile.back().kind);
+
+  // The profile is only returned for the first fetch by a process.
+  EXPECT_TRUE(
+      profiles->recordFetch(getpid(), ObjectKind::Tree, objectId(1)).empty());
+}
+
+TEST_F(ProcessFetchProfilesTest, profilesAreKeptPerMount) {
+  recordProfile(*makeProfiles("/mnt/repo"));
+
+  auto profiles = makeProfiles("/mnt/other");
+  EXPECT_TRUE(
+      profiles->recordFetch(getpid(), ObjectKind::Tree, objectId(0)).empty());
+}
+
+TEST_F(ProcessFetchProfilesTest, smallProfilesAreNotSaved) {
+  auto profiles = makeProfiles("/mnt/repo");
+  for (size_t i = 0; i + 1 < ProcessFetchProfiles::kMinProfileSize; ++i) {
+    profiles->recordFetch(getpid(), ObjectKind::Tree, objectId(i));
+  }
+
+  EXPECT_TRUE(makeProfiles("/mnt/repo")
+                  ->recordFetch(getpid(), ObjectKind::Tree, objectId(0))
+                  .empty());
+}
+
+TEST_F(ProcessFetchProfilesTest, mountProfileIsLoadedAfterRestart) {
+  auto first = makeProfiles("/mnt/repo");
+  EXPECT_TRUE(first->loadMountProfile().empty());
+  recordProfile(*first);
+
+  auto mountProfile = makeProfiles("/mnt/repo")->loadMountProfile();
+  ASSERT_EQ(ProcessFetchProfiles::kMinProfileSize, mountProfile.size());
+  auto last = ProcessFetchProfiles::kMinProfileSize - 1;
+  EXPECT_EQ(objectId(last), mountProfile.front().id);
+  EXPECT_EQ(objectId(0), mountProfile.back().id);
+
+  EXPECT_TRUE(makeProfiles("/mnt/other")->loadMountProfile().empty());
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/RecentKeyTracker.h"
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+using folly::ByteRange;
+using folly::StringPiece;
+
+TEST(RecentKeyTracker, remembersRecordedKeys) {
+  RecentKeyTracker tracker{/*maxKeys=*/4, /*sampleRate=*/1};
+  tracker.recordAccess(ByteRange{StringPiece{"a"}});
+  tracker.recordAccess(ByteRange{StringPiece{"b"}});
+
+  EXPECT_TRUE(tracker.wasRecentlyAccessed(ByteRange{StringPiece{"a"}}));
+  EXPECT_TRUE(tracker.wasRecentlyAccessed(ByteRange{StringPiece{"b"}}));
+  EXPECT_FALSE(tracker.wasRecentlyAccessed(ByteRange{StringPiece{"c"}}));
+  EXPECT_EQ(2, tracker.size());
+}
+
+TEST(RecentKeyTracker, forgetsLeastRecentlyRecordedKeys) {
+  RecentKeyTracker tracker{/*maxKeys=*/2, /*sampleRate=*/1};
+  tracker.recordAccess(ByteRange{StringPiece{"a"}});
+  tracker.recordAccess(ByteRange{StringPiece{"b"}});
+  // Recording "a" again makes "b" the least recently recorded key.
+  tracker.recordAccess(ByteRange{StringPiece{"a"}});
+  tracker.recordAccess(ByteRange{StringPiece{"c"}});
+
+  EXPECT_TRUE(tracker.wasRecentlyAccessed(ByteRange{StringPiece{"a"}}));
+  EXPECT_FALSE(tracker.wasRecentlyAccessed(ByteRange{StringPiece{"b"}}));
+  EXPECT_TRUE(tracker.wasRecentlyAccessed(ByteRange{StringPiece{"c"}}));
+}
+
+TEST(RecentKeyTracker, samplesAccesses) {
+  RecentKeyTracker tracker{/*maxKeys=*/10000, /*sampleRate=*/8};
+  for (int i = 0; i < 1000; ++i) {
+    auto key = folly::to<std::string>(i);
+    tracker.recordAccess(ByteRange{StringPiece{key}});
+  }
+  // Roughly 125 keys should be recorded.
+  EXPECT_GT(tracker.size(), 0);
+  EXPECT_LT(tracker.size(), 500);
+}
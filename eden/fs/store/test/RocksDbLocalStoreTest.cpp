@@ -5,9 +5,13 @@
  * GNU General Public License version 2.
  */
 
+#include <folly/Conv.h>
+
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
 #include "eden/fs/store/test/LocalStoreTest.h"
 #include "eden/fs/telemetry/NullStructuredLogger.h"
+#include "eden/fs/utils/FaultInjector.h"
 
 namespace {
 
@@ -18,10 +22,215 @@ LocalStoreImplResult makeRocksDbLocalStore(FaultInjector* faultInjector) {
   auto store = std::make_unique<RocksDbLocalStore>(
       AbsolutePathPiece{tempDir.path().string()},
       std::make_shared<NullStructuredLogger>(),
-      faultInjector);
+      faultInjector,
+      *EdenConfig::createTestEdenConfig());
   return {std::move(tempDir), std::move(store)};
 }
 
+TEST(RocksDbLocalStore, opensWithTunedColumnFamilies) {
+  auto config = EdenConfig::createTestEdenConfig();
+  config->rocksDbBlockCacheSize.setValue(
+      1024 * 1024, ConfigSource::CommandLine);
+  config->rocksDbCompactionRateLimit.setValue(
+      1024 * 1024, ConfigSource::CommandLine);
+  config->rocksDbBlobBlockSize.setValue(16 * 1024, ConfigSource::CommandLine);
+  config->rocksDbBlobCompression.setValue(
+      "not-a-compression", ConfigSource::CommandLine);
+
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  auto path = AbsolutePathPiece{tempDir.path().string()};
+  auto key = folly::ByteRange{folly::StringPiece{"0123456789abcdef0123"}};
+  auto blob = folly::ByteRange{folly::StringPiece{"blob contents"}};
+  auto proxyHash = folly::ByteRange{folly::StringPiece{"proxy hash"}};
+  {
+    RocksDbLocalStore store{
+        path,
+        std::make_shared<NullStructuredLogger>(),
+        &faultInjector,
+        *config};
+    store.put(KeySpace::BlobFamily, key, blob);
+    store.put(KeySpace::HgProxyHashFamily, key, proxyHash);
+  }
+
+  RocksDbLocalStore store{
+      path, std::make_shared<NullStructuredLogger>(), &faultInjector, *config};
+  EXPECT_EQ("blob contents", store.get(KeySpace::BlobFamily, key).piece());
+  EXPECT_EQ("proxy hash", store.get(KeySpace::HgProxyHashFamily, key).piece());
+}
+
+TEST(RocksDbLocalStore, evictColdKeysKeepsRecentlyUsedKeys) {
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  RocksDbLocalStore store{
+      AbsolutePathPiece{tempDir.path().string()},
+      std::make_shared<NullStructuredLogger>(),
+      &faultInjector,
+      *EdenConfig::createTestEdenConfig()};
+
+  auto value = std::string(1024, 'x');
+  std::vector<std::string> keys;
+  for (int i = 0; i < 100; ++i) {
+    keys.push_back(folly::to<std::string>("cold key ", i));
+  }
+  for (const auto& key : keys) {
+    store.put(
+        KeySpace::BlobFamily,
+        folly::ByteRange{folly::StringPiece{key}},
+        folly::ByteRange{folly::StringPiece{value}});
+  }
+
+  // Accesses are sampled, so use the hot key often enough that it is all
+  // but certain to be recorded.
+  auto hotKey = folly::ByteRange{folly::StringPiece{keys[0]}};
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_TRUE(store.hasKey(KeySpace::BlobFamily, hotKey));
+  }
+
+  auto bytesFreed = store.evictColdKeys(
+      KeySpace::BlobFamily,
+      std::numeric_limits<uint64_t>::max(),
+      /*maxDeletesPerSecond=*/0);
+  EXPECT_GT(bytesFreed, 0);
+  EXPECT_TRUE(store.hasKey(KeySpace::BlobFamily, hotKey));
+
+  size_t remaining = 0;
+  for (const auto& key : keys) {
+    if (store.hasKey(
+            KeySpace::BlobFamily, folly::ByteRange{folly::StringPiece{key}})) {
+      ++remaining;
+    }
+  }
+  EXPECT_LT(remaining, keys.size());
+}
+
+TEST(RocksDbLocalStore, evictColdKeysStopsOnceEnoughIsFreed) {
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  RocksDbLocalStore store{
+      AbsolutePathPiece{tempDir.path().string()},
+      std::make_shared<NullStructuredLogger>(),
+      &faultInjector,
+      *EdenConfig::createTestEdenConfig()};
+
+  auto value = std::string(1024, 'x');
+  for (int i = 0; i < 100; ++i) {
+    auto key = folly::to<std::string>("key ", i);
+    store.put(
+        KeySpace::TreeFamily,
+        folly::ByteRange{folly::StringPiece{key}},
+        folly::ByteRange{folly::StringPiece{value}});
+  }
+
+  auto bytesFreed = store.evictColdKeys(
+      KeySpace::TreeFamily, 4 * 1024, /*maxDeletesPerSecond=*/0);
+  EXPECT_GE(bytesFreed, 4 * 1024);
+  EXPECT_LT(bytesFreed, 8 * 1024);
+}
+
+TEST(RocksDbLocalStore, evictColdKeysRejectsPersistentKeySpaces) {
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  RocksDbLocalStore store{
+      AbsolutePathPiece{tempDir.path().string()},
+      std::make_shared<NullStructuredLogger>(),
+      &faultInjector,
+      *EdenConfig::createTestEdenConfig()};
+  EXPECT_THROW(
+      store.evictColdKeys(KeySpace::HgProxyHashFamily, 1, 0),
+      std::invalid_argument);
+}
+
+TEST(RocksDbLocalStore, queuedWritesAreReadableAndCommittedOnClose) {
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  auto path = AbsolutePathPiece{tempDir.path().string()};
+  auto config = EdenConfig::createTestEdenConfig();
+  auto key = folly::ByteRange{folly::StringPiece{"0123456789abcdef0123"}};
+  auto tree = folly::ByteRange{folly::StringPiece{"tree contents"}};
+  {
+    RocksDbLocalStore store{
+        path,
+        std::make_shared<NullStructuredLogger>(),
+        &faultInjector,
+        *config};
+    store.put(KeySpace::TreeFamily, key, tree);
+    auto batch = store.beginWrite();
+    batch->put(
+        KeySpace::BlobFamily,
+        key,
+        std::vector<folly::ByteRange>{
+            folly::ByteRange{folly::StringPiece{"blob "}},
+            folly::ByteRange{folly::StringPiece{"contents"}}});
+    batch->flush();
+
+    // The writes are visible whether or not they have been committed yet.
+    EXPECT_EQ("tree contents", store.get(KeySpace::TreeFamily, key).piece());
+    EXPECT_TRUE(store.hasKey(KeySpace::BlobFamily, key));
+    auto results = store.getBatch(KeySpace::BlobFamily, {key}).get();
+    ASSERT_EQ(1, results.size());
+    EXPECT_EQ("blob contents", results[0].piece());
+  }
+
+  RocksDbLocalStore store{
+      path, std::make_shared<NullStructuredLogger>(), &faultInjector, *config};
+  EXPECT_EQ("tree contents", store.get(KeySpace::TreeFamily, key).piece());
+  EXPECT_EQ("blob contents", store.get(KeySpace::BlobFamily, key).piece());
+}
+
+TEST(RocksDbLocalStore, clearKeySpaceDropsQueuedWrites) {
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  RocksDbLocalStore store{
+      AbsolutePathPiece{tempDir.path().string()},
+      std::make_shared<NullStructuredLogger>(),
+      &faultInjector,
+      *EdenConfig::createTestEdenConfig()};
+  auto key = folly::ByteRange{folly::StringPiece{"0123456789abcdef0123"}};
+  store.put(
+      KeySpace::BlobFamily, key, folly::ByteRange{folly::StringPiece{"blob"}});
+  store.clearKeySpace(KeySpace::BlobFamily);
+  EXPECT_FALSE(store.hasKey(KeySpace::BlobFamily, key));
+}
+
+TEST(RocksDbLocalStore, forEachEntryVisitsEntriesInKeyOrder) {
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  auto path = AbsolutePathPiece{tempDir.path().string()};
+  auto config = EdenConfig::createTestEdenConfig();
+  {
+    RocksDbLocalStore store{
+        path,
+        std::make_shared<NullStructuredLogger>(),
+        &faultInjector,
+        *config};
+    for (auto key : {"b", "c", "a"}) {
+      store.put(
+          KeySpace::TreeFamily,
+          folly::ByteRange{folly::StringPiece{key}},
+          folly::ByteRange{folly::StringPiece{"tree"}});
+    }
+  }
+
+  // Reopen the store so that no writes are still queued.
+  RocksDbLocalStore store{
+      path, std::make_shared<NullStructuredLogger>(), &faultInjector, *config};
+  std::vector<std::string> keys;
+  store.forEachEntry(KeySpace::TreeFamily, [&](auto key, auto value) {
+    EXPECT_EQ("tree", folly::StringPiece{value});
+    keys.emplace_back(folly::StringPiece{key});
+    return true;
+  });
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}), keys);
+
+  keys.clear();
+  store.forEachEntry(KeySpace::TreeFamily, [&](auto key, auto /*value*/) {
+    keys.emplace_back(folly::StringPiece{key});
+    return false;
+  });
+  EXPECT_EQ(std::vector<std::string>{"a"}, keys);
+}
+
 INSTANTIATE_TEST_CASE_P(
     RocksDB,
     LocalStoreTest,
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/ScmStatusDiffCallback.h"
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace facebook::eden;
+
+TEST(ScmStatusDiffCallback, mergesResultsReportedFromManyThreads) {
+  constexpr size_t kThreads = 8;
+  constexpr size_t kFilesPerThread = 100;
+
+  ScmStatusDiffCallback callback;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&callback, i] {
+      for (size_t j = 0; j < kFilesPerThread; ++j) {
+        auto path = folly::to<std::string>("dir", i, "/file", j);
+        if (j % 2) {
+          callback.addedFile(RelativePathPiece{path});
+        } else {
+          callback.ignoredFile(RelativePathPiece{path});
+        }
+      }
+    });
+  }
+  // Results from threads that have exited and from ones still running are
+  // both merged.
+  for (size_t i = 0; i < kThreads / 2; ++i) {
+    threads[i].join();
+  }
+  callback.modifiedFile(RelativePathPiece{"main.c"});
+  for (size_t i = kThreads / 2; i < kThreads; ++i) {
+    threads[i].join();
+  }
+
+  auto status = callback.extractStatus();
+  const auto& entries = *status.entries_ref();
+  EXPECT_EQ(kThreads * kFilesPerThread + 1, entries.size());
+  EXPECT_EQ(ScmFileStatus::MODIFIED, entries.at("main.c"));
+  EXPECT_EQ(ScmFileStatus::IGNORED, entries.at("dir3/file0"));
+  EXPECT_EQ(ScmFileStatus::ADDED, entries.at("dir7/file99"));
+  EXPECT_TRUE(status.errors_ref()->empty());
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/SerializedTree.h"
+
+#include <folly/String.h>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/test/LocalStoreTest.h"
+
+using namespace facebook::eden;
+using namespace std::literals::chrono_literals;
+using folly::ByteRange;
+using folly::StringPiece;
+
+namespace {
+Tree makeTestTree() {
+  auto contentSha1 = Hash::sha1(ByteRange{StringPiece{"contents"}});
+  return Tree{
+      {TreeEntry{
+           Hash{"3a8f8eb91101860fd8484154885838bf322964d0"},
+           "README",
+           TreeEntryType::REGULAR_FILE,
+           8,
+           contentSha1},
+       TreeEntry{
+           Hash{"8e073e366ed82de6465d1209d3f07da7eebabb93"},
+           "run.sh",
+           TreeEntryType::EXECUTABLE_FILE},
+       TreeEntry{
+           Hash{"c5f15617ed29cd35964dc197a7960aeaedf2c2d5"},
+           "src",
+           TreeEntryType::TREE}},
+      Hash{"9ed5bbccd1b9b0077561d14c0130dc086ab27e04"}};
+}
+
+void expectSameEntry(const TreeEntry& expected, const TreeEntry& actual) {
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(expected.getSize(), actual.getSize());
+  EXPECT_EQ(expected.getContentSha1(), actual.getContentSha1());
+}
+} // namespace
+
+TEST(SerializedTree, roundTripKeepsSizeAndSha1) {
+  auto tree = makeTestTree();
+  auto buf = SerializedTree::serialize(tree);
+  auto bytes = buf.coalesce();
+  ASSERT_TRUE(SerializedTree::isSerializedTree(bytes));
+
+  auto outTree = SerializedTree{bytes}.toTree(tree.getHash());
+  EXPECT_EQ(tree.getHash(), outTree->getHash());
+  ASSERT_EQ(tree.getTreeEntries().size(), outTree->getTreeEntries().size());
+  for (size_t i = 0; i < tree.getTreeEntries().size(); ++i) {
+    expectSameEntry(tree.getEntryAt(i), outTree->getEntryAt(i));
+  }
+}
+
+TEST(SerializedTree, findLooksUpSingleEntries) {
+  auto tree = makeTestTree();
+  auto buf = SerializedTree::serialize(tree);
+  SerializedTree serialized{buf.coalesce()};
+  EXPECT_EQ(3, serialized.size());
+
+  for (const auto& entry : tree.getTreeEntries()) {
+    auto found = serialized.find(entry.getName());
+    ASSERT_TRUE(found.has_value()) << entry.getName();
+    expectSameEntry(entry, *found);
+  }
+  EXPECT_FALSE(serialized.find(PathComponentPiece{"AAA"}).has_value());
+  EXPECT_FALSE(serialized.find(PathComponentPiece{"run"}).has_value());
+  EXPECT_FALSE(serialized.find(PathComponentPiece{"zzz"}).has_value());
+}
+
+TEST(SerializedTree, emptyTree) {
+  auto buf = SerializedTree::serialize(Tree{std::vector<TreeEntry>{}});
+  SerializedTree serialized{buf.coalesce()};
+  EXPECT_EQ(0, serialized.size());
+  EXPECT_FALSE(serialized.find(PathComponentPiece{"a"}).has_value());
+}
+
+TEST(SerializedTree, gitTreeObjectsAreNotSerializedTrees) {
+  EXPECT_FALSE(SerializedTree::isSerializedTree(ByteRange{StringPiece{}}));
+  EXPECT_FALSE(SerializedTree::isSerializedTree(
+      ByteRange{StringPiece{"tree 0\0", 7}}));
+}
+
+TEST(SerializedTree, rejectsMalformedData) {
+  auto buf = SerializedTree::serialize(makeTestTree());
+  auto bytes = buf.coalesce();
+
+  EXPECT_THROW(SerializedTree{bytes.subpiece(0, 3)}, std::invalid_argument);
+  // Cutting off the name table leaves the name offsets out of bounds.
+  EXPECT_THROW(
+      SerializedTree{bytes.subpiece(0, bytes.size() - 1)},
+      std::invalid_argument);
+  // Cutting into the records leaves too little room for all the entries.
+  EXPECT_THROW(SerializedTree{bytes.subpiece(0, 20)}, std::invalid_argument);
+
+  std::string badVersion{StringPiece{bytes}};
+  badVersion[0] = 2;
+  EXPECT_THROW(
+      SerializedTree{ByteRange{StringPiece{badVersion}}},
+      std::invalid_argument);
+}
+
+TEST_P(LocalStoreTest, putTreeStoresNativeFormatAndGetTreeReadsIt) {
+  auto tree = makeTestTree();
+  auto hash = store_->putTree(&tree);
+  EXPECT_EQ(tree.getHash(), hash);
+
+  auto result = store_->get(KeySpace::TreeFamily, hash);
+  ASSERT_TRUE(result.isValid());
+  EXPECT_TRUE(SerializedTree::isSerializedTree(result.bytes()));
+
+  auto outTree = store_->getTree(hash).get(10s);
+  ASSERT_TRUE(outTree);
+  ASSERT_EQ(tree.getTreeEntries().size(), outTree->getTreeEntries().size());
+  for (size_t i = 0; i < tree.getTreeEntries().size(); ++i) {
+    expectSameEntry(tree.getEntryAt(i), outTree->getEntryAt(i));
+  }
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/Sha1Hasher.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "eden/fs/model/Blob.h"
+
+using namespace facebook::eden;
+
+namespace {
+std::shared_ptr<const Blob> makeBlob(size_t size, char fill) {
+  std::string contents(size, fill);
+  return std::make_shared<const Blob>(
+      Hash::sha1(folly::StringPiece{contents}), folly::StringPiece{contents});
+}
+} // namespace
+
+TEST(Sha1Hasher, small_blobs_are_hashed_inline) {
+  Sha1Hasher hasher{1};
+  auto blob = makeBlob(Sha1Hasher::kMinPooledBytes - 1, 'a');
+  auto future = hasher.sha1(blob);
+  ASSERT_TRUE(future.isReady());
+  EXPECT_EQ(blob->getHash(), std::move(future).get());
+}
+
+TEST(Sha1Hasher, large_blobs_are_hashed_on_the_pool) {
+  Sha1Hasher hasher{4};
+  std::vector<std::shared_ptr<const Blob>> blobs;
+  std::vector<folly::Future<Hash>> futures;
+  for (char fill = 'a'; fill < 'i'; ++fill) {
+    blobs.push_back(makeBlob(1024 * 1024, fill));
+    futures.push_back(hasher.sha1(blobs.back()).toUnsafeFuture());
+  }
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    EXPECT_EQ(blobs[i]->getHash(), std::move(futures[i]).get());
+  }
+}
+
+TEST(Sha1Hasher, compute_runs_large_jobs_on_another_thread) {
+  Sha1Hasher hasher{1};
+  auto caller = std::this_thread::get_id();
+  std::thread::id runner;
+  auto hash = Hash::sha1(folly::StringPiece{"contents"});
+  auto result = hasher
+                    .compute(
+                        Sha1Hasher::kMinPooledBytes,
+                        [&] {
+                          runner = std::this_thread::get_id();
+                          return hash;
+                        })
+                    .get();
+  EXPECT_EQ(hash, result);
+  EXPECT_NE(caller, runner);
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/SqliteLocalStore.h"
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "eden/fs/store/StoreResult.h"
+#include "eden/fs/testharness/TempFile.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+
+namespace {
+
+class SqliteLocalStoreTest : public ::testing::Test {
+ protected:
+  AbsolutePath path(PathComponentPiece name) const {
+    return AbsolutePathPiece{tempDir_.path().string()} + name;
+  }
+
+  folly::test::TemporaryDirectory tempDir_{makeTempDir()};
+};
+
+TEST_F(SqliteLocalStoreTest, readsFallBackToTheSharedCache) {
+  auto sharedPath = path("shared"_pc);
+  SqliteLocalStore shared{sharedPath};
+  shared.put(KeySpace::BlobFamily, "shared"_sp, "from the shared cache"_sp);
+
+  SqliteLocalStore store{
+      path("local"_pc), SqliteLocalStore::kDefaultReaderCount, sharedPath};
+  store.put(KeySpace::BlobFamily, "local"_sp, "from the local store"_sp);
+
+  EXPECT_EQ(
+      "from the local store",
+      store.get(KeySpace::BlobFamily, "local"_sp).piece());
+  EXPECT_EQ(
+      "from the shared cache",
+      store.get(KeySpace::BlobFamily, "shared"_sp).piece());
+  EXPECT_TRUE(store.hasKey(KeySpace::BlobFamily, "shared"_sp));
+  EXPECT_FALSE(store.hasKey(KeySpace::BlobFamily, "missing"_sp));
+  EXPECT_FALSE(store.get(KeySpace::BlobFamily, "missing"_sp).isValid());
+
+  // The shared cache is never written to.
+  EXPECT_FALSE(shared.hasKey(KeySpace::BlobFamily, "local"_sp));
+}
+
+TEST_F(SqliteLocalStoreTest, missingSharedCacheIsIgnored) {
+  SqliteLocalStore store{path("local"_pc), 2, path("does-not-exist"_pc)};
+  store.put(KeySpace::BlobFamily, "key"_sp, "value"_sp);
+  EXPECT_EQ("value", store.get(KeySpace::BlobFamily, "key"_sp).piece());
+  EXPECT_FALSE(store.hasKey(KeySpace::BlobFamily, "missing"_sp));
+}
+
+TEST_F(SqliteLocalStoreTest, concurrentReadersSeeCommittedWrites) {
+  SqliteLocalStore store{path("local"_pc), 2};
+  for (int i = 0; i < 100; ++i) {
+    auto key = folly::to<std::string>("key", i);
+    store.put(KeySpace::BlobFamily, folly::StringPiece{key}, "value"_sp);
+  }
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&store] {
+      for (int i = 0; i < 100; ++i) {
+        auto key = folly::to<std::string>("key", i);
+        EXPECT_EQ(
+            "value",
+            store.get(KeySpace::BlobFamily, folly::StringPiece{key}).piece());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TreeCache.h"
+#include <gtest/gtest.h>
+#include "eden/fs/model/Tree.h"
+
+using namespace folly::literals;
+using namespace facebook::eden;
+
+namespace {
+
+const auto hash0 = Hash{"0000000000000000000000000000000000000000"_sp};
+const auto hash1 = Hash{"0000000000000000000000000000000000000001"_sp};
+const auto hash2 = Hash{"0000000000000000000000000000000000000002"_sp};
+const auto hash3 = Hash{"0000000000000000000000000000000000000003"_sp};
+
+std::shared_ptr<const Tree> makeTree(const Hash& hash, folly::StringPiece name) {
+  std::vector<TreeEntry> entries;
+  entries.emplace_back(hash0, name, TreeEntryType::REGULAR_FILE);
+  return std::make_shared<Tree>(std::move(entries), hash);
+}
+
+const auto tree1 = makeTree(hash1, "a");
+const auto tree2 = makeTree(hash2, "b");
+const auto tree3 = makeTree(hash3, "c");
+
+// All of the trees above have the same estimated size.
+const auto treeSize = tree1->getSizeBytes();
+} // namespace
+
+TEST(TreeCache, evicts_oldest_on_insertion) {
+  auto cache = TreeCache::create(2 * treeSize, 0);
+  cache->insert(tree1);
+  cache->insert(tree2); // tree2 is considered more recent than tree1
+  EXPECT_EQ(2 * treeSize, cache->getStats().totalSizeInBytes);
+  cache->insert(tree3); // evicts tree1
+  EXPECT_EQ(2 * treeSize, cache->getStats().totalSizeInBytes);
+  EXPECT_EQ(nullptr, cache->get(hash1).tree)
+      << "Inserting tree3 should evict oldest (tree1)";
+  EXPECT_EQ(tree2, cache->get(hash2).tree) << "But tree2 still fits";
+  cache->insert(tree1); // evicts tree3
+  EXPECT_EQ(nullptr, cache->get(hash3).tree)
+      << "Inserting tree1 again evicts tree3 because tree2 was accessed";
+  EXPECT_EQ(tree2, cache->get(hash2).tree);
+  EXPECT_EQ(2, cache->getStats().evictionCount);
+}
+
+TEST(TreeCache, preserves_minimum_number_of_entries) {
+  auto cache = TreeCache::create(1, 2);
+  cache->insert(tree1);
+  cache->insert(tree2);
+  cache->insert(tree3);
+
+  EXPECT_EQ(2, cache->getStats().treeCount);
+  EXPECT_FALSE(cache->get(hash1).tree);
+  EXPECT_TRUE(cache->get(hash2).tree);
+  EXPECT_TRUE(cache->get(hash3).tree);
+}
+
+TEST(TreeCache, tracks_hits_and_misses) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  cache->insert(tree1);
+  EXPECT_TRUE(cache->get(hash1).tree);
+  EXPECT_FALSE(cache->get(hash2).tree);
+  EXPECT_TRUE(cache->get(hash1).tree);
+
+  auto stats = cache->getStats();
+  EXPECT_EQ(2, stats.hitCount);
+  EXPECT_EQ(1, stats.missCount);
+}
+
+TEST(TreeCache, dropping_interest_handle_evicts) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  auto handle1 = cache->insert(tree1, TreeCache::Interest::WantHandle);
+  EXPECT_EQ(tree1, handle1.getTree());
+  handle1.reset();
+  EXPECT_FALSE(cache->contains(hash1));
+  EXPECT_EQ(1, cache->getStats().dropCount);
+}
+
+TEST(TreeCache, interest_handle_can_return_tree_even_if_it_was_evicted) {
+  auto cache = TreeCache::create(treeSize, 0);
+  auto handle1 = cache->insert(tree1);
+  auto handle2 = cache->insert(tree2);
+
+  EXPECT_FALSE(cache->get(hash1).tree) << "Inserting tree2 evicts tree1";
+  EXPECT_EQ(tree1, handle1.getTree())
+      << "Tree accessible even though it's been evicted";
+  EXPECT_EQ(tree2, handle2.getTree());
+}
+
+TEST(TreeCache, get_live_returns_evicted_tree_that_is_still_referenced) {
+  auto cache = TreeCache::create(treeSize, 0);
+  cache->insert(tree1);
+  cache->insert(tree2); // evicts tree1, which the test still references
+
+  EXPECT_FALSE(cache->get(hash1).tree);
+  EXPECT_EQ(tree1, cache->getLive(hash1).tree);
+  EXPECT_TRUE(cache->contains(hash1)) << "getLive re-inserts the tree";
+  EXPECT_FALSE(cache->contains(hash2));
+  EXPECT_EQ(1, cache->getStats().liveHitCount);
+
+  cache->insert(makeTree(hash3, "c")); // evicts tree1 again
+  cache->insert(tree2); // evicts the only reference to the new tree3
+  EXPECT_FALSE(cache->getLive(hash3).tree);
+  EXPECT_EQ(1, cache->getStats().liveHitCount);
+
+  cache->clear();
+  EXPECT_FALSE(cache->getLive(hash1).tree)
+      << "clear() forgets evicted trees too";
+}
+
+TEST(TreeCache, lists_cached_hashes_most_recently_used_first) {
+  auto cache = TreeCache::create(10 * treeSize, 0);
+  cache->insert(tree1);
+  cache->insert(tree2);
+  cache->insert(tree3);
+  cache->get(hash1);
+  EXPECT_EQ(
+      (std::vector<Hash>{hash1, hash3, hash2}), cache->getCachedHashes());
+}
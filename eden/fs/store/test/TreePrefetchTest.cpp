@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TreePrefetch.h"
+
+#include <folly/executors/QueuedImmediateExecutor.h>
+#include <gtest/gtest.h>
+#include <limits>
+
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/telemetry/NullStructuredLogger.h"
+#include "eden/fs/testharness/FakeBackingStore.h"
+#include "eden/fs/testharness/StoredObject.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr size_t kTreeCacheMaximumSize = 1000; // bytes
+
+struct TreePrefetchTest : ::testing::Test {
+  void SetUp() override {
+    localStore = std::make_shared<MemoryLocalStore>();
+    backingStore = std::make_shared<FakeBackingStore>(localStore);
+    objectStore = ObjectStore::create(
+        localStore,
+        backingStore,
+        TreeCache::create(kTreeCacheMaximumSize, 0),
+        std::make_shared<EdenStats>(),
+        &folly::QueuedImmediateExecutor::instance(),
+        std::make_shared<ProcessNameCache>(),
+        std::make_shared<NullStructuredLogger>(),
+        EdenConfig::createTestEdenConfig());
+
+    // root
+    // +- a
+    // |  +- a1
+    // +- b
+    a1 = putReadyTree({{"a1.txt", putReadyBlob("a1")}});
+    a = putReadyTree({{"a1", a1}, {"a.txt", putReadyBlob("a")}});
+    b = putReadyTree({{"b.txt", putReadyBlob("b")}});
+    root = putReadyTree({{"a", a}, {"b", b}});
+  }
+
+  StoredBlob* putReadyBlob(folly::StringPiece contents) {
+    auto* storedBlob = backingStore->putBlob(contents);
+    storedBlob->setReady();
+    return storedBlob;
+  }
+
+  StoredTree* putReadyTree(
+      const std::initializer_list<FakeBackingStore::TreeEntryData>& entries) {
+    auto* storedTree = backingStore->putTree(entries);
+    storedTree->setReady();
+    return storedTree;
+  }
+
+  size_t accessCount(const StoredTree* tree) const {
+    return backingStore->getAccessCount(tree->get().getHash());
+  }
+
+  std::shared_ptr<LocalStore> localStore;
+  std::shared_ptr<FakeBackingStore> backingStore;
+  std::shared_ptr<ObjectStore> objectStore;
+
+  StoredTree* a1;
+  StoredTree* a;
+  StoredTree* b;
+  StoredTree* root;
+};
+
+} // namespace
+
+TEST_F(TreePrefetchTest, walk_is_bounded_by_depth) {
+  auto loaded = prefetchTreesBreadthFirst(
+                    objectStore,
+                    {TreePrefetchRoot{root->get().getHash(), std::nullopt}},
+                    1,
+                    ObjectFetchContext::getNullContext())
+                    .get(0ms);
+
+  EXPECT_EQ(3, loaded);
+  EXPECT_EQ(1, accessCount(root));
+  EXPECT_EQ(1, accessCount(a));
+  EXPECT_EQ(1, accessCount(b));
+  EXPECT_EQ(0, accessCount(a1));
+}
+
+TEST_F(TreePrefetchTest, walk_skips_subtrees_identical_to_base) {
+  auto* b2 = putReadyTree({{"b2.txt", putReadyBlob("b2")}});
+  auto* root2 = putReadyTree({{"a", a}, {"b", b2}});
+
+  auto loaded = prefetchTreesBreadthFirst(
+                    objectStore,
+                    {TreePrefetchRoot{
+                        root2->get().getHash(), root->get().getHash()}},
+                    std::numeric_limits<size_t>::max(),
+                    ObjectFetchContext::getNullContext())
+                    .get(0ms);
+
+  // root2 and b2 were walked, and loaded alongside their base trees.
+  EXPECT_EQ(2, loaded);
+  EXPECT_EQ(1, accessCount(root2));
+  EXPECT_EQ(1, accessCount(b2));
+  EXPECT_EQ(1, accessCount(b));
+  EXPECT_EQ(0, accessCount(a));
+  EXPECT_EQ(0, accessCount(a1));
+}
+
+TEST_F(TreePrefetchTest, missing_trees_are_skipped) {
+  auto loaded = prefetchTreesBreadthFirst(
+                    objectStore,
+                    {TreePrefetchRoot{Hash{}, std::nullopt},
+                     TreePrefetchRoot{b->get().getHash(), std::nullopt}},
+                    0,
+                    ObjectFetchContext::getNullContext())
+                    .get(0ms);
+
+  EXPECT_EQ(1, loaded);
+}
+
+TEST_F(TreePrefetchTest, hydrate_loads_every_tree_and_selected_blobs) {
+  auto result = hydrateTree(
+                    objectStore,
+                    root->get().getHash(),
+                    {RelativePath{"a"}},
+                    ObjectFetchContext::getNullContext())
+                    .get(0ms);
+
+  EXPECT_EQ(4, result.treeCount);
+  // a/a.txt and a/a1/a1.txt
+  EXPECT_EQ(2, result.blobCount);
+  EXPECT_EQ(1, accessCount(a1));
+  EXPECT_EQ(1, accessCount(b));
+}
+
+TEST_F(TreePrefetchTest, hydrate_with_empty_path_selects_every_blob) {
+  auto all = hydrateTree(
+                 objectStore,
+                 root->get().getHash(),
+                 {RelativePath{}},
+                 ObjectFetchContext::getNullContext())
+                 .get(0ms);
+  EXPECT_EQ(3, all.blobCount);
+
+  auto none = hydrateTree(
+                  objectStore,
+                  root->get().getHash(),
+                  {},
+                  ObjectFetchContext::getNullContext())
+                  .get(0ms);
+  EXPECT_EQ(4, none.treeCount);
+  EXPECT_EQ(0, none.blobCount);
+}
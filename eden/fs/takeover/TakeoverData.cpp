@@ -8,8 +8,10 @@
 #include "eden/fs/takeover/TakeoverData.h"
 
 #include <folly/Format.h>
+#include <folly/Varint.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include "eden/fs/utils/Bug.h"
@@ -24,7 +26,163 @@ namespace eden {
 const std::set<int32_t> kSupportedTakeoverVersions{
     TakeoverData::kTakeoverProtocolVersionOne,
     TakeoverData::kTakeoverProtocolVersionThree,
-    TakeoverData::kTakeoverProtocolVersionFour};
+    TakeoverData::kTakeoverProtocolVersionFour,
+    TakeoverData::kTakeoverProtocolVersionFive,
+    TakeoverData::kTakeoverProtocolVersionSix};
+
+namespace {
+/**
+ * The compact inode map is built in chunks of this size, so that very large
+ * maps never need one contiguous buffer.
+ */
+constexpr size_t kInodeMapChunkSize = 1024 * 1024;
+
+enum InodeMapEntryFlags : uint8_t {
+  kUnlinked = 0x01,
+  kHasHash = 0x02,
+};
+
+void writeVarint(folly::io::QueueAppender& app, uint64_t value) {
+  uint8_t buf[folly::kMaxVarintLength64];
+  auto size = folly::encodeVarint(value, buf);
+  app.push(buf, size);
+}
+
+uint64_t readVarint(folly::io::Cursor& cursor) {
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    auto byte = cursor.read<uint8_t>();
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw std::runtime_error("invalid varint in takeover inode map");
+}
+
+/**
+ * Encodes the inode map as an entry count followed by, for each entry, the
+ * varint encoded inode and parent numbers, the name, a flags byte, the varint
+ * encoded FUSE reference count and mode, and the binary hash if there is one.
+ * Names and hashes are preceded by their varint encoded length.
+ */
+std::unique_ptr<IOBuf> encodeInodeMap(const SerializedInodeMap& inodeMap) {
+  folly::IOBufQueue bufQ;
+  folly::io::QueueAppender app(&bufQ, kInodeMapChunkSize);
+
+  const auto& entries = *inodeMap.unloadedInodes_ref();
+  writeVarint(app, entries.size());
+  for (const auto& entry : entries) {
+    const auto& name = *entry.name_ref();
+    const auto& hash = *entry.hash_ref();
+    writeVarint(app, *entry.inodeNumber_ref());
+    writeVarint(app, *entry.parentInode_ref());
+    writeVarint(app, name.size());
+    app.push(folly::StringPiece{name});
+    uint8_t flags = (*entry.isUnlinked_ref() ? kUnlinked : 0) |
+        (hash.empty() ? 0 : kHasHash);
+    app.write<uint8_t>(flags);
+    writeVarint(app, *entry.numFuseReferences_ref());
+    writeVarint(app, static_cast<uint32_t>(*entry.mode_ref()));
+    if (!hash.empty()) {
+      writeVarint(app, hash.size());
+      app.push(folly::StringPiece{hash});
+    }
+  }
+  return bufQ.move();
+}
+
+SerializedInodeMap decodeInodeMap(folly::io::Cursor& cursor) {
+  SerializedInodeMap inodeMap;
+  auto& entries = *inodeMap.unloadedInodes_ref();
+
+  auto numEntries = readVarint(cursor);
+  // Every entry takes at least 6 bytes, so a corrupt count cannot make us
+  // reserve more memory than the message could possibly describe.
+  entries.reserve(std::min<uint64_t>(numEntries, cursor.totalLength() / 6));
+  for (uint64_t i = 0; i < numEntries; ++i) {
+    SerializedInodeMapEntry entry;
+    *entry.inodeNumber_ref() = readVarint(cursor);
+    *entry.parentInode_ref() = readVarint(cursor);
+    *entry.name_ref() = cursor.readFixedString(readVarint(cursor));
+    auto flags = cursor.read<uint8_t>();
+    *entry.isUnlinked_ref() = flags & kUnlinked;
+    *entry.numFuseReferences_ref() = readVarint(cursor);
+    *entry.mode_ref() = static_cast<int32_t>(readVarint(cursor));
+    if (flags & kHasHash) {
+      *entry.hash_ref() = cursor.readFixedString(readVarint(cursor));
+    }
+    entries.emplace_back(std::move(entry));
+  }
+  return inodeMap;
+}
+
+/**
+ * Encodes a list of hashes as its varint encoded length followed by the raw
+ * bytes of each hash.
+ */
+void encodeHashes(folly::IOBufQueue& bufQ, const std::vector<Hash>& hashes) {
+  folly::io::QueueAppender app(&bufQ, 64 * 1024);
+  writeVarint(app, hashes.size());
+  for (const auto& hash : hashes) {
+    app.push(hash.getBytes());
+  }
+}
+
+std::vector<Hash> decodeHashes(folly::io::Cursor& cursor) {
+  auto numHashes = readVarint(cursor);
+  std::vector<Hash> hashes;
+  hashes.reserve(
+      std::min<uint64_t>(numHashes, cursor.totalLength() / Hash::RAW_SIZE));
+  for (uint64_t i = 0; i < numHashes; ++i) {
+    Hash::Storage bytes;
+    cursor.pull(bytes.data(), bytes.size());
+    hashes.emplace_back(bytes);
+  }
+  return hashes;
+}
+
+/**
+ * Builds the thrift representation of the mount points. The inode maps are
+ * left out unless includeInodeMaps is true.
+ */
+SerializedTakeoverData serializeMounts(
+    const std::vector<TakeoverData::MountInfo>& mountPoints,
+    bool includeInodeMaps) {
+  SerializedTakeoverData serialized;
+
+  std::vector<SerializedMountInfo> serializedMounts;
+  for (const auto& mount : mountPoints) {
+    SerializedMountInfo serializedMount;
+
+    *serializedMount.mountPath_ref() = mount.mountPath.stringPiece().str();
+    *serializedMount.stateDirectory_ref() =
+        mount.stateDirectory.stringPiece().str();
+
+    for (const auto& bindMount : mount.bindMounts) {
+      serializedMount.bindMountPaths_ref()->push_back(
+          bindMount.stringPiece().str());
+    }
+
+    // Stuffing the fuse connection information in as a binary
+    // blob because we know that the endianness of the target
+    // machine must match the current system for a graceful
+    // takeover, and it saves us from re-encoding an operating
+    // system specific struct into a thrift file.
+    *serializedMount.connInfo_ref() = std::string{
+        reinterpret_cast<const char*>(&mount.connInfo), sizeof(mount.connInfo)};
+
+    if (includeInodeMaps) {
+      *serializedMount.inodeMap_ref() = mount.inodeMap;
+    }
+
+    serializedMounts.emplace_back(std::move(serializedMount));
+  }
+
+  serialized.set_mounts(std::move(serializedMounts));
+  return serialized;
+}
+} // namespace
 
 std::optional<int32_t> TakeoverData::computeCompatibleVersion(
     const std::set<int32_t>& versions,
@@ -53,6 +211,9 @@ IOBuf TakeoverData::serialize(int32_t protocolVersion) {
     case kTakeoverProtocolVersionFour:
       // versions 3 and 4 use the same data serialization
       return serializeVersion3();
+    case kTakeoverProtocolVersionFive:
+    case kTakeoverProtocolVersionSix:
+      return serializeVersion5(protocolVersion);
     default: {
       EDEN_BUG() << "asked to serialize takeover data in unsupported format "
                  << protocolVersion;
@@ -72,7 +233,8 @@ folly::IOBuf TakeoverData::serializeError(
       return serializeErrorVersion1(ew);
     case kTakeoverProtocolVersionThree:
     case kTakeoverProtocolVersionFour:
-      // versions 3 and 4 use the same data serialization
+    case kTakeoverProtocolVersionFive:
+      // versions 3, 4 and 5 use the same error serialization
       return serializeErrorVersion3(ew);
     default: {
       EDEN_BUG() << "asked to serialize takeover error in unsupported format "
@@ -114,6 +276,10 @@ TakeoverData TakeoverData::deserialize(IOBuf* buf) {
       // and let the underlying code decode the data
       buf->trimStart(sizeof(uint32_t));
       return deserializeVersion3(buf);
+    case kTakeoverProtocolVersionFive:
+    case kTakeoverProtocolVersionSix:
+      buf->trimStart(sizeof(uint32_t));
+      return deserializeVersion5(buf, static_cast<int32_t>(messageType));
     default:
       throw std::runtime_error(folly::sformat(
           "Unrecognized TakeoverData response starting with {:x}",
@@ -282,43 +448,47 @@ TakeoverData TakeoverData::deserializeVersion1(IOBuf* buf) {
 }
 
 IOBuf TakeoverData::serializeVersion3() {
-  SerializedTakeoverData serialized;
-
   folly::IOBufQueue bufQ;
   folly::io::QueueAppender app(&bufQ, 0);
 
   // First word is the protocol version
   app.writeBE<uint32_t>(kTakeoverProtocolVersionThree);
 
-  std::vector<SerializedMountInfo> serializedMounts;
-  for (const auto& mount : mountPoints) {
-    SerializedMountInfo serializedMount;
-
-    *serializedMount.mountPath_ref() = mount.mountPath.stringPiece().str();
-    *serializedMount.stateDirectory_ref() =
-        mount.stateDirectory.stringPiece().str();
+  CompactSerializer::serialize(
+      serializeMounts(mountPoints, /*includeInodeMaps=*/true), &bufQ);
+  return std::move(*bufQ.move());
+}
 
-    for (const auto& bindMount : mount.bindMounts) {
-      serializedMount.bindMountPaths_ref()->push_back(
-          bindMount.stringPiece().str());
-    }
+IOBuf TakeoverData::serializeVersion5(int32_t protocolVersion) {
+  auto serializedMounts =
+      CompactSerializer::serialize<folly::IOBufQueue>(
+          serializeMounts(mountPoints, /*includeInodeMaps=*/false))
+          .move();
 
-    // Stuffing the fuse connection information in as a binary
-    // blob because we know that the endianness of the target
-    // machine must match the current system for a graceful
-    // takeover, and it saves us from re-encoding an operating
-    // system specific struct into a thrift file.
-    *serializedMount.connInfo_ref() = std::string{
-        reinterpret_cast<const char*>(&mount.connInfo), sizeof(mount.connInfo)};
-
-    *serializedMount.inodeMap_ref() = mount.inodeMap;
+  folly::IOBufQueue bufQ;
+  folly::io::QueueAppender app(&bufQ, 0);
 
-    serializedMounts.emplace_back(std::move(serializedMount));
+  // First word is the protocol version, followed by the length of the thrift
+  // encoded mounts.
+  app.writeBE<uint32_t>(protocolVersion);
+  app.writeBE<uint32_t>(
+      serializedMounts ? serializedMounts->computeChainDataLength() : 0);
+  if (serializedMounts) {
+    bufQ.append(std::move(serializedMounts));
   }
 
-  serialized.set_mounts(std::move(serializedMounts));
+  // Then the inode map of each mount, in the same order as the mounts.
+  for (const auto& mount : mountPoints) {
+    auto inodeMap = encodeInodeMap(mount.inodeMap);
+    folly::io::QueueAppender lengthApp(&bufQ, 0);
+    lengthApp.writeBE<uint64_t>(inodeMap->computeChainDataLength());
+    bufQ.append(std::move(inodeMap));
+  }
 
-  CompactSerializer::serialize(serialized, &bufQ);
+  if (protocolVersion >= kTakeoverProtocolVersionSix) {
+    encodeHashes(bufQ, cachedTrees);
+    encodeHashes(bufQ, cachedBlobs);
+  }
   return std::move(*bufQ.move());
 }
 
@@ -378,5 +548,36 @@ TakeoverData TakeoverData::deserializeVersion3(IOBuf* buf) {
       "impossible enum variant for SerializedTakeoverData");
 }
 
+TakeoverData TakeoverData::deserializeVersion5(
+    IOBuf* buf,
+    int32_t protocolVersion) {
+  folly::io::Cursor cursor(buf);
+
+  auto mountsLength = cursor.readBE<uint32_t>();
+  std::unique_ptr<IOBuf> serializedMounts;
+  cursor.clone(serializedMounts, mountsLength);
+  auto data = deserializeVersion3(serializedMounts.get());
+
+  for (auto& mount : data.mountPoints) {
+    auto inodeMapLength = cursor.readBE<uint64_t>();
+    size_t remaining = cursor.totalLength();
+    mount.inodeMap = decodeInodeMap(cursor);
+    if (remaining - cursor.totalLength() != inodeMapLength) {
+      throw std::runtime_error(folly::to<string>(
+          "takeover inode map for ",
+          mount.mountPath.stringPiece(),
+          " does not match its length of ",
+          inodeMapLength,
+          " bytes"));
+    }
+  }
+
+  if (protocolVersion >= kTakeoverProtocolVersionSix) {
+    data.cachedTrees = decodeHashes(cursor);
+    data.cachedBlobs = decodeHashes(cursor);
+  }
+  return data;
+}
+
 } // namespace eden
 } // namespace facebook
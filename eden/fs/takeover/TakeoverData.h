@@ -13,6 +13,7 @@
 #include <optional>
 #include <vector>
 
+#include "eden/fs/model/Hash.h"
 #include "eden/fs/utils/PathFuncs.h"
 
 #ifndef _WIN32
@@ -75,6 +76,19 @@ class TakeoverData {
     // break a server with this extra handshake talking to a client
     // without it
     kTakeoverProtocolVersionFour = 4,
+
+    // This version sends the inode map of each mount in a compact binary
+    // encoding after the thrift encoded mount information, instead of as
+    // a thrift list with a struct per inode. Decoding millions of thrift
+    // structs dominated the time the mounts were paused during takeover.
+    // The handshake is the same as in version 4.
+    kTakeoverProtocolVersionFive = 5,
+
+    // This version appends the hashes of the trees and blobs in the old
+    // process's memory caches to the version 5 encoding, so that the new
+    // process can reload them from the LocalStore instead of starting with
+    // cold caches.  The handshake is the same as in version 4.
+    kTakeoverProtocolVersionSix = 6,
   };
 
   // Given a set of versions provided by a client, find the largest
@@ -154,6 +168,13 @@ class TakeoverData {
    */
   std::vector<MountInfo> mountPoints;
 
+  /**
+   * The trees and blobs in the old process's memory caches, most recently
+   * used first.  These are only sent with version 6 of the protocol or later.
+   */
+  std::vector<Hash> cachedTrees;
+  std::vector<Hash> cachedBlobs;
+
   /**
    * The takeoverComplete promise will be fulfilled by the TakeoverServer code
    * once the TakeoverData has been sent to the remote process.
@@ -195,6 +216,19 @@ class TakeoverData {
    */
   static TakeoverData deserializeVersion3(folly::IOBuf* buf);
 
+  /**
+   * Serialize data using version 5 or 6 of the takeover protocol.
+   */
+  folly::IOBuf serializeVersion5(int32_t protocolVersion);
+
+  /**
+   * Deserialize the TakeoverData from a buffer using version 5 or 6 of the
+   * takeover protocol.
+   */
+  static TakeoverData deserializeVersion5(
+      folly::IOBuf* buf,
+      int32_t protocolVersion);
+
   /**
    * Message type values.
    * If we ever need to include more information in the takeover data in the
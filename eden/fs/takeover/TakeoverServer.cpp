@@ -147,7 +147,7 @@ Future<Unit> TakeoverServer::ConnHandler::start() noexcept {
           // Initiate the takeover shutdown.
           protocolVersion_ = supported.value();
           shouldPing_ =
-              (protocolVersion_ == TakeoverData::kTakeoverProtocolVersionFour);
+              (protocolVersion_ >= TakeoverData::kTakeoverProtocolVersionFour);
           return server_->getTakeoverHandler()->startTakeoverShutdown();
         })
         .thenTryInline(folly::makeAsyncTask(
@@ -335,6 +335,88 @@ TEST(Takeover, manyMounts) {
   }
 }
 
+TEST(Takeover, inodeMapRoundTrip) {
+  SerializedInodeMap inodeMap;
+  for (int64_t n = 2; n < 1000; ++n) {
+    SerializedInodeMapEntry entry;
+    *entry.inodeNumber_ref() = n;
+    *entry.parentInode_ref() = n / 2;
+    *entry.name_ref() = folly::to<string>("file", n);
+    *entry.isUnlinked_ref() = (n % 7 == 0);
+    *entry.numFuseReferences_ref() = n % 3;
+    *entry.mode_ref() = S_IFREG | 0644;
+    if (n % 2 == 0) {
+      *entry.hash_ref() = string(20, static_cast<char>(n));
+    }
+    inodeMap.unloadedInodes_ref()->emplace_back(std::move(entry));
+  }
+
+  for (auto version : {TakeoverData::kTakeoverProtocolVersionThree,
+                       TakeoverData::kTakeoverProtocolVersionFive,
+                       TakeoverData::kTakeoverProtocolVersionSix}) {
+    TakeoverData serverData;
+    serverData.mountPoints.emplace_back(
+        AbsolutePath{"/mount1"},
+        AbsolutePath{"/client1"},
+        std::vector<AbsolutePath>{},
+        folly::File{},
+        fuse_init_out{},
+        SerializedInodeMap{inodeMap});
+    serverData.mountPoints.emplace_back(
+        AbsolutePath{"/mount2"},
+        AbsolutePath{"/client2"},
+        std::vector<AbsolutePath>{},
+        folly::File{},
+        fuse_init_out{},
+        SerializedInodeMap{});
+
+    auto buf = serverData.serialize(version);
+    auto clientData = TakeoverData::deserialize(&buf);
+    ASSERT_EQ(2, clientData.mountPoints.size()) << "version " << version;
+    EXPECT_EQ(AbsolutePath{"/mount2"}, clientData.mountPoints[1].mountPath);
+    EXPECT_EQ(inodeMap, clientData.mountPoints[0].inodeMap)
+        << "version " << version;
+    EXPECT_EQ(SerializedInodeMap{}, clientData.mountPoints[1].inodeMap)
+        << "version " << version;
+  }
+}
+
+TEST(Takeover, cachedHashesRoundTrip) {
+  std::vector<Hash> trees;
+  std::vector<Hash> blobs;
+  for (uint8_t n = 0; n < 100; ++n) {
+    Hash::Storage bytes{};
+    bytes[0] = n;
+    trees.emplace_back(bytes);
+    bytes[1] = 1;
+    blobs.emplace_back(bytes);
+  }
+
+  TakeoverData serverData;
+  serverData.mountPoints.emplace_back(
+      AbsolutePath{"/mount1"},
+      AbsolutePath{"/client1"},
+      std::vector<AbsolutePath>{},
+      folly::File{},
+      fuse_init_out{},
+      SerializedInodeMap{});
+  serverData.cachedTrees = trees;
+  serverData.cachedBlobs = blobs;
+
+  auto buf = serverData.serialize(TakeoverData::kTakeoverProtocolVersionSix);
+  auto clientData = TakeoverData::deserialize(&buf);
+  ASSERT_EQ(1, clientData.mountPoints.size());
+  EXPECT_EQ(trees, clientData.cachedTrees);
+  EXPECT_EQ(blobs, clientData.cachedBlobs);
+
+  // Older versions of the protocol leave the hashes out.
+  buf = serverData.serialize(TakeoverData::kTakeoverProtocolVersionFive);
+  clientData = TakeoverData::deserialize(&buf);
+  ASSERT_EQ(1, clientData.mountPoints.size());
+  EXPECT_TRUE(clientData.cachedTrees.empty());
+  EXPECT_TRUE(clientData.cachedBlobs.empty());
+}
+
 TEST(Takeover, error) {
   TemporaryDirectory tmpDir("eden_takeover_test");
   ErrorHandler handler;
@@ -14,47 +14,60 @@ namespace {
 constexpr std::chrono::microseconds kMinValue{0};
 constexpr std::chrono::microseconds kMaxValue{10000};
 constexpr std::chrono::microseconds kBucketSize{1000};
+
+constexpr int64_t kQueueDepthMinValue{0};
+constexpr int64_t kQueueDepthMaxValue{1000};
+constexpr int64_t kQueueDepthBucketSize{10};
+
+template <typename ThreadLocal>
+auto& getActiveStats(ThreadLocal& threadLocal) {
+  auto& stats = *threadLocal.get();
+  stats.markActive();
+  return stats;
+}
+
+template <typename ThreadLocal>
+void aggregateActiveStats(ThreadLocal& threadLocal) {
+  for (auto& stats : threadLocal.accessAllThreads()) {
+    stats.aggregateIfActive();
+  }
+}
 } // namespace
 
 namespace facebook {
 namespace eden {
 
 EdenStats::ChannelThreadStats& EdenStats::getChannelStatsForCurrentThread() {
-  return *threadLocalChannelStats_.get();
+  return getActiveStats(threadLocalChannelStats_);
 }
 
 ObjectStoreThreadStats& EdenStats::getObjectStoreStatsForCurrentThread() {
-  return *threadLocalObjectStoreStats_.get();
+  return getActiveStats(threadLocalObjectStoreStats_);
 }
 
 HgBackingStoreThreadStats& EdenStats::getHgBackingStoreStatsForCurrentThread() {
-  return *threadLocalHgBackingStoreStats_.get();
+  return getActiveStats(threadLocalHgBackingStoreStats_);
 }
 
 HgImporterThreadStats& EdenStats::getHgImporterStatsForCurrentThread() {
-  return *threadLocalHgImporterStats_.get();
+  return getActiveStats(threadLocalHgImporterStats_);
 }
 
 JournalThreadStats& EdenStats::getJournalStatsForCurrentThread() {
-  return *threadLocalJournalStats_.get();
+  return getActiveStats(threadLocalJournalStats_);
+}
+
+ThriftThreadStats& EdenStats::getThriftStatsForCurrentThread() {
+  return getActiveStats(threadLocalThriftStats_);
 }
 
 void EdenStats::aggregate() {
-  for (auto& stats : threadLocalChannelStats_.accessAllThreads()) {
-    stats.aggregate();
-  }
-  for (auto& stats : threadLocalObjectStoreStats_.accessAllThreads()) {
-    stats.aggregate();
-  }
-  for (auto& stats : threadLocalHgBackingStoreStats_.accessAllThreads()) {
-    stats.aggregate();
-  }
-  for (auto& stats : threadLocalHgImporterStats_.accessAllThreads()) {
-    stats.aggregate();
-  }
-  for (auto& stats : threadLocalJournalStats_.accessAllThreads()) {
-    stats.aggregate();
-  }
+  aggregateActiveStats(threadLocalChannelStats_);
+  aggregateActiveStats(threadLocalObjectStoreStats_);
+  aggregateActiveStats(threadLocalHgBackingStoreStats_);
+  aggregateActiveStats(threadLocalHgImporterStats_);
+  aggregateActiveStats(threadLocalJournalStats_);
+  aggregateActiveStats(threadLocalThriftStats_);
 }
 
 std::shared_ptr<HgImporterThreadStats> getSharedHgImporterStatsForCurrentThread(
@@ -65,6 +78,18 @@ std::shared_ptr<HgImporterThreadStats> getSharedHgImporterStatsForCurrentThread(
 
 EdenThreadStatsBase::EdenThreadStatsBase() {}
 
+void EdenThreadStatsBase::aggregateIfActive() {
+  auto rounds = activeRounds_.load(std::memory_order_relaxed);
+  if (rounds == 0) {
+    return;
+  }
+  // If the owning thread marks the stats active again meanwhile, leave its
+  // mark in place.
+  activeRounds_.compare_exchange_strong(
+      rounds, rounds - 1, std::memory_order_relaxed);
+  aggregate();
+}
+
 EdenThreadStatsBase::Histogram EdenThreadStatsBase::createHistogram(
     const std::string& name) {
   return Histogram{this,
@@ -78,6 +103,19 @@ EdenThreadStatsBase::Histogram EdenThreadStatsBase::createHistogram(
                    99};
 }
 
+EdenThreadStatsBase::Histogram EdenThreadStatsBase::createQueueDepthHistogram(
+    const std::string& name) {
+  return Histogram{this,
+                   name,
+                   kQueueDepthBucketSize,
+                   kQueueDepthMinValue,
+                   kQueueDepthMaxValue,
+                   fb303::AVG,
+                   50,
+                   90,
+                   99};
+}
+
 EdenThreadStatsBase::Timeseries EdenThreadStatsBase::createTimeseries(
     const std::string& name) {
   auto timeseries = Timeseries{this, name};
@@ -9,6 +9,8 @@
 
 #include <fb303/ThreadLocalStats.h>
 #include <folly/ThreadLocal.h>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 
 #include "eden/fs/eden-config.h"
@@ -22,6 +24,7 @@ class ObjectStoreThreadStats;
 class HgBackingStoreThreadStats;
 class HgImporterThreadStats;
 class JournalThreadStats;
+class ThriftThreadStats;
 
 class EdenStats {
  public:
@@ -67,6 +70,17 @@ class EdenStats {
   JournalThreadStats& getJournalStatsForCurrentThread();
 
   /**
+   * This function can be called on any thread.
+   *
+   * The returned object can be used only on the current thread.
+   */
+  ThriftThreadStats& getThriftStatsForCurrentThread();
+
+  /**
+   * Aggregates the stats of the threads that updated them since the last few
+   * calls.  The stats of idle threads are skipped, so that the cost of this
+   * scales with activity rather than with the number of threads.
+   *
    * This function can be called on any thread.
    */
   void aggregate();
@@ -84,6 +98,8 @@ class EdenStats {
       threadLocalHgImporterStats_;
   folly::ThreadLocal<JournalThreadStats, ThreadLocalTag, void>
       threadLocalJournalStats_;
+  folly::ThreadLocal<ThriftThreadStats, ThreadLocalTag, void>
+      threadLocalThriftStats_;
 };
 
 std::shared_ptr<HgImporterThreadStats> getSharedHgImporterStatsForCurrentThread(
@@ -105,9 +121,35 @@ class EdenThreadStatsBase
 
   explicit EdenThreadStatsBase();
 
+  /**
+   * Records that the owning thread is about to update these stats.  This is
+   * called by the EdenStats accessors.
+   */
+  void markActive() {
+    if (activeRounds_.load(std::memory_order_relaxed) != kActiveRounds) {
+      activeRounds_.store(kActiveRounds, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Aggregates these stats if they were marked active since the last
+   * kActiveRounds calls.  This can be called on any thread.
+   */
+  void aggregateIfActive();
+
  protected:
   Histogram createHistogram(const std::string& name);
+  Histogram createQueueDepthHistogram(const std::string& name);
   Timeseries createTimeseries(const std::string& name);
+
+ private:
+  /**
+   * An update can land just after the aggregation that follows markActive(),
+   * so the stats are aggregated once more before being treated as idle.
+   */
+  static constexpr uint8_t kActiveRounds = 2;
+
+  std::atomic<uint8_t> activeRounds_{0};
 };
 
 class FuseThreadStats : public EdenThreadStatsBase {
@@ -135,6 +177,7 @@ class FuseThreadStats : public EdenThreadStatsBase {
   Histogram fsync{createHistogram("fuse.fsync_us")};
   Histogram opendir{createHistogram("fuse.opendir_us")};
   Histogram readdir{createHistogram("fuse.readdir_us")};
+  Histogram readdirplus{createHistogram("fuse.readdirplus_us")};
   Histogram releasedir{createHistogram("fuse.releasedir_us")};
   Histogram fsyncdir{createHistogram("fuse.fsyncdir_us")};
   Histogram statfs{createHistogram("fuse.statfs_us")};
@@ -149,6 +192,18 @@ class FuseThreadStats : public EdenThreadStatsBase {
   Histogram poll{createHistogram("fuse.poll_us")};
   Histogram forgetmulti{createHistogram("fuse.forgetmulti_us")};
 
+  // The number of requests waiting for a thread in each FUSE request pool,
+  // sampled whenever a request is queued.  See fuse/FuseRequestClass.h.
+  Histogram metadataQueueDepth{
+      createQueueDepthHistogram("fuse.queue_depth.metadata")};
+  Histogram dataQueueDepth{createQueueDepthHistogram("fuse.queue_depth.data")};
+  Histogram mutationQueueDepth{
+      createQueueDepthHistogram("fuse.queue_depth.mutation")};
+
+  // Requests that waited because their process had
+  // fuse:max-requests-per-process requests in progress.
+  Timeseries admissionDelayed{createTimeseries("fuse.admission_delayed")};
+
   // Since we can potentially finish a request in a different
   // thread from the one used to initiate it, we use HistogramPtr
   // as a helper for referencing the pointer-to-member that we
@@ -178,10 +233,28 @@ class PrjFSThreadStats : public EdenThreadStatsBase {
  */
 class ObjectStoreThreadStats : public EdenThreadStatsBase {
  public:
+  Timeseries getTreeFromMemory{
+      createTimeseries("object_store.get_tree.memory")};
+  Timeseries getTreeFromLocalStore{
+      createTimeseries("object_store.get_tree.local_store")};
+  Timeseries getTreeFromBackingStore{
+      createTimeseries("object_store.get_tree.backing_store")};
+  // Calls that shared a load already in progress for the same object.
+  Timeseries getTreeCoalesced{
+      createTimeseries("object_store.get_tree.coalesced")};
+
   Timeseries getBlobFromLocalStore{
       createTimeseries("object_store.get_blob.local_store")};
   Timeseries getBlobFromBackingStore{
       createTimeseries("object_store.get_blob.backing_store")};
+  Timeseries getBlobCoalesced{
+      createTimeseries("object_store.get_blob.coalesced")};
+  // Blobs prefetched because they usually follow a blob just read, and the
+  // ones of those that were then read.
+  Timeseries coAccessPrefetch{
+      createTimeseries("object_store.co_access.prefetch")};
+  Timeseries coAccessPrefetchHit{
+      createTimeseries("object_store.co_access.hit")};
 
   Timeseries getBlobMetadataFromMemory{
       createTimeseries("object_store.get_blob_metadata.memory")};
@@ -189,11 +262,20 @@ class ObjectStoreThreadStats : public EdenThreadStatsBase {
       createTimeseries("object_store.get_blob_metadata.local_store")};
   Timeseries getBlobMetadataFromBackingStore{
       createTimeseries("object_store.get_blob_metadata.backing_store")};
+  Timeseries getBlobMetadataCoalesced{
+      createTimeseries("object_store.get_blob_metadata.coalesced")};
 
   Timeseries getBlobSizeFromLocalStore{
       createTimeseries("object_store.get_blob_size.local_store")};
   Timeseries getBlobSizeFromBackingStore{
       createTimeseries("object_store.get_blob_size.backing_store")};
+
+  // Time spent writing objects fetched from the backing store to the
+  // LocalStore.
+  Histogram localStoreWriteTree{
+      createHistogram("object_store.local_store_write.tree_us")};
+  Histogram localStoreWriteBlob{
+      createHistogram("object_store.local_store_write.blob_us")};
 };
 
 /**
@@ -209,6 +291,26 @@ class HgBackingStoreThreadStats : public EdenThreadStatsBase {
       createHistogram("store.mononoke.get_tree")};
   Histogram mononokeBackingStoreGetBlob{
       createHistogram("store.mononoke.get_blob")};
+  Histogram hgBackingStoreImportPrefetch{
+      createHistogram("store.hg.import_prefetch")};
+
+  // Stages of the import queue, in milliseconds.
+  Histogram hgImportQueueWaitBlob{createHistogram("store.hg.queue_wait.blob")};
+  Histogram hgImportQueueWaitTree{createHistogram("store.hg.queue_wait.tree")};
+  Histogram hgImportQueueWaitPrefetch{
+      createHistogram("store.hg.queue_wait.prefetch")};
+  Histogram hgImportBatchFetchBlob{
+      createHistogram("store.hg.batch_fetch.blob")};
+  Histogram hgImportBatchFetchTree{
+      createHistogram("store.hg.batch_fetch.tree")};
+
+  // Number of requests in each batch taken from the import queue.
+  Histogram hgImportBatchSizeBlob{
+      createQueueDepthHistogram("store.hg.batch_size.blob")};
+  Histogram hgImportBatchSizeTree{
+      createQueueDepthHistogram("store.hg.batch_size.tree")};
+  Histogram hgImportBatchSizePrefetch{
+      createQueueDepthHistogram("store.hg.batch_size.prefetch")};
 };
 
 /**
@@ -234,5 +336,13 @@ class JournalThreadStats : public EdenThreadStatsBase {
                               fb303::SUM};
 };
 
+/**
+ * @see ThriftLoadShedder
+ */
+class ThriftThreadStats : public EdenThreadStatsBase {
+ public:
+  Timeseries loadShed{this, "thrift.load_shed", fb303::SUM};
+};
+
 } // namespace eden
 } // namespace facebook
@@ -18,16 +18,83 @@
 namespace facebook {
 namespace eden {
 
-RequestMetricsScope::RequestMetricsScope(
-    LockedRequestWatchList* pendingRequestWatches)
-    : pendingRequestWatches_(pendingRequestWatches) {
-  folly::stop_watch<> watch;
-  {
-    auto startTimes = pendingRequestWatches_->wlock();
-    requestWatch_ = startTimes->insert(startTimes->end(), watch);
+namespace {
+// Threads start scanning for an empty slot a few cache lines apart.
+constexpr size_t kSlotsPerCacheLine =
+    64 / sizeof(std::atomic<RequestWatchList::Clock::rep>);
+
+size_t getThreadStartSlot() {
+  static std::atomic<size_t> nextThread{0};
+  thread_local size_t startSlot =
+      nextThread.fetch_add(1, std::memory_order_relaxed) * kSlotsPerCacheLine;
+  return startSlot;
+}
+} // namespace
+
+RequestWatchList::RequestWatchList() {
+  for (auto& slot : slots_) {
+    slot.store(kEmptySlot, std::memory_order_relaxed);
+  }
+}
+
+RequestWatchList::Handle RequestWatchList::insert(Clock::time_point start) {
+  // The start time is only used for reporting, so relaxed ordering is enough.
+  auto startRep = std::max(start.time_since_epoch().count(), kEmptySlot + 1);
+  auto startSlot = getThreadStartSlot();
+  for (size_t i = 0; i < kSlotCount; ++i) {
+    auto index = (startSlot + i) % kSlotCount;
+    auto expected = kEmptySlot;
+    if (slots_[index].load(std::memory_order_relaxed) == kEmptySlot &&
+        slots_[index].compare_exchange_strong(
+            expected, startRep, std::memory_order_relaxed)) {
+      return Handle{index, {}};
+    }
+  }
+
+  auto overflow = overflow_.wlock();
+  return Handle{kSlotCount, overflow->insert(overflow->end(), start)};
+}
+
+void RequestWatchList::remove(const Handle& handle) {
+  if (handle.slot < kSlotCount) {
+    slots_[handle.slot].store(kEmptySlot, std::memory_order_relaxed);
+  } else {
+    overflow_.wlock()->erase(handle.overflowEntry);
   }
 }
 
+size_t RequestWatchList::size() const {
+  size_t count = 0;
+  for (const auto& slot : slots_) {
+    if (slot.load(std::memory_order_relaxed) != kEmptySlot) {
+      ++count;
+    }
+  }
+  return count + overflow_.rlock()->size();
+}
+
+RequestWatchList::Clock::duration RequestWatchList::getMaxDuration() const {
+  auto now = Clock::now();
+  Clock::duration maxDuration{0};
+  for (const auto& slot : slots_) {
+    auto startRep = slot.load(std::memory_order_relaxed);
+    if (startRep != kEmptySlot) {
+      auto start = Clock::time_point{Clock::duration{startRep}};
+      maxDuration = std::max(maxDuration, now - start);
+    }
+  }
+  for (const auto& start : *overflow_.rlock()) {
+    maxDuration = std::max(maxDuration, now - start);
+  }
+  return maxDuration;
+}
+
+RequestMetricsScope::RequestMetricsScope(
+    RequestWatchList* pendingRequestWatches)
+    : pendingRequestWatches_(pendingRequestWatches),
+      requestWatch_(
+          pendingRequestWatches_->insert(RequestWatchList::Clock::now())) {}
+
 RequestMetricsScope::RequestMetricsScope() : pendingRequestWatches_(nullptr) {}
 
 RequestMetricsScope::RequestMetricsScope(RequestMetricsScope&& other) noexcept
@@ -38,6 +105,12 @@ RequestMetricsScope::RequestMetricsScope(RequestMetricsScope&& other) noexcept
 
 RequestMetricsScope& RequestMetricsScope::operator=(
     RequestMetricsScope&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  if (pendingRequestWatches_ != nullptr) {
+    pendingRequestWatches_->remove(requestWatch_);
+  }
   this->pendingRequestWatches_ = std::move(other.pendingRequestWatches_);
   this->requestWatch_ = std::move(other.requestWatch_);
   other.pendingRequestWatches_ = nullptr;
@@ -46,8 +119,7 @@ RequestMetricsScope& RequestMetricsScope::operator=(
 
 RequestMetricsScope::~RequestMetricsScope() {
   if (pendingRequestWatches_ != nullptr) {
-    auto startTimes = pendingRequestWatches_->wlock();
-    startTimes->erase(requestWatch_);
+    pendingRequestWatches_->remove(requestWatch_);
   }
 }
 
@@ -99,10 +171,10 @@ size_t RequestMetricsScope::aggregateMetricCounters(
 
 size_t RequestMetricsScope::getMetricFromWatches(
     RequestMetric metric,
-    const LockedRequestWatchList& watches) {
+    const RequestWatchList& watches) {
   switch (metric) {
     case COUNT:
-      return watches.rlock()->size();
+      return watches.size();
     case MAX_DURATION_US:
       return static_cast<size_t>(
           std::chrono::duration_cast<std::chrono::microseconds>(
@@ -113,15 +185,8 @@ size_t RequestMetricsScope::getMetricFromWatches(
 }
 
 RequestMetricsScope::DefaultRequestDuration RequestMetricsScope::getMaxDuration(
-    const LockedRequestWatchList& watches) {
-  DefaultRequestDuration maxDurationImport{0};
-  {
-    auto lockedWatches = watches.rlock();
-    for (const auto& watch : *lockedWatches) {
-      maxDurationImport = std::max(maxDurationImport, watch.elapsed());
-    }
-  }
-  return maxDurationImport;
+    const RequestWatchList& watches) {
+  return watches.getMaxDuration();
 }
 
 } // namespace eden
@@ -7,17 +7,66 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <list>
 #include <memory>
 #include <string>
 
 #include <folly/String.h>
 #include <folly/Synchronized.h>
-#include <folly/stop_watch.h>
 
 namespace facebook {
 namespace eden {
 
+/**
+ * The start times of the requests that are in progress, so that their number
+ * and the duration of the oldest one can be reported.
+ *
+ * Requests are tracked in a fixed array of slots.  Inserting claims an empty
+ * slot with a compare-and-swap, scanning from a per-thread starting point so
+ * that threads rarely share a cache line, and removing is a single store.
+ * Neither takes a lock unless every slot is in use, in which case the request
+ * goes on a locked overflow list.  Reporting scans all the slots.
+ */
+class RequestWatchList {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Identifies an inserted request, to be passed back to remove().
+   */
+  struct Handle {
+    size_t slot;
+    std::list<Clock::time_point>::iterator overflowEntry;
+  };
+
+  RequestWatchList();
+  RequestWatchList(const RequestWatchList&) = delete;
+  RequestWatchList& operator=(const RequestWatchList&) = delete;
+
+  Handle insert(Clock::time_point start);
+  void remove(const Handle& handle);
+
+  /** The number of requests in progress. */
+  size_t size() const;
+
+  /**
+   * How long the oldest request in progress has been running, or zero if
+   * there are none.
+   */
+  Clock::duration getMaxDuration() const;
+
+ private:
+  static constexpr size_t kSlotCount = 1024;
+  // A slot holds the start time of its request, or kEmptySlot.
+  static constexpr Clock::rep kEmptySlot = 0;
+
+  std::array<std::atomic<Clock::rep>, kSlotCount> slots_;
+  folly::Synchronized<std::list<Clock::time_point>> overflow_;
+};
+
 /**
  * Represents a request tracked in a RequestMetricsScope::RequestWatchList.
  * To track a request a RequestMetricsScope object should be in scope for the
@@ -28,12 +77,9 @@ namespace eden {
  */
 class RequestMetricsScope {
  public:
-  using RequestWatchList = std::list<folly::stop_watch<>>;
-  using LockedRequestWatchList = folly::Synchronized<RequestWatchList>;
-  using DefaultRequestDuration =
-      std::chrono::steady_clock::steady_clock::duration;
+  using DefaultRequestDuration = RequestWatchList::Clock::duration;
 
-  RequestMetricsScope(LockedRequestWatchList* pendingRequestWatches);
+  RequestMetricsScope(RequestWatchList* pendingRequestWatches);
   RequestMetricsScope();
   RequestMetricsScope(RequestMetricsScope&&) noexcept;
   RequestMetricsScope& operator=(RequestMetricsScope&&);
@@ -95,18 +141,18 @@ class RequestMetricsScope {
    */
   static size_t getMetricFromWatches(
       RequestMetric metric,
-      const LockedRequestWatchList& watches);
+      const RequestWatchList& watches);
 
   /**
    * finds the watch in `watches` for which the time that has elapsed
    * is the greatest and returns the duration of time that has elapsed
    */
   static DefaultRequestDuration getMaxDuration(
-      const LockedRequestWatchList& watches);
+      const RequestWatchList& watches);
 
  private:
-  LockedRequestWatchList* pendingRequestWatches_;
-  RequestWatchList::iterator requestWatch_;
+  RequestWatchList* pendingRequestWatches_;
+  RequestWatchList::Handle requestWatch_;
 }; // namespace eden
 } // namespace eden
 } // namespace facebook
@@ -9,6 +9,7 @@
 
 #include <folly/Range.h>
 #include <string>
+#include <vector>
 
 namespace facebook {
 namespace eden {
@@ -30,6 +31,16 @@ class ScribeLogger {
   virtual void log(std::string message) {
     return log(folly::StringPiece{message});
   }
+
+  /**
+   * Logs several messages.  Subclasses can override this to hand them off
+   * together.
+   */
+  virtual void logBatch(std::vector<std::string> messages) {
+    for (auto& message : messages) {
+      log(std::move(message));
+    }
+  }
 };
 
 } // namespace eden
@@ -7,8 +7,13 @@
 
 #include "eden/fs/telemetry/ScubaStructuredLogger.h"
 
+#include <fb303/ServiceData.h>
+#include <folly/ExceptionString.h>
 #include <folly/json.h>
 #include <folly/logging/xlog.h>
+#include <folly/system/ThreadName.h>
+#include <algorithm>
+#include <vector>
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/telemetry/SubprocessScribeLogger.h"
 
@@ -17,6 +22,11 @@ namespace eden {
 
 namespace {
 
+/**
+ * The most events serialized and passed to the ScribeLogger at once.
+ */
+constexpr size_t kMaxBatchSize = 64;
+
 template <typename Key, typename Value>
 folly::dynamic dynamicMap(const std::unordered_map<Key, Value>& map) {
   folly::dynamic o = folly::dynamic::object;
@@ -26,15 +36,12 @@ folly::dynamic dynamicMap(const std::unordered_map<Key, Value>& map) {
   return o;
 }
 
-} // namespace
-
-ScubaStructuredLogger::ScubaStructuredLogger(
-    std::shared_ptr<ScribeLogger> scribeLogger,
-    SessionInfo sessionInfo)
-    : StructuredLogger{true, std::move(sessionInfo)},
-      scribeLogger_{std::move(scribeLogger)} {}
+bool isStopEvent(const DynamicEvent& event) {
+  return event.getIntMap().empty() && event.getStringMap().empty() &&
+      event.getDoubleMap().empty();
+}
 
-void ScubaStructuredLogger::logDynamicEvent(DynamicEvent event) {
+std::string serializeEvent(const DynamicEvent& event) {
   folly::dynamic document = folly::dynamic::object;
 
   const auto& intMap = event.getIntMap();
@@ -52,7 +59,95 @@ void ScubaStructuredLogger::logDynamicEvent(DynamicEvent event) {
     document["double"] = dynamicMap(doubleMap);
   }
 
-  scribeLogger_->log(folly::toJson(document));
+  return folly::toJson(document);
+}
+
+} // namespace
+
+ScubaStructuredLogger::ScubaStructuredLogger(
+    std::shared_ptr<ScribeLogger> scribeLogger,
+    SessionInfo sessionInfo,
+    SampleRates sampleRates,
+    size_t queueCapacity)
+    : StructuredLogger{true, std::move(sessionInfo), std::move(sampleRates)},
+      scribeLogger_{std::move(scribeLogger)},
+      queue_{std::max<size_t>(queueCapacity, 1)} {
+  writerThread_ = std::thread([this] {
+    folly::setThreadName("StructuredLogger");
+    writerThread();
+  });
+}
+
+ScubaStructuredLogger::~ScubaStructuredLogger() {
+  queue_.blockingWrite(DynamicEvent{});
+  writerThread_.join();
+}
+
+void ScubaStructuredLogger::flush() {
+  auto target = queuedEvents_.load();
+  std::unique_lock<std::mutex> lock{writtenMutex_};
+  eventsWritten_.wait(lock, [&] {
+    return writtenEvents_ + droppedEvents_.load() >= target;
+  });
+}
+
+void ScubaStructuredLogger::logDynamicEvent(DynamicEvent event) {
+  // Counted before it is queued so that flush() never misses it.
+  queuedEvents_.fetch_add(1);
+  if (!queue_.write(std::move(event))) {
+    XLOG_EVERY_MS(DBG7, 10000)
+        << "StructuredLogger queue full, dropping event";
+    fb303::fbData->incrementCounter("telemetry.dropped_events");
+    {
+      std::lock_guard<std::mutex> lock{writtenMutex_};
+      droppedEvents_.fetch_add(1);
+    }
+    eventsWritten_.notify_all();
+  }
+}
+
+void ScubaStructuredLogger::writerThread() {
+  std::vector<std::string> batch;
+  for (;;) {
+    DynamicEvent event;
+    queue_.blockingRead(event);
+
+    bool stop = false;
+    size_t eventCount = 0;
+    do {
+      if (isStopEvent(event)) {
+        stop = true;
+        break;
+      }
+      ++eventCount;
+      try {
+        batch.push_back(serializeEvent(event));
+      } catch (const std::exception& ex) {
+        XLOG(ERR) << "error serializing structured log event: "
+                  << folly::exceptionStr(ex);
+      }
+    } while (eventCount < kMaxBatchSize && queue_.read(event));
+
+    if (!batch.empty()) {
+      try {
+        scribeLogger_->logBatch(std::move(batch));
+      } catch (const std::exception& ex) {
+        XLOG(ERR) << "error writing structured log events: "
+                  << folly::exceptionStr(ex);
+      }
+      batch.clear();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{writtenMutex_};
+      writtenEvents_ += eventCount;
+    }
+    eventsWritten_.notify_all();
+
+    if (stop) {
+      return;
+    }
+  }
 }
 
 } // namespace eden
@@ -7,7 +7,12 @@
 
 #pragma once
 
+#include <folly/MPMCQueue.h>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include "eden/fs/telemetry/StructuredLogger.h"
 
 namespace facebook {
@@ -16,16 +21,63 @@ namespace eden {
 class EdenConfig;
 class ScribeLogger;
 
+/**
+ * Serializes events to JSON and forwards them to a ScribeLogger.
+ *
+ * Logging an event only moves it into a bounded lock-free queue.  A
+ * background thread serializes the queued events and hands them to the
+ * ScribeLogger in batches, so the cost of formatting is not paid by the
+ * thread that logged the event.  Events logged while the queue is full are
+ * dropped and counted.
+ */
 class ScubaStructuredLogger final : public StructuredLogger {
  public:
+  static constexpr size_t kDefaultQueueCapacity = 4096;
+
   ScubaStructuredLogger(
       std::shared_ptr<ScribeLogger> scribeLogger,
-      SessionInfo sessionInfo);
+      SessionInfo sessionInfo,
+      SampleRates sampleRates = {},
+      size_t queueCapacity = kDefaultQueueCapacity);
+
+  /**
+   * Writes the events that are still queued and stops the background thread.
+   */
+  ~ScubaStructuredLogger() override;
+
+  /**
+   * Blocks until every event logged before the call has been passed to the
+   * ScribeLogger.
+   */
+  void flush();
+
+  /**
+   * The number of events dropped because the queue was full.
+   */
+  uint64_t getDroppedEventCount() const {
+    return droppedEvents_.load(std::memory_order_relaxed);
+  }
 
  private:
   void logDynamicEvent(DynamicEvent event) override;
+  void writerThread();
 
   std::shared_ptr<ScribeLogger> scribeLogger_;
+
+  /**
+   * Many threads log, but only writerThread_ reads.  An empty event tells
+   * the writer to stop.
+   */
+  folly::MPMCQueue<DynamicEvent> queue_;
+  std::atomic<uint64_t> queuedEvents_{0};
+  std::atomic<uint64_t> droppedEvents_{0};
+
+  std::mutex writtenMutex_;
+  std::condition_variable eventsWritten_;
+  /** Protected by writtenMutex_. */
+  uint64_t writtenEvents_{0};
+
+  std::thread writerThread_;
 };
 
 } // namespace eden
@@ -7,6 +7,10 @@
 
 #include "eden/fs/telemetry/StructuredLogger.h"
 
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
 #include <time.h>
 #include <random>
 
@@ -35,10 +39,25 @@ uint32_t getSessionId() {
 namespace facebook {
 namespace eden {
 
-StructuredLogger::StructuredLogger(bool enabled, SessionInfo sessionInfo)
+StructuredLogger::StructuredLogger(
+    bool enabled,
+    SessionInfo sessionInfo,
+    SampleRates sampleRates)
     : enabled_{enabled},
       sessionId_{getSessionId()},
-      sessionInfo_{std::move(sessionInfo)} {}
+      sessionInfo_{std::move(sessionInfo)},
+      sampleRates_{std::move(sampleRates)} {}
+
+uint32_t StructuredLogger::sampleEvent(const char* type) const {
+  if (sampleRates_.empty()) {
+    return 1;
+  }
+  auto it = sampleRates_.find(folly::StringPiece{type});
+  if (it == sampleRates_.end() || it->second <= 1) {
+    return 1;
+  }
+  return folly::Random::oneIn(it->second) ? it->second : 0;
+}
 
 DynamicEvent StructuredLogger::populateDefaultFields(const char* type) {
   DynamicEvent event;
@@ -55,5 +74,27 @@ DynamicEvent StructuredLogger::populateDefaultFields(const char* type) {
   return event;
 }
 
+StructuredLogger::SampleRates parseSampleRates(folly::StringPiece rates) {
+  StructuredLogger::SampleRates result;
+  std::vector<folly::StringPiece> pairs;
+  folly::split(',', rates, pairs, true);
+  for (auto pair : pairs) {
+    folly::StringPiece type;
+    folly::StringPiece rate;
+    if (!folly::split('=', pair, type, rate)) {
+      XLOG(WARN) << "ignoring malformed event sample rate: " << pair;
+      continue;
+    }
+    type = folly::trimWhitespace(type);
+    auto value = folly::tryTo<uint32_t>(folly::trimWhitespace(rate));
+    if (type.empty() || !value.hasValue() || value.value() == 0) {
+      XLOG(WARN) << "ignoring malformed event sample rate: " << pair;
+      continue;
+    }
+    result[type.str()] = value.value();
+  }
+  return result;
+}
+
 } // namespace eden
 } // namespace facebook
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <folly/Range.h>
+#include <folly/container/F14Map.h>
 #include <unordered_map>
 #include "eden/fs/telemetry/LogEvent.h"
 #include "eden/fs/telemetry/SessionInfo.h"
@@ -16,7 +18,16 @@ namespace eden {
 
 class StructuredLogger {
  public:
-  explicit StructuredLogger(bool enabled, SessionInfo sessionInfo);
+  /**
+   * Maps an event type to N, where one in every N events of that type is
+   * logged.  Types that are not listed are always logged.
+   */
+  using SampleRates = folly::F14FastMap<std::string, uint32_t>;
+
+  explicit StructuredLogger(
+      bool enabled,
+      SessionInfo sessionInfo,
+      SampleRates sampleRates = {});
   virtual ~StructuredLogger() = default;
 
   template <typename Event>
@@ -31,9 +42,15 @@ class StructuredLogger {
     // too.
     constexpr const char* type = Event::type;
 
-    // TODO: consider moving the event to another thread and populating the
-    // default fields there to reduce latency at the call site.
+    auto sampleRate = sampleEvent(type);
+    if (sampleRate == 0) {
+      return;
+    }
+
     DynamicEvent de{populateDefaultFields(type)};
+    if (sampleRate > 1) {
+      de.addInt("sample_rate", sampleRate);
+    }
     event.populate(de);
     logDynamicEvent(std::move(de));
   }
@@ -43,10 +60,24 @@ class StructuredLogger {
 
   DynamicEvent populateDefaultFields(const char* type);
 
+  /**
+   * Returns 0 if this event of the given type should be skipped, and
+   * otherwise the number of events it stands for.
+   */
+  uint32_t sampleEvent(const char* type) const;
+
   bool enabled_;
   uint32_t sessionId_;
   SessionInfo sessionInfo_;
+  SampleRates sampleRates_;
 };
 
+/**
+ * Parses sample rates written as comma-separated `type=N` pairs, such as
+ * "server_data_fetch=100,fetch_heavy=10".  Malformed pairs are logged and
+ * ignored.
+ */
+StructuredLogger::SampleRates parseSampleRates(folly::StringPiece rates);
+
 } // namespace eden
 } // namespace facebook
@@ -38,7 +38,9 @@ std::unique_ptr<StructuredLogger> makeDefaultStructuredLogger(
   auto logger =
       std::make_unique<SubprocessScribeLogger>(binary.c_str(), category);
   return std::make_unique<ScubaStructuredLogger>(
-      std::move(logger), std::move(sessionInfo));
+      std::move(logger),
+      std::move(sessionInfo),
+      parseSampleRates(config.eventSampleRates.getValue()));
 #else
   return std::make_unique<NullStructuredLogger>();
 #endif
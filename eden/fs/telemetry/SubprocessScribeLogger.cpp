@@ -7,6 +7,7 @@
 
 #include "eden/fs/telemetry/SubprocessScribeLogger.h"
 
+#include <folly/FileUtil.h>
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
 
@@ -19,6 +20,12 @@ namespace {
  */
 constexpr size_t kQueueLimitBytes = 128 * 1024;
 
+/**
+ * The most messages written with one writev(), two iovecs apiece, well under
+ * IOV_MAX.
+ */
+constexpr size_t kMaxWriteBatch = 64;
+
 constexpr std::chrono::seconds kFlushTimeout{1};
 constexpr std::chrono::seconds kProcessExitTimeout{1};
 constexpr std::chrono::seconds kProcessTerminateTimeout{1};
@@ -106,11 +113,39 @@ void SubprocessScribeLogger::log(std::string message) {
   newMessageOrStop_.notify_one();
 }
 
+void SubprocessScribeLogger::logBatch(std::vector<std::string> messages) {
+  {
+    auto state = state_.lock();
+    CHECK(!state->shouldStop) << "log() called during destruction - that's UB";
+    if (state->didStop) {
+      return;
+    }
+    for (auto& message : messages) {
+      size_t messageSize = message.size();
+      if (state->totalBytes + messageSize > kQueueLimitBytes) {
+        XLOG_EVERY_MS(DBG7, 10000)
+            << "ScribeLogger queue full, dropping message";
+        continue;
+      }
+      state->messages.emplace_back(std::move(message));
+      state->totalBytes += messageSize;
+    }
+  }
+  newMessageOrStop_.notify_one();
+}
+
 void SubprocessScribeLogger::writerThread() {
   int fd = process_.stdinFd();
 
+  // Reserved up front so that filling them under the lock cannot throw.
+  std::vector<std::string> batch;
+  batch.reserve(kMaxWriteBatch);
+  std::vector<iovec> iov;
+  iov.reserve(2 * kMaxWriteBatch);
+  char newline = '\n';
+
   for (;;) {
-    std::string message;
+    batch.clear();
 
     {
       auto state = state_.lock();
@@ -118,13 +153,14 @@ void SubprocessScribeLogger::writerThread() {
         return state->shouldStop || !state->messages.empty();
       });
       if (!state->messages.empty()) {
-        CHECK_LE(state->messages.front().size(), state->totalBytes)
-            << "totalSize accounting fell out of sync!";
-
         // The below statements are all noexcept.
-        std::swap(message, state->messages.front());
-        state->messages.pop_front();
-        state->totalBytes -= message.size();
+        while (!state->messages.empty() && batch.size() < kMaxWriteBatch) {
+          CHECK_LE(state->messages.front().size(), state->totalBytes)
+              << "totalSize accounting fell out of sync!";
+          batch.push_back(std::move(state->messages.front()));
+          state->messages.pop_front();
+          state->totalBytes -= batch.back().size();
+        }
       } else {
         // If the predicate succeeded but we have no messages, then we're
         // shutting down cleanly.
@@ -138,13 +174,12 @@ void SubprocessScribeLogger::writerThread() {
       }
     }
 
-    char newline = '\n';
-    std::array<iovec, 2> iov;
-    iov[0].iov_base = message.data();
-    iov[0].iov_len = message.size();
-    iov[1].iov_base = &newline;
-    iov[1].iov_len = sizeof(newline);
-    if (-1 == folly::writevNoInt(fd, iov.data(), iov.size())) {
+    iov.clear();
+    for (auto& message : batch) {
+      iov.push_back({message.data(), message.size()});
+      iov.push_back({&newline, sizeof(newline)});
+    }
+    if (-1 == folly::writevFull(fd, iov.data(), iov.size())) {
       // TODO: We could attempt to restart the process here.
       XLOG(ERR) << "Failed to writev to logger process stdin: "
                 << folly::errnoStr(errno) << ". Giving up!";
@@ -51,6 +51,12 @@ class SubprocessScribeLogger : public ScribeLogger {
   void log(std::string message) override;
   using ScribeLogger::log;
 
+  /**
+   * Queues the messages under a single lock and writes them with as few
+   * system calls as possible.
+   */
+  void logBatch(std::vector<std::string> messages) override;
+
  private:
   void closeProcess();
   void writerThread();
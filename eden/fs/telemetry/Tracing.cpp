@@ -7,11 +7,23 @@
 
 #include "Tracing.h"
 
+#include <folly/container/F14Map.h>
+#include <folly/dynamic.h>
+#include <folly/json.h>
+#include <algorithm>
+#include <iterator>
+
 namespace facebook {
 namespace eden {
 namespace detail {
 Tracer globalTracer;
 
+namespace {
+bool timestampLess(const CompactTracePoint& a, const CompactTracePoint& b) {
+  return a.timestamp < b.timestamp;
+}
+} // namespace
+
 void ThreadLocalTracePoints::flush() {
   auto points = globalTracer.tracepoints_.wlock();
   auto state = state_.lock();
@@ -21,6 +33,24 @@ void ThreadLocalTracePoints::flush() {
       state->tracePoints_.begin(),
       state->tracePoints_.begin() + npoints);
   state->currNum_ = 0;
+  if (points->size() > Tracer::kMaxRetainedPoints) {
+    std::sort(points->begin(), points->end(), timestampLess);
+    points->erase(points->begin(), points->end() - Tracer::kMaxRetainedPoints);
+  }
+}
+
+void ThreadLocalTracePoints::copyRecent(
+    std::vector<CompactTracePoint>& out,
+    std::chrono::nanoseconds since) {
+  auto state = state_.lock();
+  size_t npoints = std::min(kBufferPoints, state->currNum_);
+  std::copy_if(
+      state->tracePoints_.begin(),
+      state->tracePoints_.begin() + npoints,
+      std::back_inserter(out),
+      [since](const CompactTracePoint& point) {
+        return point.timestamp >= since;
+      });
 }
 
 folly::RequestToken tracingToken("eden_tracing");
@@ -30,11 +60,68 @@ std::vector<CompactTracePoint> Tracer::getAllTracepoints() {
     tltp.flush();
   }
   auto points = tracepoints_.wlock();
-  std::sort(points->begin(), points->end(), [](const auto& a, const auto& b) {
-    return a.timestamp < b.timestamp;
-  });
+  std::sort(points->begin(), points->end(), timestampLess);
   return std::move(*points);
 }
+
+std::vector<CompactTracePoint> Tracer::getRecentTracepoints(
+    std::chrono::nanoseconds window) {
+  auto now = std::chrono::nanoseconds(
+      folly::chrono::clock_gettime_ns(CLOCK_MONOTONIC));
+  auto since = now - window;
+  std::vector<CompactTracePoint> result;
+  {
+    auto points = tracepoints_.rlock();
+    std::copy_if(
+        points->begin(),
+        points->end(),
+        std::back_inserter(result),
+        [since](const CompactTracePoint& point) {
+          return point.timestamp >= since;
+        });
+  }
+  for (auto& tltp : tltp_.accessAllThreads()) {
+    tltp.copyRecent(result, since);
+  }
+  std::sort(result.begin(), result.end(), timestampLess);
+  return result;
+}
 } // namespace detail
+
+std::string formatChromeTrace(const std::vector<CompactTracePoint>& points) {
+  folly::F14FastMap<uint64_t, const CompactTracePoint*> starts;
+  auto events = folly::dynamic::array();
+  for (const auto& point : points) {
+    if (point.start) {
+      starts.emplace(point.blockId, &point);
+      continue;
+    }
+    if (!point.stop) {
+      continue;
+    }
+    auto it = starts.find(point.blockId);
+    if (it == starts.end()) {
+      continue;
+    }
+    const auto& start = *it->second;
+    // Chrome traces are in microseconds.
+    auto startUs = start.timestamp.count() / 1000.0;
+    auto durationUs = (point.timestamp - start.timestamp).count() / 1000.0;
+    folly::dynamic event = folly::dynamic::object;
+    event["name"] = start.name;
+    event["cat"] = "eden";
+    event["ph"] = "X";
+    event["ts"] = startUs;
+    event["dur"] = durationUs;
+    event["pid"] = 0;
+    // Each trace gets its own row, so the stages of a request line up.
+    event["tid"] = start.traceId;
+    event["args"] = folly::dynamic::object("blockId", start.blockId)(
+        "parentBlockId", start.parentBlockId);
+    events.push_back(std::move(event));
+    starts.erase(it);
+  }
+  return folly::toJson(folly::dynamic::object("traceEvents", events));
+}
 } // namespace eden
 } // namespace facebook
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include <folly/ClockGettimeWrappers.h>
 #include <folly/Singleton.h>
@@ -50,8 +52,11 @@ static_assert(sizeof(CompactTracePoint) <= 64);
 namespace detail {
 class ThreadLocalTracePoints {
   // CompactTracePoints are currently 48 bytes each, so this is 768 KB
-  // per thread
+  // per thread. Once full, the oldest points are overwritten.
   static constexpr size_t kBufferPoints = 16 * 1024;
+  static_assert(
+      (kBufferPoints & (kBufferPoints - 1)) == 0,
+      "a power of two keeps the ring index cheap");
 
  public:
   ThreadLocalTracePoints() = default;
@@ -61,6 +66,14 @@ class ThreadLocalTracePoints {
 
   void flush();
 
+  /**
+   * Appends the points recorded at or after since to out, leaving them in
+   * the buffer.
+   */
+  void copyRecent(
+      std::vector<CompactTracePoint>& out,
+      std::chrono::nanoseconds since);
+
   FOLLY_ALWAYS_INLINE void trace(
       uint64_t traceId,
       uint64_t blockId,
@@ -122,6 +135,9 @@ class Tracer {
 
   std::vector<CompactTracePoint> getAllTracepoints();
 
+  std::vector<CompactTracePoint> getRecentTracepoints(
+      std::chrono::nanoseconds window);
+
   bool isEnabled() noexcept {
     return enabled_->load(std::memory_order_acquire);
   }
@@ -143,8 +159,9 @@ class Tracer {
       tltp_;
   // This is written to only when a thread dies and when
   // getAllTracepoints is invoked, though the latter will leave it
-  // empty. As long as threads aren't continuously being created and
-  // destroyed while tracing is on, this shouldn't grow large
+  // empty. The points of dead threads are capped at kMaxRetainedPoints,
+  // dropping the oldest, so that tracing can be left on indefinitely.
+  static constexpr size_t kMaxRetainedPoints = 64 * 1024;
   folly::Synchronized<std::vector<CompactTracePoint>> tracepoints_;
 };
 
@@ -174,6 +191,25 @@ inline std::vector<CompactTracePoint> getAllTracepoints() {
   return detail::globalTracer.getAllTracepoints();
 }
 
+/*
+ * Returns, in timestamp order, the tracepoints recorded across all threads
+ * within the last window, without consuming them. Each thread keeps only its
+ * most recent points, so with tracing left on this shows what eden was doing
+ * just before a latency incident.
+ */
+inline std::vector<CompactTracePoint> getRecentTracepoints(
+    std::chrono::nanoseconds window) {
+  return detail::globalTracer.getRecentTracepoints(window);
+}
+
+/*
+ * Formats tracepoints, as returned by getAllTracepoints(), as a JSON trace
+ * that chrome://tracing and Perfetto can load. Each block becomes one complete
+ * event, and the blocks of each trace are grouped on their own row. Blocks
+ * that were not both started and stopped within the points are left out.
+ */
+std::string formatChromeTrace(const std::vector<CompactTracePoint>& points);
+
 /*
  * TraceBlocks demark sections of eden's execution so we can analyze
  * the behavior of a request in a fine-grained fashion.
@@ -191,6 +227,12 @@ inline std::vector<CompactTracePoint> getAllTracepoints() {
  * Creating the first TraceBlock of a * request (FUSE, thrift, or
  * otherwise) will allocate a traceId which will be used to
  * associate all the future TraceBlocks of the request.
+ *
+ * Blocks that end on another thread or outlive the blocks created
+ * after them, such as the stages of an asynchronous object fetch,
+ * should be created with detached() or sibling() instead. These are
+ * recorded in the request's trace but never become its current
+ * block, so they may be closed from anywhere.
  */
 class TraceBlock {
  public:
@@ -215,21 +257,52 @@ class TraceBlock {
           name,
           /* start = */ true,
           /* stop = */ false);
+      traceId_ = reqData.traceId;
       reqData.blockId = blockId_;
     }
   }
 
+  /**
+   * Starts a block that is a child of the request's current block, but
+   * that does not become the current block itself.
+   */
+  template <size_t size>
+  static TraceBlock detached(const char (&name)[size]) {
+    if (!detail::globalTracer.isEnabled()) {
+      return TraceBlock{nullptr, 0, 0};
+    }
+    auto& reqData = detail::Tracer::getRequestData();
+    if (!reqData.traceId) {
+      reqData.traceId = generateUniqueID();
+    }
+    return TraceBlock{name, reqData.traceId, reqData.blockId};
+  }
+
+  /**
+   * Starts a detached block with the same trace and parent as this one. This
+   * block may already be closed, which lets a later stage of an operation be
+   * recorded from a thread that knows nothing of the original request.
+   */
+  template <size_t size>
+  TraceBlock sibling(const char (&name)[size]) const {
+    return TraceBlock{name, traceId_, parentBlockId_};
+  }
+
   TraceBlock(const TraceBlock&) = delete;
   TraceBlock& operator=(const TraceBlock&) = delete;
   TraceBlock(TraceBlock&& other) noexcept {
+    traceId_ = other.traceId_;
     blockId_ = other.blockId_;
     parentBlockId_ = other.parentBlockId_;
+    detached_ = other.detached_;
     other.blockId_ = 0;
   }
   TraceBlock& operator=(TraceBlock&& other) {
     close();
+    traceId_ = other.traceId_;
     blockId_ = other.blockId_;
     parentBlockId_ = other.parentBlockId_;
+    detached_ = other.detached_;
     other.blockId_ = 0;
     return *this;
   }
@@ -243,22 +316,39 @@ class TraceBlock {
    */
   void close() {
     if (blockId_) {
-      auto& reqData = detail::Tracer::getRequestData();
       detail::globalTracer.getThreadLocalTracePoints().trace(
-          reqData.traceId,
+          traceId_,
           blockId_,
           parentBlockId_,
           nullptr,
           /* start = */ false,
           /* stop = */ true);
-      reqData.blockId = parentBlockId_;
+      if (!detached_) {
+        detail::Tracer::getRequestData().blockId = parentBlockId_;
+      }
       blockId_ = 0;
     }
   }
 
  private:
+  TraceBlock(const char* name, uint64_t traceId, uint64_t parentBlockId)
+      : traceId_{traceId}, parentBlockId_{parentBlockId}, detached_{true} {
+    if (traceId_ && detail::globalTracer.isEnabled()) {
+      blockId_ = generateUniqueID();
+      detail::globalTracer.getThreadLocalTracePoints().trace(
+          traceId_,
+          blockId_,
+          parentBlockId_,
+          name,
+          /* start = */ true,
+          /* stop = */ false);
+    }
+  }
+
+  uint64_t traceId_{0};
   uint64_t blockId_{0};
   uint64_t parentBlockId_{0};
+  bool detached_{false};
 };
 
 } // namespace eden
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/EdenStats.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+TEST(EdenStats, stats_are_aggregated_only_while_active) {
+  JournalThreadStats stats;
+  stats.truncatedReads.addValue(1);
+
+  // Stats that were never marked active are skipped.
+  stats.aggregateIfActive();
+  EXPECT_EQ(1, stats.truncatedReads.sum());
+
+  stats.markActive();
+  stats.aggregateIfActive();
+  EXPECT_EQ(0, stats.truncatedReads.sum());
+
+  // An update that lands just after the first aggregation is still picked up
+  // by the next one.
+  stats.truncatedReads.addValue(2);
+  stats.aggregateIfActive();
+  EXPECT_EQ(0, stats.truncatedReads.sum());
+
+  stats.truncatedReads.addValue(3);
+  stats.aggregateIfActive();
+  EXPECT_EQ(3, stats.truncatedReads.sum());
+}
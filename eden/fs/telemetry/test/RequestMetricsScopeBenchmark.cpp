@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <benchmark/benchmark.h>
+#include "eden/fs/telemetry/RequestMetricsScope.h"
+
+using namespace facebook::eden;
+
+namespace {
+RequestWatchList watches;
+}
+
+static void RequestMetricsScope_create_and_destroy(benchmark::State& state) {
+  for (auto _ : state) {
+    RequestMetricsScope scope{&watches};
+  }
+}
+BENCHMARK(RequestMetricsScope_create_and_destroy)->Threads(1)->Threads(8);
+
+static void RequestMetricsScope_create_and_destroy_while_aggregating(
+    benchmark::State& state) {
+  // One thread computes the metrics while the others track requests, as the
+  // periodic stats update does.
+  for (auto _ : state) {
+    if (state.thread_index == 0) {
+      benchmark::DoNotOptimize(RequestMetricsScope::getMetricFromWatches(
+          RequestMetricsScope::MAX_DURATION_US, watches));
+    } else {
+      RequestMetricsScope scope{&watches};
+    }
+  }
+}
+BENCHMARK(RequestMetricsScope_create_and_destroy_while_aggregating)
+    ->Threads(8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/RequestMetricsScope.h"
+
+#include <folly/portability/GTest.h>
+#include <optional>
+#include <vector>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+TEST(RequestMetricsScopeTest, scopesAreCountedWhileAlive) {
+  RequestWatchList watches;
+  EXPECT_EQ(0, watches.size());
+  {
+    RequestMetricsScope first{&watches};
+    RequestMetricsScope second{&watches};
+    EXPECT_EQ(2, watches.size());
+  }
+  EXPECT_EQ(0, watches.size());
+  EXPECT_EQ(
+      0,
+      RequestMetricsScope::getMetricFromWatches(
+          RequestMetricsScope::MAX_DURATION_US, watches));
+}
+
+TEST(RequestMetricsScopeTest, maxDurationIsTheOldestRequest) {
+  RequestWatchList watches;
+  auto now = RequestWatchList::Clock::now();
+  auto oldest = watches.insert(now - 10s);
+  auto newest = watches.insert(now - 1s);
+  EXPECT_GE(watches.getMaxDuration(), 10s);
+
+  watches.remove(oldest);
+  EXPECT_GE(watches.getMaxDuration(), 1s);
+  EXPECT_LT(watches.getMaxDuration(), 10s);
+  watches.remove(newest);
+  EXPECT_EQ(RequestWatchList::Clock::duration{0}, watches.getMaxDuration());
+}
+
+TEST(RequestMetricsScopeTest, requestsBeyondTheSlotsOverflow) {
+  RequestWatchList watches;
+  std::vector<RequestMetricsScope> scopes;
+  for (size_t i = 0; i < 3000; ++i) {
+    scopes.emplace_back(&watches);
+  }
+  EXPECT_EQ(3000, watches.size());
+  scopes.resize(1000);
+  EXPECT_EQ(1000, watches.size());
+  scopes.clear();
+  EXPECT_EQ(0, watches.size());
+}
+
+TEST(RequestMetricsScopeTest, movedScopesAreCountedOnce) {
+  RequestWatchList watches;
+  std::optional<RequestMetricsScope> scope{std::in_place, &watches};
+  RequestMetricsScope moved{std::move(*scope)};
+  scope.reset();
+  EXPECT_EQ(1, watches.size());
+
+  RequestMetricsScope assigned{&watches};
+  EXPECT_EQ(2, watches.size());
+  assigned = std::move(moved);
+  EXPECT_EQ(1, watches.size());
+}
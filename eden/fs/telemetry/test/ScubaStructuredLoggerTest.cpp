@@ -7,6 +7,7 @@
 
 #include "eden/fs/telemetry/ScubaStructuredLogger.h"
 #include <folly/json.h>
+#include <folly/synchronization/Baton.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "eden/fs/telemetry/ScribeLogger.h"
@@ -36,6 +37,29 @@ struct TestLogEvent {
   }
 };
 
+/**
+ * Blocks the writer thread in its first batch until release is posted.
+ */
+struct BlockingScribeLogger : public ScribeLogger {
+  folly::Baton<> entered;
+  folly::Baton<> release;
+  bool blocked = false;
+  std::vector<std::string> lines;
+
+  void log(std::string line) override {
+    lines.emplace_back(std::move(line));
+  }
+
+  void logBatch(std::vector<std::string> messages) override {
+    if (!blocked) {
+      blocked = true;
+      entered.post();
+      release.wait();
+    }
+    ScribeLogger::logBatch(std::move(messages));
+  }
+};
+
 struct ScubaStructuredLoggerTest : public ::testing::Test {
   std::shared_ptr<TestScribeLogger> scribe{
       std::make_shared<TestScribeLogger>()};
@@ -46,6 +70,7 @@ struct ScubaStructuredLoggerTest : public ::testing::Test {
 
 TEST_F(ScubaStructuredLoggerTest, json_is_written_in_one_line) {
   logger.logEvent(TestLogEvent{"name", 10});
+  logger.flush();
   EXPECT_EQ(1, scribe->lines.size());
   const auto& line = scribe->lines[0];
   auto index = line.find('\n');
@@ -62,6 +87,7 @@ std::vector<std::string> keysOf(const folly::dynamic& d) {
 
 TEST_F(ScubaStructuredLoggerTest, json_contains_types_at_top_level_and_values) {
   logger.logEvent(TestLogEvent{"name", 10});
+  logger.flush();
   EXPECT_EQ(1, scribe->lines.size());
   const auto& line = scribe->lines[0];
   auto doc = folly::parseJson(line);
@@ -80,3 +106,55 @@ TEST_F(ScubaStructuredLoggerTest, json_contains_types_at_top_level_and_values) {
       UnorderedElementsAre(
           "str", "user", "host", "type", "os", "osver", "edenver"));
 }
+
+TEST_F(ScubaStructuredLoggerTest, events_are_written_in_order) {
+  for (int i = 0; i < 100; ++i) {
+    logger.logEvent(TestLogEvent{"name", i});
+  }
+  logger.flush();
+  ASSERT_EQ(100, scribe->lines.size());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, folly::parseJson(scribe->lines[i])["int"]["number"].asInt());
+  }
+}
+
+TEST(ScubaStructuredLogger, events_are_dropped_while_the_queue_is_full) {
+  auto scribe = std::make_shared<BlockingScribeLogger>();
+  ScubaStructuredLogger logger{scribe, SessionInfo{}, {}, 2};
+
+  logger.logEvent(TestLogEvent{"name", 1});
+  scribe->entered.wait();
+  logger.logEvent(TestLogEvent{"name", 2});
+  logger.logEvent(TestLogEvent{"name", 3});
+  logger.logEvent(TestLogEvent{"name", 4});
+  EXPECT_EQ(1, logger.getDroppedEventCount());
+
+  scribe->release.post();
+  logger.flush();
+  EXPECT_EQ(3, scribe->lines.size());
+}
+
+TEST(ScubaStructuredLogger, event_types_can_be_sampled) {
+  auto scribe = std::make_shared<TestScribeLogger>();
+  ScubaStructuredLogger logger{
+      scribe, SessionInfo{}, StructuredLogger::SampleRates{{"test_event", 1}}};
+  logger.logEvent(TestLogEvent{"name", 10});
+  logger.flush();
+  ASSERT_EQ(1, scribe->lines.size());
+  // A rate of 1 logs every event and does not record a sample rate.
+  auto ints = folly::parseJson(scribe->lines[0])["int"];
+  EXPECT_EQ(nullptr, ints.get_ptr("sample_rate"));
+}
+
+TEST(StructuredLogger, parses_sample_rates) {
+  auto rates = parseSampleRates("server_data_fetch=100, fetch_heavy = 10");
+  EXPECT_EQ(2, rates.size());
+  EXPECT_EQ(100, rates["server_data_fetch"]);
+  EXPECT_EQ(10, rates["fetch_heavy"]);
+}
+
+TEST(StructuredLogger, ignores_malformed_sample_rates) {
+  auto rates = parseSampleRates("a=1=2,b,c=x,d=0,=5,e=3");
+  EXPECT_EQ(1, rates.size());
+  EXPECT_EQ(3, rates["e"]);
+}
@@ -9,6 +9,8 @@
 
 #include <folly/executors/ThreadedExecutor.h>
 #include <folly/futures/Future.h>
+#include <folly/json.h>
+#include <thread>
 
 #include "eden/fs/telemetry/Tracing.h"
 
@@ -121,6 +123,99 @@ TEST(Tracing, records_traceId_across_futures_no_early_tracepoint) {
   fut.wait();
 }
 
+TEST(Tracing, detached_block_does_not_become_current) {
+  enableTracing();
+  {
+    TraceBlock block{"my_block"};
+    auto detached = TraceBlock::detached("my_detached");
+    TraceBlock child{"my_child"};
+    detached.close();
+  }
+
+  auto points = getAllTracepoints();
+  ensureValidTracePoints(points, 6);
+  auto& blockStart = points[0];
+  auto& detachedStart = points[1];
+  auto& childStart = points[2];
+  EXPECT_STREQ(detachedStart.name, "my_detached");
+  EXPECT_EQ(blockStart.blockId, detachedStart.parentBlockId);
+  EXPECT_EQ(blockStart.blockId, childStart.parentBlockId);
+  EXPECT_TRUE(points[3].stop);
+  EXPECT_EQ(detachedStart.blockId, points[3].blockId);
+}
+
+TEST(Tracing, sibling_is_recorded_in_original_trace_from_other_thread) {
+  enableTracing();
+  TraceBlock block{"my_block"};
+  auto detached = TraceBlock::detached("my_detached");
+  std::thread([&detached] {
+    detached.close();
+    auto sibling = detached.sibling("my_sibling");
+  }).join();
+  block.close();
+
+  auto points = getAllTracepoints();
+  ensureValidTracePoints(points, 6);
+  for (const auto& point : points) {
+    EXPECT_EQ(points[0].traceId, point.traceId);
+  }
+  EXPECT_STREQ(points[3].name, "my_sibling");
+  EXPECT_EQ(points[0].blockId, points[3].parentBlockId);
+}
+
+TEST(Tracing, formats_chrome_trace) {
+  using std::chrono::nanoseconds;
+  std::vector<CompactTracePoint> points{
+      {nanoseconds{1000}, 7, 1, 0, "my_block", 1, 0},
+      {nanoseconds{2000}, 7, 2, 1, "my_unfinished", 1, 0},
+      {nanoseconds{5000}, 7, 1, 0, nullptr, 0, 1},
+      // Its start was not collected
+      {nanoseconds{6000}, 7, 3, 0, nullptr, 0, 1},
+  };
+
+  auto trace = folly::parseJson(formatChromeTrace(points));
+  const auto& events = trace["traceEvents"];
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ("my_block", events[0]["name"].asString());
+  EXPECT_EQ("X", events[0]["ph"].asString());
+  EXPECT_EQ(1.0, events[0]["ts"].asDouble());
+  EXPECT_EQ(4.0, events[0]["dur"].asDouble());
+  EXPECT_EQ(7, events[0]["tid"].asInt());
+  EXPECT_EQ(1, events[0]["args"]["blockId"].asInt());
+}
+
+TEST(Tracing, recent_tracepoints_are_not_consumed) {
+  (void)getAllTracepoints();
+  enableTracing();
+  { TraceBlock block{"my_block"}; }
+
+  auto recent = getRecentTracepoints(std::chrono::seconds{60});
+  ensureValidTracePoints(recent, 2);
+  EXPECT_STREQ(recent[0].name, "my_block");
+
+  ensureValidBlock();
+}
+
+TEST(Tracing, recent_tracepoints_include_exited_threads) {
+  (void)getAllTracepoints();
+  enableTracing();
+  std::thread{[] { TraceBlock block{"my_block"}; }}.join();
+
+  ensureValidTracePoints(getRecentTracepoints(std::chrono::seconds{60}), 2);
+  ensureValidBlock();
+}
+
+TEST(Tracing, recent_tracepoints_leave_out_older_points) {
+  (void)getAllTracepoints();
+  enableTracing();
+  { TraceBlock block{"my_block"}; }
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+
+  EXPECT_EQ(0, getRecentTracepoints(std::chrono::milliseconds{10}).size());
+  ensureValidBlock();
+}
+
 TEST(Tracing, does_not_record_if_disabled) {
   // Zeroes out all pending tracepoints from previous tests.
   (void)getAllTracepoints();
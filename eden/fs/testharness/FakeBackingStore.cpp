@@ -12,12 +12,15 @@
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include <folly/ssl/OpenSSLHash.h>
+#include <algorithm>
+#include <cmath>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/SyntheticRepo.h"
 #include "eden/fs/testharness/TestUtil.h"
 #include "eden/fs/utils/EnumValue.h"
 
@@ -38,6 +41,22 @@ FakeBackingStore::FakeBackingStore(std::shared_ptr<LocalStore> localStore)
 
 FakeBackingStore::~FakeBackingStore() {}
 
+namespace {
+template <typename T>
+SemiFuture<unique_ptr<T>> delayed(
+    unique_ptr<T> object,
+    std::chrono::microseconds latency) {
+  if (latency.count() == 0) {
+    return folly::makeSemiFuture(std::move(object));
+  }
+  return folly::futures::sleep(
+             std::chrono::duration_cast<folly::Duration>(latency))
+      .deferValue([object = std::move(object)](auto&&) mutable {
+        return std::move(object);
+      });
+}
+} // namespace
+
 SemiFuture<unique_ptr<Tree>> FakeBackingStore::getTree(
     const Hash& id,
     ObjectFetchContext& /*context*/) {
@@ -45,6 +64,12 @@ SemiFuture<unique_ptr<Tree>> FakeBackingStore::getTree(
   ++data->accessCounts[id];
   auto it = data->trees.find(id);
   if (it == data->trees.end()) {
+    if (data->syntheticRepo) {
+      if (auto tree = data->syntheticRepo->getTree(id)) {
+        auto delay = computeDelay(*data, tree->getSizeBytes());
+        return delayed(std::move(tree), delay);
+      }
+    }
     // Throw immediately, as opposed to returning a Future that contains an
     // exception.  This lets the test code trigger immediate errors in
     // getTree().
@@ -64,6 +89,12 @@ SemiFuture<unique_ptr<Blob>> FakeBackingStore::getBlob(
   ++data->accessCounts[id];
   auto it = data->blobs.find(id);
   if (it == data->blobs.end()) {
+    if (data->syntheticRepo) {
+      if (auto blob = data->syntheticRepo->getBlob(id)) {
+        auto delay = computeDelay(*data, blob->getSize());
+        return delayed(std::move(blob), delay);
+      }
+    }
     // Throw immediately, for the same reasons mentioned in getTree()
     throw std::domain_error("blob " + id.toString() + " not found");
   }
@@ -71,6 +102,17 @@ SemiFuture<unique_ptr<Blob>> FakeBackingStore::getBlob(
   return it->second->getFuture();
 }
 
+SemiFuture<std::optional<BlobMetadata>> FakeBackingStore::getBlobMetadata(
+    const Hash& id,
+    ObjectFetchContext& /*context*/) {
+  auto data = data_.rlock();
+  auto it = data->blobMetadata.find(id);
+  if (it == data->blobMetadata.end()) {
+    return std::optional<BlobMetadata>{};
+  }
+  return std::make_optional(it->second);
+}
+
 SemiFuture<unique_ptr<Tree>> FakeBackingStore::getTreeForCommit(
     const Hash& commitID) {
   StoredHash* storedTreeHash;
@@ -105,9 +147,15 @@ folly::SemiFuture<std::unique_ptr<Tree>> FakeBackingStore::getTreeForManifest(
             }
 
             // Next look up the tree in our BackingStore data
-            auto data = data_.rlock();
+            auto data = data_.wlock();
             auto treeIter = data->trees.find(manifestID);
             if (treeIter == data->trees.end()) {
+              if (data->syntheticRepo) {
+                if (auto tree = data->syntheticRepo->getTree(manifestID)) {
+                  auto delay = computeDelay(*data, tree->getSizeBytes());
+                  return delayed(std::move(tree), delay).toUnsafeFuture();
+                }
+              }
               return makeFuture<unique_ptr<Tree>>(std::domain_error(
                   "tree " + manifestID.toString() + " for commit " +
                   commitID.toString() + " not found"));
@@ -139,6 +187,12 @@ StoredBlob* FakeBackingStore::putBlob(Hash hash, folly::StringPiece contents) {
   return ret.first;
 }
 
+void FakeBackingStore::putBlobMetadata(
+    const Hash& id,
+    const BlobMetadata& metadata) {
+  data_.wlock()->blobMetadata.insert_or_assign(id, metadata);
+}
+
 std::pair<StoredBlob*, bool> FakeBackingStore::maybePutBlob(
     folly::StringPiece contents) {
   return maybePutBlob(Hash::sha1(contents), contents);
@@ -374,5 +428,50 @@ void FakeBackingStore::discardOutstandingRequests() {
 size_t FakeBackingStore::getAccessCount(const Hash& hash) const {
   return folly::get_default(data_.rlock()->accessCounts, hash, 0);
 }
+
+void FakeBackingStore::setSyntheticRepo(
+    std::shared_ptr<const SyntheticRepo> repo,
+    std::chrono::microseconds latency) {
+  SimulatedLatency simulated;
+  simulated.base = latency;
+  setSyntheticRepo(std::move(repo), simulated);
+}
+
+void FakeBackingStore::setSyntheticRepo(
+    std::shared_ptr<const SyntheticRepo> repo,
+    const SimulatedLatency& latency) {
+  auto data = data_.wlock();
+  data->syntheticRepo = std::move(repo);
+  data->latency = latency;
+  data->jitterEngine.seed(latency.seed);
+  data->linkFreeAt = std::chrono::steady_clock::time_point{};
+}
+
+std::chrono::microseconds FakeBackingStore::computeDelay(
+    Data& data,
+    uint64_t bytes) {
+  using namespace std::chrono;
+  const auto& latency = data.latency;
+  auto delay = duration_cast<steady_clock::duration>(latency.base);
+  if (latency.jitterMedian.count() > 0) {
+    std::lognormal_distribution<double> jitter{
+        std::log(static_cast<double>(latency.jitterMedian.count())),
+        latency.jitterSigma};
+    delay += duration_cast<steady_clock::duration>(
+        duration<double, std::micro>{jitter(data.jitterEngine)});
+  }
+  if (latency.bandwidth > 0) {
+    // The object starts sending once the link is free, after the request
+    // latency, and takes the link for as long as its size needs.
+    auto now = steady_clock::now();
+    auto start = std::max(now + delay, data.linkFreeAt);
+    data.linkFreeAt = start +
+        duration_cast<steady_clock::duration>(duration<double>{
+            static_cast<double>(bytes) /
+            static_cast<double>(latency.bandwidth)});
+    delay = data.linkFreeAt - now;
+  }
+  return duration_cast<microseconds>(delay);
+}
 } // namespace eden
 } // namespace facebook
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <folly/Synchronized.h>
+#include <chrono>
 #include <initializer_list>
 #include <memory>
+#include <random>
 #include <unordered_map>
 #include <vector>
 #include "eden/fs/model/Blob.h"
@@ -24,6 +27,32 @@ namespace eden {
 
 class FakeTreeBuilder;
 class LocalStore;
+class SyntheticRepo;
+
+/**
+ * How long FakeBackingStore takes to serve the objects of a SyntheticRepo,
+ * modelling a remote store reached over a WAN link.
+ */
+struct SimulatedLatency {
+  /** Every fetch takes at least this long. */
+  std::chrono::microseconds base{0};
+  /**
+   * Each fetch additionally waits for a log-normally distributed time with
+   * this median, so that a few fetches are much slower than the rest.  Zero
+   * disables this.
+   */
+  std::chrono::microseconds jitterMedian{0};
+  /** The standard deviation of the logarithm of the jitter. */
+  double jitterSigma{1.0};
+  /**
+   * The bytes per second shared by all fetches.  Objects are sent over the
+   * link one after another, so concurrent fetches queue behind each other.
+   * Zero means unlimited.
+   */
+  uint64_t bandwidth{0};
+  /** Seeds the jitter, so that runs are repeatable. */
+  uint64_t seed{0};
+};
 
 /**
  * A BackingStore implementation for test code.
@@ -45,6 +74,9 @@ class FakeBackingStore : public BackingStore {
   folly::SemiFuture<std::unique_ptr<Blob>> getBlob(
       const Hash& id,
       ObjectFetchContext& context) override;
+  folly::SemiFuture<std::optional<BlobMetadata>> getBlobMetadata(
+      const Hash& id,
+      ObjectFetchContext& context) override;
   folly::SemiFuture<std::unique_ptr<Tree>> getTreeForCommit(
       const Hash& commitID) override;
   folly::SemiFuture<std::unique_ptr<Tree>> getTreeForManifest(
@@ -73,6 +105,13 @@ class FakeBackingStore : public BackingStore {
       Hash hash,
       folly::StringPiece contents);
 
+  /**
+   * Make getBlobMetadata() return metadata for the given blob ID.  Without
+   * this, it returns std::nullopt for every blob, as if this BackingStore
+   * could not fetch metadata without the contents.
+   */
+  void putBlobMetadata(const Hash& id, const BlobMetadata& metadata);
+
   static Blob makeBlob(folly::StringPiece contents);
   static Blob makeBlob(Hash hash, folly::StringPiece contents);
 
@@ -141,14 +180,37 @@ class FakeBackingStore : public BackingStore {
    */
   size_t getAccessCount(const Hash& hash) const;
 
+  /**
+   * Serve the trees and blobs of repo that were not put into this store.
+   *
+   * They are synthesized when fetched, and each fetch completes after
+   * latency has passed, simulating a remote backing store.  Unlike put
+   * objects, they are always ready.
+   */
+  void setSyntheticRepo(
+      std::shared_ptr<const SyntheticRepo> repo,
+      std::chrono::microseconds latency = std::chrono::microseconds{0});
+  void setSyntheticRepo(
+      std::shared_ptr<const SyntheticRepo> repo,
+      const SimulatedLatency& latency);
+
  private:
   struct Data {
     std::unordered_map<Hash, std::unique_ptr<StoredTree>> trees;
     std::unordered_map<Hash, std::unique_ptr<StoredBlob>> blobs;
+    std::unordered_map<Hash, BlobMetadata> blobMetadata;
     std::unordered_map<Hash, std::unique_ptr<StoredHash>> commits;
     std::unordered_map<Hash, size_t> accessCounts;
+    std::shared_ptr<const SyntheticRepo> syntheticRepo;
+    SimulatedLatency latency;
+    std::mt19937_64 jitterEngine;
+    /** When the simulated link finishes sending the objects queued on it. */
+    std::chrono::steady_clock::time_point linkFreeAt;
   };
 
+  /** How long to delay the synthesized object of this size from now. */
+  static std::chrono::microseconds computeDelay(Data& data, uint64_t bytes);
+
   static std::vector<TreeEntry> buildTreeEntries(
       const std::initializer_list<TreeEntryData>& entryArgs);
   static void sortTreeEntries(std::vector<TreeEntry>& entries);
@@ -9,6 +9,10 @@
 
 #include <folly/String.h>
 #include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
+#include <algorithm>
+
+#include "eden/fs/store/BlobChunks.h"
 
 using folly::Future;
 using folly::makeFuture;
@@ -67,6 +71,46 @@ Future<std::shared_ptr<const Blob>> FakeObjectStore::getBlob(
   return makeFuture(make_shared<Blob>(iter->second));
 }
 
+std::vector<Future<shared_ptr<const Tree>>> FakeObjectStore::getTrees(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) const {
+  std::vector<Future<shared_ptr<const Tree>>> results;
+  results.reserve(ids.size());
+  for (const auto& id : ids) {
+    results.push_back(getTree(id, context));
+  }
+  return results;
+}
+
+std::vector<Future<shared_ptr<const Blob>>> FakeObjectStore::getBlobs(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) const {
+  std::vector<Future<shared_ptr<const Blob>>> results;
+  results.reserve(ids.size());
+  for (const auto& id : ids) {
+    results.push_back(getBlob(id, context));
+  }
+  return results;
+}
+
+Future<shared_ptr<const Blob>> FakeObjectStore::getBlobChunk(
+    const Hash& id,
+    uint64_t index,
+    ObjectFetchContext&) const {
+  auto chunkId = blobChunkId(id, index);
+  ++accessCounts_[chunkId];
+  auto iter = blobs_.find(id);
+  if (iter == blobs_.end() ||
+      index * kBlobChunkSize >= iter->second.getSize()) {
+    return makeFuture(shared_ptr<const Blob>{});
+  }
+  folly::io::Cursor cursor(&iter->second.getContents());
+  cursor.skip(index * kBlobChunkSize);
+  folly::IOBuf chunk;
+  cursor.clone(chunk, std::min<uint64_t>(kBlobChunkSize, cursor.totalLength()));
+  return makeFuture(make_shared<Blob>(chunkId, std::move(chunk)));
+}
+
 Future<shared_ptr<const Tree>> FakeObjectStore::getTreeForCommit(
     const Hash& commitID,
     ObjectFetchContext&) const {
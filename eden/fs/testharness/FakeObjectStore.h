@@ -41,6 +41,22 @@ class FakeObjectStore : public IObjectStore {
       const Hash& id,
       ObjectFetchContext& context =
           ObjectFetchContext::getNullContext()) const override;
+  std::vector<folly::Future<std::shared_ptr<const Tree>>> getTrees(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context =
+          ObjectFetchContext::getNullContext()) const override;
+  std::vector<folly::Future<std::shared_ptr<const Blob>>> getBlobs(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context =
+          ObjectFetchContext::getNullContext()) const override;
+  /**
+   * FakeObjectStore serves every blob in chunks of kBlobChunkSize bytes.
+   */
+  folly::Future<std::shared_ptr<const Blob>> getBlobChunk(
+      const Hash& id,
+      uint64_t index,
+      ObjectFetchContext& context =
+          ObjectFetchContext::getNullContext()) const override;
   folly::Future<std::shared_ptr<const Tree>> getTreeForCommit(
       const Hash& commitID,
       ObjectFetchContext& context =
@@ -8,6 +8,9 @@
 #pragma once
 
 #include <gtest/gtest.h>
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/InodeMap.h"
+#include "eden/fs/inodes/InodeUnloadWalk.h"
 #include "eden/fs/inodes/TreeInode.h"
 
 namespace facebook {
@@ -22,6 +25,22 @@ struct ConditionalUnloader {
     return unloadFrom.unloadChildrenLastAccessedBefore(endOfTime);
   }
 };
+
+struct IncrementalUnloader {
+  static size_t unload(TreeInode& unloadFrom) {
+    timespec endOfTime;
+    endOfTime.tv_sec = std::numeric_limits<time_t>::max();
+    endOfTime.tv_nsec = 999999999;
+    // Examine a single inode per step to exercise resuming the walk.
+    InodeUnloadWalk walk{
+        unloadFrom.getMount()->getInodeMap()->lookupLoadedTree(
+            unloadFrom.getNodeId()),
+        endOfTime};
+    while (!walk.step(1)) {
+    }
+    return walk.getUnloadedCount();
+  }
+};
 #endif
 
 struct UnconditionalUnloader {
@@ -32,7 +51,10 @@ struct UnconditionalUnloader {
 
 #ifndef _WIN32
 using InodeUnloaderTypes =
-    ::testing::Types<ConditionalUnloader, UnconditionalUnloader>;
+    ::testing::Types<
+        ConditionalUnloader,
+        IncrementalUnloader,
+        UnconditionalUnloader>;
 #else
 using InodeUnloaderTypes = ::testing::Types<UnconditionalUnloader>;
 #endif
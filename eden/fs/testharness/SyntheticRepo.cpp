@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/testharness/SyntheticRepo.h"
+
+#include <folly/Conv.h>
+#include <folly/hash/Hash.h>
+#include <folly/io/IOBuf.h>
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/model/Tree.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+/*
+ * Synthesized hashes hold:
+ *   bytes 0-2   "syn"
+ *   byte 3      kTreeKind or kBlobKind
+ *   bytes 4-11  the directory number, big-endian
+ *   bytes 12-15 the file's index in its directory, big-endian, for blobs
+ *   bytes 16-19 a hash of the seed, so that repos with different seeds can
+ *               share a LocalStore
+ */
+constexpr uint8_t kTreeKind = 't';
+constexpr uint8_t kBlobKind = 'b';
+
+/** Keeps directory numbers well clear of overflow while computing them. */
+constexpr uint64_t kMaxDirectories = uint64_t{1} << 48;
+
+struct DecodedHash {
+  uint8_t kind;
+  uint64_t dir;
+  uint32_t index;
+  uint32_t seedTag;
+};
+
+void putBigEndian(uint8_t* out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    out[bytes - 1 - i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint64_t getBigEndian(const uint8_t* in, size_t bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    value = (value << 8) | in[i];
+  }
+  return value;
+}
+
+Hash encodeHash(uint8_t kind, uint64_t dir, uint32_t index, uint32_t seedTag) {
+  Hash::Storage bytes{};
+  bytes[0] = 's';
+  bytes[1] = 'y';
+  bytes[2] = 'n';
+  bytes[3] = kind;
+  putBigEndian(bytes.data() + 4, dir, 8);
+  putBigEndian(bytes.data() + 12, index, 4);
+  putBigEndian(bytes.data() + 16, seedTag, 4);
+  return Hash{bytes};
+}
+
+std::optional<DecodedHash> decodeHash(const Hash& id) {
+  auto bytes = id.getBytes();
+  if (bytes[0] != 's' || bytes[1] != 'y' || bytes[2] != 'n') {
+    return std::nullopt;
+  }
+  return DecodedHash{
+      bytes[3],
+      getBigEndian(bytes.data() + 4, 8),
+      static_cast<uint32_t>(getBigEndian(bytes.data() + 12, 4)),
+      static_cast<uint32_t>(getBigEndian(bytes.data() + 16, 4))};
+}
+
+uint32_t seedTag(uint64_t seed) {
+  return static_cast<uint32_t>(folly::hash::twang_mix64(seed));
+}
+} // namespace
+
+SyntheticRepo::SyntheticRepo(const SyntheticRepoOptions& options)
+    : options_{options} {
+  if (options_.minNameLength > options_.maxNameLength ||
+      options_.minFileSize > options_.maxFileSize) {
+    throw std::invalid_argument("synthetic repo ranges must not be empty");
+  }
+
+  uint64_t levelCount = 1;
+  dirCount_ = 1;
+  for (size_t level = 0; level < options_.depth; ++level) {
+    innerDirCount_ += levelCount;
+    if (options_.dirFanout &&
+        levelCount > kMaxDirectories / options_.dirFanout) {
+      throw std::invalid_argument("synthetic repo has too many directories");
+    }
+    levelCount *= options_.dirFanout;
+    dirCount_ += levelCount;
+    if (dirCount_ > kMaxDirectories) {
+      throw std::invalid_argument("synthetic repo has too many directories");
+    }
+  }
+}
+
+Hash SyntheticRepo::getRootTreeHash() const {
+  return encodeHash(kTreeKind, 0, 0, seedTag(options_.seed));
+}
+
+std::unique_ptr<Tree> SyntheticRepo::getTree(const Hash& id) const {
+  auto decoded = decodeHash(id);
+  if (!decoded || decoded->kind != kTreeKind ||
+      decoded->seedTag != seedTag(options_.seed) ||
+      decoded->dir >= dirCount_) {
+    return nullptr;
+  }
+
+  auto dir = decoded->dir;
+  std::vector<TreeEntry> entries;
+  if (dir < innerDirCount_) {
+    for (uint64_t i = 0; i < options_.dirFanout; ++i) {
+      auto child = dir * options_.dirFanout + 1 + i;
+      entries.emplace_back(
+          encodeHash(kTreeKind, child, 0, decoded->seedTag),
+          makeName('d', dir, i),
+          TreeEntryType::TREE);
+    }
+  }
+  for (uint64_t i = 0; i < options_.fileFanout; ++i) {
+    entries.emplace_back(
+        encodeHash(kBlobKind, dir, static_cast<uint32_t>(i), decoded->seedTag),
+        makeName('f', dir, i),
+        TreeEntryType::REGULAR_FILE,
+        fileSize(dir, i),
+        std::nullopt);
+  }
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+    return a.getName() < b.getName();
+  });
+  return std::make_unique<Tree>(std::move(entries), id);
+}
+
+std::unique_ptr<Blob> SyntheticRepo::getBlob(const Hash& id) const {
+  auto decoded = decodeHash(id);
+  if (!decoded || decoded->kind != kBlobKind ||
+      decoded->seedTag != seedTag(options_.seed) ||
+      decoded->dir >= dirCount_ || decoded->index >= options_.fileFanout) {
+    return nullptr;
+  }
+
+  auto size = fileSize(decoded->dir, decoded->index);
+  auto buf = folly::IOBuf::create(size);
+  auto* data = buf->writableData();
+  auto base = random(decoded->dir, decoded->index);
+  for (uint64_t offset = 0; offset < size; offset += 8) {
+    auto word = folly::hash::hash_128_to_64(base, offset);
+    auto count = std::min<uint64_t>(8, size - offset);
+    for (uint64_t i = 0; i < count; ++i) {
+      // Printable contents, so the files look like source code to tools.
+      data[offset + i] = static_cast<uint8_t>('a' + ((word >> (8 * i)) % 26));
+    }
+  }
+  buf->append(size);
+  return std::make_unique<Blob>(id, std::move(*buf));
+}
+
+uint64_t SyntheticRepo::random(uint64_t a, uint64_t b) const {
+  return folly::hash::hash_128_to_64(
+      folly::hash::hash_128_to_64(options_.seed, a), b);
+}
+
+std::string
+SyntheticRepo::makeName(char prefix, uint64_t dir, uint64_t index) const {
+  // The index makes names unique within their directory, and the letters
+  // after it cannot be mistaken for another index.
+  auto name = folly::to<std::string>(prefix, index);
+  auto r = random(dir, index ^ (uint64_t{static_cast<uint8_t>(prefix)} << 56));
+  auto length = options_.minNameLength +
+      r % (options_.maxNameLength - options_.minNameLength + 1);
+  while (name.size() < length) {
+    r = folly::hash::twang_mix64(r);
+    name.push_back(static_cast<char>('a' + r % 26));
+  }
+  return name;
+}
+
+uint64_t SyntheticRepo::fileSize(uint64_t dir, uint64_t index) const {
+  auto r = random(dir, ~index);
+  // A log-uniform draw over [minFileSize + 1, maxFileSize + 1].
+  auto low = std::log(static_cast<double>(options_.minFileSize + 1));
+  auto high = std::log(static_cast<double>(options_.maxFileSize + 1));
+  auto fraction =
+      static_cast<double>(r >> 11) / static_cast<double>(uint64_t{1} << 53);
+  auto size = std::exp(low + fraction * (high - low)) - 1;
+  return std::clamp(
+      static_cast<uint64_t>(std::max(size, 0.0)),
+      options_.minFileSize,
+      options_.maxFileSize);
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "eden/fs/model/Hash.h"
+
+namespace facebook {
+namespace eden {
+
+class Blob;
+class Tree;
+
+struct SyntheticRepoOptions {
+  /** Repos generated with different seeds have different names and sizes. */
+  uint64_t seed{0};
+  /** The number of levels of directories below the root. */
+  size_t depth{3};
+  /** The number of subdirectories in each directory above the deepest. */
+  size_t dirFanout{8};
+  /** The number of files in each directory, including the root. */
+  size_t fileFanout{16};
+  /**
+   * File sizes are drawn from a log-uniform distribution over this range, so
+   * most files are small and a few are large, as in real repositories.
+   */
+  uint64_t minFileSize{0};
+  uint64_t maxFileSize{64 * 1024};
+  /** Entry names are between these lengths, inclusive. */
+  size_t minNameLength{4};
+  size_t maxNameLength{24};
+};
+
+/**
+ * A deterministic repository too large to build up front.
+ *
+ * Trees and blobs are synthesized from their hashes when they are fetched, so
+ * a repository with millions of files takes no memory until it is read.  The
+ * hashes encode the position of each object in the repository, so the same
+ * options always produce the same trees, names and contents.
+ *
+ * FakeBackingStore::setSyntheticRepo() serves a SyntheticRepo's objects.
+ *
+ * SyntheticRepo is immutable and thread-safe.
+ */
+class SyntheticRepo {
+ public:
+  /**
+   * Throws std::invalid_argument if the options describe a repository with
+   * more directories than can be numbered.
+   */
+  explicit SyntheticRepo(const SyntheticRepoOptions& options);
+
+  Hash getRootTreeHash() const;
+
+  /** The number of directories, including the root. */
+  uint64_t getDirectoryCount() const {
+    return dirCount_;
+  }
+
+  uint64_t getFileCount() const {
+    return dirCount_ * options_.fileFanout;
+  }
+
+  /** Returns the tree with this hash, or nullptr if it is not one of ours. */
+  std::unique_ptr<Tree> getTree(const Hash& id) const;
+
+  /** Returns the blob with this hash, or nullptr if it is not one of ours. */
+  std::unique_ptr<Blob> getBlob(const Hash& id) const;
+
+ private:
+  uint64_t random(uint64_t a, uint64_t b) const;
+  std::string makeName(char prefix, uint64_t dir, uint64_t index) const;
+  uint64_t fileSize(uint64_t dir, uint64_t index) const;
+
+  SyntheticRepoOptions options_;
+  /** Directories are numbered breadth-first, starting at 0 for the root. */
+  uint64_t dirCount_{0};
+  /** Directories numbered below this have subdirectories. */
+  uint64_t innerDirCount_{0};
+};
+
+} // namespace eden
+} // namespace facebook
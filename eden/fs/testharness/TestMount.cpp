@@ -30,6 +30,7 @@
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/TreeCache.h"
 #include "eden/fs/telemetry/NullStructuredLogger.h"
 #include "eden/fs/testharness/FakeBackingStore.h"
 #include "eden/fs/testharness/FakeClock.h"
@@ -69,6 +70,8 @@ DEFINE_int32(
 namespace {
 constexpr size_t kBlobCacheMaximumSize = 1000; // bytes
 constexpr size_t kBlobCacheMinimumEntries = 0;
+constexpr size_t kTreeCacheMaximumSize = 1000; // bytes
+constexpr size_t kTreeCacheMinimumEntries = 0;
 } // namespace
 
 namespace facebook {
@@ -83,6 +86,9 @@ TestMount::TestMount()
     : blobCache_{BlobCache::create(
           kBlobCacheMaximumSize,
           kBlobCacheMinimumEntries)},
+      treeCache_{TreeCache::create(
+          kTreeCacheMaximumSize,
+          kTreeCacheMinimumEntries)},
       privHelper_{make_shared<FakePrivHelper>()},
       serverExecutor_{make_shared<folly::ManualExecutor>()} {
   // Initialize the temporary directory.
@@ -197,6 +203,7 @@ void TestMount::createMount() {
   shared_ptr<ObjectStore> objectStore = ObjectStore::create(
       localStore_,
       backingStore_,
+      treeCache_,
       stats_,
       &folly::QueuedImmediateExecutor::instance(),
       std::make_shared<ProcessNameCache>(),
@@ -279,6 +286,7 @@ void TestMount::remount() {
   auto objectStore = ObjectStore::create(
       localStore_,
       backingStore_,
+      treeCache_,
       stats_,
       &folly::QueuedImmediateExecutor::instance(),
       std::make_shared<ProcessNameCache>(),
@@ -316,6 +324,7 @@ void TestMount::remountGracefully() {
   auto objectStore = ObjectStore::create(
       localStore_,
       backingStore_,
+      treeCache_,
       stats_,
       &folly::QueuedImmediateExecutor::instance(),
       std::make_shared<ProcessNameCache>(),
@@ -43,6 +43,7 @@ class FakePrivHelper;
 class FakeTreeBuilder;
 class FileInode;
 class LocalStore;
+class TreeCache;
 class TreeInode;
 template <typename T>
 class StoredObject;
@@ -194,6 +195,10 @@ class TestMount {
     return blobCache_;
   }
 
+  const std::shared_ptr<TreeCache>& getTreeCache() const {
+    return treeCache_;
+  }
+
 #ifndef _WIN32
   Dispatcher* getDispatcher() const;
 #endif // !_WIN32
@@ -370,6 +375,7 @@ class TestMount {
   std::shared_ptr<FakeBackingStore> backingStore_;
   std::shared_ptr<EdenStats> stats_;
   std::shared_ptr<BlobCache> blobCache_;
+  std::shared_ptr<TreeCache> treeCache_;
 
   /*
    * config_ is only set before edenMount_ has been initialized.
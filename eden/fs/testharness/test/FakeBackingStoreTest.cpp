@@ -9,6 +9,7 @@
 
 #include <folly/executors/QueuedImmediateExecutor.h>
 #include <folly/experimental/TestUtil.h>
+#include <folly/futures/Future.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/test/TestUtils.h>
@@ -16,6 +17,7 @@
 
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/testharness/SyntheticRepo.h"
 #include "eden/fs/testharness/TestUtil.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -365,3 +367,92 @@ TEST_F(FakeBackingStoreTest, maybePutTree) {
   EXPECT_FALSE(dir2.second);
   EXPECT_EQ(dir1.first, dir2.first);
 }
+
+TEST_F(FakeBackingStoreTest, syntheticRepo) {
+  SyntheticRepoOptions options;
+  options.depth = 2;
+  options.dirFanout = 3;
+  options.fileFanout = 4;
+  options.maxFileSize = 1000;
+  auto repo = std::make_shared<SyntheticRepo>(options);
+  EXPECT_EQ(13, repo->getDirectoryCount());
+  EXPECT_EQ(52, repo->getFileCount());
+  store_->setSyntheticRepo(repo);
+
+  auto rootHash = repo->getRootTreeHash();
+  auto future1 =
+      store_->getTree(rootHash, ObjectFetchContext::getNullContext());
+  ASSERT_TRUE(future1.isReady());
+  auto root = std::move(future1).get();
+  ASSERT_EQ(7, root->getTreeEntries().size());
+  EXPECT_EQ(1, store_->getAccessCount(rootHash));
+
+  // The same options always synthesize the same repo.
+  auto again = SyntheticRepo{options}.getTree(rootHash);
+  ASSERT_TRUE(again);
+  EXPECT_EQ(*root, *again);
+
+  size_t trees = 0;
+  for (const auto& entry : root->getTreeEntries()) {
+    EXPECT_LE(options.minNameLength, entry.getName().stringPiece().size());
+    EXPECT_GE(options.maxNameLength, entry.getName().stringPiece().size());
+    if (entry.isTree()) {
+      ++trees;
+      continue;
+    }
+    auto blob =
+        store_->getBlob(entry.getHash(), ObjectFetchContext::getNullContext())
+            .get();
+    ASSERT_TRUE(entry.getSize().has_value());
+    EXPECT_EQ(*entry.getSize(), blob->getSize());
+    EXPECT_GE(options.maxFileSize, blob->getSize());
+  }
+  EXPECT_EQ(3, trees);
+
+  // Hashes the repo did not synthesize are still not found.
+  auto hash = makeTestHash("1");
+  EXPECT_THROW_RE(
+      store_->getBlob(hash, ObjectFetchContext::getNullContext()),
+      std::domain_error,
+      "blob 0+1 not found");
+  SyntheticRepoOptions otherOptions = options;
+  otherOptions.seed = 1;
+  EXPECT_FALSE(SyntheticRepo{otherOptions}.getTree(rootHash));
+}
+
+TEST_F(FakeBackingStoreTest, syntheticRepoLatency) {
+  auto repo = std::make_shared<SyntheticRepo>(SyntheticRepoOptions{});
+  store_->setSyntheticRepo(repo, std::chrono::milliseconds{10});
+
+  auto rootHash = repo->getRootTreeHash();
+  auto start = std::chrono::steady_clock::now();
+  auto tree =
+      store_->getTree(rootHash, ObjectFetchContext::getNullContext()).get();
+  EXPECT_EQ(rootHash, tree->getHash());
+  EXPECT_LE(
+      std::chrono::milliseconds{10}, std::chrono::steady_clock::now() - start);
+}
+
+TEST_F(FakeBackingStoreTest, syntheticRepoBandwidth) {
+  SyntheticRepoOptions options;
+  options.depth = 0;
+  options.fileFanout = 4;
+  options.minFileSize = 10000;
+  options.maxFileSize = 10000;
+  auto repo = std::make_shared<SyntheticRepo>(options);
+  SimulatedLatency latency;
+  latency.bandwidth = 1000000;
+  store_->setSyntheticRepo(repo, latency);
+
+  auto root = repo->getTree(repo->getRootTreeHash());
+  auto start = std::chrono::steady_clock::now();
+  std::vector<folly::SemiFuture<std::unique_ptr<Blob>>> futures;
+  for (const auto& entry : root->getTreeEntries()) {
+    futures.push_back(
+        store_->getBlob(entry.getHash(), ObjectFetchContext::getNullContext()));
+  }
+  folly::collectAll(std::move(futures)).get();
+  // Concurrent fetches share the link, so the four 10ms transfers add up.
+  EXPECT_LE(
+      std::chrono::milliseconds{40}, std::chrono::steady_clock::now() - start);
+}
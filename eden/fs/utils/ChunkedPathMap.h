@@ -0,0 +1,492 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+#include <folly/FBVector.h>
+#include <folly/String.h>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/** An associative container with the same interface as PathMap, for maps
+ * that can grow very large.
+ *
+ * Where PathMap keeps all of its entries in one sorted vector, this keeps
+ * them in a sequence of sorted chunks of at most MaxChunkSize entries.  An
+ * insert or erase only moves the entries of one chunk around, rather than
+ * the entire map, so building a large map out of order is no longer
+ * quadratic.  Lookups are a binary search over the chunks followed by a
+ * binary search within one chunk.
+ *
+ * Maps with at most MaxChunkSize entries consist of a single chunk, so they
+ * have the same layout and cost as a PathMap.
+ *
+ * - As with PathMap, insert and erase operations invalidate iterators.
+ * - The iterators are bidirectional rather than random access.
+ * - On Windows, lookups fall back to a case insensitive match.  The first
+ *   such lookup through the non-const find() builds a hash index of the
+ *   lower-cased names, which insert and erase keep up to date from then on.
+ *   The const find() only reads the index, so concurrent readers holding a
+ *   const reference never race with each other; without an index it scans
+ *   the entries as PathMap does.
+ */
+template <
+    typename Value,
+    typename Key = PathComponent,
+    size_t MaxChunkSize = 1024>
+class ChunkedPathMap {
+  static_assert(MaxChunkSize >= 2, "chunks must be splittable");
+
+  using Pair = std::pair<Key, Value>;
+  using Chunk = folly::fbvector<Pair>;
+  using Piece = typename Key::piece_type;
+
+  // Chunks that shrink below this size are merged with the next chunk, if
+  // the result fits in one chunk.
+  static constexpr size_t kMinChunkSize = MaxChunkSize / 2;
+
+  template <bool IsConst>
+  class Iterator {
+    using Chunks = std::
+        conditional_t<IsConst, const std::vector<Chunk>, std::vector<Chunk>>;
+
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Pair;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const Pair*, Pair*>;
+    using reference = std::conditional_t<IsConst, const Pair&, Pair&>;
+
+    Iterator() = default;
+
+    /* implicit */ Iterator(const Iterator<false>& other)
+        : chunks_{other.chunks_}, chunk_{other.chunk_}, pos_{other.pos_} {}
+
+    reference operator*() const {
+      return (*chunks_)[chunk_][pos_];
+    }
+
+    pointer operator->() const {
+      return &**this;
+    }
+
+    Iterator& operator++() {
+      if (++pos_ == (*chunks_)[chunk_].size()) {
+        ++chunk_;
+        pos_ = 0;
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    Iterator& operator--() {
+      if (pos_ == 0) {
+        --chunk_;
+        pos_ = (*chunks_)[chunk_].size() - 1;
+      } else {
+        --pos_;
+      }
+      return *this;
+    }
+
+    Iterator operator--(int) {
+      auto result = *this;
+      --*this;
+      return result;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return chunk_ == other.chunk_ && pos_ == other.pos_;
+    }
+
+    bool operator!=(const Iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class ChunkedPathMap;
+    friend class Iterator<true>;
+
+    Iterator(Chunks* chunks, size_t chunk, size_t pos)
+        : chunks_{chunks}, chunk_{chunk}, pos_{pos} {}
+
+    Chunks* chunks_{nullptr};
+    size_t chunk_{0};
+    size_t pos_{0};
+  };
+
+ public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = Pair;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
+  ChunkedPathMap() = default;
+
+  ChunkedPathMap(std::initializer_list<value_type> init)
+      : ChunkedPathMap(init.begin(), init.end()) {}
+
+  template <typename InputIterator>
+  ChunkedPathMap(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  // The case insensitive index is not copied; the copy builds its own when
+  // it is needed.
+  ChunkedPathMap(const ChunkedPathMap& other)
+      : chunks_{other.chunks_}, size_{other.size_} {}
+  ChunkedPathMap& operator=(const ChunkedPathMap& other) {
+    ChunkedPathMap(other).swap(*this);
+    return *this;
+  }
+
+  ChunkedPathMap(ChunkedPathMap&& other) noexcept
+      : chunks_{std::move(other.chunks_)}, size_{other.size_} {
+    other.chunks_.clear();
+    other.size_ = 0;
+#ifdef _WIN32
+    caseFoldedIndex_ = std::move(other.caseFoldedIndex_);
+#endif
+  }
+
+  ChunkedPathMap& operator=(ChunkedPathMap&& other) noexcept {
+    other.swap(*this);
+    return *this;
+  }
+
+  iterator begin() {
+    return iterator{&chunks_, 0, 0};
+  }
+  const_iterator begin() const {
+    return const_iterator{&chunks_, 0, 0};
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  iterator end() {
+    return iterator{&chunks_, chunks_.size(), 0};
+  }
+  const_iterator end() const {
+    return const_iterator{&chunks_, chunks_.size(), 0};
+  }
+  const_iterator cend() const {
+    return end();
+  }
+
+  size_type size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  void clear() {
+    chunks_.clear();
+    size_ = 0;
+#ifdef _WIN32
+    caseFoldedIndex_.reset();
+#endif
+  }
+
+  void swap(ChunkedPathMap& other) noexcept {
+    chunks_.swap(other.chunks_);
+    std::swap(size_, other.size_);
+#ifdef _WIN32
+    caseFoldedIndex_.swap(other.caseFoldedIndex_);
+#endif
+  }
+
+  iterator lower_bound(Piece key) {
+    auto [chunk, pos] = lowerBoundPosition(key);
+    return iterator{&chunks_, chunk, pos};
+  }
+
+  const_iterator lower_bound(Piece key) const {
+    auto [chunk, pos] = lowerBoundPosition(key);
+    return const_iterator{&chunks_, chunk, pos};
+  }
+
+  /** Find using the Piece representation of a key.
+   * Does not allocate a copy of the key string.
+   */
+  iterator find(Piece key) {
+    auto iter = lower_bound(key);
+    if (iter != end() && !(key < Piece{iter->first})) {
+      return iter;
+    }
+#ifdef _WIN32
+    // On Windows we need to do a case insensitive lookup for the file and
+    // directory names.  The case sensitive search above covers most cases,
+    // so the index is only built once a lookup actually needs it.
+    if (!caseFoldedIndex_) {
+      buildCaseFoldedIndex();
+    }
+    if (auto* match = findCaseFolded(key)) {
+      return lower_bound(*match);
+    }
+#endif
+    return end();
+  }
+
+  const_iterator find(Piece key) const {
+    auto iter = lower_bound(key);
+    if (iter != end() && !(key < Piece{iter->first})) {
+      return iter;
+    }
+#ifdef _WIN32
+    if (caseFoldedIndex_) {
+      if (auto* match = findCaseFolded(key)) {
+        return lower_bound(*match);
+      }
+      return end();
+    }
+    for (iter = begin(); iter != end(); ++iter) {
+      if (key.stringPiece().equals(
+              iter->first.stringPiece(), folly::AsciiCaseInsensitive())) {
+        return iter;
+      }
+    }
+#endif
+    return end();
+  }
+
+  /** Insert a new key-value pair.
+   * If the key already exists, it is left unaltered.
+   * Returns a pair consisting of an iterator to the position for key and
+   * a boolean that is true if an insert took place. */
+  std::pair<iterator, bool> insert(const value_type& val) {
+    return emplace(val.first, val.second);
+  }
+
+  /** Emplace a new key-value pair by constructing it in-place.
+   * If the key already exists, it is left unaltered.
+   * If an insertion happens, the args are forwarded to the Value
+   * constructor.
+   * Returns a pair consisting of an iterator to the position for key and
+   * a boolean that is true if an insert took place. */
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Piece key, Args&&... args) {
+    auto [chunk, pos] = lowerBoundPosition(key);
+    if (chunk < chunks_.size() && !(key < Piece{chunks_[chunk][pos].first})) {
+      return std::make_pair(iterator{&chunks_, chunk, pos}, false);
+    }
+
+    if (chunks_.empty()) {
+      chunks_.emplace_back();
+    } else if (chunk == chunks_.size()) {
+      // Append to the last chunk.
+      --chunk;
+      pos = chunks_[chunk].size();
+    }
+    auto& target = chunks_[chunk];
+    target.emplace(
+        target.begin() + pos,
+        std::make_pair(Key(key), Value(std::forward<Args>(args)...)));
+    ++size_;
+#ifdef _WIN32
+    if (caseFoldedIndex_) {
+      caseFoldedIndex_->emplace(caseFold(key), Key(key));
+    }
+#endif
+
+    if (target.size() > MaxChunkSize) {
+      // Split the chunk in two.
+      const auto half = target.size() / 2;
+      Chunk upper(
+          std::make_move_iterator(target.begin() + half),
+          std::make_move_iterator(target.end()));
+      target.erase(target.begin() + half, target.end());
+      chunks_.insert(chunks_.begin() + chunk + 1, std::move(upper));
+      if (pos >= half) {
+        ++chunk;
+        pos -= half;
+      }
+    }
+    return std::make_pair(iterator{&chunks_, chunk, pos}, true);
+  }
+
+  /** Returns a reference to the map position for key, creating it needed.
+   * If the key is already present, no additional allocations are performed. */
+  mapped_type& operator[](Piece key) {
+    return emplace(key).first->second;
+  }
+
+  /** Returns a reference to the map position for key, if present.
+   * Throws std::out_of_range if the key is not present (this const
+   * form is not allowed to mutate the map). */
+  const mapped_type& operator[](Piece key) const {
+    return at(key);
+  }
+
+  /** Returns a reference to the map position for key, if present.
+   * Throws std::out_of_range if the key is not present. */
+  mapped_type& at(Piece key) {
+    auto iter = find(key);
+    if (iter == end()) {
+      throw std::out_of_range(folly::to<std::string>("no such key ", key));
+    }
+    return iter->second;
+  }
+
+  const mapped_type& at(Piece key) const {
+    return const_cast<ChunkedPathMap*>(this)->at(key);
+  }
+
+  /** Erase the element at iter.
+   * Returns an iterator to the element that followed it. */
+  iterator erase(const_iterator iter) {
+    auto chunk = iter.chunk_;
+    auto pos = iter.pos_;
+    auto& target = chunks_[chunk];
+#ifdef _WIN32
+    if (caseFoldedIndex_) {
+      const auto& erasedKey = target[pos].first;
+      auto range = caseFoldedIndex_->equal_range(caseFold(erasedKey));
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == erasedKey) {
+          caseFoldedIndex_->erase(it);
+          break;
+        }
+      }
+    }
+#endif
+    target.erase(target.begin() + pos);
+    --size_;
+
+    if (target.empty()) {
+      chunks_.erase(chunks_.begin() + chunk);
+      return iterator{&chunks_, chunk, 0};
+    }
+    if (target.size() < kMinChunkSize && chunk + 1 < chunks_.size() &&
+        target.size() + chunks_[chunk + 1].size() <= MaxChunkSize) {
+      auto& next = chunks_[chunk + 1];
+      target.insert(
+          target.end(),
+          std::make_move_iterator(next.begin()),
+          std::make_move_iterator(next.end()));
+      chunks_.erase(chunks_.begin() + chunk + 1);
+    }
+    if (pos == target.size()) {
+      return iterator{&chunks_, chunk + 1, 0};
+    }
+    return iterator{&chunks_, chunk, pos};
+  }
+
+  /** Erase the value associated with key.
+   * Does not allocate any additional memory to look up the key.
+   * Returns the number of matching elements that were erased; this is
+   * always either 1 or 0. */
+  size_type erase(Piece key) {
+    auto iter = find(key);
+    if (iter == end()) {
+      return 0;
+    }
+    erase(iter);
+    return 1;
+  }
+
+  /** Returns 1 if there is an entry with the given key and 0 otherwise. */
+  size_type count(Piece key) const {
+    return find(key) != end();
+  }
+
+  /** Returns the number of chunks the entries are stored in. */
+  size_t chunkCount() const {
+    return chunks_.size();
+  }
+
+  friend bool operator==(const ChunkedPathMap& lhs, const ChunkedPathMap& rhs) {
+    return lhs.size() == rhs.size() &&
+        std::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
+
+  friend bool operator!=(const ChunkedPathMap& lhs, const ChunkedPathMap& rhs) {
+    return !(lhs == rhs);
+  }
+
+ private:
+  /** Returns the (chunk, position) of the first entry not less than key,
+   * or (chunks_.size(), 0) if there is none. */
+  std::pair<size_t, size_t> lowerBoundPosition(Piece key) const {
+    auto chunkIter = std::partition_point(
+        chunks_.begin(), chunks_.end(), [&](const Chunk& chunk) {
+          return Piece{chunk.back().first} < key;
+        });
+    if (chunkIter == chunks_.end()) {
+      return {chunks_.size(), 0};
+    }
+    auto posIter = std::partition_point(
+        chunkIter->begin(), chunkIter->end(), [&](const Pair& pair) {
+          return Piece{pair.first} < key;
+        });
+    return {static_cast<size_t>(chunkIter - chunks_.begin()),
+            static_cast<size_t>(posIter - chunkIter->begin())};
+  }
+
+#ifdef _WIN32
+  static std::string caseFold(Piece key) {
+    auto folded = key.stringPiece().str();
+    folly::toLowerAscii(folded);
+    return folded;
+  }
+
+  void buildCaseFoldedIndex() {
+    caseFoldedIndex_ = std::make_unique<CaseFoldedIndex>();
+    caseFoldedIndex_->reserve(size_);
+    for (const auto& entry : *this) {
+      caseFoldedIndex_->emplace(caseFold(entry.first), entry.first);
+    }
+  }
+
+  /** Returns the stored key that matches key case insensitively, or nullptr.
+   * If several do, returns the one that sorts first, as a scan would. */
+  const Key* findCaseFolded(Piece key) const {
+    auto range = caseFoldedIndex_->equal_range(caseFold(key));
+    const Key* match = nullptr;
+    for (auto it = range.first; it != range.second; ++it) {
+      if (!match || it->second < *match) {
+        match = &it->second;
+      }
+    }
+    return match;
+  }
+#endif
+
+  // Sorted, non-empty chunks of at most MaxChunkSize entries.
+  std::vector<Chunk> chunks_;
+  size_t size_{0};
+#ifdef _WIN32
+  // Maps lower-cased names to the stored keys, for case insensitive lookups.
+  // Null until the first lookup that needs it.
+  using CaseFoldedIndex = std::unordered_multimap<std::string, Key>;
+  std::unique_ptr<CaseFoldedIndex> caseFoldedIndex_;
+#endif
+};
+
+} // namespace eden
+} // namespace facebook
@@ -57,8 +57,9 @@ void CoverageSet::add(size_t begin, size_t end) {
   // reinsertion. At the cost of some additional checks, the rebalances could be
   // avoided. This optimization probably isn't worth much under typical usage.
 
-  if (left != set_.end() && left->end == begin) {
+  if (left != set_.end() && left->end >= begin) {
     begin = left->begin;
+    end = std::max(end, left->end);
     erase(left);
   }
   while (right != set_.end() && end >= right->begin) {
@@ -95,6 +96,30 @@ bool CoverageSet::covers(size_t begin, size_t end) const noexcept {
   return left->begin <= begin && end <= left->end;
 }
 
+std::vector<std::pair<size_t, size_t>> CoverageSet::getUncoveredRanges(
+    size_t begin,
+    size_t end) const {
+  CHECK_LE(begin, end)
+      << "End of interval must be greater than or equal to begin";
+  std::vector<std::pair<size_t, size_t>> result;
+
+  // Start from the interval containing begin, if there is one.
+  auto iter = set_.upper_bound(Interval{begin, begin});
+  if (iter != set_.begin() && std::prev(iter)->end > begin) {
+    --iter;
+  }
+  for (; begin < end && iter != set_.end() && iter->begin < end; ++iter) {
+    if (begin < iter->begin) {
+      result.emplace_back(begin, iter->begin);
+    }
+    begin = std::max(begin, iter->end);
+  }
+  if (begin < end) {
+    result.emplace_back(begin, end);
+  }
+  return result;
+}
+
 size_t CoverageSet::getIntervalCount() const noexcept {
   return set_.size();
 }
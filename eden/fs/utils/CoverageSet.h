@@ -9,6 +9,8 @@
 
 #include <cstddef>
 #include <set>
+#include <utility>
+#include <vector>
 
 namespace facebook {
 namespace eden {
@@ -40,6 +42,14 @@ class CoverageSet {
    */
   bool covers(size_t begin, size_t end) const noexcept;
 
+  /**
+   * Returns the parts of the interval [begin, end) that are not covered, as
+   * [begin, end) pairs in increasing order.
+   */
+  std::vector<std::pair<size_t, size_t>> getUncoveredRanges(
+      size_t begin,
+      size_t end) const;
+
   /**
    * Returns the number of intervals currently being tracked. This function is
    * primarily for tests.
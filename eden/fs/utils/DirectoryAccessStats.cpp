@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/DirectoryAccessStats.h"
+
+#include <algorithm>
+
+namespace facebook {
+namespace eden {
+
+DirectoryAccessStats::DirectoryAccessStats(
+    uint32_t sampleRate,
+    size_t capacity)
+    : sampleRate_{sampleRate}, capacity_{std::max<size_t>(capacity, 1)} {}
+
+void DirectoryAccessStats::add(
+    RelativePathPiece directory,
+    AccessType type) {
+  auto sketch = sketches_->sketch.lock();
+
+  Slot* slot;
+  auto it = sketch->index.find(directory.stringPiece());
+  if (it != sketch->index.end()) {
+    slot = &sketch->slots[it->second];
+  } else if (sketch->slots.size() < capacity_) {
+    sketch->slots.emplace_back();
+    slot = &sketch->slots.back();
+    slot->directory = directory.stringPiece().str();
+    sketch->index.emplace(slot->directory, sketch->slots.size() - 1);
+  } else {
+    // Take over the least counted slot. This scan is linear, but only runs
+    // for sampled accesses to directories that are not already counted.
+    slot = &*std::min_element(
+        sketch->slots.begin(),
+        sketch->slots.end(),
+        [](const Slot& a, const Slot& b) { return a.total < b.total; });
+    auto slotIndex = static_cast<size_t>(slot - sketch->slots.data());
+    sketch->index.erase(slot->directory);
+    slot->directory = directory.stringPiece().str();
+    slot->counts.fill(0);
+    slot->error = slot->total;
+    sketch->index.emplace(slot->directory, slotIndex);
+  }
+
+  slot->counts[enumValue(type)] += sampleRate_;
+  slot->total += sampleRate_;
+}
+
+std::vector<DirectoryAccessStats::DirectoryCounts>
+DirectoryAccessStats::getHotDirectories(size_t count) {
+  folly::F14FastMap<std::string, Slot> merged;
+  for (auto& local : sketches_.accessAllThreads()) {
+    auto sketch = local.sketch.lock();
+    for (const auto& slot : sketch->slots) {
+      auto& total = merged[slot.directory];
+      for (size_t type = 0; type < kAccessTypeCount; ++type) {
+        total.counts[type] += slot.counts[type];
+      }
+      total.total += slot.total;
+      total.error += slot.error;
+    }
+  }
+
+  std::vector<DirectoryCounts> result;
+  result.reserve(merged.size());
+  for (auto& [directory, slot] : merged) {
+    result.push_back(DirectoryCounts{
+        RelativePath{directory}, slot.counts, slot.total, slot.error});
+  }
+  std::sort(
+      result.begin(),
+      result.end(),
+      [](const DirectoryCounts& a, const DirectoryCounts& b) {
+        return a.total > b.total;
+      });
+  if (result.size() > count) {
+    result.resize(count);
+  }
+  return result;
+}
+
+void DirectoryAccessStats::clear() {
+  for (auto& local : sketches_.accessAllThreads()) {
+    auto sketch = local.sketch.lock();
+    sketch->slots.clear();
+    sketch->index.clear();
+  }
+}
+
+} // namespace eden
+} // namespace facebook
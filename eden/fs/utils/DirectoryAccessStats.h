@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Random.h>
+#include <folly/SpinLock.h>
+#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <folly/container/F14Map.h>
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "eden/fs/utils/EnumValue.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Sampled counts of the accesses within each directory of a mount, for
+ * finding the subtrees that are hammered when a mount is slow.
+ *
+ * Each thread counts its sampled accesses in a fixed-size top-k sketch
+ * using the Space-Saving algorithm. A directory that is not yet counted
+ * takes over the slot of the least counted one. It inherits that slot's
+ * count, which becomes its error bound. Any directory with more than
+ * 1/capacity of a thread's accesses is guaranteed a slot. The sketches of
+ * all threads are only merged when they are read, and the counts of a thread
+ * that exits are dropped, which is fine for the long-lived FUSE and server
+ * threads that record accesses.
+ */
+class DirectoryAccessStats {
+ public:
+  enum class AccessType : unsigned {
+    Lookup,
+    Read,
+    BlobLoad,
+    TreeLoad,
+    Last,
+  };
+
+  static constexpr size_t kAccessTypeCount = enumValue(AccessType::Last);
+  static constexpr size_t kDefaultCapacity = 256;
+
+  struct DirectoryCounts {
+    RelativePath directory;
+    std::array<uint64_t, kAccessTypeCount> counts{};
+    /** The sum of counts, by which directories are ranked. */
+    uint64_t total{0};
+    /** An upper bound on how much total overstates the real accesses. */
+    uint64_t error{0};
+  };
+
+  /**
+   * One in every sampleRate accesses is counted, with a weight of
+   * sampleRate. A sampleRate of 0 disables counting. Each thread keeps at
+   * most capacity directories.
+   */
+  explicit DirectoryAccessStats(
+      uint32_t sampleRate,
+      size_t capacity = kDefaultCapacity);
+
+  /**
+   * Counts an access within the directory returned by getDirectory, an
+   * std::optional<RelativePath>. getDirectory is called only for sampled
+   * accesses, so it may be as expensive as InodeBase::getPath().
+   */
+  template <typename GetDirectory>
+  void record(AccessType type, GetDirectory&& getDirectory) {
+    if (sampleRate_ == 0 ||
+        (sampleRate_ > 1 && !folly::Random::oneIn(sampleRate_))) {
+      return;
+    }
+    if (auto directory = getDirectory()) {
+      add(*directory, type);
+    }
+  }
+
+  /**
+   * The directory containing path, or std::nullopt if path is.
+   */
+  static std::optional<RelativePath> parentOf(
+      const std::optional<RelativePath>& path) {
+    if (!path) {
+      return std::nullopt;
+    }
+    return RelativePath{path->dirname()};
+  }
+
+  /**
+   * Returns up to count of the most accessed directories, most accessed
+   * first.
+   */
+  std::vector<DirectoryCounts> getHotDirectories(size_t count);
+
+  /**
+   * Forgets every access counted so far.
+   */
+  void clear();
+
+ private:
+  struct Slot {
+    std::string directory;
+    std::array<uint64_t, kAccessTypeCount> counts{};
+    uint64_t total{0};
+    uint64_t error{0};
+  };
+
+  struct Sketch {
+    std::vector<Slot> slots;
+    /** Maps each directory in slots to its index. */
+    folly::F14FastMap<std::string, size_t> index;
+  };
+
+  struct ThreadLocalSketch {
+    folly::Synchronized<Sketch, folly::SpinLock> sketch;
+  };
+
+  struct Tag {};
+
+  void add(RelativePathPiece directory, AccessType type);
+
+  const uint32_t sampleRate_;
+  const size_t capacity_;
+  folly::ThreadLocal<ThreadLocalSketch, Tag, folly::AccessModeStrict>
+      sketches_;
+};
+
+} // namespace eden
+} // namespace facebook
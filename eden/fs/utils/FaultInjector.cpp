@@ -148,6 +148,7 @@ void FaultInjector::injectFault(
   auto state = state_.wlock();
   state->faults[keyClass].emplace_back(
       keyValueRegex, std::move(behavior), count);
+  numFaults_.fetch_add(1, std::memory_order_release);
 }
 
 bool FaultInjector::removeFault(
@@ -169,6 +170,7 @@ bool FaultInjector::removeFault(
     if (iter->keyValueRegex.str() == keyValueRegex) {
       XLOG(INFO) << "removeFault(" << keyClass << ", " << keyValueRegex << ")";
       faultVector.erase(iter);
+      numFaults_.fetch_sub(1, std::memory_order_release);
       if (faultVector.empty()) {
         state->faults.erase(classIter);
       }
@@ -248,6 +250,7 @@ FaultInjector::FaultBehavior FaultInjector::findFault(
         XLOG(DBG1) << "fault expired: " << keyClass << ", "
                    << iter->keyValueRegex.str();
         faultVector.erase(iter);
+        numFaults_.fetch_sub(1, std::memory_order_release);
       }
     }
     return behavior;
@@ -11,6 +11,7 @@
 #include <boost/variant.hpp>
 #include <folly/experimental/StringKeyedUnorderedMap.h>
 #include <folly/futures/Future.h>
+#include <atomic>
 #include <optional>
 
 namespace facebook {
@@ -47,7 +48,7 @@ class FaultInjector {
   FOLLY_NODISCARD folly::SemiFuture<folly::Unit> checkAsync(
       folly::StringPiece keyClass,
       folly::StringPiece keyValue) {
-    if (UNLIKELY(enabled_)) {
+    if (UNLIKELY(hasFaults())) {
       return checkAsyncImpl(keyClass, keyValue);
     }
     return folly::makeSemiFuture();
@@ -63,11 +64,21 @@ class FaultInjector {
    * code.
    */
   void check(folly::StringPiece keyClass, folly::StringPiece keyValue) {
-    if (UNLIKELY(enabled_)) {
+    if (UNLIKELY(hasFaults())) {
       return checkImpl(keyClass, keyValue);
     }
   }
 
+  /**
+   * Returns true if any fault is currently injected.
+   *
+   * Checks can be skipped when this is false.  EDEN_CHECK_FAULT() uses this to
+   * avoid even computing the key of a check.
+   */
+  FOLLY_ALWAYS_INLINE bool hasFaults() const {
+    return enabled_ && numFaults_.load(std::memory_order_acquire) > 0;
+  }
+
   /**
    * Inject a fault that triggers an exception to be thrown.
    *
@@ -226,8 +237,27 @@ class FaultInjector {
    * enabled in the first place, and fall through
    */
   bool const enabled_{false};
+  /**
+   * The number of faults in state_, so that checks can return without taking
+   * the state_ lock while nothing is injected, which is nearly always true
+   * even in tests.  This is only modified while holding the state_ lock.
+   */
+  std::atomic<size_t> numFaults_{0};
   folly::Synchronized<State> state_;
 };
 
+/**
+ * Call injector.check(keyClass, keyValue), but only evaluate keyClass and
+ * keyValue if some fault is injected.  This lets fault points on hot paths
+ * use keys that are expensive to build, such as paths.
+ */
+#define EDEN_CHECK_FAULT(injector, keyClass, keyValue)      \
+  do {                                                      \
+    auto& edenCheckFaultInjector = (injector);              \
+    if (UNLIKELY(edenCheckFaultInjector.hasFaults())) {     \
+      edenCheckFaultInjector.check((keyClass), (keyValue)); \
+    }                                                       \
+  } while (false)
+
 } // namespace eden
 } // namespace facebook
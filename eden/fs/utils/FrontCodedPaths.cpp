@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/FrontCodedPaths.h"
+
+#include <folly/Varint.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+void appendVarint(std::string& out, uint64_t value) {
+  uint8_t buf[folly::kMaxVarintLength64];
+  auto size = folly::encodeVarint(value, buf);
+  out.append(reinterpret_cast<const char*>(buf), size);
+}
+} // namespace
+
+void FrontCodedPathsBuilder::add(folly::StringPiece path) {
+  auto limit = std::min(path.size(), previous_.size());
+  size_t shared = 0;
+  while (shared < limit && path[shared] == previous_[shared]) {
+    ++shared;
+  }
+
+  appendVarint(encoded_, shared);
+  appendVarint(encoded_, path.size() - shared);
+  encoded_.append(path.data() + shared, path.size() - shared);
+
+  // Keeps previous_'s buffer, so adding a path rarely allocates.
+  previous_.resize(shared);
+  previous_.append(path.data() + shared, path.size() - shared);
+  ++count_;
+}
+
+std::string FrontCodedPathsBuilder::finish() {
+  previous_.clear();
+  count_ = 0;
+  return std::move(encoded_);
+}
+
+std::string encodeFrontCodedPaths(std::vector<folly::StringPiece> paths) {
+  std::sort(paths.begin(), paths.end());
+  paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+  FrontCodedPathsBuilder builder;
+  for (auto path : paths) {
+    builder.add(path);
+  }
+  return builder.finish();
+}
+
+std::vector<std::string> decodeFrontCodedPaths(folly::ByteRange encoded) {
+  std::vector<std::string> paths;
+  std::string path;
+  while (!encoded.empty()) {
+    // decodeVarint() throws std::invalid_argument on truncated input.
+    auto shared = folly::decodeVarint(encoded);
+    auto suffixSize = folly::decodeVarint(encoded);
+    if (shared > path.size() || suffixSize > encoded.size()) {
+      throw std::invalid_argument("malformed front coded path list");
+    }
+    path.resize(shared);
+    path.append(reinterpret_cast<const char*>(encoded.data()), suffixSize);
+    encoded.advance(suffixSize);
+    paths.push_back(path);
+  }
+  return paths;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <string>
+#include <vector>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Encodes a sorted list of paths by front coding them: each path is stored
+ * as the number of leading bytes it shares with the path before it,
+ * followed by the length of the rest of the path and its bytes.  Both
+ * numbers are varints.
+ *
+ * Sorted lists of deeply nested paths mostly repeat the directories of the
+ * previous path, so this is much smaller than the list of full paths, and a
+ * client decodes it with a single pass over one buffer.
+ *
+ * Paths must be added in ascending byte order.
+ */
+class FrontCodedPathsBuilder {
+ public:
+  void add(folly::StringPiece path);
+
+  size_t size() const {
+    return count_;
+  }
+
+  /** Returns the encoded paths, leaving the builder empty. */
+  std::string finish();
+
+ private:
+  std::string encoded_;
+  std::string previous_;
+  size_t count_{0};
+};
+
+/**
+ * Sorts and deduplicates paths, and returns them front coded.
+ */
+std::string encodeFrontCodedPaths(std::vector<folly::StringPiece> paths);
+
+/**
+ * Decodes the output of FrontCodedPathsBuilder.  Throws std::invalid_argument
+ * if it is malformed.
+ */
+std::vector<std::string> decodeFrontCodedPaths(folly::ByteRange encoded);
+
+} // namespace eden
+} // namespace facebook
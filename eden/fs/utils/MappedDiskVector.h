@@ -9,6 +9,7 @@
 
 #include <sys/mman.h>
 #include <unistd.h>
+#include <algorithm>
 #include <type_traits>
 
 #include <eden/fs/utils/Bug.h>
@@ -16,6 +17,7 @@
 #include <folly/File.h>
 #include <folly/FileUtil.h>
 #include <folly/Range.h>
+#include <folly/String.h>
 #include <folly/logging/xlog.h>
 
 namespace facebook {
@@ -73,6 +75,31 @@ template <typename T, typename... OldVersions>
 struct Migrator;
 } // namespace detail
 
+/**
+ * Controls how MappedDiskVector maps its file into memory.
+ */
+struct MappedDiskVectorOptions {
+  /**
+   * Fault in the whole file when it is opened (MAP_POPULATE) rather than a
+   * page at a time on first access.  Worthwhile when every record is read
+   * right after opening anyway.
+   */
+  bool populate{false};
+
+  /**
+   * Advice passed to madvise(2) for the mapping, e.g. MADV_RANDOM when the
+   * records are accessed in no particular order.
+   */
+  int advice{MADV_NORMAL};
+
+  /**
+   * Request transparent huge pages for the mapping to reduce page faults and
+   * TLB misses.  This is only advice: kernels and filesystems that do not
+   * support huge pages for shared file mappings ignore it.
+   */
+  bool hugePages{false};
+};
+
 /**
  * MappedDiskVector is roughly analogous to std::vector, except it's backed by
  * a persistent memory-mapped file.
@@ -124,7 +151,7 @@ class MappedDiskVector {
   template <typename... OldVersions>
   static MappedDiskVector open(
       folly::StringPiece path,
-      bool shouldPopulate = false) {
+      const MappedDiskVectorOptions& options = {}) {
     folly::File file{path, O_RDWR | O_CREAT | O_CLOEXEC, 0600};
 
     if (!file.try_lock()) {
@@ -136,7 +163,7 @@ class MappedDiskVector {
         fstat(file.fd(), &st), "fstat failed on MappedDiskVector path ", path);
 
     if (st.st_size == 0) {
-      return initializeFromScratch(std::move(file));
+      return initializeFromScratch(std::move(file), options);
     }
 
     Header header;
@@ -183,7 +210,7 @@ class MappedDiskVector {
             header.recordSize));
       }
       return MappedDiskVector{
-          std::move(file), st.st_size, header.entryCount, shouldPopulate};
+          std::move(file), st.st_size, header.entryCount, options};
     }
 
     // Try to migrate from an old record format if any match.
@@ -205,6 +232,7 @@ class MappedDiskVector {
             st.st_size,
             header.entryCount,
             i,
+            options,
             [](const auto& from) { return T{from}; });
       }
     }
@@ -225,21 +253,24 @@ class MappedDiskVector {
    * Creates a new MappedDiskVector at the specified path, overwriting any that
    * was there prior.
    */
-  static MappedDiskVector createOrOverwrite(folly::StringPiece path) {
+  static MappedDiskVector createOrOverwrite(
+      folly::StringPiece path,
+      const MappedDiskVectorOptions& options = {}) {
     folly::File file{
         path, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600};
     if (!file.try_lock()) {
       folly::throwSystemError("failed to acquire lock on ", path);
     }
 
-    return initializeFromScratch(std::move(file));
+    return initializeFromScratch(std::move(file), options);
   }
 
   explicit MappedDiskVector() = delete;
   MappedDiskVector(const MappedDiskVector&) = delete;
   MappedDiskVector& operator=(const MappedDiskVector&) = delete;
 
-  MappedDiskVector(MappedDiskVector&& other) : file_(std::move(other.file_)) {
+  MappedDiskVector(MappedDiskVector&& other)
+      : file_(std::move(other.file_)), options_(other.options_) {
     begin_ = other.begin_;
     end_ = other.end_;
     map_ = other.map_;
@@ -257,6 +288,7 @@ class MappedDiskVector {
     }
 
     file_ = std::move(other.file_);
+    options_ = other.options_;
     begin_ = other.begin_;
     end_ = other.end_;
     map_ = other.map_;
@@ -266,6 +298,7 @@ class MappedDiskVector {
     other.end_ = nullptr;
     other.map_ = nullptr;
     other.mapSizeInBytes_ = 0;
+    return *this;
   }
 
   ~MappedDiskVector() {
@@ -291,6 +324,44 @@ class MappedDiskVector {
     return begin_[index];
   }
 
+  /**
+   * Grow the file, if necessary, so that it has room for at least count
+   * records without further resizing.
+   */
+  void reserve(size_t count) {
+    if (count > capacity()) {
+      grow(sizeof(Header) + count * sizeof(T));
+    }
+  }
+
+  /**
+   * Shrink the file, if it is larger than its initial size, to the whole
+   * number of pages that holds the current records.  Pointers to records
+   * remain valid.
+   */
+  void shrinkToFit() {
+    size_t newFileSize = std::max(
+        kInitialSize,
+        detail::roundUpToNonzeroPageSize(sizeof(Header) + size() * sizeof(T)));
+    if (newFileSize >= mapSizeInBytes_) {
+      return;
+    }
+
+    // Unmapping the tail keeps the mapping at the same address.
+    if (munmap(
+            static_cast<char*>(map_) + newFileSize,
+            mapSizeInBytes_ - newFileSize)) {
+      folly::throwSystemError("munmap failed when shrinking capacity");
+    }
+    mapSizeInBytes_ = newFileSize;
+
+    // A file longer than the mapping is harmless, so the mapping is shrunk
+    // first.
+    if (-1 == folly::ftruncateNoInt(file_.fd(), newFileSize)) {
+      folly::throwSystemError("ftruncateNoInt failed when shrinking capacity");
+    }
+  }
+
   template <typename... Args>
   void emplace_back(Args&&... args) {
     if (!hasRoom(1)) {
@@ -298,44 +369,11 @@ class MappedDiskVector {
           sizeof(GROWTH_IN_PAGES) * detail::kPageSize >= sizeof(T),
           "Growth must expand the file more than a single record");
 
-      size_t oldSize = size();
-      size_t newFileSize =
-          mapSizeInBytes_ + GROWTH_IN_PAGES * detail::kPageSize;
-
-      // Always keep the file size a whole number of pages.
-      CHECK_EQ(0, newFileSize % detail::kPageSize);
-
-      if (-1 == folly::ftruncateNoInt(file_.fd(), newFileSize)) {
-        folly::throwSystemError("ftruncateNoInt failed when growing capacity");
-      }
-
-#ifdef __APPLE__
-      auto newMap = mmap(
-          nullptr,
-          newFileSize,
-          PROT_READ | PROT_WRITE,
-          MAP_SHARED,
-          file_.fd(),
-          0);
-#else
-      auto newMap = mremap(map_, mapSizeInBytes_, newFileSize, MREMAP_MAYMOVE);
-#endif
-      if (newMap == MAP_FAILED) {
-        folly::throwSystemError(folly::to<std::string>(
-            "mremap failed when growing capacity from ",
-            mapSizeInBytes_,
-            " to ",
-            newFileSize));
-      }
-
-#ifdef __APPLE__
-      munmap(map_, mapSizeInBytes_);
-#endif
-      map_ = newMap;
-      mapSizeInBytes_ = newFileSize;
-
-      begin_ = reinterpret_cast<T*>(static_cast<Header*>(newMap) + 1);
-      end_ = begin_ + oldSize;
+      // Grow geometrically so that a table with millions of records is not
+      // resized and remapped a thousand times on the way.
+      grow(std::max(
+          mapSizeInBytes_ + GROWTH_IN_PAGES * detail::kPageSize,
+          mapSizeInBytes_ + mapSizeInBytes_ / kGrowthDivisor));
     }
 
     T* out = end_;
@@ -383,10 +421,22 @@ class MappedDiskVector {
 
   static constexpr size_t GROWTH_IN_PAGES = 256;
 
-  static MappedDiskVector initializeFromScratch(folly::File file) {
-    // Start the file large enough to handle the header and a little under one
-    // round one of growth.
-    constexpr size_t initialSize = GROWTH_IN_PAGES * detail::kPageSize;
+  /**
+   * Files start large enough to handle the header and a little under one
+   * round of growth.
+   */
+  static constexpr size_t kInitialSize = GROWTH_IN_PAGES * detail::kPageSize;
+
+  /**
+   * Once the file is larger than GROWTH_IN_PAGES * kGrowthDivisor pages, it
+   * grows by 1/kGrowthDivisor of its size at a time.
+   */
+  static constexpr size_t kGrowthDivisor = 4;
+
+  static MappedDiskVector initializeFromScratch(
+      folly::File file,
+      const MappedDiskVectorOptions& options) {
+    constexpr size_t initialSize = kInitialSize;
     static_assert(
         initialSize >= sizeof(Header) + sizeof(T),
         "Initial size must include enough space for the header and at least one element.");
@@ -411,15 +461,15 @@ class MappedDiskVector {
     }
 
     return MappedDiskVector{
-        std::move(file), initialSize, header.entryCount, false};
+        std::move(file), initialSize, header.entryCount, options};
   }
 
   explicit MappedDiskVector(
       folly::File file,
       off_t fileSize,
       size_t currentEntryCount,
-      bool populate)
-      : file_(std::move(file)) {
+      const MappedDiskVectorOptions& options)
+      : file_(std::move(file)), options_(options) {
     // It's worth keeping the file and mapping a whole number of pages to
     // avoid wasting an partial page at the end.  Note that this is an
     // optimization and it doesn't matter if kPageSize differs from the
@@ -437,16 +487,13 @@ class MappedDiskVector {
       }
     }
 
-    // Call readahead() here?  Offer it as optional functionality?
-    // InodeTable needs to traverse every record immediately after opening.
-
     auto map = mmap(
         0,
         desiredSize,
         PROT_READ | PROT_WRITE,
         MAP_SHARED
 #ifdef MAP_POPULATE
-            | (populate ? MAP_POPULATE : 0)
+            | (options_.populate ? MAP_POPULATE : 0)
 #endif
             ,
         file_.fd(),
@@ -455,10 +502,6 @@ class MappedDiskVector {
       folly::throwSystemError("mmap failed on file open");
     }
 
-#ifndef MAP_POPULATE
-    (void)populate;
-#endif
-
     // Throw no exceptions between assigning the fields.
 
     map_ = map;
@@ -473,6 +516,72 @@ class MappedDiskVector {
     CHECK_LE(
         reinterpret_cast<char*>(end_),
         static_cast<char*>(map_) + mapSizeInBytes_);
+
+    adviseMapping();
+  }
+
+  /**
+   * Resize the file to at least newFileSize bytes and remap it.
+   */
+  void grow(size_t newFileSize) {
+    size_t oldSize = size();
+    // Always keep the file size a whole number of pages.
+    newFileSize = detail::roundUpToNonzeroPageSize(newFileSize);
+    CHECK_GT(newFileSize, mapSizeInBytes_);
+
+    if (-1 == folly::ftruncateNoInt(file_.fd(), newFileSize)) {
+      folly::throwSystemError("ftruncateNoInt failed when growing capacity");
+    }
+
+#ifdef __APPLE__
+    auto newMap = mmap(
+        nullptr,
+        newFileSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        file_.fd(),
+        0);
+#else
+    auto newMap = mremap(map_, mapSizeInBytes_, newFileSize, MREMAP_MAYMOVE);
+#endif
+    if (newMap == MAP_FAILED) {
+      folly::throwSystemError(folly::to<std::string>(
+          "mremap failed when growing capacity from ",
+          mapSizeInBytes_,
+          " to ",
+          newFileSize));
+    }
+
+#ifdef __APPLE__
+    munmap(map_, mapSizeInBytes_);
+#endif
+    map_ = newMap;
+    mapSizeInBytes_ = newFileSize;
+
+    begin_ = reinterpret_cast<T*>(static_cast<Header*>(newMap) + 1);
+    end_ = begin_ + oldSize;
+
+    adviseMapping();
+  }
+
+  /**
+   * Apply options_ to the current mapping.  Failures only cost performance,
+   * so they are logged rather than thrown.
+   */
+  void adviseMapping() {
+    if (options_.advice != MADV_NORMAL &&
+        madvise(map_, mapSizeInBytes_, options_.advice) != 0) {
+      XLOG(WARNING) << "madvise(" << options_.advice
+                    << ") failed on MappedDiskVector: "
+                    << folly::errnoStr(errno);
+    }
+#ifdef MADV_HUGEPAGE
+    if (options_.hugePages &&
+        madvise(map_, mapSizeInBytes_, MADV_HUGEPAGE) != 0) {
+      XLOG(DBG2) << "huge pages are not available for MappedDiskVector: "
+                 << folly::errnoStr(errno);
+    }
+#endif
   }
 
   bool hasRoom(size_t amount) const {
@@ -519,6 +628,7 @@ class MappedDiskVector {
   size_t mapSizeInBytes_{0}; // must be nonzero, multiple of page size
 
   folly::File file_;
+  MappedDiskVectorOptions options_;
 
   template <typename T_, typename... OldVersions>
   friend struct detail::Migrator;
@@ -534,6 +644,7 @@ struct Migrator<T> {
       off_t /*fileSize*/,
       size_t /*currentEntryCount*/,
       size_t /*oldVersionIndex*/,
+      const MappedDiskVectorOptions& /*options*/,
       ConvertFn /*convert*/) {
     EDEN_BUG() << "oldVersionIndex >= sizeof...(OldVersions)";
   }
@@ -548,6 +659,7 @@ struct Migrator<T, First, Rest...> {
       off_t fileSize,
       size_t currentEntryCount,
       size_t oldVersionIndex,
+      const MappedDiskVectorOptions& options,
       ConvertFn convert) {
     using namespace folly::literals;
 
@@ -559,13 +671,15 @@ struct Migrator<T, First, Rest...> {
       // temporary file over the original.
       // Set populate to true because migrating requires reading every element
       // anyway.
+      MappedDiskVectorOptions originalOptions;
+      originalOptions.populate = true;
       MappedDiskVector<First> original{
-          std::move(file), fileSize, currentEntryCount, true};
+          std::move(file), fileSize, currentEntryCount, originalOptions};
 
       auto tmpPath = folly::to<std::string>(path, ".tmp");
-      auto newVector = MappedDiskVector<T>::createOrOverwrite(tmpPath);
+      auto newVector = MappedDiskVector<T>::createOrOverwrite(tmpPath, options);
       try {
-        // TODO: newVector.reserve
+        newVector.reserve(original.size());
         for (size_t i = 0; i < original.size(); ++i) {
           newVector.emplace_back(convert(original[i]));
         }
@@ -588,6 +702,7 @@ struct Migrator<T, First, Rest...> {
         fileSize,
         currentEntryCount,
         oldVersionIndex - 1,
+        options,
         [=](const auto& from) { return convert(First{from}); });
   }
 };
@@ -20,6 +20,7 @@
 #include <folly/String.h>
 #include <folly/hash/Hash.h>
 #include <optional>
+#include <string>
 #include <type_traits>
 
 namespace facebook {
@@ -303,9 +304,7 @@ class PathBase :
       typename = typename std::enable_if<
           std::is_same<StorageAlias, std::string>::value>::type>
   explicit PathBase(std::string&& str, SkipPathSanityCheck)
-      : path_(std::move(str)) {
-    SanityChecker()(path_);
-  }
+      : path_(std::move(str)) {}
 
   /// Return the path as a StringPiece
   folly::StringPiece stringPiece() const {
@@ -348,20 +347,21 @@ class PathBase :
 /// Asserts that val is a well formed path component
 struct PathComponentSanityCheck {
   constexpr void operator()(folly::StringPiece val) const {
-    for (auto c : val) {
-      if (c == kDirSeparator
+    // char_traits::find() is still constexpr for _pc literals, but at runtime
+    // it is memchr(), which is much faster than a loop over the bytes.
+    using traits = std::char_traits<char>;
+    if (traits::find(val.data(), val.size(), kDirSeparator) != nullptr
 #ifdef _WIN32
-          // On Windows we should also check if we have missed a Windows path
-          // separator. We have function to convert from Windows widechar paths
-          // to path component.
-          || (c == '\\')
+        // On Windows we should also check if we have missed a Windows path
+        // separator. We have function to convert from Windows widechar paths
+        // to path component.
+        || traits::find(val.data(), val.size(), '\\') != nullptr
 #endif
-      ) {
-        throw std::domain_error(folly::to<std::string>(
-            "attempt to construct a PathComponent from a string containing a "
-            "directory separator: ",
-            val));
-      }
+    ) {
+      throw std::domain_error(folly::to<std::string>(
+          "attempt to construct a PathComponent from a string containing a "
+          "directory separator: ",
+          val));
     }
 
     if (val.empty()) {
@@ -139,6 +139,7 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
   using Vector::max_size;
   using Vector::rbegin;
   using Vector::rend;
+  using Vector::reserve;
   using Vector::size;
 
   // Swap contents with another map.
@@ -223,6 +224,12 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
    * a boolean that is true if an insert took place. */
   template <typename... Args>
   std::pair<iterator, bool> emplace(Piece key, Args&&... args) {
+    // Keys that sort after all the others, as they do when the map is built
+    // from an already sorted list, can be appended without a search.
+    if (empty() || compare_(Vector::back().first, key)) {
+      Vector::emplace_back(Key(key), Value(std::forward<Args>(args)...));
+      return std::make_pair(std::prev(end()), true);
+    }
     auto iter = lower_bound(key);
     if (iter == end() || compare_(key, iter->first)) {
       iter = Vector::emplace(
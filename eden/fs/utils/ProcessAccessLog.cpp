@@ -126,13 +126,14 @@ void ProcessAccessLog::Bucket::add(
 }
 
 void ProcessAccessLog::Bucket::merge(const Bucket& other) {
-  for (auto [pid, otherAccessCounts] : other.accessCountsByPid) {
+  for (const auto& [pid, otherAccessCounts] : other.accessCountsByPid) {
+    auto& accessCounts = accessCountsByPid[pid];
     for (std::underlying_type_t<AccessType> type = 0;
          type != folly::to_underlying(AccessType::Last);
          type++) {
-      accessCountsByPid[pid].counts[type] += otherAccessCounts.counts[type];
+      accessCounts.counts[type] += otherAccessCounts.counts[type];
     }
-    accessCountsByPid[pid].duration += otherAccessCounts.duration;
+    accessCounts.duration += otherAccessCounts.duration;
   }
 }
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/ProcessConcurrencyLimiter.h"
+
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include <utility>
+
+namespace facebook {
+namespace eden {
+
+ProcessConcurrencyLimiter::Slot::Slot(Slot&& other) noexcept
+    : limiter_{std::exchange(other.limiter_, nullptr)}, pid_{other.pid_} {}
+
+ProcessConcurrencyLimiter::Slot& ProcessConcurrencyLimiter::Slot::operator=(
+    Slot&& other) noexcept {
+  if (this != &other) {
+    release();
+    limiter_ = std::exchange(other.limiter_, nullptr);
+    pid_ = other.pid_;
+  }
+  return *this;
+}
+
+ProcessConcurrencyLimiter::Slot::~Slot() {
+  release();
+}
+
+void ProcessConcurrencyLimiter::Slot::release() noexcept {
+  if (auto* limiter = std::exchange(limiter_, nullptr)) {
+    limiter->release(pid_);
+  }
+}
+
+ProcessConcurrencyLimiter::ProcessConcurrencyLimiter(size_t limit)
+    : limit_{std::max<size_t>(limit, 1)} {}
+
+folly::Future<ProcessConcurrencyLimiter::Slot>
+ProcessConcurrencyLimiter::acquire(pid_t pid) {
+  auto processes = processes_.wlock();
+  auto& process = (*processes)[pid];
+  if (process.running < limit_) {
+    ++process.running;
+    return folly::makeFuture(Slot{this, pid});
+  }
+  process.waiting.emplace_back();
+  ++waitingCount_;
+  return process.waiting.back().getFuture();
+}
+
+void ProcessConcurrencyLimiter::release(pid_t pid) noexcept {
+  folly::Promise<Slot> next;
+  {
+    auto processes = processes_.wlock();
+    auto it = processes->find(pid);
+    if (it == processes->end()) {
+      XLOG(DFATAL) << "released a slot for process " << pid
+                   << " which has none";
+      return;
+    }
+    auto& process = it->second;
+    if (process.waiting.empty()) {
+      if (--process.running == 0) {
+        processes->erase(it);
+      }
+      return;
+    }
+    // Hand this slot straight to the next waiting request, so running does
+    // not change.
+    next = std::move(process.waiting.front());
+    process.waiting.pop_front();
+    --waitingCount_;
+  }
+  // Outside the lock, since this runs the waiting request's continuation.
+  next.setValue(Slot{this, pid});
+}
+
+size_t ProcessConcurrencyLimiter::getWaitingCount() const {
+  return waitingCount_.load(std::memory_order_relaxed);
+}
+
+} // namespace eden
+} // namespace facebook
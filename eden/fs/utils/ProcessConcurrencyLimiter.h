@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/futures/Future.h>
+#include <sys/types.h>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Limits how many requests each process may have in progress at once.
+ *
+ * A request beyond its process's limit waits until one of that process's
+ * earlier requests finishes, and a process's waiting requests are admitted in
+ * the order they arrived.  So a process issuing requests faster than they can
+ * be served only delays itself, rather than growing the queues that every
+ * other process's requests wait in.
+ */
+class ProcessConcurrencyLimiter {
+ public:
+  /**
+   * Held for as long as a request is in progress.  Destroying it lets the
+   * process's next request in.
+   */
+  class Slot {
+   public:
+    Slot() = default;
+    Slot(Slot&& other) noexcept;
+    Slot& operator=(Slot&& other) noexcept;
+    ~Slot();
+
+   private:
+    friend class ProcessConcurrencyLimiter;
+    Slot(ProcessConcurrencyLimiter* limiter, pid_t pid)
+        : limiter_{limiter}, pid_{pid} {}
+
+    void release() noexcept;
+
+    ProcessConcurrencyLimiter* limiter_{nullptr};
+    pid_t pid_{0};
+  };
+
+  /**
+   * limit is the number of requests each process may have in progress.  It
+   * must be at least 1.
+   */
+  explicit ProcessConcurrencyLimiter(size_t limit);
+
+  ProcessConcurrencyLimiter(const ProcessConcurrencyLimiter&) = delete;
+  ProcessConcurrencyLimiter& operator=(const ProcessConcurrencyLimiter&) =
+      delete;
+
+  /**
+   * Returns a ready future if pid has fewer than the limit in progress.
+   * Otherwise the future completes, on the thread that releases the slot it
+   * is given, once the requests pid made before it have made room.
+   *
+   * The limiter must outlive every slot it hands out.
+   */
+  folly::Future<Slot> acquire(pid_t pid);
+
+  /**
+   * The number of requests, across all processes, waiting for a slot.
+   */
+  size_t getWaitingCount() const;
+
+ private:
+  struct Process {
+    size_t running{0};
+    std::deque<folly::Promise<Slot>> waiting;
+  };
+
+  void release(pid_t pid) noexcept;
+
+  const size_t limit_;
+  folly::Synchronized<std::unordered_map<pid_t, Process>> processes_;
+  std::atomic<size_t> waitingCount_{0};
+};
+
+} // namespace eden
+} // namespace facebook
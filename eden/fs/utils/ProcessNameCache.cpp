@@ -12,6 +12,8 @@
 
 #include <folly/FileUtil.h>
 #include <folly/MapUtil.h>
+#include <folly/Range.h>
+#include <folly/futures/Future.h>
 #include <folly/system/ThreadName.h>
 
 #include "eden/fs/utils/Synchronized.h"
@@ -179,8 +181,14 @@ std::string readPidName(pid_t pid) {
 namespace facebook {
 namespace eden {
 
-ProcessNameCache::ProcessNameCache(std::chrono::nanoseconds expiry)
-    : expiry_{expiry}, startPoint_{std::chrono::steady_clock::now()} {
+ProcessNameCache::ProcessNameCache(
+    std::chrono::nanoseconds expiry,
+    std::chrono::nanoseconds refreshInterval,
+    std::chrono::nanoseconds failedLookupExpiry)
+    : expiry_{expiry},
+      refreshInterval_{refreshInterval},
+      failedLookupExpiry_{failedLookupExpiry},
+      startPoint_{std::chrono::steady_clock::now()} {
   workerThread_ = std::thread{[this] {
     folly::setThreadName("ProcessNameCacheWorker");
     processActions();
@@ -235,7 +243,7 @@ void ProcessNameCache::add(pid_t pid) {
       state_,
       [&](const auto& state) -> std::optional<folly::Unit> {
         auto entry = folly::get_ptr(state.names, pid);
-        if (entry) {
+        if (entry && now < entry->refreshAfter) {
           entry->lastAccess.store(now, std::memory_order_seq_cst);
           return folly::unit;
         }
@@ -252,14 +260,27 @@ void ProcessNameCache::add(pid_t pid) {
       });
 }
 
-std::map<pid_t, std::string> ProcessNameCache::getAllProcessNames() {
+std::map<pid_t, std::string> ProcessNameCache::getAllProcessNames(
+    std::chrono::milliseconds maxWait) {
   auto [promise, future] =
       folly::makePromiseContract<std::map<pid_t, std::string>>();
 
   state_.wlock()->getQueue.emplace_back(std::move(promise));
   sem_.post();
 
-  return std::move(future).get();
+  try {
+    return std::move(future).get(maxWait);
+  } catch (const folly::FutureTimeout&) {
+    // The background thread is busy.  The promise is fulfilled whenever the
+    // thread gets to it, or broken if the cache is destroyed first.
+  }
+
+  std::map<pid_t, std::string> allProcessNames;
+  auto state = state_.rlock();
+  for (const auto& [pid, name] : state->names) {
+    allProcessNames[pid] = name.name;
+  }
+  return allProcessNames;
 }
 
 void ProcessNameCache::clearExpired(
@@ -292,10 +313,8 @@ void ProcessNameCache::processActions() {
     {
       auto state = state_.wlock();
       if (state->workerThreadShouldStop) {
-        // Shutdown is only initiated by the destructor and since gets
-        // are blocking, this implies no gets can be pending.
-        CHECK(state->getQueue.empty())
-            << "ProcessNameCache destroyed while gets were pending!";
+        // Shutdown is only initiated by the destructor, so any gets still
+        // pending have given up waiting.
         return;
       }
 
@@ -319,18 +338,26 @@ void ProcessNameCache::processActions() {
     //
     // As described in ProcessNameCache::add() above, it is critical this work
     // be done outside of the state lock.
+    //
+    // All of the queued pids are read in one pass, and inserted under a
+    // single acquisition of the lock.
     std::vector<std::pair<pid_t, std::string>> addedNames;
+    addedNames.reserve(addQueue.size());
     for (auto pid : addQueue) {
       addedNames.emplace_back(pid, detail::readPidName(pid));
     }
 
     auto now = std::chrono::steady_clock::now() - startPoint_;
 
-    // Now insert any new names into the synchronized data structure.
+    // Now insert any new names into the synchronized data structure,
+    // replacing the stale names of pids that were read again.
     if (!addedNames.empty()) {
       auto state = state_.wlock();
       for (auto& [pid, name] : addedNames) {
-        state->names.emplace(pid, ProcessName{std::move(name), now});
+        auto failed = folly::StringPiece{name}.startsWith("<err:");
+        auto ttl = failed ? failedLookupExpiry_ : refreshInterval_;
+        state->names.insert_or_assign(
+            pid, ProcessName{std::move(name), now, ttl});
       }
 
       // Bump the water level by two so that it's guaranteed to catch up.
@@ -366,10 +393,13 @@ void ProcessNameCache::processActions() {
 }
 
 std::optional<std::string> ProcessNameCache::getProcessName(pid_t pid) {
-  auto state = state_.rlock();
-  if (auto* processName = folly::get_ptr(state->names, pid)) {
-    return processName->name;
+  {
+    auto state = state_.rlock();
+    if (auto* processName = folly::get_ptr(state->names, pid)) {
+      return processName->name;
+    }
   }
+  add(pid);
   return std::nullopt;
 }
 
@@ -25,9 +25,16 @@ class ProcessNameCache {
   /**
    * Create a cache that maintains process names until `expiry` has elapsed
    * without them being referenced or observed.
+   *
+   * Pids are reused as short-lived processes come and go, so a name that has
+   * been known for `refreshInterval` is read again the next time its pid is
+   * referenced.  Names that could not be read, usually because the process
+   * had already exited, are only trusted for `failedLookupExpiry`.
    */
   explicit ProcessNameCache(
-      std::chrono::nanoseconds expiry = std::chrono::minutes{5});
+      std::chrono::nanoseconds expiry = std::chrono::minutes{5},
+      std::chrono::nanoseconds refreshInterval = std::chrono::seconds{30},
+      std::chrono::nanoseconds failedLookupExpiry = std::chrono::seconds{1});
 
   ~ProcessNameCache();
 
@@ -44,31 +51,46 @@ class ProcessNameCache {
   /**
    * Called rarely to produce a map of all non-expired pids to their executable
    * names.
+   *
+   * This waits for the names of the pids already added to be read, but for no
+   * longer than `maxWait`.  If the background thread is slower than that, for
+   * example because a read of /proc is stuck, this returns the names that are
+   * known so far.
    */
-  std::map<pid_t, std::string> getAllProcessNames();
+  std::map<pid_t, std::string> getAllProcessNames(
+      std::chrono::milliseconds maxWait = std::chrono::seconds{1});
 
   /**
    * Called occassionally to produce the command line name of the pid. If the
-   * name has already been resolved this returns that name. Otherwise this will
-   * return nullopt. In the future it may wait for the name to be resolved.
+   * name has already been resolved this returns that name. Otherwise this
+   * returns nullopt without waiting, and queues the pid so that its name is
+   * known by a later call.
    */
   std::optional<std::string> getProcessName(pid_t pid);
 
  private:
   struct ProcessName {
-    ProcessName(std::string n, std::chrono::steady_clock::duration d)
-        : name{std::move(n)}, lastAccess{d} {}
+    ProcessName(
+        std::string n,
+        std::chrono::steady_clock::duration d,
+        std::chrono::nanoseconds ttl)
+        : name{std::move(n)}, lastAccess{d}, refreshAfter{d + ttl} {}
     ProcessName(ProcessName&& other) noexcept
-        : name{std::move(other.name)}, lastAccess{other.lastAccess.load()} {}
+        : name{std::move(other.name)},
+          lastAccess{other.lastAccess.load()},
+          refreshAfter{other.refreshAfter} {}
 
     ProcessName& operator=(ProcessName&& other) noexcept {
       name = std::move(other.name);
       lastAccess.store(other.lastAccess.load());
+      refreshAfter = other.refreshAfter;
       return *this;
     }
 
     std::string name;
     mutable std::atomic<std::chrono::steady_clock::duration> lastAccess;
+    /** When add() should read the name again. */
+    std::chrono::steady_clock::duration refreshAfter;
   };
 
   struct State {
@@ -88,6 +110,8 @@ class ProcessNameCache {
   void processActions();
 
   const std::chrono::nanoseconds expiry_;
+  const std::chrono::nanoseconds refreshInterval_;
+  const std::chrono::nanoseconds failedLookupExpiry_;
   const std::chrono::steady_clock::time_point startPoint_;
   folly::Synchronized<State> state_;
   folly::LifoSem sem_;
@@ -9,24 +9,77 @@
 
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/ManualExecutor.h>
-#include <folly/executors/task_queue/UnboundedBlockingQueue.h>
+#include <folly/executors/task_queue/PriorityUnboundedBlockingQueue.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include "eden/fs/utils/WorkStealingExecutor.h"
 
 namespace facebook {
 namespace eden {
 
+namespace {
+/** High, normal, and low. */
+constexpr uint8_t kNumPriorities = 3;
+} // namespace
+
 UnboundedQueueExecutor::UnboundedQueueExecutor(
     size_t threadCount,
-    folly::StringPiece threadNamePrefix)
-    : executor_{std::make_unique<folly::CPUThreadPoolExecutor>(
-          threadCount,
-          std::make_unique<folly::UnboundedBlockingQueue<
-              folly::CPUThreadPoolExecutor::CPUTask>>(),
-          std::make_unique<folly::NamedThreadFactory>(threadNamePrefix))} {}
+    folly::StringPiece threadNamePrefix) {
+  auto threadPool = std::make_shared<folly::CPUThreadPoolExecutor>(
+      threadCount,
+      std::make_unique<folly::PriorityUnboundedBlockingQueue<
+          folly::CPUThreadPoolExecutor::CPUTask>>(kNumPriorities),
+      std::make_unique<folly::NamedThreadFactory>(threadNamePrefix));
+  threadPool->subscribeToTaskStats(
+      [this](const folly::ThreadPoolExecutor::TaskStats& stats) {
+        recentQueueWait_.store(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(stats.waitTime)
+                .count(),
+            std::memory_order_relaxed);
+      });
+  threadPool_ = threadPool.get();
+  executor_ = std::move(threadPool);
+}
+
+UnboundedQueueExecutor::UnboundedQueueExecutor(
+    std::shared_ptr<WorkStealingExecutor> executor)
+    : workStealing_{executor.get()} {
+  executor_ = std::move(executor);
+}
 
 UnboundedQueueExecutor::UnboundedQueueExecutor(
     std::shared_ptr<folly::ManualExecutor> executor)
     : executor_{std::move(executor)} {}
 
+void UnboundedQueueExecutor::addWithPriority(
+    folly::Func func,
+    int8_t priority) {
+  // folly::Executor::addWithPriority throws for executors without priorities.
+  if (executor_->getNumPriorities() > 1) {
+    executor_->addWithPriority(std::move(func), priority);
+  } else {
+    executor_->add(std::move(func));
+  }
+}
+
+void UnboundedQueueExecutor::setNumThreads(size_t threadCount) {
+  if (threadPool_ && threadPool_->numThreads() != threadCount) {
+    threadPool_->setNumThreads(threadCount);
+  }
+}
+
+size_t UnboundedQueueExecutor::getPendingTaskCount() const {
+  if (threadPool_) {
+    return threadPool_->getPoolStats().pendingTaskCount;
+  }
+  if (workStealing_) {
+    return workStealing_->getPendingTaskCount();
+  }
+  return 0;
+}
+
+uint64_t UnboundedQueueExecutor::getStealCount() const {
+  return workStealing_ ? workStealing_->getStealCount() : 0;
+}
+
 } // namespace eden
 } // namespace facebook
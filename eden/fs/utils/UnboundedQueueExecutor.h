@@ -9,20 +9,30 @@
 
 #include <folly/Executor.h>
 #include <folly/Range.h>
+#include <atomic>
+#include <chrono>
 
 namespace folly {
 class ManualExecutor;
-}
+class ThreadPoolExecutor;
+} // namespace folly
 
 namespace facebook {
 namespace eden {
 
+class WorkStealingExecutor;
+
 /**
  * An Executor that is guaranteed to never block, nor throw (except OOM), nor
  * execute inline from `add()`.
  *
  * Parts of Eden rely on queuing a function to be non-blocking for deadlock
  * safety.
+ *
+ * The thread pool it creates has three priorities: tasks added with a
+ * priority above folly::Executor::MID_PRI run before those added with add(),
+ * which run before those added with a priority below it.  Other executors
+ * ignore priorities.
  */
 class UnboundedQueueExecutor : public folly::Executor {
  public:
@@ -34,6 +44,13 @@ class UnboundedQueueExecutor : public folly::Executor {
       size_t threadCount,
       folly::StringPiece threadNamePrefix);
 
+  /**
+   * Instantiates with a WorkStealingExecutor, which gives each thread a queue
+   * of its own rather than one queue shared by all of them.
+   */
+  explicit UnboundedQueueExecutor(
+      std::shared_ptr<WorkStealingExecutor> executor);
+
   /**
    * ManualExecutors are unbounded too.
    *
@@ -51,8 +68,51 @@ class UnboundedQueueExecutor : public folly::Executor {
     executor_->add(std::move(func));
   }
 
+  void addWithPriority(folly::Func func, int8_t priority) override;
+
+  uint8_t getNumPriorities() const override {
+    return executor_->getNumPriorities();
+  }
+
+  /**
+   * Grows or shrinks the thread pool.  Threads being removed finish the task
+   * they are running first.  Does nothing for a ManualExecutor or a
+   * WorkStealingExecutor, whose thread count is fixed.
+   */
+  void setNumThreads(size_t threadCount);
+
+  /**
+   * The number of tasks waiting for a thread.  Always 0 for a
+   * ManualExecutor.
+   */
+  size_t getPendingTaskCount() const;
+
+  /**
+   * The number of tasks that a thread of a WorkStealingExecutor took from
+   * another thread's queue.  Always 0 for other executors.
+   */
+  uint64_t getStealCount() const;
+
+  /**
+   * How long the task that most recently finished on the thread pool waited
+   * for a thread to start it.  Always 0 for other executors.
+   */
+  std::chrono::nanoseconds getRecentQueueWait() const {
+    return std::chrono::nanoseconds{
+        recentQueueWait_.load(std::memory_order_relaxed)};
+  }
+
  private:
+  /**
+   * In nanoseconds.  Declared before executor_ since the thread pool's
+   * threads update it until they are joined.
+   */
+  std::atomic<int64_t> recentQueueWait_{0};
   std::shared_ptr<folly::Executor> executor_;
+  /** executor_, if it is a thread pool, otherwise null. */
+  folly::ThreadPoolExecutor* threadPool_{nullptr};
+  /** executor_, if it is a WorkStealingExecutor, otherwise null. */
+  WorkStealingExecutor* workStealing_{nullptr};
 };
 
 } // namespace eden
@@ -6,26 +6,118 @@
  */
 
 #include "eden/fs/utils/Utf8.h"
+
+#include <cstring>
+
 #include <folly/Unicode.h>
 
 namespace facebook {
 namespace eden {
 
+namespace {
+/**
+ * Returns a pointer to the first byte in [begin, end) that is not ASCII.
+ *
+ * Paths are almost always entirely ASCII, so this checks a word at a time,
+ * and 32 bytes per iteration while it can.
+ */
+const unsigned char* skipAscii(
+    const unsigned char* begin,
+    const unsigned char* const end) {
+  constexpr uint64_t kHighBits = 0x8080808080808080;
+  while (end - begin >= 32) {
+    uint64_t words[4];
+    std::memcpy(words, begin, sizeof(words));
+    if ((words[0] | words[1] | words[2] | words[3]) & kHighBits) {
+      break;
+    }
+    begin += 32;
+  }
+  while (end - begin >= 8) {
+    uint64_t word;
+    std::memcpy(&word, begin, sizeof(word));
+    if (word & kHighBits) {
+      break;
+    }
+    begin += 8;
+  }
+  while (begin != end && *begin < 0x80) {
+    ++begin;
+  }
+  return begin;
+}
+
+/**
+ * Returns the length of the well-formed UTF-8 sequence at begin, or 0 if it
+ * is not one.  This follows the table of well-formed byte sequences in the
+ * Unicode standard, which rules out overlong encodings, surrogates and code
+ * points past U+10FFFF.
+ */
+size_t wellFormedSequenceLength(
+    const unsigned char* begin,
+    const unsigned char* const end) {
+  auto lead = begin[0];
+  size_t length;
+  // The range of the second byte, which is narrower for some lead bytes.
+  unsigned char low = 0x80;
+  unsigned char high = 0xbf;
+  if (lead < 0x80) {
+    return 1;
+  } else if (lead < 0xc2) {
+    return 0;
+  } else if (lead < 0xe0) {
+    length = 2;
+  } else if (lead < 0xf0) {
+    length = 3;
+    if (lead == 0xe0) {
+      low = 0xa0;
+    } else if (lead == 0xed) {
+      high = 0x9f;
+    }
+  } else if (lead < 0xf5) {
+    length = 4;
+    if (lead == 0xf0) {
+      low = 0x90;
+    } else if (lead == 0xf4) {
+      high = 0x8f;
+    }
+  } else {
+    return 0;
+  }
+
+  if (static_cast<size_t>(end - begin) < length) {
+    return 0;
+  }
+  if (begin[1] < low || begin[1] > high) {
+    return 0;
+  }
+  for (size_t i = 2; i < length; ++i) {
+    if ((begin[i] & 0xc0) != 0x80) {
+      return 0;
+    }
+  }
+  return length;
+}
+} // namespace
+
 bool isValidUtf8(folly::ByteRange str) {
   const unsigned char* begin = str.begin();
   const unsigned char* const end = str.end();
-  while (begin != end) {
-    // TODO: utf8ToCodePoint's signature means we're unable to distinguish
-    // between an invalid encoding and an encoding with a replacement character.
-    // Fortunately, replacement characters are uncommon.
-    if (U'\ufffd' == folly::utf8ToCodePoint(begin, end, true)) {
+  while ((begin = skipAscii(begin, end)) != end) {
+    auto length = wellFormedSequenceLength(begin, end);
+    if (length == 0) {
       return false;
     }
+    begin += length;
   }
   return true;
 }
 
 std::string ensureValidUtf8(folly::ByteRange str) {
+  if (isValidUtf8(str)) {
+    return std::string{str.begin(), str.end()};
+  }
+
   std::string output;
   output.reserve(str.size());
 
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/WorkStealingExecutor.h"
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/lang/Align.h>
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace facebook {
+namespace eden {
+
+struct alignas(folly::hardware_destructive_interference_size)
+    WorkStealingExecutor::Worker {
+  std::mutex mutex;
+  std::deque<folly::Func> tasks;
+  /** tasks.size(), readable without the mutex to skip empty queues. */
+  std::atomic<size_t> size{0};
+  std::atomic<uint64_t> steals{0};
+
+  size_t numaNode{0};
+  /** The CPUs this thread is pinned to, or empty if it is not pinned. */
+  std::vector<size_t> cpus;
+  /** The other workers, those on the same NUMA node first. */
+  std::vector<size_t> victims;
+  std::thread thread;
+};
+
+namespace {
+struct CurrentWorker {
+  const WorkStealingExecutor* executor{nullptr};
+  size_t index{0};
+};
+
+thread_local CurrentWorker currentWorker;
+
+/**
+ * Returns the CPUs of each NUMA node, or an empty vector if the topology
+ * cannot be read.
+ */
+std::vector<std::vector<size_t>> readNumaNodes() {
+  std::vector<std::vector<size_t>> result;
+#ifdef __linux__
+  std::string contents;
+  if (!folly::readFile("/sys/devices/system/node/online", contents)) {
+    return result;
+  }
+  auto nodes = detail::parseCpuList(contents);
+  if (!nodes) {
+    return result;
+  }
+  for (auto node : *nodes) {
+    auto path = folly::to<std::string>(
+        "/sys/devices/system/node/node", node, "/cpulist");
+    if (!folly::readFile(path.c_str(), contents)) {
+      return {};
+    }
+    auto cpus = detail::parseCpuList(contents);
+    if (!cpus) {
+      return {};
+    }
+    // A node with memory but no CPUs has no use for threads.
+    if (!cpus->empty()) {
+      result.push_back(std::move(*cpus));
+    }
+  }
+#endif
+  return result;
+}
+
+void pinCurrentThread(const std::vector<size_t>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  auto error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (error) {
+    XLOG(WARN) << "unable to pin thread to its NUMA node: "
+               << folly::errnoStr(error);
+  }
+#else
+  (void)cpus;
+#endif
+}
+} // namespace
+
+WorkStealingExecutor::WorkStealingExecutor(
+    size_t threadCount,
+    folly::StringPiece threadNamePrefix,
+    bool pinToNumaNodes) {
+  threadCount = std::max<size_t>(threadCount, 1);
+
+  std::vector<std::vector<size_t>> nodes;
+  if (pinToNumaNodes) {
+    nodes = readNumaNodes();
+    if (nodes.size() < 2) {
+      nodes.clear();
+    }
+  }
+
+  workers_.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    auto worker = std::make_unique<Worker>();
+    if (!nodes.empty()) {
+      worker->numaNode = i % nodes.size();
+      worker->cpus = nodes[worker->numaNode];
+    }
+    workers_.push_back(std::move(worker));
+  }
+
+  // Visit the other workers starting after this one, so that idle threads
+  // do not all steal from the same queue.
+  for (size_t i = 0; i < threadCount; ++i) {
+    auto& victims = workers_[i]->victims;
+    for (size_t offset = 1; offset < threadCount; ++offset) {
+      auto victim = (i + offset) % threadCount;
+      if (workers_[victim]->numaNode == workers_[i]->numaNode) {
+        victims.push_back(victim);
+      }
+    }
+    for (size_t offset = 1; offset < threadCount; ++offset) {
+      auto victim = (i + offset) % threadCount;
+      if (workers_[victim]->numaNode != workers_[i]->numaNode) {
+        victims.push_back(victim);
+      }
+    }
+  }
+
+  folly::NamedThreadFactory threadFactory{threadNamePrefix};
+  for (size_t i = 0; i < threadCount; ++i) {
+    workers_[i]->thread = threadFactory.newThread([this, i] { run(i); });
+  }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  {
+    std::lock_guard<std::mutex> lock{idleMutex_};
+    stopping_ = true;
+  }
+  idleCondition_.notify_all();
+  for (auto& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+void WorkStealingExecutor::add(folly::Func func) {
+  size_t index;
+  if (currentWorker.executor == this) {
+    index = currentWorker.index;
+  } else {
+    index = nextWorker_.fetch_add(1, std::memory_order_relaxed) %
+        workers_.size();
+  }
+
+  auto& worker = *workers_[index];
+  {
+    std::lock_guard<std::mutex> lock{worker.mutex};
+    worker.tasks.push_back(std::move(func));
+    worker.size.store(worker.tasks.size(), std::memory_order_relaxed);
+  }
+
+  // A thread going idle increments idleWorkers_ before it checks pending_,
+  // so either it sees this task or this sees it and wakes it.
+  pending_.fetch_add(1);
+  if (idleWorkers_.load() > 0) {
+    { std::lock_guard<std::mutex> lock{idleMutex_}; }
+    idleCondition_.notify_one();
+  }
+}
+
+bool WorkStealingExecutor::take(size_t index, folly::Func& func) {
+  auto takeFront = [&func](Worker& worker) {
+    if (worker.size.load(std::memory_order_relaxed) == 0) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock{worker.mutex};
+    if (worker.tasks.empty()) {
+      return false;
+    }
+    func = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    worker.size.store(worker.tasks.size(), std::memory_order_relaxed);
+    return true;
+  };
+
+  auto& self = *workers_[index];
+  if (takeFront(self)) {
+    return true;
+  }
+  for (auto victim : self.victims) {
+    if (takeFront(*workers_[victim])) {
+      self.steals.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingExecutor::run(size_t index) {
+  currentWorker.executor = this;
+  currentWorker.index = index;
+  if (!workers_[index]->cpus.empty()) {
+    pinCurrentThread(workers_[index]->cpus);
+  }
+
+  while (true) {
+    folly::Func func;
+    if (take(index, func)) {
+      pending_.fetch_sub(1);
+      try {
+        func();
+      } catch (const std::exception& ex) {
+        XLOG(ERR) << "WorkStealingExecutor task threw: "
+                  << folly::exceptionStr(ex);
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{idleMutex_};
+    ++idleWorkers_;
+    idleCondition_.wait(
+        lock, [this] { return pending_.load() > 0 || stopping_; });
+    --idleWorkers_;
+    if (stopping_ && pending_.load() <= 0) {
+      return;
+    }
+  }
+}
+
+size_t WorkStealingExecutor::getPendingTaskCount() const {
+  auto pending = pending_.load(std::memory_order_relaxed);
+  return pending > 0 ? static_cast<size_t>(pending) : 0;
+}
+
+uint64_t WorkStealingExecutor::getStealCount() const {
+  uint64_t steals = 0;
+  for (auto& worker : workers_) {
+    steals += worker->steals.load(std::memory_order_relaxed);
+  }
+  return steals;
+}
+
+std::vector<size_t> WorkStealingExecutor::getThreadNumaNodes() const {
+  std::vector<size_t> nodes;
+  nodes.reserve(workers_.size());
+  for (auto& worker : workers_) {
+    nodes.push_back(worker->numaNode);
+  }
+  return nodes;
+}
+
+namespace detail {
+std::optional<std::vector<size_t>> parseCpuList(folly::StringPiece list) {
+  std::vector<size_t> result;
+  list = folly::trimWhitespace(list);
+  if (list.empty()) {
+    return result;
+  }
+
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', list, ranges);
+  for (auto range : ranges) {
+    auto dash = range.find('-');
+    auto first = folly::tryTo<size_t>(range.subpiece(0, dash));
+    if (!first.hasValue()) {
+      return std::nullopt;
+    }
+    auto last = first;
+    if (dash != folly::StringPiece::npos) {
+      last = folly::tryTo<size_t>(range.subpiece(dash + 1));
+      if (!last.hasValue() || last.value() < first.value()) {
+        return std::nullopt;
+      }
+    }
+    for (auto cpu = first.value(); cpu <= last.value(); ++cpu) {
+      result.push_back(cpu);
+    }
+  }
+  return result;
+}
+} // namespace detail
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Executor.h>
+#include <folly/Range.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * An Executor whose threads each have a queue of their own.
+ *
+ * A task added from one of the executor's threads goes on that thread's
+ * queue, so a continuation tends to run on the thread, and in the cache, that
+ * produced its inputs.  Tasks added from other threads are spread across the
+ * queues round-robin.  A thread whose queue is empty takes the oldest task
+ * from another thread's queue, trying the threads on its own NUMA node first.
+ *
+ * Like UnboundedQueueExecutor, add() never blocks waiting for space, never
+ * throws (except OOM), and never runs the task inline.  Tasks on one queue
+ * start in the order they were added, but there is no order across queues.
+ */
+class WorkStealingExecutor : public folly::Executor {
+ public:
+  /**
+   * If pinToNumaNodes is set and the machine has more than one NUMA node, the
+   * threads are spread evenly across the nodes and each is pinned to the CPUs
+   * of its node.  Pinning is only supported on Linux.
+   */
+  WorkStealingExecutor(
+      size_t threadCount,
+      folly::StringPiece threadNamePrefix,
+      bool pinToNumaNodes = false);
+
+  /**
+   * Runs every task that has been added, including those added by the tasks
+   * themselves, and then joins the threads.
+   */
+  ~WorkStealingExecutor() override;
+
+  WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+  WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+  WorkStealingExecutor(WorkStealingExecutor&&) = delete;
+  WorkStealingExecutor& operator=(WorkStealingExecutor&&) = delete;
+
+  void add(folly::Func func) override;
+
+  size_t getThreadCount() const {
+    return workers_.size();
+  }
+
+  /**
+   * The number of tasks that have been added and not yet started.
+   */
+  size_t getPendingTaskCount() const;
+
+  /**
+   * The number of tasks that a thread took from another thread's queue.
+   */
+  uint64_t getStealCount() const;
+
+  /**
+   * The NUMA node that each thread is pinned to, which is 0 for every thread
+   * that is not pinned.
+   */
+  std::vector<size_t> getThreadNumaNodes() const;
+
+ private:
+  struct Worker;
+
+  void run(size_t index);
+  bool take(size_t index, folly::Func& func);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> nextWorker_{0};
+  /**
+   * Incremented after a task is queued and decremented after it is taken, so
+   * it can briefly be negative.
+   */
+  std::atomic<int64_t> pending_{0};
+
+  std::mutex idleMutex_;
+  std::condition_variable idleCondition_;
+  /** The number of threads waiting on idleCondition_. */
+  std::atomic<size_t> idleWorkers_{0};
+  /** Protected by idleMutex_. */
+  bool stopping_{false};
+};
+
+namespace detail {
+/**
+ * Parses a Linux CPU or node list, such as "0-3,8,10-11", as found in
+ * /sys/devices/system/node.  Returns std::nullopt if it is malformed.
+ */
+std::optional<std::vector<size_t>> parseCpuList(folly::StringPiece list);
+} // namespace detail
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/ChunkedPathMap.h"
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+using facebook::eden::ChunkedPathMap;
+using facebook::eden::PathComponent;
+using facebook::eden::PathComponentPiece;
+using namespace facebook::eden::path_literals;
+
+namespace {
+// A tiny chunk size so that the tests exercise splitting and merging.
+template <typename Value>
+using SmallChunkMap = ChunkedPathMap<Value, PathComponent, 4>;
+
+PathComponent numberedName(int i) {
+  // Zero pad so that the names sort in numeric order.
+  auto name = folly::to<std::string>(i);
+  return PathComponent{std::string(4 - name.size(), '0') + name};
+}
+} // namespace
+
+TEST(ChunkedPathMap, insert) {
+  ChunkedPathMap<bool> map;
+
+  EXPECT_TRUE(map.empty());
+
+  map.insert(std::make_pair(PathComponent("foo"), true));
+  EXPECT_EQ(1, map.size());
+  EXPECT_NE(map.end(), map.find("foo"_pc));
+  EXPECT_TRUE(map.at("foo"_pc));
+  EXPECT_TRUE(map["foo"_pc]);
+
+  // operator[] creates an entry for missing key
+  map["bar"_pc] = false;
+  EXPECT_EQ(2, map.size());
+  EXPECT_NE(map.end(), map.find("bar"_pc));
+  EXPECT_FALSE(map.at("bar"_pc));
+  EXPECT_FALSE(map["bar"_pc]);
+
+  // at() throws for missing key
+  EXPECT_THROW(map.at("notpresent"_pc), std::out_of_range);
+
+  // Test the const version of find(), at() and operator[]
+  const ChunkedPathMap<bool>& cmap = map;
+  EXPECT_NE(cmap.cend(), cmap.find("bar"_pc));
+  EXPECT_FALSE(cmap.at("bar"_pc));
+  EXPECT_FALSE(cmap["bar"_pc]);
+
+  // const operator[] throws for missing key
+  EXPECT_THROW(cmap["notpresent"_pc], std::out_of_range);
+}
+
+TEST(ChunkedPathMap, iteration_and_erase) {
+  ChunkedPathMap<int> map{
+      std::make_pair(PathComponent("foo"), 1),
+      std::make_pair(PathComponent("bar"), 2),
+      std::make_pair(PathComponent("baz"), 3),
+  };
+
+  std::vector<PathComponentPiece> keys;
+  for (const auto& it : map) {
+    keys.emplace_back(it.first);
+  }
+
+  // Keys have deterministic order
+  std::vector<PathComponentPiece> expect{
+      "bar"_pc,
+      "baz"_pc,
+      "foo"_pc,
+  };
+  EXPECT_EQ(expect, keys);
+
+  auto iter = map.find("baz"_pc);
+  EXPECT_EQ(3, iter->second);
+
+  iter = map.erase(iter);
+  EXPECT_EQ(2, map.size()) << "deleted 1";
+  EXPECT_EQ(PathComponent("foo"), iter->first) << "iter advanced to next item";
+  EXPECT_EQ(1, iter->second);
+}
+
+TEST(ChunkedPathMap, copy) {
+  ChunkedPathMap<int> map{
+      std::make_pair(PathComponent("foo"), 1),
+      std::make_pair(PathComponent("bar"), 2),
+      std::make_pair(PathComponent("baz"), 3),
+  };
+  ChunkedPathMap<int> other = map;
+  EXPECT_EQ(3, other.size());
+  EXPECT_EQ(map, other);
+}
+
+TEST(ChunkedPathMap, move) {
+  ChunkedPathMap<int> map{
+      std::make_pair(PathComponent("foo"), 1),
+      std::make_pair(PathComponent("bar"), 2),
+      std::make_pair(PathComponent("baz"), 3),
+  };
+  ChunkedPathMap<int> other = std::move(map);
+  EXPECT_EQ(3, other.size());
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(ChunkedPathMap, emplace) {
+  ChunkedPathMap<std::string> map;
+
+  auto result = map.emplace("one"_pc, 3, 'x');
+  EXPECT_NE(map.end(), result.first);
+  EXPECT_TRUE(result.second) << "inserted";
+  EXPECT_EQ("xxx", map.at("one"_pc));
+
+  // Second emplace with the same key has no effect
+  result = map.emplace("one"_pc, 2, 'y');
+  EXPECT_FALSE(result.second) << "did not insert";
+  EXPECT_EQ("xxx", map.at("one"_pc)) << "didn't change the value";
+}
+
+TEST(ChunkedPathMap, swap) {
+  ChunkedPathMap<std::string> b,
+      a{std::make_pair(PathComponent("foo"), "foo")};
+
+  b.swap(a);
+  EXPECT_EQ(0, a.size()) << "a now has 0 elements";
+  EXPECT_EQ(1, b.size()) << "b now has 1 element";
+  EXPECT_EQ("foo", b.at("foo"_pc));
+
+  a = std::move(b);
+  EXPECT_EQ(1, a.size()) << "a now has 1 element";
+  EXPECT_EQ(0, b.size()) << "b now has 0 elements";
+  EXPECT_EQ("foo", a.at("foo"_pc));
+}
+
+TEST(ChunkedPathMap, out_of_order_inserts_split_chunks) {
+  SmallChunkMap<int> map;
+  EXPECT_EQ(0, map.chunkCount());
+
+  // Insert the even numbers in reverse, then fill in the odd numbers, so
+  // that inserts land at the front, back and middle of the chunks.
+  for (int i = 98; i >= 0; i -= 2) {
+    EXPECT_TRUE(map.emplace(numberedName(i), i).second);
+  }
+  for (int i = 1; i < 100; i += 2) {
+    auto result = map.emplace(numberedName(i), i);
+    EXPECT_TRUE(result.second);
+    EXPECT_EQ(numberedName(i), result.first->first)
+        << "emplace returns the position of the new entry";
+    EXPECT_EQ(i, result.first->second);
+  }
+  EXPECT_EQ(100, map.size());
+  EXPECT_LE(25, map.chunkCount());
+
+  int expected = 0;
+  for (const auto& entry : map) {
+    EXPECT_EQ(numberedName(expected), entry.first);
+    EXPECT_EQ(expected, entry.second);
+    ++expected;
+  }
+  EXPECT_EQ(100, expected);
+
+  // Walk backwards across the chunk boundaries as well.
+  auto iter = map.end();
+  for (int i = 99; i >= 0; --i) {
+    --iter;
+    EXPECT_EQ(i, iter->second);
+  }
+  EXPECT_EQ(map.begin(), iter);
+
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i, map.at(numberedName(i)));
+    EXPECT_EQ(map.find(numberedName(i)), map.lower_bound(numberedName(i)));
+  }
+  EXPECT_EQ(map.end(), map.find("0050a"_pc));
+  EXPECT_EQ(51, map.lower_bound("0050a"_pc)->second);
+  EXPECT_EQ(map.end(), map.lower_bound("1000"_pc));
+}
+
+TEST(ChunkedPathMap, erase_merges_chunks) {
+  SmallChunkMap<int> map;
+  for (int i = 0; i < 100; ++i) {
+    map.emplace(numberedName(i), i);
+  }
+  auto chunks = map.chunkCount();
+
+  // Erase the even entries through the iterator interface, checking that
+  // erase returns the following entry even when it is in another chunk.
+  auto iter = map.begin();
+  while (iter != map.end()) {
+    iter = map.erase(iter);
+    if (iter != map.end()) {
+      ++iter;
+    }
+  }
+  EXPECT_EQ(50, map.size());
+  EXPECT_GT(chunks, map.chunkCount());
+
+  int expected = 1;
+  for (const auto& entry : map) {
+    EXPECT_EQ(expected, entry.second);
+    EXPECT_EQ(1, map.count(entry.first));
+    expected += 2;
+  }
+  EXPECT_EQ(101, expected);
+
+  while (!map.empty()) {
+    EXPECT_EQ(1, map.erase(PathComponentPiece{map.begin()->first}));
+  }
+  EXPECT_EQ(0, map.chunkCount());
+  EXPECT_EQ(map.begin(), map.end());
+}
+
+#ifdef _WIN32
+TEST(ChunkedPathMap, case_insensitive_find) {
+  SmallChunkMap<int> map;
+  for (int i = 0; i < 20; ++i) {
+    map.emplace(PathComponent{folly::to<std::string>("File", i)}, i);
+  }
+
+  // The first case insensitive lookup builds the index.
+  auto iter = map.find("file7"_pc);
+  ASSERT_NE(map.end(), iter);
+  EXPECT_EQ(7, iter->second);
+
+  // Later inserts and erases keep the index current.
+  map.emplace("Extra"_pc, 100);
+  EXPECT_EQ(100, map.find("EXTRA"_pc)->second);
+  map.erase("File3"_pc);
+  EXPECT_EQ(map.end(), map.find("FILE3"_pc));
+  EXPECT_EQ(19, map.find("fIlE19"_pc)->second);
+
+  const auto& cmap = map;
+  EXPECT_EQ(100, cmap.find("extra"_pc)->second);
+  EXPECT_EQ(map.end(), map.find("missing"_pc));
+
+  // Copies start without an index and fall back to scanning.
+  const auto copy = map;
+  EXPECT_EQ(11, copy.find("FILE11"_pc)->second);
+  EXPECT_EQ(copy.end(), copy.find("file3"_pc));
+}
+#endif
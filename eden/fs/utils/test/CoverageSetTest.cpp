@@ -95,3 +95,29 @@ TEST(CoverageSetTest, merge_can_replace_many_nodes) {
   EXPECT_FALSE(s.covers(7, 9));
   EXPECT_TRUE(s.covers(1, 8));
 }
+
+TEST(CoverageSetTest, overlapping_range_merges_with_left_neighbor) {
+  CoverageSet s;
+  s.add(0, 10);
+  s.add(5, 15);
+  EXPECT_EQ(1, s.getIntervalCount());
+  EXPECT_TRUE(s.covers(5, 15));
+  s.add(2, 4);
+  EXPECT_EQ(1, s.getIntervalCount());
+  EXPECT_TRUE(s.covers(0, 15));
+}
+
+TEST(CoverageSetTest, reports_uncovered_ranges) {
+  using Ranges = std::vector<std::pair<size_t, size_t>>;
+  CoverageSet s;
+  EXPECT_EQ((Ranges{{0, 10}}), s.getUncoveredRanges(0, 10));
+  EXPECT_EQ(Ranges{}, s.getUncoveredRanges(4, 4));
+
+  s.add(2, 4);
+  s.add(6, 8);
+  EXPECT_EQ((Ranges{{0, 2}, {4, 6}, {8, 10}}), s.getUncoveredRanges(0, 10));
+  EXPECT_EQ((Ranges{{4, 6}}), s.getUncoveredRanges(3, 7));
+  EXPECT_EQ((Ranges{{5, 6}}), s.getUncoveredRanges(5, 8));
+  EXPECT_EQ(Ranges{}, s.getUncoveredRanges(6, 8));
+  EXPECT_EQ((Ranges{{8, 9}}), s.getUncoveredRanges(7, 9));
+}
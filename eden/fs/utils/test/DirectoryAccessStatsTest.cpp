@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "eden/fs/utils/DirectoryAccessStats.h"
+
+using namespace facebook::eden;
+
+namespace {
+using AccessType = DirectoryAccessStats::AccessType;
+
+std::optional<RelativePath> dir(folly::StringPiece path) {
+  return RelativePath{path};
+}
+
+uint64_t countOf(
+    const DirectoryAccessStats::DirectoryCounts& counts,
+    AccessType type) {
+  return counts.counts[enumValue(type)];
+}
+} // namespace
+
+TEST(DirectoryAccessStats, counts_accesses_by_directory_and_type) {
+  DirectoryAccessStats stats{1};
+  stats.record(AccessType::Lookup, [] { return dir("a/b"); });
+  stats.record(AccessType::Read, [] { return dir("a/b"); });
+  stats.record(AccessType::Read, [] { return dir("a/b"); });
+  stats.record(AccessType::TreeLoad, [] { return dir("c"); });
+
+  auto hot = stats.getHotDirectories(10);
+  ASSERT_EQ(2, hot.size());
+  EXPECT_EQ("a/b"_relpath, hot[0].directory);
+  EXPECT_EQ(3, hot[0].total);
+  EXPECT_EQ(1, countOf(hot[0], AccessType::Lookup));
+  EXPECT_EQ(2, countOf(hot[0], AccessType::Read));
+  EXPECT_EQ(0, hot[0].error);
+  EXPECT_EQ("c"_relpath, hot[1].directory);
+  EXPECT_EQ(1, countOf(hot[1], AccessType::TreeLoad));
+}
+
+TEST(DirectoryAccessStats, zero_sample_rate_records_nothing) {
+  DirectoryAccessStats stats{0};
+  bool called = false;
+  stats.record(AccessType::Lookup, [&] {
+    called = true;
+    return dir("a");
+  });
+  EXPECT_FALSE(called);
+  EXPECT_EQ(0, stats.getHotDirectories(10).size());
+}
+
+TEST(DirectoryAccessStats, accesses_are_weighted_by_sample_rate) {
+  DirectoryAccessStats stats{4};
+  for (int i = 0; i < 4000; ++i) {
+    stats.record(AccessType::Read, [] { return dir("a"); });
+  }
+  auto hot = stats.getHotDirectories(1);
+  ASSERT_EQ(1, hot.size());
+  EXPECT_EQ(0, hot[0].total % 4);
+  EXPECT_GT(hot[0].total, 2000);
+  EXPECT_LT(hot[0].total, 6000);
+}
+
+TEST(DirectoryAccessStats, hot_directory_keeps_its_slot_through_a_scan) {
+  DirectoryAccessStats stats{1, 4};
+  for (int i = 0; i < 100; ++i) {
+    stats.record(AccessType::Lookup, [] { return dir("hot"); });
+    stats.record(AccessType::Lookup, [i] {
+      return dir(folly::to<std::string>("cold", i));
+    });
+  }
+
+  auto hot = stats.getHotDirectories(1);
+  ASSERT_EQ(1, hot.size());
+  EXPECT_EQ("hot"_relpath, hot[0].directory);
+  EXPECT_EQ(100, countOf(hot[0], AccessType::Lookup));
+  EXPECT_EQ(4, stats.getHotDirectories(10).size());
+}
+
+TEST(DirectoryAccessStats, merges_counts_across_threads) {
+  DirectoryAccessStats stats{1};
+  stats.record(AccessType::Read, [] { return dir("a"); });
+  std::thread thread{[&] {
+    stats.record(AccessType::Read, [] { return dir("a"); });
+    auto hot = stats.getHotDirectories(10);
+    ASSERT_EQ(1, hot.size());
+    EXPECT_EQ(2, hot[0].total);
+  }};
+  thread.join();
+}
+
+TEST(DirectoryAccessStats, clear_forgets_accesses) {
+  DirectoryAccessStats stats{1};
+  stats.record(AccessType::Read, [] { return dir("a"); });
+  stats.clear();
+  EXPECT_EQ(0, stats.getHotDirectories(10).size());
+}
+
+TEST(DirectoryAccessStats, parent_of_a_file) {
+  EXPECT_EQ("a/b"_relpath, DirectoryAccessStats::parentOf(dir("a/b/c")));
+  EXPECT_EQ(""_relpath, DirectoryAccessStats::parentOf(dir("c")));
+  EXPECT_FALSE(DirectoryAccessStats::parentOf(std::nullopt));
+}
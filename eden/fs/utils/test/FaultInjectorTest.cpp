@@ -151,3 +151,34 @@ TEST(FaultInjector, noop) {
   fi.check("mount", "/a/b/c");
   EXPECT_THROW_RE(fi.check("mount", "/test/test"), std::runtime_error, "fail");
 }
+
+TEST(FaultInjector, checkFaultMacroOnlyBuildsKeysWhileFaultsAreInjected) {
+  FaultInjector fi(true);
+  size_t keysBuilt = 0;
+  auto buildKey = [&] {
+    ++keysBuilt;
+    return std::string("key");
+  };
+
+  EXPECT_FALSE(fi.hasFaults());
+  EDEN_CHECK_FAULT(fi, "class", buildKey());
+  EXPECT_EQ(0, keysBuilt);
+
+  fi.injectError("class", "key", std::runtime_error("injected"), 1);
+  EXPECT_TRUE(fi.hasFaults());
+  EXPECT_THROW_RE(
+      EDEN_CHECK_FAULT(fi, "class", buildKey()),
+      std::runtime_error,
+      "injected");
+  EXPECT_EQ(1, keysBuilt);
+
+  // The fault expired after its only match.
+  EXPECT_FALSE(fi.hasFaults());
+  EDEN_CHECK_FAULT(fi, "class", buildKey());
+  EXPECT_EQ(1, keysBuilt);
+
+  FaultInjector disabled(false);
+  EXPECT_FALSE(disabled.hasFaults());
+  EDEN_CHECK_FAULT(disabled, "class", buildKey());
+  EXPECT_EQ(1, keysBuilt);
+}
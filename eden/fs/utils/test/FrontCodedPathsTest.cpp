@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/FrontCodedPaths.h"
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+namespace {
+std::vector<std::string> decode(const std::string& encoded) {
+  return decodeFrontCodedPaths(folly::StringPiece{encoded});
+}
+} // namespace
+
+TEST(FrontCodedPaths, empty_list_encodes_to_nothing) {
+  EXPECT_EQ("", encodeFrontCodedPaths({}));
+  EXPECT_TRUE(decode("").empty());
+}
+
+TEST(FrontCodedPaths, shared_prefixes_are_stored_once) {
+  FrontCodedPathsBuilder builder;
+  builder.add("a/b/c.txt");
+  builder.add("a/b/d.txt");
+  builder.add("a/e");
+  EXPECT_EQ(3, builder.size());
+  auto encoded = builder.finish();
+  EXPECT_EQ(
+      std::string("\x00\x09" "a/b/c.txt" "\x04\x05" "d.txt" "\x02\x01" "e", 21),
+      encoded);
+  EXPECT_EQ(
+      (std::vector<std::string>{"a/b/c.txt", "a/b/d.txt", "a/e"}),
+      decode(encoded));
+
+  // The builder can be reused after finish().
+  builder.add("z");
+  EXPECT_EQ(std::string("\x00\x01z", 3), builder.finish());
+}
+
+TEST(FrontCodedPaths, paths_are_sorted_and_deduplicated) {
+  EXPECT_EQ(
+      (std::vector<std::string>{"a", "a/b", "b"}),
+      decode(encodeFrontCodedPaths({"b", "a/b", "a", "b"})));
+}
+
+TEST(FrontCodedPaths, malformed_input_is_rejected) {
+  // The shared prefix is longer than the previous path.
+  EXPECT_THROW(decode(std::string("\x01\x01z", 3)), std::invalid_argument);
+  // The suffix is truncated.
+  EXPECT_THROW(decode(std::string("\x00\x05z", 3)), std::invalid_argument);
+  // The varint is truncated.
+  EXPECT_THROW(decode("\x80"), std::invalid_argument);
+}
@@ -12,6 +12,7 @@
 #include <gtest/gtest.h>
 
 using facebook::eden::MappedDiskVector;
+using facebook::eden::MappedDiskVectorOptions;
 using folly::test::TemporaryDirectory;
 
 TEST(MappedDiskVector, roundUpToNonzeroPageSize) {
@@ -64,6 +65,68 @@ TEST_F(MappedDiskVectorTest, grows_file) {
   EXPECT_GT(new_size, old_size);
 }
 
+TEST_F(MappedDiskVectorTest, reserve_grows_once) {
+  MappedDiskVectorOptions options;
+  options.populate = true;
+  options.advice = MADV_RANDOM;
+  options.hugePages = true;
+  auto mdv = MappedDiskVector<U64>::open(mdvPath, options);
+
+  constexpr uint64_t N = 1000000;
+  mdv.reserve(N);
+  EXPECT_LE(N, mdv.capacity());
+  auto capacity = mdv.capacity();
+
+  for (uint64_t i = 0; i < N; ++i) {
+    mdv.emplace_back(i);
+  }
+  EXPECT_EQ(capacity, mdv.capacity()) << "reserved capacity was enough";
+  EXPECT_EQ(N - 1, mdv[N - 1]);
+
+  // Shrinking requests are ignored.
+  mdv.reserve(10);
+  EXPECT_EQ(capacity, mdv.capacity());
+}
+
+TEST_F(MappedDiskVectorTest, growth_is_proportional_to_size) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  constexpr uint64_t N = 1000000;
+  mdv.reserve(N);
+  auto capacity = mdv.capacity();
+  while (mdv.size() < capacity) {
+    mdv.emplace_back(mdv.size());
+  }
+  mdv.emplace_back(capacity);
+  EXPECT_LE(capacity + capacity / 4, mdv.capacity());
+}
+
+TEST_F(MappedDiskVectorTest, shrink_to_fit_truncates_file) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  struct stat st;
+  ASSERT_EQ(0, stat(mdvPath.c_str(), &st));
+  auto initial_size = st.st_size;
+
+  constexpr uint64_t N = 1000000;
+  for (uint64_t i = 0; i < N; ++i) {
+    mdv.emplace_back(i);
+  }
+  while (mdv.size() > 10) {
+    mdv.pop_back();
+  }
+  mdv.shrinkToFit();
+
+  ASSERT_EQ(0, stat(mdvPath.c_str(), &st));
+  EXPECT_EQ(initial_size, st.st_size);
+  EXPECT_EQ(10, mdv.size());
+  EXPECT_EQ(9, mdv[9]);
+
+  // The vector still grows after shrinking.
+  for (uint64_t i = 10; i < N; ++i) {
+    mdv.emplace_back(i);
+  }
+  EXPECT_EQ(N - 1, mdv[N - 1]);
+}
+
 TEST_F(MappedDiskVectorTest, remembers_contents_on_reopen) {
   {
     auto mdv = MappedDiskVector<U64>::open(mdvPath);
@@ -833,3 +833,10 @@ TEST(PathFuncs, noThrow) {
     ASSERT_TRUE(std::is_nothrow_move_assignable<PathComponentPiece>::value);
   }
 }
+
+TEST(PathFuncs, skipSanityCheckFromStdString) {
+  // Trusted names are taken as they are, even if they would fail the check.
+  PathComponent trusted{std::string{"a/b"}, detail::SkipPathSanityCheck{}};
+  EXPECT_EQ("a/b", trusted.stringPiece());
+  EXPECT_THROW(PathComponent{std::string{"a/b"}}, std::domain_error);
+}
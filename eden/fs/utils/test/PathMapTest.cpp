@@ -127,6 +127,22 @@ TEST(PathMap, emplace) {
   EXPECT_TRUE(map.at("one"_pc).dummy) << "didn't change value to false";
 }
 
+TEST(PathMap, emplaceKeepsOrderWhetherOrNotAppending) {
+  PathMap<int> map;
+  map.reserve(4);
+  map.emplace("b"_pc, 2);
+  map.emplace("d"_pc, 4);
+  map.emplace("a"_pc, 1);
+  map.emplace("c"_pc, 3);
+  EXPECT_FALSE(map.emplace("d"_pc, 5).second);
+
+  std::vector<int> values;
+  for (const auto& entry : map) {
+    values.push_back(entry.second);
+  }
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4}), values);
+}
+
 TEST(PathMap, swap) {
   PathMap<std::string> b, a{std::make_pair(PathComponent("foo"), "foo")};
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/ProcessConcurrencyLimiter.h"
+
+#include <gtest/gtest.h>
+#include <optional>
+#include <vector>
+
+using namespace facebook::eden;
+using Slot = ProcessConcurrencyLimiter::Slot;
+
+TEST(ProcessConcurrencyLimiterTest, admitsUpToTheLimit) {
+  ProcessConcurrencyLimiter limiter{2};
+  auto first = limiter.acquire(10);
+  auto second = limiter.acquire(10);
+  auto third = limiter.acquire(10);
+  EXPECT_TRUE(first.isReady());
+  EXPECT_TRUE(second.isReady());
+  EXPECT_FALSE(third.isReady());
+  EXPECT_EQ(1, limiter.getWaitingCount());
+
+  // Releasing a slot hands it to the waiting request.
+  { auto slot = std::move(first).value(); }
+  EXPECT_TRUE(third.isReady());
+  EXPECT_EQ(0, limiter.getWaitingCount());
+}
+
+TEST(ProcessConcurrencyLimiterTest, processesAreLimitedSeparately) {
+  ProcessConcurrencyLimiter limiter{1};
+  auto busy = limiter.acquire(10);
+  auto waiting = limiter.acquire(10);
+  auto other = limiter.acquire(11);
+  EXPECT_TRUE(busy.isReady());
+  EXPECT_FALSE(waiting.isReady());
+  EXPECT_TRUE(other.isReady());
+}
+
+TEST(ProcessConcurrencyLimiterTest, waitersAreAdmittedInOrder) {
+  ProcessConcurrencyLimiter limiter{1};
+  std::optional<Slot> running = limiter.acquire(10).value();
+
+  std::vector<int> order;
+  std::vector<std::optional<Slot>> slots(3);
+  std::vector<folly::Future<folly::Unit>> admitted;
+  for (int i = 0; i < 3; ++i) {
+    admitted.push_back(limiter.acquire(10).thenValue([&, i](Slot slot) {
+      order.push_back(i);
+      slots[i] = std::move(slot);
+    }));
+  }
+  EXPECT_EQ(3, limiter.getWaitingCount());
+
+  running.reset();
+  EXPECT_EQ(std::vector<int>{0}, order);
+  slots[0].reset();
+  slots[1].reset();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+  slots[2].reset();
+
+  // Every slot has been returned, so the process may run again at once.
+  EXPECT_TRUE(limiter.acquire(10).isReady());
+}
+
+TEST(ProcessConcurrencyLimiterTest, movedSlotsReleaseOnce) {
+  ProcessConcurrencyLimiter limiter{1};
+  auto slot = limiter.acquire(10).value();
+  auto waiting = limiter.acquire(10);
+
+  Slot moved = std::move(slot);
+  EXPECT_FALSE(waiting.isReady());
+  moved = Slot{};
+  EXPECT_TRUE(waiting.isReady());
+}
@@ -35,6 +35,24 @@ TEST(ProcessNameCache, expireMyPidsName) {
   EXPECT_EQ(0, results.size());
 }
 
+TEST(ProcessNameCache, getProcessNameQueuesUnknownPids) {
+  ProcessNameCache processNameCache;
+  EXPECT_EQ(std::nullopt, processNameCache.getProcessName(getpid()));
+
+  // getAllProcessNames waits for queued pids to be read.
+  auto results = processNameCache.getAllProcessNames();
+  EXPECT_NE("", results[getpid()]);
+  EXPECT_EQ(results[getpid()], processNameCache.getProcessName(getpid()));
+}
+
+TEST(ProcessNameCache, failedLookupsAreRemembered) {
+  ProcessNameCache processNameCache;
+  auto missingPid = std::numeric_limits<pid_t>::max();
+  processNameCache.add(missingPid);
+  auto results = processNameCache.getAllProcessNames();
+  EXPECT_EQ("<err:", results[missingPid].substr(0, 5));
+}
+
 TEST(ProcessNameCache, addFromMultipleThreads) {
   ProcessNameCache processNameCache;
 
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/UnboundedQueueExecutor.h"
+
+#include <folly/Synchronized.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/synchronization/Baton.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace facebook::eden;
+
+TEST(UnboundedQueueExecutorTest, higherPrioritiesRunFirst) {
+  UnboundedQueueExecutor executor{1, "PriorityTest"};
+  EXPECT_EQ(3, executor.getNumPriorities());
+
+  folly::Baton<> started;
+  folly::Baton<> release;
+  executor.add([&] {
+    started.post();
+    release.wait();
+  });
+  started.wait();
+
+  folly::Synchronized<std::vector<std::string>> order;
+  folly::Baton<> done;
+  executor.addWithPriority(
+      [&] {
+        order.wlock()->push_back("low");
+        done.post();
+      },
+      folly::Executor::LO_PRI);
+  executor.add([&] { order.wlock()->push_back("mid"); });
+  executor.addWithPriority(
+      [&] { order.wlock()->push_back("high"); }, folly::Executor::HI_PRI);
+  EXPECT_EQ(3, executor.getPendingTaskCount());
+
+  release.post();
+  done.wait();
+  EXPECT_EQ((std::vector<std::string>{"high", "mid", "low"}), *order.rlock());
+}
+
+TEST(UnboundedQueueExecutorTest, manualExecutorIgnoresPriorities) {
+  auto manual = std::make_shared<folly::ManualExecutor>();
+  UnboundedQueueExecutor executor{manual};
+  EXPECT_EQ(1, executor.getNumPriorities());
+
+  std::vector<std::string> order;
+  executor.addWithPriority(
+      [&] { order.push_back("low"); }, folly::Executor::LO_PRI);
+  executor.addWithPriority(
+      [&] { order.push_back("high"); }, folly::Executor::HI_PRI);
+  manual->drain();
+  EXPECT_EQ((std::vector<std::string>{"low", "high"}), order);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/Utf8.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace facebook::eden;
+
+namespace {
+// A typical repository path, and one with a few non-ASCII components.
+constexpr folly::StringPiece kAsciiPath =
+    "fbcode/eden/fs/inodes/test/TreeInodeTest.cpp";
+constexpr folly::StringPiece kUnicodePath =
+    "docs/r\xC3\xA9sum\xC3\xA9/\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E/"
+    "\xF0\x9F\x98\x80.txt";
+} // namespace
+
+static void BM_isValidUtf8_ascii(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(isValidUtf8(kAsciiPath));
+  }
+}
+BENCHMARK(BM_isValidUtf8_ascii);
+
+static void BM_isValidUtf8_unicode(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(isValidUtf8(kUnicodePath));
+  }
+}
+BENCHMARK(BM_isValidUtf8_unicode);
+
+static void BM_ensureValidUtf8_ascii(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ensureValidUtf8(kAsciiPath));
+  }
+}
+BENCHMARK(BM_ensureValidUtf8_ascii);
+
+static void BM_ensureValidUtf8_invalid(benchmark::State& state) {
+  auto invalid = kAsciiPath.str() + "\xff";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ensureValidUtf8(folly::StringPiece{invalid}));
+  }
+}
+BENCHMARK(BM_ensureValidUtf8_invalid);
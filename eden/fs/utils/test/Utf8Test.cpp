@@ -29,6 +29,34 @@ TEST(Utf8Test, isValidUtf8) {
   EXPECT_FALSE(isValidUtf8("\xA0prefix\xB0"));
 }
 
+TEST(Utf8Test, isValidUtf8FollowsTheWellFormedByteSequences) {
+  EXPECT_TRUE(isValidUtf8("h\xC3\xA9llo"));
+  EXPECT_TRUE(isValidUtf8("\xE2\x82\xAC"));
+  EXPECT_TRUE(isValidUtf8("\xF0\x9F\x98\x80"));
+  EXPECT_TRUE(isValidUtf8("\xF4\x8F\xBF\xBF"));
+  // The replacement character itself is valid.
+  EXPECT_TRUE(isValidUtf8(u8"\uFFFD"));
+
+  // overlong
+  EXPECT_FALSE(isValidUtf8("\xC0\x80"));
+  // surrogate
+  EXPECT_FALSE(isValidUtf8("\xED\xA0\x80"));
+  // past U+10FFFF
+  EXPECT_FALSE(isValidUtf8("\xF4\x90\x80\x80"));
+  // truncated
+  EXPECT_FALSE(isValidUtf8("\xE2\x82"));
+}
+
+TEST(Utf8Test, isValidUtf8ChecksEveryByteOfLongStrings) {
+  std::string ascii(100, 'a');
+  EXPECT_TRUE(isValidUtf8(ascii));
+  for (size_t i = 0; i < ascii.size(); ++i) {
+    auto str = ascii;
+    str[i] = '\xff';
+    EXPECT_FALSE(isValidUtf8(str)) << "invalid byte at " << i;
+  }
+}
+
 TEST(Utf8String, ensureValidUtf8) {
   for (auto str : kValidStrings) {
     EXPECT_EQ(str, ensureValidUtf8(str));
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/WorkStealingExecutor.h"
+
+#include <folly/synchronization/Baton.h>
+#include <gtest/gtest.h>
+#include <functional>
+#include <thread>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+TEST(WorkStealingExecutorTest, runsEveryTask) {
+  std::atomic<size_t> ran{0};
+  {
+    WorkStealingExecutor executor{4, "WorkStealingTest"};
+    for (size_t i = 0; i < 1000; ++i) {
+      executor.add([&ran] { ++ran; });
+    }
+  }
+  EXPECT_EQ(1000, ran.load());
+}
+
+TEST(WorkStealingExecutorTest, destructorRunsTasksAddedByTasks) {
+  std::atomic<size_t> ran{0};
+  std::function<void(size_t)> spawn;
+  {
+    WorkStealingExecutor executor{4, "WorkStealingTest"};
+    spawn = [&](size_t depth) {
+      ++ran;
+      if (depth > 0) {
+        executor.add([&spawn, depth] { spawn(depth - 1); });
+        executor.add([&spawn, depth] { spawn(depth - 1); });
+      }
+    };
+    executor.add([&spawn] { spawn(9); });
+  }
+  EXPECT_EQ(1023, ran.load());
+}
+
+TEST(WorkStealingExecutorTest, idleThreadsStealFromABusyQueue) {
+  WorkStealingExecutor executor{4, "WorkStealingTest"};
+  folly::Baton<> release;
+  std::atomic<size_t> ran{0};
+  folly::Baton<> done;
+
+  // Every task added from a worker goes on its own queue, so the only way for
+  // the other threads to help is to steal.
+  executor.add([&] {
+    for (size_t i = 0; i < 100; ++i) {
+      executor.add([&] {
+        release.wait();
+        if (++ran == 100) {
+          done.post();
+        }
+      });
+    }
+  });
+  while (executor.getStealCount() < 3) {
+    std::this_thread::sleep_for(1ms);
+  }
+  release.post();
+  done.wait();
+  EXPECT_EQ(100, ran.load());
+}
+
+TEST(WorkStealingExecutorTest, pendingTaskCount) {
+  WorkStealingExecutor executor{1, "WorkStealingTest"};
+  folly::Baton<> started;
+  folly::Baton<> release;
+  executor.add([&] {
+    started.post();
+    release.wait();
+  });
+  started.wait();
+  folly::Baton<> last;
+  executor.add([] {});
+  executor.add([&] { last.post(); });
+  EXPECT_EQ(2, executor.getPendingTaskCount());
+
+  release.post();
+  last.wait();
+  EXPECT_EQ(0, executor.getPendingTaskCount());
+}
+
+TEST(WorkStealingExecutorTest, taskExceptionsDoNotKillTheThread) {
+  WorkStealingExecutor executor{1, "WorkStealingTest"};
+  folly::Baton<> done;
+  executor.add([] { throw std::runtime_error("oops"); });
+  executor.add([&] { done.post(); });
+  done.wait();
+}
+
+TEST(WorkStealingExecutorTest, unpinnedThreadsAreOnNodeZero) {
+  WorkStealingExecutor executor{3, "WorkStealingTest"};
+  EXPECT_EQ(3, executor.getThreadCount());
+  EXPECT_EQ(std::vector<size_t>({0, 0, 0}), executor.getThreadNumaNodes());
+}
+
+TEST(WorkStealingExecutorTest, parseCpuList) {
+  using detail::parseCpuList;
+  EXPECT_EQ(std::vector<size_t>{}, parseCpuList("\n"));
+  EXPECT_EQ(std::vector<size_t>{0}, parseCpuList("0\n"));
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2, 3}), parseCpuList("0-3"));
+  EXPECT_EQ(
+      std::vector<size_t>({0, 1, 8, 10, 11}), parseCpuList("0-1,8,10-11\n"));
+  EXPECT_EQ(std::nullopt, parseCpuList("0-"));
+  EXPECT_EQ(std::nullopt, parseCpuList("3-1"));
+  EXPECT_EQ(std::nullopt, parseCpuList("a"));
+  EXPECT_EQ(std::nullopt, parseCpuList("1,,2"));
+}
@@ -9,7 +9,12 @@
 
 #include <cpptoml.h>
 #include <folly/Format.h>
+#include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
 #include "ProjectedFSLib.h"
 #include "eden/fs/config/CheckoutConfig.h"
 #include "eden/fs/inodes/EdenMount.h"
@@ -18,7 +23,10 @@
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/inodes/ServerState.h"
 #include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/journal/Journal.h"
 #include "eden/fs/service/EdenError.h"
+#include "eden/fs/store/BlobAccess.h"
+#include "eden/fs/store/BlobChunks.h"
 #include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/utils/SystemError.h"
 #include "eden/fs/win/mount/EdenDispatcher.h"
@@ -64,9 +72,6 @@ std::string makeDotEdenConfig(EdenMount& mount) {
 
 } // namespace
 
-constexpr uint32_t kMinChunkSize = 512 * 1024; // 512 KiB
-constexpr uint32_t kMaxChunkSize = 5 * 1024 * 1024; // 5 MiB
-
 EdenDispatcher::EdenDispatcher(EdenMount& mount)
     : mount_{mount}, dotEdenConfig_{makeDotEdenConfig(mount)} {
   XLOGF(
@@ -290,14 +295,71 @@ EdenDispatcher::queryFileName(const PRJ_CALLBACK_DATA& callbackData) noexcept {
 
 namespace {
 
-HRESULT readMultipleFileChunks(
+/**
+ * The contents getFileData() writes out: either the whole file, or, for a
+ * large file whose blob is stored in chunks, only the requested range.
+ */
+struct FileData {
+  std::string whole;
+  std::unique_ptr<folly::IOBuf> range;
+  // The offset in the file of the first byte of range.
+  uint64_t rangeOffset{0};
+
+  /** The contents, and the offset in the file of their first byte. */
+  std::pair<folly::ByteRange, uint64_t> get() {
+    if (range) {
+      return {range->coalesce(), rangeOffset};
+    }
+    return {folly::ByteRange{folly::StringPiece{whole}}, 0};
+  }
+};
+
+folly::Future<FileData> readFileData(
+    EdenMount& mount,
+    FileInodePtr inode,
+    uint64_t offset,
+    size_t length) {
+  // Only load the chunks of a large blob that cover the request, rather
+  // than all of it.  Blobs that could be too small to be chunked are loaded
+  // whole without looking for chunks first.
+  auto hash = inode->getBlobHash();
+  bool mayBeChunked = offset != 0 || length >= kMinChunkedBlobSize;
+  auto range = hash && mayBeChunked
+      ? mount.getBlobAccess()->getBlobRange(
+            *hash, offset, length, ObjectFetchContext::getNullContext())
+      : folly::makeFuture(std::unique_ptr<folly::IOBuf>{});
+  return std::move(range).thenValue(
+      [inode = std::move(inode),
+       offset](std::unique_ptr<folly::IOBuf> range) -> folly::Future<FileData> {
+        if (range) {
+          FileData data;
+          data.range = std::move(range);
+          data.rangeOffset = offset;
+          return folly::makeFuture(std::move(data));
+        }
+        return inode->readAll(ObjectFetchContext::getNullContext())
+            .thenValue([](std::string contents) {
+              FileData data;
+              data.whole = std::move(contents);
+              return data;
+            });
+      });
+}
+
+} // namespace
+
+static uint64_t BlockAlignTruncate(uint64_t ptr, uint32_t alignment) {
+  return ((ptr) & (0 - (static_cast<uint64_t>(alignment))));
+}
+
+HRESULT EdenDispatcher::writeFileChunks(
     PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT namespaceVirtualizationContext,
     const GUID& dataStreamId,
-    const std::string& content,
+    folly::ByteRange content,
+    uint64_t contentOffset,
     uint64_t startOffset,
     uint64_t length,
     uint64_t chunkSize) {
-  HRESULT result;
   std::unique_ptr<void, PrjAlignedBufferDeleter> writeBuffer{
       PrjAllocateAlignedBuffer(namespaceVirtualizationContext, chunkSize)};
 
@@ -310,27 +372,27 @@ HRESULT readMultipleFileChunks(
   while (remainingLength > 0) {
     uint64_t copySize = std::min(remainingLength, chunkSize);
 
-    //
-    // TODO(puneetk): Once backing store has the support for chunking the file
-    // contents, we can read the chunks of large files here and then write
-    // them to FS.
     //
     // TODO(puneetk): Build an interface to backing store so that we can pass
     // the aligned buffer to avoid coping here.
     //
-    RtlCopyMemory(writeBuffer.get(), content.data() + startOffset, copySize);
+    RtlCopyMemory(
+        writeBuffer.get(),
+        content.data() + (startOffset - contentOffset),
+        copySize);
 
     // Write the data to the file in the local file system.
-    result = PrjWriteFileData(
+    auto writeStart = std::chrono::steady_clock::now();
+    HRESULT result = PrjWriteFileData(
         namespaceVirtualizationContext,
         &dataStreamId,
         writeBuffer.get(),
         startOffset,
         folly::to_narrow(copySize));
-
     if (FAILED(result)) {
       return result;
     }
+    adaptChunkSize(copySize, std::chrono::steady_clock::now() - writeStart);
 
     remainingLength -= copySize;
     startOffset += copySize;
@@ -339,25 +401,105 @@ HRESULT readMultipleFileChunks(
   return S_OK;
 }
 
-HRESULT readSingleFileChunk(
+void EdenDispatcher::adaptChunkSize(
+    uint64_t written,
+    std::chrono::steady_clock::duration elapsed) {
+  // Small writes are dominated by fixed costs, and say little about the
+  // throughput.
+  if (written < kMinChunkSize) {
+    return;
+  }
+  auto chunkSize = chunkSize_.load(std::memory_order_relaxed);
+  // How long writing a whole chunk would take at this rate.
+  auto projected = elapsed *
+      (static_cast<double>(chunkSize) / static_cast<double>(written));
+  if (projected < kTargetChunkWriteTime / 2 && chunkSize < kMaxChunkSize) {
+    chunkSize_.store(
+        std::min(chunkSize * 2, kMaxChunkSize), std::memory_order_relaxed);
+  } else if (
+      projected > kTargetChunkWriteTime * 2 && chunkSize > kMinChunkSize) {
+    chunkSize_.store(
+        std::max(chunkSize / 2, kMinChunkSize), std::memory_order_relaxed);
+  }
+}
+
+HRESULT EdenDispatcher::writeFileData(
     PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT namespaceVirtualizationContext,
     const GUID& dataStreamId,
-    const std::string& content,
-    uint64_t startOffset,
-    uint64_t length) {
-  return readMultipleFileChunks(
+    folly::ByteRange content,
+    uint64_t contentOffset,
+    uint64_t byteOffset,
+    uint32_t length) {
+  //
+  // We should return file data which is smaller than our current chunk size
+  // and meets the memory alignment requirements of the virtualization
+  // instance's storage device.
+  //
+
+  if (contentOffset == 0 && content.size() <= kMinChunkSize) {
+    //
+    // If the file is small - copy the whole file in one shot.
+    //
+    return writeFileChunks(
+        namespaceVirtualizationContext,
+        dataStreamId,
+        content,
+        contentOffset,
+        /*startOffset=*/0,
+        /*length=*/content.size(),
+        /*chunkSize=*/content.size());
+  }
+
+  // Never read past the data we have: the file may have been shorter than
+  // the request.
+  uint64_t available = contentOffset + content.size() > byteOffset
+      ? contentOffset + content.size() - byteOffset
+      : 0;
+  uint64_t writeLength = std::min<uint64_t>(length, available);
+  if (writeLength == 0) {
+    return S_OK;
+  }
+
+  auto chunkSize = chunkSize_.load(std::memory_order_relaxed);
+  if (writeLength <= chunkSize) {
+    //
+    // If the request is with in our chunk size - copy the entire request.
+    //
+    return writeFileChunks(
+        namespaceVirtualizationContext,
+        dataStreamId,
+        content,
+        contentOffset,
+        /*startOffset=*/byteOffset,
+        /*length=*/writeLength,
+        /*chunkSize=*/writeLength);
+  }
+
+  //
+  // When the request is larger than the chunk size we split the request
+  // into multiple chunks.
+  //
+  PRJ_VIRTUALIZATION_INSTANCE_INFO instanceInfo;
+  HRESULT result = PrjGetVirtualizationInstanceInfo(
+      namespaceVirtualizationContext, &instanceInfo);
+
+  if (FAILED(result)) {
+    return result;
+  }
+
+  uint64_t endOffset = BlockAlignTruncate(
+      byteOffset + chunkSize, instanceInfo.WriteAlignment);
+  DCHECK(endOffset > 0);
+  DCHECK(endOffset > byteOffset);
+
+  return writeFileChunks(
       namespaceVirtualizationContext,
       dataStreamId,
       content,
-      /*startOffset=*/startOffset,
-      /*length=*/length,
-      /*writeLength=*/length);
-}
-
-} // namespace
-
-static uint64_t BlockAlignTruncate(uint64_t ptr, uint32_t alignment) {
-  return ((ptr) & (0 - (static_cast<uint64_t>(alignment))));
+      contentOffset,
+      /*startOffset=*/byteOffset,
+      /*length=*/writeLength,
+      /*chunkSize=*/endOffset - byteOffset);
 }
 
 HRESULT
@@ -368,80 +510,62 @@ EdenDispatcher::getFileData(
   try {
     auto relPath = wideCharToEdenRelativePath(callbackData.FilePathName);
 
-    auto content =
+    auto future =
         getMount()
             .getInode(relPath)
-            .thenValue([](const InodePtr inode) {
-              auto fileInode = inode.asFilePtr();
-              return fileInode->readAll(ObjectFetchContext::getNullContext());
+            .thenValue([this, byteOffset, length](const InodePtr inode) {
+              return readFileData(
+                  getMount(), inode.asFilePtr(), byteOffset, length);
             })
             .thenError(
                 folly::tag_t<std::system_error>{},
                 [relPath = std::move(relPath),
                  this](const std::system_error& ex) {
                   if (isEnoent(ex) && relPath == kDotEdenConfigPath) {
-                    return folly::makeFuture<std::string>(
-                        std::string(dotEdenConfig_));
+                    FileData data;
+                    data.whole = dotEdenConfig_;
+                    return folly::makeFuture(std::move(data));
                   }
-                  return folly::makeFuture<std::string>(ex);
-                })
-            .get();
-
-    //
-    // We should return file data which is smaller than
-    // our kMaxChunkSize and meets the memory alignment requirements
-    // of the virtualization instance's storage device.
-    //
+                  return folly::makeFuture<FileData>(ex);
+                });
+
+    auto context = callbackData.NamespaceVirtualizationContext;
+    auto dataStreamId = callbackData.DataStreamId;
+    if (future.isReady()) {
+      auto data = std::move(future).get();
+      auto [content, contentOffset] = data.get();
+      return writeFileData(
+          context, dataStreamId, content, contentOffset, byteOffset, length);
+    }
 
-    if (content.length() <= kMinChunkSize) {
-      //
-      // If the file is small - copy the whole file in one shot.
-      //
-      return readSingleFileChunk(
-          callbackData.NamespaceVirtualizationContext,
-          callbackData.DataStreamId,
-          content,
-          /*startOffset=*/0,
-          /*writeLength=*/content.length());
-
-    } else if (length <= kMaxChunkSize) {
-      //
-      // If the request is with in our kMaxChunkSize - copy the entire request.
-      //
-      return readSingleFileChunk(
-          callbackData.NamespaceVirtualizationContext,
-          callbackData.DataStreamId,
-          content,
-          /*startOffset=*/byteOffset,
-          /*writeLength=*/length);
-    } else {
-      //
-      // When the request is larger than kMaxChunkSize we split the
-      // request into multiple chunks.
-      //
-      PRJ_VIRTUALIZATION_INSTANCE_INFO instanceInfo;
-      HRESULT result = PrjGetVirtualizationInstanceInfo(
-          callbackData.NamespaceVirtualizationContext, &instanceInfo);
-
-      if (FAILED(result)) {
-        return result;
+    // Rather than holding this ProjFS thread while the blob is fetched,
+    // complete the command from whichever thread finishes the fetch.
+    auto commandId = callbackData.CommandId;
+    std::move(future).thenTry([this,
+                               context,
+                               dataStreamId,
+                               commandId,
+                               byteOffset,
+                               length](folly::Try<FileData>&& data) {
+      HRESULT result;
+      if (data.hasValue()) {
+        auto [content, contentOffset] = data->get();
+        result = writeFileData(
+            context, dataStreamId, content, contentOffset, byteOffset, length);
+      } else if (auto* ex = data.exception().get_exception()) {
+        result = exceptionToHResult(*ex);
+      } else {
+        result = E_FAIL;
       }
-
-      uint64_t startOffset = byteOffset;
-      uint64_t endOffset = BlockAlignTruncate(
-          startOffset + kMaxChunkSize, instanceInfo.WriteAlignment);
-      DCHECK(endOffset > 0);
-      DCHECK(endOffset > startOffset);
-
-      uint64_t chunkSize = endOffset - startOffset;
-      return readMultipleFileChunks(
-          callbackData.NamespaceVirtualizationContext,
-          callbackData.DataStreamId,
-          content,
-          /*startOffset=*/startOffset,
-          /*length=*/length,
-          /*chunkSize=*/chunkSize);
-    }
+      // This fails if ProjFS already cancelled the command, which needs no
+      // further handling.
+      auto completed =
+          PrjCompleteCommand(context, commandId, result, nullptr);
+      if (FAILED(completed)) {
+        XLOGF(DBG3, "unable to complete ProjFS command {}", commandId);
+      }
+    });
+    return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
   } catch (const std::exception& ex) {
     return exceptionToHResult(ex);
   }
@@ -495,11 +619,52 @@ folly::Future<TreeInodePtr> createDirInode(
           });
 }
 
+/**
+ * The directories looked up while applying one batch of notifications, so
+ * that the notifications for the entries of a directory only look it up once.
+ *
+ * The futures returned by a DirectoryCache must complete before it is
+ * destroyed.
+ */
+class DirectoryCache {
+ public:
+  explicit DirectoryCache(const EdenMount& mount) : mount_{mount} {}
+
+  const EdenMount& getMount() const {
+    return mount_;
+  }
+
+  /**
+   * Returns the directory at path, creating it and its parents if ProjFS has
+   * not told us about them yet.
+   */
+  folly::Future<TreeInodePtr> getOrCreate(RelativePathPiece path) {
+    auto it = dirs_.find(RelativePath{path});
+    if (it != dirs_.end()) {
+      return it->second;
+    }
+    return createDirInode(mount_, path)
+        .thenValue([this, path = RelativePath{path}](TreeInodePtr tree) {
+          dirs_.emplace(path, tree);
+          return tree;
+        });
+  }
+
+  /** Forget the directories looked up, once one may have moved. */
+  void clear() {
+    dirs_.clear();
+  }
+
+ private:
+  const EdenMount& mount_;
+  std::unordered_map<RelativePath, TreeInodePtr> dirs_;
+};
+
 folly::Future<folly::Unit> createFile(
-    const EdenMount& mount,
+    DirectoryCache& dirs,
     const RelativePathPiece path,
     bool isDirectory) {
-  return createDirInode(mount, path.dirname())
+  return dirs.getOrCreate(path.dirname())
       .thenValue([=](const TreeInodePtr treeInode) {
         if (isDirectory) {
           try {
@@ -535,11 +700,15 @@ folly::Future<folly::Unit> materializeFile(
 }
 
 folly::Future<folly::Unit> renameFile(
-    const EdenMount& mount,
+    DirectoryCache& dirs,
     const RelativePathPiece oldPath,
-    const RelativePathPiece newPath) {
-  auto oldParentInode = createDirInode(mount, oldPath.dirname());
-  auto newParentInode = createDirInode(mount, newPath.dirname());
+    const RelativePathPiece newPath,
+    bool isDirectory) {
+  auto oldParentInode = dirs.getOrCreate(oldPath.dirname());
+  auto newParentInode = dirs.getOrCreate(newPath.dirname());
+  if (isDirectory) {
+    dirs.clear();
+  }
 
   return std::move(oldParentInode)
       .thenValue([=, newParentInode = std::move(newParentInode)](
@@ -567,109 +736,103 @@ folly::Future<folly::Unit> renameFile(
 }
 
 folly::Future<folly::Unit> removeFile(
-    const EdenMount& mount,
+    DirectoryCache& dirs,
     const RelativePathPiece path,
     bool isDirectory) {
-  return mount.getInode(path.dirname()).thenValue([=](const InodePtr inode) {
-    auto treeInodePtr = inode.asTreePtr();
-    if (isDirectory) {
-      return treeInodePtr->rmdir(path.basename(), InvalidationRequired::No);
-    } else {
-      return treeInodePtr->unlink(path.basename(), InvalidationRequired::No);
-    }
-  });
+  if (isDirectory) {
+    dirs.clear();
+  }
+  return dirs.getMount()
+      .getInode(path.dirname())
+      .thenValue([=](const InodePtr inode) {
+        auto treeInodePtr = inode.asTreePtr();
+        if (isDirectory) {
+          return treeInodePtr->rmdir(path.basename(), InvalidationRequired::No);
+        } else {
+          return treeInodePtr->unlink(
+              path.basename(), InvalidationRequired::No);
+        }
+      });
 }
 
 folly::Future<folly::Unit> newFileCreated(
-    const EdenMount& mount,
-    PCWSTR path,
-    PCWSTR destPath,
+    DirectoryCache& dirs,
+    RelativePathPiece path,
+    RelativePathPiece destPath,
     bool isDirectory) {
-  auto relPath = wideCharToEdenRelativePath(path);
-  XLOG(DBG6) << "NEW_FILE_CREATED path=" << relPath;
-  return createFile(mount, relPath, isDirectory);
+  XLOG(DBG6) << "NEW_FILE_CREATED path=" << path;
+  return createFile(dirs, path, isDirectory);
 }
 
 folly::Future<folly::Unit> fileOverwritten(
-    const EdenMount& mount,
-    PCWSTR path,
-    PCWSTR destPath,
+    DirectoryCache& dirs,
+    RelativePathPiece path,
+    RelativePathPiece destPath,
     bool isDirectory) {
-  auto relPath = wideCharToEdenRelativePath(path);
-  XLOG(DBG6) << "FILE_OVERWRITTEN path=" << relPath;
-  return materializeFile(mount, relPath);
+  XLOG(DBG6) << "FILE_OVERWRITTEN path=" << path;
+  return materializeFile(dirs.getMount(), path);
 }
 
 folly::Future<folly::Unit> fileHandleClosedFileModified(
-    const EdenMount& mount,
-    PCWSTR path,
-    PCWSTR destPath,
+    DirectoryCache& dirs,
+    RelativePathPiece path,
+    RelativePathPiece destPath,
     bool isDirectory) {
-  auto relPath = wideCharToEdenRelativePath(path);
-  XLOG(DBG6) << "FILE_HANDLE_CLOSED_FILE_MODIFIED path=" << relPath;
-  return materializeFile(mount, relPath);
+  XLOG(DBG6) << "FILE_HANDLE_CLOSED_FILE_MODIFIED path=" << path;
+  return materializeFile(dirs.getMount(), path);
 }
 
 folly::Future<folly::Unit> fileRenamed(
-    const EdenMount& mount,
-    PCWSTR path,
-    PCWSTR destPath,
+    DirectoryCache& dirs,
+    RelativePathPiece oldPath,
+    RelativePathPiece newPath,
     bool isDirectory) {
-  auto oldPath = wideCharToEdenRelativePath(path);
-  auto newPath = wideCharToEdenRelativePath(destPath);
-
   XLOG(DBG6) << "FILE_RENAMED oldPath=" << oldPath << " newPath=" << newPath;
 
   // When files are moved in and out of the repo, the rename paths are
   // empty, handle these like creation/removal of files.
   if (oldPath.empty()) {
-    return createFile(mount, newPath, isDirectory);
+    return createFile(dirs, newPath, isDirectory);
   } else if (newPath.empty()) {
-    return removeFile(mount, oldPath, isDirectory);
+    return removeFile(dirs, oldPath, isDirectory);
   } else {
-    return renameFile(mount, oldPath, newPath);
+    return renameFile(dirs, oldPath, newPath, isDirectory);
   }
 }
 
 folly::Future<folly::Unit> preRename(
-    const EdenMount& mount,
-    PCWSTR path,
-    PCWSTR destPath,
+    DirectoryCache& dirs,
+    RelativePathPiece path,
+    RelativePathPiece destPath,
     bool isDirectory) {
-  XLOGF(
-      DBG6,
-      "PRE_RENAME oldPath={} newPath={}",
-      wideCharToEdenRelativePath(path),
-      wideCharToEdenRelativePath(destPath));
+  XLOGF(DBG6, "PRE_RENAME oldPath={} newPath={}", path, destPath);
   return folly::unit;
 }
 
 folly::Future<folly::Unit> fileHandleClosedFileDeleted(
-    const EdenMount& mount,
-    PCWSTR path,
-    PCWSTR destPath,
+    DirectoryCache& dirs,
+    RelativePathPiece path,
+    RelativePathPiece destPath,
     bool isDirectory) {
-  auto oldPath = wideCharToEdenRelativePath(path);
-  XLOG(DBG6) << "FILE_HANDLE_CLOSED_FILE_MODIFIED path=" << oldPath;
-  return removeFile(mount, oldPath, isDirectory);
+  XLOG(DBG6) << "FILE_HANDLE_CLOSED_FILE_MODIFIED path=" << path;
+  return removeFile(dirs, path, isDirectory);
 }
 
 folly::Future<folly::Unit> preSetHardlink(
-    const EdenMount& mount,
-    PCWSTR path,
-    PCWSTR destPath,
+    DirectoryCache& dirs,
+    RelativePathPiece path,
+    RelativePathPiece destPath,
     bool isDirectory) {
-  auto relPath = wideCharToEdenRelativePath(path);
-  XLOG(DBG6) << "PRE_SET_HARDLINK path=" << relPath;
+  XLOG(DBG6) << "PRE_SET_HARDLINK path=" << path;
   return folly::makeFuture<folly::Unit>(makeHResultErrorExplicit(
       HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED),
-      sformat("Hardlinks are not supported: {}", relPath)));
+      sformat("Hardlinks are not supported: {}", path)));
 }
 
 typedef folly::Future<folly::Unit> (*NotificationHandler)(
-    const EdenMount& mount,
-    PCWSTR path,
-    PCWSTR destPath,
+    DirectoryCache& dirs,
+    RelativePathPiece path,
+    RelativePathPiece destPath,
     bool isDirectory);
 
 const std::unordered_map<PRJ_NOTIFICATION, NotificationHandler> handlerMap = {
@@ -684,6 +847,15 @@ const std::unordered_map<PRJ_NOTIFICATION, NotificationHandler> handlerMap = {
     {PRJ_NOTIFICATION_PRE_SET_HARDLINK, preSetHardlink},
 };
 
+/**
+ * Pre-operation notifications can veto the operation, so they are answered
+ * right away rather than queued behind the notifications of past changes.
+ */
+bool isPreOperation(PRJ_NOTIFICATION notificationType) {
+  return notificationType == PRJ_NOTIFICATION_PRE_RENAME ||
+      notificationType == PRJ_NOTIFICATION_PRE_SET_HARDLINK;
+}
+
 } // namespace
 
 HRESULT EdenDispatcher::notification(
@@ -697,12 +869,23 @@ HRESULT EdenDispatcher::notification(
     if (it == handlerMap.end()) {
       XLOG(WARN) << "Unrecognized notification: " << notificationType;
       return HRESULT_FROM_WIN32(ERROR_INVALID_PARAMETER);
+    }
+
+    auto path = wideCharToEdenRelativePath(callbackData.FilePathName);
+    RelativePath destPath;
+    if (destinationFileName) {
+      destPath = wideCharToEdenRelativePath(destinationFileName);
+    }
+
+    if (isPreOperation(notificationType)) {
+      DirectoryCache dirs{getMount()};
+      it->second(dirs, path, destPath, isDirectory).get();
     } else {
-      it->second(
-            getMount(),
-            callbackData.FilePathName,
-            destinationFileName,
-            isDirectory)
+      queueNotification(QueuedNotification{notificationType,
+                                           std::move(path),
+                                           std::move(destPath),
+                                           isDirectory,
+                                           {}})
           .get();
     }
     return S_OK;
@@ -711,5 +894,95 @@ HRESULT EdenDispatcher::notification(
   }
 }
 
+folly::Future<folly::Unit> EdenDispatcher::queueNotification(
+    QueuedNotification notification) {
+  auto future = notification.promise.getFuture();
+  {
+    auto queue = notifications_.wlock();
+    queue->queued.push_back(std::move(notification));
+    if (queue->draining) {
+      // The thread draining the queue will apply it.
+      return future;
+    }
+    queue->draining = true;
+  }
+
+  // Keep applying batches until the queue is empty, since the threads
+  // waiting for the notifications queued meanwhile rely on this one.  Each of
+  // them waits for its own notification, so the queue cannot grow past the
+  // number of threads ProjFS calls us on.
+  std::vector<QueuedNotification> batch;
+  while (true) {
+    {
+      auto queue = notifications_.wlock();
+      if (queue->queued.empty()) {
+        queue->draining = false;
+        break;
+      }
+      batch.swap(queue->queued);
+    }
+    applyNotifications(batch);
+    batch.clear();
+  }
+  return future;
+}
+
+void EdenDispatcher::applyNotifications(
+    std::vector<QueuedNotification>& batch) {
+  XLOG(DBG6) << "applying " << batch.size() << " notifications";
+  Journal::FileChangeBatch journalBatch{getMount().getJournal()};
+  DirectoryCache dirs{getMount()};
+
+  // ProjFS sends notifications from several threads, so a batch can hold a
+  // file's creation ahead of its parent directory's.  A directory created
+  // later in the batch is created before the first notification under it.
+  std::unordered_map<RelativePath, size_t> dirCreations;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const auto& notification = batch[i];
+    if (notification.type == PRJ_NOTIFICATION_NEW_FILE_CREATED &&
+        notification.isDirectory) {
+      dirCreations.emplace(notification.path, i);
+    }
+  }
+
+  std::vector<bool> applied(batch.size(), false);
+  auto apply = [&](size_t index) {
+    applied[index] = true;
+    auto& notification = batch[index];
+    auto future = folly::makeFutureWith([&] {
+      return handlerMap.at(notification.type)(
+          dirs,
+          notification.path,
+          notification.destPath,
+          notification.isDirectory);
+    });
+    if (!future.isReady()) {
+      // The change may be recorded in the journal on another thread, which
+      // must not overtake the changes held by journalBatch.
+      journalBatch.flush();
+      future.wait();
+    }
+    notification.promise.setTry(std::move(future.result()));
+  };
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (applied[i]) {
+      continue;
+    }
+    if (!dirCreations.empty()) {
+      for (auto parent : batch[i].path.dirname().paths()) {
+        auto it = dirCreations.find(RelativePath{parent});
+        if (it != dirCreations.end() && it->second > i &&
+            !applied[it->second]) {
+          XLOG(DBG4) << "applying the creation of " << parent
+                     << " ahead of the notification for " << batch[i].path;
+          apply(it->second);
+        }
+      }
+    }
+    apply(i);
+  }
+}
+
 } // namespace eden
 } // namespace facebook
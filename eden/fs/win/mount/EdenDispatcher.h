@@ -10,10 +10,16 @@
 #include "folly/portability/Windows.h"
 
 #include <ProjectedFSLib.h>
+#include <folly/Range.h>
+#include <folly/futures/Future.h>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <map>
 #include <string>
+#include <vector>
+#include "eden/fs/utils/PathFuncs.h"
 #include "eden/fs/win/mount/Enumerator.h"
 #include "eden/fs/win/utils/Guid.h"
 #include "folly/Synchronized.h"
@@ -69,6 +75,72 @@ class EdenDispatcher {
   }
 
  private:
+  /**
+   * PrjWriteFileData() is called with at most this many bytes at once.
+   * Between kMinChunkSize and kMaxChunkSize, the size adapts to the observed
+   * throughput, so that each write takes about kTargetChunkWriteTime.
+   */
+  static constexpr uint64_t kMinChunkSize = 512 * 1024; // 512 KiB
+  static constexpr uint64_t kMaxChunkSize = 5 * 1024 * 1024; // 5 MiB
+  static constexpr std::chrono::milliseconds kTargetChunkWriteTime{20};
+
+  /**
+   * Write the requested part of a file to ProjFS.  content holds the file's
+   * data starting at contentOffset, and must cover the request unless the
+   * file ends first.
+   */
+  HRESULT writeFileData(
+      PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT namespaceVirtualizationContext,
+      const GUID& dataStreamId,
+      folly::ByteRange content,
+      uint64_t contentOffset,
+      uint64_t byteOffset,
+      uint32_t length);
+  HRESULT writeFileChunks(
+      PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT namespaceVirtualizationContext,
+      const GUID& dataStreamId,
+      folly::ByteRange content,
+      uint64_t contentOffset,
+      uint64_t startOffset,
+      uint64_t length,
+      uint64_t chunkSize);
+  void adaptChunkSize(
+      uint64_t written,
+      std::chrono::steady_clock::duration elapsed);
+
+  /**
+   * A notification of a change ProjFS has already made, waiting to be
+   * applied to the inodes.
+   */
+  struct QueuedNotification {
+    PRJ_NOTIFICATION type;
+    RelativePath path;
+    RelativePath destPath;
+    bool isDirectory;
+    folly::Promise<folly::Unit> promise;
+  };
+
+  struct NotificationQueue {
+    std::vector<QueuedNotification> queued;
+    /** Whether a thread is applying the queued notifications. */
+    bool draining{false};
+  };
+
+  /**
+   * Queue a notification, and apply the queued ones in batches unless
+   * another thread already is.  The returned future completes once the
+   * notification has been applied.
+   */
+  folly::Future<folly::Unit> queueNotification(
+      QueuedNotification notification);
+
+  /**
+   * Apply a batch of notifications in the order they were received, except
+   * for directory creations that a notification before them depends on.
+   * Their journal deltas are added together.
+   */
+  void applyNotifications(std::vector<QueuedNotification>& batch);
+
   // Store a raw pointer to EdenMount. It doesn't own or maintain the lifetime
   // of Mount. Instead, at this point, Eden dispatcher is owned by the
   // mount.
@@ -86,6 +158,10 @@ class EdenDispatcher {
 
   const std::string dotEdenConfig_;
 
+  std::atomic<uint64_t> chunkSize_{kMinChunkSize};
+
+  folly::Synchronized<NotificationQueue> notifications_;
+
   const uint32_t verificationCode_ = kDispatcherCode;
 };
 
@@ -8,6 +8,7 @@
 #include "folly/portability/Windows.h"
 
 #include <ProjectedFSLib.h>
+#include <algorithm>
 #include "eden/fs/win/mount/Enumerator.h"
 
 namespace facebook {
@@ -15,29 +16,71 @@ namespace eden {
 
 Enumerator::Enumerator(
     const GUID& enumerationId,
-    std::vector<FileMetadata> entryList)
-    : metadataList_(std::move(entryList)) {
+    std::shared_ptr<const std::vector<FileMetadata>> entryList)
+    : metadataList_(std::move(entryList)) {}
+
+void Enumerator::sortEntries(std::vector<FileMetadata>& entries) {
   std::sort(
-      metadataList_.begin(),
-      metadataList_.end(),
+      entries.begin(),
+      entries.end(),
       [](const FileMetadata& first, const FileMetadata& second) -> bool {
         return (
             PrjFileNameCompare(first.name.c_str(), second.name.c_str()) < 0);
       });
 }
 
+void Enumerator::saveExpression(std::wstring searchExpression) {
+  searchExpression_ = std::move(searchExpression);
+  matches_.clear();
+  matchAll_ = false;
+
+  const auto& list = *metadataList_;
+  if (searchExpression_ == L"*") {
+    // By far the most common expression: every entry matches.
+    matchAll_ = true;
+    return;
+  }
+
+  if (!PrjDoesNameContainWildCards(searchExpression_.c_str())) {
+    //
+    // A plain name matches at most one entry, which the sorted list lets us
+    // find without comparing against every entry.
+    //
+    auto it = std::lower_bound(
+        list.begin(),
+        list.end(),
+        searchExpression_,
+        [](const FileMetadata& entry, const std::wstring& name) -> bool {
+          return PrjFileNameCompare(entry.name.c_str(), name.c_str()) < 0;
+        });
+    if (it != list.end() &&
+        PrjFileNameCompare(it->name.c_str(), searchExpression_.c_str()) == 0) {
+      matches_.push_back(it - list.begin());
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < list.size(); ++i) {
+    if (PrjFileNameMatch(list[i].name.c_str(), searchExpression_.c_str())) {
+      matches_.push_back(i);
+    }
+  }
+}
+
 const FileMetadata* Enumerator::current() {
-  for (; listIndex_ < metadataList_.size(); listIndex_++) {
-    if (PrjFileNameMatch(
-            metadataList_[listIndex_].name.c_str(),
-            searchExpression_.c_str())) {
-      //
-      // Don't increment the index here because we don't know if the caller
-      // would be able to use this. The caller should instead call advance() on
-      // success.
-      //
-      return &metadataList_[listIndex_];
+  //
+  // Don't increment the index here because we don't know if the caller
+  // would be able to use this. The caller should instead call advance() on
+  // success.
+  //
+  if (matchAll_) {
+    if (listIndex_ < metadataList_->size()) {
+      return &(*metadataList_)[listIndex_];
     }
+    return nullptr;
+  }
+  if (listIndex_ < matches_.size()) {
+    return &(*metadataList_)[matches_[listIndex_]];
   }
   return nullptr;
 }
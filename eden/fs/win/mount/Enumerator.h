@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "eden/fs/model/Hash.h"
@@ -61,10 +62,22 @@ class Enumerator {
   Enumerator(const Enumerator&) = delete;
   Enumerator& operator=(const Enumerator&) = delete;
 
-  Enumerator(const GUID& enumerationId, std::vector<FileMetadata> entryList);
+  /**
+   * entryList must be sorted with sortEntries().  It is not copied, so that
+   * every enumeration of the same directory can share one list.
+   */
+  Enumerator(
+      const GUID& enumerationId,
+      std::shared_ptr<const std::vector<FileMetadata>> entryList);
 
   explicit Enumerator() = delete;
 
+  /**
+   * Sort entries in the order Projected FS expects enumerations to return
+   * them in.
+   */
+  static void sortEntries(std::vector<FileMetadata>& entries);
+
   const FileMetadata* current();
 
   void advance() {
@@ -79,17 +92,27 @@ class Enumerator {
     return searchExpression_.empty();
   }
 
-  void saveExpression(std::wstring searchExpression) noexcept {
-    searchExpression_ = std::move(searchExpression);
-  }
+  /**
+   * Set the expression entries must match, and find every entry matching it
+   * in a single pass over the list.
+   */
+  void saveExpression(std::wstring searchExpression);
 
  private:
   std::wstring searchExpression_;
-  std::vector<FileMetadata> metadataList_;
+  std::shared_ptr<const std::vector<FileMetadata>> metadataList_;
+
+  //
+  // The indices in metadataList_ of the entries matching searchExpression_,
+  // unless matchAll_ is set because every entry matches.
+  //
+  std::vector<size_t> matches_;
+  bool matchAll_{false};
 
   //
   // use the listIndex_ to return entries when the enumeration is done over
-  // multiple calls
+  // multiple calls. It indexes into matches_, or into metadataList_ when
+  // every entry matches.
   //
   size_t listIndex_ = 0;
 };
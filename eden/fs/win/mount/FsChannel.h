@@ -8,6 +8,10 @@
 #pragma once
 
 #include <folly/futures/Future.h>
+#include <optional>
+#include <vector>
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/utils/PathFuncs.h"
 
 namespace facebook {
 namespace eden {
@@ -25,6 +29,23 @@ class FsChannel {
   virtual void removeCachedFile(RelativePathPiece path) = 0;
   virtual void removeDeletedFile(RelativePathPiece path) = 0;
 
+  /**
+   * An entry changed by a checkout, and its new source control state.
+   */
+  struct CachedFileUpdate {
+    RelativePath path;
+    /** The new hash of the entry, or none if the checkout removed it. */
+    std::optional<Hash> hash;
+    bool isDirectory{false};
+  };
+
+  /**
+   * Bring the cached state of every entry in updates in line with the
+   * checkout. The returned future completes once all of them are applied.
+   */
+  virtual folly::Future<folly::Unit> updateCachedFiles(
+      std::vector<CachedFileUpdate> updates) = 0;
+
   struct StopData {};
   virtual folly::SemiFuture<FsChannel::StopData> getStopFuture() = 0;
 };
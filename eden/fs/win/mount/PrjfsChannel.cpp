@@ -6,8 +6,14 @@
  */
 
 #include "eden/fs/win/mount/PrjfsChannel.h"
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
 #include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/ServerState.h"
+#include "eden/fs/store/ObjectFetchContext.h"
+#include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/utils/UnboundedQueueExecutor.h"
 #include "eden/fs/win/mount/EdenDispatcher.h"
 #include "eden/fs/win/utils/Guid.h"
 #include "eden/fs/win/utils/StringConv.h"
@@ -19,6 +25,19 @@ namespace {
 
 using facebook::eden::EdenDispatcher;
 
+/**
+ * Update or remove entries from the Projected FS cache, whatever state they
+ * are in.
+ */
+const PRJ_UPDATE_TYPES kAllowAnyUpdate = PRJ_UPDATE_ALLOW_DIRTY_METADATA |
+    PRJ_UPDATE_ALLOW_DIRTY_DATA | PRJ_UPDATE_ALLOW_READ_ONLY |
+    PRJ_UPDATE_ALLOW_TOMBSTONE;
+
+size_t pathDepth(facebook::eden::RelativePathPiece path) {
+  auto str = path.stringPiece();
+  return std::count(str.begin(), str.end(), '/');
+}
+
 #define BAIL_ON_RECURSIVE_CALL(callbackData)                          \
   do {                                                                \
     if (callbackData->TriggeringProcessId == GetCurrentProcessId()) { \
@@ -106,7 +125,7 @@ namespace facebook {
 namespace eden {
 
 PrjfsChannel::PrjfsChannel(EdenMount* mount)
-    : dispatcher_{*mount}, mountId_{Guid::generate()} {}
+    : mount_{mount}, dispatcher_{*mount}, mountId_{Guid::generate()} {}
 
 PrjfsChannel::~PrjfsChannel() {
   if (isRunning_) {
@@ -216,15 +235,103 @@ void PrjfsChannel::deleteFile(
 }
 
 void PrjfsChannel::removeCachedFile(RelativePathPiece path) {
-  deleteFile(
-      path,
-      PRJ_UPDATE_ALLOW_DIRTY_METADATA | PRJ_UPDATE_ALLOW_DIRTY_DATA |
-          PRJ_UPDATE_ALLOW_READ_ONLY | PRJ_UPDATE_ALLOW_TOMBSTONE);
+  deleteFile(path, kAllowAnyUpdate);
 }
 
 void PrjfsChannel::removeDeletedFile(RelativePathPiece path) {
   deleteFile(path, PRJ_UPDATE_ALLOW_TOMBSTONE);
 }
 
+void PrjfsChannel::updatePlaceholder(
+    RelativePathPiece path,
+    bool isDirectory,
+    size_t size) {
+  auto winPath = edenToWinPath(path.stringPiece());
+  PRJ_PLACEHOLDER_INFO placeholderInfo{};
+  placeholderInfo.FileBasicInfo.IsDirectory = isDirectory;
+  placeholderInfo.FileBasicInfo.FileSize = size;
+  PRJ_UPDATE_FAILURE_CAUSES failureReason;
+  HRESULT hr = PrjUpdateFileIfNeeded(
+      mountChannel_,
+      winPath.c_str(),
+      &placeholderInfo,
+      sizeof(placeholderInfo),
+      kAllowAnyUpdate,
+      &failureReason);
+  if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) ||
+      hr == HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND)) {
+    // Projected FS has never been asked about this entry, so there is
+    // nothing to update: it will ask for the new state when it needs it.
+    return;
+  }
+  if (FAILED(hr)) {
+    XLOGF(
+        DBG6,
+        "Failed to update disk file {} reason: {} error: {}",
+        path,
+        static_cast<uint32_t>(failureReason),
+        hr);
+    // A file replaced by a directory, or the other way around, cannot be
+    // updated in place.
+    removeCachedFile(path);
+  }
+}
+
+folly::Future<folly::Unit> PrjfsChannel::updateCachedFile(
+    const CachedFileUpdate& update) {
+  if (!update.hash.has_value()) {
+    removeCachedFile(update.path);
+    return folly::unit;
+  }
+  if (update.isDirectory) {
+    updatePlaceholder(update.path, true, 0);
+    return folly::unit;
+  }
+  return mount_->getObjectStore()
+      ->getBlobSize(update.hash.value(), ObjectFetchContext::getNullContext())
+      .thenTry([this, path = update.path](folly::Try<uint64_t> size) {
+        if (size.hasException()) {
+          XLOG(DBG4) << "unable to get the size of " << path
+                     << ", removing it instead: " << size.exception().what();
+          removeCachedFile(path);
+          return;
+        }
+        updatePlaceholder(path, false, size.value());
+      });
+}
+
+folly::Future<folly::Unit> PrjfsChannel::updateCachedFiles(
+    std::vector<CachedFileUpdate> updates) {
+  std::stable_sort(
+      updates.begin(), updates.end(), [](const auto& a, const auto& b) {
+        return pathDepth(a.path) > pathDepth(b.path);
+      });
+  return updateCachedFilesFrom(
+      std::make_shared<std::vector<CachedFileUpdate>>(std::move(updates)), 0);
+}
+
+folly::Future<folly::Unit> PrjfsChannel::updateCachedFilesFrom(
+    std::shared_ptr<std::vector<CachedFileUpdate>> updates,
+    size_t begin) {
+  if (begin >= updates->size()) {
+    return folly::unit;
+  }
+
+  auto depth = pathDepth((*updates)[begin].path);
+  auto executor = mount_->getServerState()->getThreadPool().get();
+  std::vector<folly::Future<folly::Unit>> futures;
+  auto end = begin;
+  for (; end < updates->size() && pathDepth((*updates)[end].path) == depth;
+       ++end) {
+    futures.push_back(folly::via(executor, [this, updates, end] {
+      return updateCachedFile((*updates)[end]);
+    }));
+  }
+  return folly::collectAllUnsafe(std::move(futures))
+      .thenValue([this, updates, end](auto&&) mutable {
+        return updateCachedFilesFrom(std::move(updates), end);
+      });
+}
+
 } // namespace eden
 } // namespace facebook
@@ -10,6 +10,8 @@
 #include "folly/portability/Windows.h"
 
 #include <ProjectedFSLib.h>
+#include <memory>
+#include <vector>
 #include "eden/fs/utils/PathFuncs.h"
 #include "eden/fs/win/mount/EdenDispatcher.h"
 #include "eden/fs/win/mount/FsChannel.h"
@@ -47,8 +49,27 @@ class PrjfsChannel : public FsChannel {
    */
   void removeDeletedFile(RelativePathPiece path) override;
 
+  /**
+   * Update the placeholders of the entries a checkout changed in place, with
+   * PrjUpdateFileIfNeeded(), instead of deleting them. Projected FS then
+   * serves the next access from the placeholder rather than asking us for
+   * its info again. Removed entries, and those that cannot be updated in
+   * place, are deleted as removeCachedFile() does.
+   *
+   * Entries at the same depth are updated in parallel on the server thread
+   * pool, deepest first, so that a directory is only updated after its
+   * children.
+   */
+  folly::Future<folly::Unit> updateCachedFiles(
+      std::vector<CachedFileUpdate> updates) override;
+
  private:
   void deleteFile(RelativePathPiece path, PRJ_UPDATE_TYPES updateFlags);
+  void updatePlaceholder(RelativePathPiece path, bool isDirectory, size_t size);
+  folly::Future<folly::Unit> updateCachedFile(const CachedFileUpdate& update);
+  folly::Future<folly::Unit> updateCachedFilesFrom(
+      std::shared_ptr<std::vector<CachedFileUpdate>> updates,
+      size_t begin);
 
   /**
    * getDispatcher() return the EdenDispatcher stored with in this object.
@@ -64,6 +85,7 @@ class PrjfsChannel : public FsChannel {
   //
   PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT mountChannel_{nullptr};
 
+  EdenMount* const mount_;
   EdenDispatcher dispatcher_;
   Guid mountId_;
   bool isRunning_{false};
@@ -61,6 +61,7 @@ int main(int argc, char const *argv[])
 
 	xpparam_t xpp = {
 	    0, /* flags */
+	    0, /* max_cost */
 	};
 	xdemitconf_t xecfg = {
 	    0,             /* flags */
@@ -11,8 +11,19 @@
 #include "edenscm/hgext/extlib/cstore/datapackstore.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
+#include <algorithm>
+#include <atomic>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 #include "edenscm/hgext/extlib/cstore/key.h"
 #include "lib/clib/portability/dirent.h"
@@ -29,14 +40,28 @@ struct Deleter {
   }
 };
 
+std::string packDirectory(const std::string& path) {
+  std::string directory(path);
+  if (!path.empty() && path[path.size() - 1] != '/') {
+    directory.push_back('/');
+  }
+  return directory;
+}
+
+bool hasSuffix(
+    const char* name,
+    size_t length,
+    const char* suffix,
+    size_t suffixLength) {
+  return length >= suffixLength &&
+      strcmp(name + length - suffixLength, suffix) == 0;
+}
+
 std::unordered_set<std::string> getAvailablePackFileNames(
     const std::string& path) {
   std::unordered_set<std::string> results;
 
-  std::string packpath(path);
-  if (!path.empty() && path[path.size() - 1] != '/') {
-    packpath.push_back('/');
-  }
+  std::string packpath = packDirectory(path);
   size_t dirLength = packpath.size();
 
   std::unique_ptr<DIR, Deleter> dirp(opendir(path.c_str()));
@@ -47,10 +72,7 @@ std::unordered_set<std::string> getAvailablePackFileNames(
   dirent* entry;
   while ((entry = readdir(dirp.get())) != nullptr) {
     size_t fileLength = strlen(entry->d_name);
-    if (fileLength < PACKSUFFIXLEN) {
-      continue;
-    }
-    if (strcmp(entry->d_name + fileLength - PACKSUFFIXLEN, PACKSUFFIX) != 0) {
+    if (!hasSuffix(entry->d_name, fileLength, PACKSUFFIX, PACKSUFFIXLEN)) {
       continue;
     }
     packpath.append(entry->d_name, fileLength - PACKSUFFIXLEN);
@@ -60,12 +82,26 @@ std::unordered_set<std::string> getAvailablePackFileNames(
 
   return results;
 }
+
+uint64_t nodePrefix(const uint8_t* node) {
+  uint64_t prefix;
+  memcpy(&prefix, node, sizeof(prefix));
+  return prefix;
+}
+
+// Batches with less compressed data than this are decompressed on the
+// calling thread, since starting threads would cost more than it saves.
+constexpr size_t kParallelDecompressBytes = 1024 * 1024;
+constexpr unsigned kMaxDecompressThreads = 8;
 } // namespace
 
 DatapackStore::DatapackStore(
     const std::string& path,
     bool removeDeadPackFilesOnRefresh)
     : path_(path), removeOnRefresh_(removeDeadPackFilesOnRefresh) {
+  // Watch before listing, so that no pack added in between is missed
+  startWatching();
+
   // Find pack files in path
   auto files = getAvailablePackFileNames(path);
   for (const auto& packpath : files) {
@@ -95,12 +131,63 @@ std::shared_ptr<datapack_handle_t> DatapackStore::addPack(
 
   if (pack && pack->status == DATAPACK_HANDLE_OK) {
     packs_[path] = pack;
+    indexPack(pack);
     return pack;
   }
   return nullptr;
 }
 
-DatapackStore::~DatapackStore() {}
+void DatapackStore::indexPack(const std::shared_ptr<datapack_handle_t>& pack) {
+  auto packNumber = static_cast<uint32_t>(indexedPacks_.size());
+  indexedPacks_.push_back(pack);
+
+  auto oldSize = index_.size();
+  auto count = datapack_index_size(pack.get());
+  index_.reserve(oldSize + count);
+  for (size_t i = 0; i < count; ++i) {
+    index_.push_back(
+        IndexEntry{nodePrefix(datapack_index_node(pack.get(), i)), packNumber});
+  }
+
+  // A pack's index is sorted by node, but the prefixes are compared as
+  // integers here, so sort them before merging.
+  auto byPrefix = [](const IndexEntry& a, const IndexEntry& b) {
+    return a.prefix < b.prefix;
+  };
+  auto middle = index_.begin() + oldSize;
+  std::sort(middle, index_.end(), byPrefix);
+  std::inplace_merge(index_.begin(), middle, index_.end(), byPrefix);
+}
+
+void DatapackStore::rebuildIndex() {
+  index_.clear();
+  indexedPacks_.clear();
+  for (const auto& it : packs_) {
+    indexPack(it.second);
+  }
+}
+
+template <typename Fn>
+bool DatapackStore::forEachCandidatePack(const uint8_t* node, Fn&& fn) {
+  auto prefix = nodePrefix(node);
+  auto it = std::lower_bound(
+      index_.begin(),
+      index_.end(),
+      prefix,
+      [](const IndexEntry& entry, uint64_t value) {
+        return entry.prefix < value;
+      });
+  for (; it != index_.end() && it->prefix == prefix; ++it) {
+    if (fn(indexedPacks_[it->pack])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+DatapackStore::~DatapackStore() {
+  stopWatching();
+}
 
 DeltaChainIterator DatapackStore::getDeltaChain(const Key& key) {
   std::shared_ptr<DeltaChain> chain = this->getDeltaChainRaw(key);
@@ -111,42 +198,143 @@ DeltaChainIterator DatapackStore::getDeltaChain(const Key& key) {
 }
 
 std::shared_ptr<DeltaChain> DatapackStore::getDeltaChainRaw(const Key& key) {
-  for (const auto& it : packs_) {
-    auto& pack = it.second;
-    auto chain = getdeltachain(pack.get(), (const uint8_t*)key.node);
-
+  auto node = (const uint8_t*)key.node;
+  std::shared_ptr<DeltaChain> result;
+  auto tryPack = [&](const std::shared_ptr<datapack_handle_t>& pack) {
+    auto chain = getdeltachain(pack.get(), node);
     if (chain.code == GET_DELTA_CHAIN_OOM) {
       throw std::runtime_error("out of memory");
-    } else if (chain.code == GET_DELTA_CHAIN_NOT_FOUND) {
-      freedeltachain(chain);
-      continue;
     } else if (chain.code != GET_DELTA_CHAIN_OK) {
       freedeltachain(chain);
-      continue;
+      return false;
     }
 
     // Pass ownership of chain to CDeltaChain
-    return std::make_shared<CDeltaChain>(chain);
+    result = std::make_shared<CDeltaChain>(chain, pack);
+    return true;
+  };
+
+  if (forEachCandidatePack(node, tryPack)) {
+    return result;
+  }
+
+  // Check if there are new packs available
+  if (!rescan().empty() && forEachCandidatePack(node, tryPack)) {
+    return result;
   }
 
+  return std::make_shared<CDeltaChain>(GET_DELTA_CHAIN_NOT_FOUND);
+}
+
+std::vector<std::shared_ptr<DeltaChain>> DatapackStore::getDeltaChainsRaw(
+    const std::vector<Key>& keys) {
+  struct Located {
+    size_t key;
+    std::shared_ptr<datapack_handle_t> pack;
+    data_offset_t offset;
+    data_offset_t size;
+  };
+  std::vector<Located> located;
+  auto locate = [&](size_t i) {
+    auto node = (const uint8_t*)keys[i].node;
+    auto inPack = [&](const std::shared_ptr<datapack_handle_t>& pack) {
+      pack_index_entry_t entry;
+      if (!find(pack.get(), node, &entry)) {
+        return false;
+      }
+      located.push_back(Located{i, pack, entry.data_offset, entry.data_sz});
+      return true;
+    };
+    return forEachCandidatePack(node, inPack);
+  };
+
+  std::vector<size_t> missing;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (!locate(i)) {
+      missing.push_back(i);
+    }
+  }
   // Check if there are new packs available
-  auto rescanned = rescan();
-  for (const auto& pack : rescanned) {
-    auto chain = getdeltachain(pack.get(), (const uint8_t*)key.node);
+  if (!missing.empty() && !rescan().empty()) {
+    for (auto i : missing) {
+      locate(i);
+    }
+  }
+
+  // Read each pack front to back, and let the kernel start paging in the
+  // later chains while the earlier ones are read.
+  std::sort(
+      located.begin(), located.end(), [](const Located& a, const Located& b) {
+        return a.pack != b.pack ? a.pack.get() < b.pack.get()
+                                : a.offset < b.offset;
+      });
+  for (const auto& entry : located) {
+    datapack_willneed(entry.pack.get(), entry.offset, entry.size);
+  }
+
+  std::vector<std::shared_ptr<DeltaChain>> chains(keys.size());
+  std::vector<std::pair<size_t, delta_chain_link_t*>> links;
+  size_t compressedBytes = 0;
+  for (const auto& entry : located) {
+    auto chain = getdeltachain_compressed(
+        entry.pack.get(), (const uint8_t*)keys[entry.key].node);
     if (chain.code == GET_DELTA_CHAIN_OOM) {
       throw std::runtime_error("out of memory");
-    } else if (chain.code == GET_DELTA_CHAIN_NOT_FOUND) {
-      freedeltachain(chain);
-      continue;
     } else if (chain.code != GET_DELTA_CHAIN_OK) {
       freedeltachain(chain);
       continue;
     }
+    for (size_t i = 0; i < chain.links_count; ++i) {
+      links.emplace_back(entry.key, &chain.delta_chain_links[i]);
+      compressedBytes += chain.delta_chain_links[i].compressed_sz;
+    }
+
     // Pass ownership of chain to CDeltaChain
-    return std::make_shared<CDeltaChain>(chain);
+    chains[entry.key] = std::make_shared<CDeltaChain>(chain, entry.pack);
   }
 
-  return std::make_shared<CDeltaChain>(GET_DELTA_CHAIN_NOT_FOUND);
+  // Each link is decompressed into its own buffer, so links may be
+  // decompressed concurrently.
+  std::unique_ptr<std::atomic<bool>[]> failed(
+      new std::atomic<bool>[keys.size()]());
+  std::atomic<size_t> nextLink{0};
+  auto decompress = [&]() {
+    size_t i;
+    while ((i = nextLink.fetch_add(1)) < links.size()) {
+      if (!uncompressdeltachainlink(links[i].second)) {
+        failed[links[i].first] = true;
+      }
+    }
+  };
+
+  unsigned threadCount = 1;
+  if (compressedBytes >= kParallelDecompressBytes) {
+    threadCount = std::min(
+        std::max(std::thread::hardware_concurrency(), 1u),
+        kMaxDecompressThreads);
+    if (links.size() < threadCount) {
+      threadCount = static_cast<unsigned>(links.size());
+    }
+  }
+  std::vector<std::thread> workers;
+  try {
+    for (unsigned i = 1; i < threadCount; ++i) {
+      workers.emplace_back(decompress);
+    }
+  } catch (const std::system_error&) {
+    // Fewer threads only make the batch slower.
+  }
+  decompress();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (!chains[i] || failed[i]) {
+      chains[i] = std::make_shared<CDeltaChain>(GET_DELTA_CHAIN_NOT_FOUND);
+    }
+  }
+  return chains;
 }
 
 Key* DatapackStoreKeyIterator::next() {
@@ -161,24 +349,18 @@ Key* DatapackStoreKeyIterator::next() {
 }
 
 bool DatapackStore::contains(const Key& key) {
-  for (auto& it : packs_) {
-    auto& pack = it.second;
+  auto node = (const uint8_t*)key.node;
+  auto inPack = [node](const std::shared_ptr<datapack_handle_t>& pack) {
     pack_index_entry_t packindex;
-    if (find(pack.get(), (uint8_t*)key.node, &packindex)) {
-      return true;
-    }
-  }
+    return find(pack.get(), node, &packindex);
+  };
 
-  // Check if there are new packs available
-  auto rescanned = rescan();
-  for (auto& pack : rescanned) {
-    pack_index_entry_t packindex;
-    if (find(pack.get(), (uint8_t*)key.node, &packindex)) {
-      return true;
-    }
+  if (forEachCandidatePack(node, inPack)) {
+    return true;
   }
 
-  return false;
+  // Check if there are new packs available
+  return !rescan().empty() && forEachCandidatePack(node, inPack);
 }
 
 std::shared_ptr<KeyIterator> DatapackStore::getMissing(KeyIterator& missing) {
@@ -187,47 +369,185 @@ std::shared_ptr<KeyIterator> DatapackStore::getMissing(KeyIterator& missing) {
 
 std::vector<std::shared_ptr<datapack_handle_t>> DatapackStore::rescan() {
   constexpr auto PACK_REFRESH_RATE = std::chrono::milliseconds(100);
-  auto now = steady_clock::now();
 
   std::vector<std::shared_ptr<datapack_handle_t>> newPacks;
+  // While path_ is watched, a miss only reads the pending events, and path_
+  // is listed again only if some were lost.
+  if (watchFd_ >= 0) {
+    if (readPackEvents(newPacks)) {
+      return newPacks;
+    }
+    nextRefresh_ = steady_clock::time_point();
+  }
+
+  auto now = steady_clock::now();
   if (nextRefresh_ <= now) {
-    auto availablePacks = getAvailablePackFileNames(path_);
-
-    // Garbage collect removed pack files
-    if (removeOnRefresh_) {
-      auto it = packs_.begin();
-      while (it != packs_.end()) {
-        if (availablePacks.find(it->first) == availablePacks.end()) {
-          // This pack file no longer exists, we
-          // can forget it
-          it = packs_.erase(it);
-          continue;
-        }
-        ++it;
+    // path_ may not have existed when the store was created
+    startWatching();
+    scanDirectory(newPacks);
+    nextRefresh_ = now + PACK_REFRESH_RATE;
+  }
+
+  return newPacks;
+}
+
+void DatapackStore::scanDirectory(
+    std::vector<std::shared_ptr<datapack_handle_t>>& newPacks) {
+  auto availablePacks = getAvailablePackFileNames(path_);
+
+  // Garbage collect removed pack files
+  if (removeOnRefresh_) {
+    bool removedAny = false;
+    auto it = packs_.begin();
+    while (it != packs_.end()) {
+      if (availablePacks.find(it->first) == availablePacks.end()) {
+        // This pack file no longer exists, we
+        // can forget it
+        it = packs_.erase(it);
+        removedAny = true;
+        continue;
+      }
+      ++it;
+    }
+    if (removedAny) {
+      rebuildIndex();
+    }
+  }
+
+  // Add any newly discovered files
+  for (const auto& packPath : availablePacks) {
+    if (packs_.find(packPath) == packs_.end()) {
+      // We haven't loaded this path yet, do so now
+      auto newPack = addPack(packPath);
+      if (newPack) {
+        newPacks.push_back(std::move(newPack));
       }
     }
+  }
+}
+
+#ifdef __linux__
+void DatapackStore::startWatching() {
+  if (watchFd_ >= 0 && watchPid_ == getpid()) {
+    return;
+  }
+  // A watch inherited across fork is shared with the parent
+  stopWatching();
+
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  constexpr uint32_t kEvents = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO |
+      IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+  if (inotify_add_watch(fd, path_.c_str(), kEvents) < 0) {
+    close(fd);
+    return;
+  }
+  watchFd_ = fd;
+  watchPid_ = getpid();
+}
 
-    // Add any newly discovered files
-    for (const auto& packPath : availablePacks) {
-      if (packs_.find(packPath) == packs_.end()) {
-        // We haven't loaded this path yet, do so now
+void DatapackStore::stopWatching() {
+  if (watchFd_ >= 0) {
+    close(watchFd_);
+    watchFd_ = -1;
+  }
+}
+
+bool DatapackStore::readPackEvents(
+    std::vector<std::shared_ptr<datapack_handle_t>>& newPacks) {
+  if (watchPid_ != getpid()) {
+    startWatching();
+    return false;
+  }
+
+  auto directory = packDirectory(path_);
+  bool lost = false;
+  bool removedAny = false;
+  alignas(inotify_event) char buffer[16 * 1024];
+  while (watchFd_ >= 0) {
+    auto length = read(watchFd_, buffer, sizeof(buffer));
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        stopWatching();
+        lost = true;
+      }
+      break;
+    }
+
+    const char* end = buffer + length;
+    for (const char* p = buffer; p < end;) {
+      auto event = reinterpret_cast<const inotify_event*>(p);
+      p += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        lost = true;
+        continue;
+      }
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+        // path_ itself went away; list it until it is back
+        stopWatching();
+        lost = true;
+        break;
+      }
+      if (event->len == 0) {
+        continue;
+      }
+
+      size_t nameLength = strlen(event->name);
+      size_t suffixLength;
+      if (hasSuffix(event->name, nameLength, PACKSUFFIX, PACKSUFFIXLEN)) {
+        suffixLength = PACKSUFFIXLEN;
+      } else if (hasSuffix(
+                     event->name, nameLength, INDEXSUFFIX, INDEXSUFFIXLEN)) {
+        suffixLength = INDEXSUFFIXLEN;
+      } else {
+        continue;
+      }
+      std::string packPath =
+          directory + std::string(event->name, nameLength - suffixLength);
+
+      if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        // Chains read from the pack keep it mapped until they are freed
+        if (removeOnRefresh_ && packs_.erase(packPath)) {
+          removedAny = true;
+        }
+      } else if (packs_.find(packPath) == packs_.end()) {
+        // Either half of a pack may arrive first; opening fails until
+        // both are there, and the event for the other half retries.
         auto newPack = addPack(packPath);
         if (newPack) {
           newPacks.push_back(std::move(newPack));
         }
       }
     }
+  }
 
-    nextRefresh_ = now + PACK_REFRESH_RATE;
+  if (removedAny) {
+    rebuildIndex();
   }
+  return !lost;
+}
+#else
+void DatapackStore::startWatching() {}
 
-  return newPacks;
+void DatapackStore::stopWatching() {}
+
+bool DatapackStore::readPackEvents(
+    std::vector<std::shared_ptr<datapack_handle_t>>& /*newPacks*/) {
+  return false;
 }
+#endif
 
 void DatapackStore::refresh() {
   rescan();
 }
 
 void DatapackStore::markForRefresh() {
+  // While path_ is watched, the pending events already say what changed
   nextRefresh_ = steady_clock::time_point();
 }
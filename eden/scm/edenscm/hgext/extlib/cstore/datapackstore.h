@@ -47,32 +47,76 @@ class DatapackStore : public DataStore {
   bool removeOnRefresh_{false};
   std::unordered_map<std::string, std::shared_ptr<datapack_handle_t>> packs_;
 
+  /* An index over the nodes of every pack in packs_, so that a lookup costs
+   * one binary search however many packs there are.  Entries are sorted by
+   * the first 8 bytes of their node; the pack they name checks the rest. */
+  struct IndexEntry {
+    uint64_t prefix;
+    uint32_t pack;
+  };
+  std::vector<IndexEntry> index_;
+  std::vector<std::shared_ptr<datapack_handle_t>> indexedPacks_;
+
+  /* On Linux, an inotify descriptor watching path_, so that only the pack
+   * files that changed are looked at.  -1 when path_ is instead listed at
+   * most every PACK_REFRESH_RATE. */
+  int watchFd_{-1};
+  /* The process that created watchFd_.  A forked child must not read its
+   * parent's events, so it makes its own watch. */
+  int watchPid_{0};
+
   std::shared_ptr<datapack_handle_t> addPack(const std::string& path);
   std::vector<std::shared_ptr<datapack_handle_t>> rescan();
 
+  /* Opens the packs in path_ that are not open yet, and forgets the ones
+   * that were removed if removeOnRefresh_ is set. */
+  void scanDirectory(
+      std::vector<std::shared_ptr<datapack_handle_t>>& newPacks);
+
+  void startWatching();
+  void stopWatching();
+  /* Opens or forgets the packs that watchFd_ reported changes to.  Returns
+   * false if events were lost, and path_ has to be listed again. */
+  bool readPackEvents(
+      std::vector<std::shared_ptr<datapack_handle_t>>& newPacks);
+
+  /* Adds the nodes of pack to index_. */
+  void indexPack(const std::shared_ptr<datapack_handle_t>& pack);
+  void rebuildIndex();
+
+  /* Calls fn with each pack that may contain node, as a
+   * std::shared_ptr<datapack_handle_t>, until it returns true.  Returns
+   * whether fn returned true. */
+  template <typename Fn>
+  bool forEachCandidatePack(const uint8_t* node, Fn&& fn);
+
  public:
   ~DatapackStore();
   /** Initialize the store for the specified path.
    * If removeDeadPackFilesOnRefresh is set to true (NOT the default),
-   * then the rescan() method can choose to unmap pack files that
-   * have been deleted.  Since the DataStore API doesn't provide
-   * for propagating ownership out through the DeltaChain and DeltaChain
-   * iterator, it is not safe to removeDeadPackFilesOnRefresh if the calling
-   * code is keeping longlived references to those values; it is the
-   * responsibility of the calling code to ensure that the lifetime is
-   * managed correctly as it cannot be enforced automatically without
-   * restructing this API.
+   * then the rescan() method can choose to forget pack files that
+   * have been deleted.  The DeltaChains read from a pack keep it mapped
+   * until they are destroyed, but a DeltaChainLink is only valid while
+   * the chain or DeltaChainIterator it came from is alive.
    */
   explicit DatapackStore(
       const std::string& path,
       bool removeDeadPackFilesOnRefresh = false);
 
+  DatapackStore(const DatapackStore&) = delete;
+  DatapackStore& operator=(const DatapackStore&) = delete;
+
   DeltaChainIterator getDeltaChain(const Key& key) override;
 
   std::shared_ptr<KeyIterator> getMissing(KeyIterator& missing) override;
 
   std::shared_ptr<DeltaChain> getDeltaChainRaw(const Key& key) override;
 
+  /* Reads the chains in pack file order, and decompresses their links on
+   * several threads when there is enough to decompress. */
+  std::vector<std::shared_ptr<DeltaChain>> getDeltaChainsRaw(
+      const std::vector<Key>& keys) override;
+
   bool contains(const Key& key) override;
 
   void markForRefresh() override;
@@ -12,6 +12,7 @@
 #define FBHGEXT_DATASTORE_H
 
 #include <memory>
+#include <vector>
 
 #include "edenscm/hgext/extlib/cstore/deltachain.h"
 #include "edenscm/hgext/extlib/cstore/key.h"
@@ -27,6 +28,19 @@ class DataStore {
 
   virtual std::shared_ptr<DeltaChain> getDeltaChainRaw(const Key& key) = 0;
 
+  /* Returns the chain of each key, in order.  The chains of missing keys
+   * have a status other than GET_DELTA_CHAIN_OK.  Stores that can fetch
+   * many chains more cheaply than one at a time override this. */
+  virtual std::vector<std::shared_ptr<DeltaChain>> getDeltaChainsRaw(
+      const std::vector<Key>& keys) {
+    std::vector<std::shared_ptr<DeltaChain>> chains;
+    chains.reserve(keys.size());
+    for (const auto& key : keys) {
+      chains.push_back(getDeltaChainRaw(key));
+    }
+    return chains;
+  }
+
   virtual std::shared_ptr<KeyIterator> getMissing(KeyIterator& missing) = 0;
 
   virtual bool contains(const Key& key) = 0;
@@ -134,11 +134,17 @@ class DeltaChain {
 class CDeltaChain : public DeltaChain {
  private:
   delta_chain_t _chain;
+  // The links point into the pack's mapped files, so keep it open for as
+  // long as the chain lives.
+  std::shared_ptr<datapack_handle_t> _pack;
 
  public:
   // The constructor does a shallow copy of the delta chain and since the
   // ownership is taken by this class it is responsible for memory management
-  explicit CDeltaChain(delta_chain_t chain) : _chain(chain) {}
+  explicit CDeltaChain(
+      delta_chain_t chain,
+      std::shared_ptr<datapack_handle_t> pack = nullptr)
+      : _chain(chain), _pack(std::move(pack)) {}
 
   explicit CDeltaChain(get_delta_chain_code_t /*error*/)
       : _chain{GET_DELTA_CHAIN_NOT_FOUND, nullptr, 0} {}
@@ -180,6 +186,14 @@ class DeltaChainIterator {
   virtual ~DeltaChainIterator();
 
   DeltaChainLink next();
+
+  /*
+   * The chain that the link last returned by next() belongs to.  Holding it
+   * keeps the memory of that link valid after the iterator is gone.
+   */
+  std::shared_ptr<DeltaChain> currentChain() const {
+    return _chains.back();
+  }
 };
 
 #endif // FBHGEXT_DELTACHAIN_H
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+// py-bufferref.h - python buffers over store memory
+// no-check-code
+
+#ifndef FBHGEXT_CSTORE_PY_BUFFERREF_H
+#define FBHGEXT_CSTORE_PY_BUFFERREF_H
+
+// The PY_SSIZE_T_CLEAN define must be defined before the Python.h include,
+// as per the documentation.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "edenscm/hgext/extlib/cstore/py-structs.h"
+#include "edenscm/hgext/extlib/cstore/store.h"
+
+static void bufferref_dealloc(py_bufferref* self) {
+  self->ref.~ConstantStringRef();
+  PyObject_Del(self);
+}
+
+static Py_ssize_t bufferref_length(py_bufferref* self) {
+  return (Py_ssize_t)self->ref.size();
+}
+
+static PyObject* bufferref_str(py_bufferref* self) {
+  return PyString_FromStringAndSize(
+      self->ref.content(), (Py_ssize_t)self->ref.size());
+}
+
+static Py_ssize_t
+bufferref_getreadbuffer(py_bufferref* self, Py_ssize_t segment, void** ptr) {
+  if (segment != 0) {
+    PyErr_SetString(PyExc_SystemError, "accessing non-existent segment");
+    return -1;
+  }
+  *ptr = (void*)self->ref.content();
+  return (Py_ssize_t)self->ref.size();
+}
+
+static Py_ssize_t bufferref_getsegcount(py_bufferref* self, Py_ssize_t* len) {
+  if (len) {
+    *len = (Py_ssize_t)self->ref.size();
+  }
+  return 1;
+}
+
+static Py_ssize_t
+bufferref_getcharbuffer(py_bufferref* self, Py_ssize_t segment, char** ptr) {
+  return bufferref_getreadbuffer(self, segment, (void**)ptr);
+}
+
+static int bufferref_getbuffer(py_bufferref* self, Py_buffer* view, int flags) {
+  return PyBuffer_FillInfo(
+      view,
+      (PyObject*)self,
+      (void*)self->ref.content(),
+      (Py_ssize_t)self->ref.size(),
+      1 /* readonly */,
+      flags);
+}
+
+static PySequenceMethods bufferref_sequence_methods = {
+    (lenfunc)bufferref_length, /* sq_length */
+};
+
+static PyBufferProcs bufferref_buffer_procs = {
+    (readbufferproc)bufferref_getreadbuffer, /* bf_getreadbuffer */
+    0, /* bf_getwritebuffer */
+    (segcountproc)bufferref_getsegcount, /* bf_getsegcount */
+    (charbufferproc)bufferref_getcharbuffer, /* bf_getcharbuffer */
+    (getbufferproc)bufferref_getbuffer, /* bf_getbuffer */
+    0, /* bf_releasebuffer */
+};
+
+static PyTypeObject bufferrefType = {
+    PyObject_HEAD_INIT(NULL) 0, /* ob_size */
+    "cstore.bufferref", /* tp_name */
+    sizeof(py_bufferref), /* tp_basicsize */
+    0, /* tp_itemsize */
+    (destructor)bufferref_dealloc, /* tp_dealloc */
+    0, /* tp_print */
+    0, /* tp_getattr */
+    0, /* tp_setattr */
+    0, /* tp_compare */
+    0, /* tp_repr */
+    0, /* tp_as_number */
+    &bufferref_sequence_methods, /* tp_as_sequence - length/contains */
+    0, /* tp_as_mapping - getitem/setitem */
+    0, /* tp_hash */
+    0, /* tp_call */
+    (reprfunc)bufferref_str, /* tp_str */
+    0, /* tp_getattro */
+    0, /* tp_setattro */
+    &bufferref_buffer_procs, /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /* tp_flags */
+    "A read-only buffer over a text or delta held by a store", /* tp_doc */
+};
+
+/*
+ * Wraps ref in a bufferref, which supports both buffer protocols, so that
+ * a memoryview or buffer over it reads the store's memory without a copy.
+ */
+static PyObject* bufferref_new(ConstantStringRef ref) {
+  py_bufferref* self = PyObject_New(py_bufferref, &bufferrefType);
+  if (!self) {
+    return NULL;
+  }
+  // PyObject_New does not call the member constructor.
+  new (&self->ref) ConstantStringRef(std::move(ref));
+  return (PyObject*)self;
+}
+
+#endif /* FBHGEXT_CSTORE_PY_BUFFERREF_H */
@@ -43,6 +43,13 @@ PyMODINIT_FUNC initcstore(void) {
   Py_INCREF(&datapackstoreType);
   PyModule_AddObject(mod, "datapackstore", (PyObject*)&datapackstoreType);
 
+  // Init bufferref, which is only created by the stores
+  if (PyType_Ready(&bufferrefType) < 0) {
+    return;
+  }
+  Py_INCREF(&bufferrefType);
+  PyModule_AddObject(mod, "bufferref", (PyObject*)&bufferrefType);
+
   // Init datapackstore
   uniondatapackstoreType.tp_new = PyType_GenericNew;
   if (PyType_Ready(&uniondatapackstoreType) < 0) {
@@ -17,6 +17,7 @@
 #include <Python.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 extern "C" {
 #include "lib/cdatapack/cdatapack.h"
@@ -25,6 +26,7 @@ extern "C" {
 #include "edenscm/hgext/extlib/cstore/datapackstore.h"
 #include "edenscm/hgext/extlib/cstore/datastore.h"
 #include "edenscm/hgext/extlib/cstore/key.h"
+#include "edenscm/hgext/extlib/cstore/py-bufferref.h"
 #include "edenscm/hgext/extlib/cstore/py-structs.h"
 #include "edenscm/hgext/extlib/cstore/pythondatastore.h"
 #include "edenscm/hgext/extlib/cstore/pythonkeyiterator.h"
@@ -73,7 +75,9 @@ static PyObject* datapackstore_getdeltachain(
     Py_ssize_t namelen;
     char* node;
     Py_ssize_t nodelen;
-    if (!PyArg_ParseTuple(args, "s#s#", &name, &namelen, &node, &nodelen)) {
+    int views = 0;
+    if (!PyArg_ParseTuple(
+            args, "s#s#|i", &name, &namelen, &node, &nodelen, &views)) {
       return NULL;
     }
 
@@ -92,8 +96,13 @@ static PyObject* datapackstore_getdeltachain(
           PyString_FromStringAndSize((const char*)link.node(), NODE_SZ);
       PythonObj deltabasenode = PyString_FromStringAndSize(
           (const char*)link.deltabasenode(), NODE_SZ);
-      PythonObj delta = PyString_FromStringAndSize(
-          (const char*)link.delta(), (Py_ssize_t)link.deltasz());
+      PythonObj delta = views
+          ? bufferref_new(ConstantStringRef(
+                chain.currentChain(),
+                (const char*)link.delta(),
+                (size_t)link.deltasz()))
+          : PyString_FromStringAndSize(
+                (const char*)link.delta(), (Py_ssize_t)link.deltasz());
 
       PythonObj tuple = PyTuple_Pack(
           5,
@@ -382,7 +391,9 @@ static PyObject* uniondatapackstore_get(
   }
 }
 
-static PyObject* uniondatapackstore_getdeltachain(
+// Like get, but returns a read-only bufferref over the text rather than a
+// copy of it.
+static PyObject* uniondatapackstore_getview(
     py_uniondatapackstore* self,
     PyObject* args) {
   try {
@@ -396,6 +407,75 @@ static PyObject* uniondatapackstore_getdeltachain(
 
     Key key(name, namelen, node, nodelen);
 
+    return bufferref_new(self->uniondatapackstore->get(key));
+  } catch (const pyexception& ex) {
+    return NULL;
+  } catch (const MissingKeyError& ex) {
+    PyErr_SetString(PyExc_KeyError, ex.what());
+    return NULL;
+  } catch (const std::exception& ex) {
+    PyErr_SetString(PyExc_RuntimeError, ex.what());
+    return NULL;
+  }
+}
+
+// Takes an iterable of (name, node) tuples and returns a list of their texts,
+// with None for the keys that were not found.
+static PyObject* uniondatapackstore_getbatch(
+    py_uniondatapackstore* self,
+    PyObject* keys) {
+  try {
+    PythonObj inputIterator = PyObject_GetIter(keys);
+    PythonKeyIterator keysIter((PyObject*)inputIterator);
+
+    std::vector<Key> batch;
+    Key* key;
+    while ((key = keysIter.next()) != NULL) {
+      batch.push_back(*key);
+    }
+
+    std::vector<ConstantStringRef> fulltexts =
+        self->uniondatapackstore->getBatch(batch);
+
+    PythonObj result = PyList_New(0);
+    for (auto& fulltext : fulltexts) {
+      PythonObj text;
+      if (fulltext.content()) {
+        text = PyString_FromStringAndSize(fulltext.content(), fulltext.size());
+      } else {
+        Py_INCREF(Py_None);
+        text = Py_None;
+      }
+      if (PyList_Append(result, (PyObject*)text)) {
+        return NULL;
+      }
+    }
+
+    return result.returnval();
+  } catch (const pyexception& ex) {
+    return NULL;
+  } catch (const std::exception& ex) {
+    PyErr_SetString(PyExc_RuntimeError, ex.what());
+    return NULL;
+  }
+}
+
+static PyObject* uniondatapackstore_getdeltachain(
+    py_uniondatapackstore* self,
+    PyObject* args) {
+  try {
+    char* name;
+    Py_ssize_t namelen;
+    char* node;
+    Py_ssize_t nodelen;
+    int views = 0;
+    if (!PyArg_ParseTuple(
+            args, "s#s#|i", &name, &namelen, &node, &nodelen, &views)) {
+      return NULL;
+    }
+
+    Key key(name, namelen, node, nodelen);
+
     UnionDeltaChainIterator chain =
         self->uniondatapackstore->getDeltaChain(key);
 
@@ -409,8 +489,13 @@ static PyObject* uniondatapackstore_getdeltachain(
           PyString_FromStringAndSize((const char*)link.node(), NODE_SZ);
       PythonObj deltabasenode = PyString_FromStringAndSize(
           (const char*)link.deltabasenode(), NODE_SZ);
-      PythonObj delta = PyString_FromStringAndSize(
-          (const char*)link.delta(), (Py_ssize_t)link.deltasz());
+      PythonObj delta = views
+          ? bufferref_new(ConstantStringRef(
+                chain.currentChain(),
+                (const char*)link.delta(),
+                (size_t)link.deltasz()))
+          : PyString_FromStringAndSize(
+                (const char*)link.delta(), (Py_ssize_t)link.deltasz());
 
       PythonObj tuple = PyTuple_Pack(
           5,
@@ -473,15 +558,39 @@ static PyObject* uniondatapackstore_markforrefresh(
   Py_RETURN_NONE;
 }
 
-static PyObject* uniondatapackstore_getmetrics(
-    py_uniondatapackstore* /*self*/) {
-  return PyDict_New();
+static bool setMetric(PyObject* dict, const char* name, uint64_t value) {
+  PyObject* pyvalue = PyLong_FromUnsignedLongLong(value);
+  if (!pyvalue) {
+    return false;
+  }
+  int rc = PyDict_SetItemString(dict, name, pyvalue);
+  Py_DECREF(pyvalue);
+  return rc == 0;
+}
+
+static PyObject* uniondatapackstore_getmetrics(py_uniondatapackstore* self) {
+  const auto& cache = self->uniondatapackstore->textCache;
+  PyObject* metrics = PyDict_New();
+  if (!metrics) {
+    return NULL;
+  }
+  if (!setMetric(metrics, "textcachehits", cache.stats.hits) ||
+      !setMetric(metrics, "textcachesnapshothits", cache.stats.snapshotHits) ||
+      !setMetric(metrics, "textcachemisses", cache.stats.misses) ||
+      !setMetric(metrics, "textcachesize", cache.size()) ||
+      !setMetric(metrics, "textcachecount", cache.count())) {
+    Py_DECREF(metrics);
+    return NULL;
+  }
+  return metrics;
 }
 
 // --------- UnionDatapackStore Declaration ---------
 
 static PyMethodDef uniondatapackstore_methods[] = {
     {"get", (PyCFunction)uniondatapackstore_get, METH_VARARGS, ""},
+    {"getview", (PyCFunction)uniondatapackstore_getview, METH_VARARGS, ""},
+    {"getbatch", (PyCFunction)uniondatapackstore_getbatch, METH_O, ""},
     {"addstore", (PyCFunction)uniondatapackstore_addStore, METH_O, ""},
     {"removestore", (PyCFunction)uniondatapackstore_removeStore, METH_O, ""},
     {"getdeltachain",
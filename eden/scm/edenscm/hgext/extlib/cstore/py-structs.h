@@ -42,4 +42,14 @@ struct py_uniondatapackstore {
 };
 // clang-format on
 
+// clang-format off
+// A read-only buffer over memory owned by the store, such as a text in the
+// text cache or a delta chain, which it keeps alive.
+struct py_bufferref {
+  PyObject_HEAD
+
+  ConstantStringRef ref;
+};
+// clang-format on
+
 #endif // FBHGEXT_CSTORE_PY_STRUCTS_H
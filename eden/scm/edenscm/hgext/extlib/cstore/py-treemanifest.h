@@ -178,6 +178,88 @@ static PyTypeObject fileiterType = {
     (iternextfunc)fileiter_iterentriesnext, /* tp_iternext: next() method */
 };
 
+/**
+ * The state of a diffiter.  It is a separate struct so that its constructor
+ * can build the members of a py_diffiter in one placement new.
+ */
+struct diffiterstate {
+  PythonObj matcherObj;
+  PythonMatcher pythonMatcher;
+  AlwaysMatcher alwaysMatcher;
+  TreeDiffer differ;
+  bool done;
+
+  // The differences found by the last step that have not been returned yet,
+  // as a list of (path, value) tuples like the items of diff()'s result.
+  PythonObj items;
+  Py_ssize_t nextItem;
+
+  diffiterstate(
+      Manifest* selfmf,
+      Manifest* othermf,
+      const ManifestFetcher& fetcher,
+      bool clean,
+      PythonObj matcher)
+      : matcherObj(matcher),
+        pythonMatcher(matcher),
+        differ(
+            selfmf,
+            othermf,
+            "",
+            fetcher,
+            clean,
+            matcher ? static_cast<Matcher&>(pythonMatcher)
+                    : static_cast<Matcher&>(alwaysMatcher)),
+        done(false),
+        nextItem(0) {}
+};
+
+// clang-format off
+struct py_diffiter {
+  PyObject_HEAD
+
+  diffiterstate state;
+
+  // The differ points into both trees, so they are kept alive while it runs.
+  py_treemanifest* selftree;
+  py_treemanifest* othertree;
+};
+// clang-format on
+
+static void diffiter_dealloc(py_diffiter* self);
+static PyObject* diffiter_iternext(py_diffiter* self);
+static PyTypeObject diffiterType = {
+    PyObject_HEAD_INIT(NULL) 0, /*ob_size */
+    "treemanifest.diffiter", /*tp_name */
+    sizeof(py_diffiter), /*tp_basicsize */
+    0, /*tp_itemsize */
+    (destructor)diffiter_dealloc, /*tp_dealloc */
+    0, /*tp_print */
+    0, /*tp_getattr */
+    0, /*tp_setattr */
+    0, /*tp_compare */
+    0, /*tp_repr */
+    0, /*tp_as_number */
+    0, /*tp_as_sequence */
+    0, /*tp_as_mapping */
+    0, /*tp_hash */
+    0, /*tp_call */
+    0, /*tp_str */
+    0, /*tp_getattro */
+    0, /*tp_setattro */
+    0, /*tp_as_buffer */
+    /* tp_flags: Py_TPFLAGS_HAVE_ITER tells python to
+       use tp_iter and tp_iternext fields. */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_ITER,
+    "TODO", /* tp_doc */
+    0, /* tp_traverse */
+    0, /* tp_clear */
+    0, /* tp_richcompare */
+    0, /* tp_weaklistoffset */
+    PyObject_SelfIter, /* tp_iter: __iter__() method */
+    (iternextfunc)diffiter_iternext, /* tp_iternext: next() method */
+};
+
 static py_fileiter* createfileiter(
     py_treemanifest* pytm,
     bool includenode,
@@ -399,6 +481,47 @@ static PyObject* subtreeiter_iternext(py_subtreeiter* self) {
   return NULL;
 }
 
+// ==== py_diffiter functions ====
+
+static void diffiter_dealloc(py_diffiter* self) {
+  self->state.~diffiterstate();
+  Py_XDECREF(self->selftree);
+  Py_XDECREF(self->othertree);
+  PyObject_Del(self);
+}
+
+/**
+ * Returns the next (path, value) difference, diffing another batch of
+ * directories when the differences found so far have all been returned.
+ */
+static PyObject* diffiter_iternext(py_diffiter* self) {
+  diffiterstate& state = self->state;
+  try {
+    while (!state.items ||
+           state.nextItem >= PyList_GET_SIZE((PyObject*)state.items)) {
+      if (state.done) {
+        return NULL;
+      }
+      PythonDiffResult results(PyDict_New());
+      state.done = !state.differ.step(results);
+      state.items = PyDict_Items(results.getDiff());
+      state.nextItem = 0;
+    }
+
+    PyObject* item = PyList_GET_ITEM((PyObject*)state.items, state.nextItem);
+    state.nextItem++;
+    Py_INCREF(item);
+    return item;
+  } catch (const pyexception& ex) {
+    state.done = true;
+    return NULL;
+  } catch (const std::exception& ex) {
+    state.done = true;
+    PyErr_SetString(PyExc_RuntimeError, ex.what());
+    return NULL;
+  }
+}
+
 // ==== treemanifest functions ====
 
 /**
@@ -483,6 +606,71 @@ treemanifest_diff(PyObject* o, PyObject* args, PyObject* kwargs) {
   return results.getDiff().returnval();
 }
 
+/**
+ * Like diff(), but returns an iterator over the (path, value) items of the
+ * diff, which computes them a batch of directories at a time.
+ */
+static PyObject*
+treemanifest_diffiter(PyObject* o, PyObject* args, PyObject* kwargs) {
+  py_treemanifest* self = (py_treemanifest*)o;
+  PyObject* otherObj;
+  PyObject* matcherObj = NULL;
+  PyObject* cleanObj = NULL;
+  static char const* kwlist[] = {"m2", "matcher", "clean", NULL};
+
+  if (!PyArg_ParseTupleAndKeywords(
+          args,
+          kwargs,
+          "O|OO",
+          (char**)kwlist,
+          &otherObj,
+          &matcherObj,
+          &cleanObj)) {
+    return NULL;
+  }
+
+  py_treemanifest* other = (py_treemanifest*)otherObj;
+
+  PythonObj matcher;
+  if (matcherObj && matcherObj != Py_None) {
+    matcher = matcherObj;
+    Py_INCREF(matcherObj);
+  }
+
+  bool clean = false;
+  if (cleanObj && PyObject_IsTrue(cleanObj)) {
+    clean = true;
+  }
+
+  py_diffiter* pyiter = PyObject_New(py_diffiter, &diffiterType);
+  if (!pyiter) {
+    return NULL;
+  }
+  try {
+    // The provided created struct hasn't initialized our state member, so we
+    // do it manually.
+    new (&pyiter->state) diffiterstate(
+        self->tm.getRootManifest(),
+        other->tm.getRootManifest(),
+        self->tm.fetcher,
+        clean,
+        matcher);
+  } catch (const pyexception& ex) {
+    PyObject_Del(pyiter);
+    return NULL;
+  } catch (const std::exception& ex) {
+    PyObject_Del(pyiter);
+    PyErr_SetString(PyExc_RuntimeError, ex.what());
+    return NULL;
+  }
+
+  Py_INCREF(self);
+  pyiter->selftree = self;
+  Py_INCREF(other);
+  pyiter->othertree = other;
+  return (PyObject*)pyiter;
+}
+
 static PyObject*
 treemanifest_get(py_treemanifest* self, PyObject* args, PyObject* kwargs) {
   char* filename;
@@ -1627,6 +1815,10 @@ static PyMethodDef treemanifest_methods[] = {
      (PyCFunction)treemanifest_diff,
      METH_VARARGS | METH_KEYWORDS,
      "performs a diff of the given two manifests\n"},
+    {"diffiter",
+     (PyCFunction)treemanifest_diffiter,
+     METH_VARARGS | METH_KEYWORDS,
+     "iterates over the diff of the given two manifests as it is computed\n"},
     {"filesnotin",
      (PyCFunction)treemanifest_filesnotin,
      METH_VARARGS | METH_KEYWORDS,
@@ -13,39 +13,49 @@
 
 #include <cstddef>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "edenscm/hgext/extlib/cstore/key.h"
 
 class ConstantStringRef {
  private:
-  std::shared_ptr<std::string> str_;
+  // Keeps the memory that data_ points into alive.
+  std::shared_ptr<const void> owner_;
+  const char* data_ = NULL;
+  size_t size_ = 0;
 
  public:
   ConstantStringRef() = default;
 
   /** Make a copy of the provided string buffer */
   ConstantStringRef(const char* str, size_t size)
-      : str_(std::make_shared<std::string>(str, size)) {}
+      : ConstantStringRef(std::make_shared<std::string>(str, size)) {}
 
   /** Take ownership of an existing string */
   ConstantStringRef(std::string&& str)
-      : str_(std::make_shared<std::string>(std::move(str))) {}
+      : ConstantStringRef(std::make_shared<std::string>(std::move(str))) {}
 
   /** Take ownership of an existing shared_ptr<string> */
-  ConstantStringRef(std::shared_ptr<std::string> str) : str_(str) {}
+  ConstantStringRef(std::shared_ptr<std::string> str)
+      : owner_(str),
+        data_(str ? str->data() : NULL),
+        size_(str ? str->size() : 0) {}
 
-  const char* content() {
-    if (str_) {
-      return str_->data();
-    }
-    return NULL;
+  /** Refer to memory owned by owner, without copying it.  An empty str may
+   * be NULL, but the result still has content, unlike a missing value. */
+  ConstantStringRef(
+      std::shared_ptr<const void> owner,
+      const char* str,
+      size_t size)
+      : owner_(std::move(owner)), data_(str ? str : ""), size_(size) {}
+
+  const char* content() const {
+    return data_;
   }
 
-  size_t size() {
-    if (str_) {
-      return str_->size();
-    }
-    return 0;
+  size_t size() const {
+    return size_;
   }
 };
 
@@ -53,6 +63,19 @@ class Store {
  public:
   virtual ~Store() {}
   virtual ConstantStringRef get(const Key& key) = 0;
+
+  /* Returns the value of each key, in order.  A missing key either throws,
+   * as get() does, or comes back with no content.  Stores that can fetch
+   * many keys more cheaply than one at a time override this. */
+  virtual std::vector<ConstantStringRef> getBatch(
+      const std::vector<Key>& keys) {
+    std::vector<ConstantStringRef> results;
+    results.reserve(keys.size());
+    for (const auto& key : keys) {
+      results.push_back(get(key));
+    }
+    return results;
+  }
 };
 
 #endif // FBHGEXT_CSTORE_STORE_H
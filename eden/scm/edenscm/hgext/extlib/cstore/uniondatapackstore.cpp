@@ -18,10 +18,50 @@ extern "C" {
 #include "eden/scm/edenscm/mercurial/mpatch.h"
 }
 
-UnionDatapackStore::UnionDatapackStore() {}
+namespace {
+/* The number of bytes of rebuilt texts UnionDatapackStore keeps. */
+constexpr size_t kTextCacheSize = 32 * 1024 * 1024;
+
+/* Chains longer than this keep a snapshot of every kSnapshotInterval'th
+ * text while they are applied. */
+constexpr size_t kSnapshotInterval = 16;
+} // namespace
+
+std::shared_ptr<std::string> DeltaTextCache::get(const uint8_t* node) {
+  auto it = entries_.find(std::string((const char*)node, BIN_NODE_SIZE));
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->second;
+}
+
+void DeltaTextCache::insert(
+    const uint8_t* node,
+    std::shared_ptr<std::string> text) {
+  if (text->size() > maxSize_) {
+    return;
+  }
+  std::string key((const char*)node, BIN_NODE_SIZE);
+  if (entries_.find(key) != entries_.end()) {
+    return;
+  }
+
+  totalSize_ += text->size();
+  lru_.emplace_front(key, std::move(text));
+  entries_.emplace(std::move(key), lru_.begin());
+  while (totalSize_ > maxSize_) {
+    auto& oldest = lru_.back();
+    totalSize_ -= oldest.second->size();
+    entries_.erase(oldest.first);
+    lru_.pop_back();
+  }
+}
+
+UnionDatapackStore::UnionDatapackStore() : textCache(kTextCacheSize) {}
 
 UnionDatapackStore::UnionDatapackStore(std::vector<DataStore*>& stores)
-    : _stores(stores) {}
+    : _stores(stores), textCache(kTextCacheSize) {}
 
 UnionDatapackStore::~UnionDatapackStore() {
   // TODO: we should manage the substore lifetimes here, but because they are
@@ -47,49 +87,146 @@ mpatch_flist* getNextLink(void* container, ssize_t index) {
   return res;
 }
 
-ConstantStringRef UnionDatapackStore::get(const Key& key) {
-  UnionDeltaChainIterator chain = this->getDeltaChain(key);
-
-  std::vector<DeltaChainLink> links;
-
-  for (DeltaChainLink link = chain.next(); !link.isdone();
-       link = chain.next()) {
-    links.push_back(link);
-  }
-
-  DeltaChainLink fulltextLink = links.back();
-  links.pop_back();
-
-  // Short circuit and just return the full text if it's one long
-  if (links.size() == 0) {
-    return ConstantStringRef(
-        (const char*)fulltextLink.delta(), (size_t)fulltextLink.deltasz());
-  }
-
-  std::reverse(links.begin(), links.end());
-
-  mpatch_flist* patch = mpatch_fold(&links, getNextLink, 0, links.size());
+namespace {
+/* Applies links[begin, end), oldest first, to the base text. */
+std::shared_ptr<std::string> applyDeltas(
+    const char* base,
+    size_t baseSize,
+    std::vector<DeltaChainLink>& links,
+    size_t begin,
+    size_t end) {
+  mpatch_flist* patch = mpatch_fold(&links, getNextLink, begin, end);
   if (!patch) { /* error already set or memory error */
     throw std::logic_error("mpatch failed to fold patches");
   }
 
-  ssize_t outlen = mpatch_calcsize((ssize_t)fulltextLink.deltasz(), patch);
+  ssize_t outlen = mpatch_calcsize((ssize_t)baseSize, patch);
   if (outlen < 0) {
     mpatch_lfree(patch);
     throw std::logic_error("mpatch failed to calculate size");
   }
 
   auto result = std::make_shared<std::string>(outlen, '\0');
-  if (mpatch_apply(
-          &(*result)[0],
-          (const char*)fulltextLink.delta(),
-          (ssize_t)fulltextLink.deltasz(),
-          patch) < 0) {
+  if (mpatch_apply(&(*result)[0], base, (ssize_t)baseSize, patch) < 0) {
     mpatch_lfree(patch);
     throw std::logic_error("mpatch failed to apply patches");
   }
 
   mpatch_lfree(patch);
+  return result;
+}
+} // namespace
+
+ConstantStringRef UnionDatapackStore::get(const Key& key) {
+  auto node = (const uint8_t*)key.node;
+  if (auto cached = textCache.get(node)) {
+    ++textCache.stats.hits;
+    return ConstantStringRef(cached);
+  }
+
+  UnionDeltaChainIterator chain = this->getDeltaChain(key);
+  return buildText(node, chain);
+}
+
+std::vector<ConstantStringRef> UnionDatapackStore::getBatch(
+    const std::vector<Key>& keys) {
+  std::vector<ConstantStringRef> results(keys.size());
+  std::vector<size_t> remaining;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (auto cached = textCache.get((const uint8_t*)keys[i].node)) {
+      ++textCache.stats.hits;
+      results[i] = ConstantStringRef(cached);
+    } else {
+      remaining.push_back(i);
+    }
+  }
+
+  // Ask each store for the keys the stores before it did not have.
+  std::vector<std::shared_ptr<DeltaChain>> chains(keys.size());
+  for (auto* store : _stores) {
+    if (remaining.empty()) {
+      break;
+    }
+    std::vector<Key> batch;
+    batch.reserve(remaining.size());
+    for (auto i : remaining) {
+      batch.push_back(keys[i]);
+    }
+
+    auto found = store->getDeltaChainsRaw(batch);
+    std::vector<size_t> stillMissing;
+    for (size_t j = 0; j < remaining.size(); ++j) {
+      if (found[j]->status() == GET_DELTA_CHAIN_OK) {
+        chains[remaining[j]] = std::move(found[j]);
+      } else {
+        stillMissing.push_back(remaining[j]);
+      }
+    }
+    remaining.swap(stillMissing);
+  }
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (chains[i]) {
+      UnionDeltaChainIterator chain(*this, std::move(chains[i]));
+      results[i] = buildText((const uint8_t*)keys[i].node, chain);
+    }
+  }
+  return results;
+}
+
+ConstantStringRef UnionDatapackStore::buildText(
+    const uint8_t* node,
+    UnionDeltaChainIterator& chain) {
+  // Walk the chain until its full text, or until a text we already rebuilt.
+  std::vector<DeltaChainLink> links;
+  std::shared_ptr<std::string> snapshot;
+  for (DeltaChainLink link = chain.next(); !link.isdone();
+       link = chain.next()) {
+    if (!links.empty() && (snapshot = textCache.get(link.node()))) {
+      break;
+    }
+    links.push_back(link);
+  }
+
+  const char* base;
+  size_t baseSize;
+  if (snapshot) {
+    ++textCache.stats.snapshotHits;
+    base = snapshot->data();
+    baseSize = snapshot->size();
+  } else {
+    ++textCache.stats.misses;
+    DeltaChainLink fulltextLink = links.back();
+    links.pop_back();
+
+    // Short circuit and just return the full text if it's one long.  It
+    // points into the chain, so keep the chain rather than copy the text.
+    if (links.size() == 0) {
+      return ConstantStringRef(
+          chain.currentChain(),
+          (const char*)fulltextLink.delta(),
+          (size_t)fulltextLink.deltasz());
+    }
+    base = (const char*)fulltextLink.delta();
+    baseSize = (size_t)fulltextLink.deltasz();
+  }
+
+  std::reverse(links.begin(), links.end());
+
+  // Apply long chains in steps, keeping the text after each step so that
+  // later reads of the revisions in between can start from it.
+  std::shared_ptr<std::string> result;
+  for (size_t begin = 0; begin < links.size(); begin += kSnapshotInterval) {
+    size_t end = std::min(begin + kSnapshotInterval, links.size());
+    result = applyDeltas(base, baseSize, links, begin, end);
+    if (end < links.size()) {
+      textCache.insert(links[end - 1].node(), result);
+    }
+    base = result->data();
+    baseSize = result->size();
+  }
+
+  textCache.insert(node, result);
   return ConstantStringRef(result);
 }
 
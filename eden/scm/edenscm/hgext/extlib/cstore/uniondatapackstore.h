@@ -12,7 +12,11 @@
 #define FBHGEXT_CSTORE_UNIONDATAPACKSTORE_H
 
 #include <cstring>
+#include <list>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 extern "C" {
@@ -48,11 +52,69 @@ class UnionDeltaChainIterator : public DeltaChainIterator {
       : DeltaChainIterator(), _store(store) {
     _chains.push_back(this->getNextChain(key));
   }
+
+  /* Starts from a chain that has already been fetched. */
+  UnionDeltaChainIterator(
+      UnionDatapackStore& store,
+      std::shared_ptr<DeltaChain> chain)
+      : DeltaChainIterator(), _store(store) {
+    _chains.push_back(std::move(chain));
+  }
+};
+
+/* A bounded LRU cache of texts rebuilt from delta chains, keyed by node.
+ *
+ * Besides the texts that were asked for, UnionDatapackStore keeps a snapshot
+ * every few links along long chains, so reading a nearby revision later only
+ * applies the deltas above the closest snapshot. */
+class DeltaTextCache {
+ public:
+  struct Stats {
+    /* Texts served straight from the cache. */
+    uint64_t hits = 0;
+    /* Texts rebuilt starting from a cached snapshot. */
+    uint64_t snapshotHits = 0;
+    /* Texts rebuilt from the full text at the end of their chain. */
+    uint64_t misses = 0;
+  };
+
+  explicit DeltaTextCache(size_t maxSize) : maxSize_(maxSize) {}
+
+  /* Returns the text for node, or null. */
+  std::shared_ptr<std::string> get(const uint8_t* node);
+
+  /* Texts larger than the whole cache are not kept. */
+  void insert(const uint8_t* node, std::shared_ptr<std::string> text);
+
+  size_t size() const {
+    return totalSize_;
+  }
+
+  size_t count() const {
+    return entries_.size();
+  }
+
+  Stats stats;
+
+ private:
+  using Entry = std::pair<std::string, std::shared_ptr<std::string>>;
+
+  size_t maxSize_;
+  size_t totalSize_ = 0;
+  /* Most recently used first. */
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> entries_;
 };
 
 class UnionDatapackStore : public Store {
+ private:
+  ConstantStringRef buildText(
+      const uint8_t* node,
+      UnionDeltaChainIterator& chain);
+
  public:
   std::vector<DataStore*> _stores;
+  DeltaTextCache textCache;
 
   UnionDatapackStore();
 
@@ -62,6 +124,12 @@ class UnionDatapackStore : public Store {
 
   ConstantStringRef get(const Key& key) override;
 
+  /* Returns the text of each key, in order, fetching the first links of
+   * their chains from each substore in one batch.  The texts of missing
+   * keys have no content. */
+  std::vector<ConstantStringRef> getBatch(
+      const std::vector<Key>& keys) override;
+
   UnionDeltaChainIterator getDeltaChain(const Key& key);
 
   bool contains(const Key& key);
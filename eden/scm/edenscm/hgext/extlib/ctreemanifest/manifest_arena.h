@@ -0,0 +1,157 @@
+// Copyright (c) 2004-present, Facebook, Inc.
+// All Rights Reserved.
+//
+// This software may be used and distributed according to the terms of the
+// GNU General Public License version 2 or any later version.
+
+// manifest_arena.h - storage for the entries of a single manifest
+// no-check-code
+
+#ifndef FBHGEXT_CTREEMANIFEST_MANIFEST_ARENA_H
+#define FBHGEXT_CTREEMANIFEST_MANIFEST_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/**
+ * Hands out fixed size slots from a few large blocks, so that the entries of
+ * a manifest are not each a separate allocation.  A manifest parsed from the
+ * store reserves one slot per entry up front, so all of its entries sit in a
+ * single block in the order they are iterated.  Slots that are freed are
+ * reused by the next allocation.
+ *
+ * The slot size is set by the first allocation.  Requests of any other size
+ * go straight to the heap.
+ */
+class ManifestArena {
+ private:
+  static const size_t kMinBlockSlots = 8;
+
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  std::vector<void*> _blocks;
+  char* _cursor;
+  char* _end;
+  size_t _requestsize;
+  size_t _slotsize;
+  size_t _nextblockslots;
+  FreeSlot* _freelist;
+
+ public:
+  ManifestArena()
+      : _cursor(NULL),
+        _end(NULL),
+        _requestsize(0),
+        _slotsize(0),
+        _nextblockslots(kMinBlockSlots),
+        _freelist(NULL) {}
+
+  ManifestArena(const ManifestArena&) = delete;
+  ManifestArena& operator=(const ManifestArena&) = delete;
+
+  ~ManifestArena() {
+    for (size_t ix = 0; ix < _blocks.size(); ix++) {
+      ::operator delete(_blocks[ix]);
+    }
+  }
+
+  /**
+   * Sizes the next block to hold count slots, for callers that know how many
+   * entries they are about to add.
+   */
+  void reserve(size_t count) {
+    _nextblockslots = count > 0 ? count : 1;
+  }
+
+  void* allocate(size_t size) {
+    if (_requestsize == 0) {
+      const size_t align = alignof(std::max_align_t);
+      _requestsize = size;
+      _slotsize = (size + align - 1) / align * align;
+      if (_slotsize < sizeof(FreeSlot)) {
+        _slotsize = sizeof(FreeSlot);
+      }
+    }
+    if (size != _requestsize) {
+      return ::operator new(size);
+    }
+
+    if (_freelist) {
+      FreeSlot* slot = _freelist;
+      _freelist = slot->next;
+      return slot;
+    }
+
+    if (_cursor == _end) {
+      char* block = static_cast<char*>(
+          ::operator new(_nextblockslots * _slotsize));
+      _blocks.push_back(block);
+      _cursor = block;
+      _end = block + _nextblockslots * _slotsize;
+      // grow geometrically, so building a wide manifest a child at a time
+      // takes a logarithmic number of allocations.
+      _nextblockslots *= 2;
+    }
+
+    void* result = _cursor;
+    _cursor += _slotsize;
+    return result;
+  }
+
+  void deallocate(void* ptr, size_t size) {
+    if (size != _requestsize) {
+      ::operator delete(ptr);
+      return;
+    }
+
+    FreeSlot* slot = static_cast<FreeSlot*>(ptr);
+    slot->next = _freelist;
+    _freelist = slot;
+  }
+};
+
+/**
+ * Standard allocator interface over a ManifestArena, so that the containers
+ * in Manifest can keep their nodes in it.  The arena must outlive the
+ * container.
+ */
+template <typename T>
+class ManifestArenaAllocator {
+ public:
+  typedef T value_type;
+
+  ManifestArena* arena;
+
+  explicit ManifestArenaAllocator(ManifestArena* arena) : arena(arena) {}
+
+  template <typename U>
+  ManifestArenaAllocator(const ManifestArenaAllocator<U>& other)
+      : arena(other.arena) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(arena->allocate(count * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    arena->deallocate(ptr, count * sizeof(T));
+  }
+};
+
+template <typename T, typename U>
+bool operator==(
+    const ManifestArenaAllocator<T>& left,
+    const ManifestArenaAllocator<U>& right) {
+  return left.arena == right.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(
+    const ManifestArenaAllocator<T>& left,
+    const ManifestArenaAllocator<U>& right) {
+  return left.arena != right.arena;
+}
+
+#endif // FBHGEXT_CTREEMANIFEST_MANIFEST_ARENA_H
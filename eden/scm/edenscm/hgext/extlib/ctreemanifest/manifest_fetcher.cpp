@@ -26,3 +26,19 @@ ManifestPtr ManifestFetcher::get(
       _store->get(Key(path, pathlen, node.c_str(), node.size()));
   return ManifestPtr(new Manifest(content, node.c_str()));
 }
+
+std::vector<ManifestPtr> ManifestFetcher::getBatch(
+    const std::vector<Key>& keys) const {
+  std::vector<ConstantStringRef> contents = _store->getBatch(keys);
+
+  std::vector<ManifestPtr> results;
+  results.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (!contents[i].content()) {
+      // Let get() report the missing key the way it always has
+      contents[i] = _store->get(keys[i]);
+    }
+    results.push_back(ManifestPtr(new Manifest(contents[i], keys[i].node)));
+  }
+  return results;
+}
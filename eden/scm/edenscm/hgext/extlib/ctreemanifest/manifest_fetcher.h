@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "edenscm/hgext/extlib/cstore/store.h"
 #include "edenscm/hgext/extlib/ctreemanifest/manifest_ptr.h"
@@ -31,6 +32,13 @@ class ManifestFetcher {
    * Returns the manifest if found, or throws an exception if not found.
    */
   ManifestPtr get(const char* path, size_t pathlen, std::string& node) const;
+
+  /**
+   * Fetches the Manifests for several manifest keys with one request to the
+   * store.  Returns them in the order of the keys, or throws an exception if
+   * any of them is not found.
+   */
+  std::vector<ManifestPtr> getBatch(const std::vector<Key>& keys) const;
 };
 
 #endif // FBHGEXT_CTREEMANIFEST_MANIFEST_FETCHER_H
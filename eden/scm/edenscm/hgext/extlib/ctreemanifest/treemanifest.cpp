@@ -9,28 +9,101 @@
 
 #include "edenscm/hgext/extlib/ctreemanifest/treemanifest.h"
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
 
-/**
- * Helper function that performs the actual recursion on the tree entries.
- */
-void treemanifest_diffrecurse(
+namespace {
+// The number of directories TreeDiffer::step() fetches and diffs at once.
+constexpr size_t kDiffBatchSize = 1024;
+} // namespace
+
+TreeDiffer::TreeDiffer(
     Manifest* selfmf,
     Manifest* othermf,
-    std::string& path,
-    DiffResult& diff,
+    const std::string& path,
     const ManifestFetcher& fetcher,
     bool clean,
-    Matcher& matcher) {
+    Matcher& matcher)
+    : fetcher_(fetcher), clean_(clean), matcher_(matcher) {
+  DirectoryPair root{NULL, NULL, ManifestPtr(), ManifestPtr(), path};
+  if (selfmf != NULL) {
+    root.selfmf = ManifestPtr(selfmf);
+  }
+  if (othermf != NULL) {
+    root.othermf = ManifestPtr(othermf);
+  }
+  pending_.push_back(root);
+}
+
+bool TreeDiffer::step(DiffResult& diff) {
+  if (pending_.empty()) {
+    return false;
+  }
+
+  size_t count = std::min(pending_.size(), kDiffBatchSize);
+  std::vector<DirectoryPair> batch(pending_.begin(), pending_.begin() + count);
+  pending_.erase(pending_.begin(), pending_.begin() + count);
+
+  resolve(batch);
+  for (auto& pair : batch) {
+    diffDirectory(pair, diff);
+  }
+  return !pending_.empty();
+}
+
+void TreeDiffer::resolve(std::vector<DirectoryPair>& batch) {
+  std::vector<Key> keys;
+  std::vector<ManifestEntry*> entries;
+  auto wanted = [&](ManifestEntry* entry, const std::string& path) {
+    if (entry == NULL || !entry->resolved.isnull()) {
+      return;
+    }
+    std::string binnode = binfromhex(entry->get_node());
+    // Chop off the trailing slash
+    keys.emplace_back(
+        path.c_str(), path.size() - 1, binnode.c_str(), binnode.size());
+    entries.push_back(entry);
+  };
+  for (const auto& pair : batch) {
+    wanted(pair.selfentry, pair.path);
+    wanted(pair.otherentry, pair.path);
+  }
+
+  if (!keys.empty()) {
+    std::vector<ManifestPtr> manifests = fetcher_.getBatch(keys);
+    for (size_t i = 0; i < entries.size(); ++i) {
+      entries[i]->resolved = manifests[i];
+    }
+  }
+
+  for (auto& pair : batch) {
+    if (pair.selfentry != NULL) {
+      pair.selfmf = pair.selfentry->resolved;
+    }
+    if (pair.otherentry != NULL) {
+      pair.othermf = pair.otherentry->resolved;
+    }
+  }
+}
+
+void TreeDiffer::queue(ManifestEntry* selfentry, ManifestEntry* otherentry) {
+  pending_.push_back(DirectoryPair{
+      selfentry, otherentry, ManifestPtr(), ManifestPtr(), path_});
+}
+
+void TreeDiffer::diffDirectory(DirectoryPair& pair, DiffResult& diff) {
+  std::string& path = path_;
+  path = pair.path;
+
   ManifestIterator selfiter;
   ManifestIterator otheriter;
 
-  if (selfmf != NULL) {
-    selfiter = selfmf->getIterator();
+  if (!pair.selfmf.isnull()) {
+    selfiter = pair.selfmf->getIterator();
   }
-  if (othermf != NULL) {
-    otheriter = othermf->getIterator();
+  if (!pair.othermf.isnull()) {
+    otheriter = pair.othermf->getIterator();
   }
 
   // Iterate through both directory contents
@@ -71,13 +144,10 @@ void treemanifest_diffrecurse(
       // selfentry should be processed first and only exists in self
       selfentry->appendtopath(path);
       if (selfentry->isdirectory()) {
-        if (matcher.visitdir(path)) {
-          Manifest* selfchildmanifest =
-              selfentry->get_manifest(fetcher, path.c_str(), path.size());
-          treemanifest_diffrecurse(
-              selfchildmanifest, NULL, path, diff, fetcher, clean, matcher);
+        if (matcher_.visitdir(path)) {
+          queue(selfentry, NULL);
         }
-      } else if (matcher.matches(path)) {
+      } else if (matcher_.matches(path)) {
         diff.add(path, selfbinnode.c_str(), selfentry->flag, NULL, NULL);
       }
       selfiter.next();
@@ -85,13 +155,10 @@ void treemanifest_diffrecurse(
       // otherentry should be processed first and only exists in other
       otherentry->appendtopath(path);
       if (otherentry->isdirectory()) {
-        if (matcher.visitdir(path)) {
-          Manifest* otherchildmanifest =
-              otherentry->get_manifest(fetcher, path.c_str(), path.size());
-          treemanifest_diffrecurse(
-              NULL, otherchildmanifest, path, diff, fetcher, clean, matcher);
+        if (matcher_.visitdir(path)) {
+          queue(NULL, otherentry);
         }
-      } else if (matcher.matches(path)) {
+      } else if (matcher_.matches(path)) {
         diff.add(path, NULL, NULL, otherbinnode.c_str(), otherentry->flag);
       }
       otheriter.next();
@@ -105,52 +172,35 @@ void treemanifest_diffrecurse(
 
       // Filenames match - now compare directory vs file
       if (selfentry->isdirectory() && otherentry->isdirectory()) {
-        // Both are directories - recurse
-        if (matcher.visitdir(path) &&
-            (selfbinnode != otherbinnode || clean || selfbinnode.size() == 0)) {
-          Manifest* selfchildmanifest =
-              selfentry->get_manifest(fetcher, path.c_str(), path.size());
-          Manifest* otherchildmanifest =
-              otherentry->get_manifest(fetcher, path.c_str(), path.size());
-
-          treemanifest_diffrecurse(
-              selfchildmanifest,
-              otherchildmanifest,
-              path,
-              diff,
-              fetcher,
-              clean,
-              matcher);
+        // Both are directories - diff them in a later batch
+        if (matcher_.visitdir(path) &&
+            (selfbinnode != otherbinnode || clean_ ||
+             selfbinnode.size() == 0)) {
+          queue(selfentry, otherentry);
         }
       } else if (selfentry->isdirectory() && !otherentry->isdirectory()) {
-        if (matcher.matches(path)) {
+        if (matcher_.matches(path)) {
           // self is directory, other is not - process other then self
           diff.add(path, NULL, NULL, otherbinnode.c_str(), otherentry->flag);
         }
 
-        if (matcher.visitdir(path)) {
+        if (matcher_.visitdir(path)) {
           path.append(1, '/');
-          Manifest* selfchildmanifest =
-              selfentry->get_manifest(fetcher, path.c_str(), path.size());
-          treemanifest_diffrecurse(
-              selfchildmanifest, NULL, path, diff, fetcher, clean, matcher);
+          queue(selfentry, NULL);
         }
       } else if (!selfentry->isdirectory() && otherentry->isdirectory()) {
-        if (matcher.matches(path)) {
+        if (matcher_.matches(path)) {
           // self is not directory, other is - process self then other
           diff.add(path, selfbinnode.c_str(), selfentry->flag, NULL, NULL);
         }
 
-        if (matcher.visitdir(path)) {
+        if (matcher_.visitdir(path)) {
           path.append(1, '/');
-          Manifest* otherchildmanifest =
-              otherentry->get_manifest(fetcher, path.c_str(), path.size());
-          treemanifest_diffrecurse(
-              NULL, otherchildmanifest, path, diff, fetcher, clean, matcher);
+          queue(NULL, otherentry);
         }
       } else {
         // both are files
-        if (matcher.matches(path)) {
+        if (matcher_.matches(path)) {
           bool flagsdiffer =
               ((selfentry->flag && otherentry->flag &&
                 *selfentry->flag != *otherentry->flag) ||
@@ -163,7 +213,7 @@ void treemanifest_diffrecurse(
                 selfentry->flag,
                 otherbinnode.c_str(),
                 otherentry->flag);
-          } else if (clean) {
+          } else if (clean_) {
             diff.addclean(path);
           }
         }
@@ -176,6 +226,19 @@ void treemanifest_diffrecurse(
   }
 }
 
+void treemanifest_diffrecurse(
+    Manifest* selfmf,
+    Manifest* othermf,
+    std::string& path,
+    DiffResult& diff,
+    const ManifestFetcher& fetcher,
+    bool clean,
+    Matcher& matcher) {
+  TreeDiffer differ(selfmf, othermf, path, fetcher, clean, matcher);
+  while (differ.step(diff)) {
+  }
+}
+
 FindResult treemanifest::find(
     ManifestEntry* manifestentry,
     PathIterator& path,
@@ -219,7 +282,7 @@ FindResult treemanifest::find(
   } else {
     // position the iterator at the right location
     bool exacthit;
-    std::list<ManifestEntry>::iterator iterator =
+    ManifestEntryList::iterator iterator =
         manifest->findChild(word, wordlen, RESULT_DIRECTORY, &exacthit);
 
     ManifestEntry* entry;
@@ -311,7 +374,7 @@ static FindResult get_callback(
 
   // position the iterator at the right location
   bool exacthit;
-  std::list<ManifestEntry>::iterator iterator =
+  ManifestEntryList::iterator iterator =
       manifest->findChild(filename, filenamelen, result->resulttype, &exacthit);
 
   if (!exacthit) {
@@ -378,7 +441,7 @@ static FindResult set_callback(
 
   // position the iterator at the right location
   bool exacthit;
-  std::list<ManifestEntry>::iterator iterator =
+  ManifestEntryList::iterator iterator =
       manifest->findChild(filename, filenamelen, RESULT_FILE, &exacthit);
 
   if (!exacthit) {
@@ -447,7 +510,7 @@ static FindResult remove_callback(
 
   // position the iterator at the right location
   bool exacthit;
-  std::list<ManifestEntry>::iterator iterator =
+  ManifestEntryList::iterator iterator =
       manifest->findChild(filename, filenamelen, RESULT_FILE, &exacthit);
 
   if (exacthit) {
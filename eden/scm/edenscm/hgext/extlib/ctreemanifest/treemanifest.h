@@ -10,6 +10,7 @@
 #ifndef FBHGEXT_CTREEMANIFEST_TREEMANIFEST_H
 #define FBHGEXT_CTREEMANIFEST_TREEMANIFEST_H
 
+#include <deque>
 #include <memory>
 #include <string>
 #include <vector>
@@ -355,6 +356,59 @@ struct DiffResult {
   virtual void addclean(const std::string& path) = 0;
 };
 
+/**
+ * Diffs two trees a batch of directories at a time, breadth first.
+ *
+ * Before diffing a batch, it fetches the manifests of every directory in it
+ * with a single ManifestFetcher::getBatch, so a store that can fetch in bulk
+ * is asked once per batch rather than once per directory.  The results of
+ * each batch are reported to the DiffResult as step() walks it, so callers
+ * can consume a large diff as it is computed.
+ *
+ * The entries of the two trees must outlive the differ.
+ */
+class TreeDiffer {
+ public:
+  TreeDiffer(
+      Manifest* selfmf,
+      Manifest* othermf,
+      const std::string& path,
+      const ManifestFetcher& fetcher,
+      bool clean,
+      Matcher& matcher);
+
+  /**
+   * Diffs the next batch of directories.  Returns whether any are left.
+   */
+  bool step(DiffResult& diff);
+
+ private:
+  struct DirectoryPair {
+    // The entries of the directory in self and other, or NULL if it is not
+    // a directory on that side.  Both are NULL for the roots.
+    ManifestEntry* selfentry;
+    ManifestEntry* otherentry;
+    ManifestPtr selfmf;
+    ManifestPtr othermf;
+    // Ends with a slash, unless it is the root.
+    std::string path;
+  };
+
+  void resolve(std::vector<DirectoryPair>& batch);
+  void diffDirectory(DirectoryPair& pair, DiffResult& diff);
+  void queue(ManifestEntry* selfentry, ManifestEntry* otherentry);
+
+  ManifestFetcher fetcher_;
+  bool clean_;
+  Matcher& matcher_;
+  std::deque<DirectoryPair> pending_;
+  // The path of the directory being diffed.
+  std::string path_;
+};
+
+/**
+ * Diffs selfmf against othermf, reporting every difference to diff.
+ */
 extern void treemanifest_diffrecurse(
     Manifest* selfmf,
     Manifest* othermf,
@@ -19,6 +19,9 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include "eden/scm/edenscm/mercurial/bdiff.h"
 #include "eden/scm/edenscm/mercurial/bitmanipulation.h"
@@ -267,6 +270,46 @@ static struct bdiff_hunk* recurse(
   }
 }
 
+/* append the sentinel end hunk after curr, then normalize the hunk list */
+static int finish(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    struct bdiff_hunk* base,
+    struct bdiff_hunk* curr) {
+  int count = 0;
+
+  curr->next = (struct bdiff_hunk*)malloc(sizeof(struct bdiff_hunk));
+  if (!curr->next)
+    return -1;
+  curr = curr->next;
+  curr->a1 = curr->a2 = an;
+  curr->b1 = curr->b2 = bn;
+  curr->next = NULL;
+
+  /* normalize the hunk list, try to push each hunk towards the end */
+  for (curr = base->next; curr; curr = curr->next) {
+    struct bdiff_hunk* next = curr->next;
+
+    if (!next)
+      break;
+
+    if (curr->a2 == next->a1 || curr->b2 == next->b1)
+      while (curr->a2 < an && curr->b2 < bn && next->a1 < next->a2 &&
+             next->b1 < next->b2 && !cmp(a + curr->a2, b + curr->b2)) {
+        curr->a2++;
+        next->a1++;
+        curr->b2++;
+        next->b1++;
+      }
+  }
+
+  for (curr = base->next; curr; curr = curr->next)
+    count++;
+  return count;
+}
+
 int bdiff_diff(
     struct bdiff_line* a,
     int an,
@@ -285,40 +328,227 @@ int bdiff_diff(
     /* generate the matching block list */
 
     curr = recurse(a, b, pos, 0, an, 0, bn, base);
-    if (!curr)
-      return -1;
-
-    /* sentinel end hunk */
-    curr->next = (struct bdiff_hunk*)malloc(sizeof(struct bdiff_hunk));
-    if (!curr->next)
+    if (!curr) {
+      free(pos);
       return -1;
-    curr = curr->next;
-    curr->a1 = curr->a2 = an;
-    curr->b1 = curr->b2 = bn;
-    curr->next = NULL;
+    }
+    count = finish(a, an, b, bn, base, curr);
   }
 
   free(pos);
+  return count;
+}
 
-  /* normalize the hunk list, try to push each hunk towards the end */
-  for (curr = base->next; curr; curr = curr->next) {
-    struct bdiff_hunk* next = curr->next;
+/* the fewest lines of a worth diffing on a thread of its own */
+#define BDIFF_MIN_REGION_LINES 16384
+/* how far past its ideal position to look for each anchor line */
+#define BDIFF_ANCHOR_WINDOW 4096
+/* how many lines on either side of an anchor must match too */
+#define BDIFF_ANCHOR_CONTEXT 2
 
-    if (!next)
-      break;
+struct region {
+  struct bdiff_line *a, *b;
+  struct pos* pos;
+  int a1, a2, b1, b2;
+  struct bdiff_hunk head;
+  struct bdiff_hunk* tail;
+};
 
-    if (curr->a2 == next->a1 || curr->b2 == next->b1)
-      while (curr->a2 < an && curr->b2 < bn && next->a1 < next->a2 &&
-             next->b1 < next->b2 && !cmp(a + curr->a2, b + curr->b2)) {
-        curr->a2++;
-        next->a1++;
-        curr->b2++;
-        next->b1++;
-      }
-  }
+static void* diffregion(void* arg) {
+  struct region* r = (struct region*)arg;
+  r->tail = recurse(r->a, r->b, r->pos, r->a1, r->a2, r->b1, r->b2, &r->head);
+  return NULL;
+}
 
-  for (curr = base->next; curr; curr = curr->next)
+/*
+ * Whether a[i] and b[j] are the only copies of their line in either file,
+ * with matching lines around them, so that they are unlikely to be a line
+ * that moved.
+ */
+static int isanchor(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    const int* acounts,
+    int i,
+    int j) {
+  int k;
+
+  if (acounts[a[i].e] != 1 || b[j].n != -1)
+    return 0;
+  if (i < BDIFF_ANCHOR_CONTEXT || j < BDIFF_ANCHOR_CONTEXT ||
+      i + BDIFF_ANCHOR_CONTEXT >= an || j + BDIFF_ANCHOR_CONTEXT >= bn)
+    return 0;
+  for (k = 1; k <= BDIFF_ANCHOR_CONTEXT; k++)
+    if (a[i - k].e != b[j - k].e || a[i + k].e != b[j + k].e)
+      return 0;
+  return 1;
+}
+
+/*
+ * Picks up to nregions - 1 anchors spread evenly through a, each matching
+ * a line of b after the previous anchor's.  Returns the number of regions
+ * the anchors divide the files into, or -1 if out of memory.
+ */
+static int findanchors(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    int nregions,
+    int* anchora,
+    int* anchorb) {
+  int r, i, j = -1, limit, count = 0, preva = -1, prevb = -1, maxe = 0;
+  int* acounts;
+
+  /* count the copies of each line of a, by equivalence class */
+  for (i = 0; i < an; i++)
+    if (a[i].e > maxe)
+      maxe = a[i].e;
+  acounts = (int*)calloc(maxe + 1, sizeof(int));
+  if (!acounts)
+    return -1;
+  for (i = 0; i < an; i++)
+    acounts[a[i].e]++;
+
+  for (r = 1; r < nregions; r++) {
+    i = (int)((long long)an * r / nregions);
+    if (i <= preva)
+      i = preva + 1;
+    limit = i + BDIFF_ANCHOR_WINDOW < an ? i + BDIFF_ANCHOR_WINDOW : an;
+    for (; i < limit; i++) {
+      /* a[i].n is the last line of b that matches, unless too popular */
+      j = a[i].n;
+      if (j > prevb && isanchor(a, an, b, bn, acounts, i, j))
+        break;
+    }
+    if (i == limit)
+      continue;
+    anchora[count] = preva = i;
+    anchorb[count] = prevb = j;
     count++;
+  }
+  free(acounts);
+  return count + 1;
+}
+
+int bdiff_diff_parallel(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    struct bdiff_hunk* base,
+    int threads) {
+  struct bdiff_hunk* curr;
+  struct region* regions = NULL;
+  struct pos* pos = NULL;
+  int *anchora = NULL, *anchorb = NULL;
+  int nregions, r, count = -1;
+#ifndef _WIN32
+  pthread_t* tids = NULL;
+  char* started = NULL;
+#endif
+
+  nregions = an / BDIFF_MIN_REGION_LINES;
+  if (nregions > threads)
+    nregions = threads;
+#ifdef _WIN32
+  nregions = 1;
+#endif
+  if (nregions < 2)
+    return bdiff_diff(a, an, b, bn, base);
+
+  if (!equatelines(a, an, b, bn))
+    return 0;
+
+  pos = (struct pos*)calloc(bn ? bn : 1, sizeof(struct pos));
+  anchora = (int*)malloc(sizeof(int) * nregions);
+  anchorb = (int*)malloc(sizeof(int) * nregions);
+  regions = (struct region*)calloc(nregions, sizeof(struct region));
+#ifndef _WIN32
+  tids = (pthread_t*)malloc(sizeof(pthread_t) * nregions);
+  started = (char*)calloc(nregions, 1);
+  if (!tids || !started)
+    goto done;
+#endif
+  if (!pos || !anchora || !anchorb || !regions)
+    goto done;
+
+  /*
+   * Matching each anchor line to its only copy in b splits the files into
+   * regions that can be diffed independently.  Every line of b in a region
+   * falls in its own part of pos, and the rest of the line arrays is only
+   * read, so the regions can be diffed at the same time.
+   */
+  nregions = findanchors(a, an, b, bn, nregions, anchora, anchorb);
+  if (nregions < 0) {
+    nregions = 0;
+    goto done;
+  }
+  for (r = 0; r < nregions; r++) {
+    struct region* region = &regions[r];
+    region->a = a;
+    region->b = b;
+    region->pos = pos;
+    region->a1 = r ? anchora[r - 1] + 1 : 0;
+    region->b1 = r ? anchorb[r - 1] + 1 : 0;
+    region->a2 = r < nregions - 1 ? anchora[r] : an;
+    region->b2 = r < nregions - 1 ? anchorb[r] : bn;
+  }
+
+#ifndef _WIN32
+  for (r = 1; r < nregions; r++)
+    started[r] = !pthread_create(&tids[r], NULL, diffregion, &regions[r]);
+#endif
+  for (r = 0; r < nregions; r++) {
+#ifndef _WIN32
+    if (r && started[r]) {
+      pthread_join(tids[r], NULL);
+      continue;
+    }
+#endif
+    /* diff here any region that did not get a thread */
+    diffregion(&regions[r]);
+  }
+
+  /* stitch the regions together, with a hunk for each anchor between */
+  curr = base;
+  for (r = 0; r < nregions; r++) {
+    if (!regions[r].tail)
+      goto done;
+    if (regions[r].head.next) {
+      curr->next = regions[r].head.next;
+      curr = regions[r].tail;
+      regions[r].head.next = NULL;
+    }
+    if (r == nregions - 1)
+      break;
+    curr->next = (struct bdiff_hunk*)malloc(sizeof(struct bdiff_hunk));
+    if (!curr->next)
+      goto done;
+    curr = curr->next;
+    curr->a1 = anchora[r];
+    curr->a2 = anchora[r] + 1;
+    curr->b1 = anchorb[r];
+    curr->b2 = anchorb[r] + 1;
+    curr->next = NULL;
+  }
+  count = finish(a, an, b, bn, base, curr);
+
+done:
+  if (regions) {
+    for (r = 0; r < nregions; r++)
+      bdiff_freehunks(regions[r].head.next);
+  }
+#ifndef _WIN32
+  free(started);
+  free(tids);
+#endif
+  free(regions);
+  free(anchorb);
+  free(anchora);
+  free(pos);
   return count;
 }
 
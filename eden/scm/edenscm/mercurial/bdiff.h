@@ -36,6 +36,18 @@ int bdiff_diff(
     struct bdiff_line* b,
     int bn,
     struct bdiff_hunk* base);
+/*
+ * Like bdiff_diff, but splits large inputs at lines they share and diffs
+ * the pieces on up to threads threads.  The result is a valid list of
+ * matching blocks, though not always the same one bdiff_diff would find.
+ */
+int bdiff_diff_parallel(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    struct bdiff_hunk* base,
+    int threads);
 void bdiff_freehunks(struct bdiff_hunk* l);
 
 #endif
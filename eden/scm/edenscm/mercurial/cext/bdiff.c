@@ -70,17 +70,17 @@ static PyObject* bdiff(PyObject* self, PyObject* args) {
   Py_buffer ya, yb;
   struct bdiff_line *al, *bl;
   struct bdiff_hunk l, *h;
-  int an, bn, count;
+  int an, bn, count, threads = 1;
   Py_ssize_t len = 0, la, lb, li = 0, lcommon = 0, lmax;
   PyThreadState* _save;
 
   l.next = NULL;
 
 #ifdef IS_PY3K
-  if (!PyArg_ParseTuple(args, "y*y*:bdiff", &ya, &yb))
+  if (!PyArg_ParseTuple(args, "y*y*|i:bdiff", &ya, &yb, &threads))
     return NULL;
 #else
-  if (!PyArg_ParseTuple(args, "s*s*:bdiff", &ya, &yb))
+  if (!PyArg_ParseTuple(args, "s*s*|i:bdiff", &ya, &yb, &threads))
     return NULL;
 #endif
   sa = ya.buf;
@@ -106,7 +106,10 @@ static PyObject* bdiff(PyObject* self, PyObject* args) {
   if (!al || !bl)
     goto nomem;
 
-  count = bdiff_diff(al, an, bl, bn, &l);
+  if (threads > 1)
+    count = bdiff_diff_parallel(al, an, bl, bn, &l, threads);
+  else
+    count = bdiff_diff(al, an, bl, bn, &l);
   if (count < 0)
     goto nomem;
 
@@ -195,7 +198,10 @@ nomem:
 static char mdiff_doc[] = "Efficient binary diff.";
 
 static PyMethodDef methods[] = {
-    {"bdiff", bdiff, METH_VARARGS, "calculate a binary diff\n"},
+    {"bdiff",
+     bdiff,
+     METH_VARARGS,
+     "calculate a binary diff, of large inputs on up to threads threads\n"},
     {"blocks", blocks, METH_VARARGS, "find a list of matching lines\n"},
     {"fixws", fixws, METH_VARARGS, "normalize diff whitespaces\n"},
     {NULL, NULL}};
@@ -7,4 +7,6 @@ from typing import List, Tuple, Union
 
 def blocks(a: str, b: str) -> List[Tuple[int, int, int, int]]: ...
 def fixws(s: str, allws: bool) -> bytes: ...
-def bdiff(a: Union[str, bytes], b: Union[str, bytes]) -> bytes: ...
+def bdiff(
+    a: Union[str, bytes], b: Union[str, bytes], threads: int = ...
+) -> bytes: ...
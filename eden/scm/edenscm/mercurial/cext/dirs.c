@@ -16,31 +16,48 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <string.h>
 
 #include "eden/scm/edenscm/mercurial/cext/util.h"
 
-#ifdef IS_PY3K
-#define PYLONG_VALUE(o) ((PyLongObject*)o)->ob_digit[1]
-#else
-#define PYLONG_VALUE(o) PyInt_AS_LONG(o)
-#endif
-
 /*
  * This is a multiset of directory names, built from the files that
  * appear in a dirstate or manifest.
  *
- * A few implementation notes:
- *
- * We modify Python integers for refcounting, but those integers are
- * never visible to Python code.
- *
- * We mutate strings in-place, but leave them immutable once they can
- * be seen by Python code.
+ * The names are kept in an arena, a single buffer they are appended
+ * to, and indexed by an open addressing hash table of (hash, offset,
+ * length, count) entries.  Looking up a prefix of a path hashes it in
+ * place, so adding and removing paths creates no Python objects at all.
+ * The names of removed directories stay in the arena until the table
+ * is next resized, when it is compacted if they are most of it.
  */
+
+/* a slot of the table, 16 bytes so that four fit in a cache line */
+typedef struct {
+  /* 0 if the slot has never been used */
+  uint32_t hash;
+  uint32_t len;
+  uint32_t offset;
+  /* the number of paths under the directory, 0 if it was removed */
+  uint32_t count;
+} direntry;
+
 typedef struct {
-  PyObject_HEAD PyObject* dict;
+  PyObject_HEAD direntry* table;
+  /* always a power of two */
+  Py_ssize_t capacity;
+  /* slots that are in use or were removed */
+  Py_ssize_t used;
+  Py_ssize_t live;
+  char* arena;
+  Py_ssize_t arenasize;
+  Py_ssize_t arenacapacity;
+  /* bytes of the arena whose directories were removed */
+  Py_ssize_t garbage;
 } dirsObject;
 
+static const Py_ssize_t dirs_mincapacity = 64;
+
 static inline Py_ssize_t _finddir(const char* path, Py_ssize_t pos) {
   while (pos != -1) {
     if (path[pos] == '/')
@@ -54,107 +71,207 @@ static inline Py_ssize_t _finddir(const char* path, Py_ssize_t pos) {
   return pos;
 }
 
-static int _addpath(PyObject* dirs, PyObject* path) {
-  const char* cpath = PyBytes_AS_STRING(path);
-  Py_ssize_t pos = PyBytes_GET_SIZE(path);
-  PyObject* key = NULL;
-  int ret = -1;
+/*
+ * Hashes name 8 bytes at a time, with a multiply and rotate per word.
+ * Never returns 0, so that 0 can mark an empty slot.
+ */
+static inline uint32_t _hashdir(const char* name, Py_ssize_t len) {
+  const uint64_t prime = 0x9e3779b97f4a7c15ULL;
+  uint64_t hash = (uint64_t)len * prime, word;
+  Py_ssize_t i = 0;
+
+  for (; i + 8 <= len; i += 8) {
+    memcpy(&word, name + i, 8);
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 29;
+  }
+  if (i < len) {
+    word = 0;
+    memcpy(&word, name + i, len - i);
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 29;
+  }
+  hash ^= hash >> 32;
+  return (uint32_t)hash ? (uint32_t)hash : 1;
+}
 
-  /* This loop is super critical for performance. That's why we inline
-   * access to Python structs instead of going through a supported API.
-   * The implementation, therefore, is heavily dependent on CPython
-   * implementation details. We also commit violations of the Python
-   * "protocol" such as mutating immutable objects. But since we only
-   * mutate objects created in this function or in other well-defined
-   * locations, the references are known so these violations should go
-   * unnoticed. The code for adjusting the length of a PyBytesObject is
-   * essentially a minimal version of _PyBytes_Resize. */
-  while ((pos = _finddir(cpath, pos - 1)) != -1) {
-    PyObject* val;
-
-    /* It's likely that every prefix already has an entry
-       in our dict. Try to avoid allocating and
-       deallocating a string for each prefix we check. */
-    if (key != NULL)
-      ((PyBytesObject*)key)->ob_shash = -1;
-    else {
-      /* Force Python to not reuse a small shared string. */
-      key = PyBytes_FromStringAndSize(cpath, pos < 2 ? 2 : pos);
-      if (key == NULL)
-        goto bail;
+/*
+ * Returns the slot holding name, or if there is none, the slot it
+ * should be inserted into, which is removed or empty.
+ */
+static direntry* _lookup(
+    const dirsObject* self,
+    const char* name,
+    Py_ssize_t len,
+    uint32_t hash) {
+  size_t mask = (size_t)self->capacity - 1;
+  size_t i = (size_t)hash & mask;
+  direntry* removed = NULL;
+
+  while (1) {
+    direntry* entry = &self->table[i];
+    if (entry->hash == 0)
+      return removed ? removed : entry;
+    if (entry->count == 0) {
+      if (!removed)
+        removed = entry;
+    } else if (
+        entry->hash == hash && (Py_ssize_t)entry->len == len &&
+        !memcmp(self->arena + entry->offset, name, len)) {
+      return entry;
     }
-    /* Py_SIZE(o) refers to the ob_size member of the struct. Yes,
-     * assigning to what looks like a function seems wrong. */
-    Py_SIZE(key) = pos;
-    ((PyBytesObject*)key)->ob_sval[pos] = '\0';
-
-    val = PyDict_GetItem(dirs, key);
-    if (val != NULL) {
-      PYLONG_VALUE(val) += 1;
-      break;
+    i = (i + 1) & mask;
+  }
+}
+
+/*
+ * Rebuilds the table with room for at least live * 2 entries, dropping
+ * removed slots, and compacts the arena if it is mostly garbage.
+ */
+static int _resize(dirsObject* self) {
+  direntry *oldtable = self->table, *entry;
+  Py_ssize_t oldcapacity = self->capacity, i;
+  Py_ssize_t capacity = dirs_mincapacity;
+  char* arena = self->arena;
+  Py_ssize_t arenasize = self->arenasize;
+
+  while (capacity < self->live * 2)
+    capacity *= 2;
+
+  self->table = PyMem_Calloc(capacity, sizeof(direntry));
+  if (self->table == NULL) {
+    self->table = oldtable;
+    PyErr_NoMemory();
+    return -1;
+  }
+
+  if (self->garbage > arenasize / 2) {
+    arena = PyMem_Malloc(self->arenacapacity);
+    if (arena == NULL) {
+      PyMem_Free(self->table);
+      self->table = oldtable;
+      PyErr_NoMemory();
+      return -1;
     }
+    arenasize = 0;
+  }
 
-    /* Force Python to not reuse a small shared int. */
-#ifdef IS_PY3K
-    val = PyLong_FromLong(0x1eadbeef);
-#else
-    val = PyInt_FromLong(0x1eadbeef);
-#endif
-
-    if (val == NULL)
-      goto bail;
-
-    PYLONG_VALUE(val) = 1;
-    ret = PyDict_SetItem(dirs, key, val);
-    Py_DECREF(val);
-    if (ret == -1)
-      goto bail;
-    Py_CLEAR(key);
+  self->capacity = capacity;
+  self->used = self->live;
+  for (i = 0; i < oldcapacity; i++) {
+    const direntry* old = &oldtable[i];
+    size_t j = (size_t)old->hash & ((size_t)capacity - 1);
+    if (old->count == 0)
+      continue;
+    while (self->table[j].hash != 0)
+      j = (j + 1) & ((size_t)capacity - 1);
+    entry = &self->table[j];
+    *entry = *old;
+    if (arena != self->arena) {
+      memcpy(arena + arenasize, self->arena + old->offset, old->len);
+      entry->offset = (uint32_t)arenasize;
+      arenasize += old->len;
+    }
   }
-  ret = 0;
 
-bail:
-  Py_XDECREF(key);
+  if (arena != self->arena) {
+    PyMem_Free(self->arena);
+    self->arena = arena;
+    self->arenasize = arenasize;
+    self->garbage = 0;
+  }
+  PyMem_Free(oldtable);
+  return 0;
+}
 
-  return ret;
+static int _insert(
+    dirsObject* self,
+    direntry* entry,
+    const char* name,
+    Py_ssize_t len,
+    uint32_t hash) {
+  if (self->arenasize + len > (Py_ssize_t)UINT32_MAX) {
+    PyErr_SetString(PyExc_OverflowError, "too many directories");
+    return -1;
+  }
+  if (self->arenasize + len > self->arenacapacity) {
+    Py_ssize_t capacity = self->arenacapacity ? self->arenacapacity : 4096;
+    char* arena;
+    while (capacity < self->arenasize + len)
+      capacity *= 2;
+    arena = PyMem_Realloc(self->arena, capacity);
+    if (arena == NULL) {
+      PyErr_NoMemory();
+      return -1;
+    }
+    self->arena = arena;
+    self->arenacapacity = capacity;
+  }
+
+  if (entry->hash == 0)
+    self->used++;
+  memcpy(self->arena + self->arenasize, name, len);
+  entry->hash = hash;
+  entry->offset = (uint32_t)self->arenasize;
+  entry->len = (uint32_t)len;
+  entry->count = 1;
+  self->arenasize += len;
+  self->live++;
+
+  /* keep at least a quarter of the slots empty, so lookups stay short */
+  if (self->used * 4 >= self->capacity * 3)
+    return _resize(self);
+  return 0;
 }
 
-static int _delpath(PyObject* dirs, PyObject* path) {
-  char* cpath = PyBytes_AS_STRING(path);
+static int _addpath(dirsObject* self, PyObject* path) {
+  const char* cpath = PyBytes_AS_STRING(path);
   Py_ssize_t pos = PyBytes_GET_SIZE(path);
-  PyObject* key = NULL;
-  int ret = -1;
 
-  while ((pos = _finddir(cpath, pos - 1)) != -1) {
-    PyObject* val;
+  /* every prefix that is already present has all of its own prefixes
+     present too, so stop at the first one */
+  do {
+    uint32_t hash;
+    direntry* entry;
+
+    pos = _finddir(cpath, pos - 1);
+    hash = _hashdir(cpath, pos);
+    entry = _lookup(self, cpath, pos, hash);
+    if (entry->count > 0) {
+      entry->count++;
+      break;
+    }
+    if (_insert(self, entry, cpath, pos, hash) == -1)
+      return -1;
+  } while (pos > 0);
 
-    key = PyBytes_FromStringAndSize(cpath, pos);
+  return 0;
+}
 
-    if (key == NULL)
-      goto bail;
+static int _delpath(dirsObject* self, PyObject* path) {
+  const char* cpath = PyBytes_AS_STRING(path);
+  Py_ssize_t pos = PyBytes_GET_SIZE(path);
+
+  do {
+    direntry* entry;
 
-    val = PyDict_GetItem(dirs, key);
-    if (val == NULL) {
+    pos = _finddir(cpath, pos - 1);
+    entry = _lookup(self, cpath, pos, _hashdir(cpath, pos));
+    if (entry->count == 0) {
       PyErr_SetString(PyExc_ValueError, "expected a value, found none");
-      goto bail;
+      return -1;
     }
 
-    if (--PYLONG_VALUE(val) <= 0) {
-      if (PyDict_DelItem(dirs, key) == -1)
-        goto bail;
-    } else
+    if (--entry->count > 0)
       break;
-    Py_CLEAR(key);
-  }
-  ret = 0;
-
-bail:
-  Py_XDECREF(key);
+    self->live--;
+    self->garbage += entry->len;
+  } while (pos > 0);
 
-  return ret;
+  return 0;
 }
 
-static int dirs_fromdict(PyObject* dirs, PyObject* source, char skipchar) {
+static int dirs_fromdict(dirsObject* self, PyObject* source, char skipchar) {
   PyObject *key, *value;
   Py_ssize_t pos = 0;
 
@@ -172,14 +289,14 @@ static int dirs_fromdict(PyObject* dirs, PyObject* source, char skipchar) {
         continue;
     }
 
-    if (_addpath(dirs, key) == -1)
+    if (_addpath(self, key) == -1)
       return -1;
   }
 
   return 0;
 }
 
-static int dirs_fromiter(PyObject* dirs, PyObject* source) {
+static int dirs_fromiter(dirsObject* self, PyObject* source) {
   PyObject *iter, *item = NULL;
   int ret;
 
@@ -193,7 +310,7 @@ static int dirs_fromiter(PyObject* dirs, PyObject* source) {
       break;
     }
 
-    if (_addpath(dirs, item) == -1)
+    if (_addpath(self, item) == -1)
       break;
     Py_CLEAR(item);
   }
@@ -204,52 +321,68 @@ static int dirs_fromiter(PyObject* dirs, PyObject* source) {
   return ret;
 }
 
+static void dirs_clear(dirsObject* self) {
+  PyMem_Free(self->table);
+  PyMem_Free(self->arena);
+  self->table = NULL;
+  self->arena = NULL;
+  self->capacity = self->used = self->live = 0;
+  self->arenasize = self->arenacapacity = self->garbage = 0;
+}
+
 /*
  * Calculate a refcounted set of directory names for the files in a
  * dirstate.
  */
 static int dirs_init(dirsObject* self, PyObject* args) {
-  PyObject *dirs = NULL, *source = NULL;
+  PyObject* source = NULL;
   char skipchar = 0;
   int ret = -1;
 
-  self->dict = NULL;
-
   if (!PyArg_ParseTuple(args, "|Oc:__init__", &source, &skipchar))
     return -1;
 
-  dirs = PyDict_New();
-
-  if (dirs == NULL)
+  dirs_clear(self);
+  self->table = PyMem_Calloc(dirs_mincapacity, sizeof(direntry));
+  if (self->table == NULL) {
+    PyErr_NoMemory();
     return -1;
+  }
+  self->capacity = dirs_mincapacity;
 
   if (source == NULL)
     ret = 0;
   else if (PyDict_Check(source))
-    ret = dirs_fromdict(dirs, source, skipchar);
+    ret = dirs_fromdict(self, source, skipchar);
   else if (skipchar)
     PyErr_SetString(
         PyExc_ValueError,
         "skip character is only supported "
         "with a dict source");
   else
-    ret = dirs_fromiter(dirs, source);
+    ret = dirs_fromiter(self, source);
 
   if (ret == -1)
-    Py_XDECREF(dirs);
-  else
-    self->dict = dirs;
+    dirs_clear(self);
 
   return ret;
 }
 
+static int dirs_checkinit(dirsObject* self) {
+  if (self->table == NULL) {
+    PyErr_SetString(PyExc_ValueError, "dirs is not initialized");
+    return -1;
+  }
+  return 0;
+}
+
 PyObject* dirs_addpath(dirsObject* self, PyObject* args) {
   PyObject* path;
 
   if (!PyArg_ParseTuple(args, "O!:addpath", &PyBytes_Type, &path))
     return NULL;
 
-  if (_addpath(self->dict, path) == -1)
+  if (dirs_checkinit(self) == -1 || _addpath(self, path) == -1)
     return NULL;
 
   Py_RETURN_NONE;
@@ -261,23 +394,56 @@ static PyObject* dirs_delpath(dirsObject* self, PyObject* args) {
   if (!PyArg_ParseTuple(args, "O!:delpath", &PyBytes_Type, &path))
     return NULL;
 
-  if (_delpath(self->dict, path) == -1)
+  if (dirs_checkinit(self) == -1 || _delpath(self, path) == -1)
     return NULL;
 
   Py_RETURN_NONE;
 }
 
 static int dirs_contains(dirsObject* self, PyObject* value) {
-  return PyBytes_Check(value) ? PyDict_Contains(self->dict, value) : 0;
+  const char* name;
+  Py_ssize_t len;
+
+  if (!PyBytes_Check(value) || self->table == NULL)
+    return 0;
+  name = PyBytes_AS_STRING(value);
+  len = PyBytes_GET_SIZE(value);
+  return _lookup(self, name, len, _hashdir(name, len))->count > 0;
+}
+
+static Py_ssize_t dirs_length(dirsObject* self) {
+  return self->live;
 }
 
 static void dirs_dealloc(dirsObject* self) {
-  Py_XDECREF(self->dict);
+  dirs_clear(self);
   PyObject_Del(self);
 }
 
+/* Iterates over a snapshot of the names, so the set can change meanwhile. */
 static PyObject* dirs_iter(dirsObject* self) {
-  return PyObject_GetIter(self->dict);
+  PyObject *names, *iter;
+  Py_ssize_t i, n = 0;
+
+  names = PyList_New(self->live);
+  if (names == NULL)
+    return NULL;
+  for (i = 0; i < self->capacity; i++) {
+    const direntry* entry = &self->table[i];
+    PyObject* name;
+    if (entry->count == 0)
+      continue;
+    name = PyBytes_FromStringAndSize(self->arena + entry->offset, entry->len);
+    if (name == NULL) {
+      Py_DECREF(names);
+      return NULL;
+    }
+    PyList_SET_ITEM(names, n++, name);
+  }
+
+  iter = PyObject_GetIter(names);
+  Py_DECREF(names);
+  return iter;
 }
 
 static PySequenceMethods dirs_sequence_methods;
@@ -292,6 +458,7 @@ static PyTypeObject dirsType = {PyVarObject_HEAD_INIT(NULL, 0)};
 
 void dirs_module_init(PyObject* mod) {
   dirs_sequence_methods.sq_contains = (objobjproc)dirs_contains;
+  dirs_sequence_methods.sq_length = (lenfunc)dirs_length;
   dirsType.tp_name = "parsers.dirs";
   dirsType.tp_new = PyType_GenericNew;
   dirsType.tp_basicsize = sizeof(dirsObject);
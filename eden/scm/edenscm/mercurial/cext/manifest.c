@@ -24,6 +24,9 @@
 #include "eden/scm/edenscm/mercurial/cext/util.h"
 
 #define DEFAULT_LINES 100000
+#define MIN_ADDED_LINES 64
+#define MIN_DIFF_SPAN 16
+#define MAX_DIFF_SPAN 4096
 
 typedef struct {
 #ifdef IS_PY3K
@@ -37,13 +40,25 @@ typedef struct {
   bool deleted;
 } line;
 
+/*
+ * Lines added by setitem wait in a small sorted array of their own, as
+ * inserting each into 'lines' would move every line after it.  They are
+ * merged into 'lines' in a single pass once there are about the square root
+ * of numlines of them, or as soon as something needs one sorted array.
+ *
+ * A manifest that is not dirty holds its lines back to back in pydata.
+ */
 typedef struct {
   PyObject_HEAD PyObject* pydata;
   line* lines;
   int numlines; /* number of line entries */
-  int livelines; /* number of non-deleted lines */
+  int livelines; /* number of non-deleted lines, including added ones */
   int maxlines; /* allocated number of lines */
+  line* added; /* added lines, not yet merged into lines */
+  int numadded; /* number of added line entries */
+  int maxadded; /* allocated number of added lines */
   bool dirty;
+  bool suffixed; /* whether any line may have a hash_suffix */
 } lazymanifest;
 
 #define MANIFEST_OOM -1
@@ -156,6 +171,9 @@ static int lazymanifest_init(lazymanifest* self, PyObject* args) {
   err = PyBytes_AsStringAndSize(pydata, &data, &len);
 
   self->dirty = false;
+  self->suffixed = false;
+  self->added = NULL;
+  self->numadded = self->maxadded = 0;
   if (err == -1)
     return -1;
   self->pydata = pydata;
@@ -197,6 +215,15 @@ static void lazymanifest_dealloc(lazymanifest* self) {
     free(self->lines);
     self->lines = NULL;
   }
+  for (i = 0; i < self->numadded; i++) {
+    if (self->added[i].from_malloc) {
+      free((void*)self->added[i].start);
+    }
+  }
+  if (self->added) {
+    free(self->added);
+    self->added = NULL;
+  }
   if (self->pydata) {
     Py_DECREF(self->pydata);
     self->pydata = NULL;
@@ -398,6 +425,51 @@ static int linecmp(const void* left, const void* right) {
   return strcmp(((const line*)left)->start, ((const line*)right)->start);
 }
 
+/* find the line for needle's path, whether it was added or not */
+static line* findline(lazymanifest* self, line* needle) {
+  line* hit =
+      bsearch(needle, self->lines, self->numlines, sizeof(line), &linecmp);
+  if (!hit && self->numadded) {
+    hit = bsearch(needle, self->added, self->numadded, sizeof(line), &linecmp);
+  }
+  return hit;
+}
+
+/* Merge the added lines into the main array, from the end, so that no line
+ * is overwritten before it has moved. */
+static bool merge_added(lazymanifest* self) {
+  int i, j, k;
+  if (!self->numadded) {
+    return true;
+  }
+  if (self->numlines + self->numadded > self->maxlines) {
+    int maxlines = self->maxlines;
+    line* lines;
+    while (maxlines < self->numlines + self->numadded) {
+      maxlines *= 2;
+    }
+    lines = realloc(self->lines, maxlines * sizeof(line));
+    if (!lines) {
+      return false;
+    }
+    self->lines = lines;
+    self->maxlines = maxlines;
+  }
+  i = self->numlines - 1;
+  j = self->numadded - 1;
+  k = self->numlines + self->numadded - 1;
+  while (j >= 0) {
+    if (i >= 0 && linecmp(self->lines + i, self->added + j) > 0) {
+      self->lines[k--] = self->lines[i--];
+    } else {
+      self->lines[k--] = self->added[j--];
+    }
+  }
+  self->numlines += self->numadded;
+  self->numadded = 0;
+  return true;
+}
+
 static PyObject* lazymanifest_getitem(lazymanifest* self, PyObject* key) {
   line needle;
   line* hit;
@@ -415,7 +487,7 @@ static PyObject* lazymanifest_getitem(lazymanifest* self, PyObject* key) {
   }
   needle.start = PyBytes_AsString(key);
 #endif
-  hit = bsearch(&needle, self->lines, self->numlines, sizeof(line), &linecmp);
+  hit = findline(self, &needle);
   if (!hit || hit->deleted) {
     PyErr_Format(PyExc_KeyError, "No such manifest entry.");
     return NULL;
@@ -439,7 +511,7 @@ static int lazymanifest_delitem(lazymanifest* self, PyObject* key) {
   }
   needle.start = PyBytes_AsString(key);
 #endif
-  hit = bsearch(&needle, self->lines, self->numlines, sizeof(line), &linecmp);
+  hit = findline(self, &needle);
   if (!hit || hit->deleted) {
     PyErr_Format(PyExc_KeyError, "Tried to delete nonexistent manifest entry.");
     return -1;
@@ -450,40 +522,51 @@ static int lazymanifest_delitem(lazymanifest* self, PyObject* key) {
   return 0;
 }
 
-/* Do a binary search for the insertion point for new, creating the
- * new entry if needed. */
+/* Replace the line for new's path, or add new to the added lines if there
+ * is none yet. */
 static int internalsetitem(lazymanifest* self, line* new) {
-  int start = 0, end = self->numlines;
+  line* hit = findline(self, new);
+  int start = 0, end = self->numadded;
+  if (hit) {
+    if (hit->deleted)
+      self->livelines++;
+    if (hit->from_malloc)
+      free((void*)hit->start);
+    *hit = *new;
+    self->dirty = true;
+    return 0;
+  }
+  /* find the insertion point among the added lines */
   while (start < end) {
     int pos = start + (end - start) / 2;
-    int c = linecmp(new, self->lines + pos);
-    if (c < 0)
+    if (linecmp(new, self->added + pos) < 0)
       end = pos;
-    else if (c > 0)
+    else
       start = pos + 1;
-    else {
-      if (self->lines[pos].deleted)
-        self->livelines++;
-      if (self->lines[pos].from_malloc)
-        free((void*)self->lines[pos].start);
-      start = pos;
-      goto finish;
-    }
   }
-  /* being here means we need to do an insert */
-  if (!realloc_if_full(self)) {
-    PyErr_NoMemory();
-    return -1;
+  if (self->numadded == self->maxadded) {
+    int maxadded = self->maxadded ? self->maxadded * 2 : MIN_ADDED_LINES;
+    line* added = realloc(self->added, maxadded * sizeof(line));
+    if (!added) {
+      PyErr_NoMemory();
+      return -1;
+    }
+    self->added = added;
+    self->maxadded = maxadded;
   }
   memmove(
-      self->lines + start + 1,
-      self->lines + start,
-      (self->numlines - start) * sizeof(line));
-  self->numlines++;
+      self->added + start + 1,
+      self->added + start,
+      (self->numadded - start) * sizeof(line));
+  self->added[start] = *new;
+  self->numadded++;
   self->livelines++;
-finish:
-  self->lines[start] = *new;
   self->dirty = true;
+  /* if this fails, the added lines are merged by the next caller instead */
+  if (self->numadded >= MIN_ADDED_LINES &&
+      (double)self->numadded * self->numadded >= self->numlines) {
+    merge_added(self);
+  }
   return 0;
 }
 
@@ -586,6 +669,7 @@ lazymanifest_setitem(lazymanifest* self, PyObject* key, PyObject* value) {
   new.hash_suffix = '\0';
   if (hlen > 20) {
     new.hash_suffix = hash[20];
+    self->suffixed = true;
   }
   new.from_malloc = true; /* is `start` a pointer we allocated? */
   new.deleted = false; /* is this entry deleted? */
@@ -622,7 +706,7 @@ static int lazymanifest_contains(lazymanifest* self, PyObject* key) {
 #else
   needle.start = PyBytes_AsString(key);
 #endif
-  hit = bsearch(&needle, self->lines, self->numlines, sizeof(line), &linecmp);
+  hit = findline(self, &needle);
   if (!hit || hit->deleted) {
     return 0;
   }
@@ -654,6 +738,8 @@ static int compact(lazymanifest* self) {
   PyObject* pydata;
   if (!self->dirty)
     return 0;
+  if (!merge_added(self))
+    return -1;
   for (i = 0; i < self->numlines; i++) {
     if (!self->lines[i].deleted) {
       need += self->lines[i].len;
@@ -710,7 +796,10 @@ static lazymanifest* lazymanifest_copy(lazymanifest* self) {
   }
   copy->numlines = self->numlines;
   copy->livelines = self->livelines;
+  copy->added = NULL;
+  copy->numadded = copy->maxadded = 0;
   copy->dirty = false;
+  copy->suffixed = self->suffixed;
   copy->lines = malloc(self->maxlines * sizeof(line));
   if (!copy->lines) {
     goto nomem;
@@ -745,7 +834,10 @@ static lazymanifest* lazymanifest_filtercopy(
   if (!copy) {
     goto nomem;
   }
+  copy->added = NULL;
+  copy->numadded = copy->maxadded = 0;
   copy->dirty = true;
+  copy->suffixed = self->suffixed;
   copy->lines = malloc(self->maxlines * sizeof(line));
   if (!copy->lines) {
     goto nomem;
@@ -783,17 +875,34 @@ nomem:
   return NULL;
 }
 
+/* get the number of bytes in count lines from pos, which must be back to
+ * back */
+static Py_ssize_t spanlen(lazymanifest* self, int pos, int count) {
+  line* last = self->lines + pos + count - 1;
+  return last->start + last->len - self->lines[pos].start;
+}
+
 static PyObject* lazymanifest_diff(lazymanifest* self, PyObject* args) {
   lazymanifest* other;
   PyObject* pyclean = NULL;
-  bool listclean;
+  bool listclean, spans;
   PyObject *emptyTup = NULL, *ret = NULL;
   PyObject* es;
   int sneedle = 0, oneedle = 0;
+  int span = MIN_DIFF_SPAN;
   if (!PyArg_ParseTuple(args, "O!|O", &lazymanifestType, &other, &pyclean)) {
     return NULL;
   }
   listclean = (!pyclean) ? false : PyObject_IsTrue(pyclean);
+  if (!merge_added(self) || !merge_added(other)) {
+    goto nomem;
+  }
+  /* If neither manifest has changed since it was parsed, a run of lines
+   * that is the same in both is a span of equal bytes, which memcmp
+   * compares much faster than the lines one at a time.  The span grows
+   * while runs match and shrinks around a difference. */
+  spans = !listclean && !self->dirty && !self->suffixed && !other->dirty &&
+      !other->suffixed;
 #ifdef IS_PY3K
   es = PyUnicode_FromString("");
 #else
@@ -827,6 +936,26 @@ static PyObject* lazymanifest_diff(lazymanifest* self, PyObject* args) {
       oneedle++;
       continue;
     }
+    if (spans && sneedle < self->numlines && oneedle < other->numlines) {
+      int count = span;
+      Py_ssize_t slen;
+      if (count > self->numlines - sneedle)
+        count = self->numlines - sneedle;
+      if (count > other->numlines - oneedle)
+        count = other->numlines - oneedle;
+      slen = spanlen(self, sneedle, count);
+      if (slen == spanlen(other, oneedle, count) &&
+          (left->start == right->start ||
+           memcmp(left->start, right->start, slen) == 0)) {
+        sneedle += count;
+        oneedle += count;
+        if (span < MAX_DIFF_SPAN)
+          span *= 2;
+        continue;
+      }
+      if (span > 1)
+        span /= 2;
+    }
     /* if we're at the end of either manifest, then we
      * know the remaining items are adds so we can skip
      * the strcmp. */
@@ -41,6 +41,21 @@
 #include <sys/vnode.h> // @manual
 #endif
 
+/* io_uring gained IORING_OP_STATX in Linux 5.6, along with this flag */
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#if defined(IORING_FEAT_CUR_PERSONALITY) && defined(__NR_io_uring_setup) && \
+    defined(__NR_io_uring_enter) && defined(STATX_TYPE)
+#define HAVE_STATX_RING
+#endif
+#endif
+#endif
+
 #include "eden/scm/edenscm/mercurial/cext/util.h"
 
 /* some platforms lack the PATH_MAX definition (eg. GNU/Hurd) */
@@ -304,6 +319,350 @@ static PyObject* makestat(const struct stat* st) {
   return stat;
 }
 
+#ifdef HAVE_STATX_RING
+
+/* the number of stats submitted to the ring at a time */
+#define STATX_RING_ENTRIES 256
+
+/* only the fields makestat's users read, so network filesystems do not
+   have to fetch the rest */
+#define STATX_RING_MASK \
+  (STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_SIZE | STATX_MTIME | \
+   STATX_CTIME)
+
+typedef struct {
+  int fd;
+  pid_t pid;
+  unsigned *sqtail, *sqmask, *sqarray;
+  unsigned *cqhead, *cqtail, *cqmask;
+  struct io_uring_sqe* sqes;
+  struct io_uring_cqe* cqes;
+  void* sqring;
+  size_t sqringsize;
+  void* cqring;
+  size_t cqringsize;
+  size_t sqessize;
+  struct statx stx[STATX_RING_ENTRIES];
+} statx_ring;
+
+/* a ring kept between calls, so that walking many small directories does
+   not set one up for each. it is only touched with the GIL held. */
+static statx_ring* cachedring = NULL;
+/* io_uring or its statx operation is unavailable, e.g. on kernels before
+   5.6 or under a seccomp filter */
+static bool statxringunsupported = false;
+
+static void statx_ring_free(statx_ring* ring) {
+  if (ring->sqes != NULL)
+    munmap(ring->sqes, ring->sqessize);
+  if (ring->cqring != NULL)
+    munmap(ring->cqring, ring->cqringsize);
+  if (ring->sqring != NULL)
+    munmap(ring->sqring, ring->sqringsize);
+  if (ring->fd != -1)
+    close(ring->fd);
+  free(ring);
+}
+
+static void* statx_ring_map(int fd, size_t size, off_t offset) {
+  void* p = mmap(
+      NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+      offset);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+static statx_ring* statx_ring_new(void) {
+  struct io_uring_params params;
+  statx_ring* ring = calloc(1, sizeof(statx_ring));
+  if (ring == NULL)
+    return NULL;
+
+  memset(&params, 0, sizeof(params));
+  ring->fd = (int)syscall(__NR_io_uring_setup, STATX_RING_ENTRIES, &params);
+  if (ring->fd == -1) {
+    if (errno == ENOSYS || errno == EPERM)
+      statxringunsupported = true;
+    goto error;
+  }
+  ring->pid = getpid();
+
+  ring->sqringsize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cqringsize =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqessize = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqring = statx_ring_map(ring->fd, ring->sqringsize, IORING_OFF_SQ_RING);
+  ring->cqring = statx_ring_map(ring->fd, ring->cqringsize, IORING_OFF_CQ_RING);
+  ring->sqes = statx_ring_map(ring->fd, ring->sqessize, IORING_OFF_SQES);
+  if (ring->sqring == NULL || ring->cqring == NULL || ring->sqes == NULL)
+    goto error;
+
+  ring->sqtail = (unsigned*)((char*)ring->sqring + params.sq_off.tail);
+  ring->sqmask = (unsigned*)((char*)ring->sqring + params.sq_off.ring_mask);
+  ring->sqarray = (unsigned*)((char*)ring->sqring + params.sq_off.array);
+  ring->cqhead = (unsigned*)((char*)ring->cqring + params.cq_off.head);
+  ring->cqtail = (unsigned*)((char*)ring->cqring + params.cq_off.tail);
+  ring->cqmask = (unsigned*)((char*)ring->cqring + params.cq_off.ring_mask);
+  ring->cqes =
+      (struct io_uring_cqe*)((char*)ring->cqring + params.cq_off.cqes);
+  return ring;
+
+error:
+  statx_ring_free(ring);
+  return NULL;
+}
+
+/* Takes the cached ring, or sets up a new one if another thread has it.
+   Returns NULL if io_uring cannot be used. Call with the GIL held. */
+static statx_ring* statx_ring_acquire(void) {
+  statx_ring* ring = cachedring;
+  if (statxringunsupported)
+    return NULL;
+  cachedring = NULL;
+  /* a forked child shares the ring's memory with its parent */
+  if (ring != NULL && ring->pid != getpid()) {
+    statx_ring_free(ring);
+    ring = NULL;
+  }
+  return ring != NULL ? ring : statx_ring_new();
+}
+
+/* Call with the GIL held. */
+static void statx_ring_release(statx_ring* ring) {
+  if (cachedring == NULL && !statxringunsupported)
+    cachedring = ring;
+  else
+    statx_ring_free(ring);
+}
+
+static void statx_to_stat(const struct statx* stx, struct stat* st) {
+  memset(st, 0, sizeof(*st));
+  st->st_dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+  st->st_ino = stx->stx_ino;
+  st->st_mode = stx->stx_mode;
+  st->st_nlink = stx->stx_nlink;
+  st->st_uid = stx->stx_uid;
+  st->st_gid = stx->stx_gid;
+  st->st_size = (off_t)stx->stx_size;
+  st->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+  st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+  st->st_ctim.tv_sec = stx->stx_ctime.tv_sec;
+  st->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+
+/* Lstats paths[0:count], which are relative to dirfd, a ring's worth at a
+   time. For each path, fills sts[i] and sets errs[i] to 0, or sets errs[i]
+   to the errno. Returns -1 if the ring cannot be used, in which case the
+   caller should fall back to lstat. Does not need the GIL. */
+static int statx_ring_stat(
+    statx_ring* ring,
+    int dirfd,
+    const char* const* paths,
+    size_t count,
+    struct stat* sts,
+    int* errs) {
+  size_t base, n, j;
+  unsigned tail, head, mask = *ring->sqmask;
+  unsigned submitted, completed;
+  long ret;
+
+  for (base = 0; base < count; base += n) {
+    n = count - base;
+    if (n > STATX_RING_ENTRIES)
+      n = STATX_RING_ENTRIES;
+
+    tail = *ring->sqtail;
+    for (j = 0; j < n; j++) {
+      unsigned index = (tail + (unsigned)j) & mask;
+      struct io_uring_sqe* sqe = &ring->sqes[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_STATX;
+      sqe->fd = dirfd;
+      sqe->addr = (uint64_t)(uintptr_t)paths[base + j];
+      sqe->len = STATX_RING_MASK;
+      sqe->off = (uint64_t)(uintptr_t)&ring->stx[j];
+      sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+      sqe->user_data = j;
+      ring->sqarray[index] = index;
+    }
+    __atomic_store_n(ring->sqtail, tail + (unsigned)n, __ATOMIC_RELEASE);
+
+    submitted = completed = 0;
+    while (completed < n) {
+      ret = syscall(
+          __NR_io_uring_enter,
+          ring->fd,
+          (unsigned)n - submitted,
+          (unsigned)n - completed,
+          IORING_ENTER_GETEVENTS,
+          NULL,
+          0);
+      if (ret == -1) {
+        if (errno == EINTR)
+          continue;
+        statxringunsupported = true;
+        return -1;
+      }
+      submitted += (unsigned)ret;
+
+      head = *ring->cqhead;
+      while (head != __atomic_load_n(ring->cqtail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cqmask];
+        j = (size_t)cqe->user_data;
+        if (cqe->res == 0) {
+          statx_to_stat(&ring->stx[j], &sts[base + j]);
+          errs[base + j] = 0;
+        } else {
+          errs[base + j] = -cqe->res;
+        }
+        head++;
+        completed++;
+      }
+      __atomic_store_n(ring->cqhead, head, __ATOMIC_RELEASE);
+    }
+
+    /* kernels without IORING_OP_STATX fail every request with EINVAL,
+       which lstat never does for these arguments */
+    for (j = 0; j < n; j++) {
+      if (errs[base + j] == EINVAL) {
+        statxringunsupported = true;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/* Like _listdir_stat(keepstat=1), but reads the whole directory first and
+   then stats its entries on a statx_ring. Sets *fallback if the ring
+   cannot be used. */
+static PyObject* _listdir_ring(
+    const char* path,
+    int pathlen,
+    const char* skip,
+    bool* fallback) {
+  PyObject *list = NULL, *elem, *stat, *ret = NULL;
+  char fullpath[PATH_MAX + 10];
+  PyThreadState* state;
+  statx_ring* ring;
+  struct dirent* ent;
+  DIR* dir;
+  int dfd, kind, err = 0;
+  char* names = NULL;
+  size_t namessize = 0, namescap = 0;
+  size_t *offsets = NULL, count = 0, offsetscap = 0, i;
+  const char** paths = NULL;
+  struct stat* sts = NULL;
+  int* errs = NULL;
+
+  ring = statx_ring_acquire();
+  if (ring == NULL) {
+    *fallback = true;
+    return NULL;
+  }
+
+  dfd = open(path, O_RDONLY);
+  if (dfd == -1) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    goto error_dir;
+  }
+  dir = fdopendir(dfd);
+  if (!dir) {
+    PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+    close(dfd);
+    goto error_dir;
+  }
+
+  while ((ent = readdir(dir))) {
+    size_t len;
+    if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+      continue;
+    /* quit early? */
+    if (skip && entkind(ent) == S_IFDIR && !strcmp(ent->d_name, skip)) {
+      ret = PyList_New(0);
+      goto error;
+    }
+    len = strlen(ent->d_name) + 1;
+    if (namessize + len > namescap) {
+      namescap = (namessize + len) * 2;
+      if (!(names = PyMem_Realloc(names, namescap)))
+        goto error_nomem;
+    }
+    if (count == offsetscap) {
+      offsetscap = offsetscap ? offsetscap * 2 : 64;
+      if (!(offsets = PyMem_Realloc(offsets, offsetscap * sizeof(size_t))))
+        goto error_nomem;
+    }
+    memcpy(names + namessize, ent->d_name, len);
+    offsets[count++] = namessize;
+    namessize += len;
+  }
+
+  paths = PyMem_Malloc((count ? count : 1) * sizeof(const char*));
+  sts = PyMem_Malloc((count ? count : 1) * sizeof(struct stat));
+  errs = PyMem_Malloc((count ? count : 1) * sizeof(int));
+  if (!paths || !sts || !errs)
+    goto error_nomem;
+  for (i = 0; i < count; i++)
+    paths[i] = names + offsets[i];
+
+  state = PyEval_SaveThread();
+  err = statx_ring_stat(ring, dfd, paths, count, sts, errs);
+  PyEval_RestoreThread(state);
+  if (err == -1) {
+    *fallback = true;
+    goto error;
+  }
+
+  list = PyList_New(0);
+  if (!list)
+    goto error;
+  for (i = 0; i < count; i++) {
+    if (errs[i] != 0) {
+      /* race with file deletion? */
+      if (errs[i] == ENOENT)
+        continue;
+      errno = errs[i];
+      snprintf(fullpath, sizeof(fullpath), "%s/%s", path, paths[i]);
+      PyErr_SetFromErrnoWithFilename(PyExc_OSError, fullpath);
+      goto error;
+    }
+    kind = sts[i].st_mode & S_IFMT;
+    if (skip && kind == S_IFDIR && !strcmp(paths[i], skip)) {
+      ret = PyList_New(0);
+      goto error;
+    }
+    stat = makestat(&sts[i]);
+    if (!stat)
+      goto error;
+    elem = Py_BuildValue("siN", paths[i], kind, stat);
+    if (!elem)
+      goto error;
+    PyList_Append(list, elem);
+    Py_DECREF(elem);
+  }
+
+  ret = list;
+  Py_INCREF(ret);
+  goto error;
+
+error_nomem:
+  PyErr_NoMemory();
+error:
+  Py_XDECREF(list);
+  closedir(dir);
+  /* closedir also closes its dirfd */
+error_dir:
+  PyMem_Free(errs);
+  PyMem_Free(sts);
+  PyMem_Free(paths);
+  PyMem_Free(offsets);
+  PyMem_Free(names);
+  statx_ring_release(ring);
+  return ret;
+}
+
+#endif /* HAVE_STATX_RING */
+
 static PyObject*
 _listdir_stat(const char* path, int pathlen, int keepstat, const char* skip) {
   PyObject *list, *elem, *stat = NULL, *ret = NULL;
@@ -613,10 +972,112 @@ _listdir(const char* path, int pathlen, int keepstat, const char* skip) {
   ret = _listdir_batch(path, pathlen, keepstat, skip, &fallback);
   if (ret != NULL || !fallback)
     return ret;
+#elif defined(HAVE_STATX_RING)
+  PyObject* ret;
+  bool fallback = false;
+
+  /* without keepstat, d_type usually saves stating at all */
+  if (keepstat) {
+    ret = _listdir_ring(path, pathlen, skip, &fallback);
+    if (ret != NULL || !fallback)
+      return ret;
+  }
 #endif
   return _listdir_stat(path, pathlen, keepstat, skip);
 }
 
+#ifdef HAVE_STATX_RING
+/* only worth setting up a ring for */
+#define STATFILES_RING_MIN 32
+
+/* statfiles on a statx_ring. Sets *fallback if the ring cannot be used. */
+static PyObject*
+_statfiles_ring(PyObject* names, Py_ssize_t count, bool* fallback) {
+  PyObject *fast, *stats = NULL;
+  PyThreadState* state;
+  statx_ring* ring;
+  const char** paths = NULL;
+  struct stat* sts = NULL;
+  int* errs = NULL;
+  Py_ssize_t i, base, n;
+  int err, kind;
+
+  fast = PySequence_Fast(names, "not a sequence");
+  if (fast == NULL)
+    return NULL;
+  ring = statx_ring_acquire();
+  if (ring == NULL) {
+    *fallback = true;
+    goto bail;
+  }
+
+  paths = PyMem_Malloc(count * sizeof(const char*));
+  sts = PyMem_Malloc(count * sizeof(struct stat));
+  errs = PyMem_Malloc(count * sizeof(int));
+  if (!paths || !sts || !errs) {
+    PyErr_NoMemory();
+    goto bail;
+  }
+  for (i = 0; i < count; i++) {
+    /* the items of fast keep these alive */
+    PyObject* pypath = PySequence_Fast_GET_ITEM(fast, i);
+#ifdef IS_PY3K
+    paths[i] = PyUnicode_Check(pypath) ? PyUnicode_AsUTF8(pypath) : NULL;
+#else
+    paths[i] = PyBytes_Check(pypath) ? PyBytes_AsString(pypath) : NULL;
+#endif
+    if (paths[i] == NULL) {
+      PyErr_SetString(PyExc_TypeError, "not a str");
+      goto bail;
+    }
+  }
+
+  /* With a large file count or on a slow filesystem,
+     don't block signals for long (issue4878). */
+  for (base = 0; base < count; base += n) {
+    n = count - base < 1000 ? count - base : 1000;
+    state = PyEval_SaveThread();
+    err = statx_ring_stat(
+        ring, AT_FDCWD, paths + base, (size_t)n, sts + base, errs + base);
+    PyEval_RestoreThread(state);
+    if (err == -1) {
+      *fallback = true;
+      goto bail;
+    }
+    if (PyErr_CheckSignals() == -1)
+      goto bail;
+  }
+
+  stats = PyList_New(count);
+  if (stats == NULL)
+    goto bail;
+  for (i = 0; i < count; i++) {
+    PyObject* stat;
+    kind = sts[i].st_mode & S_IFMT;
+    if (errs[i] == 0 && (kind == S_IFREG || kind == S_IFLNK)) {
+      stat = makestat(&sts[i]);
+      if (stat == NULL) {
+        Py_CLEAR(stats);
+        goto bail;
+      }
+      PyList_SET_ITEM(stats, i, stat);
+    } else {
+      Py_INCREF(Py_None);
+      PyList_SET_ITEM(stats, i, Py_None);
+    }
+  }
+
+bail:
+  PyMem_Free(errs);
+  PyMem_Free(sts);
+  PyMem_Free(paths);
+  if (ring != NULL)
+    statx_ring_release(ring);
+  Py_DECREF(fast);
+  return stats;
+}
+#endif /* HAVE_STATX_RING */
+
 static PyObject* statfiles(PyObject* self, PyObject* args) {
   PyObject *names, *stats;
   Py_ssize_t i, count;
@@ -630,6 +1091,15 @@ static PyObject* statfiles(PyObject* self, PyObject* args) {
     return NULL;
   }
 
+#ifdef HAVE_STATX_RING
+  if (count >= STATFILES_RING_MIN) {
+    bool fallback = false;
+    stats = _statfiles_ring(names, count, &fallback);
+    if (stats != NULL || !fallback)
+      return stats;
+  }
+#endif
+
   stats = PyList_New(count);
   if (stats == NULL)
     return NULL;
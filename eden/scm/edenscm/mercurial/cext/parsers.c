@@ -347,6 +347,29 @@ quit:
   return ret;
 }
 
+/*
+ * Count the entries of a dirstate, so that the dict it is parsed into can be
+ * presized exactly. Only the entry headers are read. Stops at the first
+ * malformed entry, which parse_dirstate will report.
+ */
+static PyObject* dirstate_entry_count(PyObject* self, PyObject* args) {
+  const char* str;
+  Py_ssize_t len, pos = 40, count = 0;
+
+  if (!PyArg_ParseTuple(args, "s#:dirstate_entry_count", &str, &len))
+    return NULL;
+
+  while (pos + 17 <= len) {
+    uint32_t flen = getbe32(str + pos + 13);
+    if (flen > len - pos - 17)
+      break;
+    pos += 17 + flen;
+    count++;
+  }
+
+  return PyInt_FromSsize_t(count);
+}
+
 /*
  * Build a set of non-normal and other parent entries from the dirstate dmap
  */
@@ -400,19 +423,30 @@ bail:
   return NULL;
 }
 
+/* An entry of a dirstate being packed. The strings belong to the dicts. */
+typedef struct {
+  char state;
+  int mode, size, mtime;
+  const char* name;
+  Py_ssize_t namelen;
+  /* NULL unless the file was copied */
+  const char* copy;
+  Py_ssize_t copylen;
+} packentry;
+
 /*
  * Efficiently pack a dirstate object into its on-disk format.
+ *
+ * The dicts are walked once, to gather the entries and the size of the
+ * result, and the entries are then written out without further lookups.
  */
 static PyObject* pack_dirstate(PyObject* self, PyObject* args) {
   PyObject* packobj = NULL;
   PyObject *map, *copymap, *pl, *mtime_unset = NULL;
-  Py_ssize_t nbytes, pos, l;
-  PyObject *k, *v = NULL, *pn;
+  Py_ssize_t nbytes, pos, l, count, i;
+  PyObject *k, *v, *pn;
+  packentry* entries = NULL;
   char *p, *s;
-#ifdef IS_PY3K
-  const char* utf8c = NULL;
-  const char* utf8k = NULL;
-#endif
   int now;
 
   if (!PyArg_ParseTuple(
@@ -431,50 +465,85 @@ static PyObject* pack_dirstate(PyObject* self, PyObject* args) {
     return NULL;
   }
 
-  /* Figure out how much we need to allocate. */
-  for (nbytes = 40, pos = 0; PyDict_Next(map, &pos, &k, &v);) {
+  entries = PyMem_Malloc((PyDict_Size(map) + 1) * sizeof(packentry));
+  if (entries == NULL) {
+    PyErr_NoMemory();
+    return NULL;
+  }
+
+  /* Gather the entries and figure out how much we need to allocate. */
+  for (nbytes = 40, count = 0, pos = 0; PyDict_Next(map, &pos, &k, &v);) {
+    packentry* entry = &entries[count++];
+    dirstateTupleObject* tuple;
     PyObject* c;
+
 #ifdef IS_PY3K
     if (!PyUnicode_Check(k)) {
       PyErr_SetString(PyExc_TypeError, "expected string key");
       goto bail;
     }
-    Py_ssize_t utf8k_size = 0;
-    utf8k = PyUnicode_AsUTF8AndSize(k, &utf8k_size);
-    if (!utf8k) {
+    entry->name = PyUnicode_AsUTF8AndSize(k, &entry->namelen);
+    if (!entry->name) {
       goto bail;
     }
-    nbytes += utf8k_size + 17;
+#else
+    if (!PyBytes_Check(k)) {
+      PyErr_SetString(PyExc_TypeError, "expected string key");
+      goto bail;
+    }
+    entry->name = PyBytes_AS_STRING(k);
+    entry->namelen = PyBytes_GET_SIZE(k);
+#endif
+    nbytes += entry->namelen + 17;
 
+    entry->copy = NULL;
+    entry->copylen = 0;
     c = PyDict_GetItem(copymap, k);
-
     if (c) {
+#ifdef IS_PY3K
       if (!PyUnicode_Check(c)) {
         PyErr_SetString(PyExc_TypeError, "expected string key");
         goto bail;
       }
-      Py_ssize_t utf8c_size = 0;
-      utf8c = PyUnicode_AsUTF8AndSize(c, &utf8c_size);
-      if (!utf8c) {
+      entry->copy = PyUnicode_AsUTF8AndSize(c, &entry->copylen);
+      if (!entry->copy) {
         goto bail;
       }
-      nbytes += utf8c_size + 1;
-    }
 #else
-    if (!PyBytes_Check(k)) {
-      PyErr_SetString(PyExc_TypeError, "expected string key");
-      goto bail;
-    }
-    nbytes += PyBytes_GET_SIZE(k) + 17;
-    c = PyDict_GetItem(copymap, k);
-    if (c) {
       if (!PyBytes_Check(c)) {
         PyErr_SetString(PyExc_TypeError, "expected string key");
         goto bail;
       }
-      nbytes += PyBytes_GET_SIZE(c) + 1;
-    }
+      entry->copy = PyBytes_AS_STRING(c);
+      entry->copylen = PyBytes_GET_SIZE(c);
 #endif
+      nbytes += entry->copylen + 1;
+    }
+
+    if (!dirstate_tuple_check(v)) {
+      PyErr_SetString(PyExc_TypeError, "expected a dirstate tuple");
+      goto bail;
+    }
+    tuple = (dirstateTupleObject*)v;
+
+    entry->state = tuple->state;
+    entry->mode = tuple->mode;
+    entry->size = tuple->size;
+    entry->mtime = tuple->mtime;
+    if (entry->state == 'n' && entry->mtime == now) {
+      /* See pure/parsers.py:pack_dirstate for why we do
+       * this. Replacing the value of an existing key does not disturb
+       * PyDict_Next. */
+      entry->mtime = -1;
+      mtime_unset = (PyObject*)make_dirstate_tuple(
+          entry->state, entry->mode, entry->size, entry->mtime);
+      if (!mtime_unset)
+        goto bail;
+      if (PyDict_SetItem(map, k, mtime_unset) == -1)
+        goto bail;
+      Py_DECREF(mtime_unset);
+      mtime_unset = NULL;
+    }
   }
 
   packobj = PyBytes_FromStringAndSize(NULL, nbytes);
@@ -498,70 +567,25 @@ static PyObject* pack_dirstate(PyObject* self, PyObject* args) {
   memcpy(p, s, l);
   p += 20;
 
-  for (pos = 0; PyDict_Next(map, &pos, &k, &v);) {
-    dirstateTupleObject* tuple;
-    char state;
-    int mode, size, mtime;
-    Py_ssize_t len, l1;
-    PyObject* o;
-    char* t;
-
-    if (!dirstate_tuple_check(v)) {
-      PyErr_SetString(PyExc_TypeError, "expected a dirstate tuple");
-      goto bail;
-    }
-    tuple = (dirstateTupleObject*)v;
-
-    state = tuple->state;
-    mode = tuple->mode;
-    size = tuple->size;
-    mtime = tuple->mtime;
-    if (state == 'n' && mtime == now) {
-      /* See pure/parsers.py:pack_dirstate for why we do
-       * this. */
-      mtime = -1;
-      mtime_unset = (PyObject*)make_dirstate_tuple(state, mode, size, mtime);
-      if (!mtime_unset)
-        goto bail;
-      if (PyDict_SetItem(map, k, mtime_unset) == -1)
-        goto bail;
-      Py_DECREF(mtime_unset);
-      mtime_unset = NULL;
-    }
-    *p++ = state;
-    putbe32((uint32_t)mode, p);
-    putbe32((uint32_t)size, p + 4);
-    putbe32((uint32_t)mtime, p + 8);
-    t = p + 12;
+  for (i = 0; i < count; i++) {
+    const packentry* entry = &entries[i];
+    Py_ssize_t len = entry->namelen;
+
+    *p++ = entry->state;
+    putbe32((uint32_t)entry->mode, p);
+    putbe32((uint32_t)entry->size, p + 4);
+    putbe32((uint32_t)entry->mtime, p + 8);
+    if (entry->copy)
+      len += entry->copylen + 1;
+    putbe32((uint32_t)len, p + 12);
     p += 16;
-#ifdef IS_PY3K
-    utf8k = PyUnicode_AsUTF8AndSize(k, &len);
-    if (!utf8k) {
-      goto bail;
-    }
-    memcpy(p, utf8k, len);
-#else
-    len = PyBytes_GET_SIZE(k);
-    memcpy(p, PyBytes_AS_STRING(k), len);
-#endif
-    p += len;
-    o = PyDict_GetItem(copymap, k);
-    if (o) {
+    memcpy(p, entry->name, entry->namelen);
+    p += entry->namelen;
+    if (entry->copy) {
       *p++ = '\0';
-#ifdef IS_PY3K
-      utf8c = PyUnicode_AsUTF8AndSize(o, &l1);
-      if (!utf8c) {
-        goto bail;
-      }
-      memcpy(p, utf8c, l1);
-#else
-      l1 = PyBytes_GET_SIZE(o);
-      memcpy(p, PyBytes_AS_STRING(o), l1);
-#endif
-      p += l1;
-      len += l1 + 1;
+      memcpy(p, entry->copy, entry->copylen);
+      p += entry->copylen;
     }
-    putbe32((uint32_t)len, t);
   }
 
   pos = p - PyBytes_AS_STRING(packobj);
@@ -574,11 +598,12 @@ static PyObject* pack_dirstate(PyObject* self, PyObject* args) {
     goto bail;
   }
 
+  PyMem_Free(entries);
   return packobj;
 bail:
+  PyMem_Free(entries);
   Py_XDECREF(mtime_unset);
   Py_XDECREF(packobj);
-  Py_XDECREF(v);
   return NULL;
 }
 
@@ -789,6 +814,10 @@ static PyMethodDef methods[] = {
      "dirstate\n"},
     {"parse_manifest", parse_manifest, METH_VARARGS, "parse a manifest\n"},
     {"parse_dirstate", parse_dirstate, METH_VARARGS, "parse a dirstate\n"},
+    {"dirstate_entry_count",
+     dirstate_entry_count,
+     METH_VARARGS,
+     "count the entries of a dirstate\n"},
     {"parse_index2", parse_index2, METH_VARARGS, "parse a revlog index\n"},
     {"isasciistr", isasciistr, METH_VARARGS, "check if an ASCII string\n"},
     {"asciilower", asciilower, METH_VARARGS, "lowercase an ASCII string\n"},
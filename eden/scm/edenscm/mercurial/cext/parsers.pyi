@@ -21,6 +21,7 @@ def make_file_foldmap(
     normcase_fallback: Callable[[bytes], bytes],
 ) -> Dict[bytes, bytes]: ...
 def dict_new_presized(minsize: int) -> Dict[str, dirstatetuple]: ...
+def dirstate_entry_count(st: bytes) -> int: ...
 def parse_dirstate(
     dmap: Dict[str, dirstatetuple], copymap: Dict[str, str], st: bytes
 ) -> Tuple[bytes, bytes]: ...
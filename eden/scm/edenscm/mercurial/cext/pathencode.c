@@ -29,6 +29,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "eden/scm/edenscm/mercurial/cext/util.h"
 
 /* state machine for the fast path */
@@ -99,6 +105,107 @@ escape3(char* dest, Py_ssize_t* destlen, size_t destsize, char c) {
   hexencode(dest, destlen, destsize, c);
 }
 
+/*
+ * Most store paths are made of these bytes only: '-' through '9' (which
+ * include '.' and '/') and lowercase letters.  Neither encoding changes
+ * them, outside of the cases that pathisplain checks component by
+ * component.
+ */
+static inline int isplainbyte(uint8_t c) {
+  return (uint8_t)(c - '-') <= '9' - '-' || (uint8_t)(c - 'a') <= 'z' - 'a';
+}
+
+/* Checks whether src[0:len] consists of plain bytes, 16 at a time. */
+static int isplainbytes(const char* src, Py_ssize_t len) {
+  Py_ssize_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i digitbase = _mm_set1_epi8('-');
+  const __m128i digitspan = _mm_set1_epi8('9' - '-');
+  const __m128i lowerbase = _mm_set1_epi8('a');
+  const __m128i lowerspan = _mm_set1_epi8('z' - 'a');
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+    /* unsigned x <= span is min(x, span) == x */
+    __m128i d = _mm_sub_epi8(v, digitbase);
+    __m128i l = _mm_sub_epi8(v, lowerbase);
+    __m128i ok = _mm_or_si128(
+        _mm_cmpeq_epi8(_mm_min_epu8(d, digitspan), d),
+        _mm_cmpeq_epi8(_mm_min_epu8(l, lowerspan), l));
+    if (_mm_movemask_epi8(ok) != 0xffff)
+      return 0;
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t digitbase = vdupq_n_u8('-');
+  const uint8x16_t digitspan = vdupq_n_u8('9' - '-');
+  const uint8x16_t lowerbase = vdupq_n_u8('a');
+  const uint8x16_t lowerspan = vdupq_n_u8('z' - 'a');
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t*)(src + i));
+    uint8x16_t ok = vorrq_u8(
+        vcleq_u8(vsubq_u8(v, digitbase), digitspan),
+        vcleq_u8(vsubq_u8(v, lowerbase), lowerspan));
+    uint64x2_t halves = vreinterpretq_u64_u8(ok);
+    if ((vgetq_lane_u64(halves, 0) & vgetq_lane_u64(halves, 1)) != ~0ULL)
+      return 0;
+  }
+#endif
+
+  for (; i < len; i++) {
+    if (!isplainbyte((uint8_t)src[i]))
+      return 0;
+  }
+  return 1;
+}
+
+/*
+ * A fast check that both the fncache encoding and the dir encoding leave
+ * src[0:len] unchanged, so that the state machines in _encode and
+ * _encodedir need not run.  It may return 0 for some paths that are left
+ * unchanged.
+ *
+ * Once every byte is known to be plain, only these change a path:
+ * a component that starts or ends with '.', a reserved Windows name, and
+ * a directory (not the last component) ending in ".hg", ".i" or ".d".
+ */
+static int pathisplain(const char* src, Py_ssize_t len) {
+  const char *p = src, *end = src + len;
+
+  if (!isplainbytes(src, len))
+    return 0;
+
+  while (1) {
+    const char* slash = memchr(p, '/', end - p);
+    const char* compend = slash ? slash : end;
+    Py_ssize_t complen = compend - p;
+
+    if (complen > 0) {
+      const char* dot = memchr(p, '.', complen);
+      /* the reserved names only matter up to the first '.' */
+      Py_ssize_t stemlen = dot ? dot - p : complen;
+
+      if (p[0] == '.' || compend[-1] == '.')
+        return 0;
+      if (stemlen == 3 &&
+          (!memcmp(p, "aux", 3) || !memcmp(p, "con", 3) ||
+           !memcmp(p, "prn", 3) || !memcmp(p, "nul", 3)))
+        return 0;
+      if (stemlen == 4 && (!memcmp(p, "com", 3) || !memcmp(p, "lpt", 3)) &&
+          p[3] >= '1' && p[3] <= '9')
+        return 0;
+      if (slash && complen >= 2 && compend[-2] == '.' &&
+          (compend[-1] == 'i' || compend[-1] == 'd'))
+        return 0;
+      if (slash && complen >= 3 && !memcmp(compend - 3, ".hg", 3))
+        return 0;
+    }
+
+    if (!slash)
+      return 1;
+    p = slash + 1;
+  }
+}
+
 static Py_ssize_t
 _encodedir(char* dest, size_t destsize, const char* src, Py_ssize_t len) {
   enum dir_state state = DDEFAULT;
@@ -168,6 +275,11 @@ PyObject* encodedir(PyObject* self, PyObject* args) {
   }
 #endif
 
+  if (pathisplain(path, len)) {
+    Py_INCREF(pathobj);
+    return pathobj;
+  }
+
   newlen = len ? _encodedir(NULL, 0, path, len + 1) : 1;
 
   if (newlen == len + 1) {
@@ -778,7 +890,10 @@ PyObject* pathencode(PyObject* self, PyObject* args) {
 
   if (len > maxstorepathlen)
     newlen = maxstorepathlen + 2;
-  else
+  else if (pathisplain(path, len)) {
+    Py_INCREF(pathobj);
+    return pathobj;
+  } else
     newlen = len ? basicencode(NULL, 0, path, len + 1) : 1;
 
   if (newlen <= maxstorepathlen + 1) {
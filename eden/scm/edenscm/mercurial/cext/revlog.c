@@ -47,6 +47,33 @@ typedef struct {
   int children[16];
 } nodetree;
 
+/*
+ * A node trie can be persisted next to its revlog, so that processes opening
+ * a large revlog need not rebuild it.  The file holds this header followed by
+ * the nodes, in the machine's own byte order; it is a local cache, never
+ * exchanged.
+ *
+ * The trie covers revs [0, revs).  An index only uses it if lastnode is the
+ * node of its rev revs - 1, and looks up revs appended since then in its
+ * in-memory trie.
+ *
+ * The nodes are followed by the generation numbers of those revs, as ints,
+ * if generations is revs rather than 0.
+ */
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t byteorder;
+  uint32_t revs;
+  uint32_t nodes;
+  uint32_t generations;
+  char lastnode[20];
+} nodetreeheader;
+
+static const char nodetree_magic[4] = {'h', 'g', 'n', 't'};
+static const uint32_t nodetree_version = 2;
+static const uint32_t nodetree_byteorder = 0x01020304;
+
 /*
  * This class has two behaviors.
  *
@@ -78,6 +105,16 @@ typedef struct {
   int ntrev; /* last rev scanned */
   int ntlookups; /* # lookups */
   int ntmisses; /* # lookups that miss the cache */
+  Py_buffer ntbuf; /* buffer of the persisted trie */
+  const nodetree* ntmapped; /* persisted trie, or NULL */
+  unsigned ntmappedlength; /* # nodes in the persisted trie */
+  int ntmappedrevs; /* revs below this are in the persisted trie */
+  const int* genmapped; /* persisted generation numbers, or NULL */
+  int* generations; /* generation number of each rev, on demand */
+  Py_ssize_t ngenerations; /* # revs with a generation number */
+  Py_ssize_t gencapacity; /* # generation numbers allocated */
+  Py_ssize_t genwalked; /* # revs walked by queries without them */
+  Py_ssize_t genroot; /* first rev after 0 without parents, or -1 */
   int inlined;
 } indexObject;
 
@@ -334,6 +371,11 @@ static void _index_clearcaches(indexObject* self) {
     free(self->nt);
     self->nt = NULL;
   }
+  free(self->generations);
+  self->generations = NULL;
+  self->ngenerations = self->gencapacity = 0;
+  self->genwalked = 0;
+  self->genroot = -1;
   Py_CLEAR(self->headrevs);
 }
 
@@ -383,6 +425,9 @@ static PyObject* index_stats(indexObject* self) {
   istat(ntmisses, "node trie misses");
   istat(ntrev, "node trie last rev scanned");
   istat(ntsplits, "node trie splits");
+  istat(ntmappedlength, "node trie persisted count");
+  istat(ntmappedrevs, "node trie persisted revs");
+  istat(ngenerations, "generation numbers");
 
 #undef istat
 
@@ -415,6 +460,86 @@ static PyObject* list_copy(PyObject* list) {
   return newlist;
 }
 
+/*
+ * Return the generation number of every rev: one more than the larger of
+ * its parents', so 1 for a rev without parents.  A rev's ancestors all have
+ * lower generation numbers than it does, so ancestry queries can stop well
+ * short of the root.
+ *
+ * They are copied from the persisted trie or computed in a single pass over
+ * the index, and only revs appended since are computed afterwards.  Unless
+ * compute is set, return NULL rather than read the whole index for them; the
+ * queries that use them keep count of the revs they walk without, and ask
+ * for them once that is the size of the index.
+ */
+static const int* index_generations(indexObject* self, int compute) {
+  Py_ssize_t len = index_length(self) - 1;
+  Py_ssize_t rev;
+
+  if (len == 0)
+    return NULL;
+  if (self->ngenerations == len)
+    return self->generations;
+  if (self->generations == NULL && self->genmapped == NULL && !compute)
+    return NULL;
+
+  if (self->gencapacity < len) {
+    Py_ssize_t capacity = len + len / 8;
+    int* generations;
+
+    if ((size_t)capacity > PY_SSIZE_T_MAX / sizeof(int)) {
+      PyErr_SetString(PyExc_MemoryError, "overflow in index_generations");
+      return NULL;
+    }
+    generations = realloc(self->generations, capacity * sizeof(int));
+    if (generations == NULL) {
+      PyErr_NoMemory();
+      return NULL;
+    }
+    self->generations = generations;
+    self->gencapacity = capacity;
+  }
+
+  if (self->genmapped && self->ngenerations < self->ntmappedrevs) {
+    memcpy(
+        &self->generations[self->ngenerations],
+        &self->genmapped[self->ngenerations],
+        (self->ntmappedrevs - self->ngenerations) * sizeof(int));
+    /* only revs without parents have generation number 1 */
+    for (rev = self->ngenerations; rev < self->ntmappedrevs &&
+         self->genroot == -1;
+         rev++) {
+      if (rev > 0 && self->generations[rev] == 1)
+        self->genroot = rev;
+    }
+    self->ngenerations = self->ntmappedrevs;
+  }
+
+  for (rev = self->ngenerations; rev < len; rev++) {
+    int ps[2], g0, g1;
+
+    /* a parent after its child would not have a generation number yet */
+    if (index_get_parents(self, rev, ps, (int)rev - 1) < 0) {
+      self->ngenerations = rev;
+      return NULL;
+    }
+    g0 = ps[0] >= 0 ? self->generations[ps[0]] : 0;
+    g1 = ps[1] >= 0 ? self->generations[ps[1]] : 0;
+    self->generations[rev] = (g0 > g1 ? g0 : g1) + 1;
+    if (rev > 0 && self->generations[rev] == 1 && self->genroot == -1)
+      self->genroot = rev;
+  }
+  self->ngenerations = len;
+  return self->generations;
+}
+
+/*
+ * Return the generation number of rev, or 0 for nullrev.
+ */
+static inline int generation(const int* generations, int rev) {
+  return rev >= 0 ? generations[rev] : 0;
+}
+
 static Py_ssize_t add_roots_get_min(
     indexObject* self,
     PyObject* list,
@@ -468,6 +593,9 @@ static PyObject* reachableroots2(indexObject* self, PyObject* args) {
   Py_ssize_t l;
   int r;
   int parents[2];
+  /* revs with a lower generation number than every root reach none of them */
+  const int* generations;
+  int mingeneration = INT_MAX;
 
   /* Internal data structure:
    * tovisit: array of length len+1 (all revs + nullrev), filled upto lentovisit
@@ -475,6 +603,8 @@ static PyObject* reachableroots2(indexObject* self, PyObject* args) {
   int* tovisit = NULL;
   long lentovisit = 0;
   enum { RS_SEEN = 1, RS_ROOT = 2, RS_REACHABLE = 4 };
+  /* RS_SEEN in each byte of a word of revstates */
+  const uint64_t rs_seen_word = 0x0101010101010101ull;
   char* revstates = NULL;
 
   /* Get arguments */
@@ -493,6 +623,10 @@ static PyObject* reachableroots2(indexObject* self, PyObject* args) {
   if (includepatharg == Py_True)
     includepath = 1;
 
+  generations = index_generations(self, self->genwalked >= len);
+  if (generations == NULL && PyErr_Occurred())
+    goto bail;
+
   /* Initialize return set */
   reachable = PyList_New(0);
   if (reachable == NULL)
@@ -521,6 +655,8 @@ static PyObject* reachableroots2(indexObject* self, PyObject* args) {
     if (revnum + 1 < 0 || revnum + 1 >= len + 1)
       continue;
     revstates[revnum + 1] |= RS_ROOT;
+    if (generations && generation(generations, revnum) < mingeneration)
+      mingeneration = generation(generations, revnum);
   }
 
   /* Populate tovisit with all the heads */
@@ -533,6 +669,8 @@ static PyObject* reachableroots2(indexObject* self, PyObject* args) {
       PyErr_SetString(PyExc_IndexError, "head out of range");
       goto bail;
     }
+    if (generations && generation(generations, revnum) < mingeneration)
+      continue;
     if (!(revstates[revnum + 1] & RS_SEEN)) {
       tovisit[lentovisit++] = (int)revnum;
       revstates[revnum + 1] |= RS_SEEN;
@@ -564,7 +702,9 @@ static PyObject* reachableroots2(indexObject* self, PyObject* args) {
     if (r < 0)
       goto bail;
     for (i = 0; i < 2; i++) {
-      if (!(revstates[parents[i] + 1] & RS_SEEN) && parents[i] >= minroot) {
+      if (!(revstates[parents[i] + 1] & RS_SEEN) && parents[i] >= minroot &&
+          (generations == NULL ||
+           generation(generations, parents[i]) >= mingeneration)) {
         tovisit[lentovisit++] = parents[i];
         revstates[parents[i] + 1] |= RS_SEEN;
       }
@@ -578,6 +718,17 @@ static PyObject* reachableroots2(indexObject* self, PyObject* args) {
     if (minidx < 0)
       minidx = 0;
     for (i = minidx; i < len; i++) {
+      uint64_t word;
+
+      /* most revs are unseen, so skip them a word at a time */
+      while (i + 8 <= len) {
+        memcpy(&word, revstates + i + 1, sizeof(word));
+        if (word & rs_seen_word)
+          break;
+        i += 8;
+      }
+      if (i >= len)
+        break;
       if (!(revstates[i + 1] & RS_SEEN))
         continue;
       r = index_get_parents(self, i, parents, (int)len - 1);
@@ -600,6 +751,8 @@ static PyObject* reachableroots2(indexObject* self, PyObject* args) {
     }
   }
 
+  if (generations == NULL)
+    self->genwalked += lentovisit;
   free(revstates);
   free(tovisit);
   return reachable;
@@ -894,23 +1047,27 @@ static inline int nt_level(const char* node, Py_ssize_t level) {
 }
 
 /*
+ * Look a node up in one trie of ntlength nodes, whose leaves are all below
+ * maxrev or nullid.
+ *
  * Return values:
  *
+ *   -5: the trie is corrupt
  *   -4: match is ambiguous (multiple candidates)
  *   -2: not found
  * rest: valid rev
  */
-static int
-nt_find(indexObject* self, const char* node, Py_ssize_t nodelen, int hex) {
+static int nt_search(
+    indexObject* self,
+    const nodetree* nt,
+    unsigned ntlength,
+    int maxrev,
+    const char* node,
+    Py_ssize_t nodelen,
+    int hex) {
   int (*getnybble)(const char*, Py_ssize_t) = hex ? hexdigit : nt_level;
   int level, maxlevel, off;
 
-  if (nodelen == 20 && node[0] == '\0' && memcmp(node, nullid, 20) == 0)
-    return -1;
-
-  if (self->nt == NULL)
-    return -2;
-
   if (hex)
     maxlevel = nodelen > 40 ? 40 : (int)nodelen;
   else
@@ -918,7 +1075,7 @@ nt_find(indexObject* self, const char* node, Py_ssize_t nodelen, int hex) {
 
   for (level = off = 0; level < maxlevel; level++) {
     int k = getnybble(node, level);
-    nodetree* n = &self->nt[off];
+    const nodetree* n = &nt[off];
     int v = n->children[k];
 
     if (v < 0) {
@@ -926,6 +1083,8 @@ nt_find(indexObject* self, const char* node, Py_ssize_t nodelen, int hex) {
       Py_ssize_t i;
 
       v = -(v + 1);
+      if (v >= maxrev && v != INT_MAX)
+        return -5;
       n = index_node(self, v);
       if (n == NULL)
         return -2;
@@ -936,12 +1095,80 @@ nt_find(indexObject* self, const char* node, Py_ssize_t nodelen, int hex) {
     }
     if (v == 0)
       return -2;
+    if ((unsigned)v >= ntlength)
+      return -5;
     off = v;
   }
   /* multiple matches against an ambiguous prefix */
   return -4;
 }
 
+/*
+ * Stop using the persisted trie, after the revs it covers have changed or it
+ * turned out to be corrupt.  Those revs are then scanned into the in-memory
+ * trie on demand, like any others.
+ */
+static void nt_dropmapped(indexObject* self) {
+  if (self->ntmapped == NULL)
+    return;
+
+  /* the in-memory trie has scanned nothing below the persisted revs */
+  if (self->nt && self->ntrev < self->ntmappedrevs)
+    self->ntrev = self->ntmappedrevs;
+
+  PyBuffer_Release(&self->ntbuf);
+  memset(&self->ntbuf, 0, sizeof(self->ntbuf));
+  self->ntmapped = NULL;
+  self->ntmappedlength = 0;
+  self->ntmappedrevs = 0;
+  self->genmapped = NULL;
+}
+
+/*
+ * Return values:
+ *
+ *   -4: match is ambiguous (multiple candidates)
+ *   -2: not found
+ * rest: valid rev
+ */
+static int
+nt_find(indexObject* self, const char* node, Py_ssize_t nodelen, int hex) {
+  int rev = -2, mappedrev;
+
+  if (nodelen == 20 && node[0] == '\0' && memcmp(node, nullid, 20) == 0)
+    return -1;
+
+  if (self->nt != NULL) {
+    rev =
+        nt_search(self, self->nt, self->ntlength, INT_MAX, node, nodelen, hex);
+    /* a full node cannot also match in the persisted trie */
+    if (rev == -4 || (rev >= 0 && !hex))
+      return rev;
+  }
+
+  if (self->ntmapped == NULL)
+    return rev;
+
+  mappedrev = nt_search(
+      self,
+      self->ntmapped,
+      self->ntmappedlength,
+      self->ntmappedrevs,
+      node,
+      nodelen,
+      hex);
+  if (mappedrev == -5) {
+    nt_dropmapped(self);
+    return rev;
+  }
+  if (mappedrev == -2)
+    return rev;
+  if (rev == -2 || rev == mappedrev)
+    return mappedrev;
+  /* a prefix matching in both tries */
+  return -4;
+}
+
 static int nt_new(indexObject* self) {
   if (self->ntlength == self->ntcapacity) {
     if (self->ntcapacity >= INT_MAX / (sizeof(nodetree) * 2)) {
@@ -1008,11 +1235,14 @@ static int nt_insert(indexObject* self, const char* node, int rev) {
 
 static int nt_init(indexObject* self) {
   if (self->nt == NULL) {
-    if ((size_t)self->raw_length > INT_MAX / sizeof(nodetree)) {
+    /* only revs missing from the persisted trie will be inserted */
+    Py_ssize_t revs = self->raw_length - self->ntmappedrevs;
+
+    if ((size_t)revs > INT_MAX / sizeof(nodetree)) {
       PyErr_SetString(PyExc_ValueError, "overflow in nt_init");
       return -1;
     }
-    self->ntcapacity = self->raw_length < 4 ? 4 : (int)self->raw_length / 2;
+    self->ntcapacity = revs < 4 ? 4 : (int)revs / 2;
 
     self->nt = calloc(self->ntcapacity, sizeof(nodetree));
     if (self->nt == NULL) {
@@ -1058,7 +1288,7 @@ index_find_node(indexObject* self, const char* node, Py_ssize_t nodelen) {
    * bulk performance, e.g. for "hg log".
    */
   if (self->ntmisses++ < 4) {
-    for (rev = self->ntrev - 1; rev >= 0; rev--) {
+    for (rev = self->ntrev - 1; rev >= self->ntmappedrevs; rev--) {
       const char* n = index_node(self, rev);
       if (n == NULL)
         return -2;
@@ -1069,7 +1299,7 @@ index_find_node(indexObject* self, const char* node, Py_ssize_t nodelen) {
       }
     }
   } else {
-    for (rev = self->ntrev - 1; rev >= 0; rev--) {
+    for (rev = self->ntrev - 1; rev >= self->ntmappedrevs; rev--) {
       const char* n = index_node(self, rev);
       if (n == NULL) {
         self->ntrev = rev + 1;
@@ -1086,7 +1316,7 @@ index_find_node(indexObject* self, const char* node, Py_ssize_t nodelen) {
     self->ntrev = rev;
   }
 
-  if (rev >= 0)
+  if (rev >= self->ntmappedrevs)
     return rev;
   return -2;
 }
@@ -1137,16 +1367,17 @@ static PyObject* index_getitem(indexObject* self, PyObject* value) {
   return NULL;
 }
 
-static int
-nt_partialmatch(indexObject* self, const char* node, Py_ssize_t nodelen) {
+/*
+ * Insert every rev that is not in the persisted trie into the in-memory one.
+ */
+static int nt_populate(indexObject* self) {
   int rev;
 
   if (nt_init(self) == -1)
     return -3;
 
-  if (self->ntrev > 0) {
-    /* ensure that the radix tree is fully populated */
-    for (rev = self->ntrev - 1; rev >= 0; rev--) {
+  if (self->ntrev > self->ntmappedrevs) {
+    for (rev = self->ntrev - 1; rev >= self->ntmappedrevs; rev--) {
       const char* n = index_node(self, rev);
       if (n == NULL)
         return -2;
@@ -1156,7 +1387,28 @@ nt_partialmatch(indexObject* self, const char* node, Py_ssize_t nodelen) {
     self->ntrev = rev;
   }
 
-  return nt_find(self, node, nodelen, 1);
+  return 0;
+}
+
+static int
+nt_partialmatch(indexObject* self, const char* node, Py_ssize_t nodelen) {
+  int mapped = self->ntmapped != NULL;
+  int rev;
+
+  /* ensure that the radix tree is fully populated */
+  rev = nt_populate(self);
+  if (rev < 0)
+    return rev;
+
+  rev = nt_find(self, node, nodelen, 1);
+  if (mapped && self->ntmapped == NULL) {
+    /* the persisted trie was corrupt and got dropped; scan its revs too */
+    rev = nt_populate(self);
+    if (rev < 0)
+      return rev;
+    rev = nt_find(self, node, nodelen, 1);
+  }
+  return rev;
 }
 
 static PyObject* index_partialmatch(indexObject* self, PyObject* args) {
@@ -1207,6 +1459,117 @@ static PyObject* index_partialmatch(indexObject* self, PyObject* args) {
   return PyBytes_FromStringAndSize(fullnode, 20);
 }
 
+/*
+ * Make the in-memory trie cover every rev, starting from a copy of the
+ * persisted trie rather than rebuilding that part, and stop using the
+ * persisted trie.
+ */
+static int nt_absorbmapped(indexObject* self) {
+  Py_ssize_t capacity;
+  nodetree* nt;
+  int ret;
+
+  if (self->ntmapped == NULL)
+    return nt_populate(self);
+
+  capacity = (Py_ssize_t)self->ntmappedlength +
+      (self->raw_length - self->ntmappedrevs) + 4;
+  if ((size_t)capacity > INT_MAX / (sizeof(nodetree) * 2)) {
+    PyErr_SetString(PyExc_MemoryError, "overflow in nt_absorbmapped");
+    return -3;
+  }
+  nt = malloc(capacity * sizeof(nodetree));
+  if (nt == NULL) {
+    PyErr_NoMemory();
+    return -3;
+  }
+  memcpy(nt, self->ntmapped, self->ntmappedlength * sizeof(nodetree));
+  memset(
+      &nt[self->ntmappedlength],
+      0,
+      (capacity - self->ntmappedlength) * sizeof(nodetree));
+
+  /* nodes in the old in-memory trie are re-inserted from the index below */
+  free(self->nt);
+  self->nt = nt;
+  self->ntlength = self->ntmappedlength;
+  self->ntcapacity = (unsigned)capacity;
+  self->ntrev = (int)index_length(self) - 1;
+
+  ret = nt_populate(self);
+  if (ret < 0)
+    return ret;
+
+  nt_dropmapped(self);
+  self->ntrev = -1;
+  return 0;
+}
+
+/*
+ * Return the node trie and generation numbers of every rev, serialized for
+ * persisting, or None if fewer than maxlag revs are missing from the
+ * persisted trie.
+ */
+static PyObject* index_nodetree(indexObject* self, PyObject* args) {
+  Py_ssize_t revs = index_length(self) - 1;
+  nodetreeheader header;
+  const int* generations;
+  const char* lastnode;
+  PyObject* result;
+  char* data;
+  int maxlag;
+
+  if (!PyArg_ParseTuple(args, "i", &maxlag))
+    return NULL;
+
+  if (revs == 0 || revs - self->ntmappedrevs < maxlag)
+    Py_RETURN_NONE;
+
+  if (revs > INT_MAX) {
+    PyErr_SetString(PyExc_ValueError, "too many revs for a node trie");
+    return NULL;
+  }
+
+  /* before absorbing the trie, so that the persisted ones are copied */
+  generations = index_generations(self, 1);
+  if (generations == NULL)
+    return NULL;
+
+  if (nt_absorbmapped(self) < 0) {
+    if (!PyErr_Occurred())
+      PyErr_SetString(PyExc_IndexError, "could not access all revs");
+    return NULL;
+  }
+
+  lastnode = index_node(self, revs - 1);
+  if (lastnode == NULL) {
+    if (!PyErr_Occurred())
+      PyErr_Format(PyExc_IndexError, "could not access rev %zd", revs - 1);
+    return NULL;
+  }
+
+  memcpy(header.magic, nodetree_magic, sizeof(nodetree_magic));
+  header.version = nodetree_version;
+  header.byteorder = nodetree_byteorder;
+  header.revs = (uint32_t)revs;
+  header.nodes = self->ntlength;
+  header.generations = (uint32_t)revs;
+  memcpy(header.lastnode, lastnode, 20);
+
+  result = PyBytes_FromStringAndSize(
+      NULL,
+      sizeof(header) + self->ntlength * sizeof(nodetree) + revs * sizeof(int));
+  if (result == NULL)
+    return NULL;
+  data = PyBytes_AS_STRING(result);
+  memcpy(data, &header, sizeof(header));
+  data += sizeof(header);
+  memcpy(data, self->nt, self->ntlength * sizeof(nodetree));
+  data += self->ntlength * sizeof(nodetree);
+  memcpy(data, generations, revs * sizeof(int));
+  return result;
+}
+
 static PyObject* index_m_get(indexObject* self, PyObject* args) {
   Py_ssize_t nodelen;
   PyObject* val;
@@ -1330,6 +1693,7 @@ find_gca_candidates(indexObject* self, const int* revs, int revcount) {
   }
 
 done:
+  self->genwalked += maxrev - v;
   free(seen);
   return gca;
 bail:
@@ -1338,6 +1702,55 @@ bail:
   return NULL;
 }
 
+/*
+ * The generation number of a rev is the length of the longest path from it
+ * to a root, so find_deepest need only compare those of revs.  That gives
+ * the same answer as walking the revs only if they all descend from rev 0
+ * alone: the walk orders revs with disjoint histories in its own way.
+ */
+static PyObject* find_deepest_generations(
+    indexObject* self,
+    const int* generations,
+    PyObject* revs) {
+  const Py_ssize_t revcount = PyList_GET_SIZE(revs);
+  Py_ssize_t len = index_length(self) - 1;
+  PyObject* keys = NULL;
+  int maxgeneration = 0;
+  Py_ssize_t i;
+
+  for (i = 0; i < revcount; i++) {
+    long n = PyInt_AsLong(PyList_GET_ITEM(revs, i));
+    if (n == -1 && PyErr_Occurred())
+      return NULL;
+    if (n < 0 || n >= len) {
+      PyErr_SetString(PyExc_IndexError, "index out of range");
+      return NULL;
+    }
+    if (generations[n] > maxgeneration)
+      maxgeneration = generations[n];
+  }
+
+  if (PyList_Sort(revs) == -1)
+    return NULL;
+
+  keys = PyList_New(0);
+  if (keys == NULL)
+    return NULL;
+
+  for (i = 0; i < revcount; i++) {
+    PyObject* key = PyList_GET_ITEM(revs, i);
+
+    if (generations[PyInt_AS_LONG(key)] != maxgeneration)
+      continue;
+    if (PyList_Append(keys, key) == -1) {
+      Py_DECREF(keys);
+      return NULL;
+    }
+  }
+
+  return keys;
+}
+
 /*
  * Given a disjoint set of revs, return the subset with the longest
  * path to the root.
@@ -1351,6 +1764,7 @@ static PyObject* find_deepest(indexObject* self, PyObject* revs) {
   long* seen = NULL;
   int maxrev = -1;
   long final;
+  const int* generations;
 
   if (revcount > capacity) {
     PyErr_Format(
@@ -1361,12 +1775,20 @@ static PyObject* find_deepest(indexObject* self, PyObject* revs) {
     return NULL;
   }
 
+  generations =
+      index_generations(self, self->genwalked >= index_length(self) - 1);
+  if (generations == NULL && PyErr_Occurred())
+    return NULL;
+
   for (i = 0; i < revcount; i++) {
     int n = (int)PyInt_AsLong(PyList_GET_ITEM(revs, i));
     if (n > maxrev)
       maxrev = n;
   }
 
+  if (generations && (self->genroot == -1 || self->genroot > maxrev))
+    return find_deepest_generations(self, generations, revs);
+
   depth = calloc(sizeof(*depth), maxrev + 1);
   if (depth == NULL)
     return PyErr_NoMemory();
@@ -1448,6 +1870,7 @@ static PyObject* find_deepest(indexObject* self, PyObject* revs) {
     if (interesting[sv] == 0)
       ninteresting -= 1;
   }
+  self->genwalked += maxrev - v;
 
   final = 0;
   j = ninteresting;
@@ -1670,6 +2093,13 @@ static int index_slice_del(indexObject* self, PyObject* item) {
     return -1;
   }
 
+  if (start < self->ntmappedrevs)
+    nt_dropmapped(self);
+  if (self->ngenerations > start)
+    self->ngenerations = start;
+  if (self->genroot >= start)
+    self->genroot = -1;
+
   if (start < self->length - 1) {
     if (self->nt) {
       Py_ssize_t i;
@@ -1732,8 +2162,11 @@ index_assign_subscript(indexObject* self, PyObject* item, PyObject* value) {
   if (node_check(item, &node, &nodelen) == -1)
     return -1;
 
-  if (value == NULL)
+  if (value == NULL) {
+    /* the persisted trie cannot forget the node */
+    nt_dropmapped(self);
     return self->nt ? nt_insert(self, node, -1) : 0;
+  }
   rev = PyInt_AsLong(value);
   if (rev > INT_MAX || rev < 0) {
     if (!PyErr_Occurred())
@@ -1777,8 +2210,67 @@ static Py_ssize_t inline_scan(indexObject* self, const char** offsets) {
   return len;
 }
 
+/*
+ * Use a persisted node trie, if it matches this index.  A trie that does not
+ * is ignored rather than reported, as it is only a cache.
+ */
+static int nt_loadmapped(indexObject* self, PyObject* obj) {
+  const nodetreeheader* header;
+  const char* lastnode;
+  size_t nodebytes, genbytes;
+
+  if (!PyObject_CheckBuffer(obj)) {
+    PyErr_SetString(
+        PyExc_TypeError, "nodetree does not support buffer interface");
+    return -1;
+  }
+
+  if (PyObject_GetBuffer(obj, &self->ntbuf, PyBUF_SIMPLE) == -1)
+    return -1;
+
+  if ((size_t)self->ntbuf.len < sizeof(nodetreeheader))
+    goto ignore;
+  header = (const nodetreeheader*)self->ntbuf.buf;
+  nodebytes = self->ntbuf.len - sizeof(nodetreeheader);
+  if (memcmp(header->magic, nodetree_magic, sizeof(nodetree_magic)) != 0 ||
+      header->version != nodetree_version ||
+      header->byteorder != nodetree_byteorder)
+    goto ignore;
+  if (header->revs == 0 || header->revs > self->raw_length ||
+      header->nodes == 0 ||
+      (header->generations != 0 && header->generations != header->revs))
+    goto ignore;
+  genbytes = (size_t)header->generations * sizeof(int);
+  if (nodebytes < genbytes)
+    goto ignore;
+  nodebytes -= genbytes;
+  if (nodebytes % sizeof(nodetree) != 0 ||
+      nodebytes / sizeof(nodetree) != header->nodes)
+    goto ignore;
+
+  lastnode = index_node(self, header->revs - 1);
+  if (lastnode == NULL) {
+    PyErr_Clear();
+    goto ignore;
+  }
+  if (memcmp(lastnode, header->lastnode, 20) != 0)
+    goto ignore;
+
+  self->ntmapped = (const nodetree*)(header + 1);
+  self->ntmappedlength = header->nodes;
+  self->ntmappedrevs = (int)header->revs;
+  if (header->generations)
+    self->genmapped = (const int*)(self->ntmapped + header->nodes);
+  return 0;
+
+ignore:
+  PyBuffer_Release(&self->ntbuf);
+  memset(&self->ntbuf, 0, sizeof(self->ntbuf));
+  return 0;
+}
+
 static int index_init(indexObject* self, PyObject* args) {
-  PyObject *data_obj, *inlined_obj;
+  PyObject *data_obj, *inlined_obj, *nodetree_obj = NULL;
   Py_ssize_t size;
 
   /* Initialize before argument-checking to avoid index_dealloc() crash. */
@@ -1791,8 +2283,17 @@ static int index_init(indexObject* self, PyObject* args) {
   Py_INCREF(Py_None);
   self->nt = NULL;
   self->offsets = NULL;
-
-  if (!PyArg_ParseTuple(args, "OO", &data_obj, &inlined_obj))
+  memset(&self->ntbuf, 0, sizeof(self->ntbuf));
+  self->ntmapped = NULL;
+  self->ntmappedlength = 0;
+  self->ntmappedrevs = 0;
+  self->genmapped = NULL;
+  self->generations = NULL;
+  self->ngenerations = self->gencapacity = 0;
+  self->genwalked = 0;
+  self->genroot = -1;
+
+  if (!PyArg_ParseTuple(args, "OO|O", &data_obj, &inlined_obj, &nodetree_obj))
     return -1;
   if (!PyObject_CheckBuffer(data_obj)) {
     PyErr_SetString(PyExc_TypeError, "data does not support buffer interface");
@@ -1827,6 +2328,10 @@ static int index_init(indexObject* self, PyObject* args) {
     self->length = self->raw_length + 1;
   }
 
+  if (nodetree_obj && nodetree_obj != Py_None &&
+      nt_loadmapped(self, nodetree_obj) == -1)
+    goto bail;
+
   return 0;
 bail:
   return -1;
@@ -1839,6 +2344,7 @@ static PyObject* index_nodemap(indexObject* self) {
 
 static void index_dealloc(indexObject* self) {
   _index_clearcaches(self);
+  nt_dropmapped(self);
   if (self->buf.buf) {
     PyBuffer_Release(&self->buf);
     memset(&self->buf, 0, sizeof(self->buf));
@@ -1903,6 +2409,10 @@ static PyMethodDef index_methods[] = {
      (PyCFunction)index_partialmatch,
      METH_VARARGS,
      "match a potentially ambiguous node ID"},
+    {"nodetree",
+     (PyCFunction)index_nodetree,
+     METH_VARARGS,
+     "serialize the node trie for persisting"},
     {"stats", (PyCFunction)index_stats, METH_NOARGS, "stats for the index"},
     {NULL} /* Sentinel */
 };
@@ -31,8 +31,9 @@ hunk_consumer(int64_t a1, int64_t a2, int64_t b1, int64_t b2, void* priv) {
 static PyObject* blocks(PyObject* self, PyObject* args) {
   char *sa = NULL, *sb = NULL;
   Py_ssize_t na = 0, nb = 0;
+  long long maxcost = 0;
 
-  if (!PyArg_ParseTuple(args, "s#s#", &sa, &na, &sb, &nb))
+  if (!PyArg_ParseTuple(args, "s#s#|L", &sa, &na, &sb, &nb, &maxcost))
     return NULL;
 
   mmfile_t a = {sa, na}, b = {sb, nb};
@@ -43,6 +44,7 @@ static PyObject* blocks(PyObject* self, PyObject* args) {
 
   xpparam_t xpp = {
       XDF_INDENT_HEURISTIC, /* flags */
+      maxcost, /* max_cost */
   };
   xdemitconf_t xecfg = {
       XDL_EMIT_BDIFFHUNK, /* flags */
@@ -66,8 +68,10 @@ static PyMethodDef methods[] = {
     {"blocks",
      blocks,
      METH_VARARGS,
-     "(a: str, b: str) -> List[(a1, a2, b1, b2)].\n"
-     "Yield matched blocks. (a1, a2, b1, b2) are line numbers.\n"},
+     "(a: str, b: str, maxcost: int = 0) -> List[(a1, a2, b1, b2)].\n"
+     "Yield matched blocks. (a1, a2, b1, b2) are line numbers.\n"
+     "If maxcost is positive, it bounds the work done, after which the\n"
+     "remaining differences are reported as coarse replaced blocks.\n"},
     {NULL, NULL},
 };
 
@@ -5,4 +5,4 @@
 
 from typing import List, Tuple
 
-def blocks(a: str, b: str) -> List[Tuple[int, int, int, int]]: ...
+def blocks(a: str, b: str, maxcost: int = ...) -> List[Tuple[int, int, int, int]]: ...
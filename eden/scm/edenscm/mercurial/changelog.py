@@ -527,6 +527,7 @@ class changelog(revlog.revlog):
         if self.indexfile.startswith("00changelog"):
             self.opener.tryunlink("00changelog.nodemap")
             self.opener.tryunlink("00changelog.i.nodemap")
+            self.opener.tryunlink("00changelog.nodetree")
         if self.userust("strip"):
             self.inner.strip([self.node(minlink)])
         else:
@@ -570,6 +571,7 @@ class changelog(revlog.revlog):
 
     def delayupdate(self, tr):
         "delay visibility of index updates to other readers"
+        tr.addpostclose("cl-nodetree-%i" % id(self), self.savenodetree)
         if self._bypasstransaction:
             return
 
@@ -499,6 +499,14 @@ class unixforkingservice(object):
         self._oldsigchldhandler = None
         self._workerpids = set()  # updated by signal handler; do not iterate
         self._socketunlinked = None
+        # workers forked ahead of time, each waiting on a socketpair for the
+        # main process to pass it a connection. [(pid, sock)], oldest first.
+        self._spares = []
+        self._sparecount = 0
+        if util.safehasattr(socket.socket, "sendmsg") and util.safehasattr(
+            util, "recvfds"
+        ):
+            self._sparecount = ui.configint("cmdserver", "preforkworkers")
 
     def init(self):
         self._sock = socket.socket(socket.AF_UNIX)
@@ -528,6 +536,10 @@ class unixforkingservice(object):
         signal.signal(signal.SIGCHLD, self._oldsigchldhandler)
         self._sock.close()
         self._unlinksocket()
+        # spare workers exit once their socket is closed
+        for _pid, sock in self._spares:
+            sock.close()
+        self._spares = []
         # don't kill child processes as they have active clients, just wait
         self._reapworkers(0)
 
@@ -551,6 +563,8 @@ class unixforkingservice(object):
                 # waiting for recv() will receive ECONNRESET.
                 self._unlinksocket()
                 exiting = True
+            while not exiting and len(self._spares) < self._sparecount:
+                self._forkspare(selector)
             ready = selector.select(timeout=h.pollinterval)
             if not ready:
                 # only exit if we completed all queued requests
@@ -564,6 +578,11 @@ class unixforkingservice(object):
                     continue
                 raise
 
+            if self._handoff(conn):
+                conn.close()  # the spare worker has its own copy
+                h.newconnection()
+                continue
+
             pid = os.fork()
             if pid:
                 try:
@@ -586,6 +605,70 @@ class unixforkingservice(object):
                         os._exit(255)
         selector.close()
 
+    def _forkspare(self, selector):
+        """Fork a worker that waits for a connection from _handoff, so
+        that the next client does not wait for a fork"""
+        parentsock, childsock = socket.socketpair(socket.AF_UNIX)
+        pid = os.fork()
+        if pid:
+            childsock.close()
+            self.ui.debug("forked spare worker process (pid=%d)\n" % pid)
+            self._workerpids.add(pid)
+            self._spares.append((pid, parentsock))
+            return
+
+        try:
+            selector.close()
+            self._sock.close()
+            parentsock.close()
+            for _pid, sock in self._spares:
+                sock.close()
+            conn = self._waitforconnection(childsock)
+            if conn is not None:
+                self._runworker(conn)
+                conn.close()
+            os._exit(0)
+        except:  # never return, hence no re-raises
+            try:
+                self.ui.traceback(force=True)
+            finally:
+                os._exit(255)
+
+    def _waitforconnection(self, sock):
+        """Wait in a spare worker for the connection it is to serve.
+        Return None if the main process exited instead."""
+        while True:
+            try:
+                fds = util.recvfds(sock.fileno())
+                break
+            except OSError as inst:
+                if inst.errno != errno.EINTR:
+                    raise
+        sock.close()
+        if not fds:
+            return None
+        return socket.socket(fileno=fds[0])
+
+    def _handoff(self, conn):
+        """Pass conn to the oldest spare worker. Return False if there is
+        none left that is alive."""
+        flags = getattr(socket, "MSG_NOSIGNAL", 0)
+        ancdata = [
+            (socket.SOL_SOCKET, socket.SCM_RIGHTS, struct.pack("i", conn.fileno()))
+        ]
+        while self._spares:
+            pid, sock = self._spares.pop(0)
+            try:
+                sock.sendmsg([b"\0"], ancdata, flags)
+            except socket.error:
+                self.ui.debug("spare worker process is gone (pid=%d)\n" % pid)
+                continue
+            finally:
+                sock.close()
+            self.ui.debug("handed connection to worker process (pid=%d)\n" % pid)
+            return True
+        return False
+
     def _sigchldhandler(self, signal, frame):
         self._reapworkers(os.WNOHANG)
 
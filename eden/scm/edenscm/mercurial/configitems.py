@@ -149,6 +149,7 @@ coreconfigitem("censor", "policy", default="abort")
 coreconfigitem("chgserver", "idletimeout", default=3600)
 coreconfigitem("chgserver", "skiphash", default=False)
 coreconfigitem("cmdserver", "log", default=None)
+coreconfigitem("cmdserver", "preforkworkers", default=0)
 coreconfigitem("color", ".*", default=None, generic=True)
 coreconfigitem("commands", "show.aliasprefix", default=list)
 coreconfigitem("commands", "status.relative", default=False)
@@ -281,6 +282,7 @@ coreconfigitem("experimental", "worddiff", default=False)
 coreconfigitem("experimental", "mmapindexthreshold", default=1)
 coreconfigitem("experimental", "new-clone-path", default=True)
 coreconfigitem("experimental", "nonnormalparanoidcheck", default=False)
+coreconfigitem("experimental", "persistent-nodetree", default=False)
 coreconfigitem("experimental", "exportableenviron", default=list)
 coreconfigitem("experimental", "extendedheader.index", default=None)
 coreconfigitem("experimental", "extendedheader.similarity", default=False)
@@ -329,6 +331,8 @@ coreconfigitem("experimental", "treemanifest", default=False)
 coreconfigitem("experimental", "treematcher", default=True)
 coreconfigitem("experimental", "uncommitondirtywdir", default=True)
 coreconfigitem("experimental", "xdiff", default=True)
+coreconfigitem("experimental", "xdiff-max-cost", default=0)
+coreconfigitem("experimental", "bdiff-threads", default=1)
 coreconfigitem("extensions", ".*", default=None, generic=True)
 coreconfigitem("extdata", ".*", default=None, generic=True)
 coreconfigitem("format", "aggressivemergedeltas", default=False)
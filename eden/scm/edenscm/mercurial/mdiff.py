@@ -46,6 +46,26 @@ def init(ui):
         # pyre-fixme[9]: blocks has type `(a: str, b: str) -> List[Tuple[int, int,
         #  int, int]]`; used as `(a: str, b: str) -> List[Tuple[int, int, int, int]]`.
         blocks = xdiff.blocks
+        # Bound the work of diffing pathological inputs, such as minified
+        # files and lockfiles, so that interactive commands stay responsive.
+        maxcost = ui.configint("experimental", "xdiff-max-cost")
+        if maxcost:
+
+            def boundedblocks(a, b):
+                return xdiff.blocks(a, b, maxcost)
+
+            blocks = boundedblocks
+
+    # Deltas only need to be valid, not minimal, so large ones can be
+    # computed a piece at a time on several threads.
+    threads = ui.configint("experimental", "bdiff-threads")
+    if threads > 1:
+        global textdiff
+
+        def threadedtextdiff(a, b):
+            return bdiff.bdiff(a, b, threads)
+
+        textdiff = threadedtextdiff
 
 
 def splitnewlines(text):
@@ -65,6 +65,9 @@ REVIDX_KNOWN_FLAGS = util.bitsfrom(REVIDX_FLAGS_ORDER)
 _maxinline = 131072
 _chunksize = 1048576
 
+# rewrite a persisted node trie once this many revs are missing from it
+_nodetreemaxlag = 10000
+
 RevlogError = error.RevlogError
 LookupError = error.LookupError
 CensoredNodeError = error.CensoredNodeError
@@ -284,9 +287,12 @@ class revlogio(object):
     def __init__(self):
         self.size = indexformatng.size
 
-    def parseindex(self, data, inline):
+    def parseindex(self, data, inline, nodetree=None):
         # call the C implementation to parse the index data
-        index, cache = parsers.parse_index2(data, inline)
+        if nodetree is None:
+            index, cache = parsers.parse_index2(data, inline)
+        else:
+            index, cache = parsers.parse_index2(data, inline, nodetree)
         return index, getattr(index, "nodemap", None), cache
 
     def packentry(self, entry, node, version, rev):
@@ -371,6 +377,7 @@ class revlog(object):
         self._withsparseread = False
         self._srdensitythreshold = 0.25
         self._srmingapsize = 262144
+        self._nodetreefile = None
 
         mmapindexthreshold = None
         v = REVLOG_DEFAULT_VERSION
@@ -393,6 +400,13 @@ class revlog(object):
             if mmaplargeindex and "mmapindexthreshold" in opts:
                 mmapindexthreshold = opts["mmapindexthreshold"]
             self._withsparseread = bool(opts.get("with-sparse-read", False))
+            # Persist the node trie of large, frequently opened revlogs.
+            if (
+                mmaplargeindex
+                and opts.get("persistent-nodetree")
+                and indexfile.endswith(".i")
+            ):
+                self._nodetreefile = indexfile[:-2] + ".nodetree"
             if "sparse-read-density-threshold" in opts:
                 self._srdensitythreshold = opts["sparse-read-density-threshold"]
             if "sparse-read-min-gap-size" in opts:
@@ -467,9 +481,13 @@ class revlog(object):
 
         self.storedeltachains = True
 
+        nodetree = None
+        if self._nodetreefile is not None and not self._initempty:
+            nodetree = self._loadnodetree(mmapindexthreshold)
+
         self._io = revlogio()
         try:
-            d = self._io.parseindex(indexdata, self._inline)
+            d = self._io.parseindex(indexdata, self._inline, nodetree)
         except (ValueError, IndexError):
             raise RevlogError(_("index %s is corrupted") % (self.indexfile))
         self.index, nodemap, self._chunkcache = d
@@ -491,6 +509,40 @@ class revlog(object):
     def _compressor(self):
         return util.compengines[self._compengine].revlogcompressor()
 
+    def _loadnodetree(self, mmapindexthreshold):
+        """Read the persisted node trie, or return None if there is none.
+
+        The index checks that the trie matches it before using any of it.
+        """
+        try:
+            with self.opener(self._nodetreefile) as f:
+                if (
+                    mmapindexthreshold is not None
+                    and self.opener.fstat(f).st_size >= mmapindexthreshold
+                ):
+                    return util.buffer(util.mmapread(f))
+                return f.read()
+        except (IOError, OSError):
+            return None
+
+    def savenodetree(self, tr=None):
+        """Rewrite the persisted node trie if it lags far behind the index.
+
+        The generation numbers of the revs are stored with it, so that
+        ancestry queries have them without reading the whole index.  The
+        trie is a cache, so failing to write it is not an error.
+        """
+        if self._nodetreefile is None:
+            return
+        data = self.index.nodetree(_nodetreemaxlag)
+        if data is None:
+            return
+        try:
+            with self.opener(self._nodetreefile, "wb", atomictemp=True) as f:
+                f.write(data)
+        except (IOError, OSError):
+            pass
+
     def tip(self):
         # type: () -> bytes
         return self.node(len(self.index) - 2)
@@ -13,6 +13,7 @@ IF UNAME_SYSNAME != "Windows":
     from posix cimport fcntl, mman, stat, unistd
     from posix.types cimport off_t
 
+import collections
 import os
 
 cdef extern from "lib/linelog/linelog.c":
@@ -67,6 +68,9 @@ ELSE:
     cdef size_t pagesize = <size_t>unistd.sysconf(unistd._SC_PAGESIZE)
     cdef size_t unitsize = pagesize # used when resizing a buffer
 
+# number of annotate results kept per linelog, see linelog._snapshots
+cdef size_t maxsnapshots = 8
+
 class LinelogError(Exception):
     _messages = {
         LINELOG_RESULT_EILLDATA: b'Illegal data',
@@ -143,7 +147,12 @@ cdef class _buffer: # thin wrapper around linelog_buf
             if result == LINELOG_RESULT_OK:
                 return
             elif result == LINELOG_RESULT_ENEEDRESIZE:
-                self.resize((self.buf.neededsize // unitsize + 1) * unitsize)
+                # grow geometrically so appending many revisions does not
+                # remap (or ftruncate) the buffer once per revision. close()
+                # truncates the file to its actual size afterwards.
+                newsize = max(self.buf.neededsize,
+                              self.buf.size + self.buf.size // 2)
+                self.resize((newsize // unitsize + 1) * unitsize)
             else:
                 raise LinelogError(result)
 
@@ -263,10 +272,15 @@ cdef class linelog:
     cdef readonly _buffer buf
     cdef readonly bint closed
     cdef readonly object path
+    # {rev: bytes} copies of ar.lines[0:linecount + 1] (the last entry
+    # records the end offset) for recently annotated revisions, the most
+    # recently used last. they are only valid until the linelog is changed.
+    cdef object _snapshots
 
     def __cinit__(self):
         self.closed = 0
         memset(&self.ar, 0, sizeof(linelog_annotateresult))
+        self._snapshots = collections.OrderedDict()
 
     def __init__(self, path=None):
         """L(path : str?). Open a linelog.
@@ -298,6 +312,7 @@ cdef class linelog:
         """L.close() -> None. Close the file and free resources."""
         self._checkclosed()
         self._clearannotateresult()
+        self._snapshots.clear()
         self.buf.clear()
 
     def flush(self):
@@ -319,6 +334,7 @@ cdef class linelog:
         Copy content from another linelog object."""
         assert isinstance(rhs, linelog)
         self._checkclosed()
+        self._snapshots.clear()
         self.buf.copyfrom(rhs.buf)
 
     @property
@@ -338,13 +354,22 @@ cdef class linelog:
 
         Annotate lines for specified revision. The result can be obtained
         via L.annotateresult.
+
+        The results of the last few revisions annotated are kept, so going
+        back and forth between them does not run the linelog again.
         """
         self._checkclosed()
+        snapshot = self._snapshots.pop(rev, None)
+        if snapshot is not None:
+            self._snapshots[rev] = snapshot
+            self._restoresnapshot(snapshot)
+            return
         try:
             self.buf.annotate(&self.ar, rev)
         except LinelogError:
             self._clearannotateresult()
             raise
+        self._savesnapshot(rev)
 
     def replacelines(self, rev, a1, a2, b1, b2):
         """L.replacelines(rev, a1, a2, b1, b2 : int) -> None
@@ -353,6 +378,7 @@ cdef class linelog:
         linelog_replacelines in linelog.h for details.
         """
         self._checkclosed()
+        self._snapshots.clear()
         try:
             self.buf.replacelines(&self.ar, rev, a1, a2, b1, b2)
         except LinelogError:
@@ -367,6 +393,7 @@ cdef class linelog:
         details.
         """
         self._checkclosed()
+        self._snapshots.clear()
         # prepare blinecount, brevs, blinenums
         cdef linelog_linenum i = 0, blinecount = <linelog_linenum>len(blines)
         cdef linelog_revnum *brevs = <linelog_revnum *>malloc(
@@ -415,6 +442,27 @@ cdef class linelog:
     cdef _clearannotateresult(self):
         linelog_annotateresult_clear(&self.ar)
 
+    cdef _savesnapshot(self, rev):
+        if self.ar.lines == NULL:
+            return
+        cdef size_t size = sizeof(linelog_lineinfo) * (self.ar.linecount + 1)
+        self._snapshots[rev] = (<const char *>self.ar.lines)[:size]
+        while len(self._snapshots) > maxsnapshots:
+            self._snapshots.popitem(last=False)
+
+    cdef _restoresnapshot(self, bytes snapshot):
+        cdef size_t size = len(snapshot)
+        cdef linelog_linenum count = <linelog_linenum>(
+            size // sizeof(linelog_lineinfo))
+        if self.ar.maxlinecount < count:
+            p = realloc(self.ar.lines, size)
+            if p == NULL:
+                raise LinelogError(LINELOG_RESULT_ENOMEM)
+            self.ar.lines = <linelog_lineinfo *>p
+            self.ar.maxlinecount = count
+        memcpy(self.ar.lines, <const char *>snapshot, size)
+        self.ar.linecount = count - 1
+
     def __repr__(self):
         return b'<%s linelog %s at 0x%x>' % (
             b'closed' if self.closed else b'open',
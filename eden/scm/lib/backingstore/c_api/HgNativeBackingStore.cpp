@@ -58,6 +58,54 @@ void getBlobBatchCallback(
         (*static_cast<Fn*>(fn))(index, result);
       });
 }
+
+template <typename Fn>
+void getTreeBatchCallback(
+    RustBackingStore* store,
+    RustRequest* request,
+    uintptr_t size,
+    bool local,
+    Fn&& fn) {
+  rust_backingstore_get_tree_batch(
+      store,
+      request,
+      size,
+      local,
+      // We need to take address of the function, not to forward it.
+      // @lint-ignore HOWTOEVEN MissingStdForward
+      &fn,
+      [](void* fn, size_t index, RustCFallibleBase result) {
+        (*static_cast<Fn*>(fn))(index, result);
+      });
+}
+
+std::vector<RustRequest> toRawRequests(
+    const std::vector<std::pair<folly::ByteRange, folly::ByteRange>>&
+        requests) {
+  std::vector<RustRequest> raw_requests;
+  raw_requests.reserve(requests.size());
+
+  for (auto& request : requests) {
+    auto& name = request.first;
+    auto& node = request.second;
+
+    raw_requests.emplace_back(RustRequest{
+        name.data(),
+        name.size(),
+        node.data(),
+    });
+
+    XLOGF(
+        DBG9,
+        "Processing path=\"{}\" ({}) node={} ({:p})",
+        name.data(),
+        name.size(),
+        folly::hexlify(node),
+        node.data());
+  }
+
+  return raw_requests;
+}
 } // namespace
 
 HgNativeBackingStore::HgNativeBackingStore(
@@ -108,27 +156,7 @@ void HgNativeBackingStore::getBlobBatch(
 
   XLOG(DBG7) << "Import blobs with size:" << count;
 
-  std::vector<RustRequest> raw_requests;
-  raw_requests.reserve(count);
-
-  for (auto& request : requests) {
-    auto& name = request.first;
-    auto& node = request.second;
-
-    raw_requests.emplace_back(RustRequest{
-        name.data(),
-        name.size(),
-        node.data(),
-    });
-
-    XLOGF(
-        DBG9,
-        "Processing path=\"{}\" ({}) node={} ({:p})",
-        name.data(),
-        name.size(),
-        folly::hexlify(node),
-        node.data());
-  }
+  auto raw_requests = toRawRequests(requests);
 
   getBlobBatchCallback(
       store_.get(),
@@ -182,6 +210,46 @@ std::shared_ptr<RustTree> HgNativeBackingStore::getTree(folly::ByteRange node) {
   return manifest.unwrap();
 }
 
+void HgNativeBackingStore::getTreeBatch(
+    const std::vector<std::pair<folly::ByteRange, folly::ByteRange>>& requests,
+    bool local,
+    std::function<void(size_t, std::shared_ptr<RustTree>)>&& resolve) {
+  size_t count = requests.size();
+
+  XLOG(DBG7) << "Import trees with size:" << count;
+
+  auto raw_requests = toRawRequests(requests);
+
+  getTreeBatchCallback(
+      store_.get(),
+      raw_requests.data(),
+      count,
+      local,
+      [resolve, requests, count](size_t index, RustCFallibleBase raw_result) {
+        RustCFallible<RustTree> result(std::move(raw_result), rust_tree_free);
+
+        if (result.isError()) {
+          XLOGF(
+              DBG6,
+              "Failed to import tree path=\"{}\" node={} (batch {}/{}): {}",
+              folly::StringPiece{requests[index].first},
+              folly::hexlify(requests[index].second),
+              index,
+              count,
+              result.getError());
+        } else {
+          XLOGF(
+              DBG6,
+              "Imported tree path=\"{}\" node={} (batch: {}/{})",
+              folly::StringPiece{requests[index].first},
+              folly::hexlify(requests[index].second),
+              index,
+              count);
+          resolve(index, result.unwrap());
+        }
+      });
+}
+
 void HgNativeBackingStore::refresh() {
   XLOG(DBG7) << "Refreshing backing store";
 
@@ -44,6 +44,24 @@ class HgNativeBackingStore {
 
   std::shared_ptr<RustTree> getTree(folly::ByteRange node);
 
+  /**
+   * Imports a list of trees from Rust treestore. Each request is a pair of the
+   * tree's path and manifest node.
+   *
+   * Whenever a requested tree is read, `resolve` will be called with the index
+   * of the request in the passed vector, along with the tree itself. Trees that
+   * fail to import are logged and `resolve` is not called for them.
+   *
+   * If `local` is true, this method will only look requested trees on disk.
+   * Otherwise all trees missing from disk are fetched in a single remote
+   * request.
+   */
+  void getTreeBatch(
+      const std::vector<std::pair<folly::ByteRange, folly::ByteRange>>&
+          requests,
+      bool local,
+      std::function<void(size_t, std::shared_ptr<RustTree>)>&& resolve);
+
   void refresh();
 
  private:
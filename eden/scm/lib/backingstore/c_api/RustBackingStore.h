@@ -145,6 +145,13 @@ RustCFallibleBase rust_backingstore_get_tree(RustBackingStore *store,
                                                        const uint8_t *node,
                                                        uintptr_t node_len);
 
+void rust_backingstore_get_tree_batch(RustBackingStore *store,
+                                      const RustRequest *requests,
+                                      uintptr_t size,
+                                      bool local,
+                                      void *data,
+                                      void (*resolve)(void*, uintptr_t, RustCFallibleBase));
+
 RustCFallibleBase rust_backingstore_new(const char *repository,
                                                           size_t repository_len,
                                                           bool use_edenapi);
@@ -154,11 +154,61 @@ impl BackingStore {
 
     pub fn get_tree(&self, node: &[u8]) -> Result<List> {
         let node = Node::from_slice(node)?;
+        self.get_tree_impl(node)
+    }
+
+    fn get_tree_impl(&self, node: Node) -> Result<List> {
         let manifest = TreeManifest::durable(self.treestore.clone(), node);
 
         manifest.list(RepoPath::empty())
     }
 
+    /// Fetch trees in batch. Whenever a tree is fetched, the supplied `resolve` function is called
+    /// with the tree listing or an error message, and the index of the tree in the request array.
+    /// Trees missing locally are fetched from the remote store with a single prefetch request.
+    /// When `local_only` is enabled, this function will only check local disk for the trees.
+    pub fn get_tree_batch<F>(&self, keys: Vec<Result<Key>>, local_only: bool, resolve: F)
+    where
+        F: Fn(usize, Result<List>) -> (),
+    {
+        let requests = keys
+            .into_iter()
+            .enumerate()
+            .filter_map(|(index, key)| match key {
+                Ok(key) => Some((index, key)),
+                Err(e) => {
+                    // return early when the key is invalid
+                    resolve(index, Err(e));
+                    None
+                }
+            });
+
+        let store = self.treestore.as_content_store();
+        let mut missing = Vec::new();
+        let mut missing_requests = Vec::new();
+
+        for (index, key) in requests {
+            let store_key = StoreKey::from(&key);
+            // Assuming a tree do not exist if `.contains` call fails
+            if store.contains(&store_key).unwrap_or(false) {
+                resolve(index, self.get_tree_impl(key.hgid))
+            } else if !local_only {
+                missing.push(store_key);
+                missing_requests.push((index, key));
+            }
+        }
+
+        // If this is a local only read, nothing else we can do.
+        if local_only {
+            return;
+        }
+
+        let _ = store.prefetch(&missing);
+        for (index, key) in missing_requests {
+            resolve(index, self.get_tree_impl(key.hgid))
+        }
+    }
+
     /// forces backing store to rescan pack files
     pub fn refresh(&self) {
         self.blobstore.get_missing(&[]).ok();
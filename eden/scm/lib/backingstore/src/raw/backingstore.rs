@@ -131,6 +131,27 @@ pub extern "C" fn rust_backingstore_get_tree(
     backingstore_get_tree(store, node, node_len).into()
 }
 
+#[no_mangle]
+pub extern "C" fn rust_backingstore_get_tree_batch(
+    store: *mut BackingStore,
+    requests: *const Request,
+    size: usize,
+    local: bool,
+    data: *mut c_void,
+    resolve: unsafe extern "C" fn(*mut c_void, usize, CFallible<Tree>),
+) {
+    assert!(!store.is_null());
+    let store = unsafe { &*store };
+    let requests: &[Request] = unsafe { slice::from_raw_parts(requests, size) };
+    let keys: Vec<Result<Key>> = requests.iter().map(|req| req.try_into_key()).collect();
+
+    store.get_tree_batch(keys, local, |idx, result| {
+        let result: Result<Tree> = result.and_then(|list| list.try_into());
+        let result = result.map(|result| Box::into_raw(Box::new(result)));
+        unsafe { resolve(data, idx, result.into()) };
+    });
+}
+
 #[no_mangle]
 pub extern "C" fn rust_tree_free(tree: *mut Tree) {
     assert!(!tree.is_null());
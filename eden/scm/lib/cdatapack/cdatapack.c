@@ -43,13 +43,24 @@
 #endif /* #if defined(__APPLE__) */
 
 #include <lz4.h>
+#include <zstd.h>
 
 #include "lib/clib/buffer.h"
 #include "lib/clib/portability/inet.h"
 #include "lib/clib/portability/mman.h"
 #include "lib/clib/portability/unistd.h"
 
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) ((void)(addr))
+#endif
+
 #define MAX_PAGED_IN_DATAPACK (1024 * 1024 * 1024)
+// packs with at least this many index entries get handle->index_prefixes.
+#define PREFIX_INDEX_MIN_ENTRIES 65536
+// ranges of prefixes this short are counted, rather than bisected.
+#define PREFIX_SCAN_MAX 16
 #define VERSION 0
 #define LARGE_FANOUT 0x80
 
@@ -125,6 +136,56 @@ static inline uint16_t get_fanout_index(
   }
 }
 
+static inline uint64_t get_node_prefix(const uint8_t node[NODE_SZ]) {
+  uint64_t prefix;
+  memcpy(&prefix, node, sizeof(prefix));
+  return ntohll(prefix);
+}
+
+/**
+ * Like find(), but bisects handle->index_prefixes over the INCLUSIVE range
+ * [start, end].  The bisection is branch-free, so each step can prefetch
+ * both of the probes that may follow it, and the last few prefixes are
+ * counted in a loop the compiler can vectorize.
+ */
+static bool find_by_prefix(
+    const datapack_handle_t* handle,
+    const uint8_t node[NODE_SZ],
+    index_offset_t start,
+    index_offset_t end,
+    pack_index_entry_t* packindex) {
+  if (start > end) {
+    return false;
+  }
+
+  const uint64_t* prefixes = handle->index_prefixes;
+  uint64_t prefix = get_node_prefix(node);
+
+  // the first entry whose prefix is >= prefix is in [base, base + len].
+  size_t base = start;
+  size_t len = (size_t)(end - start) + 1;
+  while (len > PREFIX_SCAN_MAX) {
+    size_t half = len / 2;
+    PREFETCH(&prefixes[base + half / 2]);
+    PREFETCH(&prefixes[base + half + half / 2]);
+    base = prefixes[base + half - 1] < prefix ? base + half : base;
+    len -= half;
+  }
+  size_t below = 0;
+  for (size_t ix = 0; ix < len; ix++) {
+    below += prefixes[base + ix] < prefix;
+  }
+
+  // nodes that share the prefix are told apart by the full comparison.
+  for (size_t ix = base + below; ix <= end && prefixes[ix] == prefix; ix++) {
+    if (memcmp(node, handle->index_table[ix].node, NODE_SZ) == 0) {
+      unpack_disk_deltachunk(&handle->index_table[ix], packindex);
+      return true;
+    }
+  }
+  return false;
+}
+
 /**
  * Finds a node using the index, and fills out the packindex pointer.
  * Returns true iff the node is found.
@@ -137,6 +198,10 @@ bool find(
   index_offset_t start = handle->fanout_table[fanout_idx].start_index;
   index_offset_t end = handle->fanout_table[fanout_idx].end_index;
 
+  if (handle->index_prefixes != NULL) {
+    return find_by_prefix(handle, node, start, end, packindex);
+  }
+
   // indices are INCLUSIVE, so the search is <=
   while (start <= end) {
     index_offset_t middle = start + ((end - start) / 2);
@@ -163,6 +228,18 @@ bool find(
   return false;
 }
 
+size_t datapack_index_size(const datapack_handle_t* handle) {
+  const disk_index_entry_t* index_end =
+      (const disk_index_entry_t*)(((const char*)handle->index_mmap) + handle->index_file_sz);
+  return (size_t)(index_end - handle->index_table);
+}
+
+const uint8_t* datapack_index_node(
+    const datapack_handle_t* handle,
+    size_t index) {
+  return handle->index_table[index].node;
+}
+
 static void backfill_fanout_entries(
     datapack_handle_t* handle,
     size_t fanout_idx_start,
@@ -288,13 +365,40 @@ datapack_handle_t* open_datapack(
     goto error_cleanup;
   }
 
-  if (header->version > 1) {
+  if (header->version > 2) {
     // unsupported version
     handle->status = DATAPACK_HANDLE_VERSION_MISMATCH;
     goto error_cleanup;
   }
   handle->version = header->version;
 
+  handle->entries_offset = 1;
+  if (handle->version == 2) {
+    // version 2 packs start with the zstd dictionary that their deltas are
+    // compressed with, which may be empty.
+    const uint8_t* data = (const uint8_t*)handle->data_mmap;
+    uint32_t dictionary_sz;
+    if (handle->data_file_sz < (off_t)(1 + sizeof(dictionary_sz))) {
+      handle->status = DATAPACK_HANDLE_CORRUPT;
+      goto error_cleanup;
+    }
+    memcpy(&dictionary_sz, data + 1, sizeof(dictionary_sz));
+    dictionary_sz = ntohl(dictionary_sz);
+    handle->entries_offset = 1 + sizeof(dictionary_sz) + dictionary_sz;
+    if (handle->entries_offset > (data_offset_t)handle->data_file_sz) {
+      handle->status = DATAPACK_HANDLE_CORRUPT;
+      goto error_cleanup;
+    }
+    if (dictionary_sz > 0) {
+      handle->zstd_ddict =
+          ZSTD_createDDict(data + 1 + sizeof(dictionary_sz), dictionary_sz);
+      if (handle->zstd_ddict == NULL) {
+        handle->status = DATAPACK_HANDLE_OOM;
+        goto error_cleanup;
+      }
+    }
+  }
+
   handle->large_fanout = ((header->config & LARGE_FANOUT) != 0);
   int fanout_count = 1 << (handle->large_fanout ? 16 : 8);
   handle->fanout_table =
@@ -304,7 +408,7 @@ datapack_handle_t* open_datapack(
     goto error_cleanup;
   }
   size_t index_offset = 0;
-  if (handle->version == 1) {
+  if (handle->version >= 1) {
     index_offset = 8;
   }
   handle->index_table =
@@ -362,6 +466,19 @@ datapack_handle_t* open_datapack(
   backfill_fanout_entries(
       handle, need_end_idx, fanout_count, last_idx, end_offset);
 
+  // Searching 8-byte prefixes instead of 40-byte index entries touches a
+  // fifth of the cache lines.  Without them find() bisects the index
+  // entries, so failing to allocate them is not an error.
+  if (end_offset >= PREFIX_INDEX_MIN_ENTRIES) {
+    handle->index_prefixes = (uint64_t*)malloc(end_offset * sizeof(uint64_t));
+    if (handle->index_prefixes != NULL) {
+      for (index_offset_t ix = 0; ix < end_offset; ix++) {
+        handle->index_prefixes[ix] =
+            get_node_prefix(handle->index_table[ix].node);
+      }
+    }
+  }
+
   handle->status = DATAPACK_HANDLE_OK;
 
   goto success_cleanup;
@@ -384,7 +501,9 @@ error_cleanup:
     close(datafd);
   }
 
+  ZSTD_freeDDict(handle->zstd_ddict);
   free(handle->fanout_table);
+  free(handle->index_prefixes);
   free(handle);
   handle = NULL;
 
@@ -398,7 +517,9 @@ success_cleanup:
 void close_datapack(datapack_handle_t* handle) {
   munmap(handle->index_mmap, (size_t)handle->index_file_sz);
   munmap(handle->data_mmap, (size_t)handle->data_file_sz);
+  ZSTD_freeDDict(handle->zstd_ddict);
   free(handle->fanout_table);
+  free(handle->index_prefixes);
   free(handle);
 }
 
@@ -504,6 +625,26 @@ static inline int platform_madvise_away(void* ptr, size_t len) {
 #endif /* #if defined(_MSC_VER) */
 }
 
+void datapack_willneed(
+    const datapack_handle_t* handle,
+    data_offset_t offset,
+    data_offset_t size) {
+  if (offset >= (data_offset_t)handle->data_file_sz) {
+    return;
+  }
+  if (size > (data_offset_t)handle->data_file_sz - offset) {
+    size = (data_offset_t)handle->data_file_sz - offset;
+  }
+#if defined(__linux__) || defined(__APPLE__)
+  intptr_t page_size = (intptr_t)sysconf(_SC_PAGESIZE);
+  intptr_t address = (intptr_t)handle->data_mmap + offset;
+  intptr_t end_address = address + size;
+  address = address & ~(page_size - 1);
+  // The advice is only a hint, so errors are ignored.
+  madvise((void*)address, (size_t)(end_address - address), MADV_WILLNEED);
+#endif /* #if defined(__linux__) || defined(__APPLE__) */
+}
+
 get_delta_chain_link_result_t getdeltachainlink(
     const datapack_handle_t* handle,
     const uint8_t* ptr,
@@ -524,15 +665,17 @@ get_delta_chain_link_result_t getdeltachainlink(
   link->compressed_sz = compressed_sz;
   ptr += sizeof(data_offset_t);
 
-  link->delta_sz = load_le32(ptr); /* LZ4 header */
+  link->delta_sz = load_le32(ptr); /* uncompressed size header */
   ptr += sizeof(uint32_t);
-  link->compressed_buf = ptr; /* compressed_* exclude lz4 header */
+  link->compressed_buf = ptr; /* compressed_* exclude the size header */
 
   link->delta = NULL; /* call uncompressdeltachainlink to decompress it */
+  link->zstd = handle->version >= 2;
+  link->zstd_ddict = handle->zstd_ddict;
   ptr += compressed_sz;
 
-  if (handle->version == 1) {
-    // v1 has metadata block
+  if (handle->version >= 1) {
+    // v1 and later have a metadata block
     link->meta_sz = ntohl(*((uint32_t*)ptr));
     ptr += sizeof(uint32_t);
     link->meta = ptr;
@@ -546,6 +689,31 @@ get_delta_chain_link_result_t getdeltachainlink(
       GET_DELTA_CHAIN_LINK_OK, ptr};
 }
 
+/**
+ * Decompresses a zstd frame with the calling thread's decompression context,
+ * which is created on first use and kept for the life of the thread, so that
+ * small deltas do not pay for setting one up.  Returns the decompressed size,
+ * or a zstd error code.
+ */
+static size_t zstd_decompress(
+    void* dst,
+    size_t dst_sz,
+    const void* src,
+    size_t src_sz,
+    const ZSTD_DDict* ddict) {
+  static THREADLOCAL ZSTD_DCtx* dctx = NULL;
+  if (dctx == NULL) {
+    dctx = ZSTD_createDCtx();
+    if (dctx == NULL) {
+      return (size_t)-1;
+    }
+  }
+  if (ddict != NULL) {
+    return ZSTD_decompress_usingDDict(dctx, dst, dst_sz, src, src_sz, ddict);
+  }
+  return ZSTD_decompressDCtx(dctx, dst, dst_sz, src, src_sz);
+}
+
 bool uncompressdeltachainlink(delta_chain_link_t* link) {
   if (link->delta != NULL || link->delta_sz == 0) {
     // previously decompressed or no content to decompress
@@ -558,24 +726,39 @@ bool uncompressdeltachainlink(delta_chain_link_t* link) {
     return false;
   }
 
-  int32_t outbytes = LZ4_decompress_safe(
-      (const char*)link->compressed_buf,
-      (char*)decompress_output,
-      (int)link->compressed_sz,
-      (int32_t)link->delta_sz);
-  if (outbytes != (int32_t)link->delta_sz) {
-    // size mismatch
-    free(decompress_output);
-    return false;
+  if (link->zstd) {
+    size_t outbytes = zstd_decompress(
+        decompress_output,
+        (size_t)link->delta_sz,
+        link->compressed_buf,
+        (size_t)link->compressed_sz,
+        link->zstd_ddict);
+    if (ZSTD_isError(outbytes) || outbytes != (size_t)link->delta_sz) {
+      // corrupt, or size mismatch
+      free(decompress_output);
+      return false;
+    }
+  } else {
+    int32_t outbytes = LZ4_decompress_safe(
+        (const char*)link->compressed_buf,
+        (char*)decompress_output,
+        (int)link->compressed_sz,
+        (int32_t)link->delta_sz);
+    if (outbytes != (int32_t)link->delta_sz) {
+      // size mismatch
+      free(decompress_output);
+      return false;
+    }
   }
 
   link->delta = decompress_output;
   return true;
 }
 
-delta_chain_t getdeltachain(
+static delta_chain_t getdeltachain_impl(
     datapack_handle_t* handle,
-    const uint8_t node[NODE_SZ]) {
+    const uint8_t node[NODE_SZ],
+    bool uncompress) {
   pack_chain_t pack_chain = build_pack_chain(handle, node);
 
   switch (pack_chain.code) {
@@ -607,7 +790,7 @@ delta_chain_t getdeltachain(
     get_delta_chain_link_result_t next;
 
     next = getdeltachainlink(handle, ptr, link);
-    if (!uncompressdeltachainlink(link)) {
+    if (uncompress && !uncompressdeltachainlink(link)) {
       result.code = GET_DELTA_CHAIN_CORRUPT;
       goto error_cleanup;
     }
@@ -658,6 +841,18 @@ cleanup:
   return result;
 }
 
+delta_chain_t getdeltachain(
+    datapack_handle_t* handle,
+    const uint8_t node[NODE_SZ]) {
+  return getdeltachain_impl(handle, node, true);
+}
+
+delta_chain_t getdeltachain_compressed(
+    datapack_handle_t* handle,
+    const uint8_t node[NODE_SZ]) {
+  return getdeltachain_impl(handle, node, false);
+}
+
 void freedeltachain(delta_chain_t chain) {
   for (size_t ix = 0; ix < chain.links_count; ix++) {
     free((void*)chain.delta_chain_links[ix].delta);
@@ -32,6 +32,7 @@ typedef uint64_t data_offset_t;
 
 struct _disk_index_entry_t;
 struct _fanout_table_entry_t;
+struct ZSTD_DDict_s;
 
 /**
  * This is a post-processed index entry.  The node pointer is valid only if
@@ -72,12 +73,24 @@ typedef struct _datapack_handle_t {
 
   uint8_t version;
 
+  // offset of the first revision in the data file, after the header.
+  data_offset_t entries_offset;
+
+  // for version 2 packs with a dictionary, the digested dictionary that their
+  // deltas are decompressed with.  NULL otherwise.
+  struct ZSTD_DDict_s* zstd_ddict;
+
   // this is the computed fanout table.
   struct _fanout_table_entry_t* fanout_table;
 
   // this points to the first index entry.
   struct _disk_index_entry_t* index_table;
 
+  // for large packs, the first 8 bytes of each index entry's node as a big
+  // endian integer, so that find() can bisect a bucket without touching the
+  // index entries themselves.  NULL for small packs.
+  uint64_t* index_prefixes;
+
   size_t paged_in_datapack_memory;
 } datapack_handle_t;
 
@@ -98,6 +111,11 @@ typedef struct _delta_chain_link_t {
   data_offset_t delta_sz;
   const uint8_t* delta;
 
+  /* compressed_buf is a zstd frame rather than lz4 data (version 2 packs),
+   * compressed with zstd_ddict's dictionary if it is not NULL */
+  bool zstd;
+  const struct ZSTD_DDict_s* zstd_ddict;
+
   uint32_t meta_sz;
   const uint8_t* meta;
 } delta_chain_link_t;
@@ -147,12 +165,41 @@ extern bool find(
 /**
  * Retrieves a delta chain for a given node.
  */
+/**
+ * Returns the number of nodes in the pack's index.
+ */
+extern size_t datapack_index_size(const datapack_handle_t* handle);
+
+/**
+ * Returns the node of the index-th entry of the pack's index.  Entries are
+ * sorted by node.
+ */
+extern const uint8_t* datapack_index_node(
+    const datapack_handle_t* handle,
+    size_t index);
+
 extern delta_chain_t getdeltachain(
     datapack_handle_t* handle,
     const uint8_t node[NODE_SZ]);
 
+/**
+ * Like getdeltachain(), but leaves the links compressed.  Callers call
+ * uncompressdeltachainlink() on each link, possibly from several threads.
+ */
+extern delta_chain_t getdeltachain_compressed(
+    datapack_handle_t* handle,
+    const uint8_t node[NODE_SZ]);
+
 extern void freedeltachain(delta_chain_t chain);
 
+/**
+ * Tells the kernel that the given range of the data file will be read soon.
+ */
+extern void datapack_willneed(
+    const datapack_handle_t* handle,
+    data_offset_t offset,
+    data_offset_t size);
+
 typedef enum {
   GET_DELTA_CHAIN_LINK_OK,
   GET_DELTA_CHAIN_LINK_OOM,
@@ -0,0 +1,147 @@
+// Copyright (c) 2004-present, Facebook, Inc.
+// All Rights Reserved.
+//
+// This software may be used and distributed according to the terms of the
+// GNU General Public License version 2 or any later version.
+
+// cdatapack_bench.c: Measure how many index lookups per second a pack serves.
+// no-check-code
+
+// clock_gettime is only declared for POSIX sources under -std=c99.
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif /* ndef _POSIX_C_SOURCE */
+
+#include <inttypes.h>
+#include <memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cdatapack/cdatapack.h"
+
+#define DATAIDX_EXT ".dataidx"
+#define DATAPACK_EXT ".datapack"
+
+#define DEFAULT_LOOKUPS 10000000
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t xorshift64(uint64_t* state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+// looks up every node in nodes, in order, until lookups have been done.
+// returns the number of nodes that were found.
+static size_t run_lookups(
+    const datapack_handle_t* handle,
+    const uint8_t* nodes,
+    size_t count,
+    size_t lookups,
+    const char* label) {
+  size_t found = 0;
+  pack_index_entry_t entry;
+  double start = now_seconds();
+  for (size_t ix = 0; ix < lookups; ix++) {
+    found += find(handle, &nodes[(ix % count) * NODE_SZ], &entry);
+  }
+  double elapsed = now_seconds() - start;
+  printf(
+      "%-24s %12.0f lookups/sec  (%zu of %zu found)\n",
+      label,
+      (double)lookups / elapsed,
+      found,
+      lookups);
+  return found;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "%s <path> [<lookups>]\n", argv[0]);
+    return 1;
+  }
+  size_t lookups = DEFAULT_LOOKUPS;
+  if (argc > 2) {
+    lookups = strtoull(argv[2], NULL, 10);
+  }
+
+  long len = strlen(argv[1]);
+  char* idx_path = (char*)malloc(len + sizeof(DATAIDX_EXT));
+  char* data_path = (char*)malloc(len + sizeof(DATAPACK_EXT));
+  if (idx_path == NULL || data_path == NULL) {
+    free(idx_path);
+    free(data_path);
+    fprintf(stderr, "Failed to allocate memory for idx_path or data_path\n");
+    exit(1);
+  }
+
+  sprintf(idx_path, "%s%s", argv[1], DATAIDX_EXT);
+  sprintf(data_path, "%s%s", argv[1], DATAPACK_EXT);
+
+  datapack_handle_t* handle =
+      open_datapack(idx_path, strlen(idx_path), data_path, strlen(data_path));
+  free(data_path);
+  free(idx_path);
+  if (handle == NULL || handle->status != DATAPACK_HANDLE_OK) {
+    fprintf(stderr, "failed to open pack\n");
+    return 1;
+  }
+
+  size_t count = datapack_index_size(handle);
+  if (count == 0 || lookups == 0) {
+    fprintf(stderr, "nothing to look up\n");
+    return 1;
+  }
+  printf("%zu index entries\n", count);
+
+  // look the nodes up in a random order, so that successive lookups do not
+  // share cache lines.
+  uint8_t* hits = (uint8_t*)malloc(count * NODE_SZ);
+  uint8_t* misses = (uint8_t*)malloc(count * NODE_SZ);
+  if (hits == NULL || misses == NULL) {
+    fprintf(stderr, "Failed to allocate memory for the nodes\n");
+    exit(1);
+  }
+  for (size_t ix = 0; ix < count; ix++) {
+    memcpy(&hits[ix * NODE_SZ], datapack_index_node(handle, ix), NODE_SZ);
+  }
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  for (size_t ix = count - 1; ix > 0; ix--) {
+    size_t other = xorshift64(&state) % (ix + 1);
+    uint8_t tmp[NODE_SZ];
+    memcpy(tmp, &hits[ix * NODE_SZ], NODE_SZ);
+    memcpy(&hits[ix * NODE_SZ], &hits[other * NODE_SZ], NODE_SZ);
+    memcpy(&hits[other * NODE_SZ], tmp, NODE_SZ);
+  }
+  // flipping the last byte keeps the misses in the same fanout buckets and
+  // sharing prefixes with real nodes, the expensive case.
+  memcpy(misses, hits, count * NODE_SZ);
+  for (size_t ix = 0; ix < count; ix++) {
+    misses[ix * NODE_SZ + NODE_SZ - 1] ^= 0xff;
+  }
+
+  run_lookups(handle, hits, count, lookups, "hits");
+  run_lookups(handle, misses, count, lookups, "misses");
+
+  if (handle->index_prefixes != NULL) {
+    // compare against bisecting the index entries themselves.
+    free(handle->index_prefixes);
+    handle->index_prefixes = NULL;
+    run_lookups(handle, hits, count, lookups, "hits (no prefixes)");
+    run_lookups(handle, misses, count, lookups, "misses (no prefixes)");
+  }
+
+  free(hits);
+  free(misses);
+  close_datapack(handle);
+  return 0;
+}
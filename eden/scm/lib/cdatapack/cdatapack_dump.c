@@ -50,7 +50,7 @@ int main(int argc, char* argv[]) {
   const uint8_t* ptr = handle->data_mmap;
   const uint8_t* end = ptr + handle->data_file_sz;
 
-  ptr += 1; // for the version field.
+  ptr += handle->entries_offset; // for the header.
 
   const char* last_filename = NULL;
   uint16_t last_filename_sz = 0;
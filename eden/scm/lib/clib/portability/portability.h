@@ -28,4 +28,10 @@
 #define PACKEDSTRUCT(__Declaration__) __Declaration__ __attribute__((packed))
 #endif
 
+#if defined(_MSC_VER)
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
+
 #endif /* #ifndef FBHGEXT_CLIB_PORTABILITY_PORTABILITY_H */
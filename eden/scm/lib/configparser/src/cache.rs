@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+//! Binary cache of a loaded [`ConfigSet`].
+//!
+//! Parsing every config file is a noticeable part of the startup time of a
+//! short-lived process when the layered configs are large. The cache holds the
+//! loaded config, and is memory-mapped and used as is while none of the files
+//! that were read, or looked for, have changed, and the environment variables
+//! that affect loading are the same. Values are zero-copy slices of the
+//! mapping.
+//!
+//! The file starts with a binary index, followed by a pool of UTF-8 strings
+//! that the index refers to by offset and length:
+//!
+//! ```plain,ignore
+//! MAGIC VERSION index_len:u64 index pool
+//!
+//! index := env* file_count:u32 file_stat* content_count:u32 content*
+//!          section_count:u32 section*
+//! env := 0 | 1 str              (for each of ENV_VARS, unset or set)
+//! file_stat := str exists:u8 [mtime_secs:u64 mtime_nanos:u32 size:u64 inode:u64]
+//! content := path:str content:str
+//! section := name:str item_count:u32 (name:str value_count:u32 value*)*
+//! value := flags:u8 [value:str] source:str [content:u32 start:u64 end:u64]
+//! str := offset:u32 len:u32     (into the pool)
+//! ```
+//!
+//! Integers are little-endian.
+
+use std::collections::HashMap;
+use std::convert::TryInto;
+use std::env;
+use std::fs;
+use std::io::{self, Write};
+use std::path::{Path, PathBuf};
+use std::process;
+use std::str;
+use std::sync::Arc;
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+use memmap::Mmap;
+use minibytes::{Text, TextOwner};
+
+use crate::config::{ConfigSet, Section, ValueLocation, ValueSource};
+use crate::error::Error;
+
+const MAGIC: &[u8] = b"HGRCCACHE\0";
+const VERSION: u8 = 1;
+
+/// The environment variables that change what loading the config reads.
+const ENV_VARS: &[&str] = &[
+    "HGRCPATH",
+    "HGPLAIN",
+    "HGPLAINEXCEPT",
+    "VISUAL",
+    "EDITOR",
+    "HGPROF",
+    "HOME",
+    "USERPROFILE",
+    "XDG_CONFIG_HOME",
+    "PROGRAMDATA",
+];
+
+/// A file modified this recently could be modified again without changing its
+/// mtime, so the config is not cached until its files are older than this.
+const RACY_WINDOW: Duration = Duration::from_secs(2);
+
+const FLAG_VALUE: u8 = 1;
+const FLAG_LOCATION: u8 = 2;
+
+/// Return the config cached at `cache_path` if it is still valid. Otherwise call `load` to
+/// load it into an empty `ConfigSet`, and cache the result if there were no errors.
+///
+/// Problems reading or writing the cache are not errors; the config is loaded without it.
+pub fn load_cached(
+    cache_path: &Path,
+    load: impl FnOnce(&mut ConfigSet) -> Vec<Error>,
+) -> (ConfigSet, Vec<Error>) {
+    load_cached_with_racy_window(cache_path, load, RACY_WINDOW)
+}
+
+fn load_cached_with_racy_window(
+    cache_path: &Path,
+    load: impl FnOnce(&mut ConfigSet) -> Vec<Error>,
+    racy_window: Duration,
+) -> (ConfigSet, Vec<Error>) {
+    if let Some(config) = read(cache_path) {
+        return (config, Vec::new());
+    }
+    let mut config = ConfigSet::new();
+    let errors = load(&mut config);
+    if errors.is_empty() {
+        // The config is usable without the cache.
+        let _ = write(cache_path, &config, racy_window);
+    }
+    (config, errors)
+}
+
+/// The status of a config file, compared to tell whether it changed.
+#[derive(Debug, PartialEq)]
+enum FileStat {
+    Missing,
+    Present {
+        mtime: Duration,
+        size: u64,
+        inode: u64,
+    },
+}
+
+impl FileStat {
+    fn of(path: &Path) -> Self {
+        match fs::metadata(path) {
+            Ok(metadata) => FileStat::Present {
+                mtime: metadata
+                    .modified()
+                    .ok()
+                    .and_then(|mtime| mtime.duration_since(UNIX_EPOCH).ok())
+                    .unwrap_or_default(),
+                size: metadata.len(),
+                inode: inode(&metadata),
+            },
+            Err(_) => FileStat::Missing,
+        }
+    }
+}
+
+#[cfg(unix)]
+fn inode(metadata: &fs::Metadata) -> u64 {
+    use std::os::unix::fs::MetadataExt;
+    metadata.ino()
+}
+
+#[cfg(not(unix))]
+fn inode(_metadata: &fs::Metadata) -> u64 {
+    0
+}
+
+/// Owns the string pool of a mapped cache file, which was checked to be valid UTF-8.
+struct StringPool {
+    mmap: Mmap,
+    start: usize,
+}
+
+impl AsRef<str> for StringPool {
+    fn as_ref(&self) -> &str {
+        // The pool was validated as UTF-8 when the cache was opened.
+        unsafe { str::from_utf8_unchecked(&self.mmap[self.start..]) }
+    }
+}
+
+impl TextOwner for StringPool {}
+
+fn read(cache_path: &Path) -> Option<ConfigSet> {
+    let file = fs::File::open(cache_path).ok()?;
+    // The cache is replaced by renaming a new file over it, never modified in place, so the
+    // mapping stays valid.
+    let mmap = unsafe { Mmap::map(&file) }.ok()?;
+
+    let header_len = MAGIC.len() + 1 + 8;
+    if mmap.len() < header_len || &mmap[..MAGIC.len()] != MAGIC || mmap[MAGIC.len()] != VERSION {
+        return None;
+    }
+    let index_len = u64::from_le_bytes(mmap[MAGIC.len() + 1..header_len].try_into().ok()?);
+    let pool_start = header_len.checked_add(index_len.try_into().ok()?)?;
+    if pool_start > mmap.len() {
+        return None;
+    }
+    str::from_utf8(&mmap[pool_start..]).ok()?;
+    let index = mmap[header_len..pool_start].to_vec();
+    let pool = Text::from_owner(StringPool {
+        mmap,
+        start: pool_start,
+    });
+
+    let mut reader = Reader {
+        index: &index,
+        pool,
+    };
+    reader.read_config()
+}
+
+struct Reader<'a> {
+    index: &'a [u8],
+    pool: Text,
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, len: usize) -> Option<&'a [u8]> {
+        if self.index.len() < len {
+            return None;
+        }
+        let (taken, rest) = self.index.split_at(len);
+        self.index = rest;
+        Some(taken)
+    }
+
+    fn read_u8(&mut self) -> Option<u8> {
+        Some(self.take(1)?[0])
+    }
+
+    fn read_u32(&mut self) -> Option<u32> {
+        Some(u32::from_le_bytes(self.take(4)?.try_into().ok()?))
+    }
+
+    fn read_u64(&mut self) -> Option<u64> {
+        Some(u64::from_le_bytes(self.take(8)?.try_into().ok()?))
+    }
+
+    fn read_str(&mut self) -> Option<Text> {
+        let start = self.read_u32()? as usize;
+        let end = start.checked_add(self.read_u32()? as usize)?;
+        if end > self.pool.len()
+            || !self.pool.is_char_boundary(start)
+            || !self.pool.is_char_boundary(end)
+        {
+            return None;
+        }
+        Some(self.pool.slice(start..end))
+    }
+
+    fn read_stat(&mut self) -> Option<FileStat> {
+        match self.read_u8()? {
+            0 => Some(FileStat::Missing),
+            _ => {
+                let secs = self.read_u64()?;
+                let nanos = self.read_u32()?;
+                Some(FileStat::Present {
+                    mtime: Duration::new(secs, nanos),
+                    size: self.read_u64()?,
+                    inode: self.read_u64()?,
+                })
+            }
+        }
+    }
+
+    /// Read the cached config, or return `None` if it is invalid or out of date.
+    fn read_config(&mut self) -> Option<ConfigSet> {
+        for name in ENV_VARS {
+            let cached = match self.read_u8()? {
+                0 => None,
+                _ => Some(self.read_str()?),
+            };
+            let current = env::var_os(name);
+            if cached.as_deref() != current.as_ref().and_then(|v| v.to_str()) {
+                return None;
+            }
+        }
+
+        let file_count = self.read_u32()?;
+        let mut files = Vec::with_capacity(file_count as usize);
+        for _ in 0..file_count {
+            let path = PathBuf::from(&*self.read_str()?);
+            if self.read_stat()? != FileStat::of(&path) {
+                return None;
+            }
+            files.push(path);
+        }
+
+        let content_count = self.read_u32()?;
+        let mut contents = Vec::with_capacity(content_count as usize);
+        for _ in 0..content_count {
+            let path = Arc::new(PathBuf::from(&*self.read_str()?));
+            contents.push((path, self.read_str()?));
+        }
+
+        let mut config = ConfigSet::new();
+        config.files = files;
+        let section_count = self.read_u32()?;
+        for _ in 0..section_count {
+            let section_name = self.read_str()?;
+            let mut section = Section::default();
+            let item_count = self.read_u32()?;
+            for _ in 0..item_count {
+                let name = self.read_str()?;
+                let value_count = self.read_u32()?;
+                let mut values = Vec::with_capacity(value_count as usize);
+                for _ in 0..value_count {
+                    values.push(self.read_value(&contents)?);
+                }
+                section.items.insert(name, values);
+            }
+            config.sections.insert(section_name, section);
+        }
+
+        if !self.index.is_empty() {
+            return None;
+        }
+        Some(config)
+    }
+
+    fn read_value(&mut self, contents: &[(Arc<PathBuf>, Text)]) -> Option<ValueSource> {
+        let flags = self.read_u8()?;
+        let value = match flags & FLAG_VALUE {
+            0 => None,
+            _ => Some(self.read_str()?),
+        };
+        let source = self.read_str()?;
+        let location = match flags & FLAG_LOCATION {
+            0 => None,
+            _ => {
+                let (path, content) = contents.get(self.read_u32()? as usize)?;
+                let start = self.read_u64()? as usize;
+                let end = self.read_u64()? as usize;
+                if start > end
+                    || end > content.len()
+                    || !content.is_char_boundary(start)
+                    || !content.is_char_boundary(end)
+                {
+                    return None;
+                }
+                Some(ValueLocation {
+                    path: path.clone(),
+                    content: content.clone(),
+                    location: start..end,
+                })
+            }
+        };
+        Some(ValueSource {
+            value,
+            source,
+            location,
+        })
+    }
+}
+
+#[derive(Default)]
+struct Writer {
+    index: Vec<u8>,
+    pool: String,
+}
+
+impl Writer {
+    fn write_u8(&mut self, value: u8) {
+        self.index.push(value);
+    }
+
+    fn write_u32(&mut self, value: usize) -> Option<()> {
+        let value: u32 = value.try_into().ok()?;
+        self.index.extend_from_slice(&value.to_le_bytes());
+        Some(())
+    }
+
+    fn write_u64(&mut self, value: u64) {
+        self.index.extend_from_slice(&value.to_le_bytes());
+    }
+
+    fn write_str(&mut self, value: &str) -> Option<()> {
+        self.write_u32(self.pool.len())?;
+        self.write_u32(value.len())?;
+        self.pool.push_str(value);
+        Some(())
+    }
+
+    fn write_stat(&mut self, stat: &FileStat) {
+        match stat {
+            FileStat::Missing => self.write_u8(0),
+            FileStat::Present { mtime, size, inode } => {
+                self.write_u8(1);
+                self.write_u64(mtime.as_secs());
+                self.index
+                    .extend_from_slice(&mtime.subsec_nanos().to_le_bytes());
+                self.write_u64(*size);
+                self.write_u64(*inode);
+            }
+        }
+    }
+
+    /// Serialize the config, or return `None` if it cannot be cached.
+    fn write_config(&mut self, config: &ConfigSet, racy_window: Duration) -> Option<()> {
+        for name in ENV_VARS {
+            match env::var_os(name) {
+                None => self.write_u8(0),
+                Some(value) => {
+                    self.write_u8(1);
+                    self.write_str(value.to_str()?)?;
+                }
+            }
+        }
+
+        let racy_after = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .ok()?
+            .checked_sub(racy_window)?;
+        self.write_u32(config.files.len())?;
+        for path in &config.files {
+            let stat = FileStat::of(path);
+            if let FileStat::Present { mtime, .. } = stat {
+                if mtime > racy_after {
+                    return None;
+                }
+            }
+            self.write_str(path.to_str()?)?;
+            self.write_stat(&stat);
+        }
+
+        // Each file's content is written once, however many values it holds.
+        let mut content_ids = HashMap::new();
+        let mut contents = Vec::new();
+        for section in config.sections.values() {
+            for values in section.items.values() {
+                for location in values.iter().filter_map(|v| v.location.as_ref()) {
+                    let key = (location.content.as_ptr(), location.content.len());
+                    content_ids.entry(key).or_insert_with(|| {
+                        contents.push(location);
+                        contents.len() - 1
+                    });
+                }
+            }
+        }
+        self.write_u32(contents.len())?;
+        for location in &contents {
+            self.write_str(location.path.to_str()?)?;
+            self.write_str(&location.content)?;
+        }
+
+        self.write_u32(config.sections.len())?;
+        for (section_name, section) in &config.sections {
+            self.write_str(section_name)?;
+            self.write_u32(section.items.len())?;
+            for (name, values) in &section.items {
+                self.write_str(name)?;
+                self.write_u32(values.len())?;
+                for value in values {
+                    let mut flags = 0;
+                    if value.value.is_some() {
+                        flags |= FLAG_VALUE;
+                    }
+                    if value.location.is_some() {
+                        flags |= FLAG_LOCATION;
+                    }
+                    self.write_u8(flags);
+                    if let Some(ref value) = value.value {
+                        self.write_str(value)?;
+                    }
+                    self.write_str(&value.source)?;
+                    if let Some(ref location) = value.location {
+                        let key = (location.content.as_ptr(), location.content.len());
+                        self.write_u32(content_ids[&key])?;
+                        self.write_u64(location.location.start as u64);
+                        self.write_u64(location.location.end as u64);
+                    }
+                }
+            }
+        }
+        Some(())
+    }
+}
+
+fn write(cache_path: &Path, config: &ConfigSet, racy_window: Duration) -> io::Result<()> {
+    let mut writer = Writer::default();
+    if writer.write_config(config, racy_window).is_none() {
+        return Ok(());
+    }
+
+    if let Some(dir) = cache_path.parent() {
+        fs::create_dir_all(dir)?;
+    }
+    // Readers may have the old cache mapped, so write a new file and rename it over the old one
+    // rather than modifying it.
+    let temp_path = cache_path.with_extension(format!("tmp{}", process::id()));
+    let result = (|| {
+        let mut file = fs::File::create(&temp_path)?;
+        file.write_all(MAGIC)?;
+        file.write_all(&[VERSION])?;
+        file.write_all(&(writer.index.len() as u64).to_le_bytes())?;
+        file.write_all(&writer.index)?;
+        file.write_all(writer.pool.as_bytes())?;
+        drop(file);
+        fs::rename(&temp_path, cache_path)
+    })();
+    if result.is_err() {
+        let _ = fs::remove_file(&temp_path);
+    }
+    result
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::config::Options;
+    use tempdir::TempDir;
+
+    fn load_from(dir: &Path) -> impl FnOnce(&mut ConfigSet) -> Vec<Error> {
+        let path = dir.join("main.rc");
+        move |config: &mut ConfigSet| config.load_path(path, &"test".into())
+    }
+
+    fn load(dir: &Path) -> (ConfigSet, Vec<Error>) {
+        load_cached_with_racy_window(&dir.join("cache"), load_from(dir), Duration::from_secs(0))
+    }
+
+    #[test]
+    fn test_cached_config_matches_parsed_config() {
+        let dir = TempDir::new("test_cached_config").unwrap();
+        fs::write(
+            dir.path().join("main.rc"),
+            "[a]\nx = 1\n%include included.rc\ny = multi\n line\n[b]\n%unset z\n",
+        )
+        .unwrap();
+        fs::write(dir.path().join("included.rc"), "[a]\nx = 2\n").unwrap();
+
+        let (parsed, errors) = load(dir.path());
+        assert!(errors.is_empty());
+        assert!(dir.path().join("cache").exists());
+
+        let (cached, errors) = load_cached_with_racy_window(
+            &dir.path().join("cache"),
+            |_: &mut ConfigSet| panic!("the cache should be used"),
+            Duration::from_secs(0),
+        );
+        assert!(errors.is_empty());
+        assert_eq!(cached.sections(), parsed.sections());
+        assert_eq!(cached.keys("a"), parsed.keys("a"));
+        assert_eq!(cached.get("a", "x"), Some(Text::from("2")));
+        assert_eq!(cached.get("a", "y"), Some(Text::from("multi\nline")));
+
+        let sources = cached.get_sources("a", "x");
+        let expected = parsed.get_sources("a", "x");
+        assert_eq!(sources.len(), 2);
+        for (source, expected) in sources.iter().zip(expected.iter()) {
+            assert_eq!(source.value(), expected.value());
+            assert_eq!(source.source(), expected.source());
+            assert_eq!(source.location(), expected.location());
+            assert_eq!(source.file_content(), expected.file_content());
+        }
+        assert_eq!(cached.get_sources("b", "z")[0].value(), &None);
+    }
+
+    #[test]
+    fn test_changed_files_are_parsed_again() {
+        let dir = TempDir::new("test_changed_files").unwrap();
+        fs::write(
+            dir.path().join("main.rc"),
+            "[a]\nx = 1\n%include other.rc\n",
+        )
+        .unwrap();
+        let (config, _) = load(dir.path());
+        assert_eq!(config.get("a", "x"), Some(Text::from("1")));
+
+        // A file that did not exist when the cache was written is noticed too.
+        fs::write(dir.path().join("other.rc"), "[a]\nx = 22\n").unwrap();
+        let (config, _) = load(dir.path());
+        assert_eq!(config.get("a", "x"), Some(Text::from("22")));
+
+        fs::write(dir.path().join("main.rc"), "[a]\nx = 333\n").unwrap();
+        let (config, _) = load(dir.path());
+        assert_eq!(config.get("a", "x"), Some(Text::from("333")));
+    }
+
+    #[test]
+    fn test_invalid_cache_is_ignored() {
+        let dir = TempDir::new("test_invalid_cache").unwrap();
+        fs::write(dir.path().join("main.rc"), "[a]\nx = 1\n").unwrap();
+        fs::write(dir.path().join("cache"), b"HGRCCACHE\0\x01garbage").unwrap();
+        let (config, errors) = load(dir.path());
+        assert!(errors.is_empty());
+        assert_eq!(config.get("a", "x"), Some(Text::from("1")));
+    }
+
+    #[test]
+    fn test_recent_files_are_not_cached() {
+        let dir = TempDir::new("test_recent_files").unwrap();
+        fs::write(dir.path().join("main.rc"), "[a]\nx = 1\n").unwrap();
+        let cache_path = dir.path().join("cache");
+        load_cached(&cache_path, |config: &mut ConfigSet| {
+            config.load_path(dir.path().join("main.rc"), &Options::new())
+        });
+        assert!(!cache_path.exists());
+    }
+}
@@ -28,30 +28,33 @@ type Pair<'a> = pest::iterators::Pair<'a, Rule>;
 /// Collection of config sections loaded from various sources.
 #[derive(Clone, Default, Debug)]
 pub struct ConfigSet {
-    sections: IndexMap<Text, Section>,
+    pub(crate) sections: IndexMap<Text, Section>,
+    /// The paths `load_path` was asked to read, including `%include`d ones and ones that do
+    /// not exist. Used to tell whether a cached copy of this config is still valid.
+    pub(crate) files: Vec<PathBuf>,
 }
 
 /// Internal representation of a config section.
 #[derive(Clone, Default, Debug)]
-struct Section {
-    items: IndexMap<Text, Vec<ValueSource>>,
+pub(crate) struct Section {
+    pub(crate) items: IndexMap<Text, Vec<ValueSource>>,
 }
 
 /// A config value with associated metadata like where it comes from.
 #[derive(Clone, Debug)]
 pub struct ValueSource {
-    value: Option<Text>,
-    source: Text, // global, user, repo, "--config", or an extension name, etc.
-    location: Option<ValueLocation>,
+    pub(crate) value: Option<Text>,
+    pub(crate) source: Text, // global, user, repo, "--config", or an extension name, etc.
+    pub(crate) location: Option<ValueLocation>,
 }
 
 /// The on-disk file name and byte offsets that provide the config value.
 /// Useful if applications want to edit config values in-place.
 #[derive(Clone, Debug)]
-struct ValueLocation {
-    path: Arc<PathBuf>,
-    content: Text,
-    location: Range<usize>,
+pub(crate) struct ValueLocation {
+    pub(crate) path: Arc<PathBuf>,
+    pub(crate) content: Text,
+    pub(crate) location: Range<usize>,
 }
 
 /// Options that affects config setting functions like `load_path`, `parse`,
@@ -203,6 +206,7 @@ impl ConfigSet {
         visited: &mut HashSet<PathBuf>,
         errors: &mut Vec<Error>,
     ) {
+        self.files.push(path.to_path_buf());
         if let Ok(path) = path.canonicalize() {
             let path = &path;
             debug_assert!(path.is_absolute());
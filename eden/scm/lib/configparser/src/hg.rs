@@ -17,12 +17,14 @@ use anyhow::Result;
 use minibytes::Text;
 use util::path::expand_path;
 
+use crate::cache;
 use crate::config::{ConfigSet, Options};
 use crate::error::Error;
 
 pub const HGPLAIN: &str = "HGPLAIN";
 pub const HGPLAINEXCEPT: &str = "HGPLAINEXCEPT";
 pub const HGRCPATH: &str = "HGRCPATH";
+pub const HGRCCACHE: &str = "HGRCCACHE";
 
 pub trait OptionsHgExt {
     /// Drop configs according to `$HGPLAIN` and `$HGPLAINEXCEPT`.
@@ -86,17 +88,41 @@ pub trait FromConfigValue: Sized {
 }
 
 /// Load system, user config files.
+///
+/// The loaded config is cached in `$HGRCCACHE`, or `hg/hgrc.cache` in the user's cache
+/// directory, and read from there while the files it came from are unchanged. Set `HGRCCACHE`
+/// to an empty value to disable the cache.
 pub fn load() -> Result<ConfigSet> {
-    let mut set = ConfigSet::new();
-    if let Some(error) = set.load_system().pop() {
-        return Err(error.into());
-    }
-    if let Some(error) = set.load_user().pop() {
+    let (set, mut errors) = match cache_path() {
+        Some(path) => cache::load_cached(&path, load_uncached),
+        None => {
+            let mut set = ConfigSet::new();
+            let errors = load_uncached(&mut set);
+            (set, errors)
+        }
+    };
+    if let Some(error) = errors.pop() {
         return Err(error.into());
     }
     Ok(set)
 }
 
+fn load_uncached(set: &mut ConfigSet) -> Vec<Error> {
+    let errors = set.load_system();
+    if !errors.is_empty() {
+        return errors;
+    }
+    set.load_user()
+}
+
+fn cache_path() -> Option<PathBuf> {
+    match env::var_os(HGRCCACHE) {
+        Some(path) if path.is_empty() => None,
+        Some(path) => Some(PathBuf::from(path)),
+        None => dirs::cache_dir().map(|dir| dir.join("hg").join("hgrc.cache")),
+    }
+}
+
 impl OptionsHgExt for Options {
     fn process_hgplain(self) -> Self {
         let plain_set = env::var(HGPLAIN).is_ok();
@@ -67,6 +67,7 @@
 //! ```
 
 pub mod c_api;
+pub mod cache;
 pub mod config;
 pub mod error;
 pub mod hg;
@@ -152,7 +152,7 @@ impl IndexEntry {
 impl DataIndexOptions {
     pub fn read<T: Read>(reader: &mut T) -> Result<DataIndexOptions> {
         let version = reader.read_u8()?;
-        if version > 1 {
+        if version > 2 {
             return Err(DataIndexError(format!("unsupported version '{:?}'", version)).into());
         };
 
@@ -199,8 +199,8 @@ impl DataIndex {
         let fanout_size = FanoutTable::get_size(options.large);
         let mut index_start = 2 + fanout_size;
 
-        // Version one records the number of entries in the index
-        if options.version == 1 {
+        // Version one and later record the number of entries in the index
+        if options.version >= 1 {
             index_start += 8;
         }
 
@@ -211,10 +211,16 @@ impl DataIndex {
         })
     }
 
-    pub fn write<T: Write>(writer: &mut T, values: &HashMap<HgId, DeltaLocation>) -> Result<()> {
+    /// Write an index for a pack of the given version, 1 or 2, which only differ in the format of
+    /// the pack.
+    pub fn write<T: Write>(
+        writer: &mut T,
+        values: &HashMap<HgId, DeltaLocation>,
+        version: u8,
+    ) -> Result<()> {
         // Write header
         let options = DataIndexOptions {
-            version: 1,
+            version,
             large: values.len() > SMALL_FANOUT_CUTOFF,
         };
         options.write(writer)?;
@@ -312,7 +318,7 @@ mod tests {
 
     fn make_index(values: &HashMap<HgId, DeltaLocation>) -> DataIndex {
         let mut file = NamedTempFile::new().expect("file");
-        DataIndex::write(&mut file, &values).expect("write dataindex");
+        DataIndex::write(&mut file, &values, 1).expect("write dataindex");
         let path = file.into_temp_path();
 
         DataIndex::new(&path).expect("dataindex")
@@ -320,7 +326,7 @@ mod tests {
 
     #[test]
     fn test_header_invalid() {
-        let buf: Vec<u8> = vec![2, 0];
+        let buf: Vec<u8> = vec![3, 0];
         DataIndexOptions::read(&mut Cursor::new(buf)).expect_err("invalid read");
 
         let buf: Vec<u8> = vec![0, 1];
@@ -368,7 +374,7 @@ mod tests {
 
     quickcheck! {
         fn test_header_serialization(version: u8, large: bool) -> bool {
-            let version = version % 2;
+            let version = version % 3;
             let options = DataIndexOptions { version, large };
             let mut buf: Vec<u8> = vec![];
             options.write(&mut buf).expect("write");
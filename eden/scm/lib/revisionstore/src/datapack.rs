@@ -22,6 +22,8 @@
 //!     a deltabasenode equal to the nullid.
 //!
 //!     datapack = <version: 1 byte>
+//!                <dictionary len: 4 byte unsigned int> [2]
+//!                <dictionary>                          [2]
 //!                [<revision>,...]
 //!     revision = <filename len: 2 byte unsigned int>
 //!                <filename>
@@ -39,6 +41,12 @@
 //!     metadata-key could be METAKEYFLAG or METAKEYSIZE or other single byte
 //!     value in the future.
 //!
+//!     The delta is compressed, and starts with its uncompressed length as a 4
+//!     byte little endian unsigned int. Versions 0 and 1 compress it with lz4.
+//!     Version 2 compresses it with zstd, using the pack's dictionary if it is
+//!     not empty. The dictionary is trained on the pack's first deltas, so that
+//!     small deltas of similar files compress well.
+//!
 //! .dataidx
 //!     The index file consists of two parts, the fanout and the index.
 //!
@@ -78,22 +86,27 @@
 //!
 //! ```
 //! [1]: new in version 1.
+//! [2]: new in version 2. The index has the same format as for version 1.
 
 use std::{
     cell::RefCell,
     fmt,
     fs::File,
-    io::{Cursor, Read},
+    io::{Cursor, Read, Write},
     mem::{drop, take},
     path::{Path, PathBuf},
     sync::Arc,
 };
 
 use anyhow::{format_err, Error, Result};
-use byteorder::{BigEndian, ReadBytesExt};
+use byteorder::{BigEndian, LittleEndian, ReadBytesExt, WriteBytesExt};
 use bytes::Bytes;
 use memmap::{Mmap, MmapOptions};
 use thiserror::Error;
+use zstd::{
+    dict::{DecoderDictionary, EncoderDictionary},
+    stream::{read::Decoder, write::Encoder},
+};
 
 use lz4_pyframe::decompress;
 use mpatch::mpatch::get_full_text;
@@ -117,11 +130,18 @@ struct DataPackError(String);
 pub enum DataPackVersion {
     Zero,
     One,
+    Two,
 }
 
+/// The zstd compression level of version 2 datapacks. Decompression speed hardly depends on it.
+pub(crate) const ZSTD_LEVEL: i32 = 6;
+
 pub struct DataPack {
     mmap: Mmap,
     version: DataPackVersion,
+    /// Where the revisions start, after the header.
+    entries_offset: u64,
+    dictionary: Option<DecoderDictionary<'static>>,
     index: DataIndex,
     base_path: Arc<PathBuf>,
     pack_path: PathBuf,
@@ -133,6 +153,8 @@ pub struct DataEntry<'a> {
     filename: &'a RepoPath,
     hgid: HgId,
     delta_base: Option<HgId>,
+    version: DataPackVersion,
+    dictionary: Option<&'a DecoderDictionary<'static>>,
     compressed_data: &'a [u8],
     data: RefCell<Option<Bytes>>,
     metadata: Metadata,
@@ -140,10 +162,11 @@ pub struct DataEntry<'a> {
 }
 
 impl DataPackVersion {
-    fn new(value: u8) -> Result<Self> {
+    pub(crate) fn new(value: u8) -> Result<Self> {
         match value {
             0 => Ok(DataPackVersion::Zero),
             1 => Ok(DataPackVersion::One),
+            2 => Ok(DataPackVersion::Two),
             _ => {
                 Err(DataPackError(format!("invalid datapack version number '{:?}'", value)).into())
             }
@@ -156,12 +179,65 @@ impl From<DataPackVersion> for u8 {
         match version {
             DataPackVersion::Zero => 0,
             DataPackVersion::One => 1,
+            DataPackVersion::Two => 2,
+        }
+    }
+}
+
+/// Compress a delta for a version 2 datapack, with the pack's dictionary if it has one.
+pub(crate) fn zstd_compress(
+    data: &[u8],
+    dictionary: Option<&EncoderDictionary<'static>>,
+) -> Result<Vec<u8>> {
+    if data.len() > u32::max_value() as usize {
+        return Err(DataPackError("delta is longer than 2^32".into()).into());
+    }
+    let mut buf = Vec::with_capacity(data.len() / 2 + 16);
+    buf.write_u32::<LittleEndian>(data.len() as u32)?;
+    let mut encoder = match dictionary {
+        Some(dictionary) => Encoder::with_prepared_dictionary(buf, dictionary)?,
+        None => Encoder::new(buf, ZSTD_LEVEL)?,
+    };
+    encoder.write_all(data)?;
+    Ok(encoder.finish()?)
+}
+
+fn zstd_decompress(
+    compressed: &[u8],
+    dictionary: Option<&DecoderDictionary<'static>>,
+) -> Result<Vec<u8>> {
+    let len = Cursor::new(compressed).read_u32::<LittleEndian>()? as usize;
+    let frame = compressed.get_err(4..)?;
+    let mut data = Vec::with_capacity(len);
+    match dictionary {
+        Some(dictionary) => {
+            Decoder::with_prepared_dictionary(frame, dictionary)?.read_to_end(&mut data)?
         }
+        None => Decoder::with_buffer(frame)?.read_to_end(&mut data)?,
+    };
+    if data.len() != len {
+        return Err(DataPackError(format!(
+            "decompressed delta is {} bytes instead of {}",
+            data.len(),
+            len
+        ))
+        .into());
     }
+    Ok(data)
 }
 
 impl<'a> DataEntry<'a> {
     pub fn new(buf: &'a [u8], offset: u64, version: DataPackVersion) -> Result<Self> {
+        DataEntry::with_dictionary(buf, offset, version, None)
+    }
+
+    /// Like `new`, for an entry of a version 2 pack with a dictionary.
+    pub(crate) fn with_dictionary(
+        buf: &'a [u8],
+        offset: u64,
+        version: DataPackVersion,
+        dictionary: Option<&'a DecoderDictionary<'static>>,
+    ) -> Result<Self> {
         let mut cur = Cursor::new(buf);
         cur.set_position(offset);
 
@@ -195,7 +271,7 @@ impl<'a> DataEntry<'a> {
         cur.set_position(cur_pos + delta_len);
 
         // Metadata
-        let metadata = if version == DataPackVersion::One {
+        let metadata = if version != DataPackVersion::Zero {
             Metadata::read(&mut cur)?
         } else {
             Default::default()
@@ -208,6 +284,8 @@ impl<'a> DataEntry<'a> {
             filename,
             hgid,
             delta_base,
+            version,
+            dictionary,
             compressed_data,
             data,
             metadata,
@@ -234,7 +312,11 @@ impl<'a> DataEntry<'a> {
     pub fn delta(&self) -> Result<Bytes> {
         let mut cell = self.data.borrow_mut();
         if cell.is_none() {
-            *cell = Some(decompress(&self.compressed_data)?.into());
+            let data = match self.version {
+                DataPackVersion::Two => zstd_decompress(&self.compressed_data, self.dictionary)?,
+                _ => decompress(&self.compressed_data)?,
+            };
+            *cell = Some(data.into());
         }
 
         Ok(cell.as_ref().unwrap().clone())
@@ -285,10 +367,23 @@ impl DataPack {
 
         let mmap = unsafe { MmapOptions::new().len(len as usize).map(&file)? };
         let version = DataPackVersion::new(mmap[0])?;
+        let mut entries_offset = 1;
+        let mut dictionary = None;
+        if version == DataPackVersion::Two {
+            let mut cur = Cursor::new(&mmap[1..]);
+            let dictionary_len = cur.read_u32::<BigEndian>()? as u64;
+            let dictionary_slice = mmap.as_ref().get_err(5..(5 + dictionary_len) as usize)?;
+            if !dictionary_slice.is_empty() {
+                dictionary = Some(DecoderDictionary::copy(dictionary_slice));
+            }
+            entries_offset = 5 + dictionary_len;
+        }
         let index_path = path.with_extension("dataidx");
         Ok(DataPack {
             mmap,
             version,
+            entries_offset,
+            dictionary,
             index: DataIndex::new(&index_path)?,
             base_path: Arc::new(base_path),
             pack_path,
@@ -301,7 +396,12 @@ impl DataPack {
     }
 
     pub fn read_entry(&self, offset: u64) -> Result<DataEntry> {
-        DataEntry::new(self.mmap.as_ref(), offset, self.version.clone())
+        DataEntry::with_dictionary(
+            self.mmap.as_ref(),
+            offset,
+            self.version.clone(),
+            self.dictionary.as_ref(),
+        )
     }
 
     pub fn base_path(&self) -> &Path {
@@ -448,7 +548,7 @@ impl<'a> DataPackIterator<'a> {
     pub fn new(pack: &'a DataPack) -> Self {
         DataPackIterator {
             pack,
-            offset: 1, // Start after the header byte
+            offset: pack.entries_offset, // Start after the header
         }
     }
 }
@@ -22,12 +22,13 @@ use thiserror::Error;
 
 use lz4_pyframe::compress;
 use types::{HgId, Key};
+use zstd::dict::{from_samples, DecoderDictionary, EncoderDictionary};
 
 use mpatch::mpatch::get_full_text;
 
 use crate::{
     dataindex::{DataIndex, DeltaLocation},
-    datapack::{DataEntry, DataPackVersion},
+    datapack::{zstd_compress, DataEntry, DataPackVersion, ZSTD_LEVEL},
     datastore::{Delta, HgIdDataStore, HgIdMutableDeltaStore, Metadata, StoreResult},
     error::EmptyMutablePack,
     localstore::LocalStore,
@@ -36,11 +37,39 @@ use crate::{
     types::StoreKey,
 };
 
+/// The largest dictionary trained for a version 2 pack.
+const MAX_DICTIONARY_SIZE: usize = 64 * 1024;
+
+/// How many bytes of deltas a version 2 pack trains its dictionary on, about a hundred times the
+/// size of the dictionary as zstd recommends.
+const DICTIONARY_SAMPLES_SIZE: usize = 100 * MAX_DICTIONARY_SIZE;
+
+/// The dictionary of a version 2 pack, digested for compressing and decompressing deltas.
+struct Dictionary {
+    encoder: EncoderDictionary<'static>,
+    decoder: DecoderDictionary<'static>,
+}
+
+enum Zstd {
+    /// The first deltas added to a version 2 pack are held in memory until there are enough of
+    /// them to train the dictionary on, since the dictionary goes before them in the file.
+    Training {
+        pending: Vec<(Delta, Metadata)>,
+        index: HashMap<HgId, usize>,
+        size: usize,
+    },
+    /// No dictionary could be trained if there were too few deltas.
+    Trained(Option<Dictionary>),
+}
+
 struct MutableDataPackInner {
     dir: PathBuf,
+    version: DataPackVersion,
     data_file: PackWriter<NamedTempFile>,
     mem_index: HashMap<HgId, DeltaLocation>,
     hasher: Sha1,
+    /// None for packs older than version 2, which use lz4.
+    zstd: Option<Zstd>,
 }
 
 pub struct MutableDataPack {
@@ -74,19 +103,84 @@ impl MutableDataPackInner {
         let tempfile = Builder::new().append(true).tempfile_in(&dir)?;
         let mut data_file = PackWriter::new(tempfile);
         let mut hasher = Sha1::new();
-        let version_u8: u8 = version.into();
+        let zstd = if version == DataPackVersion::Two {
+            Some(Zstd::Training {
+                pending: Vec::new(),
+                index: HashMap::new(),
+                size: 0,
+            })
+        } else {
+            None
+        };
+        let version_u8: u8 = version.clone().into();
         data_file.write_u8(version_u8)?;
         hasher.input(&[version_u8]);
 
         Ok(Self {
             dir: dir.to_path_buf(),
+            version,
             data_file,
             mem_index: HashMap::new(),
             hasher,
+            zstd,
         })
     }
 
+    /// Train the dictionary of a version 2 pack on the deltas added so far, and write them out
+    /// after it.
+    fn train_dictionary(&mut self) -> Result<()> {
+        let pending = match self.zstd.take() {
+            Some(Zstd::Training { pending, .. }) => pending,
+            zstd => {
+                self.zstd = zstd;
+                return Ok(());
+            }
+        };
+
+        let samples: Vec<&[u8]> = pending
+            .iter()
+            .map(|(delta, _)| delta.data.as_ref())
+            .collect();
+        // Training fails if there are too few samples, and the deltas are then compressed
+        // without a dictionary.
+        let dictionary = from_samples(&samples, MAX_DICTIONARY_SIZE).unwrap_or_default();
+
+        let mut header = Vec::with_capacity(4 + dictionary.len());
+        header.write_u32::<BigEndian>(dictionary.len() as u32)?;
+        header.write_all(&dictionary)?;
+        self.data_file.write_all(&header)?;
+        self.hasher.input(&header);
+
+        self.zstd = Some(Zstd::Trained(if dictionary.is_empty() {
+            None
+        } else {
+            Some(Dictionary {
+                encoder: EncoderDictionary::copy(&dictionary, ZSTD_LEVEL),
+                decoder: DecoderDictionary::copy(&dictionary),
+            })
+        }));
+        for (delta, metadata) in pending {
+            self.write_entry(&delta, &metadata)?;
+        }
+        Ok(())
+    }
+
+    fn contains(&self, hgid: &HgId) -> bool {
+        match &self.zstd {
+            Some(Zstd::Training { index, .. }) => index.contains_key(hgid),
+            _ => self.mem_index.contains_key(hgid),
+        }
+    }
+
     fn read_entry(&self, key: &Key) -> Result<Option<(Delta, Metadata)>> {
+        let dictionary = match &self.zstd {
+            Some(Zstd::Training { pending, index, .. }) => {
+                return Ok(index.get(&key.hgid).map(|i| pending[*i].clone()));
+            }
+            Some(Zstd::Trained(Some(dictionary))) => Some(&dictionary.decoder),
+            _ => None,
+        };
+
         let location: &DeltaLocation = match self.mem_index.get(&key.hgid) {
             None => return Ok(None),
             Some(location) => location,
@@ -103,7 +197,7 @@ impl MutableDataPackInner {
         file.seek(SeekFrom::Start(location.offset))?;
         file.read_exact(&mut data)?;
 
-        let entry = DataEntry::new(&data, 0, DataPackVersion::One)?;
+        let entry = DataEntry::with_dictionary(&data, 0, self.version.clone(), dictionary)?;
         Ok(Some((
             Delta {
                 data: entry.delta()?,
@@ -117,14 +211,37 @@ impl MutableDataPackInner {
     }
 
     fn add(&mut self, delta: &Delta, metadata: &Metadata) -> Result<()> {
-        let path_slice = delta.key.path.as_byte_slice();
-        if path_slice.len() >= u16::MAX as usize {
+        if delta.key.path.as_byte_slice().len() >= u16::MAX as usize {
             return Err(MutableDataPackError("delta path is longer than 2^16".into()).into());
         }
 
+        if let Some(Zstd::Training {
+            pending,
+            index,
+            size,
+        }) = &mut self.zstd
+        {
+            index.insert(delta.key.hgid.clone(), pending.len());
+            pending.push((delta.clone(), metadata.clone()));
+            *size += delta.data.len();
+            if *size >= DICTIONARY_SAMPLES_SIZE {
+                self.train_dictionary()?;
+            }
+            return Ok(());
+        }
+        self.write_entry(delta, metadata)
+    }
+
+    fn write_entry(&mut self, delta: &Delta, metadata: &Metadata) -> Result<()> {
+        let path_slice = delta.key.path.as_byte_slice();
         let offset = self.data_file.bytes_written();
 
-        let compressed = compress(&delta.data)?;
+        let compressed = match &self.zstd {
+            Some(Zstd::Trained(dictionary)) => {
+                zstd_compress(&delta.data, dictionary.as_ref().map(|d| &d.encoder))?
+            }
+            _ => compress(&delta.data)?,
+        };
 
         // Preallocate with approximately the size we need:
         // (namelen(2) + name + hgid(20) + hgid(20) + datalen(8) + data + metadata(~22))
@@ -204,7 +321,7 @@ impl HgIdMutableDeltaStore for MutableDataPack {
 
     fn flush(&self) -> Result<Option<PathBuf>> {
         let mut guard = self.inner.lock();
-        let new_inner = MutableDataPackInner::new(&guard.dir, DataPackVersion::One)?;
+        let new_inner = MutableDataPackInner::new(&guard.dir, guard.version.clone())?;
         let old_inner = replace(&mut *guard, new_inner);
 
         old_inner.close_pack()
@@ -212,13 +329,18 @@ impl HgIdMutableDeltaStore for MutableDataPack {
 }
 
 impl MutablePack for MutableDataPackInner {
-    fn build_files(self) -> Result<(NamedTempFile, NamedTempFile, PathBuf)> {
+    fn build_files(mut self) -> Result<(NamedTempFile, NamedTempFile, PathBuf)> {
+        self.train_dictionary()?;
         if self.mem_index.is_empty() {
             return Err(EmptyMutablePack.into());
         }
 
         let mut index_file = PackWriter::new(NamedTempFile::new_in(&self.dir)?);
-        DataIndex::write(&mut index_file, &self.mem_index)?;
+        DataIndex::write(
+            &mut index_file,
+            &self.mem_index,
+            self.version.clone().into(),
+        )?;
 
         Ok((
             self.data_file.into_inner()?,
@@ -235,7 +357,7 @@ impl MutablePack for MutableDataPackInner {
 impl MutablePack for MutableDataPack {
     fn build_files(self) -> Result<(NamedTempFile, NamedTempFile, PathBuf)> {
         let mut guard = self.inner.lock();
-        let new_inner = MutableDataPackInner::new(&guard.dir, DataPackVersion::One)?;
+        let new_inner = MutableDataPackInner::new(&guard.dir, guard.version.clone())?;
         let old_inner = replace(&mut *guard, new_inner);
 
         old_inner.build_files()
@@ -294,7 +416,7 @@ impl LocalStore for MutableDataPack {
         Ok(keys
             .iter()
             .filter(|k| match k {
-                StoreKey::HgId(k) => inner.mem_index.get(&k.hgid).is_none(),
+                StoreKey::HgId(k) => !inner.contains(&k.hgid),
                 StoreKey::Content(_, _) => true,
             })
             .cloned()
@@ -316,6 +438,8 @@ mod tests {
 
     use types::{testutil::*, Key, RepoPathBuf};
 
+    use crate::datapack::DataPack;
+
     #[test]
     fn test_basic_creation() {
         let tempdir = tempdir().unwrap();
@@ -407,6 +531,63 @@ mod tests {
         Ok(())
     }
 
+    #[test]
+    fn test_zstd_dictionary() -> Result<()> {
+        let tempdir = tempdir()?;
+        let mutdatapack = MutableDataPack::new(tempdir.path(), DataPackVersion::Two)?;
+        let deltas: Vec<Delta> = (0..2000)
+            .map(|i| Delta {
+                data: Bytes::from(format!(
+                    "[section{}]\nname = value {}\n\
+                     # every revision of this file has a long comment in common,\n\
+                     # which the dictionary should learn to compress well.\n",
+                    i % 17,
+                    i * 7
+                )),
+                base: None,
+                key: Key::new(RepoPathBuf::new(), hgid(&i.to_string())),
+            })
+            .collect();
+        for delta in deltas.iter() {
+            mutdatapack.add(delta, &Default::default())?;
+        }
+        // The deltas are held in memory until the pack is flushed, as there are too few to train
+        // the dictionary on before then.
+        assert_eq!(
+            mutdatapack.get_delta_chain(&deltas[1].key)?,
+            Some(vec![deltas[1].clone()])
+        );
+
+        let path = mutdatapack.flush()?.unwrap();
+        let buf = fs::read(path.with_extension("datapack"))?;
+        assert_eq!(buf[0], 2);
+        let dictionary_len = u32::from_be_bytes([buf[1], buf[2], buf[3], buf[4]]);
+        assert!(dictionary_len > 0);
+
+        let pack = DataPack::new(&path)?;
+        for delta in deltas.iter() {
+            assert_eq!(pack.get_delta_chain(&delta.key)?, Some(vec![delta.clone()]));
+        }
+        Ok(())
+    }
+
+    #[test]
+    fn test_zstd_without_dictionary() -> Result<()> {
+        let tempdir = tempdir()?;
+        let mutdatapack = MutableDataPack::new(tempdir.path(), DataPackVersion::Two)?;
+        let delta = Delta {
+            data: Bytes::from(&[0, 1, 2][..]),
+            base: None,
+            key: Key::new(RepoPathBuf::new(), hgid("1")),
+        };
+        mutdatapack.add(&delta, &Default::default())?;
+        let path = mutdatapack.flush()?.unwrap();
+
+        let pack = DataPack::new(&path)?;
+        assert_eq!(pack.get_delta_chain(&delta.key)?, Some(vec![delta]));
+        Ok(())
+    }
+
     #[test]
     fn test_get_meta() {
         let tempdir = tempdir().unwrap();
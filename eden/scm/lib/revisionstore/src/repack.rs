@@ -166,8 +166,9 @@ fn repack_packs<T: MutablePack, U: LocalStore + Repackable + ToKeys>(
 fn repack_datapacks(
     paths: impl IntoIterator<Item = PathBuf> + Clone,
     outdir: &Path,
+    version: DataPackVersion,
 ) -> Result<PathBuf> {
-    let mut_pack = MutableDataPack::new(outdir, DataPackVersion::One)?;
+    let mut_pack = MutableDataPack::new(outdir, version)?;
 
     repack_packs(paths, mut_pack, repack_datapack)
 }
@@ -289,7 +290,9 @@ fn repack_no_store(path: PathBuf, kind: RepackKind, config: &ConfigSet) -> Resul
         histpacks = filter_incrementalpacks(histpacks, "histpack", config)?;
     }
 
-    let datapack_res = repack_datapacks(datapacks, &path).map(|_| ());
+    // Version 2 packs are compressed with zstd rather than lz4.
+    let version = DataPackVersion::new(config.get_or("repack", "datapackversion", || 1)?)?;
+    let datapack_res = repack_datapacks(datapacks, &path, version).map(|_| ());
     let histpack_res = repack_historypacks(histpacks, &path).map(|_| ());
 
     datapack_res.and(histpack_res)
@@ -559,7 +562,7 @@ mod tests {
     fn test_repack_no_datapack() {
         let tempdir = TempDir::new().unwrap();
 
-        let newpath = repack_datapacks(vec![].into_iter(), tempdir.path());
+        let newpath = repack_datapacks(vec![].into_iter(), tempdir.path(), DataPackVersion::One);
         assert!(newpath.is_ok());
         let newpath = newpath.unwrap();
         assert_eq!(newpath.to_str(), Some(""));
@@ -582,6 +585,7 @@ mod tests {
         let newpath = repack_datapacks(
             vec![pack.base_path().to_path_buf()].into_iter(),
             tempdir.path(),
+            DataPackVersion::One,
         );
         assert!(newpath.is_ok());
         let newpath2 = newpath.unwrap();
@@ -634,7 +638,7 @@ mod tests {
             paths.push(path);
         }
 
-        let newpath = repack_datapacks(paths.into_iter(), tempdir.path());
+        let newpath = repack_datapacks(paths.into_iter(), tempdir.path(), DataPackVersion::One);
         assert!(newpath.is_ok());
         let newpack = DataPack::new(&newpath.unwrap()).unwrap();
         assert_eq!(
@@ -651,14 +655,45 @@ mod tests {
         );
     }
 
+    #[test]
+    fn test_repack_to_zstd_datapack() -> Result<()> {
+        let tempdir = TempDir::new()?;
+        let revisions = vec![(
+            Delta {
+                data: Bytes::from(&[1u8, 2, 3, 4][..]),
+                base: None,
+                key: key("a", "1"),
+            },
+            Default::default(),
+        )];
+        let pack = make_datapack(&tempdir, &revisions);
+
+        let newpath = repack_datapacks(
+            vec![pack.base_path().to_path_buf()].into_iter(),
+            tempdir.path(),
+            DataPackVersion::Two,
+        )?;
+        assert_ne!(newpath.with_extension("datapack"), pack.pack_path());
+        let newpack = DataPack::new(&newpath)?;
+        assert_eq!(
+            newpack.get(StoreKey::hgid(revisions[0].0.key.clone()))?,
+            StoreResult::Found(revisions[0].0.data.to_vec())
+        );
+        Ok(())
+    }
+
     #[test]
     fn test_repack_missing_files() {
         let tempdir = TempDir::new().unwrap();
 
         let paths = vec![PathBuf::from("foo.datapack"), PathBuf::from("bar.datapack")];
-        let res = repack_datapacks(paths.clone().into_iter(), tempdir.path())
-            .err()
-            .unwrap();
+        let res = repack_datapacks(
+            paths.clone().into_iter(),
+            tempdir.path(),
+            DataPackVersion::One,
+        )
+        .err()
+        .unwrap();
 
         if let Ok(RepackFailure::Total(errors)) = res.downcast() {
             assert_eq!(
@@ -717,7 +752,7 @@ mod tests {
         file.write_all(b"FOOBARBAZ").unwrap();
         drop(file);
 
-        let res = repack_datapacks(paths.into_iter(), tempdir.path())
+        let res = repack_datapacks(paths.into_iter(), tempdir.path(), DataPackVersion::One)
             .err()
             .unwrap();
 
@@ -51,6 +51,12 @@ typedef struct s_mmbuffer {
 
 typedef struct s_xpparam {
 	uint64_t flags;
+	/*
+	 * Bounds the work of the diff, counted in diagonals visited, or 0 for
+	 * no bound.  Once it is spent, each remaining region that differs is
+	 * reported as changed as a whole, rather than being split further.
+	 */
+	int64_t max_cost;
 } xpparam_t;
 
 typedef struct s_xdemitcb {
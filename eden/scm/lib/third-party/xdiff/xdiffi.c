@@ -73,6 +73,7 @@ static int64_t xdl_split(uint64_t const *ha1, int64_t off1, int64_t lim1,
 	int64_t fmin = fmid, fmax = fmid;
 	int64_t bmin = bmid, bmax = bmid;
 	int64_t ec, d, i1, i2, prev1, best, dd, v, k;
+	int over_budget = 0;
 
 	/*
 	 * Set initial diagonal values for both forward and backward path.
@@ -153,7 +154,12 @@ static int64_t xdl_split(uint64_t const *ha1, int64_t off1, int64_t lim1,
 			}
 		}
 
-		if (need_min)
+		if (xenv->max_cost) {
+			xenv->cost += (fmax - fmin + bmax - bmin) / 2 + 2;
+			over_budget = xenv->cost > xenv->max_cost;
+		}
+
+		if (need_min && !over_budget)
 			continue;
 
 		/*
@@ -220,7 +226,7 @@ static int64_t xdl_split(uint64_t const *ha1, int64_t off1, int64_t lim1,
 		 * Enough is enough. We spent too much time here and now we collect
 		 * the furthest reaching path using the (i1 + i2) measure.
 		 */
-		if (ec >= xenv->mxcost) {
+		if (ec >= xenv->mxcost || over_budget) {
 			int64_t fbest, fbest1, bbest, bbest1;
 
 			fbest = fbest1 = -1;
@@ -296,6 +302,17 @@ int xdl_recs_cmp_vendored(diffdata_t *dd1, int64_t off1, int64_t lim1,
 
 		for (; off1 < lim1; off1++)
 			rchg1[rindex1[off1]] = 1;
+	} else if (xenv->max_cost && xenv->cost > xenv->max_cost) {
+		char *rchg1 = dd1->rchg, *rchg2 = dd2->rchg;
+		int64_t *rindex1 = dd1->rindex, *rindex2 = dd2->rindex;
+
+		/*
+		 * Out of budget: replace the whole box instead of splitting it.
+		 */
+		for (; off1 < lim1; off1++)
+			rchg1[rindex1[off1]] = 1;
+		for (; off2 < lim2; off2++)
+			rchg2[rindex2[off2]] = 1;
 	} else {
 		xdpsplit_t spl;
 		spl.i1 = spl.i2 = 0;
@@ -357,6 +374,8 @@ int xdl_do_diff_vendored(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 		xenv.mxcost = XDL_MAX_COST_MIN;
 	xenv.snake_cnt = XDL_SNAKE_CNT;
 	xenv.heur_min = XDL_HEUR_MIN_COST;
+	xenv.max_cost = xpp->max_cost > 0 ? xpp->max_cost : 0;
+	xenv.cost = 0;
 
 	dd1.nrec = xe->xdf1.nreff;
 	dd1.ha = xe->xdf1.ha;
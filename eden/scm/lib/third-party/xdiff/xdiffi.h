@@ -35,6 +35,9 @@ typedef struct s_xdalgoenv {
 	int64_t mxcost;
 	int64_t snake_cnt;
 	int64_t heur_min;
+	/* xpparam_t.max_cost, and the cost spent so far. */
+	int64_t max_cost;
+	int64_t cost;
 } xdalgoenv_t;
 
 typedef struct s_xdchange {
@@ -26,7 +26,6 @@
 #define XDL_KPDIS_RUN 4
 #define XDL_MAX_EQLIMIT 1024
 #define XDL_SIMSCAN_WINDOW 100
-#define XDL_GUESS_NLINES1 256
 
 
 typedef struct s_xdlclass {
@@ -340,16 +339,19 @@ static void xdl_free_ctx(xdfile_t *xdf) {
 
 int xdl_prepare_env_vendored(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 		    xdfenv_t *xe) {
-	int64_t enl1, enl2, sample;
+	int64_t enl1, enl2;
 	mmfile_t tmf1, tmf2;
 	xdlclassifier_t cf;
 
 	memset(&cf, 0, sizeof(cf));
 
-	sample = XDL_GUESS_NLINES1;
-
-	enl1 = xdl_guess_lines_vendored(mf1, sample) + 1;
-	enl2 = xdl_guess_lines_vendored(mf2, sample) + 1;
+	/*
+	 * Count the lines rather than guessing from a sample, so that the
+	 * classifier's hash table is sized for the files and the record arrays
+	 * never have to grow.
+	 */
+	enl1 = xdl_count_lines_vendored(mf1) + 1;
+	enl2 = xdl_count_lines_vendored(mf2) + 1;
 
 	if (xdl_init_classifier(&cf, enl1 + enl2 + 1, xpp->flags) < 0)
 		return -1;
@@ -30,6 +30,7 @@ int xdl_cha_init_vendored(chastore_t *cha, int64_t isize, int64_t icount);
 void xdl_cha_free_vendored(chastore_t *cha);
 void *xdl_cha_alloc_vendored(chastore_t *cha);
 int64_t xdl_guess_lines_vendored(mmfile_t *mf, int64_t sample);
+int64_t xdl_count_lines_vendored(mmfile_t *mf);
 int xdl_recmatch_vendored(const char *l1, int64_t s1, const char *l2, int64_t s2);
 uint64_t xdl_hash_record_vendored(char const **data, char const *top);
 unsigned int xdl_hashbits_vendored(int64_t size);
@@ -150,12 +150,13 @@ pub type mmbuffer_t = s_mmbuffer;
 #[derive(Debug, Copy, Clone)]
 pub struct s_xpparam {
     pub flags: u64,
+    pub max_cost: i64,
 }
 #[test]
 fn bindgen_test_layout_s_xpparam() {
     assert_eq!(
         ::std::mem::size_of::<s_xpparam>(),
-        8usize,
+        16usize,
         concat!("Size of: ", stringify!(s_xpparam))
     );
     assert_eq!(
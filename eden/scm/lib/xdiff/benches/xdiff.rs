@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+use minibench::{bench, elapsed};
+use xdiff::diff_hunks;
+
+/// Generates a large file of similar lines, like generated code, and a copy
+/// with scattered lines removed and inserted.
+fn generated_texts(lines: usize) -> (Vec<u8>, Vec<u8>) {
+    let mut old = Vec::new();
+    let mut new = Vec::new();
+    let mut state: u32 = 1;
+    for i in 0..lines {
+        state = state.wrapping_mul(1103515245).wrapping_add(12345);
+        let line = format!(
+            "  generated_value_{} = compute({}, \"field\");\n",
+            i % 50000,
+            state % 1000
+        );
+        old.extend_from_slice(line.as_bytes());
+        if state % 97 != 0 {
+            new.extend_from_slice(line.as_bytes());
+        }
+        if state % 89 == 0 {
+            new.extend_from_slice(format!("  inserted {}\n", state).as_bytes());
+        }
+    }
+    (old, new)
+}
+
+fn main() {
+    let (old, new) = generated_texts(2_000_000);
+    bench("diff_hunks 90MB generated file", || {
+        elapsed(|| {
+            diff_hunks(&old[..], &new[..]);
+        })
+    });
+
+    let (old, new) = generated_texts(20_000);
+    bench("diff_hunks 1MB generated file", || {
+        elapsed(|| {
+            diff_hunks(&old[..], &new[..]);
+        })
+    });
+}
@@ -91,6 +91,7 @@ where
     };
     let xpp = ffi::xpparam_t {
         flags: ffi::XDF_INDENT_HEURISTIC as u64,
+        max_cost: 0,
     };
     let xecfg = ffi::xdemitconf_t {
         flags: 0,
@@ -1663,7 +1663,7 @@ libraries = [
             "sources": ["lib/cdatapack/cdatapack.c"],
             "depends": ["lib/cdatapack/cdatapack.h"],
             "include_dirs": ["."] + include_dirs,
-            "libraries": ["lz4", SHA1_LIBRARY],
+            "libraries": ["lz4", "zstd", SHA1_LIBRARY],
             "extra_args": filter(None, [STDC99, WALL, WSTRICTPROTOTYPES] + cflags),
         },
     ),
@@ -34,6 +34,7 @@ New errors are not allowed. Warnings are strongly discouraged.
   Skipping edenscm/hgext/extlib/cstore/uniondatapackstore.h it has no-che?k-code (glob)
   Skipping edenscm/hgext/extlib/ctreemanifest/manifest.cpp it has no-che?k-code (glob)
   Skipping edenscm/hgext/extlib/ctreemanifest/manifest.h it has no-che?k-code (glob)
+  Skipping edenscm/hgext/extlib/ctreemanifest/manifest_arena.h it has no-che?k-code (glob)
   Skipping edenscm/hgext/extlib/ctreemanifest/manifest_entry.cpp it has no-che?k-code (glob)
   Skipping edenscm/hgext/extlib/ctreemanifest/manifest_entry.h it has no-che?k-code (glob)
   Skipping edenscm/hgext/extlib/ctreemanifest/manifest_fetcher.cpp it has no-che?k-code (glob)
@@ -66,3 +66,15 @@ for lines, rev, a1, a2, b1, b2, blines, usevec in generator(seed, endrev):
 for lines, rev, a1, a2, b1, b2, blines, usevec in generator(seed, endrev):
     log.annotate(rev)
     ensure(lines == log.annotateresult)
+
+# annotating again in reverse order should use the cached results for the
+# most recent revisions and give the same states
+states = []
+for lines, rev, a1, a2, b1, b2, blines, usevec in generator(seed, endrev):
+    states.append((rev, list(lines)))
+for rev, lines in reversed(states):
+    log.annotate(rev)
+    ensure(lines == log.annotateresult)
+    log.annotate(max(rev - 1, 1))
+    log.annotate(rev)
+    ensure(lines == log.annotateresult)